@@ -22,6 +22,9 @@ using MaybeABI = std::optional<model::ABI::Values>;
 ///
 /// If `ABI` parameter was not provided, `BinaryToRecordTheTypeAt.DefaultABI`
 /// is used instead.
+///
+/// If `Binary.DefaultPrototype` is already the default prototype for `ABI`,
+/// it's returned as is, instead of recording an identical copy.
 model::TypePath
 registerDefaultFunctionPrototype(model::Binary &Binary,
                                  detail::MaybeABI ABI = std::nullopt);
@@ -0,0 +1,141 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <array>
+#include <utility>
+
+#include "llvm/ADT/ArrayRef.h"
+
+#include "revng/ABI/RegisterSet.h"
+#include "revng/ABI/Trait.h"
+#include "revng/Model/ABI.h"
+#include "revng/Model/Register.h"
+#include "revng/Support/Assert.h"
+
+namespace abi {
+
+/// \brief Everything `abi::Trait` states about an ABI, available at runtime
+///
+/// Unlike going through `skippingEnumSwitch` for each of the properties, the
+/// descriptor of an ABI is fetched once, in constant time, through
+/// `getDescriptor`. On top of listing the registers in the order they are to
+/// be used in, it offers constant time membership tests for each of the lists.
+///
+/// See `abi::IsTrait` for the documentation of each of the fields.
+struct Descriptor {
+  using Registers = llvm::ArrayRef<model::Register::Values>;
+
+  model::ABI::Values ABI = model::ABI::Invalid;
+
+  bool ArgumentsArePositionBased = false;
+  bool OnlyStartDoubleArgumentsFromAnEvenRegister = false;
+  bool ArgumentsCanBeSplitBetweenRegistersAndStack = false;
+  bool UsePointerToCopyForStackArguments = false;
+
+  size_t MaximumGPRsPerAggregateArgument = 0;
+  size_t MaximumGPRsPerAggregateReturnValue = 0;
+  size_t MaximumGPRsPerScalarArgument = 0;
+  size_t MaximumGPRsPerScalarReturnValue = 0;
+
+  Registers GeneralPurposeArgumentRegisters;
+  Registers GeneralPurposeReturnValueRegisters;
+  Registers VectorArgumentRegisters;
+  Registers VectorReturnValueRegisters;
+  Registers CalleeSavedRegisters;
+
+  model::Register::Values
+    ReturnValueLocationRegister = model::Register::Invalid;
+  bool CalleeIsResponsibleForStackCleanup = false;
+  size_t StackAlignment = 0;
+  size_t MinimumStackArgumentSize = 0;
+
+  /// Registers allowed to be used for passing arguments, of either kind
+  RegisterSet ArgumentRegisterSet;
+
+  /// Registers allowed to be used for returning values, of either kind
+  RegisterSet ReturnValueRegisterSet;
+
+  RegisterSet CalleeSavedRegisterSet;
+
+public:
+  constexpr bool isArgument(model::Register::Values Register) const {
+    return ArgumentRegisterSet.contains(Register);
+  }
+
+  constexpr bool isReturnValue(model::Register::Values Register) const {
+    return ReturnValueRegisterSet.contains(Register);
+  }
+
+  constexpr bool isCalleeSaved(model::Register::Values Register) const {
+    return CalleeSavedRegisterSet.contains(Register);
+  }
+};
+
+namespace detail {
+
+template<model::ABI::Values A>
+constexpr Descriptor makeDescriptor() {
+  using T = abi::Trait<A>;
+  Descriptor Result;
+  Result.ABI = A;
+
+  Result.ArgumentsArePositionBased = T::ArgumentsArePositionBased;
+  Result.OnlyStartDoubleArgumentsFromAnEvenRegister = T::
+    OnlyStartDoubleArgumentsFromAnEvenRegister;
+  Result.ArgumentsCanBeSplitBetweenRegistersAndStack = T::
+    ArgumentsCanBeSplitBetweenRegistersAndStack;
+  Result.UsePointerToCopyForStackArguments = T::
+    UsePointerToCopyForStackArguments;
+
+  Result.MaximumGPRsPerAggregateArgument = T::MaximumGPRsPerAggregateArgument;
+  Result.MaximumGPRsPerAggregateReturnValue = T::
+    MaximumGPRsPerAggregateReturnValue;
+  Result.MaximumGPRsPerScalarArgument = T::MaximumGPRsPerScalarArgument;
+  Result.MaximumGPRsPerScalarReturnValue = T::MaximumGPRsPerScalarReturnValue;
+
+  Result.GeneralPurposeArgumentRegisters = T::GeneralPurposeArgumentRegisters;
+  Result.GeneralPurposeReturnValueRegisters = T::
+    GeneralPurposeReturnValueRegisters;
+  Result.VectorArgumentRegisters = T::VectorArgumentRegisters;
+  Result.VectorReturnValueRegisters = T::VectorReturnValueRegisters;
+  Result.CalleeSavedRegisters = T::CalleeSavedRegisters;
+
+  Result.ReturnValueLocationRegister = T::ReturnValueLocationRegister;
+  Result.CalleeIsResponsibleForStackCleanup = T::
+    CalleeIsResponsibleForStackCleanup;
+  Result.StackAlignment = T::StackAlignment;
+  Result.MinimumStackArgumentSize = T::MinimumStackArgumentSize;
+
+  using Set = RegisterSet;
+  Result.ArgumentRegisterSet = Set(T::GeneralPurposeArgumentRegisters)
+                               | Set(T::VectorArgumentRegisters);
+  Result.ReturnValueRegisterSet = Set(T::GeneralPurposeReturnValueRegisters)
+                                  | Set(T::VectorReturnValueRegisters);
+  Result.CalleeSavedRegisterSet = Set(T::CalleeSavedRegisters);
+
+  return Result;
+}
+
+template<size_t... Indices>
+constexpr std::array<Descriptor, sizeof...(Indices) + 1>
+makeDescriptors(std::index_sequence<Indices...>) {
+  // The first entry is left empty for `model::ABI::Invalid`
+  return { Descriptor{}, makeDescriptor<model::ABI::Values(Indices + 1)>()... };
+}
+
+constexpr size_t ValidABICount = model::ABI::Count - 1;
+inline constexpr auto
+  Descriptors = makeDescriptors(std::make_index_sequence<ValidABICount>());
+
+} // namespace detail
+
+/// \return the descriptor of \p ABI, in constant time
+constexpr const Descriptor &getDescriptor(model::ABI::Values ABI) {
+  revng_assert(ABI != model::ABI::Invalid && ABI < model::ABI::Count);
+  return detail::Descriptors[ABI];
+}
+
+} // namespace abi
@@ -25,6 +25,22 @@ tryConvertToCABI(const model::RawFunctionType &Function,
 model::TypePath convertToRaw(const model::CABIFunctionType &Function,
                              TupleTree<model::Binary> &TheBinary);
 
+/// Best effort conversion of all the `RawFunctionType`s in \p TheBinary to
+/// `CABIFunctionType`s.
+///
+/// The references to the converted types are rewritten in a single visit of
+/// the model, after all the conversions took place.
+///
+/// \return the number of converted types.
+size_t convertAllToCABI(TupleTree<model::Binary> &TheBinary,
+                        std::optional<model::ABI::Values> ABI = std::nullopt);
+
+/// Conversion of all the `CABIFunctionType`s in \p TheBinary to
+/// `RawFunctionType`s, see convertAllToCABI.
+///
+/// \return the number of converted types.
+size_t convertAllToRaw(TupleTree<model::Binary> &TheBinary);
+
 /// Indicates the layout of arguments and return values of a function.
 struct Layout {
 public:
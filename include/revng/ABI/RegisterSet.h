@@ -0,0 +1,148 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <array>
+#include <cstdint>
+#include <iterator>
+
+#include "llvm/Support/MathExtras.h"
+
+#include "revng/Model/Register.h"
+#include "revng/Support/Assert.h"
+
+namespace abi {
+
+/// \brief A constexpr set of registers, one bit per `model::Register`
+class RegisterSet {
+private:
+  static constexpr size_t WordCount = (model::Register::Count + 63) / 64;
+  std::array<uint64_t, WordCount> Words = {};
+
+public:
+  constexpr RegisterSet() = default;
+  template<typename RangeType>
+  constexpr explicit RegisterSet(const RangeType &Registers) {
+    for (model::Register::Values Register : Registers)
+      insert(Register);
+  }
+
+public:
+  constexpr void insert(model::Register::Values Register) {
+    Words[Register / 64] |= uint64_t(1) << (Register % 64);
+  }
+
+  constexpr bool contains(model::Register::Values Register) const {
+    return (Words[Register / 64] >> (Register % 64)) & 1;
+  }
+
+  constexpr bool none() const {
+    for (uint64_t Word : Words)
+      if (Word != 0)
+        return false;
+    return true;
+  }
+
+  constexpr bool any() const { return not none(); }
+
+  /// \brief Iterates over the registers in a set, in ascending order
+  class iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = model::Register::Values;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const model::Register::Values *;
+    using reference = model::Register::Values;
+
+  private:
+    const RegisterSet *Set = nullptr;
+    size_t Index = WordCount;
+    /// The bits of Words[Index] still to visit
+    uint64_t Remaining = 0;
+
+  public:
+    constexpr iterator() = default;
+    constexpr iterator(const RegisterSet *Set, size_t Index) :
+      Set(Set), Index(Index) {
+      skipEmptyWords();
+    }
+
+  public:
+    model::Register::Values operator*() const {
+      auto Bit = llvm::countTrailingZeros(Remaining);
+      return model::Register::Values(Index * 64 + Bit);
+    }
+
+    constexpr iterator &operator++() {
+      Remaining &= Remaining - 1;
+      if (Remaining == 0) {
+        ++Index;
+        skipEmptyWords();
+      }
+      return *this;
+    }
+
+    constexpr iterator operator++(int) {
+      iterator Result = *this;
+      ++*this;
+      return Result;
+    }
+
+    constexpr bool operator==(const iterator &Other) const {
+      return Index == Other.Index and Remaining == Other.Remaining;
+    }
+
+    constexpr bool operator!=(const iterator &Other) const {
+      return not(*this == Other);
+    }
+
+  private:
+    constexpr void skipEmptyWords() {
+      for (; Index < WordCount; ++Index) {
+        Remaining = Set->Words[Index];
+        if (Remaining != 0)
+          return;
+      }
+      Remaining = 0;
+    }
+  };
+
+  constexpr iterator begin() const { return iterator(this, 0); }
+  constexpr iterator end() const { return iterator(this, WordCount); }
+
+  /// \brief Enumerates the registers in the set, in ascending order
+  constexpr const RegisterSet &registers() const { return *this; }
+
+public:
+  constexpr RegisterSet operator|(const RegisterSet &Other) const {
+    RegisterSet Result;
+    for (size_t I = 0; I < WordCount; ++I)
+      Result.Words[I] = Words[I] | Other.Words[I];
+    return Result;
+  }
+
+  constexpr RegisterSet operator&(const RegisterSet &Other) const {
+    RegisterSet Result;
+    for (size_t I = 0; I < WordCount; ++I)
+      Result.Words[I] = Words[I] & Other.Words[I];
+    return Result;
+  }
+
+  /// \return the registers in this set but not in \p Other
+  constexpr RegisterSet operator-(const RegisterSet &Other) const {
+    RegisterSet Result;
+    for (size_t I = 0; I < WordCount; ++I)
+      Result.Words[I] = Words[I] & ~Other.Words[I];
+    return Result;
+  }
+
+  constexpr RegisterSet &operator|=(const RegisterSet &Other) {
+    return *this = *this | Other;
+  }
+
+  constexpr bool operator==(const RegisterSet &) const = default;
+};
+
+} // namespace abi
@@ -6,144 +6,90 @@
 
 #include "llvm/ADT/ArrayRef.h"
 
-#include "revng/ABI/Trait.h"
+#include "revng/ABI/Descriptor.h"
 #include "revng/Model/ABI.h"
-#include "revng/Support/EnumSwitch.h"
 
 namespace abi {
 
+// These are thin wrappers around `getDescriptor`: prefer fetching the
+// descriptor once when inspecting more than one property of an ABI.
+
 constexpr bool areArgumentsPositionBased(model::ABI::Values ABI) {
-  revng_assert(ABI != model::ABI::Invalid);
-  return skippingEnumSwitch<1>(ABI, [&]<model::ABI::Values A>() {
-    return abi::Trait<A>::ArgumentsArePositionBased;
-  });
+  return getDescriptor(ABI).ArgumentsArePositionBased;
 }
 
 constexpr bool
 canOnlyStartDoubleArgumentsFromAnEvenRegister(model::ABI::Values ABI) {
-  revng_assert(ABI != model::ABI::Invalid);
-  return skippingEnumSwitch<1>(ABI, [&]<model::ABI::Values A>() {
-    return abi::Trait<A>::OnlyStartDoubleArgumentsFromAnEvenRegister;
-  });
+  return getDescriptor(ABI).OnlyStartDoubleArgumentsFromAnEvenRegister;
 }
 
 constexpr bool
 canArgumentsBeSplitBetweenRegistersAndStack(model::ABI::Values ABI) {
-  revng_assert(ABI != model::ABI::Invalid);
-  return skippingEnumSwitch<1>(ABI, [&]<model::ABI::Values A>() {
-    return abi::Trait<A>::ArgumentsCanBeSplitBetweenRegistersAndStack;
-  });
+  return getDescriptor(ABI).ArgumentsCanBeSplitBetweenRegistersAndStack;
 }
 
 constexpr bool
 canOnlyUsePointerToCopyForStackArguments(model::ABI::Values ABI) {
-  revng_assert(ABI != model::ABI::Invalid);
-  return skippingEnumSwitch<1>(ABI, [&]<model::ABI::Values A>() {
-    return abi::Trait<A>::UsePointerToCopyForStackArguments;
-  });
+  return getDescriptor(ABI).UsePointerToCopyForStackArguments;
 }
 
 constexpr size_t countMaximumGPRsPerAggregateArgument(model::ABI::Values ABI) {
-  revng_assert(ABI != model::ABI::Invalid);
-  return skippingEnumSwitch<1>(ABI, [&]<model::ABI::Values A>() {
-    return abi::Trait<A>::MaximumGPRsPerAggregateArgument;
-  });
+  return getDescriptor(ABI).MaximumGPRsPerAggregateArgument;
 }
 
 constexpr size_t
 countMaximumGPRsPerAggregateReturnValue(model::ABI::Values ABI) {
-  revng_assert(ABI != model::ABI::Invalid);
-  return skippingEnumSwitch<1>(ABI, [&]<model::ABI::Values A>() {
-    return abi::Trait<A>::MaximumGPRsPerAggregateReturnValue;
-  });
+  return getDescriptor(ABI).MaximumGPRsPerAggregateReturnValue;
 }
 
 constexpr size_t countMaximumGPRsPerScalarArgument(model::ABI::Values ABI) {
-  revng_assert(ABI != model::ABI::Invalid);
-  return skippingEnumSwitch<1>(ABI, [&]<model::ABI::Values A>() {
-    return abi::Trait<A>::MaximumGPRsPerScalarArgument;
-  });
+  return getDescriptor(ABI).MaximumGPRsPerScalarArgument;
 }
 
 constexpr size_t countMaximumGPRsPerScalarReturnValue(model::ABI::Values ABI) {
-  revng_assert(ABI != model::ABI::Invalid);
-  return skippingEnumSwitch<1>(ABI, [&]<model::ABI::Values A>() {
-    return abi::Trait<A>::MaximumGPRsPerScalarReturnValue;
-  });
+  return getDescriptor(ABI).MaximumGPRsPerScalarReturnValue;
 }
 
 constexpr llvm::ArrayRef<model::Register::Values>
 listGeneralPurposeArgumentRegisters(model::ABI::Values ABI) {
-  revng_assert(ABI != model::ABI::Invalid);
-  using Registers = llvm::ArrayRef<model::Register::Values>;
-  return skippingEnumSwitch<1>(ABI, [&]<model::ABI::Values A>() -> Registers {
-    return abi::Trait<A>::GeneralPurposeArgumentRegisters;
-  });
+  return getDescriptor(ABI).GeneralPurposeArgumentRegisters;
 }
 
 constexpr llvm::ArrayRef<model::Register::Values>
 listGeneralPurposeReturnValueRegisters(model::ABI::Values ABI) {
-  revng_assert(ABI != model::ABI::Invalid);
-  using Registers = llvm::ArrayRef<model::Register::Values>;
-  return skippingEnumSwitch<1>(ABI, [&]<model::ABI::Values A>() -> Registers {
-    return abi::Trait<A>::GeneralPurposeReturnValueRegisters;
-  });
+  return getDescriptor(ABI).GeneralPurposeReturnValueRegisters;
 }
 
 constexpr llvm::ArrayRef<model::Register::Values>
 listVectorArgumentRegisters(model::ABI::Values ABI) {
-  revng_assert(ABI != model::ABI::Invalid);
-  using Registers = llvm::ArrayRef<model::Register::Values>;
-  return skippingEnumSwitch<1>(ABI, [&]<model::ABI::Values A>() -> Registers {
-    return abi::Trait<A>::VectorArgumentRegisters;
-  });
+  return getDescriptor(ABI).VectorArgumentRegisters;
 }
 
 constexpr llvm::ArrayRef<model::Register::Values>
 listVectorReturnValueRegisters(model::ABI::Values ABI) {
-  revng_assert(ABI != model::ABI::Invalid);
-  using Registers = llvm::ArrayRef<model::Register::Values>;
-  return skippingEnumSwitch<1>(ABI, [&]<model::ABI::Values A>() -> Registers {
-    return abi::Trait<A>::VectorReturnValueRegisters;
-  });
+  return getDescriptor(ABI).VectorReturnValueRegisters;
 }
 
 constexpr llvm::ArrayRef<model::Register::Values>
 listCalleeSavedRegisters(model::ABI::Values ABI) {
-  revng_assert(ABI != model::ABI::Invalid);
-  using Registers = llvm::ArrayRef<model::Register::Values>;
-  return skippingEnumSwitch<1>(ABI, [&]<model::ABI::Values A>() -> Registers {
-    return abi::Trait<A>::CalleeSavedRegisters;
-  });
+  return getDescriptor(ABI).CalleeSavedRegisters;
 }
 
 constexpr model::Register::Values
 getReturnValueLocationRegister(model::ABI::Values ABI) {
-  revng_assert(ABI != model::ABI::Invalid);
-  return skippingEnumSwitch<1>(ABI, [&]<model::ABI::Values A>() {
-    return abi::Trait<A>::ReturnValueLocationRegister;
-  });
+  return getDescriptor(ABI).ReturnValueLocationRegister;
 }
 
 constexpr bool isCalleeResponsibleForStackCleanup(model::ABI::Values ABI) {
-  revng_assert(ABI != model::ABI::Invalid);
-  return skippingEnumSwitch<1>(ABI, [&]<model::ABI::Values A>() {
-    return abi::Trait<A>::CalleeIsResponsibleForStackCleanup;
-  });
+  return getDescriptor(ABI).CalleeIsResponsibleForStackCleanup;
 }
 
 constexpr size_t getStackAlignment(model::ABI::Values ABI) {
-  revng_assert(ABI != model::ABI::Invalid);
-  return skippingEnumSwitch<1>(ABI, [&]<model::ABI::Values A>() {
-    return abi::Trait<A>::StackAlignment;
-  });
+  return getDescriptor(ABI).StackAlignment;
 }
 
 constexpr size_t getMinimumStackArgumentSize(model::ABI::Values ABI) {
-  revng_assert(ABI != model::ABI::Invalid);
-  return skippingEnumSwitch<1>(ABI, [&]<model::ABI::Values A>() {
-    return abi::Trait<A>::MinimumStackArgumentSize;
-  });
+  return getDescriptor(ABI).MinimumStackArgumentSize;
 }
 
 } // namespace abi
@@ -101,6 +101,9 @@ public:
 /// It is implemented as a vector of llvm::APInt. Each one of them represents a
 /// flip in the status of the range (`ON -> OFF` or `OFF -> ON`), starting from
 /// the initial state `OFF`.
+///
+/// Sets up to 64 bits wide, by far the most common, are combined and measured
+/// operating directly on the `uint64_t` value of the bounds.
 class ConstantRangeSet {
 private:
   APIntVector Bounds;
@@ -175,6 +178,9 @@ public:
     if (Bounds.size() == 0)
       return APInt(BitWidth, 0);
 
+    if (BitWidth <= 64)
+      return APInt(BitWidth, narrowSize());
+
     APInt Size(BitWidth, 0);
     const APInt *Last = nullptr;
     for (const llvm::APInt &N : Bounds) {
@@ -226,15 +232,92 @@ public:
   }
 
 private:
+  uint64_t narrowSize() const {
+    revng_assert(BitWidth <= 64);
+
+    uint64_t Size = 0;
+    uint64_t Last = 0;
+    bool Open = false;
+    for (const llvm::APInt &N : Bounds) {
+      uint64_t Value = N.getZExtValue();
+      if (not Open)
+        Last = Value;
+      else
+        Size += Value - Last;
+      Open = not Open;
+    }
+
+    if (Open)
+      Size += (~uint64_t(0) >> (64 - BitWidth)) - Last;
+
+    return Size;
+  }
+
   template<bool And>
   ConstantRangeSet merge(const ConstantRangeSet &Other) const {
-    using namespace llvm;
-
     auto ResultBitWidth = std::max(BitWidth, Other.BitWidth);
-    ConstantRangeSet Result(ResultBitWidth, false);
     revng_assert(BitWidth == 0 or Other.BitWidth == 0
                  or BitWidth == Other.BitWidth);
 
+    if (ResultBitWidth <= 64)
+      return mergeNarrow<And>(Other, ResultBitWidth);
+    else
+      return mergeWide<And>(Other, ResultBitWidth);
+  }
+
+  /// \brief merge for sets up to 64 bits wide, comparing the raw bounds
+  template<bool And>
+  ConstantRangeSet
+  mergeNarrow(const ConstantRangeSet &Other, uint32_t ResultBitWidth) const {
+    ConstantRangeSet Result(ResultBitWidth, false);
+    Result.Bounds.reserve(Bounds.size() + Other.Bounds.size());
+
+    bool LastOutput = false;
+    bool LeftActive = false;
+    bool RightActive = false;
+    auto LeftIt = Bounds.begin();
+    auto RightIt = Other.Bounds.begin();
+    const auto LeftEnd = Bounds.end();
+    const auto RightEnd = Other.Bounds.end();
+    while (LeftIt != LeftEnd or RightIt != RightEnd) {
+      bool HasLeft = LeftIt != LeftEnd;
+      bool HasRight = RightIt != RightEnd;
+      uint64_t Left = HasLeft ? LeftIt->getZExtValue() : 0;
+      uint64_t Right = HasRight ? RightIt->getZExtValue() : 0;
+      bool TakeLeft = HasLeft and (not HasRight or Left <= Right);
+      bool TakeRight = HasRight and (not HasLeft or Right <= Left);
+
+      if (TakeLeft) {
+        revng_assert(LeftIt->getBitWidth() == ResultBitWidth);
+        LeftActive = not LeftActive;
+        ++LeftIt;
+      }
+
+      if (TakeRight) {
+        revng_assert(RightIt->getBitWidth() == ResultBitWidth);
+        RightActive = not RightActive;
+        ++RightIt;
+      }
+
+      bool NewOutput = And ? (LeftActive and RightActive) :
+                             (LeftActive or RightActive);
+
+      if (NewOutput != LastOutput)
+        Result.Bounds.emplace_back(ResultBitWidth, TakeLeft ? Left : Right);
+
+      LastOutput = NewOutput;
+    }
+
+    return Result;
+  }
+
+  template<bool And>
+  ConstantRangeSet
+  mergeWide(const ConstantRangeSet &Other, uint32_t ResultBitWidth) const {
+    using namespace llvm;
+
+    ConstantRangeSet Result(ResultBitWidth, false);
+
     bool LastOutput = false;
     bool LeftActive = false;
     bool RightActive = false;
@@ -0,0 +1,136 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <algorithm>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/MathExtras.h"
+
+#include "revng/Support/Assert.h"
+
+/// \brief An immutable set of half-open intervals optimized for lookups
+///
+/// Overlapping intervals are merged upon construction, the remaining ones are
+/// stored in an array sorted in Eytzinger (breadth-first) order: the first
+/// levels of the implicit search tree, which every lookup goes through, share
+/// a few cache lines and the search loop has no unpredictable branches.
+template<typename T>
+class FlatIntervalSet {
+public:
+  using interval = std::pair<T, T>;
+
+private:
+  /// Starts of the intervals in Eytzinger order, 1-based, the first element
+  /// is unused
+  std::vector<T> Starts;
+
+  /// Ends of the intervals, in the same order as Starts
+  std::vector<T> Ends;
+
+public:
+  FlatIntervalSet() : Starts(1), Ends(1) {}
+
+  /// \param Intervals the [first, second) intervals, in any order
+  explicit FlatIntervalSet(std::vector<interval> Intervals) {
+    // Sort and merge overlapping intervals
+    llvm::erase_if(Intervals,
+                   [](const interval &I) { return not(I.first < I.second); });
+    std::sort(Intervals.begin(), Intervals.end());
+
+    std::vector<interval> Merged;
+    for (const interval &I : Intervals) {
+      if (not Merged.empty() and I.first < Merged.back().second)
+        Merged.back().second = std::max(Merged.back().second, I.second);
+      else
+        Merged.push_back(I);
+    }
+
+    Starts.resize(Merged.size() + 1);
+    Ends.resize(Merged.size() + 1);
+    size_t Next = 0;
+    layout(Merged, Next, 1);
+    revng_assert(Next == Merged.size());
+  }
+
+public:
+  size_t size() const { return Starts.size() - 1; }
+  bool empty() const { return size() == 0; }
+
+  /// \return the interval containing \p Value, if any
+  std::optional<interval> find(const T &Value) const {
+    size_t Index = lastStartNotGreaterThan(Value);
+    if (Index == 0 or not(Value < Ends[Index]))
+      return std::nullopt;
+
+    return interval{ Starts[Index], Ends[Index] };
+  }
+
+  bool contains(const T &Value) const { return find(Value).has_value(); }
+
+  /// \return the smallest interval including all the intervals in the set
+  std::optional<interval> hull() const {
+    if (empty())
+      return std::nullopt;
+
+    // The minimum is the leftmost node, the maximum the rightmost one
+    size_t First = 1;
+    while (2 * First <= size())
+      First = 2 * First;
+
+    size_t Last = 1;
+    while (2 * Last + 1 <= size())
+      Last = 2 * Last + 1;
+
+    return interval{ Starts[First], Ends[Last] };
+  }
+
+  /// \return the intervals in ascending order
+  std::vector<interval> intervals() const {
+    std::vector<interval> Result;
+    Result.reserve(size());
+    collect(Result, 1);
+    return Result;
+  }
+
+private:
+  void layout(const std::vector<interval> &Sorted, size_t &Next, size_t K) {
+    if (K > Sorted.size())
+      return;
+
+    // In-order visit of the implicit tree assigns the sorted elements
+    layout(Sorted, Next, 2 * K);
+    Starts[K] = Sorted[Next].first;
+    Ends[K] = Sorted[Next].second;
+    ++Next;
+    layout(Sorted, Next, 2 * K + 1);
+  }
+
+  void collect(std::vector<interval> &Result, size_t K) const {
+    if (K > size())
+      return;
+
+    collect(Result, 2 * K);
+    Result.emplace_back(Starts[K], Ends[K]);
+    collect(Result, 2 * K + 1);
+  }
+
+  /// \return the index of the greatest start lower than or equal to \p Value,
+  ///         or 0 if there's none
+  size_t lastStartNotGreaterThan(const T &Value) const {
+    const size_t Size = size();
+    size_t K = 1;
+    while (K <= Size)
+      K = 2 * K + (Starts[K] <= Value ? 1 : 0);
+
+    // Each bit of K records a step of the descent, 1 meaning we went right
+    // since Starts[K] <= Value. The answer is the node where we went right for
+    // the last time: drop the trailing left steps and the right one.
+    return K >> (llvm::countTrailingZeros(K) + 1);
+  }
+};
@@ -0,0 +1,406 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/GraphTraits.h"
+#include "llvm/ADT/STLExtras.h"
+
+#include "revng/ADT/GenericGraph.h"
+#include "revng/Support/Assert.h"
+
+template<typename T>
+concept IsFrozenNode = requires {
+  T::is_frozen_node;
+};
+
+template<typename T>
+concept IsFrozenGraph = requires {
+  T::is_frozen_graph;
+  typename T::Node;
+};
+
+/// \brief An immutable copy of a GenericGraph, in compressed sparse row form
+///
+/// All the nodes live in a single array, and so do all the successor edges and
+/// all the predecessor edges: the edges of each node are a contiguous slice of
+/// the corresponding array, in the same order they had in the original graph.
+/// This makes traversals (depth first, post order, SCCs...) much more cache
+/// friendly than on a GenericGraph, where each node and each list of edges is
+/// allocated on its own.
+///
+/// The data of the nodes can be modified, but nodes and edges cannot be added
+/// or removed. Predecessors are always available, even if the original graph
+/// was made of ForwardNodes. Edge labels are copied, which makes the frozen
+/// form only suitable for graphs with cheap to copy labels.
+template<typename NodeDataT, typename EdgeLabelT = Empty>
+class FrozenGraph {
+public:
+  // NOLINTNEXTLINE
+  static const bool is_frozen_graph = true;
+  using NodeData = NodeDataT;
+  using EdgeLabel = EdgeLabelT;
+
+public:
+  class Node;
+  using Edge = ::Edge<Node, EdgeLabel>;
+
+  class Node : public NodeDataT {
+  private:
+    friend class FrozenGraph;
+
+  public:
+    // NOLINTNEXTLINE
+    static const bool is_frozen_node = true;
+    using NodeData = NodeDataT;
+    using EdgeLabelData = EdgeLabelT;
+    using Edge = FrozenGraph::Edge;
+
+  private:
+    Edge *SuccessorsBegin = nullptr;
+    Edge *SuccessorsEnd = nullptr;
+    Edge *PredecessorsBegin = nullptr;
+    Edge *PredecessorsEnd = nullptr;
+
+  public:
+    explicit Node(const NodeData &Data) : NodeData(Data) {}
+
+    Node(const Node &) = delete;
+    Node(Node &&) = default;
+    Node &operator=(const Node &) = delete;
+    Node &operator=(Node &&) = default;
+
+  public:
+    NodeData &data() { return *this; }
+    const NodeData &data() const { return *this; }
+
+    NodeData copyData() const { return *this; }
+
+  public:
+    static Node *getNeighbor(Edge &E) { return E.Neighbor; }
+    static const Node *getConstNeighbor(const Edge &E) { return E.Neighbor; }
+
+  private:
+    using iterator_filter = decltype(&getNeighbor);
+    using const_iterator_filter = decltype(&getConstNeighbor);
+
+  public:
+    using child_iterator = llvm::mapped_iterator<Edge *, iterator_filter>;
+    using const_child_iterator = llvm::mapped_iterator<const Edge *,
+                                                       const_iterator_filter>;
+    using edge_iterator = Edge *;
+    using const_edge_iterator = const Edge *;
+
+  public:
+    // This stuff is needed by the DominatorTree implementation
+    void printAsOperand(llvm::raw_ostream &, bool) const { revng_abort(); }
+
+  public:
+    llvm::MutableArrayRef<Edge> successor_edges() {
+      return { SuccessorsBegin, SuccessorsEnd };
+    }
+    llvm::ArrayRef<Edge> successor_edges() const {
+      return { SuccessorsBegin, SuccessorsEnd };
+    }
+
+    llvm::MutableArrayRef<Edge> predecessor_edges() {
+      return { PredecessorsBegin, PredecessorsEnd };
+    }
+    llvm::ArrayRef<Edge> predecessor_edges() const {
+      return { PredecessorsBegin, PredecessorsEnd };
+    }
+
+    llvm::iterator_range<child_iterator> successors() {
+      return toNeighbors(SuccessorsBegin, SuccessorsEnd);
+    }
+    llvm::iterator_range<const_child_iterator> successors() const {
+      return toNeighbors(SuccessorsBegin, SuccessorsEnd);
+    }
+
+    llvm::iterator_range<child_iterator> predecessors() {
+      return toNeighbors(PredecessorsBegin, PredecessorsEnd);
+    }
+    llvm::iterator_range<const_child_iterator> predecessors() const {
+      return toNeighbors(PredecessorsBegin, PredecessorsEnd);
+    }
+
+    bool hasSuccessors() const { return SuccessorsBegin != SuccessorsEnd; }
+    size_t successorCount() const { return SuccessorsEnd - SuccessorsBegin; }
+
+    bool hasPredecessors() const {
+      return PredecessorsBegin != PredecessorsEnd;
+    }
+    size_t predecessorCount() const {
+      return PredecessorsEnd - PredecessorsBegin;
+    }
+
+  private:
+    static llvm::iterator_range<child_iterator>
+    toNeighbors(Edge *Begin, Edge *End) {
+      return llvm::make_range(child_iterator(Begin, getNeighbor),
+                              child_iterator(End, getNeighbor));
+    }
+
+    static llvm::iterator_range<const_child_iterator>
+    toNeighbors(const Edge *Begin, const Edge *End) {
+      return llvm::make_range(const_child_iterator(Begin, getConstNeighbor),
+                              const_child_iterator(End, getConstNeighbor));
+    }
+  };
+
+private:
+  static Node *getNode(Node &N) { return &N; }
+  static const Node *getConstNode(const Node &N) { return &N; }
+
+public:
+  using nodes_iterator = llvm::mapped_iterator<Node *, decltype(&getNode)>;
+  using const_nodes_iterator = llvm::mapped_iterator<const Node *,
+                                                     decltype(&getConstNode)>;
+
+private:
+  std::vector<Node> Nodes;
+
+  /// The successors of all the nodes, one slice per node, in node order
+  std::vector<Edge> Successors;
+
+  /// Same as Successors, for predecessors
+  std::vector<Edge> Predecessors;
+
+  Node *EntryNode = nullptr;
+
+public:
+  FrozenGraph() = default;
+
+  /// \brief Lay out a frozen copy of \p Graph
+  ///
+  /// Nodes keep the order they have in \p Graph.
+  template<IsGenericGraph GraphType>
+  explicit FrozenGraph(const GraphType &Graph);
+
+  // Nodes and edges point to each other, copying would require patching them
+  FrozenGraph(const FrozenGraph &) = delete;
+  FrozenGraph &operator=(const FrozenGraph &) = delete;
+
+  // Moving the vectors, on the other hand, preserves their storage
+  FrozenGraph(FrozenGraph &&) = default;
+  FrozenGraph &operator=(FrozenGraph &&) = default;
+
+public:
+  llvm::iterator_range<nodes_iterator> nodes() {
+    Node *Begin = Nodes.data();
+    return llvm::make_range(nodes_iterator(Begin, getNode),
+                            nodes_iterator(Begin + Nodes.size(), getNode));
+  }
+
+  llvm::iterator_range<const_nodes_iterator> nodes() const {
+    const Node *Begin = Nodes.data();
+    return llvm::make_range(const_nodes_iterator(Begin, getConstNode),
+                            const_nodes_iterator(Begin + Nodes.size(),
+                                                 getConstNode));
+  }
+
+  size_t size() const { return Nodes.size(); }
+
+  /// \return the position of \p N in the nodes of the graph, which is also its
+  ///         position in the original graph
+  size_t getIndex(const Node *N) const {
+    revng_assert(N >= Nodes.data() and N < Nodes.data() + Nodes.size());
+    return N - Nodes.data();
+  }
+
+  Node *getNodeAt(size_t Index) { return &Nodes[Index]; }
+  const Node *getNodeAt(size_t Index) const { return &Nodes[Index]; }
+
+  Node *getEntryNode() const { return EntryNode; }
+};
+
+template<typename NodeDataT, typename EdgeLabelT>
+template<IsGenericGraph GraphType>
+FrozenGraph<NodeDataT, EdgeLabelT>::FrozenGraph(const GraphType &Graph) {
+  using SourceNode = typename GraphType::Node;
+  static_assert(std::is_base_of_v<NodeData, SourceNode>);
+
+  auto GetLabel = [](const auto &SourceEdge) -> const EdgeLabel & {
+    if constexpr (IsMutableEdgeNode<SourceNode>)
+      return *SourceEdge.Label;
+    else
+      return SourceEdge;
+  };
+
+  // Lay out the nodes and count the edges of each of them.
+  // Offsets[I + 1] will be the number of successors of I, and
+  // PredecessorOffsets[I + 1] the number of its predecessors.
+  llvm::DenseMap<const SourceNode *, uint32_t> Indices;
+  Nodes.reserve(Graph.size());
+  std::vector<uint32_t> Offsets(Graph.size() + 1, 0);
+  std::vector<uint32_t> PredecessorOffsets(Graph.size() + 1, 0);
+  for (const SourceNode *N : Graph.nodes()) {
+    Indices[N] = Nodes.size();
+    Nodes.emplace_back(N->data());
+    Offsets[Nodes.size()] = N->successorCount();
+  }
+
+  size_t EdgeCount = 0;
+  for (const SourceNode *N : Graph.nodes()) {
+    for (const auto &SourceEdge : N->successor_edges()) {
+      ++PredecessorOffsets[Indices.lookup(SourceEdge.Neighbor) + 1];
+      ++EdgeCount;
+    }
+  }
+
+  for (size_t I = 1; I < Offsets.size(); ++I) {
+    Offsets[I] += Offsets[I - 1];
+    PredecessorOffsets[I] += PredecessorOffsets[I - 1];
+  }
+
+  // Fill the edges. Successors are emitted in order, for predecessors we
+  // need to keep track of the next free slot of each node.
+  Successors.reserve(EdgeCount);
+  Predecessors.resize(EdgeCount, Edge(nullptr));
+  std::vector<uint32_t> Next(PredecessorOffsets.begin(),
+                             PredecessorOffsets.end() - 1);
+  for (const SourceNode *N : Graph.nodes()) {
+    Node *Source = &Nodes[Indices.lookup(N)];
+    for (const auto &SourceEdge : N->successor_edges()) {
+      uint32_t Destination = Indices.lookup(SourceEdge.Neighbor);
+      const EdgeLabel &Label = GetLabel(SourceEdge);
+      Successors.emplace_back(&Nodes[Destination], Label);
+      Predecessors[Next[Destination]++] = Edge(Source, Label);
+    }
+  }
+  revng_assert(Successors.size() == EdgeCount);
+
+  for (size_t I = 0; I < Nodes.size(); ++I) {
+    Node &N = Nodes[I];
+    N.SuccessorsBegin = Successors.data() + Offsets[I];
+    N.SuccessorsEnd = Successors.data() + Offsets[I + 1];
+    N.PredecessorsBegin = Predecessors.data() + PredecessorOffsets[I];
+    N.PredecessorsEnd = Predecessors.data() + PredecessorOffsets[I + 1];
+  }
+
+  if constexpr (GraphType::hasEntryNode)
+    if (auto *Entry = Graph.getEntryNode())
+      EntryNode = &Nodes[Indices.lookup(Entry)];
+}
+
+/// \brief Lay out a frozen copy of \p Graph
+template<IsGenericGraph GraphType>
+auto freeze(const GraphType &Graph) {
+  using SourceNode = typename GraphType::Node;
+  using NodeData = typename SourceNode::NodeData;
+  using EdgeLabel = typename SourceNode::EdgeLabelData;
+  return FrozenGraph<NodeData, EdgeLabel>(Graph);
+}
+
+//
+// GraphTraits implementation for FrozenGraph
+//
+namespace llvm {
+
+/// Implement GraphTraits<FrozenGraph::Node>
+template<IsFrozenNode T>
+struct GraphTraits<T *> {
+public:
+  using NodeRef = T *;
+
+  template<typename Ty, typename True, typename False>
+  using if_const = std::conditional_t<std::is_const_v<Ty>, True, False>;
+  using ChildIteratorType = if_const<T,
+                                     typename T::const_child_iterator,
+                                     typename T::child_iterator>;
+  using EdgeRef = if_const<T, const typename T::Edge &, typename T::Edge &>;
+  using ChildEdgeIteratorType = if_const<T,
+                                         typename T::const_edge_iterator,
+                                         typename T::edge_iterator>;
+
+public:
+  static ChildIteratorType child_begin(NodeRef N) {
+    return N->successors().begin();
+  }
+
+  static ChildIteratorType child_end(NodeRef N) {
+    return N->successors().end();
+  }
+
+  static ChildEdgeIteratorType child_edge_begin(NodeRef N) {
+    return N->successor_edges().begin();
+  }
+
+  static ChildEdgeIteratorType child_edge_end(NodeRef N) {
+    return N->successor_edges().end();
+  }
+
+  static NodeRef edge_dest(EdgeRef Edge) { return Edge.Neighbor; }
+
+  static NodeRef getEntryNode(NodeRef N) { return N; };
+};
+
+/// Implement GraphTraits<Inverse<FrozenGraph::Node>>
+template<IsFrozenNode T>
+struct GraphTraits<llvm::Inverse<T *>> {
+public:
+  using NodeRef = T *;
+
+  template<typename Ty, typename True, typename False>
+  using if_const = std::conditional_t<std::is_const_v<Ty>, True, False>;
+  using ChildIteratorType = if_const<T,
+                                     typename T::const_child_iterator,
+                                     typename T::child_iterator>;
+  using EdgeRef = if_const<T, const typename T::Edge &, typename T::Edge &>;
+  using ChildEdgeIteratorType = if_const<T,
+                                         typename T::const_edge_iterator,
+                                         typename T::edge_iterator>;
+
+public:
+  static ChildIteratorType child_begin(NodeRef N) {
+    return N->predecessors().begin();
+  }
+
+  static ChildIteratorType child_end(NodeRef N) {
+    return N->predecessors().end();
+  }
+
+  static ChildEdgeIteratorType child_edge_begin(NodeRef N) {
+    return N->predecessor_edges().begin();
+  }
+
+  static ChildEdgeIteratorType child_edge_end(NodeRef N) {
+    return N->predecessor_edges().end();
+  }
+
+  static NodeRef edge_dest(EdgeRef Edge) { return Edge.Neighbor; }
+
+  static NodeRef getEntryNode(llvm::Inverse<NodeRef> N) { return N.Graph; };
+};
+
+/// Implement GraphTraits<FrozenGraph>
+template<IsFrozenGraph T>
+struct GraphTraits<T *>
+  : public GraphTraits<std::conditional_t<std::is_const_v<T>,
+                                          const typename T::Node *,
+                                          typename T::Node *>> {
+
+  using NodeRef = std::conditional_t<std::is_const_v<T>,
+                                     const typename T::Node *,
+                                     typename T::Node *>;
+  using nodes_iterator = std::conditional_t<std::is_const_v<T>,
+                                            typename T::const_nodes_iterator,
+                                            typename T::nodes_iterator>;
+
+  static NodeRef getEntryNode(T *G) { return G->getEntryNode(); }
+
+  static nodes_iterator nodes_begin(T *G) { return G->nodes().begin(); }
+
+  static nodes_iterator nodes_end(T *G) { return G->nodes().end(); }
+
+  static size_t size(T *G) { return G->size(); }
+};
+
+} // namespace llvm
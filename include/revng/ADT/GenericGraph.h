@@ -219,6 +219,7 @@ public:
   using Base = typename TypeCalc::Result;
   using Edge = Edge<DerivedType, EdgeLabel>;
   using NodeData = Node;
+  using EdgeLabelData = EdgeLabel;
 
 public:
   template<typename... ArgTypes>
@@ -0,0 +1,152 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "llvm/ADT/Hashing.h"
+#include "llvm/Support/MathExtras.h"
+
+namespace revng::detail {
+
+using llvm::hash_value;
+
+template<typename K>
+concept HasHashValue = requires(const K &Key) {
+  { hash_value(Key) } -> std::convertible_to<size_t>;
+};
+
+template<HasHashValue K>
+inline size_t hashKey(const K &Key) {
+  return hash_value(Key);
+}
+
+} // namespace revng::detail
+
+/// \brief Lazily built open-addressing hash index on the keys of a container
+///
+/// The index maps the keys of the elements of a random access container to
+/// their position. It's built only once the lookups since the last
+/// invalidation have cost, in binary searches, about as much as building it,
+/// so that workloads alternating insertions and lookups never pay for it,
+/// while those performing many lookups on a container that does not change
+/// get O(1) lookups.
+///
+/// The index is built by lookups, i.e., by const methods of the owning
+/// container, which might run on multiple threads: concurrent builders race
+/// to publish their index and the losers discard theirs. Invalidation is
+/// performed on mutation of the owner, which must not be concurrent with
+/// lookups anyway.
+class LazyKeyIndex {
+private:
+  struct Table {
+    /// Position + 1 of the element in each slot, 0 for empty slots
+    std::vector<uint32_t> Slots;
+    size_t Mask = 0;
+  };
+
+public:
+  /// Below this size, binary search is good enough
+  static constexpr size_t MinimumSize = 64;
+
+private:
+  mutable std::atomic<Table *> Index = nullptr;
+  mutable std::atomic<size_t> Lookups = 0;
+
+public:
+  LazyKeyIndex() = default;
+  ~LazyKeyIndex() { delete Index.load(); }
+
+  // The index refers to the positions of the elements of a specific
+  // container, never transfer it. Moving also changes the content of the
+  // moved-from container, drop its index too.
+  LazyKeyIndex(const LazyKeyIndex &) {}
+  LazyKeyIndex(LazyKeyIndex &&Other) noexcept { Other.invalidate(); }
+  LazyKeyIndex &operator=(const LazyKeyIndex &) {
+    invalidate();
+    return *this;
+  }
+  LazyKeyIndex &operator=(LazyKeyIndex &&Other) noexcept {
+    invalidate();
+    Other.invalidate();
+    return *this;
+  }
+
+  /// The index is not part of the value of the owning container
+  bool operator==(const LazyKeyIndex &) const { return true; }
+
+public:
+  /// \brief Drop the index, to be called whenever the owner is modified
+  void invalidate() {
+    delete Index.exchange(nullptr);
+    Lookups = 0;
+  }
+
+  /// \brief Look up \p Key among the \p Size elements of the owner
+  ///
+  /// \p KeyAt returns the key of the element at a certain position, \p Equal
+  ///        compare two keys.
+  ///
+  /// \return std::nullopt if the index is not available (yet), \p Size if
+  ///         there's no element with such a key, its position otherwise.
+  template<typename K, typename KeyAtT, typename EqualT>
+  std::optional<size_t>
+  find(const K &Key, size_t Size, KeyAtT &&KeyAt, EqualT &&Equal) const {
+    const Table *Current = get(Size, KeyAt);
+    if (Current == nullptr)
+      return std::nullopt;
+
+    size_t Slot = revng::detail::hashKey(Key) & Current->Mask;
+    while (uint32_t Entry = Current->Slots[Slot]) {
+      if (Equal(KeyAt(Entry - 1), Key))
+        return Entry - 1;
+      Slot = (Slot + 1) & Current->Mask;
+    }
+
+    return Size;
+  }
+
+private:
+  template<typename KeyAtT>
+  const Table *get(size_t Size, KeyAtT &KeyAt) const {
+    if (Table *Current = Index.load(std::memory_order_acquire))
+      return Current;
+
+    if (Size < MinimumSize or Size >= std::numeric_limits<uint32_t>::max())
+      return nullptr;
+
+    // Build the index once the lookups have been as expensive as building it
+    size_t Count = Lookups.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (Count * llvm::Log2_64_Ceil(Size) < Size)
+      return nullptr;
+
+    // Keep the load factor at most 1/2
+    auto New = std::make_unique<Table>();
+    size_t Capacity = llvm::PowerOf2Ceil(2 * Size);
+    New->Slots.assign(Capacity, 0);
+    New->Mask = Capacity - 1;
+    for (size_t Position = 0; Position < Size; ++Position) {
+      size_t Slot = revng::detail::hashKey(KeyAt(Position)) & New->Mask;
+      while (New->Slots[Slot] != 0)
+        Slot = (Slot + 1) & New->Mask;
+      New->Slots[Slot] = Position + 1;
+    }
+
+    Table *Expected = nullptr;
+    if (Index.compare_exchange_strong(Expected,
+                                      New.get(),
+                                      std::memory_order_acq_rel,
+                                      std::memory_order_acquire))
+      return New.release();
+
+    // Somebody else published its index first
+    return Expected;
+  }
+};
@@ -4,10 +4,12 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <bit>
 #include <climits>
 #include <cstdint>
 #include <cstring>
 #include <limits>
+#include <type_traits>
 
 #include "boost/iterator/iterator_facade.hpp"
 
@@ -15,10 +17,12 @@
 
 // TODO: implement shrinking
 
-// TODO: implement using __builtin_clz if available
 /// \brief Returns the minimum amount of bits required to represent \p Value
 template<typename T>
 inline unsigned requiredBits(T Value) {
+  if constexpr (std::is_unsigned_v<T>)
+    return std::bit_width(Value);
+
   unsigned Result = 0;
 
   while (Value != 0) {
@@ -128,6 +132,9 @@ private:
       return Storage[Index];
     }
 
+    uintptr_t *words() { return Storage; }
+    const uintptr_t *words() const { return Storage; }
+
     void zero(size_t From, size_t Count) {
       revng_assert(From + Count <= wordCount());
       memset(&at(From), 0, Count * sizeof(uintptr_t));
@@ -403,10 +410,11 @@ public:
       const LargeStorage &OtherLarge = Other.getLarge();
       LargeStorage &ThisLarge = getLarge();
 
-      unsigned Max = std::min(ThisLarge.capacity(), OtherLarge.capacity());
-      Max /= BitsPerPointer;
-      for (unsigned I = 0; I < Max; I++)
-        ThisLarge.at(I) = ThisLarge.at(I) ^ OtherLarge.at(I);
+      unsigned Max = std::min(ThisLarge.wordCount(), OtherLarge.wordCount());
+      combineWords(ThisLarge.words(),
+                   OtherLarge.words(),
+                   Max,
+                   [](uintptr_t A, uintptr_t B) { return A ^ B; });
 
     } else if (!isSmall() && Other.isSmall()) {
       LargeStorage &ThisLarge = getLarge();
@@ -431,11 +439,11 @@ public:
       const LargeStorage &OtherLarge = Other.getLarge();
       LargeStorage &ThisLarge = getLarge();
 
-      unsigned Max = std::min(ThisLarge.capacity(), OtherLarge.capacity());
-      Max /= BitsPerPointer;
-
-      for (unsigned I = 0; I < Max; I++)
-        ThisLarge.at(I) = ThisLarge.at(I) | OtherLarge.at(I);
+      unsigned Max = std::min(ThisLarge.wordCount(), OtherLarge.wordCount());
+      combineWords(ThisLarge.words(),
+                   OtherLarge.words(),
+                   Max,
+                   [](uintptr_t A, uintptr_t B) { return A | B; });
 
     } else if (!isSmall() && Other.isSmall()) {
       LargeStorage &ThisLarge = getLarge();
@@ -477,14 +485,57 @@ public:
         }
 
         unsigned Max = std::min(OtherPointersCount, ThisPointersCount);
-        for (unsigned I = 0; I < Max; I++)
-          Large.at(I) = Large.at(I) & OtherLarge.at(I);
+        combineWords(Large.words(),
+                     OtherLarge.words(),
+                     Max,
+                     [](uintptr_t A, uintptr_t B) { return A & B; });
       }
     }
 
     return *this;
   }
 
+  /// \brief Clears all the bits that are set in \p Other
+  LazySmallBitVector &andNot(const LazySmallBitVector &Other) {
+    if (isSmall()) {
+      uintptr_t OtherValue;
+      if (Other.isSmall())
+        OtherValue = Other.getSmall();
+      else
+        OtherValue = Other.getLarge().at(0);
+
+      setSmall(getSmall() & ~OtherValue);
+    } else if (Other.isSmall()) {
+      LargeStorage &Large = getLarge();
+      Large.at(0) = Large.at(0) & ~Other.getSmall();
+    } else {
+      const LargeStorage &OtherLarge = Other.getLarge();
+      LargeStorage &ThisLarge = getLarge();
+
+      unsigned Max = std::min(ThisLarge.wordCount(), OtherLarge.wordCount());
+      combineWords(ThisLarge.words(),
+                   OtherLarge.words(),
+                   Max,
+                   [](uintptr_t A, uintptr_t B) { return A & ~B; });
+    }
+
+    return *this;
+  }
+
+  /// \brief Returns the number of bits set
+  unsigned count() const {
+    if (isSmall())
+      return std::popcount(getSmall());
+
+    const LargeStorage &Large = getLarge();
+    const uintptr_t *Words = Large.words();
+    unsigned Result = 0;
+    for (unsigned I = 0; I < Large.wordCount(); I++)
+      Result += std::popcount(Words[I]);
+
+    return Result;
+  }
+
   LazySmallBitVector &operator>>=(unsigned Amount) {
     revng_assert(Amount <= capacity());
 
@@ -587,27 +638,35 @@ public:
   /// \return 0 if no bits are set after \p StartIndex, the 1-based index of the
   ///         next bit set otherwise
   unsigned findNext(unsigned StartIndex) const {
-    if (StartIndex >= requiredBits())
+    // Note: this must not go through requiredBits, which scans all the words,
+    // otherwise iterating over the set bits would be quadratic
+    if (StartIndex >= capacity())
       return 0;
 
     if (isSmall()) {
-      return StartIndex + findFirstBit(getSmall() >> StartIndex);
+      uintptr_t Value = getSmall() >> StartIndex;
+      if (Value == 0)
+        return 0;
+
+      return StartIndex + findFirstBit(Value);
     } else {
       const LargeStorage &Large = getLarge();
+      const uintptr_t *Words = Large.words();
+      unsigned WordCount = Large.wordCount();
       unsigned Index = StartIndex / BitsPerPointer;
       unsigned ShiftAmount = StartIndex % BitsPerPointer;
 
-      uintptr_t FirstValue = Large.at(Index) >> ShiftAmount;
+      uintptr_t FirstValue = Words[Index] >> ShiftAmount;
       if (FirstValue != 0)
         return StartIndex + findFirstBit(FirstValue);
 
       do {
         Index++;
-        if (Index * BitsPerPointer >= capacity())
+        if (Index >= WordCount)
           return 0;
-      } while (Large.at(Index) == 0);
+      } while (Words[Index] == 0);
 
-      return Index * BitsPerPointer + findFirstBit(Large.at(Index));
+      return Index * BitsPerPointer + findFirstBit(Words[Index]);
     }
   }
 
@@ -681,6 +740,21 @@ private:
     revng_assert(!isSmall());
   }
 
+  /// \brief Sets each of the first \p Count words of \p Destination to the
+  ///        result of \p Operation on it and on the corresponding one of
+  ///        \p Source
+  ///
+  /// This is a simple loop over raw words, without branches nor bounds checks,
+  /// so that the compiler can vectorize it.
+  template<typename F>
+  static void combineWords(uintptr_t *Destination,
+                           const uintptr_t *Source,
+                           size_t Count,
+                           F Operation) {
+    for (size_t I = 0; I < Count; I++)
+      Destination[I] = Operation(Destination[I], Source[I]);
+  }
+
   LargeStorage &getLarge() {
     revng_assert(!isSmall());
     return *reinterpret_cast<LargeStorage *>(Storage);
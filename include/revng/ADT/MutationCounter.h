@@ -0,0 +1,40 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <cstdint>
+
+/// \brief Counter of the mutations of the owning container
+///
+/// Lets the users of a container tell whether it changed since they last
+/// looked at it, e.g., to rebuild an index of its elements. Assigning to or
+/// moving from the owner counts as a mutation, so that its value never
+/// repeats for a given owner.
+class MutationCounter {
+private:
+  uint64_t Value = 0;
+
+public:
+  MutationCounter() = default;
+
+  MutationCounter(const MutationCounter &) {}
+  MutationCounter(MutationCounter &&Other) noexcept { Other.bump(); }
+  MutationCounter &operator=(const MutationCounter &) {
+    bump();
+    return *this;
+  }
+  MutationCounter &operator=(MutationCounter &&Other) noexcept {
+    bump();
+    Other.bump();
+    return *this;
+  }
+
+  /// The counter is not part of the value of the owning container
+  bool operator==(const MutationCounter &) const { return true; }
+
+public:
+  void bump() { ++Value; }
+  uint64_t value() const { return Value; }
+};
@@ -0,0 +1,134 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/Support/MathExtras.h"
+
+#include "revng/Support/Assert.h"
+
+/// \brief Perfect hash function of a set of 64-bit keys
+///
+/// Built through "hash and displace": keys are partitioned in buckets by a
+/// first hash function, then, starting from the largest bucket, a displacement
+/// is searched for each bucket such that all of its keys, hashed with a second
+/// hash function and XORed with the displacement, land in free slots.
+///
+/// The number of slots is a power of two, and at most about 1.25 times the
+/// number of keys, rounded up. Computing the slot of a key requires two hashes
+/// and a lookup in the displacements table, which makes it suitable to be
+/// emitted as code.
+///
+/// \note a key not among the ones used to build the function is mapped onto
+///       a slot too: it's up to the user to check if it's the right one.
+class PerfectHash {
+public:
+  uint64_t BucketSeed = 0;
+  uint64_t SlotSeed = 0;
+  uint64_t SlotsCount = 0;
+  std::vector<uint32_t> Displacements;
+
+public:
+  static constexpr uint64_t FirstMultiplier = 0xFF51AFD7ED558CCDULL;
+  static constexpr uint64_t SecondMultiplier = 0xC4CEB9FE1A85EC53ULL;
+
+  /// \brief The 64-bit finalizer of MurmurHash3 applied to \p Key XOR \p Seed
+  static uint64_t hash(uint64_t Key, uint64_t Seed) {
+    uint64_t Result = Key ^ Seed;
+    Result ^= Result >> 33;
+    Result *= FirstMultiplier;
+    Result ^= Result >> 33;
+    Result *= SecondMultiplier;
+    Result ^= Result >> 33;
+    return Result;
+  }
+
+public:
+  /// \param Keys the keys to hash, they must be unique.
+  static PerfectHash build(llvm::ArrayRef<uint64_t> Keys) {
+    uint64_t KeysCount = std::max<uint64_t>(Keys.size(), 1);
+    uint64_t SlotsCount = llvm::PowerOf2Ceil(KeysCount + KeysCount / 4);
+    uint64_t BucketsCount = llvm::PowerOf2Ceil(KeysCount / 4 + 1);
+
+    // Try a sequence of seeds, giving more room every few failed attempts
+    constexpr unsigned AttemptsPerSize = 16;
+    for (uint64_t Attempt = 0;; ++Attempt) {
+      if (Attempt != 0 and Attempt % AttemptsPerSize == 0)
+        SlotsCount *= 2;
+
+      PerfectHash Result;
+      Result.BucketSeed = hash(Attempt, 1);
+      Result.SlotSeed = hash(Attempt, 2);
+      Result.SlotsCount = SlotsCount;
+      Result.Displacements.resize(BucketsCount, 0);
+      if (Result.place(Keys))
+        return Result;
+    }
+  }
+
+public:
+  uint64_t bucket(uint64_t Key) const {
+    return hash(Key, BucketSeed) & (Displacements.size() - 1);
+  }
+
+  uint64_t slot(uint64_t Key) const {
+    uint64_t Displacement = Displacements[bucket(Key)];
+    return (hash(Key, SlotSeed) ^ Displacement) & (SlotsCount - 1);
+  }
+
+private:
+  /// \return true if a displacement has been found for each bucket
+  bool place(llvm::ArrayRef<uint64_t> Keys) {
+    std::vector<std::vector<uint64_t>> Buckets(Displacements.size());
+    for (uint64_t Key : Keys)
+      Buckets[bucket(Key)].push_back(Key);
+
+    std::vector<uint32_t> Order(Buckets.size());
+    for (uint32_t I = 0; I < Order.size(); ++I)
+      Order[I] = I;
+    std::stable_sort(Order.begin(), Order.end(), [&](uint32_t A, uint32_t B) {
+      return Buckets[A].size() > Buckets[B].size();
+    });
+
+    llvm::BitVector Taken(SlotsCount);
+    std::vector<uint64_t> Slots;
+    for (uint32_t Index : Order) {
+      const std::vector<uint64_t> &Bucket = Buckets[Index];
+      if (Bucket.empty())
+        break;
+
+      bool Placed = false;
+      for (uint64_t Displacement = 0; Displacement < SlotsCount;
+           ++Displacement) {
+        Slots.clear();
+        for (uint64_t Key : Bucket) {
+          uint64_t Slot = (hash(Key, SlotSeed) ^ Displacement)
+                          & (SlotsCount - 1);
+          if (Taken[Slot] or llvm::is_contained(Slots, Slot))
+            break;
+          Slots.push_back(Slot);
+        }
+
+        if (Slots.size() == Bucket.size()) {
+          for (uint64_t Slot : Slots)
+            Taken.set(Slot);
+          Displacements[Index] = Displacement;
+          Placed = true;
+          break;
+        }
+      }
+
+      if (not Placed)
+        return false;
+    }
+
+    return true;
+  }
+};
@@ -4,10 +4,15 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
 #include <experimental/coroutine>
+#include <new>
 #include <optional>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 #include "revng/Support/Assert.h"
 
@@ -16,6 +21,94 @@ struct RecursiveCoroutine;
 
 namespace revng::detail {
 
+/// \brief Thread-local pool of memory for the RecursiveCoroutine frames
+///
+/// Deep recursions allocate and free millions of small frames, mostly in LIFO
+/// order. Frames are carved out of large chunks and, once freed, are kept in a
+/// free list for their size class, ready to be reused by the next frame of the
+/// same size. Frames larger than the largest size class are directly allocated
+/// from the heap.
+///
+/// Memory is returned to the system only when the thread terminates.
+///
+/// \note a frame must be freed by the thread that allocated it, which is always
+///       the case for RecursiveCoroutine, since it's never resumed on another
+///       thread.
+class CoroutineFramePool {
+private:
+  static constexpr size_t Granularity = alignof(std::max_align_t);
+  static constexpr size_t SizeClassesCount = 128;
+  static constexpr size_t ChunkSize = 64 * 1024;
+
+  struct FreeFrame {
+    FreeFrame *Next;
+  };
+
+private:
+  std::array<FreeFrame *, SizeClassesCount> FreeLists = {};
+  std::vector<void *> Chunks;
+  char *ChunkCursor = nullptr;
+  char *ChunkEnd = nullptr;
+
+public:
+  CoroutineFramePool() = default;
+  CoroutineFramePool(const CoroutineFramePool &) = delete;
+  CoroutineFramePool &operator=(const CoroutineFramePool &) = delete;
+
+  ~CoroutineFramePool() {
+    for (void *Chunk : Chunks)
+      ::operator delete(Chunk);
+  }
+
+public:
+  static CoroutineFramePool &get() {
+    thread_local CoroutineFramePool Pool;
+    return Pool;
+  }
+
+public:
+  void *allocate(size_t Size) {
+    size_t SizeClass = sizeClass(Size);
+    if (SizeClass >= SizeClassesCount)
+      return ::operator new(Size);
+
+    // Reuse a free frame, if any
+    if (FreeFrame *Result = FreeLists[SizeClass]) {
+      FreeLists[SizeClass] = Result->Next;
+      return Result;
+    }
+
+    size_t Bytes = (SizeClass + 1) * Granularity;
+    if (static_cast<size_t>(ChunkEnd - ChunkCursor) < Bytes) {
+      // The rest of the current chunk is wasted
+      ChunkCursor = static_cast<char *>(::operator new(ChunkSize));
+      ChunkEnd = ChunkCursor + ChunkSize;
+      Chunks.push_back(ChunkCursor);
+    }
+
+    void *Result = ChunkCursor;
+    ChunkCursor += Bytes;
+    return Result;
+  }
+
+  void deallocate(void *Pointer, size_t Size) {
+    size_t SizeClass = sizeClass(Size);
+    if (SizeClass >= SizeClassesCount) {
+      ::operator delete(Pointer);
+      return;
+    }
+
+    auto *Frame = static_cast<FreeFrame *>(Pointer);
+    Frame->Next = FreeLists[SizeClass];
+    FreeLists[SizeClass] = Frame;
+  }
+
+private:
+  static size_t sizeClass(size_t Size) {
+    return (std::max<size_t>(Size, 1) - 1) / Granularity;
+  }
+};
+
 template<typename RetT>
 struct ReturnBase {
 
@@ -63,6 +156,14 @@ struct RecursivePromise : public ReturnBase<ReturnT> {
 
   [[noreturn]] void unhandled_exception() const { std::terminate(); }
 
+  static void *operator new(size_t Size) noexcept {
+    return CoroutineFramePool::get().allocate(Size);
+  }
+
+  static void operator delete(void *Pointer, size_t Size) {
+    CoroutineFramePool::get().deallocate(Pointer, Size);
+  }
+
   auto initial_suspend() const { return std::experimental::suspend_always(); }
 
   auto final_suspend() noexcept {
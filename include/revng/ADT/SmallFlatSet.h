@@ -0,0 +1,103 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <algorithm>
+#include <initializer_list>
+#include <utility>
+
+#include "llvm/ADT/SmallVector.h"
+
+/// \brief A set of elements kept sorted in a llvm::SmallVector
+///
+/// Up to N elements are stored inline, without any heap allocation. Insertion
+/// is linear in the size of the set, which makes this container suitable only
+/// for small sets. Iteration proceeds in ascending order, as for std::set.
+template<typename T, unsigned N = 4>
+class SmallFlatSet {
+private:
+  using Storage = llvm::SmallVector<T, N>;
+
+public:
+  using value_type = T;
+  using size_type = typename Storage::size_type;
+  using iterator = typename Storage::const_iterator;
+  using const_iterator = typename Storage::const_iterator;
+
+private:
+  Storage Elements;
+
+public:
+  SmallFlatSet() = default;
+
+  SmallFlatSet(std::initializer_list<T> List) {
+    insert(List.begin(), List.end());
+  }
+
+  template<typename InputIterator>
+  SmallFlatSet(InputIterator Begin, InputIterator End) {
+    insert(Begin, End);
+  }
+
+public:
+  const_iterator begin() const { return Elements.begin(); }
+  const_iterator end() const { return Elements.end(); }
+  const_iterator cbegin() const { return Elements.begin(); }
+  const_iterator cend() const { return Elements.end(); }
+
+  size_type size() const { return Elements.size(); }
+  bool empty() const { return Elements.empty(); }
+
+  void clear() { Elements.clear(); }
+
+public:
+  std::pair<iterator, bool> insert(const T &Value) {
+    // Fast path: elements are often inserted in ascending order
+    if (Elements.empty() or Elements.back() < Value) {
+      Elements.push_back(Value);
+      return { std::prev(Elements.end()), true };
+    }
+
+    auto It = std::lower_bound(Elements.begin(), Elements.end(), Value);
+    if (not(Value < *It))
+      return { It, false };
+
+    return { Elements.insert(It, Value), true };
+  }
+
+  template<typename InputIterator>
+  void insert(InputIterator Begin, InputIterator End) {
+    for (; Begin != End; ++Begin)
+      insert(*Begin);
+  }
+
+  const_iterator find(const T &Value) const {
+    auto It = std::lower_bound(Elements.begin(), Elements.end(), Value);
+    if (It == Elements.end() or Value < *It)
+      return Elements.end();
+    return It;
+  }
+
+  size_type count(const T &Value) const {
+    return find(Value) != Elements.end() ? 1 : 0;
+  }
+
+  bool erase(const T &Value) {
+    auto It = find(Value);
+    if (It == Elements.end())
+      return false;
+
+    Elements.erase(It);
+    return true;
+  }
+
+public:
+  bool operator==(const SmallFlatSet &Other) const {
+    return Elements == Other.Elements;
+  }
+  bool operator!=(const SmallFlatSet &Other) const {
+    return not(*this == Other);
+  }
+};
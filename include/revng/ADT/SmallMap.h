@@ -4,165 +4,32 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <algorithm>
 #include <array>
-#include <map>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
-#include "boost/variant.hpp"
-
-#include "revng/ADT/ZipMapIterator.h"
 #include "revng/Support/Assert.h"
 
-/// \brief Type-safe wrapper for different iterators sharing value_type
-template<typename... Ts>
-class Iteratall {
-private:
-  // Define some helpers
-  template<typename... Ps>
-  struct are_same : std::false_type {};
-
-  template<typename P, typename... Ps>
-  struct are_same<P, P, Ps...> : are_same<P, Ps...> {};
-
-  template<typename P>
-  struct are_same<P, P> : std::true_type {};
-
-  template<typename P, typename... Ps>
-  struct First {
-    using type = P;
-  };
-
-  template<typename T>
-  using it = std::iterator_traits<T>;
-  using itfirst = it<typename First<Ts...>::type>;
-
-  // Assert correct usage
-  static_assert(are_same<typename it<Ts>::value_type...>::value,
-                "The iterators have different value_type");
-  static_assert(are_same<typename it<Ts>::reference...>::value,
-                "The iterators have different reference");
-
-public:
-  using value_type = typename itfirst::value_type;
-  using reference = typename itfirst::reference;
-  using pointer = typename itfirst::pointer;
-  using difference_type = typename itfirst::difference_type;
-  using iterator_category = typename itfirst::iterator_category;
-
-  template<typename T>
-  Iteratall(T I) : Iterator(I) {}
-
-private:
-  struct PostincrementVisitor : public boost::static_visitor<Iteratall> {
-    template<typename T>
-    Iteratall operator()(T &It) const {
-      return Iteratall(It++);
-    }
-  };
-
-  struct PreincrementVisitor : public boost::static_visitor<Iteratall> {
-    template<typename T>
-    Iteratall operator()(T &It) const {
-      return Iteratall(++It);
-    }
-  };
-
-  struct PostdecrementVisitor : public boost::static_visitor<Iteratall> {
-    template<typename T>
-    Iteratall operator()(T &It) const {
-      return Iteratall(It--);
-    }
-  };
-
-  struct PredecrementVisitor : public boost::static_visitor<Iteratall> {
-    template<typename T>
-    Iteratall operator()(T &It) const {
-      return Iteratall(--It);
-    }
-  };
-
-  struct DereferenceVisitor : public boost::static_visitor<reference> {
-    template<typename T>
-    reference operator()(T &It) const {
-      return *It;
-    }
-  };
-
-  struct CompareVisitor : public boost::static_visitor<bool> {
-    template<typename T, typename R>
-    bool operator()(T &, R &) const {
-      // The compared type should always be the same
-      revng_abort();
-    }
-
-    template<typename T>
-    bool operator()(T &It, T &Other) const {
-      return It == Other;
-    }
-  };
-
-public:
-  Iteratall() = default;
-  Iteratall(const Iteratall &) = default;
-  Iteratall(Iteratall &&) = default;
-  Iteratall &operator=(const Iteratall &) = default;
-  Iteratall &operator=(Iteratall &&) = default;
-
-  Iteratall operator++(int) {
-    Iteratall Res(*this);
-    boost::apply_visitor(PostincrementVisitor(), Iterator);
-    return Res;
-  }
-
-  Iteratall &operator++() {
-    return *this = boost::apply_visitor(PreincrementVisitor(), Iterator);
-  }
-
-  Iteratall &operator+=(int N) {
-    for (int I = 0; I < N; ++I)
-      *this = boost::apply_visitor(PreincrementVisitor(), Iterator);
-    return *this;
-  }
-
-  Iteratall operator--(int) {
-    Iteratall Res(*this);
-    boost::apply_visitor(PostdecrementVisitor(), Iterator);
-    return Res;
-  }
-
-  Iteratall &operator--() {
-    return *this = boost::apply_visitor(PredecrementVisitor(), Iterator);
-  }
-
-  Iteratall &operator-=(int N) {
-    for (int I = 0; I < N; ++I)
-      *this = boost::apply_visitor(PredecrementVisitor(), Iterator);
-    return *this;
-  }
-
-  bool operator==(const Iteratall &Other) const {
-    return boost::apply_visitor(CompareVisitor(), Iterator, Other.Iterator);
-  }
-
-  bool operator!=(const Iteratall &Other) const { return !(*this == Other); }
-
-  reference operator*() const {
-    return boost::apply_visitor(DereferenceVisitor(), Iterator);
-  }
-
-  pointer operator->() const { return &**this; }
-
-private:
-  boost::variant<Ts...> Iterator;
-};
-
 /// \brief map that usually contains less than N elements
 ///
 /// SmallMap keeps a std::array of pairs inline which are search linearly if
-/// size() < N.
+/// size() < N. Past N elements, they are moved in a vector kept sorted
+/// according to C, which is searched through binary search. Unlike a node
+/// based map, growing does not allocate for each insertion, in particular if
+/// enough space has been reserved in advance.
+///
+/// If C is transparent (e.g., std::less<>), lookups accept any type that can be
+/// compared with K.
 ///
 /// \note Since this data structure internally uses an std::array, expect the
 ///       default constructor to be used.
 ///
+/// \note As for any flat container, inserting or erasing elements invalidates
+///       iterators and references to the elements.
+///
 /// \tparam N number of elements to keep inline.
 template<typename K, typename V, unsigned N, typename C = std::less<K>>
 class SmallMap {
@@ -170,30 +37,39 @@ private:
   // Define some helper types
   using NonConstPair = std::pair<K, V>;
   using NonConstContainer = std::array<NonConstPair, N>;
+  using NonConstVector = std::vector<NonConstPair>;
 
   using Pair = std::pair<const K, V>;
-  using Container = std::array<Pair, N>;
 
-  using VIterator = typename Container::iterator;
-  using ConstVIterator = typename Container::const_iterator;
+  template<typename T>
+  static constexpr bool IsKeyLike = std::is_convertible_v<const T &, const K &>
+                                    or requires {
+                                         typename C::is_transparent;
+                                       };
 
 private:
   // These have to be mutable so we can sort() can be a const method.
-  // Note that Vector is an array of pairs where the key is *not* const. We use
-  // the pair with the const key only to provide iterators compatible with
+  // Note that Vector and Large contain pairs where the key is *not* const. We
+  // use the pair with the const key only to provide iterators compatible with
   // std::map.
   mutable NonConstContainer Vector; ///< Container for inline elements
   mutable bool IsSorted; ///< Is vector sorted?
   unsigned Size; ///< Size of Vector
 
-  // Non-inline version of the container
-  std::map<K, V, C> Map;
+  /// Non-inline version of the container, always sorted
+  NonConstVector Large;
 
 private:
-  VIterator smallBegin() { return reinterpret_cast<VIterator>(Vector.begin()); }
+  Pair *smallBegin() { return reinterpret_cast<Pair *>(Vector.data()); }
 
-  ConstVIterator smallBegin() const {
-    return reinterpret_cast<ConstVIterator>(Vector.begin());
+  const Pair *smallBegin() const {
+    return reinterpret_cast<const Pair *>(Vector.data());
+  }
+
+  Pair *largeBegin() { return reinterpret_cast<Pair *>(Large.data()); }
+
+  const Pair *largeBegin() const {
+    return reinterpret_cast<const Pair *>(Large.data());
   }
 
 public:
@@ -205,9 +81,8 @@ public:
   SmallMap &operator=(SmallMap &&Other) = default;
 
 public:
-  using iterator = Iteratall<VIterator, typename std::map<K, V, C>::iterator>;
-  using const_iterator = Iteratall<ConstVIterator,
-                                   typename std::map<K, V, C>::const_iterator>;
+  using iterator = Pair *;
+  using const_iterator = const Pair *;
   using size_type = size_t;
   using value_type = Pair;
   using pointer = Pair *;
@@ -223,63 +98,54 @@ public:
     if (IsSorted || !isSmall() || Size <= 1)
       return;
 
-    auto Compare = [](const Pair &A, const Pair &B) {
+    auto Compare = [](const NonConstPair &A, const NonConstPair &B) {
       return C()(A.first, B.first);
     };
     std::sort(Vector.begin(), Vector.begin() + Size, Compare);
     IsSorted = true;
   }
 
-  bool empty() const { return Size == 0 && Map.empty(); }
+  bool empty() const { return Size == 0 && Large.empty(); }
 
-  size_type size() const { return isSmall() ? Size : Map.size(); }
+  size_type size() const { return isSmall() ? Size : Large.size(); }
+
+  /// \brief Make room for \p Count elements
+  ///
+  /// If more than N elements are expected, this avoids any reallocation while
+  /// growing up to \p Count elements.
+  void reserve(size_type Count) {
+    if (Count > N)
+      Large.reserve(Count);
+  }
 
   const_iterator begin() const {
-    if (isSmall())
-      return const_iterator(smallBegin());
-    else
-      return const_iterator(Map.begin());
+    return isSmall() ? smallBegin() : largeBegin();
   }
 
   const_iterator end() const {
-    if (isSmall())
-      return const_iterator(smallBegin() + Size);
-    else
-      return const_iterator(Map.end());
+    return isSmall() ? smallBegin() + Size : largeBegin() + Large.size();
   }
 
-  iterator begin() {
-    if (isSmall())
-      return iterator(smallBegin());
-    else
-      return iterator(Map.begin());
-  }
+  iterator begin() { return isSmall() ? smallBegin() : largeBegin(); }
 
   iterator end() {
-    if (isSmall())
-      return iterator(smallBegin() + Size);
-    else
-      return iterator(Map.end());
+    return isSmall() ? smallBegin() + Size : largeBegin() + Large.size();
   }
 
-  size_type count(const K &Key) const {
-    if (isSmall()) {
-      return vfind(Key) == smallBegin() + Size ? 0 : 1;
-    } else {
-      return Map.count(Key);
-    }
+  template<typename T>
+  requires IsKeyLike<T>
+  size_type count(const T &Key) const {
+    return find(Key) == end() ? 0 : 1;
   }
 
   std::pair<iterator, bool> insert(const Pair &P) {
-    if (!isSmall()) {
-      auto Result = Map.insert(P);
-      return { iterator(Result.first), Result.second };
-    }
+    if (!isSmall())
+      return largeInsert(P);
 
-    VIterator I = vfind(P.first);
+    iterator I = vfind(P.first);
     // Do we have it?
     if (I != smallBegin() + Size)
-      return { iterator(I), false };
+      return { I, false };
 
     if (Size < N) {
       Vector[Size] = P;
@@ -289,25 +155,60 @@ public:
       if (Size > 1 && IsSorted)
         IsSorted = !C()(P.first, Vector[Size - 2].first);
 
-      return { iterator(smallBegin() + Size - 1), true };
+      return { smallBegin() + Size - 1, true };
     }
 
-    // Otherwise, grow from vector to set.
-    revng_assert(Map.empty());
-    for (unsigned I = 0; I < Size; I++)
-      Map.insert(Vector[I]);
+    // Otherwise, grow from the inline array to the sorted vector
+    grow();
+    return largeInsert(P);
+  }
 
-    auto Result = Map.insert(P);
-    return { iterator(Result.first), Result.second };
+  /// \brief Insert all the elements in [\p Begin, \p End)
+  ///
+  /// As for insert, elements whose key is already present are ignored, and so
+  /// are all but the first of those with the same key in the range. Once the
+  /// inline storage is exceeded, all the new elements are merged at once.
+  template<typename Iterator>
+  void insert(Iterator Begin, Iterator End) {
+    for (; isSmall() and Begin != End; ++Begin)
+      insert(*Begin);
+
+    if (Begin == End)
+      return;
+
+    size_t OldSize = Large.size();
+    Large.insert(Large.end(), Begin, End);
+
+    auto Compare = [](const NonConstPair &A, const NonConstPair &B) {
+      return C()(A.first, B.first);
+    };
+    auto Middle = Large.begin() + OldSize;
+    std::stable_sort(Middle, Large.end(), Compare);
+    std::inplace_merge(Large.begin(), Middle, Large.end(), Compare);
+
+    // Merging is stable, the first element of each run is the one to keep
+    auto Equivalent = [](const NonConstPair &A, const NonConstPair &B) {
+      return not C()(A.first, B.first);
+    };
+    Large.erase(std::unique(Large.begin(), Large.end(), Equivalent),
+                Large.end());
   }
 
-  void erase(const K &Key) {
+  /// \brief Insert all the elements of \p Other whose key is not present
+  void merge(const SmallMap &Other) {
+    revng_assert(&Other != this);
+    insert(Other.begin(), Other.end());
+  }
+
+  template<typename T>
+  requires IsKeyLike<T>
+  void erase(const T &Key) {
     if (isSmall()) {
       auto I = Vector.begin();
       auto E = Vector.begin() + Size;
 
       for (; I != E; ++I)
-        if (I->first == Key)
+        if (isEqual(I->first, Key))
           break;
 
       if (I == E)
@@ -318,46 +219,57 @@ public:
         *I = *(I + 1);
 
     } else {
-      auto It = Map.find(Key);
-      if (It != Map.end())
-        Map.erase(It);
+      auto It = Large.begin() + (find(Key) - largeBegin());
+      if (It != Large.end())
+        Large.erase(It);
     }
   }
 
-  iterator find(const K &Key) {
+  template<typename T>
+  requires IsKeyLike<T>
+  iterator find(const T &Key) {
     if (isSmall())
-      return iterator(vfind(Key));
-    else
-      return iterator(Map.find(Key));
+      return vfind(Key);
+
+    iterator It = lower_bound(Key);
+    if (It != end() and not C()(Key, It->first))
+      return It;
+    return end();
   }
 
-  const_iterator find(const K &Key) const {
-    if (isSmall())
-      return const_iterator(vfind(Key));
-    else
-      return const_iterator(Map.find(Key));
+  template<typename T>
+  requires IsKeyLike<T>
+  const_iterator find(const T &Key) const {
+    return const_cast<SmallMap *>(this)->find(Key);
   }
 
-  iterator lower_bound(const K &Key) {
+  template<typename T>
+  requires IsKeyLike<T>
+  iterator lower_bound(const T &Key) {
     if (isSmall())
-      return iterator(vlower_bound(Key));
-    else
-      return iterator(Map.lower_bound(Key));
+      return vlower_bound(Key);
+
+    auto Compare = [](const Pair &A, const T &B) { return C()(A.first, B); };
+    return std::lower_bound(begin(), end(), Key, Compare);
   }
 
-  const_iterator lower_bound(const K &Key) const {
-    if (isSmall())
-      return const_iterator(vlower_bound(Key));
-    else
-      return const_iterator(Map.lower_bound(Key));
+  template<typename T>
+  requires IsKeyLike<T>
+  const_iterator lower_bound(const T &Key) const {
+    return const_cast<SmallMap *>(this)->lower_bound(Key);
   }
 
-  bool contains(const K &Key) const { return find(Key) != end(); }
+  template<typename T>
+  requires IsKeyLike<T>
+  bool contains(const T &Key) const {
+    return find(Key) != end();
+  }
 
   void clear() {
     // TODO: we should invoke some destructors at a certain point
     Size = 0;
-    Map.clear();
+    IsSorted = true;
+    Large.clear();
   }
 
   V &operator[](K &&Key) {
@@ -368,46 +280,65 @@ public:
     return insert(std::make_pair(Key, V())).first->second;
   }
 
-  V &at(const K &Key) {
+  template<typename T>
+  requires IsKeyLike<T>
+  V &at(const T &Key) {
     iterator It = find(Key);
     revng_assert(It != end());
     return It->second;
   }
 
-  const V &at(const K &Key) const {
+  template<typename T>
+  requires IsKeyLike<T>
+  const V &at(const T &Key) const {
     const_iterator It = find(Key);
     revng_assert(It != end());
     return It->second;
   }
 
 private:
-  bool isSmall() const { return Map.empty(); }
+  bool isSmall() const { return Large.empty(); }
 
-  ConstVIterator vfind(const K &Key) const {
-    for (ConstVIterator I = smallBegin(), E = smallBegin() + Size; I != E; ++I)
-      if (I->first == Key)
-        return I;
-    return smallBegin() + Size;
+  /// \brief Move the inline elements to the sorted vector
+  void grow() {
+    revng_assert(Large.empty());
+    sort();
+    Large.reserve(std::max<size_t>(Large.capacity(), 2 * N));
+    for (unsigned I = 0; I < Size; I++)
+      Large.push_back(std::move(Vector[I]));
+    Size = 0;
+    IsSorted = true;
   }
 
-  VIterator vfind(const K &Key) {
-    for (VIterator I = smallBegin(), E = smallBegin() + Size; I != E; ++I)
-      if (I->first == Key)
-        return I;
-    return smallBegin() + Size;
+  std::pair<iterator, bool> largeInsert(const Pair &P) {
+    iterator It = lower_bound(P.first);
+    if (It != end() and not C()(P.first, It->first))
+      return { It, false };
+
+    auto Inserted = Large.insert(Large.begin() + (It - largeBegin()), P);
+    return { largeBegin() + (Inserted - Large.begin()), true };
   }
 
-  ConstVIterator vlower_bound(const K &Key) const {
-    sort();
-    for (ConstVIterator I = smallBegin(), E = smallBegin() + Size; I != E; ++I)
-      if (!C()(I->first, Key))
+  template<typename T>
+  static bool isEqual(const K &Key, const T &Other) {
+    if constexpr (std::is_convertible_v<const T &, const K &>)
+      return Key == Other;
+    else
+      return not C()(Key, Other) and not C()(Other, Key);
+  }
+
+  template<typename T>
+  iterator vfind(const T &Key) {
+    for (iterator I = smallBegin(), E = smallBegin() + Size; I != E; ++I)
+      if (isEqual(I->first, Key))
         return I;
     return smallBegin() + Size;
   }
 
-  VIterator vlower_bound(const K &Key) {
+  template<typename T>
+  iterator vlower_bound(const T &Key) {
     sort();
-    for (VIterator I = smallBegin(), E = smallBegin() + Size; I != E; ++I)
+    for (iterator I = smallBegin(), E = smallBegin() + Size; I != E; ++I)
       if (!C()(I->first, Key))
         return I;
     return smallBegin() + Size;
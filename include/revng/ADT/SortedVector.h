@@ -4,10 +4,16 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <numeric>
+#include <optional>
+
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/Parallel.h"
 
 #include "revng/ADT/KeyedObjectContainer.h"
 #include "revng/ADT/KeyedObjectTraits.h"
+#include "revng/ADT/LazyKeyIndex.h"
+#include "revng/ADT/MutationCounter.h"
 #include "revng/Support/Assert.h"
 #include "revng/Support/Debug.h"
 
@@ -54,9 +60,18 @@ public:
   using reverse_iterator = typename vector_type::reverse_iterator;
   using const_reverse_iterator = typename vector_type::const_reverse_iterator;
 
+private:
+  /// Lookups can go through a hash index only if hashing the keys is
+  /// consistent with the equivalence induced by Compare
+  static constexpr bool IsIndexable = std::is_same_v<Compare, KOTCompare<T>>
+                                      and revng::detail::HasHashValue<
+                                        std::remove_cvref_t<key_type>>;
+
 private:
   vector_type TheVector;
   bool BatchInsertInProgress = false;
+  LazyKeyIndex Index;
+  MutationCounter Mutations;
 
 public:
   SortedVector() {}
@@ -72,6 +87,8 @@ public:
   void swap(SortedVector &Other) {
     revng_assert(not BatchInsertInProgress);
     TheVector.swap(Other.TheVector);
+    mutated();
+    Other.mutated();
   }
 
   bool operator==(const SortedVector &) const = default;
@@ -179,11 +196,13 @@ public:
   void clear() {
     revng_assert(not BatchInsertInProgress);
     TheVector.clear();
+    mutated();
   }
 
   void reserve(size_type NewSize) {
     revng_assert(not BatchInsertInProgress);
     TheVector.reserve(NewSize);
+    Mutations.bump();
   }
 
   size_type capacity() const {
@@ -197,10 +216,12 @@ public:
     auto It = lower_bound(Key);
     if (It == end()) {
       TheVector.push_back(Value);
+      mutated();
       return { --end(), true };
     } else if (keysEqual(KeyedObjectTraits<T>::key(*It), Key)) {
       return { It, false };
     } else {
+      mutated();
       return { TheVector.insert(It, Value), true };
     }
   }
@@ -211,22 +232,26 @@ public:
     auto It = lower_bound(Key);
     if (It == end()) {
       TheVector.push_back(Value);
+      mutated();
       return { --end(), true };
     } else if (keysEqual(KeyedObjectTraits<T>::key(*It), Key)) {
       *It = Value;
       return { It, false };
     } else {
+      mutated();
       return { TheVector.insert(It, Value), true };
     }
   }
 
   iterator erase(iterator Pos) {
     revng_assert(not BatchInsertInProgress);
+    mutated();
     return TheVector.erase(Pos);
   }
 
   iterator erase(const_iterator First, const_iterator Last) {
     revng_assert(not BatchInsertInProgress);
+    mutated();
     return TheVector.erase(First, Last);
   }
 
@@ -248,6 +273,9 @@ public:
 
   iterator find(const key_type &Key) {
     revng_assert(not BatchInsertInProgress);
+    if (auto Position = indexedFind(Key))
+      return TheVector.begin() + *Position;
+
     auto It = lower_bound(Key);
     auto End = end();
     if (!(It == End) and Compare()(Key, KeyedObjectTraits<T>::key(*It))) {
@@ -259,6 +287,9 @@ public:
 
   const_iterator find(const key_type &Key) const {
     revng_assert(not BatchInsertInProgress);
+    if (auto Position = indexedFind(Key))
+      return TheVector.begin() + *Position;
+
     auto It = lower_bound(Key);
     auto End = end();
     if (!(It == End) and Compare()(Key, KeyedObjectTraits<T>::key(*It))) {
@@ -315,11 +346,15 @@ public:
 
     ~BatchInserterBase() { commit(); }
 
-    void commit() {
+    /// \return the number of elements dropped since another element with the
+    ///         same key has been inserted
+    size_t commit() {
       if (SV != nullptr && SV->BatchInsertInProgress) {
         SV->BatchInsertInProgress = false;
-        SV->sort<KeepFirst>();
+        return SV->sort<KeepFirst>();
       }
+
+      return 0;
     }
 
   protected:
@@ -356,6 +391,32 @@ public:
     return BatchInsertOrAssigner(*this);
   }
 
+  /// \brief Replace the content with \p Elements, which can be in any order
+  ///
+  /// \p Elements are sorted only once, in parallel if they are many. Among the
+  /// elements sharing the same key, the first one is kept and
+  /// `OnDuplicate(Kept, Duplicate)` is invoked on each of the others, in
+  /// order, so that the policy can merge them, replace the kept one or just
+  /// record the collision.
+  ///
+  /// \return the number of elements with the same key of a previous one
+  template<typename F>
+  size_t assign_unsorted(std::vector<T> &&Elements, F &&OnDuplicate) {
+    revng_assert(not BatchInsertInProgress);
+    TheVector = std::move(Elements);
+    return sortAndFold(OnDuplicate);
+  }
+
+  /// \brief Replace the content with \p Elements, keeping the first of the
+  ///        elements sharing the same key
+  size_t assign_unsorted(std::vector<T> &&Elements) {
+    return assign_unsorted(std::move(Elements), [](T &, T &) {});
+  }
+
+  /// \return a value that changes whenever elements are added, removed or
+  ///         moved around in memory
+  uint64_t mutations() const { return Mutations.value(); }
+
   /// \note This function should always return true
   bool isSorted() const debug_function {
     auto It = begin();
@@ -375,6 +436,27 @@ public:
   }
 
 private:
+  void mutated() {
+    Index.invalidate();
+    Mutations.bump();
+  }
+
+  /// \brief Look up \p Key through the hash index, if available
+  ///
+  /// \return the position of the element with key \p Key, or the size of the
+  ///         container if there's none, or std::nullopt if the index is not
+  ///         available.
+  std::optional<size_t> indexedFind(const key_type &Key) const {
+    if constexpr (IsIndexable) {
+      auto KeyAt = [this](size_t Position) -> key_type {
+        return KOT::key(TheVector[Position]);
+      };
+      return Index.find(Key, TheVector.size(), KeyAt, keysEqual);
+    } else {
+      return std::nullopt;
+    }
+  }
+
   static bool compareElements(const T &LHS, const T &RHS) {
     return compareKeys(KeyedObjectTraits<T>::key(LHS),
                        KeyedObjectTraits<T>::key(RHS));
@@ -394,17 +476,68 @@ private:
   }
 
   template<bool KeepFirst>
-  void sort() {
-    // Sort
-    std::stable_sort(begin(), end(), compareElements);
-
-    // Remove duplicates keeping the last instance of each element
-    auto NewEnd = end();
-    if (KeepFirst) {
-      NewEnd = std::unique(begin(), end(), elementsEqual);
+  size_t sort() {
+    if constexpr (KeepFirst) {
+      return sortAndFold([](T &, T &) {});
+    } else {
+      // Keep the last instance of each element
+      return sortAndFold([](T &Kept, T &Duplicate) {
+        Kept = std::move(Duplicate);
+      });
+    }
+  }
+
+  /// Below this size, sorting in parallel does not pay off
+  static constexpr size_t ParallelSortThreshold = 16384;
+
+  /// \brief Stable sort of TheVector, then fold elements with the same key
+  template<typename F>
+  size_t sortAndFold(F &&OnDuplicate) {
+    mutated();
+    size_t Size = TheVector.size();
+    if (Size < ParallelSortThreshold) {
+      std::stable_sort(TheVector.begin(), TheVector.end(), compareElements);
     } else {
-      NewEnd = unique_last(begin(), end(), elementsEqual);
+      // Sort the indices, breaking ties on the position to preserve the
+      // insertion order, then move the elements in place
+      std::vector<size_t> Order(Size);
+      std::iota(Order.begin(), Order.end(), 0);
+      llvm::parallelSort(Order.begin(),
+                         Order.end(),
+                         [this](size_t Left, size_t Right) {
+                           const T &LeftElement = TheVector[Left];
+                           const T &RightElement = TheVector[Right];
+                           if (compareElements(LeftElement, RightElement))
+                             return true;
+                           if (compareElements(RightElement, LeftElement))
+                             return false;
+                           return Left < Right;
+                         });
+
+      vector_type Sorted;
+      Sorted.reserve(Size);
+      for (size_t Position : Order)
+        Sorted.push_back(std::move(TheVector[Position]));
+      TheVector.swap(Sorted);
     }
-    TheVector.erase(NewEnd, end());
+
+    if (Size == 0)
+      return 0;
+
+    size_t Last = 0;
+    size_t Duplicates = 0;
+    for (size_t I = 1; I < Size; ++I) {
+      if (elementsEqual(TheVector[Last], TheVector[I])) {
+        OnDuplicate(TheVector[Last], TheVector[I]);
+        ++Duplicates;
+      } else {
+        ++Last;
+        if (Last != I)
+          TheVector[Last] = std::move(TheVector[I]);
+      }
+    }
+
+    TheVector.erase(TheVector.begin() + Last + 1, TheVector.end());
+    return Duplicates;
   }
 };
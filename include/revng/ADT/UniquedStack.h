@@ -5,9 +5,12 @@
 //
 
 #include <algorithm>
+#include <cstddef>
 #include <set>
 #include <vector>
 
+#include "llvm/ADT/BitVector.h"
+
 #include "revng/Support/Assert.h"
 
 /// \brief Stack where an element cannot be re-inserted in it's already in the
@@ -41,3 +44,59 @@ private:
   std::set<T> Set;
   std::vector<T> Queue;
 };
+
+/// \brief Maps elements which are dense indices to themselves
+struct IdentityIndex {
+  template<typename T>
+  size_t operator()(const T &Element) const {
+    return Element;
+  }
+};
+
+/// \brief UniquedStack for elements numbered densely
+///
+/// Membership is tracked through a bit vector indexed by the number GetIndex
+/// associates to each element (e.g., the ID of a node in a graph), rather than
+/// through a std::set: insertions do not allocate, except when the bit vector
+/// or the stack grow.
+template<typename T, typename GetIndex = IdentityIndex>
+class DenseUniquedStack {
+private:
+  llvm::BitVector Members;
+  std::vector<T> Stack;
+  GetIndex Index;
+
+public:
+  /// \param Size the number of distinct elements expected, more can be
+  ///        inserted
+  explicit DenseUniquedStack(size_t Size = 0, GetIndex Index = GetIndex()) :
+    Members(Size), Index(Index) {
+    Stack.reserve(Size);
+  }
+
+public:
+  void insert(T Element) {
+    size_t I = Index(Element);
+    if (I >= Members.size())
+      Members.resize(std::max<size_t>(I + 1, 2 * Members.size()));
+
+    if (not Members.test(I)) {
+      Members.set(I);
+      Stack.push_back(Element);
+    }
+  }
+
+  bool empty() const { return Stack.empty(); }
+
+  T pop() {
+    T Result = Stack.back();
+    Stack.pop_back();
+    Members.reset(Index(Result));
+    return Result;
+  }
+
+  /// \brief Reverses the stack in its current status
+  void reverse() { std::reverse(Stack.begin(), Stack.end()); }
+
+  size_t size() const { return Stack.size(); }
+};
@@ -4,9 +4,15 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
+#include <mutex>
 #include <type_traits>
+#include <utility>
 
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/Allocator.h"
 #include "llvm/Support/Casting.h"
 
 #include "revng/ADT/Concepts.h"
@@ -83,22 +89,157 @@ void upcast(P &Upcastable, const L &Callable) {
   upcast(Upcastable, Wrapper, false);
 }
 
+namespace revng {
+
+/// \brief Bulk storage for the objects owned by UpcastablePointers
+///
+/// Objects of the same concrete type are laid out contiguously, in a pool
+/// dedicated to them. Destroying an object runs its destructor but does not
+/// reclaim its memory: the whole arena is freed at once when its owner and all
+/// the objects allocated in it are gone. Therefore, objects can safely outlive
+/// the owner of the arena, e.g., when they are moved out of a TupleTree.
+///
+/// UpcastablePointer allocates new objects in the arena installed on the
+/// current thread through a Scope, if any, on the heap otherwise. The same
+/// arena can be installed on several threads at once.
+class UpcastablePointerArena {
+private:
+  static inline thread_local UpcastablePointerArena *Current = nullptr;
+
+  template<typename Q>
+  static inline const char PoolTag = 0;
+
+private:
+  /// One for the owner plus one for each live object
+  std::atomic<size_t> References = 1;
+  std::mutex PoolsLock;
+  llvm::SmallDenseMap<const void *, llvm::BumpPtrAllocator, 8> Pools;
+
+private:
+  UpcastablePointerArena() = default;
+  UpcastablePointerArena(const UpcastablePointerArena &) = delete;
+  UpcastablePointerArena &operator=(const UpcastablePointerArena &) = delete;
+
+public:
+  /// \brief Owning reference to an arena
+  class Handle {
+  private:
+    UpcastablePointerArena *Arena = nullptr;
+
+  public:
+    Handle() = default;
+    Handle(const Handle &) = delete;
+    Handle &operator=(const Handle &) = delete;
+    Handle(Handle &&Other) noexcept :
+      Arena(std::exchange(Other.Arena, nullptr)) {}
+    Handle &operator=(Handle &&Other) noexcept {
+      if (&Other != this) {
+        reset();
+        Arena = std::exchange(Other.Arena, nullptr);
+      }
+      return *this;
+    }
+    ~Handle() { reset(); }
+
+  public:
+    /// \return the arena, creating it if necessary
+    UpcastablePointerArena &get() {
+      if (Arena == nullptr)
+        Arena = new UpcastablePointerArena;
+      return *Arena;
+    }
+
+    void reset() {
+      if (Arena != nullptr)
+        std::exchange(Arena, nullptr)->release();
+    }
+  };
+
+  /// \brief Installs an arena on the current thread for its lifetime
+  class Scope {
+  private:
+    UpcastablePointerArena *Previous;
+
+  public:
+    Scope(UpcastablePointerArena &Arena) : Previous(Current) {
+      Current = &Arena;
+    }
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+    ~Scope() { Current = Previous; }
+  };
+
+public:
+  static UpcastablePointerArena *current() { return Current; }
+
+  template<typename Q, typename... Args>
+  Q *create(Args &&...TheArgs) {
+    void *Memory = nullptr;
+    {
+      std::lock_guard Lock(PoolsLock);
+      Memory = Pools[&PoolTag<Q>].Allocate(sizeof(Q), alignof(Q));
+    }
+    References.fetch_add(1, std::memory_order_relaxed);
+    return new (Memory) Q(std::forward<Args>(TheArgs)...);
+  }
+
+  /// \brief Destroys \p Object, which must have been created in this arena
+  template<typename Q>
+  void destroy(Q *Object) {
+    Object->~Q();
+    release();
+  }
+
+private:
+  void release() {
+    if (References.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      delete this;
+  }
+};
+
+} // namespace revng
+
 /// A unique_ptr copiable thanks to LLVM RTTI
+///
+/// If an UpcastablePointerArena is installed on the current thread, the
+/// objects created by make and by copies are allocated there.
 template<Upcastable T>
 class UpcastablePointer {
 private:
-  template<Upcastable P>
-  static P *clone(P *Pointer) {
-    auto Dispatcher = [](auto &Upcasted) -> P * {
-      using type = std::remove_reference_t<decltype(Upcasted)>;
-      return new type(Upcasted);
-    };
-    return ::upcast(Pointer, Dispatcher, static_cast<P *>(nullptr));
+  using Arena = revng::UpcastablePointerArena;
+
+  /// Destroys the pointee, releasing its memory to the heap or to the arena
+  /// it has been allocated in
+  struct Deleter {
+    Arena *Owner = nullptr;
+
+    void operator()(T *Pointer) const {
+      ::upcast(Pointer, [this](auto &Upcasted) {
+        if (Owner != nullptr)
+          Owner->destroy(&Upcasted);
+        else
+          delete &Upcasted;
+      });
+    }
+  };
+
+  using inner_pointer = std::unique_ptr<T, Deleter>;
+
+  template<typename Q, typename... Args>
+  static inner_pointer create(Args &&...TheArgs) {
+    if (Arena *Current = Arena::current())
+      return inner_pointer(Current->create<Q>(std::forward<Args>(TheArgs)...),
+                           Deleter{ Current });
+    return inner_pointer(new Q(std::forward<Args>(TheArgs)...), Deleter{});
   }
 
-  template<Upcastable P>
-  static void destroy(P *Pointer) {
-    ::upcast(Pointer, [](auto &Upcasted) { delete &Upcasted; });
+  static inner_pointer clone(T *Pointer) {
+    inner_pointer Result(nullptr, Deleter{});
+    ::upcast(Pointer, [&Result](auto &Upcasted) {
+      using type = std::remove_cvref_t<decltype(Upcasted)>;
+      Result = create<type>(Upcasted);
+    });
+    return Result;
   }
 
 public:
@@ -114,30 +255,33 @@ public:
 
 private:
   using concrete_types = concrete_types_traits_t<T>;
-  static constexpr void (*Deleter)(T *) = &destroy<T>;
-  using inner_pointer = std::unique_ptr<T, decltype(Deleter)>;
 
 public:
   using pointer = typename inner_pointer::pointer;
   using element_type = typename inner_pointer::element_type;
 
 public:
-  constexpr UpcastablePointer() noexcept : Pointer(nullptr, Deleter) {}
+  constexpr UpcastablePointer() noexcept : Pointer(nullptr, Deleter{}) {}
   constexpr UpcastablePointer(std::nullptr_t P) noexcept :
-    Pointer(P, Deleter) {}
-  explicit UpcastablePointer(pointer P) noexcept : Pointer(P, Deleter) {}
+    Pointer(P, Deleter{}) {}
+
+  /// \note \p P must have been allocated with new
+  explicit UpcastablePointer(pointer P) noexcept : Pointer(P, Deleter{}) {}
+
+private:
+  explicit UpcastablePointer(inner_pointer &&P) noexcept :
+    Pointer(std::move(P)) {}
 
 public:
   template<DerivesFrom<T> Q, typename... Args>
   static UpcastablePointer<T> make(Args &&...TheArgs) {
-    return UpcastablePointer<T>(new Q(std::forward<Args>(TheArgs)...));
+    return UpcastablePointer<T>(create<Q>(std::forward<Args>(TheArgs)...));
   }
 
 public:
   UpcastablePointer &operator=(const UpcastablePointer &Other) {
     if (&Other != this) {
-      Pointer.reset(clone(Other.Pointer.get()));
-      revng_assert(Pointer.get_deleter() == Deleter);
+      Pointer = clone(Other.Pointer.get());
     }
     return *this;
   }
@@ -149,8 +293,7 @@ public:
 
   UpcastablePointer &operator=(UpcastablePointer &&Other) {
     if (&Other != this) {
-      Pointer.reset(Other.Pointer.release());
-      revng_assert(Pointer.get_deleter() == Deleter);
+      Pointer = std::move(Other.Pointer);
     }
     return *this;
   }
@@ -178,9 +321,9 @@ public:
   auto &operator*() const { return *Pointer; }
   auto *operator->() const noexcept { return Pointer.operator->(); }
 
+  /// \note \p Other must have been allocated with new
   void reset(pointer Other = pointer()) noexcept {
-    Pointer.reset(Other);
-    revng_assert(Pointer.get_deleter() == Deleter);
+    Pointer = inner_pointer(Other, Deleter{});
   }
 
 private:
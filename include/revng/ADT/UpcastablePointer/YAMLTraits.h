@@ -18,7 +18,7 @@ void initializeOwningPointer(llvm::StringRef Kind,
   if constexpr (I < std::tuple_size_v<concrete_types>) {
     using type = typename std::tuple_element_t<I, concrete_types>;
     if (llvm::StringRef(TupleLikeTraits<type>::Name) == Kind) {
-      Obj.reset(new type);
+      Obj = O::template make<type>();
     } else {
       initializeOwningPointer<O, I + 1>(Kind, TheIO, Obj);
     }
@@ -4,6 +4,8 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <algorithm>
+#include <cstddef>
 #include <iterator>
 #include <set>
 #include <tuple>
@@ -91,10 +93,13 @@ template<typename LeftMap, typename RightMap>
 struct DefaultComparator {
   template<typename T, typename Q>
   static int compare(const T &LHS, const Q &RHS) {
-    auto LHSKey = keyFromValue<LeftMap>(LHS);
-    auto RHSKey = keyFromValue<RightMap>(RHS);
-    static_assert(std::is_same_v<decltype(LHSKey), decltype(RHSKey)>);
-    auto Less = std::less<decltype(LHSKey)>();
+    // Keys returned by reference are not copied
+    const auto &LHSKey = keyFromValue<LeftMap>(LHS);
+    const auto &RHSKey = keyFromValue<RightMap>(RHS);
+    using KeyType = std::remove_cvref_t<decltype(LHSKey)>;
+    using OtherKeyType = std::remove_cvref_t<decltype(RHSKey)>;
+    static_assert(std::is_same_v<KeyType, OtherKeyType>);
+    auto Less = std::less<KeyType>();
     if (Less(LHSKey, RHSKey))
       return -1;
     else if (Less(RHSKey, LHSKey))
@@ -104,6 +109,14 @@ struct DefaultComparator {
   }
 };
 
+/// Containers whose keys are scalars, hence cheap to compare
+template<typename T>
+concept HasScalarKey = requires(const typename T::value_type &Value) {
+  keyFromValue<T>(Value);
+  requires std::is_scalar_v<
+    std::remove_cvref_t<decltype(keyFromValue<T>(Value))>>;
+};
+
 template<typename LeftMap, typename RightMap>
 using zipmap_pair = std::pair<element_pointer_t<LeftMap>,
                               element_pointer_t<RightMap>>;
@@ -113,6 +126,16 @@ template<typename A, typename B>
 using fifc = llvm::iterator_facade_base<A, std::forward_iterator_tag, B>;
 }
 
+/// \brief Iterates over two sorted containers at once, pairing the elements
+///        with the same key
+///
+/// If both containers have random access iterators (e.g., SortedVector and
+/// SmallMap), once one of the sides has produced several elements in a row, the
+/// end of the run is looked for through an exponential search, so that the rest
+/// of it is produced without further comparisons. This pays off when one of the
+/// containers is much smaller than the other, as when diffing large models, but
+/// not if keys are scalars: comparing them is cheaper than keeping track of the
+/// runs.
 template<typename LeftMap,
          typename RightMap,
          typename Comparator = DefaultComparator<LeftMap, RightMap>>
@@ -133,6 +156,18 @@ public:
   using value_type = zipmap_pair<LeftMap, RightMap>;
   using reference = typename ZipMapIterator::reference;
 
+private:
+  static constexpr bool ShouldGallop = std::random_access_iterator<
+                                         left_inner_iterator>
+                                       and std::random_access_iterator<
+                                         right_inner_iterator>
+                                       and not(HasScalarKey<LeftMap>
+                                               and HasScalarKey<RightMap>);
+
+  /// Minimum number of consecutive elements from the same side after which we
+  /// start looking for the end of the run
+  static constexpr int MinGallop = 7;
+
 private:
   value_type Current;
   left_inner_iterator LeftIt;
@@ -140,6 +175,19 @@ private:
   right_inner_iterator RightIt;
   const right_inner_iterator EndRightIt;
 
+  /// Number of elements of one side known to precede the current element of
+  /// the other side
+  size_t RunLength = 0;
+  bool RunIsLeft = false;
+
+  /// Number of consecutive elements produced by the left side only, if
+  /// positive, or by the right side only, if negative
+  int Streak = 0;
+
+  /// Number of consecutive elements after which we start galloping. It grows
+  /// when galloping finds short runs, and shrinks back when it finds long ones.
+  int GallopThreshold = MinGallop;
+
 public:
   ZipMapIterator(left_inner_range LeftRange, right_inner_range RightRange) :
     LeftIt(LeftRange.begin()),
@@ -173,23 +221,93 @@ private:
   bool leftIsValid() const { return LeftIt != EndLeftIt; }
   bool rightIsValid() const { return RightIt != EndRightIt; }
 
+  /// \return the number of elements in [First, Last) preceding \p Bound, if
+  ///         Left, or following it otherwise
+  ///
+  /// This is an exponential search followed by a binary search. It's kept out
+  /// of line, so that the common path of next() stays small.
+  template<bool Left, typename Iterator, typename T>
+  __attribute__((noinline)) static size_t
+  gallop(Iterator First, Iterator Last, const T &Bound) {
+    auto IsBefore = [&Bound](const auto &Element) {
+      if constexpr (Left)
+        return Comparator::compare(Element, Bound) < 0;
+      else
+        return Comparator::compare(Bound, Element) > 0;
+    };
+
+    size_t Size = Last - First;
+    size_t Step = 1;
+    while (Step < Size and IsBefore(First[Step]))
+      Step *= 2;
+
+    auto End = std::partition_point(First + Step / 2,
+                                    First + std::min(Step, Size),
+                                    IsBefore);
+    return End - First;
+  }
+
+  void updateGallopThreshold() {
+    Streak = 0;
+    if (RunLength < static_cast<size_t>(GallopThreshold))
+      GallopThreshold = std::min(2 * GallopThreshold, 1 << 16);
+    else
+      GallopThreshold = std::max(GallopThreshold / 2, MinGallop);
+  }
+
+  void nextInRun() {
+    --RunLength;
+    if (RunIsLeft) {
+      Current = std::make_pair(&*LeftIt, nullptr);
+      LeftIt++;
+    } else {
+      Current = std::make_pair(nullptr, &*RightIt);
+      RightIt++;
+    }
+  }
+
   void next() {
+    if constexpr (ShouldGallop) {
+      if (RunLength != 0) {
+        nextInRun();
+        return;
+      }
+    }
+
     if (leftIsValid() and rightIsValid()) {
       switch (Comparator::compare(*LeftIt, *RightIt)) {
       case 0:
         Current = decltype(Current)(&*LeftIt, &*RightIt);
         LeftIt++;
         RightIt++;
+        if constexpr (ShouldGallop)
+          Streak = 0;
         break;
 
       case -1:
         Current = std::make_pair(&*LeftIt, nullptr);
         LeftIt++;
+        if constexpr (ShouldGallop) {
+          Streak = std::max(Streak, 0) + 1;
+          if (Streak >= GallopThreshold and leftIsValid()) {
+            RunLength = gallop<true>(LeftIt, EndLeftIt, *RightIt);
+            RunIsLeft = true;
+            updateGallopThreshold();
+          }
+        }
         break;
 
       case 1:
         Current = std::make_pair(nullptr, &*RightIt);
         RightIt++;
+        if constexpr (ShouldGallop) {
+          Streak = std::min(Streak, 0) - 1;
+          if (-Streak >= GallopThreshold and rightIsValid()) {
+            RunLength = gallop<false>(RightIt, EndRightIt, *LeftIt);
+            RunIsLeft = false;
+            updateGallopThreshold();
+          }
+        }
         break;
 
       default:
@@ -6,6 +6,7 @@
 
 #include <set>
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/Analysis/ConstantFolding.h"
 #include "llvm/Analysis/LazyValueInfo.h"
 #include "llvm/Analysis/ScalarEvolution.h"
@@ -14,6 +15,7 @@
 #include "llvm/IR/Dominators.h"
 #include "llvm/IR/Instruction.h"
 #include "llvm/IR/Intrinsics.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/raw_os_ostream.h"
 
 #include "revng/ADT/ConstantRangeSet.h"
@@ -25,6 +27,10 @@
 
 inline Logger<> AVILogger("avi");
 
+/// Maximum number of basic blocks the DisjointRanges analysis can visit, 0
+/// (the default) means no limit
+extern llvm::cl::opt<unsigned> DisjointRangesBudget;
+
 using range_size_t = uint64_t;
 const range_size_t MaxMaterializedValues = (1 << 16);
 
@@ -142,12 +148,68 @@ struct Edge {
   }
 };
 
+/// \brief Memoizes the LVI and SCEV queries performed by AdvancedValueInfo
+///
+/// The same instructions are queried on the same edges every time a
+/// DisjointRanges analysis reaches a fixed point, and once for each of the
+/// expressions built while exploring a value. The IR doesn't change during an
+/// exploration, therefore the results can be reused.
+class QueryCache {
+private:
+  using RangeKey = std::tuple<llvm::Instruction *,
+                              llvm::BasicBlock *,
+                              llvm::BasicBlock *>;
+  using RewriteKey = std::pair<const llvm::SCEV *, llvm::ConstantInt *>;
+
+private:
+  llvm::LazyValueInfo &LVI;
+  llvm::ScalarEvolution &SE;
+  llvm::DenseMap<RangeKey, llvm::ConstantRange> Ranges;
+  llvm::DenseMap<RewriteKey, llvm::ConstantInt *> Rewrites;
+
+public:
+  QueryCache(llvm::LazyValueInfo &LVI, llvm::ScalarEvolution &SE) :
+    LVI(LVI), SE(SE) {}
+
+public:
+  /// \brief The range of \p I on the edge from \p Source to \p Destination
+  ///
+  /// If \p Destination is nullptr, the range at the terminator of \p Source.
+  llvm::ConstantRange getRange(llvm::Instruction *I,
+                               llvm::BasicBlock *Source,
+                               llvm::BasicBlock *Destination) {
+    RangeKey Key = { I, Source, Destination };
+    auto It = Ranges.find(Key);
+    if (It != Ranges.end())
+      return It->second;
+
+    auto Result = llvm::ConstantRange::getFull(1);
+    if (Destination == nullptr)
+      Result = LVI.getConstantRange(I, Source->getTerminator());
+    else
+      Result = LVI.getConstantRangeOnEdge(I, Source, Destination);
+
+    Ranges.try_emplace(Key, Result);
+    return Result;
+  }
+
+  llvm::ConstantInt *replaceAllUnknownsWith(const llvm::SCEV *SC,
+                                            llvm::ConstantInt *C) {
+    auto [It, New] = Rewrites.try_emplace({ SC, C }, nullptr);
+    if (New)
+      It->second = ::replaceAllUnknownsWith(SE, SC, C);
+    return It->second;
+  }
+};
+
 /// \brief Monotone framework to collect ConstantRangeSets from LazyValueInfo
 namespace DisjointRanges {
 
+/// \brief The ranges of the target instructions, indexed by their position
+///        in Analysis::Targets
 class Element {
 private:
-  using Container = std::map<llvm::Instruction *, ConstantRangeSet>;
+  using Container = llvm::SmallVector<llvm::Optional<ConstantRangeSet>, 4>;
   Container Ranges;
 
 public:
@@ -158,33 +220,53 @@ public:
 
 public:
   void combine(const Element &Other) {
+    if (Ranges.size() < Other.Ranges.size())
+      Ranges.resize(Other.Ranges.size());
+
+    for (unsigned Index = 0; Index < Other.Ranges.size(); ++Index) {
+      const auto &OtherRange = Other.Ranges[Index];
+      if (not OtherRange)
+        continue;
 
-    // We can't use zipmap_ranges since Other is const
-    for (auto &P : Other.Ranges) {
-      auto It = Ranges.find(P.first);
-      if (It == Ranges.end())
-        Ranges[P.first] = P.second;
+      auto &Range = Ranges[Index];
+      if (not Range)
+        Range = OtherRange;
       else
-        It->second = It->second.unionWith(P.second);
+        Range = Range->unionWith(*OtherRange);
     }
   }
 
   bool lowerThanOrEqual(const Element &Other) const {
-    for (auto &P : Ranges) {
-      auto It = Other.Ranges.find(P.first);
-      if (It == Other.Ranges.end() or not It->second.contains(P.second))
+    for (unsigned Index = 0; Index < Ranges.size(); ++Index) {
+      if (not Ranges[Index])
+        continue;
+
+      if (not Other.hasKey(Index)
+          or not Other.Ranges[Index]->contains(*Ranges[Index]))
         return false;
     }
 
     return true;
   }
 
-  ConstantRangeSet &operator[](llvm::Instruction *I) { return Ranges[I]; }
-  const ConstantRangeSet &operator[](llvm::Instruction *I) const {
-    return Ranges.at(I);
+  ConstantRangeSet &operator[](unsigned Index) {
+    if (Ranges.size() <= Index)
+      Ranges.resize(Index + 1);
+
+    auto &Range = Ranges[Index];
+    if (not Range)
+      Range = ConstantRangeSet();
+    return *Range;
+  }
+
+  const ConstantRangeSet &operator[](unsigned Index) const {
+    revng_assert(hasKey(Index));
+    return *Ranges[Index];
   }
 
-  bool hasKey(llvm::Instruction *I) const { return Ranges.count(I) != 0; }
+  bool hasKey(unsigned Index) const {
+    return Index < Ranges.size() and Ranges[Index].hasValue();
+  }
 };
 
 class Analysis
@@ -202,27 +284,34 @@ private:
 
 private:
   llvm::BasicBlock *Entry;
-  llvm::LazyValueInfo &LVI;
+  QueryCache &Cache;
   const llvm::DominatorTree &DT;
-  std::map<llvm::Instruction *, ConstantRangeSet> InstructionRanges;
+  llvm::SmallVector<llvm::Instruction *, 4> Targets;
+  llvm::DenseMap<llvm::Instruction *, unsigned> TargetIndices;
+  llvm::SmallVector<ConstantRangeSet, 4> InstructionRanges;
   std::set<Edge> TargetEdges;
   std::set<llvm::BasicBlock *> WhiteList;
 
 public:
   Analysis(const llvm::SmallVectorImpl<llvm::BasicBlock *> &RPOT,
-           llvm::LazyValueInfo &LVI,
+           QueryCache &Cache,
            const llvm::DominatorTree &DT,
            const std::vector<llvm::Instruction *> &TargetInstructions,
            const std::vector<Edge> &TargetEdges) :
-    Base(RPOT), Entry(RPOT[0]), LVI(LVI), DT(DT) {
+    Base(RPOT), Entry(RPOT[0]), Cache(Cache), DT(DT) {
     using namespace llvm;
 
     registerExtremal(Entry);
 
     for (Instruction *I : TargetInstructions) {
       if (auto *Ty = dyn_cast<IntegerType>(I->getType())) {
-        InstructionRanges[I] = { ConstantRange(Ty->getIntegerBitWidth(),
-                                               true) };
+        auto [It, New] = TargetIndices.try_emplace(I, Targets.size());
+        if (not New)
+          continue;
+
+        Targets.push_back(I);
+        InstructionRanges.push_back(ConstantRange(Ty->getIntegerBitWidth(),
+                                                  true));
       }
     }
 
@@ -273,31 +362,43 @@ public:
   }
 
   const ConstantRangeSet &get(llvm::Instruction *I) const {
-    return InstructionRanges.at(I);
+    auto It = TargetIndices.find(I);
+    revng_assert(It != TargetIndices.end());
+    return InstructionRanges[It->second];
   }
 
   void dump() const debug_function { dump(dbg); }
 
   template<typename T>
   void dump(T &Output) const {
-    for (auto &P : InstructionRanges) {
-      Output << getName(P.first) << ": ";
-      P.second.dump(Output);
+    for (unsigned Index = 0; Index < Targets.size(); ++Index) {
+      Output << getName(Targets[Index]) << ": ";
+      InstructionRanges[Index].dump(Output);
       Output << "\n";
     }
   }
 
   void dumpFinalState() const { revng_abort(); }
 
+  DefaultInterrupt<Element> createBudgetExhaustedInterrupt() {
+    // Forget what we learned so far: the full range is always sound
+    for (unsigned Index = 0; Index < Targets.size(); ++Index) {
+      unsigned BitWidth = Targets[Index]->getType()->getIntegerBitWidth();
+      InstructionRanges[Index] = { llvm::ConstantRange::getFull(BitWidth) };
+    }
+
+    return DefaultInterrupt<Element>();
+  }
+
 private:
   llvm::Optional<Element> compute(const Element &Original,
                                   llvm::BasicBlock *Source,
                                   llvm::BasicBlock *Destination,
                                   bool IsTargetEdge) {
     Element Result = Original;
-    for (auto &P : InstructionRanges) {
-      llvm::Instruction *I = P.first;
-      ConstantRangeSet &InstructionRangeSet = P.second;
+    for (unsigned Index = 0; Index < Targets.size(); ++Index) {
+      llvm::Instruction *I = Targets[Index];
+      ConstantRangeSet &InstructionRangeSet = InstructionRanges[Index];
 
       if (not DT.dominates(I->getParent(), Source))
         continue;
@@ -305,14 +406,10 @@ private:
       unsigned BitWidth = I->getType()->getIntegerBitWidth();
       InstructionRangeSet.setWidth(BitWidth);
 
-      auto NewRange = llvm::ConstantRange::getFull(BitWidth);
-      if (Destination == nullptr)
-        NewRange = LVI.getConstantRange(I, Source->getTerminator());
-      else
-        NewRange = LVI.getConstantRangeOnEdge(I, Source, Destination);
+      llvm::ConstantRange NewRange = Cache.getRange(I, Source, Destination);
 
-      bool IsNew = not Result.hasKey(I);
-      ConstantRangeSet &RangeSet = Result[I];
+      bool IsNew = not Result.hasKey(Index);
+      ConstantRangeSet &RangeSet = Result[Index];
       if (IsNew) {
         RangeSet = NewRange;
       } else {
@@ -471,7 +568,7 @@ public:
   ///    according to LVI.
   /// 3. Iterate over the chain looking for the instruction associated with the
   ///    smallest range.
-  llvm::Instruction *buildExpression(llvm::LazyValueInfo &LVI,
+  llvm::Instruction *buildExpression(QueryCache &Cache,
                                      const llvm::DominatorTree &DT,
                                      PhiEdges &Edges,
                                      llvm::Value *V,
@@ -601,7 +698,8 @@ public:
       for (BasicBlock *BB : Reachable)
         ReachableVector.push_back(BB);
 
-      DisjointRanges::Analysis DR(ReachableVector, LVI, DT, Targets, Edges);
+      DisjointRanges::Analysis DR(ReachableVector, Cache, DT, Targets, Edges);
+      DR.setBudget(DisjointRangesBudget);
       DR.initialize();
       DR.run();
 
@@ -628,7 +726,7 @@ public:
 
   /// \brief Materialize all the values in this expression
   template<typename MemoryOracle>
-  MaterializedValues materialize(MemoryOracle &MO) {
+  MaterializedValues materialize(QueryCache &Cache, MemoryOracle &MO) {
     using namespace llvm;
 
     revng_assert(not Materialized);
@@ -780,9 +878,9 @@ public:
           } else if (I != nullptr) {
 
             if (Op.usesSCEV()) {
-              Current = replaceAllUnknownsWith(SE,
-                                               SE.getSCEV(I),
-                                               cast<ConstantInt>(Current));
+              auto *NewConstant = cast<ConstantInt>(Current);
+              const SCEV *SC = SE.getSCEV(I);
+              Current = Cache.replaceAllUnknownsWith(SC, NewConstant);
             } else {
               // Build operands list patching the free operand
               SmallVector<Constant *, 4> Operands;
@@ -960,6 +1058,7 @@ AdvancedValueInfo<MemoryOracle>::explore(llvm::BasicBlock *BB, llvm::Value *V) {
     { DL, SE, FakePhi, MaxMaterializedValues }
   };
   Expression::PhiEdges Edges;
+  QueryCache Cache(LVI, SE);
 
   while (true) {
     PhiProcess &Current = PendingPhis.back();
@@ -990,7 +1089,8 @@ AdvancedValueInfo<MemoryOracle>::explore(llvm::BasicBlock *BB, llvm::Value *V) {
 
       Edges.push_back(NewEdge);
 
-      NextPhi = Current.Expr.buildExpression(LVI, DT, Edges, NextValue, StopAt);
+      Expression &Expr = Current.Expr;
+      NextPhi = Expr.buildExpression(Cache, DT, Edges, NextValue, StopAt);
       Current.NextIncomingIndex++;
     }
 
@@ -1022,7 +1122,7 @@ AdvancedValueInfo<MemoryOracle>::explore(llvm::BasicBlock *BB, llvm::Value *V) {
       bool PhiDone = not IsSmallerThanUpperBound;
       if (IsSmallerThanUpperBound) {
         // Materialize the current expression
-        Result = std::move(Current.Expr.materialize<MemoryOracle>(MO));
+        Result = Current.Expr.materialize<MemoryOracle>(Cache, MO);
 
         // Reset the unfinished flag
         Current.Unfinished = false;
@@ -6,6 +6,10 @@
 
 #include "revng/BasicAnalyses/GeneratedCodeBasicInfo.h"
 
+/// \brief Decorate the accesses to CSVs with alias scopes
+///
+/// The scope of each CSV is recorded in the module, so that later runs reuse
+/// it and only update the instructions whose metadata is missing or outdated.
 class CSVAliasAnalysisPass : public llvm::PassInfoMixin<CSVAliasAnalysisPass> {
 
 public:
@@ -0,0 +1,154 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+
+#include "revng/Support/Assert.h"
+#include "revng/Support/IRHelpers.h"
+
+namespace llvm {
+class BasicBlock;
+}
+
+/// \brief A custom view on the CFG of a function, in compressed sparse row form
+///
+/// Nodes are basic blocks, numbered densely in order of insertion. Edges are
+/// first collected through addEdge, then finalize lays out successors and
+/// predecessors of each node in two contiguous arrays. After finalize, the
+/// graph cannot be modified anymore, until it's cleared.
+class CompactCFG {
+public:
+  using NodeID = uint32_t;
+
+private:
+  std::vector<llvm::BasicBlock *> Blocks;
+  llvm::DenseMap<const llvm::BasicBlock *, NodeID> IDs;
+
+  /// Edges collected before finalize
+  std::vector<std::pair<NodeID, NodeID>> Edges;
+
+  /// Successors of node I are in
+  /// `Successors[SuccessorsOffsets[I]..SuccessorsOffsets[I + 1])`
+  std::vector<uint32_t> SuccessorsOffsets;
+  std::vector<NodeID> Successors;
+
+  /// Same as SuccessorsOffsets, for predecessors
+  std::vector<uint32_t> PredecessorsOffsets;
+  std::vector<NodeID> Predecessors;
+
+  bool Finalized = false;
+
+public:
+  void clear() { *this = CompactCFG(); }
+
+  /// \return the identifier of \p BB, registering it if necessary
+  NodeID addNode(llvm::BasicBlock *BB) {
+    revng_assert(not Finalized);
+    auto [It, New] = IDs.try_emplace(BB, Blocks.size());
+    if (New)
+      Blocks.push_back(BB);
+    return It->second;
+  }
+
+  void addEdge(llvm::BasicBlock *From, llvm::BasicBlock *To) {
+    NodeID Source = addNode(From);
+    NodeID Destination = addNode(To);
+    Edges.emplace_back(Source, Destination);
+  }
+
+  /// \brief Lay out the collected edges, preserving their order
+  void finalize() {
+    revng_assert(not Finalized);
+    Finalized = true;
+
+    layout(SuccessorsOffsets, Successors, false);
+    layout(PredecessorsOffsets, Predecessors, true);
+
+    Edges.clear();
+    Edges.shrink_to_fit();
+  }
+
+public:
+  size_t size() const { return Blocks.size(); }
+
+  bool hasNode(const llvm::BasicBlock *BB) const {
+    return IDs.count(BB) != 0;
+  }
+
+  std::optional<NodeID> getNode(const llvm::BasicBlock *BB) const {
+    auto It = IDs.find(BB);
+    if (It == IDs.end())
+      return std::nullopt;
+    return It->second;
+  }
+
+  llvm::BasicBlock *block(NodeID Node) const { return Blocks[Node]; }
+
+  llvm::ArrayRef<NodeID> successors(NodeID Node) const {
+    return slice(SuccessorsOffsets, Successors, Node);
+  }
+
+  llvm::ArrayRef<NodeID> predecessors(NodeID Node) const {
+    return slice(PredecessorsOffsets, Predecessors, Node);
+  }
+
+public:
+  void dump() const debug_function { dump(dbg); }
+
+  template<typename T>
+  void dump(T &Output) const {
+    revng_assert(Finalized);
+    for (NodeID Node = 0; Node < size(); ++Node) {
+      Output << getName(block(Node)) << ":\n";
+      Output << "  Predecessors:\n";
+      for (NodeID Predecessor : predecessors(Node))
+        Output << "    " << getName(block(Predecessor)) << "\n";
+      Output << "\n";
+      Output << "  Successors:\n";
+      for (NodeID Successor : successors(Node))
+        Output << "    " << getName(block(Successor)) << "\n";
+      Output << "\n";
+    }
+  }
+
+private:
+  llvm::ArrayRef<NodeID> slice(const std::vector<uint32_t> &Offsets,
+                               const std::vector<NodeID> &Links,
+                               NodeID Node) const {
+    revng_assert(Finalized);
+    revng_assert(Node < size());
+    return llvm::ArrayRef<NodeID>(Links).slice(Offsets[Node],
+                                               Offsets[Node + 1]
+                                                 - Offsets[Node]);
+  }
+
+  void layout(std::vector<uint32_t> &Offsets,
+              std::vector<NodeID> &Links,
+              bool Backward) const {
+    // Counting sort of the edges by source (or destination, if Backward)
+    Offsets.assign(size() + 1, 0);
+    for (auto [Source, Destination] : Edges)
+      ++Offsets[(Backward ? Destination : Source) + 1];
+
+    for (size_t I = 1; I < Offsets.size(); ++I)
+      Offsets[I] += Offsets[I - 1];
+
+    std::vector<uint32_t> Next(Offsets.begin(), Offsets.end() - 1);
+    Links.resize(Edges.size());
+    for (auto [Source, Destination] : Edges) {
+      if (Backward)
+        Links[Next[Destination]++] = Source;
+      else
+        Links[Next[Source]++] = Destination;
+    }
+  }
+};
@@ -6,11 +6,16 @@
 
 #include <cstdint>
 #include <map>
+#include <optional>
 #include <utility>
+#include <vector>
 
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/IR/Dominators.h"
 #include "llvm/IR/GlobalObject.h"
 #include "llvm/IR/PassManager.h"
+#include "llvm/IR/ValueHandle.h"
 #include "llvm/Pass.h"
 #include "llvm/Support/Casting.h"
 
@@ -31,6 +36,15 @@ class Instruction;
 class MDNode;
 } // namespace llvm
 
+/// \brief Name of the named metadata recording the offset of each CSV in the
+///        CPU state
+///
+/// It's computed at lift time, where the layout of the CPU state is known, and
+/// it holds a single tuple of (CSV, offset) pairs.
+///
+/// \see GeneratedCodeBasicInfo::csvOffset
+constexpr const char *CSVOffsetsMDName = "revng.csv.offsets";
+
 /// \brief Pass to collect basic information about the generated code
 ///
 /// This pass provides useful information for other passes by extracting them
@@ -42,6 +56,20 @@ class MDNode;
 /// between basic blocks generated due to translation and dispatcher-related
 /// basic blocks.
 class GeneratedCodeBasicInfo {
+public:
+  /// \brief Summary of the parts of a module GeneratedCodeBasicInfo depends on
+  struct Fingerprint {
+    /// Hash of root, newpc, the content of the CSVs list and of their offsets
+    /// and the markers of the blocks of root (dispatcher-related blocks and
+    /// jump targets). Values are hashed by address and by name, metadata by
+    /// content. Since a new value can reuse the memory of a deleted one, users
+    /// must make sure that none of the values hashed by address (see
+    /// trackedValues) has been deleted in the meantime.
+    size_t Markers = 0;
+    /// Hash of the CFG of root
+    size_t CFG = 0;
+  };
+
 public:
   GeneratedCodeBasicInfo(const model::Binary &Binary) :
     Binary(&Binary),
@@ -60,6 +88,18 @@ public:
 
   void run(llvm::Module &M);
 
+  static Fingerprint computeFingerprint(llvm::Module &M);
+
+  /// \brief The values the fingerprint of \p M hashes by address: root,
+  ///        newpc and the blocks of root
+  static std::vector<llvm::WeakVH> trackedValues(llvm::Module &M);
+
+  /// \brief Drop the information depending on the CFG of the module
+  ///
+  /// \param RootChanged whether the CFG of root changed too, or only the CFG
+  ///        of other functions.
+  void purgeCFGInformation(bool RootChanged);
+
   /// \brief Handle the invalidation of this information, so that it does not
   ///        get invalidated by other passes.
   bool invalidate(llvm::Module &,
@@ -197,8 +237,10 @@ public:
   llvm::BasicBlock *getBlockAt(MetaAddress PC) {
     parseRoot();
 
-    auto It = JumpTargets.find(PC);
-    if (It == JumpTargets.end())
+    auto It = llvm::partition_point(JumpTargets, [&PC](const auto &Element) {
+      return Element.first < PC;
+    });
+    if (It == JumpTargets.end() or It->first != PC)
       return nullptr;
 
     return It->second;
@@ -270,11 +312,45 @@ public:
       return Element.second;
     };
 
-    auto [Start, End] = PCToBlockCache.equal_range(PC);
+    auto Start = llvm::partition_point(PCToBlockCache, [&PC](auto &Element) {
+      return Element.first < PC;
+    });
+    auto End = std::partition_point(Start,
+                                    PCToBlockCache.end(),
+                                    [&PC](auto &Element) {
+                                      return not(PC < Element.first);
+                                    });
     return llvm::make_range(llvm::map_iterator(Start, GetSecond),
                             llvm::map_iterator(End, GetSecond));
   }
 
+  /// \brief Return the translated blocks owned by the jump targets in
+  ///        [\p Start, \p End)
+  ///
+  /// Blocks are grouped by jump target, in order of address. The cost is
+  /// logarithmic in the number of translated blocks, plus the size of the
+  /// result.
+  auto getBlocksGeneratedByPCRange(MetaAddress Start, MetaAddress End) {
+    // Lazily initialize the pc-to-BasicBlock cache
+    if (PCToBlockCache.size() == 0)
+      initializePCToBlockCache();
+
+    auto GetSecond = [](PCToBlockMap::value_type &Element) {
+      return Element.second;
+    };
+
+    auto First = llvm::partition_point(PCToBlockCache, [&Start](auto &Element) {
+      return Element.first < Start;
+    });
+    auto Last = std::partition_point(First,
+                                     PCToBlockCache.end(),
+                                     [&End](auto &Element) {
+                                       return Element.first < End;
+                                     });
+    return llvm::make_range(llvm::map_iterator(First, GetSecond),
+                            llvm::map_iterator(Last, GetSecond));
+  }
+
   llvm::BasicBlock *anyPC() {
     parseRoot();
     return AnyPC;
@@ -292,6 +368,26 @@ public:
 
   const llvm::ArrayRef<llvm::GlobalVariable *> csvs() const { return CSVs; }
 
+  /// \return the offset of \p CSV in the CPU state, or std::nullopt if it's
+  ///         unknown
+  std::optional<int64_t> csvOffset(const llvm::GlobalVariable *CSV) const {
+    auto It = OffsetByCSV.find(CSV);
+    if (It == OffsetByCSV.end())
+      return std::nullopt;
+    return It->second;
+  }
+
+  /// \return the CSV starting at \p Offset in the CPU state, if any
+  llvm::GlobalVariable *csvAtOffset(int64_t Offset) const {
+    auto Compare = [](const auto &Entry, int64_t Offset) {
+      return Entry.first < Offset;
+    };
+    auto It = llvm::lower_bound(CSVsByOffset, Offset, Compare);
+    if (It == CSVsByOffset.end() or It->first != Offset)
+      return nullptr;
+    return It->second;
+  }
+
   const std::vector<llvm::GlobalVariable *> &abiRegisters() const {
     return ABIRegisters;
   }
@@ -406,16 +502,21 @@ private:
   llvm::BasicBlock *DispatcherFail;
   llvm::BasicBlock *AnyPC;
   llvm::BasicBlock *UnexpectedPC;
-  std::map<MetaAddress, llvm::BasicBlock *> JumpTargets;
+  /// Jump targets sorted by address
+  std::vector<std::pair<MetaAddress, llvm::BasicBlock *>> JumpTargets;
   unsigned PCRegSize;
   llvm::Function *RootFunction;
   std::vector<llvm::GlobalVariable *> CSVs;
+  /// CSVs with a known offset, sorted by offset
+  std::vector<std::pair<int64_t, llvm::GlobalVariable *>> CSVsByOffset;
+  llvm::DenseMap<const llvm::GlobalVariable *, int64_t> OffsetByCSV;
   std::vector<llvm::GlobalVariable *> ABIRegisters;
   std::set<llvm::GlobalVariable *> ABIRegistersSet;
   llvm::StructType *MetaAddressStruct;
   llvm::Function *NewPC;
   std::unique_ptr<ProgramCounterHandler> PCH;
-  using PCToBlockMap = std::multimap<MetaAddress, llvm::BasicBlock *>;
+  /// Translated basic blocks sorted by the address of their jump target
+  using PCToBlockMap = std::vector<std::pair<MetaAddress, llvm::BasicBlock *>>;
   PCToBlockMap PCToBlockCache;
   std::map<llvm::Function *, llvm::DominatorTree> DTMap;
   bool RootParsed = false;
@@ -443,11 +544,25 @@ public:
   /// analysis manually and use a proxy.
   Result run(llvm::Module &M, llvm::ModuleAnalysisManager &);
   Result run(llvm::Function &F, llvm::FunctionAnalysisManager &);
+
+  /// \brief Get GCBI from a function pass, reusing the result for the whole
+  ///        module, if it has already been computed
+  ///
+  /// \note ModuleAnalysisManagerFunctionProxy has to be registered in \p FAM.
+  static Result &get(llvm::Function &F, llvm::FunctionAnalysisManager &FAM);
 };
 
 /// Legacy pass manager pass to access GCBI.
+///
+/// Since most passes do not declare GCBI as preserved, the legacy pass manager
+/// runs this pass again after almost each pass. The previous result is then
+/// reused, unless the pass actually changed the markers in root.
 class GeneratedCodeBasicInfoWrapperPass : public llvm::ModulePass {
   std::unique_ptr<GeneratedCodeBasicInfo> GCBI;
+  const model::Binary *Binary = nullptr;
+  GeneratedCodeBasicInfo::Fingerprint LastFingerprint;
+  /// The values LastFingerprint hashes by address, nulled upon deletion
+  std::vector<llvm::WeakVH> Tracked;
 
 public:
   static char ID;
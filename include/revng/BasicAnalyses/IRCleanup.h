@@ -0,0 +1,41 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include "llvm/Pass.h"
+
+/// \brief Perform the simple IR cleanups in a single walk of the module
+///
+/// For each function, in a single pass over its instructions:
+///
+/// * drop the calls to `newpc` (as RemoveNewPCCallsPass);
+/// * drop the debug metadata of isolated functions (as RemoveDbgMetadata);
+/// * shrink the operands of instructions (as ShrinkInstructionOperandsPass).
+///
+/// Then, `newpc` gets an empty body (as EmptyNewPC).
+///
+/// \note each function is handled on its own, so this can run in parallel on
+///       modules living in different contexts, e.g., the shards of a
+///       ShardedLLVMContainer. Functions of the same module cannot be cleaned
+///       up in parallel, since LLVMContext is not thread safe.
+class IRCleanup : public llvm::ModulePass {
+public:
+  static char ID;
+
+public:
+  IRCleanup() : llvm::ModulePass(ID) {}
+
+  void getAnalysisUsage(llvm::AnalysisUsage &AU) const override {
+    AU.setPreservesCFG();
+  }
+
+  bool runOnModule(llvm::Module &M) override;
+
+public:
+  /// \brief Clean up \p F alone
+  ///
+  /// \return true if \p F has been changed
+  static bool cleanup(llvm::Function &F);
+};
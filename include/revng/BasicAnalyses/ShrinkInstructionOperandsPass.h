@@ -55,6 +55,103 @@ inline void replaceAndResizeOperand(llvm::Instruction *I,
   I->setOperand(Index, NewOperand);
 }
 
+/// \brief Shrink the operands of \p I, if possible
+///
+/// \note this might erase the truncation using \p I.
+///
+/// \return true if \p I has been changed
+inline bool shrinkInstructionOperands(llvm::Instruction &I) {
+  using namespace llvm;
+
+  Value *ActualOp0 = nullptr;
+  unsigned Actual0Size = 0;
+  Value *ActualOp1 = nullptr;
+  unsigned Actual1Size = 0;
+  unsigned OriginalSize = getSize(&I);
+
+  if (OriginalSize == 0)
+    return false;
+
+  switch (I.getOpcode()) {
+  case Instruction::ICmp:
+
+    if (auto *Compare = dyn_cast<ICmpInst>(&I)) {
+
+      Signedness S;
+      if (Compare->isSigned())
+        S = Signed;
+      else if (Compare->isUnsigned())
+        S = Unsigned;
+      else
+        S = DontCare;
+
+      Value *Op0 = I.getOperand(0);
+      Value *Op1 = I.getOperand(1);
+      revng_assert(getSize(Op0) == getSize(Op1));
+
+      ActualOp0 = getPreExt(Op0, S);
+      ActualOp1 = getPreExt(Op1, S);
+      Actual0Size = getSize(ActualOp0);
+      Actual1Size = getSize(ActualOp1);
+
+      if (Actual0Size != 0 and Actual1Size != 0
+          and Actual0Size != OriginalSize and Actual1Size != OriginalSize) {
+        // OK, we can shrink
+        unsigned NewSize = std::max(Actual0Size, Actual1Size);
+        replaceAndResizeOperand(&I, 0, ActualOp0, NewSize, S);
+        replaceAndResizeOperand(&I, 1, ActualOp1, NewSize, S);
+        return true;
+      }
+    }
+
+    break;
+
+  case Instruction::And:
+  case Instruction::Or:
+  case Instruction::Xor:
+  case Instruction::Shl:
+  case Instruction::Add:
+  case Instruction::Mul:
+  case Instruction::Sub: {
+    Instruction *ActualOutput = getPostTrunc(&I);
+    if (ActualOutput == nullptr)
+      return false;
+
+    unsigned OutputSize = getSize(ActualOutput);
+
+    if (OutputSize != OriginalSize) {
+      // OK, we can shrink
+      ActualOp0 = getPreExt(I.getOperand(0), DontCare);
+      ActualOp1 = getPreExt(I.getOperand(1), DontCare);
+      replaceAndResizeOperand(&I, 0, ActualOp0, OutputSize, DontCare);
+      replaceAndResizeOperand(&I, 1, ActualOp1, OutputSize, DontCare);
+      I.mutateType(ActualOutput->getType());
+      ActualOutput->replaceAllUsesWith(&I);
+      eraseFromParent(ActualOutput);
+      return true;
+    }
+
+  } break;
+
+  case Instruction::UDiv:
+  case Instruction::SDiv:
+  case Instruction::URem:
+  case Instruction::SRem:
+    // TODO
+    break;
+
+  case Instruction::AShr:
+  case Instruction::LShr:
+    // TODO
+    break;
+
+  default:
+    break;
+  }
+
+  return false;
+}
+
 /// \brief Transformation to shrink operand sizes where possible
 ///
 /// This pass shrinks the operand of binary operators and comparison
@@ -81,99 +178,14 @@ public:
   run(llvm::Function &F, llvm::FunctionAnalysisManager &FAM);
 };
 
-llvm::PreservedAnalyses
+inline llvm::PreservedAnalyses
 ShrinkInstructionOperandsPass::run(llvm::Function &F,
                                    llvm::FunctionAnalysisManager &FAM) {
   using namespace llvm;
 
-  for (BasicBlock &BB : F) {
-    for (Instruction &I : BB) {
-
-      Value *ActualOp0 = nullptr;
-      unsigned Actual0Size = 0;
-      Value *ActualOp1 = nullptr;
-      unsigned Actual1Size = 0;
-      unsigned OriginalSize = getSize(&I);
-
-      if (OriginalSize == 0)
-        continue;
-
-      switch (I.getOpcode()) {
-      case Instruction::ICmp:
-
-        if (auto *Compare = dyn_cast<ICmpInst>(&I)) {
-
-          Signedness S;
-          if (Compare->isSigned())
-            S = Signed;
-          else if (Compare->isUnsigned())
-            S = Unsigned;
-          else
-            S = DontCare;
-
-          Value *Op0 = I.getOperand(0);
-          Value *Op1 = I.getOperand(1);
-          revng_assert(getSize(Op0) == getSize(Op1));
-
-          ActualOp0 = getPreExt(Op0, S);
-          ActualOp1 = getPreExt(Op1, S);
-          Actual0Size = getSize(ActualOp0);
-          Actual1Size = getSize(ActualOp1);
-
-          if (Actual0Size != 0 and Actual1Size != 0
-              and Actual0Size != OriginalSize and Actual1Size != OriginalSize) {
-            // OK, we can shrink
-            unsigned NewSize = std::max(Actual0Size, Actual1Size);
-            replaceAndResizeOperand(&I, 0, ActualOp0, NewSize, S);
-            replaceAndResizeOperand(&I, 1, ActualOp1, NewSize, S);
-          }
-        }
-
-        break;
-
-      case Instruction::And:
-      case Instruction::Or:
-      case Instruction::Xor:
-      case Instruction::Shl:
-      case Instruction::Add:
-      case Instruction::Mul:
-      case Instruction::Sub: {
-        Instruction *ActualOutput = getPostTrunc(&I);
-        if (ActualOutput == nullptr)
-          continue;
-
-        unsigned OutputSize = getSize(ActualOutput);
-
-        if (OutputSize != OriginalSize) {
-          // OK, we can shrink
-          ActualOp0 = getPreExt(I.getOperand(0), DontCare);
-          ActualOp1 = getPreExt(I.getOperand(1), DontCare);
-          replaceAndResizeOperand(&I, 0, ActualOp0, OutputSize, DontCare);
-          replaceAndResizeOperand(&I, 1, ActualOp1, OutputSize, DontCare);
-          I.mutateType(ActualOutput->getType());
-          ActualOutput->replaceAllUsesWith(&I);
-          eraseFromParent(ActualOutput);
-        }
-
-      } break;
-
-      case Instruction::UDiv:
-      case Instruction::SDiv:
-      case Instruction::URem:
-      case Instruction::SRem:
-        // TODO
-        break;
-
-      case Instruction::AShr:
-      case Instruction::LShr:
-        // TODO
-        break;
-
-      default:
-        break;
-      }
-    }
-  }
+  for (BasicBlock &BB : F)
+    for (Instruction &I : BB)
+      shrinkInstructionOperands(I);
 
   return PreservedAnalyses::none();
 }
@@ -7,12 +7,14 @@
 #include "llvm/IR/AssemblyAnnotationWriter.h"
 #include "llvm/IR/PassManager.h"
 
+#include "revng/Support/SharedOutputFile.h"
+
 class AAWriterPass : public llvm::PassInfoMixin<AAWriterPass> {
-  llvm::raw_fd_ostream &OS;
+  BufferedOutputStream &OS;
   const bool StoresOnly;
 
 public:
-  AAWriterPass(llvm::raw_fd_ostream &OS, bool StoresOnly = false) :
+  AAWriterPass(BufferedOutputStream &OS, bool StoresOnly = false) :
     OS(OS), StoresOnly(StoresOnly){};
 
   llvm::PreservedAnalyses
@@ -4,9 +4,19 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
-#include "llvm/ADT/SmallSet.h"
+#include <array>
+#include <bitset>
+#include <map>
+#include <tuple>
+#include <utility>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Function.h"
 #include "llvm/IR/GlobalVariable.h"
 #include "llvm/IR/Instruction.h"
 #include "llvm/IR/Instructions.h"
@@ -16,6 +26,7 @@
 #include "revng/BasicAnalyses/GeneratedCodeBasicInfo.h"
 #include "revng/MFP/MFP.h"
 #include "revng/Model/Binary.h"
+#include "revng/Support/Assert.h"
 
 namespace ABIAnalyses {
 
@@ -29,10 +40,20 @@ enum TransferKind {
   None,
 };
 
+/// \brief Number of values of TransferKind
+inline constexpr size_t TransferKindsCount = None + 1;
+
+/// \brief Maximum number of ABI registers of an architecture
+inline constexpr size_t MaxABIRegisters = 64;
+
+/// \brief A set of ABI registers, indexed as in ABIAnalysis::getRegisters()
+using RegisterSet = std::bitset<MaxABIRegisters>;
+
 struct ABIAnalysis {
 private:
-  llvm::SmallSet<llvm::GlobalVariable *, 20> ABIRegisters;
+  llvm::DenseMap<const llvm::GlobalVariable *, unsigned> ABIRegisters;
   llvm::SmallVector<llvm::GlobalVariable *, 20> RegisterList;
+  RegisterSet AllRegisters;
   const llvm::Instruction *CallSite;
 
 public:
@@ -44,16 +65,30 @@ public:
 
     for (auto *CSV : GCBI.abiRegisters()) {
       if (CSV) {
-        ABIRegisters.insert(CSV);
+        AllRegisters.set(RegisterList.size());
+        ABIRegisters[CSV] = RegisterList.size();
         RegisterList.emplace_back(CSV);
       }
     }
+    revng_assert(RegisterList.size() <= MaxABIRegisters);
   };
 
-  const llvm::SmallVector<llvm::GlobalVariable *, 20> getRegisters() const {
+  llvm::ArrayRef<llvm::GlobalVariable *> getRegisters() const {
     return RegisterList;
   }
 
+  const RegisterSet &getAllRegisters() const { return AllRegisters; }
+
+  const llvm::Instruction *getCallSite() const { return CallSite; }
+
+  RegisterSet
+  toRegisterSet(llvm::ArrayRef<const llvm::GlobalVariable *> Registers) const {
+    RegisterSet Result;
+    for (const llvm::GlobalVariable *Register : Registers)
+      Result.set(ABIRegisters.lookup(Register));
+    return Result;
+  }
+
   bool isABIRegister(const llvm::Value *) const;
 
   TransferKind classifyInstruction(const llvm::Instruction *) const;
@@ -160,72 +195,160 @@ ABIAnalysis::getRegistersRead(const llvm::Instruction *I) const {
   return Result;
 }
 
+/// \brief Lattice mapping each ABI register to an element of CoreLattice
+///
+/// Registers are identified by their index in ABIAnalysis::getRegisters().
+/// For each element of CoreLattice we keep the set of registers it is
+/// associated to, so that combining, comparing and transferring become a
+/// handful of bitwise operations on RegisterSet, driven by the tables
+/// CoreLattice exposes (TransferTable, CombineTable and LessOrEqualTable).
 template<typename CoreLattice>
-struct RegistersMap
-  : public llvm::DenseMap<const llvm::GlobalVariable *,
-                          typename CoreLattice::LatticeElement> {
-private:
+class RegistersLattice {
+public:
   using InnerLatticeElement = typename CoreLattice::LatticeElement;
-  using Base = llvm::DenseMap<const llvm::GlobalVariable *,
-                              InnerLatticeElement>;
 
 private:
+  static constexpr size_t ElementsCount = CoreLattice::LatticeElementsCount;
+
+private:
+  /// Values[E] is the set of registers whose value is E, each register
+  /// belongs to exactly one of them
+  std::array<RegisterSet, ElementsCount> Values = {};
+  /// The registers explicitly assigned a value, the others have Default
+  RegisterSet Assigned;
   InnerLatticeElement Default{};
 
 public:
-  RegistersMap() : Default{} {}
-  RegistersMap(InnerLatticeElement Default) : Default(Default) {}
+  RegistersLattice() : RegistersLattice(InnerLatticeElement{}) {}
+  RegistersLattice(InnerLatticeElement Default) : Default(Default) {
+    Values[Default].set();
+  }
 
 public:
-  InnerLatticeElement getOrDefault(const llvm::GlobalVariable *GV) const {
-    auto It = Base::find(GV);
-    if (It == Base::end())
-      return Default;
-    else
-      return It->second;
+  InnerLatticeElement get(unsigned Index) const {
+    for (size_t I = 0; I < ElementsCount; ++I)
+      if (Values[I].test(Index))
+        return element(I);
+    revng_abort();
   }
 
-public:
-  RegistersMap combine(const RegistersMap &RHS) const {
-    RegistersMap New = *this;
-    for (const auto &[Reg, S] : RHS) {
-      auto LHSValue = New.getOrDefault(Reg);
-      auto RHSValue = RHS.getOrDefault(Reg);
-      New[Reg] = CoreLattice::combineValues(LHSValue, RHSValue);
+  /// \brief Applies the transfer function \p T to the registers in \p Mask
+  void transfer(TransferKind T, const RegisterSet &Mask) {
+    std::array<RegisterSet, ElementsCount> New = {};
+    for (size_t I = 0; I < ElementsCount; ++I) {
+      RegisterSet Moved = Values[I] & Mask;
+      New[I] |= Values[I] & ~Mask;
+      if (Moved.any())
+        New[CoreLattice::TransferTable[T][I]] |= Moved;
     }
 
-    New.Default = CoreLattice::combineValues(New.Default, RHS.Default);
+    Values = New;
+    Assigned |= Mask;
+  }
 
-    return New;
+  /// \brief Enumerates the registers that have been explicitly assigned
+  ///
+  /// \return a range of pairs of a register and its value, valid as long as
+  ///         this lattice element is not modified
+  auto entries(llvm::ArrayRef<llvm::GlobalVariable *> Registers) const {
+    auto IsAssigned = [this](const auto &Entry) {
+      return Assigned.test(Entry.index());
+    };
+    auto ToEntry = [this](const auto &Entry) {
+      const llvm::GlobalVariable *Register = Entry.value();
+      return std::make_pair(Register, get(Entry.index()));
+    };
+
+    auto Entries = llvm::make_filter_range(llvm::enumerate(Registers),
+                                           IsAssigned);
+    return llvm::map_range(Entries, ToEntry);
   }
 
-  bool isLessOrEqual(const RegistersMap &RHS) const {
-    const RegistersMap &LHS = *this;
+public:
+  RegistersLattice combine(const RegistersLattice &RHS) const {
+    RegistersLattice New;
+    New.Default = CoreLattice::combineValues(Default, RHS.Default);
+    New.Values = {};
+    for (size_t L = 0; L < ElementsCount; ++L) {
+      if (Values[L].none())
+        continue;
+
+      for (size_t R = 0; R < ElementsCount; ++R) {
+        auto Result = CoreLattice::CombineTable[L][R];
+        New.Values[Result] |= Values[L] & RHS.Values[R];
+      }
+    }
+    New.Assigned = Assigned | RHS.Assigned;
 
-    if (!CoreLattice::isLessOrEqual(LHS.Default, RHS.Default))
+    return New;
+  }
+
+  bool isLessOrEqual(const RegistersLattice &RHS) const {
+    if (!CoreLattice::isLessOrEqual(Default, RHS.Default))
       return false;
 
-    for (auto &[Reg, S] : LHS) {
-      auto LHSValue = LHS.getOrDefault(Reg);
-      auto RHSValue = RHS.getOrDefault(Reg);
-      if (!CoreLattice::isLessOrEqual(LHSValue, RHSValue)) {
-        return false;
-      }
-    }
-    for (auto &[Reg, S] : RHS) {
-      auto LHSValue = LHS.getOrDefault(Reg);
-      auto RHSValue = RHS.getOrDefault(Reg);
-      if (!CoreLattice::isLessOrEqual(LHSValue, RHSValue)) {
+    for (size_t L = 0; L < ElementsCount; ++L) {
+      if (Values[L].none())
+        continue;
+
+      // The registers that in RHS have a value greater or equal than L
+      RegisterSet Allowed;
+      for (size_t R = 0; R < ElementsCount; ++R)
+        if (CoreLattice::LessOrEqualTable[L][R])
+          Allowed |= RHS.Values[R];
+
+      if ((Values[L] & ~Allowed).any())
         return false;
-      }
     }
+
     return true;
   }
+
+private:
+  static InnerLatticeElement element(size_t Index) {
+    return static_cast<InnerLatticeElement>(Index);
+  }
+};
+
+/// \brief The numberings of the basic blocks of a function, in both directions
+///
+/// The ABI analyses starting from the same basic block in the same direction
+/// share the same numbering (see MFP::LabelNumbering). It has to be
+/// invalidated whenever the CFG of the function changes.
+class CFGNumberings {
+private:
+  template<bool IsForward>
+  using GraphType = std::conditional_t<IsForward,
+                                       const llvm::BasicBlock *,
+                                       llvm::Inverse<const llvm::BasicBlock *>>;
+
+  template<bool IsForward>
+  using Cache = MFP::LabelNumberingCache<
+    llvm::GraphTraits<GraphType<IsForward>>, GraphType<IsForward>>;
+
+private:
+  Cache<true> Forward;
+  Cache<false> Backward;
+
+public:
+  template<bool IsForward>
+  const MFP::LabelNumbering<const llvm::BasicBlock *> &
+  get(const llvm::BasicBlock *Start) {
+    if constexpr (IsForward)
+      return Forward.get(Start);
+    else
+      return Backward.get(Start);
+  }
+
+  void invalidate() {
+    Forward.invalidate();
+    Backward.invalidate();
+  }
 };
 
 template<bool IsForward, typename CoreLattice>
 struct MFIAnalysis : ABIAnalyses::ABIAnalysis {
-  using LatticeElement = RegistersMap<CoreLattice>;
+  using LatticeElement = RegistersLattice<CoreLattice>;
   using Label = const llvm::BasicBlock *;
   using GraphType = std::conditional_t<IsForward,
                                        const llvm::BasicBlock *,
@@ -256,25 +379,15 @@ struct MFIAnalysis : ABIAnalyses::ABIAnalysis {
       auto I = InsList[IsForward ? Index : (InsList.size() - Index - 1)];
       TransferKind T = classifyInstruction(I);
       switch (T) {
-      case TheCall: {
-        for (auto &Reg : getRegisters()) {
-          auto RegState = New.getOrDefault(Reg);
-          New[Reg] = CoreLattice::transfer(TheCall, RegState);
-        }
+      case TheCall:
+        New.transfer(T, getAllRegisters());
         break;
-      }
       case Read:
-        for (auto &Reg : getRegistersRead(I)) {
-          auto RegState = New.getOrDefault(Reg);
-          New[Reg] = CoreLattice::transfer(T, RegState);
-        }
+        New.transfer(T, toRegisterSet(getRegistersRead(I)));
         break;
       case WeakWrite:
       case Write:
-        for (auto &Reg : getRegistersWritten(I)) {
-          auto RegState = New.getOrDefault(Reg);
-          New[Reg] = CoreLattice::transfer(T, RegState);
-        }
+        New.transfer(T, toRegisterSet(getRegistersWritten(I)));
         break;
       default:
         break;
@@ -284,4 +397,155 @@ struct MFIAnalysis : ABIAnalyses::ABIAnalysis {
   };
 };
 
+/// \brief The instructions of a function relevant to the ABI analyses
+///
+/// Each instruction is classified once, independently of the call site the
+/// analysis is interested in, so that multiple analyses on the same function
+/// do not need to classify every instruction again.
+class ClassifiedInstructions {
+public:
+  struct Entry {
+    const llvm::Instruction *I = nullptr;
+    TransferKind Kind = None;
+    RegisterSet Registers;
+  };
+
+private:
+  ABIAnalysis Analysis;
+  llvm::DenseMap<const llvm::BasicBlock *, llvm::SmallVector<Entry, 4>> Blocks;
+
+public:
+  ClassifiedInstructions(const llvm::Function &F,
+                         const GeneratedCodeBasicInfo &GCBI) :
+    Analysis(GCBI) {
+    using namespace llvm;
+
+    for (const BasicBlock &BB : F) {
+      auto &Entries = Blocks[&BB];
+      for (const Instruction &I : BB) {
+        switch (TransferKind Kind = Analysis.classifyInstruction(&I)) {
+        case Read:
+          Entries.push_back({ &I,
+                              Kind,
+                              Analysis.toRegisterSet(
+                                Analysis.getRegistersRead(&I)) });
+          break;
+        case WeakWrite:
+        case Write:
+          Entries.push_back({ &I,
+                              Kind,
+                              Analysis.toRegisterSet(
+                                Analysis.getRegistersWritten(&I)) });
+          break;
+        default:
+          // Calls might be the call site of some analysis
+          if (isa<CallInst>(&I))
+            Entries.push_back({ &I, None, {} });
+          break;
+        }
+      }
+    }
+  }
+
+public:
+  llvm::ArrayRef<llvm::GlobalVariable *> getRegisters() const {
+    return Analysis.getRegisters();
+  }
+
+  llvm::ArrayRef<Entry> get(const llvm::BasicBlock *BB) const {
+    auto It = Blocks.find(BB);
+    revng_assert(It != Blocks.end());
+    return It->second;
+  }
+};
+
+/// \brief Runs multiple ABI analyses with the same direction and start at once
+///
+/// The lattice is the product of the lattices of each analysis and the
+/// transfer function walks the pre-classified instructions of each basic block
+/// only once, applying them to all the analyses. The fixed point of the product
+/// is the tuple of the fixed points of each analysis.
+template<bool IsForward, typename... CoreLattices>
+struct FusedMFIAnalysis : ABIAnalyses::ABIAnalysis {
+  using LatticeElement = std::tuple<RegistersLattice<CoreLattices>...>;
+  using Label = const llvm::BasicBlock *;
+  using GraphType = std::conditional_t<IsForward,
+                                       const llvm::BasicBlock *,
+                                       llvm::Inverse<const llvm::BasicBlock *>>;
+  using GT = llvm::GraphTraits<GraphType>;
+  using LGT = GraphType;
+
+  const ClassifiedInstructions *Instructions;
+
+  LatticeElement
+  combineValues(const LatticeElement &LHS, const LatticeElement &RHS) const {
+    return combineValues(LHS, RHS, std::index_sequence_for<CoreLattices...>());
+  };
+
+  bool
+  isLessOrEqual(const LatticeElement &LHS, const LatticeElement &RHS) const {
+    return isLessOrEqual(LHS, RHS, std::index_sequence_for<CoreLattices...>());
+  };
+
+  LatticeElement applyTransferFunction(Label L, const LatticeElement &E) const {
+    LatticeElement New = E;
+    auto Transfer = [&New](TransferKind T, const RegisterSet &Mask) {
+      std::apply([&](auto &...Element) { (Element.transfer(T, Mask), ...); },
+                 New);
+    };
+
+    auto Entries = Instructions->get(L);
+    for (size_t Index = 0; Index < Entries.size(); Index++) {
+      const auto &Entry = Entries[IsForward ? Index :
+                                              (Entries.size() - Index - 1)];
+      if (Entry.I == getCallSite())
+        Transfer(TheCall, getAllRegisters());
+      else if (Entry.Kind != None)
+        Transfer(Entry.Kind, Entry.Registers);
+    }
+
+    return New;
+  };
+
+private:
+  template<size_t... Indices>
+  static LatticeElement combineValues(const LatticeElement &LHS,
+                                      const LatticeElement &RHS,
+                                      std::index_sequence<Indices...>) {
+    return { std::get<Indices>(LHS).combine(std::get<Indices>(RHS))... };
+  }
+
+  template<size_t... Indices>
+  static bool isLessOrEqual(const LatticeElement &LHS,
+                            const LatticeElement &RHS,
+                            std::index_sequence<Indices...>) {
+    return (std::get<Indices>(LHS).isLessOrEqual(std::get<Indices>(RHS))
+            and ...);
+  }
+};
+
+/// \brief Collects the OutValue of each basic block from the result of MFP
+template<typename LatticeElement>
+llvm::SmallVector<const LatticeElement *, 16>
+getOutValues(const std::map<const llvm::BasicBlock *,
+                            MFP::MFPResult<LatticeElement>> &Results) {
+  llvm::SmallVector<const LatticeElement *, 16> OutValues;
+  for (auto &[BB, Result] : Results)
+    OutValues.push_back(&Result.OutValue);
+  return OutValues;
+}
+
+/// \brief Collects the OutValue of the Index-th analysis of a FusedMFIAnalysis
+template<size_t Index, typename... Elements>
+llvm::SmallVector<const std::tuple_element_t<Index, std::tuple<Elements...>> *,
+                  16>
+getOutValues(const std::map<const llvm::BasicBlock *,
+                            MFP::MFPResult<std::tuple<Elements...>>> &Results) {
+  using Element = std::tuple_element_t<Index, std::tuple<Elements...>>;
+  llvm::SmallVector<const Element *, 16> OutValues;
+  for (auto &[BB, Result] : Results)
+    OutValues.push_back(&std::get<Index>(Result.OutValue));
+  return OutValues;
+}
+
 } // namespace ABIAnalyses
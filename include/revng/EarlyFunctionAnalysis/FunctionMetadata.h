@@ -4,6 +4,9 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+
 #include "revng/EarlyFunctionAnalysis/BasicBlock.h"
 #include "revng/Model/VerifyHelper.h"
 #include "revng/Support/MetaAddress.h"
@@ -45,3 +48,41 @@ public:
 };
 
 #include "revng/EarlyFunctionAnalysis/Generated/Late/FunctionMetadata.h"
+
+namespace efa {
+
+/// \brief Verify all of \p ToVerify against \p Binary, using multiple threads
+///
+/// The number of threads is controlled by the `-efa-verify-jobs` option.
+bool verifyFunctionsMetadata(const model::Binary &Binary,
+                             llvm::ArrayRef<const FunctionMetadata *> ToVerify,
+                             model::VerifyHelper &VH);
+
+/// \brief Verifies FunctionMetadata, skipping the ones already verified
+///
+/// The hash of the serialized form of each FunctionMetadata successfully
+/// verified is recorded: verifying again a FunctionMetadata of the same
+/// function with the same content does nothing.
+///
+/// \note the results depend on \p Binary too: call invalidate() upon changes.
+class FunctionMetadataVerifier {
+private:
+  const model::Binary &Binary;
+  llvm::DenseMap<MetaAddress, uint64_t> VerifiedHashes;
+
+public:
+  FunctionMetadataVerifier(const model::Binary &Binary) : Binary(Binary) {}
+
+public:
+  bool verify(llvm::ArrayRef<const FunctionMetadata *> ToVerify,
+              model::VerifyHelper &VH);
+  bool verify(llvm::ArrayRef<const FunctionMetadata *> ToVerify,
+              bool Assert = false) {
+    model::VerifyHelper VH(Assert);
+    return verify(ToVerify, VH);
+  }
+
+  void invalidate() { VerifiedHashes.clear(); }
+};
+
+} // namespace efa
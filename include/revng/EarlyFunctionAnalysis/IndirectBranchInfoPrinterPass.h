@@ -6,12 +6,14 @@
 
 #include "llvm/IR/PassManager.h"
 
+#include "revng/Support/SharedOutputFile.h"
+
 class IndirectBranchInfoPrinterPass
   : public llvm::PassInfoMixin<IndirectBranchInfoPrinterPass> {
-  llvm::raw_fd_ostream &OS;
+  BufferedOutputStream &OS;
 
 public:
-  IndirectBranchInfoPrinterPass(llvm::raw_fd_ostream &OS) : OS(OS){};
+  IndirectBranchInfoPrinterPass(BufferedOutputStream &OS) : OS(OS){};
 
   llvm::PreservedAnalyses
   run(llvm::Function &F, llvm::FunctionAnalysisManager &FAM);
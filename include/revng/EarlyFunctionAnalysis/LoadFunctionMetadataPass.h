@@ -4,14 +4,27 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <memory>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/Metadata.h"
 #include "llvm/Pass.h"
 
+#include "revng/EarlyFunctionAnalysis/FunctionMetadata.h"
+
+/// \brief Provides the efa::FunctionMetadata of isolated functions
+///
+/// Parsed metadata is memoized and shared by all the passes requiring this
+/// one. Results are indexed by the MDString holding the serialized metadata:
+/// MDStrings are uniqued and never freed, therefore a function whose metadata
+/// has been replaced will simply miss the cache.
 class LoadFunctionMetadataPass : public llvm::ModulePass {
 public:
   const efa::FunctionMetadata &get(llvm::Function *F);
 
 private:
-  std::map<MetaAddress, efa::FunctionMetadata> EntryToMetadata;
+  using MetadataPointer = std::unique_ptr<efa::FunctionMetadata>;
+  llvm::DenseMap<const llvm::MDString *, MetadataPointer> Cache;
 
 public:
   static char ID;
@@ -24,4 +37,6 @@ public:
   }
 
   bool runOnModule(llvm::Module &M) override;
+
+  void releaseMemory() override { Cache.clear(); }
 };
@@ -4,13 +4,19 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <set>
+#include <vector>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
 #include "llvm/Pass.h"
 #include "llvm/Support/Casting.h"
 
-#include "revng/BasicAnalyses/CustomCFG.h"
+#include "revng/BasicAnalyses/CompactCFG.h"
 #include "revng/BasicAnalyses/GeneratedCodeBasicInfo.h"
 #include "revng/Support/IRHelpers.h"
 
@@ -51,11 +57,48 @@ public:
     return isFallthrough(I->getParent());
   }
 
+  /// \brief The CFG of root restricted to translated basic blocks, where
+  ///        function calls proceed towards the fallthrough basic block and
+  ///        returns have no successors
+  const CompactCFG &getFilteredCFG() const { return FilteredCFG; }
+
+  /// \brief The translated basic blocks ending with a jump that might be a
+  ///        return, i.e., a jump with multiple successors, one of which might
+  ///        lead to unexpectedpc
+  ///
+  /// This is a superset of the jumps PruneRetSuccessors is interested in,
+  /// collected while looking for function calls.
+  llvm::ArrayRef<llvm::BasicBlock *> getReturnCandidates() const {
+    return ReturnCandidates;
+  }
+
 private:
   void buildFilteredCFG(llvm::Function &F);
 
 private:
   llvm::Function *FunctionCall;
   std::set<MetaAddress> FallthroughAddresses;
-  CustomCFG FilteredCFG;
+  CompactCFG FilteredCFG;
+  std::vector<llvm::BasicBlock *> ReturnCandidates;
 };
+
+/// \brief Collect the calls to the `function_call` marker in \p F, i.e., the
+///        function calls identified by FunctionCallIdentification
+///
+/// The marker is looked up by name, so that the function calls can be
+/// inspected without running FunctionCallIdentification again.
+inline llvm::SmallVector<llvm::CallInst *, 16>
+getFunctionCallMarkers(llvm::Function &F) {
+  llvm::SmallVector<llvm::CallInst *, 16> Result;
+
+  llvm::Function *FunctionCall = F.getParent()->getFunction("function_call");
+  if (FunctionCall == nullptr)
+    return Result;
+
+  for (llvm::User *U : FunctionCall->users())
+    if (auto *Call = llvm::dyn_cast<llvm::CallInst>(U))
+      if (Call->getFunction() == &F)
+        Result.push_back(Call);
+
+  return Result;
+}
@@ -21,3 +21,25 @@ public:
     AU.addRequired<GeneratedCodeBasicInfoWrapperPass>();
   }
 };
+
+/// \brief Promote the CSVs accessed by the translated code of the root function
+///
+/// Within the translated code, CSVs are accessed through allocas, so that they
+/// can be promoted to SSA values. The globals are updated only when control
+/// leaves the translated code (i.e., on edges towards the dispatcher-related
+/// basic blocks) and around calls. For calls to helpers, only the CSVs that
+/// CPUStateAccessAnalysis reported as read or written by the call site are
+/// spilled and reloaded.
+class PromoteCSVsInRootPass : public llvm::ModulePass {
+public:
+  static char ID;
+
+public:
+  PromoteCSVsInRootPass() : ModulePass(ID) {}
+
+  bool runOnModule(llvm::Module &M) override;
+
+  void getAnalysisUsage(llvm::AnalysisUsage &AU) const override {
+    AU.addRequired<GeneratedCodeBasicInfoWrapperPass>();
+  }
+};
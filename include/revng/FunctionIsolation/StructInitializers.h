@@ -8,6 +8,12 @@
 
 #include "revng/Support/OpaqueFunctionsPool.h"
 
+/// \brief Pool of the functions initializing a struct from its fields
+///
+/// The initializers are tagged as FunctionTags::StructInitializer and never
+/// removed from the module: the module itself is a persistent cache, and all
+/// the instances of this class, even in different passes, reuse the existing
+/// initializers.
 class StructInitializers {
 private:
   OpaqueFunctionsPool<llvm::StructType *> Pool;
@@ -4,21 +4,25 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
-#include <compare>
 #include <cstddef>
+#include <functional>
 #include <map>
 #include <queue>
 #include <type_traits>
+#include <vector>
 
+#include "llvm/ADT/BitVector.h"
 #include "llvm/ADT/GraphTraits.h"
 #include "llvm/ADT/PostOrderIterator.h"
 #include "llvm/ADT/SmallSet.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/iterator_range.h"
 #include "llvm/Support/raw_ostream.h"
 
 #include "revng/ADT/Concepts.h"
 #include "revng/ADT/GenericGraph.h"
 #include "revng/ADT/ReversePostOrderTraversal.h"
+#include "revng/Support/Assert.h"
 
 namespace MFP {
 
@@ -53,79 +57,196 @@ concept MonotoneFrameworkInstance = requires(const MFI &I,
   // clang-format on
 };
 
-/// Compute the maximum fixed points of an instance of monotone framework GT an
-/// instance of llvm::GraphTraits that tells us how to visit the graph LGT a
-/// graph type that tells us how to visit the subgraph induced by a node in the
-/// graph. This is needed for the RPOT because for certain graph (e.g.
-/// Inverse<...>) the nodes don't necessary carry all the information that
-/// GraphType has.
-template<MonotoneFrameworkInstance MFI,
-         typename GT = llvm::GraphTraits<typename MFI::GraphType>,
-         typename LGT = typename MFI::Label>
-std::map<typename MFI::Label, MFPResult<typename MFI::LatticeElement>>
-getMaximalFixedPoint(const MFI &Instance,
-                     const typename MFI::GraphType &Flow,
-                     typename MFI::LatticeElement InitialValue,
-                     typename MFI::LatticeElement ExtremalValue,
-                     const std::vector<typename MFI::Label> &ExtremalLabels,
-                     const std::vector<typename MFI::Label> &InitialNodes) {
-  using Label = typename MFI::Label;
-  using LatticeElement = typename MFI::LatticeElement;
+/// \brief The results of getIndexedMaximalFixedPoint
+///
+/// Labels are numbered in reverse post order, Results[I] is the result for
+/// Labels[I].
+template<typename Label, typename LatticeElement>
+struct IndexedMFPResults {
+  std::vector<Label> Labels;
+  std::vector<MFPResult<LatticeElement>> Results;
 
-  std::map<Label, LatticeElement> PartialAnalysis;
-  std::map<Label, MFPResult<LatticeElement>> AnalysisResult;
+  /// \return a map from each label to its result
+  std::map<Label, MFPResult<LatticeElement>> toMap() && {
+    std::map<Label, MFPResult<LatticeElement>> Map;
+    for (size_t I = 0; I < Labels.size(); ++I)
+      Map.emplace(Labels[I], std::move(Results[I]));
+    return Map;
+  }
+};
 
-  struct WorklistItem {
-    size_t Priority;
-    Label Item;
+/// \brief Numbering of the labels of a graph, shared by the analyses on it
+///
+/// The labels reachable from the initial nodes are numbered in reverse post
+/// order, launching a visit from each initial node that hasn't been visited
+/// yet. The extremal labels that are not reachable follow: they're not
+/// analyzed, but they're part of the results.
+///
+/// The numbering only depends on the graph, hence it can be computed once and
+/// passed to all the analyses starting from the same nodes, as long as the
+/// graph does not change.
+template<typename Label>
+class LabelNumbering {
+public:
+  /// The labels, in order
+  std::vector<Label> Labels;
 
-    // NOLINTNEXTLINE(readability-identifier-naming)
-    std::strong_ordering operator<=>(const WorklistItem &) const = default;
-  };
-  std::set<WorklistItem> Worklist;
+  /// Labels[0, VisitedCount) are the labels reachable from the initial nodes
+  size_t VisitedCount = 0;
 
-  llvm::SmallSet<Label, 8> Visited{};
-  std::map<Label, size_t> LabelPriority;
+  /// Successors[I] are the numbers of the successors of Labels[I]
+  std::vector<llvm::SmallVector<size_t, 2>> Successors;
 
-  // Step 1 initialize the worklist and extremal labels
-  for (Label ExtremalLabel : ExtremalLabels) {
-    AnalysisResult[ExtremalLabel].InValue = ExtremalValue;
-  }
+  /// The labels that are the target of a retreating edge, i.e., an edge
+  /// toward a label with a lower or equal number
+  llvm::BitVector LoopHeaders;
 
-  for (Label Start : InitialNodes) {
-    if (Visited.count(Start) == 0) {
-      // Fill the worklist with nodes in reverse post order
-      // lauching a visit from each remaining node
-      ReversePostOrderTraversalExt<LGT,
-                                   llvm::GraphTraits<LGT>,
-                                   llvm::SmallSet<Label, 8>>
-        RPOTE(Start, Visited);
-      for (Label Node : RPOTE) {
-        LabelPriority[Node] = LabelPriority.size();
-        Worklist.insert({ LabelPriority.at(Node), Node });
-        // initialize the analysis value for non extremal nodes
-        if (AnalysisResult.find(Node) == AnalysisResult.end()) {
-          AnalysisResult[Node].InValue = InitialValue;
+private:
+  std::map<Label, size_t> Index;
+
+public:
+  /// GT and LGT have the same meaning as in getIndexedMaximalFixedPoint
+  template<typename GT, typename LGT = Label>
+  static LabelNumbering compute(const std::vector<Label> &InitialNodes,
+                                const std::vector<Label> &ExtremalLabels) {
+    LabelNumbering Result;
+    std::vector<Label> &Labels = Result.Labels;
+
+    llvm::SmallSet<Label, 8> Visited{};
+    for (Label Start : InitialNodes) {
+      if (Visited.count(Start) == 0) {
+        ReversePostOrderTraversalExt<LGT,
+                                     llvm::GraphTraits<LGT>,
+                                     llvm::SmallSet<Label, 8>>
+          RPOTE(Start, Visited);
+        for (Label Node : RPOTE) {
+          Result.Index[Node] = Labels.size();
+          Labels.push_back(Node);
         }
       }
     }
+    Result.VisitedCount = Labels.size();
+
+    for (Label ExtremalLabel : ExtremalLabels) {
+      if (Result.Index.count(ExtremalLabel) == 0) {
+        Result.Index[ExtremalLabel] = Labels.size();
+        Labels.push_back(ExtremalLabel);
+      }
+    }
+
+    Result.Successors.resize(Result.VisitedCount);
+    Result.LoopHeaders.resize(Result.VisitedCount);
+    for (size_t I = 0; I < Result.VisitedCount; ++I) {
+      for (Label End : successors<GT>(Labels[I])) {
+        size_t EndIndex = Result.indexOf(End);
+        revng_assert(EndIndex < Result.VisitedCount);
+        Result.Successors[I].push_back(EndIndex);
+        if (EndIndex <= I)
+          Result.LoopHeaders.set(EndIndex);
+      }
+    }
+
+    return Result;
+  }
+
+public:
+  size_t size() const { return Labels.size(); }
+
+  bool contains(Label L) const { return Index.count(L) != 0; }
+
+  size_t indexOf(Label L) const {
+    auto It = Index.find(L);
+    revng_assert(It != Index.end());
+    return It->second;
+  }
+};
+
+/// \brief Caches the numbering of the labels reachable from a single label
+///
+/// This is the common case of analyses having a single extremal label, which is
+/// also where the visit starts. The cache has to be invalidated, or dropped,
+/// whenever the graph changes.
+template<typename GT, typename LGT = typename GT::NodeRef>
+class LabelNumberingCache {
+public:
+  using Label = typename GT::NodeRef;
+
+private:
+  std::map<Label, LabelNumbering<Label>> Numberings;
+
+public:
+  const LabelNumbering<Label> &get(Label Start) {
+    auto It = Numberings.find(Start);
+    if (It == Numberings.end()) {
+      using Numbering = LabelNumbering<Label>;
+      auto Result = Numbering::template compute<GT, LGT>({ Start }, { Start });
+      It = Numberings.emplace(Start, std::move(Result)).first;
+    }
+    return It->second;
   }
 
+  void invalidate() { Numberings.clear(); }
+};
+
+/// Compute the maximum fixed points of an instance of monotone framework on
+/// labels that have already been numbered (see LabelNumbering).
+///
+/// The partial results, the successors and the worklist are stored in flat
+/// vectors indexed by the label number. The extremal labels have to be part of
+/// the numbering.
+template<MonotoneFrameworkInstance MFI>
+IndexedMFPResults<typename MFI::Label, typename MFI::LatticeElement>
+getIndexedMaximalFixedPoint(const MFI &Instance,
+                            const LabelNumbering<typename MFI::Label>
+                              &Numbering,
+                            typename MFI::LatticeElement InitialValue,
+                            typename MFI::LatticeElement ExtremalValue,
+                            const std::vector<typename MFI::Label>
+                              &ExtremalLabels) {
+  using Label = typename MFI::Label;
+  using LatticeElement = typename MFI::LatticeElement;
+
+  IndexedMFPResults<Label, LatticeElement> AnalysisResult;
+  AnalysisResult.Labels = Numbering.Labels;
+  const std::vector<Label> &Labels = AnalysisResult.Labels;
+  auto &Results = AnalysisResult.Results;
+  size_t VisitedCount = Numbering.VisitedCount;
+
+  // Step 1 initialize the analysis values
+  Results.resize(Labels.size());
+  for (size_t I = 0; I < VisitedCount; ++I)
+    Results[I].InValue = InitialValue;
+  for (Label ExtremalLabel : ExtremalLabels)
+    Results[Numbering.indexOf(ExtremalLabel)].InValue = ExtremalValue;
+
+  // Fill the worklist with all the visited nodes, the node with the lowest
+  // number is always processed first
+  std::priority_queue<size_t, std::vector<size_t>, std::greater<size_t>>
+    Worklist;
+  std::vector<bool> InWorklist(VisitedCount, true);
+  for (size_t I = 0; I < VisitedCount; ++I)
+    Worklist.push(I);
+
   // Step 2 iteration
   while (!Worklist.empty()) {
-    WorklistItem First = *Worklist.begin();
-    Label Start = First.Item;
-    Worklist.erase(First);
-    auto &LabelAnalysis = AnalysisResult.at(Start);
-    LabelAnalysis
-      .OutValue = Instance.applyTransferFunction(Start, LabelAnalysis.InValue);
-
-    for (Label End : successors<GT>(Start)) {
-      auto &PartialEnd = AnalysisResult.at(End);
+    size_t Start = Worklist.top();
+    Worklist.pop();
+    InWorklist[Start] = false;
+
+    auto &LabelAnalysis = Results[Start];
+    LabelAnalysis.OutValue = Instance.applyTransferFunction(Labels[Start],
+                                                            LabelAnalysis
+                                                              .InValue);
+
+    for (size_t End : Numbering.Successors[Start]) {
+      auto &PartialEnd = Results[End];
       if (!Instance.isLessOrEqual(LabelAnalysis.OutValue, PartialEnd.InValue)) {
         PartialEnd.InValue = Instance.combineValues(PartialEnd.InValue,
                                                     LabelAnalysis.OutValue);
-        Worklist.insert({ LabelPriority.at(End), End });
+        if (!InWorklist[End]) {
+          InWorklist[End] = true;
+          Worklist.push(End);
+        }
       }
     }
   }
@@ -133,6 +254,75 @@ getMaximalFixedPoint(const MFI &Instance,
   return AnalysisResult;
 }
 
+/// Compute the maximum fixed points of an instance of monotone framework GT an
+/// instance of llvm::GraphTraits that tells us how to visit the graph LGT a
+/// graph type that tells us how to visit the subgraph induced by a node in the
+/// graph. This is needed for the RPOT because for certain graph (e.g.
+/// Inverse<...>) the nodes don't necessary carry all the information that
+/// GraphType has.
+///
+/// Labels are numbered in reverse post order before starting, see
+/// LabelNumbering. Analyses running on the same graph should compute the
+/// numbering once and use the overload taking it.
+template<MonotoneFrameworkInstance MFI,
+         typename GT = llvm::GraphTraits<typename MFI::GraphType>,
+         typename LGT = typename MFI::Label>
+IndexedMFPResults<typename MFI::Label, typename MFI::LatticeElement>
+getIndexedMaximalFixedPoint(const MFI &Instance,
+                            const typename MFI::GraphType &Flow,
+                            typename MFI::LatticeElement InitialValue,
+                            typename MFI::LatticeElement ExtremalValue,
+                            const std::vector<typename MFI::Label>
+                              &ExtremalLabels,
+                            const std::vector<typename MFI::Label>
+                              &InitialNodes) {
+  using Numbering = LabelNumbering<typename MFI::Label>;
+  auto Labels = Numbering::template compute<GT, LGT>(InitialNodes,
+                                                     ExtremalLabels);
+  return getIndexedMaximalFixedPoint(Instance,
+                                     Labels,
+                                     InitialValue,
+                                     ExtremalValue,
+                                     ExtremalLabels);
+}
+
+/// \brief Same as getIndexedMaximalFixedPoint, but the results are a map
+template<MonotoneFrameworkInstance MFI,
+         typename GT = llvm::GraphTraits<typename MFI::GraphType>,
+         typename LGT = typename MFI::Label>
+std::map<typename MFI::Label, MFPResult<typename MFI::LatticeElement>>
+getMaximalFixedPoint(const MFI &Instance,
+                     const typename MFI::GraphType &Flow,
+                     typename MFI::LatticeElement InitialValue,
+                     typename MFI::LatticeElement ExtremalValue,
+                     const std::vector<typename MFI::Label> &ExtremalLabels,
+                     const std::vector<typename MFI::Label> &InitialNodes) {
+  return getIndexedMaximalFixedPoint<MFI, GT, LGT>(Instance,
+                                                   Flow,
+                                                   InitialValue,
+                                                   ExtremalValue,
+                                                   ExtremalLabels,
+                                                   InitialNodes)
+    .toMap();
+}
+
+/// \brief Same as getIndexedMaximalFixedPoint on numbered labels, but the
+///        results are a map
+template<MonotoneFrameworkInstance MFI>
+std::map<typename MFI::Label, MFPResult<typename MFI::LatticeElement>>
+getMaximalFixedPoint(const MFI &Instance,
+                     const LabelNumbering<typename MFI::Label> &Numbering,
+                     typename MFI::LatticeElement InitialValue,
+                     typename MFI::LatticeElement ExtremalValue,
+                     const std::vector<typename MFI::Label> &ExtremalLabels) {
+  return getIndexedMaximalFixedPoint(Instance,
+                                     Numbering,
+                                     InitialValue,
+                                     ExtremalValue,
+                                     ExtremalLabels)
+    .toMap();
+}
+
 template<MonotoneFrameworkInstance MFI,
          typename GT = llvm::GraphTraits<typename MFI::GraphType>,
          typename LGT = typename MFI::Label>
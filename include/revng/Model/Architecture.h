@@ -4,6 +4,8 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/Triple.h"
 
 /* TUPLE-TREE-YAML
@@ -346,6 +348,26 @@ inline llvm::StringRef getQEMUName(Values V) {
   }
 }
 
+/// \brief Names of the CSVs holding the condition flags (or the operands from
+///        which QEMU lazily computes them)
+inline llvm::SmallVector<llvm::StringRef, 4> getFlagsCSVNames(Values V) {
+  switch (V) {
+  case model::Architecture::x86_64:
+  case model::Architecture::x86:
+    return { "cc_op", "cc_src", "cc_dst", "cc_src2" };
+  case model::Architecture::systemz:
+    return { "cc_op", "cc_src", "cc_dst", "cc_vr" };
+  case model::Architecture::arm:
+  case model::Architecture::aarch64:
+    return { "NF", "ZF", "CF", "VF" };
+  case model::Architecture::mips:
+  case model::Architecture::mipsel:
+    return {};
+  default:
+    revng_abort();
+  }
+}
+
 inline unsigned getMinimalFinalStackOffset(Values V) {
   switch (V) {
   case model::Architecture::x86_64:
@@ -4,6 +4,8 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <array>
+
 #include "llvm/ADT/SmallString.h"
 
 #include "revng/ADT/MutableSet.h"
@@ -23,6 +25,9 @@
 #include "revng/Support/YAMLTraits.h"
 #include "revng/TupleTree/TupleTree.h"
 
+template<typename T>
+struct TupleTreeDiff;
+
 /* TUPLE-TREE-YAML
 name: Binary
 doc: Data structure representing the whole binary
@@ -93,19 +98,60 @@ class model::Binary : public model::generated::Binary {
 public:
   using generated::Binary::Binary;
 
-public:
-  model::TypePath getTypePath(const model::Type *T) {
-    return TypePath::fromString(this,
-                                "/Types/" + getNameFromYAMLScalar(T->key()));
-  }
+private:
+  /// \brief Direct-indexed table of the positions of the primitive types
+  ///
+  /// Entries are indexed by kind and size and are checked against Types before
+  /// being used, therefore insertions and removals never lead to stale
+  /// results. Like the index of SortedVector, it refers to the positions of a
+  /// specific instance: copies start empty.
+  class PrimitiveTypeTable {
+  public:
+    static constexpr size_t MaximumSize = 16;
+
+    struct Entry {
+      size_t Position = 0;
+      Type::Key Key = {};
+      bool Valid = false;
+    };
+
+  private:
+    static constexpr size_t KindsCount = PrimitiveTypeKind::Count;
+    std::array<Entry, KindsCount * (MaximumSize + 1)> Entries;
+
+  public:
+    PrimitiveTypeTable() = default;
+    PrimitiveTypeTable(const PrimitiveTypeTable &) {}
+    PrimitiveTypeTable(PrimitiveTypeTable &&) {}
+    PrimitiveTypeTable &operator=(const PrimitiveTypeTable &) {
+      Entries = {};
+      return *this;
+    }
+    PrimitiveTypeTable &operator=(PrimitiveTypeTable &&) {
+      Entries = {};
+      return *this;
+    }
+
+  public:
+    /// \return the entry for the given primitive type, or nullptr if its size
+    ///         is not tracked.
+    Entry *get(PrimitiveTypeKind::Values Kind, uint8_t ByteSize) {
+      if (ByteSize > MaximumSize)
+        return nullptr;
+      return &Entries[static_cast<size_t>(Kind) * (MaximumSize + 1) + ByteSize];
+    }
+  };
+
+  PrimitiveTypeTable PrimitiveTypePositions;
 
-  model::TypePath getTypePath(const model::Type *T) const {
-    return TypePath::fromString(this,
-                                "/Types/" + getNameFromYAMLScalar(T->key()));
-  }
+public:
+  model::TypePath getTypePath(const model::Type *T);
+  model::TypePath getTypePath(const model::Type *T) const;
 
   model::TypePath recordNewType(UpcastablePointer<Type> &&T);
 
+  /// \note Repeated lookups of the same primitive type are served by a table
+  ///       indexed by kind and size, instead of searching Types.
   model::TypePath
   getPrimitiveType(PrimitiveTypeKind::Values V, uint8_t ByteSize);
 
@@ -120,6 +166,25 @@ public:
   bool verify() const debug_function;
   bool verify(bool Assert) const debug_function;
   bool verify(VerifyHelper &VH) const;
+
+  /// Verifies only the parts of the model that might have been invalidated by
+  /// applying \p Applied: the functions and the types it touched, the types
+  /// and the functions (transitively) referring to them and, in case of
+  /// renamings or additions, the uniqueness of names.
+  ///
+  /// On a model that verified before applying \p Applied, this is equivalent
+  /// to verify(), but it does not re-verify what the change cannot reach.
+  bool verifyChanges(const TupleTreeDiff<model::Binary> &Applied) const;
+  bool verifyChanges(const TupleTreeDiff<model::Binary> &Applied,
+                     bool Assert) const;
+  bool verifyChanges(const TupleTreeDiff<model::Binary> &Applied,
+                     VerifyHelper &VH) const;
+
+private:
+  bool verifyCustomNames(VerifyHelper &VH) const;
+  bool verifyTypeNames(VerifyHelper &VH) const;
+
+public:
   void dump() const debug_function;
   std::string toString() const debug_function;
 };
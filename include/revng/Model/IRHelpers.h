@@ -4,7 +4,9 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
 
 #include "revng/Model/Binary.h"
 #include "revng/Support/Assert.h"
@@ -16,6 +18,27 @@ inline MetaAddress getMetaAddressOfIsolatedFunction(const llvm::Function &F) {
   return getMetaAddressMetadata(&F, FunctionEntryMDNName);
 }
 
+/// \brief Map the entry address of each isolated function in \p M to the
+///        function itself
+///
+/// Unlike looking up isolated functions by name, this requires no string
+/// formatting nor symbol table lookups: build it once and reuse it.
+inline llvm::DenseMap<MetaAddress, llvm::Function *>
+indexIsolatedFunctions(llvm::Module &M) {
+  llvm::DenseMap<MetaAddress, llvm::Function *> Result;
+  for (llvm::Function &F : M) {
+    if (not FunctionTags::Isolated.isTagOf(&F))
+      continue;
+
+    MetaAddress Entry = getMetaAddressOfIsolatedFunction(F);
+    revng_assert(Entry.isValid());
+    auto [_, New] = Result.try_emplace(Entry, &F);
+    revng_assert(New);
+  }
+
+  return Result;
+}
+
 inline model::Function *
 llvmToModelFunction(model::Binary &Binary, const llvm::Function &F) {
   auto MaybeMetaAddress = getMetaAddressMetadata(&F, FunctionEntryMDNName);
@@ -4,10 +4,16 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <memory>
+
 #include "llvm/Object/Binary.h"
 
 #include "revng/Model/Binary.h"
 
+namespace llvm {
+class DWARFContext;
+} // namespace llvm
+
 class DwarfImporter {
 private:
   TupleTree<model::Binary> &Model;
@@ -35,4 +41,19 @@ public:
 public:
   void import(llvm::StringRef FileName);
   void import(const llvm::object::Binary &TheBinary, llvm::StringRef FileName);
+
+  /// \brief Import debug info previously parsed by parse()
+  void import(const llvm::object::Binary &TheBinary,
+              llvm::StringRef FileName,
+              llvm::DWARFContext *Parsed);
+
+public:
+  /// \brief Parse the debug info of \p TheBinary, without touching any model
+  ///
+  /// This is the bulk of the cost of importing debug info and it only reads
+  /// \p TheBinary, therefore it can run concurrently with other importers.
+  ///
+  /// \return nullptr if \p TheBinary is not an object file.
+  static std::unique_ptr<llvm::DWARFContext>
+  parse(const llvm::object::Binary &TheBinary);
 };
@@ -4,6 +4,8 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <optional>
+#include <string>
 #include <variant>
 
 #include "llvm/IR/PassManager.h"
@@ -16,8 +18,17 @@ extern llvm::cl::opt<std::string> ModelPath;
 
 inline const char *ModelMetadataName = "revng.model";
 
+/// Name of the named metadata holding the path of the file containing the
+/// model, if it's not stored in the module itself. In this case, the named
+/// metadata ModelMetadataName holds an empty tuple.
+inline const char *ModelSidecarMetadataName = "revng.model.sidecar";
+
 TupleTree<model::Binary> loadModel(const llvm::Module &M);
 
+/// \return the path of the file containing the model of \p M, if the model is
+///         not stored in the module itself
+std::optional<std::string> getModelSidecar(const llvm::Module &M);
+
 bool hasModel(const llvm::Module &M);
 
 class ModelWrapper {
@@ -4,10 +4,53 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <optional>
+
 #include "revng/Model/Binary.h"
 
 namespace model {
 
 void verify(TupleTree<model::Binary> &Model);
 
+/// \brief Verifies a model, re-verifying only what changed since the last
+///        successful verification performed by the same instance
+///
+/// A copy of the last model that verified is retained: each time, it's diffed
+/// against the model to verify and only what the diff touches is verified
+/// (see Binary::verifyChanges). The diff is then applied to the copy.
+class IncrementalVerifier {
+private:
+  std::optional<TupleTree<model::Binary>> LastVerified;
+
+public:
+  bool verify(TupleTree<model::Binary> &Model, bool Assert = false);
+
+  /// \brief Forget the last model that verified
+  void reset() { LastVerified.reset(); }
+};
+
+/// \brief Scope in which the verify model pass verifies incrementally
+///
+/// While an instance is alive on the current thread, model::verify re-verifies
+/// only what changed since its previous invocation in the same scope, e.g., in
+/// the same sequence of model passes. Outside of any scope, the whole model is
+/// verified.
+class IncrementalVerificationScope {
+private:
+  IncrementalVerifier Verifier;
+  IncrementalVerificationScope *Previous = nullptr;
+
+public:
+  IncrementalVerificationScope();
+  ~IncrementalVerificationScope();
+
+  IncrementalVerificationScope(const IncrementalVerificationScope &) = delete;
+  IncrementalVerificationScope &
+  operator=(const IncrementalVerificationScope &) = delete;
+
+public:
+  /// \return the verifier of the innermost scope of this thread, if any
+  static IncrementalVerifier *current();
+};
+
 } // namespace model
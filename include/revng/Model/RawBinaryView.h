@@ -4,9 +4,11 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <atomic>
 #include <cstdint>
 #include <optional>
 #include <utility>
+#include <vector>
 
 #include "llvm/ADT/ArrayRef.h"
 
@@ -15,20 +17,48 @@
 #include "revng/Support/OverflowSafeInt.h"
 
 /// Provide a view onto a raw binary through the lens of the model
+///
+/// Address lookups go through an index of the segments sorted by address,
+/// which is rebuilt upon the first lookup after segments are added to or
+/// removed from the model. The segments must not change while the view is
+/// being used by more than one thread.
 class RawBinaryView {
 private:
   using OverflowSafeInt = OverflowSafeInt<uint64_t>;
 
+  /// A segment in the index of the segments, sorted by start address
+  struct IndexEntry {
+    uint64_t Start = 0;
+    /// The highest end address of this segment and of the ones before it
+    uint64_t MaxEnd = 0;
+    const model::Segment *Segment = nullptr;
+    /// Whether any other segment overlaps this one
+    bool Overlaps = false;
+  };
+
 private:
   const model::Binary &Binary;
   llvm::ArrayRef<uint8_t> Data;
 
+  /// The mutations of the segments at the time the index has been built
+  mutable uint64_t IndexedMutations = 0;
+  mutable std::vector<IndexEntry> Index;
+
+  /// The position in Index of the last segment found by an address lookup,
+  /// since subsequent lookups tend to hit the same segment
+  mutable std::atomic<size_t> LastHit = 0;
+
 public:
   RawBinaryView(const model::Binary &Binary, llvm::StringRef Data) :
     RawBinaryView(Binary, { Data.bytes_begin(), Data.bytes_end() }) {}
 
   RawBinaryView(const model::Binary &Binary, llvm::ArrayRef<uint8_t> Data) :
-    Binary(Binary), Data(Data) {}
+    Binary(Binary), Data(Data) {
+    rebuildIndex();
+  }
+
+  RawBinaryView(const RawBinaryView &) = delete;
+  RawBinaryView &operator=(const RawBinaryView &) = delete;
 
 public:
   uint64_t size() { return Data.size(); }
@@ -157,20 +187,7 @@ public:
 private:
   std::pair<const model::Segment *, uint64_t>
   findOffsetInSegment(MetaAddress Address, uint64_t Size) const {
-    const model::Segment *Match = nullptr;
-    for (const model::Segment &Segment : Binary.Segments) {
-      if (Segment.contains(Address, Size)) {
-
-        if (Match != nullptr) {
-          // We have more than one match!
-          Match = nullptr;
-          break;
-        }
-
-        Match = &Segment;
-      }
-    }
-
+    const model::Segment *Match = findSegment(Address, Size);
     if (Match != nullptr) {
       auto Offset = OverflowSafeInt(Address.address())
                     - Match->StartAddress.address();
@@ -180,4 +197,23 @@ private:
 
     return { nullptr, 0 };
   }
+
+  /// \return the only segment containing \p Size bytes starting at \p
+  ///         Address, or nullptr if there are none or more than one
+  const model::Segment *findSegment(MetaAddress Address, uint64_t Size) const {
+    if (Binary.Segments.mutations() != IndexedMutations)
+      rebuildIndex();
+
+    // A segment overlapping no other one is the only match, if it's a match
+    size_t Last = LastHit.load(std::memory_order_relaxed);
+    if (Last < Index.size() and not Index[Last].Overlaps
+        and Index[Last].Segment->contains(Address, Size))
+      return Index[Last].Segment;
+
+    return lookupSegment(Address, Size);
+  }
+
+  const model::Segment *lookupSegment(MetaAddress Address,
+                                      uint64_t Size) const;
+  void rebuildIndex() const;
 };
@@ -4,6 +4,10 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <array>
+#include <iterator>
+
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/Triple.h"
 
@@ -12,7 +16,6 @@
 #include "revng/Model/Architecture.h"
 #include "revng/Support/Assert.h"
 #include "revng/Support/EnumSwitch.h"
-#include "revng/Support/Generator.h"
 #include "revng/Support/YAMLTraits.h"
 
 /* TUPLE-TREE-YAML
@@ -252,268 +255,6 @@ TUPLE-TREE-YAML */
 
 namespace model::Register {
 
-constexpr inline model::Architecture::Values getArchitecture(Values V) {
-  switch (V) {
-  case eax_x86:
-  case ebx_x86:
-  case ecx_x86:
-  case edx_x86:
-  case esi_x86:
-  case edi_x86:
-  case ebp_x86:
-  case esp_x86:
-  case xmm0_x86:
-  case xmm1_x86:
-  case xmm2_x86:
-  case xmm3_x86:
-  case xmm4_x86:
-  case xmm5_x86:
-  case xmm6_x86:
-  case xmm7_x86:
-    return model::Architecture::x86;
-  case rax_x86_64:
-  case rbx_x86_64:
-  case rcx_x86_64:
-  case rdx_x86_64:
-  case rbp_x86_64:
-  case rsp_x86_64:
-  case rsi_x86_64:
-  case rdi_x86_64:
-  case r8_x86_64:
-  case r9_x86_64:
-  case r10_x86_64:
-  case r11_x86_64:
-  case r12_x86_64:
-  case r13_x86_64:
-  case r14_x86_64:
-  case r15_x86_64:
-  case xmm0_x86_64:
-  case xmm1_x86_64:
-  case xmm2_x86_64:
-  case xmm3_x86_64:
-  case xmm4_x86_64:
-  case xmm5_x86_64:
-  case xmm6_x86_64:
-  case xmm7_x86_64:
-  case fs_x86_64:
-    return model::Architecture::x86_64;
-  case r0_arm:
-  case r1_arm:
-  case r2_arm:
-  case r3_arm:
-  case r4_arm:
-  case r5_arm:
-  case r6_arm:
-  case r7_arm:
-  case r8_arm:
-  case r9_arm:
-  case r10_arm:
-  case r11_arm:
-  case r12_arm:
-  case r13_arm:
-  case r14_arm:
-  case r15_arm:
-  case q0_arm:
-  case q1_arm:
-  case q2_arm:
-  case q3_arm:
-  case q4_arm:
-  case q5_arm:
-  case q6_arm:
-  case q7_arm:
-    return model::Architecture::arm;
-  case x0_aarch64:
-  case x1_aarch64:
-  case x2_aarch64:
-  case x3_aarch64:
-  case x4_aarch64:
-  case x5_aarch64:
-  case x6_aarch64:
-  case x7_aarch64:
-  case x8_aarch64:
-  case x9_aarch64:
-  case x10_aarch64:
-  case x11_aarch64:
-  case x12_aarch64:
-  case x13_aarch64:
-  case x14_aarch64:
-  case x15_aarch64:
-  case x16_aarch64:
-  case x17_aarch64:
-  case x18_aarch64:
-  case x19_aarch64:
-  case x20_aarch64:
-  case x21_aarch64:
-  case x22_aarch64:
-  case x23_aarch64:
-  case x24_aarch64:
-  case x25_aarch64:
-  case x26_aarch64:
-  case x27_aarch64:
-  case x28_aarch64:
-  case x29_aarch64:
-  case lr_aarch64:
-  case sp_aarch64:
-  case v0_aarch64:
-  case v1_aarch64:
-  case v2_aarch64:
-  case v3_aarch64:
-  case v4_aarch64:
-  case v5_aarch64:
-  case v6_aarch64:
-  case v7_aarch64:
-  case v8_aarch64:
-  case v9_aarch64:
-  case v10_aarch64:
-  case v11_aarch64:
-  case v12_aarch64:
-  case v13_aarch64:
-  case v14_aarch64:
-  case v15_aarch64:
-  case v16_aarch64:
-  case v17_aarch64:
-  case v18_aarch64:
-  case v19_aarch64:
-  case v20_aarch64:
-  case v21_aarch64:
-  case v22_aarch64:
-  case v23_aarch64:
-  case v24_aarch64:
-  case v25_aarch64:
-  case v26_aarch64:
-  case v27_aarch64:
-  case v28_aarch64:
-  case v29_aarch64:
-  case v30_aarch64:
-  case v31_aarch64:
-    return model::Architecture::aarch64;
-  case v0_mips:
-  case v1_mips:
-  case a0_mips:
-  case a1_mips:
-  case a2_mips:
-  case a3_mips:
-  case s0_mips:
-  case s1_mips:
-  case s2_mips:
-  case s3_mips:
-  case s4_mips:
-  case s5_mips:
-  case s6_mips:
-  case s7_mips:
-  case t0_mips:
-  case t1_mips:
-  case t2_mips:
-  case t3_mips:
-  case t4_mips:
-  case t5_mips:
-  case t6_mips:
-  case t7_mips:
-  case t8_mips:
-  case t9_mips:
-  case gp_mips:
-  case sp_mips:
-  case fp_mips:
-  case ra_mips:
-  case f0_mips:
-  case f1_mips:
-  case f2_mips:
-  case f3_mips:
-  case f4_mips:
-  case f5_mips:
-  case f6_mips:
-  case f7_mips:
-  case f8_mips:
-  case f9_mips:
-  case f10_mips:
-  case f11_mips:
-  case f12_mips:
-  case f13_mips:
-  case f14_mips:
-  case f15_mips:
-  case f16_mips:
-  case f17_mips:
-  case f18_mips:
-  case f19_mips:
-  case f20_mips:
-  case f21_mips:
-  case f22_mips:
-  case f23_mips:
-  case f24_mips:
-  case f25_mips:
-  case f26_mips:
-  case f27_mips:
-  case f28_mips:
-  case f29_mips:
-  case f30_mips:
-  case f31_mips:
-    return model::Architecture::mips;
-  case r0_systemz:
-  case r1_systemz:
-  case r2_systemz:
-  case r3_systemz:
-  case r4_systemz:
-  case r5_systemz:
-  case r6_systemz:
-  case r7_systemz:
-  case r8_systemz:
-  case r9_systemz:
-  case r10_systemz:
-  case r11_systemz:
-  case r12_systemz:
-  case r13_systemz:
-  case r14_systemz:
-  case r15_systemz:
-  case f0_systemz:
-  case f1_systemz:
-  case f2_systemz:
-  case f3_systemz:
-  case f4_systemz:
-  case f5_systemz:
-  case f6_systemz:
-  case f7_systemz:
-  case f8_systemz:
-  case f9_systemz:
-  case f10_systemz:
-  case f11_systemz:
-  case f12_systemz:
-  case f13_systemz:
-  case f14_systemz:
-  case f15_systemz:
-    return model::Architecture::systemz;
-  case Count:
-  case Invalid:
-  default:
-    revng_abort();
-  }
-}
-
-inline llvm::StringRef getRegisterName(Values V) {
-  llvm::StringRef FullName = getName(V);
-  auto Architecture = getArchitecture(V);
-  revng_assert(Architecture != model::Architecture::Invalid);
-  auto ArchitectureNameSize = model::Architecture::getName(Architecture).size();
-  return FullName.substr(0, FullName.size() - ArchitectureNameSize - 1);
-}
-
-/// Return the size of the register in bytes
-inline size_t getSize(Values V) {
-  model::Architecture::Values Architecture = getArchitecture(V);
-
-  switch (Architecture) {
-  case model::Architecture::x86:
-  case model::Architecture::arm:
-  case model::Architecture::mips:
-    return 4;
-  case model::Architecture::x86_64:
-  case model::Architecture::aarch64:
-  case model::Architecture::systemz:
-    return 8;
-  default:
-    revng_abort();
-  }
-}
-
 template<model::Architecture::Values Architecture>
 constexpr model::Register::Values getFirst() {
   if constexpr (Architecture == model::Architecture::x86)
@@ -561,6 +302,71 @@ constexpr size_t getCount() {
   return getLast<Architecture>() - getFirst<Architecture>() + 1;
 }
 
+// Registers of each architecture are a contiguous span of the enum, and the
+// spans cover it entirely, in order
+static_assert(getFirst<model::Architecture::x86>() == Invalid + 1);
+static_assert(getLast<model::Architecture::x86>() + 1
+              == getFirst<model::Architecture::x86_64>());
+static_assert(getLast<model::Architecture::x86_64>() + 1
+              == getFirst<model::Architecture::arm>());
+static_assert(getLast<model::Architecture::arm>() + 1
+              == getFirst<model::Architecture::aarch64>());
+static_assert(getLast<model::Architecture::aarch64>() + 1
+              == getFirst<model::Architecture::mips>());
+static_assert(getLast<model::Architecture::mips>() + 1
+              == getFirst<model::Architecture::systemz>());
+static_assert(getLast<model::Architecture::systemz>() + 1 == Count);
+
+template<model::Architecture::Values Architecture>
+constexpr bool belongsTo(Values V) {
+  return getFirst<Architecture>() <= V and V <= getLast<Architecture>();
+}
+
+/// \note registers of mipsel are the ones of mips, for them mips is returned
+constexpr inline model::Architecture::Values getArchitecture(Values V) {
+  using namespace model::Architecture;
+  if (belongsTo<x86>(V))
+    return x86;
+  else if (belongsTo<x86_64>(V))
+    return x86_64;
+  else if (belongsTo<arm>(V))
+    return arm;
+  else if (belongsTo<aarch64>(V))
+    return aarch64;
+  else if (belongsTo<mips>(V))
+    return mips;
+  else if (belongsTo<systemz>(V))
+    return systemz;
+  else
+    revng_abort();
+}
+
+inline llvm::StringRef getRegisterName(Values V) {
+  llvm::StringRef FullName = getName(V);
+  auto Architecture = getArchitecture(V);
+  revng_assert(Architecture != model::Architecture::Invalid);
+  auto ArchitectureNameSize = model::Architecture::getName(Architecture).size();
+  return FullName.substr(0, FullName.size() - ArchitectureNameSize - 1);
+}
+
+/// Return the size of the register in bytes
+inline size_t getSize(Values V) {
+  model::Architecture::Values Architecture = getArchitecture(V);
+
+  switch (Architecture) {
+  case model::Architecture::x86:
+  case model::Architecture::arm:
+  case model::Architecture::mips:
+    return 4;
+  case model::Architecture::x86_64:
+  case model::Architecture::aarch64:
+  case model::Architecture::systemz:
+    return 8;
+  default:
+    revng_abort();
+  }
+}
+
 constexpr model::Register::Values
 getFirst(model::Architecture::Values Architecture) {
   return skippingEnumSwitch<1>(Architecture, []<model::Architecture::Values A> {
@@ -581,13 +387,76 @@ constexpr size_t getCount(model::Architecture::Values Architecture) {
   });
 }
 
+/// \brief A contiguous range of registers, iterable without allocating
+class Range {
+public:
+  class iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Values;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const Values *;
+    using reference = Values;
+
+  private:
+    unsigned Index = 0;
+
+  public:
+    constexpr iterator() = default;
+    constexpr explicit iterator(unsigned Index) : Index(Index) {}
+
+  public:
+    constexpr Values operator*() const { return static_cast<Values>(Index); }
+
+    constexpr iterator &operator++() {
+      ++Index;
+      return *this;
+    }
+
+    constexpr iterator operator++(int) {
+      iterator Result = *this;
+      ++Index;
+      return Result;
+    }
+
+    constexpr bool operator==(const iterator &Other) const {
+      return Index == Other.Index;
+    }
+
+    constexpr bool operator!=(const iterator &Other) const {
+      return Index != Other.Index;
+    }
+  };
+
+private:
+  unsigned First = 0;
+  unsigned End = 0;
+
+public:
+  /// \param First the first register of the range.
+  /// \param Last the last register of the range, included.
+  constexpr Range(Values First, Values Last) : First(First), End(Last + 1) {
+    revng_assert(First <= Last);
+  }
+
+public:
+  constexpr iterator begin() const { return iterator(First); }
+  constexpr iterator end() const { return iterator(End); }
+  constexpr size_t size() const { return End - First; }
+};
+
 inline Values fromRegisterName(llvm::StringRef Name,
                                model::Architecture::Values Architecture) {
-  std::string FullName = (llvm::Twine(Name) + "_"
-                          + model::Architecture::getName(Architecture))
-                           .str();
+  if (Architecture == model::Architecture::Invalid)
+    return Invalid;
+
+  for (unsigned I = getFirst(Architecture); I <= getLast(Architecture); ++I) {
+    auto V = static_cast<Values>(I);
+    if (getRegisterName(V) == Name)
+      return V;
+  }
 
-  return fromName(FullName);
+  return Invalid;
 }
 
 inline std::optional<unsigned> getMContextIndex(Values V) {
@@ -657,29 +526,45 @@ inline llvm::StringRef getCSVName(Values V) {
   }
 }
 
-inline Values
-fromCSVName(llvm::StringRef Name, model::Architecture::Values Architecture) {
-  if (Architecture == model::Architecture::x86_64) {
-    if (Name == "state_0x8558") {
-      return xmm0_x86_64;
-    } else if (Name == "state_0x8598") {
-      return xmm1_x86_64;
-    } else if (Name == "state_0x85d8") {
-      return xmm2_x86_64;
-    } else if (Name == "state_0x8618") {
-      return xmm3_x86_64;
-    } else if (Name == "state_0x8658") {
-      return xmm4_x86_64;
-    } else if (Name == "state_0x8698") {
-      return xmm5_x86_64;
-    } else if (Name == "state_0x86d8") {
-      return xmm6_x86_64;
-    } else if (Name == "state_0x8718") {
-      return xmm7_x86_64;
-    }
+namespace detail {
+
+using NamesTable = llvm::StringMap<Values>;
+using NamesTables = std::array<NamesTable, model::Architecture::Count>;
+
+/// \brief Map, for each architecture, the names of the CSVs of its registers
+///        to the registers themselves
+///
+/// Registers are also reachable through their name, as in fromRegisterName.
+inline NamesTables buildCSVNamesTables() {
+  NamesTables Result;
+  for (unsigned I = model::Architecture::Invalid + 1;
+       I < model::Architecture::Count;
+       ++I) {
+    auto Architecture = static_cast<model::Architecture::Values>(I);
+    NamesTable &Table = Result[Architecture];
+
+    for (unsigned J = getFirst(Architecture); J <= getLast(Architecture); ++J)
+      Table.try_emplace(getCSVName(static_cast<Values>(J)),
+                        static_cast<Values>(J));
+
+    // A CSV name takes precedence over a register with the same name
+    for (unsigned J = getFirst(Architecture); J <= getLast(Architecture); ++J)
+      Table.try_emplace(getRegisterName(static_cast<Values>(J)),
+                        static_cast<Values>(J));
   }
 
-  return model::Register::fromRegisterName(Name, Architecture);
+  return Result;
+}
+
+} // namespace detail
+
+/// \note the lookup tables are built upon the first call
+inline Values
+fromCSVName(llvm::StringRef Name, model::Architecture::Values Architecture) {
+  static const detail::NamesTables Tables = detail::buildCSVNamesTables();
+  const detail::NamesTable &Table = Tables[Architecture];
+  auto It = Table.find(Name);
+  return It == Table.end() ? Invalid : It->second;
 }
 
 } // namespace model::Register
@@ -788,14 +673,10 @@ getPCMContextIndex(model::Architecture::Values V) {
   }
 }
 
-inline cppcoro::generator<model::Register::Values> registers(Values V) {
+/// \return the registers of architecture \p V
+constexpr model::Register::Range registers(Values V) {
   using namespace model::Register;
-  auto Next = [](model::Register::Values &V) {
-    V = static_cast<model::Register::Values>(static_cast<unsigned long>(V) + 1);
-  };
-  for (auto Register = getFirst(V); Register <= getLast(V); Next(Register)) {
-    co_yield Register;
-  }
+  return Range(getFirst(V), getLast(V));
 }
 
 } // namespace model::Architecture
@@ -44,6 +44,12 @@ fields:
       elementType: model::Section
     doc: If there's at least one Section, only Sections where
          ContainsCode == true will be searched for code.
+  - name: ContentHash
+    type: uint64_t
+    optional: true
+    doc: xxHash64 of the FileSize bytes at StartOffset in the input binary,
+         recorded at import time. Caches can use it to identify the contents
+         of a segment without rehashing the whole binary. 0 means unknown.
 
 key:
   - StartAddress
@@ -9,8 +9,24 @@
 #include "revng/Model/Binary.h"
 #include "revng/Model/LoadModelPass.h"
 
+/// \brief Serialize \p Model in \p M
+///
+/// If \p M refers to a sidecar, the reference is dropped: the sidecar belongs
+/// to the file \p M has been loaded from, and must not be overwritten.
 void writeModel(const model::Binary &Model, llvm::Module &M);
 
+/// \brief Serialize \p Model in the file at \p SidecarPath and make \p M
+///        refer to it
+llvm::Error writeModel(const model::Binary &Model,
+                       llvm::Module &M,
+                       llvm::StringRef SidecarPath);
+
+/// \brief Make \p M refer to the model stored in the file at \p Path
+///
+/// The model currently stored in the module, if any, is dropped: the caller
+/// is responsible for writing the model to \p Path, e.g., through writeModel.
+void setModelSidecar(llvm::Module &M, llvm::StringRef Path);
+
 class SerializeModelWrapperPass : public llvm::ModulePass {
 public:
   static char ID;
@@ -6,9 +6,14 @@
 
 #include <fstream>
 #include <memory>
+#include <optional>
 #include <string>
 #include <type_traits>
+#include <vector>
 
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/Bitcode/BitcodeReader.h"
 #include "llvm/Bitcode/BitcodeWriter.h"
 #include "llvm/IR/Module.h"
@@ -24,6 +29,7 @@
 #include "revng/Model/LoadModelPass.h"
 #include "revng/Model/SerializeModelPass.h"
 #include "revng/Support/Assert.h"
+#include "revng/Support/TaskScheduler.h"
 
 namespace ModelOutputType {
 
@@ -141,6 +147,8 @@ class ModelInModule {
 private:
   std::unique_ptr<llvm::LLVMContext> Context;
   std::unique_ptr<llvm::Module> Module;
+  /// File where to store the model when saving the module, if requested
+  std::optional<std::string> Sidecar;
 
 public:
   TupleTree<model::Binary> Model;
@@ -212,6 +220,25 @@ public:
   TupleTree<model::Binary> &getModel() { return Model; }
   const TupleTree<model::Binary> &getModel() const { return Model; }
 
+  /// \brief Store the model in the file at \p Path, rather than in the module
+  ///
+  /// If not requested, modules loaded with a sidecar are saved with a sidecar
+  /// of their own, next to the output: the one of the input is never touched.
+  void setSidecar(llvm::StringRef Path) {
+    revng_assert(hasModule());
+    Sidecar = Path.str();
+  }
+
+  /// \return the path of the sidecar of the module saved at \p Path
+  static llvm::Expected<std::string> deriveSidecar(const llvm::Twine &Path) {
+    llvm::SmallString<128> Result;
+    Path.toVector(Result);
+    if (auto EC = llvm::sys::fs::make_absolute(Result))
+      return llvm::createStringError(EC, EC.message());
+    Result.append(".model.yml");
+    return Result.str().str();
+  }
+
 public:
   llvm::Error save(const llvm::Twine &Path, ModelOutputType::Values Type) {
     using namespace llvm;
@@ -224,7 +251,8 @@ public:
                                        "Cannot produce module: input was YAML");
       }
 
-      updateModule();
+      if (auto Error = updateModule(Path))
+        return Error;
     }
 
     std::error_code EC;
@@ -286,11 +314,103 @@ private:
   }
 
 private:
-  void updateModule() {
+  llvm::Error updateModule(const llvm::Twine &Path) {
     auto *NamedMD = Module->getNamedMetadata(ModelMetadataName);
     if (NamedMD != nullptr)
       NamedMD->eraseFromParent();
 
-    writeModel(*Model, *Module);
+    std::optional<std::string> SidecarPath = Sidecar;
+    if (not SidecarPath and getModelSidecar(*Module) and Path.str() != "-") {
+      auto MaybePath = deriveSidecar(Path);
+      if (not MaybePath)
+        return MaybePath.takeError();
+      SidecarPath = std::move(*MaybePath);
+    }
+
+    // Standard output has no path to put a sidecar next to, embed the model
+    if (not SidecarPath) {
+      writeModel(*Model, *Module);
+      return llvm::Error::success();
+    }
+
+    return writeModel(*Model, *Module, *SidecarPath);
   }
 };
+
+/// \brief A line of a batch manifest, i.e., a list of paths
+using BatchEntry = llvm::SmallVector<std::string, 3>;
+
+/// \brief Parse a manifest listing a batch of models to process
+///
+/// Each line of the manifest is an entry composed by \p Columns paths,
+/// separated by whitespace. Empty lines and lines starting with `#` are
+/// ignored.
+inline llvm::Expected<std::vector<BatchEntry>>
+readBatchManifest(const llvm::Twine &Path, unsigned Columns) {
+  using namespace llvm;
+  auto MaybeBuffer = errorOrToExpected(MemoryBuffer::getFileOrSTDIN(Path));
+  if (not MaybeBuffer)
+    return MaybeBuffer.takeError();
+
+  std::vector<BatchEntry> Result;
+  SmallVector<StringRef, 8> Lines;
+  (*MaybeBuffer)->getBuffer().split(Lines, '\n');
+  for (unsigned LineIndex = 0; LineIndex < Lines.size(); ++LineIndex) {
+    StringRef Line = Lines[LineIndex].trim();
+    if (Line.empty() or Line.startswith("#"))
+      continue;
+
+    SmallVector<StringRef, 3> Fields;
+    SplitString(Line, Fields);
+    BatchEntry Entry;
+    for (StringRef Field : Fields)
+      Entry.push_back(Field.str());
+
+    if (Entry.size() != Columns) {
+      return createStringError(inconvertibleErrorCode(),
+                               Path + ":" + Twine(LineIndex + 1)
+                                 + ": expected " + Twine(Columns)
+                                 + " paths, found " + Twine(Entry.size()));
+    }
+
+    Result.push_back(std::move(Entry));
+  }
+
+  return Result;
+}
+
+/// \brief Run \p Process on each entry of a batch, in parallel on the shared
+///        TaskScheduler
+///
+/// Entries are independent: a failing entry does not prevent the others from
+/// being processed. The errors are reported on stderr, in manifest order,
+/// prefixed by the first path of the entry.
+///
+/// \return the number of entries that failed.
+template<typename CallableType>
+inline size_t runBatch(llvm::ArrayRef<BatchEntry> Entries,
+                       CallableType &&Process) {
+  using namespace llvm;
+  std::vector<std::string> Errors(Entries.size());
+
+  {
+    TaskGroup Group;
+    for (size_t I = 0; I < Entries.size(); ++I) {
+      Group.spawn([&, I] {
+        if (Error E = Process(Entries[I]))
+          Errors[I] = toString(std::move(E));
+      });
+    }
+    Group.wait();
+  }
+
+  size_t Failures = 0;
+  for (size_t I = 0; I < Entries.size(); ++I) {
+    if (Errors[I].empty())
+      continue;
+    ++Failures;
+    errs() << Entries[I][0] << ": " << Errors[I] << "\n";
+  }
+
+  return Failures;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+
+#include "revng/Model/Binary.h"
+
+namespace model {
+
+/// \brief The references among the types of a model, and from the rest of the
+///        model to them
+///
+/// Nodes are the types in Binary::Types, numbered in order. Each node has an
+/// edge to each type it refers to (see Type::edges), in order and including
+/// pointers. All the references are resolved once, while building the graph,
+/// and successors and predecessors are laid out in compressed sparse row form,
+/// so that model passes can walk the type system without resolving any
+/// TupleTreeReference.
+///
+/// References that cannot be resolved do not produce edges, their source is
+/// recorded among the nodes with dangling references instead.
+///
+/// \note the graph is valid as long as Binary::Types is not modified.
+class TypeReferenceGraph {
+public:
+  using NodeID = uint32_t;
+
+private:
+  std::vector<const model::Type *> Types;
+  llvm::DenseMap<const model::Type *, NodeID> IDs;
+
+  /// Successors of node I are in
+  /// `Successors[SuccessorsOffsets[I]..SuccessorsOffsets[I + 1])`
+  std::vector<uint32_t> SuccessorsOffsets;
+  std::vector<NodeID> Successors;
+
+  /// Same as SuccessorsOffsets, for predecessors
+  std::vector<uint32_t> PredecessorsOffsets;
+  std::vector<NodeID> Predecessors;
+
+  /// Types referenced from outside of Binary::Types, sorted
+  std::vector<NodeID> ExternallyReferenced;
+
+  /// Types with references that cannot be resolved, sorted
+  std::vector<NodeID> Dangling;
+
+public:
+  explicit TypeReferenceGraph(const model::Binary &Model);
+
+public:
+  size_t size() const { return Types.size(); }
+
+  const model::Type *type(NodeID Node) const { return Types[Node]; }
+
+  std::optional<NodeID> lookup(const model::Type *T) const {
+    auto It = IDs.find(T);
+    if (It == IDs.end())
+      return std::nullopt;
+    return It->second;
+  }
+
+  NodeID id(const model::Type *T) const {
+    auto It = IDs.find(T);
+    revng_assert(It != IDs.end());
+    return It->second;
+  }
+
+  llvm::ArrayRef<NodeID> successors(NodeID Node) const {
+    return slice(SuccessorsOffsets, Successors, Node);
+  }
+
+  llvm::ArrayRef<NodeID> predecessors(NodeID Node) const {
+    return slice(PredecessorsOffsets, Predecessors, Node);
+  }
+
+  /// \return the types referenced by functions, segments and any other part
+  ///         of the model but the type system itself
+  llvm::ArrayRef<NodeID> externallyReferenced() const {
+    return ExternallyReferenced;
+  }
+
+  llvm::ArrayRef<NodeID> dangling() const { return Dangling; }
+
+public:
+  /// \return the nodes reachable from \p Roots, through successors
+  llvm::BitVector reachableFrom(llvm::ArrayRef<NodeID> Roots) const {
+    return visit(Roots, false);
+  }
+
+  /// \return the nodes from which \p Roots can be reached, i.e., reachable
+  ///         from \p Roots through predecessors
+  llvm::BitVector reachingTo(llvm::ArrayRef<NodeID> Roots) const {
+    return visit(Roots, true);
+  }
+
+private:
+  llvm::BitVector visit(llvm::ArrayRef<NodeID> Roots, bool Backward) const;
+
+  llvm::ArrayRef<NodeID> slice(const std::vector<uint32_t> &Offsets,
+                               const std::vector<NodeID> &Links,
+                               NodeID Node) const {
+    revng_assert(Node < size());
+    return llvm::ArrayRef<NodeID>(Links).slice(Offsets[Node],
+                                               Offsets[Node + 1]
+                                                 - Offsets[Node]);
+  }
+};
+
+} // namespace model
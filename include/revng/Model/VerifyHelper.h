@@ -28,10 +28,21 @@ private:
   std::set<const model::Type *> InProgress;
   bool AssertOnFail = false;
 
+  /// Helper whose results are reused, but never updated, by this one
+  const VerifyHelper *Parent = nullptr;
+
 public:
   VerifyHelper() = default;
   VerifyHelper(bool AssertOnFail) : AssertOnFail(AssertOnFail) {}
 
+  /// \brief Create a helper reusing the results of \p Parent
+  ///
+  /// This enables verifying types on multiple threads: each thread gets its
+  /// own helper, and \p Parent must not be modified until they are merged back
+  /// into it.
+  VerifyHelper(const VerifyHelper *Parent) :
+    AssertOnFail(Parent->AssertOnFail), Parent(Parent) {}
+
   ~VerifyHelper() { revng_assert(InProgress.size() == 0); }
 
 public:
@@ -41,7 +52,15 @@ public:
   }
 
   bool isVerified(const model::Type *T) const {
-    return VerifiedCache.count(T) != 0;
+    return VerifiedCache.count(T) != 0
+           or (Parent != nullptr and Parent->isVerified(T));
+  }
+
+  /// \brief Import the results of \p Other, which are now known to hold
+  void merge(VerifyHelper &&Other) {
+    revng_assert(Other.Parent == this);
+    VerifiedCache.merge(Other.VerifiedCache);
+    SizeCache.merge(Other.SizeCache);
   }
 
 public:
@@ -66,10 +85,12 @@ public:
     SizeCache[T] = Size;
   }
 
-  std::optional<uint64_t> size(const model::Type *T) {
+  std::optional<uint64_t> size(const model::Type *T) const {
     auto It = SizeCache.find(T);
     if (It != SizeCache.end())
       return It->second;
+    else if (Parent != nullptr)
+      return Parent->size(T);
     else
       return {};
   }
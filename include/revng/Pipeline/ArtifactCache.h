@@ -0,0 +1,65 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <string>
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Error.h"
+
+#include "revng/Pipeline/ContainerSet.h"
+#include "revng/Pipeline/Context.h"
+
+namespace pipeline {
+
+class Step;
+
+/// An on disk cache of the outputs of the steps of a pipeline.
+///
+/// Entries are content addressed: the key of an entry is a hash of the name
+/// and of the pipes of the step that produced it, of the serialized content of
+/// the containers it received as input and of the serialized globals of the
+/// context. Two runs on the same input, even from different processes, will
+/// therefore share the same entry. The key also covers the revng build and the
+/// LLVM version, so that entries are not shared across builds whose pipes may
+/// behave differently.
+///
+/// Since the content of the containers of an entry only depends on its key,
+/// the containers stored in or loaded from an entry, and their filtered
+/// clones, are given a content ID derived from it: the keys of the following
+/// steps are computed from such IDs rather than from the serialized content.
+///
+/// Each entry stores the containers produced by the pipes of a step as well as
+/// the globals, since pipes are allowed to change them.
+class ArtifactCache {
+private:
+  std::string Directory;
+
+public:
+  explicit ArtifactCache(llvm::StringRef Directory);
+
+public:
+  llvm::StringRef getDirectory() const { return Directory; }
+
+public:
+  /// \return the key identifying the output of running ToRun on Input
+  static llvm::Expected<std::string>
+  computeKey(const Context &Ctx, const Step &ToRun, const ContainerSet &Input);
+
+  /// Loads in Ctx and Output the entry associated to Key.
+  ///
+  /// \return false if there is no such entry
+  llvm::Expected<bool>
+  load(llvm::StringRef Key, Context &Ctx, ContainerSet &Output) const;
+
+  /// Stores Output and the globals of Ctx in the entry associated to Key.
+  ///
+  /// The entry is written in a temporary directory and then renamed, so that
+  /// concurrent runs never observe a partially written entry.
+  llvm::Error
+  store(llvm::StringRef Key, const Context &Ctx, const ContainerSet &Output);
+};
+
+} // namespace pipeline
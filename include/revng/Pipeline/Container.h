@@ -4,8 +4,12 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <cstdint>
 #include <memory>
+#include <optional>
+#include <string>
 
+#include "llvm/Support/Error.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 
@@ -24,10 +28,59 @@ private:
   const char *ID;
   std::string Name;
 
+  /// Bumped by every operation that might change the content of the container
+  uint64_t Version = 0;
+
+  /// The file the content of the container is identical to, if any, and the
+  /// Version of the container at the time
+  mutable std::string SyncedPath;
+  mutable uint64_t SyncedVersion = 0;
+
+  /// An identifier of the content of the container, see setContentID, and the
+  /// Version of the container it refers to
+  mutable std::string ContentID;
+  mutable uint64_t ContentIDVersion = 0;
+
+  /// What is left of an evicted container, see evict
+  struct Eviction {
+    std::string Path;
+    uint64_t Version = 0;
+    TargetsList Targets;
+  };
+
+  std::optional<Eviction> Evicted;
+
+  /// Why loading back the content of the container failed, if it did. In that
+  /// case the content is lost, until the container is entirely replaced.
+  std::string LoadBackFailure;
+
+  uint64_t ReloadsCount = 0;
+
 public:
   ContainerBase(char const *ID, llvm::StringRef Name) :
     ID(ID), Name(Name.str()) {}
 
+  // Copies are in sync with nothing, and assigning a container changes it
+  ContainerBase(const ContainerBase &Other) : ID(Other.ID), Name(Other.Name) {}
+  ContainerBase(ContainerBase &&Other) : ID(Other.ID), Name(Other.Name) {
+    Other.markModified();
+  }
+
+  ContainerBase &operator=(const ContainerBase &Other) {
+    ID = Other.ID;
+    Name = Other.Name;
+    markModified();
+    return *this;
+  }
+
+  ContainerBase &operator=(ContainerBase &&Other) {
+    ID = Other.ID;
+    Name = std::move(Other.Name);
+    markModified();
+    Other.markModified();
+    return *this;
+  }
+
 public:
   static bool classof(const ContainerBase *) { return true; }
 
@@ -35,6 +88,83 @@ public:
   const char *getTypeID() const { return ID; }
   const std::string &name() const { return Name; }
 
+public:
+  /// \return a counter that changes every time the content of the container
+  ///         might have changed
+  uint64_t version() const { return Version; }
+
+  /// Record that the content of the container might have changed
+  ///
+  /// The generic entry points (mergeBack, remove, deserialize, clear and
+  /// loadFromDisk) take care of it. Containers must invoke it from their own
+  /// methods that change their content or that give access to it for writing.
+  void markModified() { ++Version; }
+
+  /// \return true if the content of the container has not changed since it
+  ///         has been last stored to or loaded from \p Path
+  bool isSyncedWith(llvm::StringRef Path) const;
+
+  /// Record that the content of the container is identical to \p Path
+  void markSynced(llvm::StringRef Path) const {
+    SyncedPath = Path.str();
+    SyncedVersion = Version;
+  }
+
+  /// Record that \p ID identifies the current content of the container:
+  /// containers with the same ID have the same content
+  ///
+  /// The ID is dropped as soon as the content might change.
+  void setContentID(llvm::StringRef ID) const {
+    ContentID = ID.str();
+    ContentIDVersion = Version;
+  }
+
+  /// \return the ID set by setContentID, if the content did not change since
+  std::optional<llvm::StringRef> contentID() const {
+    if (ContentID.empty() or ContentIDVersion != Version)
+      return std::nullopt;
+    return llvm::StringRef(ContentID);
+  }
+
+public:
+  /// Release the content of the container, which must be synced with \p Path
+  /// or, if empty, might have produced no file at all.
+  ///
+  /// The content is logically still there: the container keeps answering
+  /// enumerateWithoutLoading and is loaded back by loadBack. The generic
+  /// entry points that change the content load it back first, the ones that
+  /// replace it entirely (deserialize, clear and loadFromDisk) drop it.
+  /// Everything else, including the const methods, must not be invoked on an
+  /// evicted container.
+  void evict(llvm::StringRef Path);
+
+  /// \return true if the content of the container has been released by evict
+  bool isEvicted() const {
+    return Evicted.has_value() and Evicted->Version == Version;
+  }
+
+  /// Load back the content released by evict, if any
+  llvm::Error loadBack();
+
+  /// Load back the content, if evicted, for operations that cannot report
+  /// failures: they are reported by checkLoadBack
+  void loadBackOnAccess() {
+    if (isEvicted())
+      llvm::consumeError(loadBack());
+  }
+
+  /// \return the targets held by the container, as enumerate does, without
+  ///         loading it back if it has been evicted
+  TargetsList enumerateWithoutLoading() const {
+    return isEvicted() ? Evicted->Targets : enumerate();
+  }
+
+  /// \return an error if loading back the content of the container failed
+  llvm::Error checkLoadBack() const;
+
+  /// \return how many times the content has been loaded back
+  uint64_t reloadsCount() const { return ReloadsCount; }
+
 public:
   virtual ~ContainerBase() = default;
 
@@ -54,33 +184,78 @@ public:
   /// targets are currently available inside the current container.
   virtual TargetsList enumerate() const = 0;
 
-  /// The implementation must ensure that
-  /// not after(this)->enumerate().contains(Targets);
+  /// Removes \p Targets, see removeImpl
   ///
-  /// returns false if nothing was removed
-  virtual bool remove(const TargetsList &Targets) = 0;
+  /// \return false if nothing was removed
+  bool remove(const TargetsList &Targets) {
+    loadBackOnAccess();
+    markModified();
+    return removeImpl(Targets);
+  }
 
   /// The implementation for a Type T that extends ContainerBase must ensure
   /// that a new instance of T, on which deserialize has been invoked with the
   /// serialized content of a old instance, must be equal to the old instance.
   virtual llvm::Error serialize(llvm::raw_ostream &OS) const = 0;
 
-  /// same as serialize
-  virtual llvm::Error deserialize(const llvm::MemoryBuffer &Buffer) = 0;
+  /// Replaces the content of the container, see serialize
+  llvm::Error deserialize(const llvm::MemoryBuffer &Buffer) {
+    markReplaced();
+    return deserializeImpl(Buffer);
+  }
 
-  /// Must reset the state of the container to the just built state
-  virtual void clear() = 0;
+  /// Resets the state of the container to the just built state
+  void clear() {
+    markReplaced();
+    clearImpl();
+  }
 
   /// The implementation must ensure that there exists a file at the provided
   /// path that contains the serialized version of this object.
   virtual llvm::Error storeToDisk(llvm::StringRef Path) const;
 
-  /// The implementation must esure that the content of this file will be
-  /// loaded from the provided path.
-  virtual llvm::Error loadFromDisk(llvm::StringRef Path);
+  /// Replaces the content of the container with the one stored at \p Path,
+  /// see loadFromDiskImpl
+  llvm::Error loadFromDisk(llvm::StringRef Path) {
+    markReplaced();
+    return loadFromDiskImpl(Path);
+  }
+
+  /// Whether loadFromDisk can run concurrently with the loadFromDisk of other
+  /// containers, e.g., it does not use an llvm::LLVMContext shared with them.
+  virtual bool canLoadConcurrently() const { return true; }
+
+  /// Whether the container uses an llvm::LLVMContext shared with other
+  /// containers, hence it must not be used while they are being used.
+  virtual bool sharesLLVMContext() const { return false; }
 
   /// Checks that the content of the this container is valid.
   virtual llvm::Error verify() const { return enumerate().verify(*this); }
+
+protected:
+  /// The implementation must ensure that
+  /// not after(this)->enumerate().contains(Targets);
+  ///
+  /// returns false if nothing was removed
+  virtual bool removeImpl(const TargetsList &Targets) = 0;
+
+  /// same as serialize
+  virtual llvm::Error deserializeImpl(const llvm::MemoryBuffer &Buffer) = 0;
+
+  /// Must reset the state of the container to the just built state
+  virtual void clearImpl() = 0;
+
+  /// The implementation must esure that the content of this file will be
+  /// loaded from the provided path.
+  virtual llvm::Error loadFromDiskImpl(llvm::StringRef Path);
+
+private:
+  /// Record that the content is about to be replaced entirely
+  void markReplaced() {
+    markModified();
+    Evicted.reset();
+    LoadBackFailure.clear();
+  }
 };
 
 /// CRTP class to be extended to implement a pipeline container.
@@ -105,6 +280,10 @@ public:
 
 public:
   void mergeBack(ContainerBase &&Container) final {
+    loadBackOnAccess();
+    Container.loadBackOnAccess();
+    markModified();
+    Container.markModified();
     mergeBackImpl(std::move(llvm::cast<Derived>(Container)));
   }
 
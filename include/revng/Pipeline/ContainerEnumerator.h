@@ -47,6 +47,16 @@ public:
   virtual TargetsList
   enumerate(const Context &Ctx, const Container &ToInspect) const = 0;
 
+  /// \return true if \p T is among the targets enumerated from \p ToInspect
+  ///
+  /// Inspectors are encouraged to override this, so that looking for a single
+  /// target does not require to enumerate all of them.
+  virtual bool contains(const Context &Ctx,
+                        const Container &ToInspect,
+                        const Target &T) const {
+    return enumerate(Ctx, ToInspect).contains(T);
+  }
+
   /// \return must return true if it was possible to remove the provided target
   virtual bool remove(const Context &Ctx,
                       const TargetsList &Targets,
@@ -96,7 +106,9 @@ public:
   Context &getContext() { return *Ctx; }
 
   bool contains(const Target &Target) const {
-    return enumerate().contains(Target);
+    return llvm::any_of(getRegisteredInspectors(), [&](const auto *Inspector) {
+      return Inspector->contains(*Ctx, *this->self(), Target);
+    });
   }
 
 public:
@@ -110,8 +122,9 @@ public:
     return ToReturn;
   }
 
+protected:
   /// \return true if all targets to remove have been removed
-  bool remove(const TargetsList &Targets) override {
+  bool removeImpl(const TargetsList &Targets) override {
     bool RemovedAll = true;
     for (const auto *Inspector : getRegisteredInspectors())
       RemovedAll = Inspector->remove(*Ctx,
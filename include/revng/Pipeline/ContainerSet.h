@@ -11,9 +11,13 @@
 #include <set>
 #include <sstream>
 #include <string>
+#include <vector>
 
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/Error.h"
@@ -38,6 +42,15 @@ using ContainerFactory = std::function<FactorySignature>;
 ///
 /// This class contains both the containers and a pointer to a factory that is
 /// used to create that container when it does not exists.
+///
+/// Each container tracks the file it has been last loaded from or stored to,
+/// and whether it changed since then (see ContainerBase::version), so that
+/// storeToDisk can skip the containers that have not changed.
+///
+/// Containers can be evicted: they're stored on disk and their content is
+/// released from memory, to be transparently loaded back the first time they
+/// are accessed again. The container objects themselves are never destroyed,
+/// so that references to them remain valid, see ContainerBase::evict.
 class ContainerSet {
 private:
   using Map = llvm::StringMap<std::unique_ptr<ContainerBase>>;
@@ -48,9 +61,13 @@ public:
   using value_type = Map::value_type;
 
 private:
-  Map Content;
+  /// Loading back evicted containers does not change the logical content of
+  /// the set, hence it's allowed through const accessors
+  mutable Map Content;
   llvm::StringMap<const ContainerFactory *> Factories;
 
+  uint64_t EvictionsCount = 0;
+
 public:
   ContainerSet() = default;
 
@@ -65,22 +82,50 @@ public:
   ~ContainerSet() = default;
 
 public:
-  const_iterator begin() const { return Content.begin(); }
+  const_iterator begin() const {
+    restoreAllOnAccess();
+    return Content.begin();
+  }
   const_iterator end() const { return Content.end(); }
 
-  iterator begin() { return Content.begin(); }
+  iterator begin() {
+    restoreAllOnAccess();
+    return Content.begin();
+  }
   iterator end() { return Content.end(); }
 
-  iterator find(llvm::StringRef Name) { return Content.find(Name); }
+  iterator find(llvm::StringRef Name) {
+    restoreOnAccess(Name);
+    return Content.find(Name);
+  }
 
   size_t size() const { return Factories.size(); }
 
+  /// Like find, but evicted containers are not loaded back
+  const_iterator findWithoutLoading(llvm::StringRef Name) const {
+    return Content.find(Name);
+  }
+  iterator findWithoutLoading(llvm::StringRef Name) {
+    return Content.find(Name);
+  }
+
+  /// The containers, without loading back the evicted ones
+  auto entriesWithoutLoading() const {
+    return llvm::make_range(Content.begin(), Content.end());
+  }
+
 public:
-  ContainerSet cloneFiltered(const ContainerToTargetsMap &Targets);
+  /// Returns a new set holding, for each container, a clone restricted to the
+  /// provided targets. If OnlyContainers is not null, the containers that are
+  /// not part of it are left empty in the returned set.
+  ContainerSet cloneFiltered(const ContainerToTargetsMap &Targets,
+                             const llvm::StringSet<> *OnlyContainers = nullptr);
 
   void mergeBack(ContainerSet &&Other) {
+    Other.restoreAllOnAccess();
     for (auto &Entry : Other.Content) {
       revng_assert(containsOrCanCreate(Entry.first()));
+      restoreOnAccess(Entry.first());
 
       auto &LContainer = Content.find(Entry.first())->second;
       auto &RContainer = Entry.second;
@@ -96,6 +141,7 @@ public:
 
   ContainerBase &operator[](llvm::StringRef Name) {
     revng_assert(containsOrCanCreate(Name));
+    restoreOnAccess(Name);
     if (Content[Name] == nullptr)
       Content[Name] = (*Factories[Name]) (Name);
     auto &Pointer = Content.find(Name)->second;
@@ -105,14 +151,17 @@ public:
 
   ContainerBase &at(llvm::StringRef Name) {
     revng_assert(contains(Name));
+    restoreOnAccess(Name);
     return *Content.find(Name)->second;
   }
 
   const ContainerBase &at(llvm::StringRef Name) const {
     revng_assert(contains(Name));
+    restoreOnAccess(Name);
     return *Content.find(Name)->second;
   }
 
+  /// \note evicted containers are considered present
   bool contains(llvm::StringRef Name) const {
     return Content.count(Name) != 0 and Content.find(Name)->second != nullptr;
   }
@@ -121,13 +170,27 @@ public:
     return Content.count(Name) != 0;
   }
 
+  /// \return true if the container called \p Name shares the
+  ///         llvm::LLVMContext with other containers. If it has not been
+  ///         created yet, a temporary one is created to find out.
+  bool sharesLLVMContext(llvm::StringRef Name) const {
+    revng_assert(containsOrCanCreate(Name));
+    const auto &Container = Content.find(Name)->second;
+    if (Container != nullptr)
+      return Container->sharesLLVMContext();
+
+    return (*Factories.lookup(Name))(Name)->sharesLLVMContext();
+  }
+
   template<typename T>
   const T &get(llvm::StringRef Name) const {
+    restoreOnAccess(Name);
     return llvm::cast<T>(*Content.find(Name)->second);
   }
 
   template<typename T>
   T &get(llvm::StringRef Name) {
+    restoreOnAccess(Name);
     return llvm::cast<T>(*Content.find(Name)->second);
   }
 
@@ -154,13 +217,75 @@ public:
   void intersect(ContainerToTargetsMap &ToIntersect) const;
 
 public:
+  /// A container to load and the file to load it from
+  struct LoadRequest {
+    ContainerBase *Container;
+    std::string Path;
+  };
+
+  /// Store the containers that changed since they have been last loaded or
+  /// stored. Each file is first written to a temporary path and then renamed,
+  /// so that an interrupted store never leaves a truncated file behind.
   llvm::Error storeToDisk(llvm::StringRef DirectoryPath) const;
   llvm::Error loadFromDisk(llvm::StringRef DirectoryPath);
 
+  /// Create all the containers, and return the requests to load each of them
+  /// from \p DirectoryPath
+  std::vector<LoadRequest> prepareLoadFromDisk(llvm::StringRef DirectoryPath);
+
+  /// Serve \p Requests, concurrently on the TaskScheduler if \p Jobs is more
+  /// than one. The requests of containers that cannot be loaded concurrently
+  /// are served in order, on the calling thread.
+  static llvm::Error load(llvm::ArrayRef<LoadRequest> Requests, unsigned Jobs);
+
+public:
+  /// Store in \p DirectoryPath the containers that are in memory, as
+  /// storeToDisk does, and release their content
+  llvm::Error evict(llvm::StringRef DirectoryPath);
+
+  /// Load back the container \p Name, if it has been evicted
+  ///
+  /// The accessors do this implicitly, but they cannot report failures: they
+  /// leave the container empty and the error is reported by the next
+  /// operation that can fail.
+  llvm::Error restore(llvm::StringRef Name) const {
+    const auto &Container = Content.find(Name)->second;
+    return Container != nullptr ? Container->loadBack() :
+                                  llvm::Error::success();
+  }
+
+  /// Load back all the evicted containers
+  llvm::Error restoreAll() const;
+
+  /// \return true if any container is currently in memory
+  bool hasResidentContainers() const {
+    return llvm::any_of(Content, [](const auto &Entry) {
+      return Entry.second != nullptr and not Entry.second->isEvicted();
+    });
+  }
+
+  /// \return true if the container \p Name has been evicted
+  bool isEvicted(llvm::StringRef Name) const {
+    const auto &Container = Content.find(Name)->second;
+    return Container != nullptr and Container->isEvicted();
+  }
+
+  /// \return how many containers have been evicted so far
+  uint64_t evictionsCount() const { return EvictionsCount; }
+
+  /// \return how many evicted containers have been loaded back so far
+  uint64_t reloadsCount() const {
+    uint64_t Result = 0;
+    for (const auto &Entry : Content)
+      if (Entry.second != nullptr)
+        Result += Entry.second->reloadsCount();
+    return Result;
+  }
+
 public:
   template<typename OStream>
   void dump(OStream &OS, size_t Indentation = 0) const {
-    for (const auto &Entry : Content) {
+    for (const auto &Entry : *this) {
       indent(OS, Indentation);
       OS << Entry.first().str() << "\n";
       if (Entry.second != nullptr)
@@ -169,6 +294,24 @@ public:
   }
 
   void dump() const { dump(dbg); }
+
+private:
+  /// Load back the container \p Name, if it has been evicted. Failures are
+  /// reported by checkRestores.
+  void restoreOnAccess(llvm::StringRef Name) const {
+    auto It = Content.find(Name);
+    if (It != Content.end() and It->second != nullptr)
+      It->second->loadBackOnAccess();
+  }
+
+  void restoreAllOnAccess() const {
+    for (const auto &Entry : Content)
+      if (Entry.second != nullptr)
+        Entry.second->loadBackOnAccess();
+  }
+
+  /// \return an error if any container could not be loaded back
+  llvm::Error checkRestores() const;
 };
 
 } // namespace pipeline
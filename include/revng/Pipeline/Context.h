@@ -124,6 +124,9 @@ public:
     return Iter->second->deserialize(Buffer);
   }
 
+  /// Serializes every global to OS, in the order of their names.
+  llvm::Error serializeGlobals(llvm::raw_ostream &OS) const;
+
 public:
   llvm::Error storeToDisk(llvm::StringRef Path) const;
   llvm::Error loadFromDisk(llvm::StringRef Path);
@@ -132,19 +132,28 @@ public:
                           llvm::ArrayRef<std::string> ContainerNames) const;
 
 private:
-  void forward(Target &Input) const;
+  /// Transforms in place all the Inputs, which must match the contract, into
+  /// the targets produced by the pipe. The rank transformation is computed
+  /// once for all of them.
+  void forward(TargetsList::List &Inputs) const;
   bool forwardMatches(const Target &Input) const;
-  void forwardRank(Target &Input) const;
 
   /// Target fixed -> Output must be exactly Target.
   /// Target same as Source, Source derived from base -> Most strict between
   /// source and target Target same as source, source exactly base -> base.
-  void backward(Target &Output) const;
+  ///
+  /// Outputs that do not match the contract are left untouched.
+  void backward(TargetsList::List &Outputs) const;
   Exactness::Values backwardInputContract(const Target &Output) const;
-  void backwardRank(Target &Output) const;
   const Kind &backwardInputKind(const Target &Output) const;
   bool backwardMatches(const Target &Output) const;
 
+  /// \return the number of path components to add, if positive, or to drop,
+  ///         if negative, to turn a target of the source rank into one of the
+  ///         target rank
+  int forwardRankDelta() const;
+  static void applyRankDelta(Target &ToChange, int Delta);
+
   /// Target is the container in which the Pipe would write when used to produce
   /// the targets.
   void deduceRequirements(TargetsList &SourceContainer,
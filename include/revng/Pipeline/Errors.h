@@ -50,4 +50,21 @@ public:
   void log(llvm::raw_ostream &OS) const override;
 };
 
+/// Error returned by Runner::run when its progress hook requests to stop
+class CancelledRunError : public llvm::ErrorInfo<CancelledRunError> {
+public:
+  static char ID;
+
+private:
+  std::string StepName;
+
+public:
+  explicit CancelledRunError(llvm::StringRef StepName) :
+    StepName(StepName.str()) {}
+
+public:
+  std::error_code convertToErrorCode() const override;
+  void log(llvm::raw_ostream &OS) const override;
+};
+
 } // namespace pipeline
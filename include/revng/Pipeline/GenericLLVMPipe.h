@@ -40,6 +40,14 @@ concept LLVMPass = requires(T P) {
   { P.registerPasses(std::declval<llvm::legacy::PassManager &>()) };
 };
 
+/// Containers that keep their content in multiple independent modules, such as
+/// ShardedLLVMContainer
+template<typename T>
+concept ShardedLLVMContainerLike = requires(T C) {
+  { C.shardsCount() } -> convertible_to<size_t>;
+  { C.forEachShard([](size_t, llvm::Module &) {}) };
+};
+
 template<typename T>
 concept LLVMPrintablePass = requires(T P) {
   { P.print(llvm::outs()) };
@@ -137,6 +145,9 @@ public:
 
 /// Implementation of the LLVM pipes to be instantiated for a particular LLVM
 /// container
+///
+/// Passes can keep state across runOnModule invocations, hence every run starts
+/// from freshly populated pass managers.
 template<typename LLVMContainer>
 class GenericLLVMPipe {
 private:
@@ -180,10 +191,17 @@ public:
   }
 
   void run(const Context &, LLVMContainer &Container) {
-    llvm::legacy::PassManager Manager;
-    for (const auto &Element : Passes)
-      Element->registerPasses(Manager);
-    Manager.run(Container.getModule());
+    if constexpr (ShardedLLVMContainerLike<LLVMContainer>) {
+      // Shards can be processed concurrently, and a pass manager cannot be
+      // shared, hence populate one for each shard upfront.
+      auto Managers = populateManagers(Container.shardsCount());
+      Container.forEachShard([&Managers](size_t Index, llvm::Module &Shard) {
+        Managers[Index]->run(Shard);
+      });
+    } else {
+      auto Managers = populateManagers(1);
+      Managers[0]->run(Container.getModule());
+    }
   }
 
   void addPass(const PureLLVMPassWrapper &Pass) {
@@ -231,6 +249,19 @@ public:
   }
 
   void dump() const debug_function { dump(dbg); }
+
+private:
+  /// \brief Build \p Count pass managers populated with fresh passes
+  std::vector<std::unique_ptr<llvm::legacy::PassManager>>
+  populateManagers(size_t Count) const {
+    std::vector<std::unique_ptr<llvm::legacy::PassManager>> Managers;
+    for (size_t I = 0; I < Count; I++) {
+      Managers.push_back(std::make_unique<llvm::legacy::PassManager>());
+      for (const auto &Element : Passes)
+        Element->registerPasses(*Managers.back());
+    }
+    return Managers;
+  }
 };
 
 class O2Pipe {
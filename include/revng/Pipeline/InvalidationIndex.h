@@ -0,0 +1,90 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "llvm/ADT/StringRef.h"
+
+#include "revng/Pipeline/Target.h"
+
+namespace pipeline {
+
+/// Records, for a step, which of its targets have been produced from which
+/// targets of its predecessor while the pipes of the step were running.
+///
+/// This allows Runner::getInvalidations to find the targets of a step that
+/// depend on a set of invalidated targets in time proportional to the number
+/// of dependencies, rather than by enumerating the backing containers.
+///
+/// The index is only meaningful as long as every target of the step has been
+/// produced by a recorded execution. As soon as the content of the step is
+/// provided in some other way, for instance by loading it from disk, the index
+/// is marked as incomplete and must not be used.
+class InvalidationIndex {
+public:
+  /// A target within a named container
+  using Location = std::pair<std::string, Target>;
+
+private:
+  std::map<Location, std::set<Location>> Dependents;
+  std::map<Location, std::set<Location>> Sources;
+
+  /// Sources that describe more than a single target, such as those obtained
+  /// by compacting the targets of a container, which must be matched rather
+  /// than looked up
+  std::set<Location> WildcardSources;
+
+  bool Complete = true;
+
+public:
+  bool isComplete() const { return Complete; }
+
+  /// Drops all the dependencies, and stops using the index until it's cleared
+  void markIncomplete() {
+    clear();
+    Complete = false;
+  }
+
+  void clear() {
+    Dependents.clear();
+    Sources.clear();
+    WildcardSources.clear();
+    Complete = true;
+  }
+
+  bool empty() const { return Dependents.empty(); }
+
+public:
+  /// Records that Dependent has been produced from Source
+  void record(const Location &Source, const Location &Dependent);
+
+  /// Drops all the dependencies of the targets in Removed, that are no longer
+  /// available in the step
+  void forget(const ContainerToTargetsMap &Removed);
+
+  /// \return the targets produced from any of the targets in \p Changed, or
+  ///         std::nullopt if some of them cannot be looked up in the index,
+  ///         that is when the index is incomplete or when a target is not an
+  ///         exact, fully qualified, target
+  std::optional<ContainerToTargetsMap>
+  dependentsOf(const ContainerToTargetsMap &Changed) const;
+
+  /// \return true if ToCheck is an exact target with no `*` components
+  static bool isIndexable(const Target &ToCheck);
+
+  /// \return true if there is a target described by both Left and Right
+  static bool overlaps(const Location &Left, const Location &Right);
+
+private:
+  void forgetDependent(const Location &Dependent);
+};
+
+} // namespace pipeline
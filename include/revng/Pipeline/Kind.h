@@ -70,6 +70,11 @@ public:
                             const Target &Input,
                             TargetsList &Output) const;
 
+  /// Adds to ToRemove the targets of this kind affected by Event. The result
+  /// must not depend on the container the targets are in.
+  ///
+  /// When the runner uses more than one job, this is invoked concurrently for
+  /// all the kinds.
   virtual void getInvalidations(pipeline::TargetsList &ToRemove,
                                 const InvalidationEventBase &Event) const {}
 
@@ -6,6 +6,7 @@
 
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 
 #include "revng/ADT/STLExtras.h"
@@ -17,19 +18,29 @@ namespace pipeline {
 
 /// A KindsRegistry is a simple vector used to keep track of which kinds are
 /// available in a particular pipeline
+///
+/// Kinds are also indexed by name, since they are looked up by name every time
+/// a target is parsed.
 class KindsRegistry {
 public:
   using Container = llvm::SmallVector<Kind *, 4>;
 
 private:
   Container Kinds;
+  llvm::StringMap<Kind *> ByName;
 
 public:
   KindsRegistry(llvm::SmallVector<Kind *, 4> Kinds = {}) :
-    Kinds(std::move(Kinds)) {}
+    Kinds(std::move(Kinds)) {
+    for (Kind *K : this->Kinds) {
+      bool Inserted = ByName.try_emplace(K->name(), K).second;
+      revng_assert(Inserted);
+    }
+  }
 
   void registerKind(Kind &K) {
-    revng_assert(not contains(K.name()));
+    bool Inserted = ByName.try_emplace(K.name(), &K).second;
+    revng_assert(Inserted);
     Kinds.push_back(&K);
   }
 
@@ -40,15 +51,20 @@ public:
   auto end() const { return revng::dereferenceIterator(Kinds.end()); }
 
   const Kind *find(llvm::StringRef Name) const {
-    auto Iter = llvm::find_if(Kinds, [Name](const auto *Kind) {
-      return Kind->name() == Name;
-    });
-    if (Iter == Kinds.end())
+    auto Iter = ByName.find(Name);
+    if (Iter == ByName.end())
+      return nullptr;
+    return Iter->second;
+  }
+
+  Kind *find(llvm::StringRef Name) {
+    auto Iter = ByName.find(Name);
+    if (Iter == ByName.end())
       return nullptr;
-    return *Iter;
+    return Iter->second;
   }
 
-  bool contains(llvm::StringRef Name) { return find(Name) != nullptr; }
+  bool contains(llvm::StringRef Name) const { return find(Name) != nullptr; }
 
 public:
   template<typename OS>
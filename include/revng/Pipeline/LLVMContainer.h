@@ -4,8 +4,10 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <atomic>
 #include <cstdint>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <system_error>
@@ -31,6 +33,7 @@
 #include "llvm/IRReader/IRReader.h"
 #include "llvm/Linker/Linker.h"
 #include "llvm/Support/Casting.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
@@ -45,6 +48,10 @@
 
 namespace pipeline {
 
+/// When set, LLVMContainerBase::loadFromDisk only maps the file in memory and
+/// the module is parsed the first time it's accessed
+extern llvm::cl::opt<bool> LazyLoadLLVMContainers;
+
 template<typename LLVMContainer>
 class GenericLLVMPipe;
 
@@ -60,7 +67,17 @@ private:
   using ThisType = LLVMContainerBase<TypeID>;
 
 private:
-  std::unique_ptr<llvm::Module> Module;
+  /// Always non-null. While Pending is set, this is an empty module providing
+  /// the llvm::LLVMContext in which Pending will be parsed.
+  mutable std::unique_ptr<llvm::Module> Module;
+
+  /// Content loaded from disk that has not been parsed yet
+  ///
+  /// Const getters can parse it, possibly from several threads at once: reads
+  /// happen under PendingLock, unless HasPending tells there's nothing to do.
+  mutable std::unique_ptr<llvm::MemoryBuffer> Pending;
+  mutable std::atomic<bool> HasPending = false;
+  mutable std::mutex PendingLock;
 
 public:
   LLVMContainerBase(Context &Ctx,
@@ -79,8 +96,22 @@ public:
   }
 
 public:
-  const llvm::Module &getModule() const { return *Module; }
-  llvm::Module &getModule() { return *Module; }
+  const llvm::Module &getModule() const {
+    materialize();
+    return *Module;
+  }
+
+  llvm::Module &getModule() {
+    materialize();
+    this->markModified();
+    return *Module;
+  }
+
+  /// \return true if the content loaded from disk has not been parsed yet
+  bool isPending() const { return HasPending.load(); }
+
+  auto functions() const { return getModule().functions(); }
+  auto functions() { return getModule().functions(); }
 
 public:
   std::unique_ptr<ContainerBase>
@@ -98,8 +129,8 @@ public:
     };
 
     llvm::ValueToValueMapTy Map;
-    revng_assert(llvm::verifyModule(*Module, &llvm::dbgs()) == 0);
-    auto Cloned = llvm::CloneModule(*Module, Map, Filter);
+    revng_assert(llvm::verifyModule(getModule(), &llvm::dbgs()) == 0);
+    auto Cloned = llvm::CloneModule(getModule(), Map, Filter);
 
     return std::make_unique<ThisType>(*this->Ctx,
                                       std::move(Cloned),
@@ -108,12 +139,29 @@ public:
 
 public:
   llvm::Error serialize(llvm::raw_ostream &OS) const final {
+    // Nobody touched the module since it has been loaded, no need to parse it
+    if (HasPending.load()) {
+      std::lock_guard Guard(PendingLock);
+      if (Pending != nullptr) {
+        OS << Pending->getBuffer();
+        OS.flush();
+        return llvm::Error::success();
+      }
+    }
+
     getModule().print(OS, nullptr);
     OS.flush();
     return llvm::Error::success();
   }
 
-  llvm::Error deserialize(const llvm::MemoryBuffer &Buffer) final {
+  /// Lazy loading only maps the file, while parsing uses the shared context
+  bool canLoadConcurrently() const final { return LazyLoadLLVMContainers; }
+
+  bool sharesLLVMContext() const final { return true; }
+
+protected:
+  llvm::Error deserializeImpl(const llvm::MemoryBuffer &Buffer) final {
+    resetPending();
     llvm::SMDiagnostic Error;
     auto M = llvm::parseIR(Buffer, Error, Module->getContext());
     if (!M)
@@ -124,61 +172,113 @@ public:
     return llvm::Error::success();
   }
 
-  void clear() final {
+  llvm::Error loadFromDiskImpl(llvm::StringRef Path) final {
+    if (not LazyLoadLLVMContainers)
+      return ContainerBase::loadFromDiskImpl(Path);
+
+    clearImpl();
+    if (not llvm::sys::fs::exists(Path))
+      return llvm::Error::success();
+
+    // Large files are mmap'd, so pages that are never parsed are never read
+    auto MaybeBuffer = llvm::MemoryBuffer::getFile(Path);
+    if (not MaybeBuffer)
+      return llvm::createStringError(MaybeBuffer.getError(),
+                                     "could not read file");
+
+    Pending = std::move(*MaybeBuffer);
+    HasPending.store(true);
+    return llvm::Error::success();
+  }
+
+  void clearImpl() final {
+    resetPending();
     Module = std::make_unique<llvm::Module>("revng.module",
                                             Module->getContext());
   }
 
 private:
+  void resetPending() {
+    Pending.reset();
+    HasPending.store(false);
+  }
+
+  void materialize() const {
+    if (not HasPending.load())
+      return;
+
+    std::lock_guard Guard(PendingLock);
+    if (Pending == nullptr)
+      return;
+
+    llvm::SMDiagnostic Error;
+    auto M = llvm::parseIR(*Pending, Error, Module->getContext());
+    if (not M) {
+      Error.print("revng", llvm::dbgs());
+      revng_abort("Could not parse a lazily loaded module");
+    }
+
+    Module = std::move(M);
+    Pending.reset();
+    HasPending.store(false);
+  }
+
+  /// \brief Link \p Other into this module in place
+  ///
+  /// The linker moves the bodies of the incoming functions and globals into
+  /// the existing module and resolves the declarations against the
+  /// definitions, so this module is never cloned or relinked into a fresh
+  /// one. Still, each merge visits the whole of this module: the IRMover
+  /// collects the struct types it uses and, in debug builds, it's verified
+  /// before and after linking.
   void mergeBackImpl(ThisType &&Other) final {
-    auto BeforeEnumeration = this->enumerate();
-    auto OtherEnumeration = Other.enumerate();
+    materialize();
+    Other.materialize();
 
-    BeforeEnumeration.merge(OtherEnumeration);
+#ifndef NDEBUG
+    auto BeforeEnumeration = this->enumerate();
+    BeforeEnumeration.merge(Other.enumerate());
+#endif
 
     ThisType &ToMerge = Other;
-    auto Composite = std::make_unique<llvm::Module>("llvm-link",
-                                                    Module->getContext());
-    std::set<std::string> Globals;
 
-    for (auto &Global : Module->globals()) {
+    // Internal globals with the same name must be merged rather than renamed:
+    // temporarily expose the internal globals of the incoming module and their
+    // counterparts in this module. Only globals named in the incoming module
+    // are visited.
+    std::set<std::string> Globals;
+    auto Expose = [&Globals](llvm::GlobalVariable &Global) {
       if (Global.getLinkage() != llvm::GlobalValue::InternalLinkage)
-        continue;
+        return;
       Globals.insert(Global.getName().str());
       Global.setLinkage(llvm::GlobalValue::ExternalLinkage);
-    }
+    };
 
     for (auto &Global : ToMerge.getModule().globals()) {
-      if (Global.getLinkage() != llvm::GlobalValue::InternalLinkage)
-        continue;
-      Globals.insert(Global.getName().str());
-      Global.setLinkage(llvm::GlobalValue::ExternalLinkage);
+      Expose(Global);
+      if (auto *Existing = Module->getNamedGlobal(Global.getName()))
+        Expose(*Existing);
     }
 
     revng_assert(llvm::verifyModule(ToMerge.getModule(), &llvm::dbgs()) == 0);
     revng_assert(llvm::verifyModule(*Module, &llvm::dbgs()) == 0);
 
-    llvm::Linker TheLinker(*Composite);
-
-    bool Failure = TheLinker.linkInModule(std::move(Module),
+    llvm::Linker TheLinker(*Module);
+    bool Failure = TheLinker.linkInModule(std::move(ToMerge.Module),
                                           llvm::Linker::OverrideFromSrc);
-
-    Failure = Failure
-              or TheLinker.linkInModule(std::move(ToMerge.Module),
-                                        llvm::Linker::OverrideFromSrc);
-
     revng_assert(not Failure, "Linker failed");
 
-    for (auto &Global : Composite->globals()) {
-      if (Globals.contains(Global.getName().str()))
-        Global.setLinkage(llvm::GlobalValue::InternalLinkage);
-    }
+    for (const std::string &Name : Globals)
+      if (auto *Global = Module->getNamedGlobal(Name))
+        Global->setLinkage(llvm::GlobalValue::InternalLinkage);
 
-    revng_assert(llvm::verifyModule(*Composite, nullptr) == 0);
-    Module = std::move(Composite);
+    revng_assert(llvm::verifyModule(*Module, nullptr) == 0);
 
-    revng_assert(BeforeEnumeration.contains(this->enumerate()));
-    revng_assert(this->enumerate().contains(BeforeEnumeration));
+#ifndef NDEBUG
+    auto AfterEnumeration = this->enumerate();
+    revng_assert(BeforeEnumeration.contains(AfterEnumeration));
+    revng_assert(AfterEnumeration.contains(BeforeEnumeration));
+#endif
   }
 };
 
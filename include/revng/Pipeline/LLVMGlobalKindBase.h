@@ -5,6 +5,9 @@
 //
 
 #include <iterator>
+#include <map>
+#include <memory>
+#include <vector>
 
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/SmallVector.h"
@@ -19,9 +22,18 @@
 #include "revng/Pipeline/Kind.h"
 #include "revng/Pipeline/Step.h"
 #include "revng/Pipeline/Target.h"
+#include "revng/Pipeline/TargetsBitmap.h"
 
 namespace pipeline {
 
+/// Containers that keep apart the functions associated to a target from the
+/// others, and therefore need all the kinds to be registered for hasOwner to
+/// work, e.g., ShardedLLVMContainerBase
+template<typename T>
+concept TracksFunctionOwners = requires {
+  requires T::TracksFunctionOwners;
+};
+
 /// Kind that must be extended to be able to specify how a to deduce the target
 /// associated to a particular llvm global object.
 ///
@@ -30,6 +42,13 @@ namespace pipeline {
 ///
 /// compactTargets must collapse the targets into the * target if they are all
 /// presents, do no thing otherwise.
+///
+/// LLVMContainer must provide a functions() method returning the range of the
+/// llvm functions it holds.
+///
+/// Kinds register themselves, for hasOwner, only for the containers that track
+/// the owners of functions: for the others, e.g., LLVMContainerBase,
+/// untrackedFunctions returns all the functions and cloneFiltered keeps them.
 template<typename LLVMContainer>
 class LLVMGlobalKindBase : public KindForContainer<LLVMContainer> {
 public:
@@ -37,13 +56,19 @@ public:
 
 public:
   LLVMGlobalKindBase(llvm::StringRef Name, Rank *Rank) :
-    KindForContainer<LLVMContainer>(Name, Rank) {}
+    KindForContainer<LLVMContainer>(Name, Rank) {
+    registerInspector();
+  }
 
   LLVMGlobalKindBase(llvm::StringRef Name, Kind &Parent) :
-    KindForContainer<LLVMContainer>(Name, Parent) {}
+    KindForContainer<LLVMContainer>(Name, Parent) {
+    registerInspector();
+  }
 
   LLVMGlobalKindBase(llvm::StringRef Name, Kind &Parent, Rank *Rank) :
-    KindForContainer<LLVMContainer>(Name, Parent, Rank) {}
+    KindForContainer<LLVMContainer>(Name, Parent, Rank) {
+    registerInspector();
+  }
   ~LLVMGlobalKindBase() override {}
 
 public:
@@ -73,61 +98,115 @@ public:
   virtual TargetsList
   compactTargets(const Context &Ctx, TargetsList::List &Targets) const = 0;
 
-public:
-  llvm::DenseSet<const llvm::Function *>
-  targetsIntersection(const TargetsList &Targets,
-                      const LLVMContainer &Container) const {
-
-    llvm::DenseSet<const llvm::Function *> ToReturn;
-    for (auto &GL : Container.getModule().functions()) {
+private:
+  /// The targets of the functions of a container owned by this kind
+  template<typename FunctionType>
+  class OwnedFunctions {
+  public:
+    std::shared_ptr<const TargetsUniverse> Universe;
+    /// For each function, the index of its target in Universe
+    std::vector<std::pair<FunctionType *, size_t>> Functions;
+  };
+
+  template<typename FunctionType, typename Range>
+  OwnedFunctions<FunctionType> collectOwnedFunctions(Range &&Functions) const {
+    OwnedFunctions<FunctionType> Result;
+    std::vector<Target> Targets;
+    std::map<Target, size_t> Known;
+    for (auto &GL : Functions) {
       auto MaybeTarget = symbolToTarget(GL);
       if (not MaybeTarget.has_value())
         continue;
 
-      if (not Targets.contains(*MaybeTarget))
-        continue;
-
-      ToReturn.insert(&GL);
+      auto [It, New] = Known.try_emplace(*MaybeTarget, Targets.size());
+      if (New)
+        Targets.push_back(std::move(*MaybeTarget));
+      Result.Functions.emplace_back(&GL, It->second);
     }
 
+    Result.Universe = std::make_shared<TargetsUniverse>(std::move(Targets));
+    return Result;
+  }
+
+  template<typename FunctionType>
+  static llvm::DenseSet<FunctionType *>
+  selectFunctions(const OwnedFunctions<FunctionType> &Owned,
+                  const TargetsList &Targets) {
+    TargetsBitmap Selected(Owned.Universe);
+    Selected.insert(Targets);
+
+    llvm::DenseSet<FunctionType *> ToReturn;
+    for (const auto &[Function, Index] : Owned.Functions)
+      if (Selected.test(Index))
+        ToReturn.insert(Function);
     return ToReturn;
   }
 
+public:
+  llvm::DenseSet<const llvm::Function *>
+  targetsIntersection(const TargetsList &Targets,
+                      const LLVMContainer &Container) const {
+    using Function = const llvm::Function;
+    return selectFunctions(collectOwnedFunctions<Function>(Container
+                                                             .functions()),
+                           Targets);
+  }
+
   llvm::DenseSet<llvm::Function *>
   targetsIntersection(const TargetsList &Targets,
                       LLVMContainer &Container) const {
-    llvm::DenseSet<llvm::Function *> ToReturn;
-    for (auto &GL : Container.getModule().functions()) {
-      auto MaybeTarget = symbolToTarget(GL);
-      if (not MaybeTarget.has_value())
-        continue;
-
-      if (not Targets.contains(*MaybeTarget))
-        continue;
-
-      ToReturn.insert(&GL);
-    }
-
-    return ToReturn;
+    using Function = llvm::Function;
+    return selectFunctions(collectOwnedFunctions<Function>(Container
+                                                             .functions()),
+                           Targets);
   }
 
 public:
   bool remove(const Context &Ctx,
               const TargetsList &Targets,
               LLVMContainer &Container) const final {
+    auto Owned = collectOwnedFunctions<llvm::Function>(Container.functions());
+
+    // Exact targets are looked up in the bitmap, the others, which might be
+    // satisfied only by compacted targets, in the enumeration
+    const auto Present = TargetsBitmap::all(Owned.Universe);
+    std::optional<TargetsList> Enumerated;
+    bool AllContained = true;
+    for (const Target &T : Targets) {
+      if (TargetsUniverse::isExact(T) and Present.contains(T))
+        continue;
 
-    const bool AllContained = enumerate(Ctx, Container).contains(Targets);
+      if (not Enumerated)
+        Enumerated = enumerate(Ctx, Container);
+      if (not Enumerated->contains(T)) {
+        AllContained = false;
+        break;
+      }
+    }
 
-    for (auto &GL : targetsIntersection(Targets, Container))
+    for (auto &GL : selectFunctions(Owned, Targets))
       GL->deleteBody();
 
     return AllContained;
   }
 
+  bool contains(const Context &Ctx,
+                const LLVMContainer &Container,
+                const Target &T) const final {
+    if (not TargetsUniverse::isExact(T) or &T.getKind() != this)
+      return ContainerEnumerator<LLVMContainer>::contains(Ctx, Container, T);
+
+    // No need to build, and compact, the whole list of targets
+    for (auto &GL : Container.functions())
+      if (auto MaybeTarget = symbolToTarget(GL); MaybeTarget == T)
+        return true;
+    return false;
+  }
+
   TargetsList
   enumerate(const Context &Ctx, const LLVMContainer &Container) const final {
     TargetsList::List L;
-    for (auto &GL : Container.getModule().functions()) {
+    for (auto &GL : Container.functions()) {
       auto MaybeTarget = symbolToTarget(GL);
       if (not MaybeTarget.has_value())
         continue;
@@ -142,7 +221,7 @@ public:
   untrackedFunctions(const LLVMContainer &Container) {
     llvm::DenseSet<const llvm::Function *> ToReturn;
 
-    for (const auto &F : Container.getModule().functions())
+    for (const auto &F : Container.functions())
       if (not hasOwner(F))
         ToReturn.insert(&F);
 
@@ -165,6 +244,11 @@ public:
   }
 
 private:
+  void registerInspector() {
+    if constexpr (TracksFunctionOwners<LLVMContainer>)
+      getRegisteredInspectors().push_back(this);
+  }
+
   static StaticContainer &getRegisteredInspectors() {
     static StaticContainer Container;
     return Container;
@@ -8,12 +8,14 @@
 #include <vector>
 
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/YAMLTraits.h"
 
 #include "revng/Pipeline/GenericLLVMPipe.h"
 #include "revng/Pipeline/LLVMContainer.h"
+#include "revng/Pipeline/NewPMLLVMPipe.h"
 #include "revng/Pipeline/Runner.h"
 #include "revng/Pipeline/SavableObject.h"
 #include "revng/Support/Assert.h"
@@ -58,6 +60,8 @@ class PipelineContext;
 class Loader {
 public:
   using LoaderCallback = std::function<llvm::Error(const Loader &, LLVMPipe &)>;
+  using NewPMLoaderCallback = std::function<llvm::Error(const Loader &,
+                                                        NewPMLLVMPipe &)>;
 
 private:
   llvm::StringMap<ContainerFactory> KnownContainerTypes;
@@ -65,9 +69,12 @@ private:
     KnownPipesTypes;
   llvm::StringMap<std::function<std::unique_ptr<LLVMPassWrapperBase>()>>
     KnownLLVMPipeTypes;
+  llvm::StringMap<std::function<std::unique_ptr<NewPMPassWrapperBase>()>>
+    KnownNewPMLLVMPipeTypes;
 
   std::set<std::string> EnabledFlags;
   std::optional<LoaderCallback> OnLLVMContainerCreationAction = std::nullopt;
+  std::optional<NewPMLoaderCallback> OnNewPMLLVMPipeCreationAction;
   Context *PipelineContext;
 
 public:
@@ -80,6 +87,9 @@ public:
 public:
   llvm::Expected<Runner> load(const PipelineDeclaration &) const;
   llvm::Expected<Runner> load(llvm::ArrayRef<PipelineDeclaration>) const;
+
+  /// \note the YAML parsing of each distinct text is performed only once
+  ///       per process, later loads of the same text reuse its result.
   llvm::Expected<Runner> load(llvm::ArrayRef<std::string> Pipelines) const;
 
   template<typename ContainerType>
@@ -106,6 +116,16 @@ public:
     revng_assert(inserted);
   }
 
+  template<typename NewPMLLVMPass>
+  void registerNewPMLLVMPass(llvm::StringRef Name) {
+    auto [_, inserted] = KnownNewPMLLVMPipeTypes.try_emplace(Name, []() {
+      using Type = NewPMPassWrapper<NewPMLLVMPass>;
+      return std::make_unique<Type>(NewPMLLVMPass());
+    });
+
+    revng_assert(inserted);
+  }
+
   template<typename PipeType>
   void registerPipe(llvm::StringRef Name) {
     const auto LambdaToEmplace = [](std::vector<std::string> CName) {
@@ -134,7 +154,14 @@ public:
     OnLLVMContainerCreationAction = std::move(CallBack);
   }
 
+  void setNewPMLLVMPipeConfigurer(NewPMLoaderCallback CallBack) {
+    OnNewPMLLVMPipeCreationAction = std::move(CallBack);
+  }
+
 private:
+  using DeclarationsList = llvm::SmallVector<const PipelineDeclaration *, 2>;
+  llvm::Expected<Runner> loadDeclarations(DeclarationsList ToSort) const;
+
   llvm::Error
   parseSteps(Runner &Runner, const PipelineDeclaration &Declaration) const;
   llvm::Error parseDeclarations(Runner &Runner,
@@ -153,6 +180,12 @@ private:
   llvm::Expected<std::unique_ptr<LLVMPassWrapperBase>>
   loadPassFromName(llvm::StringRef Name) const;
 
+  llvm::Error
+  parseNewPMLLVMPass(Step &Step, const PipeInvocation &Invocation) const;
+
+  llvm::Expected<std::unique_ptr<NewPMPassWrapperBase>>
+  loadNewPMPassFromName(llvm::StringRef Name) const;
+
   bool isInvocationUsed(const std::vector<std::string> &Names) const;
 };
 } // namespace pipeline
@@ -0,0 +1,244 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Analysis/CGSCCPassManager.h"
+#include "llvm/Analysis/LoopAnalysisManager.h"
+#include "llvm/IR/PassManager.h"
+#include "llvm/Passes/PassBuilder.h"
+
+#include "revng/ADT/Concepts.h"
+#include "revng/Pipeline/Contract.h"
+#include "revng/Pipeline/GenericLLVMPipe.h"
+#include "revng/Pipeline/LLVMContainer.h"
+#include "revng/Support/Debug.h"
+#include "revng/Support/ResourceFinder.h"
+
+namespace pipeline {
+
+/// The analysis managers of a run of a new pass manager pipeline
+///
+/// \note the order of the members matters: proxies in an analysis manager
+///       reference the managers declared before it.
+struct AnalysisManagers {
+  llvm::LoopAnalysisManager LAM;
+  llvm::FunctionAnalysisManager FAM;
+  llvm::CGSCCAnalysisManager CGAM;
+  llvm::ModuleAnalysisManager MAM;
+};
+
+class NewPMPassWrapperBase {
+public:
+  virtual ~NewPMPassWrapperBase() = default;
+  virtual void registerPasses(llvm::PassBuilder &Builder,
+                              llvm::ModulePassManager &Manager) = 0;
+  virtual const std::vector<ContractGroup> &getContract() const = 0;
+  virtual std::unique_ptr<NewPMPassWrapperBase> clone() const = 0;
+  virtual llvm::StringRef getName() const = 0;
+};
+
+template<typename T>
+concept NewPMLLVMPass = requires(T P) {
+  { T::Name } -> convertible_to<const char *>;
+  { P.registerPasses(std::declval<llvm::ModulePassManager &>()) };
+};
+
+/// Wrapper for the passes known to the PassBuilder, identified by their
+/// textual pipeline description (e.g., `function(instcombine)`)
+class PureNewPMPassWrapper : public NewPMPassWrapperBase {
+private:
+  std::string Pipeline;
+
+public:
+  PureNewPMPassWrapper(llvm::StringRef Pipeline) : Pipeline(Pipeline.str()) {}
+
+  static llvm::Expected<std::unique_ptr<PureNewPMPassWrapper>>
+  create(llvm::StringRef Pipeline);
+
+  ~PureNewPMPassWrapper() override = default;
+
+  void registerPasses(llvm::PassBuilder &Builder,
+                      llvm::ModulePassManager &Manager) override {
+    llvm::cantFail(Builder.parsePassPipeline(Manager, Pipeline));
+  }
+
+  const std::vector<ContractGroup> &getContract() const override {
+    static const std::vector<ContractGroup> Empty{};
+    return Empty;
+  }
+
+  std::unique_ptr<NewPMPassWrapperBase> clone() const override {
+    return std::make_unique<PureNewPMPassWrapper>(*this);
+  }
+
+  llvm::StringRef getName() const override { return Pipeline; }
+};
+
+template<NewPMLLVMPass T>
+class NewPMPassWrapper : public NewPMPassWrapperBase {
+private:
+  T PipePass;
+  std::vector<ContractGroup> Contract;
+
+public:
+  NewPMPassWrapper(T Pass) :
+    PipePass(std::move(Pass)), Contract(this->PipePass.getContract()) {}
+
+  ~NewPMPassWrapper() override = default;
+
+public:
+  llvm::StringRef getName() const override { return T::Name; }
+
+  void registerPasses(llvm::PassBuilder &,
+                      llvm::ModulePassManager &Manager) override {
+    PipePass.registerPasses(Manager);
+  }
+
+  const std::vector<ContractGroup> &getContract() const override {
+    return Contract;
+  }
+
+  std::unique_ptr<NewPMPassWrapperBase> clone() const override {
+    return std::make_unique<NewPMPassWrapper>(*this);
+  }
+};
+
+/// Pipe running a sequence of passes through the new pass manager
+///
+/// Contrary to GenericLLVMPipe, all the passes share the same analysis
+/// managers, therefore an analysis (e.g., GCBI or the dominator tree) is
+/// computed once per pipe run and reused by all the passes, unless one of
+/// them does not preserve it.
+///
+/// Analyses specific to revng, such as LoadModelAnalysis, can be provided
+/// through addAnalyses. They're registered before the default ones.
+template<typename LLVMContainer>
+class GenericNewPMLLVMPipe {
+public:
+  using AnalysesRegistration = std::function<void(AnalysisManagers &)>;
+
+private:
+  llvm::SmallVector<std::unique_ptr<NewPMPassWrapperBase>, 4> Passes;
+  std::vector<AnalysesRegistration> Registrations;
+
+public:
+  static constexpr auto Name = "GenericNewPMLLVMPipe";
+
+  GenericNewPMLLVMPipe() = default;
+
+  GenericNewPMLLVMPipe(const GenericNewPMLLVMPipe &Other) :
+    Registrations(Other.Registrations) {
+    for (const auto &P : Other.Passes)
+      Passes.push_back(P->clone());
+  }
+
+  GenericNewPMLLVMPipe &operator=(const GenericNewPMLLVMPipe &Other) {
+    if (this == &Other)
+      return *this;
+
+    GenericNewPMLLVMPipe Copy(Other);
+    *this = std::move(Copy);
+    return *this;
+  }
+
+  GenericNewPMLLVMPipe &operator=(GenericNewPMLLVMPipe &&Other) = default;
+  GenericNewPMLLVMPipe(GenericNewPMLLVMPipe &&Other) = default;
+  ~GenericNewPMLLVMPipe() = default;
+
+  std::vector<ContractGroup> getContract() const {
+    std::vector<ContractGroup> Contract;
+    for (const auto &Element : Passes)
+      for (const auto &C : Element->getContract())
+        Contract.push_back(C);
+
+    return Contract;
+  }
+
+  void run(const Context &, LLVMContainer &Container) {
+    if constexpr (ShardedLLVMContainerLike<LLVMContainer>) {
+      // Each shard gets its own analysis managers, since they cannot be
+      // shared across threads
+      Container.forEachShard([this](size_t, llvm::Module &Shard) {
+        runOnModule(Shard);
+      });
+    } else {
+      runOnModule(Container.getModule());
+    }
+  }
+
+  template<NewPMLLVMPass T>
+  void addPass(T Pass) {
+    using Type = NewPMPassWrapper<T>;
+    Passes.emplace_back(std::make_unique<Type>(std::move(Pass)));
+  }
+
+  void addPass(std::unique_ptr<NewPMPassWrapperBase> Impl) {
+    Passes.emplace_back(std::move(Impl));
+  }
+
+  void addAnalyses(AnalysesRegistration Registration) {
+    Registrations.push_back(std::move(Registration));
+  }
+
+  void print(const Context &Ctx,
+             llvm::raw_ostream &OS,
+             llvm::ArrayRef<std::string> ContainerNames) const {
+    OS << *revng::ResourceFinder.findFile("bin/revng");
+    OS << " opt --model-path=model.yml " << ContainerNames[0] << " -o "
+       << ContainerNames[0] << " -passes=";
+    const char *Separator = "";
+    for (const auto &Pass : Passes) {
+      OS << Separator << Pass->getName();
+      Separator = ",";
+    }
+    OS << "\n";
+  }
+
+public:
+  template<typename OStream>
+  void dump(OStream &OS, size_t Indentation = 0) const {
+    for (const auto &Pass : Passes) {
+      indent(OS, Indentation);
+      OS << Pass->getName().str() << "\n";
+    }
+  }
+
+  void dump() const debug_function { dump(dbg); }
+
+private:
+  void runOnModule(llvm::Module &M) {
+    AnalysisManagers Managers;
+    for (const AnalysesRegistration &Registration : Registrations)
+      Registration(Managers);
+
+    llvm::PassBuilder Builder;
+    Builder.registerModuleAnalyses(Managers.MAM);
+    Builder.registerCGSCCAnalyses(Managers.CGAM);
+    Builder.registerFunctionAnalyses(Managers.FAM);
+    Builder.registerLoopAnalyses(Managers.LAM);
+    Builder.crossRegisterProxies(Managers.LAM,
+                                 Managers.FAM,
+                                 Managers.CGAM,
+                                 Managers.MAM);
+
+    llvm::ModulePassManager Manager;
+    for (const auto &Element : Passes)
+      Element->registerPasses(Builder, Manager);
+
+    Manager.run(M, Managers.MAM);
+  }
+};
+
+using NewPMLLVMPipe = GenericNewPMLLVMPipe<LLVMContainer>;
+
+} // namespace pipeline
@@ -9,6 +9,7 @@
 #include <utility>
 
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
 
 #include "revng/Support/Assert.h"
 #include "revng/Support/Debug.h"
@@ -17,19 +18,27 @@ namespace pipeline {
 
 /// PathComponent represents either a name or *, it's meant to represent either
 /// a single object or all possible object
+///
+/// Names are interned in a global table that is never freed, hence copying a
+/// PathComponent never allocates and two PathComponents are equal if and only
+/// if they point to the same entry of the table.
 class PathComponent {
 private:
-  std::optional<std::string> Name;
-  PathComponent() : Name(std::nullopt) {}
+  const std::string *Name;
+  PathComponent() : Name(nullptr) {}
 
 public:
-  PathComponent(std::optional<std::string> Name) : Name(std::move(Name)) {}
+  PathComponent(std::optional<std::string> Name) :
+    Name(Name.has_value() ? &intern(*Name) : nullptr) {}
 
   static PathComponent all() { return PathComponent(); }
 
+  /// \return the unique copy of \p Name in the table of path components
+  static const std::string &intern(llvm::StringRef Name);
+
 public:
-  bool isAll() const { return not Name.has_value(); }
-  bool isSingle() const { return Name.has_value(); }
+  bool isAll() const { return Name == nullptr; }
+  bool isSingle() const { return Name != nullptr; }
 
   const std::string &getName() const {
     revng_assert(isSingle());
@@ -37,29 +46,31 @@ public:
   }
 
 public:
-  bool operator<(const PathComponent &Other) const { return Name < Other.Name; }
+  bool operator<(const PathComponent &Other) const {
+    return (*this <=> Other) < 0;
+  }
 
-  bool operator<=>(const PathComponent &Other) const {
-    if (not Name.has_value() and not Other.Name.has_value())
+  int operator<=>(const PathComponent &Other) const {
+    if (Name == Other.Name)
       return 0;
-    if (not Name.has_value())
+    if (Name == nullptr)
       return -1;
-    if (not Other.Name.has_value())
+    if (Other.Name == nullptr)
       return 1;
-    return strcmp(Name->c_str(), Other.Name->c_str());
+    return Name->compare(*Other.Name);
   }
 
   bool operator==(const PathComponent &Other) const {
-    return (*this <=> Other) == 0;
+    return Name == Other.Name;
   }
 
   bool operator!=(const PathComponent &Other) const {
-    return (*this == Other) == false;
+    return Name != Other.Name;
   }
 
 public:
   std::string toString() const debug_function {
-    if (Name.has_value())
+    if (Name != nullptr)
       return *Name;
     else
       return "*";
@@ -0,0 +1,84 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace pipeline {
+
+/// The measurements taken while a pipe was running
+struct PipeExecutionRecord {
+  std::string Step;
+  std::string Pipe;
+  /// Microseconds since the creation of the profiler
+  uint64_t Start = 0;
+  uint64_t WallMicroseconds = 0;
+  /// CPU time of the whole process, hence only meaningful when pipes are not
+  /// run concurrently
+  uint64_t CPUMicroseconds = 0;
+  /// How much the peak resident set size of the process grew
+  uint64_t PeakRSSDeltaKiB = 0;
+  size_t InputTargets = 0;
+  size_t OutputTargets = 0;
+  uint64_t ThreadID = 0;
+};
+
+/// Collects a PipeExecutionRecord for every pipe run by the Runner it's
+/// attached to.
+///
+/// The collected invocations can be emitted either as a trace in the Chrome
+/// trace event format, which can be opened by chrome://tracing and Perfetto,
+/// or as a summary table aggregating them by pipe.
+class Profiler {
+private:
+  using Clock = std::chrono::steady_clock;
+
+public:
+  /// Measures a single pipe invocation, from construction to done()
+  class Measurement {
+  private:
+    Profiler &Parent;
+    PipeExecutionRecord Result;
+    Clock::time_point WallStart;
+    std::chrono::microseconds CPUStart;
+    uint64_t PeakRSSStart;
+
+  public:
+    Measurement(Profiler &Parent,
+                llvm::StringRef Step,
+                llvm::StringRef Pipe,
+                size_t InputTargets);
+
+    void done(size_t OutputTargets);
+  };
+
+private:
+  Clock::time_point Creation = Clock::now();
+  mutable std::mutex Lock;
+  std::vector<PipeExecutionRecord> Invocations;
+
+public:
+  void record(PipeExecutionRecord Invocation);
+
+  std::vector<PipeExecutionRecord> invocations() const;
+
+  void clear();
+
+public:
+  /// Writes all the invocations as Chrome trace events
+  void writeChromeTrace(llvm::raw_ostream &OS) const;
+
+  /// Prints a table with the total time spent in each pipe of each step
+  void printSummary(llvm::raw_ostream &OS) const;
+};
+
+} // namespace pipeline
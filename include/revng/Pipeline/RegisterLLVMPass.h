@@ -33,4 +33,27 @@ public:
   void libraryInitialization() override {}
 };
 
+/// Instantiate a global object of this class for each NewPMLLVMPass that you
+/// wish to register
+template<typename NewPMLLVMPass>
+class RegisterNewPMLLVMPass : Registry {
+private:
+  llvm::StringRef Name;
+
+public:
+  RegisterNewPMLLVMPass(llvm::StringRef Name) : Name(Name) {}
+  RegisterNewPMLLVMPass() : Name(NewPMLLVMPass::Name) {}
+
+  ~RegisterNewPMLLVMPass() override = default;
+
+public:
+  void registerContainersAndPipes(Loader &Loader) override {
+    Loader.registerNewPMLLVMPass<NewPMLLVMPass>(Name);
+  }
+
+  void registerKinds(KindsRegistry &KindDictionary) override {}
+
+  void libraryInitialization() override {}
+};
+
 } // namespace pipeline
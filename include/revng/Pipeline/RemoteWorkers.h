@@ -0,0 +1,139 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Support/Error.h"
+
+#include "revng/Pipeline/ContainerSet.h"
+#include "revng/Pipeline/Context.h"
+
+namespace pipeline {
+
+class Runner;
+class Step;
+
+/// A node able to run the pipes of a step on behalf of a Runner.
+///
+/// Work is exchanged through a request directory, which must be reachable
+/// both by the Runner and by the node, with the following layout:
+///
+/// * `step`: the name of the step whose pipes have to be run;
+/// * `only-containers`: if present, the names of the containers the pipes are
+///   restricted to, one per line (see Step::runPipes);
+/// * `globals`: the globals of the context, as stored by Context::storeToDisk;
+/// * `input`: the input containers, as stored by ContainerSet::storeToDisk.
+///
+/// Serving a request (see serveRemoteRequest) stores the resulting containers
+/// in `output`, in the same format as `input`.
+class RemoteWorker {
+public:
+  virtual ~RemoteWorker() = default;
+
+public:
+  virtual llvm::StringRef getName() const = 0;
+
+  /// Serves the request in \p RequestDirectory, producing its `output`
+  virtual llvm::Error execute(llvm::StringRef RequestDirectory) = 0;
+};
+
+/// A RemoteWorker running a command for each request, typically something like
+/// `ssh node revng-pipeline-worker -P pipeline.yml {}` on a shared file system.
+/// Each `{}` in the arguments is replaced by the path of the request directory.
+class CommandRemoteWorker final : public RemoteWorker {
+private:
+  std::string Name;
+  std::vector<std::string> Command;
+  unsigned TimeoutSeconds = 0;
+
+public:
+  /// \param TimeoutSeconds after how many seconds a request is considered
+  ///        failed and the command is killed, 0 means no timeout.
+  CommandRemoteWorker(std::vector<std::string> Command,
+                      unsigned TimeoutSeconds = 0);
+
+  /// Splits \p CommandLine in arguments, as a shell would do
+  static std::unique_ptr<CommandRemoteWorker>
+  fromCommandLine(llvm::StringRef CommandLine, unsigned TimeoutSeconds = 0);
+
+public:
+  llvm::StringRef getName() const override { return Name; }
+  llvm::Error execute(llvm::StringRef RequestDirectory) override;
+};
+
+/// Dispatches the execution of steps to a set of RemoteWorker, each serving a
+/// single request at a time.
+///
+/// A request failing on a worker is retried, up to MaxAttempts times overall,
+/// preferring the available workers that failed the least.
+class RemoteScheduler {
+private:
+  struct WorkerState {
+    std::unique_ptr<RemoteWorker> Worker;
+    bool Busy = false;
+    unsigned Failures = 0;
+  };
+
+private:
+  std::string ScratchDirectory;
+  std::vector<WorkerState> Workers;
+  unsigned MaxAttempts = 3;
+  std::mutex Lock;
+  std::condition_variable Released;
+  std::atomic<uint64_t> Dispatched = 0;
+  std::atomic<uint64_t> Failed = 0;
+
+public:
+  /// \param ScratchDirectory where the request directories are created, it
+  ///        must be reachable by all the workers.
+  explicit RemoteScheduler(llvm::StringRef ScratchDirectory);
+
+public:
+  void addWorker(std::unique_ptr<RemoteWorker> Worker) {
+    Workers.push_back({ std::move(Worker) });
+  }
+
+  size_t size() const { return Workers.size(); }
+  bool empty() const { return Workers.empty(); }
+
+  void setMaxAttempts(unsigned Attempts) { MaxAttempts = Attempts; }
+
+  /// \return how many requests have been sent to workers so far
+  uint64_t dispatchedCount() const { return Dispatched; }
+
+  /// \return how many requests failed on a worker so far
+  uint64_t failedCount() const { return Failed; }
+
+public:
+  /// Runs the pipes of \p ToRun on \p Input on a worker, replacing \p Input
+  /// with their result. On failure, \p Input is left untouched, and it's up
+  /// to the caller to run the pipes locally.
+  llvm::Error run(const Context &Ctx,
+                  const Step &ToRun,
+                  ContainerSet &Input,
+                  const llvm::StringSet<> *OnlyContainers);
+
+private:
+  size_t acquire();
+  void release(size_t Index, bool Succeeded);
+};
+
+/// Serves, on the worker side, a request prepared by RemoteScheduler.
+///
+/// Pipes are not allowed to change the globals: since their changes would not
+/// be sent back, the request fails if they do.
+llvm::Error serveRemoteRequest(Runner &Runner,
+                               llvm::StringRef RequestDirectory);
+
+} // namespace pipeline
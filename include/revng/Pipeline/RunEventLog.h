@@ -0,0 +1,76 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "revng/Pipeline/Target.h"
+
+namespace pipeline {
+
+class ContainerSet;
+
+/// What happened while executing a single step of a run
+struct StepEvent {
+  std::string Step;
+  /// The targets the rest of the run asked this step for
+  ContainerToTargetsMap Requested;
+  /// The requested targets found in the backing containers of this step,
+  /// which did not need to be produced again
+  ContainerToTargetsMap Available;
+  ContainerToTargetsMap Produced;
+  /// Number of targets in each container, before and after the pipes
+  llvm::StringMap<size_t> SizesBefore;
+  llvm::StringMap<size_t> SizesAfter;
+  uint64_t WallMicroseconds = 0;
+  /// True if the output of the step has been loaded from the artifact cache
+  bool Cached = false;
+};
+
+/// Writes a structured description of what a Runner does as JSON lines, one
+/// object per line, so that it can be processed by other tools.
+///
+/// Each object has a "event" attribute, which is either "request", for the
+/// targets requested to a run and how long it took to produce them, or
+/// "step", for each executed step (see StepEvent). Timestamps are in
+/// microseconds since the creation of the log.
+class RunEventLog {
+private:
+  using Clock = std::chrono::steady_clock;
+
+private:
+  llvm::raw_ostream &OS;
+  Clock::time_point Creation = Clock::now();
+  std::mutex Lock;
+
+public:
+  explicit RunEventLog(llvm::raw_ostream &OS) : OS(OS) {}
+
+public:
+  /// Microseconds elapsed since the creation of the log
+  uint64_t now() const;
+
+  void recordRequest(llvm::StringRef EndingStep,
+                     const ContainerToTargetsMap &Requested,
+                     const ContainerToTargetsMap &Available,
+                     uint64_t Start,
+                     uint64_t WallMicroseconds,
+                     bool Succeeded);
+
+  void recordStep(const StepEvent &Event, uint64_t Start);
+
+public:
+  /// Number of targets in each of the containers in \p Containers
+  static llvm::StringMap<size_t> computeSizes(const ContainerSet &Containers);
+};
+
+} // namespace pipeline
@@ -4,6 +4,8 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <functional>
+#include <optional>
 #include <string>
 #include <utility>
 
@@ -13,9 +15,13 @@
 #include "llvm/Support/Error.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include "revng/Pipeline/ArtifactCache.h"
 #include "revng/Pipeline/ContainerFactorySet.h"
 #include "revng/Pipeline/Context.h"
 #include "revng/Pipeline/KindsRegistry.h"
+#include "revng/Pipeline/Profiler.h"
+#include "revng/Pipeline/RemoteWorkers.h"
+#include "revng/Pipeline/RunEventLog.h"
 #include "revng/Pipeline/Step.h"
 #include "revng/Pipeline/Target.h"
 #include "revng/Support/Debug.h"
@@ -38,6 +44,30 @@ private:
   Map Steps;
   Vector ReversePostOrderIndexes;
 
+  unsigned Jobs = 1;
+  bool DeterministicMerge = true;
+  size_t StreamingBatchSize = 0;
+  std::optional<ArtifactCache> Cache;
+  Profiler *TheProfiler = nullptr;
+  RunEventLog *Events = nullptr;
+  RemoteScheduler *Remote = nullptr;
+
+public:
+  /// Invoked before executing each step, with the name of the step, its
+  /// position among the steps to execute and their count. Returning false
+  /// stops the run, which then fails with a `CancelledRunError`.
+  using ProgressHook = std::function<bool(llvm::StringRef StepName,
+                                          size_t Index,
+                                          size_t Count)>;
+
+private:
+  ProgressHook Progress;
+
+  unsigned ResidentStepsLimit = 0;
+  std::string EvictionDirectory;
+  uint64_t UseClock = 0;
+  llvm::StringMap<uint64_t> LastUse;
+
 public:
   template<typename T>
   using DereferenceIteratorType = ::revng::DereferenceIteratorType<T>;
@@ -63,6 +93,7 @@ public:
   }
 
   const Context &getContext() const { return *TheContext; }
+  Context &getContext() { return *TheContext; }
 
   const KindsRegistry &getKindsRegistry() const {
     return TheContext->getKindsRegistry();
@@ -112,10 +143,118 @@ public:
 
   Step &addStep(Step &&NewStep);
 
+  /// Sets how many parts of a single run request may be executed
+  /// concurrently.
+  ///
+  /// A request is split only when its targets reach the ending step through
+  /// disjoint sets of pipes and containers. Each part is executed on its own
+  /// clone of the containers, and merged back in the backing containers one at
+  /// the time. Parts using containers that share the llvm::LLVMContext (see
+  /// ContainerBase::sharesLLVMContext) run one at the time. Pipes of
+  /// different parts still share the Context, hence this is opt-in and it's
+  /// safe only for pipelines whose pipes do not race on it.
+  ///
+  /// With more than one job, loadFromDisk also loads the containers
+  /// concurrently, and invalidation events ask each kind what they invalidate
+  /// concurrently. All of them run on the threads of the global TaskScheduler.
+  void setJobs(unsigned NewJobs) { Jobs = NewJobs == 0 ? 1 : NewJobs; }
+  unsigned getJobs() const { return Jobs; }
+
+  /// When a request is split in parts (see setJobs), the output of each
+  /// part is kept aside until all the parts are done, and then merged back in
+  /// the containers of the steps in the order of the parts. This way the
+  /// content of the containers only depends on the request, not on the
+  /// scheduling, at the cost of keeping the outputs of all the steps of all
+  /// the parts in memory at the same time.
+  ///
+  /// Disabling it merges the output of each step as soon as it's produced.
+  void setDeterministicMerge(bool Enabled) { DeterministicMerge = Enabled; }
+  bool hasDeterministicMerge() const { return DeterministicMerge; }
+
+  /// Streams the requests through the steps: the requested targets are split
+  /// in batches of at most \p BatchSize targets, and a batch can run a step as
+  /// soon as it is done with the previous step and the previous batch is done
+  /// with that step. This way, for instance, the first functions can already
+  /// be isolated while the next ones are still going through EFA.
+  ///
+  /// Each batch plans its steps when the previous batch is done with the first
+  /// step, and skips the steps whose goals have been produced by the previous
+  /// batches in the meantime, hence targets shared by all the batches, such
+  /// as the lifted binary, are produced once. Batches merge their outputs in
+  /// the containers of each step in their order.
+  ///
+  /// Pipes of different steps run concurrently on the threads of the global
+  /// TaskScheduler, except for those using containers that share the
+  /// llvm::LLVMContext (see ContainerBase::sharesLLVMContext), which run one at
+  /// the time. As for setJobs, this is opt-in and it's safe only for pipelines
+  /// whose pipes do not race on the Context. The cache is not used. A batch
+  /// size of 0, the default, disables streaming.
+  void setStreamingBatchSize(size_t BatchSize) {
+    StreamingBatchSize = BatchSize;
+  }
+  size_t getStreamingBatchSize() const { return StreamingBatchSize; }
+
+  /// Enables the on disk cache of the step outputs, stored in Directory.
+  ///
+  /// When enabled, before executing a step the runner looks for an entry
+  /// keyed by the content of the input containers, the globals and the pipes
+  /// of that step, and if found it loads it instead of running the pipes.
+  /// Partitions run in parallel (see setJobs) do not use the cache.
+  void setCacheDirectory(llvm::StringRef Directory) {
+    Cache.emplace(Directory);
+  }
+
+  /// Records in Prof every pipe invocation performed by run. Prof is not
+  /// owned by the runner and can be null to stop profiling.
+  void setProfiler(Profiler *Prof) { TheProfiler = Prof; }
+  Profiler *getProfiler() const { return TheProfiler; }
+
+  /// Describes in Log every request served by run and every step it executes.
+  /// Log is not owned by the runner and can be null to stop logging.
+  void setEventLog(RunEventLog *Log) { Events = Log; }
+  RunEventLog *getEventLog() const { return Events; }
+
+  /// Runs the pipes of the steps on the workers of Scheduler rather than
+  /// locally. Steps that fail on all the attempted workers are run locally.
+  /// Scheduler is not owned by the runner and can be null to run everything
+  /// locally again.
+  void setRemoteScheduler(RemoteScheduler *Scheduler) { Remote = Scheduler; }
+  RemoteScheduler *getRemoteScheduler() const { return Remote; }
+
+  /// Installs the hook invoked by run before each step, an empty hook removes
+  /// it. When the request is split in parts (see setJobs) the hook is invoked
+  /// concurrently by each part, with the positions relative to that part.
+  void setProgressHook(ProgressHook Hook) { Progress = std::move(Hook); }
+  const ProgressHook &getProgressHook() const { return Progress; }
+
   llvm::Error run(llvm::StringRef EndingStepName,
                   const ContainerToTargetsMap &Targets,
                   llvm::raw_ostream *DiagnosticLog = nullptr);
 
+  /// After each run, keep in memory the containers of at most \p Limit steps,
+  /// evicting into \p Directory the ones of the steps that have been used
+  /// least recently. Evicted containers are loaded back upon the next access.
+  /// A limit of 0 disables eviction.
+  void setResidentStepsLimit(unsigned Limit, llvm::StringRef Directory) {
+    ResidentStepsLimit = Limit;
+    EvictionDirectory = Directory.str();
+  }
+
+  struct EvictionStatistics {
+    uint64_t Evictions = 0;
+    uint64_t Reloads = 0;
+  };
+
+  /// \return the evictions and reloads of the containers of all the steps
+  EvictionStatistics getEvictionStatistics() const {
+    EvictionStatistics Result;
+    for (const Step &Step : *this) {
+      Result.Evictions += Step.containers().evictionsCount();
+      Result.Reloads += Step.containers().reloadsCount();
+    }
+    return Result;
+  }
+
   void addContainerFactory(llvm::StringRef Name, ContainerFactory Entry) {
     ContainerFactoriesRegistry.registerContainerFactory(Name, std::move(Entry));
   }
@@ -197,6 +336,18 @@ public:
   }
 
   void dump() const debug_function { dump(dbg); }
+
+private:
+  /// Serves a run request, setting Available to the requested targets that
+  /// were already present in the ending step
+  llvm::Error runImpl(llvm::StringRef EndingStepName,
+                      const ContainerToTargetsMap &Targets,
+                      llvm::raw_ostream *DiagnosticLog,
+                      ContainerToTargetsMap &Available);
+
+  /// Marks \p EndingStepName and its predecessors as used, then evicts the
+  /// least recently used steps exceeding ResidentStepsLimit
+  llvm::Error enforceResidentStepsLimit(llvm::StringRef EndingStepName);
 };
 
 class PipelineFileMapping {
@@ -0,0 +1,273 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "revng/Pipeline/Context.h"
+#include "revng/Pipeline/LLVMGlobalKindBase.h"
+#include "revng/Support/Assert.h"
+
+namespace pipeline {
+
+/// Default number of threads used to process the shards of a
+/// ShardedLLVMContainer
+extern llvm::cl::opt<unsigned> LLVMShardJobs;
+
+namespace detail {
+
+/// A llvm::Module that lives in a llvm::LLVMContext owned by the shard itself,
+/// and can thus be manipulated concurrently with any other shard.
+class LLVMShard {
+private:
+  std::unique_ptr<llvm::LLVMContext> Context;
+  std::unique_ptr<llvm::Module> Module;
+
+public:
+  LLVMShard(std::unique_ptr<llvm::LLVMContext> Context,
+            std::unique_ptr<llvm::Module> Module) :
+    Context(std::move(Context)), Module(std::move(Module)) {}
+
+  LLVMShard(LLVMShard &&) = default;
+  LLVMShard &operator=(LLVMShard &&Other) {
+    // The module must be destroyed before the context it lives in
+    Module = std::move(Other.Module);
+    Context = std::move(Other.Context);
+    return *this;
+  }
+
+public:
+  /// Copies \p Source in a new shard, by round tripping it through bitcode
+  static LLVMShard fromModule(const llvm::Module &Source);
+
+  LLVMShard clone() const { return fromModule(*Module); }
+
+public:
+  const llvm::Module &getModule() const { return *Module; }
+  llvm::Module &getModule() { return *Module; }
+};
+
+/// Builds, in the context of \p Owner, a module with the definition of
+/// \p Owner, of all the functions transitively referenced by it for which
+/// \p IsUntracked holds, and declarations for every other referenced global.
+///
+/// The identifier of the returned module is the name of \p Owner.
+std::unique_ptr<llvm::Module>
+extractShard(const llvm::Function &Owner,
+             llvm::function_ref<bool(const llvm::Function &)> IsUntracked);
+
+/// Writes all the shards in a single multi-module bitcode file
+void writeShards(llvm::ArrayRef<const llvm::Module *> Shards,
+                 llvm::raw_ostream &OS);
+
+/// Parses a file produced by writeShards, each module in its own context
+llvm::Expected<std::vector<LLVMShard>>
+readShards(const llvm::MemoryBuffer &Buffer);
+
+/// Links a copy of all the shards into a single module living in \p Context
+std::unique_ptr<llvm::Module>
+linkShards(llvm::ArrayRef<const llvm::Module *> Shards,
+           llvm::LLVMContext &Context);
+
+/// Invokes Callback(Index, Shard) on each shard, concurrently on the
+/// TaskScheduler if Jobs is more than one
+void forEachShard(llvm::ArrayRef<llvm::Module *> Shards,
+                  llvm::function_ref<void(size_t, llvm::Module &)> Callback,
+                  unsigned Jobs);
+
+} // namespace detail
+
+/// A llvm container that, rather than keeping everything in a single module,
+/// keeps each function that belongs to a target in its own module and
+/// llvm::LLVMContext, called a shard.
+///
+/// Functions that are not associated to any target (helpers, and so on) are
+/// copied inside every shard that uses them, while any other global is only
+/// declared. This way cloneFiltered only touches the shards of the requested
+/// targets and shards can be processed concurrently.
+///
+/// Like LLVMContainerBase, the kinds that can be found in this container are
+/// expressed by extending LLVMGlobalKindBase<ShardedLLVMContainerBase<ID>>.
+template<char *TypeID>
+class ShardedLLVMContainerBase
+  : public EnumerableContainer<ShardedLLVMContainerBase<TypeID>> {
+public:
+  static const char ID;
+
+  /// Shards are made of the functions associated to a target
+  static constexpr bool TracksFunctionOwners = true;
+
+private:
+  using ThisType = ShardedLLVMContainerBase<TypeID>;
+  using InspectorT = LLVMGlobalKindBase<ThisType>;
+  using ShardsMap = std::map<std::string, detail::LLVMShard>;
+
+private:
+  ShardsMap Shards;
+
+public:
+  ShardedLLVMContainerBase(Context &Ctx, llvm::StringRef Name) :
+    EnumerableContainer<ThisType>(Ctx, Name) {}
+
+  ~ShardedLLVMContainerBase() override {}
+
+public:
+  size_t shardsCount() const { return Shards.size(); }
+
+  /// \return the shard containing the definition of \p FunctionName, if any
+  const llvm::Module *getShard(llvm::StringRef FunctionName) const {
+    auto It = Shards.find(FunctionName.str());
+    return It == Shards.end() ? nullptr : &It->second.getModule();
+  }
+
+  /// \return the functions owning a shard, that is, those associated to a
+  ///         target
+  auto functions() const {
+    const auto GetOwner = [](const auto &Entry) -> const llvm::Function & {
+      return *Entry.second.getModule().getFunction(Entry.first);
+    };
+    return llvm::map_range(Shards, GetOwner);
+  }
+
+  auto functions() {
+    this->markModified();
+    const auto GetOwner = [](auto &Entry) -> llvm::Function & {
+      return *Entry.second.getModule().getFunction(Entry.first);
+    };
+    return llvm::map_range(Shards, GetOwner);
+  }
+
+public:
+  /// Splits \p Source into shards, replacing the shards with the same name
+  void importModule(const llvm::Module &Source) {
+    this->markModified();
+    const auto IsUntracked = [](const llvm::Function &F) {
+      return not InspectorT::hasOwner(F);
+    };
+
+    for (const llvm::Function &F : Source.functions()) {
+      if (F.isDeclaration() or IsUntracked(F))
+        continue;
+
+      auto Extracted = detail::extractShard(F, IsUntracked);
+      Shards.insert_or_assign(F.getName().str(),
+                              detail::LLVMShard::fromModule(*Extracted));
+    }
+  }
+
+  /// \return a single module, living in \p Context, with the content of all
+  ///         the shards
+  std::unique_ptr<llvm::Module> linkShards(llvm::LLVMContext &Context) const {
+    return detail::linkShards(getShardModules(), Context);
+  }
+
+  /// Invokes Callback(Index, Shard) on each shard. Since each shard has its
+  /// own context, up to Jobs shards are processed concurrently.
+  void
+  forEachShard(llvm::function_ref<void(size_t, llvm::Module &)> Callback,
+               unsigned Jobs = LLVMShardJobs) {
+    this->markModified();
+    std::vector<llvm::Module *> Modules;
+    for (auto &Entry : Shards)
+      Modules.push_back(&Entry.second.getModule());
+    detail::forEachShard(Modules, Callback, Jobs);
+  }
+
+public:
+  std::unique_ptr<ContainerBase>
+  cloneFiltered(const TargetsList &Targets) const final {
+    auto ToClone = InspectorT::functions(Targets, *this->self());
+
+    auto Result = std::make_unique<ThisType>(*this->Ctx, this->name());
+    for (const auto &[Name, Shard] : Shards) {
+      const llvm::Function *Owner = Shard.getModule().getFunction(Name);
+      if (ToClone.count(Owner) != 0)
+        Result->Shards.emplace(Name, Shard.clone());
+    }
+
+    return Result;
+  }
+
+  llvm::Error serialize(llvm::raw_ostream &OS) const final {
+    detail::writeShards(getShardModules(), OS);
+    OS.flush();
+    return llvm::Error::success();
+  }
+
+protected:
+  bool removeImpl(const TargetsList &Targets) final {
+    bool RemovedAll = EnumerableContainer<ThisType>::removeImpl(Targets);
+
+    // Removing a target deletes the body of its function, drop the shard
+    for (auto It = Shards.begin(); It != Shards.end();) {
+      if (It->second.getModule().getFunction(It->first)->isDeclaration())
+        It = Shards.erase(It);
+      else
+        ++It;
+    }
+
+    return RemovedAll;
+  }
+
+  llvm::Error deserializeImpl(const llvm::MemoryBuffer &Buffer) final {
+    auto MaybeShards = detail::readShards(Buffer);
+    if (not MaybeShards)
+      return MaybeShards.takeError();
+
+    Shards.clear();
+    for (detail::LLVMShard &Shard : *MaybeShards) {
+      std::string Name = Shard.getModule().getModuleIdentifier();
+      Shards.insert_or_assign(std::move(Name), std::move(Shard));
+    }
+
+    return llvm::Error::success();
+  }
+
+  void clearImpl() final { Shards.clear(); }
+
+private:
+  std::vector<const llvm::Module *> getShardModules() const {
+    std::vector<const llvm::Module *> Result;
+    for (const auto &Entry : Shards)
+      Result.push_back(&Entry.second.getModule());
+    return Result;
+  }
+
+  void mergeBackImpl(ThisType &&Other) final {
+    for (auto &Entry : Other.Shards)
+      Shards.insert_or_assign(Entry.first, std::move(Entry.second));
+    Other.Shards.clear();
+  }
+};
+
+extern char ShardedLLVMContainerTypeID;
+
+using ShardedLLVMContainer = ShardedLLVMContainerBase<
+  &ShardedLLVMContainerTypeID>;
+using ShardedLLVMKind = LLVMGlobalKindBase<ShardedLLVMContainer>;
+
+/// Returns a factory of empty ShardedLLVMContainers
+template<typename ShardedContainerType>
+ContainerFactory makeShardedLLVMContainerFactory(pipeline::Context &Ctx) {
+  return [&Ctx](llvm::StringRef Name) {
+    return std::make_unique<ShardedContainerType>(Ctx, Name);
+  };
+}
+
+} // namespace pipeline
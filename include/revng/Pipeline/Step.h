@@ -4,7 +4,10 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <set>
 #include <string>
 #include <type_traits>
@@ -12,8 +15,11 @@
 #include <vector>
 
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/ScopeExit.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/ADT/iterator_range.h"
 #include "llvm/Support/Error.h"
 
@@ -21,7 +27,9 @@
 #include "revng/Pipeline/ContainerSet.h"
 #include "revng/Pipeline/Context.h"
 #include "revng/Pipeline/Contract.h"
+#include "revng/Pipeline/InvalidationIndex.h"
 #include "revng/Pipeline/Pipe.h"
+#include "revng/Pipeline/Profiler.h"
 #include "revng/Support/Assert.h"
 #include "revng/Support/Debug.h"
 
@@ -31,11 +39,26 @@ namespace pipeline {
 /// Furthermore a step has a set of containers associated to it as well that
 /// will contain the element used for perform the computations.
 class Step {
+private:
+  /// Memoized results of deduceResults, which only depend on the pipes
+  class DeductionsCache {
+  public:
+    std::mutex Lock;
+    std::map<std::string, ContainerToTargetsMap> Entries;
+  };
+
 private:
   std::string Name;
   ContainerSet Containers;
   std::vector<PipeWrapper> Pipes;
   Step *PreviousStep;
+  InvalidationIndex Index;
+  std::unique_ptr<DeductionsCache> Deductions;
+
+  /// The backing containers, and their versions, as of the last change Index
+  /// has been kept up to date with
+  using ContainerState = std::pair<const ContainerBase *, uint64_t>;
+  llvm::StringMap<ContainerState> IndexedContainers;
 
 public:
   template<typename... PipeWrapperTypes>
@@ -45,7 +68,8 @@ public:
     Name(std::move(Name)),
     Containers(std::move(Containers)),
     Pipes({ std::forward<PipeWrapperTypes>(PipeWrappers)... }),
-    PreviousStep(nullptr) {}
+    PreviousStep(nullptr),
+    Deductions(std::make_unique<DeductionsCache>()) {}
 
   template<typename... PipeWrapperTypes>
   Step(std::string Name,
@@ -55,13 +79,21 @@ public:
     Name(std::move(Name)),
     Containers(std::move(Containers)),
     Pipes({ std::forward<PipeWrapperTypes>(PipeWrappers)... }),
-    PreviousStep(&PreviousStep) {}
+    PreviousStep(&PreviousStep),
+    Deductions(std::make_unique<DeductionsCache>()) {}
 
 public:
   llvm::StringRef getName() const { return Name; }
   const ContainerSet &containers() const { return Containers; }
+
+  /// Changes made to the containers through the returned reference are
+  /// detected through their versions: as soon as they are spotted, the
+  /// invalidation index of this step is no longer used.
   ContainerSet &containers() { return Containers; }
 
+  const InvalidationIndex &invalidationIndex() const { return Index; }
+  const std::vector<PipeWrapper> &pipes() const { return Pipes; }
+
 public:
   bool hasPredecessor() const { return PreviousStep != nullptr; }
 
@@ -85,19 +117,70 @@ public:
                            ContainerSet &&Targets,
                            llvm::raw_ostream *OS = nullptr);
 
-  /// Returns the set of goals that are already contained in the backing
+  /// Executes in sequence, in place on Input, all the pipes of this step whose
+  /// requirements are met. If OnlyContainers is not null, pipes that operate
+  /// on containers outside of that set are skipped. If Prof is not null, each
+  /// pipe invocation is recorded in it.
+  ///
+  /// The backing containers of this step are not touched.
+  void runPipes(Context &Ctx,
+                ContainerSet &Input,
+                const llvm::StringSet<> *OnlyContainers = nullptr,
+                llvm::raw_ostream *OS = nullptr,
+                Profiler *Prof = nullptr);
+
+  /// Returns a clone of the Targets available in the backing containers of
+  /// this step. If OnlyContainers is not null, containers outside of that set
+  /// are not cloned.
+  ContainerSet cloneFiltered(const ContainerToTargetsMap &Targets,
+                             const llvm::StringSet<> *OnlyContainers =
+                               nullptr) {
+    return Containers.cloneFiltered(Targets, OnlyContainers);
+  }
+
+  /// Merges Input into the backing containers of this step
+  void mergeBack(ContainerSet &&Input);
+
+  /// Merges Input into the backing containers of this step and returns a
+  /// clone of the Produced targets of Input. If OnlyContainers is not null,
+  /// containers outside of that set are not cloned.
+  ContainerSet mergeAndCloneFiltered(ContainerSet &&Input,
+                                     const ContainerToTargetsMap &Produced,
+                                     const llvm::StringSet<> *OnlyContainers =
+                                       nullptr);
+
+  /// Returns the set of goals that are not already contained in the backing
   /// containers of this step, futhermore adds to the container ToLoad those
-  /// that were not present.
+  /// that were present. The pipes are not inspected at all if every goal is
+  /// already available.
   ContainerToTargetsMap
   analyzeGoals(const ContainerToTargetsMap &RequiredGoals,
                ContainerToTargetsMap &AlreadyAvbiable) const;
 
   /// Returns the predicted state of the Input containers status after the
   /// execution of all the pipes in this step.
+  ///
+  /// Results are memoized, hence asking again for the same Input is cheap.
   ContainerToTargetsMap deduceResults(ContainerToTargetsMap Input) const;
 
+  /// Records in the invalidation index of this step that the Produced
+  /// targets, now available in the backing containers, have been obtained by
+  /// running the pipes on the Input targets of the predecessor.
+  void recordDependencies(const ContainerToTargetsMap &Input,
+                          const ContainerToTargetsMap &Produced);
+
+  /// \return the targets of this step produced from any of the Invalidated
+  ///         targets of the predecessor, or std::nullopt if the invalidation
+  ///         index cannot tell, see InvalidationIndex::dependentsOf
+  std::optional<ContainerToTargetsMap>
+  dependentsOf(const ContainerToTargetsMap &Invalidated) const;
+
 public:
-  void addPipe(PipeWrapper Wrapper) { Pipes.push_back(std::move(Wrapper)); }
+  void addPipe(PipeWrapper Wrapper) {
+    Pipes.push_back(std::move(Wrapper));
+    std::lock_guard<std::mutex> Guard(Deductions->Lock);
+    Deductions->Entries.clear();
+  }
 
   /// Drops from the backing containers all the targets presents in containers
   /// status
@@ -107,6 +190,14 @@ public:
   llvm::Error storeToDisk(llvm::StringRef DirPath) const;
   llvm::Error loadFromDisk(llvm::StringRef DirPath);
 
+  /// \see ContainerSet::prepareLoadFromDisk
+  std::vector<ContainerSet::LoadRequest>
+  prepareLoadFromDisk(llvm::StringRef DirPath);
+
+  /// Stores the containers in the same layout as storeToDisk, and releases
+  /// them. They are loaded back upon the next access.
+  llvm::Error evict(llvm::StringRef DirPath);
+
 public:
   template<typename OStream>
   void dump(OStream &OS, size_t Indentation = 0) const {
@@ -123,6 +214,24 @@ public:
     Containers.dump(OS, Indentation + 2);
   }
 
+private:
+  /// \return true if the backing containers did not change since the last
+  ///         change Index has been kept up to date with
+  bool isIndexUpToDate() const;
+
+  /// Applies Change to the backing containers, which Index is then kept up to
+  /// date with, unless they have been changed from the outside in the meantime
+  template<typename CallableType>
+  auto changeContainers(CallableType &&Change) {
+    if (not isIndexUpToDate())
+      Index.markIncomplete();
+
+    auto Snapshot = llvm::make_scope_exit([this] { snapshotContainers(); });
+    return Change();
+  }
+
+  void snapshotContainers();
+
   void dump() const debug_function { dump(dbg); }
 
 private:
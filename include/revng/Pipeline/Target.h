@@ -103,7 +103,11 @@ public:
 
   int operator<=>(const Target &Other) const;
 
-  bool operator==(const Target &Other) const { return (*this <=> Other) == 0; }
+  /// Since path components are interned, this never compares strings
+  bool operator==(const Target &Other) const {
+    return K == Other.K and Exact == Other.Exact
+           and Components == Other.Components;
+  }
 
 public:
   const Kind &getKind() const { return *K; }
@@ -335,6 +339,22 @@ llvm::Error parseTarget(ContainerToTargetsMap &CurrentStatus,
                         llvm::StringRef AsString,
                         const KindsRegistry &Dict);
 
+class ContainerSet;
+
+/// \brief Parse a batch of strings in the form <ContainerName:Target>
+///
+/// Unlike calling parseTarget on each string, which sorts the list of targets
+/// of the container at each insertion, the targets of each container are
+/// sorted once.
+///
+/// The path components of a target can be glob patterns, such as `f*`: a
+/// pattern is replaced by all the targets of its kind, currently in
+/// \p Containers, whose path components match.
+llvm::Error parseTargets(ContainerToTargetsMap &CurrentStatus,
+                         llvm::ArrayRef<std::string> AsStrings,
+                         const KindsRegistry &Dict,
+                         const ContainerSet &Containers);
+
 void prettyPrintTarget(const Target &Target,
                        llvm::raw_ostream &OS,
                        size_t Indentation = 0);
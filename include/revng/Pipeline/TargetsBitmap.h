@@ -0,0 +1,141 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/Hashing.h"
+
+#include "revng/Pipeline/Target.h"
+#include "revng/Support/Assert.h"
+
+namespace pipeline {
+
+/// An immutable, indexed list of distinct targets with no `*` component, e.g.,
+/// one for each function of a module.
+///
+/// It is the set of all the targets representable by the TargetsBitmaps built
+/// upon it.
+class TargetsUniverse {
+private:
+  struct TargetHash {
+    size_t operator()(const Target &T) const {
+      size_t Result = llvm::hash_value(&T.getKind());
+      for (const PathComponent &Component : T.getPathComponents())
+        Result = llvm::hash_combine(Result, &Component.getName());
+      return Result;
+    }
+  };
+
+private:
+  std::vector<Target> Targets;
+  std::unordered_map<Target, size_t, TargetHash> Indexes;
+
+public:
+  explicit TargetsUniverse(std::vector<Target> Targets);
+
+public:
+  size_t size() const { return Targets.size(); }
+  const Target &operator[](size_t Index) const { return Targets[Index]; }
+
+  /// \return the index of \p T, if it's part of the universe
+  std::optional<size_t> indexOf(const Target &T) const;
+
+public:
+  static bool isExact(const Target &T) {
+    const auto IsSingle = [](const PathComponent &C) { return C.isSingle(); };
+    return T.kindExactness() == Exactness::Exact
+           and llvm::all_of(T.getPathComponents(), IsSingle);
+  }
+};
+
+/// A set of targets drawn from a TargetsUniverse, represented as a bitmap over
+/// the indexes of the universe.
+///
+/// Unlike a TargetsList, set operations cost a few bitwise operations per
+/// element of the universe, lookups of exact targets are hash table lookups
+/// and no Target is ever allocated.
+class TargetsBitmap {
+private:
+  std::shared_ptr<const TargetsUniverse> Universe;
+  llvm::BitVector Bits;
+
+public:
+  explicit TargetsBitmap(std::shared_ptr<const TargetsUniverse> Universe) :
+    Universe(std::move(Universe)), Bits(this->Universe->size()) {}
+
+  /// \return a bitmap holding all the targets of \p Universe
+  static TargetsBitmap all(std::shared_ptr<const TargetsUniverse> Universe) {
+    TargetsBitmap Result(std::move(Universe));
+    Result.Bits.set();
+    return Result;
+  }
+
+public:
+  const TargetsUniverse &universe() const { return *Universe; }
+
+  size_t count() const { return Bits.count(); }
+  bool empty() const { return Bits.none(); }
+
+  bool test(size_t Index) const { return Bits.test(Index); }
+  void set(size_t Index) { Bits.set(Index); }
+  void reset(size_t Index) { Bits.reset(Index); }
+
+  /// \return the indexes of the targets in the set
+  auto indexes() const { return Bits.set_bits(); }
+
+public:
+  /// Adds \p T to the set
+  ///
+  /// \return false if \p T is not part of the universe
+  bool insert(const Target &T);
+
+  /// Adds to the set all the targets of the universe that satisfy a target of
+  /// \p Targets
+  void insert(const TargetsList &Targets);
+
+  /// \return true if a target in the set satisfies \p T, with the same
+  ///         semantic of TargetsList::contains
+  bool contains(const Target &T) const;
+
+  /// \return true if every target of \p Other is in the set
+  bool contains(const TargetsBitmap &Other) const {
+    revng_assert(Universe == Other.Universe);
+    llvm::BitVector Missing = Other.Bits;
+    Missing.reset(Bits);
+    return Missing.none();
+  }
+
+public:
+  void merge(const TargetsBitmap &Other) {
+    revng_assert(Universe == Other.Universe);
+    Bits |= Other.Bits;
+  }
+
+  void intersect(const TargetsBitmap &Other) {
+    revng_assert(Universe == Other.Universe);
+    Bits &= Other.Bits;
+  }
+
+  void subtract(const TargetsBitmap &Other) {
+    revng_assert(Universe == Other.Universe);
+    Bits.reset(Other.Bits);
+  }
+
+public:
+  /// Materializes the set
+  TargetsList toList() const;
+
+  bool operator==(const TargetsBitmap &Other) const {
+    return Universe == Other.Universe and Bits == Other.Bits;
+  }
+};
+
+} // namespace pipeline
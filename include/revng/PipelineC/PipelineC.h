@@ -6,6 +6,8 @@
 #ifdef __cplusplus
 #include <cstdint>
 
+#include "llvm/ADT/SmallVector.h"
+
 #include "revng/Pipeline/Container.h"
 #include "revng/Pipeline/Kind.h"
 #include "revng/Pipeline/Runner.h"
@@ -61,6 +63,14 @@ typedef const pipeline::TargetsList rp_targets_list;
 typedef struct rp_targets_list rp_targets_list;
 #endif
 
+#ifdef __cplusplus
+typedef llvm::SmallVector<char, 0> rp_buffer;
+#else
+typedef struct rp_buffer rp_buffer;
+#endif
+
+typedef struct rp_job rp_job;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -96,11 +106,31 @@ bool rp_initialize(int argc,
                    int libraries_count,
                    const char *libraries_path[]);
 
+/**
+ * Run the parallel parts of revng on count threads, 0 means one per core. By
+ * default, the -revng-threads option passed to rp_initialize is used, or the
+ * REVNG_THREADS environment variable.
+ *
+ * Waits for the running job, if any. Must not be invoked concurrently with
+ * other rp_* functions.
+ */
+void rp_set_threads_count(uint64_t count);
+
 /**
  * Free a string return by a rp_*_create_* method.
  */
 void rp_string_destroy(char *string);
 
+/**
+ * \return the current value of all the statistics collected by revng, in the
+ *         same format used to print them upon exit when -statistics is
+ *         specified. Safe to call while other threads record statistics.
+ *
+ * \note The returned string must be freed by the caller with
+ *       rp_string_destroy.
+ */
+char *rp_statistics_create_dump(void);
+
 /**
  * \defgroup rp_manager rp_manager methods
  * \{
@@ -160,8 +190,11 @@ uint64_t rp_manager_containers_count(rp_manager *manager);
 /**
  * Applies the diff to the model and triggers a ModelInvalidationEvent
  *
+ * \return false if the diff cannot be parsed or if the resulting model does
+ *         not verify. In this case, neither the model nor the pipeline are
+ *         changed.
  */
-void rp_apply_model_diff(rp_manager *manager, const char *diff);
+bool rp_apply_model_diff(rp_manager *manager, const char *diff);
 
 /**
  * \param index must be less than rp_manager_containers_count(manager).
@@ -211,6 +244,28 @@ bool rp_manager_set_global(rp_manager *manager,
                            const char *serialized,
                            const char *global_name);
 
+/**
+ * Keep in memory the containers of at most limit steps, evicting into
+ * directory the ones of the least recently used steps at the end of each
+ * request. Evicted containers are loaded back when accessed again. A limit of
+ * 0 disables eviction.
+ *
+ * \return true on success
+ */
+bool rp_manager_set_resident_steps_limit(rp_manager *manager,
+                                         uint64_t limit,
+                                         const char *directory);
+
+/**
+ * \return how many containers have been evicted so far
+ */
+uint64_t rp_manager_get_evictions_count(rp_manager *manager);
+
+/**
+ * \return how many evicted containers have been loaded back so far
+ */
+uint64_t rp_manager_get_reloads_count(rp_manager *manager);
+
 /**
  * \return the kind with the provided name, NULL if no kind had the provided
  *         name.
@@ -255,6 +310,99 @@ char *rp_manager_create_container_path(rp_manager *manager,
 
 /** \} */
 
+/**
+ * \defgroup rp_job rp_job methods
+ * \{
+ *
+ * A job produces asynchronously, on a background thread, a set of targets
+ * spanning any number of containers. Jobs of the same process are executed one
+ * at the time.
+ *
+ * While a job is running, the functions modifying its manager wait for it to
+ * complete. The following queries can be invoked from other threads and are
+ * answered without waiting, reflecting the state before the job started:
+ * rp_target_is_ready, rp_manager_get_container_targets_list and
+ * rp_manager_create_global_copy of the model. rp_container_get_name never
+ * waits. Other functions reading the manager, such as
+ * rp_container_create_buffer and rp_step_get_container, wait for the job to
+ * complete, therefore they must not be invoked from its progress callback. The
+ * same holds for rp_manager_produce_targets.
+ */
+
+typedef enum {
+  RP_JOB_RUNNING,
+  RP_JOB_SUCCEEDED,
+  RP_JOB_FAILED,
+  RP_JOB_CANCELLED
+} rp_job_status;
+
+/**
+ * Invoked from the background thread before executing each step of a job,
+ * with the name of the step, its position among the steps to execute and
+ * their count. Invocations of the same job never overlap.
+ *
+ * \return false to cancel the job, as rp_job_cancel does.
+ */
+typedef bool (*rp_progress_callback)(const char *step_name,
+                                     uint64_t index,
+                                     uint64_t count,
+                                     void *user_data);
+
+/**
+ * Request the production of \p targets at the provided step, each in the
+ * corresponding element of \p containers. Targets are copied, hence they can
+ * be destroyed as soon as this function returns.
+ *
+ * \param targets_count must be equal to the size of \p targets and
+ *                      \p containers.
+ * \param callback can be NULL.
+ * \param user_data is passed as is to \p callback.
+ *
+ * \return the submitted job, to be destroyed with rp_job_destroy.
+ */
+rp_job *rp_manager_submit_job(rp_manager *manager,
+                              rp_step *step,
+                              uint64_t targets_count,
+                              rp_target *targets[],
+                              rp_container *containers[],
+                              rp_progress_callback callback,
+                              void *user_data);
+
+/**
+ * \return the status of \p job, without waiting for it.
+ */
+rp_job_status rp_job_poll(rp_job *job);
+
+/**
+ * Wait for \p job to be completed.
+ *
+ * \return the final status of \p job.
+ */
+rp_job_status rp_job_wait(rp_job *job);
+
+/**
+ * Request to stop \p job before its next step. The job might still succeed,
+ * if it was already executing its last step.
+ */
+void rp_job_cancel(rp_job *job);
+
+/**
+ * \return the part of \p container produced by a job which succeeded,
+ *         serialized, or NULL if the job did not succeed or no target was
+ *         requested in \p container.
+ *
+ * \note The returned string must be freed by the caller with
+ *       rp_string_destroy.
+ */
+char *rp_job_create_serialized_container(rp_job *job, rp_container *container);
+
+/**
+ * Cancel \p job, wait for it and destroy it.
+ */
+void rp_job_destroy(rp_job *job);
+
+/** \} */
+
 /**
  * \defgroup rp_targets_list rp_targets_list methods
  * \{
@@ -374,7 +522,7 @@ const char *rp_target_get_path_component(rp_target *target, uint64_t index);
 
 /**
  * \return true if the provided target is currently cached in the provided
- * container. False otherwise
+ * container, even if the container has been evicted. False otherwise
  */
 bool rp_target_is_ready(rp_target *target, rp_container *container);
 
@@ -424,6 +572,65 @@ bool rp_container_load(rp_container *container, const char *path);
 
 /** \} */
 
+/**
+ * Serialize \p container in memory, without going through the filesystem.
+ *
+ * \param targets_count the size of \p targets. If 0, the whole container is
+ *                      serialized and \p targets can be NULL.
+ * \param targets the targets to serialize, the rest of the container is left
+ *                out.
+ *
+ * \return the serialized container, NULL if an error was encountered. Destroy
+ *         with rp_buffer_destroy.
+ */
+rp_buffer *rp_container_create_buffer(rp_container *container,
+                                      uint64_t targets_count,
+                                      rp_target *targets[]);
+
+/**
+ * Like rp_container_create_buffer, but serializes into \p buffer, which is
+ * \p buffer_size bytes long. Nothing is written if it's not large enough.
+ *
+ * \param buffer can be NULL if \p buffer_size is 0, to query the size.
+ *
+ * \return the size of the serialized container, which might be larger than
+ *         \p buffer_size, or RP_SERIALIZATION_FAILED if an error was
+ *         encountered.
+ */
+uint64_t rp_container_serialize(rp_container *container,
+                                uint64_t targets_count,
+                                rp_target *targets[],
+                                char *buffer,
+                                uint64_t buffer_size);
+
+const inline uint64_t RP_SERIALIZATION_FAILED = UINT64_MAX;
+
+/** \} */
+
+/**
+ * \defgroup rp_buffer rp_buffer methods
+ * \{
+ */
+
+/**
+ * \return the content of \p buffer, which is not NUL-terminated.
+ *
+ * \note The returned pointer is valid until \p buffer is destroyed.
+ */
+const char *rp_buffer_data(rp_buffer *buffer);
+
+/**
+ * \return the size in bytes of the content of \p buffer.
+ */
+uint64_t rp_buffer_size(rp_buffer *buffer);
+
+/**
+ * Delete a buffer returned by rp_container_create_buffer.
+ */
+void rp_buffer_destroy(rp_buffer *buffer);
+
+/** \} */
+
 #ifdef __cplusplus
 } // extern C
 #endif
@@ -7,6 +7,7 @@
 #include <string>
 
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
 
 #include "revng/Pipeline/ContainerSet.h"
 #include "revng/Pipeline/Context.h"
@@ -20,8 +21,27 @@
 #include "revng/Pipes/RootKind.h"
 #include "revng/Pipes/TaggedFunctionKind.h"
 
+namespace llvm {
+class TargetMachine;
+} // namespace llvm
+
 namespace revng::pipes {
 
+/// \brief Compute the key of the object of \p Bitcode in `-compile-cache-dir`
+///
+/// The key covers the bitcode and everything affecting the code \p TM
+/// generates for it: the target, the optimization level, the target options
+/// and the backend options set by the compile pipes.
+std::string computeObjectCacheKey(llvm::StringRef Bitcode,
+                                  const llvm::TargetMachine &TM);
+
+/// \brief Combine \p Objects in the relocatable object \p OutputPath
+///
+/// The objects are linked through the compiler driver found by ProgramRunner,
+/// as in `c++ -r`.
+void linkRelocatableObject(llvm::ArrayRef<std::string> Objects,
+                           llvm::StringRef OutputPath);
+
 class CompileModulePipe {
 public:
   static constexpr auto Name = "Compile";
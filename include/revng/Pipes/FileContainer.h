@@ -3,8 +3,10 @@
 //
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
+#include <memory>
 #include <optional>
 
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 
 #include "revng/Pipeline/ContainerSet.h"
@@ -19,6 +21,10 @@ namespace revng::pipes {
 /// currently no file associated to a instance of Temporary file, and will
 /// return The target ("root", K) otherwise, where K is the kind provided at
 /// construction time.
+///
+/// Copies of the file (clones, stores and loads) are reflinks when the
+/// filesystem supports them, so that large files such as the input binary are
+/// not duplicated on disk until one of the copies is modified.
 class FileContainer : public pipeline::Container<FileContainer> {
 private:
   llvm::SmallString<32> Path;
@@ -42,15 +48,9 @@ public:
 
   pipeline::TargetsList enumerate() const final;
 
-  bool remove(const pipeline::TargetsList &Target) final;
-
   llvm::Error storeToDisk(llvm::StringRef Path) const override;
 
-  llvm::Error loadFromDisk(llvm::StringRef Path) override;
-
-  void clear() override;
   llvm::Error serialize(llvm::raw_ostream &OS) const override;
-  llvm::Error deserialize(const llvm::MemoryBuffer &Buffer) override;
 
 public:
   std::optional<llvm::StringRef> path() const {
@@ -59,15 +59,30 @@ public:
     return llvm::StringRef(Path);
   }
 
+  /// \note the caller is expected to write to the returned path, hence this
+  ///       marks the container as modified.
   llvm::StringRef getOrCreatePath();
 
+  /// \brief Get a read-only view of the content of the file
+  ///
+  /// The file is memory-mapped, unless it's too small to be worth it.
+  ///
+  /// \note the file must exist.
+  llvm::Expected<std::unique_ptr<llvm::MemoryBuffer>> getBuffer() const;
+
   bool exists() const { return not Path.empty(); }
 
   void dump() const debug_function { dbg << Path.data() << "\n"; }
 
+protected:
+  bool removeImpl(const pipeline::TargetsList &Target) final;
+  llvm::Error loadFromDiskImpl(llvm::StringRef Path) override;
+  void clearImpl() override;
+  llvm::Error deserializeImpl(const llvm::MemoryBuffer &Buffer) override;
+
 private:
   void mergeBackImpl(FileContainer &&Container) override;
-  void remove();
+  void removeFile();
   pipeline::Target getOnlyPossibleTarget() const {
     return pipeline::Target({}, *K);
   }
@@ -19,8 +19,10 @@ inline pipeline::Kind Binary("Binary", &RootRank);
 inline RootKind Root("Root", &RootRank);
 inline IsolatedRootKind IsolatedRoot("IsolatedRoot", Root);
 
+// Isolation does not depend on prototypes: all the isolated functions have the
+// same type
 inline TaggedFunctionKind
-  Isolated("Isolated", &FunctionsRank, FunctionTags::Isolated);
+  Isolated("Isolated", &FunctionsRank, FunctionTags::Isolated, false);
 inline TaggedFunctionKind
   ABIEnforced("ABIEnforced", &FunctionsRank, FunctionTags::ABIEnforced);
 inline TaggedFunctionKind
@@ -5,9 +5,13 @@
 //
 
 #include <array>
+#include <memory>
+#include <mutex>
 
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
 
 #include "revng/Model/Binary.h"
 #include "revng/Model/LoadModelPass.h"
@@ -47,8 +51,22 @@ public:
   }
   void clear() final {}
 
+  /// \brief Get the module at \p Path, parsing it in this context only the
+  ///        first time
+  ///
+  /// Meant for modules that do not change while the process is running, such
+  /// as the support modules. The returned module is shared: clone it before
+  /// linking it somewhere.
+  ///
+  /// \note Safe to call from multiple threads.
+  const llvm::Module &getCachedModule(llvm::StringRef Path);
+
 private:
   llvm::LLVMContext Ctx;
+
+  /// Declared after Ctx, since modules must be destroyed before their context
+  llvm::StringMap<std::unique_ptr<llvm::Module>> CachedModules;
+  std::mutex CachedModulesLock;
 };
 
 } // namespace revng::pipes
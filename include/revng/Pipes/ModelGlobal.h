@@ -4,6 +4,10 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 
@@ -21,15 +25,47 @@
 
 namespace revng::pipes {
 
+/// \brief Pipeline global holding the model
+///
+/// Besides the working copy of the model, which writers modify in place,
+/// ModelGlobal can hand out immutable snapshots of it. A snapshot is shared by
+/// all the readers of the same version of the model and it's never modified:
+/// any non-const access to the working copy bumps the version and detaches it
+/// from the current snapshot, which stays alive as long as someone holds it.
+///
+/// This enables readers to run against a stable model while writers commit
+/// new versions.
+///
+/// \note taking a snapshot copies the working copy, if it changed since the
+///       last snapshot, therefore it must not happen concurrently with a
+///       writer.
 class ModelGlobal : public pipeline::SavableObject<ModelGlobal> {
+public:
+  using Snapshot = std::shared_ptr<const TupleTree<model::Binary>>;
+
 private:
   TupleTree<model::Binary> Model;
+  uint64_t Version = 0;
+
+  /// Protects LastSnapshot
+  mutable std::mutex SnapshotLock;
+
+  /// The snapshot of the current version, if one has been requested
+  mutable Snapshot LastSnapshot;
 
 public:
   constexpr static const char *Name = "model.yml";
   static const char ID;
-  void clear() final { Model = TupleTree<model::Binary>(); }
+  void clear() final {
+    Model = TupleTree<model::Binary>();
+    newVersion();
+  }
   llvm::Error serialize(llvm::raw_ostream &OS) const final;
+
+  /// \brief Serialize \p Model in the format used by serialize, e.g., to
+  ///        serialize a snapshot
+  static void serialize(const TupleTree<model::Binary> &Model,
+                        llvm::raw_ostream &OS);
   llvm::Error deserialize(const llvm::MemoryBuffer &Buffer) final;
 
   explicit ModelGlobal(TupleTree<model::Binary> Model) :
@@ -37,14 +73,47 @@ public:
   ModelGlobal() = default;
 
   const TupleTree<model::Binary> &getModelWrapper() const { return Model; }
-  TupleTree<model::Binary> &getModel() { return Model; }
+
+  /// \brief Access the working copy for writing, starting a new version
+  TupleTree<model::Binary> &getModel() {
+    newVersion();
+    return Model;
+  }
+
+  /// \brief Get an immutable snapshot of the current version of the model
+  Snapshot getSnapshot() const {
+    std::lock_guard<std::mutex> Guard(SnapshotLock);
+    if (LastSnapshot == nullptr) {
+      using Tree = TupleTree<model::Binary>;
+      LastSnapshot = std::make_shared<const Tree>(Model.clone());
+    }
+    return LastSnapshot;
+  }
+
+  /// \brief A counter incremented each time the model might have changed
+  uint64_t getVersion() const { return Version; }
+
+private:
+  void newVersion() {
+    std::lock_guard<std::mutex> Guard(SnapshotLock);
+    ++Version;
+    LastSnapshot.reset();
+  }
 };
 
 inline const TupleTree<model::Binary> &
 getModelFromContext(const pipeline::Context &Ctx) {
   using Wrapper = ModelGlobal;
   const auto &Model = llvm::cantFail(Ctx.getGlobal<Wrapper>(Wrapper::Name));
-  return Model->getModel();
+  return Model->getModelWrapper();
+}
+
+/// \brief Get a snapshot of the model which will not change while it's held
+inline ModelGlobal::Snapshot
+getModelSnapshotFromContext(const pipeline::Context &Ctx) {
+  using Wrapper = ModelGlobal;
+  const auto &Model = llvm::cantFail(Ctx.getGlobal<Wrapper>(Wrapper::Name));
+  return Model->getSnapshot();
 }
 
 inline TupleTree<model::Binary> &
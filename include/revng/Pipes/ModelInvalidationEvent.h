@@ -4,30 +4,63 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+
 #include "revng/Model/Binary.h"
 #include "revng/Pipeline/InvalidationEvent.h"
 #include "revng/TupleTree/TupleTreeDiff.h"
 
 namespace revng::pipes {
 
+/// Invalidation event triggered by a change to the model
+///
+/// The paths of the changes are serialized once, when the event is created,
+/// and kept sorted so that kinds can look only at the changes under the paths
+/// they depend upon. Since the event is immutable, kinds can inspect it
+/// concurrently.
 class ModelInvalidationEvent
   : public pipeline::InvalidationEvent<ModelInvalidationEvent> {
 private:
   TupleTreeDiff<model::Binary> Diff;
 
+  /// The path of each change, in the order of Diff.Changes
+  std::vector<std::string> ChangedPaths;
+
+  /// ChangedPaths, sorted
+  std::vector<std::string> SortedPaths;
+
 public:
   static char ID;
 
 public:
   explicit ModelInvalidationEvent(TupleTreeDiff<model::Binary> &&Diff) :
-    Diff(std::move(Diff)) {}
+    Diff(std::move(Diff)) {
+    indexPaths();
+  }
 
   explicit ModelInvalidationEvent(const TupleTreeDiff<model::Binary> &Diff) :
-    Diff(Diff) {}
+    Diff(Diff) {
+    indexPaths();
+  }
 
 public:
   ~ModelInvalidationEvent() override = default;
 
-  const TupleTreeDiff<model::Binary> getDiff() const { return Diff; }
+  const TupleTreeDiff<model::Binary> &getDiff() const { return Diff; }
+
+  /// \return the path of each change, e.g., "/Functions/0x1000:Code_x86_64"
+  llvm::ArrayRef<std::string> getChangedPaths() const { return ChangedPaths; }
+
+  /// \return true if a change affects \p Prefix or anything below it. \p Prefix
+  ///         must be a path such as "/ExtraCodeAddresses".
+  bool hasChangesUnder(llvm::StringRef Prefix) const;
+
+private:
+  void indexPaths();
 };
+
 } // namespace revng::pipes
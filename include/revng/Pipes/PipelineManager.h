@@ -37,10 +37,15 @@ private:
   std::unique_ptr<pipeline::Context> PipelineContext;
   std::unique_ptr<pipeline::Loader> Loader;
   std::unique_ptr<pipeline::Runner> Runner;
+  /// The targets of each container, possibly including wildcards
   pipeline::Runner::State CurrentState;
   std::map<const pipeline::ContainerSet::value_type *,
            const pipeline::TargetsList *>
     ContainerToEnumeration;
+  /// The expansions of the entries of ContainerToEnumeration, computed upon
+  /// request
+  std::map<const pipeline::ContainerSet::value_type *, pipeline::TargetsList>
+    ExpandedEnumerations;
 
   static llvm::Expected<PipelineManager>
   createContexts(llvm::ArrayRef<std::string> EnablingFlags,
@@ -115,6 +120,9 @@ public:
 
   /// returns a reference to the internal Runner::State populated by recalculate
   /// memethods.
+  ///
+  /// \note unlike getAllPossibleTargets and getCurrentState, targets
+  ///       representing all the objects of a kind are not expanded.
   const pipeline::Runner::State &getLastState() const { return CurrentState; }
 
   /// A helper function used to produce all possible targets. It is used for
@@ -125,14 +133,11 @@ public:
 
   /// returns the cached list of targets that are known to be aviable to be
   /// produced in a container
+  ///
+  /// Targets representing all the objects of a kind are expanded the first
+  /// time the list of a container is requested.
   const pipeline::TargetsList *
-  getTargetsAvailableFor(const pipeline::ContainerSet::value_type &Container) {
-    if (auto Iter = ContainerToEnumeration.find(&Container);
-        Iter == ContainerToEnumeration.end())
-      return nullptr;
-    else
-      return Iter->second;
-  }
+  getTargetsAvailableFor(const pipeline::ContainerSet::value_type &Container);
 
   void dump() const { Runner->dump(); }
 
@@ -4,15 +4,53 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
-#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/MemoryBuffer.h"
 
 #include "revng/Pipeline/Container.h"
 #include "revng/Support/MetaAddress.h"
 
 namespace revng::pipes {
 
+/// \brief Container associating a string to each MetaAddress
+///
+/// Strings are never stored individually: they live either in an arena or in
+/// a memory-mapped serialized container, and the container only keeps a flat
+/// index of them, sorted by MetaAddress. Storages are immutable once a string
+/// has been written and are shared among copies of the container, therefore
+/// copying, filtering and merging containers never copies the strings.
+///
+/// The container can be serialized either as YAML or in an indexed binary
+/// format (see `-binary-string-maps`). Loading the latter from disk maps the
+/// file in memory and only reads the index: the strings are read on demand.
 class StringMapContainer : public pipeline::Container<StringMapContainer> {
-  std::map<MetaAddress, std::string> Map;
+public:
+  using Entry = std::pair<MetaAddress, llvm::StringRef>;
+  using EntriesVector = std::vector<Entry>;
+
+private:
+  /// Backing memory for the strings
+  struct Storage {
+    /// Protects Allocator, since the storage might be shared among containers
+    std::mutex Lock;
+    llvm::BumpPtrAllocator Allocator;
+
+    /// If not null, this storage is a serialized container, nothing can be
+    /// allocated here
+    std::unique_ptr<llvm::MemoryBuffer> Mapped;
+  };
+
+private:
+  /// Sorted by MetaAddress, without duplicates
+  EntriesVector Index;
+  std::vector<std::shared_ptr<Storage>> Storages;
   const pipeline::Kind *TheKind;
 
 public:
@@ -20,7 +58,7 @@ public:
 
 public:
   StringMapContainer(llvm::StringRef Name, const pipeline::Kind &K) :
-    pipeline::Container<StringMapContainer>(Name), Map(), TheKind(&K) {}
+    pipeline::Container<StringMapContainer>(Name), Index(), TheKind(&K) {}
 
   StringMapContainer(const StringMapContainer &) = default;
   StringMapContainer &operator=(const StringMapContainer &) = default;
@@ -31,22 +69,44 @@ public:
   ~StringMapContainer() override = default;
 
 public:
-  void clear() override { Map.clear(); }
-
   std::unique_ptr<pipeline::ContainerBase>
   cloneFiltered(const pipeline::TargetsList &Targets) const override;
 
   pipeline::TargetsList enumerate() const override;
 
-  bool remove(const pipeline::TargetsList &Targets) override;
-
   llvm::Error serialize(llvm::raw_ostream &OS) const override;
 
-  llvm::Error deserialize(const llvm::MemoryBuffer &Buffer) override;
+public:
+  /// \brief Associate a copy of \p Value to \p Key, replacing the old one
+  void insert(const MetaAddress &Key, llvm::StringRef Value);
+
+  /// \return the string associated to \p Key, if any. It's valid as long as
+  ///         the container, or a copy of it, is alive.
+  std::optional<llvm::StringRef> get(const MetaAddress &Key) const;
+
+  size_t size() const { return Index.size(); }
+  auto begin() const { return Index.begin(); }
+  auto end() const { return Index.end(); }
 
 protected:
+  void clearImpl() override {
+    Index.clear();
+    Storages.clear();
+  }
+
+  bool removeImpl(const pipeline::TargetsList &Targets) override;
+
+  llvm::Error deserializeImpl(const llvm::MemoryBuffer &Buffer) override;
+
+  llvm::Error loadFromDiskImpl(llvm::StringRef Path) override;
+
   void mergeBackImpl(StringMapContainer &&Container) override;
 
+private:
+  llvm::StringRef allocate(llvm::StringRef Value);
+  void serializeBinary(llvm::raw_ostream &OS) const;
+  llvm::Error deserializeBinary(std::unique_ptr<llvm::MemoryBuffer> Buffer);
+
 }; // end class StringMapContainer
 
 } // end namespace revng::pipes
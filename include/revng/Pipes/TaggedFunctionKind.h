@@ -14,21 +14,36 @@ namespace revng::pipes {
 /// A tagged function kind is a kind associated to tagged global elements. When
 /// enumerating a llvm::Module it will produce a target for each global object
 /// with that tag.
+///
+/// When the model changes, only the targets of the functions whose model
+/// counterpart has been modified are invalidated, unless the change can affect
+/// their callers too (e.g., a renaming), in which case all the functions are
+/// invalidated.
 class TaggedFunctionKind : public pipeline::LLVMKind {
 private:
   const FunctionTags::Tag *Tag;
 
+  /// Whether the functions of this kind depend on the prototypes of their
+  /// callees, and therefore on the types of the model
+  bool DependsOnPrototypes;
+
 public:
   TaggedFunctionKind(llvm::StringRef Name,
                      pipeline::Rank *Rank,
-                     const FunctionTags::Tag &Tag) :
-    pipeline::LLVMKind(Name, Rank), Tag(&Tag) {}
+                     const FunctionTags::Tag &Tag,
+                     bool DependsOnPrototypes = true) :
+    pipeline::LLVMKind(Name, Rank),
+    Tag(&Tag),
+    DependsOnPrototypes(DependsOnPrototypes) {}
 
   TaggedFunctionKind(llvm::StringRef Name,
                      TaggedFunctionKind &Parent,
                      pipeline::Rank *Rank,
-                     const FunctionTags::Tag &Tag) :
-    pipeline::LLVMKind(Name, Parent, Rank), Tag(&Tag) {}
+                     const FunctionTags::Tag &Tag,
+                     bool DependsOnPrototypes = true) :
+    pipeline::LLVMKind(Name, Parent, Rank),
+    Tag(&Tag),
+    DependsOnPrototypes(DependsOnPrototypes) {}
 
   pipeline::TargetsList
   compactTargets(const pipeline::Context &Ctx,
@@ -40,6 +55,10 @@ public:
 
   std::optional<pipeline::Target>
   symbolToTarget(const llvm::Function &Symbol) const override;
+
+  void
+  getInvalidations(pipeline::TargetsList &ToRemove,
+                   const pipeline::InvalidationEventBase &Event) const override;
 };
 
 } // namespace revng::pipes
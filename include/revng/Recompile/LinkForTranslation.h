@@ -4,6 +4,9 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+
 #include "revng/Model/Binary.h"
 
 void linkForTranslation(const model::Binary &Model,
@@ -16,3 +19,15 @@ void printLinkForTranslationCommands(llvm::raw_ostream &OS,
                                      llvm::StringRef InputBinary,
                                      llvm::StringRef ObjectFile,
                                      llvm::StringRef OutputBinary);
+
+/// \brief Write a relocatable x86-64 ELF containing a single section
+///
+/// The section, named \p SectionName, contains \p Data padded with zeros (or
+/// truncated) up to \p Size bytes. This is equivalent to extracting the data
+/// through `dd`, padding it through `truncate` and then turning it into an
+/// object through `objcopy -Ibinary`, without spawning any process.
+void writeSectionObject(llvm::StringRef Path,
+                        llvm::StringRef SectionName,
+                        llvm::ArrayRef<uint8_t> Data,
+                        uint64_t Size,
+                        bool IsWriteable);
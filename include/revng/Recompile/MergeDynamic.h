@@ -0,0 +1,34 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <cstdint>
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Error.h"
+
+/// \brief Merge the dynamic portions of the translated ELF with the original
+///
+/// Produces \p OutputPath by appending to the ELF at \p ToExtendPath a new
+/// segment containing its .dynstr, .dynsym, .rel(a).dyn, .gnu.version,
+/// .gnu.version_r and .dynamic extended with the ones of the ELF at
+/// \p SourcePath, a hash table for the merged symbols and the new section and
+/// program headers. The relocations of the original ELF, including the PLT
+/// ones, end up in the merged .rel(a).dyn.
+///
+/// If the original ELF is not dynamic, \p ToExtendPath is copied as is.
+///
+/// \param BaseAddress the address where the original ELF has been loaded, if
+///        it's position independent.
+/// \param MergeLoadSegments also append the LOAD segments of the original
+///        ELF.
+///
+/// \note The inputs are mapped in memory and the output is written in a
+///       single pass, after its layout has been computed.
+llvm::Error mergeDynamic(llvm::StringRef ToExtendPath,
+                         llvm::StringRef SourcePath,
+                         llvm::StringRef OutputPath,
+                         uint64_t BaseAddress = 0x400000,
+                         bool MergeLoadSegments = false);
@@ -0,0 +1,73 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+#include "llvm/ADT/StringRef.h"
+
+/// \brief Writes the log lines of all the threads from a background thread
+///
+/// Each thread writing a line gets its own single-producer single-consumer
+/// ring buffer, registered on its first write. Writing a line only copies it
+/// into the ring buffer of the current thread, without taking any lock, unless
+/// the buffer is full: in that case the producer waits for the background
+/// thread to make room.
+///
+/// The background thread periodically drains all the ring buffers into the
+/// output. Lines written by the same thread keep their order, while lines of
+/// different threads can be interleaved arbitrarily.
+///
+/// \note lines which have not been drained yet are lost if the program
+///       terminates abnormally.
+class AsyncLogWriter {
+private:
+  class RingBuffer;
+
+private:
+  std::ostream &Output;
+  size_t RingBufferSize;
+  uint64_t ID;
+
+  /// Protects the registration of new ring buffers
+  std::mutex RingBuffersLock;
+  std::vector<std::unique_ptr<RingBuffer>> RingBuffers;
+
+  /// Serializes the consumers, i.e., the background thread and drain()
+  std::mutex DrainLock;
+
+  std::atomic<bool> Stop = false;
+  std::thread Writer;
+
+public:
+  /// \param RingBufferSize the size in bytes of the ring buffer of each
+  ///        thread, must be a power of two. Longer lines are truncated.
+  explicit AsyncLogWriter(std::ostream &Output,
+                          size_t RingBufferSize = 64 * 1024);
+
+  /// \brief Stop the background thread and write all the pending lines
+  ~AsyncLogWriter();
+
+  AsyncLogWriter(const AsyncLogWriter &) = delete;
+  AsyncLogWriter &operator=(const AsyncLogWriter &) = delete;
+
+public:
+  /// \brief Enqueue \p Line for the background thread to write it
+  void write(llvm::StringRef Line);
+
+  /// \brief Write to the output all the lines enqueued so far
+  void drain();
+
+private:
+  RingBuffer &getRingBuffer();
+  bool drainOnce();
+  void run();
+};
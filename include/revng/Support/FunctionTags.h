@@ -7,6 +7,7 @@
 #include <set>
 
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallBitVector.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/IR/GlobalObject.h"
 #include "llvm/IR/GlobalVariable.h"
@@ -34,6 +35,9 @@ concept Taggable = (std::is_base_of_v<llvm::Instruction, T>
 /// Represents a set of Tag that can be attached to an
 /// Instruction/GlobalVariable/Function
 ///
+/// Tags are stored as a bit vector indexed by Tag::id(), so that checking for a
+/// Tag is a handful of bit tests.
+///
 /// \note This class automatically deduplicates Tags and keeps the most specific
 ///       Tag available, in case two Tags that are in a parent-child
 ///       relationship are added to the set
@@ -42,11 +46,11 @@ private:
   static constexpr const char *TagsMetadataName = "revng.tags";
 
 private:
-  std::set<const Tag *> Tags;
+  llvm::SmallBitVector Tags;
 
 public:
   TagsSet() {}
-  TagsSet(std::initializer_list<const Tag *> I) : Tags{ I } {}
+  TagsSet(std::initializer_list<const Tag *> I);
 
 public:
   static TagsSet from(const Taggable auto *V) {
@@ -55,9 +59,7 @@ public:
   static TagsSet from(const llvm::MDNode *MD);
 
 public:
-  bool containsExactly(const Tag &Target) const {
-    return Tags.count(&Target) != 0;
-  }
+  bool containsExactly(const Tag &Target) const;
 
   bool contains(const Tag &Target) const;
 
@@ -70,6 +72,12 @@ public:
   void insert(const Tag &Target);
 
 private:
+  void insertExactly(size_t ID) {
+    if (ID >= Tags.size())
+      Tags.resize(ID + 1);
+    Tags.set(ID);
+  }
+
   llvm::MDNode *getMetadata(llvm::LLVMContext &C) const;
 };
 
@@ -82,6 +90,15 @@ public:
   Tag(llvm::StringRef Name) : DynamicHierarchy(Name) {}
   Tag(llvm::StringRef Name, Tag &Parent) : DynamicHierarchy(Name, Parent) {}
 
+public:
+  /// \brief Find the Tag with the given Tag::id()
+  static const Tag &fromID(size_t ID);
+
+  /// \brief Find the Tag with the given name, if any
+  ///
+  /// Unlike findByName, this is a hash table lookup.
+  static const Tag *fromName(llvm::StringRef Name);
+
 public:
   void addTo(Taggable auto *I) const {
     auto Set = TagsSet::from(I);
@@ -123,27 +140,35 @@ public:
   }
 };
 
+inline TagsSet::TagsSet(std::initializer_list<const Tag *> I) {
+  for (const Tag *T : I)
+    insertExactly(T->id());
+}
+
+inline bool TagsSet::containsExactly(const Tag &Target) const {
+  size_t ID = Target.id();
+  return ID < Tags.size() and Tags.test(ID);
+}
+
 inline bool TagsSet::contains(const Tag &Target) const {
-  for (const Tag *T : Tags)
-    if (Target.ancestorOf(*T))
+  for (unsigned ID : Tags.set_bits())
+    if (Target.ancestorOf(ID))
       return true;
   return false;
 }
 
 inline void TagsSet::insert(const Tag &Target) {
-  for (auto It = Tags.begin(); It != Tags.end();) {
-    if (Target.ancestorOf(**It)) {
+  for (unsigned ID : Tags.set_bits()) {
+    if (Target.ancestorOf(ID)) {
       // No need to insert, we already have a Tag derived from Target in the set
       return;
-    } else if ((*It)->ancestorOf(Target)) {
-      // Target is more specific than (*It), delete (*It)
-      It = Tags.erase(It);
-    } else {
-      ++It;
+    } else if (Tag::fromID(ID).ancestorOf(Target)) {
+      // Target is more specific than the Tag with ID, delete it
+      Tags.reset(ID);
     }
   }
 
-  Tags.insert(&Target);
+  insertExactly(Target.id());
 }
 
 inline Tag QEMU("QEMU");
@@ -9,6 +9,7 @@
 #include <sstream>
 #include <type_traits>
 
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/iterator_range.h"
 #include "llvm/Analysis/ConstantFolding.h"
@@ -63,6 +64,11 @@ constexpr const char *CallerBlockStartMDName = "revng.callerblock.start";
 constexpr const char *JTReasonMDName = "revng.jt.reasons";
 constexpr const char *FunctionMetadataMDName = "revng.function.metadata";
 
+/// Marks the first instruction generated by a guest instruction whose call to
+/// newpc has been dropped: a tuple of the address of the guest instruction and
+/// its size, the same as the first two arguments of newpc.
+constexpr const char *NewPCMDName = "revng.newpc";
+
 template<typename T>
 inline bool contains(T Range, typename T::value_type V) {
   return std::find(std::begin(Range), std::end(Range), V) != std::end(Range);
@@ -223,6 +229,14 @@ struct BlackListTrait<const std::set<B> &, B>
   bool isBlacklisted(B Value) const { return this->Obj.count(Value) != 0; }
 };
 
+template<typename B>
+struct BlackListTrait<const llvm::SmallPtrSetImpl<B> &, B>
+  : BlackListTraitBase<const llvm::SmallPtrSetImpl<B> &> {
+  using Base = BlackListTraitBase<const llvm::SmallPtrSetImpl<B> &>;
+  using Base::Base;
+  bool isBlacklisted(B Value) const { return this->Obj.count(Value) != 0; }
+};
+
 template<typename B, typename C>
 inline BlackListTrait<C, B> make_blacklist(C Obj) {
   return BlackListTrait<C, B>(Obj);
@@ -234,6 +248,12 @@ make_blacklist(const std::set<B> &Obj) {
   return BlackListTrait<const std::set<B> &, B>(Obj);
 }
 
+template<typename B>
+inline BlackListTrait<const llvm::SmallPtrSetImpl<B> &, B>
+make_blacklist(const llvm::SmallPtrSetImpl<B> &Obj) {
+  return BlackListTrait<const llvm::SmallPtrSetImpl<B> &, B>(Obj);
+}
+
 /// \brief Possible way to continue (or stop) exploration in a breadth-first
 ///        visit
 enum VisitAction {
@@ -295,9 +315,11 @@ public:
                                              backward_iterator>;
   using instruction_range = llvm::iterator_range<instruction_iterator>;
 
+  /// \note Derived::visit is called directly, and small visits do not
+  ///       allocate: both the visited set and the queue are inline.
   void run(llvm::Instruction *I) {
     auto &ThisDerived = *static_cast<Derived *>(this);
-    std::set<BasicBlock *> Visited;
+    llvm::SmallPtrSet<BasicBlock *, 16> Visited;
 
     using ID = IteratorDirection<Forward>;
     instruction_iterator It = ID::iterator(I);
@@ -316,23 +338,24 @@ public:
       instruction_range Range;
     };
 
-    std::queue<WorkItem> Queue;
-    Queue.push(WorkItem(I->getParent(), It));
+    // Each block is enqueued at most once: pop items by moving Head forward,
+    // instead of erasing them
+    llvm::SmallVector<WorkItem, 16> Queue;
+    size_t Head = 0;
+    Queue.push_back(WorkItem(I->getParent(), It));
 
     bool ExhaustOnly = false;
 
-    while (not Queue.empty()) {
-      WorkItem Item = Queue.front();
-      Queue.pop();
+    while (Head < Queue.size()) {
+      WorkItem Item = Queue[Head];
+      ++Head;
 
       switch (ThisDerived.visit(Item.Range)) {
       case Continue:
         if (not ExhaustOnly) {
           for (auto *Successor : ThisDerived.successors(Item.BB)) {
-            if (Visited.count(Successor) == 0) {
-              Visited.insert(Successor);
-              Queue.push(WorkItem(Successor));
-            }
+            if (Visited.insert(Successor).second)
+              Queue.push_back(WorkItem(Successor));
           }
         }
         break;
@@ -1106,16 +1129,24 @@ llvm::CallInst *getLastNewPC(llvm::Instruction *TheInstruction);
 
 /// \brief Find the PC which lead to generated \p TheInstruction
 ///
+/// Both calls to newpc and instructions marked with NewPCMDName are taken into
+/// account.
+///
 /// \return a pair of integers: the first element represents the PC and the
 ///         second the size of the instruction.
 std::pair<MetaAddress, uint64_t> getPC(llvm::Instruction *TheInstruction);
 
-/// \brief Replace all uses of \Old, with \New in \F.
+/// \brief Replace all uses of \Old, with \New in the instructions accepted by
+///        \p Filter.
+///
+/// Uses through cast ConstantExprs are handled by materializing the cast as an
+/// instruction before each accepted user.
 ///
 /// \return true if it changes something, false otherwise.
-inline bool replaceAllUsesInFunctionWith(llvm::Function *F,
-                                         llvm::Value *Old,
-                                         llvm::Value *New) {
+template<typename FilterType>
+inline bool replaceAllUsesIf(llvm::Value *Old,
+                             llvm::Value *New,
+                             FilterType &&Filter) {
   using namespace llvm;
   if (Old == New)
     return false;
@@ -1130,7 +1161,7 @@ inline bool replaceAllUsesInFunctionWith(llvm::Function *F,
     ++UI;
 
     if (auto *I = dyn_cast<Instruction>(U.getUser())) {
-      if (I->getFunction() == F) {
+      if (Filter(I)) {
         U.set(New);
         Changed = true;
       }
@@ -1148,13 +1179,13 @@ inline bool replaceAllUsesInFunctionWith(llvm::Function *F,
 
   // Iterate on all ConstantExpr that use Old.
   for (ConstantExpr *OldUserCE : OldUserConstExprs) {
-    // For each ConstantExpr that uses Old, we are interested in its uses in F,
-    // so we iterate on all uses of OldUserCE, looking for uses in Instructions
-    // that are in F.
+    // For each ConstantExpr that uses Old, we are interested in its uses in
+    // accepted instructions, so we iterate on all uses of OldUserCE, looking
+    // for them.
     // When we find one, we cannot directly substitute the use of Old in
     // OldUserCE, because that is a constant expression that might be used
-    // somewhere else, possibly outside of F.
-    // What we do instead is to create an Instruction in F that is equivalent to
+    // somewhere else, possibly by instructions that have not been accepted.
+    // What we do instead is to create an Instruction that is equivalent to
     // OldUserCE, and substitute Old with New only in that instruction.
     auto CEIt = OldUserCE->use_begin();
     auto CEEnd = OldUserCE->use_end();
@@ -1162,7 +1193,7 @@ inline bool replaceAllUsesInFunctionWith(llvm::Function *F,
       Use &CEUse = *CEIt;
       ++CEIt;
       auto *CEInstrUser = dyn_cast<Instruction>(CEUse.getUser());
-      if (CEInstrUser and CEInstrUser->getFunction() == F) {
+      if (CEInstrUser and Filter(CEInstrUser)) {
         Instruction *CastInst = OldUserCE->getAsInstruction();
         CastInst->replaceUsesOfWith(Old, New);
         CastInst->insertBefore(CEInstrUser);
@@ -1174,6 +1205,18 @@ inline bool replaceAllUsesInFunctionWith(llvm::Function *F,
   return Changed;
 }
 
+/// \brief Replace all uses of \Old, with \New in \F.
+///
+/// \return true if it changes something, false otherwise.
+inline bool replaceAllUsesInFunctionWith(llvm::Function *F,
+                                         llvm::Value *Old,
+                                         llvm::Value *New) {
+  auto IsInFunction = [F](llvm::Instruction *I) {
+    return I->getFunction() == F;
+  };
+  return replaceAllUsesIf(Old, New, IsInFunction);
+}
+
 /// \brief Checks if \p I is a marker
 ///
 /// A marker a function call to an empty function acting as meta-information,
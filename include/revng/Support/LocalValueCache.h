@@ -0,0 +1,76 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Value.h"
+
+/// \brief Forward stores to loads and drop dead stores while emitting code
+///
+/// Keeps track of the last value loaded from or stored to each variable, so
+/// that subsequent loads can reuse it, and of the last store to each variable
+/// that has not been read yet, so that it can be dropped if it's overwritten.
+///
+/// The tracked values are valid only as long as code is emitted, in order, in
+/// the same basic block and nobody else accesses the variables: the cache is
+/// dropped whenever the insertion block changes, while the user is in charge
+/// of invoking clear() in all the other cases.
+class LocalValueCache {
+private:
+  /// The last value loaded from or stored in each variable in Block
+  llvm::DenseMap<llvm::Value *, llvm::Value *> KnownValues;
+  /// The last store to each variable whose value has not been read yet
+  llvm::DenseMap<llvm::Value *, llvm::StoreInst *> PendingStores;
+  llvm::BasicBlock *Block = nullptr;
+
+public:
+  /// \brief Emit a load from \p Pointer, unless its value is already known
+  llvm::Value *load(llvm::IRBuilder<> &Builder, llvm::Value *Pointer) {
+    sync(Builder);
+    PendingStores.erase(Pointer);
+    if (llvm::Value *Known = KnownValues.lookup(Pointer))
+      return Known;
+
+    auto *Type = Pointer->getType()->getPointerElementType();
+    llvm::Value *Result = Builder.CreateLoad(Type, Pointer);
+    KnownValues[Pointer] = Result;
+    return Result;
+  }
+
+  /// \brief Emit a store of \p ToStore to \p Pointer
+  ///
+  /// The previous store to \p Pointer is erased, if it has not been read in
+  /// the meantime.
+  llvm::StoreInst *
+  store(llvm::IRBuilder<> &Builder,
+        llvm::Value *ToStore,
+        llvm::Value *Pointer) {
+    sync(Builder);
+    if (llvm::StoreInst *Dead = PendingStores.lookup(Pointer))
+      Dead->eraseFromParent();
+
+    llvm::StoreInst *Result = Builder.CreateStore(ToStore, Pointer);
+    KnownValues[Pointer] = ToStore;
+    PendingStores[Pointer] = Result;
+    return Result;
+  }
+
+  /// \brief Forget all the known values and pending stores
+  void clear() {
+    KnownValues.clear();
+    PendingStores.clear();
+  }
+
+private:
+  void sync(const llvm::IRBuilder<> &Builder) {
+    if (Builder.GetInsertBlock() != Block) {
+      clear();
+      Block = Builder.GetInsertBlock();
+    }
+  }
+};
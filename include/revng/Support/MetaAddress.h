@@ -4,6 +4,11 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <functional>
+
+#include "llvm/ADT/DenseMapInfo.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/StringSwitch.h"
 #include "llvm/ADT/Triple.h"
 
 #include "revng/ADT/KeyedObjectTraits.h"
@@ -119,31 +124,29 @@ inline const char *toString(Values V) {
 }
 
 inline Values fromString(llvm::StringRef String) {
-  if (String == "Generic32") {
-    return Generic32;
-  } else if (String == "Generic64") {
-    return Generic64;
-  } else if (String == "Code_x86") {
-    return Code_x86;
-  } else if (String == "Code_x86_64") {
-    return Code_x86_64;
-  } else if (String == "Code_mips") {
-    return Code_mips;
-  } else if (String == "Code_mipsel") {
-    return Code_mipsel;
-  } else if (String == "Code_arm") {
-    return Code_arm;
-  } else if (String == "Code_arm_thumb") {
-    return Code_arm_thumb;
-  } else if (String == "Code_aarch64") {
-    return Code_aarch64;
-  } else if (String == "Code_systemz") {
-    return Code_systemz;
-  } else {
-    return Invalid;
-  }
-
-  revng_abort();
+  // Dispatch on the common prefixes first, this is on the hot path of the
+  // parsing of MetaAddresses
+  if (String.consume_front("Code_")) {
+    return llvm::StringSwitch<Values>(String)
+      .Case("x86", Code_x86)
+      .Case("x86_64", Code_x86_64)
+      .Case("mips", Code_mips)
+      .Case("mipsel", Code_mipsel)
+      .Case("arm", Code_arm)
+      .Case("arm_thumb", Code_arm_thumb)
+      .Case("aarch64", Code_aarch64)
+      .Case("systemz", Code_systemz)
+      .Default(Invalid);
+  }
+
+  if (String.consume_front("Generic")) {
+    if (String == "32")
+      return Generic32;
+    else if (String == "64")
+      return Generic64;
+  }
+
+  return Invalid;
 }
 
 inline const llvm::Optional<llvm::Triple::ArchType> arch(Values V) {
@@ -409,6 +412,11 @@ inline bool isDefaultCode(Values Type) {
 class MetaAddress : private PlainMetaAddress {
 private:
   friend class ProgramCounterHandler;
+  friend struct llvm::DenseMapInfo<MetaAddress>;
+
+public:
+  /// The canonical 128-bit encoding of a MetaAddress, see toPacked
+  using Packed = unsigned __int128;
 
 public:
   /// \name Constructors
@@ -548,20 +556,37 @@ public:
 public:
   /// @{
   bool operator==(const MetaAddress &Other) const {
-    return tie() == Other.tie();
+    return toPacked() == Other.toPacked();
   }
 
   bool operator!=(const MetaAddress &Other) const {
     return not(*this == Other);
   }
 
-  bool operator<(const MetaAddress &Other) const { return tie() < Other.tie(); }
+  bool operator<(const MetaAddress &Other) const {
+    return toPacked() < Other.toPacked();
+  }
   bool operator<=(const MetaAddress &Other) const {
-    return tie() <= Other.tie();
+    return toPacked() <= Other.toPacked();
+  }
+  bool operator>(const MetaAddress &Other) const {
+    return toPacked() > Other.toPacked();
   }
-  bool operator>(const MetaAddress &Other) const { return tie() > Other.tie(); }
   bool operator>=(const MetaAddress &Other) const {
-    return tie() >= Other.tie();
+    return toPacked() >= Other.toPacked();
+  }
+
+  friend llvm::hash_code hash_value(const MetaAddress &Value) {
+    return llvm::hash_combine(Value.packedHigh(), Value.Address);
+  }
+
+  /// \brief The canonical 128-bit encoding of this MetaAddress
+  ///
+  /// From the most significant bits: epoch, address space, type and address.
+  /// Comparing the encoding of two MetaAddresses is equivalent to (but faster
+  /// than) comparing them field by field.
+  Packed toPacked() const {
+    return (static_cast<Packed>(packedHigh()) << 64) | Address;
   }
 
   /// @}
@@ -896,15 +921,42 @@ private:
   }
 
 public:
+  /// \brief The maximum length of the textual representation
+  ///
+  /// That is, `0x` followed by 16 hexadecimal digits, the longest type name,
+  /// the epoch and the address space, separated by colons.
+  static constexpr size_t MaxStringLength = 2 + 16 + 1 + 14 + 1 + 10 + 1 + 5;
+
+  /// \brief Write the textual representation into [\p First, \p Last),
+  ///        without allocating memory
+  ///
+  /// \return the end of the written characters, or nullptr if they do not
+  ///         fit, in which case the content of the buffer is unspecified.
+  char *toChars(char *First, char *Last) const;
+
   std::string toString() const;
+
+  /// \brief Parse the textual representation produced by toString
+  ///
+  /// \note this does not allocate memory.
   static MetaAddress fromString(llvm::StringRef Text);
 
 private:
-  using Tied = std::tuple<const uint32_t &,
-                          const uint16_t &,
-                          const uint16_t &,
-                          const uint64_t &>;
-  Tied tie() const { return std::tie(Epoch, AddressSpace, Type, Address); }
+  /// \return the upper half of the encoding returned by toPacked
+  uint64_t packedHigh() const {
+    return ((static_cast<uint64_t>(Epoch) << 32)
+            | (static_cast<uint64_t>(AddressSpace) << 16) | Type);
+  }
+
+  /// \brief Create an invalid MetaAddress with a non-zero address
+  ///
+  /// Such a MetaAddress cannot be obtained otherwise, which makes it suitable
+  /// for the special keys of hash tables.
+  static MetaAddress invalidWithAddress(uint64_t Address) {
+    MetaAddress Result;
+    Result.Address = Address;
+    return Result;
+  }
 };
 
 static_assert(sizeof(MetaAddress) <= 128 / 8,
@@ -923,3 +975,33 @@ struct CompareAddress<MetaAddress> {
 template<>
 struct KeyedObjectTraits<MetaAddress>
   : public IdentityKeyedObjectTraits<MetaAddress> {};
+
+template<>
+struct llvm::DenseMapInfo<MetaAddress> {
+  static MetaAddress getEmptyKey() {
+    return MetaAddress::invalidWithAddress(~uint64_t(0));
+  }
+
+  static MetaAddress getTombstoneKey() {
+    return MetaAddress::invalidWithAddress(~uint64_t(0) - 1);
+  }
+
+  static unsigned getHashValue(const MetaAddress &Value) {
+    // Fibonacci hashing of the two halves of the encoding, so that the upper
+    // bits, which are the ones we keep, depend on all the bits of the address
+    constexpr uint64_t Multiplier = 0x9E3779B97F4A7C15ULL;
+    uint64_t Hash = (Value.packedHigh() * Multiplier) ^ Value.Address;
+    return (Hash * Multiplier) >> 32;
+  }
+
+  static bool isEqual(const MetaAddress &LHS, const MetaAddress &RHS) {
+    return LHS == RHS;
+  }
+};
+
+template<>
+struct std::hash<MetaAddress> {
+  size_t operator()(const MetaAddress &Value) const {
+    return llvm::DenseMapInfo<MetaAddress>::getHashValue(Value);
+  }
+};
@@ -15,7 +15,10 @@ struct llvm::yaml::ScalarTraits<MetaAddress> {
 
   static void
   output(const MetaAddress &Value, void *, llvm::raw_ostream &Output) {
-    Output << Value.toString();
+    char Buffer[MetaAddress::MaxStringLength];
+    char *End = Value.toChars(Buffer, Buffer + MetaAddress::MaxStringLength);
+    revng_assert(End != nullptr);
+    Output.write(Buffer, End - Buffer);
   }
 
   static StringRef input(llvm::StringRef Scalar, void *, MetaAddress &Value) {
@@ -4,11 +4,13 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <chrono>
 #include <map>
 #include <set>
 #include <type_traits>
 #include <vector>
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/PostOrderIterator.h"
 #include "llvm/ADT/SmallVector.h"
@@ -86,7 +88,7 @@ private:
   std::vector<PostOrderEntry> PostOrderList;
 
   /// Map to quickly find the index of an entry in PostOrderList
-  std::map<Iterated, size_t> PostOrderListIndex;
+  llvm::DenseMap<Iterated, size_t> PostOrderListIndex;
 
   /// The next index to consume. This should always point to the lowest enabled
   /// entry in PostOrderList
@@ -399,6 +401,12 @@ protected:
   /// \note Unused if DynamicGraph == false
   std::map<Label, llvm::SmallVector<Label, 2>> SuccessorsMap;
 
+  /// Maximum number of labels to analyze in a single run, 0 means no limit
+  size_t MaxIterations = 0;
+
+  /// Maximum time to spend in a single run, 0 means no limit
+  std::chrono::steady_clock::duration MaxDuration{};
+
 public:
   using InterruptType = Interrupt;
 
@@ -451,6 +459,18 @@ public:
     return TheInterruptCreator.createNoReturnInterrupt(derived());
   }
 
+  /// \brief Create a "budget exhausted" interrupt, used when run stops early
+  ///        since it exceeded the budget set through setBudget
+  ///
+  /// The derived class is responsible for making the results of the analysis
+  /// a sound over-approximation, e.g., by resetting them to top.
+  ///
+  /// \note This method must be implemented by the derived class D only if
+  ///       setBudget is used
+  Interrupt createBudgetExhaustedInterrupt() {
+    return derived().createBudgetExhaustedInterrupt();
+  }
+
   /// \brief Dump the final state
   ///
   /// \note This method must be implemented by the derived class D
@@ -528,12 +548,48 @@ public:
   /// \brief Register a new extremal label
   void registerExtremal(Label L) { Extremals.insert(L); }
 
+  /// \brief Limit the work performed by each invocation of run
+  ///
+  /// \param MaxIterations maximum number of labels to analyze, 0 means no
+  ///        limit.
+  /// \param MaxDuration maximum time to spend, 0 means no limit.
+  void setBudget(size_t MaxIterations,
+                 std::chrono::steady_clock::duration MaxDuration = {}) {
+    this->MaxIterations = MaxIterations;
+    this->MaxDuration = MaxDuration;
+  }
+
   /// \brief Resolve the data flow analysis problem using the MFP solution
+  ///
+  /// If the budget set through setBudget is exceeded, the analysis stops and
+  /// returns createBudgetExhaustedInterrupt(). The budget applies to each
+  /// invocation of run separately.
+  ///
+  /// The state and the work list are left untouched by run itself, therefore,
+  /// as long as createBudgetExhaustedInterrupt does not alter the results,
+  /// invoking run again without initialize resumes the analysis. If instead
+  /// the results are reset to make them sound (as DisjointRanges does), the
+  /// analysis has to be restarted with initialize.
+  ///
+  /// Similarly, when new edges appear in the graph after the analysis is over,
+  /// registerToVisit their sources and run again, instead of restarting from
+  /// scratch.
   Interrupt run() {
     using namespace llvm;
+    using Clock = std::chrono::steady_clock;
+
+    size_t Iterations = 0;
+    Clock::time_point Deadline = Clock::now() + MaxDuration;
 
     // Proceed until there are elements in the work list
     while (not WorkList.empty()) {
+      // Check if we exceeded the budget
+      if ((MaxIterations != 0 and Iterations == MaxIterations)
+          or (MaxDuration != Clock::duration::zero()
+              and Clock::now() >= Deadline))
+        return createBudgetExhaustedInterrupt();
+      ++Iterations;
+
       Label ToAnalyze = WorkList.head();
 
       // If we've been asked to visit this basic block before the end, consider
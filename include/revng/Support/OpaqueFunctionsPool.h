@@ -4,8 +4,12 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <array>
 #include <map>
+#include <mutex>
 
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Twine.h"
 #include "llvm/IR/Attributes.h"
 #include "llvm/IR/DerivedTypes.h"
@@ -66,6 +70,12 @@ public:
       revng_assert(It->second == F);
   }
 
+  /// \return the function associated to \p Key, or nullptr if there's none
+  llvm::Function *find(const KeyT &Key) const {
+    auto It = Pool.find(Key);
+    return It == Pool.end() ? nullptr : It->second;
+  }
+
 public:
   llvm::Function *
   get(KeyT Key, llvm::FunctionType *FT, const llvm::Twine &Name = {}) {
@@ -124,3 +134,138 @@ public:
     }
   }
 };
+
+/// \brief A pool of opaque functions shared among several modules
+///
+/// Unlike OpaqueFunctionsPool, which is bound to a single module, this pool can
+/// be used concurrently by passes processing distinct modules, e.g., in
+/// parallel. Functions are identified by the module they belong to and a key.
+///
+/// Modules are spread over a fixed number of shards, each with its own lock:
+/// threads working on distinct modules seldom contend, and populating a module
+/// takes a single lock.
+///
+/// \note As usual with LLVM, a module (and its context) must be accessed by a
+///       single thread at a time. Attributes and tags must be configured before
+///       the pool is shared.
+template<typename KeyT>
+class SharedOpaqueFunctionsPool {
+public:
+  static constexpr unsigned ShardsCount = 16;
+
+private:
+  using MapKey = std::pair<const llvm::Module *, KeyT>;
+
+  struct alignas(64) Shard {
+    std::mutex Lock;
+    llvm::DenseMap<MapKey, llvm::Function *> Pool;
+  };
+
+private:
+  std::array<Shard, ShardsCount> Shards;
+  llvm::SmallVector<llvm::Attribute::AttrKind, 4> FnAttributes;
+  FunctionTags::TagsSet Tags;
+
+public:
+  void addFnAttribute(llvm::Attribute::AttrKind Kind) {
+    FnAttributes.push_back(Kind);
+  }
+
+  void setTags(const FunctionTags::TagsSet &Tags) { this->Tags = Tags; }
+
+public:
+  void record(llvm::Module *M, KeyT Key, llvm::Function *F) {
+    revng_assert(F->getParent() == M);
+    Shard &Current = shard(M);
+    std::lock_guard<std::mutex> Guard(Current.Lock);
+    auto [It, New] = Current.Pool.try_emplace({ M, Key }, F);
+    revng_assert(New or It->second == F);
+  }
+
+public:
+  llvm::Function *get(llvm::Module *M,
+                      KeyT Key,
+                      llvm::FunctionType *FT,
+                      const llvm::Twine &Name = {}) {
+    Shard &Current = shard(M);
+    std::lock_guard<std::mutex> Guard(Current.Lock);
+    return getLocked(Current, M, Key, FT, Name);
+  }
+
+  llvm::Function *get(llvm::Module *M,
+                      KeyT Key,
+                      llvm::Type *ReturnType = nullptr,
+                      llvm::ArrayRef<llvm::Type *> Arguments = {},
+                      const llvm::Twine &Name = {}) {
+    using namespace llvm;
+    if (ReturnType == nullptr)
+      ReturnType = Type::getVoidTy(M->getContext());
+
+    return get(M, Key, FunctionType::get(ReturnType, Arguments, false), Name);
+  }
+
+  /// \brief Create, unless they already exist, the functions for all of \p Keys
+  ///
+  /// \param GetType returns the llvm::FunctionType for a key.
+  /// \param GetName returns the name of the function for a key.
+  template<typename TypeCallable, typename NameCallable>
+  void populate(llvm::Module *M,
+                llvm::ArrayRef<KeyT> Keys,
+                TypeCallable &&GetType,
+                NameCallable &&GetName) {
+    Shard &Current = shard(M);
+    std::lock_guard<std::mutex> Guard(Current.Lock);
+    for (const KeyT &Key : Keys)
+      getLocked(Current, M, Key, GetType(Key), GetName(Key));
+  }
+
+  /// \brief Forget all the functions of \p M, erasing them if \p Erase is set
+  void purge(llvm::Module *M, bool Erase) {
+    Shard &Current = shard(M);
+    std::lock_guard<std::mutex> Guard(Current.Lock);
+
+    llvm::SmallVector<MapKey, 16> ToForget;
+    for (auto &[Key, F] : Current.Pool) {
+      if (Key.first != M)
+        continue;
+
+      if (Erase) {
+        revng_assert(F->use_empty());
+        eraseFromParent(F);
+      }
+      ToForget.push_back(Key);
+    }
+
+    for (const MapKey &Key : ToForget)
+      Current.Pool.erase(Key);
+  }
+
+private:
+  Shard &shard(const llvm::Module *M) {
+    auto Hash = llvm::DenseMapInfo<const llvm::Module *>::getHashValue(M);
+    return Shards[Hash % ShardsCount];
+  }
+
+  llvm::Function *getLocked(Shard &Current,
+                            llvm::Module *M,
+                            KeyT Key,
+                            llvm::FunctionType *FT,
+                            const llvm::Twine &Name) {
+    using namespace llvm;
+
+    auto [It, New] = Current.Pool.try_emplace({ M, Key }, nullptr);
+    if (New) {
+      auto *F = Function::Create(FT, GlobalValue::ExternalLinkage, Name, M);
+      for (Attribute::AttrKind Kind : FnAttributes)
+        F->addFnAttr(Kind);
+      Tags.set(F);
+      It->second = F;
+    }
+
+    // Ensure the function we're returning is as expected
+    Function *F = It->second;
+    revng_assert(F->getType()->getPointerElementType() == FT);
+
+    return F;
+  }
+};
@@ -4,18 +4,48 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <map>
+#include <mutex>
 #include <optional>
+#include <set>
 #include <string>
 #include <vector>
 
 std::string getCurrentExecutableFullPath();
 
+/// \brief A list of directories in which files are looked up, in order
+///
+/// Lookups are memoized for the lifetime of the object, hence files appearing
+/// or disappearing after the first lookup of their name are not noticed.
+///
+/// A search path can provide an index (see IndexFileName) listing one relative
+/// path per line, usually written at install time. When it exists, files not
+/// listed in it are not probed for, and listed files cost a single probe. If
+/// the indexes lead nowhere, a regular probing lookup is performed, so that
+/// stale indexes only cost time.
 class PathList {
+public:
+  /// The path of the index, relative to each search path
+  static constexpr const char *IndexFileName = "share/revng/resources.idx";
+
+private:
+  using Index = std::set<std::string>;
+
+private:
+  std::vector<std::string> SearchPaths;
+
+  mutable std::mutex Lock;
+  mutable std::map<std::string, std::optional<std::string>> Cache;
+
+  /// The index of each search path, if any, loaded at the first lookup
+  mutable std::optional<std::vector<std::optional<Index>>> Indexes;
+
 public:
   PathList(const std::vector<std::string> &Paths) : SearchPaths(Paths) {}
 
   std::optional<std::string> findFile(const std::string &FileName) const;
 
 private:
-  std::vector<std::string> SearchPaths;
+  std::optional<std::string> findFileImpl(const std::string &FileName) const;
+  void loadIndexes() const;
 };
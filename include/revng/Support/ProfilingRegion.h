@@ -0,0 +1,60 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+#include "llvm/ADT/StringRef.h"
+
+/// \brief RAII helper profiling a region of code
+///
+/// What happens upon entering and leaving a region depends on the
+/// -profile-regions option:
+///
+/// * `none` (the default): nothing;
+/// * `callgrind`: valgrind instrumentation is enabled only within regions,
+///   see Callgrind.h;
+/// * `perf`: the cycles, instructions, cache misses and branch misses of the
+///   current thread are read through perf_event_open, and their difference is
+///   accounted to the name of the region.
+///
+/// The number of executions of each region and, with `perf`, its counters are
+/// part of the statistics (see -statistics). Counters are inclusive: the
+/// counters of a region nested in another one are also accounted to the
+/// outer one.
+///
+/// Entering a region with `perf` costs a system call, hence regions should
+/// enclose coarse grained work, such as running a pipe or analyzing a
+/// function.
+class ProfilingRegion {
+public:
+  enum CounterKind {
+    Cycles,
+    Instructions,
+    CacheMisses,
+    BranchMisses,
+    CountersCount
+  };
+
+  using Counters = std::array<uint64_t, CountersCount>;
+
+private:
+  bool Active = false;
+  std::string Name;
+  Counters Start = {};
+
+public:
+  explicit ProfilingRegion(llvm::StringRef Name);
+  ~ProfilingRegion();
+
+  ProfilingRegion(const ProfilingRegion &) = delete;
+  ProfilingRegion &operator=(const ProfilingRegion &) = delete;
+
+public:
+  /// \return true if regions do anything at all
+  static bool isEnabled();
+};
@@ -4,6 +4,7 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Value.h"
@@ -54,6 +55,11 @@ protected:
 
   std::set<llvm::Value *> CSVsAffectingPC;
 
+  using UniqueJumpTargetResult = std::pair<NextJumpTarget::Values, MetaAddress>;
+
+  /// Results of getUniqueJumpTarget, see invalidateUniqueJumpTargets
+  llvm::DenseMap<llvm::BasicBlock *, UniqueJumpTargetResult> UniqueJumpTargets;
+
 public:
   using DispatcherTarget = std::pair<MetaAddress, llvm::BasicBlock *>;
   using DispatcherTargets = std::vector<DispatcherTarget>;
@@ -141,9 +147,22 @@ public:
   ///         an invalid MetaAddress in case there isn't a single next PC, or,
   ///         finally, a valid MetaAddress representing the only possible next
   ///         PC
+  ///
+  /// \note results are memoized per basic block: whoever changes the code
+  ///       preceding an exit block (up to the calls to newpc), or deletes
+  ///       basic blocks, has to call invalidateUniqueJumpTargets or
+  ///       invalidateUniqueJumpTarget.
   std::pair<NextJumpTarget::Values, MetaAddress>
   getUniqueJumpTarget(llvm::BasicBlock *BB);
 
+  /// \brief Forget all the memoized results of getUniqueJumpTarget
+  void invalidateUniqueJumpTargets() { UniqueJumpTargets.clear(); }
+
+  /// \brief Forget the memoized result of getUniqueJumpTarget for \p BB
+  void invalidateUniqueJumpTarget(llvm::BasicBlock *BB) {
+    UniqueJumpTargets.erase(BB);
+  }
+
   void deserializePC(llvm::IRBuilder<> &Builder) const {
     using namespace llvm;
 
@@ -218,9 +237,26 @@ public:
 
   void destroyDispatcher(llvm::SwitchInst *Root) const;
 
+  /// \brief Replace the large switches on the address with table lookups
+  ///
+  /// Each switch on the address with at least \p MinimumCases cases is
+  /// replaced by a lookup in a perfect hash table of the case values, followed
+  /// by an `indirectbr` to the address of the target basic block. This makes
+  /// dispatching constant time, instead of logarithmic in the number of
+  /// targets.
+  ///
+  /// \note the dispatcher can no longer be extended nor destroyed.
+  void lowerDispatcherToTables(llvm::SwitchInst *Root,
+                               unsigned MinimumCases) const;
+
+  /// \brief Jump to \p CandidateTarget if it's the current PC, otherwise jump
+  ///        to \p Default
+  ///
+  /// \param SetBlockType if present, the type of all the emitted blocks.
   void buildHotPath(llvm::IRBuilder<> &Builder,
                     const DispatcherTarget &CandidateTarget,
-                    llvm::BasicBlock *Default) const;
+                    llvm::BasicBlock *Default,
+                    llvm::Optional<BlockType::Values> SetBlockType = {}) const;
 
 protected:
   void createMissingVariables(llvm::Module *M) {
@@ -248,6 +284,8 @@ public:
 private:
   bool isPCAffectingHelper(llvm::Instruction *I) const;
 
+  UniqueJumpTargetResult computeUniqueJumpTarget(llvm::BasicBlock *BB);
+
   static llvm::GlobalVariable *createAddress(llvm::Module *M) {
     return createVariable(M, AddressName, sizeof(MetaAddress::Address));
   }
@@ -0,0 +1,22 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/ErrorOr.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+namespace revng {
+
+/// \brief Get the contents of the file at \p Path, reading it once per process
+///
+/// Meant for files that do not change while the process is running, such as
+/// the helpers and support modules: all the pipelines of the process share the
+/// same copy of their contents, which is never released.
+///
+/// \note the returned buffer is null-terminated.
+llvm::ErrorOr<llvm::MemoryBufferRef> getSharedFile(llvm::StringRef Path);
+
+} // namespace revng
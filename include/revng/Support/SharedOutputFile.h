@@ -0,0 +1,77 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <cstdint>
+#include <mutex>
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/raw_ostream.h"
+
+/// \brief A file which several threads append to
+///
+/// Threads are not supposed to write to it directly, but through a
+/// BufferedOutputStream each, which appends large chunks of data at once.
+class SharedOutputFile {
+private:
+  std::mutex Lock;
+  llvm::raw_fd_ostream OS;
+
+public:
+  /// \brief Create the file at \p Path, replacing any existing one
+  explicit SharedOutputFile(llvm::StringRef Path);
+
+  SharedOutputFile(const SharedOutputFile &) = delete;
+  SharedOutputFile &operator=(const SharedOutputFile &) = delete;
+
+public:
+  void append(llvm::StringRef Data);
+};
+
+/// \brief Buffer the output of a thread, and append it to a SharedOutputFile
+///        in large chunks
+///
+/// What is written to the stream is split into records, e.g., lines or
+/// functions, terminated by endRecord(). Records are never split among
+/// chunks, hence the records written by different threads are never
+/// interleaved, but their order is unspecified.
+class BufferedOutputStream : public llvm::raw_ostream {
+public:
+  static constexpr size_t DefaultChunkSize = 1024 * 1024;
+
+private:
+  SharedOutputFile &File;
+  llvm::SmallString<0> Buffer;
+  uint64_t Appended = 0;
+  size_t ChunkSize;
+
+public:
+  explicit BufferedOutputStream(SharedOutputFile &File,
+                                size_t ChunkSize = DefaultChunkSize) :
+    llvm::raw_ostream(/* Unbuffered */ true),
+    File(File),
+    ChunkSize(ChunkSize) {}
+
+  /// \brief Append what is left of the output to the file
+  ~BufferedOutputStream() override { appendChunk(); }
+
+public:
+  /// \brief Mark the end of a record, appending the buffered output to the
+  ///        file if it is large enough
+  void endRecord() {
+    if (Buffer.size() >= ChunkSize)
+      appendChunk();
+  }
+
+  void appendChunk();
+
+private:
+  void write_impl(const char *Ptr, size_t Size) override {
+    Buffer.append(Ptr, Ptr + Size);
+  }
+
+  uint64_t current_pos() const override { return Appended + Buffer.size(); }
+};
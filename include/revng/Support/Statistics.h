@@ -4,14 +4,18 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <array>
+#include <cmath>
 #include <csignal>
 #include <cstdlib>
 #include <map>
+#include <mutex>
 #include <string>
 #include <vector>
 
 #include "llvm/ADT/Twine.h"
 #include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/raw_ostream.h"
 
 #include "revng/Support/Debug.h"
 
@@ -20,9 +24,61 @@ const size_t MaxCounterMapDump = 32;
 class OnQuitInteraface {
 public:
   virtual void onQuit() = 0;
+
+  /// \brief Print the current value of the statistic to \p Output
+  virtual void print(llvm::raw_ostream &Output) = 0;
+
   virtual ~OnQuitInteraface();
 };
 
+namespace revng::detail {
+
+/// \return a new shard index, to be assigned to a thread
+unsigned nextStatisticsShard();
+
+} // namespace revng::detail
+
+/// \brief Per-thread copies of some statistics data, aggregated upon request
+///
+/// Each thread is assigned on its first access one of a fixed number of
+/// shards, each with its own lock. Threads thus update their own shard without
+/// contending with each other (unless there are more threads than shards),
+/// while readers visit each shard in turn, without stopping the writers.
+template<typename T>
+class ShardedStatistic {
+public:
+  static constexpr unsigned ShardsCount = 16;
+
+private:
+  struct alignas(64) Shard {
+    std::mutex Lock;
+    T Data{};
+  };
+
+private:
+  std::array<Shard, ShardsCount> Shards;
+
+public:
+  /// \brief Invoke \p Callable on the data of the shard of the current thread
+  template<typename F>
+  void update(F &&Callable) {
+    thread_local unsigned Index = revng::detail::nextStatisticsShard()
+                                  % ShardsCount;
+    Shard &Current = Shards[Index];
+    std::lock_guard<std::mutex> Guard(Current.Lock);
+    Callable(Current.Data);
+  }
+
+  /// \brief Invoke \p Callable on the data of each shard, in turn
+  template<typename F>
+  void forEach(F &&Callable) {
+    for (Shard &Current : Shards) {
+      std::lock_guard<std::mutex> Guard(Current.Lock);
+      Callable(Current.Data);
+    }
+  }
+};
+
 template<typename T>
 inline size_t digitsCount(T Value) {
   size_t Digits = 0;
@@ -35,29 +91,60 @@ inline size_t digitsCount(T Value) {
   return Digits;
 }
 
+/// \brief Count the occurrences of a set of events
+///
+/// Events can be recorded concurrently by multiple threads: each one updates
+/// its own shard, and the shards are merged when dumping.
 template<typename K, typename T = uint64_t>
 class CounterMap : public OnQuitInteraface {
 private:
   using Container = std::map<K, T>;
-  Container Map;
+  mutable ShardedStatistic<Container> Shards;
   std::string Name;
 
 public:
   CounterMap(const llvm::Twine &Name) : Name(Name.str()) { init(); }
   virtual ~CounterMap() {}
 
-  void push(K Key) { Map[Key]++; }
-  void push(K Key, T Value) { Map[Key] += Value; }
-  void clear(K Key) { Map.erase(Key); }
-  void clear() { Map.clear(); }
+  void push(K Key) {
+    Shards.update([&Key](Container &Map) { Map[Key]++; });
+  }
+
+  void push(K Key, T Value) {
+    Shards.update([&Key, &Value](Container &Map) { Map[Key] += Value; });
+  }
+
+  void clear(K Key) {
+    Shards.forEach([&Key](Container &Map) { Map.erase(Key); });
+  }
+
+  void clear() {
+    Shards.forEach([](Container &Map) { Map.clear(); });
+  }
+
+  /// \return the sum of the counters of all the threads
+  Container snapshot() const {
+    Container Result;
+    Shards.forEach([&Result](Container &Map) {
+      for (const auto &[Key, Value] : Map)
+        Result[Key] += Value;
+    });
+    return Result;
+  }
 
   virtual void onQuit() { dump(); }
 
+  virtual void print(llvm::raw_ostream &Output) {
+    dump(MaxCounterMapDump, Output);
+  }
+
   template<typename O>
   void dump(size_t Max, O &Output) {
     if (not Name.empty())
       Output << Name << ":\n";
 
+    Container Map = snapshot();
+
     using Pair = std::pair<K, T>;
     std::vector<Pair> Sorted;
     Sorted.reserve(Map.size());
@@ -98,9 +185,50 @@ private:
 /// you want to record, when you're done use the various methods to obtain mean
 /// and variance.
 ///
+/// Values can be pushed concurrently by multiple threads: each one accumulates
+/// them in its own shard, and the shards are combined when the results are
+/// requested.
+///
 /// If a name is provided, the results will be registered for printing at
 /// program termination.
 class RunningStatistics : public OnQuitInteraface {
+private:
+  /// The moments of the values recorded by a thread
+  struct Moments {
+    uint64_t N = 0;
+    double Mean = 0.0;
+    /// Sum of the squared differences from the mean
+    double M2 = 0.0;
+    double Sum = 0.0;
+
+    // TODO: make a template
+    void push(double X) {
+      N++;
+      Sum += X;
+
+      // See Knuth TAOCP vol 2, 3rd edition, page 232
+      double Delta = X - Mean;
+      Mean += Delta / N;
+      M2 += Delta * (X - Mean);
+    }
+
+    /// \brief Combine the moments of two sets of values
+    ///
+    /// See Chan, Golub and LeVeque, "Updating formulae and a pairwise
+    /// algorithm for computing sample variances".
+    void merge(const Moments &Other) {
+      if (Other.N == 0)
+        return;
+
+      uint64_t Total = N + Other.N;
+      double Delta = Other.Mean - Mean;
+      Mean += Delta * Other.N / Total;
+      M2 += Other.M2 + Delta * Delta * N * Other.N / Total;
+      Sum += Other.Sum;
+      N = Total;
+    }
+  };
+
 public:
   RunningStatistics() : RunningStatistics(llvm::Twine(), false) {}
 
@@ -110,7 +238,7 @@ public:
   /// \arg Register whether this object should be registered for being printed
   ///      upon program termination or not.
   RunningStatistics(const llvm::Twine &Name, bool Register) :
-    Name(Name.str()), N(0) {
+    Name(Name.str()) {
 
     if (Register)
       init();
@@ -118,61 +246,62 @@ public:
 
   virtual ~RunningStatistics() {}
 
-  void clear() { N = 0; }
+  void clear() {
+    Shards.forEach([](Moments &Shard) { Shard = Moments(); });
+  }
 
-  // TODO: make a template
   /// \brief Record a new value
   void push(double X) {
-    N++;
-    Sum += X;
-
-    // See Knuth TAOCP vol 2, 3rd edition, page 232
-    if (N == 1) {
-      OldM = NewM = X;
-      OldS = 0.0;
-    } else {
-      NewM = OldM + (X - OldM) / N;
-      NewS = OldS + (X - OldM) * (X - NewM);
-
-      // Set up for next iteration
-      OldM = NewM;
-      OldS = NewS;
-    }
+    Shards.update([X](Moments &Shard) { Shard.push(X); });
   }
 
   /// \return the total number of recorded values.
-  int size() const { return N; }
+  int size() const { return total().N; }
 
-  double mean() const { return (N > 0) ? NewM : 0.0; }
+  double mean() const { return total().Mean; }
 
-  double variance() const { return ((N > 1) ? NewS / (N - 1) : 0.0); }
+  double variance() const {
+    Moments Total = total();
+    return ((Total.N > 1) ? Total.M2 / (Total.N - 1) : 0.0);
+  }
 
   double standardDeviation() const { return sqrt(variance()); }
 
-  double sum() const { return Sum; }
+  double sum() const { return total().Sum; }
 
   template<typename T>
   void dump(T &Output) {
+    Moments Total = total();
+    double Variance = (Total.N > 1) ? Total.M2 / (Total.N - 1) : 0.0;
     if (not Name.empty())
       Output << Name << ": ";
-    Output << "{ s: " << sum() << " "
-           << "n: " << size() << " "
-           << "u: " << mean() << " "
-           << "o: " << variance() << " }";
+    Output << "{ s: " << Total.Sum << " "
+           << "n: " << Total.N << " "
+           << "u: " << Total.Mean << " "
+           << "o: " << Variance << " }";
   }
 
   void dump() { dump(dbg); }
 
   virtual void onQuit();
 
+  virtual void print(llvm::raw_ostream &Output) {
+    dump(Output);
+    Output << "\n";
+  }
+
 private:
   void init();
 
+  Moments total() const {
+    Moments Result;
+    Shards.forEach([&Result](Moments &Shard) { Result.merge(Shard); });
+    return Result;
+  }
+
 private:
   std::string Name;
-  int N;
-  double OldM, NewM, OldS, NewS;
-  double Sum;
+  mutable ShardedStatistic<Moments> Shards;
 };
 
 // TODO: this is duplicated
@@ -187,14 +316,26 @@ public:
 
   /// \brief Registers an object for having its onQuit method called upon
   ///        program termination
-  void add(OnQuitInteraface *S) { Register.push_back(S); }
+  void add(OnQuitInteraface *S) {
+    std::lock_guard<std::mutex> Guard(Lock);
+    Register.push_back(S);
+  }
 
   void dump() {
+    std::lock_guard<std::mutex> Guard(Lock);
     for (OnQuitInteraface *S : Register)
       S->onQuit();
   }
 
+  /// \brief Prints the current value of all the registered statistics
+  void print(llvm::raw_ostream &Output) {
+    std::lock_guard<std::mutex> Guard(Lock);
+    for (OnQuitInteraface *S : Register)
+      S->print(Output);
+  }
+
 private:
+  std::mutex Lock;
   std::vector<OnQuitInteraface *> Register;
 };
 
@@ -0,0 +1,171 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+class TaskGroup;
+
+/// \brief A pool of threads shared by all the parallel stages of revng
+///
+/// Each worker thread owns a deque of tasks: tasks spawned by a worker are
+/// pushed on the back of its own deque, and the worker picks up the most
+/// recently spawned ones first. Idle workers steal the oldest tasks from the
+/// front of the deques of the other workers. Tasks spawned from threads that
+/// are not workers end up in a shared injection queue, unless they have an
+/// affinity (see TaskGroup::spawn).
+///
+/// A scheduler using N threads spawns N - 1 workers: the thread waiting for a
+/// TaskGroup runs the pending tasks of that group too. Therefore, a scheduler
+/// with a single thread runs all the tasks sequentially in the waiting thread.
+///
+/// The number of threads of the global scheduler (see get()) is taken, in
+/// order, from the -revng-threads option, from the REVNG_THREADS environment
+/// variable or from the number of available cores.
+class TaskScheduler {
+  friend class TaskGroup;
+
+public:
+  using Task = std::function<void()>;
+
+private:
+  struct Entry {
+    TaskGroup *Group = nullptr;
+    Task Callable;
+  };
+
+  struct alignas(64) Queue {
+    std::mutex Lock;
+    std::deque<Entry> Entries;
+  };
+
+private:
+  /// One queue per worker, plus the injection queue, which is the last one
+  std::vector<std::unique_ptr<Queue>> Queues;
+  unsigned WorkersCount = 0;
+  std::vector<std::thread> Workers;
+
+  std::mutex SleepLock;
+  std::condition_variable WorkAvailable;
+  std::atomic<bool> Stop = false;
+
+  std::atomic<size_t> Queued = 0;
+  std::atomic<unsigned> ActiveGroups = 0;
+  std::atomic<uint64_t> Spawned = 0;
+  std::atomic<uint64_t> Steals = 0;
+  std::atomic<uint64_t> Cancelled = 0;
+
+public:
+  /// \param ThreadsCount the number of threads running tasks, including the
+  ///        waiting one. 0 means as many as the available cores.
+  explicit TaskScheduler(unsigned ThreadsCount);
+  ~TaskScheduler();
+
+  TaskScheduler(const TaskScheduler &) = delete;
+  TaskScheduler &operator=(const TaskScheduler &) = delete;
+
+public:
+  /// \return the scheduler shared by the whole process
+  static TaskScheduler &get();
+
+  /// \brief Replace the global scheduler with one using \p ThreadsCount
+  ///        threads
+  ///
+  /// \note no TaskGroup of the global scheduler must be alive.
+  static void setGlobalThreadsCount(unsigned ThreadsCount);
+
+  /// \return the number of threads the global scheduler is created with
+  static unsigned defaultThreadsCount();
+
+public:
+  unsigned getThreadsCount() const { return WorkersCount + 1; }
+
+  /// \return the number of tasks waiting to be run
+  size_t queueDepth() const { return Queued; }
+
+  /// \return how many tasks have been spawned so far
+  uint64_t spawnedCount() const { return Spawned; }
+
+  /// \return how many tasks have been taken from the deque of another worker
+  uint64_t stealsCount() const { return Steals; }
+
+  /// \return how many tasks have been dropped since their group was cancelled
+  uint64_t cancelledCount() const { return Cancelled; }
+
+private:
+  void spawn(TaskGroup &Group, Task Callable, const void *Affinity);
+
+  /// \brief Take a task from the queues, the oldest ones first, except for the
+  ///        deque of the current worker
+  ///
+  /// \param Only if not null, consider only the tasks of this group.
+  std::optional<Entry> take(const TaskGroup *Only);
+
+  static std::optional<Entry>
+  pop(Queue &From, const TaskGroup *Only, bool Newest);
+
+  void execute(Entry &ToRun);
+  void work(unsigned Index);
+};
+
+/// \brief A set of tasks run on a TaskScheduler that can be waited for, or
+///        cancelled, together
+///
+/// Waiting for a group only runs the tasks of that group in the waiting
+/// thread, so that a task holding a lock can safely wait for the tasks it
+/// spawned.
+class TaskGroup {
+  friend class TaskScheduler;
+
+private:
+  TaskScheduler &Scheduler;
+  std::atomic<size_t> Pending = 0;
+  std::atomic<size_t> Queued = 0;
+  std::atomic<bool> Cancelled = false;
+  std::mutex Lock;
+  std::condition_variable Changed;
+
+public:
+  explicit TaskGroup(TaskScheduler &Scheduler = TaskScheduler::get());
+
+  /// \brief Wait for all the tasks of the group
+  ~TaskGroup();
+
+  TaskGroup(const TaskGroup &) = delete;
+  TaskGroup &operator=(const TaskGroup &) = delete;
+
+public:
+  /// \brief Run \p Callable on one of the threads of the scheduler
+  ///
+  /// \param Affinity if not null, queue the task on the worker associated to
+  ///        this value, typically the llvm::LLVMContext the task works on, so
+  ///        that tasks working on the same data tend to run on the same thread.
+  ///        This is a hint: idle workers can still steal the task, tasks
+  ///        working on data that is not thread safe must still be serialized.
+  void spawn(TaskScheduler::Task Callable, const void *Affinity = nullptr);
+
+  /// \brief Wait for all the tasks spawned so far, running them in the current
+  ///        thread if no worker picked them up yet
+  void wait();
+
+  /// \brief Drop the tasks of the group that did not start yet
+  ///
+  /// Running tasks are not interrupted, but they can poll isCancelled().
+  void cancel() { Cancelled = true; }
+
+  bool isCancelled() const { return Cancelled; }
+
+private:
+  void notify();
+};
@@ -5,27 +5,51 @@
 //
 
 #include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/Twine.h"
 #include "llvm/Support/FileSystem.h"
 
 #include "revng/Support/Debug.h"
 
+/// \brief A file deleted as soon as the object goes away
+///
+/// The file can be backed by the disk or, on Linux, by an anonymous memory
+/// file (see memfd_create). In the latter case, path() is a
+/// `/proc/<pid>/fd/<fd>` path, which can be opened by the current process and
+/// by the programs it spawns, for as long as the TemporaryFile is alive.
+///
+/// In-memory files have no name on disk to derive other paths from, nor an
+/// extension, and programs cannot rename other files onto them: users relying
+/// on any of this must ask for a disk backed file.
 class TemporaryFile {
+public:
+  enum class Backend {
+    /// A regular file in the temporary directory
+    Disk,
+
+    /// An anonymous memory file, if enough memory is available (see the
+    /// -temporary-files-min-available-memory option), a disk backed one
+    /// otherwise
+    Memory
+  };
+
 private:
   llvm::SmallString<32> Path;
+  int FD = -1;
 
 public:
-  TemporaryFile(const llvm::Twine &Prefix, llvm::StringRef Suffix = "") {
-    cantFail(llvm::sys::fs::createTemporaryFile(Prefix, Suffix, Path));
-  }
+  /// \brief Create a file using the backend selected by the
+  ///        -temporary-files-backend option
+  TemporaryFile(const llvm::Twine &Prefix, llvm::StringRef Suffix = "") :
+    TemporaryFile(Prefix, Suffix, defaultBackend()) {}
+
+  TemporaryFile(const llvm::Twine &Prefix,
+                llvm::StringRef Suffix,
+                Backend Preferred);
 
   TemporaryFile(TemporaryFile &&Other) { *this = std::move(Other); }
-  TemporaryFile &operator=(TemporaryFile &&Other) {
-    Path = Other.Path;
-    Other.Path.clear();
-    return *this;
-  }
+  TemporaryFile &operator=(TemporaryFile &&Other);
 
-  ~TemporaryFile() { cantFail(llvm::sys::fs::remove(Path)); }
+  ~TemporaryFile() { reset(); }
 
 public:
   TemporaryFile(const TemporaryFile &) = delete;
@@ -37,6 +61,11 @@ public:
     return Path;
   }
 
+  bool isInMemory() const { return FD >= 0; }
+
+  /// \return the backend selected by the -temporary-files-backend option
+  static Backend defaultBackend();
+
 private:
-  static void cantFail(std::error_code EC) { revng_assert(!EC); }
+  void reset();
 };
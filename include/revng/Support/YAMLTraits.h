@@ -4,6 +4,8 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <optional>
+
 #include "llvm/Support/Error.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/YAMLTraits.h"
@@ -23,6 +25,8 @@ concept HasScalarEnumTraits = llvm::yaml::has_ScalarEnumerationTraits<T>::value;
 template<typename T>
 concept HasScalarOrEnumTraits = HasScalarTraits<T> or HasScalarEnumTraits<T>;
 
+/// \return the name of the first case matching \p V, as llvm::yaml::Output
+///         would emit it, or an empty string if there's none
 template<HasScalarEnumTraits T>
 inline llvm::StringRef getNameFromYAMLEnumScalar(T V) {
   using namespace llvm::yaml;
@@ -32,7 +36,7 @@ inline llvm::StringRef getNameFromYAMLEnumScalar(T V) {
                   llvm::StringRef Name,
                   const T &M,
                   llvm::yaml::QuotingType = llvm::yaml::QuotingType::None) {
-      if (V == M) {
+      if (Result.empty() and V == M) {
         Result = Name;
       }
     }
@@ -62,6 +66,34 @@ T getInvalidValueFromYAMLScalar() {
   revng_abort();
 }
 
+/// \return the value of the case named \p Name, or std::nullopt if there's
+///         none
+template<HasScalarEnumTraits T>
+inline std::optional<T> tryGetValueFromYAMLEnumScalar(llvm::StringRef Name) {
+  struct GetScalarIO {
+    bool Found = false;
+    llvm::StringRef TargetName;
+    void enumCase(T &V,
+                  llvm::StringRef Name,
+                  const T &M,
+                  llvm::yaml::QuotingType = llvm::yaml::QuotingType::None) {
+      if (TargetName == Name) {
+        revng_assert(not Found);
+        Found = true;
+        V = M;
+      }
+    }
+  };
+
+  T Result;
+  GetScalarIO ExtractValue{ false, Name };
+  llvm::yaml::ScalarEnumerationTraits<T>::enumeration(ExtractValue, Result);
+  if (not ExtractValue.Found)
+    return std::nullopt;
+
+  return Result;
+}
+
 template<HasScalarOrEnumTraits T>
 inline T getValueFromYAMLScalar(llvm::StringRef Name) {
   using namespace llvm::yaml;
@@ -71,23 +103,9 @@ inline T getValueFromYAMLScalar(llvm::StringRef Name) {
   if constexpr (has_ScalarTraits<T>::value) {
     llvm::yaml::ScalarTraits<T>::input(Name, nullptr, Result);
   } else {
-    struct GetScalarIO {
-      bool Found = false;
-      llvm::StringRef TargetName;
-      void enumCase(T &V,
-                    llvm::StringRef Name,
-                    const T &M,
-                    llvm::yaml::QuotingType = llvm::yaml::QuotingType::None) {
-        if (TargetName == Name) {
-          revng_assert(not Found);
-          Found = true;
-          V = M;
-        }
-      }
-    };
-    GetScalarIO ExtractValue{ false, Name };
-    llvm::yaml::ScalarEnumerationTraits<T>::enumeration(ExtractValue, Result);
-    if (not ExtractValue.Found)
+    if (auto MaybeResult = tryGetValueFromYAMLEnumScalar<T>(Name))
+      Result = *MaybeResult;
+    else
       Result = getInvalidValueFromYAMLScalar<T>();
   }
 
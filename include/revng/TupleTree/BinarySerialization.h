@@ -0,0 +1,407 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Casting.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/LEB128.h"
+#include "llvm/Support/YAMLTraits.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+
+#include "revng/ADT/KeyedObjectContainer.h"
+#include "revng/ADT/STLExtras.h"
+#include "revng/ADT/SortedVector.h"
+#include "revng/ADT/UpcastablePointer.h"
+#include "revng/Support/Assert.h"
+#include "revng/Support/YAMLTraits.h"
+#include "revng/TupleTree/TupleLikeTraits.h"
+
+/// A compact binary encoding of tuple trees, to be used in place of YAML when
+/// the serialized object is not meant to be read by humans.
+///
+/// The encoding is driven by the same introspection metadata as the YAML
+/// one:
+///
+/// * tuple-like objects are the sequence of their fields, without names;
+/// * containers are the number of elements followed by the elements, keyed
+///   containers are written in key order, so reading them back does not
+///   require sorting;
+/// * upcastable pointers are the index of the concrete type in
+///   concrete_types_traits (0 for nullptr, I + 1 otherwise), followed by the
+///   fields of the concrete type;
+/// * integers and enums are LEB128 encoded, strings are length prefixed;
+/// * any other scalar is encoded as the string its llvm::yaml::ScalarTraits
+///   produce.
+///
+/// Since field names are not serialized, the header carries a hash of the
+/// structure of the root type and deserialization fails if it does not match
+/// the one of the reading program.
+namespace tupletree::binary {
+
+inline constexpr llvm::StringLiteral Magic = "\x7frevngTT";
+inline constexpr uint64_t Version = 1;
+
+template<typename T>
+concept IsStdVector = is_specialization_v<T, std::vector>;
+
+template<typename T>
+concept IsSortedVector = is_specialization_v<T, SortedVector>;
+
+namespace detail {
+
+template<typename Tuple, typename T, size_t I = 0>
+constexpr size_t tupleIndexOf() {
+  if constexpr (I == std::tuple_size_v<Tuple>)
+    return I;
+  else if constexpr (std::is_same_v<std::tuple_element_t<I, Tuple>, T>)
+    return I;
+  else
+    return tupleIndexOf<Tuple, T, I + 1>();
+}
+
+template<typename T>
+void describe(std::string &Out);
+
+template<typename T, size_t I = 0>
+void describeFields(std::string &Out) {
+  if constexpr (I < std::tuple_size_v<T>) {
+    Out += ",";
+    if constexpr (HasTupleLikeTraits<T>)
+      Out += TupleLikeTraits<T>::FieldsName[I];
+    Out += ":";
+    describe<std::remove_cvref_t<std::tuple_element_t<I, T>>>(Out);
+    describeFields<T, I + 1>(Out);
+  }
+}
+
+template<typename Tuple, size_t I = 0>
+void describeTypes(std::string &Out) {
+  if constexpr (I < std::tuple_size_v<Tuple>) {
+    describe<std::tuple_element_t<I, Tuple>>(Out);
+    describeTypes<Tuple, I + 1>(Out);
+  }
+}
+
+/// Describes the shape of T, used to detect mismatching schemas
+template<typename T>
+void describe(std::string &Out) {
+  if constexpr (UpcastablePointerLike<T>) {
+    Out += "<";
+    describeTypes<concrete_types_traits_t<pointee<T>>>(Out);
+    Out += ">";
+  } else if constexpr (IsKeyedObjectContainer<T> or IsStdVector<T>) {
+    Out += "[";
+    describe<typename T::value_type>(Out);
+    Out += "]";
+  } else if constexpr (HasTupleSize<T>) {
+    Out += "{";
+    if constexpr (HasTupleLikeTraits<T>)
+      Out += TupleLikeTraits<T>::Name;
+    describeFields<T>(Out);
+    Out += "}";
+  } else if constexpr (std::is_integral_v<T> or std::is_enum_v<T>) {
+    Out += std::is_signed_v<T> ? "i" : "u";
+    Out += std::to_string(sizeof(T));
+  } else {
+    static_assert(HasScalarTraits<T>);
+    Out += "s";
+  }
+}
+
+class Writer {
+private:
+  llvm::raw_ostream &OS;
+
+public:
+  explicit Writer(llvm::raw_ostream &OS) : OS(OS) {}
+
+public:
+  void writeUnsigned(uint64_t Value) { llvm::encodeULEB128(Value, OS); }
+  void writeSigned(int64_t Value) { llvm::encodeSLEB128(Value, OS); }
+
+  void writeString(llvm::StringRef String) {
+    writeUnsigned(String.size());
+    OS << String;
+  }
+
+  template<typename T>
+  void write(const T &Value) {
+    if constexpr (UpcastablePointerLike<T>) {
+      using concrete_types = concrete_types_traits_t<pointee<T>>;
+      if (Value.get() == nullptr) {
+        writeUnsigned(0);
+        return;
+      }
+
+      upcast(Value, [this](const auto &Upcasted) {
+        using type = std::remove_cvref_t<decltype(Upcasted)>;
+        constexpr size_t Index = tupleIndexOf<concrete_types, type>();
+        static_assert(Index < std::tuple_size_v<concrete_types>);
+        writeUnsigned(Index + 1);
+        write(Upcasted);
+      });
+    } else if constexpr (IsKeyedObjectContainer<T> or IsStdVector<T>) {
+      writeUnsigned(Value.size());
+      for (const auto &Element : Value)
+        write(Element);
+    } else if constexpr (HasTupleSize<T>) {
+      writeFields(Value);
+    } else if constexpr (std::is_same_v<T, bool>) {
+      writeUnsigned(Value ? 1 : 0);
+    } else if constexpr (std::is_integral_v<T> and std::is_signed_v<T>) {
+      writeSigned(Value);
+    } else if constexpr (std::is_integral_v<T>) {
+      writeUnsigned(Value);
+    } else if constexpr (std::is_enum_v<T>) {
+      using underlying = std::underlying_type_t<T>;
+      write(static_cast<underlying>(Value));
+    } else if constexpr (std::is_same_v<T, std::string>) {
+      writeString(Value);
+    } else {
+      static_assert(HasScalarTraits<T>);
+      writeString(getNameFromYAMLScalar(Value));
+    }
+  }
+
+private:
+  template<size_t I = 0, typename T>
+  void writeFields(const T &Value) {
+    if constexpr (I < std::tuple_size_v<T>) {
+      write(get<I>(Value));
+      writeFields<I + 1>(Value);
+    }
+  }
+};
+
+class Reader {
+private:
+  llvm::StringRef Buffer;
+  std::string ErrorMessage;
+
+public:
+  explicit Reader(llvm::StringRef Buffer) : Buffer(Buffer) {}
+
+public:
+  bool failed() const { return not ErrorMessage.empty(); }
+  bool atEnd() const { return Buffer.empty(); }
+
+  llvm::Error takeError() {
+    if (not failed())
+      return llvm::Error::success();
+
+    return llvm::createStringError(llvm::inconvertibleErrorCode(),
+                                   ErrorMessage);
+  }
+
+  void fail(const llvm::Twine &Message) {
+    if (not failed())
+      ErrorMessage = Message.str();
+
+    // Stop consuming input
+    Buffer = llvm::StringRef();
+  }
+
+public:
+  uint64_t readUnsigned() {
+    const char *Error = nullptr;
+    unsigned Size = 0;
+    auto *Start = reinterpret_cast<const uint8_t *>(Buffer.data());
+    auto *End = reinterpret_cast<const uint8_t *>(Buffer.end());
+    uint64_t Result = llvm::decodeULEB128(Start, &Size, End, &Error);
+    if (Error != nullptr) {
+      fail(Error);
+      return 0;
+    }
+
+    Buffer = Buffer.drop_front(Size);
+    return Result;
+  }
+
+  int64_t readSigned() {
+    const char *Error = nullptr;
+    unsigned Size = 0;
+    auto *Start = reinterpret_cast<const uint8_t *>(Buffer.data());
+    auto *End = reinterpret_cast<const uint8_t *>(Buffer.end());
+    int64_t Result = llvm::decodeSLEB128(Start, &Size, End, &Error);
+    if (Error != nullptr) {
+      fail(Error);
+      return 0;
+    }
+
+    Buffer = Buffer.drop_front(Size);
+    return Result;
+  }
+
+  /// \note the result points into the buffer being read, no copy is done
+  llvm::StringRef readString() {
+    uint64_t Size = readUnsigned();
+    if (Size > Buffer.size()) {
+      fail("Truncated string");
+      return llvm::StringRef();
+    }
+
+    llvm::StringRef Result = Buffer.take_front(Size);
+    Buffer = Buffer.drop_front(Size);
+    return Result;
+  }
+
+  template<typename T>
+  void read(T &Value) {
+    if (failed())
+      return;
+
+    if constexpr (UpcastablePointerLike<T>) {
+      using concrete_types = concrete_types_traits_t<pointee<T>>;
+      uint64_t Index = readUnsigned();
+      if (Index == 0)
+        Value.reset();
+      else if (Index > std::tuple_size_v<concrete_types>)
+        fail("Invalid concrete type index");
+      else
+        readConcrete(Value, Index - 1);
+    } else if constexpr (IsSortedVector<T>) {
+      uint64_t Size = readUnsigned();
+      Value.clear();
+
+      // Elements have been written in key order, the batch inserter will find
+      // them already sorted. Since the key is checked only upon commit, the
+      // elements can be read in place, avoiding a copy.
+      auto Inserter = Value.batch_insert();
+      for (uint64_t I = 0; I < Size and not failed(); ++I)
+        read(Inserter.insert(typename T::value_type{}));
+    } else if constexpr (IsKeyedObjectContainer<T>) {
+      uint64_t Size = readUnsigned();
+      Value.clear();
+
+      auto Inserter = Value.batch_insert();
+      for (uint64_t I = 0; I < Size and not failed(); ++I) {
+        typename T::value_type Element{};
+        read(Element);
+        Inserter.insert(Element);
+      }
+    } else if constexpr (IsStdVector<T>) {
+      uint64_t Size = readUnsigned();
+      Value.clear();
+      for (uint64_t I = 0; I < Size and not failed(); ++I)
+        read(Value.emplace_back());
+    } else if constexpr (HasTupleSize<T>) {
+      readFields(Value);
+    } else if constexpr (std::is_same_v<T, bool>) {
+      Value = readUnsigned() != 0;
+    } else if constexpr (std::is_integral_v<T> and std::is_signed_v<T>) {
+      Value = static_cast<T>(readSigned());
+    } else if constexpr (std::is_integral_v<T>) {
+      Value = static_cast<T>(readUnsigned());
+    } else if constexpr (std::is_enum_v<T>) {
+      std::underlying_type_t<T> Underlying{};
+      read(Underlying);
+      Value = static_cast<T>(Underlying);
+    } else if constexpr (std::is_same_v<T, std::string>) {
+      Value = readString().str();
+    } else {
+      static_assert(HasScalarTraits<T>);
+      llvm::StringRef String = readString();
+      if (failed())
+        return;
+
+      llvm::StringRef Error = llvm::yaml::ScalarTraits<T>::input(String,
+                                                                 nullptr,
+                                                                 Value);
+      if (not Error.empty())
+        fail("Invalid scalar \"" + String + "\": " + Error);
+    }
+  }
+
+private:
+  template<typename P, size_t I = 0>
+  void readConcrete(P &Pointer, uint64_t Index) {
+    using concrete_types = concrete_types_traits_t<pointee<P>>;
+    if constexpr (I < std::tuple_size_v<concrete_types>) {
+      using type = std::tuple_element_t<I, concrete_types>;
+      if (Index == I) {
+        Pointer = P::template make<type>();
+        read(*llvm::cast<type>(Pointer.get()));
+      } else {
+        readConcrete<P, I + 1>(Pointer, Index);
+      }
+    } else {
+      revng_abort();
+    }
+  }
+
+  template<size_t I = 0, typename T>
+  void readFields(T &Value) {
+    if constexpr (I < std::tuple_size_v<T>) {
+      read(get<I>(Value));
+      readFields<I + 1>(Value);
+    }
+  }
+};
+
+} // namespace detail
+
+/// \return a hash of the structure of T, recorded in the header
+template<typename T>
+uint64_t schemaHash() {
+  static const uint64_t Hash = []() {
+    std::string Description;
+    detail::describe<T>(Description);
+    return llvm::xxHash64(Description);
+  }();
+  return Hash;
+}
+
+/// \return true if \p Buffer looks like the output of serialize
+inline bool isBinarySerialization(llvm::StringRef Buffer) {
+  return Buffer.startswith(Magic);
+}
+
+template<typename T>
+void serialize(llvm::raw_ostream &OS, const T &Root) {
+  OS << Magic;
+  detail::Writer W(OS);
+  W.writeUnsigned(Version);
+  W.writeUnsigned(schemaHash<T>());
+  W.write(Root);
+}
+
+/// Deserializes an object serialized with serialize
+///
+/// The buffer is decoded in place, no intermediate representation is built.
+template<typename T>
+llvm::Expected<T> deserialize(llvm::StringRef Buffer) {
+  using namespace llvm;
+
+  if (not isBinarySerialization(Buffer))
+    return createStringError(inconvertibleErrorCode(),
+                             "Not a binary tuple tree");
+
+  detail::Reader R(Buffer.drop_front(Magic.size()));
+  if (uint64_t FoundVersion = R.readUnsigned(); FoundVersion != Version)
+    R.fail("Unsupported version " + Twine(FoundVersion));
+  if (R.readUnsigned() != schemaHash<T>())
+    R.fail("The binary tuple tree has been produced with a different schema");
+
+  T Result;
+  R.read(Result);
+
+  if (not R.failed() and not R.atEnd())
+    R.fail("Trailing data after binary tuple tree");
+
+  if (R.failed())
+    return R.takeError();
+
+  return Result;
+}
+
+} // namespace tupletree::binary
@@ -0,0 +1,499 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <functional>
+#include <istream>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <utility>
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/YAMLTraits.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "revng/ADT/KeyedObjectContainer.h"
+#include "revng/Support/YAMLTraits.h"
+#include "revng/TupleTree/TupleLikeTraits.h"
+#include "revng/TupleTree/TupleTreeDiff.h"
+
+namespace tupletreediff::streaming {
+
+/// \brief A single value to deserialize out of a YAML chunk
+template<typename T>
+struct ValueWrapper {
+  T Value;
+};
+
+inline llvm::Error makeError(const llvm::Twine &Message) {
+  return llvm::createStringError(llvm::inconvertibleErrorCode(),
+                                 Message.str());
+}
+
+/// \brief Split, line by line, a YAML document produced by llvm::yaml::Output
+///
+/// Only the current line is kept in memory, along with the chunk being
+/// produced: either a top-level key or a single element of a top-level
+/// sequence.
+///
+/// The reader relies on the layout emitted by llvm::yaml::Output: each
+/// top-level key starts at column zero and everything else, except for the
+/// elements of a sequence that is not indented, is indented.
+class YAMLChunkReader {
+private:
+  std::istream &Input;
+  std::string Line;
+  bool AtEnd = false;
+
+  /// Indentation of the elements of the current sequence
+  std::optional<size_t> ElementIndent;
+
+public:
+  explicit YAMLChunkReader(std::istream &Input) : Input(Input) {}
+
+public:
+  llvm::Error start() {
+    advance();
+    if (AtEnd or not llvm::StringRef(Line).startswith("---"))
+      return makeError("Streaming diff requires a YAML document");
+
+    advance();
+    skipBlankLines();
+    return llvm::Error::success();
+  }
+
+  /// \return the current top-level key, if any
+  std::optional<llvm::StringRef> key() const {
+    if (not isTopLevelKey())
+      return std::nullopt;
+    return llvm::StringRef(Line).split(':').first.rtrim();
+  }
+
+  /// \brief Consume the current top-level key and return it as the value of
+  ///        key `Value`
+  std::string readValue() {
+    revng_assert(isTopLevelKey());
+    std::string Result = "Value:";
+    Result += llvm::StringRef(Line).split(':').second;
+    Result += "\n";
+    advance();
+
+    while (not atDocumentEnd() and not isTopLevelKey()) {
+      Result += Line;
+      Result += "\n";
+      advance();
+    }
+
+    return Result;
+  }
+
+  /// \brief Start consuming a top-level key holding a sequence
+  ///
+  /// \return the inline value of the key, e.g., `[]`, if any.
+  std::optional<std::string> beginSequence() {
+    revng_assert(isTopLevelKey());
+    llvm::StringRef Inline = llvm::StringRef(Line).split(':').second.trim();
+    std::optional<std::string> Result;
+    if (not Inline.empty())
+      Result = "Value: " + Inline.str() + "\n";
+    advance();
+    ElementIndent.reset();
+    return Result;
+  }
+
+  /// \return the next element of the current sequence, as the only element of
+  ///         a sequence under key `Value`, or std::nullopt at its end.
+  std::optional<std::string> nextElement() {
+    skipBlankLines();
+    if (atDocumentEnd() or isTopLevelKey() or not isElementStart())
+      return std::nullopt;
+
+    std::string Result = "Value:\n";
+    Result += Line;
+    Result += "\n";
+    advance();
+
+    while (not atDocumentEnd() and not isTopLevelKey()
+           and not isElementStart()) {
+      Result += Line;
+      Result += "\n";
+      advance();
+    }
+
+    return Result;
+  }
+
+  /// \brief Skip what's left of the current top-level key
+  void skipValue() {
+    while (not atDocumentEnd() and not isTopLevelKey())
+      advance();
+  }
+
+private:
+  void advance() {
+    if (AtEnd)
+      return;
+
+    if (not std::getline(Input, Line)) {
+      AtEnd = true;
+      Line.clear();
+    } else if (not Line.empty() and Line.back() == '\r') {
+      Line.pop_back();
+    }
+  }
+
+  void skipBlankLines() {
+    while (not AtEnd and llvm::StringRef(Line).trim().empty())
+      advance();
+  }
+
+  bool atDocumentEnd() const {
+    llvm::StringRef Current(Line);
+    return AtEnd or Current == "..." or Current.startswith("---");
+  }
+
+  bool isTopLevelKey() const {
+    if (atDocumentEnd() or Line.empty())
+      return false;
+    char First = Line[0];
+    return First != ' ' and First != '\t' and First != '-' and First != '#';
+  }
+
+  /// \return true if the current line starts a new element of the current
+  ///         sequence
+  bool isElementStart() {
+    llvm::StringRef Current(Line);
+    llvm::StringRef Trimmed = Current.ltrim(' ');
+    size_t Indent = Current.size() - Trimmed.size();
+    bool IsDash = Trimmed == "-" or Trimmed.startswith("- ");
+
+    if (not ElementIndent) {
+      if (not IsDash)
+        return false;
+      ElementIndent = Indent;
+    }
+
+    return IsDash and Indent == *ElementIndent;
+  }
+};
+
+/// \brief Diff two serialized tuple trees without deserializing them
+///
+/// The top-level fields of the two documents are visited in lockstep. Fields
+/// that are sorted containers are visited one element at a time: since the
+/// elements are sorted by key, a merge of the two sequences finds additions,
+/// removals and elements to compare. Only the current element of each side is
+/// deserialized and elements with the same serialization are skipped
+/// altogether. All the other fields are deserialized and compared as a whole.
+///
+/// The changes are written to the output as soon as they are found, in the
+/// same format as TupleTreeDiff::dump.
+///
+/// \note the top-level keys are expected in the order of the fields, which is
+///       the order in which llvm::yaml::Output emits them.
+template<typename M>
+class StreamingDiff {
+private:
+  llvm::raw_ostream &Output;
+  tupletreediff::detail::Diff<M> Differ;
+  size_t ChangesCount = 0;
+
+public:
+  explicit StreamingDiff(llvm::raw_ostream &Output) : Output(Output) {}
+
+public:
+  /// \return the number of changes found
+  llvm::Expected<size_t> run(std::istream &LHSInput, std::istream &RHSInput) {
+    YAMLChunkReader LHS(LHSInput);
+    YAMLChunkReader RHS(RHSInput);
+
+    if (auto Error = LHS.start())
+      return std::move(Error);
+    if (auto Error = RHS.start())
+      return std::move(Error);
+
+    if (auto Error = diffFields(LHS, RHS))
+      return std::move(Error);
+
+    for (YAMLChunkReader *Reader : { &LHS, &RHS })
+      if (auto Key = Reader->key())
+        return makeError("Unexpected key " + *Key + ": top-level keys must be "
+                         "fields, in the order in which they are declared");
+
+    if (ChangesCount == 0)
+      TupleTreeDiff<M>().dump(Output);
+    else
+      Output << "...\n";
+
+    return ChangesCount;
+  }
+
+private:
+  template<size_t I = 0>
+  llvm::Error diffFields(YAMLChunkReader &LHS, YAMLChunkReader &RHS) {
+    if constexpr (I < std::tuple_size_v<M>) {
+      using FieldType = std::tuple_element_t<I, M>;
+      llvm::StringRef Name = TupleLikeTraits<M>::FieldsName[I];
+
+      bool InLHS = LHS.key() == Name;
+      bool InRHS = RHS.key() == Name;
+
+      Differ.Stack.push_back(size_t(I));
+      llvm::Error Error = diffField<FieldType>(LHS, InLHS, RHS, InRHS);
+      Differ.Stack.pop_back();
+
+      if (Error)
+        return Error;
+
+      flush();
+
+      // Recur
+      return diffFields<I + 1>(LHS, RHS);
+    } else {
+      return llvm::Error::success();
+    }
+  }
+
+  template<typename T>
+  llvm::Error diffField(YAMLChunkReader &LHS,
+                        bool InLHS,
+                        YAMLChunkReader &RHS,
+                        bool InRHS) {
+    if constexpr (SortedContainer<T>)
+      return diffSequence<T>(LHS, InLHS, RHS, InRHS);
+    else
+      return diffValue<T>(LHS, InLHS, RHS, InRHS);
+  }
+
+  template<typename T>
+  static llvm::Expected<T> parse(llvm::StringRef Chunk) {
+    using Wrapper = ValueWrapper<T>;
+    auto MaybeWrapper = ::detail::deserializeImpl<Wrapper>(Chunk);
+    if (not MaybeWrapper)
+      return MaybeWrapper.takeError();
+    return std::move(MaybeWrapper->Value);
+  }
+
+  template<typename T>
+  llvm::Error diffValue(YAMLChunkReader &LHS,
+                        bool InLHS,
+                        YAMLChunkReader &RHS,
+                        bool InRHS) {
+    std::optional<std::string> LHSChunk;
+    std::optional<std::string> RHSChunk;
+    if (InLHS)
+      LHSChunk = LHS.readValue();
+    if (InRHS)
+      RHSChunk = RHS.readValue();
+
+    if (LHSChunk == RHSChunk)
+      return llvm::Error::success();
+
+    T LHSValue{};
+    T RHSValue{};
+    if (LHSChunk) {
+      auto MaybeValue = parse<T>(*LHSChunk);
+      if (not MaybeValue)
+        return MaybeValue.takeError();
+      LHSValue = std::move(*MaybeValue);
+    }
+
+    if (RHSChunk) {
+      auto MaybeValue = parse<T>(*RHSChunk);
+      if (not MaybeValue)
+        return MaybeValue.takeError();
+      RHSValue = std::move(*MaybeValue);
+    }
+
+    Differ.diffSubtree(LHSValue, RHSValue);
+    return llvm::Error::success();
+  }
+
+  /// \brief The current element of a sequence being merged
+  template<typename C>
+  class Cursor {
+  private:
+    using value_type = typename C::value_type;
+    using KOT = KeyedObjectTraits<value_type>;
+    using key_type = std::decay_t<decltype(KOT::key(
+      std::declval<value_type>()))>;
+
+  private:
+    YAMLChunkReader *Reader = nullptr;
+
+    /// Elements of a sequence serialized inline
+    std::optional<C> Inline;
+    typename C::iterator InlineIt;
+
+    std::optional<key_type> LastKey;
+
+  public:
+    std::optional<std::string> Text;
+    std::optional<value_type> Value;
+
+  public:
+    llvm::Error begin(YAMLChunkReader &TheReader, bool Present) {
+      if (not Present)
+        return llvm::Error::success();
+
+      Reader = &TheReader;
+      if (auto InlineChunk = Reader->beginSequence()) {
+        auto MaybeInline = parse<C>(*InlineChunk);
+        if (not MaybeInline)
+          return MaybeInline.takeError();
+        Inline = std::move(*MaybeInline);
+        InlineIt = Inline->begin();
+      }
+
+      next();
+      return llvm::Error::success();
+    }
+
+    bool valid() const { return Text or Value; }
+
+    void next() {
+      Text.reset();
+      Value.reset();
+
+      if (Reader == nullptr)
+        return;
+
+      if (Inline) {
+        if (InlineIt != Inline->end())
+          Value = *InlineIt++;
+      } else {
+        Text = Reader->nextElement();
+      }
+
+      if (not valid()) {
+        Reader->skipValue();
+        Reader = nullptr;
+      }
+    }
+
+    /// \brief Deserialize the current element, if necessary
+    llvm::Error load() {
+      // Elements serialized inline have already been deserialized, and sorted
+      if (Value)
+        return llvm::Error::success();
+
+      auto MaybeSequence = parse<C>(*Text);
+      if (not MaybeSequence)
+        return MaybeSequence.takeError();
+      if (MaybeSequence->size() != 1)
+        return makeError("Unexpected sequence element:\n" + *Text);
+
+      Value = std::move(*MaybeSequence->begin());
+      return checkOrder();
+    }
+
+    key_type key() const { return KOT::key(*Value); }
+
+  private:
+    llvm::Error checkOrder() {
+      key_type Key = key();
+      if (LastKey and not std::less<key_type>()(*LastKey, Key))
+        return makeError("Streaming diff requires sorted sequences");
+      LastKey = Key;
+      return llvm::Error::success();
+    }
+  };
+
+  template<typename C>
+  llvm::Error diffSequence(YAMLChunkReader &LHS,
+                           bool InLHS,
+                           YAMLChunkReader &RHS,
+                           bool InRHS) {
+    using value_type = typename C::value_type;
+    using KOT = KeyedObjectTraits<value_type>;
+
+    Cursor<C> Left;
+    Cursor<C> Right;
+    if (auto Error = Left.begin(LHS, InLHS))
+      return Error;
+    if (auto Error = Right.begin(RHS, InRHS))
+      return Error;
+
+    while (Left.valid() or Right.valid()) {
+      // Identical serializations, identical elements
+      if (Left.Text and Right.Text and *Left.Text == *Right.Text) {
+        Left.next();
+        Right.next();
+        continue;
+      }
+
+      if (Left.valid())
+        if (auto Error = Left.load())
+          return Error;
+      if (Right.valid())
+        if (auto Error = Right.load())
+          return Error;
+
+      bool AdvanceLeft = false;
+      bool AdvanceRight = false;
+      if (not Right.valid()
+          or (Left.valid() and Left.key() < Right.key())) {
+        // Removed
+        Differ.Result.remove(Differ.Stack, *Left.Value);
+        AdvanceLeft = true;
+      } else if (not Left.valid() or Right.key() < Left.key()) {
+        // Added
+        Differ.Result.add(Differ.Stack, *Right.Value);
+        AdvanceRight = true;
+      } else {
+        // Same key, possibly different content
+        Differ.Stack.push_back(KOT::key(*Left.Value));
+        Differ.diffSubtree(*Left.Value, *Right.Value);
+        Differ.Stack.pop_back();
+        AdvanceLeft = true;
+        AdvanceRight = true;
+      }
+
+      if (AdvanceLeft)
+        Left.next();
+      if (AdvanceRight)
+        Right.next();
+
+      flush();
+    }
+
+    return llvm::Error::success();
+  }
+
+  /// \brief Write the changes found so far and forget about them
+  void flush() {
+    auto &Changes = Differ.Result.Changes;
+    if (Changes.empty())
+      return;
+
+    if (ChangesCount == 0)
+      Output << "---\nChanges:\n";
+
+    // Serialize as a TupleTreeDiff and keep only the elements of Changes
+    llvm::StringRef Header = "Changes:\n";
+    std::string Buffer = serializeToString(Differ.Result);
+    llvm::StringRef Body(Buffer);
+    Body = Body.drop_front(Body.find(Header) + Header.size());
+    if (Body.endswith("...\n"))
+      Body = Body.drop_back(4);
+    Output << Body;
+
+    ChangesCount += Changes.size();
+    Changes.clear();
+  }
+};
+
+} // namespace tupletreediff::streaming
+
+template<typename T>
+struct llvm::yaml::MappingTraits<tupletreediff::streaming::ValueWrapper<T>> {
+  static void
+  mapping(IO &IO, tupletreediff::streaming::ValueWrapper<T> &Wrapper) {
+    IO.mapRequired("Value", Wrapper.Value);
+  }
+};
@@ -24,18 +24,28 @@
 #include "revng/Support/Assert.h"
 #include "revng/Support/Debug.h"
 #include "revng/Support/YAMLTraits.h"
+#include "revng/TupleTree/BinarySerialization.h"
 #include "revng/TupleTree/TupleTreeCompatible.h"
 #include "revng/TupleTree/TupleTreePath.h"
 #include "revng/TupleTree/TupleTreeReference.h"
 #include "revng/TupleTree/Visits.h"
+#include "revng/TupleTree/YAMLSerialization.h"
 
 template<TupleTreeCompatible T>
 class TupleTree {
 private:
+  /// Storage for the objects owned by the UpcastablePointers of the tree,
+  /// used when the tree is loaded or cloned
+  revng::UpcastablePointerArena::Handle Arena;
   std::unique_ptr<T> Root;
 
+  /// Bumped on any non-const access, invalidates the objects cached by the
+  /// references in the tree. It's on the heap so that it survives moves.
+  std::unique_ptr<tupletree::detail::TreeGeneration> Generation;
+
 public:
-  TupleTree() : Root(new T) {}
+  TupleTree() :
+    Root(new T), Generation(new tupletree::detail::TreeGeneration) {}
 
   // Prevent accidental copy
   TupleTree(const TupleTree &Other) = delete;
@@ -50,7 +60,10 @@ public:
     TupleTree Result;
 
     // Copy the root
-    Result.Root.reset(new T(*Root));
+    {
+      revng::UpcastablePointerArena::Scope Scope(Result.Arena.get());
+      Result.Root.reset(new T(*Root));
+    }
 
     // Update references to root
     Result.initializeReferences();
@@ -69,11 +82,29 @@ public:
   }
 
 public:
+  /// Deserializes a tuple tree, either from YAML or, if it has been produced
+  /// with serializeBinary, from its binary representation
+  ///
+  /// YAML documents are read through tupletree::yaml, if possible, falling
+  /// back to llvm::yaml::Input.
   static llvm::ErrorOr<TupleTree> deserialize(llvm::StringRef YAMLString) {
+    if (tupletree::binary::isBinarySerialization(YAMLString))
+      return deserializeBinary(YAMLString);
+
     TupleTree Result;
 
     Result.Root = std::make_unique<T>();
-    llvm::yaml::Input YAMLInput(YAMLString);
+
+    revng::UpcastablePointerArena::Scope Scope(Result.Arena.get());
+    if constexpr (tupletree::yaml::IsSupported<T>) {
+      if (tupletree::yaml::deserialize(YAMLString, *Result.Root)) {
+        Result.initializeReferences();
+        return Result;
+      }
+
+      // Start over
+      Result.Root = std::make_unique<T>();
+    }
 
     auto MaybeRoot = detail::deserializeImpl<T>(YAMLString);
     if (not MaybeRoot)
@@ -87,6 +118,20 @@ public:
     return Result;
   }
 
+  static llvm::ErrorOr<TupleTree> deserializeBinary(llvm::StringRef Buffer) {
+    TupleTree Result;
+    revng::UpcastablePointerArena::Scope Scope(Result.Arena.get());
+    auto MaybeRoot = tupletree::binary::deserialize<T>(Buffer);
+    if (not MaybeRoot)
+      return llvm::errorToErrorCode(MaybeRoot.takeError());
+    *Result.Root = std::move(*MaybeRoot);
+
+    // Update references to root
+    Result.initializeReferences();
+
+    return Result;
+  }
+
   static llvm::ErrorOr<TupleTree> fromFile(const llvm::StringRef &Path) {
     auto MaybeBuffer = llvm::MemoryBuffer::getFile(Path);
     if (not MaybeBuffer)
@@ -96,7 +141,19 @@ public:
   }
 
   llvm::Error toFile(const llvm::StringRef &Path) const {
-    return ::serializeToFile(*Root, Path);
+    if constexpr (tupletree::yaml::IsSupported<T>) {
+      std::error_code EC;
+      llvm::raw_fd_ostream OutFile(Path, EC, llvm::sys::fs::CD_CreateAlways);
+      if (EC)
+        return llvm::make_error<llvm::StringError>("Could not open file "
+                                                     + Path.str(),
+                                                   EC);
+
+      serialize(OutFile);
+      return llvm::Error::success();
+    } else {
+      return ::serializeToFile(*Root, Path);
+    }
   }
 
 public:
@@ -104,7 +161,11 @@ public:
   void serialize(S &Stream) const {
     revng_assert(Root);
 
-    ::serialize(Stream, *Root);
+    if constexpr (tupletree::yaml::IsSupported<T>
+                  and std::is_base_of_v<llvm::raw_ostream, S>)
+      tupletree::yaml::serialize(Stream, *Root);
+    else
+      ::serialize(Stream, *Root);
   }
 
   void serialize(std::string &Buffer) const {
@@ -112,23 +173,60 @@ public:
     serialize(Stream);
   }
 
+  /// Serializes the tree in a compact binary format, much faster to load than
+  /// YAML. deserialize detects it automatically.
+  void serializeBinary(llvm::raw_ostream &Stream) const {
+    revng_assert(Root);
+
+    tupletree::binary::serialize(Stream, *Root);
+  }
+
 public:
-  T *get() noexcept { return Root.get(); }
+  T *get() noexcept {
+    invalidateCaches();
+    return Root.get();
+  }
   const T *get() const noexcept { return Root.get(); }
-  T &operator*() { return *Root; }
+  T &operator*() {
+    invalidateCaches();
+    return *Root;
+  }
   const T &operator*() const { return *Root; }
-  T *operator->() noexcept { return Root.operator->(); }
+  T *operator->() noexcept {
+    invalidateCaches();
+    return Root.operator->();
+  }
   const T *operator->() const noexcept { return Root.operator->(); }
 
 public:
   bool verify() const debug_function { return verifyReferences(); }
 
   void initializeReferences() {
-    visitReferences([this](auto &Element) { Element.Root = Root.get(); });
+    visitReferences([this](auto &Element) {
+      Element.Root = Root.get();
+      Element.Generation = Generation.get();
+    });
+  }
+
+  /// \brief Point to this tree the references within \p Subtree, which must be
+  ///        part of it
+  template<typename S>
+  void initializeReferences(S &Subtree) {
+    invalidateCaches();
+    auto Visitor = [this](auto &Element) {
+      using type = std::remove_cvref_t<decltype(Element)>;
+      if constexpr (IsTupleTreeReference<type>) {
+        Element.Root = Root.get();
+        Element.Generation = Generation.get();
+      }
+    };
+
+    visitTupleTree(Subtree, Visitor, [](auto &) {});
   }
 
   template<typename L>
   void visitReferences(const L &InnerVisitor) {
+    invalidateCaches();
     auto Visitor = [&InnerVisitor](auto &Element) {
       using type = std::remove_cvref_t<decltype(Element)>;
       if constexpr (IsTupleTreeReference<type>)
@@ -150,6 +248,8 @@ public:
   }
 
 private:
+  void invalidateCaches() { Generation->bump(); }
+
   bool verifyReferences() const {
     bool Result = true;
 
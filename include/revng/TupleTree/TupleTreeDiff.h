@@ -10,6 +10,7 @@
 #include <variant>
 #include <vector>
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/WithColor.h"
 #include "llvm/Support/raw_os_ostream.h"
@@ -19,6 +20,7 @@
 #include "revng/ADT/ZipMapIterator.h"
 #include "revng/Support/Assert.h"
 #include "revng/TupleTree/TupleTree.h"
+#include "revng/TupleTree/TupleTreeHash.h"
 #include "revng/TupleTree/TupleTreePath.h"
 
 template<typename>
@@ -34,13 +36,16 @@ template<typename T>
 concept HasInsertOrAssign = not HasPushBack<T>;
 
 template<HasInsertOrAssign C>
-void addToContainer(C &Container, const typename C::value_type &Value) {
-  Container.insert_or_assign(Value);
+typename C::value_type &
+addToContainer(C &Container, const typename C::value_type &Value) {
+  return *Container.insert_or_assign(Value).first;
 }
 
 template<HasPushBack C>
-void addToContainer(C &Container, const typename C::value_type &Value) {
+typename C::value_type &
+addToContainer(C &Container, const typename C::value_type &Value) {
   Container.push_back(Value);
+  return Container.back();
 }
 
 template<typename T>
@@ -174,7 +179,24 @@ public:
     dump(OutputStream);
   }
 
+  /// \brief Apply the changes to \p M and re-initialize all its references
   void apply(TupleTree<T> &M) const;
+
+  /// \brief Apply the changes to \p M, re-initializing only the references
+  ///        within the values they introduced
+  ///
+  /// All the other references of \p M must already point to it, as it's the
+  /// case unless they have been modified by hand since \p M was created.
+  void applyIncrementally(TupleTree<T> &M) const;
+
+  /// \brief Apply all of \p Diffs to \p M, in order, re-initializing its
+  ///        references once at the end
+  static void apply(llvm::ArrayRef<TupleTreeDiff> Diffs, TupleTree<T> &M);
+
+private:
+  /// Apply the changes to \p M, re-initializing the references within the
+  /// introduced values only if \p Incremental
+  void applyChanges(TupleTree<T> &M, bool Incremental) const;
 };
 
 template<typename T>
@@ -294,12 +316,38 @@ struct Diff {
   TupleTreePath Stack;
   TupleTreeDiff<M> Result;
 
+  /// Optional structural hashes of the two trees, used to skip the subtrees
+  /// that did not change
+  const tupletree::StructuralHashes *LHSHashes = nullptr;
+  const tupletree::StructuralHashes *RHSHashes = nullptr;
+
   TupleTreeDiff<M> diff(M &LHS, M &RHS) {
-    diffImpl(LHS, RHS);
+    if (not unchanged(LHS, RHS))
+      diffImpl(LHS, RHS);
     return Result;
   }
 
+  /// \brief Diff two subtrees rooted at Stack, accumulating the changes in
+  ///        Result
+  template<typename T>
+  void diffSubtree(T &LHS, T &RHS) {
+    diffImpl(LHS, RHS);
+  }
+
 private:
+  template<typename T>
+  bool unchanged(const T &LHS, const T &RHS) const {
+    if (LHSHashes == nullptr or RHSHashes == nullptr)
+      return false;
+
+    auto LHSHash = LHSHashes->lookup(&LHS);
+    if (not LHSHash)
+      return false;
+
+    auto RHSHash = RHSHashes->lookup(&RHS);
+    return RHSHash and *LHSHash == *RHSHash;
+  }
+
   template<size_t I = 0, typename T>
   void diffTuple(T &LHS, T &RHS) {
     if constexpr (I < std::tuple_size_v<T>) {
@@ -342,8 +390,8 @@ private:
       } else if (RHSElement == nullptr) {
         // Removed
         Result.remove(Stack, *LHSElement);
-      } else {
-        // Identical
+      } else if (not unchanged(*LHSElement, *RHSElement)) {
+        // Same key, possibly different content
         using value_type = typename T::value_type;
         Stack.push_back(KeyedObjectTraits<value_type>::key(*LHSElement));
         diffImpl(*LHSElement, *RHSElement);
@@ -366,6 +414,26 @@ TupleTreeDiff<M> diff(M &LHS, M &RHS) {
   return tupletreediff::detail::Diff<M>().diff(LHS, RHS);
 }
 
+/// \brief Diff two trees, skipping the subtrees with the same structural hash
+///
+/// Hashing the trees is a single pass that neither builds paths nor records
+/// changes, hence it's cheaper than visiting the unchanged subtrees.
+/// The hashes are not cached: the trees might be changed through pointers
+/// the TupleTree cannot track.
+template<typename M>
+TupleTreeDiff<M> diff(const TupleTree<M> &LHS, const TupleTree<M> &RHS) {
+  using tupletree::StructuralHashes;
+  StructuralHashes LHSHashes = StructuralHashes::compute(*LHS);
+  StructuralHashes RHSHashes = StructuralHashes::compute(*RHS);
+
+  tupletreediff::detail::Diff<M> Differ;
+  Differ.LHSHashes = &LHSHashes;
+  Differ.RHSHashes = &RHSHashes;
+
+  // diff does not modify the trees
+  return Differ.diff(const_cast<M &>(*LHS), const_cast<M &>(*RHS));
+}
+
 //
 // TupleTreeDiff::dump
 //
@@ -414,6 +482,10 @@ struct ApplyDiffVisitor {
   using Change = typename TupleTreeDiff<T>::Change;
   const Change *C;
 
+  /// If not null, the tree whose references within the introduced values
+  /// must be re-initialized
+  TupleTree<T> *ToInitialize = nullptr;
+
   template<typename TupleT, size_t I, typename K>
   void visitTupleElement(K &Element) {
     visit(Element);
@@ -442,7 +514,9 @@ struct ApplyDiffVisitor {
       revng_assert(OldSize == M.size() + 1);
     } else if (C->New != std::nullopt) {
       // TODO: assert not there already
-      addToContainer(M, std::get<value_type>(*C->New));
+      auto &Added = addToContainer(M, std::get<value_type>(*C->New));
+      if (ToInitialize != nullptr)
+        ToInitialize->initializeReferences(Added);
       revng_assert(OldSize == M.size() - 1);
     } else {
       revng_abort();
@@ -456,17 +530,39 @@ struct ApplyDiffVisitor {
     auto &New = std::get<S>(*C->New);
     revng_check(Old == M);
     M = New;
+    if (ToInitialize != nullptr)
+      ToInitialize->initializeReferences(M);
   }
 };
 
 } // namespace tupletreediff::detail
 
 template<typename T>
-inline void TupleTreeDiff<T>::apply(TupleTree<T> &M) const {
-  TupleTreePath LastPath;
+inline void
+TupleTreeDiff<T>::applyChanges(TupleTree<T> &M, bool Incremental) const {
   for (const Change &C : Changes) {
     tupletreediff::detail::ApplyDiffVisitor<T> ADV{ &C };
+    if (Incremental)
+      ADV.ToInitialize = &M;
     callByPath(ADV, C.Path, *M);
   }
+}
+
+template<typename T>
+inline void TupleTreeDiff<T>::apply(TupleTree<T> &M) const {
+  applyChanges(M, false);
+  M.initializeReferences();
+}
+
+template<typename T>
+inline void TupleTreeDiff<T>::applyIncrementally(TupleTree<T> &M) const {
+  applyChanges(M, true);
+}
+
+template<typename T>
+inline void TupleTreeDiff<T>::apply(llvm::ArrayRef<TupleTreeDiff> Diffs,
+                                    TupleTree<T> &M) {
+  for (const TupleTreeDiff &Diff : Diffs)
+    Diff.applyChanges(M, false);
   M.initializeReferences();
 }
@@ -0,0 +1,157 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/YAMLTraits.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "revng/ADT/KeyedObjectContainer.h"
+#include "revng/ADT/LazyKeyIndex.h"
+#include "revng/ADT/UpcastablePointer.h"
+#include "revng/TupleTree/TupleLikeTraits.h"
+#include "revng/TupleTree/TupleTreeCompatible.h"
+
+namespace tupletree {
+
+/// \brief Hash of a scalar consistent with its operator==
+///
+/// Scalars that can be neither hashed nor serialized as a YAML scalar all have
+/// the same hash.
+template<typename T>
+inline llvm::hash_code hashScalar(const T &Value) {
+  if constexpr (revng::detail::HasHashValue<T>) {
+    return llvm::hash_code(revng::detail::hashKey(Value));
+  } else if constexpr (llvm::yaml::has_ScalarTraits<T>::value) {
+    std::string Buffer;
+    {
+      llvm::raw_string_ostream Stream(Buffer);
+      llvm::yaml::ScalarTraits<T>::output(Value, nullptr, Stream);
+    }
+    return llvm::hash_value(Buffer);
+  } else {
+    return llvm::hash_code(0);
+  }
+}
+
+/// \brief Structural hashes of the subtrees of a tuple tree
+///
+/// A hash is recorded for the root and for each element of a sorted container,
+/// keyed by its address. Two subtrees with the same hash are considered
+/// identical, which lets diff skip them without visiting them.
+///
+/// Subtrees containing a scalar that can be neither hashed nor serialized as a
+/// YAML scalar have no hash and are always visited.
+///
+/// \note the hashes refer to a specific tree and are valid as long as it's not
+///       modified.
+class StructuralHashes {
+private:
+  llvm::DenseMap<const void *, uint64_t> Hashes;
+
+public:
+  template<typename T>
+  static StructuralHashes compute(const T &Root);
+
+public:
+  std::optional<uint64_t> lookup(const void *Object) const {
+    auto It = Hashes.find(Object);
+    if (It == Hashes.end())
+      return std::nullopt;
+    return It->second;
+  }
+
+  size_t size() const { return Hashes.size(); }
+
+private:
+  template<typename T>
+  std::optional<llvm::hash_code> hash(const T &Value);
+
+  template<size_t I = 0, typename T>
+  std::optional<llvm::hash_code>
+  hashTuple(const T &Value, llvm::hash_code Seed);
+
+  void record(const void *Object, std::optional<llvm::hash_code> Hash) {
+    if (Hash)
+      Hashes[Object] = static_cast<size_t>(*Hash);
+  }
+};
+
+template<typename T>
+inline StructuralHashes StructuralHashes::compute(const T &Root) {
+  StructuralHashes Result;
+  Result.record(&Root, Result.hash(Root));
+  return Result;
+}
+
+template<size_t I, typename T>
+inline std::optional<llvm::hash_code>
+StructuralHashes::hashTuple(const T &Value, llvm::hash_code Seed) {
+  if constexpr (I < std::tuple_size_v<T>) {
+    auto Field = hash(get<I>(Value));
+    if (not Field)
+      return std::nullopt;
+    return hashTuple<I + 1>(Value, llvm::hash_combine(Seed, *Field));
+  } else {
+    return Seed;
+  }
+}
+
+template<typename T>
+inline std::optional<llvm::hash_code>
+StructuralHashes::hash(const T &Value) {
+  if constexpr (IsUpcastablePointer<T>) {
+    std::optional<llvm::hash_code> Result = llvm::hash_code(0);
+    Value.upcast([&](auto &Upcasted) {
+      using type = std::remove_cvref_t<decltype(Upcasted)>;
+      auto Concrete = hash(Upcasted);
+      if (Concrete) {
+        llvm::StringRef Name = TupleLikeTraits<type>::Name;
+        Result = llvm::hash_combine(Name, *Concrete);
+      } else {
+        Result = std::nullopt;
+      }
+    });
+    return Result;
+  } else if constexpr (HasTupleSize<T>) {
+    return hashTuple(Value, llvm::hash_value(std::tuple_size_v<T>));
+  } else if constexpr (SortedContainer<T>) {
+    // Elements are hashed, and recorded, even if some of their siblings have no
+    // hash
+    bool Hashable = true;
+    llvm::hash_code Result = llvm::hash_value(Value.size());
+    for (const auto &Element : Value) {
+      auto ElementHash = hash(Element);
+      record(&Element, ElementHash);
+      if (ElementHash)
+        Result = llvm::hash_combine(Result, *ElementHash);
+      else
+        Hashable = false;
+    }
+
+    if (not Hashable)
+      return std::nullopt;
+    return Result;
+  } else if constexpr (revng::detail::HasHashValue<T>) {
+    return revng::detail::hashKey(Value);
+  } else if constexpr (llvm::yaml::has_ScalarTraits<T>::value) {
+    std::string Buffer;
+    {
+      llvm::raw_string_ostream Stream(Buffer);
+      llvm::yaml::ScalarTraits<T>::output(Value, nullptr, Stream);
+    }
+    return llvm::hash_value(Buffer);
+  } else {
+    return std::nullopt;
+  }
+}
+
+} // namespace tupletree
@@ -4,17 +4,84 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <atomic>
+#include <cstdint>
+#include <limits>
 #include <optional>
 #include <variant>
 
 #include "llvm/ADT/StringRef.h"
 
 #include "revng/ADT/Concepts.h"
+#include "revng/ADT/UpcastablePointer.h"
 #include "revng/Support/Assert.h"
 #include "revng/Support/YAMLTraits.h"
 #include "revng/TupleTree/TupleTreePath.h"
 #include "revng/TupleTree/Visits.h"
 
+namespace tupletree::detail {
+
+/// \brief Counter of the mutations of a specific tuple tree
+///
+/// TupleTree cannot observe the changes to the objects it owns, therefore it
+/// bumps the generation whenever it hands out non-const access to them, which
+/// is required to erase an object or to change its key.
+class TreeGeneration {
+private:
+  std::atomic<uint64_t> Value = 0;
+
+public:
+  uint64_t current() const { return Value.load(std::memory_order_acquire); }
+  void bump() { Value.fetch_add(1, std::memory_order_acq_rel); }
+};
+
+/// \brief The last object a TupleTreeReference resolved to
+///
+/// The object is valid as long as the root is the same and the generation of
+/// the tree didn't change. Copies start empty.
+/// Accesses are atomic since references in a shared, read-only, tree can be
+/// dereferenced concurrently: all the threads resolve the same object.
+class ReferenceCache {
+private:
+  static constexpr uint64_t Invalid = std::numeric_limits<uint64_t>::max();
+
+private:
+  mutable std::atomic<const void *> Root = nullptr;
+  mutable std::atomic<void *> Pointer = nullptr;
+  mutable std::atomic<uint64_t> Generation = Invalid;
+
+public:
+  ReferenceCache() = default;
+  ReferenceCache(const ReferenceCache &) {}
+  ReferenceCache &operator=(const ReferenceCache &) {
+    Generation.store(Invalid, std::memory_order_release);
+    return *this;
+  }
+
+public:
+  void *lookup(const void *TheRoot, uint64_t CurrentGeneration) const {
+    if (Generation.load(std::memory_order_acquire) != CurrentGeneration
+        or Root.load(std::memory_order_relaxed) != TheRoot)
+      return nullptr;
+    return Pointer.load(std::memory_order_relaxed);
+  }
+
+  void store(const void *TheRoot, void *ThePointer, uint64_t TheGeneration) {
+    Root.store(TheRoot, std::memory_order_relaxed);
+    Pointer.store(ThePointer, std::memory_order_relaxed);
+    Generation.store(TheGeneration, std::memory_order_release);
+  }
+};
+
+} // namespace tupletree::detail
+
+/// \note If T is Upcastable, i.e., it's owned by an UpcastablePointer in the
+///       tree, and the reference has been initialized by the TupleTree owning
+///       it, dereferencing it caches the result. Following it again then costs
+///       O(1), until the TupleTree is accessed through a non-const method.
+///       Pointers into the tree obtained before that must not be used to
+///       modify it afterwards. Other objects might be moved around by their
+///       container, hence they're always looked up.
 template<typename T, typename RootType>
 class TupleTreeReference {
 public:
@@ -24,6 +91,9 @@ public:
 public:
   RootVariant Root = static_cast<RootT *>(nullptr);
   TupleTreePath Path;
+  /// Generation of the TupleTree owning Root, if known
+  const tupletree::detail::TreeGeneration *Generation = nullptr;
+  mutable tupletree::detail::ReferenceCache Cache = {};
 
 public:
   static TupleTreeReference
@@ -68,6 +138,27 @@ private:
     return Root.index() != std::variant_npos and not hasNullRoot();
   }
 
+  template<typename R>
+  T *resolve(R &TheRoot) const {
+    if constexpr (not Upcastable<std::remove_const_t<T>>)
+      return getByPath<T>(Path, TheRoot);
+
+    if (Generation == nullptr)
+      return getByPath<T>(Path, TheRoot);
+
+    uint64_t Current = Generation->current();
+    if (void *Cached = Cache.lookup(&TheRoot, Current))
+      return static_cast<T *>(Cached);
+
+    T *Result = getByPath<T>(Path, TheRoot);
+    if (Result != nullptr) {
+      using NonConstT = std::remove_const_t<T>;
+      Cache.store(&TheRoot, const_cast<NonConstT *>(Result), Current);
+    }
+
+    return Result;
+  }
+
 public:
   const T *get() const {
     static_assert(TupleTreeCompatible<RootType>);
@@ -76,8 +167,8 @@ public:
     if (Path.size() == 0)
       return nullptr;
 
-    const auto GetByPathVisitor = [&Path = Path](const auto &RootPointer) {
-      return getByPath<T>(Path, *RootPointer);
+    const auto GetByPathVisitor = [this](const auto &RootPointer) {
+      return resolve(*RootPointer);
     };
 
     return std::visit(GetByPathVisitor, Root);
@@ -91,7 +182,7 @@ public:
       return nullptr;
 
     if (std::holds_alternative<RootT *>(Root)) {
-      return getByPath<T>(Path, *std::get<RootT *>(Root));
+      return resolve(*std::get<RootT *>(Root));
     } else if (std::holds_alternative<const RootT *>(Root)) {
       revng_abort("Called get() with const root, use getConst!");
     } else {
@@ -107,9 +198,9 @@ public:
       return nullptr;
 
     if (std::holds_alternative<const RootT *>(Root)) {
-      return getByPath<T>(Path, *std::get<const RootT *>(Root));
+      return resolve(*std::get<const RootT *>(Root));
     } else if (std::holds_alternative<RootT *>(Root)) {
-      return getByPath<T>(Path, *std::get<RootT *>(Root));
+      return resolve(*std::get<RootT *>(Root));
     } else {
       revng_abort("Invalid root variant!");
     }
@@ -4,8 +4,11 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <array>
 #include <cstdint>
+#include <string_view>
 #include <tuple>
+#include <utility>
 
 #include "revng/ADT/KeyedObjectContainer.h"
 #include "revng/ADT/UpcastablePointer.h"
@@ -78,17 +81,57 @@ void visitTupleTree(T &Element,
 //
 // tupleIndexByName
 //
-template<typename T, size_t I = 0>
-size_t tupleIndexByName(llvm::StringRef Name) {
-  if constexpr (I < std::tuple_size_v<T>) {
-    llvm::StringRef ThisName = TupleLikeTraits<T>::FieldsName[I];
-    if (Name == ThisName)
-      return I;
-    else
-      return tupleIndexByName<T, I + 1>(Name);
-  } else {
+namespace tupletree::detail {
+
+/// \brief The indices of the fields of \p T, sorted by name at compile time
+template<typename T>
+struct SortedFields {
+  static constexpr size_t Count = std::tuple_size_v<T>;
+
+  static constexpr std::string_view name(size_t Index) {
+    return TupleLikeTraits<T>::FieldsName[Index];
+  }
+
+  static constexpr std::array<size_t, Count> sort() {
+    std::array<size_t, Count> Result{};
+    for (size_t I = 0; I < Count; ++I) {
+      size_t J = I;
+      for (; J > 0 and name(I) < name(Result[J - 1]); --J)
+        Result[J] = Result[J - 1];
+      Result[J] = I;
+    }
+    return Result;
+  }
+
+  static constexpr std::array<size_t, Count> Order = sort();
+
+  /// \return the index of the field named \p Name, or -1
+  static size_t find(llvm::StringRef Name) {
+    std::string_view Needle(Name.data(), Name.size());
+    size_t Begin = 0;
+    size_t End = Count;
+    while (Begin < End) {
+      size_t Middle = Begin + (End - Begin) / 2;
+      std::string_view Candidate = name(Order[Middle]);
+      if (Candidate == Needle)
+        return Order[Middle];
+      else if (Candidate < Needle)
+        Begin = Middle + 1;
+      else
+        End = Middle;
+    }
     return -1;
   }
+};
+
+} // namespace tupletree::detail
+
+/// \return the index of the field of \p T named \p Name, or -1
+///
+/// The lookup is a binary search over the field names, sorted at compile time.
+template<typename T>
+size_t tupleIndexByName(llvm::StringRef Name) {
+  return tupletree::detail::SortedFields<T>::find(Name);
 }
 
 //
@@ -526,11 +569,14 @@ private:
   }
 
 private:
-  template<typename T, size_t I = 0>
+  template<typename T>
   static bool visitTuple(llvm::StringRef Current,
                          llvm::StringRef Rest,
                          PathMatcher &Result);
 
+  template<typename T, size_t I>
+  static bool visitTupleField(llvm::StringRef Rest, PathMatcher &Result);
+
   template<UpcastablePointerLike T>
   static bool visitTupleTreeNode(llvm::StringRef String, PathMatcher &Result);
 
@@ -589,21 +635,29 @@ bool PathMatcher::visitTupleTreeNode(llvm::StringRef Path,
 }
 
 template<typename T, size_t I>
+bool PathMatcher::visitTupleField(llvm::StringRef Rest, PathMatcher &Result) {
+  Result.Path.push_back(size_t(I));
+  using element = typename std::tuple_element_t<I, T>;
+  return PathMatcher::visitTupleTreeNode<element>(Rest, Result);
+}
+
+template<typename T>
 bool PathMatcher::visitTuple(llvm::StringRef Current,
                              llvm::StringRef Rest,
                              PathMatcher &Result) {
-  if constexpr (I < std::tuple_size_v<T>) {
-    if (TupleLikeTraits<T>::FieldsName[I] == Current) {
-      Result.Path.push_back(size_t(I));
-      using element = typename std::tuple_element_t<I, T>;
-      return PathMatcher::visitTupleTreeNode<element>(Rest, Result);
-    } else {
-      return visitTuple<T, I + 1>(Current, Rest, Result);
-    }
-  } else {
+  size_t Index = tupleIndexByName<T>(Current);
+  if (Index == size_t(-1)) {
     // Not found
     return false;
   }
+
+  // Dispatch on the index of the field through a table
+  using Visitor = bool (*)(llvm::StringRef, PathMatcher &);
+  constexpr auto Visitors = []<size_t... Is>(std::index_sequence<Is...>) {
+    return std::array<Visitor, sizeof...(Is)>{ &visitTupleField<T, Is>... };
+  }(std::make_index_sequence<std::tuple_size_v<T>>());
+
+  return Visitors[Index](Rest, Result);
 }
 
 template<typename T>
@@ -0,0 +1,1107 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <bitset>
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/ConvertUTF.h"
+#include "llvm/Support/YAMLParser.h"
+#include "llvm/Support/YAMLTraits.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "revng/ADT/KeyedObjectContainer.h"
+#include "revng/ADT/STLExtras.h"
+#include "revng/ADT/UpcastablePointer.h"
+#include "revng/ADT/UpcastablePointer/YAMLTraits.h"
+#include "revng/Support/Assert.h"
+#include "revng/Support/YAMLTraits.h"
+#include "revng/TupleTree/TupleLikeTraits.h"
+#include "revng/TupleTree/Visits.h"
+
+/// A specialized YAML emitter and parser for tuple trees.
+///
+/// The format is the one produced by llvm::yaml::Output through the
+/// MappingTraits of the tuple-like objects, but the emitter writes the
+/// document directly, and the parser reads it in a single pass over the
+/// buffer, matching keys through tupleIndexByName and deserializing into the
+/// objects in place, without building a node tree.
+///
+/// Only the types whose YAML representation is entirely driven by the
+/// introspection metadata are supported, see IsSupported:
+///
+/// * tuple-like objects mapped through TupleLikeMappingTraits;
+/// * upcastable pointers mapped through PolymorphicMappingTraits;
+/// * keyed containers and std::vectors, as block sequences or, if their
+///   SequenceTraits ask so, as flow sequences of scalars;
+/// * scalars with ScalarTraits or ScalarEnumerationTraits.
+///
+/// The emitter produces the same output as llvm::yaml::Output. The parser
+/// accepts the subset of YAML that llvm::yaml::Output produces: anything else
+/// (flow mappings, anchors, multi-line scalars, unknown or missing keys...)
+/// makes it fail, and the caller is expected to fall back to
+/// llvm::yaml::Input, which either handles the document or reports a proper
+/// diagnostic.
+namespace tupletree::yaml {
+
+namespace detail {
+
+template<typename T>
+concept IsStdVector = is_specialization_v<T, std::vector>;
+
+template<typename T>
+concept IsSortedVector = is_specialization_v<T, SortedVector>;
+
+template<typename T>
+concept IsSequence = IsKeyedObjectContainer<T> or IsStdVector<T>;
+
+template<typename T>
+concept IsScalar = HasScalarOrEnumTraits<T>;
+
+template<typename T, typename TupleLikeTraits<T>::Fields... Optionals>
+constexpr auto *asTupleLikeMapping(TupleLikeMappingTraits<T, Optionals...> *P) {
+  return P;
+}
+
+template<typename T>
+constexpr void *asTupleLikeMapping(void *) {
+  return nullptr;
+}
+
+template<typename T>
+using MappingOf = decltype(asTupleLikeMapping<T>(
+  static_cast<llvm::yaml::MappingTraits<T> *>(nullptr)));
+
+/// T is mapped by MappingTraits deriving from TupleLikeMappingTraits
+template<typename T>
+concept IsTupleLikeMapping = not std::is_same_v<MappingOf<T>, void *>;
+
+template<TupleTreeCompatible T, size_t I>
+constexpr bool isOptionalField() {
+  using Mapping = std::remove_pointer_t<MappingOf<T>>;
+  using Fields = typename TupleLikeTraits<T>::Fields;
+  return Mapping::template isOptional<static_cast<Fields>(I)>();
+}
+
+template<typename T>
+constexpr bool isFlowSequence() {
+  using Traits = llvm::yaml::SequenceTraits<T>;
+  return llvm::yaml::has_FlowTraits<Traits>::value;
+}
+
+template<typename T>
+constexpr bool isSupported();
+
+template<typename Tuple, size_t I = 0>
+constexpr bool allSupported() {
+  if constexpr (I < std::tuple_size_v<Tuple>) {
+    using Element = std::remove_cvref_t<std::tuple_element_t<I, Tuple>>;
+    return isSupported<Element>() and allSupported<Tuple, I + 1>();
+  } else {
+    return true;
+  }
+}
+
+template<typename T>
+constexpr bool isSupported() {
+  if constexpr (IsScalar<T>) {
+    return true;
+  } else if constexpr (UpcastablePointerLike<T>) {
+    using Mapping = llvm::yaml::MappingTraits<T>;
+    using Polymorphic = PolymorphicMappingTraits<T>;
+    return std::is_base_of_v<Polymorphic, Mapping>
+           and allSupported<concrete_types_traits_t<pointee<T>>>();
+  } else if constexpr (IsSequence<T>) {
+    using Element = typename T::value_type;
+    if constexpr (isFlowSequence<T>())
+      return IsScalar<Element>;
+    else
+      return not IsSequence<Element> and isSupported<Element>();
+  } else if constexpr (HasTupleSize<T> and IsTupleLikeMapping<T>) {
+    return allSupported<T>();
+  } else {
+    return false;
+  }
+}
+
+class Emitter {
+private:
+  /// LLVM's emitter aligns the scalars following keys to this column
+  static constexpr size_t KeyPadding = 16;
+
+  /// LLVM's emitter wraps flow sequences beyond this column
+  static constexpr size_t WrapColumn = 70;
+
+private:
+  llvm::raw_ostream &OS;
+  size_t Column = 0;
+  llvm::SmallString<64> Scratch;
+
+public:
+  explicit Emitter(llvm::raw_ostream &OS) : OS(OS) {}
+
+public:
+  template<typename T>
+  void document(const T &Root) {
+    write("---");
+    if (mapping(Root, 0, Position::Document) == 0)
+      write(" {}");
+    write("\n...\n");
+  }
+
+private:
+  /// Where a value is being emitted
+  enum class Position {
+    /// Right after "Key:", the padding has not been emitted yet
+    AfterKey,
+    /// Right after "- "
+    SequenceItem,
+    /// At the top-level, after "---"
+    Document
+  };
+
+  void write(llvm::StringRef String) {
+    OS << String;
+    size_t NewLine = String.rfind('\n');
+    if (NewLine == llvm::StringRef::npos)
+      Column += String.size();
+    else
+      Column = String.size() - NewLine - 1;
+  }
+
+  void indent(size_t Indent) {
+    write("\n");
+    OS.indent(Indent);
+    Column = Indent;
+  }
+
+  void padKey(size_t KeySize) {
+    size_t Padding = KeySize < KeyPadding ? KeyPadding - KeySize : 1;
+    OS.indent(Padding);
+    Column += Padding;
+  }
+
+  /// Emit a value in the given position
+  ///
+  /// \param Indent the indentation of the mapping or sequence containing the
+  ///        value
+  template<typename T>
+  void value(const T &Value, size_t Indent, size_t KeySize, Position Where) {
+    if constexpr (IsScalar<T>) {
+      if (Where == Position::AfterKey)
+        padKey(KeySize);
+      scalar(Value);
+    } else if constexpr (UpcastablePointerLike<T>) {
+      revng_assert(Value.get() != nullptr);
+      upcast(Value, [&](const auto &Upcasted) {
+        this->value(Upcasted, Indent, KeySize, Where);
+      });
+    } else if constexpr (IsSequence<T> and isFlowSequence<T>()) {
+      if (Where == Position::AfterKey)
+        padKey(KeySize);
+      flowSequence(Value);
+    } else if constexpr (IsSequence<T>) {
+      revng_assert(Where == Position::AfterKey);
+      if (Value.size() == 0) {
+        padKey(KeySize);
+        write("[]");
+        return;
+      }
+
+      for (const auto &Element : Value) {
+        indent(Indent + 2);
+        write("- ");
+        this->value(Element, Indent + 2, 0, Position::SequenceItem);
+      }
+    } else {
+      static_assert(HasTupleSize<T>);
+      if (Where == Position::SequenceItem) {
+        if (mapping(Value, Indent + 2, Where) == 0)
+          write("{}");
+      } else {
+        // Peek: an empty mapping goes on the same line as its key
+        if (not hasFields(Value)) {
+          padKey(KeySize);
+          write("{}");
+          return;
+        }
+        mapping(Value, Indent + 2, Where);
+      }
+    }
+  }
+
+  template<typename T, size_t I = 0>
+  static bool hasFields(const T &Value) {
+    if constexpr (I < std::tuple_size_v<T>) {
+      if (not isDefault<T, I>(Value))
+        return true;
+      return hasFields<T, I + 1>(Value);
+    } else {
+      return false;
+    }
+  }
+
+  template<typename T, size_t I>
+  static bool isDefault(const T &Value) {
+    if constexpr (isOptionalField<T, I>()) {
+      using Element = std::tuple_element_t<I, T>;
+      return get<I>(Value) == Element{};
+    } else {
+      return false;
+    }
+  }
+
+  /// Emit the fields of a tuple-like object
+  ///
+  /// \return the number of emitted fields
+  template<typename T, size_t I = 0>
+  size_t mapping(const T &Value,
+                 size_t Indent,
+                 Position Where,
+                 size_t Emitted = 0) {
+    if constexpr (I < std::tuple_size_v<T>) {
+      if (not isDefault<T, I>(Value)) {
+        // The first key of a mapping in a sequence item follows the dash
+        if (Emitted != 0 or Where != Position::SequenceItem)
+          indent(Indent);
+
+        llvm::StringRef Key = TupleLikeTraits<T>::FieldsName[I];
+        write(Key);
+        write(":");
+        value(get<I>(Value), Indent, Key.size(), Position::AfterKey);
+        ++Emitted;
+      }
+
+      return mapping<T, I + 1>(Value, Indent, Where, Emitted);
+    } else {
+      return Emitted;
+    }
+  }
+
+  template<typename T>
+  void flowSequence(const T &Value) {
+    size_t Start = Column;
+    write("[ ");
+    bool First = true;
+    for (const auto &Element : Value) {
+      if (not First)
+        write(", ");
+      First = false;
+
+      if (Column > WrapColumn) {
+        indent(Start);
+        write("  ");
+      }
+
+      scalar(Element);
+    }
+    write(" ]");
+  }
+
+  template<typename T>
+  void scalar(const T &Value) {
+    using llvm::yaml::QuotingType;
+
+    if constexpr (std::is_same_v<T, std::string>) {
+      quoted(Value, llvm::yaml::ScalarTraits<T>::mustQuote(Value));
+    } else if constexpr (HasScalarTraits<T>) {
+      Scratch.clear();
+      {
+        llvm::raw_svector_ostream Stream(Scratch);
+        llvm::yaml::ScalarTraits<T>::output(Value, nullptr, Stream);
+      }
+      quoted(Scratch, llvm::yaml::ScalarTraits<T>::mustQuote(Scratch));
+    } else {
+      llvm::StringRef Name = getNameFromYAMLEnumScalar(Value);
+      revng_assert(not Name.empty(), "Unknown enumeration value");
+      write(Name);
+    }
+  }
+
+  void quoted(llvm::StringRef String, llvm::yaml::QuotingType Quoting) {
+    using llvm::yaml::QuotingType;
+
+    if (String.empty()) {
+      write("''");
+    } else if (Quoting == QuotingType::None) {
+      write(String);
+    } else if (Quoting == QuotingType::Double) {
+      write("\"");
+      write(llvm::yaml::escape(String, false));
+      write("\"");
+    } else {
+      write("'");
+      auto [Before, After] = String.split('\'');
+      write(Before);
+      while (Before.size() != String.size()) {
+        write("''");
+        String = After;
+        std::tie(Before, After) = String.split('\'');
+        write(Before);
+      }
+      write("'");
+    }
+  }
+};
+
+class Parser {
+private:
+  const char *Cursor = nullptr;
+  const char *End = nullptr;
+
+  /// Start of the line the cursor is in
+  const char *LineStart = nullptr;
+
+  bool Failed = false;
+  std::string Scratch;
+
+public:
+  explicit Parser(llvm::StringRef Buffer) :
+    Cursor(Buffer.begin()), End(Buffer.end()), LineStart(Buffer.begin()) {}
+
+public:
+  template<typename T>
+  bool document(T &Root) {
+    skipEmptyLines();
+
+    // Optional document start marker
+    if (startsWith("---") and (Cursor + 3 == End or isBlank(Cursor[3]))) {
+      Cursor += 3;
+      skipSpaces();
+      if (startsWith("{}")) {
+        Cursor += 2;
+        emptyMapping(Root);
+        endOfLine();
+        return finish();
+      }
+
+      if (not atEndOfLine())
+        return false;
+
+      nextContent();
+    }
+
+    if (Cursor == End or isEndMarker())
+      return false;
+
+    mapping(Root, column());
+    return finish();
+  }
+
+private:
+  //
+  // Low level scanning
+  //
+  static bool isBlank(char C) { return C == ' ' or C == '\n' or C == '\r'; }
+
+  size_t column() const { return Cursor - LineStart; }
+
+  bool atLineStart() const { return Cursor == LineStart; }
+
+  bool startsWith(llvm::StringRef Prefix) const {
+    return static_cast<size_t>(End - Cursor) >= Prefix.size()
+           and llvm::StringRef(Cursor, Prefix.size()) == Prefix;
+  }
+
+  bool isEndMarker() const {
+    return atLineStart() and startsWith("...")
+           and (Cursor + 3 == End or isBlank(Cursor[3]));
+  }
+
+  void skipSpaces() {
+    while (Cursor != End and *Cursor == ' ')
+      ++Cursor;
+  }
+
+  /// \return true if only spaces and a comment are left on this line
+  bool atEndOfLine() {
+    skipSpaces();
+    return Cursor == End or *Cursor == '\n' or *Cursor == '\r'
+           or *Cursor == '#';
+  }
+
+  void fail() {
+    Failed = true;
+    Cursor = End;
+    LineStart = End;
+  }
+
+  /// Require the end of the line, then move to the next content line
+  void endOfLine() {
+    if (not atEndOfLine())
+      fail();
+    else
+      nextContent();
+  }
+
+  /// Move to the first non-space character of the next line that is neither
+  /// empty nor a comment, or to the end of the buffer
+  void nextContent() {
+    while (Cursor != End and *Cursor != '\n')
+      ++Cursor;
+
+    if (Cursor == End)
+      return;
+
+    ++Cursor;
+    LineStart = Cursor;
+    skipEmptyLines();
+  }
+
+  /// Starting from the beginning of a line, skip the empty lines and the
+  /// comments, and move to the first non-space character
+  void skipEmptyLines() {
+    while (true) {
+      skipSpaces();
+      if (Cursor == End)
+        return;
+
+      char C = *Cursor;
+      if (C == '\t') {
+        // Tabs are not allowed in indentation
+        fail();
+        return;
+      }
+
+      if (C != '\n' and C != '\r' and C != '#')
+        return;
+
+      while (Cursor != End and *Cursor != '\n')
+        ++Cursor;
+      if (Cursor == End)
+        return;
+
+      ++Cursor;
+      LineStart = Cursor;
+    }
+  }
+
+  /// Consume the optional document end marker
+  ///
+  /// \return true if the whole buffer has been consumed successfully
+  bool finish() {
+    if (not Failed and Cursor != End and isEndMarker()) {
+      Cursor += 3;
+      endOfLine();
+    }
+
+    return not Failed and Cursor == End;
+  }
+
+  /// \return the key at the cursor, up to the ':', or an empty string
+  llvm::StringRef key() {
+    const char *Start = Cursor;
+    while (Cursor != End and (llvm::isAlnum(*Cursor) or *Cursor == '_'))
+      ++Cursor;
+
+    llvm::StringRef Result(Start, Cursor - Start);
+    if (Result.empty() or Cursor == End or *Cursor != ':') {
+      fail();
+      return {};
+    }
+
+    ++Cursor;
+    if (Cursor != End and not isBlank(*Cursor)) {
+      fail();
+      return {};
+    }
+
+    return Result;
+  }
+
+  /// Read a scalar on the current line
+  ///
+  /// \param InFlow whether the scalar is an element of a flow sequence
+  ///
+  /// \return the value of the scalar, which might point to Scratch
+  llvm::StringRef scalar(bool InFlow) {
+    if (Cursor == End) {
+      fail();
+      return {};
+    }
+
+    if (*Cursor == '\'')
+      return singleQuoted();
+    if (*Cursor == '"')
+      return doubleQuoted();
+
+    // Plain scalars must not start with an indicator
+    static constexpr llvm::StringLiteral Indicators = "-?:,[]{}#&*!|>%@`";
+    if (Indicators.contains(*Cursor)) {
+      if (*Cursor != '-' or Cursor + 1 == End or isBlank(Cursor[1])) {
+        fail();
+        return {};
+      }
+    }
+
+    const char *Start = Cursor;
+    const char *LastNonSpace = Cursor;
+    while (Cursor != End and *Cursor != '\n' and *Cursor != '\r') {
+      char C = *Cursor;
+      if (C == '#' and Cursor[-1] == ' ')
+        break;
+      if (C == ':' and (Cursor + 1 == End or isBlank(Cursor[1]))) {
+        // This would be a mapping
+        fail();
+        return {};
+      }
+      if (InFlow and (C == ',' or C == ']' or C == '[' or C == '{'
+                      or C == '}'))
+        break;
+      if (C != ' ')
+        LastNonSpace = Cursor + 1;
+      ++Cursor;
+    }
+
+    if (LastNonSpace == Start) {
+      // Null values are not supported
+      fail();
+      return {};
+    }
+
+    return llvm::StringRef(Start, LastNonSpace - Start);
+  }
+
+  llvm::StringRef singleQuoted() {
+    ++Cursor;
+    const char *Start = Cursor;
+    bool Copied = false;
+    while (true) {
+      if (Cursor == End or *Cursor == '\n' or *Cursor == '\r') {
+        // Multi-line scalars are not supported
+        fail();
+        return {};
+      }
+
+      if (*Cursor == '\'') {
+        if (Cursor + 1 != End and Cursor[1] == '\'') {
+          // Escaped quote
+          if (not Copied)
+            Scratch.assign(Start, Cursor);
+          Copied = true;
+          Scratch += '\'';
+          Cursor += 2;
+          continue;
+        }
+
+        llvm::StringRef Result(Start, Cursor - Start);
+        ++Cursor;
+        return Copied ? llvm::StringRef(Scratch) : Result;
+      }
+
+      if (Copied)
+        Scratch += *Cursor;
+      ++Cursor;
+    }
+  }
+
+  llvm::StringRef doubleQuoted() {
+    ++Cursor;
+    const char *Start = Cursor;
+    bool Copied = false;
+    while (true) {
+      if (Cursor == End or *Cursor == '\n' or *Cursor == '\r') {
+        fail();
+        return {};
+      }
+
+      char C = *Cursor;
+      if (C == '"') {
+        llvm::StringRef Result(Start, Cursor - Start);
+        ++Cursor;
+        return Copied ? llvm::StringRef(Scratch) : Result;
+      }
+
+      if (C != '\\') {
+        if (Copied)
+          Scratch += C;
+        ++Cursor;
+        continue;
+      }
+
+      if (not Copied)
+        Scratch.assign(Start, Cursor);
+      Copied = true;
+
+      ++Cursor;
+      if (Cursor == End) {
+        fail();
+        return {};
+      }
+
+      char Escaped = *Cursor++;
+      switch (Escaped) {
+      case '0':
+        Scratch += '\0';
+        break;
+      case 'a':
+        Scratch += '\a';
+        break;
+      case 'b':
+        Scratch += '\b';
+        break;
+      case 't':
+        Scratch += '\t';
+        break;
+      case 'n':
+        Scratch += '\n';
+        break;
+      case 'v':
+        Scratch += '\v';
+        break;
+      case 'f':
+        Scratch += '\f';
+        break;
+      case 'r':
+        Scratch += '\r';
+        break;
+      case 'e':
+        Scratch += '\x1b';
+        break;
+      case ' ':
+      case '"':
+      case '/':
+      case '\\':
+        Scratch += Escaped;
+        break;
+      case 'x':
+        if (not unicodeEscape(2))
+          return {};
+        break;
+      case 'u':
+        if (not unicodeEscape(4))
+          return {};
+        break;
+      case 'U':
+        if (not unicodeEscape(8))
+          return {};
+        break;
+      default:
+        // Line folding and the other escapes are not supported
+        fail();
+        return {};
+      }
+    }
+  }
+
+  bool unicodeEscape(size_t Digits) {
+    uint32_t CodePoint = 0;
+    if (static_cast<size_t>(End - Cursor) < Digits
+        or llvm::StringRef(Cursor, Digits).getAsInteger(16, CodePoint)) {
+      fail();
+      return false;
+    }
+    Cursor += Digits;
+
+    char Buffer[UNI_MAX_UTF8_BYTES_PER_CODE_POINT];
+    char *Output = Buffer;
+    if (not llvm::ConvertCodePointToUTF8(CodePoint, Output)) {
+      fail();
+      return false;
+    }
+    Scratch.append(Buffer, Output);
+    return true;
+  }
+
+  //
+  // Values
+  //
+
+  template<typename T>
+  void scalarValue(T &Value, bool InFlow) {
+    llvm::StringRef String = scalar(InFlow);
+    if (Failed)
+      return;
+
+    if constexpr (std::is_same_v<T, std::string>) {
+      Value.assign(String.data(), String.size());
+    } else if constexpr (HasScalarTraits<T>) {
+      auto Error = llvm::yaml::ScalarTraits<T>::input(String, nullptr, Value);
+      if (not Error.empty())
+        fail();
+    } else {
+      if (auto MaybeValue = tryGetValueFromYAMLEnumScalar<T>(String))
+        Value = *MaybeValue;
+      else
+        fail();
+    }
+  }
+
+  /// Read the value at the cursor
+  ///
+  /// \param Indent the indentation of the mapping or sequence containing the
+  ///        value
+  /// \param InSequence whether the value is a sequence item, rather than the
+  ///        value of a key
+  ///
+  /// After reading the value, the cursor is at the next content line.
+  template<typename T>
+  void value(T &Value, size_t Indent, bool InSequence) {
+    if (Failed)
+      return;
+
+    if constexpr (IsScalar<T>) {
+      skipSpaces();
+      scalarValue(Value, false);
+      endOfLine();
+    } else if constexpr (UpcastablePointerLike<T>) {
+      // Without a Kind, there's no way to tell the type of an empty mapping
+      if (startMapping(Indent, InSequence) != MappingStart::Block) {
+        fail();
+        return;
+      }
+
+      polymorphic(Value, column());
+    } else if constexpr (IsSequence<T>) {
+      Value.clear();
+
+      if (atEndOfLine()) {
+        // Block sequence, the dashes can be at the same level of the key
+        nextContent();
+        size_t Column = column();
+        if (InSequence or Column < Indent or not startsWith("-")) {
+          fail();
+          return;
+        }
+
+        blockSequence(Value, Column);
+      } else if (*Cursor == '[') {
+        flowSequence(Value);
+        endOfLine();
+      } else {
+        fail();
+      }
+    } else {
+      static_assert(HasTupleSize<T>);
+      switch (startMapping(Indent, InSequence)) {
+      case MappingStart::Block:
+        mapping(Value, column());
+        break;
+      case MappingStart::Empty:
+        emptyMapping(Value);
+        break;
+      case MappingStart::Failed:
+        break;
+      }
+    }
+  }
+
+  enum class MappingStart { Block, Empty, Failed };
+
+  /// Move the cursor to the first key of the mapping, unless it's empty
+  MappingStart startMapping(size_t Indent, bool InSequence) {
+    skipSpaces();
+    if (startsWith("{}")) {
+      Cursor += 2;
+      endOfLine();
+      return Failed ? MappingStart::Failed : MappingStart::Empty;
+    }
+
+    if (InSequence) {
+      // The first key follows the dash
+      if (atEndOfLine()) {
+        fail();
+        return MappingStart::Failed;
+      }
+
+      return MappingStart::Block;
+    }
+
+    if (not atEndOfLine()) {
+      fail();
+      return MappingStart::Failed;
+    }
+
+    nextContent();
+    if (Cursor == End or column() <= Indent) {
+      fail();
+      return MappingStart::Failed;
+    }
+
+    return MappingStart::Block;
+  }
+
+  template<typename T>
+  void flowSequence(T &Sequence) {
+    using Element = typename T::value_type;
+
+    ++Cursor;
+    skipFlowSpaces();
+    if (Cursor != End and *Cursor == ']') {
+      ++Cursor;
+      return;
+    }
+
+    while (not Failed) {
+      if constexpr (IsScalar<Element>) {
+        Element NewElement{};
+        scalarValue(NewElement, true);
+        insert(Sequence, std::move(NewElement));
+      } else {
+        fail();
+        return;
+      }
+
+      skipFlowSpaces();
+      if (Cursor == End) {
+        fail();
+        return;
+      }
+
+      char C = *Cursor++;
+      if (C == ']')
+        return;
+
+      if (C != ',') {
+        fail();
+        return;
+      }
+
+      skipFlowSpaces();
+    }
+  }
+
+  /// Skip spaces and new lines within a flow sequence
+  void skipFlowSpaces() {
+    while (Cursor != End and isBlank(*Cursor)) {
+      if (*Cursor == '\n')
+        LineStart = Cursor + 1;
+      ++Cursor;
+    }
+  }
+
+  template<typename T>
+  void blockSequence(T &Sequence, size_t Indent) {
+    using Element = typename T::value_type;
+
+    if constexpr (IsKeyedObjectContainer<T>) {
+      using KOT = KeyedObjectTraits<Element>;
+      using Key = std::remove_cvref_t<decltype(KOT::key(
+        std::declval<Element>()))>;
+
+      auto Inserter = Sequence.batch_insert();
+      while (item(Indent)) {
+        if constexpr (IsSortedVector<T>) {
+          // Elements are read in place, the key is checked upon commit
+          value(Inserter.insert(KOT::fromKey(Key())), Indent, true);
+        } else {
+          Element NewElement = KOT::fromKey(Key());
+          value(NewElement, Indent, true);
+          Inserter.insert(NewElement);
+        }
+      }
+    } else {
+      while (item(Indent))
+        value(Sequence.emplace_back(), Indent, true);
+    }
+  }
+
+  /// Consume the dash of the next item of a block sequence
+  ///
+  /// \return false if the sequence is over
+  bool item(size_t Indent) {
+    if (Failed or Cursor == End or column() < Indent or isEndMarker())
+      return false;
+
+    // If the dashes are at the same level of the key they belong to, the
+    // sequence ends at the following key
+    if (column() == Indent and not startsWith("-"))
+      return false;
+
+    if (column() != Indent or not startsWith("- ")) {
+      fail();
+      return false;
+    }
+
+    Cursor += 2;
+    return true;
+  }
+
+  template<typename T>
+  static void insert(T &Sequence, typename T::value_type &&Element) {
+    if constexpr (IsKeyedObjectContainer<T>)
+      Sequence.insert(std::move(Element));
+    else
+      Sequence.push_back(std::move(Element));
+  }
+
+  /// Read the fields of a tuple-like object, the cursor is at its first key
+  template<typename T>
+  void mapping(T &Value, size_t Indent) {
+    constexpr size_t Count = std::tuple_size_v<T>;
+    std::bitset<Count> Found;
+
+    while (not Failed) {
+      size_t Index = tupleIndexByName<T>(key());
+      if (Failed)
+        return;
+
+      if (Index >= Count or Found[Index]) {
+        // Unknown or duplicate key
+        fail();
+        return;
+      }
+
+      Found[Index] = true;
+      field(Value, Index, Indent);
+
+      if (Failed or Cursor == End or column() < Indent or isEndMarker())
+        break;
+
+      if (column() > Indent) {
+        fail();
+        return;
+      }
+    }
+
+    if (not Failed)
+      checkMissing(Value, Found);
+  }
+
+  template<typename T>
+  void emptyMapping(T &Value) {
+    checkMissing(Value, std::bitset<std::tuple_size_v<T>>());
+  }
+
+  template<typename T, size_t I = 0>
+  void field(T &Value, size_t Index, size_t Indent) {
+    if constexpr (I < std::tuple_size_v<T>) {
+      if (Index == I)
+        value(get<I>(Value), Indent, false);
+      else
+        field<T, I + 1>(Value, Index, Indent);
+    } else {
+      revng_abort();
+    }
+  }
+
+  /// Reset the missing optional fields and fail on missing required fields
+  template<typename T, size_t I = 0>
+  void checkMissing(T &Value, const std::bitset<std::tuple_size_v<T>> &Found) {
+    if constexpr (I < std::tuple_size_v<T>) {
+      if (not Found[I]) {
+        if constexpr (isOptionalField<T, I>()) {
+          using Element = std::tuple_element_t<I, T>;
+          get<I>(Value) = Element{};
+        } else {
+          fail();
+          return;
+        }
+      }
+
+      checkMissing<T, I + 1>(Value, Found);
+    }
+  }
+
+  /// Read a polymorphic object, whose concrete type is determined by the
+  /// value of its Kind key
+  template<typename P>
+  void polymorphic(P &Pointer, size_t Indent) {
+    llvm::StringRef Kind = findKind(Indent);
+    if (Failed)
+      return;
+
+    if (not makeConcrete(Pointer, Kind)) {
+      fail();
+      return;
+    }
+
+    upcast(Pointer, [&](auto &Upcasted) { mapping(Upcasted, Indent); });
+  }
+
+  /// Look ahead for the Kind key of the mapping at the cursor
+  llvm::StringRef findKind(size_t Indent) {
+    const char *SavedCursor = Cursor;
+    const char *SavedLineStart = LineStart;
+
+    llvm::StringRef Result;
+    while (not Failed) {
+      llvm::StringRef Key = key();
+      if (Failed)
+        break;
+
+      if (Key == "Kind") {
+        skipSpaces();
+        Result = scalar(false);
+        if (not Failed and not atEndOfLine())
+          fail();
+        break;
+      }
+
+      // Skip the value, which spans all the following lines that are more
+      // indented than the key
+      do
+        nextContent();
+      while (Cursor != End and column() > Indent);
+
+      if (Cursor == End or column() < Indent or isEndMarker()) {
+        // No Kind
+        fail();
+        break;
+      }
+    }
+
+    if (Failed)
+      return {};
+
+    // The kind might be in Scratch, which will be overwritten
+    Scratch = Result.str();
+    Cursor = SavedCursor;
+    LineStart = SavedLineStart;
+    return Scratch;
+  }
+
+  template<typename P, size_t I = 0>
+  static bool makeConcrete(P &Pointer, llvm::StringRef Kind) {
+    using concrete_types = concrete_types_traits_t<pointee<P>>;
+    if constexpr (I < std::tuple_size_v<concrete_types>) {
+      using type = std::tuple_element_t<I, concrete_types>;
+      if (llvm::StringRef(TupleLikeTraits<type>::Name) == Kind) {
+        Pointer = P::template make<type>();
+        return true;
+      }
+
+      return makeConcrete<P, I + 1>(Pointer, Kind);
+    } else {
+      return false;
+    }
+  }
+};
+
+} // namespace detail
+
+/// Whether T can be serialized and deserialized by this module
+template<typename T>
+inline constexpr bool IsSupported = HasTupleSize<T>
+                                    and detail::IsTupleLikeMapping<T>
+                                    and detail::isSupported<T>();
+
+/// Serialize \p Root as llvm::yaml::Output would
+template<typename T>
+requires IsSupported<T>
+void serialize(llvm::raw_ostream &OS, const T &Root) {
+  detail::Emitter(OS).document(Root);
+}
+
+/// Deserialize \p Buffer into \p Root, in place
+///
+/// \return false if the document is not in the subset of YAML supported by
+///         the parser, or it is invalid. In this case, \p Root is left in an
+///         unspecified state and the caller should fall back to
+///         llvm::yaml::Input.
+template<typename T>
+requires IsSupported<T>
+bool deserialize(llvm::StringRef Buffer, T &Root) {
+  return detail::Parser(Buffer).document(Root);
+}
+
+} // namespace tupletree::yaml
@@ -5,16 +5,33 @@
 //
 
 #include <optional>
+#include <vector>
 
 #include "llvm/IR/PassManager.h"
 
+#include "revng/TypeShrinking/DataFlowGraph.h"
+
 namespace TypeShrinking {
 
 extern const uint32_t Top;
 
 bool isDataFlowSink(const llvm::Instruction *Ins);
 
-using BitLivenessAnalysisResults = std::map<llvm::Instruction *, uint32_t>;
+/// \brief The result of the bit liveness analysis on a function
+///
+/// Liveness[I] is the index from which all the bits of the operands of the
+/// node I of Graph are not alive. Graph is part of the results so that users
+/// can reuse it.
+struct BitLivenessAnalysisResults {
+  DataFlowGraph Graph;
+  std::vector<uint32_t> Liveness;
+};
+
+/// \brief Run the bit liveness analysis on \p F
+///
+/// The IR is not modified, hence distinct functions of the same module can be
+/// analyzed concurrently.
+BitLivenessAnalysisResults computeBitLiveness(llvm::Function &F);
 
 class BitLivenessWrapperPass : public llvm::FunctionPass {
 public:
@@ -4,22 +4,54 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <cstdint>
+#include <vector>
+
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Instruction.h"
 #include "llvm/Pass.h"
 
-#include "revng/ADT/GenericGraph.h"
+#include "revng/Support/Assert.h"
 
 namespace TypeShrinking {
 
-struct DataFlowNodeData {
-  DataFlowNodeData(llvm::Instruction *Ins) : Instruction(Ins){};
-  llvm::Instruction *Instruction;
+/// \brief Data flow graph of a function, with edges from uses to definitions
+///
+/// Nodes are the instructions of the function, numbered densely in the order
+/// they appear in the function. The definitions used by each node are laid out
+/// in a single contiguous array: the definitions used by node I are
+/// `Definitions[Offsets[I]..Offsets[I + 1])`.
+class DataFlowGraph {
+public:
+  using NodeID = uint32_t;
+
+private:
+  std::vector<llvm::Instruction *> Instructions;
+  std::vector<uint32_t> Offsets;
+  std::vector<NodeID> Definitions;
+
+public:
+  static DataFlowGraph fromFunction(llvm::Function &F);
+
+public:
+  size_t size() const { return Instructions.size(); }
+
+  llvm::Instruction *instruction(NodeID Node) const {
+    return Instructions[Node];
+  }
+
+  /// \return the nodes defining the operands of \p Node
+  llvm::ArrayRef<NodeID> successors(NodeID Node) const {
+    revng_assert(Node < size());
+    return llvm::ArrayRef<NodeID>(Definitions)
+      .slice(Offsets[Node], Offsets[Node + 1] - Offsets[Node]);
+  }
 };
 
-using DataFlowNode = BidirectionalNode<DataFlowNodeData>;
-
 /// Builds a data flow graph with edges from uses to definitions
-GenericGraph<DataFlowNode> buildDataFlowGraph(llvm::Function &F);
+inline DataFlowGraph buildDataFlowGraph(llvm::Function &F) {
+  return DataFlowGraph::fromFunction(F);
+}
 
 } // namespace TypeShrinking
@@ -7,6 +7,8 @@
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Instruction.h"
 #include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/PassManager.h"
+#include "llvm/Pass.h"
 #include "llvm/Transforms/Scalar.h"
 
 namespace TypeShrinking {
@@ -28,6 +30,19 @@ public:
   void getAnalysisUsage(llvm::AnalysisUsage &AU) const override;
 };
 
+/// \brief Run type shrinking on all the isolated functions of a module
+///
+/// The bit liveness analysis of each function is computed in parallel, on the
+/// threads of the global TaskScheduler, then the functions are shrunk one at a
+/// time, since changing the IR is not thread safe.
+class ParallelTypeShrinkingPass : public llvm::ModulePass {
+public:
+  static char ID;
+  ParallelTypeShrinkingPass() : ModulePass(ID) {}
+
+  bool runOnModule(llvm::Module &M) override;
+};
+
 void applyTypeShrinking(llvm::legacy::FunctionPassManager &PM);
 
 } // namespace TypeShrinking
@@ -5,8 +5,11 @@
 //
 
 #include "llvm/IR/Instructions.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Verifier.h"
 #include "llvm/IRReader/IRReader.h"
 #include "llvm/Support/Casting.h"
+#include "llvm/Support/Debug.h"
 #include "llvm/Support/SourceMgr.h"
 
 #include "revng/Support/Assert.h"
@@ -73,15 +76,13 @@ inline llvm::BasicBlock *basicBlockByName(llvm::Function *F, const char *Name) {
   revng_abort("Couldn't find a Value with the requested name");
 }
 
+/// \brief Parse the module in \p IR, aborting if it's not valid
 inline std::unique_ptr<llvm::Module>
-loadModule(llvm::LLVMContext &C, const char *Body) {
+parseModule(llvm::LLVMContext &C, llvm::StringRef IR) {
   using namespace llvm;
 
-  std::string ModuleText = buildModule(Body);
   SMDiagnostic Diagnostic;
-  using MB = MemoryBuffer;
-  std::unique_ptr<MB> Buffer = MB::getMemBuffer(StringRef(ModuleText));
-  std::unique_ptr<Module> M = parseIR(Buffer.get()->getMemBufferRef(),
+  std::unique_ptr<Module> M = parseIR(MemoryBufferRef(IR, "test"),
                                       Diagnostic,
                                       C);
 
@@ -92,3 +93,20 @@ loadModule(llvm::LLVMContext &C, const char *Body) {
 
   return M;
 }
+
+inline std::unique_ptr<llvm::Module>
+loadModule(llvm::LLVMContext &C, const char *Body) {
+  return parseModule(C, buildModule(Body));
+}
+
+/// \brief Run \p Passes on \p M, in order, and verify the result
+///
+/// \return true if any of the passes changed \p M
+template<typename... PassesT>
+inline bool runLegacyPasses(llvm::Module &M, PassesT *...Passes) {
+  llvm::legacy::PassManager PM;
+  (PM.add(Passes), ...);
+  bool Changed = PM.run(M);
+  revng_check(not llvm::verifyModule(M, &llvm::dbgs()));
+  return Changed;
+}
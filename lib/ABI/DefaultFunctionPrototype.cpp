@@ -24,8 +24,70 @@ static QualifiedType buildType(Register::Values Register, Binary &TheBinary) {
   return QualifiedType(TheBinary.getPrimitiveType(Kind, Size), {});
 }
 
+/// \return true if \p Type is what buildType returns for \p Register
+///
+/// \note unlike buildType, this never records new types in the binary.
+static bool isRegisterType(const QualifiedType &Type,
+                           Register::Values Register) {
+  if (not Type.Qualifiers.empty() or not Type.UnqualifiedType.isValid())
+    return false;
+
+  const model::Type *Unqualified = Type.UnqualifiedType.getConst();
+  auto *Primitive = llvm::dyn_cast_or_null<PrimitiveType>(Unqualified);
+  return Primitive != nullptr
+         and Primitive->PrimitiveKind == selectTypeKind(Register)
+         and Primitive->Size == Register::getSize(Register);
+}
+
+/// \return true if \p Prototype is exactly what defaultPrototype<ABI> would
+///         build, in which case it can be used in place of a new copy.
+template<ABI::Values ABI>
+static bool isDefaultPrototype(const RawFunctionType &Prototype) {
+  using AT = abi::Trait<ABI>;
+  const auto &ArgumentRegisters = AT::GeneralPurposeArgumentRegisters;
+  const auto &ReturnValueRegisters = AT::GeneralPurposeReturnValueRegisters;
+  const auto &PreservedRegisters = AT::CalleeSavedRegisters;
+
+  if (not Prototype.CustomName.empty() or not Prototype.OriginalName.empty()
+      or Prototype.FinalStackOffset != 0
+      or Prototype.StackArgumentsType.UnqualifiedType.isValid()
+      or Prototype.Arguments.size() != std::size(ArgumentRegisters)
+      or Prototype.ReturnValues.size() != std::size(ReturnValueRegisters)
+      or Prototype.PreservedRegisters.size() != std::size(PreservedRegisters))
+    return false;
+
+  for (const auto &Reg : ArgumentRegisters) {
+    auto It = Prototype.Arguments.find(Reg);
+    if (It == Prototype.Arguments.end() or not It->CustomName.empty()
+        or not isRegisterType(It->Type, Reg))
+      return false;
+  }
+
+  for (const auto &Reg : ReturnValueRegisters) {
+    auto It = Prototype.ReturnValues.find(Reg);
+    if (It == Prototype.ReturnValues.end()
+        or not isRegisterType(It->Type, Reg))
+      return false;
+  }
+
+  for (const auto &Register : PreservedRegisters)
+    if (Prototype.PreservedRegisters.count(Register) == 0)
+      return false;
+
+  return true;
+}
+
 template<ABI::Values ABI>
 TypePath defaultPrototype(Binary &TheBinary) {
+  // The default prototype of an ABI does not depend on anything else: if the
+  // binary already has one, reuse it instead of recording a new type
+  if (TheBinary.DefaultPrototype.isValid()) {
+    const auto *Existing = TheBinary.DefaultPrototype.getConst();
+    if (auto *Raw = llvm::dyn_cast_or_null<RawFunctionType>(Existing))
+      if (isDefaultPrototype<ABI>(*Raw))
+        return TheBinary.DefaultPrototype;
+  }
+
   UpcastableType NewType = makeType<RawFunctionType>();
   TypePath TypePath = TheBinary.recordNewType(std::move(NewType));
   auto &Prototype = *llvm::cast<RawFunctionType>(TypePath.get());
@@ -5,6 +5,8 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <map>
+#include <set>
 #include <unordered_set>
 
 #include "revng/ABI/FunctionType.h"
@@ -100,22 +102,44 @@ static model::QualifiedType getTypeOrDefault(const model::QualifiedType &Type,
     return buildType(Register, Binary);
 }
 
-static void replaceReferences(const model::Type::Key &OldKey,
-                              const model::TypePath &NewTypePath,
-                              TupleTree<model::Binary> &Model) {
-  auto Visitor = [&](model::TypePath &Visited) {
-    if (!Visited.isValid())
-      return; // Ignore empty references
+/// \brief Collects the types replaced by the converted ones
+///
+/// References to the replaced types are rewritten, and the replaced types are
+/// dropped, in a single visit of the model, upon commit or destruction. Until
+/// then, the replaced types are still available.
+class TypeReplacements {
+private:
+  TupleTree<model::Binary> &Model;
+  std::map<model::TypePath, model::TypePath> Replacements;
+  std::set<model::Type::Key> ToErase;
 
-    model::Type *Current = Visited.get();
-    revng_assert(Current != nullptr);
+public:
+  explicit TypeReplacements(TupleTree<model::Binary> &Model) : Model(Model) {}
+  TypeReplacements(const TypeReplacements &) = delete;
+  TypeReplacements &operator=(const TypeReplacements &) = delete;
+  ~TypeReplacements() { commit(); }
 
-    if (Current->key() == OldKey)
-      Visited = NewTypePath;
-  };
-  Model.visitReferences(Visitor);
-  Model->Types.erase(OldKey);
-}
+public:
+  void replace(const model::Type &Old, const model::TypePath &New) {
+    Replacements[Model->getTypePath(&Old)] = New;
+    ToErase.insert(Old.key());
+  }
+
+  size_t size() const { return ToErase.size(); }
+
+  void commit() {
+    if (ToErase.empty())
+      return;
+
+    Model.replaceReferences(Replacements);
+    llvm::erase_if(Model->Types, [this](model::UpcastableType &T) {
+      return ToErase.count(T->key()) != 0;
+    });
+
+    Replacements.clear();
+    ToErase.clear();
+  }
+};
 
 template<model::ABI::Values ABI>
 class ConversionHelper {
@@ -134,7 +158,8 @@ class ConversionHelper {
 public:
   static std::optional<model::TypePath>
   toCABI(const model::RawFunctionType &Function,
-         TupleTree<model::Binary> &TheBinary) {
+         TupleTree<model::Binary> &TheBinary,
+         TypeReplacements &Replacements) {
     static constexpr auto Arch = model::ABI::getArchitecture(ABI);
     if (!verify<Arch>(Function.Arguments, AT::GeneralPurposeArgumentRegisters))
       return std::nullopt;
@@ -196,13 +221,14 @@ public:
     auto NewTypePath = TheBinary->recordNewType(std::move(Ptr));
 
     // Replace all references to the old type with references to the new one.
-    replaceReferences(Function.key(), NewTypePath, TheBinary);
+    Replacements.replace(Function, NewTypePath);
 
     return NewTypePath;
   }
 
   static model::TypePath toRaw(const model::CABIFunctionType &Function,
-                               TupleTree<model::Binary> &TheBinary) {
+                               TupleTree<model::Binary> &TheBinary,
+                               TypeReplacements &Replacements) {
     auto Arguments = distributeArguments(Function.Arguments);
 
     model::RawFunctionType Result;
@@ -362,7 +388,7 @@ public:
     auto NewTypePath = TheBinary->recordNewType(std::move(Ptr));
 
     // Replace all references to the old type with references to the new one.
-    replaceReferences(Function.key(), NewTypePath, TheBinary);
+    Replacements.replace(Function, NewTypePath);
 
     return NewTypePath;
   }
@@ -790,19 +816,73 @@ tryConvertToCABI(const model::RawFunctionType &Function,
   if (!MaybeABI.has_value())
     MaybeABI = TheBinary->DefaultABI;
   revng_assert(*MaybeABI != model::ABI::Invalid);
+  TypeReplacements Replacements(TheBinary);
   return skippingEnumSwitch<1>(*MaybeABI, [&]<model::ABI::Values A>() {
-    return ConversionHelper<A>::toCABI(Function, TheBinary);
+    return ConversionHelper<A>::toCABI(Function, TheBinary, Replacements);
   });
 }
 
 model::TypePath convertToRaw(const model::CABIFunctionType &Function,
                              TupleTree<model::Binary> &TheBinary) {
   revng_assert(Function.ABI != model::ABI::Invalid);
+  TypeReplacements Replacements(TheBinary);
   return skippingEnumSwitch<1>(Function.ABI, [&]<model::ABI::Values A>() {
-    return ConversionHelper<A>::toRaw(Function, TheBinary);
+    return ConversionHelper<A>::toRaw(Function, TheBinary, Replacements);
   });
 }
 
+template<DerivesFrom<model::Type> DerivedType>
+static std::vector<const DerivedType *>
+chooseTypes(const SortedVector<model::UpcastableType> &Types) {
+  std::vector<const DerivedType *> Result;
+  for (const model::UpcastableType &Type : Types)
+    if (auto *Upcasted = llvm::dyn_cast<DerivedType>(Type.get()))
+      Result.emplace_back(Upcasted);
+  return Result;
+}
+
+size_t convertAllToCABI(TupleTree<model::Binary> &TheBinary,
+                        std::optional<model::ABI::Values> MaybeABI) {
+  if (!MaybeABI.has_value())
+    MaybeABI = TheBinary->DefaultABI;
+  revng_assert(*MaybeABI != model::ABI::Invalid);
+
+  // Collect the candidates first: converting them adds new types
+  auto ToConvert = chooseTypes<model::RawFunctionType>(TheBinary->Types);
+
+  // The replaced types stay around until all the conversions are done
+  TypeReplacements Replacements(TheBinary);
+  skippingEnumSwitch<1>(*MaybeABI, [&]<model::ABI::Values A>() {
+    for (const model::RawFunctionType *Old : ToConvert) {
+      auto New = ConversionHelper<A>::toCABI(*Old, TheBinary, Replacements);
+      revng_assert(not New or New->isValid());
+    }
+  });
+
+  size_t Result = Replacements.size();
+  Replacements.commit();
+  return Result;
+}
+
+size_t convertAllToRaw(TupleTree<model::Binary> &TheBinary) {
+  // Collect the candidates first: converting them adds new types
+  auto ToConvert = chooseTypes<model::CABIFunctionType>(TheBinary->Types);
+
+  // The replaced types stay around until all the conversions are done
+  TypeReplacements Replacements(TheBinary);
+  for (const model::CABIFunctionType *Old : ToConvert) {
+    revng_assert(Old->ABI != model::ABI::Invalid);
+    skippingEnumSwitch<1>(Old->ABI, [&]<model::ABI::Values A>() {
+      auto New = ConversionHelper<A>::toRaw(*Old, TheBinary, Replacements);
+      revng_assert(New.isValid());
+    });
+  }
+
+  size_t Result = Replacements.size();
+  Replacements.commit();
+  return Result;
+}
+
 Layout::Layout(const model::CABIFunctionType &Function) :
   Layout(skippingEnumSwitch<1>(Function.ABI, [&]<model::ABI::Values A>() {
     Layout Result;
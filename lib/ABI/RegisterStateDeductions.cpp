@@ -5,10 +5,12 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <array>
 #include <span>
 
 #include "llvm/ADT/ArrayRef.h"
 
+#include "revng/ABI/Descriptor.h"
 #include "revng/ABI/RegisterStateDeductions.h"
 #include "revng/ABI/Trait.h"
 #include "revng/Model/Binary.h"
@@ -36,8 +38,6 @@ static const State &accessCReturnValue(const StatePair &Input) {
   return Input.IsUsedForReturningValues;
 }
 
-using CRegister = const model::Register::Values;
-
 /// Finds last relevant (`Yes` or `Dead`) register out of the provided list.
 ///
 /// Returns `0` if no registers from the list were mentioned.
@@ -52,6 +52,48 @@ size_t findLastUsedIndex(llvm::ArrayRef<model::Register::Values> Registers,
   return 0;
 }
 
+/// The registers in each state, for either the arguments or the return values
+/// (depending on `Accessor`) of a `StateMap`.
+///
+/// Each register of the map belongs to exactly one of the sets, which lets
+/// the deductions handle all of them with a handful of bitwise operations.
+class StateSets {
+private:
+  std::array<abi::RegisterSet, abi::RegisterState::Count> Sets = {};
+  abi::RegisterSet All;
+
+public:
+  template<AccessorType Accessor>
+  static StateSets collect(StateMap &State) {
+    StateSets Result;
+    for (auto [Register, RegisterState] : State) {
+      Result.Sets[Accessor(RegisterState)].insert(Register);
+      Result.All.insert(Register);
+    }
+    return Result;
+  }
+
+public:
+  const abi::RegisterSet &operator[](State Value) const { return Sets[Value]; }
+  const abi::RegisterSet &all() const { return All; }
+
+  abi::RegisterSet yesOrDead() const {
+    using namespace abi::RegisterState;
+    return Sets[Yes] | Sets[YesOrDead] | Sets[Dead];
+  }
+};
+
+template<AccessorType Accessor>
+static void assign(StateMap &State,
+                   const abi::RegisterSet &Registers,
+                   abi::RegisterState::Values Value) {
+  if (Registers.none())
+    return;
+
+  for (model::Register::Values Register : Registers.registers())
+    Accessor(State[Register]) = Value;
+}
+
 template<model::ABI::Values ABI, bool EnforceABIConformance>
 struct DeductionImpl {
   static std::optional<StateMap> run(const StateMap &InputState) {
@@ -94,57 +136,31 @@ private:
   }
 
   static bool checkPositionBasedABIConformance(StateMap &State) {
-    llvm::ArrayRef GPAR = abi::Trait<ABI>::GeneralPurposeArgumentRegisters;
-    llvm::ArrayRef VAR = abi::Trait<ABI>::VectorArgumentRegisters;
-    llvm::ArrayRef GPRV = abi::Trait<ABI>::GeneralPurposeReturnValueRegisters;
-    llvm::ArrayRef VRVR = abi::Trait<ABI>::VectorReturnValueRegisters;
+    constexpr const abi::Descriptor &Descriptor = abi::getDescriptor(ABI);
+    if (!checkConformance<accessArgument>(State,
+                                          Descriptor.ArgumentRegisterSet))
+      return false;
 
-    auto AllowedArgumentRegisters = llvm::concat<CRegister>(GPAR, VAR);
-    auto AllowedReturnValueRegisters = llvm::concat<CRegister>(GPRV, VRVR);
-    for (auto [Register, RegisterState] : State) {
-      auto &[UsedForPassingArguments, UsedForReturningValues] = RegisterState;
+    if (!checkConformance<accessReturnValue>(State,
+                                             Descriptor.ReturnValueRegisterSet))
+      return false;
 
-      revng_assert(UsedForPassingArguments != abi::RegisterState::Invalid);
-      if (abi::RegisterState::isYesOrDead(UsedForPassingArguments)) {
-        if (!llvm::is_contained(AllowedArgumentRegisters, Register)) {
-          if constexpr (EnforceABIConformance == true) {
-            revng_log(Log,
-                      "Enforcing `model::Register::"
-                        << model::Register::getName(Register).data()
-                        << "` to `No` as `" << model::ABI::getName(ABI).data()
-                        << "` ABI doesn't allow it to be used.");
-            UsedForPassingArguments = abi::RegisterState::No;
-          } else {
-            revng_log(Log,
-                      "Aborting, `model::Register::"
-                        << model::Register::getName(Register).data()
-                        << "` register is used despite not being allowed by `"
-                        << model::ABI::getName(ABI).data() << "` ABI.");
-            return false;
-          }
-        }
-      }
+    return true;
+  }
 
-      revng_assert(UsedForReturningValues != abi::RegisterState::Invalid);
-      if (abi::RegisterState::isYesOrDead(UsedForReturningValues)) {
-        if (!llvm::is_contained(AllowedReturnValueRegisters, Register)) {
-          if constexpr (EnforceABIConformance == true) {
-            revng_log(Log,
-                      "Enforcing `model::Register::"
-                        << model::Register::getName(Register).data()
-                        << "` to `No` as `" << model::ABI::getName(ABI).data()
-                        << "` ABI doesn't allow it to be used.");
-            UsedForReturningValues = abi::RegisterState::No;
-          } else {
-            revng_log(Log,
-                      "Aborting, `model::Register::"
-                        << model::Register::getName(Register).data()
-                        << "` register is used despite not being allowed by `"
-                        << model::ABI::getName(ABI).data() << "` ABI.");
-            return false;
-          }
-        }
-      }
+  template<AccessorType Accessor>
+  static bool checkConformance(StateMap &State,
+                               const abi::RegisterSet &Allowed) {
+    auto Sets = StateSets::collect<Accessor>(State);
+    revng_assert(Sets[abi::RegisterState::Invalid].none());
+
+    abi::RegisterSet Violating = Sets.yesOrDead() - Allowed;
+    if constexpr (EnforceABIConformance == true) {
+      logEnforcement(Violating);
+      assign<Accessor>(State, Violating, abi::RegisterState::No);
+    } else if (Violating.any()) {
+      logViolation(Violating);
+      return false;
     }
 
     return true;
@@ -215,25 +231,18 @@ private:
     size_t VRVRCount = findLastUsedIndex<accessCReturnValue>(VRVR, State);
     auto UsedVRVR = llvm::ArrayRef(VRVR).take_front(VRVRCount);
 
-    auto AllowedRetValRegisters = llvm::concat<CRegister>(GPRV, VRVR);
-    auto UsedRetValRegisters = llvm::concat<CRegister>(UsedGPRV, UsedVRVR);
+    constexpr const abi::Descriptor &Descriptor = abi::getDescriptor(ABI);
+    abi::RegisterSet UsedRetValRegisters = abi::RegisterSet(UsedGPRV)
+                                           | abi::RegisterSet(UsedVRVR);
 
     // Even for position based ABIs, return values have behaviour patterns
     // similar to non-position based ones, so the initial deduction step is
     // to run the non-position based deduction.
-    for (auto [Register, RegisterState] : State) {
-      auto &RVState = accessReturnValue(RegisterState);
-      bool IsRVAllowed = llvm::is_contained(AllowedRetValRegisters, Register);
-      bool IsRVRequired = llvm::is_contained(UsedRetValRegisters, Register);
-      auto Deduced = singleNonPositionBasedDeduction(RVState,
-                                                     IsRVAllowed,
-                                                     IsRVRequired,
-                                                     Register);
-      if (Deduced == abi::RegisterState::Invalid)
-        return false;
-      else
-        RVState = Deduced;
-    }
+    const auto &AllowedRetValRegisters = Descriptor.ReturnValueRegisterSet;
+    if (!runNonPositionBasedDeduction<accessReturnValue>(State,
+                                                         AllowedRetValRegisters,
+                                                         UsedRetValRegisters))
+      return false;
 
     // Then we make sure that only either GPRs or VRs are used, never both.
     bool Dummy = false;
@@ -399,133 +408,117 @@ private:
     auto UsedVRVR = llvm::ArrayRef(VRVR).take_front(VRVRCount);
 
     // Merge sub-ranges together to get the final register sets.
-    auto AllowedArgRegisters = llvm::concat<CRegister>(GPAR, VAR);
-    auto AllowedRetValRegisters = llvm::concat<CRegister>(GPRVR, VRVR);
-    auto UsedArgRegisters = llvm::concat<CRegister>(UsedGPAR, UsedVAR);
-    auto UsedRetValRegisters = llvm::concat<CRegister>(UsedGPRVR, UsedVRVR);
+    constexpr const abi::Descriptor &Descriptor = abi::getDescriptor(ABI);
+    const auto &AllowedArgRegisters = Descriptor.ArgumentRegisterSet;
+    const auto &AllowedRetValRegisters = Descriptor.ReturnValueRegisterSet;
+    using Set = abi::RegisterSet;
+    Set UsedArgRegisters = Set(UsedGPAR) | Set(UsedVAR);
+    Set UsedRetValRegisters = Set(UsedGPRVR) | Set(UsedVRVR);
 
     // Copy the state to serve as a return value.
     StateMap Result = State;
 
-    // Try and apply deductions for each register. Abort if any of them fails.
-    for (auto [Register, RegisterState] : Result) {
-      auto &Argument = accessArgument(RegisterState);
-      bool IsArgAllowed = llvm::is_contained(AllowedArgRegisters, Register);
-      bool IsArgRequired = llvm::is_contained(UsedArgRegisters, Register);
-      auto DeducedArgument = singleNonPositionBasedDeduction(Argument,
-                                                             IsArgAllowed,
-                                                             IsArgRequired,
-                                                             Register);
-      if (DeducedArgument == abi::RegisterState::Invalid)
-        return std::nullopt;
-      else
-        Argument = DeducedArgument;
-
-      auto &ReturnValue = accessReturnValue(RegisterState);
-      bool IsRVAllowed = llvm::is_contained(AllowedRetValRegisters, Register);
-      bool IsRVRequired = llvm::is_contained(UsedRetValRegisters, Register);
-      auto DeducedReturnValue = singleNonPositionBasedDeduction(ReturnValue,
-                                                                IsRVAllowed,
-                                                                IsRVRequired,
-                                                                Register);
-      if (DeducedReturnValue == abi::RegisterState::Invalid)
-        return std::nullopt;
-      else
-        ReturnValue = DeducedReturnValue;
-    }
+    // Try and apply deductions to all the registers. Abort if it fails.
+    if (!runNonPositionBasedDeduction<accessArgument>(Result,
+                                                      AllowedArgRegisters,
+                                                      UsedArgRegisters))
+      return std::nullopt;
+
+    if (!runNonPositionBasedDeduction<accessReturnValue>(Result,
+                                                         AllowedRetValRegisters,
+                                                         UsedRetValRegisters))
+      return std::nullopt;
 
     return Result;
   }
 
-  static abi::RegisterState::Values
-  singleNonPositionBasedDeduction(const abi::RegisterState::Values &Input,
-                                  bool IsAllowed,
-                                  bool IsRequired,
-                                  model::Register::Values Register) {
-    auto Result = Input; // Copy the input to serve as a return value.
-
-    // Normalize the state.
-    if (Result == abi::RegisterState::Invalid)
-      Result = abi::RegisterState::Maybe;
-
-    // Fail if the register is not allowed.
-    if (!IsAllowed) {
-      if constexpr (EnforceABIConformance == true) {
-        revng_log(Log,
-                  "Enforcing `model::Register::"
-                    << model::Register::getName(Register).data()
-                    << "` to `No` as `" << model::ABI::getName(ABI).data()
-                    << "` ABI doesn't allow it to be used.");
-        return abi::RegisterState::No;
-      } else {
-        using namespace abi::RegisterState;
-        if (Result != Maybe && Result != No) {
-          revng_log(Log,
-                    "Aborting, `model::Register::"
-                      << model::Register::getName(Register).data()
-                      << "` register is used despite not being allowed by `"
-                      << model::ABI::getName(ABI).data() << "` ABI.");
-          return abi::RegisterState::Invalid;
-        } else {
-          return abi::RegisterState::No;
-        }
-      }
-    }
+  static void logEnforcement(const abi::RegisterSet &Registers) {
+    if (not Log.isEnabled())
+      return;
 
-    if (abi::RegisterState::isYesOrDead(Result)) {
-      // If a usable register is set, it's required by definition.
-      revng_assert(IsRequired,
-                   "Encountered an impossible state: the data structure is "
-                   "probably corrupted.");
+    for (model::Register::Values Register : Registers.registers())
+      revng_log(Log,
+                "Enforcing `model::Register::"
+                  << model::Register::getName(Register).data()
+                  << "` to `No` as `" << model::ABI::getName(ABI).data()
+                  << "` ABI doesn't allow it to be used.");
+  }
 
-      // The current state looks good, preserve it.
-      return Result;
-    } else {
-      if (IsRequired) {
-        if (Result == abi::RegisterState::NoOrDead) {
-          // The register is required so it must not be marked as `No`.
-          // As such `Dead` is the only option left.
-          return abi::RegisterState::Dead;
-        }
+  static void logViolation(const abi::RegisterSet &Registers) {
+    if (not Log.isEnabled())
+      return;
 
-        if (Result == abi::RegisterState::Maybe) {
-          // There's no information about the register.
-          // Return the most generic acceptable option.
-          return abi::RegisterState::YesOrDead;
-        }
+    for (model::Register::Values Register : Registers.registers())
+      revng_log(Log,
+                "Aborting, `model::Register::"
+                  << model::Register::getName(Register).data()
+                  << "` register is used despite not being allowed by `"
+                  << model::ABI::getName(ABI).data() << "` ABI.");
+  }
 
-        if constexpr (EnforceABIConformance == true) {
-          // The states are incompatible.
-          // Overwrite the result with the most generic acceptable option.
-          return abi::RegisterState::YesOrDead;
-        } else {
-          // Abort if the required register is marked as contradiction.
-          if (Result == abi::RegisterState::Contradiction) {
+  /// Applies the non-position based deduction to either the arguments or the
+  /// return values (depending on \p Accessor) of all the registers at once.
+  ///
+  /// \p Allowed are the registers the ABI allows to be used, while
+  /// \p Required are the ones that must be used because a subsequent one is.
+  ///
+  /// Returns `false` if the deduction fails.
+  template<AccessorType Accessor>
+  static bool runNonPositionBasedDeduction(StateMap &State,
+                                           const abi::RegisterSet &Allowed,
+                                           const abi::RegisterSet &Required) {
+    using namespace abi::RegisterState;
+    auto Sets = StateSets::collect<Accessor>(State);
+
+    // `Invalid` is normalized to `Maybe`.
+    abi::RegisterSet Unknown = Sets[Invalid] | Sets[Maybe];
+    abi::RegisterSet Forbidden = Sets.all() - Allowed;
+    abi::RegisterSet Set = Sets.yesOrDead() & Allowed;
+    abi::RegisterSet Missing = (Sets.all() & Allowed & Required) - Set;
+
+    // If a usable register is set, it's required by definition.
+    revng_assert((Set - Required).none(),
+                 "Encountered an impossible state: the data structure is "
+                 "probably corrupted.");
+
+    if constexpr (EnforceABIConformance == true) {
+      logEnforcement(Forbidden);
+    } else {
+      abi::RegisterSet Violating = Forbidden - Unknown - Sets[No];
+      if (Violating.any()) {
+        logViolation(Violating);
+        return false;
+      }
+
+      // Abort if a required register is marked as contradiction or as `No`.
+      abi::RegisterSet Contradicting = Missing & Sets[Contradiction];
+      abi::RegisterSet Unused = Missing & Sets[No];
+      if (Contradicting.any() or Unused.any()) {
+        if (Log.isEnabled()) {
+          for (model::Register::Values Register : Contradicting.registers())
             revng_log(Log,
                       "Aborting, `model::Register::"
                         << model::Register::getName(Register).data()
                         << "` is set to `Contradiction`.");
-            return abi::RegisterState::Invalid;
-          }
-
-          // Abort if the required register is marked as `No`.
-          if (Result == abi::RegisterState::No) {
+          for (model::Register::Values Register : Unused.registers())
             revng_log(Log,
                       "Aborting, `model::Register::"
                         << model::Register::getName(Register).data()
                         << "` is set to `No` despite being required.");
-            return abi::RegisterState::Invalid;
-          }
         }
-      } else {
-        // The current state looks good, preserve it.
-        return Result;
+        return false;
       }
     }
 
-    // Abort in case of unusual circumstances, like a new state enumerator.
-    revng_assert("This point should never be reached.");
-    return abi::RegisterState::Invalid;
+    assign<Accessor>(State, Sets[Invalid], Maybe);
+    assign<Accessor>(State, Forbidden, No);
+
+    // A required register cannot be `No`, so `NoOrDead` can only be `Dead`.
+    // Otherwise, pick the most generic acceptable option: `YesOrDead`.
+    assign<Accessor>(State, Missing & Sets[NoOrDead], Dead);
+    assign<Accessor>(State, Missing - Sets[NoOrDead], YesOrDead);
+
+    return true;
   }
 };
 
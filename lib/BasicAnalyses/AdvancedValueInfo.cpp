@@ -0,0 +1,21 @@
+/// \file AdvancedValueInfo.cpp
+/// \brief Options of the AdvancedValueInfo analysis.
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include "llvm/Support/CommandLine.h"
+
+#include "revng/BasicAnalyses/AdvancedValueInfo.h"
+#include "revng/Support/CommandLine.h"
+
+using namespace llvm;
+
+cl::opt<unsigned> DisjointRangesBudget("avi-disjoint-ranges-budget",
+                                       cl::desc("maximum number of basic "
+                                                "blocks the disjoint ranges "
+                                                "analysis of AVI can visit, "
+                                                "0 means no limit"),
+                                       cl::init(0),
+                                       cl::cat(MainCategory));
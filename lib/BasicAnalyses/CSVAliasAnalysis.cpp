@@ -5,6 +5,9 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <map>
+#include <set>
+
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/MDBuilder.h"
@@ -20,21 +23,34 @@ class CSVAliasAnalysisPassImpl;
 using CSVAAP = CSVAliasAnalysisPass;
 using CSVAAPI = CSVAliasAnalysisPassImpl;
 
+/// Named metadata holding, for each CSV, a pair composed by the CSV itself and
+/// its alias scope
+static constexpr const char *CSVAliasScopesMDName = "revng.csv.alias.scopes";
+
+/// \return the CSV of an entry of CSVAliasScopesMDName, or nullptr if it has
+///         been deleted
+static GlobalVariable *getCSV(const MDTuple *Entry) {
+  return mdconst::dyn_extract_or_null<GlobalVariable>(Entry->getOperand(0));
+}
+
 class CSVAliasAnalysisPassImpl {
   struct CSVAliasInfo {
     MDNode *AliasScope;
     MDNode *AliasSet;
+    /// Built on first use, since it lists all the other scopes
     MDNode *NoAliasSet;
   };
   std::map<const GlobalVariable *, CSVAliasInfo> CSVAliasInfoMap;
   std::vector<Metadata *> AllCSVScopes;
-  GeneratedCodeBasicInfo *GCBI = nullptr;
+  MDNode *MemoryAliasSet = nullptr;
 
 public:
   void run(Module &, ModuleAnalysisManager &);
 
 private:
-  void initializeAliasInfo(Module &M);
+  void initializeAliasInfo(Module &M, GeneratedCodeBasicInfo &GCBI);
+  void loadAliasInfo(const Module &M);
+  MDNode *getNoAliasSet(CSVAliasInfo &AliasInfo, LLVMContext &Context);
   void decorateMemoryAccesses(Instruction &I);
 };
 
@@ -46,11 +62,10 @@ PreservedAnalyses CSVAAP::run(Module &M, ModuleAnalysisManager &MAM) {
 
 void CSVAAPI::run(Module &M, ModuleAnalysisManager &MAM) {
   // Get the result of the GCBI analysis
-  GCBI = &(MAM.getResult<GeneratedCodeBasicInfoAnalysis>(M));
-  revng_assert(GCBI != nullptr);
+  auto &GCBI = MAM.getResult<GeneratedCodeBasicInfoAnalysis>(M);
 
   // Initialize the alias information for the CSVs.
-  initializeAliasInfo(M);
+  initializeAliasInfo(M, GCBI);
 
   // Decorate the IR with the alias information for the CSVs.
   for (Function &F : M)
@@ -59,41 +74,92 @@ void CSVAAPI::run(Module &M, ModuleAnalysisManager &MAM) {
         decorateMemoryAccesses(I);
 }
 
-void CSVAAPI::initializeAliasInfo(Module &M) {
+/// \brief Load the alias scopes of the CSVs recorded in \p M
+void CSVAAPI::loadAliasInfo(const Module &M) {
+  NamedMDNode *NamedMD = M.getNamedMetadata(CSVAliasScopesMDName);
+  revng_assert(NamedMD != nullptr);
+
+  LLVMContext &Context = M.getContext();
+
+  for (MDNode *Entry : NamedMD->operands()) {
+    auto *Tuple = cast<MDTuple>(Entry);
+    GlobalVariable *CSV = getCSV(Tuple);
+    if (CSV == nullptr)
+      continue;
+
+    auto *CSVScope = cast<MDNode>(Tuple->getOperand(1));
+    CSVAliasInfo &AliasInfo = CSVAliasInfoMap[CSV];
+    AliasInfo.AliasScope = CSVScope;
+    AliasInfo.AliasSet = MDNode::get(Context,
+                                     ArrayRef<Metadata *>({ CSVScope }));
+    AliasInfo.NoAliasSet = nullptr;
+    AllCSVScopes.push_back(CSVScope);
+  }
+
+  MemoryAliasSet = MDNode::get(Context, AllCSVScopes);
+}
+
+/// \brief Get the scopes of all the CSVs except the one of \p AliasInfo
+///
+/// MDNode::get uniques the sets, so each run gets the same nodes.
+MDNode *
+CSVAAPI::getNoAliasSet(CSVAliasInfo &AliasInfo, LLVMContext &Context) {
+  if (AliasInfo.NoAliasSet == nullptr) {
+    std::vector<Metadata *> OtherCSVScopes;
+    OtherCSVScopes.reserve(AllCSVScopes.size());
+    for (Metadata *Scope : AllCSVScopes)
+      if (Scope != AliasInfo.AliasScope)
+        OtherCSVScopes.push_back(Scope);
+
+    AliasInfo.NoAliasSet = MDNode::get(Context, OtherCSVScopes);
+  }
+
+  return AliasInfo.NoAliasSet;
+}
+
+void CSVAAPI::initializeAliasInfo(Module &M, GeneratedCodeBasicInfo &GCBI) {
   LLVMContext &Context = M.getContext();
   QuickMetadata QMD(Context);
   MDBuilder MDB(Context);
 
-  MDNode *AliasDomain = MDB.createAliasScopeDomain("CSVAliasDomain");
-  std::vector<GlobalVariable *> CSVs = GCBI->csvs();
+  std::vector<GlobalVariable *> CSVs = GCBI.csvs();
 
-  const auto *PCH = GCBI->programCounterHandler();
+  const auto *PCH = GCBI.programCounterHandler();
   for (GlobalVariable *PCCSV : PCH->pcCSVs())
     CSVs.emplace_back(PCCSV);
 
-  // Build alias scopes
-  for (const GlobalVariable *CSV : CSVs) {
-    CSVAliasInfo &AliasInfo = CSVAliasInfoMap[CSV];
-
-    MDNode *CSVScope = MDB.createAliasScope(CSV->getName(), AliasDomain);
-    AliasInfo.AliasScope = CSVScope;
-    AllCSVScopes.push_back(CSVScope);
-    MDNode *CSVAliasSet = MDNode::get(Context,
-                                      ArrayRef<Metadata *>({ CSVScope }));
-    AliasInfo.AliasSet = CSVAliasSet;
+  // Reuse the scopes created by previous runs, if any, so that the ones
+  // attached to instructions stay valid
+  NamedMDNode *NamedMD = M.getNamedMetadata(CSVAliasScopesMDName);
+  MDNode *AliasDomain = nullptr;
+  std::set<const GlobalVariable *> Known;
+  if (NamedMD != nullptr) {
+    for (MDNode *Entry : NamedMD->operands()) {
+      auto *Tuple = cast<MDTuple>(Entry);
+      auto *CSVScope = cast<MDNode>(Tuple->getOperand(1));
+      // The second operand of an alias scope is its domain
+      AliasDomain = cast<MDNode>(CSVScope->getOperand(1));
+      if (GlobalVariable *CSV = getCSV(Tuple))
+        Known.insert(CSV);
+    }
+  } else {
+    NamedMD = M.getOrInsertNamedMetadata(CSVAliasScopesMDName);
   }
 
-  // Build noalias sets
-  for (const GlobalVariable *CSV : CSVs) {
-    CSVAliasInfo &AliasInfo = CSVAliasInfoMap[CSV];
-    std::vector<Metadata *> OtherCSVScopes;
-    for (const auto &Q : CSVAliasInfoMap)
-      if (Q.first != CSV)
-        OtherCSVScopes.push_back(Q.second.AliasScope);
+  if (AliasDomain == nullptr)
+    AliasDomain = MDB.createAliasScopeDomain("CSVAliasDomain");
 
-    MDNode *CSVNoAliasSet = MDNode::get(Context, OtherCSVScopes);
-    AliasInfo.NoAliasSet = CSVNoAliasSet;
+  // Build alias scopes for the CSVs we've never met
+  for (GlobalVariable *CSV : CSVs) {
+    if (Known.count(CSV) != 0)
+      continue;
+
+    MDNode *CSVScope = MDB.createAliasScope(CSV->getName(), AliasDomain);
+    NamedMD->addOperand(QMD.tuple({ QMD.get(CSV), CSVScope }));
+    Known.insert(CSV);
   }
+
+  loadAliasInfo(M);
 }
 
 void CSVAAPI::decorateMemoryAccesses(Instruction &I) {
@@ -106,20 +172,26 @@ void CSVAAPI::decorateMemoryAccesses(Instruction &I) {
   else
     return;
 
+  MDNode *AliasSet = nullptr;
+  MDNode *NoAliasSet = MemoryAliasSet;
+
   // Check if the pointer is a CSV
   if (auto *GV = dyn_cast<GlobalVariable>(Pointer)) {
     auto It = CSVAliasInfoMap.find(GV);
     if (It != CSVAliasInfoMap.end()) {
-      // Set alias.scope and noalias metadata
-      auto *CurrentMDAliasScope = I.getMetadata(LLVMContext::MD_alias_scope);
-      auto *CurrentMDNoAliasScope = I.getMetadata(LLVMContext::MD_noalias);
-      I.setMetadata(LLVMContext::MD_alias_scope, It->second.AliasSet);
-      I.setMetadata(LLVMContext::MD_noalias, It->second.NoAliasSet);
-      return;
+      AliasSet = It->second.AliasSet;
+      NoAliasSet = getNoAliasSet(It->second, I.getContext());
     }
   }
 
-  // It's not a CSV memory access, set noalias info
-  MDNode *MemoryAliasSet = MDNode::get(I.getContext(), AllCSVScopes);
-  I.setMetadata(LLVMContext::MD_noalias, MemoryAliasSet);
+  // Leave alone the instructions that are already up to date
+  if (I.getMetadata(LLVMContext::MD_alias_scope) == AliasSet
+      and I.getMetadata(LLVMContext::MD_noalias) == NoAliasSet)
+    return;
+
+  // Set alias.scope and noalias metadata. If it's not a CSV memory access, we
+  // just set noalias info.
+  if (AliasSet != nullptr)
+    I.setMetadata(LLVMContext::MD_alias_scope, AliasSet);
+  I.setMetadata(LLVMContext::MD_noalias, NoAliasSet);
 }
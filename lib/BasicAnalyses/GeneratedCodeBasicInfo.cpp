@@ -6,10 +6,12 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <algorithm>
 #include <queue>
 #include <set>
 
 #include "llvm/ADT/DepthFirstIterator.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/IR/Dominators.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Instructions.h"
@@ -18,6 +20,7 @@
 #include "revng/Model/Generated/Early/Register.h"
 #include "revng/Model/LoadModelPass.h"
 #include "revng/Support/Debug.h"
+#include "revng/Support/Statistics.h"
 
 using namespace llvm;
 
@@ -27,6 +30,8 @@ char GeneratedCodeBasicInfoWrapperPass::ID = 0;
 using RegisterGCBI = RegisterPass<GeneratedCodeBasicInfoWrapperPass>;
 static RegisterGCBI X("gcbi", "Generated Code Basic Info", true, true);
 
+static CounterMap<std::string> Rebuilds("gcbi-rebuilds");
+
 void GeneratedCodeBasicInfo::run(Module &M) {
   RootFunction = M.getFunction("root");
   NewPC = M.getFunction("newpc");
@@ -64,6 +69,28 @@ void GeneratedCodeBasicInfo::run(Module &M) {
     }
   }
 
+  if (auto *NamedMD = M.getNamedMetadata(CSVOffsetsMDName)) {
+    auto *Tuple = cast<MDTuple>(NamedMD->getOperand(0));
+    for (const MDOperand &Operand : Tuple->operands()) {
+      if (Operand.get() == nullptr)
+        continue;
+
+      // Deleting a CSV leaves a null in place of the reference to it
+      auto *Entry = cast<MDTuple>(Operand.get());
+      if (Entry->getOperand(0).get() == nullptr)
+        continue;
+
+      auto *CSV = cast<GlobalVariable>(QMD.extract<Constant *>(Entry, 0));
+      auto Offset = QMD.extract<int64_t>(Entry, 1);
+      CSVsByOffset.emplace_back(Offset, CSV);
+      OffsetByCSV[CSV] = Offset;
+    }
+
+    llvm::sort(CSVsByOffset, [](const auto &LHS, const auto &RHS) {
+      return LHS.first < RHS.first;
+    });
+  }
+
   revng_log(PassesLog, "Ending GeneratedCodeBasicInfo");
 }
 
@@ -98,7 +125,8 @@ void GeneratedCodeBasicInfo::parseRoot() {
       case BlockType::JumpTargetBlock: {
         auto *Call = cast<CallInst>(&*BB.begin());
         revng_assert(Call->getCalledFunction() == NewPC);
-        JumpTargets[MetaAddress::fromConstant(Call->getArgOperand(0))] = &BB;
+        auto Address = MetaAddress::fromConstant(Call->getArgOperand(0));
+        JumpTargets.emplace_back(Address, &BB);
         break;
       }
       case BlockType::RootDispatcherHelperBlock:
@@ -111,6 +139,119 @@ void GeneratedCodeBasicInfo::parseRoot() {
       }
     }
   }
+
+  auto CompareAddress = [](const auto &LHS, const auto &RHS) {
+    return LHS.first < RHS.first;
+  };
+  llvm::stable_sort(JumpTargets, CompareAddress);
+}
+
+/// Hash a value by identity and by name. Values recycling the memory of a
+/// deleted one are detected through GeneratedCodeBasicInfo::trackedValues.
+static hash_code hashValue(const Value *V) {
+  if (V == nullptr)
+    return hash_value(V);
+  return hash_combine(V, V->getName());
+}
+
+/// Hash the content of a metadata node, as opposed to its address: uniqued
+/// nodes are recycled, and distinct ones can be mutated in place
+static hash_code hashMetadata(const Metadata *MD) {
+  if (MD == nullptr)
+    return hash_value(MD);
+
+  if (auto *String = dyn_cast<MDString>(MD))
+    return hash_value(String->getString());
+
+  if (auto *AsValue = dyn_cast<ValueAsMetadata>(MD)) {
+    const Value *V = AsValue->getValue();
+    if (auto *Integer = dyn_cast<ConstantInt>(V))
+      return hash_value(Integer->getValue());
+    return hashValue(V->stripPointerCasts());
+  }
+
+  hash_code Result = hash_value(MD->getMetadataID());
+  if (auto *Node = dyn_cast<MDNode>(MD))
+    for (const MDOperand &Operand : Node->operands())
+      Result = hash_combine(Result, hashMetadata(Operand.get()));
+  return Result;
+}
+
+static hash_code hashNamedMetadata(const NamedMDNode *NamedMD) {
+  if (NamedMD == nullptr)
+    return hash_value(NamedMD);
+
+  hash_code Result = hash_value(NamedMD->getNumOperands());
+  for (const MDNode *Operand : NamedMD->operands())
+    Result = hash_combine(Result, hashMetadata(Operand));
+  return Result;
+}
+
+GeneratedCodeBasicInfo::Fingerprint
+GeneratedCodeBasicInfo::computeFingerprint(Module &M) {
+  Fingerprint Result;
+
+  Function *Root = M.getFunction("root");
+  auto *CSVsMD = M.getNamedMetadata("revng.csv");
+  auto *OffsetsMD = M.getNamedMetadata(CSVOffsetsMDName);
+  Result.Markers = hash_combine(hashValue(Root),
+                                hashValue(M.getFunction("newpc")),
+                                hashNamedMetadata(CSVsMD),
+                                hashNamedMetadata(OffsetsMD));
+  if (Root == nullptr)
+    return Result;
+
+  for (BasicBlock &BB : *Root) {
+    Result.CFG = hash_combine(Result.CFG, hashValue(&BB));
+    for (BasicBlock *Successor : successors(&BB))
+      Result.CFG = hash_combine(Result.CFG, Successor);
+
+    if (BB.empty())
+      continue;
+
+    BlockType::Values Type = getType(&BB);
+    if (Type == BlockType::TranslatedBlock)
+      continue;
+
+    Result.Markers = hash_combine(Result.Markers, hashValue(&BB), Type);
+    if (Type == BlockType::JumpTargetBlock) {
+      auto *Call = cast<CallInst>(&*BB.begin());
+      auto Address = MetaAddress::fromConstant(Call->getArgOperand(0));
+      Result.Markers = hash_combine(Result.Markers,
+                                    Call->getCalledFunction(),
+                                    Address);
+    }
+  }
+
+  return Result;
+}
+
+std::vector<WeakVH> GeneratedCodeBasicInfo::trackedValues(Module &M) {
+  std::vector<WeakVH> Result;
+  for (Function *F : { M.getFunction("root"), M.getFunction("newpc") })
+    if (F != nullptr)
+      Result.emplace_back(F);
+
+  if (Function *Root = M.getFunction("root"))
+    for (BasicBlock &BB : *Root)
+      Result.emplace_back(&BB);
+
+  return Result;
+}
+
+void GeneratedCodeBasicInfo::purgeCFGInformation(bool RootChanged) {
+  if (RootChanged) {
+    PCToBlockCache.clear();
+    DTMap.clear();
+    return;
+  }
+
+  for (auto It = DTMap.begin(); It != DTMap.end();) {
+    if (It->first != RootFunction)
+      It = DTMap.erase(It);
+    else
+      ++It;
+  }
 }
 
 GeneratedCodeBasicInfo::SuccessorsList
@@ -232,8 +373,13 @@ void GeneratedCodeBasicInfo::initializePCToBlockCache() {
       revng_assert(DTNode != nullptr);
     }
 
-    PCToBlockCache.insert({ getBasicBlockPC(DTNode->getBlock()), &BB });
+    PCToBlockCache.emplace_back(getBasicBlockPC(DTNode->getBlock()), &BB);
   }
+
+  // Keep the order of the blocks within each jump target stable
+  llvm::stable_sort(PCToBlockCache, [](const auto &LHS, const auto &RHS) {
+    return LHS.first < RHS.first;
+  });
 }
 
 GeneratedCodeBasicInfo
@@ -252,13 +398,49 @@ GeneratedCodeBasicInfoAnalysis::run(Function &F, FunctionAnalysisManager &FAM) {
   return GCBI;
 }
 
+GeneratedCodeBasicInfo &
+GeneratedCodeBasicInfoAnalysis::get(Function &F, FunctionAnalysisManager &FAM) {
+  using GCBIA = GeneratedCodeBasicInfoAnalysis;
+  auto &MAMProxy = FAM.getResult<ModuleAnalysisManagerFunctionProxy>(F);
+  if (auto *Cached = MAMProxy.getCachedResult<GCBIA>(*F.getParent()))
+    return *Cached;
+
+  return FAM.getResult<GCBIA>(F);
+}
+
 bool GeneratedCodeBasicInfoWrapperPass::runOnModule(Module &M) {
   auto &LMA = getAnalysis<LoadModelWrapperPass>().get();
-  GCBI.reset(new GeneratedCodeBasicInfo(*LMA.getReadOnlyModel()));
+  const model::Binary *NewBinary = &*LMA.getReadOnlyModel();
+  auto NewFingerprint = GeneratedCodeBasicInfo::computeFingerprint(M);
+
+  // If any of the values hashed by address has been deleted, the fingerprint
+  // cannot be trusted
+  auto IsDeleted = [](const WeakVH &Handle) { return Handle == nullptr; };
+  bool AnyDeleted = llvm::any_of(Tracked, IsDeleted);
+
+  // Functions other than root are not fingerprinted, hence their CFG
+  // information is always dropped
+  if (GCBI and Binary == NewBinary and not AnyDeleted
+      and LastFingerprint.Markers == NewFingerprint.Markers) {
+    bool CFGChanged = LastFingerprint.CFG != NewFingerprint.CFG;
+    GCBI->purgeCFGInformation(CFGChanged);
+    if (CFGChanged)
+      Tracked = GeneratedCodeBasicInfo::trackedValues(M);
+    LastFingerprint = NewFingerprint;
+    Rebuilds.push("avoided");
+    return false;
+  }
+
+  Binary = NewBinary;
+  LastFingerprint = NewFingerprint;
+  Tracked = GeneratedCodeBasicInfo::trackedValues(M);
+  GCBI.reset(new GeneratedCodeBasicInfo(*Binary));
   GCBI->run(M);
+  Rebuilds.push("performed");
   return false;
 }
 
 void GeneratedCodeBasicInfoWrapperPass::releaseMemory() {
-  GCBI.reset();
+  // The result is kept around, so that the next run can reuse it if the module
+  // did not change in a relevant way. It is released with the pass.
 }
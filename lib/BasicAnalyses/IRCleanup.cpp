@@ -0,0 +1,80 @@
+/// \file IRCleanup.cpp
+/// \brief Perform the simple IR cleanups in a single walk of the module.
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/PassManager.h"
+
+#include "revng/BasicAnalyses/IRCleanup.h"
+#include "revng/BasicAnalyses/ShrinkInstructionOperandsPass.h"
+#include "revng/Support/FunctionTags.h"
+#include "revng/Support/IRHelpers.h"
+
+using namespace llvm;
+
+char IRCleanup::ID = 0;
+using Register = RegisterPass<IRCleanup>;
+static Register X("ir-cleanup", "Perform the simple IR cleanups", false, false);
+
+bool IRCleanup::cleanup(Function &F) {
+  bool Changed = false;
+
+  bool DropDebugInfo = FunctionTags::Isolated.isTagOf(&F);
+  if (DropDebugInfo and F.getMetadata(LLVMContext::MD_dbg) != nullptr) {
+    F.setMetadata(LLVMContext::MD_dbg, nullptr);
+    Changed = true;
+  }
+
+  SmallVector<Instruction *, 16> ToErase;
+  for (BasicBlock &BB : F) {
+    // Shrinking might erase the truncation following the current instruction
+    for (Instruction &I : BB) {
+      if (isCallTo(&I, "newpc")) {
+        ToErase.push_back(&I);
+        continue;
+      }
+
+      if (DropDebugInfo and I.getMetadata(LLVMContext::MD_dbg) != nullptr) {
+        I.setMetadata(LLVMContext::MD_dbg, nullptr);
+        Changed = true;
+      }
+
+      Changed = shrinkInstructionOperands(I) or Changed;
+    }
+  }
+
+  Changed = Changed or not ToErase.empty();
+  for (Instruction *I : ToErase)
+    eraseFromParent(I);
+
+  return Changed;
+}
+
+/// \return true if \p F is made of a single return
+static bool isEmpty(const Function &F) {
+  return F.size() == 1 and F.getEntryBlock().size() == 1
+         and isa<ReturnInst>(F.getEntryBlock().front());
+}
+
+bool IRCleanup::runOnModule(Module &M) {
+  bool Changed = false;
+  for (Function &F : M)
+    Changed = cleanup(F) or Changed;
+
+  Function *NewPCFunction = M.getFunction("newpc");
+  if (NewPCFunction != nullptr and not isEmpty(*NewPCFunction)) {
+    LLVMContext &Context = getContext(&M);
+    NewPCFunction->deleteBody();
+    ReturnInst::Create(Context, BasicBlock::Create(Context, "", NewPCFunction));
+    Changed = true;
+  }
+
+  return Changed;
+}
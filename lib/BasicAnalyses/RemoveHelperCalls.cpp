@@ -17,7 +17,7 @@ RemoveHelperCallsPass::run(llvm::Function &F,
   using namespace llvm;
 
   // Get the result of the GCBI analysis
-  GCBI = &(FAM.getResult<GeneratedCodeBasicInfoAnalysis>(F));
+  GCBI = &GeneratedCodeBasicInfoAnalysis::get(F, FAM);
   revng_assert(GCBI != nullptr);
 
   SmallVector<Instruction *, 16> ToReplace;
@@ -63,8 +63,8 @@ PreservedAnalyses AAWriterPass::run(Function &F, FunctionAnalysisManager &FAM) {
   std::unique_ptr<llvm::AssemblyAnnotationWriter> Annotator;
   Annotator.reset(new AliasAnalysisAnnotatedWriter(StoresOnly));
 
-  formatted_raw_ostream FOS(OS);
   F.print(OS, Annotator.get(), true);
+  OS.endRecord();
 
   return PreservedAnalyses::all();
 }
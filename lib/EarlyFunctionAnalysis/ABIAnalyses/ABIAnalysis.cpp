@@ -8,13 +8,16 @@
 #include "llvm/IR/Instruction.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/Support/Casting.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/raw_ostream.h"
 
 #include "revng/ABI/RegisterState.h"
 #include "revng/ADT/ZipMapIterator.h"
 #include "revng/EarlyFunctionAnalysis/Common.h"
+#include "revng/MFP/MFP.h"
 #include "revng/Model/Binary.h"
 #include "revng/Support/Assert.h"
+#include "revng/Support/CommandLine.h"
 #include "revng/Support/Debug.h"
 #include "revng/Support/IRHelpers.h"
 #include "revng/Support/MetaAddress.h"
@@ -26,6 +29,13 @@ using namespace llvm;
 
 static Logger<> ABIAnalysesLog("abi-analyses");
 
+static cl::opt<bool> FuseABIAnalyses("fuse-abi-analyses",
+                                     cl::desc("run together the ABI analyses "
+                                              "starting from the same basic "
+                                              "block"),
+                                     cl::init(true),
+                                     cl::cat(MainCategory));
+
 namespace ABIAnalyses {
 using RegisterState = abi::RegisterState::Values;
 
@@ -220,16 +230,13 @@ void finalizeReturnValues(ABIAnalysesResults &ABIResults) {
   }
 }
 
-// Run the ABI analyses on the outlined function F. This function must have all
-// the original function calls replaced with a basic block starting with a call
-// to `precall_hook` followed by a summary of the side effects of the function
-// followed by a call to `postcall_hook` and a basic block terminating
-// instruction.
-ABIAnalysesResults analyzeOutlinedFunction(Function *F,
-                                           const GeneratedCodeBasicInfo &GCBI,
-                                           Function *PreCallSiteHook,
-                                           Function *PostCallSiteHook,
-                                           Function *RetHook) {
+// Run each ABI analysis on its own
+static PartialAnalysisResults
+analyzeSeparately(Function *F,
+                  const GeneratedCodeBasicInfo &GCBI,
+                  Function *PreCallSiteHook,
+                  Function *PostCallSiteHook,
+                  Function *RetHook) {
   namespace UAOF = UsedArgumentsOfFunction;
   namespace DRAOF = DeadRegisterArgumentsOfFunction;
   namespace RAOFC = RegisterArgumentsOfFunctionCall;
@@ -237,12 +244,11 @@ ABIAnalysesResults analyzeOutlinedFunction(Function *F,
   namespace DRVOFC = DeadReturnValuesOfFunctionCall;
   namespace URVOF = UsedReturnValuesOfFunction;
 
-  ABIAnalysesResults FinalResults;
   PartialAnalysisResults Results;
+  CFGNumberings Numberings;
 
-  // Initial population of partial results
-  Results.UAOF = UAOF::analyze(&F->getEntryBlock(), GCBI);
-  Results.DRAOF = DRAOF::analyze(&F->getEntryBlock(), GCBI);
+  Results.UAOF = UAOF::analyze(&F->getEntryBlock(), GCBI, Numberings);
+  Results.DRAOF = DRAOF::analyze(&F->getEntryBlock(), GCBI, Numberings);
   for (auto &I : instructions(F)) {
     BasicBlock *BB = I.getParent();
 
@@ -253,16 +259,133 @@ ABIAnalysesResults analyzeOutlinedFunction(Function *F,
         PC = MetaAddress::fromConstant(Call->getArgOperand(0));
 
       if (isCallTo(Call, PreCallSiteHook)) {
-        Results.RAOFC[{ PC, BB }] = RAOFC::analyze(BB, GCBI);
+        Results.RAOFC[{ PC, BB }] = RAOFC::analyze(BB, GCBI, Numberings);
       } else if (isCallTo(Call, PostCallSiteHook)) {
-        Results.URVOFC[{ PC, BB }] = URVOFC::analyze(BB, GCBI);
-        Results.DRVOFC[{ PC, BB }] = DRVOFC::analyze(BB, GCBI);
+        Results.URVOFC[{ PC, BB }] = URVOFC::analyze(BB, GCBI, Numberings);
+        Results.DRVOFC[{ PC, BB }] = DRVOFC::analyze(BB, GCBI, Numberings);
       } else if (isCallTo(Call, RetHook)) {
-        Results.URVOF[{ PC, BB }] = URVOF::analyze(BB, GCBI);
+        Results.URVOF[{ PC, BB }] = URVOF::analyze(BB, GCBI, Numberings);
       }
     }
   }
 
+  return Results;
+}
+
+template<bool IsForward, typename... CoreLattices>
+static auto runFused(const ClassifiedInstructions &Instructions,
+                     CFGNumberings &Numberings,
+                     const BasicBlock *Start,
+                     const Instruction *CallSite,
+                     const GeneratedCodeBasicInfo &GCBI) {
+  using MFI = FusedMFIAnalysis<IsForward, CoreLattices...>;
+  using LatticeElement = typename MFI::LatticeElement;
+
+  MFI Instance{ { CallSite, GCBI }, &Instructions };
+  LatticeElement InitialValue;
+  LatticeElement ExtremalValue(
+    RegistersLattice<CoreLattices>(CoreLattices::ExtremalLatticeElement)...);
+  return MFP::getMaximalFixedPoint<MFI>(Instance,
+                                        Numberings.get<IsForward>(Start),
+                                        InitialValue,
+                                        ExtremalValue,
+                                        { Start });
+}
+
+// Run together the ABI analyses that share direction and starting point,
+// classifying the instructions of F only once. The results are the same as
+// analyzeSeparately.
+static PartialAnalysisResults analyzeFused(Function *F,
+                                           const GeneratedCodeBasicInfo &GCBI,
+                                           Function *PreCallSiteHook,
+                                           Function *PostCallSiteHook,
+                                           Function *RetHook) {
+  namespace UAOF = UsedArgumentsOfFunction;
+  namespace DRAOF = DeadRegisterArgumentsOfFunction;
+  namespace RAOFC = RegisterArgumentsOfFunctionCall;
+  namespace URVOFC = UsedReturnValuesOfFunctionCall;
+  namespace DRVOFC = DeadReturnValuesOfFunctionCall;
+  namespace URVOF = UsedReturnValuesOfFunction;
+
+  PartialAnalysisResults Results;
+  ClassifiedInstructions Instructions(*F, GCBI);
+  CFGNumberings Numberings;
+  auto Registers = Instructions.getRegisters();
+
+  {
+    const BasicBlock *Entry = &F->getEntryBlock();
+    auto Fixpoint = runFused<true, UAOF::CoreLattice, DRAOF::CoreLattice>(
+      Instructions, Numberings, Entry, nullptr, GCBI);
+    Results.UAOF = UAOF::summarize(Registers, getOutValues<0>(Fixpoint));
+    Results.DRAOF = DRAOF::summarize(Registers, getOutValues<1>(Fixpoint));
+  }
+
+  for (auto &I : instructions(F)) {
+    BasicBlock *BB = I.getParent();
+
+    auto *Call = dyn_cast<CallInst>(&I);
+    if (Call == nullptr)
+      continue;
+
+    if (isCallTo(Call, PreCallSiteHook)) {
+      MetaAddress PC = MetaAddress::fromConstant(Call->getArgOperand(0));
+      const BasicBlock *Start = BB->getUniquePredecessor();
+      auto Fixpoint = runFused<false, RAOFC::CoreLattice>(
+        Instructions, Numberings, Start, getPostCallHook(BB), GCBI);
+      Results.RAOFC[{ PC, BB }] = RAOFC::summarize(Registers,
+                                                   getOutValues<0>(Fixpoint));
+    } else if (isCallTo(Call, PostCallSiteHook)) {
+      MetaAddress PC = MetaAddress::fromConstant(Call->getArgOperand(0));
+      auto &URVOFCResult = Results.URVOFC[{ PC, BB }];
+      auto &DRVOFCResult = Results.DRVOFC[{ PC, BB }];
+      const BasicBlock *Start = BB->getUniqueSuccessor();
+      if (Start == nullptr)
+        continue;
+
+      using URVOFCLattice = URVOFC::CoreLattice;
+      using DRVOFCLattice = DRVOFC::CoreLattice;
+      auto Fixpoint = runFused<true, URVOFCLattice, DRVOFCLattice>(
+        Instructions, Numberings, Start, getPreCallHook(BB), GCBI);
+      URVOFCResult = URVOFC::summarize(Registers, getOutValues<0>(Fixpoint));
+      DRVOFCResult = DRVOFC::summarize(Registers, getOutValues<1>(Fixpoint));
+    } else if (isCallTo(Call, RetHook)) {
+      MetaAddress PC = MetaAddress::fromConstant(Call->getArgOperand(0));
+      auto Fixpoint = runFused<false, URVOF::CoreLattice>(Instructions,
+                                                          Numberings,
+                                                          BB,
+                                                          nullptr,
+                                                          GCBI);
+      Results.URVOF[{ PC, BB }] = URVOF::summarize(Registers,
+                                                   getOutValues<0>(Fixpoint));
+    }
+  }
+
+  return Results;
+}
+
+// Run the ABI analyses on the outlined function F. This function must have all
+// the original function calls replaced with a basic block starting with a call
+// to `precall_hook` followed by a summary of the side effects of the function
+// followed by a call to `postcall_hook` and a basic block terminating
+// instruction.
+ABIAnalysesResults analyzeOutlinedFunction(Function *F,
+                                           const GeneratedCodeBasicInfo &GCBI,
+                                           Function *PreCallSiteHook,
+                                           Function *PostCallSiteHook,
+                                           Function *RetHook) {
+  ABIAnalysesResults FinalResults;
+  PartialAnalysisResults Results;
+
+  // Initial population of partial results
+  if (FuseABIAnalyses)
+    Results = analyzeFused(F, GCBI, PreCallSiteHook, PostCallSiteHook, RetHook);
+  else
+    Results = analyzeSeparately(F,
+                                GCBI,
+                                PreCallSiteHook,
+                                PostCallSiteHook,
+                                RetHook);
+
   if (ABIAnalysesLog.isEnabled()) {
     ABIAnalysesLog << "Dumping ABIAnalyses results for function "
                    << F->getName() << ": \n";
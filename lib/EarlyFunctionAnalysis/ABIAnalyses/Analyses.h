@@ -16,11 +16,21 @@
 
 namespace ABIAnalyses {
 
+// Each analysis provides `analyze`, which runs it on its own, and `summarize`,
+// which computes its results from the OutValue of each basic block, so that it
+// can also be run together with other analyses (see FusedMFIAnalysis).
+
 namespace DeadRegisterArgumentsOfFunction {
 using namespace llvm;
 
 std::map<const GlobalVariable *, abi::RegisterState::Values>
-analyze(const BasicBlock *FunctionEntry, const GeneratedCodeBasicInfo &GCBI);
+analyze(const BasicBlock *FunctionEntry,
+        const GeneratedCodeBasicInfo &GCBI,
+        CFGNumberings &Numberings);
+
+std::map<const GlobalVariable *, abi::RegisterState::Values>
+summarize(ArrayRef<GlobalVariable *> Registers,
+          ArrayRef<const RegistersLattice<CoreLattice> *> OutValues);
 
 } // namespace DeadRegisterArgumentsOfFunction
 
@@ -28,7 +38,13 @@ namespace DeadReturnValuesOfFunctionCall {
 using namespace llvm;
 
 std::map<const GlobalVariable *, abi::RegisterState::Values>
-analyze(const BasicBlock *CallSiteBlock, const GeneratedCodeBasicInfo &GCBI);
+analyze(const BasicBlock *CallSiteBlock,
+        const GeneratedCodeBasicInfo &GCBI,
+        CFGNumberings &Numberings);
+
+std::map<const GlobalVariable *, abi::RegisterState::Values>
+summarize(ArrayRef<GlobalVariable *> Registers,
+          ArrayRef<const RegistersLattice<CoreLattice> *> OutValues);
 
 } // namespace DeadReturnValuesOfFunctionCall
 
@@ -36,7 +52,13 @@ namespace RegisterArgumentsOfFunctionCall {
 using namespace llvm;
 
 std::map<const GlobalVariable *, abi::RegisterState::Values>
-analyze(const BasicBlock *CallSiteBlock, const GeneratedCodeBasicInfo &GCBI);
+analyze(const BasicBlock *CallSiteBlock,
+        const GeneratedCodeBasicInfo &GCBI,
+        CFGNumberings &Numberings);
+
+std::map<const GlobalVariable *, abi::RegisterState::Values>
+summarize(ArrayRef<GlobalVariable *> Registers,
+          ArrayRef<const RegistersLattice<CoreLattice> *> OutValues);
 
 } // namespace RegisterArgumentsOfFunctionCall
 
@@ -44,7 +66,13 @@ namespace UsedArgumentsOfFunction {
 using namespace llvm;
 
 std::map<const GlobalVariable *, abi::RegisterState::Values>
-analyze(const BasicBlock *FunctionEntry, const GeneratedCodeBasicInfo &GCBI);
+analyze(const BasicBlock *FunctionEntry,
+        const GeneratedCodeBasicInfo &GCBI,
+        CFGNumberings &Numberings);
+
+std::map<const GlobalVariable *, abi::RegisterState::Values>
+summarize(ArrayRef<GlobalVariable *> Registers,
+          ArrayRef<const RegistersLattice<CoreLattice> *> OutValues);
 
 } // namespace UsedArgumentsOfFunction
 
@@ -52,14 +80,26 @@ namespace UsedReturnValuesOfFunction {
 using namespace llvm;
 
 std::map<const GlobalVariable *, abi::RegisterState::Values>
-analyze(const BasicBlock *ReturnBlock, const GeneratedCodeBasicInfo &GCBI);
+analyze(const BasicBlock *ReturnBlock,
+        const GeneratedCodeBasicInfo &GCBI,
+        CFGNumberings &Numberings);
+
+std::map<const GlobalVariable *, abi::RegisterState::Values>
+summarize(ArrayRef<GlobalVariable *> Registers,
+          ArrayRef<const RegistersLattice<CoreLattice> *> OutValues);
 } // namespace UsedReturnValuesOfFunction
 
 namespace UsedReturnValuesOfFunctionCall {
 using namespace llvm;
 
 std::map<const GlobalVariable *, abi::RegisterState::Values>
-analyze(const BasicBlock *CallSiteBlock, const GeneratedCodeBasicInfo &GCBI);
+analyze(const BasicBlock *CallSiteBlock,
+        const GeneratedCodeBasicInfo &GCBI,
+        CFGNumberings &Numberings);
+
+std::map<const GlobalVariable *, abi::RegisterState::Values>
+summarize(ArrayRef<GlobalVariable *> Registers,
+          ArrayRef<const RegistersLattice<CoreLattice> *> OutValues);
 } // namespace UsedReturnValuesOfFunctionCall
 
 } // namespace ABIAnalyses
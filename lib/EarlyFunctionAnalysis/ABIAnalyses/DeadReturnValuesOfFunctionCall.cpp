@@ -2,6 +2,7 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/GraphTraits.h"
 #include "llvm/ADT/SmallVector.h"
@@ -23,28 +24,12 @@ using namespace llvm;
 using namespace ABIAnalyses;
 
 std::map<const GlobalVariable *, State>
-analyze(const BasicBlock *CallSiteBlock, const GeneratedCodeBasicInfo &GCBI) {
-  using MFI = MFIAnalysis<true, CoreLattice>;
-
+summarize(ArrayRef<GlobalVariable *> Registers,
+          ArrayRef<const RegistersLattice<CoreLattice> *> OutValues) {
   std::map<const GlobalVariable *, State> RegNoOrDead{};
-  MFI Instance{ { getPreCallHook(CallSiteBlock), GCBI } };
-  MFI::LatticeElement InitialValue;
-  MFI::LatticeElement ExtremalValue(CoreLattice::ExtremalLatticeElement);
-  auto *Start = CallSiteBlock->getUniqueSuccessor();
 
-  if (!Start)
-    return RegNoOrDead;
-
-  auto
-    Results = MFP::getMaximalFixedPoint<MFI, MFI::GT, MFI::LGT>(Instance,
-                                                                Start,
-                                                                InitialValue,
-                                                                ExtremalValue,
-                                                                { Start },
-                                                                { Start });
-
-  for (auto &[BB, Result] : Results) {
-    for (auto &[GV, RegState] : Result.OutValue) {
+  for (const auto *OutValue : OutValues) {
+    for (auto [GV, RegState] : OutValue->entries(Registers)) {
       if (RegState == CoreLattice::NoOrDead) {
         RegNoOrDead[GV] = State::NoOrDead;
       }
@@ -52,4 +37,28 @@ analyze(const BasicBlock *CallSiteBlock, const GeneratedCodeBasicInfo &GCBI) {
   }
   return RegNoOrDead;
 }
+
+std::map<const GlobalVariable *, State>
+analyze(const BasicBlock *CallSiteBlock,
+        const GeneratedCodeBasicInfo &GCBI,
+        CFGNumberings &Numberings) {
+  using MFI = MFIAnalysis<true, CoreLattice>;
+
+  MFI Instance{ { getPreCallHook(CallSiteBlock), GCBI } };
+  MFI::LatticeElement InitialValue;
+  MFI::LatticeElement ExtremalValue(CoreLattice::ExtremalLatticeElement);
+  auto *Start = CallSiteBlock->getUniqueSuccessor();
+
+  if (!Start)
+    return {};
+
+  const auto &Numbering = Numberings.get<true>(Start);
+  auto Results = MFP::getMaximalFixedPoint<MFI>(Instance,
+                                                Numbering,
+                                                InitialValue,
+                                                ExtremalValue,
+                                                { Start });
+
+  return summarize(Instance.getRegisters(), getOutValues(Results));
+}
 } // namespace ABIAnalyses::DeadReturnValuesOfFunctionCall
@@ -2,6 +2,7 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/GraphTraits.h"
@@ -23,35 +24,21 @@ using namespace llvm;
 using namespace ABIAnalyses;
 
 std::map<const GlobalVariable *, State>
-analyze(const BasicBlock *CallSiteBlock, const GeneratedCodeBasicInfo &GCBI) {
-  using MFI = MFIAnalysis<false, CoreLattice>;
-
-  MFI Instance{ { getPostCallHook(CallSiteBlock), GCBI } };
-  MFI::LatticeElement InitialValue;
-  MFI::LatticeElement ExtremalValue(CoreLattice::ExtremalLatticeElement);
-
-  auto *Start = CallSiteBlock->getUniquePredecessor();
-  auto
-    Results = MFP::getMaximalFixedPoint<MFI, MFI::GT, MFI::LGT>(Instance,
-                                                                Start,
-                                                                InitialValue,
-                                                                ExtremalValue,
-                                                                { Start },
-                                                                { Start });
-
+summarize(ArrayRef<GlobalVariable *> Registers,
+          ArrayRef<const RegistersLattice<CoreLattice> *> OutValues) {
   DenseSet<const GlobalVariable *> RegUnknown{};
   std::map<const GlobalVariable *, State> RegYes{};
 
-  for (auto &[BB, Result] : Results) {
-    for (auto &[GV, RegState] : Result.OutValue) {
+  for (const auto *OutValue : OutValues) {
+    for (auto [GV, RegState] : OutValue->entries(Registers)) {
       if (RegState == CoreLattice::Unknown) {
         RegUnknown.insert(GV);
       }
     }
   }
 
-  for (auto &[BB, Result] : Results) {
-    for (auto &[GV, RegState] : Result.OutValue) {
+  for (const auto *OutValue : OutValues) {
+    for (auto [GV, RegState] : OutValue->entries(Registers)) {
       if (RegState == CoreLattice::Yes && RegUnknown.count(GV) == 0) {
         RegYes[GV] = State::Yes;
       }
@@ -60,4 +47,25 @@ analyze(const BasicBlock *CallSiteBlock, const GeneratedCodeBasicInfo &GCBI) {
 
   return RegYes;
 }
+
+std::map<const GlobalVariable *, State>
+analyze(const BasicBlock *CallSiteBlock,
+        const GeneratedCodeBasicInfo &GCBI,
+        CFGNumberings &Numberings) {
+  using MFI = MFIAnalysis<false, CoreLattice>;
+
+  MFI Instance{ { getPostCallHook(CallSiteBlock), GCBI } };
+  MFI::LatticeElement InitialValue;
+  MFI::LatticeElement ExtremalValue(CoreLattice::ExtremalLatticeElement);
+
+  auto *Start = CallSiteBlock->getUniquePredecessor();
+  const auto &Numbering = Numberings.get<false>(Start);
+  auto Results = MFP::getMaximalFixedPoint<MFI>(Instance,
+                                                Numbering,
+                                                InitialValue,
+                                                ExtremalValue,
+                                                { Start });
+
+  return summarize(Instance.getRegisters(), getOutValues(Results));
+}
 } // namespace ABIAnalyses::RegisterArgumentsOfFunctionCall
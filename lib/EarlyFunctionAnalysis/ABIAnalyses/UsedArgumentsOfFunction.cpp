@@ -2,6 +2,7 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/GraphTraits.h"
 #include "llvm/ADT/SmallVector.h"
@@ -22,24 +23,12 @@ using namespace llvm;
 using namespace ABIAnalyses;
 
 std::map<const GlobalVariable *, State>
-analyze(const BasicBlock *FunctionEntry, const GeneratedCodeBasicInfo &GCBI) {
-  using MFI = MFIAnalysis<true, CoreLattice>;
-  MFI Instance{ { GCBI } };
-  MFI::LatticeElement InitialValue;
-  MFI::LatticeElement ExtremalValue(CoreLattice::ExtremalLatticeElement);
-
-  auto
-    Res = MFP::getMaximalFixedPoint<MFI, MFI::GT, MFI::LGT>(Instance,
-                                                            FunctionEntry,
-                                                            InitialValue,
-                                                            ExtremalValue,
-                                                            { FunctionEntry },
-                                                            { FunctionEntry });
-
+summarize(ArrayRef<GlobalVariable *> Registers,
+          ArrayRef<const RegistersLattice<CoreLattice> *> OutValues) {
   std::map<const GlobalVariable *, State> RegYes{};
 
-  for (auto &[BB, Result] : Res) {
-    for (auto &[GV, RegState] : Result.OutValue) {
+  for (const auto *OutValue : OutValues) {
+    for (auto [GV, RegState] : OutValue->entries(Registers)) {
       if (RegState == CoreLattice::Yes) {
         RegYes[GV] = State::Yes;
       }
@@ -48,4 +37,23 @@ analyze(const BasicBlock *FunctionEntry, const GeneratedCodeBasicInfo &GCBI) {
 
   return RegYes;
 }
+
+std::map<const GlobalVariable *, State>
+analyze(const BasicBlock *FunctionEntry,
+        const GeneratedCodeBasicInfo &GCBI,
+        CFGNumberings &Numberings) {
+  using MFI = MFIAnalysis<true, CoreLattice>;
+  MFI Instance{ { GCBI } };
+  MFI::LatticeElement InitialValue;
+  MFI::LatticeElement ExtremalValue(CoreLattice::ExtremalLatticeElement);
+
+  const auto &Numbering = Numberings.get<true>(FunctionEntry);
+  auto Res = MFP::getMaximalFixedPoint<MFI>(Instance,
+                                            Numbering,
+                                            InitialValue,
+                                            ExtremalValue,
+                                            { FunctionEntry });
+
+  return summarize(Instance.getRegisters(), getOutValues(Res));
+}
 } // namespace ABIAnalyses::UsedArgumentsOfFunction
@@ -2,6 +2,7 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/GraphTraits.h"
 #include "llvm/ADT/SmallVector.h"
@@ -22,33 +23,21 @@ using namespace llvm;
 using namespace ABIAnalyses;
 
 std::map<const GlobalVariable *, State>
-analyze(const BasicBlock *ReturnBlock, const GeneratedCodeBasicInfo &GCBI) {
-  using MFI = MFIAnalysis<false, CoreLattice>;
-
-  MFI Instance{ { GCBI } };
-  MFI::LatticeElement InitialValue;
-  MFI::LatticeElement ExtremalValue(CoreLattice::ExtremalLatticeElement);
-
-  auto Res = MFP::getMaximalFixedPoint<MFI, MFI::GT, MFI::LGT>(Instance,
-                                                               ReturnBlock,
-                                                               InitialValue,
-                                                               ExtremalValue,
-                                                               { ReturnBlock },
-                                                               { ReturnBlock });
-
+summarize(ArrayRef<GlobalVariable *> Registers,
+          ArrayRef<const RegistersLattice<CoreLattice> *> OutValues) {
   DenseSet<const GlobalVariable *> RegUnknown{};
   std::map<const GlobalVariable *, State> RegYesOrDead{};
 
-  for (auto &[BB, Result] : Res) {
-    for (auto &[GV, RegState] : Result.OutValue) {
+  for (const auto *OutValue : OutValues) {
+    for (auto [GV, RegState] : OutValue->entries(Registers)) {
       if (RegState == CoreLattice::Unknown) {
         RegUnknown.insert(GV);
       }
     }
   }
 
-  for (auto &[BB, Result] : Res) {
-    for (auto &[GV, RegState] : Result.OutValue) {
+  for (const auto *OutValue : OutValues) {
+    for (auto [GV, RegState] : OutValue->entries(Registers)) {
       if (RegState == CoreLattice::YesOrDead && RegUnknown.count(GV) == 0) {
         RegYesOrDead[GV] = State::YesOrDead;
       }
@@ -57,4 +46,24 @@ analyze(const BasicBlock *ReturnBlock, const GeneratedCodeBasicInfo &GCBI) {
 
   return RegYesOrDead;
 }
+
+std::map<const GlobalVariable *, State>
+analyze(const BasicBlock *ReturnBlock,
+        const GeneratedCodeBasicInfo &GCBI,
+        CFGNumberings &Numberings) {
+  using MFI = MFIAnalysis<false, CoreLattice>;
+
+  MFI Instance{ { GCBI } };
+  MFI::LatticeElement InitialValue;
+  MFI::LatticeElement ExtremalValue(CoreLattice::ExtremalLatticeElement);
+
+  const auto &Numbering = Numberings.get<false>(ReturnBlock);
+  auto Res = MFP::getMaximalFixedPoint<MFI>(Instance,
+                                            Numbering,
+                                            InitialValue,
+                                            ExtremalValue,
+                                            { ReturnBlock });
+
+  return summarize(Instance.getRegisters(), getOutValues(Res));
+}
 } // namespace ABIAnalyses::UsedReturnValuesOfFunction
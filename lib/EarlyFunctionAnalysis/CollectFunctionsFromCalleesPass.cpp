@@ -8,6 +8,7 @@
 #include "llvm/IR/Module.h"
 
 #include "revng/EarlyFunctionAnalysis/CollectFunctionsFromCalleesPass.h"
+#include "revng/FunctionCallIdentification/FunctionCallIdentification.h"
 
 using namespace llvm;
 
@@ -28,25 +29,34 @@ static void collectFunctionsFromCallees(Module &M,
 
   // Static symbols have already been registered during lifting phase. Now
   // register all the other candidate entry points.
-  for (BasicBlock &BB : Root) {
-    if (getType(&BB) != BlockType::JumpTargetBlock)
+  //
+  // Callees are only ever registered as such from the calls to function_call,
+  // so we visit the call sites instead of the whole root function.
+  for (CallInst *Call : getFunctionCallMarkers(Root)) {
+    // Ignore indirect calls
+    auto *CalleeAddress = dyn_cast<BlockAddress>(Call->getArgOperand(0));
+    if (CalleeAddress == nullptr)
       continue;
 
-    MetaAddress Entry = GCBI.getJumpTarget(&BB);
+    BasicBlock *BB = CalleeAddress->getBasicBlock();
+    if (getType(BB) != BlockType::JumpTargetBlock)
+      continue;
+
+    MetaAddress Entry = GCBI.getJumpTarget(BB);
     if (Binary.Functions.find(Entry) != Binary.Functions.end())
       continue;
 
     // Do not consider dynamic functions (e.g., PLT entries), they are imported
     // directly from EarlyFunctionAnalysis.
-    if (not getDynamicSymbol(&BB).empty())
+    if (not getDynamicSymbol(BB).empty())
       continue;
 
-    uint32_t Reasons = GCBI.getJTReasons(&BB);
+    uint32_t Reasons = GCBI.getJTReasons(BB);
     bool IsCallee = hasReason(Reasons, JTReason::Callee);
 
     if (IsCallee) {
       Binary.Functions[Entry].Type = model::FunctionType::Invalid;
-      revng_log(Log, "Found function from callee: " << BB.getName().str());
+      revng_log(Log, "Found function from callee: " << BB->getName().str());
     }
   }
 }
@@ -5,6 +5,10 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <algorithm>
+#include <vector>
+
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/IR/Module.h"
 
 #include "revng/EarlyFunctionAnalysis/CollectFunctionsFromUnusedAddressesPass.h"
@@ -38,7 +42,8 @@ private:
   llvm::Module &M;
   GeneratedCodeBasicInfo &GCBI;
   model::Binary &Binary;
-  SortedVector<MetaAddress> VisitedBlocks;
+  /// Start addresses of the blocks of the known CFGs, sorted and unique
+  std::vector<MetaAddress> VisitedBlocks;
 };
 
 void CFFUAImpl::loadAllCFGs() {
@@ -55,14 +60,22 @@ void CFFUAImpl::loadAllCFGs() {
 
     efa::FunctionMetadata FM = *extractFunctionMetadata(Entry).get();
     for (const efa::BasicBlock &Block : FM.ControlFlowGraph)
-      VisitedBlocks.insert(Block.Start);
+      VisitedBlocks.push_back(Block.Start);
   }
+
+  // Sort once at the end, inserting in a sorted container would be quadratic
+  llvm::sort(VisitedBlocks);
+  auto Last = std::unique(VisitedBlocks.begin(), VisitedBlocks.end());
+  VisitedBlocks.erase(Last, VisitedBlocks.end());
 }
 
 void CFFUAImpl::collectFunctionsFromUnusedAddresses() {
   using namespace llvm;
   Function &Root = *M.getFunction("root");
 
+  // Record the new functions at the end, one by one insertions would be
+  // quadratic
+  std::vector<MetaAddress> NewFunctions;
   for (BasicBlock &BB : Root) {
     if (getType(&BB) != BlockType::JumpTargetBlock)
       continue;
@@ -82,7 +95,9 @@ void CFFUAImpl::collectFunctionsFromUnusedAddresses() {
     bool IsPCStore = hasReason(Reasons, JTReason::PCStore);
     bool IsReturnAddress = hasReason(Reasons, JTReason::ReturnAddress);
     bool IsLoadAddress = hasReason(Reasons, JTReason::LoadAddress);
-    bool IsNotPartOfOtherCFG = VisitedBlocks.count(Entry) == 0;
+    bool IsNotPartOfOtherCFG = not std::binary_search(VisitedBlocks.begin(),
+                                                      VisitedBlocks.end(),
+                                                      Entry);
 
     // Do not consider addresses found in .rodata that are part of jump
     // tables of a function.
@@ -94,11 +109,18 @@ void CFFUAImpl::collectFunctionsFromUnusedAddresses() {
       // Consider addresses found in global data that have not been used or
       // addresses that are not return addresses and do not end up in the PC
       // directly.
-      Binary.Functions[Entry].Type = model::FunctionType::Invalid;
+      NewFunctions.push_back(Entry);
       revng_log(Log,
                 "Found function from unused addresses: " << BB.getName().str());
     }
   }
+
+  auto Inserter = Binary.Functions.batch_insert();
+  for (const MetaAddress &Entry : NewFunctions) {
+    model::Function NewFunction(Entry);
+    NewFunction.Type = model::FunctionType::Invalid;
+    Inserter.insert(std::move(NewFunction));
+  }
 }
 
 void CFFUAImpl::run() {
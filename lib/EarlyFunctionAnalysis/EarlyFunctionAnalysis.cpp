@@ -4,22 +4,31 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <atomic>
 #include <climits>
 #include <cstdio>
 #include <fstream>
 #include <map>
+#include <set>
 #include <sstream>
 #include <vector>
 
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DepthFirstIterator.h"
 #include "llvm/ADT/PostOrderIterator.h"
 #include "llvm/ADT/SCCIterator.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/Twine.h"
 #include "llvm/Analysis/BasicAliasAnalysis.h"
 #include "llvm/Analysis/ScopedNoAliasAA.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
 #include "llvm/CodeGen/UnreachableBlockElim.h"
 #include "llvm/IR/Attributes.h"
 #include "llvm/IR/Constants.h"
+#include "llvm/IR/DebugInfo.h"
 #include "llvm/IR/Dominators.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/GlobalVariable.h"
@@ -30,6 +39,7 @@
 #include "llvm/IR/Value.h"
 #include "llvm/IR/Verifier.h"
 #include "llvm/Passes/PassBuilder.h"
+#include "llvm/Support/xxhash.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/InstCombine/InstCombine.h"
 #include "llvm/Transforms/Scalar/EarlyCSE.h"
@@ -41,7 +51,6 @@
 #include "llvm/Transforms/Utils.h"
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
 #include "llvm/Transforms/Utils/Cloning.h"
-#include "llvm/Transforms/Utils/CodeExtractor.h"
 #include "llvm/Transforms/Utils/Mem2Reg.h"
 
 #include "revng/ABI/FunctionType.h"
@@ -63,8 +72,12 @@
 #include "revng/Support/CommandLine.h"
 #include "revng/Support/IRHelpers.h"
 #include "revng/Support/MetaAddress.h"
+#include "revng/Support/ProfilingRegion.h"
+#include "revng/Support/SharedOutputFile.h"
+#include "revng/Support/TaskScheduler.h"
 
 #include "ABIAnalyses/ABIAnalysis.h"
+#include "FunctionSummaryCache.h"
 
 using llvm::ArrayRef;
 using llvm::BasicBlock;
@@ -142,6 +155,11 @@ static opt<std::string> AAWriterPath("aa-writer",
                                           "with annotated alias info."),
                                      value_desc("filename"));
 
+static opt<unsigned> EFAJobs("efa-jobs",
+                             desc("Number of tasks used to recover the CFG "
+                                  "of functions."),
+                             init(1));
+
 enum ABIEnforcementOption {
   NoABIEnforcement = 0,
   SoftABIEnforcement,
@@ -373,6 +391,137 @@ struct TemporaryOpaqueFunction {
 
 using BasicBlockQueue = UniquedQueue<BasicBlockNode *>;
 
+/// Worklist of function entry points scheduling the analysis bottom-up on the
+/// call graph.
+///
+/// Each node is ranked by its position in the sequence of strongly connected
+/// components of the call graph, callees first, and the pending node with the
+/// lowest rank is popped first. Hence, the functions of an SCC are analyzed
+/// once all the SCCs they call have reached a fixed point, and the summaries
+/// of their callees are final: a change can only make functions of the same
+/// SCC, or of SCCs not analyzed yet, pending again.
+class BottomUpWorklist {
+private:
+  std::vector<BasicBlockNode *> Nodes;
+  llvm::DenseMap<BasicBlockNode *, unsigned> Ranks;
+
+  /// The ranks of the pending nodes, ranks are dense
+  llvm::BitVector Pending;
+
+  /// No rank lower than this is pending
+  unsigned Lowest = 0;
+
+  size_t PendingCount = 0;
+
+public:
+  BottomUpWorklist() = default;
+
+  /// \param Root the node calling all the functions, which is not ranked
+  BottomUpWorklist(SmallCallGraph &CG, BasicBlockNode *Root) {
+    unsigned SCCs = 0;
+    for (auto It = llvm::scc_begin(&CG); !It.isAtEnd(); ++It) {
+      ++SCCs;
+      for (BasicBlockNode *Node : *It) {
+        if (Node == Root)
+          continue;
+        Ranks[Node] = Nodes.size();
+        Nodes.push_back(Node);
+      }
+    }
+    Pending.resize(Nodes.size());
+
+    revng_log(EarlyFunctionAnalysisLog,
+              "Scheduling " << Nodes.size() << " functions in " << SCCs
+                            << " SCCs");
+  }
+
+public:
+  void insert(BasicBlockNode *Node) {
+    auto It = Ranks.find(Node);
+    revng_assert(It != Ranks.end());
+    if (Pending.test(It->second))
+      return;
+
+    Pending.set(It->second);
+    ++PendingCount;
+    Lowest = std::min(Lowest, It->second);
+  }
+
+  bool empty() const { return PendingCount == 0; }
+
+  BasicBlockNode *pop() {
+    revng_assert(not empty());
+    int Rank = Pending.find_first_in(Lowest, Pending.size());
+    revng_assert(Rank >= 0);
+    Pending.reset(Rank);
+    --PendingCount;
+    Lowest = Rank + 1;
+    return Nodes[Rank];
+  }
+};
+
+/// Collect all the ABI registers, leave out the stack pointer for the moment.
+/// We will include it back later when refining ABI results.
+static std::vector<llvm::GlobalVariable *>
+collectABICSVs(GeneratedCodeBasicInfo &GCBI) {
+  std::vector<llvm::GlobalVariable *> ABICSVs;
+  for (GlobalVariable *CSV : GCBI.abiRegisters())
+    if (CSV != nullptr && !(GCBI.isSPReg(CSV)))
+      ABICSVs.emplace_back(CSV);
+  return ABICSVs;
+}
+
+/// Default-constructed cache summary for indirect calls
+static FunctionSummary
+createDefaultSummary(const model::Binary &Binary,
+                     ArrayRef<llvm::GlobalVariable *> ABICSVs) {
+  unsigned MinimalFSO;
+  {
+    using namespace model::Architecture;
+    MinimalFSO = getMinimalFinalStackOffset(Binary.Architecture);
+  }
+
+  return FunctionSummary(model::FunctionType::Values::Regular,
+                         { ABICSVs.begin(), ABICSVs.end() },
+                         ABIAnalyses::ABIAnalysesResults(),
+                         {},
+                         MinimalFSO,
+                         nullptr);
+}
+
+/// The pass and analysis managers optimizing the outlined functions. They are
+/// built once per analyzer, hence once per thread, and reused for all of its
+/// functions.
+struct OptimizationPipeline {
+  llvm::ModuleAnalysisManager MAM;
+  llvm::FunctionAnalysisManager FAM;
+  llvm::FunctionPassManager FPM;
+};
+
+/// The files the results are dumped to, if requested, shared by all the
+/// analyzers of a run. Each analyzer buffers its own output.
+struct EFADumps {
+  std::unique_ptr<SharedOutputFile> IBI;
+  std::unique_ptr<SharedOutputFile> AAWriter;
+
+  EFADumps(ArrayRef<GlobalVariable *> ABICSVs) {
+    if (IndirectBranchInfoSummaryPath.getNumOccurrences() == 1) {
+      IBI = std::make_unique<SharedOutputFile>(IndirectBranchInfoSummaryPath);
+
+      std::string Header;
+      raw_string_ostream Stream(Header);
+      Stream << "name,ra,fso,address";
+      for (const auto &Reg : ABICSVs)
+        Stream << "," << Reg->getName();
+      Stream << "\n";
+      IBI->append(Stream.str());
+    }
+
+    if (AAWriterPath.getNumOccurrences() == 1)
+      AAWriter = std::make_unique<SharedOutputFile>(AAWriterPath);
+  }
+};
+
 /// An intraprocedural analysis storage.
 ///
 /// Implementation of the intraprocedural stack analysis. It holds the
@@ -385,9 +534,10 @@ private:
   llvm::LLVMContext &Context;
   GeneratedCodeBasicInfo *GCBI;
   ArrayRef<GlobalVariable *> ABICSVs;
-  BasicBlockQueue *EntrypointsQueue;
+  BottomUpWorklist *EntrypointsQueue;
   FunctionAnalysisResults &Oracle;
   const TupleTree<model::Binary> &Binary;
+  EFADumps &Dumps;
   /// PreHookMarker and PostHookMarker mark the presence of an original
   /// function call, and surround a basic block containing the registers
   /// clobbered by the function called. They take the MetaAddress of the
@@ -399,20 +549,21 @@ private:
   /// block of fake functions need to be adjusted to jump to
   /// `unexpectedpc` of their caller.
   TemporaryOpaqueFunction UnexpectedPCMarker;
-  std::unique_ptr<raw_fd_ostream> OutputIBI;
-  std::unique_ptr<raw_fd_ostream> OutputAAWriter;
+  std::unique_ptr<BufferedOutputStream> OutputIBI;
+  std::unique_ptr<BufferedOutputStream> OutputAAWriter;
   OpaqueFunctionsPool<llvm::StringRef> RegistersClobberedPool;
   OpaqueFunctionsPool<llvm::Type *> OpaqueBranchConditionsPool;
-  const llvm::CodeExtractorAnalysisCache CEAC;
   const ProgramCounterHandler *PCH;
+  std::unique_ptr<OptimizationPipeline> Optimizer;
 
 public:
   FunctionEntrypointAnalyzer(llvm::Module &,
                              GeneratedCodeBasicInfo *GCBI,
                              ArrayRef<GlobalVariable *>,
-                             BasicBlockQueue *,
+                             BottomUpWorklist *,
                              FunctionAnalysisResults &,
-                             const TupleTree<model::Binary> &);
+                             const TupleTree<model::Binary> &,
+                             EFADumps &);
 
 public:
   void importModel();
@@ -420,7 +571,7 @@ public:
   void interproceduralPropagation();
   void finalizeModel(TupleTree<model::Binary> &);
   void applyABIDeductions();
-  void recoverCFG();
+  void recoverCFG(unsigned Jobs);
   void serializeFunctionMetadata();
 
 private:
@@ -429,6 +580,13 @@ private:
   /// reached. It is responsible for performing the whole computation.
   FunctionSummary analyze(llvm::BasicBlock *BB, bool ShouldAnalyzeABI);
 
+private:
+  void recoverCFG(ArrayRef<MetaAddress> Entries, unsigned Jobs);
+
+  /// \return a hash of everything the CFG recovered for the function at \p
+  ///         Entry depends upon, or std::nullopt if it cannot be cached
+  std::optional<uint64_t> getCFGCacheKey(MetaAddress Entry);
+
 private:
   OutlinedFunction outlineFunction(llvm::BasicBlock *BB);
   void integrateFunctionCallee(llvm::BasicBlock *BB, MetaAddress);
@@ -445,6 +603,7 @@ private:
   void opaqueBranchConditions(llvm::Function *F, llvm::IRBuilder<> &);
   void materializePCValues(llvm::Function *F, llvm::IRBuilder<> &);
   void runOptimizationPipeline(llvm::Function *F);
+  std::unique_ptr<OptimizationPipeline> createOptimizationPipeline();
   FunctionSummary milkInfo(OutlinedFunction *F,
                            SortedVector<efa::BasicBlock> &,
                            ABIAnalyses::ABIAnalysesResults &,
@@ -479,9 +638,10 @@ using FEA = FunctionEntrypointAnalyzer;
 FEA::FunctionEntrypointAnalyzer(llvm::Module &M,
                                 GeneratedCodeBasicInfo *GCBI,
                                 ArrayRef<GlobalVariable *> ABICSVs,
-                                BasicBlockQueue *EntrypointsQueue,
+                                BottomUpWorklist *EntrypointsQueue,
                                 FunctionAnalysisResults &Oracle,
-                                const TupleTree<model::Binary> &Binary) :
+                                const TupleTree<model::Binary> &Binary,
+                                EFADumps &Dumps) :
   M(M),
   Context(M.getContext()),
   GCBI(GCBI),
@@ -489,6 +649,7 @@ FEA::FunctionEntrypointAnalyzer(llvm::Module &M,
   EntrypointsQueue(EntrypointsQueue),
   Oracle(Oracle),
   Binary(Binary),
+  Dumps(Dumps),
   // Initialize hook markers for subsequent ABI analyses on function calls
   PreHookMarker(TOF(markerType(M), "precall_hook", &M)),
   PostHookMarker(TOF(markerType(M), "postcall_hook", &M)),
@@ -497,64 +658,45 @@ FEA::FunctionEntrypointAnalyzer(llvm::Module &M,
   UnexpectedPCMarker(TOF(unexpectedPCMarkerType(M), "unexpectedpc_hook", &M)),
   RegistersClobberedPool(&M, false),
   OpaqueBranchConditionsPool(&M, false),
-  // Initialize the cache for the `CodeExtractor` analysis on `root`
-  CEAC(llvm::CodeExtractorAnalysisCache(*M.getFunction("root"))),
   PCH(GCBI->programCounterHandler()) {
 
-  // Open streams for dumping results
-  if (IndirectBranchInfoSummaryPath.getNumOccurrences() == 1) {
-    std::ifstream File(IndirectBranchInfoSummaryPath.c_str());
-    if (File.is_open()) {
-      int Status = std::remove(IndirectBranchInfoSummaryPath.c_str());
-      revng_assert(Status == 0);
-    }
-
-    std::error_code EC;
-    OutputIBI = std::make_unique<raw_fd_ostream>(IndirectBranchInfoSummaryPath,
-                                                 EC,
-                                                 llvm::sys::fs::OF_Append);
-    revng_assert(!EC);
-
-    *OutputIBI << "name,ra,fso,address";
-    for (const auto &Reg : ABICSVs)
-      *OutputIBI << "," << Reg->getName();
-    *OutputIBI << "\n";
-  }
+  if (Dumps.IBI)
+    OutputIBI = std::make_unique<BufferedOutputStream>(*Dumps.IBI);
 
-  if (AAWriterPath.getNumOccurrences() == 1) {
-    std::ifstream File(AAWriterPath.c_str());
-    if (File.is_open()) {
-      int Status = std::remove(AAWriterPath.c_str());
-      revng_assert(Status == 0);
-    }
-
-    std::error_code EC;
-    OutputAAWriter = std::make_unique<raw_fd_ostream>(AAWriterPath,
-                                                      EC,
-                                                      llvm::sys::fs::OF_Append);
-    revng_assert(!EC);
-  }
+  if (Dumps.AAWriter)
+    OutputAAWriter = std::make_unique<BufferedOutputStream>(*Dumps.AAWriter);
 }
 
 void FunctionEntrypointAnalyzer::serializeFunctionMetadata() {
   using namespace llvm;
 
+  std::vector<efa::FunctionMetadata> Metadata;
   for (const auto &Function : Binary->Functions) {
     if (Function.Type == FunctionTypeValue::Invalid
         || Function.Type == FunctionTypeValue::Fake)
       continue;
 
-    auto &CFG = Oracle.at(Function.Entry).CFG;
-    BasicBlock *BB = GCBI->getBlockAt(Function.Entry);
+    efa::FunctionMetadata &FM = Metadata.emplace_back(Function.Entry);
+    for (efa::BasicBlock Edge : Oracle.at(Function.Entry).CFG)
+      FM.ControlFlowGraph.insert(Edge);
+  }
+
+  // Verify all the functions at once
+  std::vector<const efa::FunctionMetadata *> ToVerify;
+  for (const efa::FunctionMetadata &FM : Metadata)
+    ToVerify.push_back(&FM);
+  model::VerifyHelper VH(true);
+  efa::verifyFunctionsMetadata(*Binary, ToVerify, VH);
+
+  for (const efa::FunctionMetadata &FM : Metadata) {
+    BasicBlock *BB = GCBI->getBlockAt(FM.Entry);
+    // Use the binary encoding: metadata is decoded much more often than it's
+    // produced and it's not meant to be read by humans (see revng-efa-
+    // extractcfg)
     std::string Buffer;
     {
-      efa::FunctionMetadata FM(Function.Entry);
       raw_string_ostream Stream(Buffer);
-      for (efa::BasicBlock Edge : CFG)
-        FM.ControlFlowGraph.insert(Edge);
-
-      FM.verify(*Binary, true);
-      serialize(Stream, FM);
+      tupletree::binary::serialize(Stream, FM);
     }
 
     Instruction *Term = BB->getTerminator();
@@ -1341,6 +1483,10 @@ void FEA::materializePCValues(llvm::Function *F, llvm::IRBuilder<> &IRB) {
         MetaAddress NewPC = GCBI::getPCFromNewPC(Call);
         IRB.SetInsertPoint(Call);
         PCH->setPC(IRB, NewPC);
+      } else if (I.getMetadata(NewPCMDName) != nullptr) {
+        // The call to newpc has been turned into metadata by -superblocks
+        IRB.SetInsertPoint(&I);
+        PCH->setPC(IRB, getMetaAddressMetadata(&I, NewPCMDName));
       }
     }
   }
@@ -1364,81 +1510,109 @@ private:
   static constexpr const auto &Opt = getOption<T>;
 };
 
-void FunctionEntrypointAnalyzer::runOptimizationPipeline(llvm::Function *F) {
-  using namespace llvm;
-
-  // Some LLVM passes used later in the pipeline scan for cut-offs, meaning that
-  // further computation may not be done when they are reached; making some
-  // optimizations opportunities missed. Hence, we set the involved thresholds
-  // (e.g., the maximum value that MemorySSA uses to take into account
-  // stores/phis) to have initial unbounded value.
+/// Some LLVM passes used in the optimization pipeline scan for cut-offs,
+/// meaning that further computation may not be done when they are reached;
+/// making some optimizations opportunities missed. Hence, we set the involved
+/// thresholds (e.g., the maximum value that MemorySSA uses to take into account
+/// stores/phis) to have initial unbounded value.
+///
+/// Options are global: they are set once for the whole analysis, since
+/// functions might be optimized concurrently.
+struct UnboundedScanLimits {
+private:
   static constexpr const char *MemSSALimit = "memssa-check-limit";
   static constexpr const char *MemDepBlockLimit = "memdep-block-scan-limit";
 
   using TemporaryUOption = TemporaryOption<unsigned>;
-  TemporaryUOption MemSSALimitOption(MemSSALimit, UINT_MAX);
-  TemporaryUOption MemDepBlockLimitOption(MemDepBlockLimit, UINT_MAX);
+  TemporaryUOption MemSSALimitOption{ MemSSALimit, UINT_MAX };
+  TemporaryUOption MemDepBlockLimitOption{ MemDepBlockLimit, UINT_MAX };
+};
+
+void FunctionEntrypointAnalyzer::runOptimizationPipeline(llvm::Function *F) {
+  if (not Optimizer)
+    Optimizer = createOptimizationPipeline();
+
+  Optimizer->FPM.run(*F, Optimizer->FAM);
+
+  // The outlined function is going to be dropped, and its address might be
+  // reused by the next one: forget what has been computed upon it
+  Optimizer->FAM.clear(*F, F->getName());
+}
+
+std::unique_ptr<OptimizationPipeline>
+FunctionEntrypointAnalyzer::createOptimizationPipeline() {
+  using namespace llvm;
+
+  auto Result = std::make_unique<OptimizationPipeline>();
+  FunctionPassManager &FPM = Result->FPM;
 
   // TODO: break it down in the future, and check if some passes can be dropped
-  {
-    FunctionPassManager FPM;
-
-    // First stage: simplify the IR, promote the CSVs to local variables,
-    // compute subexpressions elimination and resolve redundant expressions in
-    // order to compute the stack height.
-    FPM.addPass(RemoveNewPCCallsPass());
-    FPM.addPass(RemoveHelperCallsPass());
-    FPM.addPass(PromoteGlobalToLocalPass());
-    FPM.addPass(SimplifyCFGPass());
-    FPM.addPass(SROA());
-    FPM.addPass(EarlyCSEPass(true));
-    FPM.addPass(JumpThreadingPass());
-    FPM.addPass(UnreachableBlockElimPass());
-    FPM.addPass(InstCombinePass(true));
-    FPM.addPass(EarlyCSEPass(true));
-    FPM.addPass(SimplifyCFGPass());
-    FPM.addPass(MergedLoadStoreMotionPass());
-    FPM.addPass(GVN());
-
-    // Second stage: add alias analysis info and canonicalize `i2p` + `add` into
-    // `getelementptr` instructions. Since the IR may change remarkably, another
-    // round of passes is necessary to take more optimization opportunities.
-    FPM.addPass(SegregateDirectStackAccessesPass());
-    FPM.addPass(EarlyCSEPass(true));
-    FPM.addPass(InstCombinePass(true));
-    FPM.addPass(GVN());
-
-    // Third stage: if enabled, serialize the results and dump the functions on
-    // disk with the alias information included as comments.
-    if (IndirectBranchInfoSummaryPath.getNumOccurrences() == 1)
-      FPM.addPass(IndirectBranchInfoPrinterPass(*OutputIBI));
 
-    if (AAWriterPath.getNumOccurrences() == 1)
-      FPM.addPass(AAWriterPass(*OutputAAWriter));
+  // First stage: simplify the IR, promote the CSVs to local variables,
+  // compute subexpressions elimination and resolve redundant expressions in
+  // order to compute the stack height.
+  FPM.addPass(RemoveNewPCCallsPass());
+  FPM.addPass(RemoveHelperCallsPass());
+  FPM.addPass(PromoteGlobalToLocalPass());
+  FPM.addPass(SimplifyCFGPass());
+  FPM.addPass(SROA());
+  FPM.addPass(EarlyCSEPass(true));
+  FPM.addPass(JumpThreadingPass());
+  FPM.addPass(UnreachableBlockElimPass());
+  FPM.addPass(InstCombinePass(true));
+  FPM.addPass(EarlyCSEPass(true));
+  FPM.addPass(SimplifyCFGPass());
+  FPM.addPass(MergedLoadStoreMotionPass());
+  FPM.addPass(GVN());
+
+  // Second stage: add alias analysis info and canonicalize `i2p` + `add` into
+  // `getelementptr` instructions. Since the IR may change remarkably, another
+  // round of passes is necessary to take more optimization opportunities.
+  FPM.addPass(SegregateDirectStackAccessesPass());
+  FPM.addPass(EarlyCSEPass(true));
+  FPM.addPass(InstCombinePass(true));
+  FPM.addPass(GVN());
+
+  // Third stage: if enabled, serialize the results and dump the functions on
+  // disk with the alias information included as comments.
+  if (OutputIBI)
+    FPM.addPass(IndirectBranchInfoPrinterPass(*OutputIBI));
+
+  if (OutputAAWriter)
+    FPM.addPass(AAWriterPass(*OutputAAWriter));
+
+  ModuleAnalysisManager &MAM = Result->MAM;
+  MAM.registerPass([this] {
+    using LMA = LoadModelAnalysis;
+    return LMA::fromModelWrapper(Binary);
+  });
+  MAM.registerPass([] { return GeneratedCodeBasicInfoAnalysis(); });
 
-    ModuleAnalysisManager MAM;
+  FunctionAnalysisManager &FAM = Result->FAM;
+  FAM.registerPass([] {
+    AAManager AA;
+    AA.registerFunctionAnalysis<BasicAA>();
+    AA.registerFunctionAnalysis<ScopedNoAliasAA>();
 
-    FunctionAnalysisManager FAM;
-    FAM.registerPass([] {
-      AAManager AA;
-      AA.registerFunctionAnalysis<BasicAA>();
-      AA.registerFunctionAnalysis<ScopedNoAliasAA>();
+    return AA;
+  });
+  FAM.registerPass([this] {
+    using LMA = LoadModelAnalysis;
+    return LMA::fromModelWrapper(Binary);
+  });
+  FAM.registerPass([] { return GeneratedCodeBasicInfoAnalysis(); });
+  FAM.registerPass([&MAM] { return ModuleAnalysisManagerFunctionProxy(MAM); });
 
-      return AA;
-    });
-    FAM.registerPass([this] {
-      using LMA = LoadModelAnalysis;
-      return LMA::fromModelWrapper(Binary);
-    });
-    FAM.registerPass([&] { return GeneratedCodeBasicInfoAnalysis(); });
-    FAM.registerPass([&] { return ModuleAnalysisManagerFunctionProxy(MAM); });
+  PassBuilder PB;
+  PB.registerFunctionAnalyses(FAM);
+  PB.registerModuleAnalyses(MAM);
 
-    PassBuilder PB;
-    PB.registerFunctionAnalyses(FAM);
-    PB.registerModuleAnalyses(MAM);
+  // Compute GCBI once for the whole module: the passes working on the
+  // outlined functions pick it up through the proxy, instead of computing it
+  // again for each of them
+  MAM.getResult<GeneratedCodeBasicInfoAnalysis>(M);
 
-    FPM.run(*F, FAM);
-  }
+  return Result;
 }
 
 llvm::Function *
@@ -1468,19 +1642,211 @@ FunctionEntrypointAnalyzer::createFakeFunction(llvm::BasicBlock *Entry) {
   return FakeFunction.extractFunction();
 }
 
-void FunctionEntrypointAnalyzer::recoverCFG() {
+/// Bump this whenever the CFG recovered by EFA changes for the same input
+static constexpr const char *CFGCacheVersion = "efa-cfg 1";
+
+std::optional<uint64_t> FEA::getCFGCacheKey(MetaAddress Entry) {
+  using namespace llvm;
+
+  std::string Buffer;
+  raw_string_ostream Stream(Buffer);
+  Stream << CFGCacheVersion << " " << static_cast<int>(Binary->Architecture)
+         << " " << static_cast<int>(Binary->DefaultABI) << "\n";
+
+  // Collect the code that might be part of the function, in the same way we
+  // build the call graph
+  std::vector<BasicBlock *> Blocks;
+  SmallPtrSet<BasicBlock *, 16> Visited;
+  SmallVector<BasicBlock *, 8> Worklist;
+  Worklist.push_back(GCBI->getBlockAt(Entry));
+  while (!Worklist.empty()) {
+    BasicBlock *Current = Worklist.pop_back_val();
+    if (!Visited.insert(Current).second)
+      continue;
+    Blocks.push_back(Current);
+
+    if (isFunctionCall(Current)) {
+      // Record what the analysis uses of the summary of the callee
+      if (BasicBlock *Callee = getFunctionCallCallee(Current)) {
+        MetaAddress PC = getBasicBlockPC(Callee);
+
+        // Fake functions are inlined in their callers
+        if (Oracle.isFakeFunction(PC))
+          return std::nullopt;
+
+        std::vector<StringRef> Clobbered;
+        for (GlobalVariable *CSV : Oracle.getRegistersClobbered(PC))
+          Clobbered.push_back(CSV->getName());
+        llvm::sort(Clobbered);
+
+        auto FSO = Oracle.getElectedFSO(PC);
+        Stream << "callee " << PC.toString() << " "
+               << static_cast<int>(Oracle.getFunctionType(PC)) << " "
+               << (FSO.has_value() ? static_cast<int64_t>(*FSO) : -1);
+        for (StringRef Name : Clobbered)
+          Stream << " " << Name;
+        Stream << "\n";
+      }
+
+      if (BasicBlock *Next = getFallthrough(Current))
+        Worklist.push_back(Next);
+    }
+
+    for (BasicBlock *Successor : successors(Current))
+      if (not isPartOfRootDispatcher(Successor))
+        Worklist.push_back(Successor);
+  }
+
+  // Hash the structure of the code, identifying instructions by their position
+  // rather than by their name, which depends on the rest of `root`
+  DenseMap<const Instruction *, unsigned> Positions;
+  for (BasicBlock *BB : Blocks)
+    for (Instruction &I : *BB)
+      Positions[&I] = Positions.size();
+
+  for (BasicBlock *BB : Blocks) {
+    Stream << BB->getName() << ":\n";
+    for (Instruction &I : *BB) {
+      Stream << I.getOpcodeName() << " ";
+      I.getType()->print(Stream);
+      if (auto *Compare = dyn_cast<CmpInst>(&I))
+        Stream << " " << CmpInst::getPredicateName(Compare->getPredicate());
+
+      for (const Use &Operand : I.operands()) {
+        Value *V = Operand.get();
+        Stream << ", ";
+        if (auto *OperandInstruction = dyn_cast<Instruction>(V)) {
+          auto It = Positions.find(OperandInstruction);
+          if (It != Positions.end())
+            Stream << "%" << It->second;
+          else
+            Stream << "%" << OperandInstruction->getParent()->getName() << "."
+                   << OperandInstruction->getOpcodeName();
+        } else if (auto *Block = dyn_cast<BasicBlock>(V)) {
+          Stream << "label " << Block->getName();
+        } else if (auto *Constant = dyn_cast<ConstantInt>(V)) {
+          Stream << Constant->getValue();
+        } else {
+          V->printAsOperand(Stream, true, &M);
+        }
+      }
+      Stream << "\n";
+    }
+  }
+
+  return xxHash64(Stream.str());
+}
+
+void FunctionEntrypointAnalyzer::recoverCFG(unsigned Jobs) {
+  FunctionSummaryCache Cache;
+
+  std::vector<MetaAddress> Entries;
+  std::vector<std::optional<uint64_t>> Keys;
+  unsigned Hits = 0;
   for (const auto &Function : Binary->Functions) {
     // No CFG will be recovered for `Fake` or `Invalid` functions
     if (Function.Type == FunctionTypeValue::Invalid
         || Function.Type == FunctionTypeValue::Fake)
       continue;
 
-    auto *Entry = GCBI->getBlockAt(Function.Entry);
+    std::optional<uint64_t> Key;
+    if (Cache.isEnabled())
+      Key = getCFGCacheKey(Function.Entry);
 
-    // Recover the control-flow graph of the function
-    auto &Summary = Oracle.at(Function.Entry);
-    Summary.CFG = std::move(analyze(Entry, false).CFG);
+    if (Key.has_value()) {
+      if (auto CFG = Cache.lookup(*Key, Function.Entry)) {
+        Oracle.at(Function.Entry).CFG = std::move(*CFG);
+        ++Hits;
+        continue;
+      }
+    }
+
+    Entries.push_back(Function.Entry);
+    Keys.push_back(Key);
   }
+
+  if (Cache.isEnabled())
+    revng_log(EarlyFunctionAnalysisLog,
+              "Reusing the cached CFG of " << Hits << " functions, analyzing "
+                                           << Entries.size());
+
+  // Recover the control-flow graph of the remaining functions
+  recoverCFG(Entries, Jobs);
+
+  for (size_t I = 0; I < Entries.size(); ++I)
+    if (Keys[I].has_value())
+      Cache.store(*Keys[I], Entries[I], Oracle.at(Entries[I]).CFG);
+}
+
+/// Recover the CFG of the functions at \p Entries using \p Jobs tasks.
+///
+/// The analysis of a function outlines it from `root` and optimizes the
+/// outlined copy, which never affects the analysis of other functions. Each
+/// task works on a copy of the module living in an LLVMContext of its own,
+/// with its own analyzer, and pulls the next function to analyze from a shared
+/// counter. The tasks run on the shared TaskScheduler, so no more than its
+/// threads run at the same time. The recovered CFGs do not reference the IR
+/// and are merged into the results at the end. The dumps, if any, are shared
+/// by all the tasks, in which case the order of the functions in them is
+/// unspecified.
+void FunctionEntrypointAnalyzer::recoverCFG(ArrayRef<MetaAddress> Entries,
+                                            unsigned Jobs) {
+  using namespace llvm;
+
+  if (Jobs <= 1 || Entries.size() <= 1) {
+    for (const MetaAddress &Entry : Entries) {
+      auto &Summary = Oracle.at(Entry);
+      Summary.CFG = std::move(analyze(GCBI->getBlockAt(Entry), false).CFG);
+    }
+    return;
+  }
+
+  SmallString<0> Bitcode;
+  {
+    raw_svector_ostream Stream(Bitcode);
+    WriteBitcodeToFile(M, Stream);
+  }
+
+  std::vector<SortedVector<efa::BasicBlock>> CFGs(Entries.size());
+  std::atomic<size_t> Next = 0;
+  auto Worker = [&]() {
+    LLVMContext WorkerContext;
+    MemoryBufferRef Buffer(Bitcode, M.getModuleIdentifier());
+    auto MaybeModule = parseBitcodeFile(Buffer, WorkerContext);
+    revng_assert(MaybeModule);
+    Module &WorkerModule = **MaybeModule;
+
+    GeneratedCodeBasicInfo WorkerGCBI(*Binary);
+    WorkerGCBI.run(WorkerModule);
+    auto WorkerABICSVs = collectABICSVs(WorkerGCBI);
+    FunctionAnalysisResults
+      WorkerOracle(createDefaultSummary(*Binary, WorkerABICSVs));
+    BottomUpWorklist WorkerQueue;
+    FEA WorkerAnalyzer(WorkerModule,
+                       &WorkerGCBI,
+                       WorkerABICSVs,
+                       &WorkerQueue,
+                       WorkerOracle,
+                       Binary,
+                       Dumps);
+    WorkerAnalyzer.importModel();
+
+    for (size_t I = Next++; I < Entries.size(); I = Next++) {
+      auto *Entry = WorkerGCBI.getBlockAt(Entries[I]);
+      CFGs[I] = std::move(WorkerAnalyzer.analyze(Entry, false).CFG);
+    }
+  };
+
+  {
+    unsigned Threads = std::min<size_t>(Jobs, Entries.size());
+    TaskGroup Group;
+    for (unsigned I = 0; I < Threads; ++I)
+      Group.spawn(Worker);
+    Group.wait();
+  }
+
+  for (size_t I = 0; I < Entries.size(); ++I)
+    Oracle.at(Entries[I]).CFG = std::move(CFGs[I]);
 }
 
 FunctionSummary
@@ -1488,6 +1854,8 @@ FunctionEntrypointAnalyzer::analyze(BasicBlock *Entry, bool ShouldAnalyzeABI) {
   using namespace llvm;
   using namespace ABIAnalyses;
 
+  ProfilingRegion Region("efa-analyze-function");
+
   IRBuilder<> Builder(M.getContext());
   ABIAnalysesResults ABIResults;
   SmallVector<Instruction *, 4> BranchesForIBI;
@@ -1883,6 +2251,37 @@ void FunctionEntrypointAnalyzer::integrateFunctionCallee(llvm::BasicBlock *BB,
   }
 }
 
+/// Copy to \p F, which contains part of the code of \p Root, the function
+/// attributes of \p Root that still hold, as the CodeExtractor would
+static void copyOutlinableAttributes(llvm::Function *Root, llvm::Function *F) {
+  using namespace llvm;
+
+  for (const Attribute &A : Root->getAttributes().getFnAttrs()) {
+    if (A.isEnumAttribute()) {
+      switch (A.getKindAsEnum()) {
+      case Attribute::AllocSize:
+      case Attribute::ArgMemOnly:
+      case Attribute::InaccessibleMemOnly:
+      case Attribute::InaccessibleMemOrArgMemOnly:
+      case Attribute::Naked:
+      case Attribute::NoReturn:
+      case Attribute::NoSync:
+      case Attribute::ReadNone:
+      case Attribute::ReadOnly:
+      case Attribute::ReturnsTwice:
+      case Attribute::Speculatable:
+      case Attribute::WillReturn:
+      case Attribute::WriteOnly:
+        continue;
+      default:
+        break;
+      }
+    }
+
+    F->addFnAttr(A);
+  }
+}
+
 OutlinedFunction
 FunctionEntrypointAnalyzer::outlineFunction(llvm::BasicBlock *Entry) {
   using namespace llvm;
@@ -1915,84 +2314,137 @@ FunctionEntrypointAnalyzer::outlineFunction(llvm::BasicBlock *Entry) {
     }
   }
 
-  // Create a copy of all the basic blocks to outline in `root`
-  ValueToValueMapTy VMap;
-  SmallVector<BasicBlock *, 8> BlocksToExtract;
+  // Clone the basic blocks to outline directly in a new function. This is
+  // equivalent to cloning them in `root` and extracting them, but churns
+  // neither `root` nor the CodeExtractor analyses on it.
+  auto *FTy = FunctionType::get(Type::getVoidTy(Context), false);
+  OutlinedFunction.F = Function::Create(FTy,
+                                        GlobalValue::InternalLinkage,
+                                        Root->getName() + "."
+                                          + Entry->getName() + "_cloned",
+                                        &M);
+  Function *F = OutlinedFunction.F;
+  copyOutlinableAttributes(Root, F);
 
-  auto *AnyPCBB = GCBI->anyPC();
-  auto *UnexpectedPCBB = GCBI->unexpectedPC();
+  // The entry block cannot have predecessors, while the entry of the function
+  // might be the target of a loop
+  auto *NewEntry = BasicBlock::Create(Context, "newFuncRoot", F);
 
+  ValueToValueMapTy VMap;
+  SmallVector<BasicBlock *, 8> BlocksToExtract;
   for (const auto &BB : BlocksToClone) {
-    BasicBlock *Cloned = CloneBasicBlock(BB, VMap, Twine("_cloned"), Root);
+    BasicBlock *Cloned = CloneBasicBlock(BB, VMap, Twine("_cloned"), F);
 
     VMap[BB] = Cloned;
     BlocksToExtract.emplace_back(Cloned);
   }
+  BranchInst::Create(cast<BasicBlock>(VMap[Entry]), NewEntry);
+
+  // Leaving the outlined blocks means returning from the function. Call-sites
+  // will branch to their fall-through instead.
+  BasicBlock *Return = nullptr;
+  auto GetReturn = [&]() {
+    if (Return == nullptr) {
+      Return = BasicBlock::Create(Context, "return", F);
+      ReturnInst::Create(Context, Return);
+    }
+    return Return;
+  };
+  for (BasicBlock *BB : BlocksToClone) {
+    if (isFunctionCall(BB))
+      continue;
+
+    for (BasicBlock *Successor : successors(BB))
+      if (VMap.count(Successor) == 0)
+        VMap[Successor] = GetReturn();
+  }
+
+  auto *AnyPCBB = GCBI->anyPC();
+  auto *UnexpectedPCBB = GCBI->unexpectedPC();
 
   auto AnyPCIt = VMap.find(AnyPCBB);
-  if (AnyPCIt != VMap.end())
+  if (AnyPCIt != VMap.end() && AnyPCIt->second != Return)
     OutlinedFunction.AnyPCCloned = cast<BasicBlock>(AnyPCIt->second);
 
   auto UnexpPCIt = VMap.find(UnexpectedPCBB);
-  if (UnexpPCIt != VMap.end())
+  if (UnexpPCIt != VMap.end() && UnexpPCIt->second != Return)
     OutlinedFunction.UnexpectedPCCloned = cast<BasicBlock>(UnexpPCIt->second);
 
-  remapInstructionsInBlocks(BlocksToExtract, VMap);
+  // Collect the callee and the fall-through of each call-site. The
+  // `function_call` markers reference them through blockaddresses, which
+  // cannot point into `root` from another function, drop them.
+  struct CallSite {
+    BasicBlock *Block;
+    MetaAddress Callee;
+    BasicBlock *Fallthrough;
+  };
+  SmallVector<CallSite, 8> CallSites;
+  PointerType *I8PtrTy = Type::getInt8PtrTy(Context);
+  Constant *I8NullPtr = ConstantPointerNull::get(I8PtrTy);
+  for (BasicBlock *BB : BlocksToExtract) {
+    if (not isFunctionCall(BB))
+      continue;
 
-  // Fix successor when encountering a call-site and fix fall-through in
-  // presence of a noreturn function.
-  std::map<llvm::CallInst *, MetaAddress> CallMap;
-  for (const auto &BB : BlocksToExtract) {
-    if (isFunctionCall(BB)) {
-      auto *Term = BB->getTerminator();
-      CallInst *CI = getFunctionCall(Term);
+    auto *Term = BB->getTerminator();
 
-      // If the function callee is null, we are dealing with an indirect call
-      MetaAddress PCCallee = MetaAddress::invalid();
-      if (BasicBlock *Next = getFunctionCallCallee(Term))
-        PCCallee = getBasicBlockPC(Next);
+    // If the function callee is null, we are dealing with an indirect call
+    MetaAddress PCCallee = MetaAddress::invalid();
+    if (BasicBlock *Next = getFunctionCallCallee(Term))
+      PCCallee = getBasicBlockPC(Next);
+    CallSites.push_back({ BB, PCCallee, getFallthrough(Term) });
 
-      auto CalleeType = Oracle.getFunctionType(PCCallee);
+    CallInst *CI = getFunctionCall(Term);
+    for (unsigned ArgNo = 0; ArgNo < CI->arg_size(); ++ArgNo)
+      if (isa<BlockAddress>(CI->getArgOperand(ArgNo)))
+        CI->setArgOperand(ArgNo, I8NullPtr);
+  }
 
-      if (CalleeType != FunctionTypeValue::NoReturn) {
-        auto *Br = BranchInst::Create(getFallthrough(Term));
-        ReplaceInstWithInst(Term, Br);
-      } else if (CalleeType == FunctionTypeValue::NoReturn) {
-        auto *Abort = CallInst::Create(M.getFunction("abort"));
-        new UnreachableInst(Term->getContext(), BB);
-        ReplaceInstWithInst(Term, Abort);
-      }
+  // Values defined outside of the outlined blocks would have been arguments of
+  // the extracted function: there must be none. The terminators of call-sites
+  // are replaced right after.
+  for (BasicBlock *BB : BlocksToExtract) {
+    Instruction *CallSiteTerminator = nullptr;
+    if (isFunctionCall(BB))
+      CallSiteTerminator = BB->getTerminator();
 
-      // To allow correct function extraction, there must not exist users of BBs
-      // to be extracted, so we destroy the blockaddress of the fall-through BB
-      // in the `function_call` marker.
-      unsigned ArgNo = 0;
-      PointerType *I8PtrTy = Type::getInt8PtrTy(M.getContext());
-      Constant *I8NullPtr = ConstantPointerNull::get(I8PtrTy);
-      for (Value *Arg : CI->args()) {
-        if (isa<BlockAddress>(Arg)) {
-          CI->setArgOperand(ArgNo, I8NullPtr);
-          if (Arg->use_empty())
-            cast<BlockAddress>(Arg)->destroyConstant();
-        }
-        ++ArgNo;
-      }
+    for (Instruction &I : *BB)
+      if (&I != CallSiteTerminator)
+        RemapInstruction(&I, VMap, RF_NoModuleLevelChanges);
+  }
 
-      CallMap.insert({ CI, PCCallee });
+  // Fix successor when encountering a call-site and fix fall-through in
+  // presence of a noreturn function.
+  std::map<llvm::CallInst *, MetaAddress> CallMap;
+  for (const CallSite &Site : CallSites) {
+    BasicBlock *BB = Site.Block;
+    auto *Term = BB->getTerminator();
+    CallInst *CI = getFunctionCall(Term);
+
+    auto CalleeType = Oracle.getFunctionType(Site.Callee);
+
+    if (CalleeType != FunctionTypeValue::NoReturn) {
+      // If the fall-through has not been outlined, leave the function
+      Value *MaybeFallthrough = VMap.lookup(Site.Fallthrough);
+      auto *Fallthrough = cast_or_null<BasicBlock>(MaybeFallthrough);
+      if (Fallthrough == nullptr)
+        Fallthrough = GetReturn();
+      auto *Br = BranchInst::Create(Fallthrough);
+      ReplaceInstWithInst(Term, Br);
+    } else if (CalleeType == FunctionTypeValue::NoReturn) {
+      auto *Abort = CallInst::Create(M.getFunction("abort"));
+      new UnreachableInst(Term->getContext(), BB);
+      ReplaceInstWithInst(Term, Abort);
     }
+
+    CallMap.insert({ CI, Site.Callee });
   }
 
-  // Extract outlined function
-  OutlinedFunction.F = CodeExtractor(BlocksToExtract).extractCodeRegion(CEAC);
+  // Cloned instructions still reference the debug info of `root`
+  if (Root->getSubprogram() != nullptr)
+    stripDebugInfo(*F);
 
-  revng_assert(OutlinedFunction.F != nullptr);
   revng_assert(OutlinedFunction.F->arg_size() == 0);
   revng_assert(OutlinedFunction.F->getReturnType()->isVoidTy());
-  revng_assert(OutlinedFunction.F->hasOneUser());
-
-  // Remove the only user (call to the outlined function) in `root`
-  auto It = OutlinedFunction.F->user_begin();
-  cast<Instruction>(*It)->getParent()->eraseFromParent();
 
   // Integrate function callee
   for (auto &BB : *OutlinedFunction.F) {
@@ -2147,9 +2599,9 @@ bool EarlyFunctionAnalysis<ShouldAnalyzeABI>::runOnModule(Module &M) {
   for (const auto &[_, Node] : BasicBlockNodeMap)
     RootNode->addSuccessor(Node);
 
-  // Create an over-approximated call graph of the program. A queue of all the
-  // function entrypoints is maintained.
-  BasicBlockQueue EntrypointsQueue;
+  // Create an over-approximated call graph of the program. A worklist of all
+  // the function entrypoints, scheduling them bottom-up, is maintained.
+  BottomUpWorklist EntrypointsQueue(CG, RootNode);
   for (auto *Node : llvm::post_order(&CG)) {
     if (Node == RootNode)
       continue;
@@ -2178,32 +2630,24 @@ bool EarlyFunctionAnalysis<ShouldAnalyzeABI>::runOnModule(Module &M) {
     llvm::WriteGraph(*OutputCG, &CG);
   }
 
-  // Collect all the ABI registers, leave out the stack pointer for the moment.
-  // We will include it back later when refining ABI results.
-  std::vector<llvm::GlobalVariable *> ABICSVs;
-  for (GlobalVariable *CSV : GCBI.abiRegisters())
-    if (CSV != nullptr && !(GCBI.isSPReg(CSV)))
-      ABICSVs.emplace_back(CSV);
+  std::vector<llvm::GlobalVariable *> ABICSVs = collectABICSVs(GCBI);
 
-  // Default-constructed cache summary for indirect calls
-  unsigned MinimalFSO;
-  {
-    using namespace model::Architecture;
-    MinimalFSO = getMinimalFinalStackOffset(Binary->Architecture);
-  }
+  using FAR = FunctionAnalysisResults;
+  FAR Properties(createDefaultSummary(*Binary, ABICSVs));
 
-  FunctionSummary DefaultSummary(model::FunctionType::Values::Regular,
-                                 { ABICSVs.begin(), ABICSVs.end() },
-                                 ABIAnalyses::ABIAnalysesResults(),
-                                 {},
-                                 MinimalFSO,
-                                 nullptr);
+  UnboundedScanLimits ScanLimits;
 
-  using FAR = FunctionAnalysisResults;
-  FAR Properties(std::move(DefaultSummary));
+  // Open the dumps before the analyzers, which flush to them when destroyed
+  EFADumps Dumps(ABICSVs);
 
   // Instantiate a FunctionEntrypointAnalyzer object
-  FEA Analyzer(M, &GCBI, ABICSVs, &EntrypointsQueue, Properties, Binary);
+  FEA Analyzer(M,
+               &GCBI,
+               ABICSVs,
+               &EntrypointsQueue,
+               Properties,
+               Binary,
+               Dumps);
 
   // Prepopulate the cache with existing functions and dynamic functions from
   // model, and recreate fake functions
@@ -2217,13 +2661,13 @@ bool EarlyFunctionAnalysis<ShouldAnalyzeABI>::runOnModule(Module &M) {
 
   if (!ShouldAnalyzeABI) {
     // Recover the control-flow graph
-    Analyzer.recoverCFG();
+    Analyzer.recoverCFG(EFAJobs);
 
     // Serialize function metadata, CFG included, to IR
     Analyzer.serializeFunctionMetadata();
   } else {
-    // Interprocedural analysis over the collected functions in post-order
-    // traversal (leafs first).
+    // Interprocedural analysis over the collected functions, one SCC of the
+    // call graph at a time (leafs first).
     Analyzer.runInterproceduralAnalysis();
 
     // Propagate results between call-sites and functions
@@ -4,17 +4,42 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
-#include "llvm/ADT/DepthFirstIterator.h"
+#include <atomic>
+#include <deque>
+#include <optional>
+
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/DOTGraphTraits.h"
 #include "llvm/Support/GraphWriter.h"
 #include "llvm/Support/raw_os_ostream.h"
+#include "llvm/Support/xxhash.h"
 
 #include "revng/ADT/GenericGraph.h"
 #include "revng/EarlyFunctionAnalysis/FunctionMetadata.h"
 #include "revng/Model/Binary.h"
+#include "revng/Support/CommandLine.h"
+#include "revng/Support/TaskScheduler.h"
+#include "revng/TupleTree/YAMLSerialization.h"
 
 using namespace llvm;
 
+// Keep the metadata of functions on the specialized YAML emitter and parser
+static_assert(tupletree::yaml::IsSupported<efa::FunctionMetadata>);
+
+static cl::opt<unsigned> VerifyJobs("efa-verify-jobs",
+                                    cl::desc("number of tasks verifying the "
+                                             "metadata of the functions, 0 "
+                                             "for one per thread of revng"),
+                                    cl::init(0),
+                                    cl::cat(MainCategory));
+
+/// Below this number of functions per task, verifying in parallel does not
+/// pay
+static constexpr size_t MinimumFunctionsPerJob = 64;
+
 namespace efa {
 
 struct FunctionCFGNodeData {
@@ -24,7 +49,7 @@ struct FunctionCFGNodeData {
 
 using FunctionCFGNode = ForwardNode<FunctionCFGNodeData>;
 
-/// Graph data structure to represent the CFG for verification purposes
+/// Graph data structure to represent the CFG for dumping purposes
 struct FunctionCFG : public GenericGraph<FunctionCFGNode> {
 private:
   MetaAddress Entry;
@@ -50,34 +75,21 @@ public:
 
     return Result;
   }
-
-  bool allNodesAreReachable() const {
-    if (Map.size() == 0)
-      return true;
-
-    // Ensure all the nodes are reachable from the entry node
-    df_iterator_default_set<FunctionCFGNode *> Visited;
-    for (auto &Ignore : depth_first_ext(entryNode(), Visited))
-      ;
-    return Visited.size() == size();
-  }
-
-  bool hasOnlyInvalidExits() const {
-    for (auto &[Address, Node] : Map)
-      if (Address.isValid() and not Node->hasSuccessors())
-        return false;
-    return true;
-  }
 };
 
-static FunctionCFG getGraph(const model::Binary &Binary,
-                            const SortedVector<efa::BasicBlock> &CFG,
-                            MetaAddress Entry) {
+/// \brief Invoke \p Handler on each edge of \p CFG
+///
+/// Calls that return lead to the end of their block, while edges not leading
+/// anywhere lead to MetaAddress::invalid().
+template<typename T>
+static void forEachEdge(const model::Binary &Binary,
+                        const SortedVector<efa::BasicBlock> &CFG,
+                        T &&Handler) {
   using namespace efa::FunctionEdgeType;
 
-  FunctionCFG Graph(Entry);
   for (const BasicBlock &Block : CFG) {
-    auto *Source = Graph.get(Block.Start);
+    // Report the block even if it has no successors
+    Handler(Block.Start, std::nullopt);
 
     for (const auto &Edge : Block.Successors) {
       switch (Edge->Type) {
@@ -89,21 +101,21 @@ static FunctionCFG getGraph(const model::Binary &Binary,
       case IndirectTailCall:
       case LongJmp:
       case Unreachable:
-        Source->addSuccessor(Graph.get(Edge->Destination));
+        Handler(Block.Start, Edge->Destination);
         break;
 
       case FunctionCall:
       case IndirectCall: {
         auto *CE = cast<efa::CallEdge>(Edge.get());
         if (hasAttribute(Binary, *CE, model::FunctionAttribute::NoReturn))
-          Source->addSuccessor(Graph.get(MetaAddress::invalid()));
+          Handler(Block.Start, MetaAddress::invalid());
         else
-          Source->addSuccessor(Graph.get(Block.End));
+          Handler(Block.Start, Block.End);
         break;
       }
 
       case Killer:
-        Source->addSuccessor(Graph.get(MetaAddress::invalid()));
+        Handler(Block.Start, MetaAddress::invalid());
         break;
 
       case Invalid:
@@ -113,10 +125,105 @@ static FunctionCFG getGraph(const model::Binary &Binary,
       }
     }
   }
+}
+
+static FunctionCFG getGraph(const model::Binary &Binary,
+                            const SortedVector<efa::BasicBlock> &CFG,
+                            MetaAddress Entry) {
+  FunctionCFG Graph(Entry);
+  auto AddEdge = [&Graph](MetaAddress Source,
+                          std::optional<MetaAddress> Destination) {
+    auto *SourceNode = Graph.get(Source);
+    if (Destination)
+      SourceNode->addSuccessor(Graph.get(*Destination));
+  };
+  forEachEdge(Binary, CFG, AddEdge);
 
   return Graph;
 }
 
+/// \brief Compact representation of the CFG for verification purposes
+///
+/// Nodes are identified by their index and the successors of all of them are
+/// stored in a single vector, which makes building it and visiting it cheap.
+class FlatFunctionCFG {
+private:
+  DenseMap<MetaAddress, unsigned> Indices;
+  SmallVector<MetaAddress, 16> Addresses;
+  /// The successors of node I are in [Offsets[I], Offsets[I + 1])
+  SmallVector<unsigned, 16> Offsets;
+  SmallVector<unsigned, 32> Successors;
+
+public:
+  FlatFunctionCFG(const model::Binary &Binary,
+                  const SortedVector<efa::BasicBlock> &CFG) {
+    SmallVector<std::pair<unsigned, unsigned>, 32> Edges;
+    auto AddEdge = [this, &Edges](MetaAddress Source,
+                                  std::optional<MetaAddress> Destination) {
+      unsigned SourceIndex = index(Source);
+      if (Destination)
+        Edges.emplace_back(SourceIndex, index(*Destination));
+    };
+    forEachEdge(Binary, CFG, AddEdge);
+
+    // Counting sort of the edges by source
+    Offsets.assign(Addresses.size() + 1, 0);
+    for (auto &[Source, Destination] : Edges)
+      ++Offsets[Source + 1];
+    for (unsigned I = 1; I < Offsets.size(); ++I)
+      Offsets[I] += Offsets[I - 1];
+
+    SmallVector<unsigned, 16> Next(Offsets.begin(), Offsets.end() - 1);
+    Successors.resize(Edges.size());
+    for (auto &[Source, Destination] : Edges)
+      Successors[Next[Source]++] = Destination;
+  }
+
+public:
+  bool allNodesAreReachable(MetaAddress Entry) const {
+    if (Addresses.size() == 0)
+      return true;
+
+    auto It = Indices.find(Entry);
+    if (It == Indices.end())
+      return false;
+
+    // Ensure all the nodes are reachable from the entry node
+    BitVector Visited(Addresses.size());
+    SmallVector<unsigned, 16> Stack = { It->second };
+    Visited.set(It->second);
+    unsigned VisitedCount = 1;
+    while (not Stack.empty()) {
+      unsigned Node = Stack.pop_back_val();
+      for (unsigned I = Offsets[Node]; I < Offsets[Node + 1]; ++I) {
+        unsigned Successor = Successors[I];
+        if (not Visited.test(Successor)) {
+          Visited.set(Successor);
+          ++VisitedCount;
+          Stack.push_back(Successor);
+        }
+      }
+    }
+
+    return VisitedCount == Addresses.size();
+  }
+
+  bool hasOnlyInvalidExits() const {
+    for (unsigned I = 0; I < Addresses.size(); ++I)
+      if (Addresses[I].isValid() and Offsets[I] == Offsets[I + 1])
+        return false;
+    return true;
+  }
+
+private:
+  unsigned index(MetaAddress Address) {
+    auto [It, New] = Indices.try_emplace(Address, Addresses.size());
+    if (New)
+      Addresses.push_back(Address);
+    return It->second;
+  }
+};
+
 bool FunctionMetadata::verify(const model::Binary &Binary) const {
   return verify(Binary, false);
 }
@@ -135,10 +242,10 @@ bool FunctionMetadata::verify(const model::Binary &Binary,
     return VH.maybeFail(ControlFlowGraph.size() == 0);
 
   // Populate graph
-  FunctionCFG Graph = getGraph(Binary, ControlFlowGraph, Entry);
+  FlatFunctionCFG Graph(Binary, ControlFlowGraph);
 
   // Ensure all the nodes are reachable from the entry node
-  if (not Graph.allNodesAreReachable())
+  if (not Graph.allNodesAreReachable(Entry))
     return VH.fail();
 
   // Ensure the only node with no successors is invalid
@@ -204,6 +311,105 @@ bool FunctionMetadata::verify(const model::Binary &Binary,
   return true;
 }
 
+/// \brief Run \p Verify on each index in [0, \p Count) over multiple tasks
+///
+/// Each task has its own VerifyHelper, reusing the results already in \p VH.
+/// Once all the tasks are done, their results are merged into \p VH.
+template<typename T>
+static bool
+verifyInParallel(model::VerifyHelper &VH, size_t Count, const T &Verify) {
+  size_t Threads = VerifyJobs;
+  if (Threads == 0)
+    Threads = TaskScheduler::get().getThreadsCount();
+  Threads = std::min(Threads, Count / MinimumFunctionsPerJob);
+
+  if (Threads <= 1) {
+    for (size_t Index = 0; Index < Count; ++Index)
+      if (not Verify(Index, VH))
+        return VH.fail();
+    return true;
+  }
+
+  std::deque<model::VerifyHelper> Helpers;
+  for (size_t I = 0; I < Threads; ++I)
+    Helpers.emplace_back(&VH);
+
+  std::atomic<size_t> Next = 0;
+  std::atomic<bool> Failed = false;
+  auto Worker = [Count, &Verify, &Next, &Failed](model::VerifyHelper &Helper) {
+    while (not Failed) {
+      size_t Index = Next++;
+      if (Index >= Count)
+        return;
+
+      if (not Verify(Index, Helper))
+        Failed = true;
+    }
+  };
+
+  {
+    TaskGroup Group;
+    for (model::VerifyHelper &Helper : Helpers)
+      Group.spawn([&Worker, &Helper] { Worker(Helper); });
+    Group.wait();
+  }
+
+  if (Failed)
+    return VH.fail();
+
+  for (model::VerifyHelper &Helper : Helpers)
+    VH.merge(std::move(Helper));
+
+  return true;
+}
+
+bool verifyFunctionsMetadata(const model::Binary &Binary,
+                             ArrayRef<const FunctionMetadata *> ToVerify,
+                             model::VerifyHelper &VH) {
+  auto Verify = [&Binary, &ToVerify](size_t Index, model::VerifyHelper &VH) {
+    return ToVerify[Index]->verify(Binary, VH);
+  };
+  return verifyInParallel(VH, ToVerify.size(), Verify);
+}
+
+bool FunctionMetadataVerifier::verify(ArrayRef<const FunctionMetadata *>
+                                        ToVerify,
+                                      model::VerifyHelper &VH) {
+  // VerifiedHashes is only read while verifying, the hashes of the
+  // FunctionMetadata verified successfully are recorded afterwards
+  std::vector<std::optional<uint64_t>> NewHashes(ToVerify.size());
+  auto Verify = [this, &ToVerify, &NewHashes](size_t Index,
+                                              model::VerifyHelper &VH) {
+    const FunctionMetadata &FM = *ToVerify[Index];
+
+    std::string Buffer;
+    {
+      raw_string_ostream Stream(Buffer);
+      serialize(Stream, FM);
+    }
+    uint64_t Hash = xxHash64(Buffer);
+
+    auto It = VerifiedHashes.find(FM.Entry);
+    if (It != VerifiedHashes.end() and It->second == Hash)
+      return true;
+
+    if (not FM.verify(Binary, VH))
+      return false;
+
+    NewHashes[Index] = Hash;
+    return true;
+  };
+
+  if (not verifyInParallel(VH, ToVerify.size(), Verify))
+    return false;
+
+  for (size_t Index = 0; Index < ToVerify.size(); ++Index)
+    if (NewHashes[Index])
+      VerifiedHashes[ToVerify[Index]->Entry] = *NewHashes[Index];
+
+  return true;
+}
+
 void FunctionMetadata::dump() const {
   serialize(dbg, *this);
 }
@@ -0,0 +1,94 @@
+/// \file FunctionSummaryCache.cpp
+/// \brief On disk cache of the control-flow graphs recovered by EFA.
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "revng/EarlyFunctionAnalysis/FunctionMetadata.h"
+#include "revng/Support/CommandLine.h"
+#include "revng/Support/Debug.h"
+#include "revng/TupleTree/TupleTree.h"
+
+#include "FunctionSummaryCache.h"
+
+using namespace llvm;
+
+static cl::opt<std::string> CacheDirectory("efa-cache-dir",
+                                           cl::desc("directory where the CFGs "
+                                                    "recovered by EFA are "
+                                                    "cached"),
+                                           cl::value_desc("directory"),
+                                           cl::cat(MainCategory));
+
+static Logger<> Log("efa-cache");
+
+FunctionSummaryCache::FunctionSummaryCache() : Directory(CacheDirectory) {}
+
+std::string FunctionSummaryCache::getPath(uint64_t Key) const {
+  SmallString<128> Path(Directory);
+  sys::path::append(Path, "efa-cfg-" + utohexstr(Key) + ".yml");
+  return Path.str().str();
+}
+
+std::optional<FunctionSummaryCache::ControlFlowGraph>
+FunctionSummaryCache::lookup(uint64_t Key, const MetaAddress &Entry) const {
+  if (not isEnabled())
+    return std::nullopt;
+
+  std::string Path = getPath(Key);
+  if (not sys::fs::exists(Path))
+    return std::nullopt;
+
+  auto MaybeMetadata = TupleTree<efa::FunctionMetadata>::fromFile(Path);
+  if (not MaybeMetadata or (*MaybeMetadata)->Entry != Entry) {
+    revng_log(Log, "Ignoring " << Path);
+    return std::nullopt;
+  }
+
+  revng_log(Log, "Hit for " << Entry.toString());
+  return std::move((*MaybeMetadata)->ControlFlowGraph);
+}
+
+void FunctionSummaryCache::store(uint64_t Key,
+                                 const MetaAddress &Entry,
+                                 const ControlFlowGraph &CFG) const {
+  if (not isEnabled())
+    return;
+
+  if (sys::fs::create_directories(Directory)) {
+    revng_log(Log, "Cannot create " << Directory);
+    return;
+  }
+
+  // Write to a temporary file and rename it, so that concurrent invocations
+  // never observe a partially written entry
+  std::string Path = getPath(Key);
+  int FD = 0;
+  SmallString<128> TemporaryPath;
+  if (sys::fs::createUniqueFile(Path + ".%%%%%%", FD, TemporaryPath)) {
+    revng_log(Log, "Cannot create a temporary file for " << Path);
+    return;
+  }
+
+  {
+    efa::FunctionMetadata FM(Entry);
+    for (const efa::BasicBlock &Block : CFG)
+      FM.ControlFlowGraph.insert(Block);
+
+    raw_fd_ostream Stream(FD, true);
+    serialize(Stream, FM);
+  }
+
+  if (sys::fs::rename(TemporaryPath, Path)) {
+    sys::fs::remove(TemporaryPath);
+    revng_log(Log, "Cannot write " << Path);
+  }
+}
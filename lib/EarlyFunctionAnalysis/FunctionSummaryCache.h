@@ -0,0 +1,46 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include "revng/ADT/SortedVector.h"
+#include "revng/EarlyFunctionAnalysis/BasicBlock.h"
+#include "revng/Support/MetaAddress.h"
+
+/// \brief On disk cache of the control-flow graphs recovered by EFA
+///
+/// Each entry is the efa::FunctionMetadata of a function, keyed by a hash of
+/// everything its analysis depends upon: the lifted code of the function and
+/// the summaries of its callees. Entries are stored, one file per key, in the
+/// directory specified by -efa-cache-dir, if any, so that analyzing again a
+/// slightly different binary only needs to redo the functions that changed.
+class FunctionSummaryCache {
+public:
+  using ControlFlowGraph = SortedVector<efa::BasicBlock>;
+
+private:
+  std::string Directory;
+
+public:
+  FunctionSummaryCache();
+
+public:
+  bool isEnabled() const { return not Directory.empty(); }
+
+  /// \return the CFG of the function at \p Entry cached under \p Key, if any
+  std::optional<ControlFlowGraph>
+  lookup(uint64_t Key, const MetaAddress &Entry) const;
+
+  /// \brief Records \p CFG as the CFG of the function at \p Entry
+  void store(uint64_t Key,
+             const MetaAddress &Entry,
+             const ControlFlowGraph &CFG) const;
+
+private:
+  std::string getPath(uint64_t Key) const;
+};
@@ -25,6 +25,7 @@ PreservedAnalyses IBIPP::run(Function &F, FunctionAnalysisManager &FAM) {
   for (auto *Call : callers(M.getFunction("indirect_branch_info")))
     if (Call->getParent()->getParent() == &F)
       serialize(Call);
+  OS.endRecord();
 
   return PreservedAnalyses::all();
 }
@@ -9,14 +9,19 @@
 #include "revng/Model/IRHelpers.h"
 
 const efa::FunctionMetadata &LoadFunctionMetadataPass::get(llvm::Function *F) {
-  auto Address = getMetaAddressOfIsolatedFunction(*F);
-  auto It = EntryToMetadata.find(Address);
-  if (It == EntryToMetadata.end()) {
-    efa::FunctionMetadata FM = *extractFunctionMetadata(F).get();
-    It = EntryToMetadata.insert(It, { Address, std::move(FM) });
+  using namespace llvm;
+
+  auto *MD = F->getMetadata(FunctionMetadataMDName);
+  revng_assert(MD != nullptr);
+  const auto *Data = cast<MDString>(MD->getOperand(0).get());
+
+  auto &Result = Cache[Data];
+  if (not Result) {
+    TupleTree<efa::FunctionMetadata> Parsed = extractFunctionMetadata(F);
+    Result = std::make_unique<efa::FunctionMetadata>(std::move(*Parsed));
   }
 
-  return It->second;
+  return *Result;
 }
 
 bool LoadFunctionMetadataPass::runOnModule(llvm::Module &M) {
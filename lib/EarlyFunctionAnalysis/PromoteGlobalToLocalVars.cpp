@@ -5,6 +5,7 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include "llvm/ADT/MapVector.h"
 #include "llvm/IR/IRBuilder.h"
 
 #include "revng/EarlyFunctionAnalysis/PromoteGlobalToLocalVars.h"
@@ -17,7 +18,7 @@ PromoteGlobalToLocalPass::run(llvm::Function &F,
                               llvm::FunctionAnalysisManager &FAM) {
 
   // Collect the CSVs used by the current function.
-  std::map<GlobalVariable *, Value *> CSVMap;
+  MapVector<GlobalVariable *, AllocaInst *> CSVMap;
   for (auto &BB : F) {
     for (auto &I : BB) {
       Value *Pointer = nullptr;
@@ -29,18 +30,51 @@ PromoteGlobalToLocalPass::run(llvm::Function &F,
         continue;
 
       if (auto *CSV = dyn_cast_or_null<GlobalVariable>(Pointer))
-        CSVMap.try_emplace(CSV);
+        CSVMap.insert({ CSV, nullptr });
     }
   }
 
-  // Create an equivalent local variable, replace all the uses of the CSV.
+  if (CSVMap.empty())
+    return PreservedAnalyses::all();
+
+  // Create an equivalent local variable for each CSV
   IRBuilder<> Builder(&F.getEntryBlock().front());
-  for (const auto &[CSV, _] : CSVMap) {
+  for (auto &[CSV, Alloca] : CSVMap) {
     auto *CSVTy = CSV->getType()->getPointerElementType();
-    auto *Alloca = Builder.CreateAlloca(CSVTy, nullptr, CSV->getName());
-    replaceAllUsesInFunctionWith(&F, CSV, Alloca);
+    Alloca = Builder.CreateAlloca(CSVTy, nullptr, CSV->getName());
+  }
+
+  // Replace all the uses of the CSVs in the function. CSVs are used by
+  // (almost) every function in the module: rather than going through their
+  // uses, only consider the operands of the instructions of this function.
+  // Constant expressions casting a CSV are materialized as instructions, since
+  // they might be used elsewhere.
+  for (auto &BB : F) {
+    for (auto &I : BB) {
+      for (Use &U : I.operands()) {
+        if (auto *CSV = dyn_cast<GlobalVariable>(U.get())) {
+          auto It = CSVMap.find(CSV);
+          if (It != CSVMap.end())
+            U.set(It->second);
+        } else if (auto *CE = dyn_cast<ConstantExpr>(U.get())) {
+          if (not CE->isCast())
+            continue;
+
+          auto *CSV = dyn_cast<GlobalVariable>(CE->getOperand(0));
+          if (CSV == nullptr)
+            continue;
 
-    CSVMap[CSV] = Alloca;
+          auto It = CSVMap.find(CSV);
+          if (It == CSVMap.end())
+            continue;
+
+          Instruction *Cast = CE->getAsInstruction();
+          Cast->replaceUsesOfWith(CSV, It->second);
+          Cast->insertBefore(&I);
+          U.set(Cast);
+        }
+      }
+    }
   }
 
   // Load all the CSVs and store their value onto the local variables.
@@ -46,7 +46,7 @@ void SDSAPI::run(Function &F, FunctionAnalysisManager &FAM) {
   Context = &(F.getContext());
 
   // Get the result of the GCBI analysis
-  GCBI = &(FAM.getResult<GeneratedCodeBasicInfoAnalysis>(F));
+  GCBI = &GeneratedCodeBasicInfoAnalysis::get(F, FAM);
   revng_assert(GCBI != nullptr);
 
   // Populate the two buckets with all load and store instruction of the
@@ -28,6 +28,7 @@ bool FunctionCallIdentification::runOnModule(llvm::Module &M) {
   auto &GCBI = getAnalysis<GeneratedCodeBasicInfoWrapperPass>().getGCBI();
 
   FallthroughAddresses.clear();
+  ReturnCandidates.clear();
 
   // Create function call marker
   // TODO: we could factor this out
@@ -62,6 +63,20 @@ bool FunctionCallIdentification::runOnModule(llvm::Module &M) {
     // hasn't been already marked as a function call
     Instruction *Terminator = BB.getTerminator();
 
+    // Record the jumps that might be returns: unexpectedpc can be reached
+    // either directly or through the dispatcher of an indirect jump
+    if (Terminator != nullptr and Terminator->getNumSuccessors() >= 2) {
+      auto MightLeadToUnexpectedPC = [&GCBI](BasicBlock *Successor) {
+        using namespace BlockType;
+        return (Successor == GCBI.unexpectedPC()
+                or (not Successor->empty()
+                    and getType(Successor)
+                          == IndirectBranchDispatcherHelperBlock));
+      };
+      if (any_of(successors(Terminator), MightLeadToUnexpectedPC))
+        ReturnCandidates.push_back(&BB);
+    }
+
     if (Terminator != nullptr) {
       if (CallInst *Call = getFunctionCall(Terminator)) {
         auto Address = MetaAddress::fromConstant(Call->getOperand(2));
@@ -298,19 +313,23 @@ void FunctionCallIdentification::buildFilteredCFG(llvm::Function &F) {
   //
   // * We only have translate basic blocks
   // * Function call edges proceed towards the falltrough basic block
+  //
+  // Edges are collected in a single pass over the function and then laid out
+  // in compressed sparse row form.
+  FilteredCFG.clear();
   for (BasicBlock &BB : F) {
 
     if (BB.empty() or not GCBI.isTranslated(&BB))
       continue;
 
-    CustomCFGNode *Node = FilteredCFG.getNode(&BB);
+    FilteredCFG.addNode(&BB);
 
     // Is this a function call?
     if (CallInst *Call = getFunctionCall(&BB)) {
 
       Value *SecondArgument = Call->getArgOperand(1);
       auto *Fallthrough = cast<BlockAddress>(SecondArgument)->getBasicBlock();
-      Node->addSuccessor(FilteredCFG.getNode(Fallthrough));
+      FilteredCFG.addEdge(&BB, Fallthrough);
 
     } else {
 
@@ -335,13 +354,13 @@ void FunctionCallIdentification::buildFilteredCFG(llvm::Function &F) {
           if (Successor->empty() or not GCBI.isTranslated(Successor))
             continue;
 
-          Node->addSuccessor(FilteredCFG.getNode(Successor));
+          FilteredCFG.addEdge(&BB, Successor);
         }
       }
     }
   }
 
-  FilteredCFG.buildBackLinks();
+  FilteredCFG.finalize();
 
   if (FilteredCFGLog.isEnabled())
     FilteredCFG.dump(FilteredCFGLog);
@@ -18,12 +18,10 @@ bool PruneRetSuccessors::runOnModule(llvm::Module &M) {
   auto &GCBI = getAnalysis<GeneratedCodeBasicInfoWrapperPass>().getGCBI();
   auto &FCI = getAnalysis<FunctionCallIdentification>();
 
-  for (BasicBlock &BB : *GCBI.root()) {
-    if (not GCBI.isTranslated(&BB)
-        or BB.getTerminator()->getNumSuccessors() < 2)
-      continue;
-
-    auto Successors = GCBI.getSuccessors(&BB);
+  // Only the jumps that FunctionCallIdentification has recorded while looking
+  // for function calls might have unexpectedpc among their successors
+  for (BasicBlock *BB : FCI.getReturnCandidates()) {
+    auto Successors = GCBI.getSuccessors(BB);
     if (not Successors.UnexpectedPC or Successors.Other)
       continue;
 
@@ -36,8 +34,8 @@ bool PruneRetSuccessors::runOnModule(llvm::Module &M) {
     }
 
     if (AllFallthrough) {
-      Instruction *OldTerminator = BB.getTerminator();
-      auto *NewTerminator = BranchInst::Create(GCBI.anyPC(), &BB);
+      Instruction *OldTerminator = BB->getTerminator();
+      auto *NewTerminator = BranchInst::Create(GCBI.anyPC(), BB);
       NewTerminator->copyMetadata(*OldTerminator);
       eraseFromParent(OldTerminator);
     }
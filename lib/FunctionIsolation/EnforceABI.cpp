@@ -25,6 +25,7 @@
 #include "revng/EarlyFunctionAnalysis/IRHelpers.h"
 #include "revng/FunctionIsolation/EnforceABI.h"
 #include "revng/FunctionIsolation/StructInitializers.h"
+#include "revng/Model/IRHelpers.h"
 #include "revng/Model/Register.h"
 #include "revng/Model/Type.h"
 #include "revng/Pipeline/AllRegistries.h"
@@ -76,14 +77,26 @@ public:
     Context(M.getContext()),
     Initializers(&M),
     Binary(Binary),
-    MetaAddressStruct(MetaAddress::getStruct(&M)) {}
+    MetaAddressStruct(MetaAddress::getStruct(&M)),
+    Verifier(Binary) {}
 
   void run();
 
 private:
+  /// \brief The layout of a prototype along with the corresponding LLVM type
+  struct PrototypeInfo {
+    FTLayout Layout;
+    FunctionType *Type;
+  };
+
+private:
+  const PrototypeInfo &getPrototypeInfo(const model::TypePath &Prototype);
+  const efa::FunctionMetadata &getFunctionMetadata(Function *F);
+
   Function *
   handleFunction(Function &OldFunction, const model::Function &FunctionModel);
-  Function *recreateFunction(Function &OldFunction, const FTLayout &Prototype);
+  Function *
+  recreateFunction(Function &OldFunction, const PrototypeInfo &Prototype);
   void
   createPrologue(Function *NewFunction, const model::Function &FunctionModel);
 
@@ -104,6 +117,17 @@ private:
   StructInitializers Initializers;
   model::Binary &Binary;
   StructType *MetaAddressStruct;
+
+  /// Many functions and call sites share the same prototype, compute its
+  /// layout and LLVM type only once
+  std::map<const model::Type *, PrototypeInfo> Prototypes;
+
+  /// The CFGs of the isolated functions, parsing them is costly and we need
+  /// them for each call site
+  std::map<Function *, TupleTree<efa::FunctionMetadata>> FunctionsMetadata;
+
+  /// Verifies the CFGs as they are parsed, each of them at most once
+  efa::FunctionMetadataVerifier Verifier;
 };
 
 bool EnforceABI::runOnModule(Module &M) {
@@ -132,9 +156,8 @@ void EnforceABIImpl::run() {
     revng_assert(OldFunction != nullptr);
     OldFunctions.push_back(OldFunction);
 
-    using namespace abi::FunctionType;
-    auto Prototype = Layout::make(FunctionModel.prototype(Binary));
-    revng_assert(Prototype.verify());
+    const auto &Prototype = getPrototypeInfo(FunctionModel.prototype(Binary));
+    revng_assert(Prototype.Layout.verify());
 
     Function *NewFunction = recreateFunction(*OldFunction, Prototype);
     FunctionTags::DynamicFunction.addTo(NewFunction);
@@ -146,13 +169,12 @@ void EnforceABIImpl::run() {
   }
 
   // Recreate isolated functions with arguments
+  auto IsolatedFunctions = indexIsolatedFunctions(M);
   for (const model::Function &FunctionModel : Binary.Functions) {
     if (FunctionModel.Type == model::FunctionType::Fake)
       continue;
 
-    revng_assert(not FunctionModel.name().empty());
-    auto OldFunctionName = (Twine("local_") + FunctionModel.name()).str();
-    Function *OldFunction = M.getFunction(OldFunctionName);
+    Function *OldFunction = IsolatedFunctions.lookup(FunctionModel.Entry);
     revng_assert(OldFunction != nullptr);
     OldFunctions.push_back(OldFunction);
 
@@ -196,8 +218,8 @@ static Type *getLLVMTypeForRegister(Module *M, model::Register::Values V) {
   return IntegerType::getIntNTy(C, 8 * model::Register::getSize(V));
 }
 
-static std::pair<Type *, SmallVector<Type *, 8>>
-getLLVMReturnTypeAndArguments(llvm::Module *M, const FTLayout &Prototype) {
+static FunctionType *getLLVMFunctionType(llvm::Module *M,
+                                         const FTLayout &Prototype) {
   using model::NamedTypedRegister;
   using model::RawFunctionType;
   using model::TypedRegister;
@@ -223,13 +245,34 @@ getLLVMReturnTypeAndArguments(llvm::Module *M, const FTLayout &Prototype) {
   else
     ReturnType = StructType::create(ReturnTypes);
 
-  // Create new function
-  return { ReturnType, ArgumentsTypes };
+  return FunctionType::get(ReturnType, ArgumentsTypes, false);
+}
+
+const EnforceABIImpl::PrototypeInfo &
+EnforceABIImpl::getPrototypeInfo(const model::TypePath &Prototype) {
+  auto It = Prototypes.find(Prototype.get());
+  if (It != Prototypes.end())
+    return It->second;
+
+  auto Layout = FTLayout::make(Prototype);
+  FunctionType *Type = getLLVMFunctionType(&M, Layout);
+  PrototypeInfo Info{ std::move(Layout), Type };
+  return Prototypes.emplace(Prototype.get(), std::move(Info)).first->second;
+}
+
+const efa::FunctionMetadata &EnforceABIImpl::getFunctionMetadata(Function *F) {
+  auto It = FunctionsMetadata.find(F);
+  if (It == FunctionsMetadata.end()) {
+    It = FunctionsMetadata.emplace(F, extractFunctionMetadata(F)).first;
+    const efa::FunctionMetadata *Loaded = It->second.get();
+    Verifier.verify(Loaded, /* Assert */ true);
+  }
+  return *It->second;
 }
 
 Function *EnforceABIImpl::handleFunction(Function &OldFunction,
                                          const model::Function &FunctionModel) {
-  auto Prototype = abi::FunctionType::Layout::make(FunctionModel.Prototype);
+  const auto &Prototype = getPrototypeInfo(FunctionModel.Prototype);
   Function *NewFunction = recreateFunction(OldFunction, Prototype);
   FunctionTags::ABIEnforced.addTo(NewFunction);
   createPrologue(NewFunction, FunctionModel);
@@ -237,16 +280,16 @@ Function *EnforceABIImpl::handleFunction(Function &OldFunction,
 }
 
 Function *EnforceABIImpl::recreateFunction(Function &OldFunction,
-                                           const FTLayout &Prototype) {
+                                           const PrototypeInfo &Prototype) {
   // Create new function
-  auto [NewReturnType, NewArguments] = getLLVMReturnTypeAndArguments(&M,
-                                                                     Prototype);
+  FunctionType *NewType = Prototype.Type;
   auto *NewFunction = changeFunctionType(OldFunction,
-                                         NewReturnType,
-                                         NewArguments);
+                                         NewType->getReturnType(),
+                                         NewType->params());
 
-  revng_assert(NewFunction->arg_size() == Prototype.argumentRegisterCount());
-  for (size_t Index = 0; const auto &Argument : Prototype.Arguments)
+  const FTLayout &Layout = Prototype.Layout;
+  revng_assert(NewFunction->arg_size() == Layout.argumentRegisterCount());
+  for (size_t Index = 0; const auto &Argument : Layout.Arguments)
     for (model::Register::Values Register : Argument.Registers)
       NewFunction->getArg(Index++)->setName(model::Register::getName(Register));
 
@@ -316,7 +359,7 @@ void EnforceABIImpl::handleRegularFunctionCall(CallInst *Call) {
 
   // Identify the corresponding call site in the model
   MetaAddress BasicBlockAddress = GCBI.getJumpTarget(Call->getParent());
-  efa::FunctionMetadata FM = *extractFunctionMetadata(CallerFunction).get();
+  const efa::FunctionMetadata &FM = getFunctionMetadata(CallerFunction);
 
   const efa::BasicBlock &Block = FM.ControlFlowGraph.at(BasicBlockAddress);
   const efa::CallEdge *CallSite = nullptr;
@@ -390,7 +433,8 @@ CallInst *EnforceABIImpl::generateCall(IRBuilder<> &Builder,
                                                Entry,
                                                CallSiteBlock.Start,
                                                CallSite);
-  auto Prototype = abi::FunctionType::Layout::make(PrototypePath);
+  const PrototypeInfo &Info = getPrototypeInfo(PrototypePath);
+  const FTLayout &Prototype = Info.Layout;
   revng_assert(Prototype.verify());
 
   bool IsIndirect = (Callee.getCallee() == FunctionDispatcher);
@@ -398,9 +442,7 @@ CallInst *EnforceABIImpl::generateCall(IRBuilder<> &Builder,
     // Create a new `indirect_placeholder` function with the specific function
     // type we need
     Value *PC = GCBI.programCounterHandler()->loadJumpablePC(Builder);
-    auto [ReturnType, Arguments] = getLLVMReturnTypeAndArguments(&M, Prototype);
-    auto *NewType = FunctionType::get(ReturnType, Arguments, false);
-    Callee = toFunctionPointer(Builder, PC, NewType);
+    Callee = toFunctionPointer(Builder, PC, Info.Type);
   } else {
     BasicBlock *InsertBlock = Builder.GetInsertPoint()->getParent();
     revng_log(EnforceABILog,
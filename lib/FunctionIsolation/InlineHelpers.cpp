@@ -6,19 +6,35 @@
 //
 
 #include <iterator>
+#include <map>
 
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/IR/IRBuilder.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Transforms/Utils/Cloning.h"
 
 #include "revng/ADT/Queue.h"
 #include "revng/BasicAnalyses/GeneratedCodeBasicInfo.h"
 #include "revng/FunctionIsolation/InlineHelpers.h"
+#include "revng/Support/CommandLine.h"
 #include "revng/Support/IRHelpers.h"
 #include "revng/Support/OpaqueFunctionsPool.h"
+#include "revng/Support/Statistics.h"
 
 using namespace llvm;
 
+static cl::opt<unsigned> InliningBudget("inline-helpers-budget",
+                                        cl::desc("maximum number of "
+                                                 "instructions inlining "
+                                                 "helpers can add to an "
+                                                 "isolated function, 0 means "
+                                                 "no limit"),
+                                        cl::cat(MainCategory),
+                                        cl::init(0));
+
+static RunningStatistics FunctionGrowth("inline-helpers-function-growth");
+static CounterMap<std::string> SkippedHelpers("inline-helpers-skipped");
+
 // TODO: make sure we do not inline loops
 
 char InlineHelpersPass::ID = 0;
@@ -64,6 +80,67 @@ static bool doInline(Function *F) {
   return ToInline.size() > 0;
 }
 
+static size_t getInstructionsCount(const Function *F) {
+  size_t Result = 0;
+  for (const BasicBlock &BB : *F)
+    Result += BB.size();
+  return Result;
+}
+
+/// \brief Inline helpers in \p F, cheapest first, as long as \p Budget allows
+///
+/// The cost of inlining a call is the size of the callee. Calls are considered
+/// in order of increasing cost and, among helpers of the same size, the most
+/// frequently called first, so that the budget covers as many call sites as
+/// possible. Calls that do not fit in the remaining budget are left in place.
+static void doInline(Function *F, size_t Budget) {
+  std::map<Function *, size_t> Costs;
+
+  while (true) {
+    std::map<Function *, size_t> Frequencies;
+    SmallVector<CallInst *, 8> ToInline;
+    for (BasicBlock &BB : *F) {
+      for (Instruction &I : BB) {
+        if (auto *Call = getCallToInline(&I)) {
+          Function *Callee = Call->getCalledFunction();
+          ++Frequencies[Callee];
+          if (Costs.count(Callee) == 0)
+            Costs[Callee] = getInstructionsCount(Callee);
+          ToInline.push_back(Call);
+        }
+      }
+    }
+
+    auto Compare = [&](CallInst *A, CallInst *B) {
+      Function *ACallee = A->getCalledFunction();
+      Function *BCallee = B->getCalledFunction();
+      if (Costs[ACallee] != Costs[BCallee])
+        return Costs[ACallee] < Costs[BCallee];
+      return Frequencies[ACallee] > Frequencies[BCallee];
+    };
+    llvm::stable_sort(ToInline, Compare);
+
+    bool Changed = false;
+    for (CallInst *Call : ToInline) {
+      Function *Callee = Call->getCalledFunction();
+      size_t Cost = Costs[Callee];
+      if (Cost > Budget)
+        continue;
+
+      Budget -= Cost;
+      doInline(Call);
+      Changed = true;
+    }
+
+    // Inlining might have introduced new calls to helpers, iterate
+    if (not Changed) {
+      for (CallInst *Call : ToInline)
+        SkippedHelpers.push(Call->getCalledFunction()->getName().str());
+      break;
+    }
+  }
+}
+
 class InlineHelpers {
 private:
   LLVMContext &C;
@@ -78,9 +155,17 @@ private:
 };
 
 void InlineHelpers::run(Function *F) {
-  // Fixed-point inlining
-  while (doInline(F))
-    ;
+  auto InitialSize = static_cast<double>(getInstructionsCount(F));
+
+  if (InliningBudget == 0) {
+    // Fixed-point inlining
+    while (doInline(F))
+      ;
+  } else {
+    doInline(F, InliningBudget);
+  }
+
+  FunctionGrowth.push(getInstructionsCount(F) - InitialSize);
 }
 
 bool InlineHelpersPass::runOnFunction(Function &F) {
@@ -12,6 +12,7 @@
 
 #include "revng/ABI/FunctionType.h"
 #include "revng/FunctionIsolation/InvokeIsolatedFunctions.h"
+#include "revng/Model/IRHelpers.h"
 #include "revng/Pipeline/AllRegistries.h"
 #include "revng/Pipeline/Contract.h"
 #include "revng/Pipes/Kinds.h"
@@ -67,25 +68,16 @@ public:
     Context(M->getContext()),
     GCBI(GCBI) {
 
+    auto IsolatedFunctions = indexIsolatedFunctions(*M);
     for (const model::Function &Function : Binary.Functions) {
       if (Function.Type == model::FunctionType::Fake)
         continue;
 
-      // TODO: this temporary
-      auto Name = (Twine("local_") + Function.name()).str();
-      llvm::Function *F = M->getFunction(Name);
+      llvm::Function *F = IsolatedFunctions.lookup(Function.Entry);
       revng_assert(F != nullptr);
-      Map[Function.Entry] = { &Function, nullptr, F };
-    }
-
-    for (BasicBlock &BB : *RootFunction) {
-      revng_assert(not BB.empty());
-
-      MetaAddress JumpTarget = getBasicBlockJumpTarget(&BB);
-      auto It = Map.find(JumpTarget);
-      if (It != Map.end()) {
-        get<1>(It->second) = &BB;
-      }
+      BasicBlock *Entry = GCBI.getBlockAt(Function.Entry);
+      revng_assert(Entry != nullptr);
+      Map[Function.Entry] = { &Function, Entry, F };
     }
   }
 
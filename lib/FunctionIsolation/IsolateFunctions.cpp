@@ -159,6 +159,8 @@ private:
 
 private:
   Function *RootFunction = nullptr;
+  /// Temporary function hosting the blocks of the function being isolated
+  Function *ScratchFunction = nullptr;
   Module *TheModule = nullptr;
   LLVMContext &Context;
   GeneratedCodeBasicInfo &GCBI;
@@ -695,8 +697,8 @@ IFI::cloneAndIdentifyBoundaries(const efa::BasicBlock &Block,
   std::vector<Boundary> Boundaries;
 
   for (BasicBlock *BB : Blocks) {
-    // Clone basic block in root and register it
-    auto *NewBB = CloneBasicBlock(BB, OldToNew, "", RootFunction);
+    // Clone basic block and register it
+    auto *NewBB = CloneBasicBlock(BB, OldToNew, "", ScratchFunction);
     revng_assert(OldToNew.count(BB) == 0);
     OldToNew.insert({ BB, NewBB });
     ClonedBlocks.push_back(NewBB);
@@ -822,8 +824,23 @@ void IFI::isolate(const model::Function &Function) {
   // List of cloned basic blocks, dummy entry and return block are preallocated
   FunctionBlocks ClonedBlocks;
 
+  // Clone the blocks in a temporary function instead of root: this way
+  // CodeExtractor only has to scan the blocks of the function being isolated,
+  // and not the whole root, which would make isolation quadratic
+  revng_assert(ScratchFunction == nullptr);
+  ScratchFunction = Function::Create(RootFunction->getFunctionType(),
+                                     GlobalValue::InternalLinkage,
+                                     "isolation_scratch",
+                                     TheModule);
+  ScratchFunction->copyAttributesFrom(RootFunction);
+  ScratchFunction->setSubprogram(RootFunction->getSubprogram());
+
+  // CodeExtractor cannot extract the entry block of a function
+  auto *ScratchEntry = BasicBlock::Create(Context, "", ScratchFunction);
+  new UnreachableInst(Context, ScratchEntry);
+
   auto CreateBB = [this](StringRef Name) {
-    return BasicBlock::Create(Context, Name, RootFunction, nullptr);
+    return BasicBlock::Create(Context, Name, ScratchFunction, nullptr);
   };
 
   // Create return block
@@ -875,8 +892,7 @@ void IFI::isolate(const model::Function &Function) {
   remapInstructionsInBlocks(ClonedBlocks.Blocks, OldToNew);
 
   // Let CodeExtractor create the new function
-  // TODO: can we hoist CEAC?
-  CodeExtractorAnalysisCache CEAC(*RootFunction);
+  CodeExtractorAnalysisCache CEAC(*ScratchFunction);
   CodeExtractor CE(ClonedBlocks.Blocks,
                    nullptr,
                    false,
@@ -917,6 +933,12 @@ void IFI::isolate(const model::Function &Function) {
   revng_assert(NewFunction->use_empty());
   revng_assert(NewFunction->getBasicBlockList().empty());
   eraseFromParent(NewFunction);
+
+  // Drop what's left of the scratch function, this also detaches its
+  // subprogram
+  ScratchFunction->dropAllReferences();
+  eraseFromParent(ScratchFunction);
+  ScratchFunction = nullptr;
 }
 
 void IFI::createFunctionCall(IRBuilder<> &Builder,
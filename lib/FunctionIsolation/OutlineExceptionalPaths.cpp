@@ -0,0 +1,73 @@
+/// \file OutlineExceptionalPaths.cpp
+/// \brief Move the paths leading to exceptional functions out of the isolated
+///        functions
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Transforms/IPO.h"
+
+#include "revng/Pipeline/AllRegistries.h"
+#include "revng/Pipeline/Contract.h"
+#include "revng/Support/FunctionTags.h"
+
+/// \brief Mark the functions tagged as Exceptional as cold
+///
+/// Calls to these functions (raising exceptions, e.g., upon an unexpected PC,
+/// or QEMU helpers aborting the execution) are not expected to be taken. Being
+/// cold, the blocks calling them are placed out of the hot path and can be
+/// outlined by HotColdSplitting.
+class MarkExceptionalFunctionsColdPass : public llvm::ModulePass {
+public:
+  static char ID;
+
+public:
+  MarkExceptionalFunctionsColdPass() : ModulePass(ID) {}
+
+  bool runOnModule(llvm::Module &M) override {
+    using namespace llvm;
+    bool Changed = false;
+    for (Function &F : FunctionTags::Exceptional.functions(&M)) {
+      if (F.hasFnAttribute(Attribute::Cold))
+        continue;
+
+      F.addFnAttr(Attribute::Cold);
+      Changed = true;
+    }
+
+    return Changed;
+  }
+
+  void getAnalysisUsage(llvm::AnalysisUsage &AU) const override {
+    AU.setPreservesCFG();
+  }
+};
+
+char MarkExceptionalFunctionsColdPass::ID = 0;
+using Register = llvm::RegisterPass<MarkExceptionalFunctionsColdPass>;
+static Register X("mark-exceptional-functions-cold",
+                  "Mark Exceptional Functions Cold Pass",
+                  true,
+                  false);
+
+/// \brief Outline the cold paths of all the functions in the module into
+///        separate functions
+///
+/// The outlined functions are marked as cold and minsize, therefore they are
+/// emitted in .text.unlikely, away from the hot code.
+struct OutlineExceptionalPathsPipe {
+  static constexpr auto Name = "outline-exceptional-paths";
+
+  std::vector<pipeline::ContractGroup> getContract() const { return {}; }
+
+  void registerPasses(llvm::legacy::PassManager &Manager) {
+    Manager.add(new MarkExceptionalFunctionsColdPass());
+    Manager.add(llvm::createHotColdSplittingPass());
+  }
+};
+
+static pipeline::RegisterLLVMPass<OutlineExceptionalPathsPipe> Y;
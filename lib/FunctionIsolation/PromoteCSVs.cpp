@@ -98,7 +98,8 @@ private:
   void promoteCSVs(Function *F);
   Function *createWrapper(const WrapperKey &Key);
   CSVsUsageMap getUsedCSVs(ArrayRef<CallInst *> CallsRange);
-  void wrapCallsToHelpers(Function *F);
+  void collectCallsToWrap(Function *F, std::vector<CallInst *> &ToWrap);
+  void wrapCallsToHelpers(ArrayRef<CallInst *> ToWrap, CSVsUsageMap &UsedCSVs);
 };
 
 PromoteCSVs::PromoteCSVs(Module *M, GeneratedCodeBasicInfo &GCBI) :
@@ -480,7 +481,9 @@ CSVsUsageMap PromoteCSVs::getUsedCSVs(ArrayRef<CallInst *> CallsRange) {
       auto UsedCSVs = getCSVUsedByHelperCall(Call);
       Usage.Read = UsedCSVs.Read;
       Usage.Written = UsedCSVs.Written;
-    } else {
+    } else if (NodeMap.count(Callee) == 0) {
+      // Ensure each callee is visited only once
+      getNode(NodeMap, CallGraph, Callee);
       Queue.push(Callee);
     }
   }
@@ -503,10 +506,10 @@ CSVsUsageMap PromoteCSVs::getUsedCSVs(ArrayRef<CallInst *> CallsRange) {
           Write = true;
           CSV = dyn_cast<GlobalVariable>(skipCasts(Store->getPointerOperand()));
 
-        } else if (auto *Load = dyn_cast<StoreInst>(&I)) {
+        } else if (auto *Load = dyn_cast<LoadInst>(&I)) {
 
           // Record load
-          CSV = dyn_cast<GlobalVariable>(skipCasts(Store->getPointerOperand()));
+          CSV = dyn_cast<GlobalVariable>(skipCasts(Load->getPointerOperand()));
 
         } else if (auto *Call = dyn_cast<CallInst>(&I)) {
           Function *Callee = getCallee(Call);
@@ -563,8 +566,8 @@ ArrayRef<T> oneElement(T &Element) {
   return ArrayRef(&Element, 1);
 }
 
-void PromoteCSVs::wrapCallsToHelpers(Function *F) {
-  std::vector<CallInst *> ToWrap;
+void PromoteCSVs::collectCallsToWrap(Function *F,
+                                     std::vector<CallInst *> &ToWrap) {
   for (BasicBlock &BB : *F) {
     for (Instruction &I : BB) {
       if (auto *Call = dyn_cast<CallInst>(&I)) {
@@ -578,9 +581,10 @@ void PromoteCSVs::wrapCallsToHelpers(Function *F) {
       }
     }
   }
+}
 
-  auto UsedCSVs = getUsedCSVs(ToWrap);
-
+void PromoteCSVs::wrapCallsToHelpers(ArrayRef<CallInst *> ToWrap,
+                                     CSVsUsageMap &UsedCSVs) {
   for (CallInst *Call : ToWrap) {
     CSVsUsage &CSVsUsage = UsedCSVs.get(Call);
 
@@ -592,12 +596,31 @@ void PromoteCSVs::wrapCallsToHelpers(Function *F) {
 }
 
 void PromoteCSVs::run() {
+  // Collect the calls to wrap in all the functions upfront, so that the CSVs
+  // used by the callees that are not helpers are computed once for the whole
+  // module, and not once per caller
+  std::vector<Function *> Functions;
+  std::vector<CallInst *> ToWrap;
+  std::vector<size_t> FirstCall;
   for (Function &F : FunctionTags::ABIEnforced.functions(M)) {
+    Functions.push_back(&F);
+    FirstCall.push_back(ToWrap.size());
+    collectCallsToWrap(&F, ToWrap);
+  }
+  FirstCall.push_back(ToWrap.size());
+
+  // Wrapping calls and promoting CSVs in a function does not affect the other
+  // functions and their callees: they're neither wrapped nor promoted
+  auto UsedCSVs = getUsedCSVs(ToWrap);
+
+  for (size_t I = 0; I < Functions.size(); ++I) {
     // Wrap calls to wrappers
-    wrapCallsToHelpers(&F);
+    ArrayRef<CallInst *> Calls(ToWrap);
+    auto Start = FirstCall[I];
+    wrapCallsToHelpers(Calls.slice(Start, FirstCall[I + 1] - Start), UsedCSVs);
 
     // (Re-)promote CSVs
-    promoteCSVs(&F);
+    promoteCSVs(Functions[I]);
   }
 }
 
@@ -607,3 +630,322 @@ bool PromoteCSVsPass::runOnModule(Module &M) {
   HW.run();
   return true;
 }
+
+char PromoteCSVsInRootPass::ID = 0;
+using RegisterInRoot = RegisterPass<PromoteCSVsInRootPass>;
+static RegisterInRoot XInRoot("promote-csvs-in-root",
+                              "Promote CSVs in the root function Pass",
+                              true,
+                              true);
+
+struct PromoteCSVsInRootPipe {
+  static constexpr auto Name = "promote-csvs-in-root";
+
+  // The root function is preserved, only the way CSVs are accessed changes
+  std::vector<pipeline::ContractGroup> getContract() const { return {}; }
+
+  void registerPasses(llvm::legacy::PassManager &Manager) {
+    Manager.add(new PromoteCSVsInRootPass());
+  }
+};
+
+static pipeline::RegisterLLVMPass<PromoteCSVsInRootPipe> YInRoot;
+
+/// \brief Promote the CSVs accessed by the translated code in the root function
+///
+/// The translated basic blocks (the region) access CSVs through allocas.
+/// Allocas are reloaded from the globals on the edges entering the region from
+/// the dispatcher-related basic blocks and spilled to the globals on the edges
+/// leaving it. Around calls, the globals are kept up to date as well: for
+/// helpers, we restrict ourselves to the CSVs that CPUStateAccessAnalysis
+/// reported as accessed by the call site.
+class PromoteCSVsInRoot {
+private:
+  Function *Root;
+
+  /// CSVs that can be promoted, in a deterministic order
+  std::vector<GlobalVariable *> Candidates;
+
+  /// Translated basic blocks, in function order
+  std::vector<BasicBlock *> RegionBlocks;
+  std::set<BasicBlock *> Region;
+
+  /// CSVs that have been promoted, in a deterministic order
+  std::vector<GlobalVariable *> Promoted;
+  std::map<GlobalVariable *, AllocaInst *> Allocas;
+
+  /// Promoted CSVs stored by the translated code
+  ///
+  /// All the other promoted CSVs are never out of sync with their global
+  /// variable, therefore they never need to be spilled.
+  std::set<GlobalVariable *> Stored;
+
+public:
+  PromoteCSVsInRoot(GeneratedCodeBasicInfo &GCBI);
+
+public:
+  void run();
+
+private:
+  static bool isInRegion(BasicBlock *BB) {
+    using GCBI = GeneratedCodeBasicInfo;
+    return GCBI::isTranslated(BB)
+           or getType(BB) == BlockType::IndirectBranchDispatcherHelperBlock;
+  }
+
+  static bool mayAccessCSVs(CallInst *Call) {
+    Function *Callee = getCallee(Call);
+    if (Callee == nullptr)
+      return true;
+
+    if (Callee->isIntrinsic())
+      return false;
+
+    using namespace FunctionTags;
+    auto Tags = TagsSet::from(Callee);
+    return not(Tags.contains(Marker) or Tags.contains(OpaqueCSVValue));
+  }
+
+  void collectPromotableCSVs();
+  void handleCall(CallInst *Call);
+
+  template<typename FilterType>
+  void spill(IRBuilder<> &Builder, FilterType &&Filter) {
+    for (GlobalVariable *CSV : Promoted)
+      if (Stored.count(CSV) != 0 and Filter(CSV))
+        Builder.CreateStore(Builder.CreateLoad(Allocas.at(CSV)), CSV);
+  }
+
+  template<typename FilterType>
+  void reload(IRBuilder<> &Builder, FilterType &&Filter) {
+    for (GlobalVariable *CSV : Promoted)
+      if (Filter(CSV))
+        Builder.CreateStore(Builder.CreateLoad(CSV), Allocas.at(CSV));
+  }
+
+  void spillAll(IRBuilder<> &Builder) {
+    spill(Builder, [](GlobalVariable *) { return true; });
+  }
+
+  void reloadAll(IRBuilder<> &Builder) {
+    reload(Builder, [](GlobalVariable *) { return true; });
+  }
+};
+
+PromoteCSVsInRoot::PromoteCSVsInRoot(GeneratedCodeBasicInfo &GCBI) :
+  Root(GCBI.root()) {
+
+  const auto &PCCSVs = GCBI.programCounterHandler()->pcCSVs();
+  std::set<GlobalVariable *> Seen;
+  for (GlobalVariable *CSV :
+       llvm::concat<GlobalVariable *const>(GCBI.csvs(), PCCSVs))
+    if (CSV != nullptr and Seen.insert(CSV).second)
+      Candidates.push_back(CSV);
+}
+
+/// \return true if \p C is used by a ConstantExpr other than a cast, directly
+///         or through cast ConstantExprs
+static bool hasNonCastConstantExprUsers(Constant *C) {
+  for (User *U : C->users()) {
+    if (auto *CE = dyn_cast<ConstantExpr>(U)) {
+      if (not CE->isCast() or hasNonCastConstantExprUsers(CE))
+        return true;
+    }
+  }
+
+  return false;
+}
+
+void PromoteCSVsInRoot::collectPromotableCSVs() {
+  std::set<GlobalVariable *> CandidatesSet(Candidates.begin(),
+                                           Candidates.end());
+  auto AsCandidate = [&CandidatesSet](Value *V) -> GlobalVariable * {
+    auto *CSV = dyn_cast_or_null<GlobalVariable>(skipCasts(V));
+    return CandidatesSet.count(CSV) != 0 ? CSV : nullptr;
+  };
+
+  // A CSV can be promoted only if the translated code uses it exclusively as
+  // the pointer operand of loads and stores. If its address escapes (e.g., it
+  // is passed to a helper), the pointee would no longer be the global variable
+  std::set<GlobalVariable *> Accessed;
+  std::set<GlobalVariable *> Escaped;
+
+  // Uses through a non-cast ConstantExpr (e.g., a constant GEP) cannot be
+  // redirected to the alloca: consider the CSV as escaping
+  for (GlobalVariable *CSV : Candidates)
+    if (hasNonCastConstantExprUsers(CSV))
+      Escaped.insert(CSV);
+
+  for (BasicBlock *BB : RegionBlocks) {
+    for (Instruction &I : *BB) {
+      if (auto *Load = dyn_cast<LoadInst>(&I)) {
+        if (auto *CSV = AsCandidate(Load->getPointerOperand()))
+          Accessed.insert(CSV);
+      } else if (auto *Store = dyn_cast<StoreInst>(&I)) {
+        if (auto *CSV = AsCandidate(Store->getPointerOperand())) {
+          Accessed.insert(CSV);
+          Stored.insert(CSV);
+        }
+
+        if (auto *CSV = AsCandidate(Store->getValueOperand()))
+          Escaped.insert(CSV);
+      } else if (not isa<CastInst>(&I)) {
+        // Casts are taken into account by their users
+        for (Value *Operand : I.operands())
+          if (auto *CSV = AsCandidate(Operand))
+            Escaped.insert(CSV);
+      }
+    }
+  }
+
+  for (GlobalVariable *CSV : Candidates)
+    if (Accessed.count(CSV) != 0 and Escaped.count(CSV) == 0)
+      Promoted.push_back(CSV);
+}
+
+void PromoteCSVsInRoot::handleCall(CallInst *Call) {
+  IRBuilder<> Builder(Call);
+  Instruction *Next = Call->getNextNode();
+  revng_assert(Next != nullptr);
+  bool MayReturn = not isa<UnreachableInst>(Next);
+
+  Optional<CSVsUsage> Usage;
+  Function *Callee = getCallee(Call);
+  if (Callee != nullptr and isHelper(Callee))
+    Usage = getCSVUsedByHelperCallIfAvailable(Call);
+
+  if (not Usage) {
+    // We know nothing about the callee: bring all the globals up to date and
+    // reload all of them afterwards
+    spillAll(Builder);
+    if (MayReturn) {
+      Builder.SetInsertPoint(Next);
+      reloadAll(Builder);
+    }
+    return;
+  }
+
+  std::set<GlobalVariable *> Read(Usage->Read.begin(), Usage->Read.end());
+  std::set<GlobalVariable *> Written(Usage->Written.begin(),
+                                     Usage->Written.end());
+  auto IsWritten = [&Written](GlobalVariable *CSV) {
+    return Written.count(CSV) != 0;
+  };
+
+  // Written CSVs are spilled too: the helper might write them only on certain
+  // paths, in which case reloading them must yield the current value
+  spill(Builder, [&Read, &IsWritten](GlobalVariable *CSV) {
+    return Read.count(CSV) != 0 or IsWritten(CSV);
+  });
+
+  if (MayReturn) {
+    Builder.SetInsertPoint(Next);
+    reload(Builder, IsWritten);
+  }
+}
+
+void PromoteCSVsInRoot::run() {
+  for (BasicBlock &BB : *Root) {
+    if (isInRegion(&BB)) {
+      RegionBlocks.push_back(&BB);
+      Region.insert(&BB);
+    }
+  }
+
+  collectPromotableCSVs();
+  if (Promoted.empty())
+    return;
+
+  // Collect what needs to be handled before changing anything
+  std::vector<CallInst *> Calls;
+  std::vector<ReturnInst *> Returns;
+  std::vector<std::pair<BasicBlock *, BasicBlock *>> Exits;
+  std::vector<std::pair<BasicBlock *, SmallVector<BasicBlock *, 2>>> Entries;
+  for (BasicBlock *BB : RegionBlocks) {
+    for (Instruction &I : *BB)
+      if (auto *Call = dyn_cast<CallInst>(&I))
+        if (mayAccessCSVs(Call))
+          Calls.push_back(Call);
+
+    Instruction *Terminator = BB->getTerminator();
+    if (auto *Return = dyn_cast<ReturnInst>(Terminator))
+      Returns.push_back(Return);
+
+    std::set<BasicBlock *> Visited;
+    for (BasicBlock *Successor : successors(Terminator))
+      if (Region.count(Successor) == 0 and Visited.insert(Successor).second)
+        Exits.emplace_back(BB, Successor);
+
+    SmallVector<BasicBlock *, 2> Outside;
+    for (BasicBlock *Predecessor : predecessors(BB))
+      if (Region.count(Predecessor) == 0 and not is_contained(Outside,
+                                                              Predecessor))
+        Outside.push_back(Predecessor);
+
+    if (not Outside.empty())
+      Entries.emplace_back(BB, std::move(Outside));
+  }
+
+  // Create an alloca for each promoted CSV and replace the uses in the region
+  BasicBlock &Entry = Root->getEntryBlock();
+  revng_assert(Region.count(&Entry) == 0);
+  IRBuilder<> AllocaBuilder(&Entry, Entry.begin());
+  auto IsInRegion = [this](Instruction *I) {
+    return Region.count(I->getParent()) != 0;
+  };
+  for (GlobalVariable *CSV : Promoted) {
+    Type *CSVType = CSV->getType()->getPointerElementType();
+    auto *Alloca = AllocaBuilder.CreateAlloca(CSVType, nullptr, CSV->getName());
+    Allocas[CSV] = Alloca;
+    replaceAllUsesIf(CSV, Alloca, IsInRegion);
+  }
+
+  LLVMContext &Context = Root->getContext();
+
+  // Reload on the edges entering the region. Dispatcher-related basic blocks do
+  // not access the allocas, therefore a single reload block can be shared by
+  // all the predecessors outside of the region
+  for (auto &[BB, Predecessors] : Entries) {
+    revng_assert(not isa<PHINode>(BB->begin()));
+    auto *Reload = BasicBlock::Create(Context,
+                                      Twine(BB->getName()) + ".reload",
+                                      Root,
+                                      BB);
+    IRBuilder<> Builder(Reload);
+    reloadAll(Builder);
+    Builder.CreateBr(BB);
+
+    for (BasicBlock *Predecessor : Predecessors)
+      Predecessor->getTerminator()->replaceSuccessorWith(BB, Reload);
+  }
+
+  // Spill on the edges leaving the region. We use a block for each edge, so
+  // that the values to spill do not need to be merged
+  for (auto &[BB, Successor] : Exits) {
+    revng_assert(not isa<PHINode>(Successor->begin()));
+    auto *Spill = BasicBlock::Create(Context,
+                                     Twine(BB->getName()) + ".spill",
+                                     Root,
+                                     BB->getNextNode());
+    IRBuilder<> Builder(Spill);
+    spillAll(Builder);
+    Builder.CreateBr(Successor);
+
+    BB->getTerminator()->replaceSuccessorWith(Successor, Spill);
+  }
+
+  for (ReturnInst *Return : Returns) {
+    IRBuilder<> Builder(Return);
+    spillAll(Builder);
+  }
+
+  for (CallInst *Call : Calls)
+    handleCall(Call);
+}
+
+bool PromoteCSVsInRootPass::runOnModule(Module &M) {
+  auto &GCBI = getAnalysis<GeneratedCodeBasicInfoWrapperPass>().getGCBI();
+  PromoteCSVsInRoot Promoter(GCBI);
+  Promoter.run();
+  return true;
+}
@@ -29,14 +29,16 @@ Instruction *StructInitializers::createReturn(IRBuilder<> &Builder,
   auto *FT = Builder.GetInsertBlock()->getParent()->getFunctionType();
   auto *ReturnType = cast<StructType>(FT->getReturnType());
 
-  SmallVector<Type *, 8> Types;
-  llvm::copy(ReturnType->elements(), std::back_inserter(Types));
-
-  // Create struct_initializer
-  Function *Initializer = Pool.get(ReturnType,
-                                   ReturnType,
-                                   Types,
-                                   StructInitializerPrefix);
+  // Initializers are recorded in the module, and we picked them up upon
+  // construction: in the common case the initializer already exists
+  Function *Initializer = Pool.find(ReturnType);
+  if (Initializer == nullptr) {
+    // Create struct_initializer
+    Initializer = Pool.get(ReturnType,
+                           ReturnType,
+                           ReturnType->elements(),
+                           StructInitializerPrefix);
+  }
 
   // Lazily populate its body
   if (Initializer->isDeclaration()) {
@@ -6,6 +6,9 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <map>
+#include <memory_resource>
+#include <set>
 #include <sstream>
 #include <stack>
 #include <string>
@@ -21,10 +24,13 @@
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include "revng/ADT/SmallFlatSet.h"
 #include "revng/Support/Debug.h"
 #include "revng/Support/IRHelpers.h"
 
 #include "CPUStateAccessAnalysisPass.h"
+#include "CSVAccessCache.h"
+#include "LiftProfile.h"
 #include "VariableManager.h"
 
 namespace llvm {
@@ -926,8 +932,11 @@ static int getBit(uint64_t Input, int Shift) {
   return (Input >> Shift) & 1;
 };
 
-using CallSiteOffsetMap = std::map<CallInst *, CSVOffsets>;
-using ValueCallSiteOffsetMap = std::map<Value *, CallSiteOffsetMap>;
+// These maps use polymorphic allocators so that CPUStateAccessOffsetAnalysis
+// can allocate them, and the maps nested in them, from its own arena. Maps
+// constructed without an explicit resource use the global heap.
+using CallSiteOffsetMap = std::pmr::map<CallInst *, CSVOffsets>;
+using ValueCallSiteOffsetMap = std::pmr::map<Value *, CallSiteOffsetMap>;
 using OptCSVOffsets = llvm::Optional<CSVOffsets>;
 
 /// \brief This class is used to fold constant offsets on different instructions
@@ -935,7 +944,7 @@ template<class T>
 class CRTPOffsetFolder {
 
 protected:
-  using offset_iterator = std::set<int64_t>::const_iterator;
+  using offset_iterator = CSVOffsets::const_iterator;
   using offset_iterator_range = llvm::iterator_range<offset_iterator>;
   using OffsetPair = std::pair<const CSVOffsets *, const CSVOffsets *>;
 
@@ -1274,7 +1283,7 @@ private:
           auto IdxIt = GEP->idx_begin();
           auto IdxEnd = GEP->idx_end();
           int IdxOpNum = 1;
-          std::set<int64_t> LastTypeOffsets = { 0 };
+          CSVOffsets::OffsetSet LastTypeOffsets = { 0 };
 
           for (; IdxIt != IdxEnd; ++IdxIt, ++IdxOpNum) {
             const CSVOffsets *IdxCSVOffset = OffsetTuple[IdxOpNum];
@@ -1463,6 +1472,12 @@ private:
   CallSiteOffsetMap &CallSiteStoreOffsets; // result, maps call in root to store
                                            // offsets
 
+  // All the temporary data structures of the analysis are allocated here, and
+  // released at once when the analysis of the root function is over. Arena
+  // bump-allocates the memory, Pool recycles the freed blocks.
+  std::pmr::monotonic_buffer_resource Arena;
+  std::pmr::unsynchronized_pool_resource Pool;
+
   // ValueCallSiteOffsets is used to keep track of the offsets associated with
   // each value. The primary key is the `Value` for which we're tracking the
   // offsets. The secondary key is a `CallInst` representing a call site in
@@ -1477,10 +1492,10 @@ private:
   ValueCallSiteOffsetMap LoadCallSiteOffsets;
   ValueCallSiteOffsetMap StoreCallSiteOffsets;
 
-  CallPtrSet CrossedCallSites;
-  using WorkListVector = std::vector<WorkItem>;
+  std::pmr::set<CallInst *> CrossedCallSites;
+  using WorkListVector = std::pmr::vector<WorkItem>;
   WorkListVector WorkList;
-  ConstValuePtrSet InExploration;
+  std::pmr::set<const Value *> InExploration;
 
   // Helper folders
   AddSubOffsetFolder AddSubFolder;
@@ -1516,12 +1531,14 @@ public:
     StoreOffsets(StoreOff),
     CallSiteLoadOffsets(CallSiteLoadOff),
     CallSiteStoreOffsets(CallSiteStoreOff),
-    ValueCallSiteOffsets(),
-    LoadCallSiteOffsets(),
-    StoreCallSiteOffsets(),
-    CrossedCallSites(),
-    WorkList(),
-    InExploration(),
+    Arena(),
+    Pool(&Arena),
+    ValueCallSiteOffsets(&Pool),
+    LoadCallSiteOffsets(&Pool),
+    StoreCallSiteOffsets(&Pool),
+    CrossedCallSites(&Pool),
+    WorkList(&Pool),
+    InExploration(&Pool),
     AddSubFolder(M),
     NumericFolder(M),
     GEPFolder(M),
@@ -1532,12 +1549,12 @@ public:
 
 private:
   void cleanup() {
-    ValueCallSiteOffsets = {};
-    LoadCallSiteOffsets = {};
-    StoreCallSiteOffsets = {};
-    CrossedCallSites = {};
-    WorkList = {};
-    InExploration = {};
+    ValueCallSiteOffsets.clear();
+    LoadCallSiteOffsets.clear();
+    StoreCallSiteOffsets.clear();
+    CrossedCallSites.clear();
+    WorkList.clear();
+    InExploration.clear();
   }
 
   /// \brief Analyzes the access to env performed by \p I, saving results
@@ -1802,7 +1819,8 @@ void CPUSAOA::computeOffsetsFromSources(const WorkItem &Item, bool IsLoad) {
 
     SmallVector<const CallSiteOffsetMap *, 10> SrcCallSiteOffsets;
     SrcCallSiteOffsets.reserve(Item.getNumSources());
-    std::map<CallInst *, std::set<WorkItem::size_type>> CallSiteSrcIds;
+    using SourceIndices = SmallFlatSet<WorkItem::size_type>;
+    std::pmr::map<CallInst *, SourceIndices> CallSiteSrcIds(&Pool);
 
     // This loop fills `SrcCallSiteOffsets` so that its n-th element will point
     // to the `CallSiteOffsetMap` associated with the n-th source of the Value
@@ -2306,7 +2324,7 @@ void CPUSAOA::computeAggregatedOffsets() {
           New = O;
         } else {
           revng_assert(O.size());
-          std::set<int64_t> FineGrainedOffsets;
+          CSVOffsets::OffsetSet FineGrainedOffsets;
           // Now compute the fine-grained offsets
           for (const int64_t Coarse : O) {
             int64_t Refined = Coarse;
@@ -3271,8 +3289,20 @@ bool CPUStateAccessAnalysis::run() {
 }
 
 bool CPUStateAccessAnalysisPass::runOnModule(Module &Mod) {
+  LiftProfile &Profile = LiftProfile::get();
+  auto Measurement = Profile.measure(LiftPhase::CPUStateAccessAnalysis);
+
+  // In lazy mode calls that are already decorated are not analyzed again
+  bool UseCache = Lazy and Cache != nullptr;
+  bool Decorated = UseCache and Cache->apply(Mod) != 0;
+
   CPUStateAccessAnalysis AccessAnalysis(Mod, Variables, Lazy);
-  return AccessAnalysis.run();
+  bool Result = AccessAnalysis.run();
+
+  if (UseCache)
+    Cache->record(Mod);
+
+  return Result or Decorated;
 }
 
 char CPUStateAccessAnalysisPass::ID = 0;
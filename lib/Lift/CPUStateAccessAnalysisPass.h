@@ -18,6 +18,7 @@ namespace llvm {
 class Instruction;
 }
 
+class CSVAccessCache;
 class VariableManager;
 
 /// \brief LLVM pass to analyze the access patterns to the CPU State Variable
@@ -28,16 +29,21 @@ public:
 private:
   const bool Lazy;
   VariableManager *Variables;
+  CSVAccessCache *Cache;
 
 public:
   static char ID;
 
 public:
   CPUStateAccessAnalysisPass() :
-    llvm::ModulePass(ID), Lazy(false), Variables(nullptr){};
-
-  CPUStateAccessAnalysisPass(VariableManager *VM, bool IsLazy = false) :
-    llvm::ModulePass(ID), Lazy(IsLazy), Variables(VM){};
+    llvm::ModulePass(ID), Lazy(false), Variables(nullptr), Cache(nullptr){};
+
+  /// \param Cache if not null and \p IsLazy, the accesses of the calls to
+  ///        helpers are looked up in and recorded into it
+  CPUStateAccessAnalysisPass(VariableManager *VM,
+                             bool IsLazy = false,
+                             CSVAccessCache *Cache = nullptr) :
+    llvm::ModulePass(ID), Lazy(IsLazy), Variables(VM), Cache(Cache){};
 
 public:
   virtual bool runOnModule(llvm::Module &TheModule) override;
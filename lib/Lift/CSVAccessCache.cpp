@@ -0,0 +1,288 @@
+/// \file CSVAccessCache.cpp
+/// \brief Cache of the CPU state accesses of the calls to QEMU helpers.
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "revng/Support/CommandLine.h"
+#include "revng/Support/Debug.h"
+#include "revng/Support/IRHelpers.h"
+
+#include "CSVAccessCache.h"
+
+using namespace llvm;
+
+static cl::opt<std::string> CacheDirectory("csv-access-cache-dir",
+                                           cl::desc("directory where the CPU "
+                                                    "state accesses of the "
+                                                    "helpers are cached"),
+                                           cl::value_desc("directory"),
+                                           cl::cat(MainCategory));
+
+static Logger<> Log("csv-access-cache");
+
+/// Bump this whenever CPUStateAccessAnalysisPass changes its results
+static constexpr const char *FormatHeader = "revng-csv-access-cache 1";
+
+CSVAccessCache::CSVAccessCache(uint64_t HelpersHash) {
+  if (CacheDirectory.empty())
+    return;
+
+  SmallString<128> FilePath(CacheDirectory);
+  sys::path::append(FilePath, "csv-access-" + utohexstr(HelpersHash) + ".txt");
+  Path = FilePath.str().str();
+  load();
+}
+
+/// \return a string representing \p V if it is a constant or an address in the
+///         CPU state at a constant offset
+static std::optional<std::string> describeArgument(const Value *V) {
+  if (auto *Cast = dyn_cast<CastInst>(V))
+    if (Cast->isNoopCast(getModule(Cast)->getDataLayout())
+        or isa<IntToPtrInst>(Cast) or isa<PtrToIntInst>(Cast))
+      return describeArgument(Cast->getOperand(0));
+
+  if (auto *Constant = dyn_cast<ConstantInt>(V))
+    return "i" + std::to_string(Constant->getSExtValue());
+
+  if (isa<ConstantPointerNull>(V))
+    return std::string("null");
+
+  if (auto *Load = dyn_cast<LoadInst>(V)) {
+    auto *Pointer = Load->getPointerOperand()->stripPointerCasts();
+    if (auto *CSV = dyn_cast<GlobalVariable>(Pointer))
+      if (CSV->getName() == "env")
+        return std::string("env");
+  }
+
+  if (auto *Add = dyn_cast<BinaryOperator>(V)) {
+    if (Add->getOpcode() == Instruction::Add) {
+      auto Base = describeArgument(Add->getOperand(0));
+      auto *Offset = dyn_cast<ConstantInt>(Add->getOperand(1));
+      if (Base and *Base == "env" and Offset != nullptr)
+        return "env+" + std::to_string(Offset->getSExtValue());
+    }
+  }
+
+  return std::nullopt;
+}
+
+std::optional<std::string> CSVAccessCache::getKey(const CallInst *Call) {
+  const Function *Callee = getCallee(Call);
+  if (Callee == nullptr)
+    return std::nullopt;
+
+  std::string Result = Callee->getName().str();
+  for (const Use &Argument : Call->args()) {
+    auto Description = describeArgument(Argument.get());
+    if (not Description)
+      return std::nullopt;
+    Result += "," + *Description;
+  }
+
+  return Result;
+}
+
+std::optional<CSVAccessCache::Access>
+CSVAccessCache::parseAccess(const MDNode *Node) {
+  auto *Tuple = dyn_cast_or_null<MDTuple>(Node);
+  if (Tuple == nullptr or Tuple->getNumOperands() != 2)
+    return std::nullopt;
+
+  QuickMetadata QMD(Node->getContext());
+  Access Result;
+  Result.Unknown = QMD.extract<uint32_t>(Tuple, 0) != 0;
+  for (const MDOperand &Operand : QMD.extract<MDTuple *>(Tuple, 1)->operands())
+    Result.Variables.push_back(QMD.extract<Constant *>(Operand.get())
+                                 ->getName()
+                                 .str());
+
+  return Result;
+}
+
+MDNode *CSVAccessCache::buildAccess(Module &M, const Access &A) {
+  QuickMetadata QMD(M.getContext());
+  SmallVector<Metadata *, 10> Variables;
+  for (const std::string &Name : A.Variables) {
+    GlobalVariable *CSV = M.getGlobalVariable(Name, true);
+    if (CSV == nullptr)
+      return nullptr;
+    Variables.push_back(QMD.get(CSV));
+  }
+
+  return QMD.tuple({ QMD.get(static_cast<uint32_t>(A.Unknown)),
+                     QMD.tuple(Variables) });
+}
+
+unsigned CSVAccessCache::apply(Module &M) const {
+  if (Entries.empty())
+    return 0;
+
+  Function *Root = M.getFunction("root");
+  if (Root == nullptr)
+    return 0;
+
+  const auto LoadMDKind = M.getMDKindID("revng.csvaccess.offsets.load");
+  const auto StoreMDKind = M.getMDKindID("revng.csvaccess.offsets.store");
+
+  unsigned Result = 0;
+  for (BasicBlock &BB : *Root) {
+    for (Instruction &I : BB) {
+      CallInst *Call = getCallToHelper(&I);
+      if (Call == nullptr or Call->getMetadata(LoadMDKind) != nullptr
+          or Call->getMetadata(StoreMDKind) != nullptr)
+        continue;
+
+      auto Key = getKey(Call);
+      if (not Key)
+        continue;
+
+      auto It = Entries.find(*Key);
+      if (It == Entries.end())
+        continue;
+
+      MDNode *Load = buildAccess(M, It->second.Load);
+      MDNode *Store = buildAccess(M, It->second.Store);
+      if (Load == nullptr or Store == nullptr)
+        continue;
+
+      Call->setMetadata(LoadMDKind, Load);
+      Call->setMetadata(StoreMDKind, Store);
+      ++Result;
+    }
+  }
+
+  revng_log(Log, "Decorated " << Result << " calls from the cache");
+  return Result;
+}
+
+void CSVAccessCache::record(const Module &M) {
+  const Function *Root = M.getFunction("root");
+  if (Root == nullptr)
+    return;
+
+  const auto LoadMDKind = M.getMDKindID("revng.csvaccess.offsets.load");
+  const auto StoreMDKind = M.getMDKindID("revng.csvaccess.offsets.store");
+
+  for (const BasicBlock &BB : *Root) {
+    for (const Instruction &I : BB) {
+      const CallInst *Call = getCallToHelper(&I);
+      if (Call == nullptr)
+        continue;
+
+      auto Load = parseAccess(Call->getMetadata(LoadMDKind));
+      auto Store = parseAccess(Call->getMetadata(StoreMDKind));
+      if (not Load or not Store)
+        continue;
+
+      auto Key = getKey(Call);
+      if (not Key)
+        continue;
+
+      bool New = Entries.emplace(*Key, Entry{ *Load, *Store }).second;
+      Dirty = Dirty or New;
+    }
+  }
+}
+
+void CSVAccessCache::save() {
+  if (Path.empty() or not Dirty)
+    return;
+
+  // Write to a temporary file and rename it, so that concurrent invocations
+  // never observe a partially written cache
+  SmallString<128> Directory(Path);
+  sys::path::remove_filename(Directory);
+  if (sys::fs::create_directories(Directory)) {
+    revng_log(Log, "Cannot create " << Directory.str());
+    return;
+  }
+
+  int FD = 0;
+  SmallString<128> TemporaryPath;
+  if (sys::fs::createUniqueFile(Path + ".%%%%%%", FD, TemporaryPath)) {
+    revng_log(Log, "Cannot create a temporary file for " << Path);
+    return;
+  }
+
+  const auto WriteAccess = [](raw_ostream &OS, const Access &A) {
+    OS << (A.Unknown ? "1" : "0") << ":";
+    OS << join(A.Variables.begin(), A.Variables.end(), " ");
+  };
+
+  {
+    raw_fd_ostream OS(FD, true);
+    OS << FormatHeader << "\n";
+    for (const auto &[Key, Value] : Entries) {
+      OS << Key << "\t";
+      WriteAccess(OS, Value.Load);
+      OS << "\t";
+      WriteAccess(OS, Value.Store);
+      OS << "\n";
+    }
+  }
+
+  if (sys::fs::rename(TemporaryPath, Path)) {
+    sys::fs::remove(TemporaryPath);
+    revng_log(Log, "Cannot write " << Path);
+    return;
+  }
+
+  Dirty = false;
+}
+
+void CSVAccessCache::load() {
+  auto MaybeBuffer = MemoryBuffer::getFile(Path);
+  if (not MaybeBuffer)
+    return;
+
+  SmallVector<StringRef, 64> Lines;
+  (*MaybeBuffer)->getBuffer().split(Lines, '\n', -1, false);
+  if (Lines.empty() or Lines[0] != FormatHeader) {
+    revng_log(Log, "Ignoring " << Path << ": unexpected format");
+    return;
+  }
+
+  const auto ParseAccess = [](StringRef Field) -> std::optional<Access> {
+    // <unknown>[:<variable> ...]
+    auto [Unknown, Variables] = Field.split(':');
+    if (Unknown != "0" and Unknown != "1")
+      return std::nullopt;
+
+    Access Result;
+    Result.Unknown = Unknown == "1";
+    SmallVector<StringRef, 8> Names;
+    Variables.split(Names, ' ', -1, false);
+    for (StringRef Name : Names)
+      Result.Variables.push_back(Name.str());
+    return Result;
+  };
+
+  for (StringRef Line : llvm::drop_begin(Lines)) {
+    SmallVector<StringRef, 3> Fields;
+    Line.split(Fields, '\t');
+    if (Fields.size() != 3)
+      continue;
+
+    auto Load = ParseAccess(Fields[1]);
+    auto Store = ParseAccess(Fields[2]);
+    if (Load and Store)
+      Entries.emplace(Fields[0].str(), Entry{ *Load, *Store });
+  }
+
+  revng_log(Log, "Loaded " << Entries.size() << " entries from " << Path);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/StringRef.h"
+
+namespace llvm {
+class CallInst;
+class MDNode;
+class Module;
+} // namespace llvm
+
+/// \brief Cache of the CPU state accesses of the calls to QEMU helpers
+///
+/// CPUStateAccessAnalysisPass decorates each call to a helper with the CSVs it
+/// might load or store. When all the arguments of a call are constants or the
+/// CPU state pointer, this information depends only on the helpers module: it
+/// is recorded here, keyed by the callee and its arguments, and attached to the
+/// matching calls of the following runs, which the lazy analysis then skips.
+///
+/// Entries are persisted, one file per helpers module hash, in the directory
+/// specified by -csv-access-cache-dir, if any, so that they can be reused by
+/// other invocations for the same architecture.
+class CSVAccessCache {
+private:
+  struct Access {
+    bool Unknown = false;
+    std::vector<std::string> Variables;
+  };
+
+  struct Entry {
+    Access Load;
+    Access Store;
+  };
+
+private:
+  std::string Path;
+  std::map<std::string, Entry> Entries;
+  bool Dirty = false;
+
+public:
+  /// \param HelpersHash a hash of the content of the helpers module
+  explicit CSVAccessCache(uint64_t HelpersHash);
+
+public:
+  /// \brief Decorates the calls to helpers in root with the cached accesses
+  ///
+  /// \return the number of decorated calls
+  unsigned apply(llvm::Module &M) const;
+
+  /// \brief Records the accesses of the decorated, cacheable, calls in root
+  void record(const llvm::Module &M);
+
+  /// \brief Writes the cache on disk, if it has been modified
+  void save();
+
+private:
+  static std::optional<std::string> getKey(const llvm::CallInst *Call);
+  static std::optional<Access> parseAccess(const llvm::MDNode *Node);
+  static llvm::MDNode *buildAccess(llvm::Module &M, const Access &A);
+
+  void load();
+};
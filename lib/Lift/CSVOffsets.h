@@ -4,8 +4,9 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
-#include <set>
+#include <utility>
 
+#include "revng/ADT/SmallFlatSet.h"
 #include "revng/Support/Assert.h"
 
 template<bool StaticallyEnabled>
@@ -15,10 +16,8 @@ class Logger;
 ///        set of possible offsets.
 class CSVOffsets {
 
-private:
-  using OffsetSet = std::set<int64_t>;
-
 public:
+  using OffsetSet = SmallFlatSet<int64_t, 4>;
   using iterator = OffsetSet::iterator;
   using const_iterator = OffsetSet::const_iterator;
   using size_type = OffsetSet::size_type;
@@ -66,7 +65,7 @@ public:
     // Useful for debug revng_assert(not isUnknown(K) and not
     // isUnknownInPtr(K));
   }
-  CSVOffsets(Kind K, std::set<int64_t> O) : OffsetKind(K), Offsets(O) {
+  CSVOffsets(Kind K, OffsetSet O) : OffsetKind(K), Offsets(std::move(O)) {
     // Useful for debug revng_assert(not isUnknown(K) and not
     // isUnknownInPtr(K));
   }
@@ -9,6 +9,7 @@
 #include <cstring>
 #include <fstream>
 #include <memory>
+#include <optional>
 #include <queue>
 #include <set>
 #include <sstream>
@@ -17,7 +18,11 @@
 #include <vector>
 
 #include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/Config/llvm-config.h"
 #include "llvm/ExecutionEngine/RuntimeDyld.h"
 #include "llvm/IR/CFG.h"
 #include "llvm/IR/DiagnosticPrinter.h"
@@ -29,8 +34,12 @@
 #include "llvm/IRReader/IRReader.h"
 #include "llvm/Linker/Linker.h"
 #include "llvm/Support/Casting.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/raw_os_ostream.h"
+#include "llvm/Support/xxhash.h"
 #include "llvm/Transforms/InstCombine/InstCombine.h"
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/Utils.h"
@@ -48,11 +57,14 @@
 #include "revng/Support/Debug.h"
 #include "revng/Support/FunctionTags.h"
 #include "revng/Support/ProgramCounterHandler.h"
+#include "revng/Support/SharedFiles.h"
 
+#include "CSVAccessCache.h"
 #include "CodeGenerator.h"
 #include "ExternalJumpsHandler.h"
 #include "InstructionTranslator.h"
 #include "JumpTargetManager.h"
+#include "LiftProfile.h"
 #include "PTCInterface.h"
 #include "VariableManager.h"
 
@@ -66,6 +78,82 @@ static cl::opt<bool> RecordPTC("record-ptc",
                                cl::desc("create metadata for PTC"),
                                cl::cat(MainCategory));
 
+static cl::opt<std::string> PTCDumpPath("ptc-dump",
+                                        cl::desc("stream the assembly "
+                                                 "and the PTC of the lifted "
+                                                 "instructions to a binary "
+                                                 "file, instead of recording "
+                                                 "them in the module"),
+                                        cl::value_desc("path"),
+                                        cl::cat(MainCategory));
+
+static cl::opt<unsigned> PTCDumpSampling("ptc-dump-sampling",
+                                         cl::desc("record in the file "
+                                                  "specified by -ptc-dump "
+                                                  "only one instruction "
+                                                  "every N"),
+                                         cl::value_desc("N"),
+                                         cl::init(1),
+                                         cl::cat(MainCategory));
+
+static cl::opt<bool> ProfileCounters("profile-counters",
+                                     cl::desc("instrument the jump targets "
+                                              "with execution and dispatch "
+                                              "counters, dumped at exit to "
+                                              "REVNG_PROFILE_PATH"),
+                                     cl::cat(MainCategory));
+
+static cl::opt<std::string> DispatcherProfile("dispatcher-profile",
+                                              cl::desc("profile produced by a "
+                                                       "program lifted with "
+                                                       "-profile-counters, "
+                                                       "used to test the "
+                                                       "hottest targets "
+                                                       "before the "
+                                                       "dispatcher"),
+                                              cl::value_desc("path"),
+                                              cl::cat(MainCategory));
+
+static cl::opt<unsigned> DispatcherHotTargets("dispatcher-hot-targets",
+                                              cl::desc("number of targets "
+                                                       "tested before the "
+                                                       "dispatcher when "
+                                                       "-dispatcher-profile "
+                                                       "is used"),
+                                              cl::init(8),
+                                              cl::cat(MainCategory));
+
+static cl::opt<bool> Superblocks("superblocks",
+                                 cl::desc("fuse straight-line runs of "
+                                          "translated blocks and track the PC "
+                                          "of the instructions in them "
+                                          "through metadata instead of calls "
+                                          "to newpc"),
+                                 cl::cat(MainCategory));
+
+static cl::opt<bool> LazyFlags("lazy-flags",
+                                cl::desc("drop the stores to the CSVs of the "
+                                         "condition flags which are "
+                                         "overwritten before being read"),
+                                cl::cat(MainCategory));
+
+static cl::opt<unsigned> DispatcherTables("dispatcher-tables",
+                                          cl::desc("dispatch through a "
+                                                   "perfect hash table the "
+                                                   "addresses of switches "
+                                                   "with at least this many "
+                                                   "cases (0 to disable)"),
+                                          cl::init(0),
+                                          cl::cat(MainCategory));
+
+using StringOpt = cl::opt<std::string>;
+static StringOpt PreparedHelpersDirectory("prepared-helpers-dir",
+                                          cl::desc("directory where the "
+                                                   "helpers module, ready to "
+                                                   "be linked, is cached"),
+                                          cl::value_desc("directory"),
+                                          cl::cat(MainCategory));
+
 static Logger<> PTCLog("ptc");
 static Logger<> Log("lift");
 
@@ -74,6 +162,67 @@ inline std::array<T, sizeof...(ArgTypes)> make_array(ArgTypes &&...Args) {
   return { { std::forward<ArgTypes>(Args)... } };
 }
 
+namespace {
+
+/// The PTC translation of the code starting at a jump target
+struct DecodedCode {
+  PTCInstructionListPtr InstructionList;
+
+  /// Number of bytes of code that have been translated
+  size_t ConsumedSize = 0;
+
+  /// The address where the translation has to be aborted, or invalid if the
+  /// code doesn't extend into a page we know contains no code
+  MetaAddress AbortAt = MetaAddress::invalid();
+};
+
+} // namespace
+
+/// Translates to PTC the code starting at \p VirtualAddress
+///
+/// This step is independent from the IR emission, which is the only one that
+/// needs to touch the module under construction and the JumpTargetManager.
+///
+/// \note libtinycode keeps its state (CPU state, TCG context) in globals,
+///       therefore this must not run concurrently with itself, not even on
+///       different addresses.
+static DecodedCode
+decode(MetaAddress VirtualAddress,
+       const std::set<MetaAddress> &NoMoreCodeBoundaries) {
+  DecodedCode Result;
+  Result.InstructionList.reset(new PTCInstructionList);
+
+  PTCCodeType Type = PTC_CODE_REGULAR;
+
+  switch (VirtualAddress.type()) {
+  case MetaAddressType::Invalid:
+    revng_abort();
+
+  case MetaAddressType::Code_arm_thumb:
+    Type = PTC_CODE_ARM_THUMB;
+    break;
+
+  default:
+    Type = PTC_CODE_REGULAR;
+    break;
+  }
+
+  Result.ConsumedSize = ptc.translate(VirtualAddress.address(),
+                                      Type,
+                                      Result.InstructionList.get());
+
+  // Check whether we ended up in an unmapped page
+  MetaAddress LastByte = VirtualAddress.toGeneric()
+                         + (Result.ConsumedSize - 1);
+  if (VirtualAddress.pageStart() != LastByte.pageStart()) {
+    MetaAddress NextPage = VirtualAddress.nextPageStart();
+    if (NoMoreCodeBoundaries.count(NextPage) != 0)
+      Result.AbortAt = NextPage;
+  }
+
+  return Result;
+}
+
 /// Wrap a value around a temporary opaque function
 ///
 /// Useful to prevent undesired optimizations
@@ -131,10 +280,23 @@ public:
 // Outline the destructor for the sake of privacy in the header
 CodeGenerator::~CodeGenerator() = default;
 
-static std::unique_ptr<Module> parseIR(StringRef Path, LLVMContext &Context) {
+static MemoryBufferRef readSharedFile(StringRef Path) {
+  // The same modules are loaded by all the pipelines of the process
+  auto MaybeBuffer = revng::getSharedFile(Path);
+  if (not MaybeBuffer) {
+    dbg << "Cannot read " << Path.str() << ": "
+        << MaybeBuffer.getError().message() << "\n";
+    revng_abort();
+  }
+
+  return *MaybeBuffer;
+}
+
+static std::unique_ptr<Module>
+parseIR(MemoryBufferRef Buffer, LLVMContext &Context) {
   std::unique_ptr<Module> Result;
   SMDiagnostic Errors;
-  Result = parseIRFile(Path, Errors, Context);
+  Result = llvm::parseIR(Buffer, Errors, Context);
 
   if (Result.get() == nullptr) {
     Errors.print("revng", dbgs());
@@ -144,6 +306,53 @@ static std::unique_ptr<Module> parseIR(StringRef Path, LLVMContext &Context) {
   return Result;
 }
 
+static std::unique_ptr<Module> parseIR(StringRef Path, LLVMContext &Context) {
+  return parseIR(readSharedFile(Path), Context);
+}
+
+/// Version of the transformations performed by CodeGenerator::prepareHelpers
+///
+/// Bump it whenever they change, so that stale prepared helpers are ignored.
+static constexpr unsigned PreparedHelpersVersion = 1;
+
+/// \return the path of the prepared version of the helpers module with hash
+///         \p HelpersHash, or an empty string if the cache is disabled
+static std::string getPreparedHelpersPath(uint64_t HelpersHash) {
+  if (PreparedHelpersDirectory.empty())
+    return "";
+
+  // The transformations applied to the helpers depend on libtinycode too, and
+  // the bitcode can be read back only by the same version of LLVM
+  std::string Name = "helpers-v" + std::to_string(PreparedHelpersVersion)
+                     + "-llvm" LLVM_VERSION_STRING "-" + utohexstr(HelpersHash)
+                     + "-" + std::to_string(ptc.exception_index) + ".bc";
+  SmallString<128> Result(PreparedHelpersDirectory);
+  sys::path::append(Result, Name);
+  return Result.str().str();
+}
+
+/// \brief Writes \p HelpersModule to \p Path, atomically
+static void storePreparedHelpers(const Module &HelpersModule,
+                                 const std::string &Path) {
+  SmallString<128> Directory(Path);
+  sys::path::remove_filename(Directory);
+  if (sys::fs::create_directories(Directory))
+    return;
+
+  int FD = 0;
+  SmallString<128> TemporaryPath;
+  if (sys::fs::createUniqueFile(Path + ".%%%%%%", FD, TemporaryPath))
+    return;
+
+  {
+    raw_fd_ostream OS(FD, true);
+    WriteBitcodeToFile(HelpersModule, OS);
+  }
+
+  if (sys::fs::rename(TemporaryPath, Path))
+    sys::fs::remove(TemporaryPath);
+}
+
 CodeGenerator::CodeGenerator(const RawBinaryView &RawBinary,
                              llvm::Module *TheModule,
                              const TupleTree<model::Binary> &Model,
@@ -159,7 +368,20 @@ CodeGenerator::CodeGenerator(const RawBinaryView &RawBinary,
   OriginalInstrMDKind = Context.getMDKindID("oi");
   PTCInstrMDKind = Context.getMDKindID("pi");
 
-  HelpersModule = parseIR(Helpers, Context);
+  // The CPU state accesses of the helpers depend only on the helpers module
+  MemoryBufferRef HelpersBuffer = readSharedFile(Helpers);
+  HelpersHash = xxHash64(HelpersBuffer.getBuffer());
+
+  // Use the helpers module prepared by a previous run, if available
+  PreparedHelpersPath = getPreparedHelpersPath(HelpersHash);
+  const std::string &Prepared = PreparedHelpersPath;
+  if (not Prepared.empty() and sys::fs::exists(Prepared)) {
+    revng_log(Log, "Loading prepared helpers from " << PreparedHelpersPath);
+    HelpersModule = parseIR(PreparedHelpersPath, Context);
+    HelpersArePrepared = true;
+  } else {
+    HelpersModule = parseIR(HelpersBuffer, Context);
+  }
 
   TheModule->setDataLayout(HelpersModule->getDataLayout());
 
@@ -577,18 +799,7 @@ bool CpuLoopExitPass::runOnModule(llvm::Module &M) {
   return true;
 }
 
-void CodeGenerator::translate(Optional<uint64_t> RawVirtualAddress) {
-  using FT = FunctionType;
-
-  // Declare the abort function
-  auto *AbortTy = FunctionType::get(Type::getVoidTy(Context), false);
-  FunctionCallee AbortFunction = TheModule->getOrInsertFunction("abort",
-                                                                AbortTy);
-  {
-    auto *Abort = cast<Function>(skipCasts(AbortFunction.getCallee()));
-    FunctionTags::Exceptional.addTo(Abort);
-  }
-
+void CodeGenerator::prepareHelpers() {
   // Prepare the helper modules by transforming the cpu_loop function and
   // running SROA
   legacy::PassManager CpuLoopPM;
@@ -600,14 +811,6 @@ void CodeGenerator::translate(Optional<uint64_t> RawVirtualAddress) {
   // Drop the main
   eraseFromParent(HelpersModule->getFunction("main"));
 
-  // From syscall.c
-  new GlobalVariable(*TheModule,
-                     Type::getInt32Ty(Context),
-                     false,
-                     GlobalValue::CommonLinkage,
-                     ConstantInt::get(Type::getInt32Ty(Context), 0),
-                     StringRef("do_strace"));
-
   //
   // Handle some specific QEMU functions as no-ops or abort
   //
@@ -661,6 +864,37 @@ void CodeGenerator::translate(Optional<uint64_t> RawVirtualAddress) {
   replaceFunctionWithRet(HelpersModule->getFunction("page_get_flags"),
                          0xffffffff);
 
+  // Save the result for the next runs
+  if (not PreparedHelpersPath.empty())
+    storePreparedHelpers(*HelpersModule, PreparedHelpersPath);
+
+  HelpersArePrepared = true;
+}
+
+void CodeGenerator::translate(Optional<uint64_t> RawVirtualAddress) {
+  using FT = FunctionType;
+  LiftProfile &Profile = LiftProfile::get();
+
+  // Declare the abort function
+  auto *AbortTy = FunctionType::get(Type::getVoidTy(Context), false);
+  FunctionCallee AbortFunction = TheModule->getOrInsertFunction("abort",
+                                                                AbortTy);
+  {
+    auto *Abort = cast<Function>(skipCasts(AbortFunction.getCallee()));
+    FunctionTags::Exceptional.addTo(Abort);
+  }
+
+  if (not HelpersArePrepared)
+    prepareHelpers();
+
+  // From syscall.c
+  new GlobalVariable(*TheModule,
+                     Type::getInt32Ty(Context),
+                     false,
+                     GlobalValue::CommonLinkage,
+                     ConstantInt::get(Type::getInt32Ty(Context), 0),
+                     StringRef("do_strace"));
+
   //
   // Record globals for marking them as internal after linking
   //
@@ -705,8 +939,9 @@ void CodeGenerator::translate(Optional<uint64_t> RawVirtualAddress) {
     TargetIsLittleEndian = isLittleEndian(TargetArchitecture);
   }
   VariableManager Variables(*TheModule, TargetIsLittleEndian);
-  auto CreateCPUStateAccessAnalysisPass = [&Variables]() {
-    return new CPUStateAccessAnalysisPass(&Variables, true);
+  CSVAccessCache AccessCache(HelpersHash);
+  auto CreateCPUStateAccessAnalysisPass = [&Variables, &AccessCache]() {
+    return new CPUStateAccessAnalysisPass(&Variables, true, &AccessCache);
   };
 
   {
@@ -844,43 +1079,34 @@ void CodeGenerator::translate(Optional<uint64_t> RawVirtualAddress) {
                                    EndianessMismatch,
                                    PCH.get());
 
+  std::unique_ptr<PTCDumpWriter> Dump;
+  if (not PTCDumpPath.empty())
+    Dump = std::make_unique<PTCDumpWriter>(PTCDumpPath, PTCDumpSampling);
+
+  // Record the assembly of a new original instruction in the side-channel dump
+  auto DumpNewInstruction = [&Dump](MetaAddress PC, MetaAddress NextPC) {
+    if (Dump == nullptr or not Dump->newInstruction(PC))
+      return;
+
+    std::stringstream Stream;
+    revng_assert(NextPC - PC);
+    disassemble(Stream, PC, *(NextPC - PC));
+    Dump->write(PTCDumpWriter::Assembly, Stream.str());
+  };
+
   while (Entry != nullptr) {
     Builder.SetInsertPoint(Entry);
 
     // TODO: what if create a new instance of an InstructionTranslator here?
     Translator.reset();
 
-    // TODO: rename this type
-    PTCInstructionListPtr InstructionList(new PTCInstructionList);
-    size_t ConsumedSize = 0;
-
-    PTCCodeType Type = PTC_CODE_REGULAR;
-
-    switch (VirtualAddress.type()) {
-    case MetaAddressType::Invalid:
-      revng_abort();
-
-    case MetaAddressType::Code_arm_thumb:
-      Type = PTC_CODE_ARM_THUMB;
-      break;
-
-    default:
-      Type = PTC_CODE_REGULAR;
-      break;
-    }
-
-    ConsumedSize = ptc.translate(VirtualAddress.address(),
-                                 Type,
-                                 InstructionList.get());
-
-    // Check whether we ended up in an unmapped page
-    MetaAddress AbortAt = MetaAddress::invalid();
-    MetaAddress LastByte = VirtualAddress.toGeneric() + (ConsumedSize - 1);
-    if (VirtualAddress.pageStart() != LastByte.pageStart()) {
-      MetaAddress NextPage = VirtualAddress.nextPageStart();
-      if (NoMoreCodeBoundaries.count(NextPage) != 0)
-        AbortAt = NextPage;
-    }
+    std::optional<LiftProfile::Scope> Measurement;
+    Measurement.emplace(Profile, LiftPhase::Decode);
+    DecodedCode Decoded = decode(VirtualAddress, NoMoreCodeBoundaries);
+    Measurement.emplace(Profile, LiftPhase::InstructionTranslation);
+    PTCInstructionListPtr &InstructionList = Decoded.InstructionList;
+    size_t ConsumedSize = Decoded.ConsumedSize;
+    MetaAddress AbortAt = Decoded.AbortAt;
 
     SmallSet<unsigned, 1> ToIgnore;
     ToIgnore = Translator.preprocess(InstructionList.get());
@@ -925,6 +1151,8 @@ void CodeGenerator::translate(Optional<uint64_t> RawVirtualAddress) {
                                                    EndPC,
                                                    true,
                                                    AbortAt);
+      DumpNewInstruction(PC, NextPC);
+      Profile.countInstruction();
       J++;
     }
 
@@ -964,6 +1192,8 @@ void CodeGenerator::translate(Optional<uint64_t> RawVirtualAddress) {
                                                      EndPC,
                                                      false,
                                                      AbortAt);
+        DumpNewInstruction(PC, NextPC);
+        Profile.countInstruction();
       } break;
       case PTC_INSTRUCTION_op_call: {
         Result = Translator.translateCall(&Instruction);
@@ -1009,6 +1239,12 @@ void CodeGenerator::translate(Optional<uint64_t> RawVirtualAddress) {
         MDPTCInstr = MDNode::getDistinct(Context, MDPTCString);
       }
 
+      if (Dump != nullptr and Dump->isRecording()) {
+        std::stringstream PTCStringStream;
+        dumpInstruction(PTCStringStream, InstructionList.get(), J);
+        Dump->write(PTCDumpWriter::PTC, PTCStringStream.str());
+      }
+
       // Set metadata for all the new instructions
       for (BasicBlock *Block : Blocks) {
         BasicBlock::iterator I = Block->end();
@@ -1033,6 +1269,7 @@ void CodeGenerator::translate(Optional<uint64_t> RawVirtualAddress) {
     }
 
     Translator.registerDirectJumps();
+    Measurement.reset();
 
     // Obtain a new program counter to translate
     std::tie(VirtualAddress, Entry) = JumpTargets.peek();
@@ -1129,6 +1366,8 @@ void CodeGenerator::translate(Optional<uint64_t> RawVirtualAddress) {
   InstCombinePM.run(*MainFunction);
   InstCombinePM.doFinalization();
 
+  AccessCache.save();
+
   legacy::PassManager PostInstCombinePM;
   PostInstCombinePM.add(new LoadModelWrapperPass(Model));
   PostInstCombinePM.add(new CPUStateAccessAnalysisPass(&Variables, false));
@@ -1148,5 +1387,26 @@ void CodeGenerator::translate(Optional<uint64_t> RawVirtualAddress) {
                                       PCH.get());
   JumpOutHandler.createExternalJumpsHandler();
 
+  if (not DispatcherProfile.empty())
+    JumpTargets.layoutDispatcher(DispatcherProfile, DispatcherHotTargets);
+
+  if (ProfileCounters)
+    JumpTargets.createProfilingCounters();
+
+  if (DispatcherTables != 0)
+    JumpTargets.lowerDispatcherToTables(DispatcherTables);
+
+  if (Superblocks)
+    Translator.fuseSuperblocks();
+
+  if (LazyFlags) {
+    std::vector<GlobalVariable *> Flags;
+    auto Names = model::Architecture::getFlagsCSVNames(Model->Architecture);
+    for (StringRef Name : Names)
+      if (auto *CSV = TheModule->getGlobalVariable(Name))
+        Flags.push_back(CSV);
+    Translator.dropDeadFlagStores(Flags);
+  }
+
   Variables.finalize();
 }
@@ -46,12 +46,20 @@ public:
   /// \param VirtualAddress the address from where the translation should start.
   void translate(llvm::Optional<uint64_t> RawVirtualAddress);
 
+private:
+  /// \brief Applies to HelpersModule the transformations required before
+  ///        linking it, and stores the result for the next runs if requested
+  void prepareHelpers();
+
 private:
   const RawBinaryView &RawBinary;
   llvm::Module *TheModule;
   llvm::LLVMContext &Context;
   std::unique_ptr<llvm::Module> HelpersModule;
   std::unique_ptr<llvm::Module> EarlyLinkedModule;
+  uint64_t HelpersHash = 0;
+  std::string PreparedHelpersPath;
+  bool HelpersArePrepared = false;
   const TupleTree<model::Binary> &Model;
 
   unsigned OriginalInstrMDKind;
@@ -6,8 +6,12 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <algorithm>
 #include <string>
+#include <utility>
 
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/IR/BasicBlock.h"
@@ -199,13 +203,31 @@ llvm::BasicBlock *ExternalJumpsHandler::createSetjmp(BasicBlock *FirstReturn,
 void ExternalJumpsHandler::buildExecutableSegmentsList() {
   IRBuilder<> Builder(Context);
   IntegerType *Int64 = Builder.getInt64Ty();
-  SmallVector<Constant *, 10> ExecutableSegments;
   auto Int = [Int64](uint64_t V) { return ConstantInt::get(Int64, V); };
-  for (auto &Segment : Model.Segments) {
-    if (Segment.IsExecutable) {
-      ExecutableSegments.push_back(Int(Segment.StartAddress.address()));
-      ExecutableSegments.push_back(Int(Segment.endAddress().address()));
-    }
+
+  // Collect the ranges of the executable segments, sorted and with the
+  // overlapping or contiguous ones merged, so that is_executable can perform a
+  // binary search on them
+  using Range = std::pair<uint64_t, uint64_t>;
+  SmallVector<Range, 5> Ranges;
+  for (auto &Segment : Model.Segments)
+    if (Segment.IsExecutable)
+      Ranges.emplace_back(Segment.StartAddress.address(),
+                          Segment.endAddress().address());
+  llvm::sort(Ranges);
+
+  SmallVector<Range, 5> Merged;
+  for (const Range &R : Ranges) {
+    if (not Merged.empty() and R.first <= Merged.back().second)
+      Merged.back().second = std::max(Merged.back().second, R.second);
+    else
+      Merged.push_back(R);
+  }
+
+  SmallVector<Constant *, 10> ExecutableSegments;
+  for (const auto &[Start, End] : Merged) {
+    ExecutableSegments.push_back(Int(Start));
+    ExecutableSegments.push_back(Int(End));
   }
 
   auto *SegmentsType = ArrayType::get(Int64, ExecutableSegments.size());
@@ -13,14 +13,19 @@
 #include <sstream>
 
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Analysis/ValueTracking.h"
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/CFG.h"
 #include "llvm/IR/Intrinsics.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Support/Casting.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/Local.h"
 
 #include "revng/Lift/Lift.h"
 #include "revng/Support/Assert.h"
+#include "revng/Support/BlockType.h"
 #include "revng/Support/FunctionTags.h"
 #include "revng/Support/IRHelpers.h"
 #include "revng/Support/RandomAccessIterator.h"
@@ -29,6 +34,7 @@
 #include "InstructionTranslator.h"
 #include "PTCInterface.h"
 #include "VariableManager.h"
+#include "VectorHelpers.h"
 
 using namespace llvm;
 
@@ -538,6 +544,110 @@ void IT::finalizeNewPCMarkers() {
     eraseFromParent(Call);
 }
 
+void IT::fuseSuperblocks() {
+  auto IsTranslated = [](BasicBlock *BB) {
+    auto Type = getType(BB);
+    return Type == BlockType::TranslatedBlock
+           or Type == BlockType::JumpTargetBlock;
+  };
+
+  // Collect the blocks which can be merged in their predecessor
+  std::vector<BasicBlock *> ToMerge;
+  for (BasicBlock &BB : *TheFunction) {
+    if (getType(&BB) != BlockType::TranslatedBlock or BB.hasAddressTaken())
+      continue;
+
+    BasicBlock *Predecessor = BB.getSinglePredecessor();
+    if (Predecessor == nullptr or Predecessor == &BB
+        or not IsTranslated(Predecessor))
+      continue;
+
+    // Function calls are recognized by the marker preceding the terminator
+    Instruction *Terminator = Predecessor->getTerminator();
+    auto *Branch = dyn_cast<BranchInst>(Terminator);
+    if (Branch == nullptr or Branch->isConditional()
+        or getFunctionCall(Terminator) != nullptr)
+      continue;
+
+    ToMerge.push_back(&BB);
+  }
+
+  // Merging drops basic blocks
+  PCH->invalidateUniqueJumpTargets();
+
+  for (BasicBlock *BB : ToMerge) {
+    // The type of the merged block is the one of the predecessor
+    BasicBlock *Predecessor = BB->getSinglePredecessor();
+    MDNode *Type = Predecessor->getTerminator()->getMetadata(BlockTypeMDName);
+    if (MergeBlockIntoPredecessor(BB))
+      Predecessor->getTerminator()->setMetadata(BlockTypeMDName, Type);
+  }
+
+  // Turn the calls to newpc in the middle of a block into metadata. If a call
+  // is immediately followed by another one, the instructions that follow
+  // belong to the latter.
+  std::vector<CallInst *> ToDrop;
+  for (User *U : NewPCMarker->users()) {
+    auto *Call = cast<CallInst>(U);
+    bool IsJumpTarget = getLimitedValue(Call->getArgOperand(2)) == 1;
+    if (not IsJumpTarget and Call->getParent()->getFirstNonPHI() != Call)
+      ToDrop.push_back(Call);
+  }
+
+  LLVMContext &Context = TheModule.getContext();
+  for (CallInst *Call : ToDrop) {
+    Instruction *Next = Call->getNextNode();
+    if (not isCallTo(Next, "newpc")) {
+      auto GetOperand = [Call](unsigned Index) -> Metadata * {
+        auto *Operand = cast<Constant>(Call->getArgOperand(Index));
+        return ConstantAsMetadata::get(Operand);
+      };
+      auto *Tuple = MDTuple::get(Context, { GetOperand(0), GetOperand(1) });
+      Next->setMetadata(NewPCMDName, Tuple);
+    }
+  }
+
+  for (CallInst *Call : ToDrop)
+    eraseFromParent(Call);
+}
+
+void IT::dropDeadFlagStores(ArrayRef<GlobalVariable *> Flags) {
+  SmallPtrSet<GlobalVariable *, 8> IsFlag(Flags.begin(), Flags.end());
+  if (IsFlag.empty())
+    return;
+
+  std::vector<StoreInst *> ToDrop;
+  for (BasicBlock &BB : *TheFunction) {
+    // Flags which are stored again before being read, going backwards from
+    // the end of the basic block, where all of them are live
+    SmallPtrSet<GlobalVariable *, 8> Overwritten;
+    for (Instruction &I : make_range(BB.rbegin(), BB.rend())) {
+      if (auto *Call = dyn_cast<CallInst>(&I)) {
+        // Anything but the newpc marker might read the CPU state
+        if (not isCallTo(Call, "newpc"))
+          Overwritten.clear();
+      } else if (auto *Load = dyn_cast<LoadInst>(&I)) {
+        Value *Pointer = getUnderlyingObject(Load->getPointerOperand());
+        if (auto *CSV = dyn_cast<GlobalVariable>(Pointer))
+          Overwritten.erase(CSV);
+      } else if (auto *Store = dyn_cast<StoreInst>(&I)) {
+        auto *CSV = dyn_cast<GlobalVariable>(Store->getPointerOperand());
+        if (CSV == nullptr or not IsFlag.count(CSV))
+          continue;
+
+        if (not Overwritten.insert(CSV).second)
+          ToDrop.push_back(Store);
+      }
+    }
+  }
+
+  for (StoreInst *Store : ToDrop) {
+    Value *Stored = Store->getValueOperand();
+    eraseFromParent(Store);
+    RecursivelyDeleteTriviallyDeadInstructions(Stored);
+  }
+}
+
 SmallSet<unsigned, 1> IT::preprocess(PTCInstructionList *InstructionList) {
   SmallSet<unsigned, 1> Result;
 
@@ -703,19 +813,30 @@ IT::TranslationResult IT::translateCall(PTCInstruction *Instr) {
     ResultType = Builder.getVoidTy();
   }
 
+  std::string HelperName = "helper_" + TheCall.helperName();
+
+  // Known vector helpers are translated into vector instructions on the CSVs
+  Value *Lowered = nullptr;
+  if (lowerVectorHelper(Builder, Variables, HelperName, InArgs, Lowered)) {
+    if (ResultDestination != nullptr)
+      Variables.store(Builder, Lowered, ResultDestination);
+    return Success;
+  }
+
   auto *CalleeType = FunctionType::get(ResultType,
                                        ArrayRef<Type *>(InArgsType),
                                        false);
-
-  std::string HelperName = "helper_" + TheCall.helperName();
   FunctionCallee FDecl = TheModule.getOrInsertFunction(HelperName, CalleeType);
 
   FunctionTags::Helper.addTo(cast<Function>(skipCasts(FDecl.getCallee())));
 
   CallInst *Result = Builder.CreateCall(FDecl, InArgs);
 
+  // The helper might read and write the CPU state
+  Variables.invalidateKnownValues();
+
   if (TheCall.OutArguments.size() != 0)
-    Builder.CreateStore(Result, ResultDestination);
+    Variables.store(Builder, Result, ResultDestination);
 
   return Success;
 }
@@ -751,10 +872,12 @@ IT::translate(PTCInstruction *Instr, MetaAddress PC, MetaAddress NextPC) {
     if (Destination == nullptr)
       return Abort;
 
-    auto *Store = Builder.CreateStore(Result.get()[I], Destination);
+    auto *Store = Variables.store(Builder, Result.get()[I], Destination);
 
     if (PCH->affectsPC(Store)) {
-      // This is a PC-related store
+      // This is a PC-related store, which must be preserved. Moreover, the PCH
+      // can access the CPU state on its own.
+      Variables.invalidateKnownValues();
       PCH->handleStore(Builder, Store);
     } else {
       // If we're writing somewhere an immediate, register it for exploration
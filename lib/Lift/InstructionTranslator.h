@@ -102,6 +102,29 @@ public:
   /// \brief Handle calls to `newPC` marker and emit coverage information
   void finalizeNewPCMarkers();
 
+  /// \brief Fuse straight-line runs of translated blocks into superblocks
+  ///
+  /// Each translated block which is not a jump target is merged into its
+  /// predecessor, if it's the only one and it unconditionally falls through to
+  /// it. Then, the calls to newpc not starting a basic block are dropped, and
+  /// the guest instruction they mark is recorded as NewPCMDName metadata on
+  /// the instruction following them.
+  ///
+  /// \note call this once no new code will be translated.
+  void fuseSuperblocks();
+
+  /// \brief Drop the stores to flags CSVs overwritten before being read
+  ///
+  /// Most of the instructions update the condition flags, but only a few of
+  /// them read them. Within a basic block, a store to one of \p Flags followed
+  /// by another store to the same CSV, with no load of it nor calls other than
+  /// to newpc in between, is dead. Such stores are removed along with the
+  /// computations feeding only them, so that flags are materialized only where
+  /// they might be used.
+  ///
+  /// \note this is most effective after fuseSuperblocks.
+  void dropDeadFlagStores(llvm::ArrayRef<llvm::GlobalVariable *> Flags);
+
   /// \brief Notifies InstructionTranslator about a new PTC translation
   void reset() { LabeledBasicBlocks.clear(); }
 
@@ -7,8 +7,10 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <algorithm>
 #include <cstdint>
 #include <fstream>
+#include <map>
 #include <queue>
 #include <sstream>
 
@@ -17,6 +19,8 @@
 #include "boost/type_traits/is_same.hpp"
 
 #include "llvm/ADT/DepthFirstIterator.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/Analysis/BasicAliasAnalysis.h"
 #include "llvm/Analysis/ScopedNoAliasAA.h"
 #include "llvm/CodeGen/UnreachableBlockElim.h"
@@ -25,6 +29,8 @@
 #include "llvm/IR/MDBuilder.h"
 #include "llvm/IR/PassManager.h"
 #include "llvm/IR/Verifier.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Passes/PassBuilder.h"
 #include "llvm/Transforms/InstCombine/InstCombine.h"
 #include "llvm/Transforms/Scalar.h"
@@ -48,6 +54,7 @@
 #include "revng/Support/FunctionTags.h"
 #include "revng/Support/IRHelpers.h"
 #include "revng/Support/MetaAddress.h"
+#include "revng/Support/ProfilingRegion.h"
 #include "revng/Support/Statistics.h"
 #include "revng/TypeShrinking/BitLiveness.h"
 #include "revng/TypeShrinking/TypeShrinking.h"
@@ -56,6 +63,7 @@
 #include "CPUStateAccessAnalysisPass.h"
 #include "DropHelperCallsPass.h"
 #include "JumpTargetManager.h"
+#include "LiftProfile.h"
 #include "SubGraph.h"
 
 using namespace llvm;
@@ -68,6 +76,23 @@ Logger<> RegisterJTLog("registerjt");
 
 CounterMap<std::string> HarvestingStats("harvesting");
 RunningStatistics BlocksAnalyzedByAVI("blocks-analyzed-by-avi");
+RunningStatistics AVIWhitelistSize("avi-whitelist-size");
+RunningStatistics AVIJumpTargetsWhitelistSize("avi-jt-whitelist-size");
+CounterMap<std::string> SplitStats("split-translations");
+
+cl::opt<bool> FullAVI("full-avi",
+                      cl::desc("run AVI on the whole root function at each "
+                               "harvesting round, instead of only on the "
+                               "code affected by the jump targets and edges "
+                               "discovered since the previous round"),
+                      cl::init(false));
+
+cl::opt<bool> AlwaysRetranslate("always-retranslate",
+                                cl::desc("when a jump target lands in the "
+                                         "middle of a translated block, always "
+                                         "retranslate the code following it, "
+                                         "instead of reusing it when possible"),
+                                cl::init(false));
 
 RegisterPass<TranslateDirectBranchesPass> X("translate-db",
                                             "Translate Direct Branches"
@@ -250,6 +275,7 @@ void TDBP::pinConstantStoreInternal(MetaAddress Address, CallInst *ExitTBCall) {
     BranchInst::Create(JTM->unexpectedPC(), ExitTBCall);
   }
 
+  PCH->invalidateUniqueJumpTarget(ExitTBCall->getParent());
   eraseFromParent(ExitTBCall);
 }
 
@@ -329,6 +355,7 @@ bool TDBP::forceFallthroughAfterHelper(CallInst *Call) {
   }
 
   exitTBCleanup(Call);
+  PCH->invalidateUniqueJumpTarget(Call->getParent());
 
   IRBuilder<> Builder(Call->getParent());
   Call->setArgOperand(0, Builder.getInt32(1));
@@ -464,21 +491,28 @@ JumpTargetManager::JumpTargetManager(Function *TheFunction,
   //
   // Collect executable ranges from the model
   //
+  std::vector<RangesSet::interval> Ranges;
+  auto RecordRange = [this, &Ranges](MetaAddress Start, MetaAddress End) {
+    if (not ExecutableRangesBase.isValid())
+      ExecutableRangesBase = Start;
+
+    revng_check(Start.addressIsComparableWith(ExecutableRangesBase));
+    revng_check(End.addressIsComparableWith(ExecutableRangesBase));
+    Ranges.emplace_back(Start.address(), End.address());
+  };
+
   for (const model::Segment &Segment : Model->Segments) {
     if (Segment.IsExecutable) {
       if (Segment.Sections.size() > 0) {
-        for (const model::Section &Section : Segment.Sections) {
-          if (Section.ContainsCode) {
-            ExecutableRanges.emplace_back(Section.StartAddress,
-                                          Section.endAddress());
-          }
-        }
+        for (const model::Section &Section : Segment.Sections)
+          if (Section.ContainsCode)
+            RecordRange(Section.StartAddress, Section.endAddress());
       } else {
-        ExecutableRanges.emplace_back(Segment.StartAddress,
-                                      Segment.endAddress());
+        RecordRange(Segment.StartAddress, Segment.endAddress());
       }
     }
   }
+  ExecutableRanges = RangesSet(std::move(Ranges));
 
   // Configure GlobalValueNumbering
   StringMap<cl::Option *> &Options(cl::getRegisteredOptions());
@@ -538,17 +572,48 @@ void JumpTargetManager::findCodePointers(MetaAddress StartVirtualAddress,
                                          const unsigned char *End) {
   using support::endianness;
   using support::endian::read;
-  for (auto Pos = Start; Pos < End - sizeof(value_type); Pos++) {
-    auto Read = read<value_type, static_cast<endianness>(endian), 1>;
-    uint64_t RawValue = Read(Pos);
-    MetaAddress Value = fromPC(RawValue);
-    if (Value.isInvalid())
-      continue;
 
-    BasicBlock *Result = registerJT(Value, JTReason::GlobalData);
+  auto Hull = ExecutableRanges.hull();
+  if (not Hull or End - Start <= static_cast<ptrdiff_t>(sizeof(value_type)))
+    return;
+
+  // A pointer to code is in the hull of the executable ranges, possibly with
+  // the LSB set (e.g., Thumb code). Lower the start of the hull to an even
+  // value so that masking away the LSB never discards a candidate.
+  const uint64_t HullStart = Hull->first & ~uint64_t(1);
+  const uint64_t HullSize = Hull->second - HullStart;
+
+  auto Read = read<value_type, static_cast<endianness>(endian), 1>;
+  const unsigned char *Last = End - sizeof(value_type);
+
+  // Process the data in chunks: first compute, with a simple loop which does
+  // not branch and that the compiler can vectorize, the mask of the offsets
+  // that might hold a pointer to code, then inspect those, one by one
+  constexpr ptrdiff_t ChunkSize = 64;
+  for (const unsigned char *Chunk = Start; Chunk < Last; Chunk += ChunkSize) {
+    const ptrdiff_t Size = std::min(ChunkSize, Last - Chunk);
+
+    uint64_t Candidates = 0;
+    for (ptrdiff_t I = 0; I < Size; ++I) {
+      uint64_t RawValue = Read(Chunk + I) & ~uint64_t(1);
+      uint64_t IsCandidate = (RawValue - HullStart) < HullSize ? 1 : 0;
+      Candidates |= IsCandidate << I;
+    }
 
-    if (Result != nullptr)
-      UnusedCodePointers.insert(StartVirtualAddress + (Pos - Start));
+    while (Candidates != 0) {
+      const unsigned char *Pos = Chunk + countTrailingZeros(Candidates);
+      Candidates &= Candidates - 1;
+
+      uint64_t RawValue = Read(Pos);
+      MetaAddress Value = fromPC(RawValue);
+      if (Value.isInvalid())
+        continue;
+
+      BasicBlock *Result = registerJT(Value, JTReason::GlobalData);
+
+      if (Result != nullptr)
+        UnusedCodePointers.insert(StartVirtualAddress + (Pos - Start));
+    }
   }
 }
 
@@ -622,67 +687,79 @@ void JumpTargetManager::registerInstruction(MetaAddress PC,
   OriginalInstructionAddresses[PC] = Instruction;
 }
 
-// TODO: this is a candidate for BFSVisit
-std::pair<MetaAddress, uint64_t>
-JumpTargetManager::getPC(Instruction *TheInstruction) const {
-  CallInst *NewPCCall = nullptr;
-  std::set<BasicBlock *> Visited;
-  std::queue<BasicBlock::reverse_iterator> WorkList;
-  if (TheInstruction->getIterator() == TheInstruction->getParent()->begin())
-    WorkList.push(--TheInstruction->getParent()->rend());
-  else
-    WorkList.push(++TheInstruction->getReverseIterator());
+/// \return the call to newpc closest to the end of the range, if any
+template<typename ReverseIterator>
+static CallInst *findLastNewPC(ReverseIterator Begin, ReverseIterator End) {
+  for (Instruction &I : llvm::make_range(Begin, End))
+    if (CallInst *Marker = getCallTo(&I, "newpc"))
+      return Marker;
+  return nullptr;
+}
 
-  while (!WorkList.empty()) {
-    auto I = WorkList.front();
-    WorkList.pop();
-    auto *BB = I->getParent();
-    auto End = BB->rend();
-
-    // Go through the instructions looking for calls to newpc
-    for (; I != End; I++) {
-      if (auto Marker = dyn_cast<CallInst>(&*I)) {
-        // TODO: comparing strings is not very elegant
-        auto *Callee = Marker->getCalledFunction();
-        if (Callee != nullptr && Callee->getName() == "newpc") {
+static std::pair<MetaAddress, uint64_t> getNewPCArguments(CallInst *Marker) {
+  auto PC = MetaAddress::fromConstant(Marker->getArgOperand(0));
+  uint64_t Size = getLimitedValue(Marker->getArgOperand(1));
+  revng_assert(Size != 0);
+  return { PC, Size };
+}
 
-          // We found two distinct newpc leading to the requested instruction
-          if (NewPCCall != nullptr)
-            return { MetaAddress::invalid(), 0 };
+JumpTargetManager::EntryPC
+JumpTargetManager::getEntryPC(BasicBlock *BB) const {
+  auto It = EntryPCs.find(BB);
+  if (It != EntryPCs.end())
+    return It->second;
 
-          NewPCCall = Marker;
-          break;
-        }
-      }
+  // Explore backward, stopping on each path at the first call to newpc. Blocks
+  // whose entry has already been explored contribute what they have memoized.
+  EntryPC Result;
+  std::set<BasicBlock *> Visited;
+  std::queue<BasicBlock *> WorkList;
+
+  auto EnqueuePredecessors = [&](BasicBlock *Successor) {
+    for (BasicBlock *Predecessor : predecessors(Successor)) {
+      // Assert we didn't reach the almighty dispatcher
+      revng_assert(not(isPartOfRootDispatcher(Predecessor)));
+
+      // Ignore already visited or empty BBs
+      if (!Predecessor->empty() and Visited.insert(Predecessor).second)
+        WorkList.push(Predecessor);
     }
+  };
 
-    // If we haven't find a newpc call yet, continue exploration backward
-    if (NewPCCall == nullptr) {
-      // If one of the predecessors is the dispatcher, don't explore any further
-      for (BasicBlock *Predecessor : predecessors(BB)) {
-        // Assert we didn't reach the almighty dispatcher
-        revng_assert(not(isPartOfRootDispatcher(Predecessor)));
-      }
+  EnqueuePredecessors(BB);
+  while (!WorkList.empty() and Result.Count < 2) {
+    BasicBlock *Current = WorkList.front();
+    WorkList.pop();
 
-      for (BasicBlock *Predecessor : predecessors(BB)) {
-        // Ignore already visited or empty BBs
-        if (!Predecessor->empty()
-            && Visited.find(Predecessor) == Visited.end()) {
-          WorkList.push(Predecessor->rbegin());
-          Visited.insert(Predecessor);
-        }
-      }
+    if (CallInst *Marker = findLastNewPC(Current->rbegin(), Current->rend())) {
+      auto [PC, Size] = getNewPCArguments(Marker);
+      Result.merge(PC, Size);
+    } else if (auto Known = EntryPCs.find(Current); Known != EntryPCs.end()) {
+      Result.merge(Known->second);
+    } else {
+      EnqueuePredecessors(Current);
     }
   }
 
-  // Couldn't find the current PC
-  if (NewPCCall == nullptr)
+  EntryPCs[BB] = Result;
+  return Result;
+}
+
+std::pair<MetaAddress, uint64_t>
+JumpTargetManager::getPC(Instruction *TheInstruction) const {
+  BasicBlock *BB = TheInstruction->getParent();
+
+  // Look for the call to newpc preceding TheInstruction in its basic block
+  auto Begin = ++TheInstruction->getReverseIterator();
+  if (CallInst *Marker = findLastNewPC(Begin, BB->rend()))
+    return getNewPCArguments(Marker);
+
+  // Couldn't find the current PC, or found more than one
+  EntryPC Entry = getEntryPC(BB);
+  if (Entry.Count != 1)
     return { MetaAddress::invalid(), 0 };
 
-  auto PC = MetaAddress::fromConstant(NewPCCall->getArgOperand(0));
-  uint64_t Size = getLimitedValue(NewPCCall->getArgOperand(1));
-  revng_assert(Size != 0);
-  return { PC, Size };
+  return { Entry.PC, Entry.Size };
 }
 
 /// \brief Class to iterate over all the BBs associated to a translated PC
@@ -835,7 +912,8 @@ inline bool hasRootDispatcherPredecessor(llvm::BasicBlock *BB) {
   return false;
 }
 
-void JumpTargetManager::purgeTranslation(BasicBlock *Start) {
+std::set<BasicBlock *>
+JumpTargetManager::collectTranslation(BasicBlock *Start) {
   OnceQueue<BasicBlock *> Queue;
   Queue.insert(Start);
 
@@ -851,8 +929,74 @@ void JumpTargetManager::purgeTranslation(BasicBlock *Start) {
     }
   }
 
+  return Queue.visited();
+}
+
+/// \brief Check if the translation of an instruction depends only on the IR
+///
+/// QEMU frontends might keep state across the instructions of a translation
+/// block, which affects how the following instructions are translated but
+/// does not appear in the IR: x86 and s390x track the flags computation
+/// statically (`cc_op`), ARM tracks the Thumb IT blocks (`condexec`) and MIPS
+/// handles delay slots and branch-likely instructions through `hflags`. Code
+/// translated after the first instruction on those architectures is not
+/// necessarily what a translation starting there would produce.
+static bool hasNoTranslationTimeState(model::Architecture::Values Arch) {
+  switch (Arch) {
+  case model::Architecture::aarch64:
+    return true;
+  case model::Architecture::x86:
+  case model::Architecture::x86_64:
+  case model::Architecture::arm:
+  case model::Architecture::mips:
+  case model::Architecture::mipsel:
+  case model::Architecture::systemz:
+    return false;
+  default:
+    revng_abort();
+  }
+}
+
+bool JumpTargetManager::isSelfContained(BasicBlock *Start,
+                                        const std::set<BasicBlock *> &Blocks) {
+  CallInst *Marker = getCallTo(&*Start->begin(), "newpc");
+  if (Marker == nullptr)
+    return false;
+
+  // The variadic arguments of newpc are the local temporaries of the
+  // translation block, which might hold values computed by the instructions
+  // preceding Start
+  SmallPtrSet<const Value *, 4> Locals;
+  unsigned FixedArgCount = Marker->getFunctionType()->getNumParams();
+  for (unsigned I = FixedArgCount; I < Marker->arg_size(); ++I)
+    Locals.insert(Marker->getArgOperand(I));
+
+  for (BasicBlock *BB : Blocks) {
+    for (Instruction &I : *BB) {
+      if (auto *Load = dyn_cast<LoadInst>(&I))
+        if (Locals.count(skipCasts(Load->getPointerOperand())) != 0)
+          return false;
+
+      // Values computed outside of the translation (except for allocas) would
+      // not be available when coming from the dispatcher
+      for (Value *Operand : I.operands())
+        if (auto *Definition = dyn_cast<Instruction>(Operand))
+          if (not isa<AllocaInst>(Definition)
+              and Blocks.count(Definition->getParent()) == 0)
+            return false;
+    }
+  }
+
+  return true;
+}
+
+void JumpTargetManager::purgeTranslation(BasicBlock *Start) {
+  // We're about to drop code and basic blocks
+  PCH->invalidateUniqueJumpTargets();
+  invalidateEntryPCs();
+
   // Erase all the visited basic blocks
-  std::set<BasicBlock *> Visited = Queue.visited();
+  std::set<BasicBlock *> Visited = collectTranslation(Start);
 
   // Build a subgraph, so that we can visit it in post order, and purge the
   // content of each basic block
@@ -911,6 +1055,7 @@ JumpTargetManager::registerJT(MetaAddress PC, JTReason::Values Reason) {
   // Did we already meet this PC (i.e. do we know what's the associated
   // instruction)?
   BasicBlock *NewBlock = nullptr;
+  bool Reused = false;
   InstructionMap::iterator InstrIt = OriginalInstructionAddresses.find(PC);
   if (InstrIt != OriginalInstructionAddresses.end()) {
     // Case 2: the address has already been met, but needs to be promoted to
@@ -922,13 +1067,29 @@ JumpTargetManager::registerJT(MetaAddress PC, JTReason::Values Reason) {
     } else {
       revng_assert(I != nullptr && I->getIterator() != ContainingBlock->end());
       NewBlock = ContainingBlock->splitBasicBlock(I);
+      PCH->invalidateUniqueJumpTargets();
     }
 
-    // Register the basic block and all of its descendants to be purged so that
-    // we can retranslate this PC
+    // If the code translated from PC onward does not depend on the preceding
+    // instructions, it can be reached from the dispatcher as it is
     // TODO: this might create a problem if QEMU generates control flow that
     //       crosses an instruction boundary
-    ToPurge.insert(NewBlock);
+    if (AlwaysRetranslate) {
+      SplitStats.push("retranslated: reuse disabled");
+    } else if (not hasNoTranslationTimeState(Model->Architecture)) {
+      SplitStats.push("retranslated: translation-time state");
+    } else if (isSelfContained(NewBlock, collectTranslation(NewBlock))) {
+      SplitStats.push("reused");
+      invalidateEntryPCs();
+      Reused = true;
+    } else {
+      SplitStats.push("retranslated: not self-contained");
+    }
+
+    // Otherwise, register the basic block and all of its descendants to be
+    // purged so that we can retranslate this PC
+    if (not Reused)
+      ToPurge.insert(NewBlock);
 
   } else {
     // Case 3: the address has never been met, create a temporary one, register
@@ -936,7 +1097,9 @@ JumpTargetManager::registerJT(MetaAddress PC, JTReason::Values Reason) {
     NewBlock = BasicBlock::Create(Context, "", TheFunction);
   }
 
-  Unexplored.push_back(BlockWithAddress(PC, NewBlock));
+  // Reused translations have nothing left to explore
+  if (not Reused)
+    Unexplored.push_back(BlockWithAddress(PC, NewBlock));
 
   std::stringstream Name;
   Name << "bb." << nameForAddress(PC);
@@ -948,6 +1111,7 @@ JumpTargetManager::registerJT(MetaAddress PC, JTReason::Values Reason) {
     PCH->addCaseToDispatcher(DispatcherSwitch,
                              { PC, NewBlock },
                              BlockType::RootDispatcherHelperBlock);
+    DispatcherCases.insert(PC);
   }
 
   // Associate the PC with the chosen basic block
@@ -1102,10 +1266,28 @@ void JumpTargetManager::setCFGForm(CFGForm::Values NewForm,
 }
 
 void JumpTargetManager::rebuildDispatcher(MetaAddressSet *Whitelist) {
+  PCH->invalidateUniqueJumpTargets();
+  invalidateEntryPCs();
+
+  constexpr auto RDHB = BlockType::RootDispatcherHelperBlock;
+  bool ToAllJumpTargets = (CurrentCFGForm == CFGForm::SemanticPreserving
+                           and Whitelist == nullptr);
 
   if (DispatcherSwitch != nullptr) {
     revng_assert(DispatcherSwitch->getParent() == Dispatcher);
 
+    if (ToAllJumpTargets) {
+      // Just add the jump targets that are missing in the current dispatcher
+      for (auto &[PC, JumpTarget] : sortedJumpTargets()) {
+        if (DispatcherCases.insert(PC).second) {
+          PCH->addCaseToDispatcher(DispatcherSwitch,
+                                   { PC, JumpTarget->head() },
+                                   RDHB);
+        }
+      }
+      return;
+    }
+
     // Purge the old dispatcher
     PCH->destroyDispatcher(DispatcherSwitch);
   }
@@ -1115,8 +1297,8 @@ void JumpTargetManager::rebuildDispatcher(MetaAddressSet *Whitelist) {
   // Add all the (whitelisted) jump targets if we're using the
   // SemanticPreserving, or only those with no predecessors.
   bool IsWhitelistActive = (Whitelist != nullptr);
-  for (auto &[PC, JumpTarget] : JumpTargets) {
-    BasicBlock *BB = JumpTarget.head();
+  for (auto &[PC, JumpTarget] : sortedJumpTargets()) {
+    BasicBlock *BB = JumpTarget->head();
     bool IsWhitelisted = (not IsWhitelistActive or Whitelist->count(PC) != 0);
     if ((CurrentCFGForm == CFGForm::SemanticPreserving
          or not hasPredecessors(BB))
@@ -1125,7 +1307,10 @@ void JumpTargetManager::rebuildDispatcher(MetaAddressSet *Whitelist) {
     }
   }
 
-  constexpr auto RDHB = BlockType::RootDispatcherHelperBlock;
+  DispatcherCases.clear();
+  for (const auto &Target : Targets)
+    DispatcherCases.insert(Target.first);
+
   const auto &DispatcherInfo = PCH->buildDispatcher(Targets,
                                                     Dispatcher,
                                                     DispatcherFail,
@@ -1153,17 +1338,193 @@ void JumpTargetManager::rebuildDispatcher(MetaAddressSet *Whitelist) {
     std::set<BasicBlock *> Reachable = WorkList.visited();
 
     // Identify all the unreachable jump targets
-    for (const auto &[PC, JT] : JumpTargets) {
-      BasicBlock *BB = JT.head();
+    for (const auto &[PC, JT] : sortedJumpTargets()) {
+      BasicBlock *BB = JT->head();
       bool IsWhitelisted = (not IsWhitelistActive or Whitelist->count(PC) != 0);
 
       // Add to the switch all the unreachable jump targets whose reason is not
       // just direct jump
       if (Reachable.count(BB) == 0 and IsWhitelisted
-          and not JT.isOnlyReason(JTReason::DirectJump)) {
+          and not JT->isOnlyReason(JTReason::DirectJump)) {
         PCH->addCaseToDispatcher(DispatcherSwitch,
                                  { PC, BB },
                                  BlockType::RootDispatcherHelperBlock);
+        DispatcherCases.insert(PC);
+      }
+    }
+  }
+}
+
+std::vector<std::pair<MetaAddress, const JumpTargetManager::JumpTarget *>>
+JumpTargetManager::sortedJumpTargets() const {
+  std::vector<std::pair<MetaAddress, const JumpTarget *>> Result;
+  Result.reserve(JumpTargets.size());
+  for (const auto &[PC, JT] : JumpTargets)
+    Result.emplace_back(PC, &JT);
+
+  llvm::sort(Result, [](const auto &LHS, const auto &RHS) {
+    return LHS.first < RHS.first;
+  });
+  return Result;
+}
+
+/// \brief Parse the dispatches of each address in a profile
+static std::map<uint64_t, uint64_t> loadDispatches(StringRef ProfilePath) {
+  auto MaybeBuffer = MemoryBuffer::getFile(ProfilePath);
+  revng_check(MaybeBuffer, "Cannot open the dispatcher profile");
+
+  std::map<uint64_t, uint64_t> Result;
+  SmallVector<StringRef, 64> Lines;
+  (*MaybeBuffer)->getBuffer().split(Lines, '\n', -1, false);
+
+  // Skip the header
+  for (StringRef Line : llvm::drop_begin(Lines, 1)) {
+    SmallVector<StringRef, 3> Fields;
+    Line.trim().split(Fields, ',');
+    revng_check(Fields.size() == 3, "Malformed dispatcher profile");
+
+    uint64_t Address = 0;
+    uint64_t Dispatches = 0;
+    bool Failed = Fields[0].getAsInteger(0, Address);
+    Failed = Fields[2].getAsInteger(10, Dispatches) or Failed;
+    revng_check(not Failed, "Malformed dispatcher profile");
+
+    Result[Address] += Dispatches;
+  }
+
+  return Result;
+}
+
+void JumpTargetManager::layoutDispatcher(StringRef ProfilePath,
+                                         unsigned HotCount) {
+  std::map<uint64_t, uint64_t> Dispatches = loadDispatches(ProfilePath);
+
+  // Collect the jump targets that have been reached through the dispatcher,
+  // the hottest first
+  using DispatcherTarget = ProgramCounterHandler::DispatcherTarget;
+  using Candidate = std::pair<uint64_t, DispatcherTarget>;
+  std::vector<Candidate> Hot;
+  for (const auto &[PC, JT] : sortedJumpTargets()) {
+    auto It = Dispatches.find(PC.address());
+    if (It != Dispatches.end() and It->second != 0)
+      Hot.push_back({ It->second, { PC, JT->head() } });
+  }
+
+  llvm::stable_sort(Hot, [](const Candidate &LHS, const Candidate &RHS) {
+    return LHS.first > RHS.first;
+  });
+  if (Hot.size() > HotCount)
+    Hot.resize(HotCount);
+
+  if (Hot.empty())
+    return;
+
+  // Move the dispatcher switch in a block of its own, which will be reached
+  // only if all the comparisons fail
+  revng_assert(DispatcherSwitch->getParent() == Dispatcher);
+  BasicBlock *Cold = Dispatcher->splitBasicBlock(Dispatcher->begin(),
+                                                 "dispatcher.cold");
+  eraseFromParent(Dispatcher->getTerminator());
+
+  SmallVector<BasicBlock *, 8> Checks = { Dispatcher };
+  for (size_t I = 1; I < Hot.size(); ++I)
+    Checks.push_back(BasicBlock::Create(Context,
+                                        "dispatcher.hot",
+                                        TheFunction,
+                                        Cold));
+
+  constexpr auto RDHB = BlockType::RootDispatcherHelperBlock;
+  for (size_t I = 0; I < Hot.size(); ++I) {
+    IRBuilder<> Builder(Checks[I]);
+    BasicBlock *Next = I + 1 < Hot.size() ? Checks[I + 1] : Cold;
+    PCH->buildHotPath(Builder, Hot[I].second, Next, RDHB);
+  }
+}
+
+void JumpTargetManager::createProfilingCounters() {
+  auto Targets = sortedJumpTargets();
+
+  auto *Int64 = Type::getInt64Ty(Context);
+  auto *CountersType = ArrayType::get(Int64, Targets.size());
+  auto CreateGlobal = [this](Type *Type, bool IsConstant, Constant *Initializer,
+                             const Twine &Name) {
+    return new GlobalVariable(TheModule,
+                              Type,
+                              IsConstant,
+                              GlobalValue::ExternalLinkage,
+                              Initializer,
+                              Name);
+  };
+
+  SmallVector<Constant *, 16> Addresses;
+  for (const auto &[PC, JT] : Targets)
+    Addresses.push_back(ConstantInt::get(Int64, PC.address()));
+
+  CreateGlobal(Int64,
+               true,
+               ConstantInt::get(Int64, Targets.size()),
+               "revng_profile_count");
+  CreateGlobal(CountersType,
+               true,
+               ConstantArray::get(CountersType, Addresses),
+               "revng_profile_addresses");
+  auto *Zero = ConstantAggregateZero::get(CountersType);
+  auto *Executions = CreateGlobal(CountersType,
+                                  false,
+                                  Zero,
+                                  "revng_profile_executions");
+  auto *Dispatches = CreateGlobal(CountersType,
+                                  false,
+                                  Zero,
+                                  "revng_profile_dispatches");
+
+  IRBuilder<> Builder(Context);
+  auto Increment = [&](GlobalVariable *Counters, uint64_t Index) {
+    Value *Counter = Builder.CreateConstInBoundsGEP2_64(CountersType,
+                                                        Counters,
+                                                        0,
+                                                        Index);
+    Value *Old = Builder.CreateLoad(Int64, Counter);
+    Builder.CreateStore(Builder.CreateAdd(Old, ConstantInt::get(Int64, 1)),
+                        Counter);
+  };
+
+  for (uint64_t Index = 0; Index < Targets.size(); ++Index) {
+    BasicBlock *Head = Targets[Index].second->head();
+
+    // Count the executions after the call to newpc, which must remain the
+    // first instruction of the jump target
+    Instruction *NewPC = Head->getFirstNonPHI();
+    revng_assert(getCallTo(NewPC, "newpc") != nullptr);
+    Builder.SetInsertPoint(NewPC->getNextNode());
+    Increment(Executions, Index);
+
+    // Count the dispatches on a block of their own, between each part of the
+    // dispatcher branching to the jump target and the jump target itself
+    SmallSetVector<BasicBlock *, 2> DispatcherPredecessors;
+    for (BasicBlock *Predecessor : predecessors(Head))
+      if (isPartOfRootDispatcher(Predecessor))
+        DispatcherPredecessors.insert(Predecessor);
+
+    for (BasicBlock *Predecessor : DispatcherPredecessors) {
+      auto *Counting = BasicBlock::Create(Context,
+                                          "dispatcher.profile",
+                                          TheFunction,
+                                          Head);
+      Builder.SetInsertPoint(Counting);
+      Increment(Dispatches, Index);
+      auto *Branch = Builder.CreateBr(Head);
+      setBlockType(Branch, BlockType::RootDispatcherHelperBlock);
+
+      // Multiple cases of the dispatcher might lead to the jump target, but
+      // it has now a single edge from the new block
+      Instruction *Terminator = Predecessor->getTerminator();
+      unsigned Edges = llvm::count(successors(Terminator), Head);
+      Terminator->replaceSuccessorWith(Head, Counting);
+      for (PHINode &Phi : Head->phis()) {
+        for (unsigned I = 1; I < Edges; ++I)
+          Phi.removeIncomingValue(Predecessor, false);
+        Phi.replaceIncomingBlockWith(Predecessor, Counting);
       }
     }
   }
@@ -1375,17 +1736,35 @@ JumpTargetManager::MetaAddressSet JumpTargetManager::inflateAVIWhitelist() {
 }
 
 void JumpTargetManager::harvestWithAVI() {
+  auto Measurement = LiftProfile::get().measure(LiftPhase::AVI);
   Module *M = TheFunction->getParent();
 
   //
   // Update CPUStateAccessAnalysisPass
   //
+  // This is needed even if AVI is skipped: the rest of the lifting relies on
+  // the metadata of the helper calls translated since the previous round.
   legacy::PassManager PM;
   PM.add(new LoadModelWrapperPass(ModelWrapper::createConst(Model)));
   PM.add(CreateCSAA());
   PM.add(new FunctionCallIdentification);
   PM.run(TheModule);
 
+  // AVIPCWhiteList records the jump targets (i.e., the new dispatcher edges)
+  // and the blocks with new outgoing edges found since the previous round. If
+  // there are none, the code AVI would analyze is the same as last time and so
+  // would be the results: skip the rest of the round.
+  AVIWhitelistSize.push(AVIPCWhiteList.size());
+  if (not FullAVI and AVIPCWhiteList.empty()) {
+    HarvestingStats.push("harvestWithAVI: skipped, nothing changed");
+    return;
+  }
+
+  if (FullAVI)
+    HarvestingStats.push("harvestWithAVI: full");
+  else
+    HarvestingStats.push("harvestWithAVI: incremental");
+
   //
   // Collect all the non-PC affecting CSVs
   //
@@ -1426,11 +1805,14 @@ void JumpTargetManager::harvestWithAVI() {
       }
     }
 
-    // Compute AVIJumpTargetWhitelist
+    // Compute AVIJumpTargetWhitelist, i.e., the jump targets from which the
+    // changed code can be reached without going through the dispatcher
     auto AVIJumpTargetWhitelist = inflateAVIWhitelist();
+    AVIJumpTargetsWhitelistSize.push(AVIJumpTargetWhitelist.size());
 
-    // Prune the dispatcher
-    setCFGForm(CFGForm::RecoveredOnly, &AVIJumpTargetWhitelist);
+    // Prune the dispatcher, keeping only the whitelisted jump targets
+    setCFGForm(CFGForm::RecoveredOnly,
+               FullAVI ? nullptr : &AVIJumpTargetWhitelist);
 
     // Detach all the unreachable basic blocks, so they don't get copied
     std::set<BasicBlock *> UnreachableBBs = computeUnreachable();
@@ -1834,9 +2216,14 @@ void JumpTargetManager::harvestWithAVI() {
 // translate we proceed as long as we are able to create new edges on the CFG
 // (not considering the dispatcher).
 void JumpTargetManager::harvest() {
+  auto Measurement = LiftProfile::get().measure(LiftPhase::Harvest);
+  ProfilingRegion Region("lift-harvest");
 
   HarvestingStats.push("harvest 0");
 
+  // New code has been translated since the last round
+  invalidateEntryPCs();
+
   if (empty()) {
     HarvestingStats.push("harvest 1: SimpleLiterals");
     revng_log(JTCountLog, "Collecting simple literals");
@@ -1854,6 +2241,8 @@ void JumpTargetManager::harvest() {
       BB->dropAllReferences();
     for (BasicBlock *BB : Unreachable)
       eraseFromParent(BB);
+    PCH->invalidateUniqueJumpTargets();
+    invalidateEntryPCs();
 
     // TODO: move me to a commit function
 
@@ -1887,6 +2276,11 @@ void JumpTargetManager::harvest() {
     OptimizingPM.run(*TheFunction);
     OptimizingPM.doFinalization();
 
+    // The optimizations might have turned some stores to the PC into constant
+    // ones, or dropped some of them
+    PCH->invalidateUniqueJumpTargets();
+    invalidateEntryPCs();
+
     legacy::PassManager PreliminaryBranchesPM;
     PreliminaryBranchesPM.add(new TranslateDirectBranchesPass(this));
     PreliminaryBranchesPM.run(TheModule);
@@ -6,6 +6,7 @@
 
 #include <cstdint>
 #include <map>
+#include <optional>
 #include <set>
 #include <vector>
 
@@ -13,10 +14,13 @@
 #include "boost/icl/interval_set.hpp"
 #include "boost/type_traits/is_same.hpp"
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/PassManager.h"
+#include "llvm/IR/ValueMap.h"
 
+#include "revng/ADT/FlatIntervalSet.h"
 #include "revng/BasicAnalyses/MaterializedValue.h"
 #include "revng/Lift/Lift.h"
 #include "revng/Model/Architecture.h"
@@ -207,8 +211,9 @@ public:
   };
 
 public:
-  using BlockMap = std::map<MetaAddress, JumpTarget>;
-  using RangesVector = std::vector<std::pair<MetaAddress, MetaAddress>>;
+  /// \note iteration order is unspecified, see sortedJumpTargets
+  using BlockMap = llvm::DenseMap<MetaAddress, JumpTarget>;
+  using RangesSet = FlatIntervalSet<uint64_t>;
   using CSAAFactory = std::function<CPUStateAccessAnalysisPass *(void)>;
 
 public:
@@ -268,15 +273,12 @@ public:
   bool isExecutableRange(MetaAddress Start, MetaAddress End) const {
     revng_assert(Start.isValid() and End.isValid());
 
-    for (const std::pair<MetaAddress, MetaAddress> &Range : ExecutableRanges) {
-      if (Range.first.addressLowerThanOrEqual(Start)
-          and Start.addressLowerThan(Range.second)
-          and Range.first.addressLowerThanOrEqual(End)
-          and End.addressLowerThan(Range.second)) {
-        return true;
-      }
-    }
-    return false;
+    auto Range = findExecutableRange(Start);
+    if (not Range)
+      return false;
+
+    revng_check(End.addressIsComparableWith(ExecutableRangesBase));
+    return Range->first <= End.address() and End.address() < Range->second;
   }
 
   /// \brief Return true if the given PC can be executed by the current
@@ -307,14 +309,7 @@ public:
   /// \brief Return true if \p PC is in an executable segment
   bool isExecutableAddress(MetaAddress PC) const {
     revng_assert(PC.isValid());
-
-    for (std::pair<MetaAddress, MetaAddress> Range : ExecutableRanges) {
-      if (Range.first.addressLowerThanOrEqual(PC)
-          and PC.addressLowerThan(Range.second)) {
-        return true;
-      }
-    }
-    return false;
+    return findExecutableRange(PC).has_value();
   }
 
   /// \brief Get the basic block associated to the original address \p PC
@@ -383,9 +378,19 @@ public:
   // TODO: can this be replaced by the corresponding method in
   // GeneratedCodeBasicInfo?
   /// \brief Get the PC associated and the size of the original instruction
+  ///
+  /// Looks for the closest call to newpc preceding \p TheInstruction in its
+  /// basic block and, if there's none, uses the memoized information about
+  /// what reaches the entry of the block (see getEntryPC).
   std::pair<MetaAddress, uint64_t>
   getPC(llvm::Instruction *TheInstruction) const;
 
+  /// \brief Forget what has been memoized about the PCs reaching basic blocks
+  ///
+  /// Splitting a basic block does not alter what reaches the entry of any
+  /// block, but adding or removing edges does.
+  void invalidateEntryPCs() { EntryPCs.clear(); }
+
   // TODO: can this be replaced by the corresponding method in
   // GeneratedCodeBasicInfo?
   MetaAddress getNextPC(llvm::Instruction *TheInstruction) const {
@@ -457,6 +462,37 @@ public:
     return fromPC(Constant->getLimitedValue());
   }
 
+  /// \brief Test the hottest targets of indirect jumps before the dispatcher
+  ///
+  /// The profile, as dumped by a program lifted with -profile-counters, is read
+  /// from \p ProfilePath. A comparison against each of the \p HotCount jump
+  /// targets with the most dispatches is emitted, in order of decreasing
+  /// dispatches, before the dispatcher switch, which handles all the rest.
+  ///
+  /// \note call this only once the dispatcher will no longer be rebuilt.
+  void layoutDispatcher(llvm::StringRef ProfilePath, unsigned HotCount);
+
+  /// \brief Instrument the jump targets with execution counters
+  ///
+  /// Each jump target gets two counters: the number of times it's executed
+  /// and the number of times it's reached through the dispatcher, i.e., as the
+  /// target of an indirect branch. The counters, along with the address of each
+  /// jump target, are exposed through the `revng_profile_*` globals, which the
+  /// runtime dumps at exit.
+  ///
+  /// \note call this only once the root function will no longer change.
+  void createProfilingCounters();
+
+  /// \brief Dispatch through perfect hash tables instead of switches
+  ///
+  /// See ProgramCounterHandler::lowerDispatcherToTables.
+  ///
+  /// \note call this last: the edges leaving the dispatcher can no longer be
+  ///       split, nor the dispatcher rebuilt.
+  void lowerDispatcherToTables(unsigned MinimumCases) {
+    PCH->lowerDispatcherToTables(DispatcherSwitch, MinimumCases);
+  }
+
   void createJTReasonMD() {
     using namespace llvm;
 
@@ -515,6 +551,16 @@ public:
   ProgramCounterHandler *programCounterHandler() { return PCH; }
 
 private:
+  /// \return the executable range containing \p PC, if any
+  std::optional<RangesSet::interval>
+  findExecutableRange(MetaAddress PC) const {
+    if (ExecutableRanges.empty())
+      return std::nullopt;
+
+    revng_check(PC.addressIsComparableWith(ExecutableRangesBase));
+    return ExecutableRanges.find(PC.address());
+  }
+
   void fixPostHelperPC();
 
   std::set<llvm::BasicBlock *> computeUnreachable() const;
@@ -550,9 +596,21 @@ private:
     eraseFromParent(I);
   }
 
+  /// \brief Collect \p Start and all the descendants, stopping when a JT is met
+  std::set<llvm::BasicBlock *> collectTranslation(llvm::BasicBlock *Start);
+
+  /// \brief Check if the translation in \p Blocks, starting at \p Start, can be
+  ///        executed without the instructions translated before \p Start
+  static bool isSelfContained(llvm::BasicBlock *Start,
+                              const std::set<llvm::BasicBlock *> &Blocks);
+
   /// \brief Drop \p Start and all the descendants, stopping when a JT is met
   void purgeTranslation(llvm::BasicBlock *Start);
 
+  /// \return the jump targets, sorted by address
+  std::vector<std::pair<MetaAddress, const JumpTarget *>>
+  sortedJumpTargets() const;
+
   /// \brief Check if \p BB has at least a predecessor, excluding the dispatcher
   bool hasPredecessors(llvm::BasicBlock *BB) const;
 
@@ -560,6 +618,10 @@ private:
   ///
   /// Depending on the CFG form we're currently adopting the dispatcher might go
   /// to all the jump targets or only to those who have no other predecessor.
+  ///
+  /// If the dispatcher has to go to all the jump targets, it's a superset of
+  /// any previous dispatcher: in that case the missing cases are appended to
+  /// the existing one, instead of rebuilding it from scratch.
   void rebuildDispatcher(MetaAddressSet *Whitelist);
 
   void prepareDispatcher();
@@ -577,8 +639,44 @@ private:
 
   llvm::CallInst *getJumpTarget(llvm::BasicBlock *Target);
 
+  /// \brief The calls to newpc found walking backward from the entry of a block
+  struct EntryPC {
+    /// Number of distinct PCs found, two means two or more
+    unsigned Count = 0;
+    MetaAddress PC = MetaAddress::invalid();
+    uint64_t Size = 0;
+
+    void merge(MetaAddress OtherPC, uint64_t OtherSize) {
+      if (Count == 0) {
+        Count = 1;
+        PC = OtherPC;
+        Size = OtherSize;
+      } else if (Count == 1 and PC != OtherPC) {
+        Count = 2;
+      }
+    }
+
+    void merge(const EntryPC &Other) {
+      if (Other.Count > 1)
+        Count = 2;
+      else if (Other.Count == 1)
+        merge(Other.PC, Other.Size);
+    }
+  };
+
+  /// \brief Collect the PCs reaching the entry of \p BB, memoizing them
+  EntryPC getEntryPC(llvm::BasicBlock *BB) const;
+
 private:
-  using InstructionMap = std::map<MetaAddress, llvm::Instruction *>;
+  /// Entries of deleted blocks are dropped, RAUW on a block must not move them
+  struct EntryPCsConfig : llvm::ValueMapConfig<const llvm::BasicBlock *> {
+    enum { FollowRAUW = false };
+  };
+
+  using EntryPCsMap = llvm::ValueMap<const llvm::BasicBlock *,
+                                     EntryPC,
+                                     EntryPCsConfig>;
+  using InstructionMap = llvm::DenseMap<MetaAddress, llvm::Instruction *>;
 
   llvm::Module &TheModule;
   llvm::LLVMContext &Context;
@@ -586,16 +684,25 @@ private:
   /// Holds the association between a PC and the last generated instruction for
   /// the previous instruction.
   InstructionMap OriginalInstructionAddresses;
+  /// Memoized results of getEntryPC, see invalidateEntryPCs
+  mutable EntryPCsMap EntryPCs;
   /// Holds the association between a PC and a BasicBlock.
   BlockMap JumpTargets;
   /// Queue of program counters we still have to translate.
   std::vector<BlockWithAddress> Unexplored;
 
   llvm::Function *ExitTB;
-  RangesVector ExecutableRanges;
+
+  /// The addresses of the executable ranges, all of them are comparable with
+  /// ExecutableRangesBase
+  RangesSet ExecutableRanges;
+  MetaAddress ExecutableRangesBase = MetaAddress::invalid();
 
   llvm::BasicBlock *Dispatcher;
   llvm::SwitchInst *DispatcherSwitch;
+
+  /// The addresses having a case in DispatcherSwitch
+  MetaAddressSet DispatcherCases;
   llvm::BasicBlock *DispatcherFail;
   llvm::BasicBlock *AnyPC;
   llvm::BasicBlock *UnexpectedPC;
@@ -612,6 +719,7 @@ private:
 
   ProgramCounterHandler *PCH;
 
+  /// New jump targets and sources of new edges since the last AVI round
   MetaAddressSet AVIPCWhiteList;
   const TupleTree<model::Binary> &Model;
   const RawBinaryView &BinaryView;
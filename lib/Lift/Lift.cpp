@@ -5,10 +5,14 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+
 #include "revng/Lift/Lift.h"
 #include "revng/Support/ResourceFinder.h"
 
 #include "CodeGenerator.h"
+#include "LiftProfile.h"
 #include "PTCInterface.h"
 
 using namespace llvm::cl;
@@ -25,6 +29,12 @@ alias A1("e",
          aliasopt(EntryPointAddress),
          cat(MainCategory));
 
+opt<std::string> LiftProfilePath("lift-profile",
+                                 desc("write to this file a JSON report of "
+                                      "the time spent in each lifting phase"),
+                                 value_desc("path"),
+                                 cat(MainCategory));
+
 } // namespace
 
 char LiftPass::ID;
@@ -116,6 +126,8 @@ bool LiftPass::runOnModule(llvm::Module &M) {
   const auto &ModelWrapper = getAnalysis<LoadModelWrapperPass>().get();
   const TupleTree<model::Binary> &Model = ModelWrapper.getReadOnlyModel();
 
+  LiftProfile::get().reset();
+
   findFiles(Model->Architecture);
 
   // Load the appropriate libtyncode version
@@ -138,5 +150,12 @@ bool LiftPass::runOnModule(llvm::Module &M) {
     EntryPointAddressOptional = EntryPointAddress;
   Generator.translate(EntryPointAddressOptional);
 
+  if (not LiftProfilePath.empty()) {
+    std::error_code EC;
+    llvm::raw_fd_ostream Output(LiftProfilePath, EC, llvm::sys::fs::OF_Text);
+    revng_check(not EC, "Cannot open the lift profile output file");
+    LiftProfile::get().writeJSON(Output);
+  }
+
   return false;
 }
@@ -0,0 +1,71 @@
+/// \file LiftProfile.cpp
+/// \brief Records how much time lifting spends in each phase.
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <sys/resource.h>
+
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "revng/Support/Assert.h"
+
+#include "LiftProfile.h"
+
+using namespace std::chrono;
+
+static uint64_t getPeakRSSKiB() {
+  struct rusage Usage;
+  if (getrusage(RUSAGE_SELF, &Usage) != 0)
+    return 0;
+  return Usage.ru_maxrss;
+}
+
+static double toSeconds(LiftProfile::Clock::duration Duration) {
+  return duration_cast<duration<double>>(Duration).count();
+}
+
+LiftProfile &LiftProfile::get() {
+  static LiftProfile Instance;
+  return Instance;
+}
+
+llvm::StringRef LiftProfile::getName(LiftPhase Phase) {
+  switch (Phase) {
+  case LiftPhase::Decode:
+    return "decode";
+  case LiftPhase::InstructionTranslation:
+    return "instruction-translation";
+  case LiftPhase::Harvest:
+    return "harvest";
+  case LiftPhase::AVI:
+    return "avi";
+  case LiftPhase::CPUStateAccessAnalysis:
+    return "cpu-state-access-analysis";
+  case LiftPhase::Count:
+    break;
+  }
+  revng_abort();
+}
+
+void LiftProfile::writeJSON(llvm::raw_ostream &OS) const {
+  double Total = toSeconds(Clock::now() - Start);
+
+  llvm::json::OStream JSON(OS, 2);
+  JSON.object([&] {
+    JSON.attribute("seconds", Total);
+    JSON.attribute("instructions", static_cast<int64_t>(Instructions));
+    JSON.attribute("instructions_per_second",
+                   Total > 0 ? Instructions / Total : 0.0);
+    JSON.attribute("peak_rss_kib", static_cast<int64_t>(getPeakRSSKiB()));
+    JSON.attributeObject("phases", [&] {
+      for (size_t I = 0; I < PhasesCount; ++I) {
+        auto Phase = static_cast<LiftPhase>(I);
+        JSON.attribute(getName(Phase), toSeconds(Durations[I]));
+      }
+    });
+  });
+  OS << "\n";
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+#include "llvm/ADT/StringRef.h"
+
+namespace llvm {
+class raw_ostream;
+} // namespace llvm
+
+/// \brief The phases of lifting whose duration is recorded by LiftProfile
+enum class LiftPhase {
+  Decode,
+  InstructionTranslation,
+  Harvest,
+  AVI,
+  CPUStateAccessAnalysis,
+  Count
+};
+
+/// \brief Records how much time lifting spends in each phase
+///
+/// Times are inclusive: AVI and CPUStateAccessAnalysis run during harvesting,
+/// hence they are also accounted in Harvest.
+class LiftProfile {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /// \brief RAII helper accounting its lifetime to a phase
+  class Scope {
+  private:
+    LiftProfile &Parent;
+    LiftPhase Phase;
+    Clock::time_point Start;
+
+  public:
+    Scope(LiftProfile &Parent, LiftPhase Phase) :
+      Parent(Parent), Phase(Phase), Start(Clock::now()) {}
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+    ~Scope() { Parent.account(Phase, Clock::now() - Start); }
+  };
+
+private:
+  static constexpr size_t PhasesCount = static_cast<size_t>(LiftPhase::Count);
+
+private:
+  std::array<Clock::duration, PhasesCount> Durations = {};
+  Clock::time_point Start = Clock::now();
+  uint64_t Instructions = 0;
+
+public:
+  /// \brief The profile of the current lifting
+  static LiftProfile &get();
+
+  static llvm::StringRef getName(LiftPhase Phase);
+
+public:
+  Scope measure(LiftPhase Phase) { return Scope(*this, Phase); }
+
+  void account(LiftPhase Phase, Clock::duration Duration) {
+    Durations[static_cast<size_t>(Phase)] += Duration;
+  }
+
+  void countInstruction() { ++Instructions; }
+
+  /// \brief Starts a new profile, discarding the recorded data
+  void reset() { *this = LiftProfile(); }
+
+  /// \brief Writes the profile as a JSON object
+  void writeJSON(llvm::raw_ostream &OS) const;
+};
@@ -30,7 +30,12 @@ static Register X("load-binary", "Load Binary Pass", true, true);
 
 LoadBinaryWrapperPass::LoadBinaryWrapperPass() : llvm::ModulePass(ID) {
   revng_check(RawBinaryPath.getNumOccurrences() == 1);
-  auto Result = MemoryBuffer::getFileOrSTDIN(RawBinaryPath);
+  // Not requiring a null terminator lets the file be memory-mapped even if
+  // its size is a multiple of the page size, instead of reading a copy of it
+  constexpr bool RequiresNullTerminator = false;
+  auto Result = MemoryBuffer::getFileOrSTDIN(RawBinaryPath,
+                                             /* IsText */ false,
+                                             RequiresNullTerminator);
   MaybeBuffer = cantFail(errorOrToExpected(std::move(Result)));
   Data = toArrayRef(MaybeBuffer->getBuffer());
 }
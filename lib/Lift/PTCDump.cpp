@@ -10,6 +10,9 @@
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <type_traits>
+
+#include "llvm/Support/Endian.h"
 
 #include "revng/Support/Assert.h"
 
@@ -291,3 +294,59 @@ int dumpTranslation(MetaAddress VirtualAddress,
 
   return EXIT_SUCCESS;
 }
+
+PTCDumpWriter::PTCDumpWriter(llvm::StringRef Path, unsigned SamplingPeriod) :
+  Output(Path.str(), std::ios::binary | std::ios::trunc),
+  SamplingPeriod(SamplingPeriod == 0 ? 1 : SamplingPeriod) {
+  revng_check(Output.good(), "Cannot open the PTC dump file");
+}
+
+PTCDumpWriter::~PTCDumpWriter() {
+  uint64_t IndexOffset = Output.tellp();
+  for (const IndexEntry &Entry : Index) {
+    writeAddress(Entry.Address);
+    writeInteger<uint64_t>(Entry.Offset);
+  }
+
+  writeInteger<uint64_t>(IndexOffset);
+  writeInteger<uint64_t>(Index.size());
+  Output.write(Magic, sizeof(Magic) - 1);
+  Output.flush();
+  revng_check(Output.good(), "Cannot write the PTC dump file");
+}
+
+bool PTCDumpWriter::newInstruction(MetaAddress PC) {
+  bool Sampled = PC.isValid() and SeenInstructions % SamplingPeriod == 0;
+  ++SeenInstructions;
+
+  Current = Sampled ? PC : MetaAddress::invalid();
+  if (Sampled)
+    Index.push_back({ PC, static_cast<uint64_t>(Output.tellp()) });
+
+  return Sampled;
+}
+
+void PTCDumpWriter::write(RecordKind Kind, llvm::StringRef Text) {
+  if (not isRecording())
+    return;
+
+  writeInteger<uint8_t>(Kind);
+  writeAddress(Current);
+  writeInteger<uint32_t>(Text.size());
+  Output.write(Text.data(), Text.size());
+}
+
+template<typename T>
+void PTCDumpWriter::writeInteger(T Value) {
+  static_assert(std::is_integral_v<T>);
+  char Buffer[sizeof(T)];
+  llvm::support::endian::write<T, llvm::support::little>(Buffer, Value);
+  Output.write(Buffer, sizeof(T));
+}
+
+void PTCDumpWriter::writeAddress(const MetaAddress &Address) {
+  writeInteger<uint64_t>(Address.address());
+  writeInteger<uint32_t>(Address.epoch());
+  writeInteger<uint16_t>(Address.addressSpace());
+  writeInteger<uint16_t>(Address.type());
+}
@@ -5,7 +5,11 @@
 //
 
 #include <cstdint>
+#include <fstream>
 #include <iostream>
+#include <vector>
+
+#include "llvm/ADT/StringRef.h"
 
 #include "revng/Support/MetaAddress.h"
 
@@ -44,3 +48,66 @@ void disassemble(std::ostream &Result,
                  MetaAddress PC,
                  uint32_t MaxBytes = 4096,
                  uint32_t InstructionCount = 4096);
+
+/// \brief Streams the assembly and the PTC of the lifted instructions to a file
+///
+/// Instead of attaching the dumps to the module as metadata, records are
+/// appended to a binary file as soon as they're produced. Each record is
+/// composed by a kind (uint8_t), the MetaAddress of the original instruction
+/// (address, epoch, address space and type), the length of the text (uint32_t)
+/// and the text itself.
+///
+/// Upon destruction, an index is appended, associating the MetaAddress of each
+/// recorded instruction to the offset of its first record, followed by a
+/// footer composed by the offset of the index, the number of its entries and
+/// a magic value. All the integers are little endian.
+///
+/// If a sampling period N is specified, only one instruction out of N is
+/// recorded.
+class PTCDumpWriter {
+public:
+  enum RecordKind : uint8_t { Assembly, PTC };
+
+  static constexpr char Magic[] = "RVNGPTCD";
+
+private:
+  struct IndexEntry {
+    MetaAddress Address;
+    uint64_t Offset;
+  };
+
+private:
+  std::ofstream Output;
+  unsigned SamplingPeriod;
+  uint64_t SeenInstructions = 0;
+  MetaAddress Current = MetaAddress::invalid();
+  std::vector<IndexEntry> Index;
+
+public:
+  /// \param SamplingPeriod record one instruction every \p SamplingPeriod, 0
+  ///        and 1 record all of them.
+  PTCDumpWriter(llvm::StringRef Path, unsigned SamplingPeriod);
+
+  ~PTCDumpWriter();
+
+  PTCDumpWriter(const PTCDumpWriter &) = delete;
+  PTCDumpWriter &operator=(const PTCDumpWriter &) = delete;
+
+public:
+  /// \brief Notify that the instruction at \p PC is being lifted
+  ///
+  /// \return true if the instruction has been sampled, in which case the
+  ///         records written until the next call are associated to it.
+  bool newInstruction(MetaAddress PC);
+
+  /// \brief Whether the instruction being lifted has been sampled
+  bool isRecording() const { return Current.isValid(); }
+
+  /// \brief Append a record for the current instruction, if it's sampled
+  void write(RecordKind Kind, llvm::StringRef Text);
+
+private:
+  template<typename T>
+  void writeInteger(T Value);
+  void writeAddress(const MetaAddress &Address);
+};
@@ -22,6 +22,7 @@
 #include "llvm/Transforms/Utils/Cloning.h"
 #include "llvm/Transforms/Utils/ValueMapper.h"
 
+#include "revng/BasicAnalyses/GeneratedCodeBasicInfo.h"
 #include "revng/Support/Debug.h"
 #include "revng/Support/IRHelpers.h"
 
@@ -151,6 +152,51 @@ getTypeAtOffset(const DataLayout *TheLayout, Type *VarType, intptr_t Offset) {
   }
 }
 
+CPUStateLayout::CPUStateLayout(const DataLayout &Layout, StructType *Type) :
+  Slots(Layout.getTypeAllocSize(Type)) {
+  fill(Layout, Type, 0);
+}
+
+// This mirrors what getTypeAtOffset does, for all the offsets at once
+void CPUStateLayout::fill(const DataLayout &Layout, Type *T, size_t Base) {
+  switch (T->getTypeID()) {
+  case llvm::Type::TypeID::PointerTyID:
+    // Pointers are treated as padding, see getTypeAtOffset
+    break;
+
+  case llvm::Type::TypeID::IntegerTyID: {
+    auto *Integer = cast<IntegerType>(T);
+    uint64_t Size = Layout.getTypeAllocSize(Integer);
+    for (uint64_t Offset = 0; Offset < Size; ++Offset)
+      Slots[Base + Offset] = { SlotKind::Integer,
+                               { Integer, static_cast<unsigned>(Offset) } };
+  } break;
+
+  case llvm::Type::TypeID::ArrayTyID: {
+    Type *ElementType = T->getArrayElementType();
+    uint64_t ElementSize = Layout.getTypeAllocSize(ElementType);
+    for (uint64_t I = 0; I < T->getArrayNumElements(); ++I)
+      fill(Layout, ElementType, Base + I * ElementSize);
+  } break;
+
+  case llvm::Type::TypeID::StructTyID: {
+    auto *Struct = cast<StructType>(T);
+    const StructLayout *FieldsLayout = Layout.getStructLayout(Struct);
+    for (unsigned I = 0; I < Struct->getNumElements(); ++I)
+      fill(Layout,
+           Struct->getElementType(I),
+           Base + FieldsLayout->getElementOffset(I));
+  } break;
+
+  default:
+    // Let getTypeAtOffset handle it
+    uint64_t Size = Layout.getTypeAllocSize(T);
+    for (uint64_t Offset = 0; Offset < Size; ++Offset)
+      Slots[Base + Offset].Kind = SlotKind::Unsupported;
+    break;
+  }
+}
+
 VariableManager::VariableManager(Module &M, bool TargetIsLittleEndian) :
   TheModule(M),
   AllocaBuilder(getContext(&M)),
@@ -241,6 +287,9 @@ VariableManager::VariableManager(Module &M, bool TargetIsLittleEndian) :
       }
     }
   }
+
+  Layout = CPUStateLayout(*ModuleLayout, CPUStateType);
+  CSVByOffset.assign(Layout.size(), nullptr);
 }
 
 Optional<StoreInst *>
@@ -248,6 +297,8 @@ VariableManager::storeToCPUStateOffset(IRBuilder<> &Builder,
                                        unsigned StoreSize,
                                        unsigned Offset,
                                        Value *ToStore) {
+  invalidateKnownValues();
+
   Value *Target;
   unsigned Remaining;
   std::tie(Target, Remaining) = getByCPUStateOffsetInternal(Offset);
@@ -310,9 +361,27 @@ VariableManager::storeToCPUStateOffset(IRBuilder<> &Builder,
   return { Builder.CreateStore(ToStore, Target) };
 }
 
+bool VariableManager::canAccessCPUStateOffset(unsigned AccessSize,
+                                              unsigned Offset) {
+  GlobalVariable *Target = getByCPUStateOffsetInternal(Offset).first;
+  if (Target == nullptr)
+    return false;
+
+  // Accessing more than what fits in the field is valid only if what follows
+  // is padding, see loadFromCPUStateOffset and storeToCPUStateOffset
+  auto *FieldTy = cast<IntegerType>(Target->getValueType());
+  unsigned FieldSize = FieldTy->getBitWidth() / 8;
+  if (FieldSize < AccessSize)
+    return getByCPUStateOffsetInternal(Offset + FieldSize).first == nullptr;
+
+  return true;
+}
+
 Value *VariableManager::loadFromCPUStateOffset(IRBuilder<> &Builder,
                                                unsigned LoadSize,
                                                unsigned Offset) {
+  invalidateKnownValues();
+
   Value *Target;
   unsigned Remaining;
   std::tie(Target, Remaining) = getByCPUStateOffsetInternal(Offset);
@@ -363,6 +432,8 @@ bool VariableManager::memcpyAtEnvOffset(llvm::IRBuilder<> &Builder,
                                         llvm::CallInst *CallMemcpy,
                                         unsigned InitialEnvOffset,
                                         bool EnvIsSrc) {
+  invalidateKnownValues();
+
   Function *Callee = getCallee(CallMemcpy);
   // We only support memcpys where the last parameter is constant
   revng_assert(Callee != nullptr
@@ -425,6 +496,17 @@ void VariableManager::rebuildCSVList() {
     CSVsMD.push_back(QMD.get(P.second));
   NamedMD->clearOperands();
   NamedMD->addOperand(QMD.tuple(CSVsMD));
+
+  // Record the offset of each CSV, so that later passes don't have to derive
+  // it from the layout of the CPU state
+  NamedMDNode *OffsetsMD = TheModule.getOrInsertNamedMetadata(CSVOffsetsMDName);
+  std::vector<Metadata *> OffsetsTuple;
+  for (auto &[Offset, CSV] : CPUStateGlobals) {
+    Metadata *Entry[] = { QMD.get(CSV), QMD.get(static_cast<int64_t>(Offset)) };
+    OffsetsTuple.push_back(QMD.tuple(Entry));
+  }
+  OffsetsMD->clearOperands();
+  OffsetsMD->addOperand(QMD.tuple(OffsetsTuple));
 }
 
 void VariableManager::finalize() {
@@ -537,18 +619,24 @@ VariableManager::getByCPUStateOffset(intptr_t Offset, std::string Name) {
   return Result;
 }
 
+std::pair<IntegerType *, unsigned>
+VariableManager::getTypeAt(intptr_t Offset) const {
+  if (auto Field = Layout.lookup(Offset))
+    return { Field->Type, Field->Remaining };
+
+  return getTypeAtOffset(ModuleLayout, CPUStateType, Offset);
+}
+
 std::pair<GlobalVariable *, unsigned>
 VariableManager::getByCPUStateOffsetInternal(intptr_t Offset,
                                              std::string Name) {
-  GlobalsMap::iterator It = CPUStateGlobals.find(Offset);
+  GlobalVariable *Existing = getCSVAt(Offset);
   static const char *UnknownCSVPref = "state_0x";
-  if (It == CPUStateGlobals.end()
-      || (Name.size() != 0
-          && It->second->getName().startswith(UnknownCSVPref))) {
+  if (Existing == nullptr
+      || (Name.size() != 0 && Existing->getName().startswith(UnknownCSVPref))) {
     Type *VariableType;
     unsigned Remaining;
-    std::tie(VariableType,
-             Remaining) = getTypeAtOffset(ModuleLayout, CPUStateType, Offset);
+    std::tie(VariableType, Remaining) = getTypeAt(Offset);
 
     // Unsupported type, let the caller handle the situation
     if (VariableType == nullptr)
@@ -556,9 +644,8 @@ VariableManager::getByCPUStateOffsetInternal(intptr_t Offset,
 
     // Check we're not trying to go inside an existing variable
     if (Remaining != 0) {
-      GlobalsMap::iterator It = CPUStateGlobals.find(Offset - Remaining);
-      if (It != CPUStateGlobals.end())
-        return { It->second, Remaining };
+      if (GlobalVariable *Container = getCSVAt(Offset - Remaining))
+        return { Container, Remaining };
     }
 
     if (Name.size() == 0) {
@@ -579,18 +666,18 @@ VariableManager::getByCPUStateOffsetInternal(intptr_t Offset,
                                            Name);
     revng_assert(NewVariable != nullptr);
 
-    if (It != CPUStateGlobals.end()) {
-      It->second->replaceAllUsesWith(NewVariable);
-      eraseFromParent(It->second);
+    if (Existing != nullptr) {
+      Existing->replaceAllUsesWith(NewVariable);
+      eraseFromParent(Existing);
     }
 
-    CPUStateGlobals[Offset] = NewVariable;
+    setCSVAt(Offset, NewVariable);
 
     rebuildCSVList();
 
     return { NewVariable, Remaining };
   } else {
-    return { It->second, 0 };
+    return { Existing, 0 };
   }
 }
 
@@ -6,12 +6,15 @@
 
 #include <cstdint>
 #include <map>
+#include <optional>
 #include <string>
+#include <vector>
 
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/Pass.h"
 
 #include "revng/Support/CommandLine.h"
+#include "revng/Support/LocalValueCache.h"
 
 #include "CPUStateAccessAnalysisPass.h"
 #include "PTCDump.h"
@@ -21,6 +24,7 @@ class AllocaInst;
 class BasicBlock;
 class DataLayout;
 class GlobalVariable;
+class IntegerType;
 class Module;
 class StructType;
 class Value;
@@ -31,6 +35,55 @@ class VariableManager;
 // TODO: rename
 extern llvm::cl::opt<bool> External;
 
+/// \brief Offset-indexed description of the integer fields of the CPU state
+///
+/// It's built once from the layout of the CPU state type and never modified
+/// afterwards, therefore it can be shared among threads.
+class CPUStateLayout {
+public:
+  struct Field {
+    /// The integer type at a certain offset, nullptr for padding and pointers
+    llvm::IntegerType *Type = nullptr;
+
+    /// The offset within the field
+    unsigned Remaining = 0;
+  };
+
+private:
+  enum class SlotKind : uint8_t { Padding, Integer, Unsupported };
+
+  struct Slot {
+    SlotKind Kind = SlotKind::Padding;
+    Field Content;
+  };
+
+private:
+  std::vector<Slot> Slots;
+
+public:
+  CPUStateLayout() = default;
+  CPUStateLayout(const llvm::DataLayout &Layout, llvm::StructType *Type);
+
+public:
+  /// \return the field at \p Offset, or std::nullopt if \p Offset is out of
+  ///         the CPU state or it falls in a type this class doesn't handle
+  std::optional<Field> lookup(intptr_t Offset) const {
+    if (Offset < 0 or static_cast<size_t>(Offset) >= Slots.size())
+      return std::nullopt;
+
+    const Slot &Result = Slots[Offset];
+    if (Result.Kind == SlotKind::Unsupported)
+      return std::nullopt;
+
+    return Result.Content;
+  }
+
+  size_t size() const { return Slots.size(); }
+
+private:
+  void fill(const llvm::DataLayout &Layout, llvm::Type *Type, size_t Base);
+};
+
 /// \brief Maintain the list of variables required by PTC
 ///
 /// It can be queried for a variable, which, if not already existing, will be
@@ -43,7 +96,12 @@ public:
     AllocaBuilder.SetInsertPoint(I);
   }
 
-  llvm::Instruction *load(llvm::IRBuilder<> &Builder, unsigned TemporaryId) {
+  /// \brief Read the value of a PTC temporary
+  ///
+  /// If the value of the temporary is known, since it has already been loaded
+  /// or stored while translating the current guest instruction, no load is
+  /// emitted.
+  llvm::Value *load(llvm::IRBuilder<> &Builder, unsigned TemporaryId) {
     using namespace llvm;
 
     auto [IsNew, V] = getOrCreate(TemporaryId, true);
@@ -56,9 +114,26 @@ public:
       Builder.CreateStore(Undef, V);
     }
 
-    return Builder.CreateLoad(V);
+    return KnownValues.load(Builder, V);
   }
 
+  /// \brief Store \p ToStore in \p Destination, obtained from getOrCreate
+  ///
+  /// A previous store to \p Destination emitted while translating the current
+  /// guest instruction is dropped, if its value has not been read in the
+  /// meantime.
+  llvm::StoreInst *store(llvm::IRBuilder<> &Builder,
+                         llvm::Value *ToStore,
+                         llvm::Value *Destination) {
+    return KnownValues.store(Builder, ToStore, Destination);
+  }
+
+  /// \brief Forget the values of all the variables and all the pending stores
+  ///
+  /// Invoke this whenever the variables might be read or written behind the
+  /// back of the VariableManager, e.g., by an helper.
+  void invalidateKnownValues() { KnownValues.clear(); }
+
   /// \brief Get or create the LLVM value associated to a PTC temporary
   ///
   /// Given a PTC temporary identifier, checks if it already exists in the
@@ -100,7 +175,14 @@ public:
 
   /// Informs the VariableManager that a new basic block has begun, so it can
   /// discard basic block-level variables.
-  void newBasicBlock() { Temporaries.clear(); }
+  ///
+  /// Note: this is also invoked at the start of each guest instruction, since
+  ///       the block might be split at its newpc marker later on. Therefore,
+  ///       known values are never forwarded across guest instructions.
+  void newBasicBlock() {
+    Temporaries.clear();
+    invalidateKnownValues();
+  }
 
   /// Returns true if the given variable is the env variable
   bool isEnv(llvm::Value *TheValue);
@@ -120,6 +202,14 @@ public:
     return Locals;
   }
 
+  /// \brief Check whether loadFromEnvOffset and storeToEnvOffset would succeed
+  ///
+  /// No instruction is emitted: callers can use this to decide whether to
+  /// translate an access through CSVs before generating any code for it.
+  bool canAccessEnvOffset(unsigned AccessSize, unsigned Offset) {
+    return canAccessCPUStateOffset(AccessSize, EnvOffset + Offset);
+  }
+
   llvm::Value *loadFromEnvOffset(llvm::IRBuilder<> &Builder,
                                  unsigned LoadSize,
                                  unsigned Offset) {
@@ -157,6 +247,8 @@ private:
   std::pair<bool, llvm::Value *>
   getOrCreate(unsigned TemporaryId, bool Reading);
 
+  bool canAccessCPUStateOffset(unsigned AccessSize, unsigned Offset);
+
   llvm::Value *loadFromCPUStateOffset(llvm::IRBuilder<> &Builder,
                                       unsigned LoadSize,
                                       unsigned Offset);
@@ -173,18 +265,40 @@ private:
   std::pair<llvm::GlobalVariable *, unsigned>
   getByCPUStateOffsetInternal(intptr_t Offset, std::string Name = "");
 
+  std::pair<llvm::IntegerType *, unsigned> getTypeAt(intptr_t Offset) const;
+
+  llvm::GlobalVariable *getCSVAt(intptr_t Offset) const {
+    if (Offset >= 0 and static_cast<size_t>(Offset) < CSVByOffset.size())
+      return CSVByOffset[Offset];
+
+    auto It = CPUStateGlobals.find(Offset);
+    return It == CPUStateGlobals.end() ? nullptr : It->second;
+  }
+
+  void setCSVAt(intptr_t Offset, llvm::GlobalVariable *CSV) {
+    CPUStateGlobals[Offset] = CSV;
+    if (Offset >= 0 and static_cast<size_t>(Offset) < CSVByOffset.size())
+      CSVByOffset[Offset] = CSV;
+  }
+
 private:
   llvm::Module &TheModule;
   llvm::IRBuilder<> AllocaBuilder;
   using TemporariesMap = std::map<unsigned int, llvm::AllocaInst *>;
   using GlobalsMap = std::map<intptr_t, llvm::GlobalVariable *>;
   GlobalsMap CPUStateGlobals;
+  /// Mirror of CPUStateGlobals indexed by offset, for the offsets in Layout
+  std::vector<llvm::GlobalVariable *> CSVByOffset;
   GlobalsMap OtherGlobals;
   TemporariesMap Temporaries;
   TemporariesMap LocalTemporaries;
   PTCInstructionList *Instructions;
 
+  /// Values of the variables accessed by the current guest instruction
+  LocalValueCache KnownValues;
+
   llvm::StructType *CPUStateType;
+  CPUStateLayout Layout;
   const llvm::DataLayout *ModuleLayout;
   unsigned EnvOffset;
 
@@ -0,0 +1,429 @@
+/// \file VectorHelpers.cpp
+/// \brief Lowering of QEMU vector helpers into LLVM vector IR
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Intrinsics.h"
+#include "llvm/IR/PatternMatch.h"
+#include "llvm/Support/CommandLine.h"
+
+#include "revng/Support/Assert.h"
+#include "revng/Support/CommandLine.h"
+#include "revng/Support/Statistics.h"
+
+#include "VariableManager.h"
+#include "VectorHelpers.h"
+
+using namespace llvm;
+
+static cl::opt<bool> LiftVectorHelpers("lift-vector-helpers",
+                                       cl::desc("translate calls to known "
+                                                "QEMU vector helpers into LLVM "
+                                                "vector instructions"),
+                                       cl::cat(MainCategory),
+                                       cl::init(true));
+
+static cl::opt<bool> LiftFloatVectorHelpers("lift-float-vector-helpers",
+                                            cl::desc("translate also the "
+                                                     "packed floating point "
+                                                     "helpers, ignoring the "
+                                                     "rounding mode and the "
+                                                     "exception flags"),
+                                            cl::cat(MainCategory),
+                                            cl::init(false));
+
+static CounterMap<std::string> LoweredHelpers("lift-lowered-vector-helpers");
+
+namespace {
+
+enum class VectorOp {
+  Add,
+  Sub,
+  Mul,
+  And,
+  AndNot,
+  Or,
+  Xor,
+  CompareEqual,
+  CompareGreaterSigned,
+  CompareGreaterUnsigned,
+  MinSigned,
+  MinUnsigned,
+  MaxSigned,
+  MaxUnsigned,
+  AddSaturateSigned,
+  AddSaturateUnsigned,
+  SubSaturateSigned,
+  SubSaturateUnsigned,
+  AverageUnsigned,
+  UnpackLow,
+  UnpackHigh,
+  FAdd,
+  FSub,
+  FMul,
+  FDiv
+};
+
+struct VectorHelper {
+  VectorOp Op;
+  unsigned ElementBits;
+  bool IsFloat;
+
+  /// The size of the vector, in bytes
+  unsigned Size;
+
+  /// Whether the operands are pointers to registers in the CPU state, as
+  /// opposed to values
+  bool InCPUState;
+};
+
+struct HelperDescriptor {
+  const char *Name;
+  VectorOp Op;
+  unsigned ElementBits;
+};
+
+} // namespace
+
+using VO = VectorOp;
+
+/// x86 MMX and SSE helpers: `void helper(env, Reg *D, Reg *S)`, computing
+/// `D = D op S`, available both with the `_mmx` and the `_xmm` suffix
+static const HelperDescriptor X86Helpers[] = {
+  { "paddb", VO::Add, 8 },
+  { "paddw", VO::Add, 16 },
+  { "paddl", VO::Add, 32 },
+  { "paddq", VO::Add, 64 },
+  { "psubb", VO::Sub, 8 },
+  { "psubw", VO::Sub, 16 },
+  { "psubl", VO::Sub, 32 },
+  { "psubq", VO::Sub, 64 },
+  { "pmullw", VO::Mul, 16 },
+  { "pand", VO::And, 64 },
+  { "pandn", VO::AndNot, 64 },
+  { "por", VO::Or, 64 },
+  { "pxor", VO::Xor, 64 },
+  { "pcmpeqb", VO::CompareEqual, 8 },
+  { "pcmpeqw", VO::CompareEqual, 16 },
+  { "pcmpeql", VO::CompareEqual, 32 },
+  { "pcmpgtb", VO::CompareGreaterSigned, 8 },
+  { "pcmpgtw", VO::CompareGreaterSigned, 16 },
+  { "pcmpgtl", VO::CompareGreaterSigned, 32 },
+  { "pminub", VO::MinUnsigned, 8 },
+  { "pmaxub", VO::MaxUnsigned, 8 },
+  { "pminsw", VO::MinSigned, 16 },
+  { "pmaxsw", VO::MaxSigned, 16 },
+  { "paddsb", VO::AddSaturateSigned, 8 },
+  { "paddsw", VO::AddSaturateSigned, 16 },
+  { "paddusb", VO::AddSaturateUnsigned, 8 },
+  { "paddusw", VO::AddSaturateUnsigned, 16 },
+  { "psubsb", VO::SubSaturateSigned, 8 },
+  { "psubsw", VO::SubSaturateSigned, 16 },
+  { "psubusb", VO::SubSaturateUnsigned, 8 },
+  { "psubusw", VO::SubSaturateUnsigned, 16 },
+  { "pavgb", VO::AverageUnsigned, 8 },
+  { "pavgw", VO::AverageUnsigned, 16 },
+  { "punpcklbw", VO::UnpackLow, 8 },
+  { "punpcklwd", VO::UnpackLow, 16 },
+  { "punpckldq", VO::UnpackLow, 32 },
+  { "punpcklqdq", VO::UnpackLow, 64 },
+  { "punpckhbw", VO::UnpackHigh, 8 },
+  { "punpckhwd", VO::UnpackHigh, 16 },
+  { "punpckhdq", VO::UnpackHigh, 32 },
+  { "punpckhqdq", VO::UnpackHigh, 64 }
+};
+
+/// SSE packed floating point helpers, with the same signature of X86Helpers
+static const HelperDescriptor X86FloatHelpers[] = {
+  { "addps", VO::FAdd, 32 }, { "addpd", VO::FAdd, 64 },
+  { "subps", VO::FSub, 32 }, { "subpd", VO::FSub, 64 },
+  { "mulps", VO::FMul, 32 }, { "mulpd", VO::FMul, 64 },
+  { "divps", VO::FDiv, 32 }, { "divpd", VO::FDiv, 64 }
+};
+
+/// ARM NEON helpers: `uint32_t helper(uint32_t A, uint32_t B)`, computing
+/// `A op B` on the lanes of the arguments
+static const HelperDescriptor NEONHelpers[] = {
+  { "neon_add_u8", VO::Add, 8 },
+  { "neon_add_u16", VO::Add, 16 },
+  { "neon_sub_u8", VO::Sub, 8 },
+  { "neon_sub_u16", VO::Sub, 16 },
+  { "neon_mul_u8", VO::Mul, 8 },
+  { "neon_mul_u16", VO::Mul, 16 },
+  { "neon_ceq_u8", VO::CompareEqual, 8 },
+  { "neon_ceq_u16", VO::CompareEqual, 16 },
+  { "neon_cgt_s8", VO::CompareGreaterSigned, 8 },
+  { "neon_cgt_s16", VO::CompareGreaterSigned, 16 },
+  { "neon_cgt_u8", VO::CompareGreaterUnsigned, 8 },
+  { "neon_cgt_u16", VO::CompareGreaterUnsigned, 16 },
+  { "neon_min_s8", VO::MinSigned, 8 },
+  { "neon_min_s16", VO::MinSigned, 16 },
+  { "neon_min_u8", VO::MinUnsigned, 8 },
+  { "neon_min_u16", VO::MinUnsigned, 16 },
+  { "neon_max_s8", VO::MaxSigned, 8 },
+  { "neon_max_s16", VO::MaxSigned, 16 },
+  { "neon_max_u8", VO::MaxUnsigned, 8 },
+  { "neon_max_u16", VO::MaxUnsigned, 16 },
+  { "neon_rhadd_u8", VO::AverageUnsigned, 8 },
+  { "neon_rhadd_u16", VO::AverageUnsigned, 16 }
+};
+
+static const StringMap<VectorHelper> &getHelpers() {
+  static const StringMap<VectorHelper> Result = [] {
+    StringMap<VectorHelper> Helpers;
+
+    auto Register = [&Helpers](const HelperDescriptor &Helper,
+                               const char *Suffix,
+                               bool IsFloat,
+                               unsigned Size,
+                               bool InCPUState) {
+      std::string Name = std::string("helper_") + Helper.Name + Suffix;
+      Helpers[Name] = { Helper.Op, Helper.ElementBits, IsFloat, Size,
+                        InCPUState };
+    };
+
+    for (const HelperDescriptor &Helper : X86Helpers) {
+      Register(Helper, "_mmx", false, 8, true);
+      Register(Helper, "_xmm", false, 16, true);
+    }
+
+    for (const HelperDescriptor &Helper : X86FloatHelpers)
+      Register(Helper, "", true, 16, true);
+
+    for (const HelperDescriptor &Helper : NEONHelpers)
+      Register(Helper, "", false, 4, false);
+
+    return Helpers;
+  }();
+
+  return Result;
+}
+
+/// \return the offset in the CPU state \p Pointer points to, if it's `env`
+///         plus a constant
+static Optional<uint64_t>
+getEnvOffset(VariableManager &Variables, Value *Pointer) {
+  using namespace llvm::PatternMatch;
+
+  if (Variables.isEnv(Pointer))
+    return 0;
+
+  Value *Base = nullptr;
+  ConstantInt *Offset = nullptr;
+  if (match(Pointer, m_c_Add(m_Value(Base), m_ConstantInt(Offset)))
+      and Variables.isEnv(Base))
+    return Offset->getLimitedValue();
+
+  return {};
+}
+
+/// \return true if the register at \p Offset in the CPU state is entirely
+///         mapped on CSVs, i.e., if it can be loaded and stored in chunks of 8
+///         bytes
+static bool isRegisterMapped(VariableManager &Variables,
+                             uint64_t Offset,
+                             unsigned Size) {
+  for (unsigned I = 0; I < Size / 8; ++I)
+    if (not Variables.canAccessEnvOffset(8, Offset + 8 * I))
+      return false;
+
+  return true;
+}
+
+/// \brief Load the register at \p Offset in the CPU state as a vector of i64
+///
+/// \note The register must be mapped on CSVs, see isRegisterMapped.
+static Value *loadRegister(IRBuilder<> &Builder,
+                           VariableManager &Variables,
+                           uint64_t Offset,
+                           unsigned Size) {
+  unsigned Chunks = Size / 8;
+  Value *Result = UndefValue::get(FixedVectorType::get(Builder.getInt64Ty(),
+                                                       Chunks));
+  for (unsigned I = 0; I < Chunks; ++I) {
+    Value *Chunk = Variables.loadFromEnvOffset(Builder, 8, Offset + 8 * I);
+    revng_assert(Chunk != nullptr, "Cannot load a mapped register");
+    Result = Builder.CreateInsertElement(Result, Chunk, I);
+  }
+
+  return Result;
+}
+
+static void storeRegister(IRBuilder<> &Builder,
+                          VariableManager &Variables,
+                          uint64_t Offset,
+                          Value *Register) {
+  auto *RegisterType = cast<FixedVectorType>(Register->getType());
+  for (unsigned I = 0; I < RegisterType->getNumElements(); ++I) {
+    Value *Chunk = Builder.CreateExtractElement(Register, I);
+    auto MaybeStore = Variables.storeToEnvOffset(Builder,
+                                                 8,
+                                                 Offset + 8 * I,
+                                                 Chunk);
+    revng_assert(MaybeStore.hasValue(), "Cannot store a mapped register");
+  }
+}
+
+static Value *
+compute(IRBuilder<> &Builder, VectorOp Op, Value *D, Value *S) {
+  auto *Type = cast<FixedVectorType>(D->getType());
+  unsigned Lanes = Type->getNumElements();
+
+  switch (Op) {
+  case VO::Add:
+    return Builder.CreateAdd(D, S);
+  case VO::Sub:
+    return Builder.CreateSub(D, S);
+  case VO::Mul:
+    return Builder.CreateMul(D, S);
+  case VO::And:
+    return Builder.CreateAnd(D, S);
+  case VO::AndNot:
+    return Builder.CreateAnd(Builder.CreateNot(D), S);
+  case VO::Or:
+    return Builder.CreateOr(D, S);
+  case VO::Xor:
+    return Builder.CreateXor(D, S);
+
+  case VO::CompareEqual:
+    return Builder.CreateSExt(Builder.CreateICmpEQ(D, S), Type);
+  case VO::CompareGreaterSigned:
+    return Builder.CreateSExt(Builder.CreateICmpSGT(D, S), Type);
+  case VO::CompareGreaterUnsigned:
+    return Builder.CreateSExt(Builder.CreateICmpUGT(D, S), Type);
+
+  case VO::MinSigned:
+    return Builder.CreateSelect(Builder.CreateICmpSLT(D, S), D, S);
+  case VO::MinUnsigned:
+    return Builder.CreateSelect(Builder.CreateICmpULT(D, S), D, S);
+  case VO::MaxSigned:
+    return Builder.CreateSelect(Builder.CreateICmpSGT(D, S), D, S);
+  case VO::MaxUnsigned:
+    return Builder.CreateSelect(Builder.CreateICmpUGT(D, S), D, S);
+
+  case VO::AddSaturateSigned:
+    return Builder.CreateBinaryIntrinsic(Intrinsic::sadd_sat, D, S);
+  case VO::AddSaturateUnsigned:
+    return Builder.CreateBinaryIntrinsic(Intrinsic::uadd_sat, D, S);
+  case VO::SubSaturateSigned:
+    return Builder.CreateBinaryIntrinsic(Intrinsic::ssub_sat, D, S);
+  case VO::SubSaturateUnsigned:
+    return Builder.CreateBinaryIntrinsic(Intrinsic::usub_sat, D, S);
+
+  case VO::AverageUnsigned: {
+    // (D + S + 1) >> 1, without overflowing
+    auto *WideType = VectorType::getExtendedElementVectorType(Type);
+    Value *Sum = Builder.CreateAdd(Builder.CreateZExt(D, WideType),
+                                   Builder.CreateZExt(S, WideType));
+    Sum = Builder.CreateAdd(Sum, ConstantInt::get(WideType, 1));
+    return Builder.CreateTrunc(Builder.CreateLShr(Sum, 1), Type);
+  }
+
+  case VO::UnpackLow:
+  case VO::UnpackHigh: {
+    // Interleave the lanes of the lower (or upper) halves of D and S
+    SmallVector<int, 16> Mask;
+    unsigned First = Op == VO::UnpackLow ? 0 : Lanes / 2;
+    for (unsigned I = 0; I < Lanes / 2; ++I) {
+      Mask.push_back(First + I);
+      Mask.push_back(Lanes + First + I);
+    }
+    return Builder.CreateShuffleVector(D, S, Mask);
+  }
+
+  case VO::FAdd:
+    return Builder.CreateFAdd(D, S);
+  case VO::FSub:
+    return Builder.CreateFSub(D, S);
+  case VO::FMul:
+    return Builder.CreateFMul(D, S);
+  case VO::FDiv:
+    return Builder.CreateFDiv(D, S);
+  }
+
+  revng_abort();
+}
+
+bool lowerVectorHelper(IRBuilder<> &Builder,
+                       VariableManager &Variables,
+                       StringRef Name,
+                       ArrayRef<Value *> Arguments,
+                       Value *&Result) {
+  if (not LiftVectorHelpers)
+    return false;
+
+  const StringMap<VectorHelper> &Helpers = getHelpers();
+  auto It = Helpers.find(Name);
+  if (It == Helpers.end())
+    return false;
+
+  const VectorHelper &Helper = It->second;
+  if (Helper.IsFloat and not LiftFloatVectorHelpers)
+    return false;
+
+  Type *ElementType = nullptr;
+  if (not Helper.IsFloat)
+    ElementType = Builder.getIntNTy(Helper.ElementBits);
+  else if (Helper.ElementBits == 32)
+    ElementType = Builder.getFloatTy();
+  else
+    ElementType = Builder.getDoubleTy();
+
+  unsigned Lanes = Helper.Size * 8 / Helper.ElementBits;
+  auto *Type = FixedVectorType::get(ElementType, Lanes);
+
+  if (Helper.InCPUState) {
+    if (Arguments.size() != 3 or not Variables.isEnv(Arguments[0]))
+      return false;
+
+    auto DestinationOffset = getEnvOffset(Variables, Arguments[1]);
+    auto SourceOffset = getEnvOffset(Variables, Arguments[2]);
+    if (not DestinationOffset or not SourceOffset)
+      return false;
+
+    // Check both registers before emitting anything, so that falling back to
+    // the helper call doesn't leave dead loads behind
+    if (not isRegisterMapped(Variables, *DestinationOffset, Helper.Size)
+        or not isRegisterMapped(Variables, *SourceOffset, Helper.Size))
+      return false;
+
+    Value *Destination = loadRegister(Builder,
+                                      Variables,
+                                      *DestinationOffset,
+                                      Helper.Size);
+    Value *Source = loadRegister(Builder,
+                                 Variables,
+                                 *SourceOffset,
+                                 Helper.Size);
+
+    Value *Computed = compute(Builder,
+                              Helper.Op,
+                              Builder.CreateBitCast(Destination, Type),
+                              Builder.CreateBitCast(Source, Type));
+    storeRegister(Builder,
+                  Variables,
+                  *DestinationOffset,
+                  Builder.CreateBitCast(Computed, Destination->getType()));
+    Result = nullptr;
+  } else {
+    auto *IntegerType = Builder.getIntNTy(Helper.Size * 8);
+    if (Arguments.size() != 2 or Arguments[0]->getType() != IntegerType
+        or Arguments[1]->getType() != IntegerType)
+      return false;
+
+    Value *Computed = compute(Builder,
+                              Helper.Op,
+                              Builder.CreateBitCast(Arguments[0], Type),
+                              Builder.CreateBitCast(Arguments[1], Type));
+    Result = Builder.CreateBitCast(Computed, IntegerType);
+  }
+
+  LoweredHelpers.push(Name.str());
+  return true;
+}
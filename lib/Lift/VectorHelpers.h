@@ -0,0 +1,38 @@
+#pragma once
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/IR/IRBuilder.h"
+
+class VariableManager;
+
+/// \brief Try to replace a call to a QEMU vector helper with LLVM vector IR
+///
+/// Calls to helpers operating on SIMD registers would otherwise be translated
+/// into opaque calls, executed one lane at a time by the helper. The supported
+/// helpers are:
+///
+/// * the x86 MMX/SSE integer helpers taking the destination and source
+///   registers as pointers in the CPU state (e.g., `helper_paddb_xmm`): the
+///   registers are loaded from and stored to the corresponding CSVs;
+/// * the ARM NEON helpers operating on the lanes of 32-bit values (e.g.,
+///   `helper_neon_add_u8`).
+///
+/// Packed floating point helpers are lowered only if requested (see
+/// -lift-float-vector-helpers), since the resulting IR ignores the rounding
+/// mode and the exception flags of the guest.
+///
+/// \param Name the name of the helper.
+/// \param Arguments the arguments the helper would be called with.
+/// \param Result set to the value returned by the helper, if any.
+///
+/// \return true if the call has been lowered and must not be emitted.
+bool lowerVectorHelper(llvm::IRBuilder<> &Builder,
+                       VariableManager &Variables,
+                       llvm::StringRef Name,
+                       llvm::ArrayRef<llvm::Value *> Arguments,
+                       llvm::Value *&Result);
@@ -5,23 +5,126 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <atomic>
+#include <deque>
+
 #include "llvm/ADT/DepthFirstIterator.h"
 #include "llvm/BinaryFormat/ELF.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/DOTGraphTraits.h"
 #include "llvm/Support/GraphWriter.h"
 #include "llvm/Support/raw_os_ostream.h"
 
 #include "revng/ADT/GenericGraph.h"
 #include "revng/Model/Binary.h"
+#include "revng/Model/TypeReferenceGraph.h"
 #include "revng/Model/VerifyHelper.h"
+#include "revng/Support/CommandLine.h"
 #include "revng/Support/OverflowSafeInt.h"
+#include "revng/Support/TaskScheduler.h"
+#include "revng/TupleTree/TupleTreeDiff.h"
+#include "revng/TupleTree/YAMLSerialization.h"
 
 using namespace llvm;
 
+// The model must never fall back to the slower llvm::yaml (de)serialization
+static_assert(tupletree::yaml::IsSupported<model::Binary>);
+
+static cl::opt<unsigned> VerifyJobs("model-verify-jobs",
+                                    cl::desc("number of tasks verifying the "
+                                             "types of the model, 0 for one "
+                                             "per thread of revng"),
+                                    cl::init(0),
+                                    cl::cat(MainCategory));
+
+/// Below this number of types per task, verifying in parallel does not pay
+static constexpr size_t MinimumTypesPerJob = 1024;
+
+/// \brief Verify \p ToVerify, distributing them over multiple tasks
+///
+/// Each task has its own VerifyHelper, reusing the results already in \p VH.
+/// Once all the tasks are done, their results are merged into \p VH.
+static bool
+verifyTypesInParallel(model::VerifyHelper &VH,
+                      const std::vector<const model::Type *> &ToVerify) {
+  size_t Threads = VerifyJobs;
+  if (Threads == 0)
+    Threads = TaskScheduler::get().getThreadsCount();
+  Threads = std::min(Threads, ToVerify.size() / MinimumTypesPerJob);
+
+  if (Threads <= 1) {
+    for (const model::Type *T : ToVerify)
+      if (not T->verify(VH))
+        return VH.fail();
+    return true;
+  }
+
+  std::deque<model::VerifyHelper> Helpers;
+  for (size_t I = 0; I < Threads; ++I)
+    Helpers.emplace_back(&VH);
+
+  std::atomic<size_t> Next = 0;
+  std::atomic<bool> Failed = false;
+  auto Worker = [&ToVerify, &Next, &Failed](model::VerifyHelper &Helper) {
+    while (not Failed) {
+      size_t Index = Next++;
+      if (Index >= ToVerify.size())
+        return;
+
+      if (not ToVerify[Index]->verify(Helper))
+        Failed = true;
+    }
+  };
+
+  {
+    TaskGroup Group;
+    for (model::VerifyHelper &Helper : Helpers)
+      Group.spawn([&Worker, &Helper] { Worker(Helper); });
+    Group.wait();
+  }
+
+  if (Failed)
+    return VH.fail();
+
+  for (model::VerifyHelper &Helper : Helpers)
+    VH.merge(std::move(Helper));
+
+  return true;
+}
+
 namespace model {
 
+/// Build the path of \p T directly, without going through its string form
+template<ConstOrNot<Binary> BinaryT>
+static TypePath getTypePathImpl(BinaryT *Root, const model::Type *T) {
+  using Fields = TupleLikeTraits<Binary>::Fields;
+  using Key = std::remove_cv_t<decltype(Binary::Types)::key_type>;
+
+  TupleTreePath Path;
+  Path.push_back(static_cast<size_t>(Fields::Types));
+  Path.push_back(Key(T->key()));
+  return TypePath::fromPath(Root, Path);
+}
+
+model::TypePath Binary::getTypePath(const model::Type *T) {
+  return getTypePathImpl(this, T);
+}
+
+model::TypePath Binary::getTypePath(const model::Type *T) const {
+  return getTypePathImpl(this, T);
+}
+
 model::TypePath
 Binary::getPrimitiveType(PrimitiveTypeKind::Values V, uint8_t ByteSize) {
+  auto *Entry = PrimitiveTypePositions.get(V, ByteSize);
+
+  // Try the position we found the last time
+  if (Entry != nullptr and Entry->Valid and Entry->Position < Types.size()) {
+    const model::Type *Candidate = Types.begin()[Entry->Position].get();
+    if (Candidate->key() == Entry->Key)
+      return getTypePath(Candidate);
+  }
+
   PrimitiveType Temporary(V, ByteSize);
   Type::Key PrimitiveKey{ TypeKind::PrimitiveType, Temporary.ID };
   auto It = Types.find(PrimitiveKey);
@@ -32,6 +135,12 @@ Binary::getPrimitiveType(PrimitiveTypeKind::Values V, uint8_t ByteSize) {
     It = Types.insert(UpcastablePointer<model::Type>(NewPrimitiveType)).first;
   }
 
+  if (Entry != nullptr) {
+    Entry->Position = std::distance(Types.begin(), It);
+    Entry->Key = PrimitiveKey;
+    Entry->Valid = true;
+  }
+
   return getTypePath(It->get());
 }
 
@@ -58,13 +167,21 @@ bool Binary::verifyTypes(bool Assert) const {
 
 bool Binary::verifyTypes(VerifyHelper &VH) const {
   // All types on their own should verify
+  std::vector<const model::Type *> ToVerify;
+  ToVerify.reserve(Types.size());
+  for (auto &Type : Types)
+    ToVerify.push_back(Type.get());
+
+  if (not verifyTypesInParallel(VH, ToVerify))
+    return VH.fail();
+
+  return verifyTypeNames(VH);
+}
+
+bool Binary::verifyTypeNames(VerifyHelper &VH) const {
+  // Ensure the names are unique
   std::set<Identifier> Names;
   for (auto &Type : Types) {
-    // Verify the type
-    if (not Type.get()->verify(VH))
-      return VH.fail();
-
-    // Ensure the names are unique
     auto Name = Type->name();
     if (not Names.insert(Name).second)
       return VH.fail(Twine("Multiple types with the following name: ") + Name);
@@ -94,6 +211,26 @@ bool Binary::verify(bool Assert) const {
 }
 
 bool Binary::verify(VerifyHelper &VH) const {
+  // Verify individual functions
+  for (const Function &F : Functions)
+    if (not F.verify(VH))
+      return VH.fail();
+
+  // Verify DynamicFunctions
+  for (const DynamicFunction &DF : ImportedDynamicFunctions)
+    if (not DF.verify(VH))
+      return VH.fail();
+
+  if (not verifyCustomNames(VH))
+    return VH.fail();
+
+  //
+  // Verify the type system
+  //
+  return verifyTypes(VH);
+}
+
+bool Binary::verifyCustomNames(VerifyHelper &VH) const {
   // Prepare for checking symbol names. We will populate and check this against
   // functions, dynamic functions, types and enum entries
   std::set<Identifier> Symbols;
@@ -106,23 +243,13 @@ bool Binary::verify(VerifyHelper &VH) const {
                         *this);
   };
 
-  for (const Function &F : Functions) {
-    // Verify individual functions
-    if (not F.verify(VH))
-      return VH.fail();
-
+  for (const Function &F : Functions)
     if (not CheckCustomName(F.CustomName))
       return VH.fail("Duplicate name", F);
-  }
-
-  // Verify DynamicFunctions
-  for (const DynamicFunction &DF : ImportedDynamicFunctions) {
-    if (not DF.verify(VH))
-      return VH.fail();
 
+  for (const DynamicFunction &DF : ImportedDynamicFunctions)
     if (not CheckCustomName(DF.CustomName))
       return VH.fail();
-  }
 
   for (auto &Type : Types) {
     if (not CheckCustomName(Type->CustomName))
@@ -134,10 +261,202 @@ bool Binary::verify(VerifyHelper &VH) const {
           return VH.fail();
   }
 
-  //
-  // Verify the type system
-  //
-  return verifyTypes(VH);
+  return true;
+}
+
+namespace {
+
+/// The elements of a model::Binary that a diff might have invalidated
+struct TouchedElements {
+  std::set<TupleTreePath> Functions;
+  std::set<TupleTreePath> DynamicFunctions;
+  std::set<TupleTreePath> Types;
+  bool Names = false;
+};
+
+} // namespace
+
+static TupleTreePath pathOf(llvm::StringRef Path) {
+  auto MaybePath = stringAsPath<model::Binary>(Path);
+  revng_assert(MaybePath.has_value());
+  return std::move(*MaybePath);
+}
+
+/// \return the path of the element of the collection \p Field that has been
+///         added or removed by a change on the collection itself
+template<typename T>
+static std::optional<TupleTreePath>
+elementPath(llvm::StringRef Field,
+            const std::optional<TupleTreeEntriesT<model::Binary>> &Entry) {
+  if (not Entry.has_value())
+    return std::nullopt;
+
+  const T *Element = std::get_if<T>(&*Entry);
+  if (Element == nullptr)
+    return std::nullopt;
+
+  auto Key = KeyedObjectTraits<T>::key(*Element);
+  return pathOf("/" + Field.str() + "/" + getNameFromYAMLScalar(Key));
+}
+
+template<typename T>
+static void recordElement(std::set<TupleTreePath> &Touched,
+                          llvm::StringRef Field,
+                          const TupleTreePath &Collection,
+                          const TupleTreeDiff<model::Binary>::Change &C) {
+  if (not Collection.isPrefixOf(C.Path))
+    return;
+
+  if (C.Path.size() > Collection.size()) {
+    // The change is within an element
+    TupleTreePath Element = C.Path;
+    Element.resize(Collection.size() + 1);
+    Touched.insert(std::move(Element));
+  } else {
+    // An element has been added to or removed from the collection
+    if (auto Path = elementPath<T>(Field, C.Old))
+      Touched.insert(std::move(*Path));
+    if (auto Path = elementPath<T>(Field, C.New))
+      Touched.insert(std::move(*Path));
+  }
+}
+
+static TouchedElements
+collectTouchedElements(const TupleTreeDiff<model::Binary> &Diff) {
+  static const TupleTreePath FunctionsPath = pathOf("/Functions");
+  static const TupleTreePath
+    DynamicFunctionsPath = pathOf("/ImportedDynamicFunctions");
+  static const TupleTreePath TypesPath = pathOf("/Types");
+
+  TouchedElements Result;
+  for (const TupleTreeDiff<model::Binary>::Change &C : Diff.Changes) {
+    recordElement<model::Function>(Result.Functions,
+                                   "Functions",
+                                   FunctionsPath,
+                                   C);
+    recordElement<model::DynamicFunction>(Result.DynamicFunctions,
+                                          "ImportedDynamicFunctions",
+                                          DynamicFunctionsPath,
+                                          C);
+    recordElement<UpcastablePointer<model::Type>>(Result.Types,
+                                                  "Types",
+                                                  TypesPath,
+                                                  C);
+
+    // Names have to be unique across the whole binary: any renaming, as well
+    // as any addition, requires to check them again
+    bool IsAddition = C.New.has_value() and not C.Old.has_value();
+    auto AsString = pathAsString<model::Binary>(C.Path);
+    bool IsRenaming = AsString.has_value()
+                      and llvm::StringRef(*AsString).endswith("/CustomName");
+    Result.Names = Result.Names or IsAddition or IsRenaming;
+  }
+
+  return Result;
+}
+
+/// Invokes \p Callback on the path of each type referenced by \p Element
+template<typename T, typename L>
+static void forEachReferencedType(const T &Element, const L &Callback) {
+  static const TupleTreePath TypesPath = pathOf("/Types");
+
+  auto Visitor = [&Callback](const auto &Node) {
+    using type = std::remove_cvref_t<decltype(Node)>;
+    if constexpr (IsTupleTreeReference<type>) {
+      if (TypesPath.isPrefixOf(Node.path())
+          and Node.path().size() > TypesPath.size()) {
+        TupleTreePath Referenced = Node.path();
+        Referenced.resize(TypesPath.size() + 1);
+        Callback(Referenced);
+      }
+    }
+  };
+
+  visitTupleTree(Element, Visitor, [](const auto &) {});
+}
+
+bool Binary::verifyChanges(const TupleTreeDiff<model::Binary> &Applied) const {
+  return verifyChanges(Applied, false);
+}
+
+bool Binary::verifyChanges(const TupleTreeDiff<model::Binary> &Applied,
+                           bool Assert) const {
+  VerifyHelper VH(Assert);
+  return verifyChanges(Applied, VH);
+}
+
+bool Binary::verifyChanges(const TupleTreeDiff<model::Binary> &Applied,
+                           VerifyHelper &VH) const {
+  TouchedElements Touched = collectTouchedElements(Applied);
+
+  if (not Touched.Types.empty()) {
+    // Types embedding or pointing to a touched type might be affected too
+    // (e.g., their size changes), propagate to all the transitive referrers.
+    // The same goes for types referring to types that are no longer there.
+    TypeReferenceGraph Graph(*this);
+    std::vector<TypeReferenceGraph::NodeID> Roots(Graph.dangling().begin(),
+                                                  Graph.dangling().end());
+    for (const TupleTreePath &Path : Touched.Types)
+      if (auto *T = getByPath<const model::Type>(Path, *this))
+        Roots.push_back(Graph.id(T));
+
+    llvm::BitVector Affected = Graph.reachingTo(Roots);
+    for (unsigned Node : Affected.set_bits())
+      Touched.Types.insert(getTypePath(Graph.type(Node)).path());
+
+    // Functions whose prototypes are among the affected types
+    const auto IsAffected = [&Touched](const TupleTreePath &Referenced) {
+      return Touched.Types.count(Referenced) != 0;
+    };
+
+    for (const Function &F : Functions) {
+      bool Affected = false;
+      forEachReferencedType(F, [&](const TupleTreePath &Referenced) {
+        Affected = Affected or IsAffected(Referenced);
+      });
+      if (Affected) {
+        auto Key = getNameFromYAMLScalar(F.key());
+        Touched.Functions.insert(pathOf("/Functions/" + Key));
+      }
+    }
+
+    for (const DynamicFunction &DF : ImportedDynamicFunctions) {
+      bool Affected = false;
+      forEachReferencedType(DF, [&](const TupleTreePath &Referenced) {
+        Affected = Affected or IsAffected(Referenced);
+      });
+      if (Affected) {
+        auto Key = getNameFromYAMLScalar(DF.key());
+        Touched.DynamicFunctions.insert(pathOf("/ImportedDynamicFunctions/"
+                                               + Key));
+      }
+    }
+  }
+
+  // Elements that have been removed are no longer there, skip them
+  for (const TupleTreePath &Path : Touched.Functions)
+    if (auto *F = getByPath<const model::Function>(Path, *this))
+      if (not F->verify(VH))
+        return VH.fail();
+
+  for (const TupleTreePath &Path : Touched.DynamicFunctions)
+    if (auto *DF = getByPath<const model::DynamicFunction>(Path, *this))
+      if (not DF->verify(VH))
+        return VH.fail();
+
+  std::vector<const model::Type *> ToVerify;
+  for (const TupleTreePath &Path : Touched.Types)
+    if (auto *T = getByPath<const model::Type>(Path, *this))
+      ToVerify.push_back(T);
+
+  if (not verifyTypesInParallel(VH, ToVerify))
+    return VH.fail();
+
+  if (Touched.Names)
+    if (not verifyCustomNames(VH) or not verifyTypeNames(VH))
+      return VH.fail();
+
+  return true;
 }
 
 Identifier Function::name() const {
@@ -7,8 +7,11 @@
 #include <cstdint>
 
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/xxhash.h"
 
 #include "revng/Model/Architecture.h"
+#include "revng/Model/Segment.h"
 #include "revng/Support/Debug.h"
 #include "revng/Support/MetaAddress.h"
 
@@ -44,4 +47,14 @@ public:
 
 public:
   static uint64_t u64(uint64_t Value) { return Value; }
+
+  /// \brief Record in \p Segment the digest of its contents in \p File
+  ///
+  /// The bytes are hashed directly in the buffer of the input file, no copy
+  /// is made. Portions of the segment exceeding the file are ignored.
+  static void hashContent(model::Segment &Segment, llvm::StringRef File) {
+    llvm::StringRef Content = File.substr(Segment.StartOffset,
+                                          Segment.FileSize);
+    Segment.ContentHash = llvm::xxHash64(Content);
+  }
 };
@@ -5,10 +5,12 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <chrono>
 #include <cstdint>
 #include <optional>
 
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/DebugInfo/DWARF/DWARFContext.h"
 #include "llvm/Object/ELF.h"
 #include "llvm/Object/ELFObjectFile.h"
 #include "llvm/Object/ObjectFile.h"
@@ -18,6 +20,7 @@
 #include "revng/Model/Importer/Dwarf/DwarfImporter.h"
 #include "revng/Model/RawBinaryView.h"
 #include "revng/Support/Debug.h"
+#include "revng/Support/TaskScheduler.h"
 
 #include "BinaryImporterHelper.h"
 #include "DwarfReader.h"
@@ -167,6 +170,14 @@ private:
   Optional<MetaAddress> EHFrameHdrAddress;
   Optional<MetaAddress> DynamicAddress;
 
+  /// Number of symbols and relocations parsed, for reporting the throughput
+  uint64_t ParsedSymbols = 0;
+  uint64_t ParsedRelocations = 0;
+
+  using FunctionsInserter = SortedVector<model::Function>::BatchInserter;
+  using DynamicFunctionsInserter = SortedVector<
+    model::DynamicFunction>::BatchInserter;
+
 public:
   ELFImporter(TupleTree<model::Binary> &Model,
               const object::ELFObjectFileBase &TheBinary,
@@ -250,12 +261,16 @@ private:
   void parseProgramHeaders(object::ELFFile<T> &TheELF);
 
   template<typename T>
-  void
-  parseDynamicSymbol(llvm::object::Elf_Sym_Impl<T> &Symbol, StringRef Dynstr);
+  void parseDynamicSymbol(llvm::object::Elf_Sym_Impl<T> &Symbol,
+                          StringRef Dynstr,
+                          FunctionsInserter &Functions,
+                          DynamicFunctionsInserter &DynamicFunctions);
 };
 
 template<typename T, bool HasAddend>
 Error ELFImporter::import() {
+  auto Start = std::chrono::steady_clock::now();
+
   // Parse the ELF file
   auto TheELFOrErr = object::ELFFile<T>::create(TheBinary.getData());
   if (not TheELFOrErr)
@@ -277,6 +292,15 @@ Error ELFImporter::import() {
     return createError("Only ELF executables and ELF dynamic libraries are "
                        "supported");
 
+  // Parsing the debug info only reads the binary: do it in background while
+  // we import the rest, the conversion to the model will take place at the
+  // end, as before, so that the result is deterministic
+  std::unique_ptr<DWARFContext> ParsedDWARF;
+  TaskGroup DWARFParser;
+  DWARFParser.spawn([this, &ParsedDWARF]() {
+    ParsedDWARF = DwarfImporter::parse(TheBinary);
+  });
+
   // Look for static or dynamic symbols and relocations
   ConstElf_Shdr<T> *SymtabShdr = nullptr;
   Optional<MetaAddress> EHFrameAddress;
@@ -472,8 +496,14 @@ Error ELFImporter::import() {
 
       ArrayRef<Elf_Sym> Symbols = DynsymPortion.extractAs<Elf_Sym>();
 
-      for (Elf_Sym Symbol : Symbols)
-        parseDynamicSymbol<T>(Symbol, Dynstr);
+      {
+        // New functions are appended and sorted once at the end of the scope
+        Model->Functions.reserve(Model->Functions.size() + Symbols.size());
+        auto Functions = Model->Functions.batch_insert();
+        auto DynamicFunctions = Model->ImportedDynamicFunctions.batch_insert();
+        for (Elf_Sym Symbol : Symbols)
+          parseDynamicSymbol<T>(Symbol, Dynstr, Functions, DynamicFunctions);
+      }
 
       using Elf_Rel = llvm::object::Elf_Rel_Impl<T, HasAddend>;
       if (ReldynPortion.isAvailable()) {
@@ -528,12 +558,26 @@ Error ELFImporter::import() {
     }
   }
 
+  if (Log.isEnabled()) {
+    using namespace std::chrono;
+    auto Elapsed = steady_clock::now() - Start;
+    double Seconds = duration_cast<duration<double>>(Elapsed).count();
+    uint64_t Size = TheBinary.getData().size();
+    Log << "Parsed " << ParsedSymbols << " symbols and " << ParsedRelocations
+        << " relocations of a " << Size << " bytes file in " << Seconds
+        << " seconds";
+    if (Seconds > 0)
+      Log << " (" << (Size / Seconds / (1024 * 1024)) << " MiB/s)";
+    Log << DoLog;
+  }
+
   // Create a default prototype
   Model->DefaultPrototype = abi::registerDefaultFunctionPrototype(*Model.get());
 
   // Import Dwarf
+  DWARFParser.wait();
   DwarfImporter Importer(Model);
-  Importer.import(TheBinary, "");
+  Importer.import(TheBinary, "", ParsedDWARF.get());
 
   return Error::success();
 }
@@ -568,7 +612,12 @@ void ELFImporter::parseSymbols(object::ELFFile<T> &TheELF,
     return;
   }
 
+  // New functions are appended and sorted once at the end
+  Model->Functions.reserve(Model->Functions.size() + ELFSymbols->size());
+  auto Functions = Model->Functions.batch_insert();
+
   for (auto &Symbol : *ELFSymbols) {
+    ++ParsedSymbols;
     auto MaybeName = expectedToOptional(Symbol.getName(StrtabContent));
 
     bool IsCode = Symbol.getType() == ELF::STT_FUNC;
@@ -584,13 +633,12 @@ void ELFImporter::parseSymbols(object::ELFFile<T> &TheELF,
       Address = relocate(fromGeneric(Symbol.st_value));
 
     if (IsCode) {
-      auto It = Model->Functions.find(Address);
-      if (It == Model->Functions.end()) {
-        model::Function &Function = Model->Functions[Address];
-        Function.Type = model::FunctionType::Invalid;
-        if (MaybeName)
-          Function.OriginalName = *MaybeName;
-      }
+      // Functions already there, or inserted before, take precedence
+      model::Function Function(Address);
+      Function.Type = model::FunctionType::Invalid;
+      if (MaybeName)
+        Function.OriginalName = *MaybeName;
+      Functions.insert(Function);
     }
   }
 }
@@ -678,6 +726,8 @@ void ELFImporter::parseProgramHeaders(object::ELFFile<T> &TheELF) {
         }
       }
 
+      hashContent(NewSegment, TheBinary.getData());
+
       NewSegment.verify(true);
 
       Model->Segments.insert(std::move(NewSegment));
@@ -723,7 +773,11 @@ void ELFImporter::parseProgramHeaders(object::ELFFile<T> &TheELF) {
 
 template<typename T>
 void ELFImporter::parseDynamicSymbol(llvm::object::Elf_Sym_Impl<T> &Symbol,
-                                     StringRef Dynstr) {
+                                     StringRef Dynstr,
+                                     FunctionsInserter &Functions,
+                                     DynamicFunctionsInserter
+                                       &DynamicFunctions) {
+  ++ParsedSymbols;
   Expected<llvm::StringRef> MaybeName = Symbol.getName(Dynstr);
   if (not MaybeName) {
     auto TheError = MaybeName.takeError();
@@ -747,7 +801,7 @@ void ELFImporter::parseDynamicSymbol(llvm::object::Elf_Sym_Impl<T> &Symbol,
   if (Symbol.st_shndx == ELF::SHN_UNDEF) {
     if (IsCode) {
       // Create dynamic function symbol
-      Model->ImportedDynamicFunctions[Name.str()];
+      DynamicFunctions.insert(model::DynamicFunction(Name.str()));
     } else {
       // TODO: create dynamic global variable
     }
@@ -757,12 +811,11 @@ void ELFImporter::parseDynamicSymbol(llvm::object::Elf_Sym_Impl<T> &Symbol,
     if (IsCode) {
       Address = relocate(fromPC(Symbol.st_value));
       // TODO: record model::Function::IsDynamic = true
-      auto It = Model->Functions.find(Address);
-      if (It == Model->Functions.end()) {
-        model::Function &Function = Model->Functions[Address];
-        Function.Type = model::FunctionType::Invalid;
-        Function.OriginalName = Name;
-      }
+      // Functions already there, or inserted before, take precedence
+      model::Function Function(Address);
+      Function.Type = model::FunctionType::Invalid;
+      Function.OriginalName = Name;
+      Functions.insert(Function);
     } else {
       Address = relocate(fromGeneric(Symbol.st_value));
       // TODO: create field in segment struct
@@ -1100,7 +1153,18 @@ void ELFImporter::registerRelocations(Elf_Rel_Array<T, HasAddend> Relocations,
   if (Dynsym.isAvailable())
     Symbols = Dynsym.extractAs<Elf_Sym>();
 
+  // Base-relative relocations are the vast majority: append them and sort
+  // them once at the end
+  using RelocationsInserter = SortedVector<model::Relocation>::BatchInserter;
+  std::optional<RelocationsInserter> BaseRelative;
+  if (LowestSegment != nullptr) {
+    auto &SegmentRelocations = LowestSegment->Relocations;
+    SegmentRelocations.reserve(SegmentRelocations.size() + Relocations.size());
+    BaseRelative.emplace(SegmentRelocations.batch_insert());
+  }
+
   for (Elf_Rel Relocation : Relocations) {
+    ++ParsedRelocations;
     auto Type = static_cast<unsigned char>(Relocation.getType(false));
     uint64_t Addend = RelocationHelper<T, HasAddend>::getAddend(Relocation);
     MetaAddress Address = relocate(fromGeneric(Relocation.r_offset));
@@ -1115,6 +1179,7 @@ void ELFImporter::registerRelocations(Elf_Rel_Array<T, HasAddend> Relocations,
                   "Invalid symbol index "
                     << SymbolIndex << ". "
                     << "Symbol count: " << Symbols.size());
+        continue;
       }
       const Elf_Sym &Symbol = Symbols[SymbolIndex];
       auto MaybeName = Symbol.getName(Dynstr.extractString());
@@ -1162,9 +1227,9 @@ void ELFImporter::registerRelocations(Elf_Rel_Array<T, HasAddend> Relocations,
       }
     } else {
       // Base-relative relocation
-      if (LowestSegment != nullptr) {
+      if (BaseRelative.has_value()) {
         NewRelocation.verify(true);
-        LowestSegment->Relocations.insert(NewRelocation);
+        BaseRelative->insert(NewRelocation);
       } else {
         revng_log(Log,
                   "Found a base-relative relocation, but no segment is "
@@ -295,6 +295,8 @@ void MachOImporter::parseMachOSegment(ArrayRef<uint8_t> RawDataRef,
   Segment.IsWriteable = SegmentCommand.initprot & VM_PROT_WRITE;
   Segment.IsExecutable = SegmentCommand.initprot & VM_PROT_EXECUTE;
 
+  hashContent(Segment, TheBinary.getData());
+
   Segment.verify(true);
 
   Model->Segments.insert(std::move(Segment));
@@ -90,6 +90,7 @@ Error PECOFFImporter::import() {
     Segment.IsWriteable = CoffRef->Characteristics & COFF::IMAGE_SCN_MEM_WRITE;
     Segment.IsExecutable = CoffRef->Characteristics
                            & COFF::IMAGE_SCN_MEM_EXECUTE;
+    hashContent(Segment, TheBinary.getData());
     Segment.verify(true);
     Model->Segments.insert(std::move(Segment));
   }
@@ -5,6 +5,7 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <atomic>
 #include <csignal>
 #include <optional>
 
@@ -17,6 +18,7 @@
 #include "llvm/DebugInfo/DWARF/DWARFDie.h"
 #include "llvm/DebugInfo/DWARF/DWARFFormValue.h"
 #include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/raw_os_ostream.h"
 #include "llvm/Support/raw_ostream.h"
@@ -27,13 +29,22 @@
 #include "revng/Model/QualifiedType.h"
 #include "revng/Model/Type.h"
 #include "revng/Support/Assert.h"
+#include "revng/Support/CommandLine.h"
 #include "revng/Support/Debug.h"
+#include "revng/Support/TaskScheduler.h"
 
 using namespace llvm;
 using namespace llvm::dwarf;
 
 static Logger<> DILogger("dwarf-importer");
 
+static cl::opt<unsigned> Jobs("dwarf-import-jobs",
+                              cl::init(0),
+                              cl::desc("number of tasks parsing the compile "
+                                       "units of the debug info, 0 means one "
+                                       "per thread of revng"),
+                              cl::cat(MainCategory));
+
 template<typename M>
 class ScopedSetElement {
 private:
@@ -1083,11 +1094,71 @@ inline void detectAliases(const llvm::object::ObjectFile &ELF,
   }
 }
 
+/// \brief Parse the DIEs of all the compile units of \p DICtx in parallel
+///
+/// The conversion to the model is sequential, since DIEs can refer to DIEs of
+/// other compile units, but parsing the DIEs of each compile unit is
+/// independent and it's the bulk of the time spent in large debug info.
+static void parseCompileUnits(DWARFContext &DICtx) {
+  std::vector<DWARFUnit *> Units;
+  for (const auto &CU : DICtx.compile_units()) {
+    // Abbreviations are lazily parsed into a data structure shared by all the
+    // compile units, resolve them here once and for all
+    CU->getAbbreviations();
+    Units.push_back(CU.get());
+  }
+
+  std::vector<std::string> Errors(Units.size());
+  std::atomic<size_t> Next = 0;
+  auto Worker = [&]() {
+    for (size_t I = Next++; I < Units.size(); I = Next++)
+      if (Error E = Units[I]->tryExtractDIEsIfNeeded(false))
+        Errors[I] = toString(std::move(E));
+  };
+
+  unsigned Threads = Jobs;
+  if (Threads == 0)
+    Threads = TaskScheduler::get().getThreadsCount();
+  Threads = std::min<size_t>(Threads, Units.size());
+  if (Threads <= 1) {
+    Worker();
+  } else {
+    TaskGroup Group;
+    for (unsigned I = 0; I < Threads; ++I)
+      Group.spawn(Worker);
+    Group.wait();
+  }
+
+  for (const std::string &Message : Errors)
+    if (not Message.empty())
+      revng_log(DILogger, "Cannot parse compile unit: " << Message);
+}
+
+std::unique_ptr<DWARFContext>
+DwarfImporter::parse(const llvm::object::Binary &TheBinary) {
+  auto *ELF = dyn_cast<object::ObjectFile>(&TheBinary);
+  if (ELF == nullptr)
+    return nullptr;
+
+  std::unique_ptr<DWARFContext> Result = DWARFContext::create(*ELF);
+  parseCompileUnits(*Result);
+  return Result;
+}
+
 void DwarfImporter::import(const llvm::object::Binary &TheBinary,
                            StringRef FileName) {
+  std::unique_ptr<DWARFContext> Parsed = parse(TheBinary);
+  import(TheBinary, FileName, Parsed.get());
+}
+
+void DwarfImporter::import(const llvm::object::Binary &TheBinary,
+                           StringRef FileName,
+                           DWARFContext *Parsed) {
   using namespace llvm::object;
 
   if (auto *ELF = dyn_cast<ObjectFile>(&TheBinary)) {
+    revng_assert(Parsed != nullptr);
+
     // Check if we already loaded the alt debug info file
     size_t AltIndex = -1;
     StringRef AltDebugLinkFileName = getAltDebugLinkFileName(ELF);
@@ -1099,9 +1170,8 @@ void DwarfImporter::import(const llvm::object::Binary &TheBinary,
         AltIndex = It - Begin;
     }
 
-    auto TheDWARFContext = DWARFContext::create(*ELF);
     DwarfToModelConverter Converter(*this,
-                                    *TheDWARFContext,
+                                    *Parsed,
                                     LoadedFiles.size(),
                                     AltIndex);
     Converter.run();
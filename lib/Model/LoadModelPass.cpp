@@ -36,12 +36,30 @@ bool hasModel(const llvm::Module &M) {
   return NamedMD and NamedMD->getNumOperands();
 }
 
+std::optional<std::string> getModelSidecar(const llvm::Module &M) {
+  NamedMDNode *NamedMD = M.getNamedMetadata(ModelSidecarMetadataName);
+  if (NamedMD == nullptr or NamedMD->getNumOperands() == 0)
+    return std::nullopt;
+
+  auto *Tuple = cast<MDTuple>(NamedMD->getOperand(0));
+  revng_check(Tuple->getNumOperands());
+  return cast<MDString>(Tuple->getOperand(0).get())->getString().str();
+}
+
 TupleTree<model::Binary> loadModel(const llvm::Module &M) {
   revng_check(hasModel(M));
 
   NamedMDNode *NamedMD = M.getNamedMetadata(ModelMetadataName);
   auto *Tuple = cast<MDTuple>(NamedMD->getOperand(0));
-  revng_check(Tuple->getNumOperands());
+
+  // An empty tuple means that the model lives in the sidecar file
+  if (Tuple->getNumOperands() == 0) {
+    auto Path = getModelSidecar(M);
+    revng_check(Path, "The model is neither in the module nor in a sidecar");
+    auto MaybeBinary = TupleTree<model::Binary>::fromFile(*Path);
+    revng_check(MaybeBinary, ("Cannot load the model from " + *Path).c_str());
+    return std::move(*MaybeBinary);
+  }
 
   Metadata *MD = Tuple->getOperand(0).get();
   StringRef YAMLString = cast<MDString>(MD)->getString();
@@ -50,16 +50,6 @@ static RegisterModelPass ToCABI("convert-all-raw-functions-to-cabi",
 
 static Logger Log("convert-function-types");
 
-template<DerivesFrom<model::Type> DerivedType>
-static std::vector<DerivedType *>
-chooseTypes(SortedVector<UpcastablePointer<model::Type>> &Types) {
-  std::vector<DerivedType *> Result;
-  for (model::UpcastableType &Type : Types)
-    if (auto *Upscaled = llvm::dyn_cast<DerivedType>(Type.get()))
-      Result.emplace_back(Upscaled);
-  return Result;
-}
-
 void model::convertAllFunctionsToRaw(TupleTree<model::Binary> &Model) {
   if (!Model.verify() || !Model->verify()) {
     revng_log(Log,
@@ -68,11 +58,8 @@ void model::convertAllFunctionsToRaw(TupleTree<model::Binary> &Model) {
     return;
   }
 
-  auto ToConvert = chooseTypes<model::CABIFunctionType>(Model->Types);
-  for (model::CABIFunctionType *Old : ToConvert) {
-    auto New = abi::FunctionType::convertToRaw(*Old, Model);
-    revng_assert(New.isValid());
-  }
+  size_t Converted = abi::FunctionType::convertAllToRaw(Model);
+  revng_log(Log, "Converted " << Converted << " prototypes");
 
   if (!Model.verify() || !Model->verify())
     revng_log(Log,
@@ -89,10 +76,8 @@ void model::convertAllFunctionsToCABI(TupleTree<model::Binary> &Model,
     return;
   }
 
-  auto ToConvert = chooseTypes<model::RawFunctionType>(Model->Types);
-  for (model::RawFunctionType *Old : ToConvert)
-    if (auto New = abi::FunctionType::tryConvertToCABI(*Old, Model, ABI))
-      revng_assert(New->isValid());
+  size_t Converted = abi::FunctionType::convertAllToCABI(Model, ABI);
+  revng_log(Log, "Converted " << Converted << " prototypes");
 
   if (!Model.verify() || !Model->verify())
     revng_log(Log,
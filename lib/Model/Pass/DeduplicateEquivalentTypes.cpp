@@ -5,14 +5,15 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
-#include "llvm/ADT/DepthFirstIterator.h"
+#include <numeric>
+
 #include "llvm/ADT/EquivalenceClasses.h"
-#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/MapVector.h"
 
-#include "revng/ADT/GenericGraph.h"
 #include "revng/ADT/STLExtras.h"
 #include "revng/Model/Pass/DeduplicateEquivalentTypes.h"
 #include "revng/Model/Pass/RegisterModelPass.h"
+#include "revng/Model/TypeReferenceGraph.h"
 #include "revng/Support/Debug.h"
 
 using namespace llvm;
@@ -40,24 +41,48 @@ compareAll(SmallVector<model::Type *> &ToTest,
   }
 }
 
+/// \brief Computes the classes of strongly equivalent types of a model
+///
+/// Two types are strongly equivalent if they are locally identical and the
+/// types they refer to are, in turn, strongly equivalent. We compute the
+/// coarsest partition of the type graph satisfying this property through
+/// partition refinement:
+///
+/// 1. types are initially partitioned by name, kind and local equivalence,
+///    comparing only the types with the same local hash;
+/// 2. each block is split according to the blocks of the successors of its
+///    members, until no block can be split anymore.
+///
+/// When splitting a block, its largest part retains the original block, while
+/// only the predecessors of the types that moved out need to be reconsidered.
+/// Since a type that changes block ends up in a block at most half as large
+/// as the previous one, this happens at most a logarithmic number of times per
+/// type, which makes the refinement O(n log n) in the size of the type graph.
 class TypeSystemDeduplicator {
 private:
-  struct TypeNode {
-    model::Type *T;
-  };
-  using Node = ForwardNode<TypeNode>;
-  using Graph = GenericGraph<Node>;
+  using BlockID = uint32_t;
 
 private:
+  /// All the types in the model, the position identifies the type
   std::vector<model::Type *> Types;
+
+  /// Types referenced by each type (including through pointers), in order,
+  /// with the same numbering of Types
+  model::TypeReferenceGraph Graph;
+
+  /// The block to which each type currently belongs
+  std::vector<BlockID> Block;
+
+  /// The types in each block
+  std::vector<std::vector<uint32_t>> Members;
+
+  std::vector<BlockID> Worklist;
+  std::vector<bool> InWorklist;
+
   EquivalenceClasses<model::Type *> StrongEquivalence;
-  EquivalenceClasses<model::Type *> WeakEquivalence;
-  Graph TypeGraph;
-  std::map<const model::Type *, Node *> TypeToNode;
-  std::vector<model::Type *> VisitOrder;
 
 private:
-  TypeSystemDeduplicator(TupleTree<model::Binary> &Model) {
+  TypeSystemDeduplicator(TupleTree<model::Binary> &Model) : Graph(*Model) {
     for (auto &T : Model->Types)
       Types.push_back(&*T);
   }
@@ -66,269 +91,233 @@ public:
   static EquivalenceClasses<model::Type *>
   run(TupleTree<model::Binary> &Model) {
     TypeSystemDeduplicator Helper(Model);
-    Helper.computeWeakEquivalenceClasses();
-    Helper.createTypeGraph();
-    Helper.computeVisitOrder();
+    revng_assert(Helper.Graph.dangling().empty());
+    Helper.computeInitialPartition();
+    Helper.refinePartition();
     Helper.computeStrongEquivalenceClasses();
     return std::move(Helper.StrongEquivalence);
   }
 
 private:
-  void computeWeakEquivalenceClasses() {
-    revng_log(Log, "Computing weak equivalence classes");
+  /// Partition types by name, kind and local equivalence
+  ///
+  /// Named types in the same block are weakly equivalent. Unnamed types are
+  /// never deduplicated on their own, but we still need to know which ones are
+  /// locally equivalent, since named types referring to them might be.
+  void computeInitialPartition() {
+    revng_log(Log, "Computing the initial partition");
     LoggerIndent Indent(Log);
 
-    auto ComputeKey = [](model::Type *T) {
-      return std::pair{ T->OriginalName, T->Kind };
+    auto ComputeKey = [this](uint32_t Index) {
+      const model::Type *T = Types[Index];
+      return std::tuple{ StringRef(T->OriginalName),
+                         T->Kind,
+                         Graph.successors(Index).size() };
     };
 
-    // Sort types by the key (the name)
-    llvm::sort(Types, [&ComputeKey](model::Type *Left, model::Type *Right) {
+    // Sort types by the key (the name first)
+    std::vector<uint32_t> Sorted(Types.size());
+    std::iota(Sorted.begin(), Sorted.end(), 0);
+    llvm::sort(Sorted, [&ComputeKey](uint32_t Left, uint32_t Right) {
       return ComputeKey(Left) < ComputeKey(Right);
     });
 
-    auto GroupStart = Types.begin();
-    auto End = Types.end();
+    Block.resize(Types.size());
+    BlockID NextBlock = 0;
+    auto GroupStart = Sorted.begin();
+    auto End = Sorted.end();
     while (GroupStart != End) {
-      // Find group end and collect types
+      // Find group end and collect types, each in its own block for now
       auto GroupKey = ComputeKey(*GroupStart);
-      std::string GroupName = (TypeKind::getName(GroupKey.second) + " "
-                               + GroupKey.first)
+      std::string GroupName = (TypeKind::getName(std::get<1>(GroupKey)) + " "
+                               + std::get<0>(GroupKey))
                                 .str();
       revng_log(Log, "Considering \"" << GroupName << "\"");
       LoggerIndent Indent2(Log);
 
+      // Locally equivalent types have the same local hash: bucket them by it,
+      // so that only types in the same bucket need to be compared. This
+      // matters for unnamed types, which tend to end up all in a huge group.
       auto GroupEnd = GroupStart;
-      SmallVector<model::Type *> ToTest;
+      MapVector<size_t, SmallVector<model::Type *>> Buckets;
       do {
-        ToTest.push_back(*GroupEnd);
+        Block[*GroupEnd] = NextBlock++;
+        model::Type *T = Types[*GroupEnd];
+        Buckets[T->localHash()].push_back(T);
         ++GroupEnd;
       } while (GroupEnd != End and ComputeKey(*GroupEnd) == GroupKey);
 
-      if (not GroupKey.first.empty()) {
-
-        auto Compare = [this](model::Type *Left, model::Type *Right) -> bool {
-          revng_assert(Left != Right
-                       and not WeakEquivalence.isEquivalent(Left, Right));
-          if (Left->localCompare(*Right)) {
+      bool IsNamed = not std::get<0>(GroupKey).empty();
+      auto Compare = [this, IsNamed](model::Type *Left, model::Type *Right) {
+        revng_assert(Left != Right);
+        if (Left->localCompare(*Right)) {
+          if (IsNamed)
             revng_log(Log,
                       Left->ID << " and " << Right->ID
                                << " are weakly equivalent");
 
-            // Record as weakly equivalent
-            WeakEquivalence.unionSets(Left, Right);
-
-            return true;
-          } else {
-            // This is kind of unusual
-            if (Log.isEnabled()) {
-              Log << "The following types have same kind and name but are "
-                     "locally different.";
-              model::Type *M = Left;
-              upcast(M, [](auto &U) { serialize(Log, U); });
-              upcast(Right, [](auto &U) { serialize(Log, U); });
-              Log << DoLog;
-            }
-
-            return false;
+          // Move Right in the block of Left
+          Block[indexOf(Right)] = Block[indexOf(Left)];
+
+          return true;
+        } else {
+          // This is kind of unusual
+          if (IsNamed and Log.isEnabled()) {
+            Log << "The following types have same kind and name but are "
+                   "locally different.";
+            model::Type *M = Left;
+            upcast(M, [](auto &U) { serialize(Log, U); });
+            upcast(Right, [](auto &U) { serialize(Log, U); });
+            Log << DoLog;
           }
-        };
 
-        compareAll(ToTest, Compare);
+          return false;
+        }
+      };
 
-        revng_log(Log,
-                  GroupName << " has " << ToTest.size()
-                            << " non-weakly equivalent types");
+      size_t Remaining = 0;
+      for (auto &[Hash, ToTest] : Buckets) {
+        compareAll(ToTest, Compare);
+        Remaining += ToTest.size();
       }
 
+      revng_log(Log,
+                GroupName << " has " << Remaining
+                          << " non-weakly equivalent types");
+
       GroupStart = GroupEnd;
     }
-  }
-
-  /// Create a graph of the non-local parts (including pointers)
-  void createTypeGraph() {
-    revng_log(Log, "Building the type graph");
 
-    // Create nodes
-    for (model::Type *T : Types)
-      TypeToNode[T] = TypeGraph.addNode(TypeNode{ T });
-
-    // Create edges
-    for (const model::Type *T : Types)
-      for (const model::QualifiedType &QT : T->edges())
-        addEdge(T, QT);
+    Members.resize(NextBlock);
+    for (uint32_t Index = 0; Index < Types.size(); ++Index)
+      Members[Block[Index]].push_back(Index);
   }
 
-  /// Compute a visit order: post order in the leaders of WeakEquivalence
-  void computeVisitOrder() {
-    revng_log(Log, "Computing visit order");
+  /// Split blocks until all the members of each block have successors in the
+  /// same blocks
+  void refinePartition() {
+    revng_log(Log, "Refining the partition");
 
-    Node *Entry = TypeGraph.addNode(TypeNode{ nullptr });
-    for (Node *N : TypeGraph.nodes())
-      Entry->addSuccessor(N);
+    InWorklist.assign(Members.size(), false);
+    for (BlockID ID = 0; ID < Members.size(); ++ID)
+      if (Members[ID].size() > 1)
+        enqueue(ID);
 
-    std::set<model::Type *> Inserted;
-    for (Node *N : post_order(Entry)) {
+    unsigned Splits = 0;
+    while (not Worklist.empty()) {
+      BlockID ID = Worklist.back();
+      Worklist.pop_back();
+      InWorklist[ID] = false;
 
-      auto LeaderIt = WeakEquivalence.findLeader(N->T);
-      if (LeaderIt != WeakEquivalence.member_end()
-          and Inserted.count(*LeaderIt) == 0) {
-        VisitOrder.push_back(*LeaderIt);
-        Inserted.insert(*LeaderIt);
-      }
+      if (split(ID))
+        ++Splits;
     }
 
-    TypeGraph.removeNode(Entry);
+    revng_log(Log, Splits << " blocks have been split");
   }
 
   void computeStrongEquivalenceClasses() {
     revng_log(Log, "Computing strong equivalence classes");
     LoggerIndent Indent(Log);
 
-    for (model::Type *Leader : VisitOrder) {
-      revng_log(Log, "Considering " << Leader->OriginalName);
-      LoggerIndent Indent2(Log);
-
-      revng_assert(not Leader->OriginalName.empty());
-      auto LeaderIt = WeakEquivalence.findValue(Leader);
-      revng_assert(LeaderIt->isLeader());
-
-      SmallVector<model::Type *> ToTest;
-      std::copy(WeakEquivalence.member_begin(LeaderIt),
-                WeakEquivalence.member_end(),
-                std::back_inserter(ToTest));
-
-      auto Compare = [this](model::Type *Left, model::Type *Right) {
-        if (Left == Right or StrongEquivalence.isEquivalent(Left, Right))
-          return true;
-
-        revng_log(Log, "Comparing " << Left->ID << " and " << Right->ID);
-        LoggerIndent Indent(Log);
-
-        bool Result = deepCompare(Left, Right);
+    for (const std::vector<uint32_t> &Nodes : Members) {
+      // Unnamed types are not deduplicated
+      if (Nodes.size() < 2 or Types[Nodes[0]]->OriginalName.empty())
+        continue;
 
-        revng_log(Log, "Comparison result: " << (Result ? "true" : "false"));
-
-        return Result;
-      };
-
-      compareAll(ToTest, Compare);
+      model::Type *Leader = Types[Nodes[0]];
+      revng_log(Log,
+                Nodes.size() << " types are strongly equivalent to "
+                             << Leader->ID);
+      for (uint32_t Index : Nodes)
+        StrongEquivalence.unionSets(Leader, Types[Index]);
     }
   }
 
 private:
-  void addEdge(const model::Type *T, const model::QualifiedType &QT) {
-    auto *DependantType = QT.UnqualifiedType.get();
-    TypeToNode.at(T)->addSuccessor(TypeToNode.at(DependantType));
-  }
+  uint32_t indexOf(const model::Type *T) const { return Graph.id(T); }
 
-  bool deepCompare(model::Type *LeftType, model::Type *RightType) {
-    Node *Left = TypeToNode.at(LeftType);
-    Node *Right = TypeToNode.at(RightType);
+  void enqueue(BlockID ID) {
+    if (InWorklist[ID])
+      return;
+    InWorklist[ID] = true;
+    Worklist.push_back(ID);
+  }
 
-    // Create a bidirectional map associating left and right nodes
-    std::map<Node *, Node *> LeftToRight;
-    std::map<Node *, Node *> RightToLeft;
+  /// Split the block \p ID by the blocks of the successors of its members
+  ///
+  /// \return true if the block has been split
+  bool split(BlockID ID) {
+    if (Members[ID].size() < 2)
+      return false;
 
-    // Initialize the map with the two considered nodes
-    LeftToRight[Left] = Right;
-    RightToLeft[Right] = Left;
+    // Compare types by the blocks of their successors
+    auto LessBlock = [this](uint32_t Left, uint32_t Right) {
+      return Block[Left] < Block[Right];
+    };
+    auto SameBlock = [this](uint32_t Left, uint32_t Right) {
+      return Block[Left] == Block[Right];
+    };
+    auto Less = [this, &LessBlock](uint32_t Left, uint32_t Right) {
+      ArrayRef<uint32_t> L = Graph.successors(Left);
+      ArrayRef<uint32_t> R = Graph.successors(Right);
+      return std::lexicographical_compare(L.begin(),
+                                          L.end(),
+                                          R.begin(),
+                                          R.end(),
+                                          LessBlock);
+    };
+    auto Equal = [this, &SameBlock](uint32_t Left, uint32_t Right) {
+      ArrayRef<uint32_t> L = Graph.successors(Left);
+      ArrayRef<uint32_t> R = Graph.successors(Right);
+      return std::equal(L.begin(), L.end(), R.begin(), R.end(), SameBlock);
+    };
 
-    // Perform a depth-first visit from here.
-    // Note: we will stop the visit on successors that are already known to be
-    // strongly equivalent.
-    df_iterator_default_set<Node *> Visited;
+    std::vector<uint32_t> Nodes = std::move(Members[ID]);
+    llvm::sort(Nodes, Less);
 
-    for (Node *LeftNode : depth_first_ext(Left, Visited)) {
-      revng_log(Log, "Visiting " << LeftNode->T->ID);
-      LoggerIndent Indent2(Log);
+    // Collect the parts: [Parts[I], Parts[I + 1])
+    SmallVector<size_t, 4> Parts = { 0 };
+    for (size_t I = 1; I < Nodes.size(); ++I)
+      if (not Equal(Nodes[I - 1], Nodes[I]))
+        Parts.push_back(I);
+    Parts.push_back(Nodes.size());
 
-      auto RightIt = LeftToRight.find(LeftNode);
-      if (RightIt == LeftToRight.end()) {
-        revng_log(Log, "Mismatch");
-        return false;
-      }
-      Node *RightNode = RightIt->second;
-
-      // Zip out edges of the node pair: consider the destinations.
-      for (auto [LeftSuccessor, RightSuccessor] :
-           zip(LeftNode->successors(), RightNode->successors())) {
-        revng_log(Log, "Visiting successor " << LeftSuccessor->T->ID);
-        if (not compareSuccessor(LeftToRight,
-                                 RightToLeft,
-                                 Visited,
-                                 LeftSuccessor,
-                                 RightSuccessor))
-          return false;
-      }
+    if (Parts.size() == 2) {
+      Members[ID] = std::move(Nodes);
+      return false;
     }
 
-    // All those in the map are strongly equivalent
-    for (auto [LeftNode, RightMode] : LeftToRight)
-      StrongEquivalence.unionSets(Left->T, Right->T);
-
-    return true;
-  }
-
-  /// Support function for deepCompare
-  bool compareSuccessor(std::map<Node *, Node *> &LeftToRight,
-                        std::map<Node *, Node *> &RightToLeft,
-                        df_iterator_default_set<Node *> &Visited,
-                        Node *Left,
-                        Node *Right) {
-    // If any of them is in the associating map, the other needs to match.
-    // If it doesn't, the two nodes are not equivalent.
-    auto LeftToRightIt = LeftToRight.find(Left);
-    if (LeftToRightIt != LeftToRight.end()) {
-      if (LeftToRightIt->second != Right) {
-        revng_log(Log,
-                  "We were expecting " << LeftToRightIt->second->T->ID
-                                       << " but we got " << Right->T->ID);
-        return false;
-      } else {
-        revng_assert(RightToLeft.at(Right) == Left);
-        return true;
+    // The largest part retains the block
+    size_t Largest = 0;
+    for (size_t I = 1; I + 1 < Parts.size(); ++I)
+      if (Parts[I + 1] - Parts[I] > Parts[Largest + 1] - Parts[Largest])
+        Largest = I;
+
+    std::vector<uint32_t> Moved;
+    for (size_t I = 0; I + 1 < Parts.size(); ++I) {
+      auto Begin = Nodes.begin() + Parts[I];
+      auto End = Nodes.begin() + Parts[I + 1];
+      if (I == Largest) {
+        Members[ID].assign(Begin, End);
+        continue;
       }
-    }
 
-    auto RightToLeftIt = RightToLeft.find(Right);
-    if (RightToLeftIt != RightToLeft.end()) {
-      if (RightToLeftIt->second != Left) {
-        revng_log(Log,
-                  "We were expecting " << RightToLeftIt->second->T->ID
-                                       << " but we got " << Left->T->ID);
-        return false;
-      } else {
-        revng_assert(LeftToRight.at(Left) == Right);
-        return true;
+      BlockID NewID = Members.size();
+      Members.emplace_back(Begin, End);
+      InWorklist.push_back(false);
+      for (uint32_t Index : make_range(Begin, End)) {
+        Block[Index] = NewID;
+        Moved.push_back(Index);
       }
     }
 
-    // Record the match before actually verifying it. In any case,
-    // even if we fail we'll discard this.
-    LeftToRight[Left] = Right;
-    RightToLeft[Right] = Left;
-
-    // Verify the match
-    if (Right->T == Left->T
-        or StrongEquivalence.isEquivalent(Right->T, Left->T)) {
-      // Strong equivalence, no need to visit me
-      Visited.insert(Left);
-      return true;
-    } else if (WeakEquivalence.isEquivalent(Right->T, Left->T)
-               or (Left->T->OriginalName.empty()
-                   and Right->T->OriginalName.empty()
-                   and Left->T->localCompare(*Right->T))) {
-      // Weak equivalence
-      return true;
-    } else {
-      // Otherwise, the nodes are not equivalent
-      revng_assert(not Left->T->localCompare(*Right->T));
-      revng_log(Log,
-                Left->T->ID << " and " << Right->T->ID
-                            << " are locally different");
-      return false;
-    }
+    // The signature of the predecessors of the moved types has changed
+    for (uint32_t Index : Moved)
+      for (uint32_t Predecessor : Graph.predecessors(Index))
+        enqueue(Block[Predecessor]);
+
+    return true;
   }
 };
 
@@ -5,11 +5,11 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
-#include "llvm/ADT/DepthFirstIterator.h"
+#include "llvm/ADT/BitVector.h"
 
-#include "revng/ADT/GenericGraph.h"
 #include "revng/Model/Pass/PurgeUnnamedAndUnreachableTypes.h"
 #include "revng/Model/Pass/RegisterModelPass.h"
+#include "revng/Model/TypeReferenceGraph.h"
 
 using namespace llvm;
 
@@ -19,83 +19,24 @@ static RegisterModelPass R("purge-unnamed-and-unreachable-types",
                            "system itself",
                            model::purgeUnnamedAndUnreachableTypes);
 
-template<typename V, typename T, size_t... Indices>
-static void
-visitTuple(V &&Visitor, T &Tuple, const std::index_sequence<Indices...> &) {
-  (Visitor(get<Indices>(Tuple)), ...);
-}
-
-template<typename V, IsTupleLike T>
-static void visitTuple(V &&Visitor, T &Tuple) {
-  visitTuple(std::forward<V>(Visitor),
-             Tuple,
-             std::make_index_sequence<std::tuple_size_v<T>>{});
-}
-
-template<typename V, IsTupleLike T, typename E>
-static auto visitTupleExcept(V &&Visitor, T &Tuple, E *Exclude) {
-  auto WrappedVisitor = [&Visitor, Exclude](auto &Field) {
-    if constexpr (std::is_same_v<std::decay_t<decltype(Field)>, E>) {
-      // Make sure we don't visit the type system
-      if (&Field != Exclude) {
-        return Visitor(Field);
-      }
-    } else {
-      return Visitor(Field);
-    }
-  };
-  return visitTuple(WrappedVisitor, Tuple);
-}
-
 void model::purgeUnnamedAndUnreachableTypes(TupleTree<model::Binary> &Model) {
-  struct NodeData {
-    model::Type *T;
-  };
-  using Node = ForwardNode<NodeData>;
-  using Graph = GenericGraph<Node>;
-
-  Graph TypeGraph;
-  std::map<const model::Type *, Node *> TypeToNode;
-
-  llvm::SmallPtrSet<Type *, 16> ToKeep;
-
-  // Create nodes
-  for (UpcastablePointer<model::Type> &T : Model->Types) {
-
+  using NodeID = TypeReferenceGraph::NodeID;
+  TypeReferenceGraph Graph(*Model);
+
+  // Keep named types and the types used outside of the type system
+  std::vector<NodeID> ToKeep(Graph.externallyReferenced().begin(),
+                             Graph.externallyReferenced().end());
+  for (NodeID Node = 0; Node < Graph.size(); ++Node) {
+    const model::Type *T = Graph.type(Node);
     if (not T->CustomName.empty() or not T->OriginalName.empty())
-      ToKeep.insert(T.get());
-
-    TypeToNode[T.get()] = TypeGraph.addNode(NodeData{ T.get() });
+      ToKeep.push_back(Node);
   }
 
-  // Create type system edges
-  for (UpcastablePointer<model::Type> &T : Model->Types) {
-    for (const model::QualifiedType &QT : T->edges()) {
-      auto *DependantType = QT.UnqualifiedType.get();
-      TypeToNode.at(T.get())->addSuccessor(TypeToNode.at(DependantType));
-    }
-  }
-
-  // Record references to types *outside* of Model->Types
-  auto VisitBinary = [&](auto &Field) {
-    auto Visitor = [&](auto &Element) {
-      using type = std::decay_t<decltype(Element)>;
-      if constexpr (std::is_same_v<type, TypePath>)
-        if (Element.isValid())
-          ToKeep.insert(Element.get());
-    };
-    visitTupleTree(Field, Visitor, [](auto) {});
-  };
-  visitTupleExcept(VisitBinary, *Model, &Model->Types);
-
   // Visit all the nodes reachable from ToKeep
-  df_iterator_default_set<Node *> Visited;
-  for (Type *T : ToKeep)
-    for (Node *N : depth_first_ext(TypeToNode.at(T), Visited))
-      ;
+  llvm::BitVector Reachable = Graph.reachableFrom(ToKeep);
 
   // Purge the non-visited
   llvm::erase_if(Model->Types, [&](UpcastablePointer<model::Type> &P) {
-    return not Visited.contains(TypeToNode.at(P.get()));
+    return not Reachable.test(Graph.id(P.get()));
   });
 }
@@ -10,6 +10,7 @@
 
 #include "revng/Model/Pass/RegisterModelPass.h"
 #include "revng/Model/Pass/Verify.h"
+#include "revng/TupleTree/TupleTreeDiff.h"
 
 using namespace llvm;
 using namespace model;
@@ -19,6 +20,52 @@ static RegisterModelPass R("verify",
                            "model",
                            model::verify);
 
+/// Innermost IncrementalVerificationScope of this thread
+static thread_local model::IncrementalVerificationScope *CurrentScope = nullptr;
+
+model::IncrementalVerificationScope::IncrementalVerificationScope() :
+  Previous(CurrentScope) {
+  CurrentScope = this;
+}
+
+model::IncrementalVerificationScope::~IncrementalVerificationScope() {
+  revng_assert(CurrentScope == this);
+  CurrentScope = Previous;
+}
+
+model::IncrementalVerifier *model::IncrementalVerificationScope::current() {
+  return CurrentScope != nullptr ? &CurrentScope->Verifier : nullptr;
+}
+
 void model::verify(TupleTree<model::Binary> &Model) {
-  Model->verify(true);
+  // This pass is usually run after each of the other passes of a sequence:
+  // only verify what they changed
+  if (IncrementalVerifier *Verifier = IncrementalVerificationScope::current())
+    Verifier->verify(Model, true);
+  else
+    Model->verify(true);
+}
+
+bool model::IncrementalVerifier::verify(TupleTree<model::Binary> &Model,
+                                        bool Assert) {
+  VerifyHelper VH(Assert);
+
+  if (not LastVerified.has_value()) {
+    if (not Model->verify(VH))
+      return false;
+
+    LastVerified = Model.clone();
+    return true;
+  }
+
+  auto Changes = diff(**LastVerified, *Model);
+  if (Changes.Changes.empty())
+    return true;
+
+  // In case of failure, keep diffing against the last model that verified
+  if (not Model->verifyChanges(Changes, VH))
+    return false;
+
+  Changes.applyIncrementally(*LastVerified);
+  return true;
 }
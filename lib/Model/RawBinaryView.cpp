@@ -0,0 +1,93 @@
+/// \file RawBinaryView.cpp
+/// \brief Implementation of the index of the segments of RawBinaryView
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <algorithm>
+#include <limits>
+
+#include "llvm/ADT/STLExtras.h"
+
+#include "revng/Model/RawBinaryView.h"
+
+void RawBinaryView::rebuildIndex() const {
+  const auto &Segments = Binary.Segments;
+  IndexedMutations = Segments.mutations();
+  LastHit.store(0, std::memory_order_relaxed);
+
+  Index.clear();
+  Index.reserve(Segments.size());
+  for (const model::Segment &Segment : Segments) {
+    uint64_t Start = Segment.StartAddress.address();
+
+    // Ends are only used to rule out segments, overestimating them is fine
+    auto End = OverflowSafeInt(Start) + Segment.VirtualSize;
+    Index.push_back({ Start,
+                      End ? *End : std::numeric_limits<uint64_t>::max(),
+                      &Segment,
+                      false });
+  }
+
+  llvm::stable_sort(Index, [](const IndexEntry &LHS, const IndexEntry &RHS) {
+    return LHS.Start < RHS.Start;
+  });
+
+  // At this point MaxEnd is the end of each segment: a segment overlaps one of
+  // the following ones if the next one starts before its end, and one of the
+  // previous ones if it starts before the highest end among them
+  uint64_t PreviousMaxEnd = 0;
+  for (size_t I = 0; I < Index.size(); ++I) {
+    IndexEntry &Entry = Index[I];
+    uint64_t End = Entry.MaxEnd;
+    if (I != 0 and Entry.Start < PreviousMaxEnd)
+      Entry.Overlaps = true;
+    if (I + 1 < Index.size() and Index[I + 1].Start < End)
+      Entry.Overlaps = true;
+
+    PreviousMaxEnd = std::max(PreviousMaxEnd, End);
+    Entry.MaxEnd = PreviousMaxEnd;
+  }
+}
+
+const model::Segment *RawBinaryView::lookupSegment(MetaAddress Address,
+                                                   uint64_t Size) const {
+  if (not Address.isValid())
+    return nullptr;
+
+  uint64_t Start = Address.address();
+  auto LastByte = OverflowSafeInt(Start) + (Size <= 1 ? 0 : Size - 1);
+  if (not LastByte)
+    return nullptr;
+
+  // Segments starting after Address cannot contain it
+  auto It = llvm::upper_bound(Index,
+                              Start,
+                              [](uint64_t Value, const IndexEntry &Entry) {
+                                return Value < Entry.Start;
+                              });
+
+  const IndexEntry *Match = nullptr;
+  for (size_t I = It - Index.begin(); I > 0; --I) {
+    const IndexEntry &Entry = Index[I - 1];
+
+    // None of the remaining segments reaches the last byte
+    if (Entry.MaxEnd <= *LastByte)
+      break;
+
+    if (Entry.Segment->contains(Address, Size)) {
+      // We have more than one match!
+      if (Match != nullptr)
+        return nullptr;
+
+      Match = &Entry;
+    }
+  }
+
+  if (Match == nullptr)
+    return nullptr;
+
+  LastHit.store(Match - Index.data(), std::memory_order_relaxed);
+  return Match->Segment;
+}
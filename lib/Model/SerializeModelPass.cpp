@@ -29,6 +29,9 @@ void writeModel(const model::Binary &Model, llvm::Module &M) {
   NamedMDNode *NamedMD = M.getNamedMetadata(ModelMetadataName);
   revng_check(not NamedMD, "The model has alread been serialized");
 
+  if (NamedMDNode *SidecarMD = M.getNamedMetadata(ModelSidecarMetadataName))
+    SidecarMD->eraseFromParent();
+
   std::string Buffer;
   {
     llvm::raw_string_ostream Stream(Buffer);
@@ -42,6 +45,35 @@ void writeModel(const model::Binary &Model, llvm::Module &M) {
   NamedMD->addOperand(Tuple);
 }
 
+llvm::Error writeModel(const model::Binary &Model,
+                       llvm::Module &M,
+                       llvm::StringRef SidecarPath) {
+  Model.verify(true);
+
+  revng_check(not M.getNamedMetadata(ModelMetadataName),
+              "The model has alread been serialized");
+
+  if (auto Error = serializeToFile(Model, SidecarPath))
+    return Error;
+
+  // Leave a placeholder in the module, the model lives in the sidecar file
+  setModelSidecar(M, SidecarPath);
+  LLVMContext &Context = M.getContext();
+  M.getOrInsertNamedMetadata(ModelMetadataName)
+    ->addOperand(MDTuple::get(Context, {}));
+  return llvm::Error::success();
+}
+
+void setModelSidecar(llvm::Module &M, llvm::StringRef Path) {
+  for (const char *Name : { ModelMetadataName, ModelSidecarMetadataName })
+    if (NamedMDNode *NamedMD = M.getNamedMetadata(Name))
+      NamedMD->eraseFromParent();
+
+  LLVMContext &Context = M.getContext();
+  auto Tuple = MDTuple::get(Context, { MDString::get(Context, Path) });
+  M.getOrInsertNamedMetadata(ModelSidecarMetadataName)->addOperand(Tuple);
+}
+
 bool SerializeModelWrapperPass::runOnModule(Module &M) {
   auto LoadPass = getAnalysisIfAvailable<LoadModelWrapperPass>();
   if (not LoadPass)
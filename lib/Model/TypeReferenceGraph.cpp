@@ -0,0 +1,112 @@
+/// \file TypeReferenceGraph.cpp
+/// \brief
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include "llvm/ADT/STLExtras.h"
+
+#include "revng/Model/TypeReferenceGraph.h"
+#include "revng/TupleTree/Visits.h"
+
+using namespace llvm;
+
+using NodeID = model::TypeReferenceGraph::NodeID;
+
+template<typename V, size_t... Indices>
+static void visitFieldsExceptTypes(V &&Visitor,
+                                   const model::Binary &Model,
+                                   const std::index_sequence<Indices...> &) {
+  auto WrappedVisitor = [&Visitor, &Model](const auto &Field) {
+    // Make sure we don't visit the type system
+    if (static_cast<const void *>(&Field) != &Model.Types)
+      Visitor(Field);
+  };
+  (WrappedVisitor(get<Indices>(Model)), ...);
+}
+
+static void sortAndUnique(std::vector<NodeID> &Nodes) {
+  llvm::sort(Nodes);
+  Nodes.erase(std::unique(Nodes.begin(), Nodes.end()), Nodes.end());
+}
+
+model::TypeReferenceGraph::TypeReferenceGraph(const model::Binary &Model) {
+  Types.reserve(Model.Types.size());
+  IDs.reserve(Model.Types.size());
+  for (const UpcastablePointer<model::Type> &T : Model.Types) {
+    IDs[T.get()] = Types.size();
+    Types.push_back(T.get());
+  }
+
+  // Type system edges
+  SuccessorsOffsets.reserve(size() + 1);
+  SuccessorsOffsets.push_back(0);
+  for (NodeID Node = 0; Node < size(); ++Node) {
+    for (const model::QualifiedType &QT : Types[Node]->edges()) {
+      if (auto Successor = lookup(QT.UnqualifiedType.get()))
+        Successors.push_back(*Successor);
+      else if (Dangling.empty() or Dangling.back() != Node)
+        Dangling.push_back(Node);
+    }
+    SuccessorsOffsets.push_back(Successors.size());
+  }
+
+  // Counting sort of the edges by destination
+  PredecessorsOffsets.assign(size() + 1, 0);
+  for (NodeID Successor : Successors)
+    ++PredecessorsOffsets[Successor + 1];
+
+  for (size_t I = 1; I < PredecessorsOffsets.size(); ++I)
+    PredecessorsOffsets[I] += PredecessorsOffsets[I - 1];
+
+  std::vector<uint32_t> Next(PredecessorsOffsets.begin(),
+                             PredecessorsOffsets.end() - 1);
+  Predecessors.resize(Successors.size());
+  for (NodeID Node = 0; Node < size(); ++Node)
+    for (NodeID Successor : successors(Node))
+      Predecessors[Next[Successor]++] = Node;
+
+  // Record references to types *outside* of Model.Types
+  auto VisitField = [this](const auto &Field) {
+    auto Visitor = [this](const auto &Element) {
+      using type = std::decay_t<decltype(Element)>;
+      if constexpr (std::is_same_v<type, TypePath>) {
+        if (Element.isValid())
+          if (auto Node = lookup(Element.get()))
+            ExternallyReferenced.push_back(*Node);
+      }
+    };
+    visitTupleTree(Field, Visitor, [](const auto &) {});
+  };
+  constexpr size_t FieldsCount = std::tuple_size_v<model::Binary>;
+  visitFieldsExceptTypes(VisitField,
+                         Model,
+                         std::make_index_sequence<FieldsCount>{});
+  sortAndUnique(ExternallyReferenced);
+}
+
+BitVector model::TypeReferenceGraph::visit(ArrayRef<NodeID> Roots,
+                                           bool Backward) const {
+  BitVector Visited(size());
+  std::vector<NodeID> Worklist;
+  for (NodeID Root : Roots) {
+    if (not Visited.test(Root)) {
+      Visited.set(Root);
+      Worklist.push_back(Root);
+    }
+  }
+
+  while (not Worklist.empty()) {
+    NodeID Node = Worklist.back();
+    Worklist.pop_back();
+    for (NodeID Next : Backward ? predecessors(Node) : successors(Node)) {
+      if (not Visited.test(Next)) {
+        Visited.set(Next);
+        Worklist.push_back(Next);
+      }
+    }
+  }
+
+  return Visited;
+}
@@ -0,0 +1,177 @@
+/// \file ArtifactCache.cpp
+/// \brief The artifact cache stores on disk the outputs of steps, indexed by a
+/// hash of their input.
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <sstream>
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SHA1.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "revng/Pipeline/ArtifactCache.h"
+#include "revng/Pipeline/Step.h"
+
+using namespace llvm;
+using namespace pipeline;
+
+namespace {
+
+/// A stream that, rather than writing anything, feeds a SHA1 hasher
+class HashingOStream : public raw_ostream {
+private:
+  SHA1 &Hasher;
+  uint64_t Position = 0;
+
+public:
+  explicit HashingOStream(SHA1 &Hasher) : Hasher(Hasher) {}
+  ~HashingOStream() override { flush(); }
+
+private:
+  void write_impl(const char *Ptr, size_t Size) override {
+    Hasher.update(StringRef(Ptr, Size));
+    Position += Size;
+  }
+
+  uint64_t current_pos() const override { return Position; }
+};
+
+} // namespace
+
+/// The content of the containers of an entry only depends on its key
+static void setContentIDs(StringRef Key, const ContainerSet &Output) {
+  for (const auto &Entry : Output.entriesWithoutLoading())
+    if (Entry.second != nullptr)
+      Entry.second->setContentID((Key + "/" + Entry.first()).str());
+}
+
+ArtifactCache::ArtifactCache(StringRef Directory) {
+  SmallString<128> Path(Directory);
+  sys::fs::make_absolute(Path);
+  this->Directory = Path.str().str();
+}
+
+Expected<std::string> ArtifactCache::computeKey(const Context &Ctx,
+                                                const Step &ToRun,
+                                                const ContainerSet &Input) {
+  SHA1 Hasher;
+  {
+    HashingOStream OS(Hasher);
+
+    // Pipes may produce different outputs in another build
+#ifdef BUILD_ID
+    OS << "build " << BUILD_ID << "\n";
+#endif
+    OS << "llvm " << LLVM_VERSION_STRING << "\n";
+
+    OS << "step " << ToRun.getName() << "\n";
+
+    for (const auto &Pipe : ToRun.pipes()) {
+      std::stringstream Description;
+      Pipe->dump(Description, 0);
+      OS << "pipe " << Description.str() << "\n";
+    }
+
+    // Iterate the containers in a stable order
+    std::vector<StringRef> Names;
+    for (const auto &Entry : Input)
+      Names.push_back(Entry.first());
+    llvm::sort(Names);
+
+    for (StringRef Name : Names) {
+      OS << "container " << Name << "\n";
+      if (not Input.contains(Name))
+        continue;
+
+      // Containers produced by a cached step, or cloned from one, are
+      // identified without serializing them
+      const ContainerBase &Container = Input.at(Name);
+      if (auto ID = Container.contentID()) {
+        OS << "id " << *ID << "\n";
+        continue;
+      }
+
+      if (auto Error = Container.serialize(OS); Error)
+        return std::move(Error);
+      OS << "\n";
+    }
+
+    OS << "globals\n";
+    if (auto Error = Ctx.serializeGlobals(OS); Error)
+      return std::move(Error);
+  }
+
+  return toHex(Hasher.final(), true);
+}
+
+Expected<bool>
+ArtifactCache::load(StringRef Key, Context &Ctx, ContainerSet &Output) const {
+  SmallString<128> EntryPath(Directory);
+  sys::path::append(EntryPath, Key);
+  if (not sys::fs::is_directory(EntryPath))
+    return false;
+
+  SmallString<128> GlobalsPath(EntryPath);
+  sys::path::append(GlobalsPath, "globals");
+  if (auto Error = Ctx.loadFromDisk(GlobalsPath); Error)
+    return std::move(Error);
+
+  SmallString<128> ContainersPath(EntryPath);
+  sys::path::append(ContainersPath, "containers");
+  if (auto Error = Output.loadFromDisk(ContainersPath); Error)
+    return std::move(Error);
+
+  setContentIDs(Key, Output);
+  return true;
+}
+
+Error ArtifactCache::store(StringRef Key,
+                           const Context &Ctx,
+                           const ContainerSet &Output) {
+  if (auto ErrorCode = sys::fs::create_directories(Directory); ErrorCode)
+    return createStringError(ErrorCode,
+                             "Could not create dir %s",
+                             Directory.c_str());
+
+  SmallString<128> TemporaryPath;
+  SmallString<128> Prefix(Directory);
+  sys::path::append(Prefix, "tmp-" + Key);
+  if (auto ErrorCode = sys::fs::createUniqueDirectory(Prefix, TemporaryPath);
+      ErrorCode)
+    return createStringError(ErrorCode,
+                             "Could not create a temporary dir in %s",
+                             Directory.c_str());
+
+  SmallString<128> GlobalsPath(TemporaryPath);
+  sys::path::append(GlobalsPath, "globals");
+  SmallString<128> ContainersPath(TemporaryPath);
+  sys::path::append(ContainersPath, "containers");
+  for (StringRef Path : { GlobalsPath.str(), ContainersPath.str() })
+    if (auto ErrorCode = sys::fs::create_directory(Path); ErrorCode)
+      return createStringError(ErrorCode,
+                               "Could not create dir %s",
+                               Path.str().c_str());
+
+  if (auto Error = Ctx.storeToDisk(GlobalsPath); Error)
+    return Error;
+
+  if (auto Error = Output.storeToDisk(ContainersPath); Error)
+    return Error;
+
+  setContentIDs(Key, Output);
+
+  // If another run stored the same entry in the meantime, keep that one
+  SmallString<128> EntryPath(Directory);
+  sys::path::append(EntryPath, Key);
+  if (sys::fs::rename(TemporaryPath, EntryPath))
+    sys::fs::remove_directories(TemporaryPath);
+
+  return Error::success();
+}
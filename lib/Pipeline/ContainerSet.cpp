@@ -6,22 +6,54 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <mutex>
+
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SHA1.h"
 
 #include "revng/Pipeline/ContainerSet.h"
 #include "revng/Pipeline/Errors.h"
+#include "revng/Support/TaskScheduler.h"
 
 using namespace pipeline;
 using namespace llvm;
 using namespace std;
 
-ContainerSet ContainerSet::cloneFiltered(const ContainerToTargetsMap &Targets) {
+/// \return the content ID of the clone of the container identified by \p ID
+///         restricted to \p Targets
+static std::string computeCloneID(StringRef ID, const TargetsList &Targets) {
+  SHA1 Hasher;
+  Hasher.update(ID);
+  for (const Target &Extracted : Targets) {
+    Hasher.update("\n");
+    Hasher.update(Extracted.getKind().name());
+    Hasher.update(Extracted.kindExactness() == Exactness::Exact ? ":" : "~");
+    for (const PathComponent &Component : Extracted.getPathComponents()) {
+      Hasher.update(Component.toString());
+      Hasher.update("/");
+    }
+  }
+  return toHex(Hasher.final(), true);
+}
+
+ContainerSet
+ContainerSet::cloneFiltered(const ContainerToTargetsMap &Targets,
+                            const llvm::StringSet<> *OnlyContainers) {
+  restoreAllOnAccess();
   ContainerSet ToReturn;
   for (const auto &Pair : Content) {
     const auto &ContainerName = Pair.first();
     const auto &Container = Pair.second;
 
+    bool Excluded = OnlyContainers != nullptr
+                    and OnlyContainers->count(ContainerName) == 0;
+    if (Excluded) {
+      ToReturn.add(ContainerName, *Factories[ContainerName]);
+      continue;
+    }
+
     auto ExtractedNames = Targets.contains(ContainerName) ?
                             Targets.at(ContainerName) :
                             TargetsList();
@@ -30,6 +62,12 @@ ContainerSet ContainerSet::cloneFiltered(const ContainerToTargetsMap &Targets) {
                     Container->cloneFiltered(ExtractedNames) :
                     nullptr;
 
+    // The content of the clone only depends on the original and on the
+    // extracted targets
+    if (Cloned != nullptr)
+      if (auto ID = Container->contentID())
+        Cloned->setContentID(computeCloneID(*ID, ExtractedNames));
+
     ToReturn.add(ContainerName, *Factories[Pair.first()], move(Cloned));
   }
   revng_assert(ToReturn.Content.size() == Content.size());
@@ -37,12 +75,16 @@ ContainerSet ContainerSet::cloneFiltered(const ContainerToTargetsMap &Targets) {
 }
 
 bool ContainerSet::contains(const Target &Target) const {
+  restoreAllOnAccess();
   return llvm::any_of(Content, [&Target](const auto &Container) {
     return Container.second->enumerate().contains(Target);
   });
 }
 
 Error ContainerSet::remove(const ContainerToTargetsMap &ToRemove) {
+  if (auto Error = checkRestores(); !!Error)
+    return Error;
+
   for (const auto &Target : ToRemove) {
     const auto &ContainerName = Target.first();
     const auto &NamesToRemove = Target.second;
@@ -75,29 +117,143 @@ void ContainerSet::intersect(ContainerToTargetsMap &ToIntersect) const {
 }
 
 llvm::Error ContainerSet::storeToDisk(StringRef Directory) const {
+  if (auto Error = checkRestores(); !!Error)
+    return Error;
+
   for (const auto &Pair : Content) {
     const auto &Name = Directory.str() + "/" + Pair.first().str();
     const auto &Container = Pair.second;
-    if (Container == nullptr)
+    if (Container == nullptr or Container->isSyncedWith(Name))
       continue;
 
-    if (auto Error = Container->storeToDisk(Name); !!Error)
+    // Containers evicted somewhere else need to be loaded back first
+    if (auto Error = Container->loadBack(); !!Error)
       return Error;
+
+    auto TemporaryName = Name + ".tmp";
+    if (auto Error = Container->storeToDisk(TemporaryName); !!Error) {
+      llvm::sys::fs::remove(TemporaryName);
+      return Error;
+    }
+
+    // Containers are free not to produce any file, e.g., when they are empty.
+    // In that case, what was previously stored is stale.
+    if (not llvm::sys::fs::exists(TemporaryName)) {
+      llvm::sys::fs::remove(Name);
+      continue;
+    }
+
+    if (auto EC = llvm::sys::fs::rename(TemporaryName, Name); EC)
+      return llvm::createStringError(EC,
+                                     "could not rename %s to %s",
+                                     TemporaryName.c_str(),
+                                     Name.c_str());
+
+    Container->markSynced(Name);
   }
   return Error::success();
 }
 
+std::vector<ContainerSet::LoadRequest>
+ContainerSet::prepareLoadFromDisk(StringRef Directory) {
+  std::vector<LoadRequest> Requests;
+  for (auto &Pair : Content) {
+    // Evicted containers are not loaded back, they're going to be replaced
+    if (Pair.second == nullptr)
+      Pair.second = (*Factories[Pair.first()])(Pair.first());
+
+    auto Name = Directory.str() + "/" + Pair.first().str();
+    Requests.push_back({ Pair.second.get(), std::move(Name) });
+  }
+  return Requests;
+}
+
 llvm::Error ContainerSet::loadFromDisk(StringRef Directory) {
+  return load(prepareLoadFromDisk(Directory), 1);
+}
+
+llvm::Error ContainerSet::load(ArrayRef<LoadRequest> Requests, unsigned Jobs) {
+  const auto MarkSynced = [](const LoadRequest &Request) {
+    Request.Container->markSynced(Request.Path);
+  };
+
+  if (Jobs <= 1) {
+    for (const LoadRequest &Request : Requests) {
+      if (auto Error = Request.Container->loadFromDisk(Request.Path); !!Error)
+        return Error;
+      MarkSynced(Request);
+    }
+    return Error::success();
+  }
+
+  std::mutex ErrorLock;
+  Error Result = Error::success();
+  std::vector<char> Loaded(Requests.size(), false);
+  auto Serve = [&ErrorLock, &Result, &Loaded, &Requests](size_t Index) {
+    const LoadRequest &Request = Requests[Index];
+    if (auto Error = Request.Container->loadFromDisk(Request.Path); !!Error) {
+      std::lock_guard<std::mutex> Guard(ErrorLock);
+      Result = joinErrors(std::move(Result), std::move(Error));
+    } else {
+      Loaded[Index] = true;
+    }
+  };
+
+  TaskGroup Group;
+  for (size_t I = 0; I < Requests.size(); ++I)
+    if (Requests[I].Container->canLoadConcurrently())
+      Group.spawn([&Serve, I] { Serve(I); });
+
+  for (size_t I = 0; I < Requests.size(); ++I)
+    if (not Requests[I].Container->canLoadConcurrently())
+      Serve(I);
+
+  Group.wait();
+
+  for (size_t I = 0; I < Requests.size(); ++I)
+    if (Loaded[I])
+      MarkSynced(Requests[I]);
+
+  return Result;
+}
+
+llvm::Error ContainerSet::evict(StringRef Directory) {
+  if (auto Error = storeToDisk(Directory); !!Error)
+    return Error;
+
   for (auto &Pair : Content) {
-    const auto &Name = Directory.str() + "/" + Pair.first().str();
+    if (Pair.second == nullptr or Pair.second->isEvicted())
+      continue;
 
-    if (auto Error = (*this)[Pair.first()].loadFromDisk(Name); !!Error)
-      return Error;
+    Pair.second->evict(Directory.str() + "/" + Pair.first().str());
+    ++EvictionsCount;
   }
+
   return Error::success();
 }
 
+llvm::Error ContainerSet::restoreAll() const {
+  for (const auto &Entry : Content)
+    if (Entry.second != nullptr)
+      consumeError(Entry.second->loadBack());
+
+  return checkRestores();
+}
+
+llvm::Error ContainerSet::checkRestores() const {
+  Error Result = Error::success();
+  for (const auto &Entry : Content)
+    if (Entry.second != nullptr)
+      Result = joinErrors(std::move(Result), Entry.second->checkLoadBack());
+
+  return Result;
+}
+
 llvm::Error ContainerSet::verify() const {
+  restoreAllOnAccess();
+  if (auto Error = checkRestores(); !!Error)
+    return Error;
+
   for (const auto &Pair : Content) {
     if (Pair.second == nullptr)
       continue;
@@ -111,12 +267,13 @@ llvm::Error ContainerSet::verify() const {
 ContainerToTargetsMap ContainerSet::enumerate() const {
   ContainerToTargetsMap Status;
 
-  for (const auto &Pair : *this) {
+  // Evicted containers remember what they held, no need to load them back
+  for (const auto &Pair : Content) {
     const auto &Name = Pair.first();
     const auto &MaybeCont = Pair.second;
 
     if (MaybeCont != nullptr)
-      Status[Name] = MaybeCont->enumerate();
+      Status[Name] = MaybeCont->enumerateWithoutLoading();
   }
   return Status;
 }
@@ -132,7 +289,50 @@ llvm::Error ContainerBase::storeToDisk(llvm::StringRef Path) const {
   return serialize(OS);
 }
 
-llvm::Error ContainerBase::loadFromDisk(llvm::StringRef Path) {
+bool ContainerBase::isSyncedWith(llvm::StringRef Path) const {
+  return not SyncedPath.empty() and SyncedVersion == Version
+         and SyncedPath == Path and llvm::sys::fs::exists(Path);
+}
+
+void ContainerBase::evict(llvm::StringRef Path) {
+  revng_assert(not isEvicted());
+  Evicted = Eviction{ Path.str(), Version, enumerate() };
+  clearImpl();
+}
+
+llvm::Error ContainerBase::loadBack() {
+  if (not isEvicted())
+    return llvm::Error::success();
+
+  std::string Path = std::move(Evicted->Path);
+  Evicted.reset();
+
+  // Loading back is not a change. What has been evicted was either synced with
+  // Path or empty, and then missing, and it's still the case.
+  uint64_t OldVersion = Version;
+  auto Error = loadFromDiskImpl(Path);
+  Version = OldVersion;
+
+  if (Error) {
+    LoadBackFailure = "Cannot load back evicted container " + Path + ": "
+                      + llvm::toString(std::move(Error));
+    return llvm::createStringError(llvm::inconvertibleErrorCode(),
+                                   LoadBackFailure);
+  }
+
+  ++ReloadsCount;
+  return llvm::Error::success();
+}
+
+llvm::Error ContainerBase::checkLoadBack() const {
+  if (LoadBackFailure.empty())
+    return llvm::Error::success();
+
+  return llvm::createStringError(llvm::inconvertibleErrorCode(),
+                                 LoadBackFailure);
+}
+
+llvm::Error ContainerBase::loadFromDiskImpl(llvm::StringRef Path) {
   if (not llvm::sys::fs::exists(Path)) {
     clear();
     return llvm::Error::success();
@@ -7,7 +7,9 @@
 //
 
 #include <cstdlib>
+#include <vector>
 
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringRef.h"
 
 #include "revng/Pipeline/AllRegistries.h"
@@ -24,6 +26,20 @@ llvm::Error Context::storeToDisk(llvm::StringRef Path) const {
   return llvm::Error::success();
 }
 
+llvm::Error Context::serializeGlobals(llvm::raw_ostream &OS) const {
+  std::vector<llvm::StringRef> Names;
+  for (const auto &Global : Globals)
+    Names.push_back(Global.first());
+  llvm::sort(Names);
+
+  for (llvm::StringRef Name : Names) {
+    OS << Name << "\n";
+    if (auto E = Globals.find(Name)->second->serialize(OS); !!E)
+      return E;
+  }
+  return llvm::Error::success();
+}
+
 llvm::Error Context::loadFromDisk(llvm::StringRef Path) {
   for (const auto &Global : Globals)
     if (auto E = Global.second->loadFromDisk(Path.str() + "/"
@@ -23,7 +23,7 @@ void Contract::deduceResults(ContainerToTargetsMap &StepStatus,
   TargetsList Tmp;
   deduceResults(StepStatus, Tmp, Names);
 
-  copy(Tmp, back_inserter(OutputContainerTarget));
+  OutputContainerTarget.merge(Tmp);
 }
 
 void Contract::deduceResults(ContainerToTargetsMap &StepStatus,
@@ -53,14 +53,15 @@ void Contract::deduceResults(ContainerToTargetsMap &StepStatus,
     return forwardMatches(Input);
   };
 
-  TargetsList Tmp;
+  // Collect everything in a plain list, so that duplicates are removed once
+  // rather than after each insertion
+  TargetsList::List Tmp;
   copy_if(SourceContainerTargets, back_inserter(Tmp), Matches);
   if (Preservation == pipeline::InputPreservation::Erase)
     erase_if(SourceContainerTargets, Matches);
 
-  for (pipeline::Target &Target : Tmp)
-    forward(Target);
-  copy(Tmp, back_inserter(Results));
+  forward(Tmp);
+  Results.merge(TargetsList(std::move(Tmp)));
 }
 
 ContainerToTargetsMap
@@ -85,122 +86,112 @@ void Contract::deduceRequirements(TargetsList &Source,
     return backwardMatches(Input) or (PreservedInput and forwardMatches(Input));
   };
 
-  TargetsList Tmp;
+  TargetsList::List Tmp;
 
   copy_if(Target, back_inserter(Tmp), Matches);
 
   // Transform the forward inputs/backward outputs that match,
   // they are trasformed by the current Pipe
-  for (pipeline::Target &Out : Tmp)
-    backward(Out);
+  backward(Tmp);
 
   // Erase from the Target those that will produced by me
   erase_if(Target, Matches);
 
-  copy(Tmp, back_inserter(Source));
+  Source.merge(TargetsList(std::move(Tmp)));
 }
 
-void Contract::forward(pipeline::Target &Input) const {
-  // A Pipe cannot yield a instance with multiple kinds when going
-  // forward.
-  revng_assert(Input.kindExactness() == Exactness::Exact);
+void Contract::forward(TargetsList::List &Inputs) const {
+  if (Inputs.empty())
+    return;
 
-  const auto *OutputKind = TargetKind != nullptr ? TargetKind :
-                                                   &Input.getKind();
-  Input.setKind(*OutputKind);
-  forwardRank(Input);
-}
+  const int Delta = forwardRankDelta();
+  for (pipeline::Target &Input : Inputs) {
+    // A Pipe cannot yield a instance with multiple kinds when going
+    // forward.
+    revng_assert(Input.kindExactness() == Exactness::Exact);
 
-bool Contract::forwardMatches(const Target &In) const {
-  switch (InputContract) {
-  case Exactness::DerivedFrom:
-    return Source->ancestorOf(In.getKind());
-  case Exactness::Exact:
-    return &In.getKind() == Source;
-  }
-  return false;
-}
+    const auto *OutputKind = TargetKind != nullptr ? TargetKind :
+                                                     &Input.getKind();
+    Input.setKind(*OutputKind);
 
-void Contract::backward(Target &Output) const {
-  if (not backwardMatches(Output))
-    return;
+    // if you are decreasing the rank, you must have at your disposal all
+    // symbols.
+    const auto &Components = Input.getPathComponents();
+    for (int I = Delta; I < 0; I++)
+      revng_assert(Components[Components.size() + I].isAll());
 
-  Output.setKind(backwardInputKind(Output));
-  Output.setExactness(backwardInputContract(Output));
-  backwardRank(Output);
+    applyRankDelta(Input, Delta);
+  }
 }
 
-Exactness::Values Contract::backwardInputContract(const Target &O) const {
-  if (TargetKind != nullptr)
-    return InputContract;
+void Contract::backward(TargetsList::List &Outputs) const {
+  if (Outputs.empty())
+    return;
 
-  if (InputContract == Exactness::Exact)
-    return Exactness::Exact;
+  const int Delta = -forwardRankDelta();
+  for (pipeline::Target &Output : Outputs) {
+    if (not backwardMatches(Output))
+      continue;
 
-  return O.kindExactness();
+    Output.setKind(backwardInputKind(Output));
+    Output.setExactness(backwardInputContract(Output));
+    applyRankDelta(Output, Delta);
+  }
 }
 
-void Contract::forwardRank(Target &Input) const {
+int Contract::forwardRankDelta() const {
   const auto *InputRank = &Source->rank();
   const auto *OutputRank = TargetKind != nullptr ? &TargetKind->rank() :
                                                    InputRank;
   if (InputRank == OutputRank)
-    return;
+    return 0;
 
-  // if the output is at a greater level of depth of the hierarchy
-  // than the input, for each level of difference add a rank to the
-  // target.
-  //
+  // if the output is at a greater level of depth of the hierarchy than the
+  // input, a path component must be added for each level of difference
+  int Delta = 0;
   if (InputRank->ancestorOf(*OutputRank)) {
-    while (InputRank != OutputRank) {
-      Input.addPathComponent();
-      OutputRank = OutputRank->parent();
-    }
-    return;
+    for (; OutputRank != InputRank; OutputRank = OutputRank->parent())
+      Delta++;
+    return Delta;
   }
 
-  // If the output is less fined grained than the input drop levels of
-  // rank until they have the same.
+  // If the output is less fined grained than the input, levels must be
+  // dropped until they have the same rank
   if (OutputRank->ancestorOf(*InputRank)) {
-    while (OutputRank != InputRank) {
-      // if you are decreasing the rank, you must have at your disposal
-      // all symbols.
-      revng_assert(Input.getPathComponents().back().isAll());
-      Input.dropPathComponent();
-      InputRank = InputRank->parent();
-    }
-    return;
+    for (; InputRank != OutputRank; InputRank = InputRank->parent())
+      Delta--;
+    return Delta;
   }
 
   revng_abort("Unreachable");
 }
 
-void Contract::backwardRank(Target &Out) const {
-  const auto *InputRank = &Source->rank();
-  const auto *OutputRank = TargetKind != nullptr ? &TargetKind->rank() :
-                                                   InputRank;
-  if (InputRank == OutputRank)
-    return;
+void Contract::applyRankDelta(Target &ToChange, int Delta) {
+  for (; Delta > 0; Delta--)
+    ToChange.addPathComponent();
 
-  if (OutputRank->ancestorOf(*InputRank)) {
-    while (InputRank != OutputRank) {
-      Out.addPathComponent();
-      InputRank = InputRank->parent();
-    }
-    return;
-  }
+  for (; Delta < 0; Delta++)
+    ToChange.dropPathComponent();
+}
 
-  if (InputRank->ancestorOf(*OutputRank)) {
-    while (InputRank != OutputRank) {
-      // if you are decreasing the rank, you must have at your disposal
-      // all symbols.
-      Out.dropPathComponent();
-      OutputRank = OutputRank->parent();
-    }
-    return;
+bool Contract::forwardMatches(const Target &In) const {
+  switch (InputContract) {
+  case Exactness::DerivedFrom:
+    return Source->ancestorOf(In.getKind());
+  case Exactness::Exact:
+    return &In.getKind() == Source;
   }
+  return false;
+}
 
-  revng_abort("Unreachable");
+Exactness::Values Contract::backwardInputContract(const Target &O) const {
+  if (TargetKind != nullptr)
+    return InputContract;
+
+  if (InputContract == Exactness::Exact)
+    return Exactness::Exact;
+
+  return O.kindExactness();
 }
 
 const Kind &Contract::backwardInputKind(const Target &Output) const {
@@ -42,3 +42,13 @@ void UnknownTargetError::log(raw_ostream &OS) const {
 std::error_code UnknownTargetError::convertToErrorCode() const {
   return inconvertibleErrorCode();
 }
+
+char CancelledRunError::ID;
+
+void CancelledRunError::log(raw_ostream &OS) const {
+  OS << "Run cancelled before step " << StepName;
+}
+
+std::error_code CancelledRunError::convertToErrorCode() const {
+  return inconvertibleErrorCode();
+}
@@ -16,8 +16,13 @@ using namespace pipeline;
 using namespace cl;
 
 void O2Pipe::registerPasses(llvm::legacy::PassManager &Manager) {
-  StringMap<llvm::cl::Option *> &Options(getRegisteredOptions());
-  getOption<bool>(Options, "disable-machine-licm")->setInitialValue(true);
+  // Options are global, there's no need to set them more than once
+  static bool OptionsSet = [] {
+    StringMap<llvm::cl::Option *> &Options(getRegisteredOptions());
+    getOption<bool>(Options, "disable-machine-licm")->setInitialValue(true);
+    return true;
+  }();
+  (void) OptionsSet;
 
   PassBuilder Builder;
   Builder.buildPerModuleDefaultPipeline(PassBuilder::OptimizationLevel::O2);
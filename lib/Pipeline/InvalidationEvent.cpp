@@ -5,8 +5,11 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <vector>
+
 #include "revng/Pipeline/InvalidationEvent.h"
 #include "revng/Pipeline/Kind.h"
+#include "revng/Support/TaskScheduler.h"
 
 using namespace pipeline;
 
@@ -21,15 +24,39 @@ llvm::Error InvalidationEventBase::apply(Runner &Runner) const {
 using InvalidationMap = Runner::InvalidationMap;
 void InvalidationEventBase::getInvalidations(const Runner &Runner,
                                              InvalidationMap &Map) const {
+  // What a kind invalidates does not depend on the container, hence ask each
+  // kind only once, possibly concurrently, and then add the result to all the
+  // containers
+  std::vector<const Kind *> Kinds;
+  for (const Kind &Rule : Runner.getKindsRegistry())
+    Kinds.push_back(&Rule);
+
+  std::vector<TargetsList> ByKind(Kinds.size());
+  const auto Compute = [this, &Kinds, &ByKind](size_t Index) {
+    Kinds[Index]->getInvalidations(ByKind[Index], *this);
+  };
+
+  if (Runner.getJobs() <= 1 or Kinds.size() <= 1) {
+    for (size_t I = 0; I < Kinds.size(); ++I)
+      Compute(I);
+  } else {
+    TaskGroup Group;
+    for (size_t I = 0; I < Kinds.size(); ++I)
+      Group.spawn([&Compute, I] { Compute(I); });
+    Group.wait();
+  }
+
+  TargetsList Invalidated;
+  for (const TargetsList &Targets : ByKind)
+    Invalidated.merge(Targets);
+
   for (const auto &Step : Runner) {
     auto &StepInvalidations = Map[Step.getName()];
     for (const auto &Cotainer : Step.containers()) {
       if (not Cotainer.second)
         continue;
 
-      auto &ContainerInvalidations = StepInvalidations[Cotainer.first()];
-      for (const Kind &Rule : Runner.getKindsRegistry())
-        Rule.getInvalidations(ContainerInvalidations, *this);
+      StepInvalidations[Cotainer.first()].merge(Invalidated);
     }
   }
 }
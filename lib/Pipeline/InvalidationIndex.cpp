@@ -0,0 +1,120 @@
+/// \file InvalidationIndex.cpp
+/// \brief The invalidation index keeps track of which targets of a step have
+/// been produced from which targets of its predecessor.
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include "llvm/ADT/STLExtras.h"
+
+#include "revng/Pipeline/InvalidationIndex.h"
+
+using namespace pipeline;
+using Location = InvalidationIndex::Location;
+
+bool InvalidationIndex::isIndexable(const Target &ToCheck) {
+  if (ToCheck.kindExactness() != Exactness::Exact)
+    return false;
+
+  return llvm::all_of(ToCheck.getPathComponents(),
+                      [](const PathComponent &Component) {
+                        return Component.isSingle();
+                      });
+}
+
+bool InvalidationIndex::overlaps(const Location &Left, const Location &Right) {
+  if (Left.first != Right.first)
+    return false;
+
+  const Target &L = Left.second;
+  const Target &R = Right.second;
+  if (L.getPathComponents().size() != R.getPathComponents().size())
+    return false;
+
+  return L.satisfies(R) or R.satisfies(L);
+}
+
+void InvalidationIndex::record(const Location &Source,
+                               const Location &Dependent) {
+  if (not Complete)
+    return;
+
+  Dependents[Source].insert(Dependent);
+  Sources[Dependent].insert(Source);
+
+  if (not isIndexable(Source.second))
+    WildcardSources.insert(Source);
+}
+
+void InvalidationIndex::forgetDependent(const Location &Dependent) {
+  auto It = Sources.find(Dependent);
+  if (It == Sources.end())
+    return;
+
+  for (const Location &Source : It->second) {
+    auto SourceIt = Dependents.find(Source);
+    revng_assert(SourceIt != Dependents.end());
+    SourceIt->second.erase(Dependent);
+    if (SourceIt->second.empty()) {
+      WildcardSources.erase(Source);
+      Dependents.erase(SourceIt);
+    }
+  }
+
+  Sources.erase(It);
+}
+
+void InvalidationIndex::forget(const ContainerToTargetsMap &Removed) {
+  for (const auto &Container : Removed) {
+    for (const Target &ToForget : Container.second) {
+      Location Dependent(Container.first().str(), ToForget);
+      if (isIndexable(ToForget)) {
+        forgetDependent(Dependent);
+        continue;
+      }
+
+      // The removed target describes many targets, drop all of them
+      std::vector<Location> Described;
+      for (const auto &Entry : Sources)
+        if (overlaps(Entry.first, Dependent))
+          Described.push_back(Entry.first);
+
+      for (const Location &ToDrop : Described)
+        forgetDependent(ToDrop);
+    }
+  }
+}
+
+std::optional<ContainerToTargetsMap>
+InvalidationIndex::dependentsOf(const ContainerToTargetsMap &Changed) const {
+  if (not Complete)
+    return std::nullopt;
+
+  std::set<Location> Found;
+  const auto Collect = [this, &Found](const Location &Source) {
+    auto It = Dependents.find(Source);
+    if (It != Dependents.end())
+      Found.insert(It->second.begin(), It->second.end());
+  };
+
+  for (const auto &Container : Changed) {
+    for (const Target &ToCheck : Container.second) {
+      if (not isIndexable(ToCheck))
+        return std::nullopt;
+
+      Location Source(Container.first().str(), ToCheck);
+      Collect(Source);
+
+      // Sources recorded as compacted targets may describe ToCheck as well
+      for (const Location &Wildcard : WildcardSources)
+        if (overlaps(Wildcard, Source))
+          Collect(Wildcard);
+    }
+  }
+
+  ContainerToTargetsMap Result;
+  for (const auto &[ContainerName, Dependent] : Found)
+    Result.add(ContainerName, Dependent);
+  return Result;
+}
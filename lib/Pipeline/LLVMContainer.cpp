@@ -11,5 +11,15 @@
 
 char pipeline::LLVMContainerTypeID = '0';
 
+using namespace llvm;
+
+static constexpr const char *LazyLoadDescription = "parse the llvm containers "
+                                                   "loaded from disk only when "
+                                                   "used";
+
+cl::opt<bool> pipeline::LazyLoadLLVMContainers("lazy-load-llvm-containers",
+                                               cl::desc(LazyLoadDescription),
+                                               cl::init(false));
+
 template<>
 const char pipeline::LLVMContainer::ID = '0';
@@ -6,8 +6,10 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <mutex>
 #include <optional>
 
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 
 #include "revng/Pipeline/Loader.h"
@@ -67,11 +69,48 @@ Loader::parseLLVMPass(Step &Step, const PipeInvocation &Invocation) const {
   return Error::success();
 }
 
+llvm::Expected<std::unique_ptr<NewPMPassWrapperBase>>
+Loader::loadNewPMPassFromName(llvm::StringRef Name) const {
+
+  auto It = KnownNewPMLLVMPipeTypes.find(Name);
+  if (It != KnownNewPMLLVMPipeTypes.end())
+    return It->second();
+
+  return PureNewPMPassWrapper::create(Name);
+}
+
+llvm::Error
+Loader::parseNewPMLLVMPass(Step &Step, const PipeInvocation &Invocation) const {
+
+  NewPMLLVMPipe ToInsert;
+
+  if (OnNewPMLLVMPipeCreationAction.has_value()) {
+    auto MaybeError = (*OnNewPMLLVMPipeCreationAction)(*this, ToInsert);
+    if (!!MaybeError)
+      return MaybeError;
+  }
+
+  for (const auto &PassName : Invocation.Passes) {
+    auto MaybePass = loadNewPMPassFromName(PassName);
+    if (not MaybePass)
+      return MaybePass.takeError();
+    ToInsert.addPass(std::move(*MaybePass));
+  }
+
+  auto Wrapper = PipeWrapper(move(ToInsert), Invocation.UsedContainers);
+  Step.addPipe(move(Wrapper));
+
+  return Error::success();
+}
+
 llvm::Error
 Loader::parseInvocation(Step &Step, const PipeInvocation &Invocation) const {
   if (Invocation.Type == "LLVMPipe")
     return parseLLVMPass(Step, Invocation);
 
+  if (Invocation.Type == "NewPMLLVMPipe")
+    return parseNewPMLLVMPass(Step, Invocation);
+
   auto It = KnownPipesTypes.find(Invocation.Type);
   if (It == KnownPipesTypes.end()) {
     auto *Message = "while parsing pipe invocation: No known Pipe with "
@@ -102,19 +141,41 @@ Error Loader::parseContainerDeclaration(Runner &Pipeline,
   return Error::success();
 }
 
+/// \brief Parse the YAML of a pipeline, unless it has been parsed before
+///
+/// Parsed declarations are never released, and they're immutable, so the
+/// returned pointer is valid for the whole lifetime of the process.
+static llvm::Expected<const PipelineDeclaration *>
+parsePipeline(llvm::StringRef Text) {
+  static std::mutex CacheLock;
+  static llvm::StringMap<PipelineDeclaration> Cache;
+
+  std::lock_guard<std::mutex> Guard(CacheLock);
+  auto It = Cache.find(Text);
+  if (It != Cache.end())
+    return &It->second;
+
+  PipelineDeclaration Declaration;
+  yaml::Input Input(Text);
+  Input >> Declaration;
+  if (Input.error())
+    return createStringError(inconvertibleErrorCode(),
+                             "Could not parse pipeline\n");
+
+  return &Cache.try_emplace(Text, std::move(Declaration)).first->second;
+}
+
 llvm::Expected<Runner>
 Loader::load(llvm::ArrayRef<std::string> Pipelines) const {
-  std::vector<PipelineDeclaration> Declarations(Pipelines.size());
-  for (size_t I = 0; I < Pipelines.size(); I++) {
-    yaml::Input Input(Pipelines[I]);
-
-    Input >> Declarations[I];
-    if (Input.error())
-      return createStringError(inconvertibleErrorCode(),
-                               "Could not parse pipeline\n");
+  DeclarationsList Declarations;
+  for (const std::string &Pipeline : Pipelines) {
+    auto MaybeDeclaration = parsePipeline(Pipeline);
+    if (not MaybeDeclaration)
+      return MaybeDeclaration.takeError();
+    Declarations.push_back(*MaybeDeclaration);
   }
 
-  return load(Declarations);
+  return loadDeclarations(std::move(Declarations));
 }
 
 llvm::Error Loader::parseSteps(Runner &Runner,
@@ -181,12 +242,16 @@ sortPipeline(llvm::SmallVector<const PipelineDeclaration *, 2> &ToSort) {
 
 llvm::Expected<Runner>
 Loader::load(llvm::ArrayRef<PipelineDeclaration> Pipelines) const {
-  Runner ToReturn(*PipelineContext);
-
-  llvm::SmallVector<const PipelineDeclaration *, 2> ToSort;
+  DeclarationsList ToSort;
   for (const auto &Pipeline : Pipelines)
     ToSort.push_back(&Pipeline);
 
+  return loadDeclarations(std::move(ToSort));
+}
+
+llvm::Expected<Runner> Loader::loadDeclarations(DeclarationsList ToSort) const {
+  Runner ToReturn(*PipelineContext);
+
   if (auto Error = sortPipeline(ToSort); Error)
     return std::move(Error);
 
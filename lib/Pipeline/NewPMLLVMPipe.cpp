@@ -0,0 +1,27 @@
+/// \file NewPMLLVMPipe.cpp
+/// \brief A new pass manager pipe runs passes sharing the analysis managers
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include "llvm/Passes/PassBuilder.h"
+
+#include "revng/Pipeline/NewPMLLVMPipe.h"
+
+using namespace llvm;
+using namespace pipeline;
+
+Expected<std::unique_ptr<PureNewPMPassWrapper>>
+PureNewPMPassWrapper::create(StringRef Pipeline) {
+  // Make sure the description can be parsed upfront
+  PassBuilder Builder;
+  ModulePassManager Manager;
+  if (auto Error = Builder.parsePassPipeline(Manager, Pipeline))
+    return createStringError(inconvertibleErrorCode(),
+                             "Could not parse llvm pass pipeline %s: %s",
+                             Pipeline.str().c_str(),
+                             toString(std::move(Error)).c_str());
+
+  return std::make_unique<PureNewPMPassWrapper>(Pipeline);
+}
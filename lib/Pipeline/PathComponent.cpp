@@ -0,0 +1,26 @@
+/// \file PathComponent.cpp
+/// \brief A path component is either the name of an object or *.
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <mutex>
+
+#include "llvm/ADT/StringMap.h"
+
+#include "revng/Pipeline/PathComponent.h"
+
+using namespace pipeline;
+
+const std::string &PathComponent::intern(llvm::StringRef Name) {
+  // Entries of a StringMap are never moved, so references to them stay valid
+  static std::mutex Lock;
+  static llvm::StringMap<std::string> Table;
+
+  std::lock_guard<std::mutex> Guard(Lock);
+  auto It = Table.find(Name);
+  if (It == Table.end())
+    It = Table.try_emplace(Name, Name.str()).first;
+  return It->second;
+}
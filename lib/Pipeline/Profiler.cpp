@@ -0,0 +1,166 @@
+/// \file Profiler.cpp
+/// \brief The profiler records how much time and memory each pipe required.
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <functional>
+#include <map>
+#include <thread>
+
+#include <sys/resource.h>
+
+#include "llvm/Support/Format.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/Process.h"
+
+#include "revng/Pipeline/Profiler.h"
+
+using namespace pipeline;
+using namespace std::chrono;
+
+static microseconds getCPUTime() {
+  llvm::sys::TimePoint<> Elapsed;
+  std::chrono::nanoseconds User;
+  std::chrono::nanoseconds System;
+  llvm::sys::Process::GetTimeUsage(Elapsed, User, System);
+  return duration_cast<microseconds>(User + System);
+}
+
+static uint64_t getPeakRSSKiB() {
+  struct rusage Usage;
+  if (getrusage(RUSAGE_SELF, &Usage) != 0)
+    return 0;
+  return Usage.ru_maxrss;
+}
+
+Profiler::Measurement::Measurement(Profiler &Parent,
+                                   llvm::StringRef Step,
+                                   llvm::StringRef Pipe,
+                                   size_t InputTargets) :
+  Parent(Parent),
+  WallStart(Clock::now()),
+  CPUStart(getCPUTime()),
+  PeakRSSStart(getPeakRSSKiB()) {
+  Result.Step = Step.str();
+  Result.Pipe = Pipe.str();
+  Result.InputTargets = InputTargets;
+  Result.Start = duration_cast<microseconds>(WallStart - Parent.Creation)
+                   .count();
+  Result.ThreadID = std::hash<std::thread::id>()(std::this_thread::get_id());
+}
+
+void Profiler::Measurement::done(size_t OutputTargets) {
+  auto Wall = Clock::now() - WallStart;
+  Result.WallMicroseconds = duration_cast<microseconds>(Wall).count();
+  Result.CPUMicroseconds = (getCPUTime() - CPUStart).count();
+  Result.PeakRSSDeltaKiB = getPeakRSSKiB() - PeakRSSStart;
+  Result.OutputTargets = OutputTargets;
+  Parent.record(std::move(Result));
+}
+
+void Profiler::record(PipeExecutionRecord Invocation) {
+  std::lock_guard<std::mutex> Guard(Lock);
+  Invocations.push_back(std::move(Invocation));
+}
+
+std::vector<PipeExecutionRecord> Profiler::invocations() const {
+  std::lock_guard<std::mutex> Guard(Lock);
+  return Invocations;
+}
+
+void Profiler::clear() {
+  std::lock_guard<std::mutex> Guard(Lock);
+  Invocations.clear();
+}
+
+void Profiler::writeChromeTrace(llvm::raw_ostream &OS) const {
+  llvm::json::OStream JSON(OS);
+  JSON.object([&] {
+    JSON.attributeArray("traceEvents", [&] {
+      for (const PipeExecutionRecord &Invocation : invocations()) {
+        JSON.object([&] {
+          JSON.attribute("name", Invocation.Pipe);
+          JSON.attribute("cat", Invocation.Step);
+          JSON.attribute("ph", "X");
+          JSON.attribute("ts", static_cast<int64_t>(Invocation.Start));
+          JSON.attribute("dur",
+                         static_cast<int64_t>(Invocation.WallMicroseconds));
+          JSON.attribute("pid", 0);
+          JSON.attribute("tid", static_cast<int64_t>(Invocation.ThreadID));
+          JSON.attributeObject("args", [&] {
+            JSON.attribute("step", Invocation.Step);
+            JSON.attribute("cpu_us",
+                           static_cast<int64_t>(Invocation.CPUMicroseconds));
+            JSON.attribute("peak_rss_delta_kib",
+                           static_cast<int64_t>(Invocation.PeakRSSDeltaKiB));
+            JSON.attribute("input_targets",
+                           static_cast<int64_t>(Invocation.InputTargets));
+            JSON.attribute("output_targets",
+                           static_cast<int64_t>(Invocation.OutputTargets));
+          });
+        });
+      }
+    });
+    JSON.attribute("displayTimeUnit", "ms");
+  });
+  OS << "\n";
+}
+
+void Profiler::printSummary(llvm::raw_ostream &OS) const {
+  struct Total {
+    size_t Count = 0;
+    uint64_t Wall = 0;
+    uint64_t CPU = 0;
+    uint64_t PeakRSSDelta = 0;
+    size_t InputTargets = 0;
+    size_t OutputTargets = 0;
+  };
+
+  // Keep the order in which pipes have been run for the first time
+  std::vector<std::pair<std::string, std::string>> Order;
+  std::map<std::pair<std::string, std::string>, Total> Totals;
+  uint64_t OverallWall = 0;
+  for (const PipeExecutionRecord &Invocation : invocations()) {
+    auto Key = std::make_pair(Invocation.Step, Invocation.Pipe);
+    auto [It, New] = Totals.try_emplace(Key);
+    if (New)
+      Order.push_back(Key);
+
+    Total &Entry = It->second;
+    Entry.Count++;
+    Entry.Wall += Invocation.WallMicroseconds;
+    Entry.CPU += Invocation.CPUMicroseconds;
+    Entry.PeakRSSDelta += Invocation.PeakRSSDeltaKiB;
+    Entry.InputTargets += Invocation.InputTargets;
+    Entry.OutputTargets += Invocation.OutputTargets;
+    OverallWall += Invocation.WallMicroseconds;
+  }
+
+  OS << llvm::left_justify("Step", 20) << " " << llvm::left_justify("Pipe", 30)
+     << " " << llvm::right_justify("Runs", 6) << " "
+     << llvm::right_justify("Wall (ms)", 12) << " "
+     << llvm::right_justify("CPU (ms)", 12) << " "
+     << llvm::right_justify("Wall %", 7) << " "
+     << llvm::right_justify("Peak RSS (KiB)", 14) << " "
+     << llvm::right_justify("Inputs", 8) << " "
+     << llvm::right_justify("Outputs", 8) << "\n";
+
+  for (const auto &Key : Order) {
+    const Total &Entry = Totals.at(Key);
+    double Percentage = OverallWall == 0 ? 0.0 :
+                                           100.0 * Entry.Wall / OverallWall;
+    OS << llvm::format("%-20s %-30s %6zu %12.3f %12.3f %6.1f%% %14llu %8zu "
+                       "%8zu\n",
+                       Key.first.c_str(),
+                       Key.second.c_str(),
+                       Entry.Count,
+                       Entry.Wall / 1000.0,
+                       Entry.CPU / 1000.0,
+                       Percentage,
+                       static_cast<unsigned long long>(Entry.PeakRSSDelta),
+                       Entry.InputTargets,
+                       Entry.OutputTargets);
+  }
+}
@@ -0,0 +1,325 @@
+/// \file RemoteWorkers.cpp
+/// \brief Dispatch the execution of the pipes of a step to other nodes.
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <optional>
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Program.h"
+#include "llvm/Support/StringSaver.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "revng/Pipeline/RemoteWorkers.h"
+#include "revng/Pipeline/Runner.h"
+#include "revng/Pipeline/Step.h"
+#include "revng/Support/Assert.h"
+
+using namespace llvm;
+using namespace pipeline;
+
+static constexpr const char *StepFileName = "step";
+static constexpr const char *OnlyContainersFileName = "only-containers";
+static constexpr const char *GlobalsDirectoryName = "globals";
+static constexpr const char *InputDirectoryName = "input";
+static constexpr const char *OutputDirectoryName = "output";
+
+static std::string appendPath(StringRef Directory, StringRef Name) {
+  SmallString<128> Result(Directory);
+  sys::path::append(Result, Name);
+  return Result.str().str();
+}
+
+static Error writeFile(StringRef Path, StringRef Content) {
+  std::error_code EC;
+  raw_fd_ostream OS(Path, EC, sys::fs::OF_Text);
+  if (EC)
+    return createStringError(EC, "Could not open %s", Path.str().c_str());
+  OS << Content;
+  return Error::success();
+}
+
+static Error createDirectory(StringRef Path) {
+  if (auto ErrorCode = sys::fs::create_directories(Path); ErrorCode)
+    return createStringError(ErrorCode,
+                             "Could not create dir %s",
+                             Path.str().c_str());
+  return Error::success();
+}
+
+CommandRemoteWorker::CommandRemoteWorker(std::vector<std::string> Command,
+                                         unsigned TimeoutSeconds) :
+  Command(std::move(Command)), TimeoutSeconds(TimeoutSeconds) {
+  revng_assert(not this->Command.empty());
+  for (const std::string &Argument : this->Command) {
+    if (not Name.empty())
+      Name += " ";
+    Name += Argument;
+  }
+}
+
+std::unique_ptr<CommandRemoteWorker>
+CommandRemoteWorker::fromCommandLine(StringRef CommandLine,
+                                     unsigned TimeoutSeconds) {
+  BumpPtrAllocator Allocator;
+  StringSaver Saver(Allocator);
+  SmallVector<const char *, 8> Arguments;
+  cl::TokenizeGNUCommandLine(CommandLine, Saver, Arguments);
+  if (Arguments.empty())
+    return nullptr;
+
+  std::vector<std::string> Command(Arguments.begin(), Arguments.end());
+  return std::make_unique<CommandRemoteWorker>(std::move(Command),
+                                               TimeoutSeconds);
+}
+
+Error CommandRemoteWorker::execute(StringRef RequestDirectory) {
+  std::vector<std::string> Arguments;
+  for (const std::string &Argument : Command) {
+    std::string Replaced;
+    StringRef Rest = Argument;
+    for (size_t Position = Rest.find("{}"); Position != StringRef::npos;
+         Position = Rest.find("{}")) {
+      Replaced += Rest.take_front(Position).str() + RequestDirectory.str();
+      Rest = Rest.drop_front(Position + 2);
+    }
+    Arguments.push_back(Replaced + Rest.str());
+  }
+
+  auto MaybeProgram = sys::findProgramByName(Arguments.front());
+  if (not MaybeProgram)
+    return createStringError(MaybeProgram.getError(),
+                             "Could not find %s",
+                             Arguments.front().c_str());
+  Arguments.front() = *MaybeProgram;
+
+  std::vector<StringRef> ArgumentsRefs(Arguments.begin(), Arguments.end());
+  std::string ErrorMessage;
+  int ExitCode = sys::ExecuteAndWait(Arguments.front(),
+                                     ArgumentsRefs,
+                                     None,
+                                     {},
+                                     TimeoutSeconds,
+                                     0,
+                                     &ErrorMessage);
+  if (ExitCode != 0)
+    return createStringError(inconvertibleErrorCode(),
+                             "Worker %s failed with exit code %d: %s",
+                             Name.c_str(),
+                             ExitCode,
+                             ErrorMessage.c_str());
+
+  return Error::success();
+}
+
+RemoteScheduler::RemoteScheduler(StringRef ScratchDirectory) {
+  SmallString<128> Path(ScratchDirectory);
+  sys::fs::make_absolute(Path);
+  this->ScratchDirectory = Path.str().str();
+}
+
+size_t RemoteScheduler::acquire() {
+  std::unique_lock<std::mutex> Guard(Lock);
+  while (true) {
+    std::optional<size_t> Best;
+    for (size_t I = 0; I < Workers.size(); ++I) {
+      if (Workers[I].Busy)
+        continue;
+      if (not Best or Workers[I].Failures < Workers[*Best].Failures)
+        Best = I;
+    }
+
+    if (Best) {
+      Workers[*Best].Busy = true;
+      return *Best;
+    }
+
+    Released.wait(Guard);
+  }
+}
+
+void RemoteScheduler::release(size_t Index, bool Succeeded) {
+  {
+    std::lock_guard<std::mutex> Guard(Lock);
+    Workers[Index].Busy = false;
+    if (not Succeeded)
+      ++Workers[Index].Failures;
+  }
+  Released.notify_one();
+}
+
+Error RemoteScheduler::run(const Context &Ctx,
+                           const Step &ToRun,
+                           ContainerSet &Input,
+                           const StringSet<> *OnlyContainers) {
+  revng_assert(not Workers.empty());
+
+  if (auto Error = createDirectory(ScratchDirectory); Error)
+    return Error;
+
+  SmallString<128> RequestDirectory;
+  SmallString<128> Prefix(ScratchDirectory);
+  sys::path::append(Prefix, "request-" + ToRun.getName());
+  if (auto ErrorCode = sys::fs::createUniqueDirectory(Prefix,
+                                                      RequestDirectory);
+      ErrorCode)
+    return createStringError(ErrorCode,
+                             "Could not create a request dir in %s",
+                             ScratchDirectory.c_str());
+
+  // Whatever happens, do not leave the request behind
+  struct RemoveOnExit {
+    StringRef Path;
+    ~RemoveOnExit() { sys::fs::remove_directories(Path); }
+  } Cleanup{ RequestDirectory };
+
+  std::string GlobalsPath = appendPath(RequestDirectory, GlobalsDirectoryName);
+  std::string InputPath = appendPath(RequestDirectory, InputDirectoryName);
+  for (StringRef Path : { StringRef(GlobalsPath), StringRef(InputPath) })
+    if (auto Error = createDirectory(Path); Error)
+      return Error;
+
+  auto StepPath = appendPath(RequestDirectory, StepFileName);
+  if (auto Error = writeFile(StepPath, ToRun.getName()); Error)
+    return Error;
+
+  if (OnlyContainers != nullptr) {
+    std::string Names;
+    for (const auto &Entry : *OnlyContainers)
+      Names += Entry.first().str() + "\n";
+
+    auto OnlyPath = appendPath(RequestDirectory, OnlyContainersFileName);
+    if (auto Error = writeFile(OnlyPath, Names); Error)
+      return Error;
+  }
+
+  if (auto Error = Ctx.storeToDisk(GlobalsPath); Error)
+    return Error;
+
+  if (auto Error = Input.storeToDisk(InputPath); Error)
+    return Error;
+
+  std::string OutputPath = appendPath(RequestDirectory, OutputDirectoryName);
+  Error Result = Error::success();
+  for (unsigned Attempt = 0; Attempt < MaxAttempts; ++Attempt) {
+    size_t Index = acquire();
+    ++Dispatched;
+
+    // Never trust the output of a previous failed attempt
+    sys::fs::remove_directories(OutputPath);
+
+    auto Error = Workers[Index].Worker->execute(RequestDirectory);
+    if (not Error and not sys::fs::is_directory(OutputPath))
+      Error = createStringError(inconvertibleErrorCode(),
+                                "Worker %s did not produce any output",
+                                Workers[Index].Worker->getName().str().c_str());
+
+    release(Index, not Error);
+    if (not Error) {
+      consumeError(std::move(Result));
+      return Input.loadFromDisk(OutputPath);
+    }
+
+    ++Failed;
+    Result = joinErrors(std::move(Result), std::move(Error));
+  }
+
+  return Result;
+}
+
+static Expected<std::string> readFile(StringRef Path) {
+  auto MaybeBuffer = MemoryBuffer::getFile(Path);
+  if (not MaybeBuffer)
+    return createStringError(MaybeBuffer.getError(),
+                             "Could not read %s",
+                             Path.str().c_str());
+  return (*MaybeBuffer)->getBuffer().str();
+}
+
+static Expected<std::string> serializeGlobals(const Context &Ctx) {
+  std::string Result;
+  raw_string_ostream OS(Result);
+  if (auto Error = Ctx.serializeGlobals(OS); Error)
+    return std::move(Error);
+  OS.flush();
+  return Result;
+}
+
+Error pipeline::serveRemoteRequest(Runner &Runner, StringRef RequestDirectory) {
+  auto MaybeStepName = readFile(appendPath(RequestDirectory, StepFileName));
+  if (not MaybeStepName)
+    return MaybeStepName.takeError();
+
+  StringRef StepName = StringRef(*MaybeStepName).trim();
+  if (not Runner.containsStep(StepName))
+    return createStringError(inconvertibleErrorCode(),
+                             "No known step %s",
+                             StepName.str().c_str());
+  Step &ToRun = Runner[StepName];
+
+  std::optional<StringSet<>> OnlyContainers;
+  auto OnlyPath = appendPath(RequestDirectory, OnlyContainersFileName);
+  if (sys::fs::exists(OnlyPath)) {
+    auto MaybeNames = readFile(OnlyPath);
+    if (not MaybeNames)
+      return MaybeNames.takeError();
+
+    SmallVector<StringRef, 8> Names;
+    StringRef(*MaybeNames).split(Names, '\n', -1, false);
+    OnlyContainers.emplace();
+    for (StringRef Name : Names)
+      OnlyContainers->insert(Name);
+  }
+
+  Context &Ctx = Runner.getContext();
+  auto GlobalsPath = appendPath(RequestDirectory, GlobalsDirectoryName);
+  if (auto Error = Ctx.loadFromDisk(GlobalsPath); Error)
+    return Error;
+
+  auto MaybeGlobalsBefore = serializeGlobals(Ctx);
+  if (not MaybeGlobalsBefore)
+    return MaybeGlobalsBefore.takeError();
+
+  ContainerSet Input = ToRun.cloneFiltered({});
+  auto InputPath = appendPath(RequestDirectory, InputDirectoryName);
+  if (auto Error = Input.loadFromDisk(InputPath); Error)
+    return Error;
+
+  const StringSet<> *Only = OnlyContainers ? &*OnlyContainers : nullptr;
+  ToRun.runPipes(Ctx, Input, Only);
+
+  auto MaybeGlobalsAfter = serializeGlobals(Ctx);
+  if (not MaybeGlobalsAfter)
+    return MaybeGlobalsAfter.takeError();
+
+  if (*MaybeGlobalsBefore != *MaybeGlobalsAfter)
+    return createStringError(inconvertibleErrorCode(),
+                             "The pipes of step %s changed the globals, they "
+                             "cannot be run remotely",
+                             StepName.str().c_str());
+
+  // Write the output in a temporary directory first, so that the scheduler
+  // never observes a partial output
+  auto OutputPath = appendPath(RequestDirectory, OutputDirectoryName);
+  auto TemporaryPath = OutputPath + ".tmp";
+  sys::fs::remove_directories(TemporaryPath);
+  if (auto Error = createDirectory(TemporaryPath); Error)
+    return Error;
+
+  if (auto Error = Input.storeToDisk(TemporaryPath); Error)
+    return Error;
+
+  if (auto ErrorCode = sys::fs::rename(TemporaryPath, OutputPath); ErrorCode)
+    return createStringError(ErrorCode,
+                             "Could not rename %s",
+                             TemporaryPath.c_str());
+
+  return Error::success();
+}
@@ -0,0 +1,133 @@
+/// \file RunEventLog.cpp
+/// \brief The run event log describes what a runner did as JSON lines.
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <algorithm>
+#include <vector>
+
+#include "llvm/Support/JSON.h"
+
+#include "revng/Pipeline/ContainerSet.h"
+#include "revng/Pipeline/RunEventLog.h"
+
+using namespace pipeline;
+using namespace std::chrono;
+
+static std::string toString(const Target &T) {
+  std::string Result;
+  for (const PathComponent &Component : T.getPathComponents()) {
+    if (not Result.empty())
+      Result += "/";
+    Result += Component.toString();
+  }
+  Result += ":";
+  Result += T.getKind().name();
+  return Result;
+}
+
+/// Containers are emitted sorted by name, so that the output is stable
+template<typename T>
+static std::vector<llvm::StringRef> sortedKeys(const T &Map) {
+  std::vector<llvm::StringRef> Result;
+  for (const auto &Entry : Map)
+    Result.push_back(Entry.first());
+  llvm::sort(Result);
+  return Result;
+}
+
+static void writeTargets(llvm::json::OStream &JSON,
+                         llvm::StringRef Name,
+                         const ContainerToTargetsMap &Targets) {
+  JSON.attributeObject(Name, [&] {
+    for (llvm::StringRef Container : sortedKeys(Targets)) {
+      const TargetsList &List = Targets.at(Container);
+      if (List.empty())
+        continue;
+
+      JSON.attributeArray(Container, [&] {
+        for (const Target &T : List)
+          JSON.value(toString(T));
+      });
+    }
+  });
+}
+
+static void writeSizes(llvm::json::OStream &JSON,
+                       llvm::StringRef Name,
+                       const llvm::StringMap<size_t> &Sizes) {
+  JSON.attributeObject(Name, [&] {
+    for (llvm::StringRef Container : sortedKeys(Sizes))
+      JSON.attribute(Container,
+                     static_cast<int64_t>(Sizes.find(Container)->second));
+  });
+}
+
+static size_t countTargets(const ContainerToTargetsMap &Targets) {
+  size_t Result = 0;
+  for (const auto &Entry : Targets)
+    Result += Entry.second.size();
+  return Result;
+}
+
+uint64_t RunEventLog::now() const {
+  return duration_cast<microseconds>(Clock::now() - Creation).count();
+}
+
+void RunEventLog::recordRequest(llvm::StringRef EndingStep,
+                                const ContainerToTargetsMap &Requested,
+                                const ContainerToTargetsMap &Available,
+                                uint64_t Start,
+                                uint64_t WallMicroseconds,
+                                bool Succeeded) {
+  std::lock_guard<std::mutex> Guard(Lock);
+  {
+    llvm::json::OStream JSON(OS);
+    JSON.object([&] {
+      JSON.attribute("event", "request");
+      JSON.attribute("step", EndingStep);
+      JSON.attribute("ts", static_cast<int64_t>(Start));
+      JSON.attribute("dur", static_cast<int64_t>(WallMicroseconds));
+      JSON.attribute("succeeded", Succeeded);
+      writeTargets(JSON, "requested", Requested);
+      writeTargets(JSON, "available", Available);
+      JSON.attribute("requested_count",
+                     static_cast<int64_t>(countTargets(Requested)));
+      JSON.attribute("available_count",
+                     static_cast<int64_t>(countTargets(Available)));
+    });
+  }
+  OS << "\n";
+  OS.flush();
+}
+
+void RunEventLog::recordStep(const StepEvent &Event, uint64_t Start) {
+  std::lock_guard<std::mutex> Guard(Lock);
+  {
+    llvm::json::OStream JSON(OS);
+    JSON.object([&] {
+      JSON.attribute("event", "step");
+      JSON.attribute("step", Event.Step);
+      JSON.attribute("ts", static_cast<int64_t>(Start));
+      JSON.attribute("dur", static_cast<int64_t>(Event.WallMicroseconds));
+      JSON.attribute("cached", Event.Cached);
+      writeTargets(JSON, "requested", Event.Requested);
+      writeTargets(JSON, "available", Event.Available);
+      writeTargets(JSON, "produced", Event.Produced);
+      writeSizes(JSON, "sizes_before", Event.SizesBefore);
+      writeSizes(JSON, "sizes_after", Event.SizesAfter);
+    });
+  }
+  OS << "\n";
+  OS.flush();
+}
+
+llvm::StringMap<size_t>
+RunEventLog::computeSizes(const ContainerSet &Containers) {
+  llvm::StringMap<size_t> Result;
+  for (const auto &Entry : Containers.enumerate())
+    Result[Entry.first()] = Entry.second.size();
+  return Result;
+}
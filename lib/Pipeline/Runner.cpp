@@ -6,11 +6,23 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "llvm/ADT/EquivalenceClasses.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/Support/Error.h"
 
+#include "revng/Pipeline/ArtifactCache.h"
 #include "revng/Pipeline/Errors.h"
 #include "revng/Pipeline/Runner.h"
 #include "revng/Pipeline/Target.h"
+#include "revng/Support/TaskScheduler.h"
 
 using namespace std;
 using namespace llvm;
@@ -19,25 +31,60 @@ using namespace pipeline;
 class PipelineExecutionEntry {
 public:
   Step *ToExecute;
+  /// What the predecessor of ToExecute has to provide
   ContainerToTargetsMap Objectives;
-
-  PipelineExecutionEntry(Step &ToExecute, ContainerToTargetsMap Objectives) :
-    ToExecute(&ToExecute), Objectives(std::move(Objectives)) {}
+  /// The goals ToExecute has been asked for
+  ContainerToTargetsMap Requested;
+  /// The requested goals already available in the backing containers
+  ContainerToTargetsMap Available;
+
+  PipelineExecutionEntry(Step &ToExecute,
+                         ContainerToTargetsMap Objectives,
+                         ContainerToTargetsMap Requested,
+                         ContainerToTargetsMap Available) :
+    ToExecute(&ToExecute),
+    Objectives(std::move(Objectives)),
+    Requested(std::move(Requested)),
+    Available(std::move(Available)) {}
 };
 
+using StepLocksMap = llvm::StringMap<std::mutex>;
+
+static std::unique_lock<std::mutex> lockStep(StepLocksMap *StepLocks,
+                                             const Step &ToLock) {
+  if (StepLocks == nullptr)
+    return std::unique_lock<std::mutex>();
+  return std::unique_lock<std::mutex>(StepLocks->find(ToLock.getName())
+                                        ->second);
+}
+
+/// Computes the steps to execute to obtain Targets in EndingStepName, and the
+/// targets to load from the first of them. If StepLocks is not null, the
+/// backing containers of each step are inspected while holding its lock.
 static Error getObjectives(Runner &Runner,
                            llvm::StringRef EndingStepName,
                            const ContainerToTargetsMap &Targets,
                            ContainerToTargetsMap &ToLoad,
-                           std::vector<PipelineExecutionEntry> &ToExec) {
+                           std::vector<PipelineExecutionEntry> &ToExec,
+                           StepLocksMap *StepLocks = nullptr) {
   ContainerToTargetsMap PartialGoals = Targets;
   auto *CurrentStep = &(Runner[EndingStepName]);
   while (CurrentStep != nullptr) {
     if (PartialGoals.empty())
       break;
 
-    PartialGoals = CurrentStep->analyzeGoals(PartialGoals, ToLoad);
-    ToExec.emplace_back(*CurrentStep, PartialGoals);
+    ContainerToTargetsMap Available;
+    ContainerToTargetsMap Requirements;
+    {
+      auto Lock = lockStep(StepLocks, *CurrentStep);
+      Requirements = CurrentStep->analyzeGoals(PartialGoals, Available);
+    }
+    ToLoad.merge(Available);
+    ToExec.emplace_back(*CurrentStep,
+                        Requirements,
+                        std::move(PartialGoals),
+                        std::move(Available));
+    PartialGoals = std::move(Requirements);
     CurrentStep = CurrentStep->hasPredecessor() ?
                     &CurrentStep->getPredecessor() :
                     nullptr;
@@ -51,6 +98,264 @@ static Error getObjectives(Runner &Runner,
 
 using StatusMap = llvm::StringMap<ContainerToTargetsMap>;
 
+namespace {
+
+/// A portion of a run request whose targets, on their way to the ending step,
+/// are only ever touched by pipes operating on Containers.
+class RequestPartition {
+public:
+  ContainerToTargetsMap Targets;
+  llvm::StringSet<> Containers;
+  ContainerToTargetsMap ToLoad;
+  std::vector<PipelineExecutionEntry> ToExec;
+};
+
+/// The output of a step, to be merged back in the containers of the step
+/// once all the partitions of a request are done.
+class DeferredMerge {
+public:
+  Step *Target = nullptr;
+  ContainerSet Produced;
+  ContainerToTargetsMap Input;
+  ContainerToTargetsMap Output;
+};
+
+/// A slice of the targets of a streamed request (see
+/// Runner::setStreamingBatchSize), going through the steps on its own.
+class StreamingBatch {
+public:
+  ContainerToTargetsMap Targets;
+  ContainerToTargetsMap ToLoad;
+  std::vector<PipelineExecutionEntry> ToExec;
+  /// The position of the first step of ToExec among all the steps
+  size_t FirstStep = 0;
+  /// What the batch produced in the last step it executed
+  ContainerSet Current;
+  bool Failed = false;
+  std::string Log;
+};
+
+} // namespace
+
+/// Groups the containers of the steps leading to EndingStepName so that two
+/// containers are in the same group if a pipe operates on both of them, and
+/// splits Targets according to such groups.
+static std::vector<RequestPartition>
+partitionRequest(Runner &Runner,
+                 llvm::StringRef EndingStepName,
+                 const ContainerToTargetsMap &Targets) {
+  llvm::EquivalenceClasses<std::string> Classes;
+  auto *CurrentStep = &(Runner[EndingStepName]);
+  while (CurrentStep != nullptr) {
+    for (const auto &Container : std::as_const(*CurrentStep).containers())
+      Classes.insert(Container.first().str());
+
+    for (const auto &Pipe : CurrentStep->pipes()) {
+      auto Names = Pipe->getRunningContainersNames();
+
+      // Pipes running on no container do not tie any containers together
+      if (Names.empty())
+        continue;
+
+      Classes.insert(Names.front());
+      for (const auto &Name : llvm::drop_begin(Names))
+        Classes.unionSets(Names.front(), Name);
+    }
+
+    CurrentStep = CurrentStep->hasPredecessor() ?
+                    &CurrentStep->getPredecessor() :
+                    nullptr;
+  }
+
+  // Use an ordered map so that partitions are always built in the same order
+  std::map<std::string, RequestPartition> ByLeader;
+  for (const auto &Entry : Targets) {
+    if (Entry.second.empty())
+      continue;
+
+    std::string Name = Entry.first().str();
+    Classes.insert(Name);
+    auto &Partition = ByLeader[Classes.getLeaderValue(Name)];
+    Partition.Targets[Entry.first()] = Entry.second;
+  }
+
+  std::vector<RequestPartition> Result;
+  for (auto &[Leader, Partition] : ByLeader) {
+    auto LeaderIt = Classes.findValue(Leader);
+    for (auto It = Classes.member_begin(LeaderIt); It != Classes.member_end();
+         ++It)
+      Partition.Containers.insert(*It);
+    Result.push_back(std::move(Partition));
+  }
+
+  return Result;
+}
+
+/// Executes the step of Entry on CurrentContainer, which holds the targets
+/// produced by its predecessor, and replaces it with the targets the step
+/// produced. The parameters have the same meaning as in executeObjectives.
+static Error executeStep(Context &Ctx,
+                         const PipelineExecutionEntry &Entry,
+                         ContainerSet &CurrentContainer,
+                         const llvm::StringSet<> *OnlyContainers,
+                         StepLocksMap *StepLocks,
+                         std::vector<DeferredMerge> *Deferred,
+                         ArtifactCache *Cache,
+                         RemoteScheduler *Remote,
+                         Profiler *Prof,
+                         RunEventLog *Events,
+                         llvm::raw_ostream *DiagnosticLog) {
+  Step &ToExecute = *Entry.ToExecute;
+  auto Enumeration = CurrentContainer.enumerate();
+
+  uint64_t Start = 0;
+  StepEvent Event;
+  if (Events != nullptr) {
+    Start = Events->now();
+    Event.Step = ToExecute.getName().str();
+    Event.Requested = Entry.Requested;
+    Event.Available = Entry.Available;
+    Event.SizesBefore = RunEventLog::computeSizes(CurrentContainer);
+  }
+
+  std::string Key;
+  bool Cached = false;
+  if (Cache != nullptr) {
+    auto MaybeKey = ArtifactCache::computeKey(Ctx,
+                                              ToExecute,
+                                              CurrentContainer);
+    if (not MaybeKey)
+      return MaybeKey.takeError();
+    Key = std::move(*MaybeKey);
+
+    auto MaybeLoaded = Cache->load(Key, Ctx, CurrentContainer);
+    if (not MaybeLoaded)
+      return MaybeLoaded.takeError();
+    Cached = *MaybeLoaded;
+  }
+
+  if (Cached) {
+    if (DiagnosticLog != nullptr)
+      *DiagnosticLog << "\nLoaded Step: " << ToExecute.getName()
+                     << " from cache entry " << Key << "\n";
+  } else {
+    bool RanRemotely = false;
+    if (Remote != nullptr) {
+      auto Error = Remote->run(Ctx,
+                               ToExecute,
+                               CurrentContainer,
+                               OnlyContainers);
+      RanRemotely = not Error;
+      if (Error and DiagnosticLog != nullptr)
+        *DiagnosticLog << "\nRunning Step: " << ToExecute.getName()
+                       << " locally: " << toString(std::move(Error)) << "\n";
+      else
+        consumeError(std::move(Error));
+    }
+
+    if (not RanRemotely)
+      ToExecute.runPipes(Ctx,
+                         CurrentContainer,
+                         OnlyContainers,
+                         DiagnosticLog,
+                         Prof);
+    if (Cache != nullptr)
+      if (auto Error = Cache->store(Key, Ctx, CurrentContainer); Error)
+        return Error;
+  }
+
+  auto Produced = ToExecute.deduceResults(Enumeration);
+
+  if (Events != nullptr) {
+    Event.Produced = Produced;
+    Event.SizesAfter = RunEventLog::computeSizes(CurrentContainer);
+    Event.Cached = Cached;
+    Event.WallMicroseconds = Events->now() - Start;
+    Events->recordStep(Event, Start);
+  }
+
+  if (Deferred != nullptr) {
+    auto Next = CurrentContainer.cloneFiltered(Produced, OnlyContainers);
+    auto NextEnumeration = Next.enumerate();
+    Deferred->push_back({ &ToExecute,
+                          std::move(CurrentContainer),
+                          std::move(Enumeration),
+                          std::move(NextEnumeration) });
+    CurrentContainer = std::move(Next);
+    return Error::success();
+  }
+
+  auto Lock = lockStep(StepLocks, ToExecute);
+  auto Merged = ToExecute.mergeAndCloneFiltered(std::move(CurrentContainer),
+                                                Produced,
+                                                OnlyContainers);
+  ToExecute.recordDependencies(Enumeration, Merged.enumerate());
+  CurrentContainer = std::move(Merged);
+  return Error::success();
+}
+
+/// Executes the steps in ToExec, starting from the ToLoad targets of the first
+/// one. If OnlyContainers is not null, only the pipes and containers in such
+/// set are considered. If StepLocks is not null, every access to the backing
+/// containers of a step is guarded by the lock associated to that step. If
+/// Deferred is not null, the outputs of the steps are appended to it rather
+/// than being merged back in the containers of the steps. If
+/// Cache is not null, the output of each step is looked up in it before
+/// running the pipes, and stored in it otherwise. If Remote is not null, the
+/// pipes are run on its workers, falling back to running them locally. If
+/// Prof is not null, every pipe invocation is recorded in it. If Progress is
+/// not empty, it's invoked before each step. If Events is not null, each
+/// executed step is described in it.
+static Error executeObjectives(Context &Ctx,
+                               const ContainerToTargetsMap &ToLoad,
+                               ArrayRef<PipelineExecutionEntry> ToExec,
+                               const llvm::StringSet<> *OnlyContainers,
+                               StepLocksMap *StepLocks,
+                               std::vector<DeferredMerge> *Deferred,
+                               ArtifactCache *Cache,
+                               RemoteScheduler *Remote,
+                               Profiler *Prof,
+                               RunEventLog *Events,
+                               const Runner::ProgressHook &Progress,
+                               llvm::raw_ostream *DiagnosticLog) {
+  auto &FirstStep = *ToExec.front().ToExecute;
+  ContainerSet CurrentContainer;
+  {
+    auto Lock = lockStep(StepLocks, FirstStep);
+    CurrentContainer = FirstStep.cloneFiltered(ToLoad, OnlyContainers);
+  }
+
+  size_t StepsCount = ToExec.size() - 1;
+  for (const auto &Indexed : llvm::enumerate(ToExec.drop_front())) {
+    Step &ToExecute = *Indexed.value().ToExecute;
+    if (Progress and not Progress(ToExecute.getName(),
+                                  Indexed.index(),
+                                  StepsCount))
+      return make_error<CancelledRunError>(ToExecute.getName());
+
+    if (auto Error = executeStep(Ctx,
+                                 Indexed.value(),
+                                 CurrentContainer,
+                                 OnlyContainers,
+                                 StepLocks,
+                                 Deferred,
+                                 Cache,
+                                 Remote,
+                                 Prof,
+                                 Events,
+                                 DiagnosticLog);
+        Error)
+      return Error;
+  }
+
+  if (DiagnosticLog != nullptr) {
+    *DiagnosticLog << "Produced:\n";
+    CurrentContainer.enumerate().dump(*DiagnosticLog);
+  }
+
+  return Error::success();
+}
+
 static void explainPipeline(const ContainerToTargetsMap &Targets,
                             const ContainerToTargetsMap &ToLoad,
                             ArrayRef<PipelineExecutionEntry> Requirements,
@@ -94,6 +399,17 @@ Error Runner::getInvalidations(StatusMap &Invalidated) const {
 
     ContainerToTargetsMap &Outputs = Invalidated[NextS.getName()];
 
+    if (Inputs.empty())
+      continue;
+
+    // Prefer the dependencies recorded while the pipes were running, which do
+    // not require to enumerate the containers of the step
+    auto MaybeDependents = NextS.dependentsOf(Inputs);
+    if (MaybeDependents) {
+      Outputs.merge(*MaybeDependents);
+      continue;
+    }
+
     auto Deduced = NextS.deduceResults(Inputs);
     NextS.containers().intersect(Deduced);
     Outputs.merge(Deduced);
@@ -184,15 +500,450 @@ Error Runner::storeToDisk(llvm::StringRef DirPath) const {
 Error Runner::loadFromDisk(llvm::StringRef DirPath) {
   if (auto Error = TheContext->loadFromDisk(DirPath); !!Error)
     return Error;
+
+  // Containers are independent from each other, load all of them at once
+  std::vector<ContainerSet::LoadRequest> Requests;
   for (auto &Step : Steps)
-    if (auto Error = Step.second.loadFromDisk(DirPath); !!Error)
+    for (ContainerSet::LoadRequest &Request :
+         Step.second.prepareLoadFromDisk(DirPath))
+      Requests.push_back(std::move(Request));
+
+  return ContainerSet::load(Requests, Jobs);
+}
+
+/// \return true if the steps of Partition use a container sharing the
+///         llvm::LLVMContext with other containers
+static bool sharesLLVMContext(const RequestPartition &Partition) {
+  for (const PipelineExecutionEntry &Entry : Partition.ToExec) {
+    const ContainerSet &Containers = std::as_const(*Entry.ToExecute)
+                                       .containers();
+    for (const auto &Name : Partition.Containers.keys())
+      if (Containers.containsOrCanCreate(Name)
+          and Containers.sharesLLVMContext(Name))
+        return true;
+  }
+
+  return false;
+}
+
+/// Executes each partition of a request concurrently, on the threads of the
+/// TaskScheduler. The partitions using containers that share the
+/// llvm::LLVMContext run one at the time, holding ContextLock.
+static Error runPartitions(Runner &Runner,
+                           Context &Ctx,
+                           llvm::StringRef EndingStepName,
+                           std::vector<RequestPartition> &Partitions,
+                           llvm::raw_ostream *DiagnosticLog) {
+  // Objectives are computed upfront since they inspect the backing containers
+  for (RequestPartition &Partition : Partitions) {
+    if (auto Error = getObjectives(Runner,
+                                   EndingStepName,
+                                   Partition.Targets,
+                                   Partition.ToLoad,
+                                   Partition.ToExec);
+        Error)
       return Error;
-  return Error::success();
+  }
+
+  StepLocksMap StepLocks;
+  for (const Step &Step : Runner)
+    StepLocks.try_emplace(Step.getName());
+
+  // Each partition logs in its own buffer, buffers are printed in order at the
+  // end so that the output does not depend on the scheduling
+  std::vector<std::string> Logs(Partitions.size());
+  std::vector<std::vector<DeferredMerge>> Merges(Partitions.size());
+  bool Deterministic = Runner.hasDeterministicMerge();
+  std::mutex ContextLock;
+  std::mutex ErrorLock;
+  Error Result = Error::success();
+  {
+    TaskGroup Group;
+    for (size_t I = 0; I < Partitions.size(); I++) {
+      const RequestPartition &Partition = Partitions[I];
+      if (Partition.ToExec.size() <= 1)
+        continue;
+
+      std::string &Log = Logs[I];
+      auto *Deferred = Deterministic ? &Merges[I] : nullptr;
+      bool SharesContext = sharesLLVMContext(Partition);
+      const auto Execute = [&, Deferred, DiagnosticLog, SharesContext]() {
+        std::unique_lock<std::mutex> ContextGuard(ContextLock,
+                                                  std::defer_lock);
+        if (SharesContext)
+          ContextGuard.lock();
+
+        llvm::raw_string_ostream OS(Log);
+        // The cache is not used here, since loading an entry overwrites the
+        // globals shared by all the partitions
+        auto Error = executeObjectives(Ctx,
+                                       Partition.ToLoad,
+                                       Partition.ToExec,
+                                       &Partition.Containers,
+                                       &StepLocks,
+                                       Deferred,
+                                       nullptr,
+                                       Runner.getRemoteScheduler(),
+                                       Runner.getProfiler(),
+                                       Runner.getEventLog(),
+                                       Runner.getProgressHook(),
+                                       DiagnosticLog != nullptr ? &OS :
+                                                                  nullptr);
+        OS.flush();
+        if (ContextGuard.owns_lock())
+          ContextGuard.unlock();
+
+        std::lock_guard<std::mutex> Guard(ErrorLock);
+        Result = joinErrors(std::move(Result), std::move(Error));
+      };
+      Group.spawn(Execute);
+    }
+    Group.wait();
+  }
+
+  // Merge in the order of the partitions, rather than in the order they
+  // completed, so that the content of the containers does not depend on the
+  // scheduling
+  for (std::vector<DeferredMerge> &PartitionMerges : Merges) {
+    for (DeferredMerge &Merge : PartitionMerges) {
+      Merge.Target->mergeBack(std::move(Merge.Produced));
+      Merge.Target->recordDependencies(Merge.Input, Merge.Output);
+    }
+  }
+
+  if (DiagnosticLog != nullptr) {
+    for (size_t I = 0; I < Partitions.size(); I++) {
+      const RequestPartition &Partition = Partitions[I];
+      explainPipeline(Partition.Targets,
+                      Partition.ToLoad,
+                      Partition.ToExec,
+                      *DiagnosticLog);
+      *DiagnosticLog << Logs[I];
+    }
+  }
+
+  return Result;
+}
+
+/// \return true if Available holds all the targets in Requested
+static bool containsAll(const ContainerToTargetsMap &Available,
+                        const ContainerToTargetsMap &Requested) {
+  for (const auto &Entry : Requested) {
+    if (Entry.second.empty())
+      continue;
+
+    auto It = Available.find(Entry.first());
+    if (It == Available.end() or not It->second.contains(Entry.second))
+      return false;
+  }
+
+  return true;
+}
+
+/// \return true if running the pipes of ToExecute on Containers uses a
+///         container sharing the llvm::LLVMContext with other containers. The
+///         containers the pipes run on are created, if missing.
+static bool sharesLLVMContext(const Step &ToExecute, ContainerSet &Containers) {
+  for (const auto &Pipe : ToExecute.pipes())
+    for (const std::string &Name : Pipe->getRunningContainersNames())
+      if (Containers.containsOrCanCreate(Name))
+        Containers[Name];
+
+  for (const auto &Entry : Containers.entriesWithoutLoading())
+    if (Entry.second != nullptr and Entry.second->sharesLLVMContext())
+      return true;
+
+  return false;
+}
+
+/// Splits Targets in batches of at most BatchSize targets, preserving their
+/// order.
+static std::vector<StreamingBatch>
+splitInBatches(const ContainerToTargetsMap &Targets, size_t BatchSize) {
+  revng_assert(BatchSize != 0);
+
+  // Iterate over the containers in a deterministic order
+  std::vector<llvm::StringRef> Containers;
+  for (const auto &Entry : Targets)
+    Containers.push_back(Entry.first());
+  llvm::sort(Containers);
+
+  std::vector<StreamingBatch> Result;
+  size_t InLastBatch = BatchSize;
+  for (llvm::StringRef Container : Containers) {
+    for (const Target &Target : Targets.at(Container)) {
+      if (InLastBatch == BatchSize) {
+        Result.emplace_back();
+        InLastBatch = 0;
+      }
+
+      Result.back().Targets.add(Container, Target);
+      ++InLastBatch;
+    }
+  }
+
+  return Result;
+}
+
+/// Moves Batch through the step at position Index of Chain. The batch plans
+/// its steps at position 0, and loads its targets at its first step.
+///
+/// Everything but running the pipes is done while holding ContextLock, which
+/// is held while running the pipes too, if they use containers sharing the
+/// llvm::LLVMContext: this way no two batches use such context at once.
+static Error advanceBatch(Runner &Runner,
+                          Context &Ctx,
+                          llvm::StringRef EndingStepName,
+                          ArrayRef<Step *> Chain,
+                          StepLocksMap &StepLocks,
+                          std::mutex &ContextLock,
+                          StreamingBatch &Batch,
+                          size_t Index,
+                          llvm::raw_ostream *DiagnosticLog) {
+  std::unique_lock<std::mutex> ContextGuard(ContextLock);
+
+  if (Index == 0) {
+    if (auto Error = getObjectives(Runner,
+                                   EndingStepName,
+                                   Batch.Targets,
+                                   Batch.ToLoad,
+                                   Batch.ToExec,
+                                   &StepLocks);
+        Error)
+      return Error;
+
+    if (not Batch.ToExec.empty()) {
+      auto *It = llvm::find(Chain, Batch.ToExec.front().ToExecute);
+      revng_assert(It != Chain.end());
+      Batch.FirstStep = It - Chain.begin();
+    }
+  }
+
+  if (Batch.ToExec.size() <= 1 or Index < Batch.FirstStep)
+    return Error::success();
+
+  if (Index == Batch.FirstStep) {
+    Step &FirstStep = *Chain[Index];
+    auto Lock = lockStep(&StepLocks, FirstStep);
+    Batch.Current = FirstStep.cloneFiltered(Batch.ToLoad);
+    return Error::success();
+  }
+
+  const PipelineExecutionEntry &Entry = Batch.ToExec[Index - Batch.FirstStep];
+  Step &ToExecute = *Entry.ToExecute;
+  const auto &Progress = Runner.getProgressHook();
+  if (Progress and not Progress(ToExecute.getName(),
+                                Index - Batch.FirstStep - 1,
+                                Batch.ToExec.size() - 1))
+    return make_error<CancelledRunError>(ToExecute.getName());
+
+  // The previous batches might have produced the goals of this batch too
+  {
+    auto Lock = lockStep(&StepLocks, ToExecute);
+    ContainerToTargetsMap Available;
+    ToExecute.analyzeGoals(Entry.Requested, Available);
+    if (containsAll(Available, Entry.Requested)) {
+      if (DiagnosticLog != nullptr)
+        *DiagnosticLog << "\nSkipped Step: " << ToExecute.getName()
+                       << ", produced by a previous batch\n";
+      Batch.Current = ToExecute.cloneFiltered(Entry.Requested);
+      return Error::success();
+    }
+  }
+
+  if (not sharesLLVMContext(ToExecute, Batch.Current))
+    ContextGuard.unlock();
+
+  return executeStep(Ctx,
+                     Entry,
+                     Batch.Current,
+                     nullptr,
+                     &StepLocks,
+                     nullptr,
+                     nullptr,
+                     Runner.getRemoteScheduler(),
+                     Runner.getProfiler(),
+                     Runner.getEventLog(),
+                     DiagnosticLog);
+}
+
+/// Streams the batches through the steps leading to EndingStepName, on the
+/// threads of the TaskScheduler. Batch K runs the step at position I once
+/// it's done with position I - 1 and batch K - 1 is done with position I.
+static Error runStreaming(Runner &Runner,
+                          Context &Ctx,
+                          llvm::StringRef EndingStepName,
+                          std::vector<StreamingBatch> &Batches,
+                          llvm::raw_ostream *DiagnosticLog) {
+  std::vector<Step *> Chain;
+  for (Step *Current = &Runner[EndingStepName]; Current != nullptr;
+       Current = Current->hasPredecessor() ? &Current->getPredecessor() :
+                                             nullptr)
+    Chain.push_back(Current);
+  std::reverse(Chain.begin(), Chain.end());
+
+  StepLocksMap StepLocks;
+  for (const Step &Step : Runner)
+    StepLocks.try_emplace(Step.getName());
+
+  // How many of its dependencies each (batch, step) is still waiting for
+  size_t StepsCount = Chain.size();
+  std::vector<std::atomic<unsigned>> Waiting(Batches.size() * StepsCount);
+  for (size_t K = 0; K < Batches.size(); ++K)
+    for (size_t I = 0; I < StepsCount; ++I)
+      Waiting[K * StepsCount + I] = (K != 0) + (I != 0);
+
+  std::atomic<bool> Stop = false;
+  std::mutex ContextLock;
+  std::mutex ErrorLock;
+  Error Result = Error::success();
+  {
+    TaskGroup Group;
+    std::function<void(size_t, size_t)> Spawn;
+    const auto Execute = [&](size_t K, size_t I) {
+      StreamingBatch &Batch = Batches[K];
+      if (not Stop and not Batch.Failed) {
+        llvm::raw_string_ostream OS(Batch.Log);
+        auto Error = advanceBatch(Runner,
+                                  Ctx,
+                                  EndingStepName,
+                                  Chain,
+                                  StepLocks,
+                                  ContextLock,
+                                  Batch,
+                                  I,
+                                  DiagnosticLog != nullptr ? &OS : nullptr);
+        OS.flush();
+        if (Error) {
+          Batch.Failed = true;
+          if (Error.isA<CancelledRunError>())
+            Stop = true;
+
+          std::lock_guard<std::mutex> Guard(ErrorLock);
+          Result = joinErrors(std::move(Result), std::move(Error));
+        }
+      }
+
+      // Batches following a failed one still run, and they don't wait for it.
+      // The next batch is spawned first, so that it can start planning while
+      // this one goes on.
+      if (K + 1 < Batches.size() and --Waiting[(K + 1) * StepsCount + I] == 0)
+        Spawn(K + 1, I);
+      if (I + 1 < StepsCount and --Waiting[K * StepsCount + I + 1] == 0)
+        Spawn(K, I + 1);
+    };
+    Spawn = [&](size_t K, size_t I) {
+      Group.spawn([&Execute, K, I]() { Execute(K, I); });
+    };
+
+    Spawn(0, 0);
+    Group.wait();
+  }
+
+  if (DiagnosticLog != nullptr) {
+    for (const StreamingBatch &Batch : Batches) {
+      explainPipeline(Batch.Targets,
+                      Batch.ToLoad,
+                      Batch.ToExec,
+                      *DiagnosticLog);
+      *DiagnosticLog << Batch.Log;
+    }
+  }
+
+  return Result;
 }
 
 Error Runner::run(llvm::StringRef EndingStepName,
                   const ContainerToTargetsMap &Targets,
                   llvm::raw_ostream *DiagnosticLog) {
+  ContainerToTargetsMap Available;
+  uint64_t Start = Events != nullptr ? Events->now() : 0;
+  auto Error = runImpl(EndingStepName, Targets, DiagnosticLog, Available);
+  if (Events != nullptr)
+    Events->recordRequest(EndingStepName,
+                          Targets,
+                          Available,
+                          Start,
+                          Events->now() - Start,
+                          not Error);
+
+  if (Error or ResidentStepsLimit == 0)
+    return Error;
+
+  return enforceResidentStepsLimit(EndingStepName);
+}
+
+Error Runner::enforceResidentStepsLimit(llvm::StringRef EndingStepName) {
+  // The ending step is the most recently used one, then its predecessors
+  llvm::SmallVector<const Step *, 8> Used;
+  for (const Step *Current = &operator[](EndingStepName); Current != nullptr;
+       Current = Current->hasPredecessor() ? &Current->getPredecessor() :
+                                             nullptr)
+    Used.push_back(Current);
+  for (const Step *Current : llvm::reverse(Used))
+    LastUse[Current->getName()] = ++UseClock;
+
+  llvm::SmallVector<Step *, 8> Resident;
+  for (Step &Step : *this)
+    if (Step.containers().hasResidentContainers())
+      Resident.push_back(&Step);
+
+  if (Resident.size() <= ResidentStepsLimit)
+    return Error::success();
+
+  // Steps never used by a run come first, then from the least recently used
+  llvm::stable_sort(Resident, [this](const Step *LHS, const Step *RHS) {
+    return LastUse.lookup(LHS->getName()) < LastUse.lookup(RHS->getName());
+  });
+
+  size_t ToEvict = Resident.size() - ResidentStepsLimit;
+  for (Step *Step : llvm::make_range(Resident.begin(),
+                                     Resident.begin() + ToEvict))
+    if (auto Error = Step->evict(EvictionDirectory))
+      return Error;
+
+  return Error::success();
+}
+
+Error Runner::runImpl(llvm::StringRef EndingStepName,
+                      const ContainerToTargetsMap &Targets,
+                      llvm::raw_ostream *DiagnosticLog,
+                      ContainerToTargetsMap &Available) {
+  if (StreamingBatchSize != 0) {
+    auto Batches = splitInBatches(Targets, StreamingBatchSize);
+    if (Batches.size() > 1) {
+      auto Result = runStreaming(*this,
+                                 *TheContext,
+                                 EndingStepName,
+                                 Batches,
+                                 DiagnosticLog);
+      if (Result)
+        return Result;
+
+      for (const StreamingBatch &Batch : Batches)
+        if (not Batch.ToExec.empty())
+          Available.merge(Batch.ToExec.back().Available);
+      return Error::success();
+    }
+  }
+
+  if (Jobs > 1) {
+    auto Partitions = partitionRequest(*this, EndingStepName, Targets);
+    if (Partitions.size() > 1) {
+      auto Result = runPartitions(*this,
+                                  *TheContext,
+                                  EndingStepName,
+                                  Partitions,
+                                  DiagnosticLog);
+      if (Result)
+        return Result;
+
+      for (const RequestPartition &Partition : Partitions)
+        if (not Partition.ToExec.empty())
+          Available.merge(Partition.ToExec.back().Available);
+      return Error::success();
+    }
+  }
 
   ContainerToTargetsMap ToLoad;
   vector<PipelineExecutionEntry> ToExec;
@@ -202,28 +953,28 @@ Error Runner::run(llvm::StringRef EndingStepName,
       Error)
     return Error;
 
+  if (not ToExec.empty())
+    Available = ToExec.back().Available;
+
   if (DiagnosticLog != nullptr)
     explainPipeline(Targets, ToLoad, ToExec, *DiagnosticLog);
 
   if (ToExec.size() <= 1)
     return Error::success();
 
-  auto &FirstStepContainers = ToExec.front().ToExecute->containers();
-  auto CurrentContainer(FirstStepContainers.cloneFiltered(ToLoad));
-  for (auto &StepGoalsPairs :
-       llvm::make_range(ToExec.begin() + 1, ToExec.end())) {
-    auto &[Step, Goals] = StepGoalsPairs;
-    CurrentContainer = Step->cloneAndRun(*TheContext,
-                                         std::move(CurrentContainer),
-                                         DiagnosticLog);
-  }
-
-  if (DiagnosticLog != nullptr) {
-    *DiagnosticLog << "Produced:\n";
-    CurrentContainer.enumerate().dump(*DiagnosticLog);
-  }
-
-  return Error::success();
+  auto *CacheToUse = Cache.has_value() ? &*Cache : nullptr;
+  return executeObjectives(*TheContext,
+                           ToLoad,
+                           ToExec,
+                           nullptr,
+                           nullptr,
+                           nullptr,
+                           CacheToUse,
+                           Remote,
+                           TheProfiler,
+                           Events,
+                           Progress,
+                           DiagnosticLog);
 }
 
 Error Runner::invalidate(const StatusMap &Invalidations) {
@@ -0,0 +1,280 @@
+/// \file ShardedLLVMContainer.cpp
+/// \brief A sharded llvm container keeps each function associated to a target
+/// in a module and context of its own.
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <deque>
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Linker/Linker.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
+
+#include "revng/Pipeline/ShardedLLVMContainer.h"
+#include "revng/Support/Debug.h"
+#include "revng/Support/TaskScheduler.h"
+
+using namespace llvm;
+using namespace pipeline;
+using pipeline::detail::LLVMShard;
+
+char pipeline::ShardedLLVMContainerTypeID = '0';
+
+template<>
+const char pipeline::ShardedLLVMContainer::ID = '0';
+
+cl::opt<unsigned> pipeline::LLVMShardJobs("llvm-shard-jobs",
+                                          cl::desc("number of threads used to "
+                                                   "process the shards of a "
+                                                   "sharded llvm container"),
+                                          cl::init(1));
+
+LLVMShard LLVMShard::fromModule(const llvm::Module &Source) {
+  SmallString<0> Buffer;
+  raw_svector_ostream OS(Buffer);
+  WriteBitcodeToFile(Source, OS);
+
+  auto NewContext = std::make_unique<LLVMContext>();
+  MemoryBufferRef Ref(Buffer, Source.getModuleIdentifier());
+  auto MaybeModule = parseBitcodeFile(Ref, *NewContext);
+  revng_assert(MaybeModule);
+
+  (*MaybeModule)->setModuleIdentifier(Source.getModuleIdentifier());
+  return LLVMShard(std::move(NewContext), std::move(*MaybeModule));
+}
+
+namespace {
+
+/// Creates on demand, in the shard being built, a declaration for each global
+/// referenced by the cloned code. Functions are recorded so that their
+/// metadata, and for untracked functions their body, can be cloned as well.
+class DeclarationMaterializer final : public ValueMaterializer {
+private:
+  Module &Destination;
+  function_ref<bool(const Function &)> IsUntracked;
+  std::deque<std::pair<const Function *, Function *>> &ToClone;
+
+public:
+  DeclarationMaterializer(Module &Destination,
+                          function_ref<bool(const Function &)> IsUntracked,
+                          std::deque<std::pair<const Function *, Function *>>
+                            &ToClone) :
+    Destination(Destination), IsUntracked(IsUntracked), ToClone(ToClone) {}
+
+  Value *materialize(Value *V) final {
+    auto *Global = dyn_cast<GlobalValue>(V);
+    if (Global == nullptr)
+      return nullptr;
+
+    if (auto *F = dyn_cast<Function>(Global)) {
+      auto *NewF = Function::Create(F->getFunctionType(),
+                                    GlobalValue::ExternalLinkage,
+                                    F->getAddressSpace(),
+                                    F->getName(),
+                                    &Destination);
+      NewF->copyAttributesFrom(F);
+
+      if (not F->isDeclaration() and IsUntracked(*F)) {
+        NewF->setLinkage(F->getLinkage());
+        NewF->setVisibility(F->getVisibility());
+      } else {
+        NewF->setPersonalityFn(nullptr);
+      }
+      ToClone.emplace_back(F, NewF);
+
+      return NewF;
+    }
+
+    auto *Variable = dyn_cast<GlobalVariable>(Global);
+    revng_assert(Variable != nullptr, "Unexpected global kind in a shard");
+    auto *NewVariable = new GlobalVariable(Destination,
+                                           Variable->getValueType(),
+                                           Variable->isConstant(),
+                                           GlobalValue::ExternalLinkage,
+                                           nullptr,
+                                           Variable->getName(),
+                                           nullptr,
+                                           Variable->getThreadLocalMode(),
+                                           Variable->getAddressSpace());
+    NewVariable->copyAttributesFrom(Variable);
+    NewVariable->setLinkage(GlobalValue::ExternalLinkage);
+    NewVariable->setVisibility(GlobalValue::DefaultVisibility);
+    return NewVariable;
+  }
+};
+
+} // namespace
+
+static void cloneMetadata(const Function &From,
+                          Function &To,
+                          ValueToValueMapTy &Map,
+                          ValueMaterializer &Materializer) {
+  SmallVector<std::pair<unsigned, MDNode *>, 4> Metadata;
+  From.getAllMetadata(Metadata);
+  for (auto &[Kind, Node] : Metadata) {
+    // Declarations cannot carry debug info and profiling metadata
+    bool IsDebugOrProfile = Kind == LLVMContext::MD_dbg
+                            or Kind == LLVMContext::MD_prof;
+    if (To.isDeclaration() and IsDebugOrProfile)
+      continue;
+
+    auto *Mapped = MapMetadata(Node, Map, RF_None, nullptr, &Materializer);
+    To.addMetadata(Kind, *Mapped);
+  }
+}
+
+static void cloneBody(const Function &From,
+                      Function &To,
+                      ValueToValueMapTy &Map,
+                      ValueMaterializer &Materializer) {
+  auto ToArgument = To.arg_begin();
+  for (const Argument &Argument : From.args()) {
+    ToArgument->setName(Argument.getName());
+    Map[&Argument] = &*ToArgument;
+    ++ToArgument;
+  }
+
+  for (const BasicBlock &BB : From)
+    Map[&BB] = CloneBasicBlock(&BB, Map, "", &To);
+
+  for (BasicBlock &BB : To)
+    for (Instruction &I : BB)
+      RemapInstruction(&I, Map, RF_None, nullptr, &Materializer);
+
+  if (From.hasPersonalityFn()) {
+    auto *Personality = From.getPersonalityFn();
+    To.setPersonalityFn(MapValue(Personality,
+                                 Map,
+                                 RF_None,
+                                 nullptr,
+                                 &Materializer));
+  }
+}
+
+using FunctionPredicate = function_ref<bool(const Function &)>;
+
+std::unique_ptr<Module>
+pipeline::detail::extractShard(const Function &Owner,
+                               FunctionPredicate IsUntracked) {
+  const Module &Source = *Owner.getParent();
+  auto Result = std::make_unique<Module>(Owner.getName(), Source.getContext());
+  Result->setSourceFileName(Owner.getName());
+  Result->setDataLayout(Source.getDataLayout());
+  Result->setTargetTriple(Source.getTargetTriple());
+
+  std::deque<std::pair<const Function *, Function *>> ToClone;
+  DeclarationMaterializer Materializer(*Result, IsUntracked, ToClone);
+
+  // Clone the owner first, so that it's materialized with its own linkage
+  auto *NewOwner = Function::Create(Owner.getFunctionType(),
+                                    Owner.getLinkage(),
+                                    Owner.getAddressSpace(),
+                                    Owner.getName(),
+                                    Result.get());
+  NewOwner->copyAttributesFrom(&Owner);
+
+  ValueToValueMapTy Map;
+  Map[&Owner] = NewOwner;
+  ToClone.emplace_back(&Owner, NewOwner);
+
+  while (not ToClone.empty()) {
+    auto [From, To] = ToClone.front();
+    ToClone.pop_front();
+    bool HasBody = not From->isDeclaration();
+    if (HasBody and (From == &Owner or IsUntracked(*From)))
+      cloneBody(*From, *To, Map, Materializer);
+    cloneMetadata(*From, *To, Map, Materializer);
+  }
+
+  revng_assert(verifyModule(*Result, &dbgs()) == 0);
+  return Result;
+}
+
+void pipeline::detail::writeShards(ArrayRef<const Module *> Shards,
+                                   raw_ostream &OS) {
+  SmallString<0> Buffer;
+  {
+    BitcodeWriter Writer(Buffer);
+    for (const Module *Shard : Shards)
+      Writer.writeModule(*Shard);
+    Writer.writeSymtab();
+    Writer.writeStrtab();
+  }
+  OS << Buffer;
+}
+
+Expected<std::vector<LLVMShard>>
+pipeline::detail::readShards(const MemoryBuffer &Buffer) {
+  std::vector<LLVMShard> Result;
+
+  // An empty buffer is an empty container
+  if (Buffer.getBufferSize() == 0)
+    return Result;
+
+  auto MaybeModules = getBitcodeModuleList(Buffer.getMemBufferRef());
+  if (not MaybeModules)
+    return MaybeModules.takeError();
+
+  for (BitcodeModule &Bitcode : *MaybeModules) {
+    auto NewContext = std::make_unique<LLVMContext>();
+    auto MaybeModule = Bitcode.parseModule(*NewContext);
+    if (not MaybeModule)
+      return MaybeModule.takeError();
+
+    auto &M = **MaybeModule;
+    M.setModuleIdentifier(M.getSourceFileName());
+    Result.emplace_back(std::move(NewContext), std::move(*MaybeModule));
+  }
+
+  return Result;
+}
+
+std::unique_ptr<Module>
+pipeline::detail::linkShards(ArrayRef<const Module *> Shards,
+                             LLVMContext &Context) {
+  auto Composite = std::make_unique<Module>("revng.module", Context);
+  Linker TheLinker(*Composite);
+
+  for (const Module *Shard : Shards) {
+    SmallString<0> Buffer;
+    raw_svector_ostream OS(Buffer);
+    WriteBitcodeToFile(*Shard, OS);
+
+    MemoryBufferRef Ref(Buffer, Shard->getModuleIdentifier());
+    auto MaybeModule = parseBitcodeFile(Ref, Context);
+    revng_assert(MaybeModule);
+
+    bool Failure = TheLinker.linkInModule(std::move(*MaybeModule),
+                                          Linker::OverrideFromSrc);
+    revng_assert(not Failure, "Linker failed");
+  }
+
+  revng_assert(verifyModule(*Composite, &dbgs()) == 0);
+  return Composite;
+}
+
+void pipeline::detail::forEachShard(ArrayRef<Module *> Shards,
+                                    function_ref<void(size_t, Module &)>
+                                      Callback,
+                                    unsigned Jobs) {
+  if (Jobs <= 1 or Shards.size() <= 1) {
+    for (size_t I = 0; I < Shards.size(); I++)
+      Callback(I, *Shards[I]);
+    return;
+  }
+
+  // Each shard has its own context, keep the tasks working on it together
+  TaskGroup Group;
+  for (size_t I = 0; I < Shards.size(); I++)
+    Group.spawn([&Callback, &Shards, I]() { Callback(I, *Shards[I]); },
+                &Shards[I]->getContext());
+  Group.wait();
+}
@@ -7,6 +7,13 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Path.h"
@@ -14,6 +21,7 @@
 #include "revng/Pipeline/ContainerSet.h"
 #include "revng/Pipeline/Step.h"
 #include "revng/Support/Debug.h"
+#include "revng/Support/ProfilingRegion.h"
 
 using namespace llvm;
 using namespace std;
@@ -34,6 +42,10 @@ Step::analyzeGoals(const ContainerToTargetsMap &RequiredGoals,
   ContainerToTargetsMap Targets = RequiredGoals;
   removeSatisfiedGoals(Targets, AlreadyAviable);
   for (const auto &Pipe : llvm::make_range(Pipes.rbegin(), Pipes.rend())) {
+    // Nothing left to produce, no need to ask the remaining pipes
+    if (Targets.empty())
+      break;
+
     Targets = Pipe->getRequirements(Targets);
   }
 
@@ -91,19 +103,117 @@ void Step::explainExecutedPipe(const Context &Ctx,
 ContainerSet
 Step::cloneAndRun(Context &Ctx, ContainerSet &&Input, llvm::raw_ostream *OS) {
   auto InputEnumeration = Input.enumerate();
-  explainStartStep(InputEnumeration, OS);
+  runPipes(Ctx, Input, nullptr, OS);
+  auto Produced = deduceResults(InputEnumeration);
+  auto Result = mergeAndCloneFiltered(std::move(Input), Produced);
+  recordDependencies(InputEnumeration, Result.enumerate());
+  return Result;
+}
+
+static size_t countTargets(const ContainerToTargetsMap &Status,
+                           const PipeWrapper &Pipe) {
+  size_t Result = 0;
+  llvm::StringSet<> Visited;
+  for (const std::string &Name : Pipe->getRunningContainersNames()) {
+    // The same container can be passed to many arguments of a pipe
+    if (not Visited.insert(Name).second)
+      continue;
+
+    auto It = Status.find(Name);
+    if (It != Status.end())
+      Result += It->second.size();
+  }
+  return Result;
+}
+
+void Step::runPipes(Context &Ctx,
+                    ContainerSet &Input,
+                    const llvm::StringSet<> *OnlyContainers,
+                    llvm::raw_ostream *OS,
+                    Profiler *Prof) {
+  const auto IsSelected = [OnlyContainers](const PipeWrapper &Pipe) {
+    if (OnlyContainers == nullptr)
+      return true;
+
+    return llvm::all_of(Pipe->getRunningContainersNames(),
+                        [OnlyContainers](const std::string &Name) {
+                          return OnlyContainers->count(Name) != 0;
+                        });
+  };
+
+  if (OS != nullptr)
+    explainStartStep(Input.enumerate(), OS);
 
   for (auto &Pipe : Pipes) {
-    if (not Pipe->areRequirementsMet(Input.enumerate()))
+    if (not IsSelected(Pipe))
+      continue;
+
+    auto Enumeration = Input.enumerate();
+    if (not Pipe->areRequirementsMet(Enumeration))
       continue;
 
     explainExecutedPipe(Ctx, Pipe, OS);
-    Pipe->run(Ctx, Input);
+
+    std::optional<Profiler::Measurement> Measurement;
+    if (Prof != nullptr)
+      Measurement.emplace(*Prof,
+                          Name,
+                          Pipe->getName(),
+                          countTargets(Enumeration, Pipe));
+
+    {
+      ProfilingRegion Region(Pipe->getName());
+      Pipe->run(Ctx, Input);
+    }
     llvm::cantFail(Input.verify());
+
+    if (Measurement)
+      Measurement->done(countTargets(Input.enumerate(), Pipe));
+  }
+}
+
+ContainerSet
+Step::mergeAndCloneFiltered(ContainerSet &&Input,
+                            const ContainerToTargetsMap &Produced,
+                            const llvm::StringSet<> *OnlyContainers) {
+  // The Produced targets come from Input: cloning them from there, as the
+  // deferred merges do, preserves the content IDs of its containers
+  auto Result = Input.cloneFiltered(Produced, OnlyContainers);
+  mergeBack(std::move(Input));
+  return Result;
+}
+
+void Step::mergeBack(ContainerSet &&Input) {
+  changeContainers([&] { Containers.mergeBack(std::move(Input)); });
+}
+
+bool Step::isIndexUpToDate() const {
+  for (const auto &Entry : Containers.entriesWithoutLoading()) {
+    const ContainerBase *Container = Entry.second.get();
+    auto It = IndexedContainers.find(Entry.first());
+
+    // A container created in the meantime is still empty, unless it has been
+    // changed
+    if (It == IndexedContainers.end() or It->second.first == nullptr) {
+      if (Container != nullptr and Container->version() != 0)
+        return false;
+      continue;
+    }
+
+    if (It->second != ContainerState(Container, Container->version()))
+      return false;
+  }
+
+  return true;
+}
+
+void Step::snapshotContainers() {
+  IndexedContainers.clear();
+  for (const auto &Entry : Containers.entriesWithoutLoading()) {
+    const ContainerBase *Container = Entry.second.get();
+    uint64_t Version = Container != nullptr ? Container->version() : 0;
+    IndexedContainers[Entry.first()] = ContainerState(Container, Version);
   }
-  Containers.mergeBack(std::move(Input));
-  InputEnumeration = deduceResults(InputEnumeration);
-  return Containers.cloneFiltered(InputEnumeration);
 }
 
 void Step::removeSatisfiedGoals(TargetsList &RequiredInputs,
@@ -134,14 +244,193 @@ void Step::removeSatisfiedGoals(ContainerToTargetsMap &Targets,
   }
 }
 
+/// Builds a string identifying the targets in \p Status, ignoring the
+/// containers without targets
+static std::string computeDeductionKey(const ContainerToTargetsMap &Status) {
+  std::vector<llvm::StringRef> Names;
+  for (const auto &Entry : Status)
+    if (not Entry.second.empty())
+      Names.push_back(Entry.first());
+  llvm::sort(Names);
+
+  std::string Key;
+  for (llvm::StringRef Name : Names) {
+    Key += Name;
+    Key += '\n';
+
+    // Targets lists are sorted, no need to sort them again
+    for (const Target &T : Status.at(Name)) {
+      Key += T.getKind().name();
+      Key += T.kindExactness() == Exactness::Exact ? ":" : "~";
+      for (const PathComponent &Component : T.getPathComponents()) {
+        Key += Component.toString();
+        Key += '/';
+      }
+      Key += '\n';
+    }
+    Key += '\n';
+  }
+  return Key;
+}
+
 ContainerToTargetsMap Step::deduceResults(ContainerToTargetsMap Input) const {
+  // Enough for the single target queries of recordDependencies, which are
+  // the most frequent ones
+  constexpr size_t MaxDeductions = 4096;
+
+  std::string Key = computeDeductionKey(Input);
+  {
+    std::lock_guard<std::mutex> Guard(Deductions->Lock);
+    auto It = Deductions->Entries.find(Key);
+    if (It != Deductions->Entries.end())
+      return It->second;
+  }
+
   for (const auto &Pipe : Pipes)
     Input = Pipe->deduceResults(Input);
+
+  std::lock_guard<std::mutex> Guard(Deductions->Lock);
+  if (Deductions->Entries.size() >= MaxDeductions)
+    Deductions->Entries.clear();
+  Deductions->Entries.try_emplace(std::move(Key), Input);
   return Input;
 }
 
+namespace {
+
+/// The targets available in a step, indexed so that the ones overlapping a
+/// certain target can be found without comparing it against all of them
+class AvailableTargets {
+private:
+  using Location = InvalidationIndex::Location;
+  using ShapeKey = std::pair<std::string, size_t>;
+  using ComponentsKey = std::pair<std::string, std::vector<std::string>>;
+
+private:
+  std::set<Location> Exact;
+  /// Targets with no `*` components, which might still differ in kind
+  std::map<ComponentsKey, std::vector<const Location *>> ByComponents;
+  /// Targets with `*` components, by container and number of components
+  std::map<ShapeKey, std::vector<const Location *>> Wildcards;
+  /// All the targets, by container and number of components
+  std::map<ShapeKey, std::vector<const Location *>> ByShape;
+
+public:
+  explicit AvailableTargets(const ContainerToTargetsMap &Targets) {
+    for (const auto &Container : Targets) {
+      for (const Target &ToAdd : Container.second) {
+        auto [It, New] = Exact.emplace(Container.first().str(), ToAdd);
+        if (not New)
+          continue;
+
+        const Location *Added = &*It;
+        ByShape[shapeOf(*Added)].push_back(Added);
+        if (hasWildcards(ToAdd))
+          Wildcards[shapeOf(*Added)].push_back(Added);
+        else
+          ByComponents[componentsOf(*Added)].push_back(Added);
+      }
+    }
+  }
+
+public:
+  /// Invokes \p Callback on each available target overlapping \p ToMatch
+  template<typename CallbackType>
+  void forEachOverlapping(const Location &ToMatch,
+                          CallbackType &&Callback) const {
+    if (Exact.count(ToMatch) != 0) {
+      Callback(ToMatch);
+      return;
+    }
+
+    // The deduced target and the available ones might be expressed with a
+    // different granularity
+    if (hasWildcards(ToMatch.second)) {
+      visitOverlapping(ByShape, shapeOf(ToMatch), ToMatch, Callback);
+    } else {
+      visitOverlapping(ByComponents, componentsOf(ToMatch), ToMatch, Callback);
+      visitOverlapping(Wildcards, shapeOf(ToMatch), ToMatch, Callback);
+    }
+  }
+
+private:
+  template<typename MapType, typename CallbackType>
+  static void visitOverlapping(const MapType &Map,
+                               const typename MapType::key_type &Key,
+                               const Location &ToMatch,
+                               CallbackType &Callback) {
+    auto It = Map.find(Key);
+    if (It == Map.end())
+      return;
+
+    for (const Location *Candidate : It->second)
+      if (InvalidationIndex::overlaps(*Candidate, ToMatch))
+        Callback(*Candidate);
+  }
+
+  static bool hasWildcards(const Target &ToCheck) {
+    return llvm::any_of(ToCheck.getPathComponents(),
+                        [](const PathComponent &Component) {
+                          return Component.isAll();
+                        });
+  }
+
+  static ShapeKey shapeOf(const Location &Where) {
+    return { Where.first, Where.second.getPathComponents().size() };
+  }
+
+  static ComponentsKey componentsOf(const Location &Where) {
+    ComponentsKey Result;
+    Result.first = Where.first;
+    for (const PathComponent &Component : Where.second.getPathComponents())
+      Result.second.push_back(Component.getName());
+    return Result;
+  }
+};
+
+} // namespace
+
+void Step::recordDependencies(const ContainerToTargetsMap &Input,
+                              const ContainerToTargetsMap &Produced) {
+  if (not Index.isComplete())
+    return;
+
+  AvailableTargets Available(Produced);
+
+  // Deduce what each input target contributes to on its own
+  for (const auto &Container : Input) {
+    for (const Target &Source : Container.second) {
+      ContainerToTargetsMap Single;
+      Single.add(Container.first(), Source);
+
+      InvalidationIndex::Location From(Container.first().str(), Source);
+      const auto Record = [this, &From](const auto &To) {
+        Index.record(From, To);
+      };
+
+      for (const auto &Deduced : deduceResults(std::move(Single))) {
+        for (const Target &Dependent : Deduced.second) {
+          InvalidationIndex::Location To(Deduced.first().str(), Dependent);
+          Available.forEachOverlapping(To, Record);
+        }
+      }
+    }
+  }
+}
+
+std::optional<ContainerToTargetsMap>
+Step::dependentsOf(const ContainerToTargetsMap &Invalidated) const {
+  if (not isIndexUpToDate())
+    return std::nullopt;
+
+  return Index.dependentsOf(Invalidated);
+}
+
 Error Step::invalidate(const ContainerToTargetsMap &ToRemove) {
-  return containers().remove(ToRemove);
+  return changeContainers([&] {
+    Index.forget(ToRemove);
+    return Containers.remove(ToRemove);
+  });
 }
 
 Error Step::storeToDisk(llvm::StringRef DirPath) const {
@@ -152,9 +441,27 @@ Error Step::storeToDisk(llvm::StringRef DirPath) const {
                              Path.c_str());
   return Containers.storeToDisk(Path);
 }
+
+Error Step::evict(llvm::StringRef DirPath) {
+  auto Path = DirPath.str() + "/" + Name;
+  if (auto ErrorCode = llvm::sys::fs::create_directories(Path); ErrorCode)
+    return createStringError(ErrorCode,
+                             "Could not create dir %s",
+                             Path.c_str());
+  return Containers.evict(Path);
+}
+
 Error Step::loadFromDisk(llvm::StringRef DirPath) {
+  return ContainerSet::load(prepareLoadFromDisk(DirPath), 1);
+}
+
+std::vector<ContainerSet::LoadRequest>
+Step::prepareLoadFromDisk(llvm::StringRef DirPath) {
   auto Path = DirPath.str() + "/" + Name;
   if (not llvm::sys::fs::exists(Path))
-    return llvm::Error::success();
-  return Containers.loadFromDisk(Path);
+    return {};
+
+  // Nothing is known about how the loaded targets have been produced
+  Index.markIncomplete();
+  return Containers.prepareLoadFromDisk(Path);
 }
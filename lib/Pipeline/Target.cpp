@@ -6,9 +6,14 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <optional>
+
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/GlobPattern.h"
 
 #include "revng/Pipeline/Container.h"
+#include "revng/Pipeline/ContainerSet.h"
 #include "revng/Pipeline/Kind.h"
 #include "revng/Pipeline/KindsRegistry.h"
 #include "revng/Pipeline/Target.h"
@@ -133,17 +138,16 @@ pipeline::parseTarget(llvm::StringRef AsString, const KindsRegistry &Dict) {
   llvm::SmallVector<llvm::StringRef, 4> Path;
   Parts[0].split(Path, '/');
 
-  auto It = llvm::find_if(Dict,
-                          [&Parts](Kind &K) { return Parts[1] == K.name(); });
-  if (It == Dict.end())
+  const Kind *K = Dict.find(Parts[1]);
+  if (K == nullptr)
     return llvm::createStringError(llvm::inconvertibleErrorCode(),
                                    "No known Kind %s in dictionary",
                                    Parts[1].str().c_str());
 
   if (AsString[0] == ':')
-    return Target({}, *It);
+    return Target({}, *K);
 
-  return Target(std::move(Path), *It);
+  return Target(std::move(Path), *K);
 }
 
 llvm::Error pipeline::parseTarget(ContainerToTargetsMap &CurrentStatus,
@@ -167,6 +171,89 @@ llvm::Error pipeline::parseTarget(ContainerToTargetsMap &CurrentStatus,
   return llvm::Error::success();
 }
 
+static bool isGlob(const PathComponent &Component) {
+  if (not Component.isSingle())
+    return false;
+  return StringRef(Component.getName()).find_first_of("*?[") != StringRef::npos;
+}
+
+llvm::Error pipeline::parseTargets(ContainerToTargetsMap &CurrentStatus,
+                                   llvm::ArrayRef<std::string> AsStrings,
+                                   const KindsRegistry &Dict,
+                                   const ContainerSet &Containers) {
+  llvm::StringMap<TargetsList::List> Parsed;
+  std::optional<ContainerToTargetsMap> Available;
+
+  for (const std::string &AsString : AsStrings) {
+    llvm::SmallVector<llvm::StringRef, 2> Parts;
+    StringRef(AsString).split(Parts, ':', 1);
+
+    if (Parts.size() != 2) {
+      auto *Message = "string %s was not in expected form "
+                      "<ContainerName:Target>";
+      return llvm::createStringError(llvm::inconvertibleErrorCode(),
+                                     Message,
+                                     AsString.c_str());
+    }
+
+    auto MaybeTarget = parseTarget(Parts[1], Dict);
+    if (not MaybeTarget)
+      return MaybeTarget.takeError();
+
+    TargetsList::List &Targets = Parsed[Parts[0]];
+    const PathComponents &Components = MaybeTarget->getPathComponents();
+    if (llvm::none_of(Components, isGlob)) {
+      Targets.push_back(std::move(*MaybeTarget));
+      continue;
+    }
+
+    // Match the pattern against what's in the container. A `*` component has
+    // no pattern: it matches any component.
+    llvm::SmallVector<std::optional<llvm::GlobPattern>, 2> Patterns;
+    for (const PathComponent &Component : Components) {
+      if (Component.isAll()) {
+        Patterns.push_back(std::nullopt);
+        continue;
+      }
+
+      auto MaybePattern = llvm::GlobPattern::create(Component.getName());
+      if (not MaybePattern)
+        return MaybePattern.takeError();
+      Patterns.push_back(std::move(*MaybePattern));
+    }
+
+    if (not Available)
+      Available = Containers.enumerate();
+
+    auto It = Available->find(Parts[0]);
+    if (It == Available->end())
+      continue;
+
+    for (const Target &Candidate : It->second) {
+      if (&Candidate.getKind() != &MaybeTarget->getKind())
+        continue;
+
+      const PathComponents &CandidateComponents = Candidate
+                                                    .getPathComponents();
+      bool Matches = true;
+      for (size_t I = 0; I < Patterns.size() and Matches; ++I) {
+        const PathComponent &Component = CandidateComponents[I];
+        Matches = not Patterns[I].has_value()
+                  or (Component.isSingle()
+                      and Patterns[I]->match(Component.getName()));
+      }
+
+      if (Matches)
+        Targets.push_back(Candidate);
+    }
+  }
+
+  for (auto &Entry : Parsed)
+    CurrentStatus[Entry.first()].merge(TargetsList(std::move(Entry.second)));
+
+  return llvm::Error::success();
+}
+
 void pipeline::prettyPrintTarget(const Target &Target,
                                  llvm::raw_ostream &OS,
                                  size_t Indentation) {
@@ -0,0 +1,85 @@
+/// \file TargetsBitmap.cpp
+/// \brief A targets bitmap is a compact representation of a set of targets.
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include "revng/Pipeline/TargetsBitmap.h"
+
+using namespace pipeline;
+
+TargetsUniverse::TargetsUniverse(std::vector<Target> Targets) :
+  Targets(std::move(Targets)) {
+  Indexes.reserve(this->Targets.size());
+  for (size_t I = 0; I < this->Targets.size(); ++I) {
+    const Target &T = this->Targets[I];
+    revng_assert(isExact(T));
+    bool New = Indexes.try_emplace(T, I).second;
+    revng_assert(New);
+  }
+}
+
+std::optional<size_t> TargetsUniverse::indexOf(const Target &T) const {
+  if (not isExact(T))
+    return std::nullopt;
+
+  auto It = Indexes.find(T);
+  if (It == Indexes.end())
+    return std::nullopt;
+  return It->second;
+}
+
+bool TargetsBitmap::insert(const Target &T) {
+  auto Index = Universe->indexOf(T);
+  if (not Index)
+    return false;
+
+  Bits.set(*Index);
+  return true;
+}
+
+void TargetsBitmap::insert(const TargetsList &Targets) {
+  bool Scan = false;
+  for (const Target &T : Targets)
+    if (auto Index = Universe->indexOf(T))
+      Bits.set(*Index);
+    else
+      Scan = Scan or not TargetsUniverse::isExact(T);
+
+  // Targets with `*` components or requiring a derived kind can be satisfied
+  // by many targets of the universe
+  if (not Scan)
+    return;
+
+  for (size_t I = 0; I < Universe->size(); ++I)
+    if (not Bits.test(I) and Targets.contains((*Universe)[I]))
+      Bits.set(I);
+}
+
+bool TargetsBitmap::contains(const Target &T) const {
+  // Targets in the universe have no `*` components, hence they satisfy only
+  // targets without `*` components
+  if (not llvm::all_of(T.getPathComponents(), [](const PathComponent &C) {
+        return C.isSingle();
+      }))
+    return false;
+
+  if (T.kindExactness() == Exactness::Exact) {
+    auto Index = Universe->indexOf(T);
+    return Index and Bits.test(*Index);
+  }
+
+  for (unsigned Index : Bits.set_bits())
+    if ((*Universe)[Index].satisfies(T))
+      return true;
+  return false;
+}
+
+TargetsList TargetsBitmap::toList() const {
+  TargetsList::List Result;
+  Result.reserve(Bits.count());
+  for (unsigned Index : Bits.set_bits())
+    Result.push_back((*Universe)[Index]);
+  return TargetsList(std::move(Result));
+}
@@ -1,11 +1,20 @@
 //
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <condition_variable>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "llvm/ADT/STLExtras.h"
@@ -16,6 +25,7 @@
 
 #include "revng/Pipeline/AllRegistries.h"
 #include "revng/Pipeline/Container.h"
+#include "revng/Pipeline/Errors.h"
 #include "revng/Pipeline/Runner.h"
 #include "revng/Pipeline/Target.h"
 #include "revng/PipelineC/PipelineC.h"
@@ -23,6 +33,8 @@
 #include "revng/Pipes/ModelInvalidationEvent.h"
 #include "revng/Pipes/PipelineManager.h"
 #include "revng/Support/Assert.h"
+#include "revng/Support/Statistics.h"
+#include "revng/Support/TaskScheduler.h"
 #include "revng/TupleTree/TupleTreeDiff.h"
 
 using namespace pipeline;
@@ -41,6 +53,157 @@ static char *copyString(llvm::StringRef str) {
   return ToReturn;
 }
 
+/// Serialize the part of Container containing Targets, loading it back if it
+/// has been evicted
+static llvm::Expected<std::string>
+serializeFiltered(rp_container &Container, const TargetsList &Targets) {
+  if (auto Error = Container.second->loadBack(); Error)
+    return std::move(Error);
+
+  std::string Out;
+  llvm::raw_string_ostream Serialized(Out);
+  const auto &Cloned = Container.second->cloneFiltered(Targets);
+  llvm::cantFail(Cloned->serialize(Serialized));
+  Serialized.flush();
+  return Out;
+}
+
+//
+// Synchronization
+//
+// Only one operation at a time can modify the managers, since the runner is not
+// reentrant. Short operations (e.g., applying a model diff) also keep the
+// queries out. Long ones, i.e., producing targets, directly or through a job,
+// instead publish a Snapshot of what the queries need before starting: queries
+// issued in the meantime are answered from it, without waiting. Queries the
+// snapshot cannot answer (e.g., serializing a container) wait for the
+// operation to complete.
+//
+// Container objects are never destroyed, eviction only releases their content,
+// and their names never change: the queries about them that do not look at
+// their content need no synchronization. Loading back an evicted container
+// instead is a modification.
+//
+
+namespace {
+
+/// \brief What the queries observed right before a long operation started
+struct Snapshot {
+  const rp_manager *Manager = nullptr;
+
+  /// The targets held by each container of Manager, including the evicted
+  /// ones and the ones that have not been created yet
+  std::map<const rp_container *, TargetsList> Ready;
+
+  ModelGlobal::Snapshot Model;
+
+  bool owns(const rp_container *Container) const {
+    return Ready.count(Container) != 0;
+  }
+};
+
+} // namespace
+
+/// Held by the operations modifying the managers
+static std::mutex WritersLock;
+
+/// Held exclusively by the short operations modifying the managers and to
+/// publish or retire the Snapshot, shared by the queries
+static std::shared_mutex StateLock;
+
+/// Notified when the Snapshot is retired
+static std::condition_variable_any SnapshotRetired;
+
+/// The state of the managers during a long operation, protected by StateLock
+static std::unique_ptr<const Snapshot> Published;
+
+/// Protects the targets lists of the managers, which are expanded lazily
+static std::mutex ExpansionLock;
+
+namespace {
+
+/// \brief Exclusive access for the operations modifying a manager quickly
+class ModifyAccess {
+private:
+  std::lock_guard<std::mutex> Writers;
+  std::unique_lock<std::shared_mutex> State;
+
+public:
+  ModifyAccess() : Writers(WritersLock), State(StateLock) {}
+};
+
+/// \brief Access for the operations modifying \p Manager for a long time,
+///        during which the queries are answered from a Snapshot
+class BackgroundAccess {
+private:
+  std::lock_guard<std::mutex> Writers;
+
+public:
+  BackgroundAccess(rp_manager &Manager) : Writers(WritersLock) {
+    // Nothing else is modifying Manager: it can be inspected concurrently with
+    // the running queries
+    auto Captured = std::make_unique<Snapshot>();
+    Captured->Manager = &Manager;
+    Captured->Model = getModelSnapshotFromContext(Manager.context());
+
+    {
+      // Expand the targets lists now, expanding them later would require the
+      // model
+      std::lock_guard<std::mutex> Guard(ExpansionLock);
+      for (const Step &TheStep : Manager.getRunner()) {
+        const ContainerSet &Containers = TheStep.containers();
+        for (const rp_container &Container :
+             Containers.entriesWithoutLoading()) {
+          Manager.getTargetsAvailableFor(Container);
+          auto &Ready = Captured->Ready[&Container];
+          if (Container.second != nullptr)
+            Ready = Container.second->enumerateWithoutLoading();
+        }
+      }
+    }
+
+    std::lock_guard<std::shared_mutex> Guard(StateLock);
+    Published = std::move(Captured);
+  }
+
+  ~BackgroundAccess() {
+    {
+      std::lock_guard<std::shared_mutex> Guard(StateLock);
+      Published.reset();
+    }
+    SnapshotRetired.notify_all();
+  }
+};
+
+/// \brief Shared access for the queries
+class ReadAccess {
+private:
+  std::shared_lock<std::shared_mutex> State;
+
+public:
+  ReadAccess() : State(StateLock) {}
+
+  /// \return the Snapshot, if a long operation is modifying a manager
+  const Snapshot *snapshot() const { return Published.get(); }
+
+  /// Wait for the long operation to complete, if it's modifying the manager
+  /// owning \p Container
+  void waitFor(const rp_container *Container) {
+    SnapshotRetired.wait(State, [Container] {
+      return Published == nullptr or not Published->owns(Container);
+    });
+  }
+
+  /// Wait for the long operation to complete, if it's modifying \p Manager
+  void waitFor(const rp_manager *Manager) {
+    SnapshotRetired.wait(State, [Manager] {
+      return Published == nullptr or Published->Manager != Manager;
+    });
+  }
+};
+
+} // namespace
+
 static bool Initialized = false;
 
 static bool loadLibraryPermanently(const char *LibraryPath) {
@@ -141,6 +304,8 @@ rp_manager *rp_manager_create_memory_only(const char *pipeline_path,
 bool rp_manager_store_containers(rp_manager *manager) {
   revng_check(manager != nullptr);
 
+  // Storing might load back evicted containers
+  ModifyAccess Access;
   auto Error = manager->storeToDisk();
   if (not Error)
     return true;
@@ -186,12 +351,22 @@ rp_container *
 rp_step_get_container(rp_step *step, rp_container_identifier *container) {
   revng_check(step != nullptr);
   revng_check(container != nullptr);
-  step->containers()[container->first()];
-  auto Iter = step->containers().find(container->first());
-  if (Iter == step->containers().end())
+  ContainerSet &Containers = step->containers();
+  auto Iter = Containers.findWithoutLoading(container->first());
+  if (Iter == Containers.end())
     return nullptr;
 
-  return &*Iter;
+  rp_container *Result = &*Iter;
+  {
+    ReadAccess Access;
+    Access.waitFor(Result);
+    if (Result->second != nullptr)
+      return Result;
+  }
+
+  ModifyAccess Access;
+  Containers[container->first()];
+  return Result;
 }
 
 uint64_t rp_targets_list_targets_count(rp_targets_list *targets_list) {
@@ -227,20 +402,166 @@ const char *rp_manager_produce_targets(rp_manager *manager,
   for (size_t I = 0; I < targets_count; I++)
     Targets[container->second->name()].push_back(*targets[I]);
 
+  BackgroundAccess Access(*manager);
   auto Error = manager->getRunner().run(step->getName(), Targets);
   if (Error) {
     llvm::consumeError(std::move(Error));
     return nullptr;
   }
 
-  std::string Out;
-  llvm::raw_string_ostream Serialized(Out);
-  const auto &ToFilter = Targets[container->second->name()];
-  const auto &Cloned = container->second->cloneFiltered(ToFilter);
-  llvm::cantFail(Cloned->serialize(Serialized));
-  Serialized.flush();
+  auto MaybeSerialized = serializeFiltered(*container,
+                                           Targets[container->second->name()]);
+  if (not MaybeSerialized) {
+    llvm::consumeError(MaybeSerialized.takeError());
+    return nullptr;
+  }
 
-  return copyString(Out);
+  return copyString(*MaybeSerialized);
+}
+
+struct rp_job {
+public:
+  rp_manager *Manager;
+  std::string StepName;
+  ContainerToTargetsMap Targets;
+  llvm::StringMap<rp_container *> Containers;
+  rp_progress_callback Callback;
+  void *UserData;
+
+  std::atomic<bool> CancelRequested = false;
+
+  /// Protects Status and Results
+  std::mutex Lock;
+  std::condition_variable Completed;
+  rp_job_status Status = RP_JOB_RUNNING;
+  llvm::StringMap<std::string> Results;
+
+  std::thread Worker;
+
+public:
+  void run();
+};
+
+void rp_job::run() {
+  BackgroundAccess Access(*Manager);
+
+  rp_job_status FinalStatus = RP_JOB_SUCCEEDED;
+  llvm::StringMap<std::string> Produced;
+  if (CancelRequested) {
+    FinalStatus = RP_JOB_CANCELLED;
+  } else {
+    Runner &TheRunner = Manager->getRunner();
+    std::mutex CallbackLock;
+    TheRunner.setProgressHook([this, &CallbackLock](llvm::StringRef Step,
+                                                    size_t Index,
+                                                    size_t Count) {
+      if (Callback != nullptr) {
+        std::lock_guard<std::mutex> Guard(CallbackLock);
+        if (not Callback(Step.str().c_str(), Index, Count, UserData))
+          CancelRequested = true;
+      }
+      return not CancelRequested;
+    });
+    auto Error = TheRunner.run(StepName, Targets);
+    TheRunner.setProgressHook({});
+
+    if (Error) {
+      bool Cancelled = Error.isA<CancelledRunError>();
+      FinalStatus = Cancelled ? RP_JOB_CANCELLED : RP_JOB_FAILED;
+      llvm::consumeError(std::move(Error));
+    } else {
+      for (const auto &Entry : Containers) {
+        auto MaybeSerialized = serializeFiltered(*Entry.second,
+                                                 Targets[Entry.first()]);
+        if (not MaybeSerialized) {
+          llvm::consumeError(MaybeSerialized.takeError());
+          FinalStatus = RP_JOB_FAILED;
+          break;
+        }
+        Produced[Entry.first()] = std::move(*MaybeSerialized);
+      }
+    }
+  }
+
+  std::lock_guard<std::mutex> Guard(Lock);
+  Results = std::move(Produced);
+  Status = FinalStatus;
+  Completed.notify_all();
+}
+
+void rp_set_threads_count(uint64_t count) {
+  revng_check(count <= UINT_MAX);
+  ModifyAccess Access;
+  TaskScheduler::setGlobalThreadsCount(count);
+}
+
+rp_job *rp_manager_submit_job(rp_manager *manager,
+                              rp_step *step,
+                              uint64_t targets_count,
+                              rp_target *targets[],
+                              rp_container *containers[],
+                              rp_progress_callback callback,
+                              void *user_data) {
+  revng_check(manager != nullptr);
+  revng_check(step != nullptr);
+  revng_check(targets_count != 0);
+  revng_check(targets != nullptr);
+  revng_check(containers != nullptr);
+
+  auto *Job = new rp_job();
+  Job->Manager = manager;
+  Job->StepName = step->getName().str();
+  Job->Callback = callback;
+  Job->UserData = user_data;
+  for (size_t I = 0; I < targets_count; I++) {
+    revng_check(targets[I] != nullptr);
+    revng_check(containers[I] != nullptr);
+    llvm::StringRef Name = containers[I]->second->name();
+    Job->Targets[Name].push_back(*targets[I]);
+    Job->Containers[Name] = containers[I];
+  }
+
+  Job->Worker = std::thread([Job] { Job->run(); });
+  return Job;
+}
+
+rp_job_status rp_job_poll(rp_job *job) {
+  revng_check(job != nullptr);
+  std::lock_guard<std::mutex> Guard(job->Lock);
+  return job->Status;
+}
+
+rp_job_status rp_job_wait(rp_job *job) {
+  revng_check(job != nullptr);
+  std::unique_lock<std::mutex> Guard(job->Lock);
+  job->Completed.wait(Guard, [job] { return job->Status != RP_JOB_RUNNING; });
+  return job->Status;
+}
+
+void rp_job_cancel(rp_job *job) {
+  revng_check(job != nullptr);
+  job->CancelRequested = true;
+}
+
+char *rp_job_create_serialized_container(rp_job *job, rp_container *container) {
+  revng_check(job != nullptr);
+  revng_check(container != nullptr);
+  std::lock_guard<std::mutex> Guard(job->Lock);
+  if (job->Status != RP_JOB_SUCCEEDED)
+    return nullptr;
+
+  auto It = job->Results.find(container->second->name());
+  if (It == job->Results.end())
+    return nullptr;
+
+  return copyString(It->second);
+}
+
+void rp_job_destroy(rp_job *job) {
+  revng_check(job != nullptr);
+  rp_job_cancel(job);
+  job->Worker.join();
+  delete job;
 }
 
 rp_target *rp_target_create(rp_kind *kind,
@@ -270,7 +591,12 @@ void rp_target_destroy(rp_target *target) {
 bool rp_container_store(rp_container *container, const char *path) {
   revng_check(container != nullptr);
   revng_check(path != nullptr);
-  auto Error = container->second->storeToDisk(path);
+
+  // Storing an evicted container loads it back
+  ModifyAccess Access;
+  auto Error = container->second->loadBack();
+  if (not Error)
+    Error = container->second->storeToDisk(path);
   if (not Error)
     return true;
 
@@ -281,6 +607,7 @@ bool rp_container_store(rp_container *container, const char *path) {
 bool rp_container_load(rp_container *container, const char *path) {
   revng_check(container != nullptr);
   revng_check(path != nullptr);
+  ModifyAccess Access;
   auto Error = container->second->loadFromDisk(path);
   if (not Error)
     return true;
@@ -289,6 +616,101 @@ bool rp_container_load(rp_container *container, const char *path) {
   return false;
 }
 
+/// Serialize into Out the whole Container, which must not be evicted, if
+/// TargetsCount is 0, or the part of it containing Targets
+static bool serializeLoadedInto(const ContainerBase &Container,
+                                uint64_t TargetsCount,
+                                rp_target *Targets[],
+                                rp_buffer &Out) {
+  std::unique_ptr<ContainerBase> Filtered;
+  if (TargetsCount != 0) {
+    TargetsList ToFilter;
+    for (size_t I = 0; I < TargetsCount; I++)
+      ToFilter.push_back(*Targets[I]);
+    Filtered = Container.cloneFiltered(ToFilter);
+  }
+
+  llvm::raw_svector_ostream OS(Out);
+  const ContainerBase &ToSerialize = Filtered ? *Filtered : Container;
+  auto Error = ToSerialize.serialize(OS);
+  if (not Error)
+    return true;
+
+  llvm::consumeError(std::move(Error));
+  return false;
+}
+
+/// Serialize into Out the whole Container, if TargetsCount is 0, or the part of
+/// it containing Targets, loading it back if it has been evicted
+static bool serializeInto(rp_container *Container,
+                          uint64_t TargetsCount,
+                          rp_target *Targets[],
+                          rp_buffer &Out) {
+  revng_check(Container != nullptr);
+  if (TargetsCount != 0)
+    revng_check(Targets != nullptr);
+
+  {
+    ReadAccess Access;
+    Access.waitFor(Container);
+    const ContainerBase &ToSerialize = *Container->second;
+    if (not ToSerialize.isEvicted())
+      return serializeLoadedInto(ToSerialize, TargetsCount, Targets, Out);
+  }
+
+  ModifyAccess Access;
+  if (auto Error = Container->second->loadBack(); Error) {
+    llvm::consumeError(std::move(Error));
+    return false;
+  }
+
+  return serializeLoadedInto(*Container->second, TargetsCount, Targets, Out);
+}
+
+rp_buffer *rp_container_create_buffer(rp_container *container,
+                                      uint64_t targets_count,
+                                      rp_target *targets[]) {
+  auto *Buffer = new rp_buffer();
+  if (serializeInto(container, targets_count, targets, *Buffer))
+    return Buffer;
+
+  delete Buffer;
+  return nullptr;
+}
+
+uint64_t rp_container_serialize(rp_container *container,
+                                uint64_t targets_count,
+                                rp_target *targets[],
+                                char *buffer,
+                                uint64_t buffer_size) {
+  if (buffer_size != 0)
+    revng_check(buffer != nullptr);
+
+  rp_buffer Serialized;
+  if (not serializeInto(container, targets_count, targets, Serialized))
+    return RP_SERIALIZATION_FAILED;
+
+  if (Serialized.size() <= buffer_size)
+    memcpy(buffer, Serialized.data(), Serialized.size());
+
+  return Serialized.size();
+}
+
+const char *rp_buffer_data(rp_buffer *buffer) {
+  revng_check(buffer != nullptr);
+  return buffer->data();
+}
+
+uint64_t rp_buffer_size(rp_buffer *buffer) {
+  revng_check(buffer != nullptr);
+  return buffer->size();
+}
+
+void rp_buffer_destroy(rp_buffer *buffer) {
+  revng_check(buffer != nullptr);
+  delete buffer;
+}
+
 rp_kind *rp_target_get_kind(rp_target *target) {
   revng_check(target != nullptr);
   return &target->getKind();
@@ -331,6 +753,7 @@ char *rp_manager_create_container_path(rp_manager *manager,
 
 void rp_manager_recompute_all_available_targets(rp_manager *manager) {
   revng_check(manager != nullptr);
+  ModifyAccess Access;
   manager->recalculateAllPossibleTargets();
 }
 
@@ -340,6 +763,9 @@ rp_manager_get_container_targets_list(rp_manager *manager,
   revng_check(manager != nullptr);
   revng_check(container != nullptr);
 
+  // During a long operation, all the lists have already been expanded
+  ReadAccess Access;
+  std::lock_guard<std::mutex> Guard(ExpansionLock);
   return manager->getTargetsAvailableFor(*container);
 }
 
@@ -355,6 +781,14 @@ void rp_string_destroy(char *string) {
   free(string);
 }
 
+char *rp_statistics_create_dump(void) {
+  std::string Out;
+  llvm::raw_string_ostream Serialized(Out);
+  OnQuitStatistics->print(Serialized);
+  Serialized.flush();
+  return copyString(Out);
+}
+
 uint64_t rp_manager_containers_count(rp_manager *manager) {
   revng_check(manager != nullptr);
   return manager->getRunner().registeredContainersCount();
@@ -399,16 +833,47 @@ rp_target_create_from_string(rp_manager *manager, const char *string) {
 bool rp_target_is_ready(rp_target *target, rp_container *container) {
   revng_assert(target);
   revng_assert(container);
-  return container->second->enumerate().contains(*target);
+
+  // Answered without waiting, even for evicted containers: this might be
+  // invoked by the progress callback of the operation holding the Snapshot
+  ReadAccess Access;
+  if (const Snapshot *Current = Access.snapshot()) {
+    auto It = Current->Ready.find(container);
+    if (It != Current->Ready.end())
+      return It->second.contains(*target);
+  }
+
+  if (container->second == nullptr)
+    return false;
+
+  return container->second->enumerateWithoutLoading().contains(*target);
 }
 
-void rp_apply_model_diff(rp_manager *manager, const char *diff) {
-  auto Diff(cantFail(deserialize<TupleTreeDiff<model::Binary>>(diff)));
-  ModelInvalidationEvent Event(Diff);
-  llvm::cantFail(Event.apply(manager->getRunner()));
+bool rp_apply_model_diff(rp_manager *manager, const char *diff) {
+  auto MaybeDiff = deserialize<TupleTreeDiff<model::Binary>>(diff);
+  if (not MaybeDiff) {
+    llvm::consumeError(MaybeDiff.takeError());
+    return false;
+  }
+  const TupleTreeDiff<model::Binary> &Diff = *MaybeDiff;
 
+  ModifyAccess Access;
   auto &Model(getWritableModelFromContext(manager->context()));
-  Diff.apply(Model);
+  // The references outside of the changed subtrees already point to Model
+  Diff.applyIncrementally(Model);
+
+  // Only re-verify what the diff could have broken, not the whole model
+  if (not Model->verifyChanges(Diff)) {
+    // Undo the changes, in reverse order, and leave the pipeline untouched
+    TupleTreeDiff<model::Binary> Undo = Diff.invert();
+    std::reverse(Undo.Changes.begin(), Undo.Changes.end());
+    Undo.applyIncrementally(Model);
+    return false;
+  }
+
+  ModelInvalidationEvent Event(Diff);
+  llvm::cantFail(Event.apply(manager->getRunner()));
+  return true;
 }
 
 /// TODO Remove the redundant copy by writing a custom string stream that writes
@@ -417,6 +882,19 @@ const char *
 rp_manager_create_global_copy(rp_manager *manager, const char *global_name) {
   std::string Out;
   llvm::raw_string_ostream Serialized(Out);
+
+  ReadAccess Access;
+  const Snapshot *Current = Access.snapshot();
+  if (Current != nullptr and Current->Manager == manager) {
+    if (llvm::StringRef(global_name) == ModelGlobal::Name) {
+      ModelGlobal::serialize(*Current->Model, Serialized);
+      Serialized.flush();
+      return copyString(Out);
+    }
+
+    Access.waitFor(manager);
+  }
+
   if (auto Error = manager->context().serializeGlobal(global_name, Serialized);
       Error) {
     llvm::consumeError(std::move(Error));
@@ -433,6 +911,7 @@ bool rp_manager_set_global(rp_manager *manager,
   if (MaybeBuffer == nullptr)
     return false;
 
+  ModifyAccess Access;
   if (auto Error = manager->context().deserializeGlobal(global_name,
                                                         *MaybeBuffer);
       Error) {
@@ -442,3 +921,30 @@ bool rp_manager_set_global(rp_manager *manager,
 
   return true;
 }
+
+bool rp_manager_set_resident_steps_limit(rp_manager *manager,
+                                         uint64_t limit,
+                                         const char *directory) {
+  revng_check(manager != nullptr);
+  if (limit > UINT_MAX or (limit != 0 and directory == nullptr))
+    return false;
+
+  llvm::StringRef Directory = directory != nullptr ? directory : "";
+  ModifyAccess Access;
+  manager->getRunner().setResidentStepsLimit(limit, Directory);
+  return true;
+}
+
+uint64_t rp_manager_get_evictions_count(rp_manager *manager) {
+  revng_check(manager != nullptr);
+  ReadAccess Access;
+  Access.waitFor(manager);
+  return manager->getRunner().getEvictionStatistics().Evictions;
+}
+
+uint64_t rp_manager_get_reloads_count(rp_manager *manager) {
+  revng_check(manager != nullptr);
+  ReadAccess Access;
+  Access.waitFor(manager);
+  return manager->getRunner().getEvictionStatistics().Reloads;
+}
@@ -5,18 +5,31 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <iterator>
 #include <memory>
+#include <string>
+#include <vector>
 
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
 #include "llvm/CodeGen/CommandFlags.h"
 #include "llvm/CodeGen/MachineModuleInfo.h"
+#include "llvm/Config/llvm-config.h"
 #include "llvm/IR/AutoUpgrade.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/Option/OptTable.h"
 #include "llvm/Support/CodeGen.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SHA1.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/raw_os_ostream.h"
 #include "llvm/Target/TargetMachine.h"
+#include "llvm/Transforms/Utils/SplitModule.h"
 
 #include "revng/Pipeline/AllRegistries.h"
 #include "revng/Pipeline/LLVMContainer.h"
@@ -24,6 +37,9 @@
 #include "revng/Support/Assert.h"
 #include "revng/Support/IRAnnotators.h"
 #include "revng/Support/OriginalAssemblyAnnotationWriter.h"
+#include "revng/Support/ProgramRunner.h"
+#include "revng/Support/TaskScheduler.h"
+#include "revng/Support/TemporaryFile.h"
 
 using namespace llvm;
 using namespace llvm::codegen;
@@ -41,86 +57,347 @@ static cl::opt<char> OptLevel("compile-opt-level",
                               cl::ZeroOrMore,
                               cl::init(' '));
 
-static void
-compileModuleRunImpl(LLVMContainer &Module, FileContainer &TargetBinary) {
-
-  StringMap<Option *> &RegOptions(getRegisteredOptions());
-  getOption<bool>(RegOptions, "disable-machine-licm")->setInitialValue(true);
-
-  llvm::Module *M = &Module.getModule();
+static cl::opt<unsigned> Partitions("compile-partitions",
+                                    cl::desc("Number of partitions the module "
+                                             "is split into, to generate their "
+                                             "code in parallel (default = 1)"),
+                                    cl::ZeroOrMore,
+                                    cl::init(1));
 
-  OriginalAssemblyAnnotationWriter OAAW(M->getContext());
-  createSelfReferencingDebugInfo(M, Module.name(), &OAAW);
+static cl::opt<std::string> CacheDirectory("compile-cache-dir",
+                                           cl::desc("Directory where the "
+                                                    "objects of the partitions "
+                                                    "are cached, indexed by "
+                                                    "their IR and the codegen "
+                                                    "options"),
+                                           cl::ZeroOrMore,
+                                           cl::init(""));
 
-  // Get the target specific parser.
-  std::string Error;
-  Triple TheTriple(M->getTargetTriple());
-  const auto *TheTarget = TargetRegistry::lookupTarget("", TheTriple, Error);
-  revng_assert(TheTarget);
-
-  TargetOptions Options = InitTargetOptionsFromCodeGenFlags(TheTriple);
-
-  CodeGenOpt::Level OLvl = CodeGenOpt::Default;
+static CodeGenOpt::Level getOptimizationLevel() {
   switch (OptLevel) {
   case ' ':
-    break;
+    return CodeGenOpt::Default;
   case '0':
-    OLvl = CodeGenOpt::None;
-    break;
+    return CodeGenOpt::None;
   case '1':
-    OLvl = CodeGenOpt::Less;
-    break;
+    return CodeGenOpt::Less;
   case '2':
-    OLvl = CodeGenOpt::Default;
-    break;
+    return CodeGenOpt::Default;
   case '3':
-    OLvl = CodeGenOpt::Aggressive;
-    break;
+    return CodeGenOpt::Aggressive;
   default:
     revng_abort("Wrong Optimization Level");
-    return;
   }
+}
+
+static unique_ptr<TargetMachine> createTargetMachine(const llvm::Module &M) {
+  // Get the target specific parser.
+  std::string Error;
+  Triple TheTriple(M.getTargetTriple());
+  const auto *TheTarget = TargetRegistry::lookupTarget("", TheTriple, Error);
+  revng_assert(TheTarget);
+
+  TargetOptions Options = InitTargetOptionsFromCodeGenFlags(TheTriple);
 
   auto Ptr = TheTarget->createTargetMachine(TheTriple.getTriple(),
                                             "",
                                             "",
                                             Options,
                                             getRelocModel(),
-                                            M->getCodeModel(),
-                                            OLvl);
-  unique_ptr<TargetMachine> Target(Ptr);
-
-  // Add the target data from the target machine, if it exists, or the module.
-  M->setDataLayout(Target->createDataLayout());
-
-  // This needs to be done after setting datalayout since it calls verifier
-  // to check debug info whereas verifier relies on correct datalayout.
-  UpgradeDebugInfo(*M);
+                                            M.getCodeModel(),
+                                            getOptimizationLevel());
+  return unique_ptr<TargetMachine>(Ptr);
+}
 
-  LLVMTargetMachine &LLVMTM = static_cast<LLVMTargetMachine &>(*Target);
+/// \brief Emit the object file for \p M in \p OutputPath using \p Target
+static void
+emitObject(llvm::Module &M, TargetMachine &Target, StringRef OutputPath) {
+  LLVMTargetMachine &LLVMTM = static_cast<LLVMTargetMachine &>(Target);
   auto *MMIWP = new MachineModuleInfoWrapperPass(&LLVMTM);
 
   std::error_code EC;
-  raw_fd_ostream OutputStream(TargetBinary.getOrCreatePath(), EC);
+  raw_fd_ostream OutputStream(OutputPath, EC);
   revng_assert(!EC);
 
   // Create pass manager
   legacy::PassManager PM;
 
   // Add an appropriate TargetLibraryInfo pass for the module's triple.
-  TargetLibraryInfoImpl TLII(Triple(M->getTargetTriple()));
+  TargetLibraryInfoImpl TLII(Triple(M.getTargetTriple()));
   PM.add(new TargetLibraryInfoWrapperPass(TLII));
 
-  bool Err = Target->addPassesToEmitFile(PM,
-                                         OutputStream,
-                                         nullptr,
-                                         CGFT_ObjectFile,
-                                         true,
-                                         MMIWP);
+  bool Err = Target.addPassesToEmitFile(PM,
+                                        OutputStream,
+                                        nullptr,
+                                        CGFT_ObjectFile,
+                                        true,
+                                        MMIWP);
   revng_assert(not Err);
-  revng_assert(llvm::verifyModule(*M, &llvm::dbgs()) == 0);
-  PM.run(*M);
-  revng_assert(llvm::verifyModule(*M, &llvm::dbgs()) == 0);
+  revng_assert(llvm::verifyModule(M, &llvm::dbgs()) == 0);
+  PM.run(M);
+  revng_assert(llvm::verifyModule(M, &llvm::dbgs()) == 0);
+}
+
+/// \brief Hash the target options affecting the generated code
+///
+/// Options only affecting diagnostics or textual assembly are ignored.
+static void hashTargetOptions(SHA1 &Hasher, const TargetOptions &Options) {
+  const MCTargetOptions &MC = Options.MCOptions;
+  DenormalMode FPDenormal = Options.getRawFPDenormalMode();
+  DenormalMode FP32Denormal = Options.getRawFP32DenormalMode();
+  uint64_t Values[] = { Options.UnsafeFPMath,
+                        Options.NoInfsFPMath,
+                        Options.NoNaNsFPMath,
+                        Options.NoTrappingFPMath,
+                        Options.NoSignedZerosFPMath,
+                        Options.HonorSignDependentRoundingFPMathOption,
+                        Options.NoZerosInBSS,
+                        Options.GuaranteedTailCallOpt,
+                        Options.StackSymbolOrdering,
+                        Options.EnableFastISel,
+                        Options.EnableGlobalISel,
+                        static_cast<uint64_t>(Options.GlobalISelAbort),
+                        Options.UseInitArray,
+                        Options.DisableIntegratedAS,
+                        static_cast<uint64_t>(Options.CompressDebugSections),
+                        Options.RelaxELFRelocations,
+                        Options.FunctionSections,
+                        Options.DataSections,
+                        Options.UniqueSectionNames,
+                        Options.UniqueBasicBlockSectionNames,
+                        Options.TrapUnreachable,
+                        Options.NoTrapAfterNoreturn,
+                        Options.TLSSize,
+                        Options.EmulatedTLS,
+                        Options.ExplicitEmulatedTLS,
+                        Options.EnableIPRA,
+                        Options.EmitStackSizeSection,
+                        Options.EnableMachineOutliner,
+                        Options.SupportsDefaultOutlining,
+                        Options.EmitAddrsig,
+                        static_cast<uint64_t>(Options.BBSections),
+                        Options.EmitCallSiteInfo,
+                        Options.SupportsDebugEntryValues,
+                        Options.EnableDebugEntryValues,
+                        Options.ForceDwarfFrameSection,
+                        Options.XRayOmitFunctionIndex,
+                        static_cast<uint64_t>(Options.FloatABIType),
+                        static_cast<uint64_t>(Options.AllowFPOpFusion),
+                        static_cast<uint64_t>(Options.ThreadModel),
+                        static_cast<uint64_t>(Options.EABIVersion),
+                        static_cast<uint64_t>(Options.DebuggerTuning),
+                        static_cast<uint64_t>(FPDenormal.Input),
+                        static_cast<uint64_t>(FPDenormal.Output),
+                        static_cast<uint64_t>(FP32Denormal.Input),
+                        static_cast<uint64_t>(FP32Denormal.Output),
+                        static_cast<uint64_t>(Options.ExceptionModel),
+                        MC.MCRelaxAll,
+                        MC.MCNoExecStack,
+                        MC.MCIncrementalLinkerCompatible,
+                        static_cast<uint64_t>(MC.DwarfVersion) };
+  Hasher.update(ArrayRef(reinterpret_cast<const uint8_t *>(Values),
+                         sizeof(Values)));
+  Hasher.update(MC.ABIName);
+}
+
+/// \brief Backend options affecting the generated code not reflected in the
+///        TargetMachine
+static const char *CodeGenBoolOptions[] = { "disable-machine-licm" };
+
+std::string revng::pipes::computeObjectCacheKey(StringRef Bitcode,
+                                                const TargetMachine &TM) {
+  SHA1 Hasher;
+  Hasher.update(Bitcode);
+  Hasher.update(LLVM_VERSION_STRING);
+  Hasher.update(TM.getTargetTriple().str());
+  Hasher.update(TM.getTargetCPU());
+  Hasher.update(TM.getTargetFeatureString());
+  uint8_t Levels[] = { static_cast<uint8_t>(TM.getOptLevel()),
+                       static_cast<uint8_t>(TM.getRelocationModel()),
+                       static_cast<uint8_t>(TM.getCodeModel()) };
+  Hasher.update(Levels);
+  hashTargetOptions(Hasher, TM.Options);
+
+  StringMap<Option *> &RegOptions(getRegisteredOptions());
+  for (const char *Name : CodeGenBoolOptions) {
+    uint8_t Value = getOption<bool>(RegOptions, Name)->getValue();
+    Hasher.update(Name);
+    Hasher.update(Value);
+  }
+
+  return toHex(Hasher.final(), true);
+}
+
+/// \brief Cache of the objects generated for the partitions of a module
+///
+/// Entries are indexed by the SHA1 of the bitcode of the partition and of
+/// everything affecting code generation. The bitcode carries no debug
+/// information, which is generated for each partition on its own: a partition
+/// is reused as long as its code did not change, wherever it is in the module.
+class ObjectCache {
+private:
+  std::string Directory;
+
+public:
+  explicit ObjectCache(StringRef Directory) : Directory(Directory.str()) {
+    std::error_code EC = fs::create_directories(Directory);
+    revng_check(!EC, "Could not create the compile cache directory");
+  }
+
+public:
+  /// \return true if the object for \p Key has been copied in \p OutputPath
+  bool load(StringRef Key, StringRef OutputPath) const {
+    SmallString<128> EntryPath = entryPath(Key);
+    if (not fs::exists(EntryPath))
+      return false;
+    return not fs::copy_file(EntryPath, OutputPath);
+  }
+
+  void store(StringRef Key, StringRef ObjectPath) const {
+    // Copy in a temporary file first, then atomically move it in place: if
+    // another run stored the same entry in the meantime, either is fine
+    SmallString<128> TemporaryPath;
+    SmallString<128> Model(Directory);
+    sys::path::append(Model, "tmp-" + Key + "-%%%%%%.o");
+    if (fs::createUniqueFile(Model, TemporaryPath))
+      return;
+
+    if (fs::copy_file(ObjectPath, TemporaryPath)
+        or fs::rename(TemporaryPath, entryPath(Key)))
+      fs::remove(TemporaryPath);
+  }
+
+private:
+  SmallString<128> entryPath(StringRef Key) const {
+    SmallString<128> Result(Directory);
+    sys::path::append(Result, Key + ".o");
+    return Result;
+  }
+};
+
+void revng::pipes::linkRelocatableObject(ArrayRef<std::string> Objects,
+                                         StringRef OutputPath) {
+  // Go through the compiler driver, as LinkForTranslation does, so that the
+  // linker of the toolchain is used
+  std::vector<std::string> Arguments = {
+    "-r", "-nostdlib", "-o", OutputPath.str()
+  };
+  llvm::copy(Objects, std::back_inserter(Arguments));
+  int ExitCode = ::Runner.run("c++", Arguments);
+  revng_check(ExitCode == 0);
+}
+
+/// \brief Split \p M by function and generate the code of the partitions in
+///        parallel, producing a single relocatable object in \p OutputPath
+///
+/// Each partition is moved into an LLVMContext of its own through bitcode,
+/// since contexts cannot be shared across threads. The debug information of
+/// each partition refers to the lines of the partition itself, named after
+/// \p SourcePath, so that it does not depend on the rest of the module. The
+/// resulting objects are then combined by linkRelocatableObject, so that the
+/// rest of the pipeline still sees a single object file.
+///
+/// If \p Cache is not null, partitions whose object is in the cache are not
+/// compiled again, and the newly compiled ones are added to it.
+static void emitPartitionedObject(llvm::Module &M,
+                                  const TargetMachine &Target,
+                                  StringRef SourcePath,
+                                  StringRef OutputPath,
+                                  const ObjectCache *Cache) {
+  std::vector<SmallString<0>> Bitcodes;
+  SplitModule(M, Partitions, [&Bitcodes](std::unique_ptr<llvm::Module> Part) {
+    // Each partition declares all the globals of the module: drop the unused
+    // declarations, so that a partition is not affected by unrelated changes
+    for (llvm::Function &F : llvm::make_early_inc_range(Part->functions()))
+      if (F.isDeclaration() and F.use_empty())
+        F.eraseFromParent();
+    for (GlobalVariable &G : llvm::make_early_inc_range(Part->globals()))
+      if (G.isDeclaration() and G.use_empty())
+        G.eraseFromParent();
+
+    raw_svector_ostream OS(Bitcodes.emplace_back());
+    WriteBitcodeToFile(*Part, OS);
+  });
+
+  std::vector<TemporaryFile> Objects;
+  Objects.reserve(Bitcodes.size());
+  for (size_t I = 0; I < Bitcodes.size(); ++I)
+    Objects.emplace_back("revng-compile-partition-" + Twine(I), "o");
+
+  {
+    TaskGroup Group;
+    for (size_t I = 0; I < Bitcodes.size(); ++I) {
+      Group.spawn([&, I] {
+        std::string Key;
+        if (Cache != nullptr) {
+          Key = computeObjectCacheKey(Bitcodes[I], Target);
+          if (Cache->load(Key, Objects[I].path()))
+            return;
+        }
+
+        LLVMContext Context;
+        MemoryBufferRef Ref(Bitcodes[I], M.getModuleIdentifier());
+        auto MaybePart = parseBitcodeFile(Ref, Context);
+        revng_assert(MaybePart);
+        std::unique_ptr<llvm::Module> Part = std::move(*MaybePart);
+
+        OriginalAssemblyAnnotationWriter OAAW(Context);
+        std::string PartSourcePath = (SourcePath + "-" + Twine(I)).str();
+        createSelfReferencingDebugInfo(Part.get(), PartSourcePath, &OAAW);
+        UpgradeDebugInfo(*Part);
+
+        unique_ptr<TargetMachine> PartTarget = createTargetMachine(*Part);
+        emitObject(*Part, *PartTarget, Objects[I].path());
+
+        if (Cache != nullptr)
+          Cache->store(Key, Objects[I].path());
+      });
+    }
+    Group.wait();
+  }
+
+  std::vector<std::string> ObjectPaths;
+  for (const TemporaryFile &Object : Objects)
+    ObjectPaths.push_back(Object.path().str());
+  linkRelocatableObject(ObjectPaths, OutputPath);
+}
+
+static void
+compileModuleRunImpl(LLVMContainer &Module, FileContainer &TargetBinary) {
+
+  // Options are global, there's no need to set them more than once
+  static bool OptionsSet = [] {
+    StringMap<Option *> &RegOptions(getRegisteredOptions());
+    getOption<bool>(RegOptions, "disable-machine-licm")->setInitialValue(true);
+    return true;
+  }();
+  (void) OptionsSet;
+
+  llvm::Module *M = &Module.getModule();
+
+  unique_ptr<TargetMachine> Target = createTargetMachine(*M);
+
+  // Add the target data from the target machine, if it exists, or the module.
+  M->setDataLayout(Target->createDataLayout());
+
+  // The partitions get their own debug information, after the split
+  StringRef OutputPath = TargetBinary.getOrCreatePath();
+  revng_assert(Partitions > 0);
+  if (not CacheDirectory.empty()) {
+    ObjectCache Cache(CacheDirectory);
+    emitPartitionedObject(*M, *Target, Module.name(), OutputPath, &Cache);
+  } else if (Partitions > 1) {
+    emitPartitionedObject(*M, *Target, Module.name(), OutputPath, nullptr);
+  } else {
+    OriginalAssemblyAnnotationWriter OAAW(M->getContext());
+    createSelfReferencingDebugInfo(M, Module.name(), &OAAW);
+
+    // This needs to be done after setting datalayout since it calls verifier
+    // to check debug info whereas verifier relies on correct datalayout.
+    UpgradeDebugInfo(*M);
+
+    emitObject(*M, *Target, OutputPath);
+  }
 
   auto Path = TargetBinary.path();
 
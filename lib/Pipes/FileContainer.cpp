@@ -5,6 +5,12 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#ifdef __linux__
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
@@ -20,6 +26,29 @@ static void cantFail(std::error_code EC) {
   revng_assert(!EC);
 }
 
+/// \brief Copy \p Source in \p Destination, sharing the data on disk if the
+///        filesystem allows it
+static std::error_code cloneFile(StringRef Source, StringRef Destination) {
+#ifdef FICLONE
+  int SourceFD = -1;
+  if (not fs::openFileForRead(Source, SourceFD)) {
+    int DestinationFD = -1;
+    bool Cloned = false;
+    if (not fs::openFileForWrite(Destination, DestinationFD)) {
+      Cloned = ioctl(DestinationFD, FICLONE, SourceFD) == 0;
+      ::close(DestinationFD);
+    }
+    ::close(SourceFD);
+
+    if (Cloned)
+      return {};
+  }
+#endif
+
+  // Reflinks are not supported, perform an actual copy
+  return fs::copy_file(Source, Destination);
+}
+
 namespace revng::pipes {
 
 char FileContainer::ID;
@@ -31,17 +60,18 @@ FileContainer::FileContainer(Kind &K,
 }
 
 FileContainer::~FileContainer() {
-  remove();
+  removeFile();
 }
 
 llvm::StringRef FileContainer::getOrCreatePath() {
+  markModified();
   if (Path.empty())
     cantFail(llvm::sys::fs::createTemporaryFile("", Suffix, Path));
 
   return llvm::StringRef(Path);
 }
 
-void FileContainer::remove() {
+void FileContainer::removeFile() {
   if (not Path.empty())
     cantFail(llvm::sys::fs::remove(Path));
 }
@@ -52,16 +82,16 @@ FileContainer &FileContainer::operator=(const FileContainer &Other) noexcept {
 
   if (Path.empty())
     cantFail(llvm::sys::fs::createTemporaryFile("", Other.Suffix, Path));
-  cantFail(llvm::sys::fs::copy_file(Other.Path, Path));
+  cantFail(cloneFile(Other.Path, Path));
   return *this;
 }
 
-bool FileContainer::remove(const pipeline::TargetsList &Target) {
+bool FileContainer::removeImpl(const pipeline::TargetsList &Target) {
   auto NotFound = llvm::find(Target, getOnlyPossibleTarget()) == Target.end();
   if (NotFound)
     return false;
 
-  clear();
+  clearImpl();
 
   return true;
 }
@@ -70,7 +100,7 @@ FileContainer &FileContainer::operator=(FileContainer &&Other) noexcept {
   if (this == &Other)
     return *this;
 
-  remove();
+  removeFile();
   Path = std::move(Other.Path);
   return *this;
 }
@@ -85,7 +115,7 @@ FileContainer::cloneFiltered(const TargetsList &Container) const {
 
   auto Result = std::make_unique<FileContainer>(*K, this->name(), Suffix);
   Result->getOrCreatePath();
-  cantFail(llvm::sys::fs::copy_file(Path, Result->Path));
+  cantFail(cloneFile(Path, Result->Path));
   return Result;
 }
 
@@ -111,19 +141,19 @@ llvm::Error FileContainer::storeToDisk(llvm::StringRef Path) const {
     return llvm::Error::success();
   }
 
-  auto Error = errorCodeToError(llvm::sys::fs::copy_file(this->Path, Path));
+  auto Error = errorCodeToError(cloneFile(this->Path, Path));
   auto Perm = cantFail(errorOrToExpected(fs::getPermissions(this->Path)));
   fs::setPermissions(Path, Perm);
   return Error;
 }
 
-llvm::Error FileContainer::loadFromDisk(llvm::StringRef Path) {
+llvm::Error FileContainer::loadFromDiskImpl(llvm::StringRef Path) {
   if (not llvm::sys::fs::exists(Path)) {
     *this = FileContainer(*K, this->name(), Suffix);
     return llvm::Error::success();
   }
   getOrCreatePath();
-  return errorCodeToError(llvm::sys::fs::copy_file(Path, this->Path));
+  return errorCodeToError(cloneFile(Path, this->Path));
 }
 
 TargetsList FileContainer::enumerate() const {
@@ -133,7 +163,7 @@ TargetsList FileContainer::enumerate() const {
   return TargetsList({ getOnlyPossibleTarget() });
 }
 
-void FileContainer::clear() {
+void FileContainer::clearImpl() {
   *this = FileContainer(*K, name(), Suffix);
 }
 
@@ -141,16 +171,31 @@ llvm::Error FileContainer::serialize(llvm::raw_ostream &OS) const {
   if (Path.empty())
     return llvm::Error::success();
 
-  if (auto MaybeBuffer = MemoryBuffer::getFile(Path); !MaybeBuffer)
+  auto MaybeBuffer = getBuffer();
+  if (not MaybeBuffer)
+    return MaybeBuffer.takeError();
+
+  OS << (*MaybeBuffer)->getBuffer();
+  return llvm::Error::success();
+}
+
+llvm::Expected<std::unique_ptr<llvm::MemoryBuffer>>
+FileContainer::getBuffer() const {
+  revng_assert(not Path.empty());
+
+  // Not requiring a null terminator avoids copying files whose size is a
+  // multiple of the page size
+  auto MaybeBuffer = MemoryBuffer::getFile(Path,
+                                           /* IsText */ false,
+                                           /* RequiresNullTerminator */ false);
+  if (not MaybeBuffer)
     return llvm::createStringError(MaybeBuffer.getError(),
                                    "could not read file");
-  else
-    OS << (*MaybeBuffer)->getBuffer();
 
-  return llvm::Error::success();
+  return std::move(*MaybeBuffer);
 }
 
-llvm::Error FileContainer::deserialize(const llvm::MemoryBuffer &Buffer) {
+llvm::Error FileContainer::deserializeImpl(const llvm::MemoryBuffer &Buffer) {
   std::error_code EC;
   llvm::raw_fd_ostream OS(getOrCreatePath(), EC, llvm::sys::fs::F_None);
   if (EC)
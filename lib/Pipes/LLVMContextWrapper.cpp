@@ -6,8 +6,30 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/SourceMgr.h"
+
 #include "revng/Pipes/LLVMContextWrapper.h"
+#include "revng/Support/Assert.h"
+#include "revng/Support/SharedFiles.h"
 
 using namespace revng::pipes;
 
 const char LLVMContextWrapper::ID = '0';
+
+const llvm::Module &LLVMContextWrapper::getCachedModule(llvm::StringRef Path) {
+  std::lock_guard Lock(CachedModulesLock);
+  auto It = CachedModules.find(Path);
+  if (It == CachedModules.end()) {
+    auto MaybeBuffer = revng::getSharedFile(Path);
+    revng_assert(MaybeBuffer);
+
+    llvm::SMDiagnostic Err;
+    auto Module = llvm::parseIR(*MaybeBuffer, Err, Ctx);
+    revng_assert(Module != nullptr);
+
+    It = CachedModules.try_emplace(Path, std::move(Module)).first;
+  }
+
+  return *It->second;
+}
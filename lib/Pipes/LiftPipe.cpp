@@ -32,11 +32,13 @@ void LiftPipe::run(Context &Ctx,
   if (not SourceBinary.exists())
     return;
 
-  const TupleTree<model::Binary> &Model = getModelFromContext(Ctx);
+  // Lift against a snapshot, so that the model cannot change under our feet
+  ModelGlobal::Snapshot Snapshot = getModelSnapshotFromContext(Ctx);
+  const TupleTree<model::Binary> &Model = *Snapshot;
 
-  auto BufferOrError = MemoryBuffer::getFileOrSTDIN(*SourceBinary.path());
-  auto Buffer = cantFail(errorOrToExpected(std::move(BufferOrError)));
-  RawBinaryView RawBinary(*Model, Buffer->getBuffer());
+  // The buffer is a read-only mapping of the file, LoadBinaryWrapperPass
+  // builds the RawBinaryView on top of it without copying it
+  auto Buffer = cantFail(SourceBinary.getBuffer());
 
   // Perform lifting
   llvm::legacy::PassManager PM;
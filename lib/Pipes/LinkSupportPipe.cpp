@@ -11,6 +11,7 @@
 #include "llvm/Linker/Linker.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/SourceMgr.h"
+#include "llvm/Transforms/Utils/Cloning.h"
 
 #include "revng/Model/Architecture.h"
 #include "revng/Model/Binary.h"
@@ -21,6 +22,7 @@
 #include "revng/Support/Assert.h"
 #include "revng/Support/CommandLine.h"
 #include "revng/Support/ResourceFinder.h"
+#include "revng/Support/SharedFiles.h"
 
 using namespace llvm::cl;
 using namespace pipeline;
@@ -81,21 +83,45 @@ void LinkSupportPipe::print(const pipeline::Context &Ctx,
      << Names[0] << "\n";
 }
 
+/// \return a copy of the support module in \p Context, parsing it only once
+///         per pipeline context
+static std::unique_ptr<llvm::Module>
+getSupportModule(const Context &Ctx, llvm::LLVMContext &Context) {
+  std::string SupportPath = getSupportPath(Ctx);
+
+  auto MaybeWrapper = Ctx.getGlobal<LLVMContextWrapper>("LLVMContext");
+  if (MaybeWrapper and &(*MaybeWrapper)->getContext() == &Context)
+    return llvm::CloneModule((*MaybeWrapper)->getCachedModule(SupportPath));
+  llvm::consumeError(MaybeWrapper.takeError());
+
+  // The module lives in a context we do not own, parse the support module
+  auto MaybeBuffer = getSharedFile(SupportPath);
+  revng_assert(MaybeBuffer);
+
+  llvm::SMDiagnostic Err;
+  auto Module = llvm::parseIR(*MaybeBuffer, Err, Context);
+  revng_assert(Module != nullptr);
+  return Module;
+}
+
 void revng::pipes::LinkSupportPipe::run(const Context &Ctx,
                                         LLVMContainer &TargetsList) {
   if (TargetsList.enumerate().empty())
     return;
 
-  std::string SupportPath = getSupportPath(Ctx);
+  llvm::Module &Module = TargetsList.getModule();
+  auto Support = getSupportModule(Ctx, Module.getContext());
 
-  llvm::SMDiagnostic Err;
-  auto Module = llvm::parseIRFile(SupportPath,
-                                  Err,
-                                  TargetsList.getModule().getContext());
-  revng_assert(Module != nullptr);
+  // Only the symbols the module references are linked, plus the entry point
+  // of the program, which nobody references
+  if (llvm::Function *Main = Support->getFunction("main"))
+    if (Module.getFunction("main") == nullptr)
+      Module.getOrInsertFunction("main", Main->getFunctionType());
 
-  auto Failed = llvm::Linker::linkModules(TargetsList.getModule(),
-                                          std::move(Module));
+  using llvm::Linker;
+  auto Failed = Linker::linkModules(Module,
+                                    std::move(Support),
+                                    Linker::Flags::LinkOnlyNeeded);
 
   revng_assert(not Failed);
 }
@@ -6,6 +6,7 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
@@ -18,8 +19,24 @@ using namespace ::revng::pipes;
 
 const char ModelGlobal::ID = '0';
 
+static llvm::cl::opt<bool> BinaryModel("binary-model",
+                                       llvm::cl::desc("store the model in "
+                                                      "execution directories "
+                                                      "using the binary tuple "
+                                                      "tree format instead of "
+                                                      "YAML"),
+                                       llvm::cl::init(false));
+
+void ModelGlobal::serialize(const TupleTree<model::Binary> &Model,
+                            llvm::raw_ostream &OS) {
+  if (BinaryModel)
+    Model.serializeBinary(OS);
+  else
+    Model.serialize(OS);
+}
+
 llvm::Error ModelGlobal::serialize(llvm::raw_ostream &OS) const {
-  Model.serialize(OS);
+  serialize(Model, OS);
   return llvm::Error::success();
 }
 
@@ -30,5 +47,6 @@ llvm::Error ModelGlobal::deserialize(const llvm::MemoryBuffer &Buffer) {
   else
     Model = std::move(*MaybeBin);
 
+  newVersion();
   return llvm::Error::success();
 }
@@ -5,11 +5,47 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <algorithm>
+
 #include "revng/Pipeline/InvalidationEvent.h"
 #include "revng/Pipeline/KindsRegistry.h"
 #include "revng/Pipes/ModelInvalidationEvent.h"
+#include "revng/Support/Assert.h"
+#include "revng/TupleTree/Visits.h"
 
 using namespace pipeline;
 using namespace revng::pipes;
 
 char ModelInvalidationEvent::ID = 0;
+
+void ModelInvalidationEvent::indexPaths() {
+  ChangedPaths.reserve(Diff.Changes.size());
+  for (const auto &Change : Diff.Changes) {
+    auto MaybePath = pathAsString<model::Binary>(Change.Path);
+    revng_assert(MaybePath.has_value());
+    ChangedPaths.push_back(std::move(*MaybePath));
+  }
+
+  SortedPaths = ChangedPaths;
+  llvm::sort(SortedPaths);
+}
+
+bool ModelInvalidationEvent::hasChangesUnder(llvm::StringRef Prefix) const {
+  // All the paths starting with Prefix follow it in SortedPaths
+  auto It = std::lower_bound(SortedPaths.begin(),
+                             SortedPaths.end(),
+                             Prefix,
+                             [](const std::string &Path, llvm::StringRef P) {
+                               return llvm::StringRef(Path) < P;
+                             });
+  for (; It != SortedPaths.end(); ++It) {
+    llvm::StringRef Path(*It);
+    if (not Path.startswith(Prefix))
+      return false;
+
+    // Do not match "/Foo" against "/FooBar"
+    if (Path.size() == Prefix.size() or Path[Prefix.size()] == '/')
+      return true;
+  }
+  return false;
+}
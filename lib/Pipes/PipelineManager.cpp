@@ -18,6 +18,7 @@
 #include "llvm/Support/raw_os_ostream.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include "revng/BasicAnalyses/GeneratedCodeBasicInfo.h"
 #include "revng/Model/LoadModelPass.h"
 #include "revng/Pipeline/AllRegistries.h"
 #include "revng/Pipeline/Context.h"
@@ -74,10 +75,30 @@ pipelineConfigurationCallback(const Loader &Loader, LLVMPipe &NewPass) {
   return llvm::Error::success();
 }
 
+static llvm::Error
+newPMPipelineConfigurationCallback(const Loader &Loader, NewPMLLVMPipe &Pipe) {
+  using Wrapper = ModelGlobal;
+  auto &Context = Loader.getContext();
+  auto MaybeModelWrapper = Context.getGlobal<Wrapper>(Wrapper::Name);
+  if (not MaybeModelWrapper)
+    return MaybeModelWrapper.takeError();
+
+  ModelWrapper TheModel((*MaybeModelWrapper)->getModel());
+  Pipe.addAnalyses([TheModel](AnalysisManagers &Managers) {
+    using LMA = LoadModelAnalysis;
+    Managers.MAM.registerPass([&] { return LMA::fromModelWrapper(TheModel); });
+    Managers.FAM.registerPass([&] { return LMA::fromModelWrapper(TheModel); });
+    Managers.MAM.registerPass([] { return GeneratedCodeBasicInfoAnalysis(); });
+    Managers.FAM.registerPass([] { return GeneratedCodeBasicInfoAnalysis(); });
+  });
+  return llvm::Error::success();
+}
+
 static Loader setupLoader(pipeline::Context &PipelineContext,
                           llvm::ArrayRef<std::string> EnablingFlags) {
   Loader Loader(PipelineContext);
   Loader.setLLVMPipeConfigurer(pipelineConfigurationCallback);
+  Loader.setNewPMLLVMPipeConfigurer(newPMPipelineConfigurationCallback);
   Loader.registerEnabledFlags(EnablingFlags);
   Registry::registerAllContainersAndPipes(Loader);
 
@@ -185,6 +206,7 @@ PipelineManager::createFromMemory(llvm::ArrayRef<std::string> PipelineContent,
 
 void PipelineManager::recalculateCache() {
   ContainerToEnumeration.clear();
+  ExpandedEnumerations.clear();
   for (const auto &Step : *Runner) {
     for (const auto &Container : Step.containers()) {
       const auto &StepName = Step.getName();
@@ -201,40 +223,54 @@ void PipelineManager::recalculateCache() {
   }
 }
 
+const TargetsList *PipelineManager::getTargetsAvailableFor(
+  const ContainerSet::value_type &Container) {
+  auto Iter = ContainerToEnumeration.find(&Container);
+  if (Iter == ContainerToEnumeration.end())
+    return nullptr;
+
+  auto [ExpandedIter, Inserted] = ExpandedEnumerations.try_emplace(&Container);
+  if (Inserted)
+    for (const auto &Target : *Iter->second)
+      Target.expand(*PipelineContext, ExpandedIter->second);
+
+  return &ExpandedIter->second;
+}
+
+// The cached state is kept symbolic: planning whole-binary requests does not
+// depend on the number of functions, the wildcards are expanded only when a
+// user asks for the targets of a container
 void PipelineManager::recalculateAllPossibleTargets() {
   CurrentState = Runner::State();
-  getAllPossibleTargets(CurrentState);
+  Runner->deduceAllPossibleTargets(CurrentState);
   recalculateCache();
 }
 
 void PipelineManager::recalculateCurrentState() {
   CurrentState = Runner::State();
-  getCurrentState(CurrentState);
+  Runner->getCurrentState(CurrentState);
   recalculateCache();
 }
 
-void PipelineManager::getCurrentState(Runner::State &State) const {
-  Runner->getCurrentState(State);
+static void expandState(const Context &Ctx, Runner::State &State) {
   for (auto &Step : State) {
     for (auto &Container : Step.second) {
       TargetsList Expansions;
       for (auto &Target : Container.second)
-        Target.expand(*PipelineContext, Expansions);
-      State[Step.first()][Container.first()] = std::move(Expansions);
+        Target.expand(Ctx, Expansions);
+      Container.second = std::move(Expansions);
     }
   }
 }
 
+void PipelineManager::getCurrentState(Runner::State &State) const {
+  Runner->getCurrentState(State);
+  expandState(*PipelineContext, State);
+}
+
 void PipelineManager::getAllPossibleTargets(Runner::State &State) const {
   Runner->deduceAllPossibleTargets(State);
-  for (auto &Step : State) {
-    for (auto &Container : Step.second) {
-      TargetsList Expansions;
-      for (auto &Target : Container.second)
-        Target.expand(*PipelineContext, Expansions);
-      State[Step.first()][Container.first()] = std::move(Expansions);
-    }
-  }
+  expandState(*PipelineContext, State);
 }
 
 void PipelineManager::writeAllPossibleTargets(llvm::raw_ostream &OS) const {
@@ -282,7 +318,9 @@ llvm::Error
 PipelineManager::invalidateAllPossibleTargets(llvm::raw_ostream &Stream) {
   recalculateAllPossibleTargets();
 
-  for (const auto &Step : CurrentState) {
+  Runner::State AllTargets;
+  getAllPossibleTargets(AllTargets);
+  for (const auto &Step : AllTargets) {
     for (const auto &Container : Step.second) {
       for (const auto &Target : Container.second) {
         if (not getRunner()[Step.first()]
@@ -317,7 +355,9 @@ llvm::Error
 PipelineManager::produceAllPossibleTargets(llvm::raw_ostream &Stream) {
   recalculateAllPossibleTargets();
 
-  for (const auto &Step : CurrentState) {
+  Runner::State AllTargets;
+  getAllPossibleTargets(AllTargets);
+  for (const auto &Step : AllTargets) {
     for (const auto &Container : Step.second) {
       for (const auto &Target : Container.second) {
         ContainerToTargetsMap ToProduce;
@@ -16,7 +16,6 @@
 #include "revng/Pipes/ModelInvalidationEvent.h"
 #include "revng/Pipes/RootKind.h"
 #include "revng/Support/FunctionTags.h"
-#include "revng/TupleTree/Visits.h"
 
 using namespace pipeline;
 using namespace ::revng::pipes;
@@ -45,15 +44,7 @@ void RootKind::getInvalidations(TargetsList &ToRemove,
   if (not Event)
     return;
 
-  const TupleTreePath ToCheck = *stringAsPath<model::Binary>("/ExtraCodeAddre"
-                                                             "ss"
-                                                             "es");
-
-  bool RootChanged = llvm::any_of(Event->getDiff().Changes,
-                                  [&ToCheck](const auto &Entry) {
-                                    const auto &[Path, Old, New] = Entry;
-                                    return ToCheck.isPrefixOf(Path);
-                                  });
+  bool RootChanged = Event->hasChangesUnder("/ExtraCodeAddresses");
 
   if (RootChanged)
     ToRemove.emplace_back(*this);
@@ -2,70 +2,148 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <algorithm>
+#include <cstring>
 #include <memory>
+#include <set>
 
-#include "llvm/IR/ModuleSummaryIndexYAML.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/YAMLTraits.h"
 
 #include "revng/Pipeline/Target.h"
 #include "revng/Pipes/StringMapContainer.h"
+#include "revng/Support/CommandLine.h"
 #include "revng/Support/MetaAddress/YAMLTraits.h"
 #include "revng/Support/YAMLTraits.h"
 
 using namespace pipeline;
 
+static llvm::cl::opt<bool> BinaryStringMaps("binary-string-maps",
+                                            llvm::cl::desc("store the string "
+                                                           "map containers "
+                                                           "in execution "
+                                                           "directories "
+                                                           "using an indexed "
+                                                           "binary format "
+                                                           "instead of YAML"),
+                                            llvm::cl::cat(MainCategory),
+                                            llvm::cl::init(false));
+
 namespace revng::pipes {
 
+using Entry = StringMapContainer::Entry;
+using EntriesVector = StringMapContainer::EntriesVector;
+
+static bool compareKeys(const Entry &LHS, const Entry &RHS) {
+  return LHS.first < RHS.first;
+}
+
+static Target toTarget(const MetaAddress &Address, const Kind &TheKind) {
+  return Target{ Address.toString(), TheKind };
+}
+
 char StringMapContainer::ID = 0;
 
+llvm::StringRef StringMapContainer::allocate(llvm::StringRef Value) {
+  if (Value.empty())
+    return {};
+
+  if (Storages.empty() or Storages.back()->Mapped != nullptr)
+    Storages.push_back(std::make_shared<Storage>());
+
+  Storage &Arena = *Storages.back();
+  char *Data = nullptr;
+  {
+    std::lock_guard<std::mutex> Guard(Arena.Lock);
+    Data = Arena.Allocator.Allocate<char>(Value.size());
+  }
+  memcpy(Data, Value.data(), Value.size());
+  return llvm::StringRef(Data, Value.size());
+}
+
+void StringMapContainer::insert(const MetaAddress &Key,
+                                llvm::StringRef Value) {
+  markModified();
+  Entry NewEntry{ Key, allocate(Value) };
+  auto It = std::lower_bound(Index.begin(), Index.end(), NewEntry, compareKeys);
+  if (It != Index.end() and It->first == Key)
+    It->second = NewEntry.second;
+  else
+    Index.insert(It, NewEntry);
+}
+
+std::optional<llvm::StringRef>
+StringMapContainer::get(const MetaAddress &Key) const {
+  Entry Needle{ Key, {} };
+  auto It = std::lower_bound(Index.begin(), Index.end(), Needle, compareKeys);
+  if (It == Index.end() or It->first != Key)
+    return std::nullopt;
+  return It->second;
+}
+
 std::unique_ptr<ContainerBase>
 StringMapContainer::cloneFiltered(const TargetsList &Targets) const {
-  auto Clone = std::make_unique<StringMapContainer>(*this);
-
-  // Returns true if Targets contains a Target that matches the Entry in the Map
-  const auto EntryIsInTargets = [&](const auto &Entry) {
-    const auto &KeyMetaAddress = Entry.first;
-    pipeline::Target EntryTarget{KeyMetaAddress.toString(), *TheKind };
-    return Targets.contains(EntryTarget);
-  };
+  // The clone shares the storages, only the index is copied
+  auto Clone = std::make_unique<StringMapContainer>(name(), *TheKind);
+  Clone->Storages = Storages;
 
-  // Drop all the entries in Map that are not in Targets
-  std::erase_if(Clone->Map, std::not_fn(EntryIsInTargets));
+  // Keep only the entries of the index that are in Targets
+  for (const Entry &E : Index)
+    if (Targets.contains(toTarget(E.first, *TheKind)))
+      Clone->Index.push_back(E);
 
   return Clone;
 }
 
 void StringMapContainer::mergeBackImpl(StringMapContainer &&Other) {
-  // Stuff in Other should overwrite what's in this container.
-  // We first merge this->Map into Other.Map (which keeps Other's version if
-  // present), and then we replace this->Map with the newly merged version of
-  // Other.Map.
-  Other.Map.merge(std::move(this->Map));
-  this->Map = std::move(Other.Map);
+  // Stuff in Other should overwrite what's in this container: merge the two
+  // sorted indexes, preferring the entries of Other in case of collision
+  EntriesVector Merged;
+  Merged.reserve(Index.size() + Other.Index.size());
+  auto It = Index.begin();
+  auto End = Index.end();
+  for (const Entry &E : Other.Index) {
+    for (; It != End and It->first < E.first; ++It)
+      Merged.push_back(*It);
+    if (It != End and It->first == E.first)
+      ++It;
+    Merged.push_back(E);
+  }
+  Merged.insert(Merged.end(), It, End);
+  Index = std::move(Merged);
+
+  // Keep the storages of Other alive, prepending them so that the last storage
+  // of this container stays the one new strings are allocated in
+  Storages.insert(Storages.begin(),
+                  std::make_move_iterator(Other.Storages.begin()),
+                  std::make_move_iterator(Other.Storages.end()));
 }
 
 TargetsList StringMapContainer::enumerate() const {
   TargetsList Result;
-  for (const auto &[MetaAddress, Mapped] : Map)
-    Result.push_back({ MetaAddress.toString(), *TheKind });
+  for (const auto &[MetaAddress, Mapped] : Index)
+    Result.push_back(toTarget(MetaAddress, *TheKind));
   return Result;
 }
 
-bool StringMapContainer::remove(const TargetsList &Targets) {
-  bool Changed = false;
-
-  auto End = Map.end();
+bool StringMapContainer::removeImpl(const TargetsList &Targets) {
+  std::set<MetaAddress> ToRemove;
   for (const Target &T : Targets) {
     revng_assert(T.getPathComponents().size() == 1);
     std::string MetaAddrStr = T.getPathComponents().back().getName();
-    auto It = Map.find(MetaAddress::fromString(MetaAddrStr));
-    if (It != End) {
-      Map.erase(It);
-      Changed = true;
-    }
+    ToRemove.insert(MetaAddress::fromString(MetaAddrStr));
   }
 
-  return Changed;
+  auto OldSize = Index.size();
+  llvm::erase_if(Index, [&ToRemove](const Entry &E) {
+    return ToRemove.count(E.first) != 0;
+  });
+
+  return Index.size() != OldSize;
 }
 
 } // end namespace revng::pipes
@@ -74,15 +152,18 @@ namespace llvm {
 namespace yaml {
 
 template<>
-struct CustomMappingTraits<std::map<MetaAddress, std::string>> {
+struct CustomMappingTraits<revng::pipes::EntriesVector> {
 
+  /// \note the strings point into the YAML document, they need to be copied
+  ///       before the Input is destroyed
   static void
-  inputOne(IO &IO, StringRef Key, std::map<MetaAddress, std::string> &M) {
-    IO.mapRequired(Key.str().c_str(), M[MetaAddress::fromString(Key)]);
+  inputOne(IO &IO, StringRef Key, revng::pipes::EntriesVector &Entries) {
+    Entries.push_back({ MetaAddress::fromString(Key), StringRef() });
+    IO.mapRequired(Key.str().c_str(), Entries.back().second);
   }
 
-  static void output(IO &IO, std::map<MetaAddress, std::string> &M) {
-    for (auto &[MetaAddr, String] : M)
+  static void output(IO &IO, revng::pipes::EntriesVector &Entries) {
+    for (auto &[MetaAddr, String] : Entries)
       IO.mapRequired(MetaAddr.toString().c_str(), String);
   }
 };
@@ -92,24 +173,155 @@ struct CustomMappingTraits<std::map<MetaAddress, std::string>> {
 
 namespace revng::pipes {
 
+/// \name Indexed binary format
+///
+/// All the integers are little endian. The file is composed by:
+///
+/// * the magic value;
+/// * the number of entries (uint64_t);
+/// * for each entry, in ascending order of MetaAddress, the address
+///   (uint64_t), the epoch (uint32_t), the address space (uint16_t) and the
+///   type (uint16_t) of the key, followed by the offset (uint64_t) and the
+///   size (uint64_t) of the string, relative to the start of the strings;
+/// * the strings.
+///
+/// @{
+static constexpr llvm::StringLiteral Magic = "RVNGSMAP";
+static constexpr size_t HeaderSize = 8 + sizeof(uint64_t);
+static constexpr size_t EntrySize = 32;
+/// @}
+
+void StringMapContainer::serializeBinary(llvm::raw_ostream &OS) const {
+  using namespace llvm::support;
+  endian::Writer Writer(OS, little);
+
+  OS << Magic;
+  Writer.write<uint64_t>(Index.size());
+
+  uint64_t Offset = 0;
+  for (const auto &[Key, Value] : Index) {
+    Writer.write<uint64_t>(Key.address());
+    Writer.write<uint32_t>(Key.epoch());
+    Writer.write<uint16_t>(Key.addressSpace());
+    Writer.write<uint16_t>(Key.type());
+    Writer.write<uint64_t>(Offset);
+    Writer.write<uint64_t>(Value.size());
+    Offset += Value.size();
+  }
+
+  for (const auto &[Key, Value] : Index)
+    OS << Value;
+}
+
+llvm::Error
+StringMapContainer::deserializeBinary(std::unique_ptr<llvm::MemoryBuffer>
+                                        Buffer) {
+  using namespace llvm::support;
+  auto Invalid = [] {
+    return llvm::createStringError(llvm::inconvertibleErrorCode(),
+                                   "invalid binary string map");
+  };
+
+  llvm::StringRef Data = Buffer->getBuffer();
+  if (Data.size() < HeaderSize)
+    return Invalid();
+
+  const char *Cursor = Data.data() + Magic.size();
+  uint64_t Count = endian::readNext<uint64_t, little, unaligned>(Cursor);
+  if ((Data.size() - HeaderSize) / EntrySize < Count)
+    return Invalid();
+
+  llvm::StringRef Strings = Data.drop_front(HeaderSize + Count * EntrySize);
+  EntriesVector NewIndex;
+  NewIndex.reserve(Count);
+  for (uint64_t I = 0; I < Count; ++I) {
+    auto Address = endian::readNext<uint64_t, little, unaligned>(Cursor);
+    auto Epoch = endian::readNext<uint32_t, little, unaligned>(Cursor);
+    auto AddressSpace = endian::readNext<uint16_t, little, unaligned>(Cursor);
+    auto Type = endian::readNext<uint16_t, little, unaligned>(Cursor);
+    auto Offset = endian::readNext<uint64_t, little, unaligned>(Cursor);
+    auto Size = endian::readNext<uint64_t, little, unaligned>(Cursor);
+
+    if (Offset > Strings.size() or Size > Strings.size() - Offset)
+      return Invalid();
+
+    MetaAddress Key(Address,
+                    static_cast<MetaAddressType::Values>(Type),
+                    Epoch,
+                    AddressSpace);
+    if (Key.isInvalid()
+        or (not NewIndex.empty() and not(NewIndex.back().first < Key)))
+      return Invalid();
+
+    NewIndex.push_back({ Key, Strings.substr(Offset, Size) });
+  }
+
+  auto Mapped = std::make_shared<Storage>();
+  Mapped->Mapped = std::move(Buffer);
+  Index = std::move(NewIndex);
+  Storages = { std::move(Mapped) };
+
+  return llvm::Error::success();
+}
+
 llvm::Error StringMapContainer::serialize(llvm::raw_ostream &OS) const {
+  if (BinaryStringMaps) {
+    serializeBinary(OS);
+    return llvm::Error::success();
+  }
+
   llvm::yaml::Output YAMLOutput(OS);
-  YAMLOutput << const_cast<std::map<MetaAddress, std::string> &>(Map);
+  YAMLOutput << const_cast<EntriesVector &>(Index);
   return llvm::Error::success();
 }
 
-llvm::Error StringMapContainer::deserialize(const llvm::MemoryBuffer &Buffer) {
+llvm::Error
+StringMapContainer::deserializeImpl(const llvm::MemoryBuffer &Buffer) {
+  llvm::StringRef Data = Buffer.getBuffer();
+  if (Data.startswith(Magic)) {
+    // We do not own Buffer, copy it
+    auto Name = Buffer.getBufferIdentifier();
+    return deserializeBinary(llvm::MemoryBuffer::getMemBufferCopy(Data, Name));
+  }
 
+  EntriesVector Entries;
   llvm::yaml::Input YAMLInput(Buffer);
-  YAMLInput >> Map;
+  YAMLInput >> Entries;
 
+  clearImpl();
   if (YAMLInput.error()) {
-    this->Map.clear();
     return llvm::createStringError(llvm::inconvertibleErrorCode(),
                                    YAMLInput.error().message());
   }
 
+  // Copy the strings away from the YAML document, the last value of a
+  // duplicated key wins
+  for (const auto &[Key, Value] : Entries)
+    insert(Key, Value);
+
   return llvm::Error::success();
 }
 
+llvm::Error StringMapContainer::loadFromDiskImpl(llvm::StringRef Path) {
+  if (not llvm::sys::fs::exists(Path)) {
+    clearImpl();
+    return llvm::Error::success();
+  }
+
+  // Map the file in memory, so that the strings of binary containers are
+  // read only when accessed
+  auto MaybeBuffer = llvm::MemoryBuffer::getFile(Path,
+                                                 /* IsText */ false,
+                                                 /* RequiresNullTerminator */
+                                                 false);
+  if (not MaybeBuffer)
+    return llvm::createStringError(MaybeBuffer.getError(),
+                                   "could not read file");
+
+  if ((*MaybeBuffer)->getBuffer().startswith(Magic))
+    return deserializeBinary(std::move(*MaybeBuffer));
+
+  return deserializeImpl(**MaybeBuffer);
+}
+
 } // end namespace revng::pipes
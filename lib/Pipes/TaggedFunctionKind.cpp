@@ -5,10 +5,13 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <array>
 #include <optional>
+#include <set>
 #include <string>
 
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
 
 #include "revng/Model/Binary.h"
 #include "revng/Model/IRHelpers.h"
@@ -18,11 +21,13 @@
 #include "revng/Pipeline/Target.h"
 #include "revng/Pipes/Kinds.h"
 #include "revng/Pipes/ModelGlobal.h"
+#include "revng/Pipes/ModelInvalidationEvent.h"
 #include "revng/Pipes/RootKind.h"
 #include "revng/Pipes/TaggedFunctionKind.h"
 #include "revng/Support/Assert.h"
 #include "revng/Support/FunctionTags.h"
 #include "revng/Support/MetaAddress.h"
+#include "revng/TupleTree/Visits.h"
 
 using namespace pipeline;
 using namespace ::revng::pipes;
@@ -98,3 +103,47 @@ TaggedFunctionKind::symbolToTarget(const llvm::Function &Symbol) const {
   revng_assert(Address.isValid());
   return pipeline::Target({ Address.toString() }, *this);
 }
+
+void TaggedFunctionKind::getInvalidations(TargetsList &ToRemove,
+                                          const InvalidationEventBase &Base)
+  const {
+  const auto *Event = llvm::dyn_cast<ModelInvalidationEvent>(&Base);
+  if (not Event)
+    return;
+
+  // Fields of a function that are inspected when handling its call sites
+  static constexpr std::array<llvm::StringRef, 4> CallerVisibleFields = {
+    "CustomName", "OriginalName", "Type", "Attributes"
+  };
+
+  std::set<std::string> Invalidated;
+  for (llvm::StringRef Path : Event->getChangedPaths()) {
+    // Path components, the first one is empty since paths start with "/"
+    llvm::SmallVector<llvm::StringRef, 4> Components;
+    Path.split(Components, '/');
+    revng_assert(Components.size() >= 2 and Components[0].empty());
+
+    if (Components[1] == "Types" and not DependsOnPrototypes)
+      continue;
+
+    if (Components[1] == "Functions" and Components.size() > 3) {
+      // The change is within a function
+      llvm::StringRef Field = Components[3];
+      bool IsPrototype = Field == "Prototype";
+      if (not llvm::is_contained(CallerVisibleFields, Field)
+          and not(IsPrototype and DependsOnPrototypes)) {
+        Invalidated.insert(Components[2].str());
+        continue;
+      }
+    }
+
+    // Functions have been added or removed, or the change might affect the
+    // callers of a function, or something we do not track precisely: we don't
+    // know which functions depend on it, invalidate all of them
+    ToRemove.emplace_back(Target({ PathComponent::all() }, *this));
+    return;
+  }
+
+  for (const std::string &Entry : Invalidated)
+    ToRemove.emplace_back(Target({ PathComponent(Entry) }, *this));
+}
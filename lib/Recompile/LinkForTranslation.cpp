@@ -5,12 +5,15 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/BinaryFormat/ELF.h"
 #include "llvm/Object/ELFObjectFile.h"
 #include "llvm/Object/ObjectFile.h"
 #include "llvm/Support/Debug.h"
@@ -22,6 +25,7 @@
 #include "revng/Model/LoadModelPass.h"
 #include "revng/Model/RawBinaryView.h"
 #include "revng/Recompile/LinkForTranslation.h"
+#include "revng/Recompile/MergeDynamic.h"
 #include "revng/Support/Assert.h"
 #include "revng/Support/ProgramRunner.h"
 #include "revng/Support/ResourceFinder.h"
@@ -79,11 +83,117 @@ defineProgramHeadersSymbols(RawBinaryView &BinaryView,
     revng_abort();
 }
 
+void writeSectionObject(llvm::StringRef Path,
+                        llvm::StringRef SectionName,
+                        llvm::ArrayRef<uint8_t> Data,
+                        uint64_t Size,
+                        bool IsWriteable) {
+  using namespace llvm::ELF;
+
+  enum SectionIndex { Null, Content, SectionNames, Symbols, Strings, Count };
+
+  std::string Names;
+  auto AddName = [&Names](llvm::StringRef Name) {
+    uint32_t Result = Names.size();
+    Names += Name;
+    Names += '\0';
+    return Result;
+  };
+  AddName("");
+  uint32_t ContentName = AddName(SectionName);
+  uint32_t SectionNamesName = AddName(".shstrtab");
+  uint32_t SymbolsName = AddName(".symtab");
+  uint32_t StringsName = AddName(".strtab");
+
+  // Layout: header, content, section names, symbols, strings, section headers
+  auto AlignTo8 = [](uint64_t Offset) { return (Offset + 7) & ~uint64_t(7); };
+  uint64_t ContentOffset = sizeof(Elf64_Ehdr);
+  uint64_t NamesOffset = ContentOffset + Size;
+  uint64_t SymbolsOffset = AlignTo8(NamesOffset + Names.size());
+  uint64_t StringsOffset = SymbolsOffset + sizeof(Elf64_Sym);
+  uint64_t HeadersOffset = AlignTo8(StringsOffset + 1);
+
+  Elf64_Ehdr Header = {};
+  memcpy(Header.e_ident, ElfMagic, strlen(ElfMagic));
+  Header.e_ident[EI_CLASS] = ELFCLASS64;
+  Header.e_ident[EI_DATA] = ELFDATA2LSB;
+  Header.e_ident[EI_VERSION] = EV_CURRENT;
+  Header.e_type = ET_REL;
+  Header.e_machine = EM_X86_64;
+  Header.e_version = EV_CURRENT;
+  Header.e_shoff = HeadersOffset;
+  Header.e_ehsize = sizeof(Elf64_Ehdr);
+  Header.e_shentsize = sizeof(Elf64_Shdr);
+  Header.e_shnum = Count;
+  Header.e_shstrndx = SectionNames;
+
+  Elf64_Shdr Sections[Count] = {};
+  Sections[Content].sh_name = ContentName;
+  Sections[Content].sh_type = SHT_PROGBITS;
+  Sections[Content].sh_flags = SHF_ALLOC | (IsWriteable ? SHF_WRITE : 0);
+  Sections[Content].sh_offset = ContentOffset;
+  Sections[Content].sh_size = Size;
+  Sections[Content].sh_addralign = 1;
+
+  Sections[SectionNames].sh_name = SectionNamesName;
+  Sections[SectionNames].sh_type = SHT_STRTAB;
+  Sections[SectionNames].sh_offset = NamesOffset;
+  Sections[SectionNames].sh_size = Names.size();
+  Sections[SectionNames].sh_addralign = 1;
+
+  // Only the null symbol
+  Sections[Symbols].sh_name = SymbolsName;
+  Sections[Symbols].sh_type = SHT_SYMTAB;
+  Sections[Symbols].sh_offset = SymbolsOffset;
+  Sections[Symbols].sh_size = sizeof(Elf64_Sym);
+  Sections[Symbols].sh_link = Strings;
+  Sections[Symbols].sh_info = 1;
+  Sections[Symbols].sh_addralign = 8;
+  Sections[Symbols].sh_entsize = sizeof(Elf64_Sym);
+
+  Sections[Strings].sh_name = StringsName;
+  Sections[Strings].sh_type = SHT_STRTAB;
+  Sections[Strings].sh_offset = StringsOffset;
+  Sections[Strings].sh_size = 1;
+  Sections[Strings].sh_addralign = 1;
+
+  std::error_code EC;
+  raw_fd_ostream Output(Path, EC);
+  revng_check(not EC, "Cannot open the segment object file");
+
+  auto WriteZeros = [&Output](uint64_t Count) {
+    static const char Zeros[4096] = {};
+    for (; Count > sizeof(Zeros); Count -= sizeof(Zeros))
+      Output.write(Zeros, sizeof(Zeros));
+    Output.write(Zeros, Count);
+  };
+
+  Output.write(reinterpret_cast<const char *>(&Header), sizeof(Header));
+
+  uint64_t Copied = std::min<uint64_t>(Data.size(), Size);
+  Output.write(reinterpret_cast<const char *>(Data.data()), Copied);
+  WriteZeros(Size - Copied);
+
+  Output << Names;
+  WriteZeros(SymbolsOffset - (NamesOffset + Names.size()));
+
+  Elf64_Sym NullSymbol = {};
+  Output.write(reinterpret_cast<const char *>(&NullSymbol), sizeof(NullSymbol));
+  Output.write('\0');
+  WriteZeros(HeadersOffset - (StringsOffset + 1));
+
+  Output.write(reinterpret_cast<const char *>(Sections), sizeof(Sections));
+}
+
 class Command {
 public:
   std::string CommandName;
   std::vector<std::string> Arguments;
 
+  /// If present, run() invokes this instead of spawning the command, which is
+  /// still what print() emits
+  std::function<void()> InProcess;
+
 public:
   Command(std::string CommandName) : CommandName(CommandName) {}
 };
@@ -91,8 +201,13 @@ public:
 class CommandList {
 private:
   std::vector<Command> Commands;
+  TemporaryFile::Backend TemporariesBackend;
   std::vector<std::unique_ptr<TemporaryFile>> Temporaries;
 
+public:
+  CommandList(TemporaryFile::Backend TemporariesBackend) :
+    TemporariesBackend(TemporariesBackend) {}
+
 public:
   void print(llvm::raw_ostream &OS) const {
     for (const Command &C : Commands) {
@@ -106,8 +221,12 @@ public:
 
   void run() const {
     for (const Command &C : Commands) {
-      auto ExitCode = ::Runner.run(C.CommandName, C.Arguments);
-      revng_check(ExitCode == 0);
+      if (C.InProcess) {
+        C.InProcess();
+      } else {
+        auto ExitCode = ::Runner.run(C.CommandName, C.Arguments);
+        revng_check(ExitCode == 0);
+      }
     }
   }
 
@@ -115,7 +234,10 @@ public:
   void enqueueCommand(Command C) { Commands.push_back(std::move(C)); }
 
   TemporaryFile &createTemporary(std::string Prefix, std::string Suffix) {
-    Temporaries.emplace_back(std::make_unique<TemporaryFile>(Prefix, Suffix));
+    auto Temporary = std::make_unique<TemporaryFile>(Prefix,
+                                                     Suffix,
+                                                     TemporariesBackend);
+    Temporaries.push_back(std::move(Temporary));
     return *Temporaries.back();
   }
 
@@ -136,11 +258,14 @@ public:
   }
 };
 
+/// \param TemporariesBackend where to create the intermediate files. The
+///        printed commands derive other paths from them, they need a disk.
 static CommandList linkingArgs(const model::Binary &Model,
                                llvm::StringRef InputBinary,
                                llvm::StringRef ObjectFile,
-                               llvm::StringRef OutputBinary) {
-  CommandList Result;
+                               llvm::StringRef OutputBinary,
+                               TemporaryFile::Backend TemporariesBackend) {
+  CommandList Result(TemporariesBackend);
 
   auto UToHexStr = Twine::utohexstr;
 
@@ -150,8 +275,9 @@ static CommandList linkingArgs(const model::Binary &Model,
 
   auto MaybeBuffer = llvm::MemoryBuffer::getFileOrSTDIN(InputBinary);
   revng_assert(MaybeBuffer);
-  llvm::MemoryBuffer &Buffer = **MaybeBuffer;
-  RawBinaryView BinaryView(Model, Buffer.getBuffer());
+  // Kept alive by the commands reading segments data from it
+  std::shared_ptr<llvm::MemoryBuffer> Buffer = std::move(*MaybeBuffer);
+  RawBinaryView BinaryView(Model, Buffer->getBuffer());
 
   Command Linker("c++");
   Linker.Arguments = { ObjectFile.str(),
@@ -179,24 +305,6 @@ static CommandList linkingArgs(const model::Binary &Model,
                  << Segment.endAddress().toString();
     }
 
-    TemporaryFile &RawSegment = Result.createTemporary("", "");
-
-    Command DD("dd");
-    DD.Arguments = { { "status=none",
-                       "bs=1",
-                       ("skip=" + Twine(Segment.StartOffset)).str(),
-                       ("if=" + InputBinary).str(),
-                       ("count=" + Twine(Segment.FileSize)).str(),
-                       ("of=" + RawSegment.path()).str() } };
-    Result.enqueueCommand(std::move(DD));
-
-    Command Truncate("truncate");
-    Truncate.Arguments = { { ("--size=" + Twine(Segment.VirtualSize)).str(),
-                             RawSegment.path().str() } };
-    Result.enqueueCommand(std::move(Truncate));
-
-    Command ObjCopy("objcopy");
-
     // Create an object file we can later link
     TemporaryFile &SegmentELF = Result.createTemporary("", "o");
 
@@ -204,14 +312,36 @@ static CommandList linkingArgs(const model::Binary &Model,
     if (not Segment.IsWriteable)
       SectionFlags += ",readonly";
 
-    ObjCopy.Arguments = { "-Ibinary",
-                          "-Oelf64-x86-64",
-                          "--rename-section=.data=." + SectionName,
-                          "--set-section-flags=.data=" + SectionFlags,
-                          RawSegment.path().str(),
-                          SegmentELF.path().str() };
+    // When running, the object is produced directly from the segment data.
+    // When printing, emit the equivalent dd, truncate and objcopy commands.
+    Command ObjCopy("sh");
+    std::string RawSegment = SegmentELF.path().str() + ".raw";
+    auto Quote = CommandList::shellEscape;
+    std::string Script;
+    {
+      llvm::raw_string_ostream Stream(Script);
+      Stream << "dd status=none bs=1 skip=" << Segment.StartOffset
+             << " if=" << Quote(InputBinary) << " count=" << Segment.FileSize
+             << " of=" << Quote(RawSegment) << " && truncate --size="
+             << Segment.VirtualSize << " " << Quote(RawSegment)
+             << " && objcopy -Ibinary -Oelf64-x86-64 --rename-section=.data=."
+             << SectionName << " --set-section-flags=.data=" << SectionFlags
+             << " " << Quote(RawSegment) << " " << Quote(SegmentELF.path())
+             << " && rm " << Quote(RawSegment);
+    }
+    ObjCopy.Arguments = { "-c", Script };
+
+    // Structured bindings cannot be captured, copy the reference to the data
+    llvm::ArrayRef<uint8_t> SegmentData = Data;
+    ObjCopy.InProcess = [Buffer,
+                         Path = SegmentELF.path().str(),
+                         Name = "." + SectionName,
+                         SegmentData,
+                         Size = Segment.VirtualSize,
+                         IsWriteable = Segment.IsWriteable] {
+      writeSectionObject(Path, Name, SegmentData, Size, IsWriteable);
+    };
 
-    // Register the objcopy invocation
     Result.enqueueCommand(ObjCopy);
 
     Min = std::min(Min, Segment.StartAddress.address());
@@ -243,7 +373,7 @@ static CommandList linkingArgs(const model::Binary &Model,
   Linker.Arguments.push_back("-Wl,--as-needed");
 
   // Define program headers-related symbols
-  llvm::copy(defineProgramHeadersSymbols(BinaryView, Buffer),
+  llvm::copy(defineProgramHeadersSymbols(BinaryView, *Buffer),
              std::back_inserter(Linker.Arguments));
 
   Result.enqueueCommand(std::move(Linker));
@@ -263,6 +393,13 @@ static CommandList linkingArgs(const model::Binary &Model,
     MergeDynamic.Arguments.push_back("0x" + UToHexStr(BaseAddress).str());
   }
 
+  MergeDynamic.InProcess = [LinkerOutputPath = LinkerOutput.path().str(),
+                            Input = InputBinary.str(),
+                            Output = OutputBinary.str()] {
+    if (auto Error = mergeDynamic(LinkerOutputPath, Input, Output, BaseAddress))
+      revng_abort(toString(std::move(Error)).c_str());
+  };
+
   Result.enqueueCommand(std::move(MergeDynamic));
 
   return Result;
@@ -275,7 +412,8 @@ void linkForTranslation(const model::Binary &Model,
   CommandList Commands = linkingArgs(Model,
                                      InputBinary,
                                      ObjectFile,
-                                     OutputBinary);
+                                     OutputBinary,
+                                     TemporaryFile::defaultBackend());
   Commands.run();
 }
 
@@ -287,6 +425,7 @@ void printLinkForTranslationCommands(llvm::raw_ostream &OS,
   CommandList Commands = linkingArgs(Model,
                                      InputBinary,
                                      ObjectFile,
-                                     OutputBinary);
+                                     OutputBinary,
+                                     TemporaryFile::Backend::Disk);
   Commands.print(OS);
 }
@@ -22,7 +22,8 @@ void LinkForTranslationPipe::run(const Context &Ctx,
                                  FileContainer &ObjectFile,
                                  FileContainer &OutputBinary) {
 
-  const model::Binary &Model = *getModelFromContext(Ctx);
+  ModelGlobal::Snapshot Snapshot = getModelSnapshotFromContext(Ctx);
+  const model::Binary &Model = **Snapshot;
   linkForTranslation(Model,
                      *InputBinary.path(),
                      *ObjectFile.path(),
@@ -0,0 +1,938 @@
+/// \file MergeDynamic.cpp
+/// \brief Merge the dynamic portions of the translated ELF with the original
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/BinaryFormat/ELF.h"
+#include "llvm/Object/ELF.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/FileOutputBuffer.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+#include "revng/Recompile/MergeDynamic.h"
+#include "revng/Support/Assert.h"
+#include "revng/Support/Debug.h"
+
+using namespace llvm;
+using namespace llvm::object;
+
+static Logger<> Log("merge-dynamic");
+
+/// The new dynamic sections are mapped in a segment of their own
+static constexpr uint64_t SegmentAlignment = 0x1000;
+
+/// \brief Relocation with the fields of both REL and RELA entries, decoded
+struct Relocation {
+  uint64_t Offset = 0;
+  uint32_t Symbol = 0;
+  uint32_t Type = 0;
+  int64_t Addend = 0;
+};
+
+/// \brief A growable buffer of bytes with support for ELF structures
+class Buffer {
+private:
+  std::vector<uint8_t> Bytes;
+
+public:
+  size_t size() const { return Bytes.size(); }
+  ArrayRef<uint8_t> bytes() const { return Bytes; }
+
+public:
+  void append(ArrayRef<uint8_t> Data) {
+    Bytes.insert(Bytes.end(), Data.begin(), Data.end());
+  }
+
+  template<typename T>
+  void append(const T &Value) {
+    writeAt(Bytes.size(), Value);
+  }
+
+  /// Write \p Value at \p Offset, zero-filling the gap, if any
+  template<typename T>
+  void writeAt(size_t Offset, const T &Value) {
+    if (Bytes.size() < Offset + sizeof(T))
+      Bytes.resize(Offset + sizeof(T), 0);
+    memcpy(Bytes.data() + Offset, &Value, sizeof(T));
+  }
+};
+
+/// \brief The dynamic portions of an ELF, as seen by the dynamic loader
+template<typename ELFT>
+class ParsedELF {
+public:
+  LLVM_ELF_IMPORT_TYPES_ELFT(ELFT)
+
+  using Verneed = std::pair<Elf_Verneed, std::vector<Elf_Vernaux>>;
+
+public:
+  ELFFile<ELFT> File;
+  ArrayRef<uint8_t> Data;
+  std::vector<Elf_Phdr> Segments;
+  std::vector<Elf_Shdr> Sections;
+  std::vector<StringRef> SectionNames;
+
+  bool IsDynamic = false;
+  const Elf_Phdr *Dynamic = nullptr;
+  std::vector<Elf_Dyn> DynamicTags;
+  bool IsRela = false;
+
+  ArrayRef<uint8_t> DynStr;
+  ArrayRef<uint8_t> RelDyn;
+  std::vector<Relocation> Relocations;
+  std::vector<Elf_Sym> Symbols;
+  std::vector<uint16_t> VersionIndices;
+  std::vector<Verneed> Verneeds;
+
+private:
+  ParsedELF(ELFFile<ELFT> &&File, ArrayRef<uint8_t> Data) :
+    File(std::move(File)), Data(Data) {}
+
+public:
+  static Expected<ParsedELF> parse(ArrayRef<uint8_t> Data) {
+    auto MaybeFile = ELFFile<ELFT>::create(toStringRef(Data));
+    if (not MaybeFile)
+      return MaybeFile.takeError();
+
+    ParsedELF Result(std::move(*MaybeFile), Data);
+    if (auto Err = Result.parseDynamic())
+      return Err;
+    return Result;
+  }
+
+public:
+  bool isMips64EL() const { return File.isMips64EL(); }
+
+  std::optional<uint64_t> tag(uint64_t Tag) const {
+    for (const Elf_Dyn &Entry : DynamicTags)
+      if (static_cast<uint64_t>(Entry.getTag()) == Tag)
+        return Entry.getVal();
+    return std::nullopt;
+  }
+
+  /// \return the offset in the file of the \p Size bytes at \p Address
+  Expected<uint64_t> offsetOf(uint64_t Address, uint64_t Size) const {
+    for (const Elf_Phdr &Segment : Segments) {
+      if (Segment.p_type != ELF::PT_LOAD)
+        continue;
+
+      uint64_t Start = Segment.p_vaddr;
+      uint64_t End = Start + Segment.p_filesz;
+      if (Start <= Address and Size <= End - Start and Address <= End - Size) {
+        uint64_t Offset = Segment.p_offset + (Address - Start);
+        if (Offset + Size > Data.size())
+          break;
+        return Offset;
+      }
+    }
+
+    return createError("Address 0x" + utohexstr(Address)
+                       + " is not mapped in the file");
+  }
+
+  Expected<ArrayRef<uint8_t>> read(uint64_t Address, uint64_t Size) const {
+    if (Size == 0)
+      return ArrayRef<uint8_t>();
+
+    auto MaybeOffset = offsetOf(Address, Size);
+    if (not MaybeOffset)
+      return MaybeOffset.takeError();
+    return Data.slice(*MaybeOffset, Size);
+  }
+
+  /// Read the table starting at the value of \p AddressTag and as large as
+  /// \p Scale times the value of \p SizeTag, if any, or \p Scale otherwise
+  Expected<ArrayRef<uint8_t>> readTable(uint64_t AddressTag,
+                                        std::optional<uint64_t> SizeTag,
+                                        uint64_t Scale = 1) const {
+    uint64_t Size = Scale;
+    if (SizeTag) {
+      auto MaybeSize = tag(*SizeTag);
+      if (not MaybeSize)
+        return ArrayRef<uint8_t>();
+      Size *= *MaybeSize;
+    }
+
+    if (auto MaybeAddress = tag(AddressTag))
+      return read(*MaybeAddress, Size);
+    return ArrayRef<uint8_t>();
+  }
+
+  template<typename T>
+  Expected<T> readStruct(uint64_t Offset) const {
+    if (Offset + sizeof(T) > Data.size())
+      return createError("Truncated structure at offset 0x"
+                         + utohexstr(Offset));
+
+    T Result;
+    memcpy(&Result, Data.data() + Offset, sizeof(T));
+    return Result;
+  }
+
+  template<typename T>
+  static Expected<std::vector<T>> parseArray(ArrayRef<uint8_t> Bytes) {
+    if (Bytes.size() % sizeof(T) != 0)
+      return createError("Table size is not a multiple of its entries size");
+
+    std::vector<T> Result(Bytes.size() / sizeof(T));
+    if (not Bytes.empty())
+      memcpy(Result.data(), Bytes.data(), Bytes.size());
+    return Result;
+  }
+
+  const Elf_Phdr *segmentByRange(uint64_t Address, uint64_t Size) const {
+    auto Overlaps = [&](const Elf_Phdr &Segment) {
+      return Segment.p_type == ELF::PT_LOAD
+             and Address + Size >= Segment.p_vaddr
+             and Segment.p_vaddr + Segment.p_memsz >= Address;
+    };
+
+    auto It = llvm::find_if(Segments, Overlaps);
+    return It == Segments.end() ? nullptr : &*It;
+  }
+
+private:
+  Error parseDynamic() {
+    auto MaybeSegments = File.program_headers();
+    if (not MaybeSegments)
+      return MaybeSegments.takeError();
+    Segments.assign(MaybeSegments->begin(), MaybeSegments->end());
+
+    for (const Elf_Phdr &Segment : Segments)
+      if (Segment.p_type == ELF::PT_DYNAMIC)
+        Dynamic = &Segment;
+
+    IsDynamic = Dynamic != nullptr;
+    if (not IsDynamic)
+      return Error::success();
+
+    auto MaybeSections = File.sections();
+    if (not MaybeSections)
+      return MaybeSections.takeError();
+    Sections.assign(MaybeSections->begin(), MaybeSections->end());
+
+    auto MaybeNames = File.getSectionStringTable(*MaybeSections);
+    if (not MaybeNames)
+      return MaybeNames.takeError();
+
+    for (const Elf_Shdr &Section : Sections) {
+      auto MaybeName = File.getSectionName(Section, *MaybeNames);
+      if (not MaybeName)
+        return MaybeName.takeError();
+      SectionNames.push_back(*MaybeName);
+    }
+
+    // Collect the dynamic tags, up to and including DT_NULL
+    for (uint64_t Offset = Dynamic->p_offset;
+         Offset + sizeof(Elf_Dyn) <= Dynamic->p_offset + Dynamic->p_filesz;
+         Offset += sizeof(Elf_Dyn)) {
+      auto MaybeEntry = readStruct<Elf_Dyn>(Offset);
+      if (not MaybeEntry)
+        return MaybeEntry.takeError();
+
+      DynamicTags.push_back(*MaybeEntry);
+      if (MaybeEntry->getTag() == ELF::DT_NULL)
+        break;
+    }
+
+    auto PLTRel = tag(ELF::DT_PLTREL);
+    IsRela = (PLTRel and *PLTRel == ELF::DT_RELA)
+             or tag(ELF::DT_RELA).has_value();
+
+    auto MaybeDynStr = readTable(ELF::DT_STRTAB, ELF::DT_STRSZ);
+    if (not MaybeDynStr)
+      return MaybeDynStr.takeError();
+    DynStr = *MaybeDynStr;
+
+    auto MaybeRelDyn = IsRela ? readTable(ELF::DT_RELA, ELF::DT_RELASZ) :
+                                readTable(ELF::DT_REL, ELF::DT_RELSZ);
+    if (not MaybeRelDyn)
+      return MaybeRelDyn.takeError();
+    RelDyn = *MaybeRelDyn;
+
+    auto MaybeRelPLT = readTable(ELF::DT_JMPREL, ELF::DT_PLTRELSZ);
+    if (not MaybeRelPLT)
+      return MaybeRelPLT.takeError();
+
+    // The PLT relocations come first
+    for (ArrayRef<uint8_t> Table : { *MaybeRelPLT, RelDyn })
+      if (auto Err = parseRelocations(Table))
+        return Err;
+
+    // The dynamic loader only needs the symbols referenced by relocations
+    uint64_t SymbolsCount = 0;
+    for (const Relocation &R : Relocations)
+      SymbolsCount = std::max<uint64_t>(SymbolsCount, R.Symbol + 1);
+
+    auto MaybeDynSym = readTable(ELF::DT_SYMTAB, ELF::DT_SYMENT, SymbolsCount);
+    if (not MaybeDynSym)
+      return MaybeDynSym.takeError();
+    auto MaybeSymbols = parseArray<Elf_Sym>(*MaybeDynSym);
+    if (not MaybeSymbols)
+      return MaybeSymbols.takeError();
+    Symbols = std::move(*MaybeSymbols);
+
+    auto MaybeVersions = readTable(ELF::DT_VERSYM,
+                                   std::nullopt,
+                                   SymbolsCount * sizeof(uint16_t));
+    if (not MaybeVersions)
+      return MaybeVersions.takeError();
+    for (size_t I = 0; I < MaybeVersions->size(); I += sizeof(uint16_t)) {
+      const uint8_t *Pointer = MaybeVersions->data() + I;
+      using namespace support;
+      VersionIndices.push_back(endian::read<uint16_t, ELFT::TargetEndianness>(
+        Pointer));
+    }
+
+    return parseVerneeds();
+  }
+
+  Error parseRelocations(ArrayRef<uint8_t> Table) {
+    bool IsMips64EL = isMips64EL();
+
+    if (IsRela) {
+      auto MaybeEntries = parseArray<Elf_Rela>(Table);
+      if (not MaybeEntries)
+        return MaybeEntries.takeError();
+
+      for (const Elf_Rela &Entry : *MaybeEntries)
+        Relocations.push_back({ Entry.r_offset,
+                                Entry.getSymbol(IsMips64EL),
+                                Entry.getType(IsMips64EL),
+                                Entry.r_addend });
+    } else {
+      auto MaybeEntries = parseArray<Elf_Rel>(Table);
+      if (not MaybeEntries)
+        return MaybeEntries.takeError();
+
+      for (const Elf_Rel &Entry : *MaybeEntries)
+        Relocations.push_back({ Entry.r_offset,
+                                Entry.getSymbol(IsMips64EL),
+                                Entry.getType(IsMips64EL),
+                                0 });
+    }
+
+    return Error::success();
+  }
+
+  Error parseVerneeds() {
+    auto MaybeAddress = tag(ELF::DT_VERNEED);
+    if (not MaybeAddress)
+      return Error::success();
+
+    auto MaybeOffset = offsetOf(*MaybeAddress, sizeof(Elf_Verneed));
+    if (not MaybeOffset)
+      return MaybeOffset.takeError();
+
+    uint64_t VerneedOffset = *MaybeOffset;
+    uint64_t Count = tag(ELF::DT_VERNEEDNUM).value_or(0);
+    for (uint64_t I = 0; I < Count; ++I) {
+      auto MaybeVerneed = readStruct<Elf_Verneed>(VerneedOffset);
+      if (not MaybeVerneed)
+        return MaybeVerneed.takeError();
+
+      Verneed &New = Verneeds.emplace_back(*MaybeVerneed,
+                                          std::vector<Elf_Vernaux>{});
+      uint64_t VernauxOffset = VerneedOffset + New.first.vn_aux;
+      for (uint64_t J = 0; J < New.first.vn_cnt; ++J) {
+        auto MaybeVernaux = readStruct<Elf_Vernaux>(VernauxOffset);
+        if (not MaybeVernaux)
+          return MaybeVernaux.takeError();
+
+        New.second.push_back(*MaybeVernaux);
+        VernauxOffset += MaybeVernaux->vna_next;
+      }
+
+      VerneedOffset += New.first.vn_next;
+    }
+
+    return Error::success();
+  }
+};
+
+/// Serialize \p Verneeds following their relative offsets, as the dynamic
+/// loader will walk them
+template<typename ELFT>
+static Buffer
+serializeVerneeds(ArrayRef<typename ParsedELF<ELFT>::Verneed> Verneeds) {
+  Buffer Result;
+
+  uint64_t VerneedOffset = 0;
+  for (const auto &[Verneed, Vernauxs] : Verneeds) {
+    Result.writeAt(VerneedOffset, Verneed);
+
+    uint64_t VernauxOffset = VerneedOffset + Verneed.vn_aux;
+    for (const auto &Vernaux : Vernauxs) {
+      Result.writeAt(VernauxOffset, Vernaux);
+      VernauxOffset += Vernaux.vna_next;
+    }
+
+    VerneedOffset += Verneed.vn_next;
+  }
+
+  return Result;
+}
+
+/// \return \p Entries without the first, null, entry, if any
+template<typename T>
+static ArrayRef<T> skipNull(ArrayRef<T> Entries) {
+  return Entries.empty() ? Entries : Entries.drop_front();
+}
+
+static Expected<uint32_t> getRelativeRelocation(unsigned Machine) {
+  switch (Machine) {
+  case ELF::EM_X86_64:
+    return ELF::R_X86_64_RELATIVE;
+  case ELF::EM_ARM:
+    return ELF::R_ARM_RELATIVE;
+  case ELF::EM_386:
+    return ELF::R_386_RELATIVE;
+  case ELF::EM_MIPS:
+    // TODO: check
+    return 0xFFFFFFFF;
+  case ELF::EM_S390:
+    return ELF::R_390_RELATIVE;
+  default:
+    return createError("Unknown machine: " + Twine(Machine));
+  }
+}
+
+/// Ordering of the program headers: PHDR and INTERP have to come first, then
+/// the LOAD segments sorted by address and then the rest
+template<typename Phdr>
+static auto programHeaderSortKey(const Phdr &Segment) {
+  unsigned Rank = 4;
+  switch (Segment.p_type) {
+  case ELF::PT_PHDR:
+    Rank = 1;
+    break;
+  case ELF::PT_INTERP:
+    Rank = 2;
+    break;
+  case ELF::PT_LOAD:
+    Rank = 3;
+    break;
+  }
+
+  return std::make_pair(Rank, uint64_t(Segment.p_vaddr));
+}
+
+/// Build an old-style (non-GNU) hash table with a single bucket pointing to
+/// the first defined symbol, which in turn points to the second one and so on,
+/// up to the last one, whose chain is 0. Basically, we transform a hash lookup
+/// in a linear search.
+///
+/// TODO: implement an actual hash table, possibly GNU
+template<typename ELFT>
+static Buffer buildDummyHashTable(uint32_t SymbolsCount,
+                                  ArrayRef<uint32_t> DefinedSymbols) {
+  std::vector<uint32_t> Chain(SymbolsCount, 0);
+  for (size_t I = 1; I < DefinedSymbols.size(); ++I)
+    Chain[DefinedSymbols[I - 1]] = DefinedSymbols[I];
+
+  using Word = support::detail::packed_endian_specific_integral<
+    uint32_t,
+    ELFT::TargetEndianness,
+    support::unaligned>;
+
+  Buffer Result;
+  Result.append(Word(1));
+  Result.append(Word(SymbolsCount));
+  Result.append(Word(DefinedSymbols.empty() ? 0 : DefinedSymbols.front()));
+  for (uint32_t Next : Chain)
+    Result.append(Word(Next));
+
+  return Result;
+}
+
+template<typename ELFT>
+static Error merge(const ParsedELF<ELFT> &ToExtend,
+                   const ParsedELF<ELFT> &Source,
+                   StringRef OutputPath,
+                   uint64_t BaseAddress,
+                   bool MergeLoadSegments) {
+  using uintX_t = typename ELFT::uint;
+  using Elf_Ehdr = typename ELFT::Ehdr;
+  using Elf_Shdr = typename ELFT::Shdr;
+  using Elf_Phdr = typename ELFT::Phdr;
+  using Elf_Sym = typename ELFT::Sym;
+  using Elf_Dyn = typename ELFT::Dyn;
+  using Elf_Rel = typename ELFT::Rel;
+  using Elf_Rela = typename ELFT::Rela;
+  using Elf_Vernaux = typename ELFT::Vernaux;
+  using Verneed = typename ParsedELF<ELFT>::Verneed;
+
+  const Elf_Ehdr &ToExtendHeader = ToExtend.File.getHeader();
+  const Elf_Ehdr &SourceHeader = Source.File.getHeader();
+  bool IsMips64EL = ToExtend.isMips64EL();
+  auto Flags = FileOutputBuffer::F_executable;
+
+  // If the original ELF was not dynamic, we don't have to do anything
+  if (not Source.IsDynamic) {
+    auto MaybeOutput = FileOutputBuffer::create(OutputPath,
+                                                ToExtend.Data.size(),
+                                                Flags);
+    if (not MaybeOutput)
+      return MaybeOutput.takeError();
+
+    llvm::copy(ToExtend.Data, (*MaybeOutput)->getBufferStart());
+    return (*MaybeOutput)->commit();
+  }
+
+  if (not ToExtend.IsDynamic)
+    return createError("The ELF to extend is not dynamic");
+
+  if (ToExtendHeader.e_machine != SourceHeader.e_machine)
+    return createError("The two ELFs have different architectures");
+
+  auto MaybeRelativeRelocation = getRelativeRelocation(ToExtendHeader
+                                                         .e_machine);
+  if (not MaybeRelativeRelocation)
+    return MaybeRelativeRelocation.takeError();
+  uint32_t RelativeRelocation = *MaybeRelativeRelocation;
+
+  uint64_t RelocationOffset = 0;
+  if (SourceHeader.e_type == ELF::ET_DYN)
+    RelocationOffset = BaseAddress;
+
+  //
+  // Build the new tables
+  //
+
+  // Prepare new .dynstr
+  if (ToExtend.DynStr.empty() or ToExtend.DynStr.back() != 0)
+    return createError(".dynstr of the ELF to extend is not NULL terminated");
+
+  uint64_t ToExtendDynStrSize = ToExtend.DynStr.size();
+  Buffer NewDynStr;
+  NewDynStr.append(ToExtend.DynStr);
+  NewDynStr.append(Source.DynStr);
+
+  // Prepare new .dynsym
+  std::vector<uint32_t> DefinedSymbols;
+  for (const auto &Entry : llvm::enumerate(ToExtend.Symbols))
+    if (Entry.value().st_shndx != ELF::SHN_UNDEF)
+      DefinedSymbols.push_back(Entry.index());
+
+  Buffer NewDynSym;
+  for (const Elf_Sym &Symbol : ToExtend.Symbols)
+    NewDynSym.append(Symbol);
+
+  uint32_t DynSymOffset = ToExtend.Symbols.size() - 1;
+  uint32_t SymbolsCount = ToExtend.Symbols.size();
+  for (const Elf_Sym &Original : skipNull<Elf_Sym>(Source.Symbols)) {
+    Elf_Sym Symbol = Original;
+    Symbol.st_name += ToExtendDynStrSize;
+    if (Symbol.st_value != 0)
+      Symbol.st_value += RelocationOffset;
+    if (Symbol.st_shndx != ELF::SHN_UNDEF)
+      DefinedSymbols.push_back(SymbolsCount);
+
+    NewDynSym.append(Symbol);
+    ++SymbolsCount;
+  }
+
+  // Prepare new .rel(a).dyn
+  Buffer NewRelDyn;
+  NewRelDyn.append(ToExtend.RelDyn);
+  for (Relocation R : Source.Relocations) {
+    if (R.Symbol != 0)
+      R.Symbol += DynSymOffset;
+    if (R.Type == RelativeRelocation)
+      R.Addend += RelocationOffset;
+    R.Offset += RelocationOffset;
+
+    if (Source.IsRela) {
+      Elf_Rela Entry;
+      Entry.r_offset = R.Offset;
+      Entry.setSymbolAndType(R.Symbol, R.Type, IsMips64EL);
+      Entry.r_addend = R.Addend;
+      NewRelDyn.append(Entry);
+    } else {
+      Elf_Rel Entry;
+      Entry.r_offset = R.Offset;
+      Entry.setSymbolAndType(R.Symbol, R.Type, IsMips64EL);
+      NewRelDyn.append(Entry);
+    }
+  }
+
+  // Shift the version indices of the original ELF after the highest one of
+  // the ELF to extend
+  uint16_t VersionIndexOffset = 0;
+  for (const Verneed &Entry : ToExtend.Verneeds)
+    for (const Elf_Vernaux &Vernaux : Entry.second)
+      VersionIndexOffset = std::max<uint16_t>(VersionIndexOffset,
+                                              Vernaux.vna_other);
+  VersionIndexOffset -= 1;
+
+  // Prepare new .gnu.version
+  using Half = support::detail::packed_endian_specific_integral<
+    uint16_t,
+    ELFT::TargetEndianness,
+    support::unaligned>;
+  Buffer NewVersions;
+  for (uint16_t Index : ToExtend.VersionIndices)
+    NewVersions.append(Half(Index));
+  for (uint16_t Index : skipNull<uint16_t>(Source.VersionIndices)) {
+    if (Index != ELF::VER_NDX_LOCAL and Index != ELF::VER_NDX_GLOBAL)
+      Index += VersionIndexOffset;
+    NewVersions.append(Half(Index));
+  }
+
+  // Prepare new .gnu.version_r: the verneeds of the original ELF follow the
+  // ones of the ELF to extend, with the names and the version indices
+  // adjusted
+  std::vector<Verneed> NewVerneeds = ToExtend.Verneeds;
+  if (not NewVerneeds.empty()) {
+    uint64_t LastOffset = 0;
+    for (const Verneed &Entry : NewVerneeds)
+      LastOffset += Entry.first.vn_next;
+
+    uint64_t Size = serializeVerneeds<ELFT>(NewVerneeds).size();
+    NewVerneeds.back().first.vn_next = Size - LastOffset;
+  }
+
+  for (Verneed Entry : Source.Verneeds) {
+    Entry.first.vn_file += ToExtendDynStrSize;
+    for (Elf_Vernaux &Vernaux : Entry.second) {
+      Vernaux.vna_name += ToExtendDynStrSize;
+      Vernaux.vna_other += VersionIndexOffset;
+    }
+    NewVerneeds.push_back(std::move(Entry));
+  }
+
+  // Explicitly ensure the last entry is marked as such
+  if (not NewVerneeds.empty())
+    NewVerneeds.back().first.vn_next = 0;
+
+  Buffer NewVerneedsTable = serializeVerneeds<ELFT>(NewVerneeds);
+
+  // Prepare new .hash
+  Buffer NewHash = buildDummyHashTable<ELFT>(SymbolsCount, DefinedSymbols);
+
+  //
+  // Lay out the new segment
+  //
+
+  // Each table is aligned to its natural alignment, relative to the start of
+  // the new segment, which is aligned to SegmentAlignment
+  uint64_t SegmentSize = 0;
+  auto Allocate = [&SegmentSize](uint64_t Size, uint64_t Alignment) {
+    uint64_t Result = alignTo(SegmentSize, Alignment);
+    SegmentSize = Result + Size;
+    return Result;
+  };
+
+  uint64_t WordSize = sizeof(uintX_t);
+  uint64_t DynamicSize = ToExtend.DynamicTags.size() * sizeof(Elf_Dyn);
+  uint64_t SectionHeadersSize = ToExtend.Sections.size() * sizeof(Elf_Shdr);
+
+  unsigned AdditionalSegmentsCount = 0;
+  if (MergeLoadSegments)
+    for (const Elf_Phdr &Segment : Source.Segments)
+      if (Segment.p_type == ELF::PT_LOAD)
+        ++AdditionalSegmentsCount;
+  unsigned SegmentsCount = ToExtend.Segments.size() + AdditionalSegmentsCount
+                           + 1;
+  uint64_t ProgramHeadersSize = SegmentsCount * sizeof(Elf_Phdr);
+
+  uint64_t DynStrStart = Allocate(NewDynStr.size(), 1);
+  uint64_t DynSymStart = Allocate(NewDynSym.size(), WordSize);
+  uint64_t RelDynStart = Allocate(NewRelDyn.size(), WordSize);
+  uint64_t VersionsStart = Allocate(NewVersions.size(), sizeof(uint16_t));
+  uint64_t VerneedsStart = Allocate(NewVerneedsTable.size(), sizeof(uint32_t));
+  uint64_t HashStart = Allocate(NewHash.size(), sizeof(uint32_t));
+  uint64_t DynamicStart = Allocate(DynamicSize, WordSize);
+  uint64_t SectionHeadersStart = Allocate(SectionHeadersSize, WordSize);
+  uint64_t ProgramHeadersStart = Allocate(ProgramHeadersSize, WordSize);
+
+  // Find a place for the new segment after all the others
+  uint64_t ToExtendSize = ToExtend.Data.size();
+  uint64_t LowestAddress = std::numeric_limits<uint64_t>::max();
+  for (const Elf_Phdr &Segment : ToExtend.Segments)
+    if (Segment.p_type == ELF::PT_LOAD)
+      LowestAddress = std::min<uint64_t>(LowestAddress, Segment.p_vaddr);
+
+  uint64_t StartAddress = alignTo(LowestAddress + ToExtendSize,
+                                  SegmentAlignment);
+  auto FindOverlapping = [&]() {
+    if (auto *Segment = ToExtend.segmentByRange(StartAddress, SegmentSize))
+      return Segment;
+    return Source.segmentByRange(StartAddress, SegmentSize);
+  };
+
+  while (const Elf_Phdr *Overlapping = FindOverlapping()) {
+    revng_log(Log,
+              "Discarding 0x" << utohexstr(StartAddress)
+                              << " since it overlaps the segment at 0x"
+                              << utohexstr(Overlapping->p_vaddr));
+    StartAddress = alignTo(Overlapping->p_vaddr + Overlapping->p_memsz,
+                           SegmentAlignment);
+  }
+
+  uint64_t SegmentOffset = StartAddress - LowestAddress;
+  auto ToAddress = [&](uint64_t Start) { return StartAddress + Start; };
+  auto ToOffset = [&](uint64_t Start) { return SegmentOffset + Start; };
+
+  // Prepare new .dynamic
+  Buffer NewDynamic;
+  bool HasHash = false;
+  for (Elf_Dyn Entry : ToExtend.DynamicTags) {
+    switch (Entry.getTag()) {
+    case ELF::DT_STRTAB:
+      Entry.d_un.d_val = ToAddress(DynStrStart);
+      break;
+    case ELF::DT_STRSZ:
+      Entry.d_un.d_val = NewDynStr.size();
+      break;
+    case ELF::DT_REL:
+    case ELF::DT_RELA:
+      Entry.d_un.d_val = ToAddress(RelDynStart);
+      break;
+    case ELF::DT_RELSZ:
+    case ELF::DT_RELASZ:
+      Entry.d_un.d_val = NewRelDyn.size();
+      break;
+    case ELF::DT_SYMTAB:
+      Entry.d_un.d_val = ToAddress(DynSymStart);
+      break;
+    case ELF::DT_VERNEED:
+      Entry.d_un.d_val = ToAddress(VerneedsStart);
+      break;
+    case ELF::DT_VERNEEDNUM:
+      Entry.d_un.d_val = NewVerneeds.size();
+      break;
+    case ELF::DT_VERSYM:
+      Entry.d_un.d_val = ToAddress(VersionsStart);
+      break;
+    case ELF::DT_HASH:
+    case ELF::DT_GNU_HASH:
+      // Both are replaced by the new table: if both are present, emit DT_HASH
+      // only once
+      if (HasHash)
+        continue;
+      HasHash = true;
+      Entry.d_tag = ELF::DT_HASH;
+      Entry.d_un.d_val = ToAddress(HashStart);
+      break;
+    }
+    NewDynamic.append(Entry);
+  }
+
+  // Keep the size .dynamic has been allocated, padding it with DT_NULL
+  while (NewDynamic.size() < DynamicSize) {
+    Elf_Dyn Null;
+    Null.d_tag = ELF::DT_NULL;
+    Null.d_un.d_val = 0;
+    NewDynamic.append(Null);
+  }
+  revng_assert(NewDynamic.size() == DynamicSize);
+
+  // Prepare new section headers
+  Buffer NewSectionHeaders;
+  for (const auto &[Original, Name] :
+       llvm::zip(ToExtend.Sections, ToExtend.SectionNames)) {
+    Elf_Shdr Section = Original;
+    auto Relocate = [&](uint64_t Start, uint64_t Size) {
+      Section.sh_addr = ToAddress(Start);
+      Section.sh_offset = ToOffset(Start);
+      Section.sh_size = Size;
+    };
+
+    if (Name == ".dynstr") {
+      Relocate(DynStrStart, NewDynStr.size());
+    } else if (Name == ".dynsym") {
+      Relocate(DynSymStart, NewDynSym.size());
+    } else if (Name == ".rela.dyn" or Name == ".rel.dyn") {
+      Relocate(RelDynStart, NewRelDyn.size());
+    } else if (Name == ".dynamic") {
+      Relocate(DynamicStart, NewDynamic.size());
+    } else if (Name == ".gnu.version") {
+      Relocate(VersionsStart, NewVersions.size());
+    } else if (Name == ".gnu.version_r") {
+      Relocate(VerneedsStart, NewVerneedsTable.size());
+      Section.sh_info = NewVerneeds.size();
+    }
+
+    NewSectionHeaders.append(Section);
+  }
+
+  // Prepare new program headers
+  std::vector<Elf_Phdr> NewSegments = ToExtend.Segments;
+  std::vector<std::pair<uint64_t, ArrayRef<uint8_t>>> AdditionalSegments;
+  uint64_t OutputSize = ToOffset(SegmentSize);
+
+  if (MergeLoadSegments) {
+    for (const Elf_Phdr &Original : Source.Segments) {
+      if (Original.p_type != ELF::PT_LOAD)
+        continue;
+
+      auto MaybeContent = Source.read(Original.p_vaddr, Original.p_filesz);
+      if (not MaybeContent)
+        return MaybeContent.takeError();
+
+      // Preserve the congruence between offset and address
+      Elf_Phdr Segment = Original;
+      uint64_t Alignment = std::max<uint64_t>(Segment.p_align, 1);
+      uint64_t Offset = alignTo(OutputSize, SegmentAlignment);
+      Offset += (Segment.p_vaddr - Offset) % Alignment;
+      Segment.p_offset = Offset;
+      OutputSize = Offset + Segment.p_filesz;
+
+      NewSegments.push_back(Segment);
+      AdditionalSegments.emplace_back(Offset, *MaybeContent);
+    }
+  }
+
+  for (Elf_Phdr &Segment : NewSegments) {
+    auto Relocate = [&](uint64_t Start, uint64_t Size) {
+      Segment.p_filesz = Size;
+      Segment.p_memsz = Size;
+      Segment.p_paddr = ToAddress(Start);
+      Segment.p_vaddr = ToAddress(Start);
+      Segment.p_offset = ToOffset(Start);
+    };
+
+    if (Segment.p_type == ELF::PT_DYNAMIC)
+      Relocate(DynamicStart, NewDynamic.size());
+    else if (Segment.p_type == ELF::PT_PHDR)
+      Relocate(ProgramHeadersStart, ProgramHeadersSize);
+  }
+
+  Elf_Phdr NewSegment = {};
+  NewSegment.p_type = ELF::PT_LOAD;
+  NewSegment.p_offset = SegmentOffset;
+  NewSegment.p_flags = ELF::PF_R | ELF::PF_W;
+  NewSegment.p_vaddr = StartAddress;
+  NewSegment.p_paddr = StartAddress;
+  NewSegment.p_memsz = SegmentSize;
+  NewSegment.p_filesz = SegmentSize;
+  NewSegment.p_align = SegmentAlignment;
+  NewSegments.push_back(NewSegment);
+
+  llvm::stable_sort(NewSegments, [](const Elf_Phdr &A, const Elf_Phdr &B) {
+    return programHeaderSortKey(A) < programHeaderSortKey(B);
+  });
+
+  Buffer NewProgramHeaders;
+  for (const Elf_Phdr &Segment : NewSegments)
+    NewProgramHeaders.append(Segment);
+  revng_assert(NewProgramHeaders.size() == ProgramHeadersSize);
+
+  // Prepare new ELF header
+  Elf_Ehdr NewHeader = ToExtendHeader;
+  NewHeader.e_phnum = NewSegments.size();
+  NewHeader.e_phoff = ToOffset(ProgramHeadersStart);
+  NewHeader.e_shnum = ToExtend.Sections.size();
+  NewHeader.e_shoff = ToOffset(SectionHeadersStart);
+
+  //
+  // Write everything out, in order
+  //
+  auto MaybeOutput = FileOutputBuffer::create(OutputPath,
+                                              OutputSize,
+                                              Flags);
+  if (not MaybeOutput)
+    return MaybeOutput.takeError();
+
+  // The buffer is zero-initialized, we only need to fill in the content
+  uint8_t *Output = (*MaybeOutput)->getBufferStart();
+  llvm::copy(ToExtend.Data, Output);
+  memcpy(Output, &NewHeader, sizeof(NewHeader));
+
+  auto Write = [Output, &ToOffset](uint64_t Start, const Buffer &Content) {
+    llvm::copy(Content.bytes(), Output + ToOffset(Start));
+  };
+  Write(DynStrStart, NewDynStr);
+  Write(DynSymStart, NewDynSym);
+  Write(RelDynStart, NewRelDyn);
+  Write(VersionsStart, NewVersions);
+  Write(VerneedsStart, NewVerneedsTable);
+  Write(HashStart, NewHash);
+  Write(DynamicStart, NewDynamic);
+  Write(SectionHeadersStart, NewSectionHeaders);
+  Write(ProgramHeadersStart, NewProgramHeaders);
+
+  for (const auto &[Offset, Content] : AdditionalSegments)
+    llvm::copy(Content, Output + Offset);
+
+  return (*MaybeOutput)->commit();
+}
+
+template<typename ELFT>
+static Error merge(ArrayRef<uint8_t> ToExtendData,
+                   ArrayRef<uint8_t> SourceData,
+                   StringRef OutputPath,
+                   uint64_t BaseAddress,
+                   bool MergeLoadSegments) {
+  auto MaybeToExtend = ParsedELF<ELFT>::parse(ToExtendData);
+  if (not MaybeToExtend)
+    return MaybeToExtend.takeError();
+
+  auto MaybeSource = ParsedELF<ELFT>::parse(SourceData);
+  if (not MaybeSource)
+    return MaybeSource.takeError();
+
+  return merge<ELFT>(*MaybeToExtend,
+                     *MaybeSource,
+                     OutputPath,
+                     BaseAddress,
+                     MergeLoadSegments);
+}
+
+Error mergeDynamic(StringRef ToExtendPath,
+                   StringRef SourcePath,
+                   StringRef OutputPath,
+                   uint64_t BaseAddress,
+                   bool MergeLoadSegments) {
+  // Map both the inputs in memory
+  auto MaybeToExtend = MemoryBuffer::getFile(ToExtendPath);
+  if (not MaybeToExtend)
+    return errorCodeToError(MaybeToExtend.getError());
+
+  auto MaybeSource = MemoryBuffer::getFile(SourcePath);
+  if (not MaybeSource)
+    return errorCodeToError(MaybeSource.getError());
+
+  auto ToExtendData = arrayRefFromStringRef((*MaybeToExtend)->getBuffer());
+  auto SourceData = arrayRefFromStringRef((*MaybeSource)->getBuffer());
+
+  auto [Class, Encoding] = getElfArchType((*MaybeToExtend)->getBuffer());
+  if (getElfArchType((*MaybeSource)->getBuffer())
+      != std::make_pair(Class, Encoding))
+    return createError("The two ELFs have a different class or endianness");
+
+  auto Merge = [&]<typename ELFT>() {
+    return merge<ELFT>(ToExtendData,
+                       SourceData,
+                       OutputPath,
+                       BaseAddress,
+                       MergeLoadSegments);
+  };
+
+  bool IsLittleEndian = Encoding == ELF::ELFDATA2LSB;
+  if (Class == ELF::ELFCLASS32 and IsLittleEndian)
+    return Merge.operator()<ELF32LE>();
+  else if (Class == ELF::ELFCLASS32 and Encoding == ELF::ELFDATA2MSB)
+    return Merge.operator()<ELF32BE>();
+  else if (Class == ELF::ELFCLASS64 and IsLittleEndian)
+    return Merge.operator()<ELF64LE>();
+  else if (Class == ELF::ELFCLASS64 and Encoding == ELF::ELFDATA2MSB)
+    return Merge.operator()<ELF64BE>();
+  else
+    return createError("Invalid ELF class or endianness");
+}
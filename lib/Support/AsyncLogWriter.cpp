@@ -0,0 +1,170 @@
+/// \file AsyncLogWriter.cpp
+/// \brief Implementation of the background writer for log lines
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include "llvm/Support/MathExtras.h"
+
+#include "revng/Support/Assert.h"
+#include "revng/Support/AsyncLogWriter.h"
+
+/// \brief Single-producer single-consumer queue of length-prefixed lines
+///
+/// Head and Tail grow indefinitely, their value modulo the size of the buffer
+/// is the actual position.
+class AsyncLogWriter::RingBuffer {
+private:
+  using Length = uint32_t;
+
+private:
+  std::unique_ptr<char[]> Data;
+  size_t Size;
+
+  /// Written by the producer only
+  alignas(64) std::atomic<size_t> Head = 0;
+
+  /// Written by the consumer only
+  alignas(64) std::atomic<size_t> Tail = 0;
+
+public:
+  explicit RingBuffer(size_t Size) : Data(new char[Size]), Size(Size) {}
+
+public:
+  /// \brief Enqueue \p Line, waiting for room if necessary
+  void push(llvm::StringRef Line) {
+    Line = Line.take_front(Size - sizeof(Length));
+    Length LineLength = Line.size();
+    size_t Required = sizeof(Length) + LineLength;
+
+    size_t CurrentHead = Head.load(std::memory_order_relaxed);
+    while (Size - (CurrentHead - Tail.load(std::memory_order_acquire))
+           < Required)
+      std::this_thread::yield();
+
+    copyIn(CurrentHead, reinterpret_cast<const char *>(&LineLength),
+           sizeof(Length));
+    copyIn(CurrentHead + sizeof(Length), Line.data(), LineLength);
+    Head.store(CurrentHead + Required, std::memory_order_release);
+  }
+
+  /// \brief Write all the enqueued lines to \p Output
+  ///
+  /// \return true if at least a line has been written
+  bool pop(std::ostream &Output, std::string &Scratch) {
+    size_t CurrentTail = Tail.load(std::memory_order_relaxed);
+    size_t CurrentHead = Head.load(std::memory_order_acquire);
+    if (CurrentTail == CurrentHead)
+      return false;
+
+    while (CurrentTail != CurrentHead) {
+      Length LineLength = 0;
+      copyOut(CurrentTail, reinterpret_cast<char *>(&LineLength),
+              sizeof(Length));
+      Scratch.resize(LineLength);
+      copyOut(CurrentTail + sizeof(Length), Scratch.data(), LineLength);
+      Output << Scratch;
+      CurrentTail += sizeof(Length) + LineLength;
+    }
+
+    Tail.store(CurrentTail, std::memory_order_release);
+    return true;
+  }
+
+private:
+  void copyIn(size_t Position, const char *Source, size_t Count) {
+    size_t Offset = Position & (Size - 1);
+    size_t First = std::min(Count, Size - Offset);
+    memcpy(Data.get() + Offset, Source, First);
+    memcpy(Data.get(), Source + First, Count - First);
+  }
+
+  void copyOut(size_t Position, char *Destination, size_t Count) const {
+    size_t Offset = Position & (Size - 1);
+    size_t First = std::min(Count, Size - Offset);
+    memcpy(Destination, Data.get() + Offset, First);
+    memcpy(Destination + First, Data.get(), Count - First);
+  }
+};
+
+static std::atomic<uint64_t> NextWriterID = 1;
+
+AsyncLogWriter::AsyncLogWriter(std::ostream &Output, size_t RingBufferSize) :
+  Output(Output), RingBufferSize(RingBufferSize), ID(NextWriterID++) {
+  revng_assert(llvm::isPowerOf2_64(RingBufferSize));
+  revng_assert(RingBufferSize > sizeof(uint32_t));
+  Writer = std::thread([this] { run(); });
+}
+
+AsyncLogWriter::~AsyncLogWriter() {
+  Stop.store(true);
+  Writer.join();
+  drain();
+}
+
+void AsyncLogWriter::write(llvm::StringRef Line) {
+  getRingBuffer().push(Line);
+}
+
+void AsyncLogWriter::drain() {
+  std::lock_guard<std::mutex> Guard(DrainLock);
+  while (drainOnce())
+    ;
+}
+
+AsyncLogWriter::RingBuffer &AsyncLogWriter::getRingBuffer() {
+  // The ring buffers of the current thread, one for each writer it has used.
+  // Writers are identified by ID rather than by address, since a new writer
+  // might be allocated where a destroyed one used to be.
+  thread_local std::vector<std::pair<uint64_t, RingBuffer *>> Cache;
+  for (auto &[WriterID, Buffer] : Cache)
+    if (WriterID == ID)
+      return *Buffer;
+
+  std::lock_guard<std::mutex> Guard(RingBuffersLock);
+  RingBuffers.push_back(std::make_unique<RingBuffer>(RingBufferSize));
+  Cache.emplace_back(ID, RingBuffers.back().get());
+  return *RingBuffers.back();
+}
+
+bool AsyncLogWriter::drainOnce() {
+  // Consumers are serialized by DrainLock
+  std::vector<RingBuffer *> Snapshot;
+  {
+    std::lock_guard<std::mutex> Guard(RingBuffersLock);
+    Snapshot.reserve(RingBuffers.size());
+    for (const std::unique_ptr<RingBuffer> &Buffer : RingBuffers)
+      Snapshot.push_back(Buffer.get());
+  }
+
+  bool Written = false;
+  std::string Scratch;
+  for (RingBuffer *Buffer : Snapshot)
+    Written = Buffer->pop(Output, Scratch) or Written;
+
+  if (Written)
+    Output.flush();
+
+  return Written;
+}
+
+void AsyncLogWriter::run() {
+  using namespace std::chrono_literals;
+  while (not Stop.load()) {
+    bool Written = false;
+    {
+      std::lock_guard<std::mutex> Guard(DrainLock);
+      Written = drainOnce();
+    }
+
+    if (not Written)
+      std::this_thread::sleep_for(1ms);
+  }
+}
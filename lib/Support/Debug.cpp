@@ -6,13 +6,18 @@
 //
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <vector>
 
 #include "llvm/ADT/Twine.h"
 #include "llvm/IR/Value.h"
 
+#include "revng/Support/AsyncLogWriter.h"
 #include "revng/Support/Debug.h"
 
 namespace cl = llvm::cl;
@@ -26,6 +31,14 @@ static cl::opt<unsigned> MaxLocationLength("debug-location-max-length",
                                            cl::cat(MainCategory),
                                            cl::init(0));
 
+static cl::opt<bool> AsyncLog("debug-log-async",
+                              cl::desc("write log messages from a background "
+                                       "thread, prefixing them with a "
+                                       "timestamp and the thread emitting "
+                                       "them."),
+                              cl::cat(MainCategory),
+                              cl::init(false));
+
 size_t MaxLoggerNameLength = 0;
 llvm::ManagedStatic<LoggersRegistry> Loggers;
 
@@ -35,11 +48,44 @@ Logger<> PassesLog("passes");
 Logger<> ReleaseLog("release");
 Logger<> VerifyLog("verify");
 
+static const auto ProcessStart = std::chrono::steady_clock::now();
+
+static AsyncLogWriter &getAsyncLogWriter() {
+  static AsyncLogWriter Writer(dbg);
+  return Writer;
+}
+
+/// \return the prefix identifying when and from which thread a log line has
+///         been emitted
+static std::string getAsyncLogPrefix() {
+  static std::atomic<unsigned> NextThreadID = 0;
+  thread_local unsigned ThreadID = NextThreadID++;
+
+  using namespace std::chrono;
+  auto Elapsed = steady_clock::now() - ProcessStart;
+  auto Microseconds = duration_cast<microseconds>(Elapsed).count();
+
+  char Result[64];
+  snprintf(Result,
+           sizeof(Result),
+           "[%llu.%06llu T%u] ",
+           static_cast<unsigned long long>(Microseconds / 1000000),
+           static_cast<unsigned long long>(Microseconds % 1000000),
+           ThreadID);
+  return Result;
+}
+
 template<bool X>
 void Logger<X>::flush(const LogTerminator &LineInfo) {
   if (X && Enabled) {
+    std::stringstream Output;
     std::string Pad;
 
+    std::string Prefix;
+    if (AsyncLog)
+      Prefix = getAsyncLogPrefix();
+    Output << Prefix;
+
     if (MaxLocationLength != 0) {
       std::string Suffix = (Twine(":") + Twine(LineInfo.Line)).str();
       revng_assert(Suffix.size() < MaxLocationLength);
@@ -54,12 +100,12 @@ void Logger<X>::flush(const LogTerminator &LineInfo) {
 
       Pad = std::string(MaxLocationLength - Location.size() - Suffix.size(),
                         ' ');
-      dbg << "[" << Location << Suffix << Pad << "] ";
+      Output << "[" << Location << Suffix << Pad << "] ";
     }
 
     Pad = std::string(MaxLoggerNameLength - Name.size(), ' ');
-    dbg << "[" << Name.data() << Pad << "] ";
-    dbg << std::string(IndentLevel * 2, ' ');
+    Output << "[" << Name.data() << Pad << "] ";
+    Output << std::string(IndentLevel * 2, ' ');
 
     std::string Data = Buffer.str();
     if (Data.size() > 0 and Data.back() == '\n')
@@ -68,17 +114,24 @@ void Logger<X>::flush(const LogTerminator &LineInfo) {
     std::string Delimiter = "\n";
     size_t Start = 0;
     size_t End = Data.find(Delimiter);
-    dbg << Data.substr(Start, End) << "\n";
+    Output << Data.substr(Start, End) << "\n";
 
     if (End != std::string::npos) {
-      Pad = std::string(3 + MaxLoggerNameLength + IndentLevel * 2, ' ');
+      Pad = std::string(Prefix.size() + 3 + MaxLoggerNameLength
+                          + IndentLevel * 2,
+                        ' ');
       do {
         Start = End + Delimiter.length();
         End = Data.find(Delimiter, Start);
-        dbg << Pad << Data.substr(Start, End - Start) << "\n";
+        Output << Pad << Data.substr(Start, End - Start) << "\n";
       } while (End != std::string::npos);
     }
 
+    if (AsyncLog)
+      getAsyncLogWriter().write(Output.str());
+    else
+      dbg << Output.str();
+
     Buffer.str("");
     Buffer.clear();
   }
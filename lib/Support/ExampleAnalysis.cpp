@@ -62,6 +62,7 @@ public:
   size_t successor_size(Label *, Interrupt &) const { revng_abort(); }
   Interrupt createSummaryInterrupt() { revng_abort(); }
   Interrupt createNoReturnInterrupt() const { revng_abort(); }
+  Interrupt createBudgetExhaustedInterrupt() { revng_abort(); }
   LatticeElement extremalValue(Label *) const { revng_abort(); }
   Interrupt transfer(Label *) { revng_abort(); }
 };
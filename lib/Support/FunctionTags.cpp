@@ -5,9 +5,10 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
-#include <map>
+#include <vector>
 
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/InstrTypes.h"
 #include "llvm/IR/Metadata.h"
@@ -21,10 +22,44 @@ using namespace llvm;
 
 namespace FunctionTags {
 
+namespace {
+
+/// Index of all the Tags by ID and by name, built once all of them exist
+struct TagsIndex {
+  std::vector<const Tag *> ByID;
+  llvm::StringMap<const Tag *> ByName;
+
+  TagsIndex() {
+    for (const Tag *T : Tag::getAll()) {
+      size_t ID = T->id();
+      if (ID >= ByID.size())
+        ByID.resize(ID + 1, nullptr);
+      ByID[ID] = T;
+
+      bool New = ByName.try_emplace(T->name(), T).second;
+      revng_assert(New);
+    }
+  }
+};
+
+} // namespace
+
+static ManagedStatic<TagsIndex> Index;
+
+const Tag &Tag::fromID(size_t ID) {
+  revng_assert(ID < Index->ByID.size() and Index->ByID[ID] != nullptr);
+  return *Index->ByID[ID];
+}
+
+const Tag *Tag::fromName(StringRef Name) {
+  auto It = Index->ByName.find(Name);
+  return It == Index->ByName.end() ? nullptr : It->second;
+}
+
 llvm::MDNode *TagsSet::getMetadata(LLVMContext &C) const {
   SmallVector<Metadata *, 8> MDTags;
-  for (const Tag *T : Tags)
-    MDTags.push_back(MDString::get(C, T->name()));
+  for (unsigned ID : Tags.set_bits())
+    MDTags.push_back(MDString::get(C, Tag::fromID(ID).name()));
   return MDTuple::get(C, MDTags);
 }
 
@@ -36,9 +71,9 @@ TagsSet TagsSet::from(const MDNode *MD) {
 
   for (const MDOperand &Op : cast<MDTuple>(MD)->operands()) {
     StringRef Name = cast<MDString>(Op.get())->getString();
-    Tag *T = Tag::findByName(Name);
+    const Tag *T = Tag::fromName(Name);
     revng_assert(T != nullptr);
-    Result.Tags.insert(T);
+    Result.insertExactly(T->id());
   }
 
   return Result;
@@ -6,6 +6,8 @@
 //
 
 #include <fstream>
+#include <optional>
+#include <utility>
 
 #include "llvm/Support/raw_os_ostream.h"
 
@@ -89,7 +91,29 @@ Constant *getUniqueString(Module *M,
   return ConstantExpr::getBitCast(NewVariable, Int8PtrTy);
 }
 
-CallInst *getLastNewPC(Instruction *TheInstruction) {
+/// \return the information about the guest instruction marked by \p I, if any
+static std::optional<std::pair<MetaAddress, uint64_t>>
+getPCMarker(Instruction &I, bool CallsOnly) {
+  if (CallInst *Marker = getCallTo(&I, "newpc")) {
+    return std::pair{ MetaAddress::fromConstant(Marker->getArgOperand(0)),
+                      getLimitedValue(Marker->getArgOperand(1)) };
+  }
+
+  if (not CallsOnly) {
+    if (auto *MD = dyn_cast_or_null<MDTuple>(I.getMetadata(NewPCMDName))) {
+      auto *PC = cast<ConstantAsMetadata>(MD->getOperand(0))->getValue();
+      auto *Size = cast<ConstantAsMetadata>(MD->getOperand(1))->getValue();
+      return std::pair{ MetaAddress::fromConstant(PC), getLimitedValue(Size) };
+    }
+  }
+
+  return std::nullopt;
+}
+
+/// \brief Find the last instruction marking a guest instruction before
+///        \p TheInstruction
+static Instruction *getLastPCMarker(Instruction *TheInstruction,
+                                    bool CallsOnly) {
   std::set<BasicBlock *> Visited;
   std::queue<BasicBlock::reverse_iterator> WorkList;
 
@@ -108,8 +132,8 @@ CallInst *getLastNewPC(Instruction *TheInstruction) {
 
     // Go through the instructions looking for calls to newpc
     for (; I != End; I++)
-      if (CallInst *Marker = getCallTo(&*I, "newpc"))
-        return Marker;
+      if (getPCMarker(*I, CallsOnly))
+        return &*I;
 
     // If we didn't find a newpc call yet, continue exploration backward
     // If one of the predecessors is the dispatcher, don't explore any further
@@ -128,17 +152,26 @@ CallInst *getLastNewPC(Instruction *TheInstruction) {
   return nullptr;
 }
 
+CallInst *getLastNewPC(Instruction *TheInstruction) {
+  return cast_or_null<CallInst>(getLastPCMarker(TheInstruction, true));
+}
+
 std::pair<MetaAddress, uint64_t> getPC(Instruction *TheInstruction) {
-  CallInst *NewPCCall = getLastNewPC(TheInstruction);
+  // An instruction marked with metadata belongs to the guest instruction it
+  // marks, unlike calls to newpc, which precede the instructions they mark
+  auto Marker = getPCMarker(*TheInstruction, false);
+  if (not Marker or isCallTo(TheInstruction, "newpc")) {
+    Instruction *Last = getLastPCMarker(TheInstruction, false);
+
+    // Couldn't find the current PC
+    if (Last == nullptr)
+      return { MetaAddress::invalid(), 0 };
 
-  // Couldn't find the current PC
-  if (NewPCCall == nullptr)
-    return { MetaAddress::invalid(), 0 };
+    Marker = getPCMarker(*Last, false);
+  }
 
-  auto PC = MetaAddress::fromConstant(NewPCCall->getArgOperand(0));
-  uint64_t Size = getLimitedValue(NewPCCall->getArgOperand(1));
-  revng_assert(Size != 0);
-  return { PC, Size };
+  revng_assert(Marker->second != 0);
+  return *Marker;
 }
 
 /// Boring code to get the text of the metadata with the specified kind
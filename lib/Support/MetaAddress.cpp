@@ -5,6 +5,9 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <array>
+#include <cstring>
+
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Module.h"
@@ -108,22 +111,120 @@ MetaAddress MetaAddress::decomposeIntegerPC(ConstantInt *Value) {
 
 #define SEP ":"
 
-std::string MetaAddress::toString() const {
-  if (isInvalid())
-    return SEP "Invalid";
-
-  std::string Result;
-  {
-    raw_string_ostream Stream(Result);
-    Stream << "0x" << Twine::utohexstr(Address) << SEP
-           << MetaAddressType::toString(type());
-    if (not isDefaultEpoch())
-      Stream << SEP << Epoch;
-    if (not isDefaultAddressSpace())
-      Stream << SEP << AddressSpace;
+namespace {
+
+/// \brief Appends characters to a fixed size buffer
+class CharsWriter {
+private:
+  char *Current;
+  char *End;
+  bool Overflow = false;
+
+public:
+  CharsWriter(char *First, char *Last) : Current(First), End(Last) {}
+
+public:
+  void append(StringRef String) {
+    if (Overflow or static_cast<size_t>(End - Current) < String.size()) {
+      Overflow = true;
+      return;
+    }
+
+    memcpy(Current, String.data(), String.size());
+    Current += String.size();
+  }
+
+  /// Append \p Value in base \p Base, using lower case digits
+  template<unsigned Base>
+  void append(uint64_t Value) {
+    char Digits[64];
+    char *DigitsEnd = Digits + sizeof(Digits);
+    char *First = DigitsEnd;
+    do {
+      *--First = "0123456789abcdef"[Value % Base];
+      Value /= Base;
+    } while (Value != 0);
+
+    append(StringRef(First, DigitsEnd - First));
+  }
+
+  /// \return the end of the written characters, nullptr in case of overflow
+  char *finish() const { return Overflow ? nullptr : Current; }
+};
+
+} // namespace
+
+char *MetaAddress::toChars(char *First, char *Last) const {
+  CharsWriter Writer(First, Last);
+
+  if (isInvalid()) {
+    Writer.append(SEP "Invalid");
+    return Writer.finish();
+  }
+
+  Writer.append("0x");
+  Writer.append<16>(Address);
+  Writer.append(SEP);
+  Writer.append(MetaAddressType::toString(type()));
+  if (not isDefaultEpoch()) {
+    Writer.append(SEP);
+    Writer.append<10>(Epoch);
   }
 
+  if (not isDefaultAddressSpace()) {
+    Writer.append(SEP);
+    Writer.append<10>(AddressSpace);
+  }
+
+  return Writer.finish();
+}
+
+std::string MetaAddress::toString() const {
+  char Buffer[MaxStringLength];
+  char *End = toChars(Buffer, Buffer + MaxStringLength);
+  revng_assert(End != nullptr);
+  return std::string(Buffer, End);
+}
+
+/// The value of each hexadecimal digit, 0x10 for the other characters
+static constexpr std::array<uint8_t, 256> HexDigits = [] {
+  std::array<uint8_t, 256> Result{};
+  for (uint8_t &Entry : Result)
+    Entry = 0x10;
+  for (unsigned I = 0; I < 10; ++I)
+    Result['0' + I] = I;
+  for (unsigned I = 0; I < 6; ++I) {
+    Result['a' + I] = 10 + I;
+    Result['A' + I] = 10 + I;
+  }
   return Result;
+}();
+
+/// Parse \p Text in the format accepted by StringRef::getAsInteger with radix
+/// 0, handling the hexadecimal numbers that fit \p T without going through
+/// APInt
+template<typename T>
+static bool parseInteger(StringRef Text, T &Result) {
+  if (Text.size() > 2 and Text.size() <= 2 + 2 * sizeof(T)
+      and Text.startswith("0x")) {
+    // Accumulate the invalid digits, rather than checking each of them, to
+    // keep the loop free of unpredictable branches
+    T Value = 0;
+    uint8_t Invalid = 0;
+    for (char C : Text.drop_front(2)) {
+      uint8_t Digit = HexDigits[static_cast<uint8_t>(C)];
+      Invalid |= Digit;
+      Value = (Value << 4) | (Digit & 0xF);
+    }
+
+    if (Invalid & 0x10)
+      return false;
+
+    Result = Value;
+    return true;
+  }
+
+  return not Text.getAsInteger(0, Result);
 }
 
 MetaAddress MetaAddress::fromString(StringRef Text) {
@@ -132,36 +233,31 @@ MetaAddress MetaAddress::fromString(StringRef Text) {
 
   MetaAddress Result;
 
-  SmallVector<StringRef, 4> Parts;
-  Text.split(Parts, SEP);
+  // Split the (at most) four parts by hand, without building a vector
+  constexpr char Separator = SEP[0];
+  auto [AddressPart, Rest] = Text.split(Separator);
+  auto [TypePart, OptionalParts] = Rest.split(Separator);
+  auto [EpochPart, AddressSpacePart] = OptionalParts.split(Separator);
 
-  if (Parts.size() < 2 or Parts.size() > 4)
+  // There must be at least one separator, and at most three
+  if (AddressPart.size() == Text.size() or AddressSpacePart.contains(Separator))
     return MetaAddress::invalid();
 
-  bool Error;
-  uint64_t Value;
-
-  Error = Parts[0].getAsInteger(0, Result.Address);
-  if (Error)
+  if (not parseInteger(AddressPart, Result.Address))
     return MetaAddress::invalid();
 
-  Result.Type = MetaAddressType::fromString(Parts[1]);
+  Result.Type = MetaAddressType::fromString(TypePart);
   if (Result.type() == MetaAddressType::Invalid)
     return MetaAddress::invalid();
 
   Result.Epoch = 0;
-  if (Parts.size() >= 3 and Parts[2].size() > 0) {
-    Error = Parts[2].getAsInteger(0, Result.Epoch);
-    if (Error)
-      return MetaAddress::invalid();
-  }
+  if (EpochPart.size() > 0 and not parseInteger(EpochPart, Result.Epoch))
+    return MetaAddress::invalid();
 
   Result.AddressSpace = 0;
-  if (Parts.size() == 4 and Parts[3].size() > 0) {
-    Error = Parts[3].getAsInteger(0, Result.AddressSpace);
-    if (Error)
-      return MetaAddress::invalid();
-  }
+  if (AddressSpacePart.size() > 0
+      and not parseInteger(AddressSpacePart, Result.AddressSpace))
+    return MetaAddress::invalid();
 
   Result.validate();
 
@@ -2,6 +2,12 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+
 #include "revng/Support/Assert.h"
 #include "revng/Support/Debug.h"
 #include "revng/Support/PathList.h"
@@ -24,40 +30,93 @@ std::string getCurrentExecutableFullPath() {
   return FullPath.str().str();
 }
 
-static std::optional<std::string>
-findFileInPaths(const std::string &FileName,
-                const std::vector<std::string> &SearchPaths) {
+/// \return true if \p FullFileName exists and can be accessed
+static bool probe(llvm::StringRef FullFileName) {
+  LoggerIndent<> Indent(Log);
+
+  if (not llvm::sys::fs::exists(FullFileName)) {
+    revng_log(Log, "File not found: " << FullFileName.str());
+    return false;
+  }
 
-  std::optional<std::string> FoundFileName;
+  std::error_code
+    Err = llvm::sys::fs::access(FullFileName,
+                                llvm::sys::fs::AccessMode::Exist);
+  if (Err) {
+    revng_log(Log, "Cannot access file: " << FullFileName.str());
+    return false;
+  }
 
+  revng_log(Log, "Found file: " << FullFileName.str());
+  return true;
+}
+
+void PathList::loadIndexes() const {
+  Indexes.emplace();
   for (const auto &Path : SearchPaths) {
+    llvm::SmallString<64> IndexPath;
+    llvm::sys::path::append(IndexPath, Path, IndexFileName);
+
+    auto MaybeBuffer = llvm::MemoryBuffer::getFile(IndexPath);
+    if (not MaybeBuffer) {
+      Indexes->emplace_back();
+      continue;
+    }
+
+    revng_log(Log, "Using index " << IndexPath.str().str());
+    llvm::SmallVector<llvm::StringRef, 128> Lines;
+    (*MaybeBuffer)->getBuffer().split(Lines, '\n', -1, false);
+
+    Index &NewIndex = Indexes->emplace_back().emplace();
+    for (llvm::StringRef Line : Lines)
+      NewIndex.insert(Line.trim().str());
+  }
+}
+
+std::optional<std::string>
+PathList::findFileImpl(const std::string &FileName) const {
+  if (not Indexes.has_value())
+    loadIndexes();
+
+  // Look first in the search paths according to their index, probing those
+  // without one
+  for (const auto &[Path, MaybeIndex] : llvm::zip(SearchPaths, *Indexes)) {
+    if (MaybeIndex.has_value() and MaybeIndex->count(FileName) == 0)
+      continue;
+
     revng_log(Log, "Looking in path: " << Path);
     llvm::SmallString<64> FullFileName;
     llvm::sys::path::append(FullFileName, Path, FileName);
+    if (probe(FullFileName))
+      return FullFileName.str().str();
+  }
 
-    LoggerIndent<> Indent(Log);
-
-    if (not llvm::sys::fs::exists(FullFileName)) {
-      revng_log(Log, "File not found: " << FullFileName.str().str());
+  // The indexes might be stale, probe the search paths they ruled out
+  for (const auto &[Path, MaybeIndex] : llvm::zip(SearchPaths, *Indexes)) {
+    if (not MaybeIndex.has_value() or MaybeIndex->count(FileName) != 0)
       continue;
-    }
 
-    std::error_code
-      Err = llvm::sys::fs::access(FullFileName,
-                                  llvm::sys::fs::AccessMode::Exist);
-    if (Err) {
-      revng_log(Log, "Cannot access file: " << FullFileName.str().str());
-    } else {
-      revng_log(Log, "Found file: " << FullFileName.str().str());
-      FoundFileName = FullFileName.str().str();
-      break;
-    }
+    revng_log(Log, "Looking in path not indexing the file: " << Path);
+    llvm::SmallString<64> FullFileName;
+    llvm::sys::path::append(FullFileName, Path, FileName);
+    if (probe(FullFileName))
+      return FullFileName.str().str();
   }
 
-  return FoundFileName;
+  return std::nullopt;
 }
 
 std::optional<std::string>
 PathList::findFile(const std::string &FileName) const {
-  return findFileInPaths(FileName, SearchPaths);
+  std::lock_guard Guard(Lock);
+
+  auto It = Cache.find(FileName);
+  if (It != Cache.end()) {
+    revng_log(Log, "Cached lookup for " << FileName);
+    return It->second;
+  }
+
+  auto Result = findFileImpl(FileName);
+  Cache[FileName] = Result;
+  return Result;
 }
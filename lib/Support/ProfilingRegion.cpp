@@ -0,0 +1,222 @@
+/// \file ProfilingRegion.cpp
+/// \brief Implementation of the backends of ProfilingRegion
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <cstring>
+#include <mutex>
+
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#include "llvm/Support/CommandLine.h"
+
+#include "revng/Support/Callgrind.h"
+#include "revng/Support/CommandLine.h"
+#include "revng/Support/Debug.h"
+#include "revng/Support/ProfilingRegion.h"
+#include "revng/Support/Statistics.h"
+
+namespace cl = llvm::cl;
+
+using Counters = ProfilingRegion::Counters;
+
+enum class RegionsBackend { None, Callgrind, Perf };
+
+using RB = RegionsBackend;
+
+static cl::opt<RB> Backend("profile-regions",
+                           cl::desc("how to profile the regions of code "
+                                    "marked for it"),
+                           cl::values(clEnumValN(RB::None,
+                                                 "none",
+                                                 "do not profile"),
+                                      clEnumValN(RB::Callgrind,
+                                                 "callgrind",
+                                                 "enable callgrind "
+                                                 "instrumentation only "
+                                                 "within regions"),
+                                      clEnumValN(RB::Perf,
+                                                 "perf",
+                                                 "collect hardware counters "
+                                                 "through perf_event_open")),
+                           cl::init(RB::None),
+                           cl::cat(MainCategory));
+
+static Logger<> Log("profiling-regions");
+
+static CounterMap<std::string> Calls("profiling-regions-calls");
+static CounterMap<std::string> CyclesMap("profiling-regions-cycles");
+static CounterMap<std::string> InstructionsMap("profiling-regions-"
+                                               "instructions");
+static CounterMap<std::string> CacheMissesMap("profiling-regions-cache-misses");
+static CounterMap<std::string> BranchMissesMap("profiling-regions-branch-"
+                                               "misses");
+
+static std::array<CounterMap<std::string> *, ProfilingRegion::CountersCount>
+  CounterMaps = { &CyclesMap, &InstructionsMap, &CacheMissesMap,
+                  &BranchMissesMap };
+
+/// How many regions the current thread is in
+static thread_local unsigned Depth = 0;
+
+namespace {
+
+/// \brief The hardware counters of the current thread, as a perf event group
+class PerfCounters {
+private:
+  int Leader = -1;
+  std::array<int, ProfilingRegion::CountersCount> FDs;
+
+  /// The position of each counter in the values of the group, -1 if the
+  /// counter is not supported
+  std::array<int, ProfilingRegion::CountersCount> Slots;
+
+public:
+  PerfCounters() {
+    FDs.fill(-1);
+    Slots.fill(-1);
+    open();
+  }
+
+  ~PerfCounters() {
+    for (int FD : FDs)
+      if (FD >= 0)
+        close(FD);
+  }
+
+  PerfCounters(const PerfCounters &) = delete;
+  PerfCounters &operator=(const PerfCounters &) = delete;
+
+public:
+  /// \return the counters of the current thread, 0 for the unsupported ones
+  Counters read() const {
+    Counters Result = {};
+    if (Leader < 0)
+      return Result;
+
+    // With PERF_FORMAT_GROUP, the number of values comes first
+    std::array<uint64_t, ProfilingRegion::CountersCount + 1> Values = {};
+    if (::read(Leader, Values.data(), sizeof(Values)) <= 0)
+      return Result;
+
+    for (size_t I = 0; I < Result.size(); ++I)
+      if (Slots[I] >= 0 and static_cast<uint64_t>(Slots[I]) < Values[0])
+        Result[I] = Values[1 + Slots[I]];
+
+    return Result;
+  }
+
+private:
+  void open() {
+#ifdef __linux__
+    static constexpr std::array<uint64_t, ProfilingRegion::CountersCount>
+      Configs = { PERF_COUNT_HW_CPU_CYCLES,
+                  PERF_COUNT_HW_INSTRUCTIONS,
+                  PERF_COUNT_HW_CACHE_MISSES,
+                  PERF_COUNT_HW_BRANCH_MISSES };
+
+    int Opened = 0;
+    for (size_t I = 0; I < Configs.size(); ++I) {
+      perf_event_attr Attributes;
+      std::memset(&Attributes, 0, sizeof(Attributes));
+      Attributes.size = sizeof(Attributes);
+      Attributes.type = PERF_TYPE_HARDWARE;
+      Attributes.config = Configs[I];
+      Attributes.disabled = Leader < 0;
+      Attributes.exclude_kernel = 1;
+      Attributes.exclude_hv = 1;
+      Attributes.read_format = PERF_FORMAT_GROUP;
+
+      // Count the current thread only, on any CPU
+      long FD = syscall(SYS_perf_event_open, &Attributes, 0, -1, Leader, 0);
+      if (FD < 0)
+        continue;
+
+      FDs[I] = FD;
+      Slots[I] = Opened++;
+      if (Leader < 0)
+        Leader = FD;
+    }
+
+    if (Leader < 0) {
+      static std::once_flag Warned;
+      std::call_once(Warned, [] {
+        revng_log(Log,
+                  "Cannot open the hardware counters: " << strerror(errno));
+      });
+      return;
+    }
+
+    ioctl(Leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(Leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+  }
+};
+
+} // namespace
+
+static const PerfCounters &currentPerfCounters() {
+  thread_local PerfCounters Result;
+  return Result;
+}
+
+bool ProfilingRegion::isEnabled() {
+  return Backend != RegionsBackend::None;
+}
+
+ProfilingRegion::ProfilingRegion(llvm::StringRef Name) {
+  if (not isEnabled())
+    return;
+
+  Active = true;
+  this->Name = Name.str();
+
+  switch (Backend) {
+  case RegionsBackend::Callgrind:
+    if (Depth == 0)
+      CALLGRIND_START_INSTRUMENTATION;
+    break;
+
+  case RegionsBackend::Perf:
+    Start = currentPerfCounters().read();
+    break;
+
+  case RegionsBackend::None:
+    revng_abort();
+  }
+
+  ++Depth;
+}
+
+ProfilingRegion::~ProfilingRegion() {
+  if (not Active)
+    return;
+
+  --Depth;
+  Calls.push(Name);
+
+  switch (Backend) {
+  case RegionsBackend::Callgrind:
+    if (Depth == 0)
+      CALLGRIND_STOP_INSTRUMENTATION;
+    break;
+
+  case RegionsBackend::Perf: {
+    Counters End = currentPerfCounters().read();
+    for (size_t I = 0; I < End.size(); ++I)
+      if (End[I] > Start[I])
+        CounterMaps[I]->push(Name, End[I] - Start[I]);
+  } break;
+
+  case RegionsBackend::None:
+    revng_abort();
+  }
+}
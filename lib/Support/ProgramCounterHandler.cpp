@@ -5,8 +5,10 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallSet.h"
 
+#include "revng/ADT/PerfectHash.h"
 #include "revng/Support/ProgramCounterHandler.h"
 
 using namespace llvm;
@@ -372,6 +374,16 @@ llvm::Value *ProgramCounterHandler::loadPC(llvm::IRBuilder<> &Builder) const {
 
 std::pair<NextJumpTarget::Values, MetaAddress>
 PCH::getUniqueJumpTarget(BasicBlock *BB) {
+  auto It = UniqueJumpTargets.find(BB);
+  if (It != UniqueJumpTargets.end())
+    return It->second;
+
+  UniqueJumpTargetResult Result = computeUniqueJumpTarget(BB);
+  UniqueJumpTargets[BB] = Result;
+  return Result;
+}
+
+PCH::UniqueJumpTargetResult PCH::computeUniqueJumpTarget(BasicBlock *BB) {
   std::vector<StackEntry> Stack;
 
   enum ProcessResult { Proceed, DontProceed, BailOut };
@@ -709,6 +721,141 @@ void PCH::destroyDispatcher(SwitchInst *Root) const {
   SwitchManager(Root, {}).destroy(Root);
 }
 
+/// \brief Emit the computation of PerfectHash::hash
+static Value *emitHash(IRBuilder<> &B, Value *Key, uint64_t Seed) {
+  auto XorShift = [&B](Value *V) {
+    return B.CreateXor(V, B.CreateLShr(V, 33));
+  };
+
+  Value *Result = XorShift(B.CreateXor(Key, B.getInt64(Seed)));
+  Result = B.CreateMul(Result, B.getInt64(PerfectHash::FirstMultiplier));
+  Result = XorShift(Result);
+  Result = B.CreateMul(Result, B.getInt64(PerfectHash::SecondMultiplier));
+  return XorShift(Result);
+}
+
+static void lowerToTable(SwitchInst *Switch) {
+  BasicBlock *SwitchBB = Switch->getParent();
+  Function *F = SwitchBB->getParent();
+  Module *M = F->getParent();
+  LLVMContext &Context = getContext(Switch);
+  BasicBlock *Default = Switch->getDefaultDest();
+
+  auto *Int32 = Type::getInt32Ty(Context);
+  auto *Int64 = Type::getInt64Ty(Context);
+  auto *Int8Ptr = Type::getInt8PtrTy(Context);
+
+  std::vector<uint64_t> Keys;
+  SmallSetVector<BasicBlock *, 16> Destinations;
+  Destinations.insert(Default);
+  for (const auto &Case : Switch->cases()) {
+    Keys.push_back(Case.getCaseValue()->getZExtValue());
+    BasicBlock *Successor = Case.getCaseSuccessor();
+    revng_assert(not isa<PHINode>(Successor->begin()));
+    Destinations.insert(Successor);
+  }
+
+  PerfectHash Hash = PerfectHash::build(Keys);
+
+  // Emit the table of displacements
+  SmallVector<Constant *, 16> Displacements;
+  for (uint32_t Displacement : Hash.Displacements)
+    Displacements.push_back(ConstantInt::get(Int32, Displacement));
+  auto *DisplacementsType = ArrayType::get(Int32, Displacements.size());
+  auto *DisplacementsInitializer = ConstantArray::get(DisplacementsType,
+                                                      Displacements);
+  auto *DisplacementsTable = new GlobalVariable(*M,
+                                                DisplacementsType,
+                                                true,
+                                                GlobalValue::PrivateLinkage,
+                                                DisplacementsInitializer,
+                                                SwitchBB->getName()
+                                                  + ".displacements");
+
+  // Emit the table of key/target pairs. Empty slots lead to the default
+  // destination, no matter if the key matches.
+  auto *EntryType = StructType::get(Context, { Int64, Int8Ptr });
+  auto *DefaultAddress = BlockAddress::get(F, Default);
+  auto *EmptyEntry = ConstantStruct::get(EntryType,
+                                         { ConstantInt::get(Int64, 0),
+                                           DefaultAddress });
+  std::vector<Constant *> Entries(Hash.SlotsCount, EmptyEntry);
+  for (const auto &Case : Switch->cases()) {
+    ConstantInt *Key = ConstantInt::get(Int64,
+                                        Case.getCaseValue()->getZExtValue());
+    auto *Target = BlockAddress::get(F, Case.getCaseSuccessor());
+    Entries[Hash.slot(Key->getZExtValue())] = ConstantStruct::get(EntryType,
+                                                                 { Key,
+                                                                   Target });
+  }
+  auto *EntriesType = ArrayType::get(EntryType, Entries.size());
+  auto *EntriesTable = new GlobalVariable(*M,
+                                          EntriesType,
+                                          true,
+                                          GlobalValue::PrivateLinkage,
+                                          ConstantArray::get(EntriesType,
+                                                             Entries),
+                                          SwitchBB->getName() + ".targets");
+
+  // Compute the slot and check the key
+  IRBuilder<> Builder(Switch);
+  Value *Key = Builder.CreateZExtOrTrunc(Switch->getCondition(), Int64);
+  Value *Bucket = Builder.CreateAnd(emitHash(Builder, Key, Hash.BucketSeed),
+                                    Hash.Displacements.size() - 1);
+  Value *DisplacementPointer = Builder.CreateInBoundsGEP(DisplacementsType,
+                                                         DisplacementsTable,
+                                                         { Builder.getInt64(0),
+                                                           Bucket });
+  Value *Displacement = Builder.CreateLoad(Int32, DisplacementPointer);
+  Displacement = Builder.CreateZExt(Displacement, Int64);
+  Value *Slot = Builder.CreateAnd(Builder.CreateXor(emitHash(Builder,
+                                                             Key,
+                                                             Hash.SlotSeed),
+                                                    Displacement),
+                                  Hash.SlotsCount - 1);
+
+  auto EntryField = [&](IRBuilder<> &B, unsigned Field) {
+    return B.CreateInBoundsGEP(EntriesType,
+                               EntriesTable,
+                               { B.getInt64(0), Slot, B.getInt32(Field) });
+  };
+  Value *EntryKey = Builder.CreateLoad(Int64, EntryField(Builder, 0));
+  auto *Found = BasicBlock::Create(Context,
+                                   SwitchBB->getName() + ".found",
+                                   F);
+  auto *Branch = Builder.CreateCondBr(Builder.CreateICmpEQ(EntryKey, Key),
+                                      Found,
+                                      Default);
+
+  // Jump to the target
+  IRBuilder<> FoundBuilder(Found);
+  Value *Target = FoundBuilder.CreateLoad(Int8Ptr, EntryField(FoundBuilder, 1));
+  auto *Jump = FoundBuilder.CreateIndirectBr(Target, Destinations.size());
+  for (BasicBlock *Destination : Destinations)
+    Jump->addDestination(Destination);
+
+  // Preserve the block type
+  if (MDNode *Type = Switch->getMetadata(BlockTypeMDName)) {
+    Branch->setMetadata(BlockTypeMDName, Type);
+    Jump->setMetadata(BlockTypeMDName, Type);
+  }
+
+  eraseFromParent(Switch);
+}
+
+void PCH::lowerDispatcherToTables(SwitchInst *Root,
+                                  unsigned MinimumCases) const {
+  std::vector<SwitchInst *> AddressSwitches;
+  for (const auto &EpochCase : Root->cases())
+    for (const auto &AddressSpaceCase : getNextSwitch(EpochCase)->cases())
+      for (const auto &TypeCase : getNextSwitch(AddressSpaceCase)->cases())
+        AddressSwitches.push_back(getNextSwitch(TypeCase));
+
+  for (SwitchInst *AddressSwitch : AddressSwitches)
+    if (AddressSwitch->getNumCases() >= MinimumCases)
+      lowerToTable(AddressSwitch);
+}
+
 PCH::DispatcherInfo
 PCH::buildDispatcher(DispatcherTargets &Targets,
                      IRBuilder<> &Builder,
@@ -834,7 +981,8 @@ PCH::fromModule(Triple::ArchType Architecture, Module *M) {
 
 void PCH::buildHotPath(IRBuilder<> &B,
                        const DispatcherTarget &CandidateTarget,
-                       BasicBlock *Default) const {
+                       BasicBlock *Default,
+                       Optional<BlockType::Values> SetBlockType) const {
   auto &[Address, BB] = CandidateTarget;
 
   auto CreateCmp = [&B](GlobalVariable *CSV, uint64_t Value) {
@@ -856,8 +1004,12 @@ void PCH::buildHotPath(IRBuilder<> &B,
   auto *JumpToBB = BasicBlock::Create(B.getContext(), "", BB->getParent());
   auto *JumpToDefault = BasicBlock::Create(B.getContext(), "", BB->getParent());
 
-  BranchInst::Create(BB, JumpToBB);
-  BranchInst::Create(Default, JumpToDefault);
+  auto *ToBB = BranchInst::Create(BB, JumpToBB);
+  auto *ToDefault = BranchInst::Create(Default, JumpToDefault);
+
+  auto *Branch = B.CreateCondBr(Condition, JumpToBB, JumpToDefault);
 
-  B.CreateCondBr(Condition, JumpToBB, JumpToDefault);
+  if (SetBlockType)
+    for (Instruction *Terminator : { ToBB, ToDefault, Branch })
+      setBlockType(Terminator, *SetBlockType);
 }
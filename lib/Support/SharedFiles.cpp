@@ -0,0 +1,35 @@
+/// \file SharedFiles.cpp
+/// \brief Process-wide cache of the contents of immutable files
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <memory>
+#include <mutex>
+
+#include "llvm/ADT/StringMap.h"
+
+#include "revng/Support/SharedFiles.h"
+
+using namespace llvm;
+
+namespace revng {
+
+ErrorOr<MemoryBufferRef> getSharedFile(StringRef Path) {
+  static std::mutex Lock;
+  static StringMap<std::unique_ptr<MemoryBuffer>> Files;
+
+  std::lock_guard<std::mutex> Guard(Lock);
+  auto It = Files.find(Path);
+  if (It == Files.end()) {
+    auto MaybeBuffer = MemoryBuffer::getFile(Path);
+    if (not MaybeBuffer)
+      return MaybeBuffer.getError();
+    It = Files.try_emplace(Path, std::move(*MaybeBuffer)).first;
+  }
+
+  return It->second->getMemBufferRef();
+}
+
+} // namespace revng
@@ -0,0 +1,38 @@
+/// \file SharedOutputFile.cpp
+/// \brief Implementation of files written to by several threads
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include "llvm/Support/FileSystem.h"
+
+#include "revng/Support/Assert.h"
+#include "revng/Support/SharedOutputFile.h"
+
+static int createFile(llvm::StringRef Path) {
+  int FD = -1;
+  std::error_code EC = llvm::sys::fs::openFileForWrite(Path, FD);
+  revng_assert(not EC);
+  return FD;
+}
+
+SharedOutputFile::SharedOutputFile(llvm::StringRef Path) :
+  OS(createFile(Path), /* shouldClose */ true) {
+  // Data is already appended in large chunks
+  OS.SetUnbuffered();
+}
+
+void SharedOutputFile::append(llvm::StringRef Data) {
+  std::lock_guard Guard(Lock);
+  OS << Data;
+}
+
+void BufferedOutputStream::appendChunk() {
+  if (Buffer.empty())
+    return;
+
+  File.append(Buffer);
+  Appended += Buffer.size();
+  Buffer.clear();
+}
@@ -5,6 +5,8 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <atomic>
+
 #include "revng/Support/CommandLine.h"
 #include "revng/Support/Statistics.h"
 
@@ -37,6 +39,11 @@ static std::array<Handler, 3> Handlers = { { { SIGINT, true, {}, {} },
 
 llvm::ManagedStatic<OnQuitRegistry> OnQuitStatistics;
 
+unsigned revng::detail::nextStatisticsShard() {
+  static std::atomic<unsigned> Next = 0;
+  return Next++;
+}
+
 void installStatistics() {
   if (Statistics)
     OnQuitStatistics->install();
@@ -0,0 +1,253 @@
+/// \file TaskScheduler.cpp
+/// \brief Implementation of the work-stealing scheduler shared by revng
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Threading.h"
+
+#include "revng/Support/Assert.h"
+#include "revng/Support/CommandLine.h"
+#include "revng/Support/Statistics.h"
+#include "revng/Support/TaskScheduler.h"
+
+namespace cl = llvm::cl;
+
+static cl::opt<unsigned> ThreadsCount("revng-threads",
+                                      cl::desc("number of threads running the "
+                                               "parallel parts of revng, 0 "
+                                               "means one per core. Overrides "
+                                               "REVNG_THREADS."),
+                                      cl::cat(MainCategory),
+                                      cl::init(0));
+
+static CounterMap<std::string> SchedulerEvents("task-scheduler");
+static RunningStatistics QueueDepth("task-scheduler-queue-depth");
+
+/// The scheduler owning the current thread, if it's a worker, and its index
+static thread_local const TaskScheduler *CurrentScheduler = nullptr;
+static thread_local unsigned CurrentWorker = 0;
+
+static std::mutex GlobalLock;
+static std::unique_ptr<TaskScheduler> Global;
+
+TaskScheduler::TaskScheduler(unsigned ThreadsCount) {
+  if (ThreadsCount == 0)
+    ThreadsCount = llvm::hardware_concurrency().compute_thread_count();
+  WorkersCount = std::max(ThreadsCount, 1U) - 1;
+
+  for (unsigned I = 0; I < WorkersCount + 1; ++I)
+    Queues.push_back(std::make_unique<Queue>());
+
+  for (unsigned I = 0; I < WorkersCount; ++I)
+    Workers.emplace_back([this, I] { work(I); });
+}
+
+TaskScheduler::~TaskScheduler() {
+  revng_assert(ActiveGroups == 0);
+
+  {
+    std::lock_guard<std::mutex> Guard(SleepLock);
+    Stop = true;
+  }
+  WorkAvailable.notify_all();
+
+  for (std::thread &Worker : Workers)
+    Worker.join();
+
+  revng_assert(Queued == 0);
+}
+
+TaskScheduler &TaskScheduler::get() {
+  std::lock_guard<std::mutex> Guard(GlobalLock);
+  if (not Global)
+    Global = std::make_unique<TaskScheduler>(defaultThreadsCount());
+  return *Global;
+}
+
+void TaskScheduler::setGlobalThreadsCount(unsigned ThreadsCount) {
+  std::lock_guard<std::mutex> Guard(GlobalLock);
+  Global.reset();
+  Global = std::make_unique<TaskScheduler>(ThreadsCount);
+}
+
+unsigned TaskScheduler::defaultThreadsCount() {
+  if (ThreadsCount.getNumOccurrences() > 0 and ThreadsCount != 0)
+    return ThreadsCount;
+
+  if (const char *Value = std::getenv("REVNG_THREADS")) {
+    unsigned Result = 0;
+    if (not llvm::StringRef(Value).getAsInteger(10, Result) and Result != 0)
+      return Result;
+  }
+
+  return llvm::hardware_concurrency().compute_thread_count();
+}
+
+void TaskScheduler::spawn(TaskGroup &Group,
+                          Task Callable,
+                          const void *Affinity) {
+  unsigned Index = WorkersCount;
+  if (Affinity != nullptr and WorkersCount != 0)
+    Index = std::hash<const void *>()(Affinity) % WorkersCount;
+  else if (CurrentScheduler == this)
+    Index = CurrentWorker;
+
+  ++Group.Pending;
+  size_t Depth = 0;
+  {
+    Queue &Destination = *Queues[Index];
+    std::lock_guard<std::mutex> Guard(Destination.Lock);
+    Destination.Entries.push_back({ &Group, std::move(Callable) });
+
+    // Counters are updated under the lock, so that they are never decremented
+    // before being incremented
+    ++Group.Queued;
+    Depth = ++Queued;
+  }
+
+  ++Spawned;
+  SchedulerEvents.push("spawned");
+  QueueDepth.push(Depth);
+
+  {
+    std::lock_guard<std::mutex> Guard(SleepLock);
+  }
+  WorkAvailable.notify_one();
+  Group.notify();
+}
+
+std::optional<TaskScheduler::Entry>
+TaskScheduler::pop(Queue &From, const TaskGroup *Only, bool Newest) {
+  std::lock_guard<std::mutex> Guard(From.Lock);
+  auto &Entries = From.Entries;
+  auto Matches = [Only](const Entry &Candidate) {
+    return Only == nullptr or Candidate.Group == Only;
+  };
+
+  std::optional<Entry> Result;
+  if (Newest) {
+    auto It = std::find_if(Entries.rbegin(), Entries.rend(), Matches);
+    if (It == Entries.rend())
+      return std::nullopt;
+    Result = std::move(*It);
+    Entries.erase(std::next(It).base());
+  } else {
+    auto It = std::find_if(Entries.begin(), Entries.end(), Matches);
+    if (It == Entries.end())
+      return std::nullopt;
+    Result = std::move(*It);
+    Entries.erase(It);
+  }
+
+  --Result->Group->Queued;
+  return Result;
+}
+
+std::optional<TaskScheduler::Entry> TaskScheduler::take(const TaskGroup *Only) {
+  std::optional<Entry> Result;
+  bool IsWorker = CurrentScheduler == this;
+  if (IsWorker)
+    Result = pop(*Queues[CurrentWorker], Only, true);
+
+  if (not Result)
+    Result = pop(*Queues[WorkersCount], Only, false);
+
+  // Steal from the other workers, starting from the next one, so that thieves
+  // do not all pick on the same victim
+  unsigned Start = IsWorker ? CurrentWorker + 1 : 0;
+  for (unsigned I = 0; not Result and I < WorkersCount; ++I) {
+    unsigned Victim = (Start + I) % WorkersCount;
+    if (IsWorker and Victim == CurrentWorker)
+      continue;
+
+    Result = pop(*Queues[Victim], Only, false);
+    if (Result) {
+      ++Steals;
+      SchedulerEvents.push("stolen");
+    }
+  }
+
+  if (Result)
+    --Queued;
+
+  return Result;
+}
+
+void TaskScheduler::execute(Entry &ToRun) {
+  TaskGroup &Group = *ToRun.Group;
+  if (Group.isCancelled()) {
+    ++Cancelled;
+    SchedulerEvents.push("cancelled");
+  } else {
+    ToRun.Callable();
+  }
+
+  // Release what the task captured before the group can be destroyed
+  ToRun.Callable = nullptr;
+
+  // Decrement under the lock: once the waiter observes no pending tasks, the
+  // group might go away at any time
+  std::lock_guard<std::mutex> Guard(Group.Lock);
+  --Group.Pending;
+  Group.Changed.notify_all();
+}
+
+void TaskScheduler::work(unsigned Index) {
+  CurrentScheduler = this;
+  CurrentWorker = Index;
+
+  while (true) {
+    if (auto ToRun = take(nullptr)) {
+      execute(*ToRun);
+      continue;
+    }
+
+    std::unique_lock<std::mutex> Guard(SleepLock);
+    WorkAvailable.wait(Guard, [this] { return Stop or Queued > 0; });
+    if (Stop and Queued == 0)
+      return;
+  }
+}
+
+TaskGroup::TaskGroup(TaskScheduler &Scheduler) : Scheduler(Scheduler) {
+  ++Scheduler.ActiveGroups;
+}
+
+TaskGroup::~TaskGroup() {
+  wait();
+  --Scheduler.ActiveGroups;
+}
+
+void TaskGroup::spawn(TaskScheduler::Task Callable, const void *Affinity) {
+  Scheduler.spawn(*this, std::move(Callable), Affinity);
+}
+
+void TaskGroup::notify() {
+  std::lock_guard<std::mutex> Guard(Lock);
+  Changed.notify_all();
+}
+
+void TaskGroup::wait() {
+  while (Pending > 0) {
+    if (auto ToRun = Scheduler.take(this)) {
+      Scheduler.execute(*ToRun);
+      continue;
+    }
+
+    // All the tasks are running elsewhere: sleep until they are done, or until
+    // one of them spawns a new task in this group
+    std::unique_lock<std::mutex> Guard(Lock);
+    Changed.wait(Guard, [this] { return Pending == 0 or Queued > 0; });
+  }
+
+  // Make sure the last task is done signalling the group
+  std::lock_guard<std::mutex> Guard(Lock);
+}
@@ -0,0 +1,150 @@
+/// \file TemporaryFile.cpp
+/// \brief Implementation of the disk and memory backed temporary files
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+#include "revng/Support/CommandLine.h"
+#include "revng/Support/Statistics.h"
+#include "revng/Support/TemporaryFile.h"
+
+namespace cl = llvm::cl;
+
+using Backend = TemporaryFile::Backend;
+
+static cl::opt<Backend> BackendOption("temporary-files-backend",
+                                      cl::desc("where temporary files are "
+                                               "created"),
+                                      cl::values(clEnumValN(Backend::Disk,
+                                                            "disk",
+                                                            "in the temporary "
+                                                            "directory"),
+                                                 clEnumValN(Backend::Memory,
+                                                            "memory",
+                                                            "in anonymous "
+                                                            "memory files, "
+                                                            "when enough "
+                                                            "memory is "
+                                                            "available")),
+                                      cl::init(Backend::Disk),
+                                      cl::cat(MainCategory));
+
+static cl::opt<uint64_t> MinAvailableMemory("temporary-files-min-available-"
+                                            "memory",
+                                            cl::desc("MiB of memory that must "
+                                                     "be available to create "
+                                                     "temporary files in "
+                                                     "memory, rather than on "
+                                                     "disk"),
+                                            cl::init(1024),
+                                            cl::cat(MainCategory));
+
+static CounterMap<std::string> Created("temporary-files");
+
+/// \return the memory available for new allocations in MiB, if known
+static std::optional<uint64_t> availableMemory() {
+  auto MaybeBuffer = llvm::MemoryBuffer::getFileAsStream("/proc/meminfo");
+  if (not MaybeBuffer)
+    return std::nullopt;
+
+  // The line looks like "MemAvailable:    1234567 kB"
+  llvm::SmallVector<llvm::StringRef, 64> Lines;
+  (*MaybeBuffer)->getBuffer().split(Lines, '\n');
+  for (llvm::StringRef Line : Lines) {
+    if (not Line.consume_front("MemAvailable:"))
+      continue;
+
+    llvm::StringRef Value = Line.trim();
+    Value.consume_back("kB");
+    uint64_t KiB = 0;
+    if (Value.trim().getAsInteger(10, KiB))
+      return std::nullopt;
+    return KiB / 1024;
+  }
+
+  return std::nullopt;
+}
+
+/// \return a new anonymous memory file, or -1 if it cannot be created
+static int createMemoryFile(const std::string &Name) {
+#ifdef __linux__
+  auto MaybeAvailable = availableMemory();
+  if (not MaybeAvailable or *MaybeAvailable < MinAvailableMemory)
+    return -1;
+
+  return memfd_create(Name.c_str(), MFD_CLOEXEC);
+#else
+  return -1;
+#endif
+}
+
+TemporaryFile::TemporaryFile(const llvm::Twine &Prefix,
+                             llvm::StringRef Suffix,
+                             Backend Preferred) {
+  if (Preferred == Backend::Memory) {
+    std::string Name = Prefix.str();
+    if (not Suffix.empty())
+      Name += "." + Suffix.str();
+
+    FD = createMemoryFile(Name);
+    if (FD >= 0) {
+      // Unlike /proc/self, this path has the same meaning in child processes
+      Path = ("/proc/" + llvm::Twine(getpid()) + "/fd/" + llvm::Twine(FD))
+               .str();
+      Created.push("memory");
+      return;
+    }
+
+    Created.push("disk-fallback");
+  } else {
+    Created.push("disk");
+  }
+
+  std::error_code EC = llvm::sys::fs::createTemporaryFile(Prefix,
+                                                          Suffix,
+                                                          Path);
+  revng_assert(not EC);
+}
+
+TemporaryFile &TemporaryFile::operator=(TemporaryFile &&Other) {
+  reset();
+  Path = Other.Path;
+  FD = Other.FD;
+  Other.Path.clear();
+  Other.FD = -1;
+  return *this;
+}
+
+void TemporaryFile::reset() {
+  if (FD >= 0) {
+    // The memory is released once nobody refers to the file anymore
+    int Result = close(FD);
+    revng_assert(Result == 0);
+  } else if (not Path.empty()) {
+    std::error_code EC = llvm::sys::fs::remove(Path);
+    revng_assert(not EC);
+  }
+
+  Path.clear();
+  FD = -1;
+}
+
+Backend TemporaryFile::defaultBackend() {
+  return BackendOption;
+}
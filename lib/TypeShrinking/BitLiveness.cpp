@@ -13,27 +13,25 @@
 #include <limits>
 
 #include "llvm/ADT/APInt.h"
-#include "llvm/ADT/BitVector.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/Instruction.h"
 #include "llvm/IR/Type.h"
 #include "llvm/Support/Casting.h"
 
-#include "revng/MFP/MFP.h"
+#include "revng/ADT/UniquedStack.h"
 #include "revng/Support/Assert.h"
 #include "revng/TypeShrinking/BitLiveness.h"
 #include "revng/TypeShrinking/DataFlowGraph.h"
 
 namespace TypeShrinking {
 
+using Instruction = llvm::Instruction;
+
 /// This class is an instance of monotone framework
 /// the elements represent the index from which all bits are not alive
 /// so for an element E, all bits with index < E are alive
 struct BitLivenessAnalysis {
-  using GraphType = GenericGraph<DataFlowNode> *;
   using LatticeElement = uint32_t;
-  using Label = DataFlowNode *;
-  using MFPResult = MFP::MFPResult<BitLivenessAnalysis::LatticeElement>;
 
   uint32_t combineValues(const uint32_t &LHS, const uint32_t &RHS) const {
     return std::max(LHS, RHS);
@@ -43,12 +41,9 @@ struct BitLivenessAnalysis {
     return LHS <= RHS;
   }
 
-  uint32_t applyTransferFunction(DataFlowNode *L, const uint32_t E) const;
+  uint32_t applyTransferFunction(Instruction *Ins, const uint32_t E) const;
 };
 
-using BitVector = llvm::BitVector;
-using Instruction = llvm::Instruction;
-
 llvm::AnalysisKey TypeShrinking::BitLivenessPass::Key;
 char TypeShrinking::BitLivenessWrapperPass::ID = 0;
 
@@ -220,9 +215,8 @@ static uint32_t transferZExt(Instruction *Ins, const uint32_t &Element) {
   return std::min(Element, getMaxOperandSize(Ins));
 }
 
-uint32_t BitLivenessAnalysis::applyTransferFunction(DataFlowNode *L,
+uint32_t BitLivenessAnalysis::applyTransferFunction(Instruction *Ins,
                                                     const uint32_t E) const {
-  auto *Ins = L->Instruction;
   uint32_t Input = E;
   // At most every bit of the result is alive
   if (!isDataFlowSink(Ins)) {
@@ -236,7 +230,7 @@ uint32_t BitLivenessAnalysis::applyTransferFunction(DataFlowNode *L,
   case Instruction::Add:
   case Instruction::Sub:
   case Instruction::Mul:
-    return std::min(E, getMaxOperandSize(L->Instruction));
+    return std::min(E, getMaxOperandSize(Ins));
   case Instruction::Shl:
     return transferShiftLeft(Ins, E);
   case Instruction::LShr:
@@ -253,31 +247,64 @@ uint32_t BitLivenessAnalysis::applyTransferFunction(DataFlowNode *L,
   }
 }
 
-BitLivenessPass::Result
-BitLivenessPass::run(llvm::Function &F, llvm::FunctionAnalysisManager &) {
-  GenericGraph<DataFlowNode> DataFlowGraph = buildDataFlowGraph(F);
-  std::vector<DataFlowNode *> ExtremalLabels;
-  for (DataFlowNode *Node : DataFlowGraph.nodes()) {
-    if (isDataFlowSink(Node->Instruction)) {
-      ExtremalLabels.push_back(Node);
+/// \brief Compute the maximal fixed point of BitLivenessAnalysis on \p Graph
+///
+/// This is a specialization of MFP::getMaximalFixedPoint: nodes are already
+/// numbered densely, hence the values are kept in a flat vector, and a node is
+/// processed again only if the value it receives from its users changed.
+static std::vector<uint32_t> computeLiveness(const DataFlowGraph &Graph) {
+  using NodeID = DataFlowGraph::NodeID;
+  const BitLivenessAnalysis Analysis;
+  size_t Size = Graph.size();
+
+  // The value flowing into each node from its users, data flow sinks are the
+  // extremal nodes
+  std::vector<uint32_t> Values(Size, 0);
+  for (NodeID Node = 0; Node < Size; ++Node)
+    if (isDataFlowSink(Graph.instruction(Node)))
+      Values[Node] = Top;
+
+  // Users usually follow their definitions, hence we start from the last node
+  DenseUniquedStack<NodeID> Worklist(Size);
+  for (NodeID Node = 0; Node < Size; ++Node)
+    Worklist.insert(Node);
+
+  while (not Worklist.empty()) {
+    NodeID Node = Worklist.pop();
+
+    Instruction *Ins = Graph.instruction(Node);
+    uint32_t Out = Analysis.applyTransferFunction(Ins, Values[Node]);
+    for (NodeID Definition : Graph.successors(Node)) {
+      if (Analysis.isLessOrEqual(Out, Values[Definition]))
+        continue;
+
+      Values[Definition] = Analysis.combineValues(Values[Definition], Out);
+      Worklist.insert(Definition);
     }
   }
 
-  auto MFPRes = MFP::getMaximalFixedPoint<BitLivenessAnalysis>({},
-                                                               &DataFlowGraph,
-                                                               0,
-                                                               Top,
-                                                               ExtremalLabels);
-  BitLivenessPass::Result Result;
-  for (auto &[Label, MFPResult] : MFPRes)
-    Result[Label->Instruction] = MFPResult.OutValue;
+  // The results are the output values
+  for (NodeID Node = 0; Node < Size; ++Node)
+    Values[Node] = Analysis.applyTransferFunction(Graph.instruction(Node),
+                                                  Values[Node]);
+
+  return Values;
+}
 
+BitLivenessAnalysisResults computeBitLiveness(llvm::Function &F) {
+  BitLivenessAnalysisResults Result;
+  Result.Graph = buildDataFlowGraph(F);
+  Result.Liveness = computeLiveness(Result.Graph);
   return Result;
 }
 
+BitLivenessPass::Result
+BitLivenessPass::run(llvm::Function &F, llvm::FunctionAnalysisManager &) {
+  return computeBitLiveness(F);
+}
+
 bool BitLivenessWrapperPass::runOnFunction(llvm::Function &F) {
-  llvm::FunctionAnalysisManager FAM;
-  Result = BitLivenessPass().run(F, FAM);
+  Result = computeBitLiveness(F);
   return false;
 }
 
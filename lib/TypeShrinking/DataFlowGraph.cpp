@@ -5,8 +5,7 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
-#include <unordered_map>
-
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/IR/InstIterator.h"
 
 #include "revng/TypeShrinking/DataFlowGraph.h"
@@ -14,26 +13,31 @@
 using namespace llvm;
 
 namespace TypeShrinking {
-GenericGraph<DataFlowNode> buildDataFlowGraph(Function &F) {
-  GenericGraph<DataFlowNode> DataFlowGraph{};
-  std::vector<DataFlowNode *> Worklist;
-  std::unordered_map<Instruction *, DataFlowNode *> InstructionNodeMap;
+
+DataFlowGraph DataFlowGraph::fromFunction(Function &F) {
+  DataFlowGraph Result;
+
   // Initialization
+  DenseMap<const Instruction *, NodeID> NodeIDs;
   for (Instruction &I : instructions(F)) {
-    DataFlowNode Node{ &I };
-    auto *GraphNode = DataFlowGraph.addNode(Node);
-    Worklist.push_back(GraphNode);
-    InstructionNodeMap[GraphNode->Instruction] = GraphNode;
+    NodeIDs[&I] = Result.Instructions.size();
+    Result.Instructions.push_back(&I);
   }
 
-  for (auto *DefNode : Worklist) {
-    auto *Ins = DefNode->Instruction;
-    for (auto &Use : Ins->uses()) {
-      auto *UseNode = InstructionNodeMap.at(cast<Instruction>(Use.getUser()));
-      UseNode->addSuccessor(DefNode);
+  Result.Offsets.reserve(Result.size() + 1);
+  Result.Offsets.push_back(0);
+  for (Instruction *User : Result.Instructions) {
+    for (Value *Operand : User->operands()) {
+      if (auto *Definition = dyn_cast<Instruction>(Operand)) {
+        auto It = NodeIDs.find(Definition);
+        revng_assert(It != NodeIDs.end());
+        Result.Definitions.push_back(It->second);
+      }
     }
+    Result.Offsets.push_back(Result.Definitions.size());
   }
-  return DataFlowGraph;
+
+  return Result;
 }
 
 } // namespace TypeShrinking
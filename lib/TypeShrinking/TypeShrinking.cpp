@@ -22,7 +22,9 @@
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/CommandLine.h"
 
+#include "revng/Support/FunctionTags.h"
 #include "revng/Support/IRHelpers.h"
+#include "revng/Support/TaskScheduler.h"
 #include "revng/TypeShrinking/BitLiveness.h"
 #include "revng/TypeShrinking/DataFlowGraph.h"
 #include "revng/TypeShrinking/TypeShrinking.h"
@@ -44,6 +46,15 @@ using Register = RegisterPass<TypeShrinking::TypeShrinkingWrapperPass>;
 static Register
   X("type-shrinking", "Run the type shrinking analysis", true, true);
 
+char TypeShrinking::ParallelTypeShrinkingPass::ID = 0;
+
+using RegisterParallel = RegisterPass<TypeShrinking::ParallelTypeShrinkingPass>;
+static RegisterParallel Y("parallel-type-shrinking",
+                          "Run the type shrinking analysis on all the isolated "
+                          "functions in parallel",
+                          false,
+                          false);
+
 namespace TypeShrinking {
 
 void TypeShrinkingWrapperPass::getAnalysisUsage(AnalysisUsage &AU) const {
@@ -70,7 +81,11 @@ runTypeShrinking(Function &F, const BitLivenessAnalysisResults &FixedPoints) {
   bool HasChanges = false;
 
   const std::array<uint32_t, 4> Ranks = { 8, 16, 32, 64 };
-  for (auto &[Ins, Result] : FixedPoints) {
+  const DataFlowGraph &Graph = FixedPoints.Graph;
+  for (DataFlowGraph::NodeID Node = 0; Node < Graph.size(); ++Node) {
+    Instruction *Ins = Graph.instruction(Node);
+    uint32_t Result = FixedPoints.Liveness[Node];
+
     // Find the closest rank that contains all the alive bits.
     // If there is a known rank and this is an instruction that behaves like add
     // (the least significant bits of the result depend only on the least
@@ -137,6 +152,35 @@ bool TypeShrinkingWrapperPass::runOnFunction(Function &F) {
   return runTypeShrinking(F, FixedPoints);
 }
 
+bool ParallelTypeShrinkingPass::runOnModule(Module &M) {
+  std::vector<Function *> Functions;
+  for (Function &F : M)
+    if (not F.isDeclaration() and FunctionTags::Isolated.isTagOf(&F))
+      Functions.push_back(&F);
+
+  // Each task owns the results of its function, the analysis only reads the
+  // IR
+  std::vector<BitLivenessAnalysisResults> Results(Functions.size());
+  {
+    TaskGroup Group;
+    for (size_t I = 0; I < Functions.size(); ++I)
+      Group.spawn([&Results, &Functions, I]() {
+        Results[I] = computeBitLiveness(*Functions[I]);
+      });
+    Group.wait();
+  }
+
+  // Shrinking creates types and constants in the LLVMContext, do it
+  // sequentially
+  bool Changed = false;
+  for (size_t I = 0; I < Functions.size(); ++I) {
+    Changed = runTypeShrinking(*Functions[I], Results[I]) or Changed;
+    Results[I] = BitLivenessAnalysisResults();
+  }
+
+  return Changed;
+}
+
 PreservedAnalyses
 TypeShrinkingPass::run(Function &F, FunctionAnalysisManager &FAM) {
   const auto &FixedPoints = FAM.getResult<BitLivenessPass>(F);
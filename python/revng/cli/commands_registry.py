@@ -4,6 +4,7 @@
 
 import argparse
 import dataclasses
+import os
 import sys
 from typing import Tuple
 
@@ -65,6 +66,13 @@ class CommandsRegistry:
         parser.add_argument(
             "--prefix", action="append", metavar="PREFIX", help="Additional search prefix."
         )
+        parser.add_argument(
+            "-j",
+            "--threads",
+            type=int,
+            metavar="N",
+            help="Number of threads used by revng (0 means one per core), sets REVNG_THREADS.",
+        )
         self.root_parser = parser
         self.commands = {}
         self.namespaces = {}
@@ -126,6 +134,9 @@ class CommandsRegistry:
             if args.heaptrack:
                 options.command_prefix += ["heaptrack"]
 
+        if args.threads is not None:
+            os.environ["REVNG_THREADS"] = str(args.threads)
+
         if args.version:
             sys.stdout.write("rev.ng version @VERSION@\n")
             return 0
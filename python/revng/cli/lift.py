@@ -2,8 +2,6 @@
 # This file is distributed under the MIT License. See LICENSE.md for details.
 #
 
-from tempfile import NamedTemporaryFile
-
 from .commands_registry import Command, Options, commands_registry
 from .revng import run_revng_command
 from .support import log_error
@@ -18,11 +16,14 @@ class LiftCommand(Command):
         parser.add_argument("output", type=str, nargs=1, help="Output module path")
         parser.add_argument("--record-asm", action="store_true")
         parser.add_argument("--record-ptc", action="store_true")
+        parser.add_argument("--always-retranslate", action="store_true")
         parser.add_argument("--external", action="store_true")
         parser.add_argument("--base", type=str)
         parser.add_argument("--entry", type=str)
         parser.add_argument("--debug-info", type=str)
         parser.add_argument("--import-debug-info", type=str, action="append", default=[])
+        parser.add_argument("--lift-profile", type=str, help="Write a JSON profile of lifting")
+        parser.add_argument("--dispatcher-profile", type=str)
 
     def run(self, options: Options):
         if options.remaining_args:
@@ -34,68 +35,37 @@ class LiftCommand(Command):
         arg_or_empty = (
             lambda args, name: [f"--{name}={args.__dict__[name]}"] if args.__dict__[name] else []
         )
+        flag_or_empty = (
+            lambda args, name: [f"--{name.replace('_', '-')}"] if args.__dict__[name] else []
+        )
 
-        with NamedTemporaryFile(
-            suffix=".yml", delete=not options.keep_temporaries
-        ) as model, NamedTemporaryFile(
-            suffix=".ll", delete=not options.keep_temporaries
-        ) as model_in_module:
-            # Run revng model import args.input
-            run_revng_command(
-                [
-                    "model",
-                    "import",
-                    "binary",
-                    args.input[0],
-                    "-o",
-                    model.name,
-                ]
-                + [f"--import-debug-info={value}" for value in args.import_debug_info]
-                + arg_or_empty(args, "base")
-                + arg_or_empty(args, "entry"),
-                options,
-            )
-
-            run_revng_command(
-                [
-                    "model",
-                    "opt",
-                    "--add-primitive-types",
-                    model.name,
-                    "-o",
-                    model.name,
-                ],
-                options,
-            )
+        # Import the binary, lift it and embed the model in the module in a
+        # single process, so that the module is never serialized in between
+        step_name = "EmbedModel"
+        command = [
+            "pipeline",
+            "module.ll::Root",
+            "--step",
+            step_name,
+            "-i",
+            "begin:input:" + args.input[0],
+            "-o",
+            step_name + ":module.ll:" + args.output[0],
+        ]
 
-            run_revng_command(
-                [
-                    "model",
-                    "inject",
-                    model.name,
-                    "/dev/null",
-                    "-o",
-                    model_in_module.name,
-                ],
-                options,
-            )
+        command += [f"--import-debug-info={value}" for value in args.import_debug_info]
+        command += arg_or_empty(args, "base")
+        command += arg_or_empty(args, "entry")
+        command += flag_or_empty(args, "external")
+        command += flag_or_empty(args, "record_asm")
+        command += flag_or_empty(args, "record_ptc")
+        command += flag_or_empty(args, "always_retranslate")
+        if args.lift_profile:
+            command.append(f"--lift-profile={args.lift_profile}")
+        if args.dispatcher_profile:
+            command.append(f"--dispatcher-profile={args.dispatcher_profile}")
 
-            run_revng_command(
-                [
-                    "opt",
-                    model_in_module.name,
-                    "-o",
-                    args.output[0],
-                    "-load-binary",
-                    f"-binary-path={args.input[0]}",
-                    "-lift",
-                ]
-                + arg_or_empty(args, "external")
-                + arg_or_empty(args, "record_asm")
-                + arg_or_empty(args, "record_ptc"),
-                options,
-            )
-        return 0
+        return run_revng_command(command, options)
         # TODO: annotate IR
 
 
@@ -1,5 +0,0 @@
-#
-# This file is distributed under the MIT License. See LICENSE.md for details.
-#
-
-from .merge_dynamic import merge_dynamic  # noqa: F401
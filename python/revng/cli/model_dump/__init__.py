@@ -4,8 +4,14 @@
 
 import yaml
 
+# Models can be large, use the libyaml-based loader whenever available
+try:
+    from yaml import CSafeLoader as SafeLoader
+except ImportError:
+    from yaml import SafeLoader  # type: ignore
 
-class SafeLoaderIgnoreUnknown(yaml.SafeLoader):
+
+class SafeLoaderIgnoreUnknown(SafeLoader):
     def ignore_unknown(self, node):
         return self.construct_mapping(node)
 
@@ -37,6 +37,24 @@ class TranslateCommand(Command):
 
         parser.add_argument("--base", help="Load address to employ in lifting.")
 
+        parser.add_argument(
+            "--no-vector-helpers",
+            action="store_true",
+            help="Emit calls to the QEMU vector helpers instead of vector IR.",
+        )
+
+        parser.add_argument(
+            "--profile-counters",
+            action="store_true",
+            help="Count the executions of each jump target, see REVNG_PROFILE_PATH.",
+        )
+
+        parser.add_argument(
+            "--dispatcher-profile",
+            metavar="PROFILE",
+            help="Test the hottest jump targets in PROFILE before the dispatcher.",
+        )
+
     def run(self, options: Options):
         args = options.parsed_args
         out_file = args.output if args.output else args.input[0] + ".translated"
@@ -69,6 +87,15 @@ class TranslateCommand(Command):
         if args.trace:
             command.append("--link-trace")
 
+        if args.no_vector_helpers:
+            command.append("--lift-vector-helpers=false")
+
+        if args.profile_counters:
+            command.append("--profile-counters")
+
+        if args.dispatcher_profile:
+            command.append(f"--dispatcher-profile={args.dispatcher_profile}")
+
         return run_revng_command(command, options)
 
 
@@ -34,67 +34,167 @@ def _create_instance(field_value, field_type):
     raise TypeError(f"Invalid type {type(field_value)}, was expecting {field_type}")
 
 
-# Hot function, hence the lru_cache
-# Called once per field for each object instantiation
-@lru_cache(maxsize=1024, typed=True)
-def get_type_hint_cached(class_, name):
-    return get_type_hints(class_)[name]
+class LazyList(list):
+    """A list whose elements are deserialized only when they are first accessed.
+
+    Each element is kept in its raw form, a dict, until it's read; then it's converted through
+    `convert` and replaced in place. Operations that need the whole list materialize it first.
+    """
+
+    __slots__ = ("_convert", "_pending")
+
+    def __init__(self, values, convert):
+        super().__init__(values)
+        self._convert = convert
+        self._pending = True
+
+    def _get(self, index):
+        value = list.__getitem__(self, index)
+        if isinstance(value, dict):
+            value = self._convert(value)
+            list.__setitem__(self, index, value)
+        return value
+
+    def materialize(self):
+        if self._pending:
+            for index in range(len(self)):
+                self._get(index)
+            self._pending = False
+
+    def __getitem__(self, index):
+        if isinstance(index, slice):
+            self.materialize()
+            return list.__getitem__(self, index)
+        return self._get(index)
+
+    def __iter__(self):
+        if not self._pending:
+            return list.__iter__(self)
+        return self._lazy_iter()
+
+    def _lazy_iter(self):
+        index = 0
+        while index < len(self):
+            yield self._get(index)
+            index += 1
+
+
+def _materializing(name):
+    method = getattr(list, name)
+
+    def wrapper(self, *args, **kwargs):
+        self.materialize()
+        return method(self, *args, **kwargs)
+
+    wrapper.__name__ = name
+    return wrapper
+
+
+for _name in (
+    "__add__",
+    "__contains__",
+    "__eq__",
+    "__ge__",
+    "__gt__",
+    "__le__",
+    "__lt__",
+    "__mul__",
+    "__ne__",
+    "__reduce_ex__",
+    "__repr__",
+    "__reversed__",
+    "__rmul__",
+    "copy",
+    "count",
+    "index",
+    "pop",
+    "remove",
+    "sort",
+):
+    setattr(LazyList, _name, _materializing(_name))
+
+
+def _make_list_converter(cls, field_name, underlying_type):
+    def convert_element(value):
+        try:
+            return _create_instance(value, underlying_type)
+        except ValueError as e:
+            raise ValueError(
+                f"Error deserializing list element of {field_name} of {cls.__name__}"
+            ) from e
+
+    is_struct = isinstance(underlying_type, type) and issubclass(underlying_type, StructBase)
+
+    def convert(field_value):
+        if not isinstance(field_value, list):
+            raise ValueError(
+                f"Expected list for field {field_name} of {cls.__name__},"
+                + f"got {type(field_value)}"
+            )
+
+        # Lists of structs are the bulk of a tuple tree: deserialize their elements on demand
+        if is_struct:
+            return LazyList(field_value, convert_element)
+        return [convert_element(v) for v in field_value]
+
+    return convert
+
+
+def _make_converter(cls, field_name, field_type):
+    # Get the "origin", i.e. for a field annotated as List[str] the origin is list
+    origin = get_origin(field_type)
+    # Get the args, i.e. for a field annotated as Dict[str, int] the args are (str, int)
+    args = get_args(field_type)
+
+    # If the field is a list of something we need to instantiate its elements one by one
+    if origin is list:
+        assert len(args) == 1
+        return _make_list_converter(cls, field_name, args[0])
+
+    if origin is Reference:
+        return Reference
+
+    # The field is not a list nor a reference, create an instance of the field value
+    def convert(field_value):
+        try:
+            return _create_instance(field_value, field_type)
+        except ValueError as e:
+            raise TypeError(
+                f"Error while deserializing field {field_name} of {cls.__name__}"
+            ) from e
+
+    return convert
+
+
+# Hot function, hence the cache
+# Called once per object instantiation, resolving the type hints only once per class
+@lru_cache(maxsize=None)
+def get_field_converters(class_):
+    type_hints = get_type_hints(class_)
+    return {
+        name: _make_converter(class_, name, type_hints[name])
+        for name in class_.__dataclass_fields__
+    }
 
 
 @dataclass
 class StructBase:
     @classmethod
     def from_dict(cls, **kwargs):
-        """Constructs an instance of the object using the values supplied as kwargs"""
+        """Constructs an instance of the object using the values supplied as kwargs.
+
+        Lists of structs are not deserialized right away: their elements are converted the first
+        time they are accessed (see LazyList).
+        """
+        converters = get_field_converters(cls)
         constructor_kwargs = {}
 
         # Iterate over all the fields defined in the dataclass
         for field_name, field_value in kwargs.items():
-            field_spec = cls.__dataclass_fields__.get(field_name)
-            if field_spec is None:
+            converter = converters.get(field_name)
+            if converter is None:
                 raise ValueError(f"Field {field_name} is not allowed for type {cls.__name__}")
-
-            # Get the type annotation
-            field_spec_type = get_type_hint_cached(cls, field_spec.name)
-            # Get the "origin", i.e. for a field annotated as List[str] the origin is list
-            origin = get_origin(field_spec_type)
-            # Get the args, i.e. for a field annotated as Dict[str, int] the args are (str, int)
-            args = get_args(field_spec_type)
-
-            # If the field is a list of something we need to instantiate its elements one by one
-            if origin is list:
-                assert len(args) == 1
-                underlying_type = args[0]
-
-                if not isinstance(field_value, list):
-                    raise ValueError(
-                        f"Expected list for field {field_name} of {cls.__name__},"
-                        + f"got {type(field_value)}"
-                    )
-
-                instances = []
-                for v in field_value:
-                    try:
-                        v_inst = _create_instance(v, underlying_type)
-                        instances.append(v_inst)
-                    except ValueError as e:
-                        raise ValueError(
-                            f"Error deserializing list element of {field_name} of {cls.__name__}"
-                        ) from e
-
-                constructor_kwargs[field_name] = instances
-
-            elif origin is Reference:
-                constructor_kwargs[field_name] = Reference(field_value)
-
-            # The field is not a list nor a reference, create an instance of the field value
-            else:
-                try:
-                    constructor_kwargs[field_name] = _create_instance(field_value, field_spec_type)
-                except ValueError as e:
-                    raise TypeError(
-                        f"Error while deserializing field {field_name} of {cls.__name__}"
-                    ) from e
+            constructor_kwargs[field_name] = converter(field_value)
 
         instance = cls(**constructor_kwargs)
         return instance
@@ -232,3 +332,6 @@ class YamlDumper(Dumper):
 
     def ignore_aliases(self, data):
         return True
+
+
+YamlDumper.add_representer(LazyList, YamlDumper.represent_list)
@@ -17,7 +17,6 @@ setup(
     install_requires=open("requirements.txt", encoding="utf-8").readlines(),  # noqa: SIM115
     scripts=[
         "scripts/revng",
-        "scripts/revng-merge-dynamic",
         "scripts/revng-model-compare",
         "scripts/revng-model-to-json",
     ],
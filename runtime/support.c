@@ -260,19 +260,158 @@ void unknownPC(PlainMetaAddress *PC) {
   abort();
 }
 
+// Profiling support
+//
+// If the program has been lifted with -profile-counters, it counts how many
+// times each jump target has been executed and how many times it has been
+// reached through the dispatcher, i.e., as the target of an indirect branch.
+// At exit, the counters are dumped in CSV format to the path specified by
+// REVNG_PROFILE_PATH, if any.
+
+extern const uint64_t revng_profile_count __attribute__((weak));
+extern const uint64_t revng_profile_addresses[] __attribute__((weak));
+extern uint64_t revng_profile_executions[] __attribute__((weak));
+extern uint64_t revng_profile_dispatches[] __attribute__((weak));
+
+static FILE *profile_file = NULL;
+
+static void dump_profile(void) {
+  if (profile_file == NULL)
+    return;
+
+  fprintf(profile_file, "address,executions,dispatches\n");
+  for (uint64_t i = 0; i < revng_profile_count; i++) {
+    uint64_t executions = revng_profile_executions[i];
+    uint64_t dispatches = revng_profile_dispatches[i];
+    if (executions == 0 && dispatches == 0)
+      continue;
+
+    fprintf(profile_file,
+            "0x%" PRIx64 ",%" PRIu64 ",%" PRIu64 "\n",
+            revng_profile_addresses[i],
+            executions,
+            dispatches);
+  }
+
+  fclose(profile_file);
+  profile_file = NULL;
+}
+
+static void init_profiling(void) {
+  // Check if the program has been instrumented
+  if (&revng_profile_count == NULL)
+    return;
+
+  char *profile_path = getenv("REVNG_PROFILE_PATH");
+  if (profile_path == NULL || strlen(profile_path) == 0)
+    return;
+
+  profile_file = fopen(profile_path, "w");
+  assert(profile_file != NULL);
+
+  int result = atexit(dump_profile);
+  assert(result == 0);
+}
+
 #ifdef TRACE
 
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+
 // Execution tracing support
+//
+// Program counters are accumulated in one of two buffers. When it's full, it's
+// handed over to a writer thread, and the other one is used in the meantime.
+// If the writer thread cannot be started, buffers are written synchronously.
+//
+// Two formats are available, selected through REVNG_TRACE_FORMAT:
+//
+// * `raw` (default): a sequence of 64-bit program counters, in host endianness.
+// * `delta`: the 8 bytes magic "RVNGTRC1", followed by, for each program
+//   counter, the difference from the previous one (the first one is relative
+//   to 0), zigzag-encoded as a LEB128 varint.
+//
+// If REVNG_TRACE_BLOCKS is set to 1, only the program counters of the first
+// instruction of each translated basic block are recorded.
+
+enum { RawFormat, DeltaFormat };
+
+static const char delta_magic[8] = "RVNGTRC1";
+
+enum { MaximumRecordSize = 10 };
+
 static int trace_fd = -1;
+static int trace_format = RawFormat;
+static bool trace_blocks_only = false;
 static size_t trace_buffer_size = 1024 * 1024;
+static uint64_t last_pc = 0;
+
+static uint8_t *trace_buffers[2];
+static unsigned active_buffer = 0;
 static size_t trace_buffer_index = 0;
-static uint64_t *trace_buffer;
 
-static void flush_trace_buffer(void);
+// Written by the traced thread when handing over a buffer, reset by the writer
+// thread once it has been written out. Zero means no buffer is pending.
+static size_t pending_size = 0;
+static unsigned pending_buffer = 0;
+static bool has_writer_thread = false;
+static sem_t writer_semaphore;
 
 void flush_trace_buffer(void);
 void flush_trace_buffer_signal_handler(int signal);
 
+static void write_all(const uint8_t *data, size_t size) {
+  while (size > 0) {
+    ssize_t written = write(trace_fd, data, size);
+    if (written <= 0)
+      return;
+    data += written;
+    size -= written;
+  }
+}
+
+static void *trace_writer(void *argument) {
+  while (true) {
+    while (sem_wait(&writer_semaphore) != 0)
+      ;
+
+    size_t size = __atomic_load_n(&pending_size, __ATOMIC_ACQUIRE);
+    if (size != 0) {
+      write_all(trace_buffers[pending_buffer], size);
+      __atomic_store_n(&pending_size, 0, __ATOMIC_RELEASE);
+    }
+  }
+
+  return NULL;
+}
+
+// Busy waiting is used since this might be invoked from a signal handler
+static void wait_pending_buffer(void) {
+  while (__atomic_load_n(&pending_size, __ATOMIC_ACQUIRE) != 0)
+    sched_yield();
+}
+
+static void hand_over_trace_buffer(void) {
+  if (!has_writer_thread) {
+    flush_trace_buffer();
+    return;
+  }
+
+  wait_pending_buffer();
+  pending_buffer = active_buffer;
+  __atomic_store_n(&pending_size, trace_buffer_index, __ATOMIC_RELEASE);
+  sem_post(&writer_semaphore);
+
+  active_buffer = 1 - active_buffer;
+  trace_buffer_index = 0;
+}
+
+static bool is_env_set(const char *name, const char *value) {
+  char *string = getenv(name);
+  return string != NULL && strcmp(string, value) == 0;
+}
+
 void init_tracing(void) {
   // If REVNG_TRACE_PATH contains a path, enable tracing
   char *trace_path = getenv("REVNG_TRACE_PATH");
@@ -287,20 +426,48 @@ void init_tracing(void) {
     char *trace_buffer_size_string = getenv("REVNG_TRACE_BUFFER_SIZE");
     if (trace_buffer_size_string != NULL
         && strlen(trace_buffer_size_string) > 0) {
-      char **first_invalid = NULL;
-      trace_buffer_size = strtoll(trace_buffer_size_string, first_invalid, 0);
-      assert(**first_invalid == '\0');
+      char *first_invalid = NULL;
+      trace_buffer_size = strtoll(trace_buffer_size_string, &first_invalid, 0);
+      assert(*first_invalid == '\0');
+      assert(trace_buffer_size > 0);
+    }
+
+    char *format = getenv("REVNG_TRACE_FORMAT");
+    if (format == NULL || strlen(format) == 0 || strcmp(format, "raw") == 0)
+      trace_format = RawFormat;
+    else if (strcmp(format, "delta") == 0)
+      trace_format = DeltaFormat;
+    else
+      assert(false && "Unknown REVNG_TRACE_FORMAT");
+
+    trace_blocks_only = is_env_set("REVNG_TRACE_BLOCKS", "1");
+
+    // Allocate buffers to hold program counters, plus room for the record
+    // overflowing the nominal size
+    for (unsigned c = 0; c < 2; c++) {
+      size_t size = trace_buffer_size * sizeof(uint64_t) + MaximumRecordSize;
+      trace_buffers[c] = malloc(size);
+      assert(trace_buffers[c] != NULL);
     }
 
-    // Allocate buffer to hold program counters
-    trace_buffer = malloc(trace_buffer_size * sizeof(uint64_t));
-    assert(trace_buffer != NULL);
+    if (trace_format == DeltaFormat)
+      write_all((const uint8_t *) delta_magic, sizeof(delta_magic));
+
+    // Start the writer thread
+    if (sem_init(&writer_semaphore, 0, 0) == 0) {
+      pthread_t writer;
+      has_writer_thread = pthread_create(&writer, NULL, trace_writer, NULL)
+                          == 0;
+      if (has_writer_thread)
+        pthread_detach(writer);
+    }
 
     // In case of a crash, flush the buffer
     static const int signals[] = { SIGINT, SIGABRT, SIGTERM, SIGSEGV };
     for (unsigned c = 0; c < sizeof(signals) / sizeof(int); c++) {
       struct sigaction new_handler;
       struct sigaction old_handler;
+      memset(&new_handler, 0, sizeof(new_handler));
       new_handler.sa_handler = flush_trace_buffer_signal_handler;
       int result = sigaction(signals[c], &new_handler, &old_handler);
       assert(result == 0);
@@ -314,12 +481,19 @@ void init_tracing(void) {
   }
 }
 
-static void flush_trace_buffer(void) {
-  if (trace_fd == -1 || trace_buffer_index == 0)
+// Synchronously write out all the recorded program counters
+void flush_trace_buffer(void) {
+  if (trace_fd == -1)
+    return;
+
+  // Preserve the order with respect to the buffer being written out, if any
+  wait_pending_buffer();
+
+  if (trace_buffer_index == 0)
     return;
 
   // Write the all buffer out and reset the counter
-  write(trace_fd, trace_buffer, sizeof(uint64_t) * trace_buffer_index);
+  write_all(trace_buffers[active_buffer], trace_buffer_index);
   trace_buffer_index = 0;
 }
 
@@ -330,6 +504,7 @@ void flush_trace_buffer_signal_handler(int signal) {
 // This function is called by the syscall helpers in case of exit/exit_group
 void on_exit_syscall(void) {
   flush_trace_buffer();
+  dump_profile();
 }
 
 void newpc(uint64_t pc,
@@ -341,12 +516,31 @@ void newpc(uint64_t pc,
   if (trace_fd == -1)
     return;
 
+  if (trace_blocks_only && !is_first)
+    return;
+
   // Record the program counter
-  trace_buffer[trace_buffer_index++] = pc;
+  uint8_t *buffer = trace_buffers[active_buffer];
+  if (trace_format == RawFormat) {
+    memcpy(buffer + trace_buffer_index, &pc, sizeof(pc));
+    trace_buffer_index += sizeof(pc);
+  } else {
+    uint64_t delta = pc - last_pc;
+    uint64_t zigzag = (delta << 1) ^ (uint64_t) ((int64_t) delta >> 63);
+    last_pc = pc;
+
+    do {
+      uint8_t byte = zigzag & 0x7F;
+      zigzag >>= 7;
+      if (zigzag != 0)
+        byte |= 0x80;
+      buffer[trace_buffer_index++] = byte;
+    } while (zigzag != 0);
+  }
 
-  // If the buffer is full, flush it out
-  if (trace_buffer_index >= trace_buffer_size)
-    flush_trace_buffer();
+  // If the buffer is full, hand it over to the writer thread
+  if (trace_buffer_index >= trace_buffer_size * sizeof(uint64_t))
+    hand_over_trace_buffer();
 }
 
 #else
@@ -355,6 +549,7 @@ void init_tracing(void) {
 }
 
 void on_exit_syscall(void) {
+  dump_profile();
 }
 
 void newpc(uint64_t pc,
@@ -371,12 +566,22 @@ void newpc(uint64_t pc,
 bool is_executable(uint64_t pc) {
   assert(segments_count != 0);
 
-  // Check if the pc is inside one of the executable segments
-  for (int i = 0; i < segments_count; i++)
-    if (pc >= segment_boundaries[2 * i] && pc < segment_boundaries[2 * i + 1])
-      return true;
+  // segment_boundaries holds sorted and non-overlapping [start, end) pairs:
+  // look for the last segment starting at or before pc
+  uint64_t low = 0;
+  uint64_t high = segments_count;
+  while (low < high) {
+    uint64_t middle = low + (high - low) / 2;
+    if (segment_boundaries[2 * middle] <= pc)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+
+  if (low == 0)
+    return false;
 
-  return false;
+  return pc < segment_boundaries[2 * (low - 1) + 1];
 }
 
 void handle_sigsegv(int signo, siginfo_t *info, void *opaque_context) {
@@ -412,6 +617,9 @@ int main(int argc, char *argv[]) {
   // Initialize the tracing system
   init_tracing();
 
+  // Initialize the profiling counters, if any
+  init_profiling();
+
   // Allocate and initialize the stack
   void *stack = mmap((void *) NULL,
                      16 * 0x100000,
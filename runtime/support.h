@@ -93,6 +93,7 @@ typedef uint64_t target_reg;
 // Register values before the signal was triggered
 extern target_reg *saved_registers;
 
+// Sorted, non-overlapping [start, end) pairs of the executable segments
 extern uint64_t *segment_boundaries;
 extern uint64_t segments_count;
 
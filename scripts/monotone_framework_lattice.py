@@ -16,119 +16,115 @@ from collections import defaultdict
 import monotone_framework
 
 
-def gen_combine_values(lattice, reachability):
-    out = ""
+def lattice_elements(lattice):
+    # The elements in the order of the LatticeElement enum
+    return list(lattice.nodes())
 
-    # Emit the combine operator
-    out += """LatticeElement combineValues(const LatticeElement &LHS, const LatticeElement &RHS) {
-"""
 
+def gen_table(rows):
+    return "{\n  " + ",\n  ".join("{ " + ", ".join(row) + " }" for row in rows) + "\n}"
+
+
+def compute_less_or_equal(lattice, reachability):
+    def index(v):
+        return int(lattice.nodes[v]["index"])
+
+    elements = lattice_elements(lattice)
+    return {
+        (v1, v2): v1 == v2 or reachability[index(v1)][index(v2)] != 0
+        for v1 in elements
+        for v2 in elements
+    }
+
+
+def compute_combine(lattice, reachability):
     def node_by_index(index):
         return monotone_framework.get_unique(
             [x for x, x_data in lattice.nodes(data=True) if x_data["index"] == str(index)]
         )
 
-    result = defaultdict(lambda: [])
+    def nonzero(i):
+        return {x[0] for x in enumerate(reachability[i]) if x[1] != 0}
+
+    result = {}
     for v1, v1_data in lattice.nodes(data=True):
         for v2, v2_data in lattice.nodes(data=True):
-            if v1 != v2:
-                i1 = int(v1_data["index"])
-                i2 = int(v2_data["index"])
-
-                def nonzero(i):
-                    return {x[0] for x in enumerate(reachability[i]) if x[1] != 0}
-
-                output = max(
-                    nonzero(i1) & nonzero(i2),
-                    key=lambda i: reachability[i1][i] + reachability[i2][i],
-                )
-                output = node_by_index(output)
-
-                result[output].append((v1, v2))
-                assert output in result
-
-    first = True
-    for output, pairs in sorted(result.items(), key=lambda x: x[0]):
-        if first:
-            out += """  if ("""
-        else:
-            out += """ else if ("""
-        conditions = []
-        for this, other in sorted(pairs, key=lambda x: (x[0], x[1])):
-            condition = "(LHS == LatticeElement::{} && RHS == LatticeElement::{})"
-            condition = condition.format(this, other)
-            conditions.append(condition)
-        conditions[0] = conditions[0].lstrip()
-        conditions_string = "\n      || " if first else "\n             || "
-        out += conditions_string.join(conditions)
-        out += f""") {{
-    return LatticeElement::{output};
-    }}"""
-        first = False
-
-    out += """
-  return LHS;
-}
+            if v1 == v2:
+                result[(v1, v2)] = v1
+                continue
 
-"""
-    return out
+            i1 = int(v1_data["index"])
+            i2 = int(v2_data["index"])
+            output = max(
+                nonzero(i1) & nonzero(i2),
+                key=lambda i: reachability[i1][i] + reachability[i2][i],
+            )
+            result[(v1, v2)] = node_by_index(output)
+
+    return result
 
 
-def gen_is_less_or_equal(lattice, reachability):
+def gen_lattice_tables(lattice, reachability, tf_names, transfer_functions):
     out = ""
+    elements = lattice_elements(lattice)
 
-    # Emit the comparison operator of the lattice
-    out += """bool isLessOrEqual(const LatticeElement &LHS, const LatticeElement &RHS) {
-  return LHS == RHS
-    || """
-
-    result = []
-    for v1, v1_data in lattice.nodes(data=True):
-        for v2, v2_data in lattice.nodes(data=True):
-            if v1 != v2:
-                i1 = int(v1_data["index"])
-                i2 = int(v2_data["index"])
-                if reachability[i1][i2] != 0:
-                    condition = f"""(LHS == LatticeElement::{v1} && RHS == LatticeElement::{v2})"""
-                    result.append(condition)
-
-    out += "\n    || ".join(result)
-    out += """;
-}
+    less_or_equal = compute_less_or_equal(lattice, reachability)
+    rows = [["true" if less_or_equal[(v1, v2)] else "false" for v2 in elements] for v1 in elements]
+    out += f"""/// LessOrEqualTable[LHS][RHS] tells whether LHS <= RHS
+static constexpr bool
+  LessOrEqualTable[LatticeElementsCount][LatticeElementsCount] = {gen_table(rows)};
 
 """
-    return out
 
+    combine = compute_combine(lattice, reachability)
+    rows = [[combine[(v1, v2)] for v2 in elements] for v1 in elements]
+    out += f"""/// CombineTable[LHS][RHS] is the least upper bound of LHS and RHS
+static constexpr LatticeElement
+  CombineTable[LatticeElementsCount][LatticeElementsCount] = {gen_table(rows)};
 
-def gen_transfer_function(tf_names, transfer_functions):
-    out = ""
+"""
 
-    # Emit the transfer function implementation
-    out += """LatticeElement transfer(TransferFunction T, const LatticeElement &E) {
-  switch(T) {
+    # Transfer functions have been made total by check_transfer_functions
+    out += """/// TransferTable[T][E] is the result of the transfer function T on E, the
+/// transfer functions that do not appear in the graph are the identity
+static constexpr auto TransferTable = [] {
+  using Row = std::array<LatticeElement, LatticeElementsCount>;
+  std::array<Row, TransferKindsCount> Result{};
+  for (Row &Identity : Result)
 """
-    for tf in tf_names:
-        out += f"""  case TransferFunction::{tf}:
-    switch(E) {{
+    out += f"""    Identity = {{ {", ".join(elements)} }};
 """
-        for edge in transfer_functions[tf]:
-            source, destination = edge
-            out += f"""    case LatticeElement::{source}:
-      return LatticeElement::{destination};
+    for tf in sorted(set(tf_names)):
+        mapping = dict(transfer_functions[tf])
+        assert set(mapping) == set(elements), f"{tf} is not defined for every element"
+        row = ", ".join(mapping[v] for v in elements)
+        out += f"""  Result[TransferFunction::{tf}] = {{ {row} }};
 """
-        out += """    default:
-      revng_abort("Invalid LatticeElement value found");
-    }
+    out += """  return Result;
+}();
+"""
+    return out
 
+
+def gen_combine_values():
+    return """LatticeElement combineValues(const LatticeElement &LHS, const LatticeElement &RHS) {
+  return CombineTable[LHS][RHS];
+}
 """
 
-    out += """  default:
-    return E;
-  }
+
+def gen_is_less_or_equal():
+    return """bool isLessOrEqual(const LatticeElement &LHS, const LatticeElement &RHS) {
+  return LessOrEqualTable[LHS][RHS];
 }
+"""
 
+
+def gen_transfer_function():
+    return """LatticeElement transfer(TransferFunction T, const LatticeElement &E) {
+  return TransferTable[T][E];
+}
 """
-    return out
 
 
 def gen_lattice_element_enum(lattice):
@@ -193,11 +189,15 @@ def process_graph(path, call_arcs):
         "transfer_function_names": tf_names,
         "lattice_name": input_graph.name,
         "lattice_elements_enums": gen_lattice_element_enum(lattice),
+        "lattice_elements_count": len(lattice.nodes()),
         "extremal_lattice_element": extremal_lattice_element,
         "transfer_function_enums": gen_transfer_function_enum(tf_graph),
-        "is_less_or_equal_definition": gen_is_less_or_equal(lattice, reachability),
-        "combine_values_definition": gen_combine_values(lattice, reachability),
-        "transfer_function_definition": gen_transfer_function(tf_names, transfer_functions),
+        "lattice_tables": gen_lattice_tables(
+            lattice, reachability, tf_names, transfer_functions
+        ),
+        "is_less_or_equal_definition": gen_is_less_or_equal(),
+        "combine_values_definition": gen_combine_values(),
+        "transfer_function_definition": gen_transfer_function(),
     }
 
 
@@ -214,8 +214,10 @@ def main():
                       you can use the keywords:
                       - %LatticeName% the name of the lattice extracted from the graph name
                       - %LatticeElement% the C++ enum definition for the elements in the lattice `enum LatticeElement {...}`
+                      - %LatticeElementsCount% the number of elements in the lattice
                       - %ExtremalLatticeElement% the name for the default value for a lattice element
                       - %TransferFunction% the C++ enum definition for the possible transfer functions `enum TransferFunction {...}`
+                      - %LatticeTables% the definition of LessOrEqualTable, CombineTable and TransferTable, which respectively tabulate isLessOrEqual, combineValues and transfer
                       - %isLessOrEqual% the C++ function with signature `bool isLessOrEqual(const LatticeElement &LHS, const LatticeElement &RHS)`
                       - %combineValues% the C++ function with signature `bool combineValues(const LatticeElement &LHS, const LatticeElement &RHS)`
                       - %transfer% the C++ function with signature `bool transfer(TransferFunction T, const LatticeElement &RHS)`
@@ -237,8 +239,10 @@ def main():
     monotone_framework.out(
         template.replace("%LatticeName%", generated_code["lattice_name"])
         .replace("%LatticeElement%", generated_code["lattice_elements_enums"])
+        .replace("%LatticeElementsCount%", str(generated_code["lattice_elements_count"]))
         .replace("%ExtremalLatticeElement%", generated_code["extremal_lattice_element"])
         .replace("%TransferFunction%", generated_code["transfer_function_enums"])
+        .replace("%LatticeTables%", generated_code["lattice_tables"])
         .replace("%isLessOrEqual%", generated_code["is_less_or_equal_definition"])
         .replace("%combineValues%", generated_code["combine_values_definition"])
         .replace("%transfer%", generated_code["transfer_function_definition"])
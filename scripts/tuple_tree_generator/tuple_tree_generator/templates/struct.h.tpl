@@ -12,6 +12,8 @@ The notice below applies to the generated files.
 
 #include <compare>
 
+#include "llvm/ADT/Hashing.h"
+
 #include "revng/TupleTree/TupleTreeReference.h"
 #include "revng/Support/Assert.h"
 
@@ -132,6 +134,10 @@ struct /*= struct.fullname =*/
   /** endif **/
 
   bool localCompare(const /*= struct.user_fullname =*/ &Other) const;
+
+  /// \return a hash that is the same for objects that are equal according to
+  ///         localCompare
+  llvm::hash_code localHash() const;
 };
 
 /** if struct._key **/
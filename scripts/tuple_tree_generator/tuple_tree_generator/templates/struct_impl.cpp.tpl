@@ -7,6 +7,7 @@ The notice below applies to the generated files.
 //
 
 #include "revng/Model/Binary.h"
+#include "revng/TupleTree/TupleTreeHash.h"
 
 /**- for child_type in upcastable|sort(attribute="user_fullname") **/
 #include "/*= generator.user_include_path =*//*= child_type.filename =*/"
@@ -117,3 +118,48 @@ bool /*= struct.fullname =*/::localCompare(const /*= struct.user_fullname =*/ &O
   /**- endif -**/
 }
 
+llvm::hash_code /*= struct.fullname =*/::localHash() const {
+  /**- if struct.abstract **/
+
+  auto *This = static_cast<const /*= struct.user_fullname =*/ *>(this);
+  return upcast(This, [](const auto &Upcasted) -> llvm::hash_code {
+    return Upcasted.localHash();
+  }, llvm::hash_code(0));
+
+  /**- else -**/
+
+  llvm::hash_code Result(0);
+
+  /** for field in struct.all_fields if not field.is_guid and field.__class__.__name__ != "ReferenceStructField" **/
+
+  /**- if field.__class__.__name__ == "SimpleStructField" **/
+
+  /**- if schema.get_definition_for(field.type).__class__.__name__ == "StructDefinition" -**/
+  Result = llvm::hash_combine(Result, this->/*= field.name =*/.localHash());
+  /**- else -**/
+  Result = llvm::hash_combine(Result,
+                              tupletree::hashScalar(this->/*= field.name =*/));
+  /**- endif -**/
+
+  /**- elif field.__class__.__name__ == "SequenceStructField" -**/
+  Result = llvm::hash_combine(Result, this->/*= field.name =*/.size());
+  for (const auto &Element : this->/*= field.name =*/) {
+    /**- if schema.get_definition_for(field.element_type).__class__.__name__ == "StructDefinition" -**/
+    /** if field.upcastable **/
+    Result = llvm::hash_combine(Result, Element->localHash());
+    /** else **/
+    Result = llvm::hash_combine(Result, Element.localHash());
+    /** endif **/
+    /**- else -**/
+    Result = llvm::hash_combine(Result, tupletree::hashScalar(Element));
+    /**- endif -**/
+  }
+
+  /** else **//*= ERROR("unexpected field type") =*//** endif **/
+
+  /** endfor **/
+
+  return Result;
+  /**- endif -**/
+}
+
@@ -50,6 +50,27 @@ macro(artifact_handler CATEGORY INPUT_FILE CONFIGURATION OUTPUT TARGET_NAME)
 
     endif()
 
+    #
+    # Ensure running EFA on 1 and many threads produces the same output
+    #
+    set(SERIAL_CFG "${OUTPUT}.serial.yml")
+    set(PARALLEL_CFG "${OUTPUT}.parallel.yml")
+    set(TEST_NAME test-lifted-${CATEGORY}-${TARGET_NAME}-deterministic)
+    add_test(
+      NAME ${TEST_NAME}
+      COMMAND
+        sh -c "REVNG_THREADS=1 ./bin/revng opt ${OUTPUT} --detect-abi \
+        --collect-cfg --efa-jobs=1 -S \
+        | REVNG_THREADS=1 ./bin/revng efa-extractcfg -j 1 > ${SERIAL_CFG} \
+        && REVNG_THREADS=8 ./bin/revng opt ${OUTPUT} --detect-abi \
+        --collect-cfg --efa-jobs=8 -S \
+        | REVNG_THREADS=8 ./bin/revng efa-extractcfg -j 8 > ${PARALLEL_CFG} \
+        && cmp ${SERIAL_CFG} ${PARALLEL_CFG}")
+    set_tests_properties(
+      ${TEST_NAME}
+      PROPERTIES LABELS
+                 "deterministic;analysis;${CATEGORY};${CONFIGURATION}")
+
   endif()
 endmacro()
 register_derived_artifact("compiled" "lifted" ".ll" "FILE")
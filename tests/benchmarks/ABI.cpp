@@ -0,0 +1,484 @@
+/// \file ABI.cpp
+/// \brief Measures the throughput of the conversions between
+///        `CABIFunctionType` and `RawFunctionType` and of the computation and
+///        verification of their layouts, for each ABI
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <map>
+#include <optional>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/ToolOutputFile.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "revng/ABI/FunctionType.h"
+#include "revng/Model/Binary.h"
+#include "revng/Model/Types.h"
+#include "revng/Support/Assert.h"
+#include "revng/TupleTree/TupleTree.h"
+
+using std::string;
+using namespace llvm;
+using namespace llvm::cl;
+
+static cl::OptionCategory BenchCategory("revng-bench-abi options", "");
+
+static cl::list<string> ABIs("abi",
+                             desc("the ABIs to measure, can be repeated "
+                                  "(default: all of them)"),
+                             ZeroOrMore,
+                             CommaSeparated,
+                             cat(BenchCategory));
+
+static opt<unsigned> PrototypesCount("prototypes",
+                                     desc("number of random prototypes "
+                                          "generated for each ABI"),
+                                     cat(BenchCategory),
+                                     init(1000));
+
+static opt<unsigned> MaxArguments("max-arguments",
+                                  desc("maximum number of arguments of the "
+                                       "generated prototypes"),
+                                  cat(BenchCategory),
+                                  init(8));
+
+static opt<unsigned> Seed("seed",
+                          desc("seed of the prototype generator"),
+                          cat(BenchCategory),
+                          init(0));
+
+static opt<double> MinTime("min-time",
+                           desc("minimum number of seconds each operation is "
+                                "repeated for"),
+                           cat(BenchCategory),
+                           init(0.1));
+
+static opt<string> BaselinePath("baseline",
+                                desc("compare against this previous report "
+                                     "and fail on regressions"),
+                                value_desc("path"),
+                                cat(BenchCategory));
+
+static opt<double> Tolerance("tolerance",
+                             desc("slowdown with respect to the baseline "
+                                  "considered a regression (default: 0.2, "
+                                  "i.e., 20%)"),
+                             cat(BenchCategory),
+                             init(0.2));
+
+static opt<string> OutputPath("o",
+                              desc("write the report here instead of stdout"),
+                              value_desc("path"),
+                              cat(BenchCategory),
+                              init("-"));
+
+static ExitOnError AbortOnError;
+
+//
+// Harness
+//
+
+using Clock = std::chrono::steady_clock;
+
+/// \brief Runs \p Operation on the result of \p Setup until MinTime has passed
+///
+/// Only \p Operation is timed: \p Setup is used to give each run a fresh copy
+/// of the data it modifies.
+///
+/// \return the average number of seconds taken by a run
+template<typename S, typename F>
+static double measure(S &&Setup, F &&Operation) {
+  std::chrono::duration<double> Elapsed(0);
+  size_t Runs = 0;
+  do {
+    auto State = Setup();
+    auto Start = Clock::now();
+    Operation(State);
+    Elapsed += Clock::now() - Start;
+    ++Runs;
+  } while (Elapsed.count() < MinTime);
+
+  return Elapsed.count() / Runs;
+}
+
+template<typename F>
+static double measure(F &&Operation) {
+  return measure([] { return 0; }, [&](int) { Operation(); });
+}
+
+/// \brief The measurements of all the ABIs, in order
+class Report {
+private:
+  json::Array Results;
+
+public:
+  void add(model::ABI::Values ABI,
+           StringRef Operation,
+           size_t Count,
+           double Seconds,
+           size_t Succeeded) {
+    Results.push_back(json::Object{
+      { "abi", model::ABI::getName(ABI).str() },
+      { "operation", Operation.str() },
+      { "prototypes", static_cast<int64_t>(Count) },
+      { "succeeded", static_cast<int64_t>(Succeeded) },
+      { "ns_per_prototype", Seconds * 1e9 / Count },
+    });
+  }
+
+  const json::Array &results() const { return Results; }
+
+  void write(raw_ostream &OS) const {
+    json::Value Value = json::Object{ { "results", json::Array(Results) } };
+    OS << formatv("{0:2}", Value) << "\n";
+  }
+};
+
+//
+// Prototype generation
+//
+
+/// \brief Populates a binary with random prototypes using a certain ABI
+///
+/// The arguments and return values are a mix of integers, floating point
+/// values, pointers and small structs, so that all the paths of the
+/// conversion (registers, stack, splitting, pointers to copies) are taken.
+class PrototypeGenerator {
+private:
+  TupleTree<model::Binary> &Binary;
+  model::ABI::Values ABI;
+  std::mt19937_64 Random;
+  std::vector<model::TypePath> Structs;
+
+public:
+  PrototypeGenerator(TupleTree<model::Binary> &Binary,
+                     model::ABI::Values ABI,
+                     uint64_t Seed) :
+    Binary(Binary), ABI(ABI), Random(Seed) {
+
+    Binary->Architecture = model::ABI::getArchitecture(ABI);
+    Binary->DefaultABI = ABI;
+
+    constexpr unsigned StructsCount = 16;
+    for (unsigned I = 0; I < StructsCount; ++I)
+      Structs.push_back(makeStruct());
+  }
+
+public:
+  void makePrototype() {
+    using namespace model;
+    auto Path = Binary->recordNewType(model::makeType<CABIFunctionType>());
+    auto *Prototype = llvm::cast<CABIFunctionType>(Path.get());
+    Prototype->ABI = ABI;
+
+    // One prototype out of four returns void
+    if (pick(4) == 0)
+      Prototype->ReturnType = { primitive(PrimitiveTypeKind::Void, 0), {} };
+    else
+      Prototype->ReturnType = randomType();
+
+    unsigned ArgumentsCount = pick(MaxArguments + 1);
+    for (unsigned I = 0; I < ArgumentsCount; ++I) {
+      model::Argument Argument{ I };
+      Argument.Type = randomType();
+      Prototype->Arguments.insert(Argument);
+    }
+  }
+
+private:
+  unsigned pick(unsigned Count) {
+    return std::uniform_int_distribution<unsigned>(0, Count - 1)(Random);
+  }
+
+  model::TypePath primitive(model::PrimitiveTypeKind::Values Kind,
+                            uint8_t Size) {
+    return Binary->getPrimitiveType(Kind, Size);
+  }
+
+  model::QualifiedType randomScalar() {
+    using namespace model;
+    static constexpr uint8_t IntegerSizes[] = { 1, 2, 4, 8 };
+    static constexpr uint8_t FloatSizes[] = { 4, 8 };
+
+    switch (pick(4)) {
+    case 0:
+      return { primitive(PrimitiveTypeKind::Signed, IntegerSizes[pick(4)]),
+               {} };
+    case 1:
+      return { primitive(PrimitiveTypeKind::Unsigned, IntegerSizes[pick(4)]),
+               {} };
+    case 2:
+      return { primitive(PrimitiveTypeKind::Float, FloatSizes[pick(2)]), {} };
+    case 3:
+      return { primitive(PrimitiveTypeKind::Void, 0),
+               { Qualifier::createPointer(Binary->Architecture) } };
+    default:
+      revng_abort();
+    }
+  }
+
+  model::QualifiedType randomType() {
+    // One type out of five is a struct
+    if (pick(5) == 0)
+      return { Structs[pick(Structs.size())], {} };
+    return randomScalar();
+  }
+
+  model::TypePath makeStruct() {
+    using namespace model;
+    auto Path = Binary->recordNewType(model::makeType<StructType>());
+    auto *Struct = llvm::cast<StructType>(Path.get());
+
+    uint64_t Offset = 0;
+    uint64_t Alignment = 1;
+    unsigned FieldsCount = 1 + pick(6);
+    for (unsigned I = 0; I < FieldsCount; ++I) {
+      QualifiedType FieldType = randomScalar();
+      uint64_t Size = *FieldType.size();
+      Offset = alignTo(Offset, Size);
+      Alignment = std::max(Alignment, Size);
+
+      model::StructField Field{ Offset };
+      Field.Type = FieldType;
+      Struct->Fields.insert(Field);
+      Offset += Size;
+    }
+    Struct->Size = alignTo(Offset, Alignment);
+
+    return Path;
+  }
+};
+
+template<typename T>
+static std::vector<const T *> collect(const TupleTree<model::Binary> &Binary) {
+  std::vector<const T *> Result;
+  for (const model::UpcastableType &Type : Binary->Types)
+    if (auto *Upcasted = llvm::dyn_cast<T>(Type.get()))
+      Result.push_back(Upcasted);
+  return Result;
+}
+
+/// \brief A binary paired with the prototypes to operate on
+template<typename T>
+struct Prototypes {
+  TupleTree<model::Binary> Binary;
+  std::vector<const T *> List;
+
+  explicit Prototypes(const TupleTree<model::Binary> &Original) :
+    Binary(Original.clone()), List(collect<T>(Binary)) {}
+};
+
+//
+// Driver
+//
+
+using FunctionTypeLayout = abi::FunctionType::Layout;
+
+static void benchmarkABI(Report &R, model::ABI::Values ABI) {
+  TupleTree<model::Binary> CABI;
+  PrototypeGenerator Generator(CABI, ABI, Seed);
+  for (unsigned I = 0; I < PrototypesCount; ++I)
+    Generator.makePrototype();
+  revng_check(CABI->verify(true));
+
+  auto CABIPrototypes = collect<model::CABIFunctionType>(CABI);
+  size_t Count = CABIPrototypes.size();
+
+  // The data verified and converted by the following operations
+  TupleTree<model::Binary> Raw = CABI.clone();
+  for (const model::CABIFunctionType *Prototype :
+       collect<model::CABIFunctionType>(Raw))
+    abi::FunctionType::convertToRaw(*Prototype, Raw);
+  auto RawPrototypes = collect<model::RawFunctionType>(Raw);
+  revng_check(RawPrototypes.size() == Count);
+
+  std::vector<FunctionTypeLayout> Layouts;
+  for (const model::CABIFunctionType *Prototype : CABIPrototypes)
+    Layouts.emplace_back(*Prototype);
+  for (const model::RawFunctionType *Prototype : RawPrototypes)
+    Layouts.emplace_back(*Prototype);
+
+  using CABIList = Prototypes<model::CABIFunctionType>;
+  R.add(ABI,
+        "to-raw",
+        Count,
+        measure([&] { return CABIList(CABI); },
+                [](CABIList &State) {
+                  for (const model::CABIFunctionType *Prototype : State.List)
+                    abi::FunctionType::convertToRaw(*Prototype, State.Binary);
+                }),
+        Count);
+
+  using RawList = Prototypes<model::RawFunctionType>;
+  size_t Converted = 0;
+  R.add(ABI,
+        "to-cabi",
+        Count,
+        measure([&] { return RawList(Raw); },
+                [&](RawList &State) {
+                  Converted = 0;
+                  for (const model::RawFunctionType *Prototype : State.List)
+                    if (abi::FunctionType::tryConvertToCABI(*Prototype,
+                                                            State.Binary,
+                                                            ABI))
+                      ++Converted;
+                }),
+        Converted);
+
+  R.add(ABI,
+        "layout-cabi",
+        Count,
+        measure([&] {
+          for (const model::CABIFunctionType *Prototype : CABIPrototypes)
+            FunctionTypeLayout(*Prototype).argumentRegisterCount();
+        }),
+        Count);
+
+  R.add(ABI,
+        "layout-raw",
+        Count,
+        measure([&] {
+          for (const model::RawFunctionType *Prototype : RawPrototypes)
+            FunctionTypeLayout(*Prototype).argumentRegisterCount();
+        }),
+        Count);
+
+  size_t ValidLayouts = 0;
+  R.add(ABI,
+        "verify-layout",
+        Layouts.size(),
+        measure([&] {
+          ValidLayouts = llvm::count_if(Layouts,
+                                        [](const FunctionTypeLayout &L) {
+                                          return L.verify();
+                                        });
+        }),
+        ValidLayouts);
+
+  size_t ValidTypes = 0;
+  R.add(ABI,
+        "verify-type",
+        Count * 2,
+        measure([&] {
+          ValidTypes = 0;
+          for (const model::CABIFunctionType *Prototype : CABIPrototypes)
+            ValidTypes += Prototype->verify() ? 1 : 0;
+          for (const model::RawFunctionType *Prototype : RawPrototypes)
+            ValidTypes += Prototype->verify() ? 1 : 0;
+        }),
+        ValidTypes);
+}
+
+/// \brief Compares \p R against the report at BaselinePath
+///
+/// \return the number of measurements slower than the baseline by more than
+///         Tolerance
+static unsigned compareToBaseline(const Report &R) {
+  auto MaybeBuffer = MemoryBuffer::getFile(BaselinePath);
+  auto Buffer = AbortOnError(errorOrToExpected(std::move(MaybeBuffer)));
+  json::Value Baseline = AbortOnError(json::parse(Buffer->getBuffer()));
+
+  using Key = std::pair<string, string>;
+  std::map<Key, double> Previous;
+  auto *Object = Baseline.getAsObject();
+  const json::Array *Results = Object ? Object->getArray("results") : nullptr;
+  if (Results == nullptr)
+    AbortOnError(createStringError(inconvertibleErrorCode(),
+                                   "the baseline is not a revng-bench-abi "
+                                   "report"));
+
+  auto GetKey = [](const json::Object &Entry) -> std::optional<Key> {
+    auto ABI = Entry.getString("abi");
+    auto Operation = Entry.getString("operation");
+    if (not ABI or not Operation)
+      return std::nullopt;
+    return Key{ ABI->str(), Operation->str() };
+  };
+
+  for (const json::Value &Value : *Results) {
+    const json::Object *Entry = Value.getAsObject();
+    if (Entry == nullptr)
+      continue;
+    auto MaybeKey = GetKey(*Entry);
+    auto Time = Entry->getNumber("ns_per_prototype");
+    if (MaybeKey and Time)
+      Previous[*MaybeKey] = *Time;
+  }
+
+  unsigned Regressions = 0;
+  for (const json::Value &Value : R.results()) {
+    const json::Object &Entry = *Value.getAsObject();
+    auto It = Previous.find(*GetKey(Entry));
+    if (It == Previous.end())
+      continue;
+
+    double Current = *Entry.getNumber("ns_per_prototype");
+    double Before = It->second;
+    if (Current > Before * (1 + Tolerance)) {
+      ++Regressions;
+      errs() << formatv("Regression: {0} {1}: {2:f1} ns -> {3:f1} ns "
+                        "(+{4:f1}%)\n",
+                        It->first.first,
+                        It->first.second,
+                        Before,
+                        Current,
+                        (Current / Before - 1) * 100);
+    }
+  }
+
+  return Regressions;
+}
+
+int main(int argc, const char *argv[]) {
+  HideUnrelatedOptions(BenchCategory);
+  ParseCommandLineOptions(argc, argv);
+
+  if (PrototypesCount == 0)
+    AbortOnError(createStringError(inconvertibleErrorCode(),
+                                   "prototypes must be positive"));
+
+  std::vector<model::ABI::Values> ToRun;
+  for (const string &Name : ABIs) {
+    auto ABI = model::ABI::fromName(Name);
+    if (ABI == model::ABI::Invalid)
+      AbortOnError(createStringError(inconvertibleErrorCode(),
+                                     "unknown ABI: " + Name));
+    ToRun.push_back(ABI);
+  }
+
+  if (ToRun.empty())
+    for (unsigned I = 1; I < model::ABI::Count; ++I)
+      ToRun.push_back(static_cast<model::ABI::Values>(I));
+
+  Report R;
+  for (model::ABI::Values ABI : ToRun)
+    benchmarkABI(R, ABI);
+
+  std::error_code EC;
+  ToolOutputFile Output(OutputPath, EC, sys::fs::OF_Text);
+  AbortOnError(errorCodeToError(EC));
+  R.write(Output.os());
+  Output.keep();
+
+  if (not BaselinePath.empty() and compareToBaseline(R) != 0)
+    return EXIT_FAILURE;
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,885 @@
+/// \file ADT.cpp
+/// \brief Micro-benchmarks of the revng ADT containers against their LLVM and
+///        standard library counterparts, and of other hot support code
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <iterator>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <malloc.h>
+
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/DepthFirstIterator.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallBitVector.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/IR/ConstantRange.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/ToolOutputFile.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "revng/ADT/ConstantRangeSet.h"
+#include "revng/ADT/GenericGraph.h"
+#include "revng/ADT/LazySmallBitVector.h"
+#include "revng/ADT/MutableSet.h"
+#include "revng/ADT/SmallMap.h"
+#include "revng/ADT/SortedVector.h"
+#include "revng/ADT/UniquedStack.h"
+#include "revng/ADT/ZipMapIterator.h"
+#include "revng/Support/Assert.h"
+#include "revng/Support/MetaAddress.h"
+
+using std::string;
+using namespace llvm;
+using namespace llvm::cl;
+
+static cl::OptionCategory BenchCategory("revng-bench-adt options", "");
+
+static cl::list<unsigned> Sizes("size",
+                                desc("number of elements of the containers, "
+                                     "can be repeated (default: 16, 1024 and "
+                                     "65536)"),
+                                ZeroOrMore,
+                                CommaSeparated,
+                                cat(BenchCategory));
+
+static opt<double> MinTime("min-time",
+                           desc("minimum number of seconds each operation is "
+                                "repeated for"),
+                           cat(BenchCategory),
+                           init(0.1));
+
+static opt<string> Filter("filter",
+                          desc("only run the families whose name contains "
+                               "this string"),
+                          cat(BenchCategory));
+
+static opt<string> OutputPath("o",
+                              desc("write the report here instead of stdout"),
+                              value_desc("path"),
+                              cat(BenchCategory),
+                              init("-"));
+
+static ExitOnError AbortOnError;
+
+//
+// Heap accounting, used to measure the memory footprint
+//
+// The allocation functions of glibc are wrapped, rather than operator new,
+// since not all the containers go through the latter (e.g., llvm::SmallVector
+// calls malloc directly). mallinfo is not precise enough either, since it
+// accounts the chunks cached by each thread as in use.
+//
+
+extern "C" {
+void *__libc_malloc(size_t Size);
+void *__libc_calloc(size_t Count, size_t Size);
+void *__libc_realloc(void *Pointer, size_t Size);
+void *__libc_memalign(size_t Alignment, size_t Size);
+void __libc_free(void *Pointer);
+}
+
+static size_t LiveBytes = 0;
+
+static void *track(void *Pointer) {
+  if (Pointer != nullptr)
+    LiveBytes += malloc_usable_size(Pointer);
+  return Pointer;
+}
+
+static void untrack(void *Pointer) {
+  if (Pointer != nullptr)
+    LiveBytes -= malloc_usable_size(Pointer);
+}
+
+extern "C" {
+
+void *malloc(size_t Size) {
+  return track(__libc_malloc(Size));
+}
+
+void *calloc(size_t Count, size_t Size) {
+  return track(__libc_calloc(Count, Size));
+}
+
+void *realloc(void *Pointer, size_t Size) {
+  untrack(Pointer);
+  return track(__libc_realloc(Pointer, Size));
+}
+
+void *memalign(size_t Alignment, size_t Size) {
+  return track(__libc_memalign(Alignment, Size));
+}
+
+void *aligned_alloc(size_t Alignment, size_t Size) {
+  return memalign(Alignment, Size);
+}
+
+int posix_memalign(void **Result, size_t Alignment, size_t Size) {
+  *Result = memalign(Alignment, Size);
+  return *Result == nullptr ? ENOMEM : 0;
+}
+
+void free(void *Pointer) {
+  untrack(Pointer);
+  __libc_free(Pointer);
+}
+}
+
+//
+// Harness
+//
+
+/// \brief Prevents the compiler from optimizing away the computation of \p V
+template<typename T>
+static void doNotOptimize(const T &V) {
+  asm volatile("" : : "g"(&V) : "memory");
+}
+
+using Clock = std::chrono::steady_clock;
+
+/// \brief Runs \p Operation until MinTime has passed
+///
+/// \return the average number of seconds taken by a run
+template<typename F>
+static double measure(F &&Operation) {
+  std::chrono::duration<double> Elapsed(0);
+  size_t Runs = 0;
+  do {
+    auto Start = Clock::now();
+    Operation();
+    Elapsed += Clock::now() - Start;
+    ++Runs;
+  } while (Elapsed.count() < MinTime);
+
+  return Elapsed.count() / Runs;
+}
+
+/// \brief The measurements of all the families, in order
+class Report {
+private:
+  json::Array Results;
+
+public:
+  void addTime(StringRef Family,
+               StringRef Operation,
+               StringRef Container,
+               size_t Size,
+               double Seconds) {
+    Results.push_back(json::Object{
+      { "family", Family.str() },
+      { "operation", Operation.str() },
+      { "container", Container.str() },
+      { "size", static_cast<int64_t>(Size) },
+      { "ns_per_element", Seconds * 1e9 / Size },
+    });
+  }
+
+  void addFootprint(StringRef Family,
+                    StringRef Container,
+                    size_t Size,
+                    size_t Bytes) {
+    Results.push_back(json::Object{
+      { "family", Family.str() },
+      { "operation", "footprint" },
+      { "container", Container.str() },
+      { "size", static_cast<int64_t>(Size) },
+      { "bytes_per_element", static_cast<double>(Bytes) / Size },
+    });
+  }
+
+  void write(raw_ostream &OS) {
+    json::Value Value = json::Object{ { "results", std::move(Results) } };
+    OS << formatv("{0:2}", Value) << "\n";
+  }
+};
+
+/// \brief \return the number of bytes, inline and on the heap, of the object
+///        built by \p Build
+template<typename F>
+static size_t footprint(F &&Build) {
+  size_t Before = LiveBytes;
+  auto Object = Build();
+  size_t After = LiveBytes;
+  doNotOptimize(Object);
+  return sizeof(Object) + (After - Before);
+}
+
+/// \brief A bijection scattering consecutive integers
+static uint64_t scramble(uint64_t Value) {
+  return Value * 0x9E3779B97F4A7C15ULL;
+}
+
+/// \brief \p Size distinct keys, in a pseudo-random order
+///
+/// Keys of sequences with consecutive \p Offset overlap for half of their
+/// elements.
+static std::vector<uint64_t> getKeys(size_t Size, size_t Offset = 0) {
+  std::vector<uint64_t> Result;
+  Result.reserve(Size);
+  for (size_t I = 0; I < Size; ++I)
+    Result.push_back(scramble(I + Offset * Size / 2));
+  return Result;
+}
+
+//
+// Sets
+//
+
+template<typename SetType, typename RangeType>
+static void insertAll(SetType &Set, const RangeType &Keys) {
+  if constexpr (revng::detail::IsSortedVector<SetType>) {
+    // This is how SortedVectors are meant to be populated
+    auto Inserter = Set.batch_insert();
+    for (uint64_t Key : Keys)
+      Inserter.insert(Key);
+  } else {
+    for (uint64_t Key : Keys)
+      Set.insert(Key);
+  }
+}
+
+template<typename SetType>
+static void benchmarkSet(Report &R, StringRef Name, size_t Size) {
+  constexpr auto Family = "set";
+  std::vector<uint64_t> Keys = getKeys(Size);
+  std::vector<uint64_t> OtherKeys = getKeys(Size, 1);
+
+  auto Build = [&](ArrayRef<uint64_t> Keys) {
+    SetType Result;
+    insertAll(Result, Keys);
+    return Result;
+  };
+
+  R.addTime(Family, "insert", Name, Size, measure([&] {
+              doNotOptimize(Build(Keys).size());
+            }));
+
+  SetType Set = Build(Keys);
+  R.addTime(Family, "lookup", Name, Size, measure([&] {
+              size_t Found = 0;
+              for (uint64_t Key : Keys)
+                Found += Set.count(Key);
+              doNotOptimize(Found);
+            }));
+
+  R.addTime(Family, "iterate", Name, Size, measure([&] {
+              uint64_t Sum = 0;
+              for (uint64_t Key : Set)
+                Sum += Key;
+              doNotOptimize(Sum);
+            }));
+
+  SetType Other = Build(OtherKeys);
+  R.addTime(Family, "merge", Name, Size, measure([&] {
+              SetType Merged = Set;
+              insertAll(Merged, Other);
+              doNotOptimize(Merged.size());
+            }));
+
+  R.addFootprint(Family, Name, Size, footprint([&] { return Build(Keys); }));
+}
+
+//
+// Maps
+//
+
+template<typename MapType>
+static void benchmarkMap(Report &R, StringRef Name, size_t Size) {
+  constexpr auto Family = "map";
+  std::vector<uint64_t> Keys = getKeys(Size);
+  std::vector<uint64_t> OtherKeys = getKeys(Size, 1);
+
+  auto Build = [&](ArrayRef<uint64_t> Keys) {
+    MapType Result;
+    for (uint64_t Key : Keys)
+      Result[Key] = Key;
+    return Result;
+  };
+
+  R.addTime(Family, "insert", Name, Size, measure([&] {
+              doNotOptimize(Build(Keys).size());
+            }));
+
+  MapType Map = Build(Keys);
+  R.addTime(Family, "lookup", Name, Size, measure([&] {
+              uint64_t Sum = 0;
+              for (uint64_t Key : Keys)
+                Sum += Map.find(Key)->second;
+              doNotOptimize(Sum);
+            }));
+
+  R.addTime(Family, "iterate", Name, Size, measure([&] {
+              uint64_t Sum = 0;
+              for (const auto &[Key, Value] : Map)
+                Sum += Value;
+              doNotOptimize(Sum);
+            }));
+
+  MapType Other = Build(OtherKeys);
+  R.addTime(Family, "merge", Name, Size, measure([&] {
+              MapType Merged = Map;
+              for (const auto &[Key, Value] : Other)
+                Merged.insert({ Key, Value });
+              doNotOptimize(Merged.size());
+            }));
+
+  R.addFootprint(Family, Name, Size, footprint([&] { return Build(Keys); }));
+}
+
+//
+// Bit vectors
+//
+
+static void setBit(LazySmallBitVector &Vector, unsigned Index) {
+  Vector.set(Index);
+}
+
+template<typename T>
+static void setBit(T &Vector, unsigned Index) {
+  if (Index >= Vector.size())
+    Vector.resize(Index + 1);
+  Vector.set(Index);
+}
+
+static bool testBit(const LazySmallBitVector &Vector, unsigned Index) {
+  return Vector[Index];
+}
+
+template<typename T>
+static bool testBit(const T &Vector, unsigned Index) {
+  return Index < Vector.size() and Vector.test(Index);
+}
+
+static auto setBits(const LazySmallBitVector &Vector) {
+  return make_range(Vector.begin(), Vector.end());
+}
+
+template<typename T>
+static auto setBits(const T &Vector) {
+  return Vector.set_bits();
+}
+
+static void orBits(LazySmallBitVector &Vector,
+                   const LazySmallBitVector &Other) {
+  Vector |= Other;
+}
+
+template<typename T>
+static void orBits(T &Vector, const T &Other) {
+  if (Vector.size() < Other.size())
+    Vector.resize(Other.size());
+  Vector |= Other;
+}
+
+template<typename BitVectorType>
+static void benchmarkBitVector(Report &R, StringRef Name, size_t Size) {
+  constexpr auto Family = "bitvector";
+
+  // Half of the bits in the range are set
+  auto getIndexes = [Size](size_t Offset) {
+    std::vector<unsigned> Result;
+    for (uint64_t Key : getKeys(Size, Offset))
+      Result.push_back(Key % (2 * Size));
+    return Result;
+  };
+  std::vector<unsigned> Indexes = getIndexes(0);
+  std::vector<unsigned> OtherIndexes = getIndexes(1);
+
+  auto Build = [&](ArrayRef<unsigned> Indexes) {
+    BitVectorType Result;
+    for (unsigned Index : Indexes)
+      setBit(Result, Index);
+    return Result;
+  };
+
+  R.addTime(Family, "insert", Name, Size, measure([&] {
+              doNotOptimize(Build(Indexes));
+            }));
+
+  BitVectorType Vector = Build(Indexes);
+  R.addTime(Family, "lookup", Name, Size, measure([&] {
+              size_t Found = 0;
+              for (unsigned Index = 0; Index < Size; ++Index)
+                Found += testBit(Vector, Index);
+              doNotOptimize(Found);
+            }));
+
+  R.addTime(Family, "iterate", Name, Size, measure([&] {
+              uint64_t Sum = 0;
+              for (unsigned Index : setBits(Vector))
+                Sum += Index;
+              doNotOptimize(Sum);
+            }));
+
+  BitVectorType Other = Build(OtherIndexes);
+  R.addTime(Family, "merge", Name, Size, measure([&] {
+              BitVectorType Merged = Vector;
+              orBits(Merged, Other);
+              doNotOptimize(Merged);
+            }));
+
+  R.addFootprint(Family, Name, Size, footprint([&] {
+                   return Build(Indexes);
+                 }));
+}
+
+//
+// Ranges
+//
+
+/// \brief \p Size disjoint 64-bit ranges, in a pseudo-random order
+static std::vector<ConstantRange> getRanges(size_t Size) {
+  std::vector<ConstantRange> Result;
+  for (uint64_t Key : getKeys(Size)) {
+    uint64_t Start = Key & ~uint64_t(0xFF);
+    Result.emplace_back(APInt(64, Start), APInt(64, Start + 0x10));
+  }
+  return Result;
+}
+
+/// \brief Compares ConstantRangeSet with its lossy counterpart, ConstantRange,
+///        which can only represent the hull of the ranges
+template<typename RangeType>
+static void benchmarkRanges(Report &R, StringRef Name, size_t Size) {
+  constexpr auto Family = "ranges";
+  std::vector<ConstantRange> Ranges = getRanges(Size);
+
+  auto Build = [&] {
+    RangeType Result(ConstantRange::getEmpty(64));
+    for (const ConstantRange &Range : Ranges)
+      Result = Result.unionWith(RangeType(Range));
+    return Result;
+  };
+
+  R.addTime(Family, "merge", Name, Size, measure([&] {
+              doNotOptimize(Build().isEmptySet());
+            }));
+
+  RangeType Set = Build();
+  R.addTime(Family, "lookup", Name, Size, measure([&] {
+              size_t Found = 0;
+              for (const ConstantRange &Range : Ranges)
+                Found += Set.contains(RangeType(Range));
+              doNotOptimize(Found);
+            }));
+
+  R.addFootprint(Family, Name, Size, footprint(Build));
+}
+
+//
+// Zipped iteration
+//
+
+/// \brief Compares zipmap_range with the corresponding hand-written loop over
+///        two sorted containers
+template<typename ContainerType>
+static void benchmarkZip(Report &R, StringRef Name, size_t Size) {
+  constexpr auto Family = "zip";
+
+  auto Build = [Size](size_t Offset) {
+    ContainerType Result;
+    for (uint64_t Key : getKeys(Size, Offset))
+      Result.insert({ Key, Key });
+    return Result;
+  };
+  ContainerType Left = Build(0);
+  ContainerType Right = Build(1);
+
+  R.addTime(Family, "iterate", "zipmap_range(" + Name.str() + ")", Size,
+            measure([&] {
+              size_t Both = 0;
+              for (auto [LeftIt, RightIt] : zipmap_range(Left, Right))
+                Both += LeftIt != nullptr and RightIt != nullptr;
+              doNotOptimize(Both);
+            }));
+
+  R.addTime(Family, "iterate", "manual(" + Name.str() + ")", Size,
+            measure([&] {
+              size_t Both = 0;
+              auto LeftIt = Left.begin();
+              auto RightIt = Right.begin();
+              while (LeftIt != Left.end() and RightIt != Right.end()) {
+                if (LeftIt->first < RightIt->first) {
+                  ++LeftIt;
+                } else if (RightIt->first < LeftIt->first) {
+                  ++RightIt;
+                } else {
+                  ++Both;
+                  ++LeftIt;
+                  ++RightIt;
+                }
+              }
+              doNotOptimize(Both);
+            }));
+
+  // Zipping with a much smaller container, as when diffing large models or
+  // merging sparse register maps
+  ContainerType Sparse;
+  for (uint64_t Key : getKeys(std::max<size_t>(Size / 64, 1), 1))
+    Sparse.insert({ Key, Key });
+
+  R.addTime(Family, "iterate-sparse", "zipmap_range(" + Name.str() + ")", Size,
+            measure([&] {
+              size_t Both = 0;
+              for (auto [LeftIt, RightIt] : zipmap_range(Left, Sparse))
+                Both += LeftIt != nullptr and RightIt != nullptr;
+              doNotOptimize(Both);
+            }));
+}
+
+/// \brief Entry of a SortedVector behaving like an element of a map
+struct KeyValue {
+  uint64_t first;
+  uint64_t second;
+};
+
+template<>
+struct KeyedObjectTraits<KeyValue> {
+  static uint64_t key(const KeyValue &Obj) { return Obj.first; }
+  static KeyValue fromKey(const uint64_t &Key) { return { Key, 0 }; }
+};
+
+/// \brief Same as KeyValue, but with a key that is costly to compare, as the
+///        keys of the objects in the model
+struct NamedKeyValue {
+  std::string first;
+  uint64_t second;
+
+  NamedKeyValue(std::string Key, uint64_t Value) :
+    first(std::move(Key)), second(Value) {}
+
+  NamedKeyValue(uint64_t Key, uint64_t Value) :
+    first(formatv("/Types/Struct-{0:x16}", Key).str()), second(Value) {}
+};
+
+template<>
+struct KeyedObjectTraits<NamedKeyValue> {
+  static std::string key(const NamedKeyValue &Obj) { return Obj.first; }
+  static NamedKeyValue fromKey(const std::string &Key) { return { Key, 0 }; }
+};
+
+//
+// Graphs
+//
+
+struct BenchNodeData {
+  BenchNodeData(unsigned Index) : Index(Index) {}
+  unsigned Index;
+};
+
+using BenchNode = ForwardNode<BenchNodeData>;
+
+/// \brief The successors of a node of a graph with \p Size nodes, all of
+///        which are reachable from the first one
+static std::array<unsigned, 2> getSuccessors(unsigned Index, size_t Size) {
+  return { static_cast<unsigned>((Index + 1) % Size),
+           static_cast<unsigned>(scramble(Index) % Size) };
+}
+
+static void benchmarkGenericGraph(Report &R, size_t Size) {
+  constexpr auto Family = "graph";
+  constexpr auto Name = "GenericGraph";
+
+  auto Build = [Size] {
+    auto Result = std::make_unique<GenericGraph<BenchNode>>();
+    std::vector<BenchNode *> Nodes;
+    Nodes.reserve(Size);
+    for (unsigned I = 0; I < Size; ++I)
+      Nodes.push_back(Result->addNode(I));
+    for (unsigned I = 0; I < Size; ++I)
+      for (unsigned Successor : getSuccessors(I, Size))
+        Nodes[I]->addSuccessor(Nodes[Successor]);
+    Result->setEntryNode(Nodes[0]);
+    return Result;
+  };
+
+  R.addTime(Family, "insert", Name, Size, measure([&] {
+              doNotOptimize(Build()->size());
+            }));
+
+  auto Graph = Build();
+  R.addTime(Family, "iterate", Name, Size, measure([&] {
+              uint64_t Sum = 0;
+              for (BenchNode *Node : depth_first(Graph.get()))
+                Sum += Node->Index;
+              doNotOptimize(Sum);
+            }));
+
+  R.addFootprint(Family, Name, Size, footprint(Build));
+}
+
+/// \brief The baseline for GenericGraph: a vector of adjacency lists
+static void benchmarkAdjacencyList(Report &R, size_t Size) {
+  constexpr auto Family = "graph";
+  constexpr auto Name = "std::vector<llvm::SmallVector>";
+  using Graph = std::vector<SmallVector<unsigned, 2>>;
+
+  auto Build = [Size] {
+    Graph Result(Size);
+    for (unsigned I = 0; I < Size; ++I)
+      for (unsigned Successor : getSuccessors(I, Size))
+        Result[I].push_back(Successor);
+    return Result;
+  };
+
+  R.addTime(Family, "insert", Name, Size, measure([&] {
+              doNotOptimize(Build().size());
+            }));
+
+  Graph G = Build();
+  R.addTime(Family, "iterate", Name, Size, measure([&] {
+              uint64_t Sum = 0;
+              BitVector Visited(Size);
+              SmallVector<unsigned, 16> Stack = { 0 };
+              Visited.set(0);
+              while (not Stack.empty()) {
+                unsigned Current = Stack.pop_back_val();
+                Sum += Current;
+                for (unsigned Successor : G[Current]) {
+                  if (not Visited[Successor]) {
+                    Visited.set(Successor);
+                    Stack.push_back(Successor);
+                  }
+                }
+              }
+              doNotOptimize(Sum);
+            }));
+
+  R.addFootprint(Family, Name, Size, footprint(Build));
+}
+
+//
+// Worklists
+//
+
+/// \brief Stands for an instruction or basic block in a worklist
+struct WorkItem {
+  unsigned ID = 0;
+  const WorkItem *getParent() const { return this; }
+};
+
+struct WorkItemIndex {
+  size_t operator()(const WorkItem *Item) const { return Item->ID; }
+};
+
+using DenseStack = DenseUniquedStack<const WorkItem *, WorkItemIndex>;
+
+static void pushItem(DenseStack &Stack, const WorkItem *Item) {
+  Stack.insert(Item);
+}
+
+static const WorkItem *popItem(DenseStack &Stack) {
+  return Stack.pop();
+}
+
+static void pushItem(UniquedStack<const WorkItem *> &Stack,
+                     const WorkItem *Item) {
+  Stack.insert(Item);
+}
+
+static void
+pushItem(SetVector<const WorkItem *> &Stack, const WorkItem *Item) {
+  Stack.insert(Item);
+}
+
+static const WorkItem *popItem(UniquedStack<const WorkItem *> &Stack) {
+  return Stack.pop();
+}
+
+static const WorkItem *popItem(SetVector<const WorkItem *> &Stack) {
+  return Stack.pop_back_val();
+}
+
+template<typename StackType>
+static void benchmarkWorklist(Report &R, StringRef Name, size_t Size) {
+  constexpr auto Family = "worklist";
+  std::vector<WorkItem> Items(Size);
+  for (unsigned I = 0; I < Size; ++I)
+    Items[I].ID = I;
+
+  // Each item is pushed twice, on average
+  std::vector<const WorkItem *> Pushed;
+  for (unsigned I = 0; I < 2 * Size; ++I)
+    Pushed.push_back(&Items[scramble(I) % Size]);
+
+  auto Build = [&] {
+    StackType Result;
+    for (const WorkItem *Item : Pushed)
+      pushItem(Result, Item);
+    return Result;
+  };
+
+  R.addTime(Family, "insert", Name, Size, measure([&] {
+              doNotOptimize(Build().size());
+            }));
+
+  R.addTime(Family, "insert+pop", Name, Size, measure([&] {
+              StackType Stack = Build();
+              size_t Popped = 0;
+              while (not Stack.empty()) {
+                doNotOptimize(popItem(Stack));
+                ++Popped;
+              }
+              doNotOptimize(Popped);
+            }));
+
+  R.addFootprint(Family, Name, Size, footprint(Build));
+}
+
+//
+// MetaAddress textual representation
+//
+
+/// \brief The way MetaAddress::toString used to work, for comparison
+static std::string printThroughStream(const MetaAddress &Address) {
+  std::string Result;
+  raw_string_ostream Stream(Result);
+  Stream << "0x" << Twine::utohexstr(Address.address()) << ":"
+         << MetaAddressType::toString(Address.type());
+  if (not Address.isDefaultEpoch())
+    Stream << ":" << Address.epoch();
+  if (not Address.isDefaultAddressSpace())
+    Stream << ":" << Address.addressSpace();
+  Stream.flush();
+  return Result;
+}
+
+static void benchmarkMetaAddress(Report &R, size_t Size) {
+  constexpr auto Family = "metaaddress";
+  std::vector<MetaAddress> Addresses;
+  for (uint64_t Key : getKeys(Size))
+    Addresses.push_back(MetaAddress::fromPC(Triple::x86_64, Key));
+
+  R.addTime(Family, "print", "raw_string_ostream", Size, measure([&] {
+              size_t Length = 0;
+              for (const MetaAddress &Address : Addresses)
+                Length += printThroughStream(Address).size();
+              doNotOptimize(Length);
+            }));
+
+  R.addTime(Family, "print", "toString", Size, measure([&] {
+              size_t Length = 0;
+              for (const MetaAddress &Address : Addresses)
+                Length += Address.toString().size();
+              doNotOptimize(Length);
+            }));
+
+  R.addTime(Family, "print", "toChars", Size, measure([&] {
+              char Buffer[MetaAddress::MaxStringLength];
+              size_t Length = 0;
+              for (const MetaAddress &Address : Addresses)
+                Length += Address.toChars(Buffer, std::end(Buffer)) - Buffer;
+              doNotOptimize(Length);
+            }));
+
+  std::vector<std::string> Strings;
+  for (const MetaAddress &Address : Addresses)
+    Strings.push_back(Address.toString());
+
+  R.addTime(Family, "parse", "fromString", Size, measure([&] {
+              uint64_t Sum = 0;
+              for (const std::string &String : Strings)
+                Sum += MetaAddress::fromString(String).address();
+              doNotOptimize(Sum);
+            }));
+}
+
+//
+// Driver
+//
+
+static bool isEnabled(StringRef Family) {
+  return Filter.empty() or Family.contains(Filter);
+}
+
+static void runAll(Report &R, size_t Size) {
+  if (isEnabled("set")) {
+    benchmarkSet<SortedVector<uint64_t>>(R, "SortedVector", Size);
+    benchmarkSet<MutableSet<uint64_t>>(R, "MutableSet", Size);
+    benchmarkSet<std::set<uint64_t>>(R, "std::set", Size);
+    benchmarkSet<DenseSet<uint64_t>>(R, "llvm::DenseSet", Size);
+  }
+
+  if (isEnabled("map")) {
+    benchmarkMap<SmallMap<uint64_t, uint64_t, 16>>(R, "SmallMap<16>", Size);
+    benchmarkMap<std::map<uint64_t, uint64_t>>(R, "std::map", Size);
+    using SmallDenseMap16 = SmallDenseMap<uint64_t, uint64_t, 16>;
+    benchmarkMap<SmallDenseMap16>(R, "llvm::SmallDenseMap<16>", Size);
+    benchmarkMap<DenseMap<uint64_t, uint64_t>>(R, "llvm::DenseMap", Size);
+  }
+
+  if (isEnabled("bitvector")) {
+    benchmarkBitVector<LazySmallBitVector>(R, "LazySmallBitVector", Size);
+    benchmarkBitVector<BitVector>(R, "llvm::BitVector", Size);
+    benchmarkBitVector<SmallBitVector>(R, "llvm::SmallBitVector", Size);
+  }
+
+  if (isEnabled("ranges")) {
+    benchmarkRanges<ConstantRangeSet>(R, "ConstantRangeSet", Size);
+    benchmarkRanges<ConstantRange>(R, "llvm::ConstantRange", Size);
+  }
+
+  if (isEnabled("zip")) {
+    benchmarkZip<std::map<uint64_t, uint64_t>>(R, "std::map", Size);
+    benchmarkZip<SortedVector<KeyValue>>(R, "SortedVector", Size);
+    using NamedVector = SortedVector<NamedKeyValue>;
+    benchmarkZip<NamedVector>(R, "SortedVector<string key>", Size);
+  }
+
+  if (isEnabled("graph")) {
+    benchmarkGenericGraph(R, Size);
+    benchmarkAdjacencyList(R, Size);
+  }
+
+  if (isEnabled("worklist")) {
+    using Stack = UniquedStack<const WorkItem *>;
+    benchmarkWorklist<Stack>(R, "UniquedStack", Size);
+    benchmarkWorklist<SetVector<const WorkItem *>>(R, "llvm::SetVector", Size);
+    benchmarkWorklist<DenseStack>(R, "DenseUniquedStack", Size);
+  }
+
+  if (isEnabled("metaaddress"))
+    benchmarkMetaAddress(R, Size);
+}
+
+int main(int argc, const char *argv[]) {
+  HideUnrelatedOptions(BenchCategory);
+  ParseCommandLineOptions(argc, argv);
+
+  std::vector<unsigned> ToRun(Sizes.begin(), Sizes.end());
+  if (ToRun.empty())
+    ToRun = { 16, 1024, 65536 };
+
+  Report R;
+  for (unsigned Size : ToRun) {
+    if (Size == 0)
+      AbortOnError(createStringError(inconvertibleErrorCode(),
+                                     "sizes must be positive"));
+    runAll(R, Size);
+  }
+
+  std::error_code EC;
+  ToolOutputFile Output(OutputPath, EC, sys::fs::OF_Text);
+  AbortOnError(errorCodeToError(EC));
+  R.write(Output.os());
+  Output.keep();
+
+  return EXIT_SUCCESS;
+}
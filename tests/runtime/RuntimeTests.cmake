@@ -34,6 +34,85 @@ macro(artifact_handler CATEGORY INPUT_FILE CONFIGURATION OUTPUT TARGET_NAME)
 endmacro()
 register_derived_artifact("compiled;compiled-run" "translated" "" "FILE")
 
+# Translate once more emitting calls to the QEMU vector helpers: the translated
+# binaries are the reference for the vector IR the helpers are lowered into
+macro(artifact_handler CATEGORY INPUT_FILE CONFIGURATION OUTPUT TARGET_NAME)
+  set(INPUT_FILE "${INPUT_FILE}")
+  list(GET INPUT_FILE 0 COMPILED_INPUT)
+  list(GET INPUT_FILE 1 COMPILED_RUN_INPUT)
+
+  if("${CATEGORY}" STREQUAL "tests_runtime"
+     AND NOT "${CONFIGURATION}" STREQUAL "static_native"
+     AND NOT "${CONFIGURATION}" STREQUAL "aarch64")
+    set(COMMAND_TO_RUN "./bin/revng" translate --no-vector-helpers -i
+                       ${COMPILED_INPUT} -o "${OUTPUT}")
+    set(DEPEND_ON revng-all-binaries)
+
+    foreach(RUN IN LISTS ARTIFACT_RUNS_${ARTIFACT_CATEGORY}__${ARTIFACT})
+
+      set(OUTPUT_RUN "${OUTPUT}-${RUN}.stdout")
+      set(TEST_NAME
+          test-translated-no-vector-helpers-${CATEGORY}-${TARGET_NAME}-${RUN})
+      add_test(
+        NAME ${TEST_NAME}
+        COMMAND
+          sh -c
+          "${OUTPUT} ${ARTIFACT_RUNS_${ARTIFACT_CATEGORY}__${ARTIFACT}__${RUN}} > ${OUTPUT_RUN} \
+          && diff -u ${COMPILED_RUN_INPUT}/${RUN}.stdout ${OUTPUT_RUN}")
+      set_tests_properties(
+        ${TEST_NAME}
+        PROPERTIES LABELS "runtime;vector-helpers;${CATEGORY};${CONFIGURATION}")
+
+    endforeach()
+
+  endif()
+endmacro()
+register_derived_artifact("compiled;compiled-run"
+                          "translated-without-vector-helpers" "" "FILE")
+
+# Translate with profiling counters, then feed the profile of each run back to
+# the lifter: the hot jump targets must be tested before the dispatcher switch,
+# now in dispatcher.cold, and the output must not change
+macro(artifact_handler CATEGORY INPUT_FILE CONFIGURATION OUTPUT TARGET_NAME)
+  set(INPUT_FILE "${INPUT_FILE}")
+  list(GET INPUT_FILE 0 COMPILED_INPUT)
+  list(GET INPUT_FILE 1 COMPILED_RUN_INPUT)
+
+  if("${CATEGORY}" STREQUAL "tests_runtime"
+     AND NOT "${CONFIGURATION}" STREQUAL "static_native"
+     AND NOT "${CONFIGURATION}" STREQUAL "aarch64")
+    set(COMMAND_TO_RUN "./bin/revng" translate --profile-counters -i
+                       ${COMPILED_INPUT} -o "${OUTPUT}")
+    set(DEPEND_ON revng-all-binaries)
+
+    foreach(RUN IN LISTS ARTIFACT_RUNS_${ARTIFACT_CATEGORY}__${ARTIFACT})
+
+      set(PROFILE "${OUTPUT}-${RUN}.csv")
+      set(HOT "${OUTPUT}-${RUN}.hot")
+      set(OUTPUT_RUN "${HOT}.stdout")
+      set(TEST_NAME
+          test-translated-dispatcher-profile-${CATEGORY}-${TARGET_NAME}-${RUN})
+      add_test(
+        NAME ${TEST_NAME}
+        COMMAND
+          sh -c
+          "REVNG_PROFILE_PATH=${PROFILE} ${OUTPUT} ${ARTIFACT_RUNS_${ARTIFACT_CATEGORY}__${ARTIFACT}__${RUN}} > /dev/null \
+          && ./bin/revng lift --dispatcher-profile=${PROFILE} ${COMPILED_INPUT} ${HOT}.ll \
+          && grep -q '^dispatcher.cold:' ${HOT}.ll \
+          && ./bin/revng translate --dispatcher-profile=${PROFILE} -i ${COMPILED_INPUT} -o ${HOT} \
+          && ${HOT} ${ARTIFACT_RUNS_${ARTIFACT_CATEGORY}__${ARTIFACT}__${RUN}} > ${OUTPUT_RUN} \
+          && diff -u ${COMPILED_RUN_INPUT}/${RUN}.stdout ${OUTPUT_RUN}")
+      set_tests_properties(
+        ${TEST_NAME}
+        PROPERTIES LABELS "runtime;dispatcher;${CATEGORY};${CONFIGURATION}")
+
+    endforeach()
+
+  endif()
+endmacro()
+register_derived_artifact("compiled;compiled-run"
+                          "translated-with-profile-counters" "" "FILE")
+
 macro(artifact_handler CATEGORY INPUT_FILE CONFIGURATION OUTPUT TARGET_NAME)
   set(INPUT_FILE "${INPUT_FILE}")
   list(GET INPUT_FILE 0 COMPILED_INPUT)
@@ -43,6 +122,24 @@ macro(artifact_handler CATEGORY INPUT_FILE CONFIGURATION OUTPUT TARGET_NAME)
                                                 "static_native")
     set(COMMAND_TO_RUN "./bin/revng" lift ${COMPILED_INPUT} "${OUTPUT}")
     set(DEPEND_ON revng-all-binaries)
+
+    #
+    # Reusing the translation when a jump target splits a block must find the
+    # same jump targets as retranslating the code following it
+    #
+    set(RETRANSLATED "${OUTPUT}.retranslated.ll")
+    set(JUMP_TARGETS "grep -oE '^\"?bb\\.[^\" ]+' | sort")
+    set(TEST_NAME test-lifted-${CATEGORY}-${TARGET_NAME}-split-translations)
+    add_test(
+      NAME ${TEST_NAME}
+      COMMAND
+        sh -c "./bin/revng lift --always-retranslate ${COMPILED_INPUT} \
+        ${RETRANSLATED} \
+        && ${JUMP_TARGETS} < ${RETRANSLATED} > ${RETRANSLATED}.jts \
+        && ${JUMP_TARGETS} < ${OUTPUT} > ${OUTPUT}.jts \
+        && diff -u ${RETRANSLATED}.jts ${OUTPUT}.jts")
+    set_tests_properties(
+      ${TEST_NAME} PROPERTIES LABELS "runtime;lift;${CATEGORY};${CONFIGURATION}")
   endif()
 endmacro()
 register_derived_artifact("compiled;compiled-run" "lifted" ".ll" "FILE")
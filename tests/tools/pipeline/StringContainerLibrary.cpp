@@ -34,6 +34,7 @@ public:
   }
 
   void insert(const Target &Target) {
+    markModified();
     ContainedStrings.insert(toString(Target));
   }
 
@@ -41,22 +42,6 @@ public:
     return ContainedStrings.count(Target.getPathComponents().back().getName());
   }
 
-  bool remove(const TargetsList &Targets) override {
-    bool RemovedAll = true;
-    for (const auto &Target : Targets)
-      RemovedAll = remove(Target) && RemovedAll;
-
-    return RemovedAll;
-  }
-
-  bool remove(const Target &Target) {
-    if (contains(Target))
-      return false;
-
-    ContainedStrings.erase(toString(Target));
-    return true;
-  }
-
   TargetsList enumerate() const final {
     TargetsList ToReturn;
 
@@ -66,8 +51,6 @@ public:
     return ToReturn;
   }
 
-  void clear() final { ContainedStrings.clear(); }
-
   llvm::Error serialize(llvm::raw_ostream &OS) const final {
     for (const auto &S : ContainedStrings) {
       OS << S << "\n";
@@ -75,8 +58,21 @@ public:
     return llvm::Error::success();
   }
 
-  llvm::Error deserialize(const llvm::MemoryBuffer &Buffer) final {
-    clear();
+  const std::set<std::string> &getStrings() const { return ContainedStrings; }
+
+protected:
+  bool removeImpl(const TargetsList &Targets) override {
+    bool RemovedAll = true;
+    for (const auto &Target : Targets)
+      RemovedAll = removeTarget(Target) && RemovedAll;
+
+    return RemovedAll;
+  }
+
+  void clearImpl() final { ContainedStrings.clear(); }
+
+  llvm::Error deserializeImpl(const llvm::MemoryBuffer &Buffer) final {
+    clearImpl();
     SmallVector<llvm::StringRef, 0> Strings;
     Buffer.getBuffer().split(Strings, '\n');
     for (llvm::StringRef S : Strings) {
@@ -87,9 +83,15 @@ public:
     return llvm::Error::success();
   }
 
-  const std::set<std::string> &getStrings() const { return ContainedStrings; }
-
 private:
+  bool removeTarget(const Target &Target) {
+    if (contains(Target))
+      return false;
+
+    ContainedStrings.erase(toString(Target));
+    return true;
+  }
+
   static std::string toString(const Target &Target) {
     std::stringstream S;
     Target::dumpPathComponents(S, Target.getPathComponents());
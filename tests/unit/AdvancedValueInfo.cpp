@@ -466,3 +466,37 @@ end:
                                aI64(33),
                                aI64(34) } } });
 }
+
+BOOST_AUTO_TEST_CASE(TestDisjointRangesBudget) {
+  // Two disjoint intervals, as in TestDisjoint
+  const char *Body = R"LLVM(
+  br label %start
+
+start:
+  %to_store = load i64, i64* @rax
+  %gt10 = icmp ugt i64 %to_store, 10
+  %lt15 = icmp ult i64 %to_store, 15
+  %in10_15 = and i1 %gt10, %lt15
+  br i1 %in10_15, label %end, label %false
+
+false:
+  %gt30 = icmp ugt i64 %to_store, 30
+  %lt35 = icmp ult i64 %to_store, 35
+  %in30_35 = and i1 %gt30, %lt35
+  br i1 %in30_35, label %end, label %exit
+
+exit:
+  unreachable
+
+end:
+  store i64 %to_store, i64* @pc
+  unreachable
+
+)LLVM";
+
+  // Exhausting the budget of the disjoint ranges analysis must discard its
+  // partial results
+  DisjointRangesBudget = 1;
+  checkAdvancedValueInfo(Body, { { "to_store", {} } });
+  DisjointRangesBudget = 0;
+}
@@ -0,0 +1,84 @@
+/// \file AsyncLogWriter.cpp
+/// \brief Tests for AsyncLogWriter
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define BOOST_TEST_MODULE AsyncLogWriter
+bool init_unit_test();
+#include "boost/test/unit_test.hpp"
+
+#include "llvm/ADT/StringExtras.h"
+
+#include "revng/Support/Assert.h"
+#include "revng/Support/AsyncLogWriter.h"
+
+/// Each of the threads writes "<Thread> <Index>\n" lines
+static std::string writeConcurrently(size_t RingBufferSize,
+                                     unsigned ThreadsCount,
+                                     unsigned LinesCount) {
+  std::stringstream Output;
+  {
+    AsyncLogWriter Writer(Output, RingBufferSize);
+    std::vector<std::thread> Threads;
+    for (unsigned Thread = 0; Thread < ThreadsCount; ++Thread) {
+      Threads.emplace_back([&Writer, Thread, LinesCount] {
+        for (unsigned I = 0; I < LinesCount; ++I)
+          Writer.write(std::to_string(Thread) + " " + std::to_string(I) + "\n");
+      });
+    }
+
+    for (std::thread &Thread : Threads)
+      Thread.join();
+  }
+  return Output.str();
+}
+
+static void checkLines(const std::string &Output,
+                       unsigned ThreadsCount,
+                       unsigned LinesCount) {
+  std::map<unsigned, unsigned> NextIndex;
+  llvm::SmallVector<llvm::StringRef, 16> Lines;
+  llvm::StringRef(Output).split(Lines, '\n', -1, false);
+  revng_check(Lines.size() == ThreadsCount * LinesCount);
+
+  // Lines of each thread are written in order
+  for (llvm::StringRef Line : Lines) {
+    auto [ThreadString, IndexString] = Line.split(' ');
+    unsigned Thread = 0;
+    unsigned Index = 0;
+    revng_check(not ThreadString.getAsInteger(10, Thread));
+    revng_check(not IndexString.getAsInteger(10, Index));
+    revng_check(NextIndex[Thread]++ == Index);
+  }
+
+  for (unsigned Thread = 0; Thread < ThreadsCount; ++Thread)
+    revng_check(NextIndex[Thread] == LinesCount);
+}
+
+BOOST_AUTO_TEST_CASE(ConcurrentWriters) {
+  checkLines(writeConcurrently(64 * 1024, 8, 10000), 8, 10000);
+}
+
+BOOST_AUTO_TEST_CASE(SmallRingBuffer) {
+  // Lines wrap around the end of the buffer and producers have to wait
+  checkLines(writeConcurrently(32, 4, 2000), 4, 2000);
+}
+
+BOOST_AUTO_TEST_CASE(DrainAndTruncate) {
+  std::stringstream Output;
+  AsyncLogWriter Writer(Output, 16);
+  Writer.write("short\n");
+  Writer.write("this line does not fit\n");
+  Writer.drain();
+
+  // Four bytes of each slot are taken by the length of the line
+  revng_check(Output.str() == "short\nthis line do");
+}
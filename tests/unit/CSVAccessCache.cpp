@@ -0,0 +1,164 @@
+/// \file CSVAccessCache.cpp
+/// \brief Tests for CSVAccessCache
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <memory>
+#include <string>
+
+#define BOOST_TEST_MODULE CSVAccessCache
+bool init_unit_test();
+#include "boost/test/unit_test.hpp"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/SourceMgr.h"
+
+#include "revng/Support/FunctionTags.h"
+#include "revng/Support/IRHelpers.h"
+#include "revng/UnitTestHelpers/UnitTestHelpers.h"
+
+#include "lib/Lift/CSVAccessCache.h"
+
+using namespace llvm;
+
+static const char *RootModule = R"LLVM(
+@env = global i8* null
+@rax = global i64 0
+@rbx = global i64 0
+
+declare void @helper_a(i8*, i64)
+
+define void @root(i64 %x) {
+entry:
+  %env = load i8*, i8** @env
+  call void @helper_a(i8* %env, i64 4)
+  call void @helper_a(i8* %env, i64 %x)
+  ret void
+}
+)LLVM";
+
+static const char *LoadMDName = "revng.csvaccess.offsets.load";
+static const char *StoreMDName = "revng.csvaccess.offsets.store";
+
+/// \brief Sets -csv-access-cache-dir to a fresh directory for its lifetime
+class CacheDirectory {
+private:
+  SmallString<128> Path;
+
+public:
+  CacheDirectory() {
+    revng_check(not sys::fs::createUniqueDirectory("revng-test-csv-access",
+                                                   Path));
+    set(Path.str().str());
+  }
+
+  ~CacheDirectory() {
+    set("");
+    sys::fs::remove_directories(Path);
+  }
+
+private:
+  static void set(const std::string &Value) {
+    StringMap<cl::Option *> &Options = cl::getRegisteredOptions();
+    getOption<std::string>(Options, "csv-access-cache-dir")->setValue(Value);
+  }
+};
+
+static std::unique_ptr<Module> loadRoot(LLVMContext &Context) {
+  SMDiagnostic Errors;
+  auto Result = parseAssemblyString(RootModule, Errors, Context);
+  revng_check(Result);
+  FunctionTags::Helper.addTo(Result->getFunction("helper_a"));
+  return Result;
+}
+
+/// \return the calls in root, in order
+static SmallVector<CallInst *, 2> calls(Module &M) {
+  SmallVector<CallInst *, 2> Result;
+  for (Instruction &I : M.getFunction("root")->getEntryBlock())
+    if (auto *Call = dyn_cast<CallInst>(&I))
+      Result.push_back(Call);
+  return Result;
+}
+
+/// \brief Decorate \p Call as loading rax and storing rbx
+static void decorate(CallInst *Call) {
+  Module &M = *getModule(Call);
+  QuickMetadata QMD(M.getContext());
+  const auto Access = [&](const char *Name) {
+    return QMD.tuple({ QMD.get(static_cast<uint32_t>(0)),
+                       QMD.tuple({ QMD.get(M.getGlobalVariable(Name)) }) });
+  };
+  Call->setMetadata(LoadMDName, Access("rax"));
+  Call->setMetadata(StoreMDName, Access("rbx"));
+}
+
+/// \return the name of the only CSV in the \p Kind metadata of \p Call
+static std::string accessedCSV(CallInst *Call, const char *Kind) {
+  QuickMetadata QMD(Call->getContext());
+  auto *Access = cast<MDTuple>(Call->getMetadata(Kind));
+  revng_check(QMD.extract<uint32_t>(Access, 0) == 0);
+  auto *Variables = QMD.extract<MDTuple *>(Access, 1);
+  revng_check(Variables->getNumOperands() == 1);
+  return QMD.extract<Constant *>(Variables->getOperand(0).get())
+    ->getName()
+    .str();
+}
+
+/// \brief Record the accesses of a decorated module in the cache for \p Hash
+static void populate(uint64_t Hash) {
+  LLVMContext Context;
+  auto M = loadRoot(Context);
+  for (CallInst *Call : calls(*M))
+    decorate(Call);
+
+  CSVAccessCache Cache(Hash);
+  Cache.record(*M);
+  Cache.save();
+}
+
+BOOST_AUTO_TEST_CASE(TestCachedAccessesAreApplied) {
+  CacheDirectory Directory;
+  populate(42);
+
+  LLVMContext Context;
+  auto M = loadRoot(Context);
+  CSVAccessCache Cache(42);
+  revng_check(Cache.apply(*M) == 1);
+
+  auto Calls = calls(*M);
+  revng_check(accessedCSV(Calls[0], LoadMDName) == "rax");
+  revng_check(accessedCSV(Calls[0], StoreMDName) == "rbx");
+
+  // A call with a non-constant argument is never cached
+  revng_check(Calls[1]->getMetadata(LoadMDName) == nullptr);
+  revng_check(Calls[1]->getMetadata(StoreMDName) == nullptr);
+
+  // Decorated calls are left alone
+  revng_check(Cache.apply(*M) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(TestCacheDependsOnHelpersHash) {
+  CacheDirectory Directory;
+  populate(42);
+
+  LLVMContext Context;
+  auto M = loadRoot(Context);
+  revng_check(CSVAccessCache(43).apply(*M) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(TestCacheIsDisabledWithoutDirectory) {
+  populate(42);
+
+  LLVMContext Context;
+  auto M = loadRoot(Context);
+  revng_check(CSVAccessCache(42).apply(*M) == 0);
+}
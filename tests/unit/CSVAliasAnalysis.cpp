@@ -0,0 +1,163 @@
+/// \file CSVAliasAnalysis.cpp
+/// \brief Tests for CSVAliasAnalysisPass
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#define BOOST_TEST_MODULE CSVAliasAnalysis
+bool init_unit_test();
+#include "boost/test/unit_test.hpp"
+
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/PassManager.h"
+#include "llvm/Passes/PassBuilder.h"
+
+#include "revng/BasicAnalyses/CSVAliasAnalysis.h"
+#include "revng/BasicAnalyses/GeneratedCodeBasicInfo.h"
+#include "revng/Model/Binary.h"
+#include "revng/Model/LoadModelPass.h"
+#include "revng/UnitTestHelpers/LLVMTestHelpers.h"
+#include "revng/UnitTestHelpers/UnitTestHelpers.h"
+
+using namespace llvm;
+
+static const char *ModuleText = R"LLVM(
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-pc-linux-gnu"
+
+@rax = internal global i64 0
+@rdi = internal global i64 0
+@pc = internal global i64 0
+@pc_epoch = internal global i32 0
+@pc_address_space = internal global i16 0
+@pc_type = internal global i16 0
+
+define void @root() {
+  %stack = alloca i64
+  %rax.value = load i64, i64* @rax
+  store i64 %rax.value, i64* @rdi
+  store i64 %rax.value, i64* %stack
+  ret void
+}
+
+!revng.csv = !{!0}
+
+!0 = !{i64* @rax, i64* @rdi, i64* @pc}
+)LLVM";
+
+static void runCSVAA(Module &M) {
+  TupleTree<model::Binary> Binary;
+  Binary->Architecture = model::Architecture::x86_64;
+
+  ModuleAnalysisManager MAM;
+  MAM.registerPass([&] {
+    return LoadModelAnalysis::fromModelWrapper(ModelWrapper(Binary));
+  });
+  MAM.registerPass([&] { return GeneratedCodeBasicInfoAnalysis(); });
+
+  PassBuilder PB;
+  PB.registerModuleAnalyses(MAM);
+
+  ModulePassManager MPM;
+  MPM.addPass(CSVAliasAnalysisPass());
+  MPM.run(M, MAM);
+}
+
+static Instruction *getAccess(Module &M, StringRef Pointer) {
+  for (Instruction &I : instructions(M.getFunction("root"))) {
+    Value *Operand = nullptr;
+    if (auto *Load = dyn_cast<LoadInst>(&I))
+      Operand = Load->getPointerOperand();
+    else if (auto *Store = dyn_cast<StoreInst>(&I))
+      Operand = Store->getPointerOperand();
+
+    if (Operand != nullptr and Operand->getName() == Pointer)
+      return &I;
+  }
+
+  revng_abort();
+}
+
+static MDNode *aliasScope(Instruction *I) {
+  return I->getMetadata(LLVMContext::MD_alias_scope);
+}
+
+static MDNode *noAlias(Instruction *I) {
+  return I->getMetadata(LLVMContext::MD_noalias);
+}
+
+/// \return the number of CSVs with an alias scope
+static unsigned scopesCount(Module &M) {
+  return M.getNamedMetadata("revng.csv.alias.scopes")->getNumOperands();
+}
+
+/// \return the single scope of the alias set of the access to \p CSV
+static Metadata *scopeOf(Module &M, StringRef CSV) {
+  MDNode *AliasSet = aliasScope(getAccess(M, CSV));
+  revng_check(AliasSet != nullptr and AliasSet->getNumOperands() == 1);
+  return AliasSet->getOperand(0).get();
+}
+
+BOOST_AUTO_TEST_CASE(TestCSVAccessesAreDecorated) {
+  LLVMContext Context;
+  auto M = parseModule(Context, ModuleText);
+  runCSVAA(*M);
+
+  Metadata *RAXScope = scopeOf(*M, "rax");
+  Metadata *RDIScope = scopeOf(*M, "rdi");
+  revng_check(RAXScope != RDIScope);
+
+  // The CSVs affecting the program counter have a scope too
+  unsigned Scopes = scopesCount(*M);
+  revng_check(Scopes == 6);
+
+  // Each CSV access does not alias with all the other CSVs
+  MDNode *RAXNoAlias = noAlias(getAccess(*M, "rax"));
+  revng_check(RAXNoAlias->getNumOperands() == Scopes - 1);
+  revng_check(is_contained(RAXNoAlias->operands(), RDIScope));
+  revng_check(not is_contained(RAXNoAlias->operands(), RAXScope));
+
+  // Other accesses do not alias with any CSV
+  Instruction *Stack = getAccess(*M, "stack");
+  revng_check(aliasScope(Stack) == nullptr);
+  revng_check(noAlias(Stack)->getNumOperands() == Scopes);
+  revng_check(is_contained(noAlias(Stack)->operands(), RAXScope));
+}
+
+BOOST_AUTO_TEST_CASE(TestRerunReusesScopes) {
+  LLVMContext Context;
+  auto M = parseModule(Context, ModuleText);
+  runCSVAA(*M);
+
+  MDNode *AliasSet = aliasScope(getAccess(*M, "rax"));
+  MDNode *NoAliasSet = noAlias(getAccess(*M, "rax"));
+  unsigned Scopes = scopesCount(*M);
+
+  runCSVAA(*M);
+
+  revng_check(aliasScope(getAccess(*M, "rax")) == AliasSet);
+  revng_check(noAlias(getAccess(*M, "rax")) == NoAliasSet);
+  revng_check(scopesCount(*M) == Scopes);
+}
+
+BOOST_AUTO_TEST_CASE(TestDeletedCSVs) {
+  LLVMContext Context;
+  auto M = parseModule(Context, ModuleText);
+  runCSVAA(*M);
+  unsigned Scopes = scopesCount(*M);
+
+  // Deleting a CSV nulls out the references to it in the metadata
+  getAccess(*M, "rdi")->eraseFromParent();
+  M->getGlobalVariable("rdi", true)->eraseFromParent();
+
+  runCSVAA(*M);
+
+  // The scope of the deleted CSV is no longer used
+  MDNode *RAXNoAlias = noAlias(getAccess(*M, "rax"));
+  revng_check(RAXNoAlias->getNumOperands() == Scopes - 2);
+  revng_check(noAlias(getAccess(*M, "stack"))->getNumOperands() == Scopes - 1);
+}
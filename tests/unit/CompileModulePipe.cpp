@@ -0,0 +1,164 @@
+/// \file CompileModulePipe.cpp
+/// \brief Tests for the helpers of the compile pipes
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#define BOOST_TEST_MODULE CompileModulePipe
+bool init_unit_test();
+#include "boost/test/unit_test.hpp"
+
+#include "llvm/ADT/Triple.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Object/ObjectFile.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Target/TargetOptions.h"
+
+#include "revng/Pipes/CompileModulePipe.h"
+#include "revng/Support/IRHelpers.h"
+#include "revng/Support/TemporaryFile.h"
+#include "revng/UnitTestHelpers/UnitTestHelpers.h"
+
+using namespace llvm;
+
+using revng::pipes::computeObjectCacheKey;
+using revng::pipes::linkRelocatableObject;
+
+static std::unique_ptr<TargetMachine>
+createTargetMachine(const TargetOptions &Options = TargetOptions(),
+                    CodeGenOpt::Level Level = CodeGenOpt::Default) {
+  InitializeAllTargetInfos();
+  InitializeAllTargets();
+  InitializeAllTargetMCs();
+  InitializeAllAsmPrinters();
+
+  std::string Error;
+  Triple TheTriple("x86_64-pc-linux-gnu");
+  const auto *TheTarget = TargetRegistry::lookupTarget("", TheTriple, Error);
+  revng_check(TheTarget != nullptr);
+
+  auto *Result = TheTarget->createTargetMachine(TheTriple.getTriple(),
+                                                "",
+                                                "",
+                                                Options,
+                                                Reloc::Static,
+                                                None,
+                                                Level);
+  return std::unique_ptr<TargetMachine>(Result);
+}
+
+BOOST_AUTO_TEST_CASE(TestKeyIsStable) {
+  auto First = createTargetMachine();
+  auto Second = createTargetMachine();
+  revng_check(computeObjectCacheKey("bitcode", *First)
+              == computeObjectCacheKey("bitcode", *Second));
+}
+
+BOOST_AUTO_TEST_CASE(TestKeyDependsOnBitcode) {
+  auto Target = createTargetMachine();
+  revng_check(computeObjectCacheKey("bitcode", *Target)
+              != computeObjectCacheKey("other", *Target));
+}
+
+BOOST_AUTO_TEST_CASE(TestKeyDependsOnOptimizationLevel) {
+  auto Default = createTargetMachine();
+  auto Unoptimized = createTargetMachine(TargetOptions(), CodeGenOpt::None);
+  revng_check(computeObjectCacheKey("bitcode", *Default)
+              != computeObjectCacheKey("bitcode", *Unoptimized));
+}
+
+BOOST_AUTO_TEST_CASE(TestKeyDependsOnTargetOptions) {
+  auto Default = createTargetMachine();
+  std::string DefaultKey = computeObjectCacheKey("bitcode", *Default);
+
+  TargetOptions Sections;
+  Sections.FunctionSections = true;
+  revng_check(computeObjectCacheKey("bitcode", *createTargetMachine(Sections))
+              != DefaultKey);
+
+  TargetOptions FloatABI;
+  FloatABI.FloatABIType = FloatABI::Soft;
+  revng_check(computeObjectCacheKey("bitcode", *createTargetMachine(FloatABI))
+              != DefaultKey);
+}
+
+BOOST_AUTO_TEST_CASE(TestKeyDependsOnBackendOptions) {
+  auto Target = createTargetMachine();
+
+  StringMap<cl::Option *> &Options = cl::getRegisteredOptions();
+  auto *DisableLICM = getOption<bool>(Options, "disable-machine-licm");
+  bool Original = DisableLICM->getValue();
+
+  std::string Before = computeObjectCacheKey("bitcode", *Target);
+  DisableLICM->setValue(not Original);
+  std::string After = computeObjectCacheKey("bitcode", *Target);
+  DisableLICM->setValue(Original);
+
+  revng_check(Before != After);
+  revng_check(computeObjectCacheKey("bitcode", *Target) == Before);
+}
+
+/// \brief Emit an object defining a function named \p Name in \p File
+static void emitFunctionObject(StringRef Name, const TemporaryFile &File) {
+  LLVMContext Context;
+  Module M("test", Context);
+  auto *VoidType = Type::getVoidTy(Context);
+  auto *FunctionType = FunctionType::get(VoidType, false);
+  auto *F = Function::Create(FunctionType, Function::ExternalLinkage, Name, M);
+  ReturnInst::Create(Context, BasicBlock::Create(Context, "", F));
+
+  auto Target = createTargetMachine();
+  M.setDataLayout(Target->createDataLayout());
+
+  std::error_code EC;
+  raw_fd_ostream OutputStream(File.path(), EC);
+  revng_check(not EC);
+
+  legacy::PassManager PM;
+  bool Failed = Target->addPassesToEmitFile(PM,
+                                            OutputStream,
+                                            nullptr,
+                                            CGFT_ObjectFile);
+  revng_check(not Failed);
+  PM.run(M);
+}
+
+BOOST_AUTO_TEST_CASE(TestLinkRelocatableObject) {
+  TemporaryFile First("revng-test-first", "o");
+  TemporaryFile Second("revng-test-second", "o");
+  emitFunctionObject("first", First);
+  emitFunctionObject("second", Second);
+
+  TemporaryFile Output("revng-test-output", "o");
+  linkRelocatableObject({ First.path().str(), Second.path().str() },
+                        Output.path());
+
+  auto MaybeBuffer = MemoryBuffer::getFile(Output.path());
+  revng_check(MaybeBuffer);
+  auto MaybeObject = object::ObjectFile::createObjectFile(**MaybeBuffer);
+  revng_check(MaybeObject);
+  object::ObjectFile &Object = **MaybeObject;
+
+  // The result is still relocatable and defines the symbols of both objects
+  revng_check(Object.isRelocatableObject());
+  std::set<std::string> Defined;
+  for (const object::SymbolRef &Symbol : Object.symbols()) {
+    auto MaybeSection = Symbol.getSection();
+    revng_check(MaybeSection);
+    if (*MaybeSection != Object.section_end())
+      Defined.insert(cantFail(Symbol.getName()).str());
+  }
+  revng_check(Defined.count("first") == 1);
+  revng_check(Defined.count("second") == 1);
+}
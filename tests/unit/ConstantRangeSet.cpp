@@ -62,3 +62,70 @@ BOOST_AUTO_TEST_CASE(TestEnumerate) {
     dbg << "\n";
   }
 }
+
+BOOST_AUTO_TEST_CASE(TestNarrowAndWideAgree) {
+  using CRS = ConstantRangeSet;
+  using Ranges = std::vector<std::pair<uint64_t, uint64_t>>;
+
+  // Sets up to 64 bits wide take a different code path: build the same random
+  // sets at 32 and 128 bits and check that the results match
+  uint64_t Seed = 42;
+  auto Random = [&Seed](uint64_t Max) {
+    Seed = Seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (Seed >> 33) % Max;
+  };
+
+  auto RandomRanges = [&Random]() {
+    Ranges Result;
+    unsigned Count = Random(4);
+    for (unsigned I = 0; I < Count; ++I) {
+      uint64_t Start = Random(200);
+      Result.push_back({ Start, Start + 1 + Random(50) });
+    }
+    return Result;
+  };
+
+  auto Build = [](unsigned BitWidth, const Ranges &Ranges) {
+    CRS Result(BitWidth, false);
+    for (auto [Start, End] : Ranges) {
+      llvm::ConstantRange Range({ BitWidth, Start }, { BitWidth, End });
+      Result = Result.unionWith(CRS(Range));
+    }
+    return Result;
+  };
+
+  auto Elements = [](const CRS &Set) {
+    std::vector<uint64_t> Result;
+    for (const llvm::APInt &Value : Set)
+      Result.push_back(Value.getLimitedValue());
+    return Result;
+  };
+
+  for (unsigned I = 0; I < 1000; ++I) {
+    Ranges Left = RandomRanges();
+    Ranges Right = RandomRanges();
+    CRS NarrowLeft = Build(32, Left);
+    CRS NarrowRight = Build(32, Right);
+    CRS WideLeft = Build(128, Left);
+    CRS WideRight = Build(128, Right);
+
+    revng_check(Elements(NarrowLeft) == Elements(WideLeft));
+
+    CRS NarrowUnion = NarrowLeft.unionWith(NarrowRight);
+    CRS WideUnion = WideLeft.unionWith(WideRight);
+    revng_check(Elements(NarrowUnion) == Elements(WideUnion));
+    revng_check(NarrowUnion.size().getZExtValue()
+                == WideUnion.size().getZExtValue());
+
+    CRS NarrowIntersection = NarrowLeft.intersectWith(NarrowRight);
+    CRS WideIntersection = WideLeft.intersectWith(WideRight);
+    revng_check(Elements(NarrowIntersection) == Elements(WideIntersection));
+    revng_check(NarrowIntersection.size().getZExtValue()
+                == WideIntersection.size().getZExtValue());
+
+    revng_check(NarrowUnion.contains(NarrowLeft));
+    revng_check(WideUnion.contains(WideLeft));
+    revng_check(NarrowLeft.contains(NarrowIntersection));
+    revng_check(WideLeft.contains(WideIntersection));
+  }
+}
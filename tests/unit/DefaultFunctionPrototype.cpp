@@ -0,0 +1,54 @@
+/// \file DefaultFunctionPrototype.cpp
+/// \brief Tests for abi::registerDefaultFunctionPrototype
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#define BOOST_TEST_MODULE DefaultFunctionPrototype
+bool init_unit_test();
+#include "boost/test/unit_test.hpp"
+
+#include "revng/ABI/DefaultFunctionPrototype.h"
+#include "revng/Model/Binary.h"
+#include "revng/UnitTestHelpers/UnitTestHelpers.h"
+
+using namespace model;
+
+BOOST_AUTO_TEST_CASE(TestDefaultPrototypeIsReused) {
+  TupleTree<model::Binary> Model;
+  Model->DefaultABI = ABI::SystemV_x86_64;
+
+  Model->DefaultPrototype = abi::registerDefaultFunctionPrototype(*Model);
+  size_t TypesCount = Model->Types.size();
+
+  // Checking whether the existing prototype can be reused records nothing
+  TypePath Reused = abi::registerDefaultFunctionPrototype(*Model);
+  revng_check(Reused == Model->DefaultPrototype);
+  revng_check(Model->Types.size() == TypesCount);
+}
+
+BOOST_AUTO_TEST_CASE(TestDefaultPrototypeOfAnotherABI) {
+  TupleTree<model::Binary> Model;
+  Model->DefaultABI = ABI::SystemV_x86_64;
+  Model->DefaultPrototype = abi::registerDefaultFunctionPrototype(*Model);
+
+  TypePath Other = abi::registerDefaultFunctionPrototype(*Model,
+                                                         ABI::SystemV_x86);
+  revng_check(Other != Model->DefaultPrototype);
+  revng_check(llvm::isa<RawFunctionType>(Other.get()));
+}
+
+BOOST_AUTO_TEST_CASE(TestChangedDefaultPrototypeIsNotReused) {
+  TupleTree<model::Binary> Model;
+  Model->DefaultABI = ABI::SystemV_x86_64;
+  Model->DefaultPrototype = abi::registerDefaultFunctionPrototype(*Model);
+
+  auto *Prototype = llvm::cast<RawFunctionType>(Model->DefaultPrototype.get());
+  Prototype->OriginalName = "custom";
+
+  size_t TypesCount = Model->Types.size();
+  TypePath New = abi::registerDefaultFunctionPrototype(*Model);
+  revng_check(New != Model->DefaultPrototype);
+  revng_check(Model->Types.size() == TypesCount + 1);
+}
@@ -0,0 +1,92 @@
+/// \file FlatIntervalSet.cpp
+/// \brief Tests for FlatIntervalSet
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <random>
+
+#define BOOST_TEST_MODULE FlatIntervalSet
+bool init_unit_test();
+#include "boost/test/unit_test.hpp"
+
+#include "revng/ADT/FlatIntervalSet.h"
+#include "revng/UnitTestHelpers/UnitTestHelpers.h"
+
+using Intervals = std::vector<std::pair<uint64_t, uint64_t>>;
+
+static bool linearContains(const Intervals &Ranges, uint64_t Value) {
+  for (const auto &[Start, End] : Ranges)
+    if (Start <= Value and Value < End)
+      return true;
+  return false;
+}
+
+BOOST_AUTO_TEST_CASE(Empty) {
+  FlatIntervalSet<uint64_t> Set;
+  BOOST_TEST(Set.empty());
+  BOOST_TEST(not Set.contains(0));
+  BOOST_TEST(not Set.hull().has_value());
+
+  FlatIntervalSet<uint64_t> OnlyEmptyIntervals(Intervals{ { 10, 10 } });
+  BOOST_TEST(OnlyEmptyIntervals.empty());
+}
+
+BOOST_AUTO_TEST_CASE(Boundaries) {
+  FlatIntervalSet<uint64_t> Set(Intervals{ { 30, 40 }, { 10, 20 } });
+  BOOST_TEST(Set.size() == 2U);
+  BOOST_TEST(not Set.contains(9));
+  BOOST_TEST(Set.contains(10));
+  BOOST_TEST(Set.contains(19));
+  BOOST_TEST(not Set.contains(20));
+  BOOST_TEST(not Set.contains(29));
+  BOOST_TEST(Set.contains(30));
+  BOOST_TEST(not Set.contains(40));
+
+  auto Found = Set.find(35);
+  BOOST_TEST(Found.has_value());
+  BOOST_TEST(Found->first == 30U);
+  BOOST_TEST(Found->second == 40U);
+}
+
+BOOST_AUTO_TEST_CASE(OverlappingIntervalsAreMerged) {
+  Intervals Overlapping{ { 0, 100 }, { 10, 20 }, { 90, 120 } };
+  FlatIntervalSet<uint64_t> Set(Overlapping);
+  BOOST_TEST(Set.size() == 1U);
+  BOOST_TEST(Set.contains(50));
+  BOOST_TEST(Set.contains(119));
+  BOOST_TEST(not Set.contains(120));
+
+  // Adjacent intervals are kept distinct
+  FlatIntervalSet<uint64_t> Adjacent(Intervals{ { 0, 10 }, { 10, 20 } });
+  BOOST_TEST(Adjacent.size() == 2U);
+  BOOST_TEST(Adjacent.find(10)->first == 10U);
+}
+
+BOOST_AUTO_TEST_CASE(MatchesLinearScan) {
+  std::mt19937_64 Generator(42);
+
+  for (unsigned Size : { 1, 2, 3, 7, 8, 9, 100, 1000 }) {
+    // Non overlapping intervals with gaps in between
+    Intervals Ranges;
+    uint64_t Cursor = 0;
+    for (unsigned I = 0; I < Size; ++I) {
+      Cursor += Generator() % 16;
+      uint64_t Length = 1 + Generator() % 16;
+      Ranges.emplace_back(Cursor, Cursor + Length);
+      Cursor += Length;
+    }
+
+    Intervals Shuffled = Ranges;
+    std::shuffle(Shuffled.begin(), Shuffled.end(), Generator);
+    FlatIntervalSet<uint64_t> Set(Shuffled);
+    BOOST_TEST(Set.size() == Ranges.size());
+    BOOST_TEST((Set.intervals() == Ranges));
+    BOOST_TEST(Set.hull()->first == Ranges.front().first);
+    BOOST_TEST(Set.hull()->second == Ranges.back().second);
+
+    for (uint64_t Value = 0; Value <= Cursor + 1; ++Value)
+      BOOST_TEST(Set.contains(Value) == linearContains(Ranges, Value));
+  }
+}
@@ -0,0 +1,73 @@
+/// \file FunctionMetadata.cpp
+/// \brief Tests for efa::FunctionMetadataVerifier
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#define BOOST_TEST_MODULE FunctionMetadata
+bool init_unit_test();
+#include "boost/test/unit_test.hpp"
+
+#include "revng/EarlyFunctionAnalysis/FunctionMetadata.h"
+#include "revng/Model/Binary.h"
+#include "revng/UnitTestHelpers/UnitTestHelpers.h"
+
+using namespace llvm;
+
+static const MetaAddress Entry = MetaAddress::fromPC(Triple::x86_64, 0x1000);
+
+static TupleTree<model::Binary> createBinary() {
+  TupleTree<model::Binary> Binary;
+  Binary->Architecture = model::Architecture::x86_64;
+  Binary->Functions[Entry].Type = model::FunctionType::Regular;
+  return Binary;
+}
+
+/// \return a function made of a single block returning to the caller
+static efa::FunctionMetadata createMetadata() {
+  efa::FunctionMetadata Result(Entry);
+  efa::BasicBlock &Block = Result.ControlFlowGraph[Entry];
+  Block.End = Entry + 4;
+
+  using EdgePointer = UpcastablePointer<efa::FunctionEdgeBase>;
+  auto Return = efa::FunctionEdgeType::Return;
+  auto Edge = EdgePointer::make<efa::FunctionEdge>(MetaAddress::invalid(),
+                                                   Return);
+  Block.Successors.insert(std::move(Edge));
+  return Result;
+}
+
+BOOST_AUTO_TEST_CASE(TestVerification) {
+  TupleTree<model::Binary> Binary = createBinary();
+  efa::FunctionMetadataVerifier Verifier(*Binary);
+
+  efa::FunctionMetadata FM = createMetadata();
+  revng_check(Verifier.verify(&FM));
+
+  // The CFG has to contain a block starting at the entry point
+  FM.ControlFlowGraph.clear();
+  FM.ControlFlowGraph[Entry + 4].End = Entry + 8;
+  revng_check(not Verifier.verify(&FM));
+}
+
+BOOST_AUTO_TEST_CASE(TestUnchangedMetadataIsNotVerifiedAgain) {
+  TupleTree<model::Binary> Binary = createBinary();
+  efa::FunctionMetadataVerifier Verifier(*Binary);
+
+  efa::FunctionMetadata FM = createMetadata();
+  revng_check(Verifier.verify(&FM));
+
+  // Fake functions cannot have a CFG, but FM has already been verified
+  Binary->Functions.at(Entry).Type = model::FunctionType::Fake;
+  revng_check(Verifier.verify(&FM));
+
+  // Changing FM triggers a new verification
+  efa::FunctionMetadata Changed = createMetadata();
+  Changed.ControlFlowGraph.at(Entry).End = Entry + 8;
+  revng_check(not Verifier.verify(&Changed));
+
+  // After invalidation, the changes to the model are taken into account
+  Verifier.invalidate();
+  revng_check(not Verifier.verify(&FM));
+}
@@ -0,0 +1,62 @@
+/// \file FunctionTags.cpp
+/// \brief Tests for FunctionTags
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#define BOOST_TEST_MODULE FunctionTags
+bool init_unit_test();
+#include "boost/test/unit_test.hpp"
+
+#include "llvm/IR/Function.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+
+#include "revng/Support/Assert.h"
+#include "revng/Support/FunctionTags.h"
+
+using namespace llvm;
+using namespace FunctionTags;
+
+BOOST_AUTO_TEST_CASE(KeepsTheMostSpecificTag) {
+  TagsSet Set;
+  Set.insert(Isolated);
+  Set.insert(CSVsPromoted);
+  Set.insert(ABIEnforced);
+  Set.insert(Helper);
+
+  revng_check(Set.contains(Isolated));
+  revng_check(Set.contains(ABIEnforced));
+  revng_check(Set.contains(CSVsPromoted));
+  revng_check(Set.contains(Helper));
+  revng_check(not Set.contains(QEMU));
+
+  revng_check(Set.containsExactly(CSVsPromoted));
+  revng_check(not Set.containsExactly(Isolated));
+  revng_check(not Set.containsExactly(ABIEnforced));
+}
+
+BOOST_AUTO_TEST_CASE(RoundTripsThroughMetadata) {
+  LLVMContext Context;
+  Module M("test", Context);
+  auto *Type = FunctionType::get(Type::getVoidTy(Context), false);
+  auto *F = Function::Create(Type, GlobalValue::ExternalLinkage, "f", &M);
+
+  revng_check(not Isolated.isTagOf(F));
+
+  ABIEnforced.addTo(F);
+  Marker.addTo(F);
+  Isolated.addTo(F);
+
+  revng_check(Isolated.isTagOf(F));
+  revng_check(ABIEnforced.isExactTagOf(F));
+  revng_check(not Isolated.isExactTagOf(F));
+  revng_check(Marker.isExactTagOf(F));
+  revng_check(not CSVsPromoted.isTagOf(F));
+  revng_check(isRootOrLifted(F));
+
+  revng_check(Tag::fromName("Marker") == &Marker);
+  revng_check(Tag::fromName("NotATag") == nullptr);
+  revng_check(&Tag::fromID(Marker.id()) == &Marker);
+}
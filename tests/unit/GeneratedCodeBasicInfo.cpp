@@ -0,0 +1,105 @@
+/// \file GeneratedCodeBasicInfo.cpp
+/// \brief Test the GeneratedCodeBasicInfo analysis
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#define BOOST_TEST_MODULE GeneratedCodeBasicInfo
+bool init_unit_test();
+#include "boost/test/unit_test.hpp"
+
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+
+#include "revng/BasicAnalyses/GeneratedCodeBasicInfo.h"
+#include "revng/Model/Binary.h"
+#include "revng/Support/Assert.h"
+#include "revng/UnitTestHelpers/LLVMTestHelpers.h"
+
+using namespace llvm;
+
+static const char *CSVsModule = R"LLVM(
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-pc-linux-gnu"
+
+@rax = internal global i64 0
+@rdi = internal global i64 0
+@pc = internal global i64 0
+
+!revng.csv = !{!0}
+!revng.csv.offsets = !{!1}
+
+!0 = !{i64* @rax, i64* @rdi, i64* @pc}
+!1 = !{!2, !3, !4}
+!2 = !{i64* @rax, i64 0}
+!3 = !{i64* @rdi, i64 8}
+!4 = !{i64* @pc, i64 16}
+)LLVM";
+
+BOOST_AUTO_TEST_CASE(TestCSVOffsets) {
+  LLVMContext Context;
+  auto M = parseModule(Context, CSVsModule);
+
+  TupleTree<model::Binary> Binary;
+  Binary->Architecture = model::Architecture::x86_64;
+  GeneratedCodeBasicInfo GCBI(*Binary);
+  GCBI.run(*M);
+
+  auto *RDI = M->getGlobalVariable("rdi", true);
+  revng_check(GCBI.csvOffset(RDI) == 8);
+  revng_check(GCBI.csvAtOffset(8) == RDI);
+  revng_check(GCBI.csvAtOffset(4) == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(TestDeletedCSVsHaveNoOffset) {
+  LLVMContext Context;
+  auto M = parseModule(Context, CSVsModule);
+
+  // Deleting a CSV nulls out the references to it in the metadata
+  M->getGlobalVariable("rdi", true)->eraseFromParent();
+
+  TupleTree<model::Binary> Binary;
+  Binary->Architecture = model::Architecture::x86_64;
+  GeneratedCodeBasicInfo GCBI(*Binary);
+  GCBI.run(*M);
+
+  auto *PC = M->getGlobalVariable("pc", true);
+  revng_check(GCBI.csvOffset(PC) == 16);
+  revng_check(GCBI.csvAtOffset(16) == PC);
+  revng_check(GCBI.csvAtOffset(8) == nullptr);
+}
+
+static const char *RootModule = R"LLVM(
+declare void @newpc(i64)
+
+define void @root() {
+entry:
+  br label %next
+
+next:
+  ret void
+}
+)LLVM";
+
+BOOST_AUTO_TEST_CASE(TestTrackedValuesDetectDeletions) {
+  LLVMContext Context;
+  auto M = parseModule(Context, RootModule);
+
+  auto Tracked = GeneratedCodeBasicInfo::trackedValues(*M);
+  revng_check(Tracked.size() == 4);
+
+  auto IsDeleted = [](const WeakVH &Handle) { return Handle == nullptr; };
+  revng_check(llvm::none_of(Tracked, IsDeleted));
+
+  // Deleting a block of root nulls out its handle, even if a new block reuses
+  // its memory
+  Function *Root = M->getFunction("root");
+  BasicBlock *Next = &*std::next(Root->begin());
+  auto *Other = BasicBlock::Create(Context, "other", Root);
+  ReturnInst::Create(Context, Other);
+  Next->replaceAllUsesWith(Other);
+  Next->eraseFromParent();
+  revng_check(llvm::count_if(Tracked, IsDeleted) == 1);
+}
@@ -18,6 +18,7 @@ bool init_unit_test();
 #include "llvm/Support/raw_ostream.h"
 
 #include "revng/ADT/FilteredGraphTraits.h"
+#include "revng/ADT/FrozenGraph.h"
 #include "revng/ADT/GenericGraph.h"
 #include "revng/ADT/SerializableGraph.h"
 #include "revng/TupleTree/Introspection.h"
@@ -246,6 +247,87 @@ BOOST_AUTO_TEST_CASE(TestSCC) {
   revng_check(SCCCount == 4);
 }
 
+template<typename GraphType>
+static std::vector<unsigned> rpotRanks(GraphType *Graph) {
+  std::vector<unsigned> Result;
+  for (auto *Node : ReversePostOrderTraversal<GraphType *>(Graph))
+    Result.push_back(Node->Rank);
+  return Result;
+}
+
+template<typename NodeType, bool UseRefs = false>
+static void checkFrozenDiamond() {
+  auto DG = createGraph<NodeType, UseRefs>();
+  auto Frozen = freeze(DG.Graph);
+  using FrozenNode = typename decltype(Frozen)::Node;
+
+  revng_check(Frozen.size() == 4);
+  revng_check(Frozen.getEntryNode()->Rank == DG.Root->Rank);
+  revng_check(rpotRanks(&Frozen) == rpotRanks(&DG.Graph));
+
+  // Nodes keep their order, and so do edges
+  unsigned Index = 0;
+  for (FrozenNode *Node : Frozen.nodes())
+    revng_check(Frozen.getIndex(Node) == Index++);
+
+  FrozenNode *Root = Frozen.getEntryNode();
+  revng_check(Root->successorCount() == 2 and not Root->hasPredecessors());
+  auto Edges = Root->successor_edges();
+  revng_check(Edges[0].Neighbor->Rank == 1 and Edges[0].Weight == 7);
+  revng_check(Edges[1].Neighbor->Rank == 3 and Edges[1].Weight == 1);
+
+  FrozenNode *Final = Frozen.getNodeAt(3);
+  revng_check(not Final->hasSuccessors());
+  auto Predecessors = Final->predecessor_edges();
+  revng_check(Predecessors.size() == 2);
+  revng_check(Predecessors[0].Neighbor->Rank == 1);
+  revng_check(Predecessors[0].Weight == 2);
+  revng_check(Predecessors[1].Neighbor->Rank == 3);
+  revng_check(Predecessors[1].Weight == 3);
+
+  std::vector<FrozenNode *> Visited;
+  for (FrozenNode *Node : inverse_depth_first(Final))
+    Visited.push_back(Node);
+  revng_check(Visited.size() == 4);
+
+  unsigned SCCCount = 0;
+  for (auto &SCC : make_range(scc_begin(&Frozen), scc_end(&Frozen))) {
+    revng_check(SCC.size() == 1);
+    ++SCCCount;
+  }
+  revng_check(SCCCount == 4);
+
+  // Moving the graph preserves the nodes
+  auto Moved = std::move(Frozen);
+  revng_check(Moved.getEntryNode() == Root);
+  revng_check(*Root->successors().begin() == Moved.getNodeAt(1));
+}
+
+BOOST_AUTO_TEST_CASE(TestFrozenGraph) {
+  checkFrozenDiamond<ForwardNode<TestNodeData, TestEdgeLabel>>();
+  checkFrozenDiamond<BidirectionalTestNode>();
+  checkFrozenDiamond<MutableEdgeNode<TestNodeData, TestEdgeLabel>, true>();
+}
+
+BOOST_AUTO_TEST_CASE(TestFrozenGraphCycle) {
+  GenericGraph<BidirectionalTestNode> Graph;
+  auto *A = Graph.addNode(0);
+  auto *B = Graph.addNode(1);
+  auto *C = Graph.addNode(2);
+  Graph.setEntryNode(A);
+  A->addSuccessor(B, { 0 });
+  B->addSuccessor(C, { 0 });
+  C->addSuccessor(B, { 0 });
+  C->addSuccessor(C, { 0 });
+
+  const auto Frozen = freeze(Graph);
+  std::vector<size_t> SCCSizes;
+  for (auto &SCC : make_range(scc_begin(&Frozen), scc_end(&Frozen)))
+    SCCSizes.push_back(SCC.size());
+  revng_check((SCCSizes == std::vector<size_t>{ 2, 1 }));
+  revng_check(Frozen.getNodeAt(2)->predecessorCount() == 2);
+}
+
 BOOST_AUTO_TEST_CASE(TestFilterGraphTraits) {
   auto DG = createGraph<BidirectionalTestNode>();
 
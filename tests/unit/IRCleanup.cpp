@@ -0,0 +1,104 @@
+/// \file IRCleanup.cpp
+/// \brief Tests for IRCleanup
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#define BOOST_TEST_MODULE IRCleanup
+bool init_unit_test();
+#include "boost/test/unit_test.hpp"
+
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+
+#include "revng/BasicAnalyses/IRCleanup.h"
+#include "revng/Support/FunctionTags.h"
+#include "revng/Support/IRHelpers.h"
+#include "revng/UnitTestHelpers/LLVMTestHelpers.h"
+#include "revng/UnitTestHelpers/UnitTestHelpers.h"
+
+using namespace llvm;
+
+static const char *ModuleIR = R"LLVM(
+@pc = global i64 0
+
+define void @newpc(i64 %address) {
+  store i64 %address, i64* @pc
+  ret void
+}
+
+define i32 @isolated(i32 %a, i32 %b) !dbg !3 {
+  call void @newpc(i64 4096), !dbg !4
+  %a.wide = zext i32 %a to i64
+  %b.wide = zext i32 %b to i64
+  %sum = add i64 %a.wide, %b.wide
+  %sum.narrow = trunc i64 %sum to i32
+  ret i32 %sum.narrow, !dbg !4
+}
+
+define void @not_isolated() !dbg !5 {
+  call void @newpc(i64 8192), !dbg !6
+  ret void, !dbg !6
+}
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!2}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C, file: !1,
+                             emissionKind: FullDebug)
+!1 = !DIFile(filename: "test.c", directory: "/")
+!2 = !{i32 2, !"Debug Info Version", i32 3}
+!3 = distinct !DISubprogram(name: "isolated", scope: !1, file: !1,
+                            unit: !0, spFlags: DISPFlagDefinition)
+!4 = !DILocation(line: 1, scope: !3)
+!5 = distinct !DISubprogram(name: "not_isolated", scope: !1, file: !1,
+                            unit: !0, spFlags: DISPFlagDefinition)
+!6 = !DILocation(line: 2, scope: !5)
+)LLVM";
+
+static std::unique_ptr<Module> load(LLVMContext &Context) {
+  auto M = parseModule(Context, ModuleIR);
+  FunctionTags::Isolated.addTo(M->getFunction("isolated"));
+  return M;
+}
+
+static bool hasDebugInfo(const Function &F) {
+  if (F.getSubprogram() != nullptr)
+    return true;
+
+  for (const BasicBlock &BB : F)
+    for (const Instruction &I : BB)
+      if (I.getDebugLoc())
+        return true;
+
+  return false;
+}
+
+BOOST_AUTO_TEST_CASE(TestCleanup) {
+  LLVMContext Context;
+  auto M = load(Context);
+  revng_check(runLegacyPasses(*M, new IRCleanup()));
+
+  // Calls to newpc are dropped everywhere, and newpc is emptied
+  revng_check(M->getFunction("newpc")->getNumUses() == 0);
+  auto &NewPCEntry = M->getFunction("newpc")->getEntryBlock();
+  revng_check(NewPCEntry.size() == 1);
+  revng_check(isa<ReturnInst>(NewPCEntry.front()));
+
+  // Only isolated functions lose their debug information
+  Function *Isolated = M->getFunction("isolated");
+  revng_check(not hasDebugInfo(*Isolated));
+  revng_check(hasDebugInfo(*M->getFunction("not_isolated")));
+
+  // The sum is performed on the truncated operands
+  revng_check(instructionByName(Isolated, "sum")->getType()->isIntegerTy(32));
+}
+
+BOOST_AUTO_TEST_CASE(TestCleanupIsIdempotent) {
+  LLVMContext Context;
+  auto M = load(Context);
+  revng_check(runLegacyPasses(*M, new IRCleanup()));
+  revng_check(not runLegacyPasses(*M, new IRCleanup()));
+}
@@ -95,3 +95,51 @@ BOOST_AUTO_TEST_CASE(TestForwardBFSVisitor) {
   };
   revng_check(V.VisitLog == GroundTruth);
 }
+
+const char *NewPCTestModule = R"LLVM(
+%MetaAddress = type { i32, i16, i16, i64 }
+
+declare void @newpc(%MetaAddress, i64, i32)
+
+define void @main() {
+initial_block:
+  call void @newpc(%MetaAddress { i32 0, i16 0, i16 4, i64 4096 }, i64 4, i32 1)
+  %a = add i64 0, 0
+  %b = add i64 1, 0, !revng.newpc !0
+  %c = add i64 2, 0
+  br label %next
+
+next:
+  %d = add i64 3, 0
+  ret void
+}
+
+!0 = !{%MetaAddress { i32 0, i16 0, i16 4, i64 4100 }, i64 2}
+)LLVM";
+
+BOOST_AUTO_TEST_CASE(TestGetPCWithDroppedNewPCCalls) {
+  LLVMContext TestContext;
+  SMDiagnostic Diagnostic;
+  auto Buffer = MemoryBuffer::getMemBuffer(NewPCTestModule);
+  auto M = parseIR(Buffer->getMemBufferRef(), Diagnostic, TestContext);
+  revng_check(M);
+  Function *F = M->getFunction("main");
+
+  auto First = MetaAddress::fromPC(Triple::x86_64, 0x1000);
+  auto Second = MetaAddress::fromPC(Triple::x86_64, 0x1004);
+  using PC = std::pair<MetaAddress, uint64_t>;
+
+  // Instructions following a call to newpc belong to it
+  revng_check(getPC(instructionByName(F, "a")) == PC(First, 4));
+
+  // The instruction marked by metadata, and the following ones, belong to
+  // the instruction whose call to newpc has been dropped
+  revng_check(getPC(instructionByName(F, "b")) == PC(Second, 2));
+  revng_check(getPC(instructionByName(F, "c")) == PC(Second, 2));
+  revng_check(getPC(instructionByName(F, "d")) == PC(Second, 2));
+
+  // getLastNewPC ignores the metadata
+  CallInst *NewPC = getLastNewPC(instructionByName(F, "d"));
+  revng_check(NewPC != nullptr);
+  revng_check(NewPC->getNextNode() == instructionByName(F, "a"));
+}
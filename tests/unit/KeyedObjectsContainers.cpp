@@ -201,3 +201,147 @@ BOOST_AUTO_TEST_CASE(TestUniqueLast) {
   Vector Expected = { { 1, 3 }, { 2, 3 } };
   revng_check(TheVector == Expected);
 }
+
+BOOST_AUTO_TEST_CASE(TestSortedVectorAssignUnsorted) {
+  std::vector<Element> Elements = { { 3, 1 }, { 1, 1 }, { 3, 2 }, { 2, 1 } };
+
+  // Keep the first element of each key
+  {
+    SortedVector<Element> TheVector;
+    revng_check(TheVector.assign_unsorted(std::vector(Elements)) == 1);
+    revng_check(TheVector.isSorted());
+    revng_check(TheVector.size() == 3);
+    revng_check(TheVector.at(3).value() == 1);
+  }
+
+  // Merge elements with the same key
+  {
+    SortedVector<Element> TheVector;
+    auto Sum = [](Element &Kept, Element &Duplicate) {
+      Kept.setValue(Kept.value() + Duplicate.value());
+    };
+    revng_check(TheVector.assign_unsorted(std::vector(Elements), Sum) == 1);
+    revng_check(TheVector.at(3).value() == 3);
+  }
+
+  // Enough elements to be sorted in parallel, the insertion order of elements
+  // sharing the same key must be preserved
+  {
+    constexpr uint64_t Keys = 10000;
+    constexpr uint64_t Copies = 4;
+    std::vector<Element> Many;
+    for (uint64_t Copy = 0; Copy < Copies; ++Copy)
+      for (uint64_t Key = 0; Key < Keys; ++Key)
+        Many.push_back({ (Key * 7919) % Keys, Copy });
+
+    SortedVector<Element> TheVector;
+    size_t Duplicates = TheVector.assign_unsorted(std::move(Many));
+    revng_check(Duplicates == Keys * (Copies - 1));
+    revng_check(TheVector.isSorted());
+    revng_check(TheVector.size() == Keys);
+    for (const Element &E : TheVector)
+      revng_check(E.value() == 0);
+
+    // Batch insertions keep the last instance in the same way
+    {
+      auto Inserter = TheVector.batch_insert_or_assign();
+      for (uint64_t Copy = 1; Copy < Copies; ++Copy)
+        for (uint64_t Key = 0; Key < Keys; ++Key)
+          Inserter.insert_or_assign({ Key, Copy });
+    }
+    revng_check(TheVector.size() == Keys);
+    for (const Element &E : TheVector)
+      revng_check(E.value() == Copies - 1);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(TestSortedVectorIndex) {
+  constexpr uint64_t Keys = 1000;
+  SortedVector<Element> TheVector;
+  {
+    auto Inserter = TheVector.batch_insert();
+    for (uint64_t Key = 0; Key < Keys; ++Key)
+      Inserter.insert({ 2 * Key, Key });
+  }
+
+  // Look up each key multiple times, so that the index gets built
+  const auto &Constant = TheVector;
+  for (unsigned Round = 0; Round < 3; ++Round) {
+    for (uint64_t Key = 0; Key < Keys; ++Key) {
+      revng_check(Constant.find(2 * Key)->value() == Key);
+      revng_check(Constant.find(2 * Key + 1) == Constant.end());
+    }
+  }
+
+  // Mutations invalidate the index
+  TheVector.erase(TheVector.find(10));
+  TheVector.insert({ 11, 11 });
+  for (unsigned Round = 0; Round < 3; ++Round) {
+    for (uint64_t Key = 0; Key < Keys; ++Key) {
+      if (Key == 5)
+        revng_check(TheVector.count(2 * Key) == 0);
+      else
+        revng_check(TheVector.find(2 * Key)->value() == Key);
+    }
+    revng_check(TheVector.at(11).value() == 11);
+  }
+
+  // Copies have their own index
+  SortedVector<Element> Copy = TheVector;
+  Copy.clear();
+  revng_check(Copy.count(0) == 0);
+  revng_check(TheVector.count(0) == 1);
+
+  // Moved-from vectors drop their index, the moved-to ones build their own
+  for (unsigned Round = 0; Round < 3; ++Round)
+    for (uint64_t Key = 0; Key < Keys; ++Key)
+      revng_check(Constant.count(2 * Key) == (Key == 5 ? 0 : 1));
+
+  SortedVector<Element> Moved = std::move(TheVector);
+  revng_check(TheVector.count(0) == 0);
+  revng_check(Moved.count(0) == 1);
+
+  Copy = std::move(Moved);
+  revng_check(Moved.count(0) == 0);
+  revng_check(Copy.count(0) == 1);
+}
+
+BOOST_AUTO_TEST_CASE(TestSortedVectorMutations) {
+  SortedVector<Element> TheVector;
+  uint64_t Last = TheVector.mutations();
+  auto Changed = [&]() {
+    uint64_t Current = TheVector.mutations();
+    bool Result = Current != Last;
+    Last = Current;
+    return Result;
+  };
+
+  TheVector.insert({ 1, 1 });
+  revng_check(Changed());
+
+  // Lookups and failed insertions do not count
+  revng_check(TheVector.count(1) == 1);
+  TheVector.insert({ 1, 2 });
+  revng_check(not Changed());
+
+  // Replacing an element keeps the size and, usually, the storage
+  TheVector.erase(1);
+  TheVector.insert({ 2, 2 });
+  revng_check(Changed());
+
+  {
+    auto Inserter = TheVector.batch_insert();
+    Inserter.insert({ 3, 3 });
+  }
+  revng_check(Changed());
+
+  SortedVector<Element> Other = { { 1, 1 } };
+  TheVector = Other;
+  revng_check(Changed());
+
+  TheVector.swap(Other);
+  revng_check(Changed());
+
+  Other = std::move(TheVector);
+  revng_check(Changed());
+}
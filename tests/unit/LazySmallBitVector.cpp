@@ -159,6 +159,85 @@ BOOST_AUTO_TEST_CASE(TestBitwiseOperators) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(TestAndNotAndCount) {
+  for (unsigned Start = 0; Start <= FirstLargeBit; Start += FirstLargeBit) {
+    LazySmallBitVector A;
+    LazySmallBitVector B;
+
+    A.set(Start + 0);
+    A.set(Start + 1);
+    A.set(Start + 2);
+    BOOST_TEST(A.count() == 3U);
+
+    B.set(Start + 1);
+    A.andNot(B);
+    BOOST_TEST(A.count() == 2U);
+    BOOST_TEST(A[Start + 0] == true);
+    BOOST_TEST(A[Start + 1] == false);
+    BOOST_TEST(A[Start + 2] == true);
+
+    A.andNot(A);
+    BOOST_TEST(A.isZero());
+    BOOST_TEST(A.count() == 0U);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(TestManyWords) {
+  // Compare the operations on bit vectors spanning many words against a plain
+  // vector of bools
+  const unsigned Size = 64 * FirstLargeBit;
+  std::vector<bool> ExpectedA(Size);
+  std::vector<bool> ExpectedB(Size);
+  LazySmallBitVector A;
+  LazySmallBitVector B;
+  for (unsigned I = 0; I < Size; I++) {
+    if (I % 3 == 0) {
+      ExpectedA[I] = true;
+      A.set(I);
+    }
+
+    if (I % 5 == 0 or I % 7 == 0) {
+      ExpectedB[I] = true;
+      B.set(I);
+    }
+  }
+
+  auto Check = [&](const LazySmallBitVector &Actual,
+                   const std::vector<bool> &Expected) {
+    std::vector<unsigned> ExpectedIndices;
+    for (unsigned I = 0; I < Size; I++)
+      if (Expected[I])
+        ExpectedIndices.push_back(I);
+
+    std::vector<unsigned> Indices(Actual.begin(), Actual.end());
+    BOOST_REQUIRE_EQUAL(Indices, ExpectedIndices);
+    BOOST_TEST(Actual.count() == ExpectedIndices.size());
+  };
+
+  auto Apply = [&](auto Operation) {
+    std::vector<bool> Expected(Size);
+    for (unsigned I = 0; I < Size; I++)
+      Expected[I] = Operation(ExpectedA[I], ExpectedB[I]);
+    return Expected;
+  };
+
+  LazySmallBitVector Result = A;
+  Result &= B;
+  Check(Result, Apply([](bool X, bool Y) { return X and Y; }));
+
+  Result = A;
+  Result |= B;
+  Check(Result, Apply([](bool X, bool Y) { return X or Y; }));
+
+  Result = A;
+  Result ^= B;
+  Check(Result, Apply([](bool X, bool Y) { return X != Y; }));
+
+  Result = A;
+  Result.andNot(B);
+  Check(Result, Apply([](bool X, bool Y) { return X and not Y; }));
+}
+
 BOOST_AUTO_TEST_CASE(TestCopy) {
   for (unsigned Start = 0; Start <= FirstLargeBit; Start += FirstLargeBit) {
     LazySmallBitVector A;
@@ -0,0 +1,107 @@
+/// \file LinkForTranslation.cpp
+/// \brief Tests for the in-process creation of the segment objects
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <cstdint>
+#include <vector>
+
+#define BOOST_TEST_MODULE LinkForTranslation
+bool init_unit_test();
+#include "boost/test/unit_test.hpp"
+
+#include "llvm/BinaryFormat/ELF.h"
+#include "llvm/Object/ELFObjectFile.h"
+#include "llvm/Object/ObjectFile.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+#include "revng/Recompile/LinkForTranslation.h"
+#include "revng/Support/TemporaryFile.h"
+#include "revng/UnitTestHelpers/UnitTestHelpers.h"
+
+using namespace llvm;
+using namespace llvm::object;
+
+using Backend = TemporaryFile::Backend;
+
+static const std::vector<uint8_t> Data = { 1, 2, 3, 4, 5, 6, 7, 8 };
+
+/// \brief Write, then parse back, an object with a single section
+class SectionObject {
+private:
+  TemporaryFile File;
+  std::unique_ptr<MemoryBuffer> Buffer;
+  std::unique_ptr<ObjectFile> Object;
+
+public:
+  SectionObject(uint64_t Size, bool IsWriteable) :
+    File("revng-test-section", "o", Backend::Disk) {
+    writeSectionObject(File.path(), ".segment", Data, Size, IsWriteable);
+
+    auto MaybeBuffer = MemoryBuffer::getFile(File.path());
+    revng_check(MaybeBuffer);
+    Buffer = std::move(*MaybeBuffer);
+
+    auto MaybeObject = ObjectFile::createObjectFile(*Buffer);
+    revng_check(MaybeObject);
+    Object = std::move(*MaybeObject);
+  }
+
+public:
+  ELFSectionRef section() const {
+    for (const SectionRef &Section : Object->sections()) {
+      auto MaybeName = Section.getName();
+      revng_check(MaybeName);
+      if (*MaybeName == ".segment")
+        return Section;
+    }
+
+    revng_abort();
+  }
+
+  std::vector<uint8_t> contents() const {
+    auto MaybeContents = section().getContents();
+    revng_check(MaybeContents);
+    return { MaybeContents->bytes_begin(), MaybeContents->bytes_end() };
+  }
+
+  const ObjectFile &object() const { return *Object; }
+};
+
+BOOST_AUTO_TEST_CASE(TestObjectIsRelocatable) {
+  SectionObject Object(Data.size(), false);
+
+  revng_check(isa<ELF64LEObjectFile>(&Object.object()));
+  revng_check(Object.object().getArch() == Triple::x86_64);
+  revng_check(Object.object().isRelocatableObject());
+  revng_check(Object.contents() == Data);
+}
+
+BOOST_AUTO_TEST_CASE(TestDataIsPadded) {
+  SectionObject Object(Data.size() + 4, false);
+
+  std::vector<uint8_t> Expected = Data;
+  Expected.resize(Data.size() + 4, 0);
+  revng_check(Object.contents() == Expected);
+}
+
+BOOST_AUTO_TEST_CASE(TestDataIsTruncated) {
+  SectionObject Object(4, false);
+
+  std::vector<uint8_t> Expected(Data.begin(), Data.begin() + 4);
+  revng_check(Object.contents() == Expected);
+}
+
+BOOST_AUTO_TEST_CASE(TestSectionFlags) {
+  using namespace llvm::ELF;
+
+  uint64_t ReadOnlyFlags = SectionObject(4, false).section().getFlags();
+  revng_check((ReadOnlyFlags & SHF_ALLOC) != 0);
+  revng_check((ReadOnlyFlags & SHF_WRITE) == 0);
+
+  uint64_t WriteableFlags = SectionObject(4, true).section().getFlags();
+  revng_check((WriteableFlags & SHF_ALLOC) != 0);
+  revng_check((WriteableFlags & SHF_WRITE) != 0);
+}
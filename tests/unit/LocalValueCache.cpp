@@ -0,0 +1,130 @@
+/// \file LocalValueCache.cpp
+/// \brief Tests for LocalValueCache
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#define BOOST_TEST_MODULE LocalValueCache
+bool init_unit_test();
+#include "boost/test/unit_test.hpp"
+
+#include "llvm/IR/Function.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+
+#include "revng/Support/LocalValueCache.h"
+#include "revng/UnitTestHelpers/UnitTestHelpers.h"
+
+using namespace llvm;
+
+/// \brief A function with two empty blocks and two variables
+struct TestFunction {
+  LLVMContext Context;
+  Module M;
+  Function *F;
+  BasicBlock *Entry;
+  BasicBlock *Next;
+  GlobalVariable *A;
+  GlobalVariable *B;
+  IRBuilder<> Builder;
+
+  TestFunction() : M("test", Context), Builder(Context) {
+    auto *Int64 = Type::getInt64Ty(Context);
+    auto *VoidType = Type::getVoidTy(Context);
+    auto *FunctionType = FunctionType::get(VoidType, false);
+    F = Function::Create(FunctionType, GlobalValue::ExternalLinkage, "f", M);
+    Entry = BasicBlock::Create(Context, "entry", F);
+    Next = BasicBlock::Create(Context, "next", F);
+    A = cast<GlobalVariable>(M.getOrInsertGlobal("a", Int64));
+    B = cast<GlobalVariable>(M.getOrInsertGlobal("b", Int64));
+    Builder.SetInsertPoint(Entry);
+  }
+
+  Constant *constant(uint64_t Value) {
+    return ConstantInt::get(Type::getInt64Ty(Context), Value);
+  }
+
+  template<typename T>
+  unsigned count(BasicBlock *BB) {
+    unsigned Result = 0;
+    for (Instruction &I : *BB)
+      if (isa<T>(&I))
+        ++Result;
+    return Result;
+  }
+};
+
+BOOST_AUTO_TEST_CASE(TestLoadIsReused) {
+  TestFunction T;
+  LocalValueCache Cache;
+
+  Value *First = Cache.load(T.Builder, T.A);
+  revng_check(Cache.load(T.Builder, T.A) == First);
+  revng_check(Cache.load(T.Builder, T.B) != First);
+  revng_check(T.count<LoadInst>(T.Entry) == 2);
+}
+
+BOOST_AUTO_TEST_CASE(TestStoreIsForwarded) {
+  TestFunction T;
+  LocalValueCache Cache;
+
+  Cache.store(T.Builder, T.constant(42), T.A);
+  revng_check(Cache.load(T.Builder, T.A) == T.constant(42));
+  revng_check(T.count<LoadInst>(T.Entry) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(TestDeadStoreIsDropped) {
+  TestFunction T;
+  LocalValueCache Cache;
+
+  Cache.store(T.Builder, T.constant(1), T.A);
+  Cache.store(T.Builder, T.constant(2), T.B);
+  StoreInst *Last = Cache.store(T.Builder, T.constant(3), T.A);
+
+  revng_check(T.count<StoreInst>(T.Entry) == 2);
+  revng_check(Last->getParent() == T.Entry);
+  revng_check(Last->getValueOperand() == T.constant(3));
+}
+
+BOOST_AUTO_TEST_CASE(TestReadStoreIsPreserved) {
+  TestFunction T;
+  LocalValueCache Cache;
+
+  Cache.store(T.Builder, T.constant(1), T.A);
+  Cache.load(T.Builder, T.A);
+  Cache.store(T.Builder, T.constant(2), T.A);
+
+  // Even if the load has been forwarded, the first store is preserved
+  revng_check(T.count<StoreInst>(T.Entry) == 2);
+}
+
+BOOST_AUTO_TEST_CASE(TestChangingBlockDropsTheCache) {
+  TestFunction T;
+  LocalValueCache Cache;
+
+  Cache.store(T.Builder, T.constant(1), T.A);
+
+  T.Builder.SetInsertPoint(T.Next);
+  Value *Loaded = Cache.load(T.Builder, T.A);
+  revng_check(isa<LoadInst>(Loaded));
+  revng_check(cast<LoadInst>(Loaded)->getParent() == T.Next);
+
+  // The store in the previous block is not dropped
+  Cache.store(T.Builder, T.constant(2), T.A);
+  revng_check(T.count<StoreInst>(T.Entry) == 1);
+}
+
+BOOST_AUTO_TEST_CASE(TestClear) {
+  TestFunction T;
+  LocalValueCache Cache;
+
+  Cache.store(T.Builder, T.constant(1), T.A);
+  Cache.clear();
+
+  revng_check(isa<LoadInst>(Cache.load(T.Builder, T.A)));
+  Cache.clear();
+
+  Cache.store(T.Builder, T.constant(2), T.A);
+  revng_check(T.count<StoreInst>(T.Entry) == 2);
+}
@@ -0,0 +1,178 @@
+/// \file MFP.cpp
+/// \brief Tests for the MFP solver
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <algorithm>
+#include <set>
+#include <string>
+
+#define BOOST_TEST_MODULE MFP
+bool init_unit_test();
+#include "boost/test/unit_test.hpp"
+
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Module.h"
+
+#include "revng/MFP/MFP.h"
+#include "revng/UnitTestHelpers/LLVMTestHelpers.h"
+#include "revng/UnitTestHelpers/UnitTestHelpers.h"
+
+using namespace llvm;
+
+/// Collects the names of the basic blocks on any path reaching a basic block
+template<bool IsForward>
+struct ReachingBlocks {
+  using LatticeElement = std::set<std::string>;
+  using Label = const BasicBlock *;
+  using GraphType = std::conditional_t<IsForward,
+                                       const BasicBlock *,
+                                       Inverse<const BasicBlock *>>;
+  using GT = GraphTraits<GraphType>;
+  using LGT = GraphType;
+
+  LatticeElement
+  combineValues(const LatticeElement &LHS, const LatticeElement &RHS) const {
+    LatticeElement Result = LHS;
+    Result.insert(RHS.begin(), RHS.end());
+    return Result;
+  }
+
+  bool
+  isLessOrEqual(const LatticeElement &LHS, const LatticeElement &RHS) const {
+    return std::includes(RHS.begin(), RHS.end(), LHS.begin(), LHS.end());
+  }
+
+  LatticeElement applyTransferFunction(Label L, const LatticeElement &E) const {
+    LatticeElement Result = E;
+    Result.insert(L->getName().str());
+    return Result;
+  }
+};
+
+static const char *LoopBody = R"LLVM(
+  br label %header
+
+header:
+  br i1 true, label %body, label %exit
+
+body:
+  br i1 true, label %header, label %latch
+
+latch:
+  br label %header
+
+exit:
+  ret void
+)LLVM";
+
+using StringSet = std::set<std::string>;
+
+BOOST_AUTO_TEST_CASE(TestForward) {
+  using MFI = ReachingBlocks<true>;
+  LLVMContext TestContext;
+  std::unique_ptr<Module> M = loadModule(TestContext, LoopBody);
+  Function *F = M->getFunction("main");
+  const BasicBlock *Entry = &F->getEntryBlock();
+  const BasicBlock *Exit = basicBlockByName(F, "exit");
+
+  MFI Instance;
+  auto Results = MFP::getIndexedMaximalFixedPoint<MFI, MFI::GT, MFI::LGT>(
+    Instance, Entry, {}, {}, { Entry }, { Entry });
+
+  // Labels are numbered in reverse post order
+  revng_check(Results.Labels.size() == 5);
+  revng_check(Results.Labels.front() == Entry);
+
+  for (size_t I = 0; I < Results.Labels.size(); ++I) {
+    if (Results.Labels[I] == Exit) {
+      const auto &Result = Results.Results[I];
+      StringSet Expected = { "initial_block", "header", "body", "latch" };
+      revng_check(Result.InValue == Expected);
+      Expected.insert("exit");
+      revng_check(Result.OutValue == Expected);
+    }
+  }
+
+  // The map-based API returns the same results
+  auto Map = MFP::getMaximalFixedPoint<MFI, MFI::GT, MFI::LGT>(Instance,
+                                                               Entry,
+                                                               {},
+                                                               {},
+                                                               { Entry },
+                                                               { Entry });
+  revng_check(Map.size() == Results.Labels.size());
+  for (size_t I = 0; I < Results.Labels.size(); ++I) {
+    const auto &Result = Map.at(Results.Labels[I]);
+    revng_check(Result.InValue == Results.Results[I].InValue);
+    revng_check(Result.OutValue == Results.Results[I].OutValue);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(TestBackward) {
+  using MFI = ReachingBlocks<false>;
+  LLVMContext TestContext;
+  std::unique_ptr<Module> M = loadModule(TestContext, LoopBody);
+  Function *F = M->getFunction("main");
+  const BasicBlock *Latch = basicBlockByName(F, "latch");
+
+  MFI Instance;
+  auto Results = MFP::getMaximalFixedPoint<MFI, MFI::GT, MFI::LGT>(Instance,
+                                                                   Latch,
+                                                                   {},
+                                                                   {},
+                                                                   { Latch },
+                                                                   { Latch });
+
+  // The exit is not reachable going backward from the latch
+  revng_check(Results.size() == 4);
+  StringSet Expected = { "latch", "body", "header" };
+  revng_check(Results.at(Latch).InValue == Expected);
+  Expected.insert("initial_block");
+  revng_check(Results.at(&F->getEntryBlock()).OutValue == Expected);
+}
+
+BOOST_AUTO_TEST_CASE(TestSharedNumbering) {
+  using MFI = ReachingBlocks<true>;
+  LLVMContext TestContext;
+  std::unique_ptr<Module> M = loadModule(TestContext, LoopBody);
+  Function *F = M->getFunction("main");
+  const BasicBlock *Entry = &F->getEntryBlock();
+  const BasicBlock *Header = basicBlockByName(F, "header");
+
+  MFP::LabelNumberingCache<MFI::GT, MFI::LGT> Cache;
+  const auto &Numbering = Cache.get(Entry);
+  revng_check(&Cache.get(Entry) == &Numbering);
+  revng_check(Numbering.size() == 5);
+  revng_check(Numbering.VisitedCount == 5);
+  revng_check(Numbering.indexOf(Entry) == 0);
+
+  // Both body and latch jump back to the header
+  revng_check(Numbering.LoopHeaders.count() == 1);
+  revng_check(Numbering.LoopHeaders.test(Numbering.indexOf(Header)));
+
+  // Running on the cached numbering gives the same results
+  MFI Instance;
+  auto Expected = MFP::getMaximalFixedPoint<MFI, MFI::GT, MFI::LGT>(Instance,
+                                                                    Entry,
+                                                                    {},
+                                                                    {},
+                                                                    { Entry },
+                                                                    { Entry });
+  auto Results = MFP::getMaximalFixedPoint<MFI>(Instance,
+                                                Numbering,
+                                                {},
+                                                {},
+                                                { Entry });
+  revng_check(Results.size() == Expected.size());
+  for (const auto &[Label, Result] : Expected) {
+    revng_check(Results.at(Label).InValue == Result.InValue);
+    revng_check(Results.at(Label).OutValue == Result.OutValue);
+  }
+
+  Cache.invalidate();
+  revng_check(Cache.get(Entry).size() == 5);
+}
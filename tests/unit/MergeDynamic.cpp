@@ -0,0 +1,252 @@
+/// \file MergeDynamic.cpp
+/// \brief Tests for mergeDynamic
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <string>
+#include <vector>
+
+#define BOOST_TEST_MODULE MergeDynamic
+bool init_unit_test();
+#include "boost/test/unit_test.hpp"
+
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/BinaryFormat/ELF.h"
+#include "llvm/Object/ELF.h"
+#include "llvm/ObjectYAML/yaml2obj.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/YAMLTraits.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "revng/Recompile/MergeDynamic.h"
+#include "revng/Support/TemporaryFile.h"
+#include "revng/UnitTestHelpers/UnitTestHelpers.h"
+
+using namespace llvm;
+using namespace llvm::object;
+
+/// A minimal dynamic ELF with a single three characters symbol, \p Symbol,
+/// referenced by a relocation, whose .dynamic ends with \p HashTags
+static std::string createELF(StringRef Symbol, StringRef HashTags) {
+  std::string YAML = R"YAML(
+--- !ELF
+FileHeader:
+  Class:   ELFCLASS64
+  Data:    ELFDATA2LSB
+  Type:    ET_EXEC
+  Machine: EM_X86_64
+Sections:
+  - Name:         .dynstr
+    Type:         SHT_STRTAB
+    Flags:        [ SHF_ALLOC ]
+    Address:      0x400200
+    Offset:       0x200
+  - Name:         .dynsym
+    Type:         SHT_DYNSYM
+    Flags:        [ SHF_ALLOC ]
+    Address:      0x400300
+    Offset:       0x300
+    Link:         .dynstr
+    EntSize:      24
+  - Name:         .rela.dyn
+    Type:         SHT_RELA
+    Flags:        [ SHF_ALLOC ]
+    Address:      0x400400
+    Offset:       0x400
+    Link:         .dynsym
+    EntSize:      24
+    Relocations:
+      - Offset:   0x401000
+        Symbol:   SYMBOL
+        Type:     R_X86_64_GLOB_DAT
+  - Name:         .hash
+    Type:         SHT_PROGBITS
+    Flags:        [ SHF_ALLOC ]
+    Address:      0x400500
+    Offset:       0x500
+    Content:      '0100000002000000010000000000000000000000'
+  - Name:         .gnu.hash
+    Type:         SHT_PROGBITS
+    Flags:        [ SHF_ALLOC ]
+    Address:      0x400600
+    Offset:       0x600
+    Content:      '01000000010000000100000000000000'
+  - Name:         .dynamic
+    Type:         SHT_DYNAMIC
+    Flags:        [ SHF_ALLOC, SHF_WRITE ]
+    Address:      0x400700
+    Offset:       0x700
+    Link:         .dynstr
+    EntSize:      16
+    Entries:
+      - Tag:      DT_STRTAB
+        Value:    0x400200
+      - Tag:      DT_STRSZ
+        Value:    5
+      - Tag:      DT_SYMTAB
+        Value:    0x400300
+      - Tag:      DT_SYMENT
+        Value:    24
+      - Tag:      DT_RELA
+        Value:    0x400400
+      - Tag:      DT_RELASZ
+        Value:    24
+      - Tag:      DT_RELAENT
+        Value:    24
+HASH_TAGS
+      - Tag:      DT_NULL
+        Value:    0
+DynamicSymbols:
+  - Name:         SYMBOL
+    Type:         STT_FUNC
+    Section:      .dynstr
+    Binding:      STB_GLOBAL
+    Value:        0x401000
+ProgramHeaders:
+  - Type:         PT_LOAD
+    Flags:        [ PF_R, PF_W ]
+    VAddr:        0x400200
+    FirstSec:     .dynstr
+    LastSec:      .dynamic
+  - Type:         PT_DYNAMIC
+    Flags:        [ PF_R, PF_W ]
+    VAddr:        0x400700
+    FirstSec:     .dynamic
+    LastSec:      .dynamic
+)YAML";
+
+  auto Replace = [&YAML](StringRef From, StringRef To) {
+    size_t Position;
+    while ((Position = YAML.find(From.str())) != std::string::npos)
+      YAML.replace(Position, From.size(), To.str());
+  };
+  Replace("SYMBOL", Symbol);
+  Replace("HASH_TAGS\n", HashTags);
+
+  std::string Result;
+  raw_string_ostream Stream(Result);
+  yaml::Input Input(YAML);
+  auto ErrorHandler = [](const Twine &Message) {
+    revng_check(false, Message.str().c_str());
+  };
+  revng_check(yaml::convertYAML(Input, Stream, ErrorHandler));
+  Stream.flush();
+  return Result;
+}
+
+static const char *DTHash = R"YAML(      - Tag:      DT_HASH
+        Value:    0x400500
+)YAML";
+
+static const char *DTGNUHash = R"YAML(      - Tag:      DT_GNU_HASH
+        Value:    0x400600
+)YAML";
+
+static void writeFile(const TemporaryFile &File, StringRef Data) {
+  std::error_code EC;
+  raw_fd_ostream Stream(File.path(), EC);
+  revng_check(not EC);
+  Stream << Data;
+}
+
+struct MergedELF {
+  std::vector<uint64_t> Tags;
+  uint64_t HashAddress = 0;
+  uint32_t HashBuckets = 0;
+  uint32_t HashChains = 0;
+};
+
+/// Merge a dynamic ELF with \p HashTags into one with DT_HASH and collect the
+/// tags of the resulting .dynamic and the header of its hash table
+static MergedELF merge(StringRef HashTags) {
+  TemporaryFile ToExtend("revng-merge-dynamic-to-extend");
+  TemporaryFile Source("revng-merge-dynamic-source");
+  TemporaryFile Output("revng-merge-dynamic-output",
+                       "",
+                       TemporaryFile::Backend::Disk);
+  writeFile(ToExtend, createELF("foo", HashTags));
+  writeFile(Source, createELF("bar", DTHash));
+
+  Error Err = mergeDynamic(ToExtend.path(), Source.path(), Output.path());
+  revng_check(not Err, toString(std::move(Err)).c_str());
+
+  auto MaybeBuffer = MemoryBuffer::getFile(Output.path());
+  revng_check(MaybeBuffer);
+  auto File = cantFail(ELF64LEFile::create((*MaybeBuffer)->getBuffer()));
+
+  // Read the whole .dynamic, including the DT_NULL padding
+  const ELF64LE::Phdr *Dynamic = nullptr;
+  for (const ELF64LE::Phdr &Segment : cantFail(File.program_headers()))
+    if (Segment.p_type == ELF::PT_DYNAMIC)
+      Dynamic = &Segment;
+  revng_check(Dynamic != nullptr);
+
+  const uint8_t *Start = File.base() + Dynamic->p_offset;
+  ArrayRef<ELF64LE::Dyn> Entries(reinterpret_cast<const ELF64LE::Dyn *>(Start),
+                                 Dynamic->p_filesz / sizeof(ELF64LE::Dyn));
+
+  MergedELF Result;
+  for (const ELF64LE::Dyn &Entry : Entries) {
+    Result.Tags.push_back(Entry.getTag());
+    if (Entry.getTag() == ELF::DT_HASH)
+      Result.HashAddress = Entry.getVal();
+  }
+
+  if (Result.HashAddress != 0) {
+    const uint8_t *Hash = cantFail(File.toMappedAddr(Result.HashAddress));
+    using namespace support;
+    Result.HashBuckets = endian::read32le(Hash);
+    Result.HashChains = endian::read32le(Hash + sizeof(uint32_t));
+  }
+
+  return Result;
+}
+
+/// The tags of the ELF to extend, up to the hash tables
+static std::vector<uint64_t> commonTags() {
+  return { ELF::DT_STRTAB, ELF::DT_STRSZ,   ELF::DT_SYMTAB, ELF::DT_SYMENT,
+           ELF::DT_RELA,   ELF::DT_RELASZ,  ELF::DT_RELAENT };
+}
+
+static void checkHashTable(const MergedELF &Merged) {
+  // The hash table covers the null symbol and the two merged ones
+  revng_check(Merged.HashAddress != 0x400500);
+  revng_check(Merged.HashAddress != 0x400600);
+  revng_check(Merged.HashBuckets == 1);
+  revng_check(Merged.HashChains == 3);
+}
+
+BOOST_AUTO_TEST_CASE(TestGNUHashOnly) {
+  // As in the Python implementation, DT_GNU_HASH becomes DT_HASH
+  MergedELF Merged = merge(DTGNUHash);
+  std::vector<uint64_t> Expected = commonTags();
+  Expected.push_back(ELF::DT_HASH);
+  Expected.push_back(ELF::DT_NULL);
+  revng_check(Merged.Tags == Expected);
+  checkHashTable(Merged);
+}
+
+BOOST_AUTO_TEST_CASE(TestHashOnly) {
+  // The Python implementation emitted the same tags, but left DT_HASH pointing
+  // to the original table, which lacks the merged symbols
+  MergedELF Merged = merge(DTHash);
+  std::vector<uint64_t> Expected = commonTags();
+  Expected.push_back(ELF::DT_HASH);
+  Expected.push_back(ELF::DT_NULL);
+  revng_check(Merged.Tags == Expected);
+  checkHashTable(Merged);
+}
+
+BOOST_AUTO_TEST_CASE(TestHashAndGNUHash) {
+  // The Python implementation emitted DT_HASH twice, once pointing to the
+  // original table: now it's emitted once and .dynamic is padded with DT_NULL
+  MergedELF Merged = merge(std::string(DTHash) + DTGNUHash);
+  std::vector<uint64_t> Expected = commonTags();
+  Expected.push_back(ELF::DT_HASH);
+  Expected.push_back(ELF::DT_NULL);
+  Expected.push_back(ELF::DT_NULL);
+  revng_check(Merged.Tags == Expected);
+  checkHashTable(Merged);
+}
@@ -6,12 +6,16 @@
 //
 
 #include <map>
+#include <unordered_map>
+#include <vector>
 
 #define BOOST_TEST_MODULE MetaAddress
 bool init_unit_test();
 #include "boost/test/execution_monitor.hpp"
 #include "boost/test/unit_test.hpp"
 
+#include "llvm/ADT/DenseMap.h"
+
 #include "revng/Support/MetaAddress.h"
 #include "revng/UnitTestHelpers/UnitTestHelpers.h"
 
@@ -184,3 +188,99 @@ BOOST_AUTO_TEST_CASE(Map) {
 
   BOOST_TEST(Map.size() == size_t(5));
 }
+
+BOOST_AUTO_TEST_CASE(PackedComparison) {
+  using namespace MetaAddressType;
+
+  // Fields are compared in order: epoch, address space, type and address
+  std::vector<MetaAddress> Sorted = {
+    MetaAddress::invalid(),
+    MetaAddress(0xFFFF'FFFF, Generic32),
+    MetaAddress(0x0, Generic64),
+    MetaAddress(0x1000, Code_x86),
+    MetaAddress(0x0, Generic32, 0, 1),
+    MetaAddress(0x0, Generic32, 1, 0),
+    MetaAddress(0x1, Generic32, 1, 0),
+    MetaAddress(0x0, Generic32, 0xFFFF'FFFF, 0xFFFF),
+  };
+
+  for (size_t I = 0; I < Sorted.size(); ++I) {
+    for (size_t J = 0; J < Sorted.size(); ++J) {
+      const MetaAddress &A = Sorted[I];
+      const MetaAddress &B = Sorted[J];
+      BOOST_TEST((A < B) == (I < J));
+      BOOST_TEST((A == B) == (I == J));
+      BOOST_TEST((A.toPacked() < B.toPacked()) == (I < J));
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(HashedContainers) {
+  llvm::DenseMap<MetaAddress, int> Map;
+  std::unordered_map<MetaAddress, int> UnorderedMap;
+
+  for (uint64_t I = 0; I < 1000; ++I) {
+    Map[generic64(I * 0x1000)] = I;
+    UnorderedMap[pc(I * 4)] = I;
+  }
+  Map[MetaAddress::invalid()] = -1;
+  Map[MetaAddress::fromPC(Triple::arm, 0)] = -2;
+  Map[MetaAddress::fromPC(Triple::arm, 1)] = -3;
+
+  BOOST_TEST(Map.size() == size_t(1003));
+  BOOST_TEST(UnorderedMap.size() == size_t(1000));
+  BOOST_TEST(Map.lookup(generic64(0x5000)) == 5);
+  BOOST_TEST(Map.lookup(MetaAddress::invalid()) == -1);
+  BOOST_TEST(Map.count(generic64(0x5001)) == size_t(0));
+  BOOST_TEST(UnorderedMap.at(pc(40)) == 10);
+
+  Map.erase(generic64(0x5000));
+  BOOST_TEST(Map.count(generic64(0x5000)) == size_t(0));
+}
+
+BOOST_AUTO_TEST_CASE(StringConversion) {
+  using namespace MetaAddressType;
+
+  std::vector<std::pair<MetaAddress, llvm::StringRef>> Cases = {
+    { MetaAddress::invalid(), ":Invalid" },
+    { MetaAddress(0x0, Generic32), "0x0:Generic32" },
+    { MetaAddress(0xABCDEF, Generic64), "0xabcdef:Generic64" },
+    { MetaAddress(0x1000, Code_arm_thumb, 7), "0x1000:Code_arm_thumb:7" },
+    { MetaAddress(0x1000, Code_x86_64, 7, 3), "0x1000:Code_x86_64:7:3" },
+    { MetaAddress(0xFFFF'FFFF'FFFF'FFF0, Code_systemz, 0xFFFF'FFFF, 0xFFFF),
+      "0xfffffffffffffff0:Code_systemz:4294967295:65535" },
+  };
+
+  for (auto &[Address, Text] : Cases) {
+    BOOST_TEST(Address.toString() == Text.str());
+    BOOST_TEST(MetaAddress::fromString(Text) == Address);
+
+    // toChars fails, rather than truncating, if the buffer is too small
+    char Buffer[MetaAddress::MaxStringLength];
+    BOOST_TEST(Address.toChars(Buffer, Buffer + Text.size() - 1) == nullptr);
+    char *End = Address.toChars(Buffer, Buffer + Text.size());
+    BOOST_TEST((End == Buffer + Text.size()));
+  }
+
+  // Other notations for the numbers and the optional parts
+  BOOST_TEST(MetaAddress::fromString("4096:Generic64")
+             == MetaAddress(0x1000, Generic64));
+  BOOST_TEST(MetaAddress::fromString("0x1000:Code_arm:")
+             == MetaAddress(0x1000, Code_arm));
+  BOOST_TEST(MetaAddress::fromString("0xabc:Generic32::0x2")
+             == MetaAddress(0xABC, Generic32, 0, 2));
+
+  // Malformed inputs
+  const char *Malformed[] = { "",
+                              "0x1000",
+                              "0x1000:",
+                              "0x:Generic32",
+                              "0x1000:Generic16",
+                              "0x1000:Code_",
+                              "0xG:Generic64",
+                              "0x10000000000000000:Generic64",
+                              "0x1000:Generic64:0:0:0",
+                              "0x1000:Generic64:0:65536" };
+  for (llvm::StringRef Text : Malformed)
+    BOOST_TEST(MetaAddress::fromString(Text).isInvalid());
+}
@@ -5,6 +5,9 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <sstream>
+#include <thread>
+
 #define BOOST_TEST_MODULE Model
 bool init_unit_test();
 #include "boost/test/unit_test.hpp"
@@ -12,10 +15,14 @@ bool init_unit_test();
 #include "revng/Model/Binary.h"
 #include "revng/Model/Pass/AllPasses.h"
 #include "revng/Model/Processing.h"
+#include "revng/Model/RawBinaryView.h"
+#include "revng/Model/ToolHelpers.h"
+#include "revng/Model/TypeReferenceGraph.h"
 #include "revng/Support/MetaAddress.h"
 #include "revng/Support/MetaAddress/YAMLTraits.h"
 #include "revng/Support/YAMLTraits.h"
 #include "revng/TupleTree/Introspection.h"
+#include "revng/TupleTree/StreamingDiff.h"
 #include "revng/TupleTree/TupleTreeDiff.h"
 
 using namespace model;
@@ -168,12 +175,80 @@ BOOST_AUTO_TEST_CASE(TestTupleTreeReference) {
   revng_check(AnElement.Self.get() == &AnElement);
 }
 
+namespace TestTupleTree {
+class Fields;
+} // namespace TestTupleTree
+
+class TestTupleTree::Fields {
+public:
+  int Zulu;
+  int Alpha;
+  int Mike;
+  int Bravo;
+  SortedVector<TestTupleTree::Element> Yankee;
+};
+INTROSPECTION_NS(TestTupleTree, Fields, Zulu, Alpha, Mike, Bravo, Yankee)
+
+BOOST_AUTO_TEST_CASE(TestTupleTreeFieldLookup) {
+  using namespace TestTupleTree;
+
+  revng_check(tupleIndexByName<Fields>("Zulu") == 0);
+  revng_check(tupleIndexByName<Fields>("Alpha") == 1);
+  revng_check(tupleIndexByName<Fields>("Mike") == 2);
+  revng_check(tupleIndexByName<Fields>("Bravo") == 3);
+  revng_check(tupleIndexByName<Fields>("Yankee") == 4);
+  revng_check(tupleIndexByName<Fields>("Charlie") == size_t(-1));
+  revng_check(tupleIndexByName<Fields>("") == size_t(-1));
+
+  auto MaybePath = stringAsPath<Fields>("/Yankee/3/Key");
+  revng_check(MaybePath);
+  revng_check(MaybePath->size() == 3);
+  revng_check((*MaybePath)[0].get<size_t>() == 4);
+  revng_check((*MaybePath)[2].get<size_t>() == 0);
+  revng_check(not stringAsPath<Fields>("/Charlie"));
+}
+
 template<typename T>
 static T *createType(model::Binary &Model) {
   model::TypePath Path = Model.recordNewType(makeType<T>());
   return llvm::cast<T>(Path.get());
 }
 
+BOOST_AUTO_TEST_CASE(TestTupleTreeReferenceCache) {
+  TupleTree<model::Binary> Model;
+  model::TypePath Path = Model->recordNewType(makeType<model::StructType>());
+  auto *Typedef = createType<TypedefType>(*Model);
+  Typedef->UnderlyingType = { Path, {} };
+  Model.initializeReferences();
+
+  model::TypePath &InTree = Typedef->UnderlyingType.UnqualifiedType;
+  const model::Type *Original = Path.get();
+  revng_check(Original != nullptr);
+  revng_check(InTree.get() == Original);
+  revng_check(InTree.get() == Original);
+
+  // Adding types moves the UpcastablePointers around, but not the types
+  for (unsigned I = 0; I < 100; ++I)
+    Model->recordNewType(makeType<model::StructType>());
+  revng_check(Path.get() == Original);
+  revng_check(InTree.get() == Original);
+
+  // Replacing the type with another one with the same key must not return the
+  // old one
+  auto Key = Original->key();
+  UpcastablePointer<model::Type> Copy = Model->Types.at(Key);
+  Model->Types.at(Key) = Copy;
+  const model::Type *Replacement = Model->Types.at(Key).get();
+  revng_check(Replacement != Original);
+  revng_check(Path.get() == Replacement);
+  revng_check(InTree.get() == Replacement);
+
+  // Dropping the type must not leave a dangling cached pointer behind
+  Model->Types.erase(Key);
+  revng_check(Path.get() == nullptr);
+  revng_check(InTree.get() == nullptr);
+}
+
 BOOST_AUTO_TEST_CASE(TestModelDeduplication) {
   TupleTree<model::Binary> Model;
   auto Dedup = [&Model]() {
@@ -254,6 +329,266 @@ BOOST_AUTO_TEST_CASE(TestModelDeduplication) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(TestModelDeduplicationThroughUnnamedTypes) {
+  TupleTree<model::Binary> Model;
+  auto Dedup = [&Model]() {
+    int64_t OldTypesCount = Model->Types.size();
+    deduplicateEquivalentTypes(Model);
+    int64_t NewTypesCount = Model->Types.size();
+    return OldTypesCount - NewTypesCount;
+  };
+
+  model::TypePath UInt8 = Model->getPrimitiveType(PrimitiveTypeKind::Generic,
+                                                  4);
+  auto PointerQualifier = Qualifier::createPointer(8);
+
+  // Many copies of a named struct pointing to itself through an unnamed
+  // typedef, as emitted for each translation unit by the DWARF importer
+  constexpr unsigned Copies = 1000;
+  model::TypedefType *Different = nullptr;
+  for (unsigned I = 0; I < Copies; ++I) {
+    auto *Struct = createType<StructType>(*Model);
+    Struct->OriginalName = "ListNode";
+
+    auto *Typedef = createType<TypedefType>(*Model);
+    Typedef->UnderlyingType = { Model->getTypePath(Struct),
+                                { PointerQualifier } };
+
+    Struct->Fields[0].Type = { Model->getTypePath(Typedef), {} };
+    Struct->Fields[8].Type = { UInt8, {} };
+
+    if (I == Copies / 2)
+      Different = Typedef;
+  }
+
+  // Make one of the copies different
+  Different->UnderlyingType.Qualifiers.push_back(PointerQualifier);
+
+  // Unnamed typedefs are never deduplicated on their own
+  revng_check(Dedup() == Copies - 2);
+}
+
+BOOST_AUTO_TEST_CASE(TestIncrementalVerifier) {
+  TupleTree<model::Binary> Model;
+  model::TypePath Generic4 = Model->getPrimitiveType(PrimitiveTypeKind::Generic,
+                                                     4);
+
+  auto *Typedef = createType<TypedefType>(*Model);
+  Typedef->UnderlyingType = { Generic4, {} };
+
+  IncrementalVerifier Verifier;
+  revng_check(Verifier.verify(Model));
+
+  // Nothing changed
+  revng_check(Verifier.verify(Model));
+
+  // Break the typedef
+  Typedef->CustomName = "0Invalid";
+  revng_check(not Verifier.verify(Model));
+  revng_check(not Model->verify());
+
+  // Fix it
+  Typedef->CustomName = "Valid";
+  revng_check(Verifier.verify(Model));
+
+  // Break a type the typedef refers to
+  auto *Struct = createType<StructType>(*Model);
+  Struct->Fields[0].Type = { Generic4, {} };
+  Struct->Size = 4;
+  Typedef->UnderlyingType = { Model->getTypePath(Struct), {} };
+  revng_check(Verifier.verify(Model));
+
+  Struct->CustomName = "0Invalid";
+  revng_check(not Verifier.verify(Model));
+}
+
+/// A struct, MyStruct, and an unnamed typedef of it
+static TupleTree<model::Binary> makeVerifyChangesModel() {
+  TupleTree<model::Binary> Model;
+  model::TypePath UInt8 = Model->getPrimitiveType(PrimitiveTypeKind::Generic,
+                                                  4);
+
+  auto *Struct = createType<StructType>(*Model);
+  Struct->Fields[0].Type = { UInt8, {} };
+  Struct->Size = 4;
+  Struct->CustomName = "MyStruct";
+
+  auto *Typedef = createType<TypedefType>(*Model);
+  Typedef->UnderlyingType = { Model->getTypePath(Struct), {} };
+
+  revng_check(Model->verify());
+  return Model;
+}
+
+BOOST_AUTO_TEST_CASE(TestVerifyChanges) {
+  auto Prepare = [](auto &&Change) {
+    TupleTree<model::Binary> Model = makeVerifyChangesModel();
+    const model::Type *Struct = nullptr;
+    const model::Type *Typedef = nullptr;
+    for (const UpcastablePointer<model::Type> &T : Model->Types) {
+      if (isa<StructType>(T.get()))
+        Struct = T.get();
+      else if (isa<TypedefType>(T.get()))
+        Typedef = T.get();
+    }
+
+    TupleTree<model::Binary> After = Model.clone();
+    Change(*After, *After->Types.at(Struct->key()),
+           *After->Types.at(Typedef->key()));
+
+    auto Diff = diff(Model, After);
+    Diff.applyIncrementally(Model);
+    return std::make_pair(std::move(Model), std::move(Diff));
+  };
+
+  // A valid change
+  {
+    auto [Model, Diff] = Prepare([](Binary &, Type &, Type &Typedef) {
+      Typedef.CustomName = "MyTypedef";
+    });
+    revng_check(Model->verifyChanges(Diff));
+  }
+
+  // Renamings are checked against the names of all the other types
+  {
+    auto [Model, Diff] = Prepare([](Binary &, Type &, Type &Typedef) {
+      Typedef.CustomName = "MyStruct";
+    });
+    revng_check(not Model->verifyChanges(Diff));
+    revng_check(not Model->verify());
+  }
+
+  // Types referring to a removed type are verified too
+  {
+    auto [Model, Diff] = Prepare([](Binary &After, Type &Struct, Type &) {
+      auto Key = Struct.key();
+      After.Types.erase(Key);
+    });
+    revng_check(not Model->verifyChanges(Diff));
+  }
+
+  // What a change cannot reach is not verified again
+  {
+    auto [Model, Diff] = Prepare([](Binary &After, Type &Struct, Type &) {
+      Struct.OriginalName = "Original";
+      auto *Unrelated = createType<TypedefType>(After);
+      Unrelated->UnderlyingType = { After.getPrimitiveType(PrimitiveTypeKind::
+                                                             Generic,
+                                                           4),
+                                    {} };
+      Unrelated->OriginalName = "0Invalid";
+      Unrelated->CustomName = "0Invalid";
+    });
+    revng_check(not Model->verify());
+
+    // The typedef has been added, hence it's verified
+    revng_check(not Model->verifyChanges(Diff));
+
+    // A later change to the struct leaves it alone
+    TupleTree<model::Binary> After = Model.clone();
+    for (UpcastablePointer<model::Type> &T : After->Types)
+      if (auto *AfterStruct = dyn_cast<StructType>(T.get()))
+        AfterStruct->OriginalName = "Changed";
+    auto Later = diff(Model, After);
+    Later.applyIncrementally(Model);
+    revng_check(Model->verifyChanges(Later));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(TestIncrementalVerificationScope) {
+  revng_check(IncrementalVerificationScope::current() == nullptr);
+  {
+    IncrementalVerificationScope Outer;
+    auto *OuterVerifier = IncrementalVerificationScope::current();
+    revng_check(OuterVerifier != nullptr);
+    {
+      // Scopes do not share verifiers
+      IncrementalVerificationScope Inner;
+      revng_check(IncrementalVerificationScope::current() != OuterVerifier);
+    }
+    revng_check(IncrementalVerificationScope::current() == OuterVerifier);
+  }
+  revng_check(IncrementalVerificationScope::current() == nullptr);
+
+  // Each thread has its own scopes
+  IncrementalVerificationScope Scope;
+  std::thread([] {
+    revng_check(IncrementalVerificationScope::current() == nullptr);
+  }).join();
+}
+
+BOOST_AUTO_TEST_CASE(TestPrimitiveTypeLookupsAfterChanges) {
+  TupleTree<model::Binary> Model;
+  const auto Get = [](model::Binary &Binary, uint8_t Size) {
+    model::TypePath Path = Binary.getPrimitiveType(PrimitiveTypeKind::Unsigned,
+                                                   Size);
+    auto *Primitive = cast<PrimitiveType>(Path.get());
+    revng_check(Primitive->PrimitiveKind == PrimitiveTypeKind::Unsigned);
+    revng_check(Primitive->Size == Size);
+    return Primitive;
+  };
+
+  // Repeated lookups do not record new types
+  PrimitiveType *UInt32 = Get(*Model, 4);
+  revng_check(Get(*Model, 4) == UInt32);
+  revng_check(Model->Types.size() == 1);
+
+  // UInt8 is recorded before UInt32, moving it
+  Get(*Model, 1);
+  revng_check(Model->Types.size() == 2);
+  revng_check(Get(*Model, 4)->key() == UInt32->key());
+
+  // Erasing UInt8 moves UInt32 back
+  auto UInt8Key = Get(*Model, 1)->key();
+  Get(*Model, 4);
+  Model->Types.erase(UInt8Key);
+  revng_check(Get(*Model, 4)->key() == UInt32->key());
+  revng_check(Model->Types.size() == 1);
+
+  // Erased types are recorded again
+  Model->Types.erase(UInt32->key());
+  Get(*Model, 4);
+  revng_check(Model->Types.size() == 1);
+
+  // Copies look up their own types
+  model::Binary Copy = *Model;
+  PrimitiveType *Copied = Get(Copy, 4);
+  revng_check(Copied == Copy.Types.begin()->get());
+  revng_check(Copied != Get(*Model, 4));
+}
+
+BOOST_AUTO_TEST_CASE(TestPurgeUnnamedAndUnreachableTypes) {
+  TupleTree<model::Binary> Model;
+  model::TypePath UInt8 = Model->getPrimitiveType(PrimitiveTypeKind::Unsigned,
+                                                  1);
+  model::TypePath UInt32 = Model->getPrimitiveType(PrimitiveTypeKind::Unsigned,
+                                                   4);
+
+  auto *Unnamed = createType<TypedefType>(*Model);
+  Unnamed->UnderlyingType = { UInt8, {} };
+
+  auto *Named = createType<TypedefType>(*Model);
+  Named->UnderlyingType = { UInt32, {} };
+  Named->OriginalName = "MyUInt32";
+
+  {
+    model::TypeReferenceGraph Graph(*Model);
+    revng_check(Graph.size() == 4);
+    revng_check(Graph.dangling().empty());
+    revng_check(Graph.externallyReferenced().empty());
+
+    auto UInt32Node = Graph.id(UInt32.get());
+    revng_check(Graph.predecessors(UInt32Node).size() == 1);
+    revng_check(Graph.type(Graph.predecessors(UInt32Node)[0]) == Named);
+  }
+
+  model::TypePath NamedPath = Model->getTypePath(Named);
+  purgeUnnamedAndUnreachableTypes(Model);
+  revng_check(Model->Types.size() == 2);
+  revng_check(NamedPath.isValid());
+  revng_check(UInt32.isValid());
+}
+
 BOOST_AUTO_TEST_CASE(TestTupleTreeDiff) {
   model::Binary Left;
   model::Binary Right;
@@ -295,8 +630,247 @@ BOOST_AUTO_TEST_CASE(TestTupleTreeDiffDeserialization) {
   BOOST_TEST(S == S2);
 }
 
+BOOST_AUTO_TEST_CASE(TestTupleTreeDiffWithHashes) {
+  TupleTree<model::Binary> Left;
+  for (uint64_t Address = 0x1000; Address <= 0x2000; Address += 0x10) {
+    auto Entry = MetaAddress::fromPC(llvm::Triple::arm, Address);
+    Left->Functions[Entry].CustomName = "f_" + std::to_string(Address);
+  }
+
+  TupleTree<model::Binary> Right = Left.clone();
+  revng_check(diff(Left, Right).Changes.empty());
+
+  // Diffing again after a change detects it
+  Right->Functions.at(ARM1000).CustomName = "changed";
+  auto Diff = diff(Left, Right);
+  revng_check(Diff.Changes.size() == 1);
+  revng_check(Diff.Changes.size() == diff(*Left, *Right).Changes.size());
+
+  Right->Functions.erase(ARM2000);
+  revng_check(diff(Left, Right).Changes.size() == 2);
+
+  // Changes made through a pointer obtained before diffing are detected too
+  model::Binary &RightBinary = *Right;
+  revng_check(diff(Left, Right).Changes.size() == 2);
+  auto ARM1800 = MetaAddress::fromPC(llvm::Triple::arm, 0x1800);
+  RightBinary.Functions.at(ARM1800).CustomName = "changed";
+  revng_check(diff(Left, Right).Changes.size() == 3);
+}
+
+BOOST_AUTO_TEST_CASE(TestTupleTreeDiffApply) {
+  TupleTree<model::Binary> Left;
+
+  TupleTree<model::Binary> Middle = Left.clone();
+  model::TypePath UInt32 = Middle->getPrimitiveType(PrimitiveTypeKind::Unsigned,
+                                                    4);
+  auto *Typedef = createType<TypedefType>(*Middle);
+  Typedef->UnderlyingType = { UInt32, {} };
+
+  TupleTree<model::Binary> Right = Middle.clone();
+  Right->Functions[ARM1000].CustomName = "f";
+
+  auto First = diff(*Left, *Middle);
+  auto Second = diff(*Middle, *Right);
+
+  // The references introduced by the diffs point to the tree they're applied
+  // to, however the diffs are applied
+  TupleTree<model::Binary> Batched = Left.clone();
+  TupleTreeDiff<model::Binary>::apply({ First, Second }, Batched);
+  revng_check(Batched.verify());
+  revng_check(diff(*Batched, *Right).Changes.empty());
+
+  TupleTree<model::Binary> Incremental = Left.clone();
+  First.applyIncrementally(Incremental);
+  Second.applyIncrementally(Incremental);
+  revng_check(Incremental.verify());
+  revng_check(diff(*Incremental, *Right).Changes.empty());
+}
+
+BOOST_AUTO_TEST_CASE(TestStreamingTupleTreeDiff) {
+  TupleTree<model::Binary> Left;
+  for (uint64_t Address = 0x1000; Address <= 0x2000; Address += 0x10) {
+    auto Entry = MetaAddress::fromPC(llvm::Triple::arm, Address);
+    Left->Functions[Entry].CustomName = "f_" + std::to_string(Address);
+  }
+
+  TupleTree<model::Binary> Right = Left.clone();
+  Right->Functions.at(ARM1000).CustomName = "changed";
+  Right->Functions.erase(ARM2000);
+  Right->Functions[MetaAddress::fromPC(llvm::Triple::arm, 0x3000)];
+  Right->ExtraCodeAddresses.insert(ARM3000);
+
+  auto Streamed = [](const TupleTree<model::Binary> &LHS,
+                     const TupleTree<model::Binary> &RHS) {
+    std::string LHSYAML;
+    std::string RHSYAML;
+    LHS.serialize(LHSYAML);
+    RHS.serialize(RHSYAML);
+    std::istringstream LHSStream(LHSYAML);
+    std::istringstream RHSStream(RHSYAML);
+
+    std::string Result;
+    {
+      llvm::raw_string_ostream Stream(Result);
+      using namespace tupletreediff::streaming;
+      StreamingDiff<model::Binary> Differ(Stream);
+      llvm::cantFail(Differ.run(LHSStream, RHSStream));
+    }
+    return Result;
+  };
+
+  // The changes, and their order, are the same of the in-memory diff
+  BOOST_TEST(Streamed(Left, Right) == serializeToString(diff(*Left, *Right)));
+  BOOST_TEST(Streamed(Right, Left) == serializeToString(diff(*Right, *Left)));
+  BOOST_TEST(Streamed(Left, Left) == serializeToString(diff(*Left, *Left)));
+}
+
 static_assert(std::is_default_constructible_v<TupleTree<TestTupleTree::Root>>);
 static_assert(not std::is_copy_assignable_v<TupleTree<TestTupleTree::Root>>);
 static_assert(not std::is_copy_constructible_v<TupleTree<TestTupleTree::Root>>);
 static_assert(std::is_move_assignable_v<TupleTree<TestTupleTree::Root>>);
 static_assert(std::is_move_constructible_v<TupleTree<TestTupleTree::Root>>);
+
+BOOST_AUTO_TEST_CASE(TestBinarySerialization) {
+  TupleTree<model::Binary> Model;
+  Model->Architecture = model::Architecture::x86_64;
+  Model->ExtraCodeAddresses.insert(ARM1000);
+
+  model::TypePath UInt8 = Model->getPrimitiveType(PrimitiveTypeKind::Unsigned,
+                                                  1);
+  auto *Struct = createType<StructType>(*Model);
+  Struct->Fields[0].CustomName = "FirstField";
+  Struct->Fields[0].Type = { UInt8, {} };
+  Struct->OriginalName = "MyStruct";
+
+  model::Function &F = Model->Functions[ARM2000];
+  F.CustomName = "MyFunction";
+
+  std::string Binary;
+  {
+    llvm::raw_string_ostream Stream(Binary);
+    Model.serializeBinary(Stream);
+  }
+  revng_check(tupletree::binary::isBinarySerialization(Binary));
+
+  // deserialize detects the binary format on its own
+  auto MaybeLoaded = TupleTree<model::Binary>::deserialize(Binary);
+  revng_check(MaybeLoaded);
+  TupleTree<model::Binary> &Loaded = *MaybeLoaded;
+  revng_check(Loaded->Types.size() == Model->Types.size());
+  revng_check(Loaded->Functions.at(ARM2000).CustomName == "MyFunction");
+
+  // References point to the new root
+  auto *LoadedStruct = cast<StructType>(Loaded->Types.at(Struct->key()).get());
+  auto Unsigned8 = Loaded->getPrimitiveType(PrimitiveTypeKind::Unsigned, 1);
+  revng_check(LoadedStruct->Fields[0].Type.UnqualifiedType.get()
+              == Unsigned8.get());
+
+  std::string Expected;
+  std::string Actual;
+  Model.serialize(Expected);
+  Loaded.serialize(Actual);
+  revng_check(Expected == Actual);
+
+  // A truncated buffer and a buffer with a different schema are rejected
+  llvm::StringRef Truncated = llvm::StringRef(Binary).drop_back(1);
+  revng_check(not TupleTree<model::Binary>::deserialize(Truncated));
+
+  auto MaybeOther = tupletree::binary::deserialize<TestTupleTree::Root>(Binary);
+  revng_check(not MaybeOther);
+  llvm::consumeError(MaybeOther.takeError());
+}
+
+BOOST_AUTO_TEST_CASE(TestRawBinaryViewLookups) {
+  auto Generic = [](uint64_t Address) {
+    return MetaAddress::fromGeneric(llvm::Triple::x86_64, Address);
+  };
+
+  Binary TheBinary;
+  auto AddSegment = [&](uint64_t Address, uint64_t Size, uint64_t Offset) {
+    Segment &NewSegment = TheBinary.Segments[{ Generic(Address), Size }];
+    NewSegment.StartOffset = Offset;
+    NewSegment.FileSize = Size;
+  };
+
+  std::vector<uint8_t> Data(0x1000);
+  RawBinaryView View(TheBinary, Data);
+  AddSegment(0x3000, 0x100, 0x300);
+  AddSegment(0x1000, 0x100, 0x100);
+  AddSegment(0x2000, 0x100, 0x200);
+
+  // The view notices the new segments
+  revng_check(View.addressToOffset(Generic(0x1010)) == 0x110);
+  revng_check(View.addressToOffset(Generic(0x2010)) == 0x210);
+  revng_check(View.addressToOffset(Generic(0x3010), 0x10) == 0x310);
+  revng_check(not View.addressToOffset(Generic(0x30f8), 0x10));
+  revng_check(not View.addressToOffset(Generic(0x1100)));
+  revng_check(not View.addressToOffset(Generic(0x500)));
+
+  // Addresses in more than one segment are ambiguous
+  AddSegment(0x2080, 0x100, 0x400);
+  revng_check(not View.addressToOffset(Generic(0x2090)));
+  revng_check(View.addressToOffset(Generic(0x2010)) == 0x210);
+  revng_check(View.addressToOffset(Generic(0x2110)) == 0x490);
+  revng_check(View.addressToOffset(Generic(0x1010)) == 0x110);
+
+  // Replacing a segment is noticed too, even if the number of segments and
+  // their storage do not change
+  TheBinary.Segments.erase({ Generic(0x2080), 0x100 });
+  AddSegment(0x5000, 0x100, 0x500);
+  revng_check(View.addressToOffset(Generic(0x2090)) == 0x290);
+  revng_check(View.addressToOffset(Generic(0x5010)) == 0x510);
+}
+
+BOOST_AUTO_TEST_CASE(TestModelSidecarFollowsTheOutput) {
+  using namespace llvm;
+
+  SmallString<128> Directory;
+  revng_check(not sys::fs::createUniqueDirectory("revng-sidecar", Directory));
+  auto Path = [&Directory](StringRef Name) {
+    SmallString<128> Result(Directory);
+    sys::path::append(Result, Name);
+    return Result.str().str();
+  };
+
+  // A module whose model lives in a sidecar
+  TupleTree<model::Binary> Original;
+  Original->Architecture = model::Architecture::x86_64;
+  {
+    LLVMContext Context;
+    Module M("input", Context);
+    revng_check(not writeModel(*Original, M, Path("input.model.yml")));
+
+    std::error_code EC;
+    raw_fd_ostream Stream(Path("input.ll"), EC);
+    revng_check(not EC);
+    M.print(Stream, nullptr);
+  }
+
+  auto Loaded = ModelInModule::loadModule(Path("input.ll"));
+  revng_check(Loaded);
+  revng_check(Loaded->Model->Architecture == model::Architecture::x86_64);
+
+  // Saving the module does not overwrite the sidecar of the input
+  Loaded->Model->Architecture = model::Architecture::aarch64;
+  revng_check(not Loaded->save(Path("output.ll"), ModelOutputType::LLVMIR));
+
+  auto Input = TupleTree<model::Binary>::fromFile(Path("input.model.yml"));
+  revng_check(Input);
+  revng_check((*Input)->Architecture == model::Architecture::x86_64);
+
+  auto Output = ModelInModule::loadModule(Path("output.ll"));
+  revng_check(Output);
+  revng_check(Output->Model->Architecture == model::Architecture::aarch64);
+  auto Derived = ModelInModule::deriveSidecar(Path("output.ll"));
+  revng_check(Derived);
+  revng_check(sys::fs::exists(*Derived));
+
+  // Failing to write the sidecar is reported
+  LLVMContext Context;
+  Module M("unwritable", Context);
+  auto Error = writeModel(*Original, M, Path("missing/model.yml"));
+  revng_check(static_cast<bool>(Error));
+  consumeError(std::move(Error));
+
+  revng_check(not sys::fs::remove_directories(Directory));
+}
@@ -0,0 +1,108 @@
+/// \file OpaqueFunctionsPool.cpp
+/// \brief Tests for OpaqueFunctionsPool and SharedOpaqueFunctionsPool
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#define BOOST_TEST_MODULE OpaqueFunctionsPool
+bool init_unit_test();
+#include "boost/test/unit_test.hpp"
+
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+
+#include "revng/Support/Assert.h"
+#include "revng/Support/OpaqueFunctionsPool.h"
+
+using namespace llvm;
+
+static std::vector<Type *> getKeyTypes(LLVMContext &Context) {
+  std::vector<Type *> Result;
+  for (unsigned Bits : { 1, 8, 16, 32, 64, 128 })
+    Result.push_back(IntegerType::get(Context, Bits));
+  return Result;
+}
+
+static FunctionType *getPrototype(Type *Key) {
+  return FunctionType::get(Key, { Key }, false);
+}
+
+BOOST_AUTO_TEST_CASE(KeyedByModule) {
+  SharedOpaqueFunctionsPool<Type *> Pool;
+  Pool.addFnAttribute(Attribute::ReadNone);
+  Pool.setTags({ &FunctionTags::Marker });
+
+  LLVMContext Context;
+  Module A("a", Context);
+  Module B("b", Context);
+  Type *Int32 = Type::getInt32Ty(Context);
+
+  Function *InA = Pool.get(&A, Int32, Int32, { Int32 }, "opaque");
+  Function *InB = Pool.get(&B, Int32, Int32, { Int32 }, "opaque");
+  revng_check(InA != InB);
+  revng_check(InA->getParent() == &A);
+  revng_check(InB->getParent() == &B);
+  revng_check(Pool.get(&A, Int32, Int32, { Int32 }) == InA);
+  revng_check(InA->hasFnAttribute(Attribute::ReadNone));
+  revng_check(FunctionTags::Marker.isTagOf(InA));
+
+  Pool.purge(&A, true);
+  revng_check(A.getFunction("opaque") == nullptr);
+  revng_check(Pool.get(&B, Int32, Int32, { Int32 }) == InB);
+}
+
+BOOST_AUTO_TEST_CASE(Parallel) {
+  SharedOpaqueFunctionsPool<Type *> Pool;
+
+  constexpr unsigned ThreadsCount = 8;
+  std::vector<bool> Results(ThreadsCount, false);
+  std::vector<std::thread> Threads;
+  for (unsigned I = 0; I < ThreadsCount; ++I) {
+    Threads.emplace_back([&Pool, &Results, I]() {
+      LLVMContext Context;
+      Module M("shard", Context);
+      std::vector<Type *> Keys = getKeyTypes(Context);
+
+      auto GetName = [](Type *Key) {
+        return "opaque_" + std::to_string(Key->getIntegerBitWidth());
+      };
+      Pool.populate(&M, Keys, getPrototype, GetName);
+
+      bool Success = M.getFunctionList().size() == Keys.size();
+      for (unsigned Round = 0; Round < 100; ++Round) {
+        for (Type *Key : Keys) {
+          Function *F = Pool.get(&M, Key, getPrototype(Key));
+          Success = Success and F->getName() == GetName(Key);
+        }
+      }
+
+      Success = Success and M.getFunctionList().size() == Keys.size();
+      Pool.purge(&M, true);
+      Results[I] = Success and M.getFunctionList().empty();
+    });
+  }
+
+  for (std::thread &Thread : Threads)
+    Thread.join();
+
+  for (bool Result : Results)
+    revng_check(Result);
+}
+
+BOOST_AUTO_TEST_CASE(Find) {
+  LLVMContext Context;
+  Module M("m", Context);
+  Type *Int32 = Type::getInt32Ty(Context);
+
+  OpaqueFunctionsPool<Type *> Pool(&M, false);
+  revng_check(Pool.find(Int32) == nullptr);
+
+  Function *F = Pool.get(Int32, Int32, { Int32 }, "opaque");
+  revng_check(Pool.find(Int32) == F);
+  revng_check(Pool.find(Type::getInt64Ty(Context)) == nullptr);
+}
@@ -0,0 +1,97 @@
+/// \file PathList.cpp
+/// \brief Tests for PathList
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <string>
+
+#define BOOST_TEST_MODULE PathList
+bool init_unit_test();
+#include "boost/test/unit_test.hpp"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "revng/Support/Assert.h"
+#include "revng/Support/PathList.h"
+
+namespace fs = llvm::sys::fs;
+
+/// \brief A directory removed, with all its contents, upon destruction
+class TestDirectory {
+private:
+  llvm::SmallString<64> Path;
+
+public:
+  TestDirectory() {
+    std::error_code EC = fs::createUniqueDirectory("revng-test", Path);
+    revng_check(not EC);
+  }
+
+  ~TestDirectory() { fs::remove_directories(Path); }
+
+public:
+  std::string path() const { return Path.str().str(); }
+
+  std::string write(const llvm::Twine &RelativePath,
+                    llvm::StringRef Content = "") const {
+    llvm::SmallString<64> FullPath;
+    llvm::sys::path::append(FullPath, Path, RelativePath);
+    std::error_code EC = fs::create_directories(llvm::sys::path::parent_path(
+      FullPath));
+    revng_check(not EC);
+
+    llvm::raw_fd_ostream Stream(FullPath, EC);
+    revng_check(not EC);
+    Stream << Content;
+    return FullPath.str().str();
+  }
+};
+
+BOOST_AUTO_TEST_CASE(LookupsAreInOrder) {
+  TestDirectory First;
+  TestDirectory Second;
+  std::string InSecond = Second.write("share/a");
+  std::string InFirst = First.write("share/b");
+  Second.write("share/b");
+
+  PathList Paths({ First.path(), Second.path() });
+  revng_check(Paths.findFile("share/a") == InSecond);
+  revng_check(Paths.findFile("share/b") == InFirst);
+  revng_check(not Paths.findFile("share/c"));
+}
+
+BOOST_AUTO_TEST_CASE(LookupsAreMemoized) {
+  TestDirectory Directory;
+  std::string File = Directory.write("share/a");
+
+  PathList Paths({ Directory.path() });
+  revng_check(Paths.findFile("share/a") == File);
+  revng_check(not Paths.findFile("share/b"));
+
+  fs::remove(File);
+  Directory.write("share/b");
+  revng_check(Paths.findFile("share/a") == File);
+  revng_check(not Paths.findFile("share/b"));
+}
+
+BOOST_AUTO_TEST_CASE(IndexesAreUsed) {
+  TestDirectory Indexed;
+  TestDirectory Other;
+
+  // The index lists a file which is not there, and misses one which is
+  Indexed.write(PathList::IndexFileName, "share/listed\nshare/ghost\n");
+  std::string Listed = Indexed.write("share/listed");
+  std::string Unlisted = Indexed.write("share/unlisted");
+  std::string Ghost = Other.write("share/ghost");
+
+  PathList Paths({ Indexed.path(), Other.path() });
+  revng_check(Paths.findFile("share/listed") == Listed);
+  revng_check(Paths.findFile("share/ghost") == Ghost);
+  revng_check(Paths.findFile("share/unlisted") == Unlisted);
+}
@@ -0,0 +1,64 @@
+/// \file PerfectHash.cpp
+/// \brief Tests for PerfectHash
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <cstdint>
+#include <set>
+#include <vector>
+
+#define BOOST_TEST_MODULE PerfectHash
+bool init_unit_test();
+#include "boost/test/unit_test.hpp"
+
+#include "revng/ADT/PerfectHash.h"
+
+static void checkPerfect(const std::vector<uint64_t> &Keys) {
+  PerfectHash Hash = PerfectHash::build(Keys);
+  revng_check(llvm::isPowerOf2_64(Hash.SlotsCount));
+  revng_check(Hash.SlotsCount >= Keys.size());
+
+  std::set<uint64_t> Slots;
+  for (uint64_t Key : Keys) {
+    uint64_t Slot = Hash.slot(Key);
+    revng_check(Slot < Hash.SlotsCount);
+    revng_check(Slots.insert(Slot).second);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Empty) {
+  checkPerfect({});
+}
+
+BOOST_AUTO_TEST_CASE(Single) {
+  checkPerfect({ 0x400000 });
+}
+
+BOOST_AUTO_TEST_CASE(AlignedAddresses) {
+  // Jump targets are typically dense and aligned
+  std::vector<uint64_t> Keys;
+  for (uint64_t I = 0; I < 20000; ++I)
+    Keys.push_back(0x400000 + I * 4);
+  checkPerfect(Keys);
+}
+
+BOOST_AUTO_TEST_CASE(SparseAddresses) {
+  std::vector<uint64_t> Keys;
+  uint64_t Address = 0x10000;
+  for (uint64_t I = 0; I < 5000; ++I) {
+    Address += 1 + PerfectHash::hash(I, 0) % 4096;
+    Keys.push_back(Address);
+  }
+  checkPerfect(Keys);
+}
+
+BOOST_AUTO_TEST_CASE(Compact) {
+  // The table is not more than 2.5 times the number of keys
+  std::vector<uint64_t> Keys;
+  for (uint64_t I = 0; I < 1000; ++I)
+    Keys.push_back(I * 16);
+  PerfectHash Hash = PerfectHash::build(Keys);
+  revng_check(Hash.SlotsCount <= 2048);
+}
@@ -6,37 +6,54 @@
 //
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/IR/Constants.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalVariable.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/InitializePasses.h"
 #include "llvm/Pass.h"
 #include "llvm/Support/Casting.h"
+#include "llvm/Support/JSON.h"
 #include "llvm/Support/TargetSelect.h"
 #include "llvm/Support/YAMLTraits.h"
 #include "llvm/Transforms/Utils/Cloning.h"
 
 #include "revng/Pipeline/AllRegistries.h"
+#include "revng/Pipeline/ArtifactCache.h"
 #include "revng/Pipeline/ContainerEnumerator.h"
 #include "revng/Pipeline/ContainerFactorySet.h"
 #include "revng/Pipeline/Context.h"
 #include "revng/Pipeline/Contract.h"
 #include "revng/Pipeline/Errors.h"
 #include "revng/Pipeline/GenericLLVMPipe.h"
+#include "revng/Pipeline/InvalidationEvent.h"
 #include "revng/Pipeline/Kind.h"
 #include "revng/Pipeline/LLVMContainerFactory.h"
 #include "revng/Pipeline/LLVMGlobalKindBase.h"
 #include "revng/Pipeline/Loader.h"
+#include "revng/Pipeline/NewPMLLVMPipe.h"
 #include "revng/Pipeline/PathComponent.h"
+#include "revng/Pipeline/Profiler.h"
+#include "revng/Pipeline/RemoteWorkers.h"
+#include "revng/Pipeline/RunEventLog.h"
 #include "revng/Pipeline/Runner.h"
+#include "revng/Pipeline/ShardedLLVMContainer.h"
 #include "revng/Pipeline/Target.h"
+#include "revng/Pipeline/TargetsBitmap.h"
 
 static char LLVMName = ' ';
 
@@ -49,6 +66,7 @@ const char ExampleLLVMInspectalbeContainer::ID = '0';
 bool init_unit_test();
 #include "boost/test/unit_test.hpp"
 
+#include "revng/Support/TaskScheduler.h"
 #include "revng/UnitTestHelpers/UnitTestHelpers.h"
 
 using namespace pipeline;
@@ -84,6 +102,10 @@ static Kind FunctionKind("FunctionKind", &FunctionRank);
 
 static std::string CName = "ContainerName";
 
+/// The names of the MapContainers merged back so far, in order
+static std::mutex MergedContainersLock;
+static std::vector<std::string> MergedContainers;
+
 class MapContainer : public Container<MapContainer> {
 public:
   MapContainer(std::map<Target, int> Map, llvm::StringRef Name) :
@@ -122,68 +144,78 @@ public:
     return ToReturn;
   }
 
-  bool remove(const TargetsList &Targets) override {
-
-    if (Targets.contains(AllTargets)) {
-      Map.clear();
-      return true;
-    }
-
-    bool RemovedAll = true;
-    for (const auto &Target : Targets)
-      RemovedAll = remove(Target) && RemovedAll;
-
-    return RemovedAll;
-  }
-
-  bool remove(const Target &Target) {
-    if (Map.find(Target) == Map.end())
-      return false;
-
-    Map.erase(Target);
-    return true;
-  }
-
   static char ID;
 
-  auto &get(Target Target) { return Map[std::move(Target)]; }
+  auto &get(Target Target) {
+    markModified();
+    return Map[std::move(Target)];
+  }
   const auto &get(const Target &Target) const {
     return Map.find(std::move(Target))->second;
   }
   auto &getMap() const { return Map; }
-  auto &getMap() { return Map; }
+  auto &getMap() {
+    markModified();
+    return Map;
+  }
 
   llvm::Error storeToDisk(llvm::StringRef Path) const override {
     SavedData = Map;
     return llvm::Error::success();
   }
 
-  llvm::Error loadFromDisk(llvm::StringRef Path) override {
-    Map = SavedData;
+  llvm::Error serialize(llvm::raw_ostream &OS) const final {
+
     return llvm::Error::success();
   }
 
-  llvm::Error serialize(llvm::raw_ostream &OS) const final {
+protected:
+  bool removeImpl(const TargetsList &Targets) override {
+
+    if (Targets.contains(AllTargets)) {
+      Map.clear();
+      return true;
+    }
+
+    bool RemovedAll = true;
+    for (const auto &Target : Targets)
+      RemovedAll = removeTarget(Target) && RemovedAll;
 
+    return RemovedAll;
+  }
+
+  llvm::Error loadFromDiskImpl(llvm::StringRef Path) override {
+    Map = SavedData;
     return llvm::Error::success();
   }
 
-  llvm::Error deserialize(const llvm::MemoryBuffer &Buffer) final {
+  llvm::Error deserializeImpl(const llvm::MemoryBuffer &Buffer) final {
 
     return llvm::Error::success();
   }
 
   /// Must reset the state of the container to the just built state
-  void clear() final {}
+  void clearImpl() final {}
 
 private:
   std::map<Target, int> Map;
   mutable std::map<Target, int> SavedData;
 
 private:
+  bool removeTarget(const Target &Target) {
+    if (Map.find(Target) == Map.end())
+      return false;
+
+    Map.erase(Target);
+    return true;
+  }
+
   void mergeBackImpl(MapContainer &&Container) override {
     Container.Map.merge(std::move(this->Map));
     this->Map = std::move(Container.Map);
+
+    std::lock_guard<std::mutex> Guard(MergedContainersLock);
+    MergedContainers.push_back(this->name());
   }
 };
 
@@ -230,6 +262,56 @@ BOOST_AUTO_TEST_CASE(ContainersCanBeCreated) {
   BOOST_TEST(cast<MapContainer>(Containers.at(CName)).get(ExampleTarget) == 1);
 }
 
+BOOST_AUTO_TEST_CASE(TargetsCanBeParsedInBulkWithGlobs) {
+  ContainerSet Containers;
+  auto Factory = getMapFactoryContainer();
+  Containers.add(CName, Factory, Factory(CName));
+  auto &Container = llvm::cast<MapContainer>(Containers[CName]);
+  for (const char *Name : { "fa", "fb", "ga" })
+    Container.get(Target({ Name }, FunctionKind)) = 1;
+
+  KindsRegistry Registry({ &RootKind, &FunctionKind });
+  ContainerToTargetsMap Parsed;
+  std::vector<std::string> ToParse = { CName + ":f*:FunctionKind",
+                                       CName + ":ha:FunctionKind",
+                                       CName + "::RootKind" };
+  auto Error = parseTargets(Parsed, ToParse, Registry, Containers);
+  BOOST_TEST(not Error);
+
+  // Globs only match what's in the container, plain targets are kept as is
+  const TargetsList &Targets = Parsed.at(CName);
+  BOOST_TEST(Targets.size() == 4U);
+  BOOST_TEST(Targets.contains(Target({ "fa" }, FunctionKind)));
+  BOOST_TEST(Targets.contains(Target({ "fb" }, FunctionKind)));
+  BOOST_TEST(Targets.contains(Target({ "ha" }, FunctionKind)));
+  BOOST_TEST(Targets.contains(Target(RootKind)));
+  BOOST_TEST(not Targets.contains(Target({ "ga" }, FunctionKind)));
+}
+
+static Rank NestedRank("Nested", FunctionRank);
+static Kind NestedKind("NestedKind", &NestedRank);
+
+BOOST_AUTO_TEST_CASE(TargetsGlobsCanBeMixedWithAll) {
+  ContainerSet Containers;
+  auto Factory = getMapFactoryContainer();
+  Containers.add(CName, Factory, Factory(CName));
+  auto &Container = llvm::cast<MapContainer>(Containers[CName]);
+  Container.get(Target({ "fa", "ba" }, NestedKind)) = 1;
+  Container.get(Target({ "fb", "bb" }, NestedKind)) = 1;
+  Container.get(Target({ "fa", "ca" }, NestedKind)) = 1;
+
+  KindsRegistry Registry({ &NestedKind });
+  ContainerToTargetsMap Parsed;
+  std::vector<std::string> ToParse = { CName + ":*/b*:NestedKind" };
+  auto Error = parseTargets(Parsed, ToParse, Registry, Containers);
+  BOOST_TEST(not Error);
+
+  const TargetsList &Targets = Parsed.at(CName);
+  BOOST_TEST(Targets.size() == 2U);
+  BOOST_TEST(Targets.contains(Target({ "fa", "ba" }, NestedKind)));
+  BOOST_TEST(Targets.contains(Target({ "fb", "bb" }, NestedKind)));
+}
+
 class TestPipe {
 
 public:
@@ -248,6 +330,17 @@ public:
   }
 };
 
+class SlowTestPipe : public TestPipe {
+public:
+  static constexpr auto Name = "SlowTestPipe";
+
+  void
+  run(const Context &Ctx, const MapContainer &Source, MapContainer &Target) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    TestPipe::run(Ctx, Source, Target);
+  }
+};
+
 BOOST_AUTO_TEST_CASE(PipeCanBeWrapper) {
   Context Ctx;
   MapContainer Map("RandomName");
@@ -276,6 +369,24 @@ BOOST_AUTO_TEST_CASE(InputOutputContractExactExactForward) {
   BOOST_TEST((Targets[CName][0].kindExactness() == KE::Exact));
 }
 
+BOOST_AUTO_TEST_CASE(InputOutputContractManyTargetsForward) {
+  ContainerToTargetsMap Targets;
+  for (size_t I = 0; I < 100; I++)
+    Targets[CName].emplace_back(Target({ "f" + std::to_string(I) },
+                                       FunctionKind));
+
+  ContractGroup Contract1(FunctionKind,
+                          KE::Exact,
+                          0,
+                          FunctionKind,
+                          1,
+                          InputPreservation::Preserve);
+  Contract1.deduceResults(Targets, { CName, "second" });
+  BOOST_TEST(Targets[CName].size() == 100);
+  BOOST_TEST(Targets["second"].size() == 100);
+  BOOST_TEST(Targets["second"].contains(Target({ "f42" }, FunctionKind)));
+}
+
 BOOST_AUTO_TEST_CASE(InputOutputContractMultiLine) {
   ContainerToTargetsMap Targets;
   Targets["third"].emplace_back(Target({}, RootKind));
@@ -526,6 +637,183 @@ BOOST_AUTO_TEST_CASE(SingleElementPipelineCanBeRunned) {
   BOOST_TEST(cast<MapContainer>(BC.at(CName)).get(Target(RootKind2)) == 1);
 }
 
+/// A container of root targets that, unlike MapContainer, is actually written
+/// to disk, so that it can be shipped to remote workers
+class ShippableContainer : public Container<ShippableContainer> {
+public:
+  std::map<Target, int> Map;
+
+public:
+  ShippableContainer(llvm::StringRef Name) :
+    Container<ShippableContainer>(Name) {}
+
+  unique_ptr<ContainerBase>
+  cloneFiltered(const TargetsList &Targets) const final {
+    auto Result = make_unique<ShippableContainer>(this->name());
+    Result->Map = Map;
+    return Result;
+  }
+
+  TargetsList enumerate() const final {
+    TargetsList ToReturn;
+    for (const auto &Target : Map)
+      ToReturn.push_back(Target.first);
+    return ToReturn;
+  }
+
+  llvm::Error serialize(llvm::raw_ostream &OS) const final {
+    for (const auto &[Target, Value] : Map)
+      OS << Target.getKind().name() << " " << Value << "\n";
+    return llvm::Error::success();
+  }
+
+  static char ID;
+
+protected:
+  bool removeImpl(const TargetsList &Targets) final {
+    for (const auto &Target : Targets)
+      Map.erase(Target);
+    return true;
+  }
+
+  llvm::Error deserializeImpl(const llvm::MemoryBuffer &Buffer) final {
+    Map.clear();
+    llvm::SmallVector<llvm::StringRef, 4> Lines;
+    Buffer.getBuffer().split(Lines, '\n', -1, false);
+    for (llvm::StringRef Line : Lines) {
+      auto [KindName, Value] = Line.split(' ');
+      for (Kind *K : { &static_cast<Kind &>(RootKind), &RootKind2 })
+        if (K->name() == KindName)
+          Value.getAsInteger(10, Map[Target(*K)]);
+    }
+    return llvm::Error::success();
+  }
+
+  void clearImpl() final { Map.clear(); }
+
+private:
+  void mergeBackImpl(ShippableContainer &&Container) override {
+    Container.Map.merge(std::move(this->Map));
+    this->Map = std::move(Container.Map);
+  }
+};
+
+char ShippableContainer::ID;
+
+class ShippablePipe {
+public:
+  static constexpr auto Name = "ShippablePipe";
+
+  std::vector<ContractGroup> getContract() const {
+    return { ContractGroup(RootKind, KE::Exact, 0, RootKind2, 0) };
+  }
+
+  void run(const Context &,
+           const ShippableContainer &Source,
+           ShippableContainer &Target) {
+    for (const auto &Element : Source.Map)
+      if (&Element.first.getKind() == &RootKind)
+        Target.Map[pipeline::Target(RootKind2)] = Element.second;
+  }
+};
+
+static void addRemotelyRunnableSteps(Runner &Pip) {
+  // Container sets refer to the factory, which must outlive them
+  static const auto Factory = ContainerFactory([](llvm::StringRef Name) {
+    return make_unique<ShippableContainer>(Name);
+  });
+  ContainerSet Content;
+  Content.add(CName, Factory);
+  Content.getOrCreate<ShippableContainer>(CName).Map[Target(RootKind)] = 1;
+  Pip.addStep(Step("first_step", move(Content)));
+
+  ContainerSet Containers2;
+  Containers2.add(CName, Factory);
+  Pip.addStep(Step("End",
+                   move(Containers2),
+                   Pip["first_step"],
+                   bindPipe<ShippablePipe>(CName, CName)));
+}
+
+/// Serves requests in process, on a distinct Runner, or always fails if there
+/// is none
+class LoopbackWorker final : public RemoteWorker {
+public:
+  Runner *Served = nullptr;
+  unsigned Executions = 0;
+
+public:
+  llvm::StringRef getName() const override { return "loopback"; }
+
+  llvm::Error execute(llvm::StringRef RequestDirectory) override {
+    ++Executions;
+    if (Served == nullptr)
+      return createStringError(inconvertibleErrorCode(), "unreachable");
+    return serveRemoteRequest(*Served, RequestDirectory);
+  }
+};
+
+BOOST_AUTO_TEST_CASE(StepsCanBeRunByRemoteWorkers) {
+  llvm::SmallString<128> Directory;
+  BOOST_TEST(!llvm::sys::fs::createUniqueDirectory("revng-pipeline-test",
+                                                   Directory));
+
+  Context WorkerCtx;
+  Runner WorkerPip(WorkerCtx);
+  addRemotelyRunnableSteps(WorkerPip);
+
+  ContainerToTargetsMap Targets;
+  Targets[CName].emplace_back(Target(RootKind2));
+
+  // The first worker fails, the request is retried on the second one
+  {
+    Context Ctx;
+    Runner Pip(Ctx);
+    addRemotelyRunnableSteps(Pip);
+
+    RemoteScheduler Scheduler(Directory);
+    auto Failing = make_unique<LoopbackWorker>();
+    auto Working = make_unique<LoopbackWorker>();
+    Working->Served = &WorkerPip;
+    LoopbackWorker &FailingRef = *Failing;
+    LoopbackWorker &WorkingRef = *Working;
+    Scheduler.addWorker(std::move(Failing));
+    Scheduler.addWorker(std::move(Working));
+    Pip.setRemoteScheduler(&Scheduler);
+
+    BOOST_TEST(!Pip.run("End", Targets));
+    const auto &Result = Pip["End"].containers().get<ShippableContainer>(CName);
+    BOOST_TEST(Result.Map.at(Target(RootKind2)) == 1);
+    BOOST_TEST(FailingRef.Executions == 1U);
+    BOOST_TEST(WorkingRef.Executions == 1U);
+    BOOST_TEST(Scheduler.dispatchedCount() == 2U);
+    BOOST_TEST(Scheduler.failedCount() == 1U);
+  }
+
+  // When all the attempts fail, the step is run locally
+  {
+    Context Ctx;
+    Runner Pip(Ctx);
+    addRemotelyRunnableSteps(Pip);
+
+    RemoteScheduler Scheduler(Directory);
+    Scheduler.addWorker(make_unique<LoopbackWorker>());
+    Pip.setRemoteScheduler(&Scheduler);
+
+    BOOST_TEST(!Pip.run("End", Targets));
+    const auto &Result = Pip["End"].containers().get<ShippableContainer>(CName);
+    BOOST_TEST(Result.Map.at(Target(RootKind2)) == 1);
+    BOOST_TEST(Scheduler.failedCount() == 3U);
+  }
+
+  // Requests do not outlive their execution
+  std::error_code EC;
+  BOOST_TEST((llvm::sys::fs::directory_iterator(Directory, EC)
+              == llvm::sys::fs::directory_iterator()));
+
+  llvm::sys::fs::remove_directories(Directory);
+}
+
 class FineGranerPipe {
 
 public:
@@ -570,6 +858,230 @@ public:
   }
 };
 
+BOOST_AUTO_TEST_CASE(RequestsCanBeStreamed) {
+  for (unsigned Threads : { 1, 4 }) {
+    TaskScheduler::setGlobalThreadsCount(Threads);
+
+    Context Ctx;
+    Runner Pipeline(Ctx);
+    auto CName2 = CName + "2";
+    Pipeline.addDefaultConstructibleFactory<MapContainer>(CName);
+    Pipeline.addDefaultConstructibleFactory<MapContainer>(CName2);
+    Pipeline.setStreamingBatchSize(1);
+
+    const std::string Name = "first_step";
+    const std::string SecondName = "second_step";
+    Pipeline.emplaceStep("", Name);
+    Pipeline.emplaceStep(Name,
+                         SecondName,
+                         bindPipe<FineGranerPipe>(CName, CName));
+    Pipeline.emplaceStep(SecondName,
+                         "End",
+                         bindPipe<CopyPipe>(CName, CName2));
+
+    auto &C1 = Pipeline[Name].containers().getOrCreate<MapContainer>(CName);
+    C1.get(Target({}, RootKind)) = 1;
+
+    Profiler Prof;
+    Pipeline.setProfiler(&Prof);
+
+    const auto F1 = Target({ PathComponent("f1") }, FunctionKind);
+    const auto F2 = Target({ PathComponent("f2") }, FunctionKind);
+    ContainerToTargetsMap Map;
+    Map[CName2].emplace_back(F1);
+    Map[CName2].emplace_back(F2);
+    cantFail(Pipeline.run("End", Map));
+
+    auto &End = Pipeline["End"].containers();
+    auto &C2End = End.getOrCreate<MapContainer>(CName2);
+    BOOST_TEST(C2End.get(F1) == 1);
+    BOOST_TEST(C2End.get(F2) == 1);
+
+    // The second batch finds the functions already produced by the first one
+    const auto IsFineGraner = [](const PipeExecutionRecord &Invocation) {
+      return Invocation.Pipe == FineGranerPipe::Name;
+    };
+    BOOST_TEST(llvm::count_if(Prof.invocations(), IsFineGraner) == 1);
+  }
+
+  TaskScheduler::setGlobalThreadsCount(TaskScheduler::defaultThreadsCount());
+}
+
+/// A container that pretends to use a llvm::LLVMContext shared with the other
+/// containers. Unlike MapContainer, clones only hold the requested targets.
+class SharedContextContainer : public Container<SharedContextContainer> {
+public:
+  static char ID;
+  std::map<Target, int> Map;
+
+public:
+  SharedContextContainer(llvm::StringRef Name) :
+    Container<SharedContextContainer>(Name) {}
+
+public:
+  unique_ptr<ContainerBase>
+  cloneFiltered(const TargetsList &Targets) const final {
+    auto Result = make_unique<SharedContextContainer>(this->name());
+    for (const auto &[Key, Value] : Map)
+      if (Targets.contains(Key))
+        Result->Map[Key] = Value;
+    return Result;
+  }
+
+  TargetsList enumerate() const final {
+    TargetsList Result;
+    for (const auto &Entry : Map)
+      Result.push_back(Entry.first);
+    return Result;
+  }
+
+  bool sharesLLVMContext() const final { return true; }
+
+  llvm::Error serialize(llvm::raw_ostream &OS) const final {
+    return llvm::Error::success();
+  }
+
+protected:
+  bool removeImpl(const TargetsList &Targets) final {
+    bool Removed = false;
+    for (const auto &Target : Targets)
+      Removed = Map.erase(Target) != 0 or Removed;
+    return Removed;
+  }
+
+  llvm::Error deserializeImpl(const llvm::MemoryBuffer &Buffer) final {
+    return llvm::Error::success();
+  }
+
+  void clearImpl() final { Map.clear(); }
+
+  void mergeBackImpl(SharedContextContainer &&Other) final {
+    Other.Map.merge(std::move(Map));
+    Map = std::move(Other.Map);
+  }
+};
+
+char SharedContextContainer::ID;
+
+static std::atomic<unsigned> RunningPipes = 0;
+static std::atomic<unsigned> MaxRunningPipes = 0;
+
+/// Copies the functions, recording how many of its instances run at once
+class TrackedCopyPipe {
+
+public:
+  static constexpr auto Name = "TrackedCopyPipe";
+  std::vector<ContractGroup> getContract() const {
+    return CopyPipe().getContract();
+  }
+
+  void run(Context &,
+           const SharedContextContainer &Source,
+           SharedContextContainer &Target) {
+    unsigned Running = ++RunningPipes;
+    unsigned Max = MaxRunningPipes;
+    while (Running > Max
+           and not MaxRunningPipes.compare_exchange_weak(Max, Running))
+      ;
+
+    // Give the other batches the chance to run at the same time
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    for (const auto &[Key, Value] : Source.Map)
+      Target.Map[Key] = Value;
+    Target.markModified();
+    --RunningPipes;
+  }
+};
+
+BOOST_AUTO_TEST_CASE(StreamedPipesDoNotShareTheLLVMContext) {
+  TaskScheduler::setGlobalThreadsCount(4);
+
+  Context Ctx;
+  Runner Pipeline(Ctx);
+  auto CName2 = CName + "2";
+  auto CName3 = CName + "3";
+  Pipeline.addDefaultConstructibleFactory<SharedContextContainer>(CName);
+  Pipeline.addDefaultConstructibleFactory<SharedContextContainer>(CName2);
+  Pipeline.addDefaultConstructibleFactory<SharedContextContainer>(CName3);
+  Pipeline.setStreamingBatchSize(1);
+
+  Pipeline.emplaceStep("", "first_step");
+  Pipeline.emplaceStep("first_step",
+                       "tracked",
+                       bindPipe<TrackedCopyPipe>(CName, CName2));
+  Pipeline.emplaceStep("tracked",
+                       "End",
+                       bindPipe<TrackedCopyPipe>(CName2, CName3));
+
+  const auto F1 = Target({ PathComponent("f1") }, FunctionKind);
+  const auto F2 = Target({ PathComponent("f2") }, FunctionKind);
+  auto &First = Pipeline["first_step"].containers();
+  auto &Functions = First.getOrCreate<SharedContextContainer>(CName);
+  Functions.Map[F1] = 1;
+  Functions.Map[F2] = 2;
+  ContainerToTargetsMap Map;
+  Map[CName3].emplace_back(F1);
+  Map[CName3].emplace_back(F2);
+
+  // If they did not share the context, the first batch could copy to the
+  // last container while the second one copies to the previous one
+  RunningPipes = 0;
+  MaxRunningPipes = 0;
+  cantFail(Pipeline.run("End", Map));
+  BOOST_TEST(MaxRunningPipes == 1U);
+
+  auto &End = Pipeline["End"].containers();
+  auto &Result = End.getOrCreate<SharedContextContainer>(CName3);
+  BOOST_TEST(Result.Map.at(F1) == 1);
+  BOOST_TEST(Result.Map.at(F2) == 2);
+
+  TaskScheduler::setGlobalThreadsCount(TaskScheduler::defaultThreadsCount());
+}
+
+BOOST_AUTO_TEST_CASE(PartitionsDoNotShareTheLLVMContext) {
+  TaskScheduler::setGlobalThreadsCount(4);
+
+  Context Ctx;
+  Runner Pipeline(Ctx);
+  auto CName2 = CName + "2";
+  auto OtherName = CName + "Other";
+  auto OtherName2 = CName + "Other2";
+  for (const auto &Name : { CName, CName2, OtherName, OtherName2 })
+    Pipeline.addDefaultConstructibleFactory<SharedContextContainer>(Name);
+  Pipeline.setJobs(2);
+
+  Pipeline.emplaceStep("", "first_step");
+  Pipeline.emplaceStep("first_step",
+                       "End",
+                       bindPipe<TrackedCopyPipe>(CName, CName2),
+                       bindPipe<TrackedCopyPipe>(OtherName, OtherName2));
+
+  const auto F1 = Target({ PathComponent("f1") }, FunctionKind);
+  auto &First = Pipeline["first_step"].containers();
+  First.getOrCreate<SharedContextContainer>(CName).Map[F1] = 1;
+  First.getOrCreate<SharedContextContainer>(OtherName).Map[F1] = 2;
+  ContainerToTargetsMap Map;
+  Map[CName2].emplace_back(F1);
+  Map[OtherName2].emplace_back(F1);
+
+  // The two pipes operate on disjoint containers, hence the request is split
+  // in two partitions, which must not run at the same time
+  std::string Log;
+  llvm::raw_string_ostream OS(Log);
+  RunningPipes = 0;
+  MaxRunningPipes = 0;
+  cantFail(Pipeline.run("End", Map, &OS));
+  BOOST_TEST(StringRef(OS.str()).count("Starting Step: End") == 2);
+  BOOST_TEST(MaxRunningPipes == 1U);
+
+  auto &End = Pipeline["End"].containers();
+  BOOST_TEST(End.getOrCreate<SharedContextContainer>(CName2).Map.at(F1) == 1);
+  auto &Other = End.getOrCreate<SharedContextContainer>(OtherName2);
+  BOOST_TEST(Other.Map.at(F1) == 2);
+
+  TaskScheduler::setGlobalThreadsCount(TaskScheduler::defaultThreadsCount());
+}
+
 BOOST_AUTO_TEST_CASE(SingleElementPipelineBackwardFinedGrained) {
   Context Ctx;
   Runner Pipeline(Ctx);
@@ -594,6 +1106,242 @@ BOOST_AUTO_TEST_CASE(SingleElementPipelineBackwardFinedGrained) {
   BOOST_TEST(Val == 1);
 }
 
+BOOST_AUTO_TEST_CASE(IndependentTargetsCanBeRunInParallel) {
+  Context Ctx;
+  Runner Pipeline(Ctx);
+  const std::string CName2 = "ContainerName2";
+  Pipeline.addDefaultConstructibleFactory<MapContainer>(CName);
+  Pipeline.addDefaultConstructibleFactory<MapContainer>(CName2);
+  Pipeline.setJobs(2);
+
+  const std::string Name = "first_step";
+  Pipeline.emplaceStep("", Name);
+  Pipeline.emplaceStep(Name,
+                       "End",
+                       bindPipe<TestPipe>(CName, CName),
+                       bindPipe<TestPipe>(CName2, CName2));
+
+  auto &Containers = Pipeline[Name].containers();
+  Containers.getOrCreate<MapContainer>(CName).get(Target(RootKind)) = 1;
+  Containers.getOrCreate<MapContainer>(CName2).get(Target(RootKind)) = 2;
+
+  ContainerToTargetsMap Targets;
+  Targets[CName].emplace_back(Target(RootKind2));
+  Targets[CName2].emplace_back(Target(RootKind2));
+
+  std::string Log;
+  llvm::raw_string_ostream OS(Log);
+  auto Error = Pipeline.run("End", Targets, &OS);
+  BOOST_TEST(!Error);
+
+  const auto &End = Pipeline["End"].containers();
+  BOOST_TEST(End.get<MapContainer>(CName).get(Target(RootKind2)) == 1);
+  BOOST_TEST(End.get<MapContainer>(CName2).get(Target(RootKind2)) == 2);
+  BOOST_TEST(StringRef(OS.str()).count("Starting Step: End") == 2);
+}
+
+BOOST_AUTO_TEST_CASE(PartsAreMergedInADeterministicOrder) {
+  for (unsigned Threads : { 1, 4 }) {
+    TaskScheduler::setGlobalThreadsCount(Threads);
+
+    Context Ctx;
+    Runner Pipeline(Ctx);
+    const std::string CName2 = "ContainerName2";
+    Pipeline.addDefaultConstructibleFactory<MapContainer>(CName);
+    Pipeline.addDefaultConstructibleFactory<MapContainer>(CName2);
+    Pipeline.setJobs(2);
+
+    // The first part is the slowest one, it must still be merged first
+    const std::string Name = "first_step";
+    Pipeline.emplaceStep("", Name);
+    Pipeline.emplaceStep(Name,
+                         "End",
+                         bindPipe<SlowTestPipe>(CName, CName),
+                         bindPipe<TestPipe>(CName2, CName2));
+
+    auto &Containers = Pipeline[Name].containers();
+    Containers.getOrCreate<MapContainer>(CName).get(Target(RootKind)) = 1;
+    Containers.getOrCreate<MapContainer>(CName2).get(Target(RootKind)) = 2;
+
+    // Merging in an empty container just moves it
+    auto &EndContainers = Pipeline["End"].containers();
+    EndContainers.getOrCreate<MapContainer>(CName);
+    EndContainers.getOrCreate<MapContainer>(CName2);
+
+    ContainerToTargetsMap Targets;
+    Targets[CName].emplace_back(Target(RootKind2));
+    Targets[CName2].emplace_back(Target(RootKind2));
+
+    MergedContainers.clear();
+    auto Error = Pipeline.run("End", Targets);
+    BOOST_TEST(!Error);
+
+    std::vector<std::string> Expected = { CName, CName2 };
+    BOOST_TEST(MergedContainers == Expected);
+  }
+
+  TaskScheduler::setGlobalThreadsCount(TaskScheduler::defaultThreadsCount());
+}
+
+BOOST_AUTO_TEST_CASE(PipeInvocationsCanBeProfiled) {
+  Context Ctx;
+  Runner Pipeline(Ctx);
+  Pipeline.addDefaultConstructibleFactory<MapContainer>(CName);
+
+  const std::string Name = "first_step";
+  Pipeline.emplaceStep("", Name);
+  Pipeline.emplaceStep(Name, "End", bindPipe<FineGranerPipe>(CName, CName));
+
+  auto &C1 = Pipeline[Name].containers().getOrCreate<MapContainer>(CName);
+  C1.get(Target({}, RootKind)) = 1;
+
+  Profiler Prof;
+  Pipeline.setProfiler(&Prof);
+
+  ContainerToTargetsMap Targets;
+  Targets.add(CName, Target({ PathComponent("f1") }, FunctionKind));
+  cantFail(Pipeline.run("End", Targets));
+
+  auto Invocations = Prof.invocations();
+  BOOST_TEST(Invocations.size() == 1);
+  BOOST_TEST(Invocations[0].Step == "End");
+  BOOST_TEST(Invocations[0].Pipe == FineGranerPipe::Name);
+  BOOST_TEST(Invocations[0].InputTargets == 1);
+  BOOST_TEST(Invocations[0].OutputTargets >= 1);
+
+  std::string Trace;
+  llvm::raw_string_ostream OS(Trace);
+  Prof.writeChromeTrace(OS);
+  auto Parsed = llvm::json::parse(OS.str());
+  BOOST_TEST(static_cast<bool>(Parsed));
+  if (not Parsed)
+    llvm::consumeError(Parsed.takeError());
+}
+
+BOOST_AUTO_TEST_CASE(AvailableTargetsAreNotProducedAgain) {
+  Context Ctx;
+  Runner Pipeline(Ctx);
+  Pipeline.addDefaultConstructibleFactory<MapContainer>(CName);
+
+  const std::string Name = "first_step";
+  Pipeline.emplaceStep("", Name);
+  Pipeline.emplaceStep(Name, "End", bindPipe<FineGranerPipe>(CName, CName));
+
+  auto &C1 = Pipeline[Name].containers().getOrCreate<MapContainer>(CName);
+  C1.get(Target({}, RootKind)) = 1;
+
+  ContainerToTargetsMap Targets;
+  Targets.add(CName, Target({ PathComponent("f1") }, FunctionKind));
+  cantFail(Pipeline.run("End", Targets));
+
+  // Deductions are memoized, asking twice must give the same answer
+  const Step &End = Pipeline["End"];
+  ContainerToTargetsMap Input;
+  Input.add(CName, Target({}, RootKind));
+  auto First = End.deduceResults(Input);
+  auto Second = End.deduceResults(Input);
+  BOOST_TEST(First[CName].size() == Second[CName].size());
+  BOOST_TEST(First[CName].contains(Target({ PathComponent("f1") },
+                                          FunctionKind)));
+
+  size_t Steps = 0;
+  Pipeline.setProgressHook([&](StringRef, size_t, size_t) {
+    ++Steps;
+    return true;
+  });
+  cantFail(Pipeline.run("End", Targets));
+  BOOST_TEST(Steps == 0U);
+}
+
+BOOST_AUTO_TEST_CASE(RunsCanBeDescribedAsJSONLines) {
+  Context Ctx;
+  Runner Pipeline(Ctx);
+  Pipeline.addDefaultConstructibleFactory<MapContainer>(CName);
+
+  const std::string Name = "first_step";
+  Pipeline.emplaceStep("", Name);
+  Pipeline.emplaceStep(Name, "End", bindPipe<FineGranerPipe>(CName, CName));
+
+  auto &C1 = Pipeline[Name].containers().getOrCreate<MapContainer>(CName);
+  C1.get(Target({}, RootKind)) = 1;
+
+  std::string Buffer;
+  llvm::raw_string_ostream OS(Buffer);
+  RunEventLog Events(OS);
+  Pipeline.setEventLog(&Events);
+
+  ContainerToTargetsMap Targets;
+  Targets.add(CName, Target({ PathComponent("f1") }, FunctionKind));
+  cantFail(Pipeline.run("End", Targets));
+  cantFail(Pipeline.run("End", Targets));
+  Pipeline.setEventLog(nullptr);
+
+  llvm::SmallVector<llvm::StringRef, 4> Lines;
+  llvm::StringRef(OS.str()).trim().split(Lines, "\n");
+  BOOST_TEST(Lines.size() == 3U);
+
+  std::vector<llvm::json::Value> Parsed;
+  for (llvm::StringRef Line : Lines) {
+    auto MaybeValue = llvm::json::parse(Line);
+    BOOST_TEST(static_cast<bool>(MaybeValue));
+    if (not MaybeValue) {
+      llvm::consumeError(MaybeValue.takeError());
+      return;
+    }
+    Parsed.push_back(std::move(*MaybeValue));
+  }
+
+  // The first request executes End, the second one finds f1 already there
+  const auto *Step = Parsed[0].getAsObject();
+  BOOST_TEST((Step->getString("event").getValueOr("") == "step"));
+  BOOST_TEST((Step->getString("step").getValueOr("") == "End"));
+  BOOST_TEST(Step->getObject("produced")->getArray(CName)->size() >= 1U);
+
+  const auto *First = Parsed[1].getAsObject();
+  BOOST_TEST((First->getString("event").getValueOr("") == "request"));
+  BOOST_TEST((First->getInteger("available_count").getValueOr(-1) == 0));
+
+  const auto *Second = Parsed[2].getAsObject();
+  BOOST_TEST((Second->getString("event").getValueOr("") == "request"));
+  BOOST_TEST((Second->getInteger("available_count").getValueOr(-1) == 1));
+}
+
+BOOST_AUTO_TEST_CASE(RunsReportProgressAndCanBeCancelled) {
+  Context Ctx;
+  Runner Pipeline(Ctx);
+  Pipeline.addDefaultConstructibleFactory<MapContainer>(CName);
+
+  const std::string Name = "first_step";
+  Pipeline.emplaceStep("", Name);
+  Pipeline.emplaceStep(Name, "End", bindPipe<FineGranerPipe>(CName, CName));
+
+  auto &C1 = Pipeline[Name].containers().getOrCreate<MapContainer>(CName);
+  C1.get(Target({}, RootKind)) = 1;
+
+  ContainerToTargetsMap Targets;
+  Targets.add(CName, Target({ PathComponent("f1") }, FunctionKind));
+
+  std::vector<std::string> Reported;
+  Pipeline.setProgressHook([&](StringRef StepName, size_t Index, size_t Count) {
+    BOOST_TEST(Index < Count);
+    Reported.push_back(StepName.str());
+    return false;
+  });
+
+  auto Error = Pipeline.run("End", Targets);
+  BOOST_TEST(Error.isA<CancelledRunError>());
+  llvm::consumeError(std::move(Error));
+  BOOST_TEST(Reported == std::vector<std::string>{ "End" });
+
+  const auto &End = Pipeline["End"].containers();
+  BOOST_TEST(not End.contains(CName));
+
+  Pipeline.setProgressHook({});
+  cantFail(Pipeline.run("End", Targets));
+  BOOST_TEST(End.get<MapContainer>(CName).get(Target({ "f1" }, FunctionKind))
+             == 1);
+}
+
 BOOST_AUTO_TEST_CASE(DifferentNamesAreNotCompatible) {
   Target Target1({ "f1Wrong" }, FunctionKind);
   Target Target2({ "f1" }, FunctionKind);
@@ -691,35 +1439,340 @@ struct LLVMPassFunctionIdentity {
   }
 };
 
-BOOST_AUTO_TEST_CASE(SingleElementLLVMPipelineBackwardFinedGrained) {
-  llvm::LLVMContext C;
+BOOST_AUTO_TEST_CASE(SingleElementLLVMPipelineBackwardFinedGrained) {
+  llvm::LLVMContext C;
+
+  Context Ctx;
+  Runner Pipeline(Ctx);
+  Pipeline.addContainerFactory(CName, makeDefaultLLVMContainerFactory(Ctx, C));
+
+  const std::string Name = "first_step";
+  Pipeline.emplaceStep("", Name);
+  Pipeline
+    .emplaceStep(Name,
+                 "End",
+                 LLVMContainer::wrapLLVMPasses(CName,
+                                               LLVMPassFunctionCreator(),
+                                               LLVMPassFunctionIdentity()));
+
+  auto &C1(Pipeline[Name].containers().getOrCreate<LLVMContainer>(CName));
+  makeF(C1.getModule(), "root");
+
+  ContainerToTargetsMap Targets;
+  Targets.add(CName, Target({ PathComponent("f1") }, FunctionKind));
+
+  auto Error = Pipeline.run("End", Targets);
+  BOOST_TEST(!Error);
+
+  const auto &Final = Pipeline["End"].containers().get<LLVMContainer>(CName);
+  const auto *F = Final.getModule().getFunction("f1");
+
+  BOOST_TEST(F != nullptr);
+}
+
+static size_t StalePassRuns = 0;
+
+/// A pass that is not meant to run more than once
+struct RunOncePass : public llvm::ModulePass {
+  static char ID;
+  bool Ran = false;
+
+  RunOncePass() : llvm::ModulePass(ID) {}
+
+  bool runOnModule(llvm::Module &M) override {
+    if (Ran)
+      ++StalePassRuns;
+    Ran = true;
+    return false;
+  }
+};
+char RunOncePass::ID = '_';
+
+struct LLVMPassRunOnce {
+  static constexpr auto Name = "Run Once";
+
+  std::vector<ContractGroup> getContract() const {
+    return { ContractGroup(RootKind, KE::Exact) };
+  }
+
+  void registerPasses(llvm::legacy::PassManager &Manager) {
+    Manager.add(new RunOncePass());
+  }
+};
+
+BOOST_AUTO_TEST_CASE(LLVMContainersShareTheContext) {
+  llvm::LLVMContext C;
+  Context Ctx;
+
+  auto Factory = makeDefaultLLVMContainerFactory(Ctx, C);
+  BOOST_TEST(Factory(CName)->sharesLLVMContext());
+  BOOST_TEST(not MapContainer(CName).sharesLLVMContext());
+}
+
+BOOST_AUTO_TEST_CASE(LLVMPipesRunFreshPasses) {
+  llvm::LLVMContext C;
+  Context Ctx;
+
+  auto Factory = makeDefaultLLVMContainerFactory(Ctx, C);
+  auto Container = Factory(CName);
+  auto &Module = cast<LLVMContainer>(*Container);
+  makeF(Module.getModule(), "root");
+
+  StalePassRuns = 0;
+  GenericLLVMPipe<LLVMContainer> Pipe(LLVMPassRunOnce{});
+  Pipe.run(Ctx, Module);
+  Pipe.run(Ctx, Module);
+  BOOST_TEST(StalePassRuns == 0U);
+}
+
+static size_t CountingFunctionCreatorRuns = 0;
+
+struct CountingFunctionCreator {
+  static constexpr auto Name = "Counting Function Creator";
+
+  std::vector<ContractGroup> getContract() const {
+    return { ContractGroup(RootKind, KE::Exact, 0, FunctionKind) };
+  }
+
+  void registerPasses(llvm::legacy::PassManager &Manager) {
+    ++CountingFunctionCreatorRuns;
+    Manager.add(new FunctionInserterPass());
+  }
+};
+
+static bool runWithCache(llvm::StringRef CacheDirectory) {
+  llvm::LLVMContext C;
+
+  Context Ctx;
+  Runner Pipeline(Ctx);
+  Pipeline.addContainerFactory(CName, makeDefaultLLVMContainerFactory(Ctx, C));
+  Pipeline.setCacheDirectory(CacheDirectory);
+
+  const std::string Name = "first_step";
+  Pipeline.emplaceStep("", Name);
+  auto Pipe = LLVMContainer::wrapLLVMPasses(CName, CountingFunctionCreator());
+  Pipeline.emplaceStep(Name, "End", std::move(Pipe));
+
+  auto &C1(Pipeline[Name].containers().getOrCreate<LLVMContainer>(CName));
+  makeF(C1.getModule(), "root");
+
+  ContainerToTargetsMap Targets;
+  Targets.add(CName, Target({ PathComponent("f1") }, FunctionKind));
+
+  auto Error = Pipeline.run("End", Targets);
+  BOOST_TEST(!Error);
+
+  const auto &Final = Pipeline["End"].containers().get<LLVMContainer>(CName);
+  return Final.getModule().getFunction("f1") != nullptr;
+}
+
+BOOST_AUTO_TEST_CASE(StepOutputsAreCached) {
+  llvm::SmallString<128> CacheDirectory;
+  auto ErrorCode = llvm::sys::fs::createUniqueDirectory("revng-cache",
+                                                        CacheDirectory);
+  BOOST_TEST(not ErrorCode);
+
+  CountingFunctionCreatorRuns = 0;
+  BOOST_TEST(runWithCache(CacheDirectory));
+  BOOST_TEST(CountingFunctionCreatorRuns == 1);
+
+  // The second run finds the same input, hence it must not run the pipe
+  BOOST_TEST(runWithCache(CacheDirectory));
+  BOOST_TEST(CountingFunctionCreatorRuns == 1);
+
+  llvm::sys::fs::remove_directories(CacheDirectory);
+}
+
+BOOST_AUTO_TEST_CASE(ContentIDsAreDroppedOnChanges) {
+  MapContainer Container(CName);
+  BOOST_TEST(not Container.contentID().has_value());
+
+  Container.setContentID("id");
+  BOOST_TEST((*Container.contentID() == "id"));
+
+  Container.get(ExampleTarget) = 1;
+  BOOST_TEST(not Container.contentID().has_value());
+}
+
+BOOST_AUTO_TEST_CASE(ClonesInheritContentIDs) {
+  ContainerSet Containers;
+  auto Factory = getMapFactoryContainer();
+  Containers.add(CName, Factory, Factory(CName));
+  auto &Container = llvm::cast<MapContainer>(Containers[CName]);
+  Container.get(ExampleTarget) = 1;
+
+  ContainerToTargetsMap All;
+  All.add(CName, ExampleTarget);
+  ContainerToTargetsMap None;
+
+  // Nothing is known about a container without ID, and about its clones
+  BOOST_TEST(not Containers.cloneFiltered(All).at(CName).contentID());
+
+  // Clones are given an ID depending on the original and on their targets
+  Container.setContentID("id");
+  auto First = Containers.cloneFiltered(All).at(CName).contentID()->str();
+  auto Second = Containers.cloneFiltered(All).at(CName).contentID()->str();
+  auto Empty = Containers.cloneFiltered(None).at(CName).contentID()->str();
+  BOOST_TEST(First == Second);
+  BOOST_TEST(First != Empty);
+  BOOST_TEST(First != "id");
+}
+
+BOOST_AUTO_TEST_CASE(CacheKeysUseContentIDs) {
+  Context Ctx;
+  Runner Pipeline(Ctx);
+  Pipeline.addDefaultConstructibleFactory<MapContainer>(CName);
+  Pipeline.emplaceStep("", "first_step");
+  Step &First = Pipeline["first_step"];
+  First.containers().getOrCreate<MapContainer>(CName);
+
+  ContainerToTargetsMap Everything;
+  const auto KeyOf = [&](llvm::StringRef ID) {
+    ContainerSet Input = First.cloneFiltered(Everything);
+    if (not ID.empty())
+      Input.at(CName).setContentID(ID);
+    return cantFail(ArtifactCache::computeKey(Ctx, First, Input));
+  };
+
+  // MapContainer serializes to nothing, the key only changes due to the IDs
+  BOOST_TEST(KeyOf("") == KeyOf(""));
+  BOOST_TEST(KeyOf("a") == KeyOf("a"));
+  BOOST_TEST(KeyOf("a") != KeyOf("b"));
+  BOOST_TEST(KeyOf("a") != KeyOf(""));
+}
+
+BOOST_AUTO_TEST_CASE(CachedContainersAreGivenContentIDs) {
+  llvm::SmallString<128> CacheDirectory;
+  auto ErrorCode = llvm::sys::fs::createUniqueDirectory("revng-cache",
+                                                        CacheDirectory);
+  BOOST_TEST(not ErrorCode);
+
+  Context Ctx;
+  ArtifactCache Cache(CacheDirectory);
+  ContainerSet Output;
+  auto Factory = getMapFactoryContainer();
+  Output.add(CName, Factory, Factory(CName));
+  cast<MapContainer>(Output[CName]).get(ExampleTarget) = 1;
+
+  BOOST_TEST(!Cache.store("key", Ctx, Output));
+  auto StoredID = Output.at(CName).contentID();
+  BOOST_TEST(StoredID.has_value());
+
+  ContainerSet Loaded;
+  Loaded.add(CName, Factory, Factory(CName));
+  BOOST_TEST(cantFail(Cache.load("key", Ctx, Loaded)));
+  BOOST_TEST((Loaded.at(CName).contentID() == StoredID));
+
+  llvm::sys::fs::remove_directories(CacheDirectory);
+}
 
+BOOST_AUTO_TEST_CASE(LLVMContainersCanBeLoadedLazily) {
+  llvm::LLVMContext C;
   Context Ctx;
-  Runner Pipeline(Ctx);
-  Pipeline.addContainerFactory(CName, makeDefaultLLVMContainerFactory(Ctx, C));
+  auto Factory = makeDefaultLLVMContainerFactory(Ctx, C);
 
-  const std::string Name = "first_step";
-  Pipeline.emplaceStep("", Name);
-  Pipeline
-    .emplaceStep(Name,
-                 "End",
-                 LLVMContainer::wrapLLVMPasses(CName,
-                                               LLVMPassFunctionCreator(),
-                                               LLVMPassFunctionIdentity()));
+  llvm::SmallString<128> Path;
+  auto ErrorCode = llvm::sys::fs::createTemporaryFile("revng-lazy", "ll", Path);
+  BOOST_TEST(not ErrorCode);
 
-  auto &C1(Pipeline[Name].containers().getOrCreate<LLVMContainer>(CName));
-  makeF(C1.getModule(), "root");
+  auto Original = Factory(CName);
+  makeF(cast<LLVMContainer>(*Original).getModule(), "root");
+  BOOST_TEST(!Original->storeToDisk(Path));
 
-  ContainerToTargetsMap Targets;
-  Targets.add(CName, Target({ PathComponent("f1") }, FunctionKind));
+  LazyLoadLLVMContainers = true;
+  auto Loaded = Factory(CName);
+  BOOST_TEST(!Loaded->loadFromDisk(Path));
+  LazyLoadLLVMContainers = false;
 
-  auto Error = Pipeline.run("End", Targets);
-  BOOST_TEST(!Error);
+  // Storing an untouched container must not require parsing it
+  auto &Lazy = cast<LLVMContainer>(*Loaded);
+  BOOST_TEST(Lazy.isPending());
+  std::string Buffer;
+  llvm::raw_string_ostream OS(Buffer);
+  BOOST_TEST(!Lazy.serialize(OS));
+  BOOST_TEST(Lazy.isPending());
 
-  const auto &Final = Pipeline["End"].containers().get<LLVMContainer>(CName);
-  const auto *F = Final.getModule().getFunction("f1");
+  BOOST_TEST(Lazy.getModule().getFunction("root") != nullptr);
+  BOOST_TEST(not Lazy.isPending());
 
-  BOOST_TEST(F != nullptr);
+  llvm::sys::fs::remove(Path);
+}
+
+BOOST_AUTO_TEST_CASE(LazyLLVMContainersCanBeReadConcurrently) {
+  llvm::LLVMContext C;
+  Context Ctx;
+  auto Factory = makeDefaultLLVMContainerFactory(Ctx, C);
+
+  llvm::SmallString<128> Path;
+  auto ErrorCode = llvm::sys::fs::createTemporaryFile("revng-lazy", "ll", Path);
+  BOOST_TEST(not ErrorCode);
+
+  auto Original = Factory(CName);
+  makeF(cast<LLVMContainer>(*Original).getModule(), "root");
+  BOOST_TEST(!Original->storeToDisk(Path));
+
+  LazyLoadLLVMContainers = true;
+  auto Loaded = Factory(CName);
+  BOOST_TEST(!Loaded->loadFromDisk(Path));
+  LazyLoadLLVMContainers = false;
+
+  // All the readers parse the module at most once, and see the same one
+  const auto &Lazy = cast<LLVMContainer>(*Loaded);
+  std::vector<const llvm::Module *> Seen(8, nullptr);
+  std::vector<std::thread> Readers;
+  for (size_t I = 0; I < Seen.size(); ++I)
+    Readers.emplace_back([&Lazy, &Seen, I] { Seen[I] = &Lazy.getModule(); });
+  for (std::thread &Reader : Readers)
+    Reader.join();
+
+  BOOST_TEST(not Lazy.isPending());
+  for (const llvm::Module *M : Seen)
+    BOOST_TEST(M == &Lazy.getModule());
+  BOOST_TEST(Lazy.getModule().getFunction("root") != nullptr);
+
+  llvm::sys::fs::remove(Path);
+}
+
+static llvm::GlobalVariable *makeInternalGlobal(llvm::Module &M,
+                                               llvm::StringRef Name) {
+  auto *Int32 = llvm::Type::getInt32Ty(M.getContext());
+  return new llvm::GlobalVariable(M,
+                                  Int32,
+                                  false,
+                                  llvm::GlobalValue::InternalLinkage,
+                                  llvm::ConstantInt::get(Int32, 0),
+                                  Name);
+}
+
+BOOST_AUTO_TEST_CASE(LLVMContainersAreMergedInPlace) {
+  llvm::LLVMContext C;
+  Context Ctx;
+  auto Factory = makeDefaultLLVMContainerFactory(Ctx, C);
+
+  auto Existing = Factory(CName);
+  auto &Destination = cast<LLVMContainer>(*Existing);
+  makeF(Destination.getModule(), "root");
+  makeInternalGlobal(Destination.getModule(), "state");
+  Destination.getModule().getOrInsertFunction("f1",
+                                              llvm::Type::getVoidTy(C));
+  const llvm::Module *Before = &Destination.getModule();
+
+  auto Incoming = Factory(CName);
+  auto &Source = cast<LLVMContainer>(*Incoming);
+  makeF(Source.getModule(), "f1");
+  makeInternalGlobal(Source.getModule(), "state");
+
+  Existing->mergeBack(std::move(*Incoming));
+
+  // The incoming definitions are moved into the existing module
+  const llvm::Module &After = Destination.getModule();
+  BOOST_TEST(&After == Before);
+  BOOST_TEST(not After.getFunction("root")->isDeclaration());
+  BOOST_TEST(not After.getFunction("f1")->isDeclaration());
+
+  // Internal globals with the same name are merged and stay internal
+  BOOST_TEST(After.global_size() == 1U);
+  BOOST_TEST(After.getNamedGlobal("state")->hasInternalLinkage());
 }
 
 BOOST_AUTO_TEST_CASE(LLVMPurePipe) {
@@ -809,6 +1862,49 @@ BOOST_AUTO_TEST_CASE(SingleElementPipelineInvalidation) {
   BOOST_TEST((QuantifOfInvalidated.front().isAll()));
 }
 
+class ExampleInvalidationEvent
+  : public InvalidationEvent<ExampleInvalidationEvent> {
+public:
+  static char ID;
+};
+
+char ExampleInvalidationEvent::ID;
+
+/// A kind invalidating the function "f1" of a ExampleInvalidationEvent
+class InvalidatedKind : public Kind {
+public:
+  InvalidatedKind() : Kind("InvalidatedKind", &FunctionRank) {}
+
+  void getInvalidations(TargetsList &ToRemove,
+                        const InvalidationEventBase &Event) const override {
+    if (llvm::isa<ExampleInvalidationEvent>(&Event))
+      ToRemove.emplace_back(Target({ "f1" }, *this));
+  }
+};
+
+static InvalidatedKind InvalidatedKindExample;
+
+BOOST_AUTO_TEST_CASE(KindsInvalidationsReachAllTheContainers) {
+  Context Ctx;
+  Runner Pipeline(Ctx);
+  Pipeline.addDefaultConstructibleFactory<MapContainer>(CName);
+
+  const std::string Name = "first_step";
+  Pipeline.emplaceStep("", Name);
+  Pipeline.emplaceStep(Name, "End", bindPipe<FineGranerPipe>(CName, CName));
+  Pipeline[Name].containers().getOrCreate<MapContainer>(CName);
+  Pipeline["End"].containers().getOrCreate<MapContainer>(CName);
+
+  Target Expected({ "f1" }, InvalidatedKindExample);
+  for (unsigned Jobs : { 1, 4 }) {
+    Pipeline.setJobs(Jobs);
+    Runner::InvalidationMap Invalidations;
+    ExampleInvalidationEvent().getInvalidations(Pipeline, Invalidations);
+    BOOST_TEST(Invalidations[Name][CName].contains(Expected));
+    BOOST_TEST(Invalidations["End"][CName].contains(Expected));
+  }
+}
+
 BOOST_AUTO_TEST_CASE(SingleElementPipelineWithRemove) {
   Context Ctx;
   Runner Pipeline(Ctx);
@@ -953,6 +2049,85 @@ BOOST_AUTO_TEST_CASE(LoaderTestFromYamlLLVM) {
   BOOST_TEST(!!MaybePipeline);
 }
 
+struct NewPMFunctionInserterPass
+  : public llvm::PassInfoMixin<NewPMFunctionInserterPass> {
+  llvm::PreservedAnalyses run(llvm::Module &M, llvm::ModuleAnalysisManager &) {
+    makeF(M, "f1");
+    return llvm::PreservedAnalyses::none();
+  }
+};
+
+struct NewPMPassFunctionCreator {
+  static constexpr auto Name = "NewPMFunctionCreator";
+
+  std::vector<ContractGroup> getContract() const {
+    return { ContractGroup(RootKind, KE::Exact, 0, FunctionKind) };
+  }
+
+  void registerPasses(llvm::ModulePassManager &Manager) {
+    Manager.addPass(NewPMFunctionInserterPass());
+  }
+};
+
+static std::string makeNewPMPipeline(llvm::StringRef Pass) {
+  return (R"(---
+                       Containers:
+                         - Name:            CustomName
+                           Type:            LLVMContainer
+                       Steps:
+                         - Name:            FirstStep
+                           Pipes:
+                             - Type:             NewPMLLVMPipe
+                               UsedContainers:
+                                 - CustomName
+                               Passes:
+                                 - NewPMFunctionCreator
+                                 - )"
+          + Pass + "\n")
+    .str();
+}
+
+BOOST_AUTO_TEST_CASE(LoaderTestFromYamlNewPMLLVM) {
+  llvm::LLVMContext C;
+  Context Ctx;
+  Loader Loader(Ctx);
+  Loader.addContainerFactory("LLVMContainer",
+                             makeDefaultLLVMContainerFactory(Ctx, C));
+  auto *Name = NewPMPassFunctionCreator::Name;
+  Loader.registerNewPMLLVMPass<NewPMPassFunctionCreator>(Name);
+
+  size_t Registrations = 0;
+  Loader.setNewPMLLVMPipeConfigurer([&](const pipeline::Loader &,
+                                        NewPMLLVMPipe &Pipe) {
+    Pipe.addAnalyses([&](AnalysisManagers &) { ++Registrations; });
+    return llvm::Error::success();
+  });
+
+  // Unknown passes are rejected upfront
+  auto MaybeInvalid = Loader.load(makeNewPMPipeline("not-a-pass"));
+  BOOST_TEST(!MaybeInvalid);
+  llvm::consumeError(MaybeInvalid.takeError());
+
+  auto MaybePipeline = Loader.load(makeNewPMPipeline("function(instcombine)"));
+  BOOST_TEST(!!MaybePipeline);
+  auto &Pipeline = *MaybePipeline;
+
+  auto &Begin = Pipeline["begin"].containers();
+  makeF(Begin.getOrCreate<LLVMContainer>("CustomName").getModule(), "root");
+
+  ContainerToTargetsMap Targets;
+  Targets.add("CustomName", Target({ PathComponent("f1") }, FunctionKind));
+  auto Error = Pipeline.run("FirstStep", Targets);
+  BOOST_TEST(!Error);
+
+  // Analyses are registered once for all the passes of the pipe
+  BOOST_TEST(Registrations == 1);
+
+  auto &Final = Pipeline["FirstStep"].containers();
+  const auto &Module = Final.get<LLVMContainer>("CustomName").getModule();
+  BOOST_TEST(Module.getFunction("f1") != nullptr);
+}
+
 static std::string getCurrentPath() {
   llvm::SmallVector<char, 3> ToReturn;
   llvm::sys::fs::current_path(ToReturn);
@@ -982,6 +2157,280 @@ BOOST_AUTO_TEST_CASE(SingleElementPipelineStoreToDisk) {
   BOOST_TEST(Pipeline[Name].containers().contains(CName));
 }
 
+BOOST_AUTO_TEST_CASE(ContainersCanBeLoadedConcurrently) {
+  Context Ctx;
+  Runner Pipeline(Ctx);
+  Pipeline.setJobs(4);
+  Pipeline.addDefaultConstructibleFactory<MapContainer>(CName);
+
+  const std::string Name = "first_step";
+  Pipeline.emplaceStep("", Name, bindPipe<FineGranerPipe>(CName, CName));
+  Pipeline.emplaceStep(Name, "End");
+
+  auto &C1 = Pipeline[Name].containers().getOrCreate<MapContainer>(CName);
+  C1.get(Target({}, RootKind)) = 1;
+  auto &C2 = Pipeline["End"].containers().getOrCreate<MapContainer>(CName);
+  C2.get(Target({}, RootKind)) = 2;
+
+  BOOST_TEST((!Pipeline.storeToDisk(getCurrentPath())));
+
+  C1.get(Target({}, RootKind)) = 3;
+  C2.get(Target({}, RootKind)) = 4;
+  BOOST_TEST((!Pipeline.loadFromDisk(getCurrentPath())));
+
+  BOOST_TEST((C1.get(Target({}, RootKind)) == 1));
+  BOOST_TEST((C2.get(Target({}, RootKind)) == 2));
+}
+
+/// A container which is stored through serialize, counting how many times it
+/// has been serialized
+class CountingContainer : public Container<CountingContainer> {
+public:
+  static char ID;
+  static inline size_t Serialized = 0;
+
+  std::string Content;
+
+public:
+  CountingContainer(llvm::StringRef Name) :
+    Container<CountingContainer>(Name) {}
+
+  void setContent(std::string NewContent) {
+    markModified();
+    Content = std::move(NewContent);
+  }
+
+  unique_ptr<ContainerBase>
+  cloneFiltered(const TargetsList &Container) const final {
+    auto Result = make_unique<CountingContainer>(this->name());
+    Result->Content = Content;
+    return Result;
+  }
+
+  TargetsList enumerate() const final { return {}; }
+
+  llvm::Error serialize(llvm::raw_ostream &OS) const final {
+    ++Serialized;
+    OS << Content;
+    return llvm::Error::success();
+  }
+
+protected:
+  bool removeImpl(const TargetsList &Targets) final { return true; }
+
+  llvm::Error deserializeImpl(const llvm::MemoryBuffer &Buffer) final {
+    Content = Buffer.getBuffer().str();
+    return llvm::Error::success();
+  }
+
+  void clearImpl() final { Content.clear(); }
+
+private:
+  void mergeBackImpl(CountingContainer &&Container) override {
+    Content = std::move(Container.Content);
+  }
+};
+
+char CountingContainer::ID;
+
+BOOST_AUTO_TEST_CASE(UnchangedContainersAreNotStoredAgain) {
+  llvm::SmallString<128> Directory;
+  BOOST_TEST(!llvm::sys::fs::createUniqueDirectory("revng-pipeline-test",
+                                                   Directory));
+
+  auto Factory = ContainerFactory([](llvm::StringRef Name) {
+    return make_unique<CountingContainer>(Name);
+  });
+  ContainerSet Set;
+  Set.add(CName, Factory);
+  Set.getOrCreate<CountingContainer>(CName).setContent("first");
+
+  CountingContainer::Serialized = 0;
+  BOOST_TEST(!Set.storeToDisk(Directory));
+  BOOST_TEST(CountingContainer::Serialized == 1U);
+
+  // Nothing changed, nothing to write
+  const auto &ConstSet = Set;
+  BOOST_TEST(ConstSet.contains(CName));
+  BOOST_TEST(!Set.storeToDisk(Directory));
+  BOOST_TEST(CountingContainer::Serialized == 1U);
+
+  // Loading the file back keeps the container in sync with it
+  BOOST_TEST(!Set.loadFromDisk(Directory));
+  BOOST_TEST(!Set.storeToDisk(Directory));
+  BOOST_TEST(CountingContainer::Serialized == 1U);
+
+  Set.getOrCreate<CountingContainer>(CName).setContent("second");
+  BOOST_TEST(!Set.storeToDisk(Directory));
+  BOOST_TEST(CountingContainer::Serialized == 2U);
+
+  std::string Path = (Directory + "/" + CName).str();
+  BOOST_TEST(!llvm::sys::fs::exists(Path + ".tmp"));
+  auto Buffer = llvm::MemoryBuffer::getFile(Path);
+  BOOST_TEST((Buffer and (*Buffer)->getBuffer() == "second"));
+
+  llvm::sys::fs::remove_directories(Directory);
+}
+
+BOOST_AUTO_TEST_CASE(MutationsThroughHeldReferencesAreStored) {
+  llvm::SmallString<128> Directory;
+  BOOST_TEST(!llvm::sys::fs::createUniqueDirectory("revng-pipeline-test",
+                                                   Directory));
+
+  auto Factory = ContainerFactory([](llvm::StringRef Name) {
+    return make_unique<CountingContainer>(Name);
+  });
+  ContainerSet Set;
+  Set.add(CName, Factory);
+
+  // Hold on to the container, as C API users do, and mutate it without going
+  // through the ContainerSet
+  auto &Held = Set.getOrCreate<CountingContainer>(CName);
+  Held.setContent("first");
+
+  CountingContainer::Serialized = 0;
+  BOOST_TEST(!Set.storeToDisk(Directory));
+  BOOST_TEST(CountingContainer::Serialized == 1U);
+
+  auto Buffer = llvm::MemoryBuffer::getMemBuffer("deserialized");
+  BOOST_TEST(!Held.deserialize(*Buffer));
+  BOOST_TEST(!Set.storeToDisk(Directory));
+  BOOST_TEST(CountingContainer::Serialized == 2U);
+
+  BOOST_TEST(Held.remove(TargetsList()));
+  BOOST_TEST(!Set.storeToDisk(Directory));
+  BOOST_TEST(CountingContainer::Serialized == 3U);
+
+  CountingContainer Other(CName);
+  Other.setContent("merged");
+  Held.mergeBack(std::move(Other));
+  BOOST_TEST(!Set.storeToDisk(Directory));
+  BOOST_TEST(CountingContainer::Serialized == 4U);
+
+  std::string Path = (Directory + "/" + CName).str();
+  std::string OtherPath = (Directory + "/other").str();
+  BOOST_TEST(!Other.storeToDisk(OtherPath));
+  BOOST_TEST(!Held.loadFromDisk(OtherPath));
+  BOOST_TEST(!Set.storeToDisk(Directory));
+  BOOST_TEST(CountingContainer::Serialized == 6U);
+
+  Held.clear();
+  BOOST_TEST(!Set.storeToDisk(Directory));
+  BOOST_TEST(CountingContainer::Serialized == 7U);
+
+  auto Stored = llvm::MemoryBuffer::getFile(Path);
+  BOOST_TEST((Stored and (*Stored)->getBuffer().empty()));
+
+  llvm::sys::fs::remove_directories(Directory);
+}
+
+BOOST_AUTO_TEST_CASE(EvictedContainersAreLoadedBackOnAccess) {
+  llvm::SmallString<128> Directory;
+  BOOST_TEST(!llvm::sys::fs::createUniqueDirectory("revng-pipeline-test",
+                                                   Directory));
+
+  auto Factory = ContainerFactory([](llvm::StringRef Name) {
+    return make_unique<CountingContainer>(Name);
+  });
+  ContainerSet Set;
+  Set.add(CName, Factory);
+  Set.getOrCreate<CountingContainer>(CName).setContent("evicted");
+
+  BOOST_TEST(!Set.evict(Directory));
+  BOOST_TEST(!Set.hasResidentContainers());
+  BOOST_TEST(Set.evictionsCount() == 1U);
+  BOOST_TEST(Set.reloadsCount() == 0U);
+
+  // Evicted containers are still there, as far as users are concerned
+  const auto &ConstSet = Set;
+  BOOST_TEST(ConstSet.contains(CName));
+  BOOST_TEST(Set.reloadsCount() == 0U);
+
+  BOOST_TEST(ConstSet.get<CountingContainer>(CName).Content == "evicted");
+  BOOST_TEST(Set.hasResidentContainers());
+  BOOST_TEST(Set.reloadsCount() == 1U);
+
+  // What has been loaded back is in sync with the file, evicting it again
+  // does not write anything
+  CountingContainer::Serialized = 0;
+  BOOST_TEST(!Set.evict(Directory));
+  BOOST_TEST(CountingContainer::Serialized == 0U);
+  BOOST_TEST(Set.evictionsCount() == 2U);
+
+  llvm::sys::fs::remove_directories(Directory);
+}
+
+BOOST_AUTO_TEST_CASE(EvictionKeepsContainersAlive) {
+  llvm::SmallString<128> Directory;
+  BOOST_TEST(!llvm::sys::fs::createUniqueDirectory("revng-pipeline-test",
+                                                   Directory));
+
+  auto Factory = ContainerFactory([](llvm::StringRef Name) {
+    return make_unique<CountingContainer>(Name);
+  });
+  ContainerSet Set;
+  Set.add(CName, Factory);
+  auto &Held = Set.getOrCreate<CountingContainer>(CName);
+  Held.setContent("evicted");
+
+  BOOST_TEST(!Set.evict(Directory));
+  BOOST_TEST(Set.isEvicted(CName));
+
+  // Enumerating does not need to load the container back
+  BOOST_TEST(Set.enumerate().contains(CName));
+  BOOST_TEST(Set.reloadsCount() == 0U);
+
+  // The held reference is still valid and loading back fills it again
+  BOOST_TEST(!Set.restore(CName));
+  BOOST_TEST(not Set.isEvicted(CName));
+  BOOST_TEST(&Set.get<CountingContainer>(CName) == &Held);
+  BOOST_TEST(Held.Content == "evicted");
+
+  // Replacing the content of an evicted container through a reference wins
+  // over what has been evicted
+  BOOST_TEST(!Set.evict(Directory));
+  auto Buffer = llvm::MemoryBuffer::getMemBuffer("replaced");
+  BOOST_TEST(!Held.deserialize(*Buffer));
+  BOOST_TEST(!Set.restoreAll());
+  BOOST_TEST(Held.Content == "replaced");
+  BOOST_TEST(Set.reloadsCount() == 1U);
+
+  llvm::sys::fs::remove_directories(Directory);
+}
+
+BOOST_AUTO_TEST_CASE(FailingToLoadBackEvictedContainersIsReported) {
+  llvm::SmallString<128> Directory;
+  BOOST_TEST(!llvm::sys::fs::createUniqueDirectory("revng-pipeline-test",
+                                                   Directory));
+
+  auto Factory = ContainerFactory([](llvm::StringRef Name) {
+    return make_unique<CountingContainer>(Name);
+  });
+  ContainerSet Set;
+  Set.add(CName, Factory);
+  Set.getOrCreate<CountingContainer>(CName).setContent("evicted");
+  BOOST_TEST(!Set.evict(Directory));
+
+  // Make the evicted file unreadable
+  std::string Path = (Directory + "/" + CName).str();
+  BOOST_TEST(!llvm::sys::fs::remove(Path));
+  BOOST_TEST(!llvm::sys::fs::create_directory(Path));
+
+  // Implicit loads cannot report failures right away, but they prevent the
+  // set from being stored
+  BOOST_TEST(Set.get<CountingContainer>(CName).Content.empty());
+  auto Error = Set.storeToDisk(Directory);
+  BOOST_TEST(!!Error);
+  llvm::consumeError(std::move(Error));
+
+  // Until it's loaded again
+  BOOST_TEST(!llvm::sys::fs::remove(Path));
+  BOOST_TEST(!Set.loadFromDisk(Directory));
+  BOOST_TEST(!Set.storeToDisk(Directory));
+
+  llvm::sys::fs::remove_directories(Directory);
+}
+
 BOOST_AUTO_TEST_CASE(SingleElementPipelineStoreToDiskWithOverrides) {
   Context Ctx;
   Loader Loader(Ctx);
@@ -1025,25 +2474,26 @@ public:
     return llvm::Error::success();
   }
 
-  llvm::Error loadFromDisk(llvm::StringRef Path) override {
+  llvm::Error serialize(llvm::raw_ostream &OS) const final {
 
     return llvm::Error::success();
   }
 
-  llvm::Error serialize(llvm::raw_ostream &OS) const final {
+  std::set<Target> Targets;
+
+protected:
+  llvm::Error loadFromDiskImpl(llvm::StringRef Path) override {
 
     return llvm::Error::success();
   }
 
-  llvm::Error deserialize(const llvm::MemoryBuffer &Buffer) final {
+  llvm::Error deserializeImpl(const llvm::MemoryBuffer &Buffer) final {
 
     return llvm::Error::success();
   }
 
   /// Must reset the state of the container to the just built state
-  void clear() final {}
-
-  std::set<Target> Targets;
+  void clearImpl() final {}
 
 private:
   void mergeBackImpl(EnumerableContainerExample &&Container) override {}
@@ -1175,6 +2625,28 @@ BOOST_AUTO_TEST_CASE(LLVMKindTest) {
   BOOST_TEST(F != nullptr);
 }
 
+BOOST_AUTO_TEST_CASE(LLVMContainerCloneKeepsOtherFunctions) {
+  Context Ctx;
+  llvm::LLVMContext C;
+
+  using Cont = ExampleLLVMInspectalbeContainer;
+  auto Factory = makeLLVMContainerFactory<Cont>(Ctx, C);
+  auto Container = Factory("dont_care");
+  makeF(cast<Cont>(*Container).getModule(), "f1");
+  makeF(cast<Cont>(*Container).getModule(), "f2");
+
+  // Kinds of non-sharded containers are not registered: the functions of the
+  // other targets are untracked, hence they are kept by clones
+  const auto *F2 = cast<Cont>(*Container).getModule().getFunction("f2");
+  BOOST_TEST(not LLVMGlobalKindBase<Cont>::hasOwner(*F2));
+
+  auto Cloned = Container->cloneFiltered(TargetsList({ Target({ "f1" },
+                                                              FunctionKind) }));
+  const auto &Module = cast<Cont>(*Cloned).getModule();
+  BOOST_TEST(not Module.getFunction("f1")->isDeclaration());
+  BOOST_TEST(not Module.getFunction("f2")->isDeclaration());
+}
+
 class InspectorKindExample
   : public LLVMGlobalKindBase<ExampleLLVMInspectalbeContainer> {
 public:
@@ -1219,6 +2691,68 @@ BOOST_AUTO_TEST_CASE(InspectorKindTest) {
   BOOST_TEST(Container->enumerate().contains(RootF));
 }
 
+BOOST_AUTO_TEST_CASE(TargetsBitmapsSupportSetOperations) {
+  Target F1({ "f1" }, FunctionKind);
+  Target F2({ "f2" }, FunctionKind);
+  Target F3({ "f3" }, FunctionKind);
+  auto Universe = std::make_shared<TargetsUniverse>(std::vector<Target>{
+    F1, F2, F3 });
+
+  TargetsBitmap Left(Universe);
+  BOOST_TEST(Left.insert(F1));
+  BOOST_TEST(Left.insert(F2));
+  BOOST_TEST(not Left.insert(Target({ "f4" }, FunctionKind)));
+  BOOST_TEST(Left.contains(F1));
+  BOOST_TEST(not Left.contains(F3));
+  BOOST_TEST(not Left.contains(Target({ PathComponent::all() },
+                                      FunctionKind)));
+
+  TargetsBitmap Right(Universe);
+  Right.insert(TargetsList({ F2, F3 }));
+  BOOST_TEST(Right.count() == 2U);
+
+  auto Union = Left;
+  Union.merge(Right);
+  BOOST_TEST((Union == TargetsBitmap::all(Universe)));
+  BOOST_TEST(Union.contains(Left));
+  BOOST_TEST(not Left.contains(Right));
+
+  auto Intersection = Left;
+  Intersection.intersect(Right);
+  BOOST_TEST(Intersection.toList().size() == 1U);
+  BOOST_TEST(Intersection.toList().contains(F2));
+
+  Union.subtract(Left);
+  BOOST_TEST(Union.count() == 1U);
+  BOOST_TEST(Union.contains(F3));
+
+  // Wildcards select every matching target of the universe
+  TargetsBitmap All(Universe);
+  All.insert(TargetsList({ Target({ PathComponent::all() }, FunctionKind) }));
+  BOOST_TEST((All == TargetsBitmap::all(Universe)));
+}
+
+BOOST_AUTO_TEST_CASE(LLVMContainersCanRemoveTargets) {
+  Context Ctx;
+  llvm::LLVMContext C;
+
+  using Cont = ExampleLLVMInspectalbeContainer;
+  auto Factory = makeLLVMContainerFactory<Cont>(Ctx, C);
+  auto Container = Factory("dont_care");
+  auto &Module = cast<Cont>(*Container).getModule();
+  makeF(Module, "f1");
+  makeF(Module, "f3");
+
+  Target F1({ "f1" }, InspKindExample);
+  Target F3({ "f3" }, InspKindExample);
+  BOOST_TEST(Container->enumerate().contains(F1));
+  BOOST_TEST(Container->remove(TargetsList({ F1 })));
+  BOOST_TEST(Module.getFunction("f1")->isDeclaration());
+  BOOST_TEST(not Module.getFunction("f3")->isDeclaration());
+  BOOST_TEST(not Container->remove(TargetsList({ Target({ "f2" },
+                                                         InspKindExample) })));
+}
+
 BOOST_AUTO_TEST_CASE(MultiStepInvalidationTest) {
   Context Ctx;
   Runner Pipeline(Ctx);
@@ -1267,4 +2801,202 @@ BOOST_AUTO_TEST_CASE(MultiStepInvalidationTest) {
   BOOST_TEST(C2End.get(ToProduce) == 0);
 }
 
+BOOST_AUTO_TEST_CASE(InvalidationIndexTest) {
+  Context Ctx;
+  Runner Pipeline(Ctx);
+  auto CName2 = CName + "2";
+  Pipeline.addDefaultConstructibleFactory<MapContainer>(CName);
+  Pipeline.addDefaultConstructibleFactory<MapContainer>(CName2);
+
+  const std::string Name = "first_step";
+  const std::string SecondName = "second_step";
+  Pipeline.emplaceStep("", Name);
+  Pipeline.emplaceStep(Name,
+                       SecondName,
+                       bindPipe<FineGranerPipe>(CName, CName));
+  Pipeline.emplaceStep(SecondName, "End", bindPipe<CopyPipe>(CName, CName2));
+
+  auto &C1 = Pipeline[Name].containers().getOrCreate<MapContainer>(CName);
+  const auto T = Target({}, RootKind);
+  C1.get(T) = 1;
+
+  const auto ToProduce = Target({ PathComponent("f1") }, FunctionKind);
+  ContainerToTargetsMap Map;
+  Map[CName2].emplace_back(ToProduce);
+  cantFail(Pipeline.run("End", Map));
+
+  // The steps that have been run know where their targets come from
+  const Runner &ConstPipeline = Pipeline;
+  const auto &Index = ConstPipeline["End"].invalidationIndex();
+  BOOST_TEST(Index.isComplete());
+  BOOST_TEST(not Index.empty());
+
+  pipeline::Runner::InvalidationMap Invalidations;
+  Invalidations[Name][CName].push_back(T);
+  BOOST_TEST(!Pipeline.getInvalidations(Invalidations));
+  BOOST_TEST(Invalidations["End"][CName2].contains(ToProduce));
+
+  BOOST_TEST(!Pipeline.invalidate(Invalidations));
+  BOOST_TEST(Index.empty());
+
+  const auto &End = ConstPipeline["End"].containers();
+  BOOST_TEST(not End.at(CName2).enumerate().contains(ToProduce));
+}
+
+BOOST_AUTO_TEST_CASE(InvalidationIndexExternalChangesTest) {
+  Context Ctx;
+  Runner Pipeline(Ctx);
+  auto CName2 = CName + "2";
+  Pipeline.addDefaultConstructibleFactory<MapContainer>(CName);
+  Pipeline.addDefaultConstructibleFactory<MapContainer>(CName2);
+
+  const std::string Name = "first_step";
+  Pipeline.emplaceStep("", Name);
+  Pipeline.emplaceStep(Name, "End", bindPipe<CopyPipe>(CName, CName2));
+
+  auto &C1 = Pipeline[Name].containers().getOrCreate<MapContainer>(CName);
+  const auto T = Target({ PathComponent("f1") }, FunctionKind);
+  C1.get(T) = 1;
+
+  ContainerToTargetsMap Map;
+  Map[CName2].emplace_back(T);
+  cantFail(Pipeline.run("End", Map));
+
+  ContainerToTargetsMap Invalidated;
+  Invalidated[CName].push_back(T);
+
+  // Reading the containers does not prevent the index from being used
+  Step &End = Pipeline["End"];
+  BOOST_TEST(End.containers().at(CName2).enumerate().contains(T));
+  auto MaybeDependents = End.dependentsOf(Invalidated);
+  BOOST_TEST(MaybeDependents.has_value());
+  BOOST_TEST((*MaybeDependents)[CName2].contains(T));
+
+  // Changing them from the outside does
+  const auto Other = Target({ PathComponent("f3") }, FunctionKind);
+  End.containers().getOrCreate<MapContainer>(CName2).get(Other) = 2;
+  BOOST_TEST(not End.dependentsOf(Invalidated).has_value());
+
+  // Invalidations are still computed, enumerating the containers
+  pipeline::Runner::InvalidationMap Invalidations;
+  Invalidations[Name][CName].push_back(T);
+  BOOST_TEST(!Pipeline.getInvalidations(Invalidations));
+  BOOST_TEST(Invalidations["End"][CName2].contains(T));
+
+  // Nothing is known about the targets added from the outside, the index is
+  // no longer used even after the step changes the containers on its own
+  BOOST_TEST(!Pipeline.invalidate(Invalidations));
+  BOOST_TEST(not End.invalidationIndex().isComplete());
+}
+
+class ShardedKindExample : public ShardedLLVMKind {
+public:
+  ShardedKindExample() : ShardedLLVMKind("ShardedKind", &FunctionRank) {}
+
+  std::optional<Target>
+  symbolToTarget(const llvm::Function &Symbol) const final {
+    if (not Symbol.getName().startswith("f") or Symbol.isDeclaration())
+      return std::nullopt;
+    return Target({ Symbol.getName() }, *this);
+  }
+
+  TargetsList
+  compactTargets(const Context &Ctx, TargetsList::List &Targets) const final {
+    return TargetsList(move(Targets));
+  }
+
+  ~ShardedKindExample() override {}
+};
+
+static ShardedKindExample ShardedKind;
+
+static void makeCaller(llvm::Module &M,
+                       llvm::StringRef FName,
+                       llvm::Function &Callee,
+                       llvm::GlobalVariable &Variable) {
+  auto *Int32 = llvm::Type::getInt32Ty(M.getContext());
+  auto *VoidType = llvm::Type::getVoidTy(M.getContext());
+  auto *FType = llvm::FunctionType::get(VoidType, {});
+  auto *F = llvm::Function::Create(FType,
+                                   llvm::GlobalValue::ExternalLinkage,
+                                   FName,
+                                   &M);
+  auto *BB = llvm::BasicBlock::Create(M.getContext(), "bb", F);
+  llvm::IRBuilder<> Builder(BB);
+  Builder.CreateCall(&Callee);
+  Builder.CreateStore(llvm::ConstantInt::get(Int32, 1), &Variable);
+  Builder.CreateRetVoid();
+}
+
+BOOST_AUTO_TEST_CASE(ShardedLLVMContainerTest) {
+  llvm::LLVMContext C;
+  Context Ctx;
+
+  llvm::Module M("m", C);
+  makeF(M, "helper");
+  auto *Int32 = llvm::Type::getInt32Ty(C);
+  auto *Variable = new llvm::GlobalVariable(M,
+                                            Int32,
+                                            false,
+                                            llvm::GlobalValue::ExternalLinkage,
+                                            llvm::ConstantInt::get(Int32, 0),
+                                            "csv");
+  makeCaller(M, "f1", *M.getFunction("helper"), *Variable);
+  makeCaller(M, "f2", *M.getFunction("helper"), *Variable);
+
+  auto Factory = makeShardedLLVMContainerFactory<ShardedLLVMContainer>(Ctx);
+  auto Base = Factory("dont_care");
+  auto &Container = cast<ShardedLLVMContainer>(*Base);
+  Container.importModule(M);
+
+  BOOST_TEST(Container.shardsCount() == 2);
+  Target F1({ "f1" }, ShardedKind);
+  Target F2({ "f2" }, ShardedKind);
+  BOOST_TEST(Container.enumerate().contains(F1));
+  BOOST_TEST(Container.enumerate().contains(F2));
+
+  // Each shard has its own context, a copy of the helpers and only
+  // declarations of globals
+  const llvm::Module *Shard = Container.getShard("f1");
+  BOOST_TEST(&Shard->getContext() != &C);
+  BOOST_TEST(&Shard->getContext() != &Container.getShard("f2")->getContext());
+  BOOST_TEST(not Shard->getFunction("helper")->isDeclaration());
+  BOOST_TEST(Shard->getGlobalVariable("csv")->isDeclaration());
+  BOOST_TEST(Shard->getFunction("f2") == nullptr);
+
+  auto Cloned = Container.cloneFiltered(TargetsList({ F1 }));
+  BOOST_TEST(cast<ShardedLLVMContainer>(*Cloned).shardsCount() == 1);
+  BOOST_TEST(Cloned->enumerate().contains(F1));
+  BOOST_TEST(not Cloned->enumerate().contains(F2));
+
+  size_t Visited = 0;
+  std::mutex Lock;
+  Container.forEachShard(
+    [&](size_t, llvm::Module &) {
+      std::lock_guard<std::mutex> Guard(Lock);
+      Visited++;
+    },
+    2);
+  BOOST_TEST(Visited == 2);
+
+  std::string Buffer;
+  llvm::raw_string_ostream OS(Buffer);
+  BOOST_TEST(!Container.serialize(OS));
+  auto Reloaded = Factory("dont_care");
+  auto MemoryBuffer = llvm::MemoryBuffer::getMemBuffer(OS.str(), "", false);
+  BOOST_TEST(!Reloaded->deserialize(*MemoryBuffer));
+  BOOST_TEST(Reloaded->enumerate().contains(F1));
+  BOOST_TEST(Reloaded->enumerate().contains(F2));
+
+  BOOST_TEST(Container.remove(TargetsList({ F2 })));
+  BOOST_TEST(Container.shardsCount() == 1);
+  Container.mergeBack(std::move(*Reloaded));
+  BOOST_TEST(Container.shardsCount() == 2);
+
+  auto Linked = Container.linkShards(C);
+  BOOST_TEST(not Linked->getFunction("f1")->isDeclaration());
+  BOOST_TEST(not Linked->getFunction("f2")->isDeclaration());
+  BOOST_TEST(Linked->getGlobalVariable("csv") != nullptr);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
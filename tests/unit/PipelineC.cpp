@@ -5,6 +5,14 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <string>
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
 #include "revng/PipelineC/PipelineC.h"
 
 #define BOOST_TEST_MODULE PipelineC
@@ -57,4 +65,248 @@ BOOST_AUTO_TEST_CASE(CAPILoadTest) {
   BOOST_TEST(rp_manager_get_kind_from_name(Runner, "Root") != nullptr);
 }
 
+static bool cancelImmediately(const char *StepName,
+                              uint64_t Index,
+                              uint64_t Count,
+                              void *UserData) {
+  ++*static_cast<unsigned *>(UserData);
+  return false;
+}
+
+static bool countSteps(const char *StepName,
+                       uint64_t Index,
+                       uint64_t Count,
+                       void *UserData) {
+  ++*static_cast<unsigned *>(UserData);
+  return true;
+}
+
+BOOST_AUTO_TEST_CASE(CAPIJobTest) {
+  auto *Begin = rp_manager_get_step(Runner, 0);
+  auto *FirstStep = rp_manager_get_step(Runner, 1);
+  auto GetIdentifier = [](llvm::StringRef Name) {
+    for (uint64_t I = 0; I < rp_manager_containers_count(Runner); I++) {
+      auto *Identifier = rp_manager_get_container_identifier(Runner, I);
+      if (Name == rp_container_identifier_get_name(Identifier))
+        return Identifier;
+    }
+    revng_abort();
+  };
+  auto *Input = rp_step_get_container(Begin, GetIdentifier("Strings1"));
+  auto *Output = rp_step_get_container(FirstStep, GetIdentifier("Strings2"));
+  auto *Kind = rp_manager_get_kind_from_name(Runner, "StringKind");
+  BOOST_TEST(Kind != nullptr);
+
+  // Provide the input of the copy
+  llvm::SmallString<32> Path;
+  {
+    int FD = -1;
+    revng_check(not llvm::sys::fs::createTemporaryFile("job", "", FD, Path));
+    llvm::raw_fd_ostream OS(FD, true);
+    OS << "f1\n";
+  }
+  BOOST_TEST(rp_container_load(Input, Path.c_str()));
+  llvm::sys::fs::remove(Path);
+
+  const char *Components[1] = { "f1" };
+  rp_target *Targets[1] = { rp_target_create(Kind, 1, 1, Components) };
+  rp_container *Containers[1] = { Output };
+
+  unsigned Invocations = 0;
+  rp_job *Job = rp_manager_submit_job(Runner,
+                                      FirstStep,
+                                      1,
+                                      Targets,
+                                      Containers,
+                                      cancelImmediately,
+                                      &Invocations);
+  BOOST_TEST(rp_job_wait(Job) == RP_JOB_CANCELLED);
+  BOOST_TEST(rp_job_poll(Job) == RP_JOB_CANCELLED);
+  BOOST_TEST(Invocations == 1);
+  BOOST_TEST(rp_job_create_serialized_container(Job, Output) == nullptr);
+  rp_job_destroy(Job);
+
+  Invocations = 0;
+  Job = rp_manager_submit_job(Runner,
+                              FirstStep,
+                              1,
+                              Targets,
+                              Containers,
+                              countSteps,
+                              &Invocations);
+  rp_target_destroy(Targets[0]);
+  BOOST_TEST(rp_job_wait(Job) == RP_JOB_SUCCEEDED);
+  BOOST_TEST(Invocations == 1);
+  BOOST_TEST(rp_job_create_serialized_container(Job, Input) == nullptr);
+
+  char *Serialized = rp_job_create_serialized_container(Job, Output);
+  BOOST_TEST(std::string(Serialized) == "f1\n");
+  rp_string_destroy(Serialized);
+  rp_job_destroy(Job);
+}
+
+BOOST_AUTO_TEST_CASE(CAPIInMemorySerializationTest) {
+  auto *FirstStep = rp_manager_get_step(Runner, 1);
+  rp_container *Container = nullptr;
+  for (uint64_t I = 0; I < rp_manager_containers_count(Runner); I++) {
+    auto *Identifier = rp_manager_get_container_identifier(Runner, I);
+    if (llvm::StringRef(rp_container_identifier_get_name(Identifier))
+        == "Strings1")
+      Container = rp_step_get_container(FirstStep, Identifier);
+  }
+  revng_check(Container != nullptr);
+
+  llvm::SmallString<32> Path;
+  {
+    int FD = -1;
+    revng_check(not llvm::sys::fs::createTemporaryFile("buffer", "", FD, Path));
+    llvm::raw_fd_ostream OS(FD, true);
+    OS << "f2\nf3\n";
+  }
+  BOOST_TEST(rp_container_load(Container, Path.c_str()));
+  llvm::sys::fs::remove(Path);
+
+  rp_buffer *Buffer = rp_container_create_buffer(Container, 0, nullptr);
+  BOOST_TEST(std::string(rp_buffer_data(Buffer), rp_buffer_size(Buffer))
+             == "f2\nf3\n");
+  rp_buffer_destroy(Buffer);
+
+  auto *Kind = rp_manager_get_kind_from_name(Runner, "StringKind");
+  const char *Components[1] = { "f3" };
+  rp_target *Targets[1] = { rp_target_create(Kind, 1, 1, Components) };
+
+  BOOST_TEST(rp_container_serialize(Container, 1, Targets, nullptr, 0) == 3);
+  char Small[2] = { 'x', 'x' };
+  BOOST_TEST(rp_container_serialize(Container, 1, Targets, Small, 2) == 3);
+  BOOST_TEST(Small[0] == 'x');
+  char Large[8] = {};
+  BOOST_TEST(rp_container_serialize(Container, 1, Targets, Large, 8) == 3);
+  BOOST_TEST(std::string(Large) == "f3\n");
+  rp_target_destroy(Targets[0]);
+}
+
+static rp_container *getContainer(rp_step *Step, llvm::StringRef Name) {
+  for (uint64_t I = 0; I < rp_manager_containers_count(Runner); I++) {
+    auto *Identifier = rp_manager_get_container_identifier(Runner, I);
+    if (Name == rp_container_identifier_get_name(Identifier))
+      return rp_step_get_container(Step, Identifier);
+  }
+  revng_abort();
+}
+
+static void loadStrings(rp_container *Container, llvm::StringRef Content) {
+  llvm::SmallString<32> Path;
+  {
+    int FD = -1;
+    revng_check(not llvm::sys::fs::createTemporaryFile("load", "", FD, Path));
+    llvm::raw_fd_ostream OS(FD, true);
+    OS << Content;
+  }
+  revng_check(rp_container_load(Container, Path.c_str()));
+  llvm::sys::fs::remove(Path);
+}
+
+struct QueriesFromCallback {
+  rp_container *Container = nullptr;
+  rp_target *Target = nullptr;
+  bool Ready = true;
+  std::string Name;
+};
+
+static bool queryContainer(const char *StepName,
+                           uint64_t Index,
+                           uint64_t Count,
+                           void *UserData) {
+  auto &Queries = *static_cast<QueriesFromCallback *>(UserData);
+  Queries.Ready = rp_target_is_ready(Queries.Target, Queries.Container);
+  Queries.Name = rp_container_get_name(Queries.Container);
+  return true;
+}
+
+BOOST_AUTO_TEST_CASE(CAPIQueriesDuringJobsTest) {
+  auto *Begin = rp_manager_get_step(Runner, 0);
+  auto *FirstStep = rp_manager_get_step(Runner, 1);
+  auto *Input = getContainer(Begin, "Strings1");
+  auto *Output = getContainer(FirstStep, "Strings2");
+  auto *Kind = rp_manager_get_kind_from_name(Runner, "StringKind");
+  loadStrings(Input, "f4\n");
+
+  const char *Components[1] = { "f4" };
+  rp_target *Targets[1] = { rp_target_create(Kind, 1, 1, Components) };
+  rp_container *Containers[1] = { Output };
+
+  // The queries issued while the job is running are answered from what the
+  // containers held when it started, without waiting for it
+  QueriesFromCallback Queries;
+  Queries.Container = Output;
+  Queries.Target = Targets[0];
+  rp_job *Job = rp_manager_submit_job(Runner,
+                                      FirstStep,
+                                      1,
+                                      Targets,
+                                      Containers,
+                                      queryContainer,
+                                      &Queries);
+  BOOST_TEST(rp_job_wait(Job) == RP_JOB_SUCCEEDED);
+  rp_job_destroy(Job);
+  BOOST_TEST(not Queries.Ready);
+  BOOST_TEST(Queries.Name == "Strings2");
+
+  BOOST_TEST(rp_target_is_ready(Targets[0], Output));
+  rp_target_destroy(Targets[0]);
+}
+
+BOOST_AUTO_TEST_CASE(CAPIEvictionTest) {
+  llvm::SmallString<128> Directory;
+  revng_check(not llvm::sys::fs::createUniqueDirectory("revng-pipeline-c",
+                                                       Directory));
+  BOOST_TEST(rp_manager_set_resident_steps_limit(Runner, 1, Directory.c_str()));
+
+  auto *Begin = rp_manager_get_step(Runner, 0);
+  auto *FirstStep = rp_manager_get_step(Runner, 1);
+  auto *Input = getContainer(Begin, "Strings1");
+  auto *Output = getContainer(FirstStep, "Strings2");
+  auto *Kind = rp_manager_get_kind_from_name(Runner, "StringKind");
+  loadStrings(Input, "f5\n");
+
+  const char *Components[1] = { "f5" };
+  rp_target *Targets[1] = { rp_target_create(Kind, 1, 1, Components) };
+  rp_container *Containers[1] = { Output };
+  unsigned Invocations = 0;
+  rp_job *Job = rp_manager_submit_job(Runner,
+                                      FirstStep,
+                                      1,
+                                      Targets,
+                                      Containers,
+                                      countSteps,
+                                      &Invocations);
+  BOOST_TEST(rp_job_wait(Job) == RP_JOB_SUCCEEDED);
+  rp_job_destroy(Job);
+
+  // Only the containers of FirstStep are kept in memory
+  BOOST_TEST(rp_manager_get_evictions_count(Runner) != 0);
+  uint64_t Reloads = rp_manager_get_reloads_count(Runner);
+
+  // Evicted containers can still be queried, without loading them back
+  BOOST_TEST(rp_target_is_ready(Targets[0], Input));
+  BOOST_TEST(std::string(rp_container_get_name(Input)) == "Strings1");
+  BOOST_TEST(rp_manager_get_reloads_count(Runner) == Reloads);
+
+  // Serializing and storing them loads them back
+  rp_buffer *Buffer = rp_container_create_buffer(Input, 0, nullptr);
+  BOOST_TEST(std::string(rp_buffer_data(Buffer), rp_buffer_size(Buffer))
+             == "f5\n");
+  rp_buffer_destroy(Buffer);
+  BOOST_TEST(rp_manager_get_reloads_count(Runner) == Reloads + 1);
+
+  std::string Path = (Directory + "/stored").str();
+  BOOST_TEST(rp_container_store(Input, Path.c_str()));
+  auto Stored = llvm::MemoryBuffer::getFile(Path);
+  BOOST_TEST((Stored and (*Stored)->getBuffer() == "f5\n"));
+
+  rp_target_destroy(Targets[0]);
+  BOOST_TEST(rp_manager_set_resident_steps_limit(Runner, 0, nullptr));
+  llvm::sys::fs::remove_directories(Directory);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,120 @@
+/// \file PromoteCSVs.cpp
+/// \brief Tests for PromoteCSVsPass
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#define BOOST_TEST_MODULE PromoteCSVs
+bool init_unit_test();
+#include "boost/test/unit_test.hpp"
+
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+
+#include "revng/FunctionIsolation/PromoteCSVs.h"
+#include "revng/Model/Binary.h"
+#include "revng/Model/LoadModelPass.h"
+#include "revng/Support/FunctionTags.h"
+#include "revng/Support/IRHelpers.h"
+#include "revng/UnitTestHelpers/LLVMTestHelpers.h"
+#include "revng/UnitTestHelpers/UnitTestHelpers.h"
+
+using namespace llvm;
+
+static const char *ModuleText = R"LLVM(
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-pc-linux-gnu"
+
+@rax = internal global i64 0
+@rdi = internal global i64 0
+@rsi = internal global i64 0
+@pc = internal global i64 0
+@pc_epoch = internal global i32 0
+@pc_address_space = internal global i16 0
+@pc_type = internal global i16 0
+
+; Reads rax and writes rdi
+define void @callee(i8* %0) {
+  %rax.value = load i64, i64* @rax
+  store i64 %rax.value, i64* @rdi
+  ret void
+}
+
+; Reads rsi through another function
+define void @indirect_callee(i8* %0) {
+  call void @rsi_reader(i8* %0)
+  ret void
+}
+
+define void @rsi_reader(i8* %0) {
+  %rsi.value = load i64, i64* @rsi
+  ret void
+}
+
+define void @f() {
+  call void @callee(i8* null)
+  call void @indirect_callee(i8* null)
+  ret void
+}
+
+!revng.csv = !{!0}
+
+!0 = !{i64* @rax, i64* @rdi, i64* @rsi, i64* @pc}
+)LLVM";
+
+static std::unique_ptr<Module> promote(LLVMContext &Context) {
+  auto M = parseModule(Context, ModuleText);
+
+  FunctionTags::ABIEnforced.addTo(M->getFunction("f"));
+
+  TupleTree<model::Binary> Binary;
+  Binary->Architecture = model::Architecture::x86_64;
+
+  runLegacyPasses(*M,
+                  new LoadModelWrapperPass(ModelWrapper(Binary)),
+                  new PromoteCSVsPass());
+  return M;
+}
+
+/// \return the call in f to the wrapper of \p Callee
+static CallInst *getWrapperCall(Module &M, StringRef Callee) {
+  std::string WrapperName = (Callee + "_wrapper").str();
+  for (Instruction &I : M.getFunction("f")->getEntryBlock())
+    if (auto *Call = dyn_cast<CallInst>(&I))
+      if (getCallee(Call)->getName() == WrapperName)
+        return Call;
+
+  revng_abort();
+}
+
+/// \return the CSV whose alloca is loaded by \p V
+static StringRef loadedCSV(Value *V) {
+  auto *Load = cast<LoadInst>(V);
+  return cast<AllocaInst>(Load->getPointerOperand())->getName();
+}
+
+BOOST_AUTO_TEST_CASE(TestCalleeLoadsAreArguments) {
+  LLVMContext Context;
+  auto M = promote(Context);
+
+  // rax is passed after the original argument, rdi is returned
+  CallInst *Call = getWrapperCall(*M, "callee");
+  revng_check(Call->arg_size() == 2);
+  revng_check(loadedCSV(Call->getArgOperand(1)) == "rax");
+
+  auto *ReturnType = cast<StructType>(Call->getType());
+  revng_check(ReturnType->getNumElements() == 1);
+}
+
+BOOST_AUTO_TEST_CASE(TestTransitiveCalleeLoads) {
+  LLVMContext Context;
+  auto M = promote(Context);
+
+  // rsi is read by a function called by the callee
+  CallInst *Call = getWrapperCall(*M, "indirect_callee");
+  revng_check(Call->arg_size() == 2);
+  revng_check(loadedCSV(Call->getArgOperand(1)) == "rsi");
+  revng_check(Call->getType()->isVoidTy());
+}
@@ -0,0 +1,239 @@
+/// \file PromoteCSVsInRoot.cpp
+/// \brief Tests for PromoteCSVsInRootPass
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#define BOOST_TEST_MODULE PromoteCSVsInRoot
+bool init_unit_test();
+#include "boost/test/unit_test.hpp"
+
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+
+#include "revng/FunctionIsolation/PromoteCSVs.h"
+#include "revng/Model/Binary.h"
+#include "revng/Model/LoadModelPass.h"
+#include "revng/Support/FunctionTags.h"
+#include "revng/Support/IRHelpers.h"
+#include "revng/UnitTestHelpers/LLVMTestHelpers.h"
+#include "revng/UnitTestHelpers/UnitTestHelpers.h"
+
+using namespace llvm;
+
+using NamesSet = std::set<std::string>;
+
+static const char *Prologue = R"LLVM(
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-pc-linux-gnu"
+
+@rax = internal global i64 0
+@rdi = internal global i64 0
+@rsi = internal global i64 0
+@pc = internal global i64 0
+
+declare void @helper_with_metadata()
+declare void @helper_without_metadata()
+
+define void @root() {
+entry:
+  br label %dispatcher
+
+dispatcher:
+  %pc = load i64, i64* @pc
+  switch i64 %pc, label %fail [ i64 4096, label %bb ], !revng.block.type !0
+
+fail:
+  unreachable, !revng.block.type !1
+
+bb:
+  %rax.value = load i64, i64* @rax
+  %inc = add i64 %rax.value, 1
+  store i64 %inc, i64* @rax
+  %rdi.value = load i64, i64* @rdi
+  store i64 %rdi.value, i64* @rsi
+)LLVM";
+
+// The helper reads rax and writes rsi
+static const char *Epilogue = R"LLVM(
+  call void @helper_with_metadata(), !revng.csvaccess.offsets.load !2,
+                                     !revng.csvaccess.offsets.store !3
+  call void @helper_without_metadata()
+  br label %dispatcher
+}
+
+!revng.csv = !{!4}
+
+!0 = !{!"RootDispatcherBlock"}
+!1 = !{!"DispatcherFailureBlock"}
+!2 = !{i32 0, !5}
+!3 = !{i32 0, !6}
+!4 = !{i64* @rax, i64* @rdi, i64* @rsi, i64* @pc}
+!5 = !{i64* @rax}
+!6 = !{i64* @rsi}
+)LLVM";
+
+static std::unique_ptr<Module>
+promote(LLVMContext &Context, const char *Body = "") {
+  auto M = parseModule(Context, std::string(Prologue) + Body + Epilogue);
+
+  for (const char *Name : { "helper_with_metadata", "helper_without_metadata" })
+    FunctionTags::Helper.addTo(M->getFunction(Name));
+
+  TupleTree<model::Binary> Binary;
+  Binary->Architecture = model::Architecture::x86_64;
+
+  runLegacyPasses(*M,
+                  new LoadModelWrapperPass(ModelWrapper(Binary)),
+                  new PromoteCSVsInRootPass());
+  return M;
+}
+
+static BasicBlock *getBlock(Module &M, StringRef Name) {
+  for (BasicBlock &BB : *M.getFunction("root"))
+    if (BB.getName() == Name)
+      return &BB;
+
+  revng_abort();
+}
+
+static CallInst *getCall(Module &M, StringRef Name) {
+  CallInst *Result = nullptr;
+  for (User *U : M.getFunction(Name)->users()) {
+    revng_check(Result == nullptr);
+    Result = cast<CallInst>(U);
+  }
+
+  revng_check(Result != nullptr);
+  return Result;
+}
+
+/// \return the names of the CSVs spilled (i.e., stored) in [From, To)
+static NamesSet
+spilled(BasicBlock::iterator From, BasicBlock::iterator To) {
+  NamesSet Result;
+  for (Instruction &I : make_range(From, To))
+    if (auto *Store = dyn_cast<StoreInst>(&I))
+      if (auto *CSV = dyn_cast<GlobalVariable>(Store->getPointerOperand()))
+        Result.insert(CSV->getName().str());
+  return Result;
+}
+
+/// \return the names of the CSVs reloaded (i.e., loaded and stored in their
+///         alloca) in [From, To)
+static NamesSet
+reloaded(BasicBlock::iterator From, BasicBlock::iterator To) {
+  NamesSet Result;
+  for (Instruction &I : make_range(From, To)) {
+    auto *Store = dyn_cast<StoreInst>(&I);
+    if (Store == nullptr or not isa<AllocaInst>(Store->getPointerOperand()))
+      continue;
+
+    if (auto *Load = dyn_cast<LoadInst>(Store->getValueOperand()))
+      if (auto *CSV = dyn_cast<GlobalVariable>(Load->getPointerOperand()))
+        Result.insert(CSV->getName().str());
+  }
+  return Result;
+}
+
+static NamesSet spilled(BasicBlock *BB) {
+  return spilled(BB->begin(), BB->end());
+}
+
+static NamesSet reloaded(BasicBlock *BB) {
+  return reloaded(BB->begin(), BB->end());
+}
+
+BOOST_AUTO_TEST_CASE(TestEntriesReloadAllPromotedCSVs) {
+  LLVMContext Context;
+  auto M = promote(Context);
+
+  // The dispatcher now jumps to the translated code through the reload block
+  BasicBlock *Reload = getBlock(*M, "bb.reload");
+  auto *Dispatcher = getBlock(*M, "dispatcher")->getTerminator();
+  revng_check(is_contained(successors(Dispatcher), Reload));
+  revng_check(not is_contained(successors(Dispatcher), getBlock(*M, "bb")));
+  revng_check(Reload->getSingleSuccessor() == getBlock(*M, "bb"));
+
+  // pc is not accessed by the translated code, therefore it's not promoted
+  revng_check(reloaded(Reload) == NamesSet({ "rax", "rdi", "rsi" }));
+  revng_check(spilled(Reload).empty());
+}
+
+BOOST_AUTO_TEST_CASE(TestExitsSpillStoredCSVs) {
+  LLVMContext Context;
+  auto M = promote(Context);
+
+  BasicBlock *Spill = getBlock(*M, "bb.spill");
+  revng_check(getBlock(*M, "bb")->getSingleSuccessor() == Spill);
+  revng_check(Spill->getSingleSuccessor() == getBlock(*M, "dispatcher"));
+
+  // rdi is only read by the translated code, it never needs to be spilled
+  revng_check(spilled(Spill) == NamesSet({ "rax", "rsi" }));
+  revng_check(reloaded(Spill).empty());
+}
+
+BOOST_AUTO_TEST_CASE(TestCallsWithAccessMetadata) {
+  LLVMContext Context;
+  auto M = promote(Context);
+
+  BasicBlock *BB = getBlock(*M, "bb");
+  CallInst *WithMetadata = getCall(*M, "helper_with_metadata");
+  CallInst *WithoutMetadata = getCall(*M, "helper_without_metadata");
+
+  // The read CSV (rax) and the written one (rsi) are spilled before the call,
+  // but only the written one is reloaded after it
+  BasicBlock::iterator Call = WithMetadata->getIterator();
+  revng_check(spilled(BB->begin(), Call) == NamesSet({ "rax", "rsi" }));
+  revng_check(reloaded(std::next(Call), WithoutMetadata->getIterator())
+              == NamesSet({ "rsi" }));
+}
+
+BOOST_AUTO_TEST_CASE(TestCallsWithoutAccessMetadata) {
+  LLVMContext Context;
+  auto M = promote(Context);
+
+  BasicBlock *BB = getBlock(*M, "bb");
+  CallInst *WithMetadata = getCall(*M, "helper_with_metadata");
+  CallInst *WithoutMetadata = getCall(*M, "helper_without_metadata");
+
+  // Nothing is known about the call: all the stored CSVs are spilled and all
+  // the promoted CSVs are reloaded
+  BasicBlock::iterator Call = WithoutMetadata->getIterator();
+  revng_check(spilled(std::next(WithMetadata->getIterator()), Call)
+              == NamesSet({ "rax", "rsi" }));
+  revng_check(reloaded(std::next(Call), BB->getTerminator()->getIterator())
+              == NamesSet({ "rax", "rdi", "rsi" }));
+}
+
+BOOST_AUTO_TEST_CASE(TestConstantExprUsersEscape) {
+  LLVMContext Context;
+  auto M = promote(Context, R"LLVM(
+  %high = load i32,
+               i32* getelementptr (i32,
+                                   i32* bitcast (i64* @rdi to i32*),
+                                   i64 1)
+)LLVM");
+
+  // rdi is accessed through a constant GEP: it cannot be promoted, and its
+  // accesses must still target the global variable
+  unsigned Allocas = 0;
+  for (Instruction &I : *getBlock(*M, "entry"))
+    if (isa<AllocaInst>(&I))
+      ++Allocas;
+  revng_check(Allocas == 2);
+
+  GlobalVariable *RDI = M->getGlobalVariable("rdi", true);
+  for (Instruction &I : *getBlock(*M, "bb")) {
+    if (I.getName() == "rdi.value") {
+      revng_check(cast<LoadInst>(&I)->getPointerOperand() == RDI);
+    } else if (I.getName() == "high") {
+      revng_check(isa<ConstantExpr>(cast<LoadInst>(&I)->getPointerOperand()));
+    }
+  }
+
+  BasicBlock *Reload = getBlock(*M, "bb.reload");
+  revng_check(reloaded(Reload) == NamesSet({ "rax", "rsi" }));
+}
@@ -2,14 +2,16 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <algorithm>
 #include <chrono>
+#include <cstdlib>
 #include <experimental/coroutine>
 #include <functional>
 #include <iostream>
 #include <vector>
 
 // TODO: increase height up to explosion
-// TODO: compare performance and peak memory
+// TODO: compare peak memory
 
 #include "revng/ADT/RecursiveCoroutine.h"
 #include "revng/Support/Assert.h"
@@ -20,7 +22,7 @@
 size_t MaxDepth = 0;
 size_t Iterations = 0;
 
-int main(int, char *[]) {
+int main(int Argc, char *Argv[]) {
 
   //
   // Run a simple recursive coroutine
@@ -66,7 +68,11 @@ int main(int, char *[]) {
 
   using namespace std::chrono;
   using us = long long;
-  const us Repeat = 1;
+
+  // Benchmarking is opt-in: pass the number of repetitions as first argument.
+  // The first repetition is a warm-up and it's not part of the average.
+  const us Repeat = Argc > 1 ? std::max(std::atoll(Argv[1]), 1LL) : 1;
+  const us Measured = std::max<us>(Repeat - 1, 1);
   us Average = 0;
 
   for (size_t I = 0; I < Repeat; I++) {
@@ -97,7 +103,7 @@ int main(int, char *[]) {
     auto End = high_resolution_clock::now();
 
     if (I != 0) {
-      Average += (duration_cast<microseconds>(End - Start).count() / Repeat);
+      Average += (duration_cast<microseconds>(End - Start).count() / Measured);
     }
 
     std::cerr << "MaxDepth: " << MaxDepth << std::endl;
@@ -129,7 +135,7 @@ int main(int, char *[]) {
     auto End = high_resolution_clock::now();
 
     if (I != 0) {
-      Average += (duration_cast<microseconds>(End - Start).count() / Repeat);
+      Average += (duration_cast<microseconds>(End - Start).count() / Measured);
     }
 
     revng_check(X == 34);
@@ -6,6 +6,7 @@
 bool init_unit_test();
 #include "boost/test/unit_test.hpp"
 
+#include "revng/ABI/Descriptor.h"
 #include "revng/ABI/RegisterStateDeductions.h"
 #include "revng/ABI/Trait.h"
 
@@ -28,6 +29,45 @@ BOOST_AUTO_TEST_CASE(RegisterStateMapTest) {
   }
 }
 
+template<model::ABI::Values A>
+static void checkDescriptor() {
+  using T = abi::Trait<A>;
+  const abi::Descriptor &Descriptor = abi::getDescriptor(A);
+  revng_check(Descriptor.ABI == A);
+  revng_check(Descriptor.ArgumentsArePositionBased
+              == T::ArgumentsArePositionBased);
+  revng_check(Descriptor.StackAlignment == T::StackAlignment);
+
+  llvm::ArrayRef GPAR = T::GeneralPurposeArgumentRegisters;
+  llvm::ArrayRef VAR = T::VectorArgumentRegisters;
+  llvm::ArrayRef GPRV = T::GeneralPurposeReturnValueRegisters;
+  llvm::ArrayRef VRVR = T::VectorReturnValueRegisters;
+  llvm::ArrayRef CSR = T::CalleeSavedRegisters;
+  revng_check(Descriptor.GeneralPurposeArgumentRegisters == GPAR);
+  revng_check(Descriptor.CalleeSavedRegisters == CSR);
+
+  auto Architecture = model::ABI::getArchitecture(A);
+  for (auto Register : model::Architecture::registers(Architecture)) {
+    bool IsArgument = llvm::is_contained(GPAR, Register)
+                      or llvm::is_contained(VAR, Register);
+    revng_check(Descriptor.isArgument(Register) == IsArgument);
+
+    bool IsReturnValue = llvm::is_contained(GPRV, Register)
+                         or llvm::is_contained(VRVR, Register);
+    revng_check(Descriptor.isReturnValue(Register) == IsReturnValue);
+
+    bool IsCalleeSaved = llvm::is_contained(CSR, Register);
+    revng_check(Descriptor.isCalleeSaved(Register) == IsCalleeSaved);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(DescriptorsMatchTraits) {
+  checkDescriptor<ABI::SystemV_x86_64>();
+  checkDescriptor<ABI::Microsoft_x86_64>();
+  checkDescriptor<ABI::AAPCS>();
+  checkDescriptor<ABI::SystemZ_s390x>();
+}
+
 BOOST_AUTO_TEST_SUITE_END();
 
 BOOST_AUTO_TEST_SUITE(PositionBasedRegisterStateDeduction);
@@ -0,0 +1,139 @@
+/// \file RegistersLattice.cpp
+/// \brief Tests for ABIAnalyses::RegistersLattice
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#define BOOST_TEST_MODULE RegistersLattice
+bool init_unit_test();
+#include "boost/test/unit_test.hpp"
+
+#include <array>
+
+#include "revng/EarlyFunctionAnalysis/Common.h"
+#include "revng/UnitTestHelpers/UnitTestHelpers.h"
+
+using namespace ABIAnalyses;
+
+/// \brief A chain lattice, Unknown < Maybe < Yes
+struct ChainLattice {
+  enum LatticeElement { Unknown, Maybe, Yes };
+  static constexpr unsigned LatticeElementsCount = 3;
+
+  static constexpr bool
+    LessOrEqualTable[LatticeElementsCount][LatticeElementsCount] = {
+      { true, true, true }, { false, true, true }, { false, false, true }
+    };
+
+  static constexpr LatticeElement
+    CombineTable[LatticeElementsCount][LatticeElementsCount] = {
+      { Unknown, Maybe, Yes }, { Maybe, Maybe, Yes }, { Yes, Yes, Yes }
+    };
+
+  /// Reading a register makes it Yes, writing it makes it Unknown
+  static constexpr auto TransferTable = [] {
+    using Row = std::array<LatticeElement, LatticeElementsCount>;
+    std::array<Row, TransferKindsCount> Result{};
+    for (Row &Identity : Result)
+      Identity = { Unknown, Maybe, Yes };
+    Result[TransferKind::Read] = { Yes, Yes, Yes };
+    Result[TransferKind::Write] = { Unknown, Unknown, Unknown };
+    return Result;
+  }();
+
+  static bool isLessOrEqual(LatticeElement LHS, LatticeElement RHS) {
+    return LessOrEqualTable[LHS][RHS];
+  }
+
+  static LatticeElement
+  combineValues(LatticeElement LHS, LatticeElement RHS) {
+    return CombineTable[LHS][RHS];
+  }
+};
+
+using Lattice = RegistersLattice<ChainLattice>;
+
+static RegisterSet registers(std::initializer_list<unsigned> Indices) {
+  RegisterSet Result;
+  for (unsigned Index : Indices)
+    Result.set(Index);
+  return Result;
+}
+
+BOOST_AUTO_TEST_CASE(TestTransfer) {
+  Lattice State(ChainLattice::Maybe);
+  State.transfer(TransferKind::Read, registers({ 0, 2 }));
+  State.transfer(TransferKind::Write, registers({ 2 }));
+
+  revng_check(State.get(0) == ChainLattice::Yes);
+  revng_check(State.get(1) == ChainLattice::Maybe);
+  revng_check(State.get(2) == ChainLattice::Unknown);
+}
+
+BOOST_AUTO_TEST_CASE(TestCombine) {
+  Lattice LHS(ChainLattice::Maybe);
+  LHS.transfer(TransferKind::Read, registers({ 0 }));
+
+  Lattice RHS(ChainLattice::Maybe);
+  RHS.transfer(TransferKind::Write, registers({ 0, 1 }));
+
+  // Each register is combined on its own, the others have the default value
+  Lattice Result = LHS.combine(RHS);
+  revng_check(Result.get(0) == ChainLattice::Yes);
+  revng_check(Result.get(1) == ChainLattice::Maybe);
+  revng_check(Result.get(2) == ChainLattice::Maybe);
+
+  // Combining is commutative
+  Lattice Swapped = RHS.combine(LHS);
+  for (unsigned Index = 0; Index < 3; ++Index)
+    revng_check(Result.get(Index) == Swapped.get(Index));
+}
+
+BOOST_AUTO_TEST_CASE(TestCombineDefaults) {
+  Lattice LHS(ChainLattice::Unknown);
+  LHS.transfer(TransferKind::Read, registers({ 0 }));
+  Lattice RHS(ChainLattice::Maybe);
+
+  // Registers not assigned in either side take the combined default
+  Lattice Result = LHS.combine(RHS);
+  revng_check(Result.get(0) == ChainLattice::Yes);
+  revng_check(Result.get(1) == ChainLattice::Maybe);
+  revng_check(Result.get(MaxABIRegisters - 1) == ChainLattice::Maybe);
+}
+
+BOOST_AUTO_TEST_CASE(TestCombineIsAnUpperBound) {
+  Lattice LHS(ChainLattice::Maybe);
+  LHS.transfer(TransferKind::Read, registers({ 0 }));
+  LHS.transfer(TransferKind::Write, registers({ 1 }));
+
+  Lattice RHS(ChainLattice::Unknown);
+  RHS.transfer(TransferKind::Read, registers({ 1 }));
+
+  Lattice Result = LHS.combine(RHS);
+  revng_check(LHS.isLessOrEqual(Result));
+  revng_check(RHS.isLessOrEqual(Result));
+  revng_check(not Result.isLessOrEqual(LHS));
+  revng_check(not Result.isLessOrEqual(RHS));
+
+  // Combining with itself does not change a lattice element
+  Lattice Idempotent = Result.combine(Result);
+  revng_check(Idempotent.isLessOrEqual(Result));
+  revng_check(Result.isLessOrEqual(Idempotent));
+}
+
+BOOST_AUTO_TEST_CASE(TestCombineTracksAssignedRegisters) {
+  std::array<llvm::GlobalVariable *, 3> Registers = {};
+
+  Lattice LHS(ChainLattice::Maybe);
+  LHS.transfer(TransferKind::Read, registers({ 0 }));
+  Lattice RHS(ChainLattice::Maybe);
+  RHS.transfer(TransferKind::Read, registers({ 2 }));
+
+  unsigned Entries = 0;
+  for (auto [Register, Value] : LHS.combine(RHS).entries(Registers)) {
+    revng_check(Value == ChainLattice::Yes);
+    ++Entries;
+  }
+  revng_check(Entries == 2);
+}
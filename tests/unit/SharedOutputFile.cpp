@@ -0,0 +1,94 @@
+/// \file SharedOutputFile.cpp
+/// \brief Tests for SharedOutputFile and BufferedOutputStream
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#define BOOST_TEST_MODULE SharedOutputFile
+bool init_unit_test();
+#include "boost/test/unit_test.hpp"
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+#include "revng/Support/Assert.h"
+#include "revng/Support/SharedOutputFile.h"
+#include "revng/Support/TemporaryFile.h"
+
+using Backend = TemporaryFile::Backend;
+
+static std::string readFile(llvm::StringRef Path) {
+  auto MaybeBuffer = llvm::MemoryBuffer::getFileAsStream(Path);
+  revng_check(MaybeBuffer);
+  return (*MaybeBuffer)->getBuffer().str();
+}
+
+BOOST_AUTO_TEST_CASE(OutputIsAppendedInChunks) {
+  TemporaryFile Temporary("revng-test", "txt", Backend::Disk);
+  SharedOutputFile File(Temporary.path());
+  {
+    BufferedOutputStream Stream(File, 8);
+
+    Stream << "abc";
+    Stream.endRecord();
+    revng_check(readFile(Temporary.path()).empty());
+
+    Stream << "defgh";
+    revng_check(readFile(Temporary.path()).empty());
+    Stream.endRecord();
+    revng_check(readFile(Temporary.path()) == "abcdefgh");
+
+    Stream << "ijk";
+    Stream.endRecord();
+    revng_check(Stream.tell() == 11);
+  }
+
+  revng_check(readFile(Temporary.path()) == "abcdefghijk");
+}
+
+BOOST_AUTO_TEST_CASE(RecordsOfDifferentThreadsAreNotInterleaved) {
+  constexpr unsigned ThreadsCount = 8;
+  constexpr unsigned RecordsCount = 1000;
+
+  TemporaryFile Temporary("revng-test", "txt", Backend::Disk);
+  {
+    SharedOutputFile File(Temporary.path());
+
+    std::vector<std::thread> Threads;
+    for (unsigned Thread = 0; Thread < ThreadsCount; ++Thread) {
+      Threads.emplace_back([&File, Thread] {
+        BufferedOutputStream Stream(File, 64);
+        for (unsigned I = 0; I < RecordsCount; ++I) {
+          // Write each record in several pieces
+          Stream << "thread " << Thread;
+          Stream << " record " << I << "\n";
+          Stream.endRecord();
+        }
+      });
+    }
+
+    for (std::thread &Thread : Threads)
+      Thread.join();
+  }
+
+  llvm::SmallVector<llvm::StringRef, 0> Lines;
+  std::string Content = readFile(Temporary.path());
+  llvm::StringRef(Content).split(Lines, '\n', -1, false);
+  revng_check(Lines.size() == ThreadsCount * RecordsCount);
+
+  // Records of the same thread keep their order
+  llvm::StringMap<unsigned> NextRecord;
+  for (llvm::StringRef Line : Lines) {
+    auto [Thread, Record] = Line.split(" record ");
+    revng_check(Thread.startswith("thread "));
+    unsigned Index = 0;
+    revng_check(not Record.getAsInteger(10, Index));
+    revng_check(NextRecord[Thread]++ == Index);
+  }
+}
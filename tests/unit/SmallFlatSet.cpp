@@ -0,0 +1,53 @@
+/// \file SmallFlatSet.cpp
+/// \brief Tests for SmallFlatSet
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <set>
+
+#define BOOST_TEST_MODULE SmallFlatSet
+bool init_unit_test();
+#include "boost/test/unit_test.hpp"
+
+#include "revng/ADT/SmallFlatSet.h"
+#include "revng/UnitTestHelpers/UnitTestHelpers.h"
+
+BOOST_AUTO_TEST_CASE(TestInsertKeepsOrder) {
+  SmallFlatSet<int64_t, 2> Set = { 4, 2, 0, 2 };
+  std::vector<int64_t> Expected = { 0, 2, 4 };
+  revng_check(Set.size() == 3);
+  revng_check(std::equal(Set.begin(), Set.end(), Expected.begin()));
+
+  revng_check(not Set.insert(4).second);
+  revng_check(Set.insert(3).second);
+  revng_check(Set.count(3) == 1);
+  revng_check(Set.count(5) == 0);
+
+  revng_check(Set.erase(0));
+  revng_check(not Set.erase(0));
+  revng_check(*Set.begin() == 2);
+}
+
+BOOST_AUTO_TEST_CASE(TestAgainstStdSet) {
+  std::mt19937 Generator(42);
+  std::uniform_int_distribution<int64_t> Distribution(-64, 64);
+
+  SmallFlatSet<int64_t> Set;
+  std::set<int64_t> Reference;
+  for (unsigned I = 0; I < 1000; ++I) {
+    int64_t Value = Distribution(Generator);
+    bool Inserted = Set.insert(Value).second;
+    revng_check(Inserted == Reference.insert(Value).second);
+  }
+
+  revng_check(Set.size() == Reference.size());
+  revng_check(std::equal(Set.begin(), Set.end(), Reference.begin()));
+
+  SmallFlatSet<int64_t> Copy(Reference.begin(), Reference.end());
+  revng_check(Copy == Set);
+}
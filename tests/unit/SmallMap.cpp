@@ -6,6 +6,10 @@
 //
 
 #include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #define BOOST_TEST_MODULE SmallMapLowerBound
 bool init_unit_test();
@@ -113,3 +117,67 @@ BOOST_AUTO_TEST_CASE(Contains) {
   revng_check(Map.contains(Value));
   revng_check(!Map.contains(Value + 1));
 }
+
+BOOST_AUTO_TEST_CASE(Grow) {
+  SmallMap<int, int, 4> Map;
+  std::map<int, int> Ref;
+  Map.reserve(64);
+
+  for (int I = 0; I < 64; ++I) {
+    int Key = (I * 37) % 64;
+    revng_check(Map.insert({ Key, I }).second);
+    Ref[Key] = I;
+    revng_check(not Map.insert({ Key, -1 }).second);
+  }
+
+  revng_check(Map.size() == Ref.size());
+  revng_check(std::equal(Map.begin(), Map.end(), Ref.begin(), Ref.end()));
+
+  Map.erase(10);
+  Ref.erase(10);
+  revng_check(not Map.contains(10));
+  revng_check(Map.lower_bound(10)->first == 11);
+  revng_check(std::equal(Map.begin(), Map.end(), Ref.begin(), Ref.end()));
+
+  Map.clear();
+  revng_check(Map.empty());
+  Map[3] = 3;
+  revng_check(Map.size() == 1 and Map.at(3) == 3);
+}
+
+BOOST_AUTO_TEST_CASE(HeterogeneousLookup) {
+  SmallMap<std::string, int, 2, std::less<>> Map;
+  Map["a"] = 1;
+  revng_check(Map.contains(std::string_view("a")));
+  revng_check(Map.count("b") == 0);
+
+  Map["b"] = 2;
+  Map["c"] = 3;
+  revng_check(Map.find(std::string_view("c"))->second == 3);
+  revng_check(Map.at("b") == 2);
+  Map.erase(std::string_view("b"));
+  revng_check(not Map.contains("b") and Map.size() == 2);
+}
+
+BOOST_AUTO_TEST_CASE(Merge) {
+  SmallMap<int, int, 2> Map;
+  Map[1] = 1;
+  Map[5] = 5;
+
+  SmallMap<int, int, 2> Other;
+  for (int I = 6; I >= 0; --I)
+    Other[I] = -I;
+
+  Map.merge(Other);
+
+  std::map<int, int> Ref = { { 0, 0 },  { 1, 1 },  { 2, -2 }, { 3, -3 },
+                             { 4, -4 }, { 5, 5 },  { 6, -6 } };
+  revng_check(std::equal(Map.begin(), Map.end(), Ref.begin(), Ref.end()));
+
+  // Duplicated keys in the range keep the first occurrence
+  std::vector<std::pair<const int, int>> Elements = { { 9, 1 },
+                                                       { 8, 1 },
+                                                       { 9, 2 } };
+  Map.insert(Elements.begin(), Elements.end());
+  revng_check(Map.size() == 9 and Map.at(9) == 1 and Map.at(8) == 1);
+}
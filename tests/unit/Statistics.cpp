@@ -0,0 +1,83 @@
+/// \file Statistics.cpp
+/// \brief Tests for the statistics collection framework
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#define BOOST_TEST_MODULE Statistics
+bool init_unit_test();
+#include "boost/test/unit_test.hpp"
+
+#include "revng/Support/Statistics.h"
+
+static void runInThreads(unsigned ThreadsCount, auto Callable) {
+  std::vector<std::thread> Threads;
+  for (unsigned I = 0; I < ThreadsCount; ++I)
+    Threads.emplace_back(Callable, I);
+  for (std::thread &Thread : Threads)
+    Thread.join();
+}
+
+BOOST_AUTO_TEST_CASE(ConcurrentCounterMap) {
+  CounterMap<std::string> Counters("");
+  constexpr unsigned ThreadsCount = 32;
+  constexpr unsigned Iterations = 1000;
+
+  runInThreads(ThreadsCount, [&Counters](unsigned Thread) {
+    for (unsigned I = 0; I < Iterations; ++I) {
+      Counters.push("all");
+      Counters.push(Thread % 2 == 0 ? "even" : "odd", 2);
+    }
+  });
+
+  auto Snapshot = Counters.snapshot();
+  revng_check(Snapshot.size() == 3);
+  revng_check(Snapshot["all"] == ThreadsCount * Iterations);
+  revng_check(Snapshot["even"] == ThreadsCount * Iterations);
+  revng_check(Snapshot["odd"] == ThreadsCount * Iterations);
+
+  std::string Dump;
+  llvm::raw_string_ostream Stream(Dump);
+  Counters.print(Stream);
+  llvm::StringRef Printed = Stream.str();
+  revng_check(Printed.count('\n') == 3);
+  revng_check(Printed.contains("  all:  32000\n"));
+  revng_check(Printed.contains("  even: 32000\n"));
+
+  Counters.clear("all");
+  revng_check(Counters.snapshot().size() == 2);
+  Counters.clear();
+  revng_check(Counters.snapshot().empty());
+}
+
+BOOST_AUTO_TEST_CASE(ConcurrentRunningStatistics) {
+  RunningStatistics Statistics;
+  constexpr unsigned ThreadsCount = 8;
+
+  // Thread I pushes I + 1 values, all equal to I
+  runInThreads(ThreadsCount, [&Statistics](unsigned Thread) {
+    for (unsigned I = 0; I <= Thread; ++I)
+      Statistics.push(Thread);
+  });
+
+  RunningStatistics Reference;
+  for (unsigned Thread = 0; Thread < ThreadsCount; ++Thread)
+    for (unsigned I = 0; I <= Thread; ++I)
+      Reference.push(Thread);
+
+  revng_check(Statistics.size() == 36);
+  revng_check(Statistics.sum() == Reference.sum());
+  revng_check(std::abs(Statistics.mean() - Reference.mean()) < 1e-9);
+  revng_check(std::abs(Statistics.variance() - Reference.variance()) < 1e-9);
+
+  // Mean of Thread weighted by Thread + 1 is 168 / 36
+  revng_check(std::abs(Reference.mean() - 168.0 / 36.0) < 1e-9);
+
+  Statistics.clear();
+  revng_check(Statistics.size() == 0 and Statistics.mean() == 0.0);
+}
@@ -0,0 +1,170 @@
+/// \file StringMapContainer.cpp
+/// \brief Tests for the StringMapContainer
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <string>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+#define BOOST_TEST_MODULE StringMapContainer
+bool init_unit_test();
+#include "boost/test/unit_test.hpp"
+
+#include "revng/Pipeline/Kind.h"
+#include "revng/Pipeline/Rank.h"
+#include "revng/Pipes/StringMapContainer.h"
+#include "revng/Support/Assert.h"
+#include "revng/Support/CommandLine.h"
+#include "revng/Support/MetaAddress.h"
+#include "revng/UnitTestHelpers/UnitTestHelpers.h"
+
+using namespace pipeline;
+using namespace revng::pipes;
+
+static Rank TestRoot("TestRoot");
+static Rank TestFunctionRank("TestFunction", TestRoot);
+static Kind TestFunctionKind("TestFunctionKind", &TestFunctionRank);
+
+static const MetaAddress A1000(0x1000, MetaAddressType::Code_x86_64);
+static const MetaAddress A2000(0x2000, MetaAddressType::Code_x86_64);
+static const MetaAddress A3000(0x3000, MetaAddressType::Code_x86_64);
+
+static llvm::cl::opt<bool> &getBinaryStringMaps() {
+  auto &Options = llvm::cl::getRegisteredOptions();
+  auto Option = Options.find("binary-string-maps");
+  revng_check(Option != Options.end());
+  return *static_cast<llvm::cl::opt<bool> *>(Option->second);
+}
+
+static void setBinaryStringMaps(bool Value) {
+  getBinaryStringMaps().setValue(Value);
+}
+
+static std::string makeTemporaryPath() {
+  llvm::SmallString<128> Path;
+  auto ErrorCode = llvm::sys::fs::createTemporaryFile("revng-string-map",
+                                                      "",
+                                                      Path);
+  revng_check(not ErrorCode);
+  return Path.str().str();
+}
+
+static StringMapContainer makeContainer() {
+  StringMapContainer Container("strings", TestFunctionKind);
+  Container.insert(A2000, "second");
+  Container.insert(A1000, "first");
+  Container.insert(A3000, "");
+  return Container;
+}
+
+static void checkContent(const StringMapContainer &Container) {
+  BOOST_TEST(Container.size() == 3U);
+  BOOST_TEST((*Container.get(A1000) == "first"));
+  BOOST_TEST((*Container.get(A2000) == "second"));
+  BOOST_TEST(Container.get(A3000)->empty());
+  BOOST_TEST(not Container.get(MetaAddress(0x4000,
+                                           MetaAddressType::Code_x86_64)));
+}
+
+static void checkRoundTrip(bool Binary) {
+  setBinaryStringMaps(Binary);
+  std::string Path = makeTemporaryPath();
+
+  StringMapContainer Original = makeContainer();
+  BOOST_TEST(not Original.storeToDisk(Path));
+
+  auto MaybeBuffer = llvm::MemoryBuffer::getFile(Path);
+  revng_check(MaybeBuffer);
+  BOOST_TEST((*MaybeBuffer)->getBuffer().startswith("RVNGSMAP") == Binary);
+
+  StringMapContainer Loaded("strings", TestFunctionKind);
+  BOOST_TEST(not Loaded.loadFromDisk(Path));
+  checkContent(Loaded);
+
+  // Containers loaded from either format can be deserialized from memory too
+  StringMapContainer Deserialized("strings", TestFunctionKind);
+  BOOST_TEST(not Deserialized.deserialize(**MaybeBuffer));
+  checkContent(Deserialized);
+
+  setBinaryStringMaps(false);
+  llvm::sys::fs::remove(Path);
+}
+
+BOOST_AUTO_TEST_CASE(BinaryStringMapsIsListedInTheMainCategory) {
+  BOOST_TEST(llvm::is_contained(getBinaryStringMaps().Categories,
+                                &MainCategory));
+}
+
+BOOST_AUTO_TEST_CASE(YAMLStringMapsRoundTrip) {
+  checkRoundTrip(false);
+}
+
+BOOST_AUTO_TEST_CASE(BinaryStringMapsRoundTrip) {
+  checkRoundTrip(true);
+}
+
+BOOST_AUTO_TEST_CASE(BinaryStringMapsOfPageSizeCanBeLoaded) {
+  // Files whose size is a multiple of the page size are mapped without a
+  // null terminator
+  setBinaryStringMaps(true);
+  std::string Path = makeTemporaryPath();
+
+  // Header, one entry and the string
+  StringMapContainer Original("strings", TestFunctionKind);
+  Original.insert(A1000, std::string(4096 - 16 - 32, 'a'));
+  BOOST_TEST(not Original.storeToDisk(Path));
+
+  uint64_t Size = 0;
+  BOOST_TEST(not llvm::sys::fs::file_size(Path, Size));
+  BOOST_TEST(Size == 4096U);
+
+  StringMapContainer Loaded("strings", TestFunctionKind);
+  BOOST_TEST(not Loaded.loadFromDisk(Path));
+  BOOST_TEST(Loaded.get(A1000)->size() == 4096U - 16 - 32);
+
+  setBinaryStringMaps(false);
+  llvm::sys::fs::remove(Path);
+}
+
+BOOST_AUTO_TEST_CASE(TruncatedBinaryStringMapsAreRejected) {
+  setBinaryStringMaps(true);
+  std::string Serialized;
+  {
+    llvm::raw_string_ostream Stream(Serialized);
+    BOOST_TEST(not makeContainer().serialize(Stream));
+  }
+  setBinaryStringMaps(false);
+
+  llvm::StringRef Truncated = llvm::StringRef(Serialized).drop_back(1);
+  auto Buffer = llvm::MemoryBuffer::getMemBuffer(Truncated, "", false);
+  StringMapContainer Loaded("strings", TestFunctionKind);
+  auto Error = Loaded.deserialize(*Buffer);
+  BOOST_TEST(static_cast<bool>(Error));
+  llvm::consumeError(std::move(Error));
+}
+
+BOOST_AUTO_TEST_CASE(StringMapsCanBeFilteredAndMerged) {
+  StringMapContainer Container = makeContainer();
+
+  TargetsList Targets;
+  Targets.push_back(Target(A2000.toString(), TestFunctionKind));
+  auto Clone = Container.cloneFiltered(Targets);
+  auto &Filtered = llvm::cast<StringMapContainer>(*Clone);
+  BOOST_TEST(Filtered.size() == 1U);
+  BOOST_TEST((*Filtered.get(A2000) == "second"));
+
+  // Entries of the merged container win
+  Filtered.insert(A2000, "updated");
+  Container.mergeBack(std::move(*Clone));
+  BOOST_TEST(Container.size() == 3U);
+  BOOST_TEST((*Container.get(A1000) == "first"));
+  BOOST_TEST((*Container.get(A2000) == "updated"));
+}
@@ -0,0 +1,116 @@
+/// \file TaskScheduler.cpp
+/// \brief Tests for TaskScheduler
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define BOOST_TEST_MODULE TaskScheduler
+bool init_unit_test();
+#include "boost/test/unit_test.hpp"
+
+#include "revng/Support/Assert.h"
+#include "revng/Support/TaskScheduler.h"
+
+BOOST_AUTO_TEST_CASE(AllTasksAreRun) {
+  TaskScheduler Scheduler(4);
+  revng_check(Scheduler.getThreadsCount() == 4);
+
+  std::atomic<unsigned> Sum = 0;
+  {
+    TaskGroup Group(Scheduler);
+    for (unsigned I = 1; I <= 1000; ++I)
+      Group.spawn([&Sum, I] { Sum += I; });
+  }
+
+  revng_check(Sum == 1000 * 1001 / 2);
+  revng_check(Scheduler.spawnedCount() == 1000);
+  revng_check(Scheduler.queueDepth() == 0);
+}
+
+BOOST_AUTO_TEST_CASE(SingleThreadRunsInTheWaitingThread) {
+  TaskScheduler Scheduler(1);
+  revng_check(Scheduler.getThreadsCount() == 1);
+
+  std::vector<std::thread::id> Threads;
+  TaskGroup Group(Scheduler);
+  for (unsigned I = 0; I < 10; ++I)
+    Group.spawn([&Threads] { Threads.push_back(std::this_thread::get_id()); });
+
+  // Nothing runs until someone waits
+  revng_check(Threads.empty());
+  revng_check(Scheduler.queueDepth() == 10);
+
+  Group.wait();
+  revng_check(Threads.size() == 10);
+  for (std::thread::id Thread : Threads)
+    revng_check(Thread == std::this_thread::get_id());
+}
+
+BOOST_AUTO_TEST_CASE(TasksCanWaitForNestedGroups) {
+  TaskScheduler Scheduler(3);
+
+  // Each task holds a lock shared with the others while waiting for its own
+  // subtasks: waiting must not pick up the tasks of other groups
+  std::mutex SharedLock;
+  std::atomic<unsigned> Count = 0;
+  {
+    TaskGroup Outer(Scheduler);
+    for (unsigned I = 0; I < 16; ++I) {
+      Outer.spawn([&] {
+        std::lock_guard<std::mutex> Guard(SharedLock);
+        TaskGroup Inner(Scheduler);
+        for (unsigned J = 0; J < 16; ++J)
+          Inner.spawn([&Count] { ++Count; }, &Inner);
+        Inner.wait();
+      });
+    }
+  }
+
+  revng_check(Count == 16 * 16);
+}
+
+BOOST_AUTO_TEST_CASE(CancelledTasksAreDropped) {
+  TaskScheduler Scheduler(1);
+
+  unsigned Run = 0;
+  TaskGroup Group(Scheduler);
+  for (unsigned I = 0; I < 10; ++I)
+    Group.spawn([&Run] { ++Run; });
+
+  Group.cancel();
+  revng_check(Group.isCancelled());
+  Group.wait();
+
+  revng_check(Run == 0);
+  revng_check(Scheduler.cancelledCount() == 10);
+}
+
+BOOST_AUTO_TEST_CASE(IdleWorkersStealTasks) {
+  TaskScheduler Scheduler(4);
+
+  // All the tasks have the same affinity, hence they end up in the deque of
+  // the same worker: the other threads can only get them by stealing
+  int Data = 0;
+  std::atomic<unsigned> Count = 0;
+  {
+    TaskGroup Group(Scheduler);
+    for (unsigned I = 0; I < 64; ++I) {
+      Group.spawn(
+        [&Count] {
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+          ++Count;
+        },
+        &Data);
+    }
+  }
+
+  revng_check(Count == 64);
+  revng_check(Scheduler.stealsCount() > 0);
+}
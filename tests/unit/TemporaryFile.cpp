@@ -0,0 +1,89 @@
+/// \file TemporaryFile.cpp
+/// \brief Tests for TemporaryFile
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <cstdint>
+#include <string>
+
+#define BOOST_TEST_MODULE TemporaryFile
+bool init_unit_test();
+#include "boost/test/unit_test.hpp"
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Program.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "revng/Support/Assert.h"
+#include "revng/Support/IRHelpers.h"
+#include "revng/Support/TemporaryFile.h"
+
+using Backend = TemporaryFile::Backend;
+
+static void writeAndReadBack(const TemporaryFile &File) {
+  {
+    std::error_code EC;
+    llvm::raw_fd_ostream Stream(File.path(), EC);
+    revng_check(not EC);
+    Stream << "content";
+  }
+
+  auto MaybeBuffer = llvm::MemoryBuffer::getFileAsStream(File.path());
+  revng_check(MaybeBuffer);
+  revng_check((*MaybeBuffer)->getBuffer() == "content");
+}
+
+BOOST_AUTO_TEST_CASE(DiskFilesAreRemoved) {
+  std::string Path;
+  {
+    TemporaryFile File("revng-test", "txt", Backend::Disk);
+    revng_check(not File.isInMemory());
+    revng_check(llvm::StringRef(File.path()).endswith(".txt"));
+    writeAndReadBack(File);
+    Path = File.path().str();
+  }
+
+  revng_check(not llvm::sys::fs::exists(Path));
+}
+
+BOOST_AUTO_TEST_CASE(MemoryFilesCanBeOpenedByPath) {
+  auto &Options = llvm::cl::getRegisteredOptions();
+  auto *Threshold = getOption<uint64_t>(Options,
+                                        "temporary-files-min-available-memory");
+  Threshold->setValue(0);
+
+  std::string Path;
+  {
+    TemporaryFile File("revng-test", "txt", Backend::Memory);
+    revng_check(File.isInMemory());
+    writeAndReadBack(File);
+
+    // Child processes can read it too
+    std::string Script = "test \"$(cat " + File.path().str() + ")\" = content";
+    int ExitCode = llvm::sys::ExecuteAndWait("/bin/sh", { "sh", "-c", Script });
+    revng_check(ExitCode == 0);
+
+    // Moving the file around does not release it
+    TemporaryFile Moved(std::move(File));
+    revng_check(Moved.isInMemory());
+    Path = Moved.path().str();
+    revng_check(llvm::sys::fs::exists(Path));
+  }
+
+  revng_check(not llvm::sys::fs::exists(Path));
+}
+
+BOOST_AUTO_TEST_CASE(MemoryFilesFallBackToDisk) {
+  auto &Options = llvm::cl::getRegisteredOptions();
+  auto *Threshold = getOption<uint64_t>(Options,
+                                        "temporary-files-min-available-memory");
+  Threshold->setValue(UINT64_MAX);
+
+  TemporaryFile File("revng-test", "txt", Backend::Memory);
+  revng_check(not File.isInMemory());
+  writeAndReadBack(File);
+}
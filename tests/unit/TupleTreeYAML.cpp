@@ -0,0 +1,349 @@
+/// \file TupleTreeYAML.cpp
+/// \brief Tests for the specialized YAML emitter and parser of tuple trees
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define BOOST_TEST_MODULE TupleTreeYAML
+bool init_unit_test();
+#include "boost/test/unit_test.hpp"
+
+#include "llvm/Support/YAMLTraits.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "revng/ADT/SortedVector.h"
+#include "revng/ADT/UpcastablePointer.h"
+#include "revng/ADT/UpcastablePointer/YAMLTraits.h"
+#include "revng/Support/Assert.h"
+#include "revng/Support/YAMLTraits.h"
+#include "revng/TupleTree/Introspection.h"
+#include "revng/TupleTree/TupleTree.h"
+#include "revng/TupleTree/YAMLSerialization.h"
+#include "revng/UnitTestHelpers/UnitTestHelpers.h"
+
+// Polymorphic types are matched against the Kind key by their unqualified
+// name
+enum class ShapeKind { Invalid, Circle, Square };
+
+class Shape {
+public:
+  ShapeKind Kind = ShapeKind::Invalid;
+  uint64_t ID = 0;
+
+public:
+  Shape(ShapeKind Kind) : Kind(Kind) {}
+  static bool classof(const Shape *) { return true; }
+};
+
+class Circle : public Shape {
+public:
+  uint64_t Radius = 0;
+
+public:
+  Circle() : Shape(ShapeKind::Circle) {}
+  static bool classof(const Shape *S) { return S->Kind == ShapeKind::Circle; }
+};
+
+class Square : public Shape {
+public:
+  std::string Label;
+  std::vector<uint64_t> Sides;
+
+public:
+  Square() : Shape(ShapeKind::Square) {}
+  static bool classof(const Shape *S) { return S->Kind == ShapeKind::Square; }
+};
+
+namespace TestYAML {
+
+class Point {
+public:
+  uint64_t Key = 0;
+  int64_t X = 0;
+  bool Visible = false;
+  std::string Name;
+  std::vector<uint64_t> Weights;
+};
+
+class Pair {
+public:
+  int64_t First = 0;
+  int64_t Second = 0;
+
+  bool operator==(const Pair &) const = default;
+};
+
+} // namespace TestYAML
+
+using namespace TestYAML;
+
+template<>
+struct concrete_types_traits<Shape> {
+  using type = std::tuple<Circle, Square>;
+};
+
+template<>
+struct KeyedObjectTraits<Point> {
+  static uint64_t key(const Point &Obj) { return Obj.Key; }
+  static Point fromKey(uint64_t Key) {
+    Point Result;
+    Result.Key = Key;
+    return Result;
+  }
+};
+
+template<>
+struct KeyedObjectTraits<UpcastablePointer<Shape>> {
+  using Pointer = UpcastablePointer<Shape>;
+  static uint64_t key(const Pointer &Obj) { return Obj->ID; }
+  static Pointer fromKey(uint64_t Key) {
+    auto Result = Pointer::make<Circle>();
+    Result->ID = Key;
+    return Result;
+  }
+};
+
+namespace TestYAML {
+
+class Root {
+public:
+  std::string Name;
+  ShapeKind Favorite = ShapeKind::Invalid;
+  Pair Optional;
+  Pair Required;
+  SortedVector<Point> Points;
+  std::vector<Pair> Pairs;
+  std::vector<uint64_t> Numbers;
+  SortedVector<UpcastablePointer<Shape>> Shapes;
+};
+
+} // namespace TestYAML
+
+template<>
+struct llvm::yaml::ScalarEnumerationTraits<ShapeKind> {
+  template<typename IOType>
+  static void enumeration(IOType &IO, ShapeKind &Value) {
+    IO.enumCase(Value, "Invalid", ShapeKind::Invalid);
+    IO.enumCase(Value, "Circle", ShapeKind::Circle);
+    IO.enumCase(Value, "Square", ShapeKind::Square);
+  }
+};
+
+INTROSPECTION(Circle, Kind, ID, Radius);
+INTROSPECTION(Square, Kind, ID, Label, Sides);
+INTROSPECTION_NS(TestYAML, Point, Key, X, Visible, Name, Weights);
+INTROSPECTION_NS(TestYAML, Pair, First, Second);
+INTROSPECTION_NS(TestYAML,
+                 Root,
+                 Name,
+                 Favorite,
+                 Optional,
+                 Required,
+                 Points,
+                 Pairs,
+                 Numbers,
+                 Shapes);
+
+template<>
+struct llvm::yaml::MappingTraits<Circle>
+  : public TupleLikeMappingTraits<Circle> {};
+
+template<>
+struct llvm::yaml::MappingTraits<Square>
+  : public TupleLikeMappingTraits<Square,
+                                  TupleLikeTraits<Square>::Fields::Sides> {};
+
+template<>
+struct llvm::yaml::MappingTraits<UpcastablePointer<Shape>>
+  : public PolymorphicMappingTraits<UpcastablePointer<Shape>> {};
+
+template<>
+struct llvm::yaml::MappingTraits<Point>
+  : public TupleLikeMappingTraits<Point,
+                                  TupleLikeTraits<Point>::Fields::X,
+                                  TupleLikeTraits<Point>::Fields::Weights> {};
+
+template<>
+struct llvm::yaml::MappingTraits<Pair>
+  : public TupleLikeMappingTraits<Pair,
+                                  TupleLikeTraits<Pair>::Fields::First,
+                                  TupleLikeTraits<Pair>::Fields::Second> {};
+
+template<>
+struct llvm::yaml::MappingTraits<Root>
+  : public TupleLikeMappingTraits<Root,
+                                  TupleLikeTraits<Root>::Fields::Optional> {};
+
+LLVM_YAML_IS_SEQUENCE_VECTOR(Pair)
+
+static_assert(tupletree::yaml::IsSupported<Root>);
+static_assert(not tupletree::yaml::IsSupported<std::vector<Root>>);
+
+static Root makeRoot() {
+  Root Result;
+  Result.Name = "it's a \"name\": with\nspecial characters";
+  Result.Favorite = ShapeKind::Square;
+  Result.Required = { -1, 0 };
+
+  Point &First = Result.Points[1];
+  First.X = -42;
+  First.Visible = true;
+  First.Name = "true";
+  First.Weights = { 1, 2, 3 };
+
+  Point &Second = Result.Points[2];
+  Second.Name = "";
+
+  Point &Third = Result.Points[3];
+  Third.Name = "plain text";
+  for (uint64_t I = 0; I < 40; ++I)
+    Third.Weights.push_back(I * 1000);
+
+  Result.Pairs = { { 0, 0 }, { 1, 2 }, { 0, 3 } };
+
+  auto MakeCircle = [](uint64_t ID, uint64_t Radius) {
+    auto Result = UpcastablePointer<Shape>::make<Circle>();
+    Result->ID = ID;
+    llvm::cast<Circle>(Result.get())->Radius = Radius;
+    return Result;
+  };
+  Result.Shapes.insert(MakeCircle(10, 5));
+
+  auto ASquare = UpcastablePointer<Shape>::make<Square>();
+  ASquare->ID = 11;
+  llvm::cast<Square>(ASquare.get())->Label = "Ünïcode";
+  llvm::cast<Square>(ASquare.get())->Sides = { 4, 4 };
+  Result.Shapes.insert(ASquare);
+
+  return Result;
+}
+
+static std::string emitWithLLVM(Root &Value) {
+  std::string Buffer;
+  {
+    llvm::raw_string_ostream Stream(Buffer);
+    llvm::yaml::Output YAMLOutput(Stream);
+    YAMLOutput << Value;
+  }
+  return Buffer;
+}
+
+static std::string emit(const Root &Value) {
+  std::string Buffer;
+  {
+    llvm::raw_string_ostream Stream(Buffer);
+    tupletree::yaml::serialize(Stream, Value);
+  }
+  return Buffer;
+}
+
+BOOST_AUTO_TEST_CASE(EmitterMatchesLLVM) {
+  Root Value = makeRoot();
+  BOOST_TEST(emit(Value) == emitWithLLVM(Value));
+
+  Root Empty;
+  Empty.Name = "x";
+  BOOST_TEST(emit(Empty) == emitWithLLVM(Empty));
+}
+
+BOOST_AUTO_TEST_CASE(ParserRoundTrips) {
+  Root Value = makeRoot();
+  std::string YAML = emit(Value);
+
+  Root Parsed;
+  BOOST_TEST(tupletree::yaml::deserialize(YAML, Parsed));
+  BOOST_TEST(emit(Parsed) == YAML);
+
+  // The concrete types of the upcastable pointers are preserved
+  BOOST_TEST(llvm::isa<Square>(Parsed.Shapes.at(11).get()));
+  BOOST_TEST(Parsed.Points.at(3).Weights.size() == 40U);
+}
+
+BOOST_AUTO_TEST_CASE(ParserAcceptsHandWrittenYAML) {
+  llvm::StringRef YAML = R"(
+# A comment
+Name: 'single ''quoted'''
+Favorite: Circle   # Another comment
+Required: {}
+Points:
+- Key: 7
+  Visible: true
+  Name: "\x41é"
+  Weights: [ 1,
+             2 ]
+
+Pairs: []
+Numbers: [  ]
+Shapes:
+  - ID: 3
+    Kind: Square
+    Label: s
+)";
+
+  Root Parsed;
+  BOOST_TEST(tupletree::yaml::deserialize(YAML, Parsed));
+  BOOST_TEST(Parsed.Name == "single 'quoted'");
+  BOOST_TEST((Parsed.Favorite == ShapeKind::Circle));
+  BOOST_TEST(Parsed.Points.at(7).Name == "A\xC3\xA9");
+  BOOST_TEST(Parsed.Points.at(7).Weights.size() == 2U);
+  BOOST_TEST(llvm::isa<Square>(Parsed.Shapes.at(3).get()));
+}
+
+BOOST_AUTO_TEST_CASE(ParserRejectsUnsupportedYAML) {
+  const std::string Rest = "Favorite: Circle\nPoints: []\nPairs: []\n"
+                           "Numbers: []\nShapes: []\n";
+
+  auto Parse = [](const std::string &Document) {
+    Root Parsed;
+    return tupletree::yaml::deserialize(Document, Parsed);
+  };
+
+  BOOST_TEST(Parse("Name: x\nRequired: {}\n" + Rest));
+
+  // Missing required key
+  BOOST_TEST(not Parse("Name: x\n" + Rest));
+
+  // Unknown key
+  BOOST_TEST(not Parse("Name: x\nRequired: {}\nUnknown: 1\n" + Rest));
+
+  // Flow mappings
+  BOOST_TEST(not Parse("Name: x\nRequired: { First: 1 }\n" + Rest));
+
+  // Anchors
+  BOOST_TEST(not Parse("Name: &a x\nRequired: {}\n" + Rest));
+
+  // Multi-line plain scalars
+  BOOST_TEST(not Parse("Name: x\n  y\nRequired: {}\n" + Rest));
+
+  // Null values
+  BOOST_TEST(not Parse("Name:\nRequired: {}\n" + Rest));
+
+  // Invalid enumeration value
+  BOOST_TEST(not Parse("Name: x\nRequired: {}\nFavorite: Triangle\n"
+                       "Points: []\nPairs: []\nNumbers: []\nShapes: []\n"));
+}
+
+BOOST_AUTO_TEST_CASE(TupleTreesUseTheParser) {
+  Root Value = makeRoot();
+  std::string YAML = emit(Value);
+
+  auto MaybeTree = TupleTree<Root>::deserialize(YAML);
+  BOOST_TEST(!!MaybeTree);
+
+  std::string Buffer;
+  MaybeTree->serialize(Buffer);
+  BOOST_TEST(Buffer == YAML);
+
+  // Documents the parser does not handle go through llvm::yaml::Input
+  auto MaybeFlow = TupleTree<Root>::deserialize("{ Name: x, Favorite: Circle, "
+                                                "Required: {}, Points: [], "
+                                                "Pairs: [], Numbers: [], "
+                                                "Shapes: [] }");
+  BOOST_TEST(!!MaybeFlow);
+  BOOST_TEST((*MaybeFlow)->Name == "x");
+}
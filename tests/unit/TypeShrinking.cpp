@@ -0,0 +1,76 @@
+/// \file TypeShrinking.cpp
+/// \brief Tests for ParallelTypeShrinkingPass
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#define BOOST_TEST_MODULE TypeShrinking
+bool init_unit_test();
+#include "boost/test/unit_test.hpp"
+
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+
+#include "revng/Support/FunctionTags.h"
+#include "revng/Support/IRHelpers.h"
+#include "revng/TypeShrinking/TypeShrinking.h"
+#include "revng/UnitTestHelpers/LLVMTestHelpers.h"
+#include "revng/UnitTestHelpers/UnitTestHelpers.h"
+
+using namespace llvm;
+
+// Only the lowest 16 bits of the sums are used
+static const char *ModuleIR = R"LLVM(
+@result = global i16 0
+
+define void @first(i64 %a, i64 %b) {
+  %sum = add i64 %a, %b
+  %truncated = trunc i64 %sum to i16
+  store i16 %truncated, i16* @result
+  ret void
+}
+
+define void @second(i64 %a, i64 %b) {
+  %sum = mul i64 %a, %b
+  %truncated = trunc i64 %sum to i16
+  store i16 %truncated, i16* @result
+  ret void
+}
+
+define void @not_isolated(i64 %a, i64 %b) {
+  %sum = add i64 %a, %b
+  %truncated = trunc i64 %sum to i16
+  store i16 %truncated, i16* @result
+  ret void
+}
+)LLVM";
+
+/// \return the width of the only binary operator in \p F
+static unsigned binaryOperatorWidth(Function &F) {
+  unsigned Result = 0;
+  for (Instruction &I : F.getEntryBlock()) {
+    if (isa<BinaryOperator>(&I)) {
+      revng_check(Result == 0);
+      Result = I.getType()->getIntegerBitWidth();
+    }
+  }
+
+  revng_check(Result != 0);
+  return Result;
+}
+
+BOOST_AUTO_TEST_CASE(TestIsolatedFunctionsAreShrunk) {
+  LLVMContext Context;
+  auto M = parseModule(Context, ModuleIR);
+
+  for (const char *Name : { "first", "second" })
+    FunctionTags::Isolated.addTo(M->getFunction(Name));
+
+  runLegacyPasses(*M, new TypeShrinking::ParallelTypeShrinkingPass());
+
+  revng_check(binaryOperatorWidth(*M->getFunction("first")) == 16);
+  revng_check(binaryOperatorWidth(*M->getFunction("second")) == 16);
+  revng_check(binaryOperatorWidth(*M->getFunction("not_isolated")) == 64);
+}
@@ -47,6 +47,18 @@ target_link_libraries(test_irhelpers revngSupport revngUnitTestHelpers
 add_test(NAME test_irhelpers COMMAND ./test_irhelpers)
 set_tests_properties(test_irhelpers PROPERTIES LABELS "unit")
 
+#
+# test_localvaluecache
+#
+
+revng_add_test_executable(test_localvaluecache "${SRC}/LocalValueCache.cpp")
+target_compile_definitions(test_localvaluecache PRIVATE "BOOST_TEST_DYN_LINK=1")
+target_include_directories(test_localvaluecache PRIVATE "${CMAKE_SOURCE_DIR}")
+target_link_libraries(test_localvaluecache revngSupport revngUnitTestHelpers
+                      Boost::unit_test_framework ${LLVM_LIBRARIES})
+add_test(NAME test_localvaluecache COMMAND ./test_localvaluecache)
+set_tests_properties(test_localvaluecache PROPERTIES LABELS "unit")
+
 #
 # test_irhelpers
 #
@@ -60,6 +72,86 @@ target_link_libraries(test_advancedvalueinfo revngSupport revngBasicAnalyses
 add_test(NAME test_advancedvalueinfo COMMAND ./test_advancedvalueinfo)
 set_tests_properties(test_advancedvalueinfo PROPERTIES LABELS "unit")
 
+#
+# test_generatedcodebasicinfo
+#
+
+revng_add_test_executable(test_generatedcodebasicinfo
+                          "${SRC}/GeneratedCodeBasicInfo.cpp")
+target_compile_definitions(test_generatedcodebasicinfo
+                           PRIVATE "BOOST_TEST_DYN_LINK=1")
+target_include_directories(test_generatedcodebasicinfo
+                           PRIVATE "${CMAKE_SOURCE_DIR}")
+target_link_libraries(
+  test_generatedcodebasicinfo
+  revngSupport
+  revngModel
+  revngBasicAnalyses
+  Boost::unit_test_framework
+  ${LLVM_LIBRARIES})
+add_test(NAME test_generatedcodebasicinfo COMMAND ./test_generatedcodebasicinfo)
+set_tests_properties(test_generatedcodebasicinfo PROPERTIES LABELS "unit")
+
+#
+# test_csvaliasanalysis
+#
+
+revng_add_test_executable(test_csvaliasanalysis "${SRC}/CSVAliasAnalysis.cpp")
+target_compile_definitions(test_csvaliasanalysis
+                           PRIVATE "BOOST_TEST_DYN_LINK=1")
+target_include_directories(test_csvaliasanalysis PRIVATE "${CMAKE_SOURCE_DIR}")
+target_link_libraries(
+  test_csvaliasanalysis
+  revngSupport
+  revngModel
+  revngBasicAnalyses
+  revngUnitTestHelpers
+  Boost::unit_test_framework
+  ${LLVM_LIBRARIES})
+add_test(NAME test_csvaliasanalysis COMMAND ./test_csvaliasanalysis)
+set_tests_properties(test_csvaliasanalysis PROPERTIES LABELS "unit")
+
+#
+# test_promotecsvs
+#
+
+revng_add_test_executable(test_promotecsvs "${SRC}/PromoteCSVs.cpp")
+target_compile_definitions(test_promotecsvs PRIVATE "BOOST_TEST_DYN_LINK=1")
+target_include_directories(test_promotecsvs PRIVATE "${CMAKE_SOURCE_DIR}")
+target_link_libraries(
+  test_promotecsvs
+  revngSupport
+  revngModel
+  revngBasicAnalyses
+  revngFunctionIsolation
+  revngUnitTestHelpers
+  Boost::unit_test_framework
+  ${LLVM_LIBRARIES})
+add_test(NAME test_promotecsvs COMMAND ./test_promotecsvs)
+set_tests_properties(test_promotecsvs PROPERTIES LABELS "unit")
+
+#
+# test_promotecsvsinroot
+#
+
+revng_add_test_executable(test_promotecsvsinroot
+                          "${SRC}/PromoteCSVsInRoot.cpp")
+target_compile_definitions(test_promotecsvsinroot
+                           PRIVATE "BOOST_TEST_DYN_LINK=1")
+target_include_directories(test_promotecsvsinroot
+                           PRIVATE "${CMAKE_SOURCE_DIR}")
+target_link_libraries(
+  test_promotecsvsinroot
+  revngSupport
+  revngModel
+  revngBasicAnalyses
+  revngFunctionIsolation
+  revngUnitTestHelpers
+  Boost::unit_test_framework
+  ${LLVM_LIBRARIES})
+add_test(NAME test_promotecsvsinroot COMMAND ./test_promotecsvsinroot)
+set_tests_properties(test_promotecsvsinroot PROPERTIES LABELS "unit")
+
 #
 # test_zipmapiterator
 #
@@ -102,6 +194,23 @@ add_test(NAME test_shrinkinstructionoperands
          COMMAND ./test_shrinkinstructionoperands)
 set_tests_properties(test_shrinkinstructionoperands PROPERTIES LABELS "unit")
 
+#
+# test_ircleanup
+#
+
+revng_add_test_executable(test_ircleanup "${SRC}/IRCleanup.cpp")
+target_compile_definitions(test_ircleanup PRIVATE "BOOST_TEST_DYN_LINK=1")
+target_include_directories(test_ircleanup PRIVATE "${CMAKE_SOURCE_DIR}")
+target_link_libraries(
+  test_ircleanup
+  revngSupport
+  revngBasicAnalyses
+  revngUnitTestHelpers
+  Boost::unit_test_framework
+  ${LLVM_LIBRARIES})
+add_test(NAME test_ircleanup COMMAND ./test_ircleanup)
+set_tests_properties(test_ircleanup PROPERTIES LABELS "unit")
+
 #
 # test_metaaddress
 #
@@ -132,6 +241,31 @@ add_test(NAME test_filtered_graph_traits COMMAND ./test_filtered_graph_traits
                                                  -- "${SRC}/test_graphs/")
 set_tests_properties(test_filtered_graph_traits PROPERTIES LABELS "unit")
 
+#
+# test_flat_interval_set
+#
+
+revng_add_test_executable(test_flat_interval_set "${SRC}/FlatIntervalSet.cpp")
+target_compile_definitions(test_flat_interval_set
+                           PRIVATE "BOOST_TEST_DYN_LINK=1")
+target_include_directories(test_flat_interval_set PRIVATE "${CMAKE_SOURCE_DIR}")
+target_link_libraries(test_flat_interval_set revngSupport revngUnitTestHelpers
+                      Boost::unit_test_framework ${LLVM_LIBRARIES})
+add_test(NAME test_flat_interval_set COMMAND ./test_flat_interval_set)
+set_tests_properties(test_flat_interval_set PROPERTIES LABELS "unit")
+
+#
+# test_small_flat_set
+#
+
+revng_add_test_executable(test_small_flat_set "${SRC}/SmallFlatSet.cpp")
+target_compile_definitions(test_small_flat_set PRIVATE "BOOST_TEST_DYN_LINK=1")
+target_include_directories(test_small_flat_set PRIVATE "${CMAKE_SOURCE_DIR}")
+target_link_libraries(test_small_flat_set revngSupport revngUnitTestHelpers
+                      Boost::unit_test_framework ${LLVM_LIBRARIES})
+add_test(NAME test_small_flat_set COMMAND ./test_small_flat_set)
+set_tests_properties(test_small_flat_set PROPERTIES LABELS "unit")
+
 #
 # test_smallmap
 #
@@ -144,6 +278,121 @@ target_link_libraries(test_smallmap revngSupport revngUnitTestHelpers
 add_test(NAME test_smallmap COMMAND ./test_smallmap)
 set_tests_properties(test_smallmap PROPERTIES LABELS "unit")
 
+#
+# test_function_tags
+#
+
+revng_add_test_executable(test_function_tags "${SRC}/FunctionTags.cpp")
+target_compile_definitions(test_function_tags PRIVATE "BOOST_TEST_DYN_LINK=1")
+target_include_directories(test_function_tags PRIVATE "${CMAKE_SOURCE_DIR}")
+target_link_libraries(test_function_tags revngSupport revngUnitTestHelpers
+                      Boost::unit_test_framework ${LLVM_LIBRARIES})
+add_test(NAME test_function_tags COMMAND ./test_function_tags)
+set_tests_properties(test_function_tags PROPERTIES LABELS "unit")
+
+#
+# test_opaque_functions_pool
+#
+
+revng_add_test_executable(test_opaque_functions_pool
+                          "${SRC}/OpaqueFunctionsPool.cpp")
+target_compile_definitions(test_opaque_functions_pool
+                           PRIVATE "BOOST_TEST_DYN_LINK=1")
+target_include_directories(test_opaque_functions_pool
+                           PRIVATE "${CMAKE_SOURCE_DIR}")
+target_link_libraries(
+  test_opaque_functions_pool revngSupport revngUnitTestHelpers
+  Boost::unit_test_framework ${LLVM_LIBRARIES})
+add_test(NAME test_opaque_functions_pool COMMAND ./test_opaque_functions_pool)
+set_tests_properties(test_opaque_functions_pool PROPERTIES LABELS "unit")
+
+#
+# test_perfecthash
+#
+
+revng_add_test_executable(test_perfecthash "${SRC}/PerfectHash.cpp")
+target_compile_definitions(test_perfecthash PRIVATE "BOOST_TEST_DYN_LINK=1")
+target_include_directories(test_perfecthash PRIVATE "${CMAKE_SOURCE_DIR}")
+target_link_libraries(test_perfecthash revngSupport revngUnitTestHelpers
+                      Boost::unit_test_framework ${LLVM_LIBRARIES})
+add_test(NAME test_perfecthash COMMAND ./test_perfecthash)
+set_tests_properties(test_perfecthash PROPERTIES LABELS "unit")
+
+#
+# test_statistics
+#
+
+revng_add_test_executable(test_statistics "${SRC}/Statistics.cpp")
+target_compile_definitions(test_statistics PRIVATE "BOOST_TEST_DYN_LINK=1")
+target_include_directories(test_statistics PRIVATE "${CMAKE_SOURCE_DIR}")
+target_link_libraries(test_statistics revngSupport revngUnitTestHelpers
+                      Boost::unit_test_framework ${LLVM_LIBRARIES})
+add_test(NAME test_statistics COMMAND ./test_statistics)
+set_tests_properties(test_statistics PROPERTIES LABELS "unit")
+
+#
+# test_asynclogwriter
+#
+
+revng_add_test_executable(test_asynclogwriter "${SRC}/AsyncLogWriter.cpp")
+target_compile_definitions(test_asynclogwriter
+                           PRIVATE "BOOST_TEST_DYN_LINK=1")
+target_include_directories(test_asynclogwriter
+                           PRIVATE "${CMAKE_SOURCE_DIR}")
+target_link_libraries(test_asynclogwriter revngSupport revngUnitTestHelpers
+                      Boost::unit_test_framework ${LLVM_LIBRARIES})
+add_test(NAME test_asynclogwriter COMMAND ./test_asynclogwriter)
+set_tests_properties(test_asynclogwriter PROPERTIES LABELS "unit")
+
+#
+# test_taskscheduler
+#
+
+revng_add_test_executable(test_taskscheduler "${SRC}/TaskScheduler.cpp")
+target_compile_definitions(test_taskscheduler PRIVATE "BOOST_TEST_DYN_LINK=1")
+target_include_directories(test_taskscheduler PRIVATE "${CMAKE_SOURCE_DIR}")
+target_link_libraries(test_taskscheduler revngSupport revngUnitTestHelpers
+                      Boost::unit_test_framework ${LLVM_LIBRARIES})
+add_test(NAME test_taskscheduler COMMAND ./test_taskscheduler)
+set_tests_properties(test_taskscheduler PROPERTIES LABELS "unit")
+
+#
+# test_temporaryfile
+#
+
+revng_add_test_executable(test_temporaryfile "${SRC}/TemporaryFile.cpp")
+target_compile_definitions(test_temporaryfile PRIVATE "BOOST_TEST_DYN_LINK=1")
+target_include_directories(test_temporaryfile PRIVATE "${CMAKE_SOURCE_DIR}")
+target_link_libraries(test_temporaryfile revngSupport revngUnitTestHelpers
+                      Boost::unit_test_framework ${LLVM_LIBRARIES})
+add_test(NAME test_temporaryfile COMMAND ./test_temporaryfile)
+set_tests_properties(test_temporaryfile PROPERTIES LABELS "unit")
+
+#
+# test_pathlist
+#
+
+revng_add_test_executable(test_pathlist "${SRC}/PathList.cpp")
+target_compile_definitions(test_pathlist PRIVATE "BOOST_TEST_DYN_LINK=1")
+target_include_directories(test_pathlist PRIVATE "${CMAKE_SOURCE_DIR}")
+target_link_libraries(test_pathlist revngSupport revngUnitTestHelpers
+                      Boost::unit_test_framework ${LLVM_LIBRARIES})
+add_test(NAME test_pathlist COMMAND ./test_pathlist)
+set_tests_properties(test_pathlist PROPERTIES LABELS "unit")
+
+#
+# test_sharedoutputfile
+#
+
+revng_add_test_executable(test_sharedoutputfile "${SRC}/SharedOutputFile.cpp")
+target_compile_definitions(test_sharedoutputfile
+                           PRIVATE "BOOST_TEST_DYN_LINK=1")
+target_include_directories(test_sharedoutputfile PRIVATE "${CMAKE_SOURCE_DIR}")
+target_link_libraries(test_sharedoutputfile revngSupport revngUnitTestHelpers
+                      Boost::unit_test_framework ${LLVM_LIBRARIES})
+add_test(NAME test_sharedoutputfile COMMAND ./test_sharedoutputfile)
+set_tests_properties(test_sharedoutputfile PROPERTIES LABELS "unit")
+
 #
 # test_genericgraph
 #
@@ -190,6 +439,101 @@ target_link_libraries(
 add_test(NAME test_model COMMAND ./test_model)
 set_tests_properties(test_model PROPERTIES LABELS "unit")
 
+#
+# test_functionmetadata
+#
+
+revng_add_test_executable(test_functionmetadata "${SRC}/FunctionMetadata.cpp")
+target_compile_definitions(test_functionmetadata
+                           PRIVATE "BOOST_TEST_DYN_LINK=1")
+target_include_directories(test_functionmetadata PRIVATE "${CMAKE_SOURCE_DIR}")
+target_link_libraries(
+  test_functionmetadata
+  revngSupport
+  revngUnitTestHelpers
+  revngModel
+  revngEarlyFunctionAnalysis
+  Boost::unit_test_framework
+  ${LLVM_LIBRARIES})
+add_test(NAME test_functionmetadata COMMAND ./test_functionmetadata)
+set_tests_properties(test_functionmetadata PROPERTIES LABELS "unit")
+
+#
+# test_registerslattice
+#
+
+revng_add_test_executable(test_registerslattice "${SRC}/RegistersLattice.cpp")
+target_compile_definitions(test_registerslattice
+                           PRIVATE "BOOST_TEST_DYN_LINK=1")
+target_include_directories(test_registerslattice PRIVATE "${CMAKE_SOURCE_DIR}")
+target_link_libraries(
+  test_registerslattice
+  revngSupport
+  revngUnitTestHelpers
+  revngModel
+  revngBasicAnalyses
+  revngEarlyFunctionAnalysis
+  Boost::unit_test_framework
+  ${LLVM_LIBRARIES})
+add_test(NAME test_registerslattice COMMAND ./test_registerslattice)
+set_tests_properties(test_registerslattice PROPERTIES LABELS "unit")
+
+#
+# test_type_shrinking
+#
+
+revng_add_test_executable(test_type_shrinking "${SRC}/TypeShrinking.cpp")
+target_compile_definitions(test_type_shrinking PRIVATE "BOOST_TEST_DYN_LINK=1")
+target_include_directories(test_type_shrinking PRIVATE "${CMAKE_SOURCE_DIR}")
+target_link_libraries(
+  test_type_shrinking
+  revngSupport
+  revngTypeShrinking
+  revngUnitTestHelpers
+  Boost::unit_test_framework
+  ${LLVM_LIBRARIES})
+add_test(NAME test_type_shrinking COMMAND ./test_type_shrinking)
+set_tests_properties(test_type_shrinking PROPERTIES LABELS "unit")
+
+#
+# test_linkfortranslation
+#
+
+revng_add_test_executable(test_linkfortranslation
+                          "${SRC}/LinkForTranslation.cpp")
+target_compile_definitions(test_linkfortranslation
+                           PRIVATE "BOOST_TEST_DYN_LINK=1")
+target_include_directories(test_linkfortranslation
+                           PRIVATE "${CMAKE_SOURCE_DIR}")
+target_link_libraries(
+  test_linkfortranslation
+  revngSupport
+  revngRecompile
+  revngUnitTestHelpers
+  Boost::unit_test_framework
+  ${LLVM_LIBRARIES})
+add_test(NAME test_linkfortranslation COMMAND ./test_linkfortranslation)
+set_tests_properties(test_linkfortranslation PROPERTIES LABELS "unit")
+
+#
+# test_merge_dynamic
+#
+
+llvm_map_components_to_libnames(OBJECTYAML_LIBRARIES ObjectYAML)
+revng_add_test_executable(test_merge_dynamic "${SRC}/MergeDynamic.cpp")
+target_compile_definitions(test_merge_dynamic PRIVATE "BOOST_TEST_DYN_LINK=1")
+target_include_directories(test_merge_dynamic PRIVATE "${CMAKE_SOURCE_DIR}")
+target_link_libraries(
+  test_merge_dynamic
+  revngSupport
+  revngRecompile
+  revngUnitTestHelpers
+  Boost::unit_test_framework
+  ${OBJECTYAML_LIBRARIES}
+  ${LLVM_LIBRARIES})
+add_test(NAME test_merge_dynamic COMMAND ./test_merge_dynamic)
+set_tests_properties(test_merge_dynamic PROPERTIES LABELS "unit")
+
 #
 # test_instantiatepasses
 #
@@ -216,6 +560,18 @@ target_link_libraries(test_upcastablepointer revngSupport revngUnitTestHelpers
 add_test(NAME test_upcastablepointer COMMAND ./test_upcastablepointer)
 set_tests_properties(test_upcastablepointer PROPERTIES LABELS "unit")
 
+#
+# test_tupletreeyaml
+#
+
+revng_add_test_executable(test_tupletreeyaml "${SRC}/TupleTreeYAML.cpp")
+target_compile_definitions(test_tupletreeyaml PRIVATE "BOOST_TEST_DYN_LINK=1")
+target_include_directories(test_tupletreeyaml PRIVATE "${CMAKE_SOURCE_DIR}")
+target_link_libraries(test_tupletreeyaml revngSupport revngUnitTestHelpers
+                      Boost::unit_test_framework ${LLVM_LIBRARIES})
+add_test(NAME test_tupletreeyaml COMMAND ./test_tupletreeyaml)
+set_tests_properties(test_tupletreeyaml PROPERTIES LABELS "unit")
+
 #
 # test_recursive_coroutines
 #
@@ -314,6 +670,49 @@ add_test(NAME test_diff_invalidation_event
          COMMAND ./test_diff_invalidation_event)
 set_tests_properties(test_diff_invalidation_event PROPERTIES LABELS "unit")
 
+#
+# test_compile_module_pipe
+#
+
+revng_add_test_executable(test_compile_module_pipe
+                          "${SRC}/CompileModulePipe.cpp")
+target_compile_definitions(test_compile_module_pipe
+                           PRIVATE "BOOST_TEST_DYN_LINK=1")
+target_include_directories(test_compile_module_pipe
+                           PRIVATE "${CMAKE_SOURCE_DIR}")
+target_link_libraries(test_compile_module_pipe revngUnitTestHelpers
+                      revngPipes Boost::unit_test_framework ${LLVM_LIBRARIES})
+add_test(NAME test_compile_module_pipe COMMAND ./test_compile_module_pipe)
+set_tests_properties(test_compile_module_pipe PROPERTIES LABELS "unit")
+
+#
+# test_csvaccesscache
+#
+
+revng_add_test_executable(test_csvaccesscache "${SRC}/CSVAccessCache.cpp")
+target_compile_definitions(test_csvaccesscache PRIVATE "BOOST_TEST_DYN_LINK=1")
+target_include_directories(test_csvaccesscache PRIVATE "${CMAKE_SOURCE_DIR}")
+target_link_libraries(test_csvaccesscache revngLift revngSupport
+                      revngUnitTestHelpers Boost::unit_test_framework
+                      ${LLVM_LIBRARIES})
+add_test(NAME test_csvaccesscache COMMAND ./test_csvaccesscache)
+set_tests_properties(test_csvaccesscache PROPERTIES LABELS "unit")
+
+#
+# test_string_map_container
+#
+
+revng_add_test_executable(test_string_map_container
+                          "${SRC}/StringMapContainer.cpp")
+target_compile_definitions(test_string_map_container
+                           PRIVATE "BOOST_TEST_DYN_LINK=1")
+target_include_directories(test_string_map_container
+                           PRIVATE "${CMAKE_SOURCE_DIR}")
+target_link_libraries(test_string_map_container revngUnitTestHelpers
+                      revngPipes Boost::unit_test_framework ${LLVM_LIBRARIES})
+add_test(NAME test_string_map_container COMMAND ./test_string_map_container)
+set_tests_properties(test_string_map_container PROPERTIES LABELS "unit")
+
 #
 # test_pipeline_c
 #
@@ -354,3 +753,38 @@ add_test(NAME test_register_state_deductions
          COMMAND ./test_register_state_deductions)
 set_tests_properties(test_register_state_deductions PROPERTIES LABELS
                                                                "unit;abi")
+
+#
+# test_default_function_prototype
+#
+
+revng_add_test_executable(test_default_function_prototype
+                          "${SRC}/DefaultFunctionPrototype.cpp")
+target_compile_definitions(test_default_function_prototype
+                           PRIVATE "BOOST_TEST_DYN_LINK=1")
+target_include_directories(test_default_function_prototype
+                           PRIVATE "${CMAKE_SOURCE_DIR}")
+target_link_libraries(
+  test_default_function_prototype
+  revngABI
+  revngModel
+  revngSupport
+  revngUnitTestHelpers
+  Boost::unit_test_framework
+  ${LLVM_LIBRARIES})
+add_test(NAME test_default_function_prototype
+         COMMAND ./test_default_function_prototype)
+set_tests_properties(test_default_function_prototype PROPERTIES LABELS
+                                                                "unit;abi")
+
+#
+# test_mfp
+#
+
+revng_add_test_executable(test_mfp "${SRC}/MFP.cpp")
+target_compile_definitions(test_mfp PRIVATE "BOOST_TEST_DYN_LINK=1")
+target_include_directories(test_mfp PRIVATE "${CMAKE_SOURCE_DIR}")
+target_link_libraries(test_mfp revngSupport revngUnitTestHelpers
+                      Boost::unit_test_framework ${LLVM_LIBRARIES})
+add_test(NAME test_mfp COMMAND ./test_mfp)
+set_tests_properties(test_mfp PROPERTIES LABELS "unit")
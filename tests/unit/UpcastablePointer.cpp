@@ -5,6 +5,10 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <set>
+#include <thread>
+#include <vector>
+
 #include "revng/ADT/UpcastablePointer.h"
 
 // clang-format off
@@ -48,5 +52,53 @@ static_assert(std::is_move_assignable_v<UpcastablePointer<TestClass>>);
 static_assert(std::is_move_constructible_v<UpcastablePointer<TestClass>>);
 
 int main() {
+  using Pointer = UpcastablePointer<TestClass>;
+  using Arena = revng::UpcastablePointerArena;
+
+  // Objects allocated in an arena are laid out in order and can outlive its
+  // owner
+  Pointer Outliving;
+  {
+    Arena::Handle Owner;
+    Arena::Scope Scope(Owner.get());
+    Pointer First = Pointer::make<TestClass>();
+    Pointer Second = Pointer::make<TestClass>();
+    revng_check(First.get() < Second.get());
+
+    Outliving = First;
+  }
+  revng_check(Outliving.get() != nullptr);
+
+  // Without an arena, objects are allocated on the heap
+  Pointer Copy = Outliving;
+  Outliving.reset();
+  revng_check(Copy.get() != nullptr);
+
+  // The same arena can be installed on several threads at once
+  {
+    constexpr unsigned ThreadsCount = 4;
+    constexpr unsigned PerThread = 1000;
+    Arena::Handle Owner;
+    Arena &Shared = Owner.get();
+    std::vector<std::vector<Pointer>> Created(ThreadsCount);
+    std::vector<std::thread> Threads;
+    for (std::vector<Pointer> &Pointers : Created) {
+      Threads.emplace_back([&Shared, &Pointers] {
+        Arena::Scope Scope(Shared);
+        for (unsigned I = 0; I < PerThread; ++I)
+          Pointers.push_back(Pointer::make<TestClass>());
+      });
+    }
+
+    for (std::thread &Thread : Threads)
+      Thread.join();
+
+    std::set<TestClass *> Distinct;
+    for (const std::vector<Pointer> &Pointers : Created)
+      for (const Pointer &P : Pointers)
+        Distinct.insert(P.get());
+    revng_check(Distinct.size() == ThreadsCount * PerThread);
+  }
+
   return 0;
 }
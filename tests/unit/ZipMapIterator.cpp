@@ -8,6 +8,7 @@
 #include <iterator>
 #include <map>
 #include <set>
+#include <string>
 
 #define BOOST_TEST_MODULE ZipMapIterator
 bool init_unit_test();
@@ -213,3 +214,61 @@ BOOST_AUTO_TEST_CASE(TestSmallMap) {
 BOOST_AUTO_TEST_CASE(TestSortedVectorAndMutableSet) {
   run<SortedVector<int>, MutableSet<int>>();
 }
+
+/// \brief Checks zipmap_range on SortedVectors, which gallops over long runs,
+///        against zipmap_range on std::sets
+static void checkAgainstSet(const std::set<int> &LeftKeys,
+                            const std::set<int> &RightKeys) {
+  // Galloping is disabled for scalar keys
+  auto ToStrings = [](const std::set<int> &Keys) {
+    std::set<std::string> Result;
+    for (int Key : Keys)
+      Result.insert(std::to_string(Key));
+    return Result;
+  };
+  std::set<std::string> Left = ToStrings(LeftKeys);
+  std::set<std::string> Right = ToStrings(RightKeys);
+
+  SortedVector<std::string> LeftVector;
+  SortedVector<std::string> RightVector;
+  for (const std::string &Key : Left)
+    LeftVector.insert(Key);
+  for (const std::string &Key : Right)
+    RightVector.insert(Key);
+
+  using Pair = std::pair<Optional<std::string>, Optional<std::string>>;
+  auto Unwrap = [](const std::string *Pointer) -> Optional<std::string> {
+    if (Pointer == nullptr)
+      return llvm::None;
+    return *Pointer;
+  };
+
+  std::vector<Pair> Expected;
+  for (auto [LeftPointer, RightPointer] : zipmap_range(Left, Right))
+    Expected.emplace_back(Unwrap(LeftPointer), Unwrap(RightPointer));
+
+  std::vector<Pair> Result;
+  for (auto [LeftPointer, RightPointer] : zipmap_range(LeftVector, RightVector))
+    Result.emplace_back(Unwrap(LeftPointer), Unwrap(RightPointer));
+
+  revng_check(Result == Expected);
+}
+
+BOOST_AUTO_TEST_CASE(TestGalloping) {
+  std::set<int> Dense;
+  for (int I = 0; I < 1000; ++I)
+    Dense.insert(I);
+
+  std::set<int> Sparse = { -5, 5, 500, 501, 998, 2000 };
+  std::set<int> Interleaved;
+  for (int I = 0; I < 1000; I += 2)
+    Interleaved.insert(I);
+
+  checkAgainstSet(Dense, Sparse);
+  checkAgainstSet(Sparse, Dense);
+  checkAgainstSet(Dense, Interleaved);
+  checkAgainstSet(Interleaved, Sparse);
+  checkAgainstSet(Dense, {});
+  checkAgainstSet({}, Dense);
+  checkAgainstSet(Dense, Dense);
+}
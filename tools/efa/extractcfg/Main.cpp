@@ -4,14 +4,21 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <map>
+#include <mutex>
 #include <string>
+#include <vector>
 
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
 
 #include "revng/EarlyFunctionAnalysis/IRHelpers.h"
 #include "revng/Model/ToolHelpers.h"
 #include "revng/Support/IRHelpers.h"
+#include "revng/Support/TaskScheduler.h"
 
 #include "./DecoratedFunction.h"
 
@@ -29,9 +36,76 @@ static cl::opt<std::string> OutputFilename("o",
                                            llvm::cl::desc("<output file>"),
                                            cl::value_desc("filename"));
 
+static cl::list<std::string> Functions("function",
+                                       cl::cat(MainCategory),
+                                       cl::desc("Extract only the CFG of the "
+                                                "function with this original "
+                                                "name or entry address"),
+                                       cl::value_desc("function"));
+
+static cl::opt<std::string> OutputDirectory("output-directory",
+                                            cl::cat(MainCategory),
+                                            cl::desc("Write the CFG of each "
+                                                     "function to a separate "
+                                                     "file, named after its "
+                                                     "entry address, in this "
+                                                     "directory"),
+                                            cl::value_desc("directory"));
+
+static cl::opt<unsigned> Jobs("j",
+                              cl::cat(MainCategory),
+                              cl::desc("Number of functions to extract in "
+                                       "parallel"),
+                              cl::init(0));
+
+/// \brief Map the entry address of each function with metadata in \p Module
+///        to its serialized efa::FunctionMetadata
+///
+/// Building the index does not deserialize the metadata: that's left to the
+/// functions that are actually requested.
+static std::map<MetaAddress, StringRef> indexFunctionMetadata(Module &Module) {
+  std::map<MetaAddress, StringRef> Result;
+  for (BasicBlock &BB : *Module.getFunction("root")) {
+    llvm::Instruction *Term = BB.getTerminator();
+    auto *FMMDNode = Term->getMetadata(FunctionMetadataMDName);
+    if (not FMMDNode)
+      continue;
+
+    StringRef Data = cast<MDString>(FMMDNode->getOperand(0))->getString();
+    Result[getBasicBlockPC(&BB)] = Data;
+  }
+
+  return Result;
+}
+
+/// \brief Resolve \p Name, either an original name or an entry address, to
+///        the entry of a function
+static MetaAddress
+findFunction(const model::Binary &Model, llvm::StringRef Name) {
+  MetaAddress Address = MetaAddress::fromString(Name);
+  if (Address.isValid() and Model.Functions.count(Address) != 0)
+    return Address;
+
+  for (const model::Function &Function : Model.Functions)
+    if (Function.OriginalName == Name)
+      return Function.Entry;
+
+  return MetaAddress::invalid();
+}
+
+static revng::DecoratedFunction
+decorate(const model::Function &Function, StringRef YAML) {
+  auto MaybeParsed = TupleTree<efa::FunctionMetadata>::deserialize(YAML);
+  revng_assert(MaybeParsed);
+  MaybeParsed->verify();
+  return { Function.OriginalName, Function.Type, *MaybeParsed->get() };
+}
+
 int main(int argc, const char **argv) {
   cl::HideUnrelatedOptions({ &MainCategory });
   cl::ParseCommandLineOptions(argc, argv);
+  if (Jobs.getNumOccurrences() > 0)
+    TaskScheduler::setGlobalThreadsCount(Jobs);
 
   auto BufOrError = MemoryBuffer::getFileOrSTDIN(InputModule);
   if (std::error_code EC = BufOrError.getError())
@@ -47,20 +121,69 @@ int main(int argc, const char **argv) {
   else
     ExitOnError("Unable to extract model\n");
 
-  SortedVector<revng::DecoratedFunction> DecoratedFunctions;
-  for (BasicBlock &BB : *Module->getFunction("root")) {
-    llvm::Instruction *Term = BB.getTerminator();
-    auto *FMMDNode = Term->getMetadata(FunctionMetadataMDName);
-    if (not FMMDNode)
-      continue;
+  ExitOnError AbortOnError;
+  auto Index = indexFunctionMetadata(*Module);
+
+  // Select the functions to extract
+  std::vector<std::pair<const model::Function *, StringRef>> Selected;
+  if (Functions.empty()) {
+    for (const auto &[Entry, YAML] : Index)
+      Selected.emplace_back(&Model->Functions.at(Entry), YAML);
+  } else {
+    for (const std::string &Name : Functions) {
+      MetaAddress Entry = findFunction(*Model, Name);
+      auto It = Index.find(Entry);
+      if (It == Index.end())
+        AbortOnError(createStringError(inconvertibleErrorCode(),
+                                       "No CFG for function " + Name));
+      Selected.emplace_back(&Model->Functions.at(Entry), It->second);
+    }
+  }
 
-    efa::FunctionMetadata FM = *extractFunctionMetadata(&BB).get();
-    auto &Function = Model->Functions.at(getBasicBlockPC(&BB));
-    DecoratedFunctions.insert({ Function.OriginalName, Function.Type, FM });
+  if (not OutputDirectory.empty()) {
+    std::error_code EC = sys::fs::create_directories(OutputDirectory);
+    AbortOnError(errorCodeToError(EC));
   }
 
-  ExitOnError AbortOnError;
-  AbortOnError((serializeToFile(DecoratedFunctions, OutputFilename)));
+  // Deserialize the metadata of the selected functions in parallel. In the
+  // output directory mode, each function is also written out right away.
+  std::mutex Lock;
+  SortedVector<revng::DecoratedFunction> DecoratedFunctions;
+  std::vector<std::string> Errors;
+  {
+    TaskGroup Group;
+    for (const auto &[Function, YAML] : Selected) {
+      Group.spawn([&, Function = Function, YAML = YAML] {
+        revng::DecoratedFunction Decorated = decorate(*Function, YAML);
+
+        if (OutputDirectory.empty()) {
+          std::lock_guard Guard(Lock);
+          DecoratedFunctions.insert(std::move(Decorated));
+          return;
+        }
+
+        SmallString<128> Path(OutputDirectory);
+        sys::path::append(Path, Function->Entry.toString() + ".yml");
+        SortedVector<revng::DecoratedFunction> Single;
+        Single.insert(std::move(Decorated));
+        if (Error E = serializeToFile(Single, Path)) {
+          std::lock_guard Guard(Lock);
+          Errors.push_back(Path.str().str() + ": " + toString(std::move(E)));
+        }
+      });
+    }
+    Group.wait();
+  }
+
+  // Errors are collected in completion order, report them in a stable one
+  llvm::sort(Errors);
+  for (const std::string &Message : Errors)
+    errs() << Message << "\n";
+  if (not Errors.empty())
+    return EXIT_FAILURE;
+
+  if (OutputDirectory.empty())
+    AbortOnError((serializeToFile(DecoratedFunctions, OutputFilename)));
 
   return EXIT_SUCCESS;
 }
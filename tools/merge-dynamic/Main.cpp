@@ -0,0 +1,70 @@
+/// \file Main.cpp
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <cstdlib>
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Error.h"
+
+#include "revng/Recompile/MergeDynamic.h"
+#include "revng/Support/Debug.h"
+
+using std::string;
+using namespace llvm;
+using namespace llvm::cl;
+
+static OptionCategory MergeDynamicCategory("revng-merge-dynamic options");
+
+static opt<string> ToExtend(Positional,
+                            Required,
+                            desc("<to extend>"),
+                            cat(MergeDynamicCategory));
+
+static opt<string> Source(Positional,
+                          Required,
+                          desc("<source>"),
+                          cat(MergeDynamicCategory));
+
+static opt<string> Output(Positional,
+                          init("-"),
+                          desc("<output>"),
+                          cat(MergeDynamicCategory));
+
+static opt<uint64_t> Base("base",
+                          desc("The base address where dynamic objects have "
+                               "been loaded"),
+                          value_desc("address"),
+                          cat(MergeDynamicCategory),
+                          init(0x400000));
+
+static opt<bool> MergeLoadSegments("merge-load-segments",
+                                   desc("Merge the LOADed segments from the "
+                                        "source ELF into the output ELF"),
+                                   cat(MergeDynamicCategory),
+                                   init(false));
+
+static opt<bool> Verbose("verbose",
+                         desc("Print debug information and warnings"),
+                         cat(MergeDynamicCategory),
+                         init(false));
+
+static ExitOnError AbortOnError;
+
+int main(int argc, const char *argv[]) {
+  HideUnrelatedOptions({ &MergeDynamicCategory });
+  ParseCommandLineOptions(argc,
+                          argv,
+                          "Merge the dynamic portions of the translated ELF "
+                          "with the ones from the original ELF.\n");
+
+  if (Verbose)
+    Loggers->enable("merge-dynamic");
+
+  AbortOnError.setBanner("revng-merge-dynamic: ");
+  AbortOnError(mergeDynamic(ToExtend, Source, Output, Base, MergeLoadSegments));
+
+  return EXIT_SUCCESS;
+}
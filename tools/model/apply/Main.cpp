@@ -5,7 +5,10 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <map>
+#include <set>
 #include <string>
+#include <vector>
 
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FileSystem.h"
@@ -14,6 +17,7 @@
 
 #include "revng/Model/ToolHelpers.h"
 #include "revng/Support/MetaAddress/YAMLTraits.h"
+#include "revng/Support/TaskScheduler.h"
 #include "revng/Support/YAMLTraits.h"
 #include "revng/TupleTree/TupleTreeDiff.h"
 
@@ -27,31 +31,103 @@ static cl::opt<std::string> PathModel(cl::Positional,
                                       cl::init("-"),
                                       cl::value_desc("model"));
 
-static cl::opt<std::string> DiffPath(cl::Positional,
-                                     cl::cat(ThisToolCategory),
-                                     cl::desc("<model diff>"),
-                                     cl::value_desc("model"));
+static cl::list<std::string> DiffPaths(cl::Positional,
+                                       cl::cat(ThisToolCategory),
+                                       cl::desc("<model diff>..."),
+                                       cl::value_desc("model"));
 
 static ModelOutputOptions<false> Options(ThisToolCategory);
 
+static cl::opt<std::string> BatchManifest("batch",
+                                          cl::cat(ThisToolCategory),
+                                          cl::desc("Process all the entries "
+                                                   "listed in a manifest, one "
+                                                   "<input model> <model diff> "
+                                                   "<output> triple per line, "
+                                                   "instead of the "
+                                                   "positional arguments"),
+                                          cl::value_desc("manifest"));
+
+static cl::opt<unsigned> Jobs("j",
+                              cl::cat(ThisToolCategory),
+                              cl::desc("Number of entries of the batch to "
+                                       "process in parallel"),
+                              cl::init(0));
+
+using ModelDiff = TupleTreeDiff<model::Binary>;
+
+/// \brief Apply \p Diffs, in order, to the model at \p ModelPath
+static Error apply(const Twine &ModelPath,
+                   ArrayRef<ModelDiff> Diffs,
+                   const Twine &Output) {
+  auto Model = ModelInModule::load(ModelPath);
+  if (not Model)
+    return Model.takeError();
+
+  // The references are re-initialized once, not after each diff
+  ModelDiff::apply(Diffs, Model->getModel());
+
+  auto DesiredOutput = Options.getDesiredOutput(Model->hasModule());
+  return Model->save(Output, DesiredOutput);
+}
+
+/// \brief Apply each diff of the manifest to its model
+///
+/// Any given diff is deserialized once, even if it appears in multiple
+/// entries, and it's then shared, read-only, among all the threads.
+static size_t applyBatch(ArrayRef<BatchEntry> Entries) {
+  // Check the outcome of deserialization here: checking an Expected is not
+  // thread safe, hence the threads only get to see the diffs that loaded
+  std::map<std::string, ModelDiff> Diffs;
+  std::set<std::string> Failed;
+  for (const BatchEntry &Entry : Entries) {
+    const std::string &Path = Entry[1];
+    if (Diffs.count(Path) != 0 or Failed.count(Path) != 0)
+      continue;
+
+    auto MaybeDiff = deserializeFile<ModelDiff>(Path);
+    if (MaybeDiff) {
+      Diffs.emplace(Path, std::move(*MaybeDiff));
+    } else {
+      // Report the reason why each diff could not be loaded, once
+      errs() << Path << ": " << toString(MaybeDiff.takeError()) << "\n";
+      Failed.insert(Path);
+    }
+  }
+
+  return runBatch(Entries, [&](const BatchEntry &Entry) -> Error {
+    auto It = Diffs.find(Entry[1]);
+    if (It == Diffs.end()) {
+      return createStringError(inconvertibleErrorCode(),
+                               "Cannot load diff " + Entry[1]);
+    }
+
+    return apply(Entry[0], It->second, Entry[2]);
+  });
+}
+
 int main(int Argc, char *Argv[]) {
   cl::HideUnrelatedOptions({ &ThisToolCategory });
   cl::ParseCommandLineOptions(Argc, Argv);
+  if (Jobs.getNumOccurrences() > 0)
+    TaskScheduler::setGlobalThreadsCount(Jobs);
 
   ExitOnError ExitOnError;
 
-  auto Model = ModelInModule::load(PathModel);
-  if (not Model)
-    ExitOnError(Model.takeError());
+  if (BatchManifest.getNumOccurrences() > 0) {
+    auto Entries = ExitOnError(readBatchManifest(BatchManifest, 3));
+    return applyBatch(Entries) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
 
-  auto Diff = deserializeFile<TupleTreeDiff<model::Binary>>(DiffPath);
-  if (not Diff)
-    ExitOnError(Diff.takeError());
+  if (DiffPaths.empty())
+    ExitOnError(createStringError(inconvertibleErrorCode(),
+                                  "No model diff specified"));
 
-  Diff->apply(Model->getModel());
+  std::vector<ModelDiff> Diffs;
+  for (const std::string &DiffPath : DiffPaths)
+    Diffs.push_back(ExitOnError(deserializeFile<ModelDiff>(DiffPath)));
 
-  auto DesiredOutput = Options.getDesiredOutput(Model->hasModule());
-  ExitOnError(Model->save(Options.getPath(), DesiredOutput));
+  ExitOnError(apply(PathModel, Diffs, Options.getPath()));
 
   return EXIT_SUCCESS;
 }
@@ -5,6 +5,9 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <fstream>
+#include <iostream>
+#include <memory>
 #include <string>
 
 #include "llvm/Support/CommandLine.h"
@@ -15,6 +18,7 @@
 #include "revng/Model/ToolHelpers.h"
 #include "revng/Support/MetaAddress/YAMLTraits.h"
 #include "revng/Support/YAMLTraits.h"
+#include "revng/TupleTree/StreamingDiff.h"
 #include "revng/TupleTree/TupleTreeDiff.h"
 
 using namespace llvm;
@@ -40,10 +44,60 @@ static cl::opt<std::string> OutputFilename("o",
                                                           "filename"),
                                            llvm::cl::value_desc("filename"));
 
+static cl::opt<bool> Streaming("streaming",
+                               cl::cat(ThisToolCategory),
+                               cl::desc("Compare two YAML models one element "
+                                        "at a time, without loading them "
+                                        "entirely in memory"),
+                               cl::init(false));
+
+static std::unique_ptr<llvm::ToolOutputFile> openOutput() {
+  ExitOnError ExitOnError;
+  std::error_code EC;
+  auto Result = std::make_unique<llvm::ToolOutputFile>(OutputFilename,
+                                                       EC,
+                                                       sys::fs::OF_Text);
+  if (EC)
+    ExitOnError(llvm::createStringError(EC, EC.message()));
+  return Result;
+}
+
+/// \brief Diff the models without deserializing them
+///
+/// \return the number of changes
+static size_t streamingDiff() {
+  ExitOnError ExitOnError;
+
+  auto Open = [&ExitOnError](const std::string &Path) {
+    auto Result = std::make_unique<std::ifstream>(Path);
+    if (not *Result)
+      ExitOnError(createStringError(inconvertibleErrorCode(),
+                                    "Cannot open " + Path));
+    return Result;
+  };
+
+  std::unique_ptr<std::ifstream> LeftFile;
+  if (LeftModelPath != "-")
+    LeftFile = Open(LeftModelPath);
+  auto RightFile = Open(RightModelPath);
+  std::istream &LeftStream = LeftFile ? *LeftFile : std::cin;
+
+  auto OutputFile = openOutput();
+  using namespace tupletreediff::streaming;
+  StreamingDiff<model::Binary> Differ(OutputFile->os());
+  size_t Result = ExitOnError(Differ.run(LeftStream, *RightFile));
+  OutputFile->keep();
+
+  return Result;
+}
+
 int main(int Argc, char *Argv[]) {
   cl::HideUnrelatedOptions({ &ThisToolCategory });
   cl::ParseCommandLineOptions(Argc, Argv);
 
+  if (Streaming)
+    return streamingDiff() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+
   ExitOnError ExitOnError;
 
   auto LeftModel = ModelInModule::load(LeftModelPath);
@@ -54,17 +108,10 @@ int main(int Argc, char *Argv[]) {
   if (not RightModel)
     ExitOnError(RightModel.takeError());
 
-  std::error_code EC;
-  llvm::ToolOutputFile OutputFile(OutputFilename,
-                                  EC,
-                                  sys::fs::OpenFlags::OF_Text);
-  if (EC)
-    ExitOnError(llvm::createStringError(EC, EC.message()));
-  auto &Stream = OutputFile.os();
-
-  auto Diff = diff(*LeftModel->Model, *RightModel->Model);
-  Diff.dump(Stream);
-  OutputFile.keep();
+  auto OutputFile = openOutput();
+  auto Diff = diff(LeftModel->Model, RightModel->Model);
+  Diff.dump(OutputFile->os());
+  OutputFile->keep();
 
   if (Diff.Changes.empty())
     return EXIT_SUCCESS;
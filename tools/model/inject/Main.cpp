@@ -5,9 +5,13 @@
 // This file is distributed under the MIT License. See LICENSE.md for details.
 //
 
+#include <optional>
 #include <string>
 
+#include "llvm/IRReader/IRReader.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/SourceMgr.h"
 
 #include "revng/Model/ToolHelpers.h"
 
@@ -28,19 +32,76 @@ static cl::opt<std::string> InputModulePath(cl::Positional,
                                             cl::init("-"),
                                             cl::value_desc("module"));
 
+static cl::opt<std::string> Sidecar("sidecar",
+                                    cl::cat(ThisToolCategory),
+                                    cl::desc("Store the model in this file, "
+                                             "referenced by the module. If "
+                                             "the module is updated in place "
+                                             "and already refers to it, only "
+                                             "the model is written."),
+                                    cl::value_desc("filename"));
+
+/// \return true if the output is the input module itself
+static bool isInPlace() {
+  if (InputModulePath == "-" or Options.getPath() == "-")
+    return false;
+
+  bool Result = false;
+  if (sys::fs::equivalent(InputModulePath, Options.getPath(), Result))
+    return false;
+  return Result;
+}
+
+/// \return the sidecar of the module at \p Path, if any
+///
+/// Bitcode modules are loaded lazily, i.e., function bodies are not parsed.
+static std::optional<std::string> peekSidecar(const std::string &Path) {
+  ExitOnError ExitOnError;
+  LLVMContext Context;
+  SMDiagnostic Diagnostic;
+  auto Module = getLazyIRFileModule(Path, Diagnostic, Context);
+  if (not Module)
+    ExitOnError(createStringError(inconvertibleErrorCode(),
+                                  Diagnostic.getMessage()));
+
+  return getModelSidecar(*Module);
+}
+
 int main(int Argc, char *Argv[]) {
   cl::HideUnrelatedOptions({ &ThisToolCategory });
   cl::ParseCommandLineOptions(Argc, Argv);
 
+  ExitOnError ExitOnError;
+
+  SmallString<128> SidecarPath(Sidecar);
+  if (not Sidecar.empty()) {
+    ExitOnError(errorCodeToError(sys::fs::make_absolute(SidecarPath)));
+
+    // Fast path: the module is updated in place and already refers to the
+    // sidecar, just overwrite the latter
+    if (isInPlace()
+        and peekSidecar(InputModulePath) == SidecarPath.str().str()) {
+      auto NewModel = ModelInModule::loadYAML(NewModelPath);
+      if (not NewModel)
+        ExitOnError(NewModel.takeError());
+
+      NewModel->Model->verify(true);
+      ExitOnError(NewModel->Model.toFile(SidecarPath));
+      return EXIT_SUCCESS;
+    }
+  }
+
   auto OldModel = ModelInModule::loadModule(InputModulePath);
   auto NewModel = ModelInModule::loadYAML(NewModelPath);
 
-  ExitOnError ExitOnError;
   if (not OldModel)
     ExitOnError(OldModel.takeError());
   if (not NewModel)
     ExitOnError(NewModel.takeError());
 
+  if (not Sidecar.empty())
+    OldModel->setSidecar(SidecarPath);
+
   OldModel->Model = std::move(NewModel->Model);
   ExitOnError(OldModel->save(Options.getPath(),
                              Options.getDesiredOutput(OldModel->hasModule())));
@@ -11,8 +11,10 @@
 #include "llvm/Support/Error.h"
 
 #include "revng/Model/Pass/RegisterModelPass.h"
+#include "revng/Model/Pass/Verify.h"
 #include "revng/Model/Processing.h"
 #include "revng/Model/ToolHelpers.h"
+#include "revng/Support/TaskScheduler.h"
 
 using namespace llvm;
 
@@ -27,6 +29,21 @@ static cl::opt<std::string> InputFilename(cl::Positional,
                                           cl::value_desc("filename"),
                                           cl::cat(ThisToolCategory));
 
+static cl::opt<std::string> BatchManifest("batch",
+                                          cl::desc("Process all the models "
+                                                   "listed in a manifest, one "
+                                                   "<input> <output> pair per "
+                                                   "line, instead of the "
+                                                   "input file"),
+                                          cl::value_desc("manifest"),
+                                          cl::cat(ThisToolCategory));
+
+static cl::opt<unsigned> Jobs("j",
+                              cl::desc("Number of models of the batch to "
+                                       "process in parallel"),
+                              cl::init(0),
+                              cl::cat(ThisToolCategory));
+
 class PassName : public std::string {
 public:
   PassName() {}
@@ -61,26 +78,62 @@ static void loadPassesList() {
     PassesList.getParser().addLiteralOption(Name, PassName(Name), Description);
 }
 
+static Expected<std::vector<const RegisterModelPass::ModelPass *>>
+getPasses() {
+  std::vector<const RegisterModelPass::ModelPass *> Result;
+  for (const PassName &PassName : PassesList) {
+    const RegisterModelPass::ModelPass *Pass = RegisterModelPass::get(PassName);
+    if (Pass == nullptr) {
+      return llvm::createStringError(llvm::inconvertibleErrorCode(),
+                                     "Pass not found: " + PassName);
+    }
+
+    Result.push_back(Pass);
+  }
+
+  return Result;
+}
+
+static Error optimize(ArrayRef<const RegisterModelPass::ModelPass *> Passes,
+                      const Twine &Input,
+                      const Twine &Output) {
+  auto MaybeModel = ModelInModule::load(Input);
+  if (not MaybeModel)
+    return MaybeModel.takeError();
+
+  // Run passes, verifying incrementally the model along the way
+  {
+    model::IncrementalVerificationScope Scope;
+    for (const RegisterModelPass::ModelPass *Pass : Passes)
+      (*Pass)(MaybeModel->Model);
+  }
+
+  // Serialize
+  auto OutputType = Options.getDesiredOutput(MaybeModel->hasModule());
+  return MaybeModel->save(Output, OutputType);
+}
+
 int main(int Argc, char *Argv[]) {
   loadPassesList();
   cl::HideUnrelatedOptions({ &ThisToolCategory, &ModelPassCategory });
   cl::ParseCommandLineOptions(Argc, Argv);
+  if (Jobs.getNumOccurrences() > 0)
+    TaskScheduler::setGlobalThreadsCount(Jobs);
 
   ExitOnError ExitOnError;
-  auto MaybeModel = ExitOnError(ModelInModule::load(InputFilename));
-
-  for (const PassName &PassName : PassesList) {
-    const RegisterModelPass::ModelPass *Pass = RegisterModelPass::get(PassName);
-    if (Pass == nullptr) {
-      ExitOnError(llvm::createStringError(llvm::inconvertibleErrorCode(),
-                                          "Pass not found: " + PassName));
-    }
+  auto Passes = ExitOnError(getPasses());
 
-    // Run pass
-    (*Pass)(MaybeModel.Model);
+  if (BatchManifest.getNumOccurrences() == 0) {
+    ExitOnError(optimize(Passes, InputFilename, Options.getPath()));
+    return EXIT_SUCCESS;
   }
 
-  // Serialize
-  auto OutputType = Options.getDesiredOutput(MaybeModel.hasModule());
-  ExitOnError(MaybeModel.save(Options.getPath(), OutputType));
+  // Batch mode: the passes are looked up once and each model is loaded,
+  // optimized and saved independently from the others
+  auto Entries = ExitOnError(readBatchManifest(BatchManifest, 2));
+  size_t Failures = runBatch(Entries, [&](const BatchEntry &Entry) {
+    return optimize(Passes, Entry[0], Entry[1]);
+  });
+
+  return Failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -5,8 +5,12 @@
 //
 
 #include <cstdlib>
+#include <memory>
+#include <optional>
 
 #include "llvm/Support/DynamicLibrary.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/raw_os_ostream.h"
 
 #include "revng/Model/LoadModelPass.h"
@@ -17,9 +21,13 @@
 #include "revng/Pipeline/LLVMContainerFactory.h"
 #include "revng/Pipeline/LLVMGlobalKindBase.h"
 #include "revng/Pipeline/Loader.h"
+#include "revng/Pipeline/Profiler.h"
+#include "revng/Pipeline/RemoteWorkers.h"
+#include "revng/Pipeline/RunEventLog.h"
 #include "revng/Pipeline/Target.h"
 #include "revng/Pipes/ModelGlobal.h"
 #include "revng/Pipes/PipelineManager.h"
+#include "revng/Support/TaskScheduler.h"
 
 using std::string;
 using namespace llvm;
@@ -89,6 +97,72 @@ static alias VerboseAlias1("v",
                            aliasopt(Verbose),
                            cat(PipelineCategory));
 
+static opt<unsigned> Jobs("j",
+                          desc("Number of independent parts of the request "
+                               "that can be produced in parallel. Parts using "
+                               "LLVM containers still run one at the time. "
+                               "The pipes must not race on the pipeline "
+                               "context. If specified, it's also the number "
+                               "of threads used by revng, overriding "
+                               "REVNG_THREADS"),
+                          cat(PipelineCategory),
+                          init(1));
+
+static opt<unsigned> StreamingBatchSize("stream-batch-size",
+                                        desc("Stream the requested targets "
+                                             "through the steps in batches "
+                                             "of this size, overlapping the "
+                                             "steps of different batches. 0 "
+                                             "disables streaming"),
+                                        cat(PipelineCategory),
+                                        init(0));
+
+static opt<string> CacheDirectory("cache-dir",
+                                  desc("Directory in which the outputs of "
+                                       "each step are cached, indexed by the "
+                                       "hash of their inputs"),
+                                  cat(PipelineCategory),
+                                  init(""));
+
+static cl::list<string> RemoteWorkers("remote-worker",
+                                      desc("Command line running the pipes "
+                                           "of a step on a remote node, such "
+                                           "as `ssh node revng-pipeline-"
+                                           "worker -P pipeline.yml {}`, where "
+                                           "{} is the request directory. Can "
+                                           "be repeated"),
+                                      cat(PipelineCategory));
+
+static opt<string> RemoteScratchDirectory("remote-scratch-dir",
+                                          desc("Directory, shared with the "
+                                               "remote workers, in which "
+                                               "requests are exchanged"),
+                                          cat(PipelineCategory),
+                                          init(""));
+
+static opt<unsigned> RemoteTimeout("remote-timeout",
+                                   desc("Seconds after which a remote worker "
+                                        "is considered failed, 0 means no "
+                                        "timeout"),
+                                   cat(PipelineCategory),
+                                   init(0));
+
+static opt<string> ProfileOutput("profile",
+                                 desc("Record time and memory used by each "
+                                      "pipe, write them as a Chrome trace to "
+                                      "the provided file and print a "
+                                      "summary"),
+                                 cat(PipelineCategory),
+                                 init(""));
+
+static opt<string> EventsOutput("events",
+                                desc("Describe each request and each executed "
+                                     "step, with the requested, available and "
+                                     "produced targets, as JSON lines written "
+                                     "to the provided file"),
+                                cat(PipelineCategory),
+                                init(""));
+
 static cl::list<string> StoresOverrides("o",
                                         desc("Store the target container at "
                                              "the "
@@ -138,7 +212,32 @@ static void runPipeline(Runner &Pipeline) {
     AbortOnError(parseTarget(ToProduce, Target, Registry));
 
   auto *Stream = Verbose ? &dbgs() : nullptr;
+  Pipeline.setJobs(Jobs);
+  Pipeline.setStreamingBatchSize(StreamingBatchSize);
+  if (not CacheDirectory.empty())
+    Pipeline.setCacheDirectory(CacheDirectory);
+
+  std::optional<RemoteScheduler> Scheduler;
+  if (not RemoteWorkers.empty()) {
+    if (RemoteScratchDirectory.empty())
+      AbortOnError(createStringError(inconvertibleErrorCode(),
+                                     "--remote-worker requires "
+                                     "--remote-scratch-dir"));
+
+    Scheduler.emplace(RemoteScratchDirectory);
+    for (const string &CommandLine : RemoteWorkers) {
+      auto Worker = CommandRemoteWorker::fromCommandLine(CommandLine,
+                                                         RemoteTimeout);
+      if (Worker == nullptr)
+        AbortOnError(createStringError(inconvertibleErrorCode(),
+                                       "Empty remote worker command line"));
+      Scheduler->addWorker(std::move(Worker));
+    }
+    Pipeline.setRemoteScheduler(&*Scheduler);
+  }
+
   AbortOnError(Pipeline.run(TargetStep, ToProduce, Stream));
+  Pipeline.setRemoteScheduler(nullptr);
 }
 
 static auto makeManager() {
@@ -150,6 +249,9 @@ static auto makeManager() {
 int main(int argc, const char *argv[]) {
   HideUnrelatedOptions(PipelineCategory);
   ParseCommandLineOptions(argc, argv);
+  if (Jobs.getNumOccurrences() > 0)
+    TaskScheduler::setGlobalThreadsCount(Jobs);
+
   auto LoggerOS = PipelineLogger.getAsLLVMStream();
 
   std::string Msg;
@@ -177,6 +279,23 @@ int main(int argc, const char *argv[]) {
     Manager.writeAllPossibleTargets(OS);
     return EXIT_SUCCESS;
   }
+  pipeline::Profiler PipesProfiler;
+  if (not ProfileOutput.empty())
+    Manager.getRunner().setProfiler(&PipesProfiler);
+
+  std::unique_ptr<ToolOutputFile> EventsFile;
+  std::unique_ptr<pipeline::RunEventLog> Events;
+  if (not EventsOutput.empty()) {
+    std::error_code EC;
+    EventsFile = std::make_unique<ToolOutputFile>(EventsOutput,
+                                                  EC,
+                                                  sys::fs::OF_Text);
+    if (EC)
+      AbortOnError(createStringError(EC, "could not open the events output"));
+    Events = std::make_unique<pipeline::RunEventLog>(EventsFile->os());
+    Manager.getRunner().setEventLog(Events.get());
+  }
+
   if (ProduceAllPossibleTargets) {
     PipelineLogger.enable();
     AbortOnError(Manager.produceAllPossibleTargets(*LoggerOS));
@@ -189,6 +308,24 @@ int main(int argc, const char *argv[]) {
     AbortOnError(Manager.invalidateAllPossibleTargets(*LoggerOS));
   }
 
+  if (EventsFile) {
+    Manager.getRunner().setEventLog(nullptr);
+    EventsFile->keep();
+  }
+
+  if (not ProfileOutput.empty()) {
+    Manager.getRunner().setProfiler(nullptr);
+
+    std::error_code EC;
+    ToolOutputFile Output(ProfileOutput, EC, sys::fs::OF_Text);
+    if (EC)
+      AbortOnError(createStringError(EC, "could not open the profile output"));
+    PipesProfiler.writeChromeTrace(Output.os());
+    Output.keep();
+
+    PipesProfiler.printSummary(dbgs());
+  }
+
   AbortOnError(Manager.store(StoresOverrides));
   AbortOnError(Manager.storeToDisk());
 
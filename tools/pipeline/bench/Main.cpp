@@ -0,0 +1,390 @@
+/// \file Main.cpp
+/// \brief Measures the overhead of the pipeline framework on a synthetic
+///        pipeline
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/ToolOutputFile.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "revng/Pipeline/Container.h"
+#include "revng/Pipeline/Context.h"
+#include "revng/Pipeline/Contract.h"
+#include "revng/Pipeline/Kind.h"
+#include "revng/Pipeline/KindsRegistry.h"
+#include "revng/Pipeline/Pipe.h"
+#include "revng/Pipeline/Rank.h"
+#include "revng/Pipeline/Runner.h"
+#include "revng/Pipeline/Target.h"
+
+using std::string;
+using namespace llvm;
+using namespace llvm::cl;
+using namespace pipeline;
+
+static cl::OptionCategory BenchCategory("revng-bench-pipeline options", "");
+
+static opt<unsigned> StepsCount("steps",
+                                desc("number of steps of the synthetic "
+                                     "pipeline"),
+                                cat(BenchCategory),
+                                init(8));
+
+static opt<unsigned> KindsCount("kinds",
+                                desc("number of kinds the pipes convert the "
+                                     "targets through"),
+                                cat(BenchCategory),
+                                init(4));
+
+static opt<unsigned> TargetsCount("targets",
+                                  desc("number of targets in each step"),
+                                  cat(BenchCategory),
+                                  init(10000));
+
+static opt<unsigned> Repetitions("repeat",
+                                 desc("how many times each operation is "
+                                      "measured"),
+                                 cat(BenchCategory),
+                                 init(5));
+
+static opt<string> OutputPath("o",
+                              desc("write the report here instead of stdout"),
+                              value_desc("path"),
+                              cat(BenchCategory),
+                              init("-"));
+
+static ExitOnError AbortOnError;
+
+static Rank BenchRoot("BenchRoot");
+static Rank ObjectRank("BenchObject", BenchRoot);
+
+/// The kinds of the synthetic pipeline, they are created according to the
+/// command line options, before the hierarchy of kinds gets initialized
+static std::deque<Kind> Kinds;
+static StringMap<const Kind *> KindsByName;
+
+static const std::string ContainerName = "bench";
+
+/// A container of targets carrying no data, serialized one target per line
+class BenchContainer : public Container<BenchContainer> {
+public:
+  static char ID;
+
+private:
+  std::set<Target> Targets;
+
+public:
+  BenchContainer(llvm::StringRef Name) : Container<BenchContainer>(Name) {}
+
+  ~BenchContainer() override = default;
+
+public:
+  void insert(Target NewTarget) {
+    markModified();
+    Targets.insert(std::move(NewTarget));
+  }
+  const std::set<Target> &targets() const { return Targets; }
+
+public:
+  std::unique_ptr<ContainerBase>
+  cloneFiltered(const TargetsList &Filter) const final {
+    auto Result = std::make_unique<BenchContainer>(name());
+    for (const Target &T : Filter)
+      if (Targets.count(T) != 0)
+        Result->insert(T);
+    return Result;
+  }
+
+  TargetsList enumerate() const final {
+    return TargetsList(TargetsList::List(Targets.begin(), Targets.end()));
+  }
+
+  llvm::Error serialize(llvm::raw_ostream &OS) const final {
+    for (const Target &T : Targets)
+      OS << T.serialize() << "\n";
+    return llvm::Error::success();
+  }
+
+protected:
+  bool removeImpl(const TargetsList &ToRemove) final {
+    bool RemovedAll = true;
+    for (const Target &T : ToRemove)
+      RemovedAll = Targets.erase(T) != 0 and RemovedAll;
+    return RemovedAll;
+  }
+
+  llvm::Error deserializeImpl(const llvm::MemoryBuffer &Buffer) final {
+    Targets.clear();
+
+    SmallVector<StringRef, 0> Lines;
+    Buffer.getBuffer().split(Lines, '\n', -1, false);
+    for (StringRef Line : Lines) {
+      auto [Path, KindName] = Line.rsplit(':');
+      auto It = KindsByName.find(KindName);
+      if (It == KindsByName.end())
+        return createStringError(inconvertibleErrorCode(),
+                                 "No known kind %s",
+                                 KindName.str().c_str());
+      insert(Target(Path.str(), *It->second));
+    }
+
+    return llvm::Error::success();
+  }
+
+  void clearImpl() final { Targets.clear(); }
+
+private:
+  void mergeBackImpl(BenchContainer &&Other) final {
+    Targets.merge(Other.Targets);
+  }
+};
+
+char BenchContainer::ID;
+
+/// Turns every target of kind From into one of kind To
+class ConvertPipe {
+public:
+  static constexpr auto Name = "Convert";
+
+private:
+  const Kind *From;
+  const Kind *To;
+
+public:
+  ConvertPipe(const Kind &From, const Kind &To) : From(&From), To(&To) {}
+
+public:
+  std::vector<ContractGroup> getContract() const {
+    return { ContractGroup(*From, Exactness::Exact, 0, *To, 0) };
+  }
+
+  void run(const Context &, BenchContainer &Container) {
+    std::vector<Target> Converted;
+    for (const Target &T : Container.targets())
+      if (&T.getKind() == From)
+        Converted.push_back(T);
+
+    Container.remove(TargetsList(TargetsList::List(Converted.begin(),
+                                                   Converted.end())));
+    for (Target &T : Converted) {
+      T.setKind(*To);
+      Container.insert(std::move(T));
+    }
+  }
+};
+
+static std::string getStepName(unsigned Index) {
+  return "step-" + std::to_string(Index);
+}
+
+static const Kind &getStepKind(unsigned Index) {
+  return Kinds[Index % Kinds.size()];
+}
+
+static ConvertPipe getStepPipe(unsigned Index) {
+  revng_assert(Index != 0);
+  return ConvertPipe(getStepKind(Index - 1), getStepKind(Index));
+}
+
+/// All the targets a step is expected to hold once the pipeline has run
+static TargetsList getStepTargets(unsigned Index) {
+  TargetsList::List Result;
+  Result.reserve(TargetsCount);
+  for (unsigned I = 0; I < TargetsCount; ++I)
+    Result.emplace_back("t" + std::to_string(I), getStepKind(Index));
+  return TargetsList(std::move(Result));
+}
+
+/// A synthetic pipeline, with the context it runs in
+struct BenchPipeline {
+  Context Ctx;
+  Runner Pipeline;
+
+  BenchPipeline() :
+    Ctx(Context::fromRegistry(makeRegistry())), Pipeline(Ctx) {
+    Pipeline.addDefaultConstructibleFactory<BenchContainer>(ContainerName);
+    Pipeline.emplaceStep("", getStepName(0));
+    for (unsigned I = 1; I < StepsCount; ++I)
+      Pipeline.emplaceStep(getStepName(I - 1),
+                           getStepName(I),
+                           bindPipe(getStepPipe(I), ContainerName));
+  }
+
+  void populate() {
+    auto &Input = Pipeline[getStepName(0)].containers()[ContainerName];
+    for (const Target &T : getStepTargets(0))
+      cast<BenchContainer>(Input).insert(T);
+  }
+
+private:
+  static KindsRegistry makeRegistry() {
+    KindsRegistry::Container Result;
+    for (Kind &K : Kinds)
+      Result.push_back(&K);
+    return KindsRegistry(std::move(Result));
+  }
+};
+
+using Clock = std::chrono::steady_clock;
+
+template<typename T>
+static double measure(T &&Operation) {
+  auto Start = Clock::now();
+  Operation();
+  std::chrono::duration<double> Elapsed = Clock::now() - Start;
+  return Elapsed.count();
+}
+
+/// The time taken by each repetition of an operation
+struct Samples {
+  std::string Name;
+  std::vector<double> Seconds;
+};
+
+static void runContractDeduction(Samples &Results) {
+  std::vector<ContractGroup> Contracts;
+  for (unsigned I = 1; I < StepsCount; ++I)
+    for (const ContractGroup &Contract : getStepPipe(I).getContract())
+      Contracts.push_back(Contract);
+
+  ContainerToTargetsMap Input;
+  Input[ContainerName] = getStepTargets(0);
+  ContainerToTargetsMap Output;
+  Output[ContainerName] = getStepTargets(StepsCount - 1);
+
+  Results.Seconds.push_back(measure([&] {
+    ContainerToTargetsMap Status = Input;
+    for (const ContractGroup &Contract : Contracts)
+      Contract.deduceResults(Status, { ContainerName });
+
+    ContainerToTargetsMap Requirements = Output;
+    for (const ContractGroup &Contract : llvm::reverse(Contracts))
+      Requirements = Contract.deduceRequirements(Requirements,
+                                                 { ContainerName });
+  }));
+}
+
+static void runRepetition(std::vector<Samples> &Results, StringRef Directory) {
+  auto Bench = std::make_unique<BenchPipeline>();
+  Runner &Pipeline = Bench->Pipeline;
+  Bench->populate();
+
+  auto Sample = Results.begin();
+  runContractDeduction(*Sample++);
+
+  Sample++->Seconds.push_back(measure([&] {
+    Runner::State State;
+    Pipeline.deduceAllPossibleTargets(State);
+  }));
+
+  ContainerToTargetsMap Requested;
+  Requested[ContainerName] = getStepTargets(StepsCount - 1);
+  Sample++->Seconds.push_back(measure([&] {
+    AbortOnError(Pipeline.run(getStepName(StepsCount - 1), Requested));
+  }));
+
+  Target Invalidated("t0", getStepKind(0));
+  Sample++->Seconds.push_back(measure([&] {
+    Runner::InvalidationMap Invalidations;
+    AbortOnError(Pipeline.getInvalidations(Invalidated, Invalidations));
+  }));
+
+  Sample++->Seconds.push_back(measure([&] {
+    AbortOnError(Pipeline.storeToDisk(Directory));
+  }));
+
+  // Load in a pipeline that has never been run, as a fresh invocation would
+  auto Loaded = std::make_unique<BenchPipeline>();
+  Sample++->Seconds.push_back(measure([&] {
+    AbortOnError(Loaded->Pipeline.loadFromDisk(Directory));
+  }));
+
+  const Step &LastStep = Loaded->Pipeline[getStepName(StepsCount - 1)];
+  const ContainerBase &Container = LastStep.containers().at(ContainerName);
+  revng_check(Container.enumerate().size() == TargetsCount);
+}
+
+static void writeReport(raw_ostream &OS, ArrayRef<Samples> Results) {
+  json::OStream JSON(OS, 2);
+  JSON.object([&] {
+    JSON.attribute("steps", static_cast<int64_t>(StepsCount));
+    JSON.attribute("kinds", static_cast<int64_t>(KindsCount));
+    JSON.attribute("targets", static_cast<int64_t>(TargetsCount));
+    JSON.attribute("repetitions", static_cast<int64_t>(Repetitions));
+    JSON.attributeObject("operations", [&] {
+      for (const Samples &Operation : Results) {
+        std::vector<double> Sorted = Operation.Seconds;
+        llvm::sort(Sorted);
+        JSON.attributeObject(Operation.Name, [&] {
+          JSON.attribute("seconds_min", Sorted.front());
+          JSON.attribute("seconds_median", Sorted[Sorted.size() / 2]);
+          JSON.attribute("seconds_max", Sorted.back());
+        });
+      }
+    });
+  });
+  OS << "\n";
+}
+
+int main(int argc, const char *argv[]) {
+  HideUnrelatedOptions(BenchCategory);
+  ParseCommandLineOptions(argc, argv);
+
+  if (StepsCount == 0 or KindsCount == 0 or TargetsCount == 0
+      or Repetitions == 0)
+    AbortOnError(createStringError(inconvertibleErrorCode(),
+                                   "steps, kinds, targets and repetitions "
+                                   "must be positive"));
+
+  for (unsigned I = 0; I < KindsCount; ++I) {
+    Kinds.emplace_back("BenchKind" + std::to_string(I), &ObjectRank);
+    KindsByName[Kinds.back().name()] = &Kinds.back();
+  }
+  Rank::init();
+  Kind::init();
+
+  std::vector<Samples> Results = { { "contract-deduction", {} },
+                                   { "deduce-all-possible-targets", {} },
+                                   { "run", {} },
+                                   { "get-invalidations", {} },
+                                   { "store-to-disk", {} },
+                                   { "load-from-disk", {} } };
+
+  SmallString<128> Directory;
+  auto EC = sys::fs::createUniqueDirectory("revng-bench-pipeline", Directory);
+  AbortOnError(errorCodeToError(EC));
+
+  for (unsigned I = 0; I < Repetitions; ++I) {
+    std::string RepetitionDirectory = (Twine(Directory) + "/" + Twine(I)).str();
+    runRepetition(Results, RepetitionDirectory);
+  }
+
+  AbortOnError(errorCodeToError(sys::fs::remove_directories(Directory)));
+
+  std::error_code OutputEC;
+  ToolOutputFile Output(OutputPath, OutputEC, sys::fs::OF_Text);
+  AbortOnError(errorCodeToError(OutputEC));
+  writeReport(Output.os(), Results);
+  Output.keep();
+
+  return EXIT_SUCCESS;
+}
@@ -5,8 +5,10 @@
 //
 
 #include <cstdlib>
+#include <vector>
 
 #include "llvm/Support/DynamicLibrary.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_os_ostream.h"
 
 #include "revng/Model/LoadModelPass.h"
@@ -33,10 +35,15 @@ static cl::list<string>
   InputPipeline("P", desc("<Pipeline>"), cat(PipelineCategory));
 
 static cl::list<string> Targets(Positional,
-                                Required,
+                                ZeroOrMore,
                                 desc("<Targets to invalidate>..."),
                                 cat(PipelineCategory));
 
+static opt<string> TargetsFile("targets",
+                               desc("file listing further targets to "
+                                    "invalidate, one per line"),
+                               cat(PipelineCategory));
+
 static opt<string> TargetStep("step",
                               Required,
                               desc("name the step in which to produce the "
@@ -83,13 +90,42 @@ static auto makeManager() {
                                  ExecutionDirectory);
 }
 
+static std::vector<string> getTargets() {
+  std::vector<string> Result(Targets.begin(), Targets.end());
+  if (TargetsFile.empty())
+    return Result;
+
+  auto MaybeBuffer = MemoryBuffer::getFileOrSTDIN(TargetsFile);
+  if (not MaybeBuffer)
+    AbortOnError(errorCodeToError(MaybeBuffer.getError()));
+
+  SmallVector<StringRef, 16> Lines;
+  (*MaybeBuffer)->getBuffer().split(Lines, '\n', -1, false);
+  for (StringRef Line : Lines)
+    if (not Line.trim().empty())
+      Result.push_back(Line.trim().str());
+
+  return Result;
+}
+
 static Runner::InvalidationMap getInvalidationMap(Runner &Pipeline) {
   Runner::InvalidationMap Invalidations;
   auto &ToInvalidate = Invalidations[TargetStep];
 
+  if (not Pipeline.containsStep(TargetStep))
+    AbortOnError(createStringError(inconvertibleErrorCode(),
+                                   "No known step " + TargetStep));
+
+  auto ToParse = getTargets();
+  if (ToParse.empty())
+    AbortOnError(createStringError(inconvertibleErrorCode(),
+                                   "No targets to invalidate"));
+
+  // Parse all the targets at once, expanding the globs against the current
+  // content of the step
   const auto &Registry = Pipeline.getKindsRegistry();
-  for (const auto &Target : Targets)
-    AbortOnError(parseTarget(ToInvalidate, Target, Registry));
+  const auto &Containers = Pipeline[TargetStep].containers();
+  AbortOnError(parseTargets(ToInvalidate, ToParse, Registry, Containers));
 
   return Invalidations;
 }
@@ -0,0 +1,66 @@
+/// \file Main.cpp
+/// \brief Serves a request of a remote revng-pipeline, see RemoteWorker.
+
+//
+// This file is distributed under the MIT License. See LICENSE.md for details.
+//
+
+#include <cstdlib>
+
+#include "llvm/Support/DynamicLibrary.h"
+
+#include "revng/Pipeline/AllRegistries.h"
+#include "revng/Pipeline/RemoteWorkers.h"
+#include "revng/Pipes/PipelineManager.h"
+
+using std::string;
+using namespace llvm;
+using namespace llvm::cl;
+using namespace pipeline;
+using namespace ::revng::pipes;
+
+cl::OptionCategory PipelineCategory("revng-pipeline-worker options", "");
+
+static cl::list<string>
+  InputPipeline("P", desc("<Pipeline>"), cat(PipelineCategory));
+
+static opt<string> RequestDirectory(Positional,
+                                    Required,
+                                    desc("<Request directory>"),
+                                    cat(PipelineCategory));
+
+static cl::list<string> EnablingFlags("f",
+                                      desc("list of pipeline enabling flags"),
+                                      cat(PipelineCategory));
+
+static cl::list<string>
+  LoadLibraries("load", desc("libraries to open"), cat(PipelineCategory));
+
+static alias A1("l",
+                desc("Alias for --load"),
+                aliasopt(LoadLibraries),
+                cat(PipelineCategory));
+
+static ExitOnError AbortOnError;
+
+int main(int argc, const char *argv[]) {
+  HideUnrelatedOptions(PipelineCategory);
+  ParseCommandLineOptions(argc, argv);
+
+  std::string Msg;
+  for (const auto &Library : LoadLibraries) {
+    if (sys::DynamicLibrary::LoadLibraryPermanently(Library.c_str(), &Msg))
+      AbortOnError(createStringError(inconvertibleErrorCode(), Msg));
+  }
+
+  Registry::runAllInitializationRoutines();
+
+  // Containers are shipped with the request, nothing is loaded upfront
+  auto Manager = AbortOnError(PipelineManager::create(InputPipeline,
+                                                      EnablingFlags,
+                                                      ""));
+
+  AbortOnError(serveRemoteRequest(Manager.getRunner(), RequestDirectory));
+
+  return EXIT_SUCCESS;
+}